@@ -63,6 +63,7 @@ GDB_FUNCTIONS_NAME := rethinkdb-gdb.py
 
 PACKAGE_NAME := $(VANILLA_PACKAGE_NAME)
 SERVER_UNIT_TEST_NAME := $(SERVER_EXEC_NAME)-unittest
+SERVER_BENCH_NAME := $(SERVER_EXEC_NAME)-bench
 
 PROTO_FILE_SRC := $(TOP)/src/rdb_protocol/ql2.proto
 PROTO_DIR := $(BUILD_ROOT_DIR)/proto
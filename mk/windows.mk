@@ -21,7 +21,7 @@ endif
 
 SOURCES := $(shell find $(TOP)/src \( -name '*.cc' -or -name '*.hpp' -or -name '*.tcc' \) -and -not -name '\.*')
 
-SOURCES_NOUNIT := $(filter-out $(TOP)/src/unittest/%,$(SOURCES))
+SOURCES_NOUNIT := $(filter-out $(TOP)/src/unittest/% $(TOP)/src/bench/%,$(SOURCES))
 
 LIB_DEPS := $(foreach dep, $(FETCH_LIST), $(SUPPORT_BUILD_DIR)/$(dep)_$($(dep)_VERSION)/$(INSTALL_WITNESS))
 
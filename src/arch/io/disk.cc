@@ -16,6 +16,7 @@
 
 #include <algorithm>
 #include <functional>
+#include <map>
 
 #include "arch/types.hpp"
 #include "arch/runtime/thread_pool.hpp"
@@ -25,6 +26,8 @@
 #include "arch/io/disk/conflict_resolving.hpp"
 #include "arch/io/disk/stats.hpp"
 #include "arch/io/disk/accounting.hpp"
+#include "arch/io/disk/uring.hpp"
+#include "arch/io/concurrency.hpp"
 #include "backtrace.hpp"
 #include "config/args.hpp"
 #include "do_on_thread.hpp"
@@ -50,14 +53,36 @@ public:
     linux_disk_manager_t(linux_event_queue_t *queue,
                          int batch_factor,
                          int max_concurrent_io_requests,
+                         io_backend_t io_backend,
                          perfmon_collection_t *stats) :
         stack_stats(stats, "stack"),
         conflict_resolver(stats),
         accounter(batch_factor),
         backend_stats(stats, "backend", accounter.producer),
-        backend(queue, backend_stats.producer, max_concurrent_io_requests),
         outstanding_txn(0)
     {
+        if (io_backend == io_backend_t::io_uring && !uring_diskmgr_t::is_available()) {
+            logWRN("This system doesn't support io_uring.  Using a thread pool for "
+                   "disk I/O instead.");
+            io_backend = io_backend_t::pool;
+        }
+        switch (io_backend) {
+        case io_backend_t::pool:
+            pool_backend.init(new pool_diskmgr_t(queue, backend_stats.producer,
+                                                 max_concurrent_io_requests));
+            pool_backend->done_fun = std::bind(&stats_diskmgr_2_t::done,
+                                               &backend_stats, ph::_1);
+            break;
+        case io_backend_t::io_uring:
+            uring_backend.init(new uring_diskmgr_t(queue, backend_stats.producer,
+                                                   max_concurrent_io_requests));
+            uring_backend->done_fun = std::bind(&stats_diskmgr_2_t::done,
+                                                &backend_stats, ph::_1);
+            break;
+        default:
+            unreachable();
+        }
+
         /* Hook up the `submit_fun`s of the parts of the IO stack that are above the
         queue. (The parts below the queue use the `passive_producer_t` interface instead
         of a callback function.) */
@@ -66,8 +91,7 @@ public:
         conflict_resolver.submit_fun = std::bind(&accounting_diskmgr_t::submit,
                                                  &accounter, ph::_1);
 
-        /* Hook up everything's `done_fun`. */
-        backend.done_fun = std::bind(&stats_diskmgr_2_t::done, &backend_stats, ph::_1);
+        /* Hook up everything's `done_fun`.  (The backend's was hooked up above.) */
         backend_stats.done_fun = std::bind(&accounting_diskmgr_t::done, &accounter, ph::_1);
         accounter.done_fun = std::bind(&conflict_resolving_diskmgr_t::done,
                                        &conflict_resolver, ph::_1);
@@ -81,8 +105,9 @@ public:
                 outstanding_txn);
     }
 
-    void *create_account(int pri, int outstanding_requests_limit) {
-        return new accounting_diskmgr_t::account_t(&accounter, pri, outstanding_requests_limit);
+    void *create_account(io_class_t io_class, int pri, int outstanding_requests_limit) {
+        return new accounting_diskmgr_t::account_t(&accounter, io_class, pri,
+                                                   outstanding_requests_limit);
     }
 
     void destroy_account(void *account) {
@@ -92,6 +117,10 @@ public:
         }, home_thread());
     }
 
+    file_load_t get_load() const {
+        return stack_stats.get_load();
+    }
+
     void submit_action_to_stack_stats(action_t *a) {
         assert_thread();
         outstanding_txn++;
@@ -180,7 +209,8 @@ private:
     holding back operations that must be run after other, currently-running, operations.
     Then it goes to the account manager, which queues up running IO operations according
     to which account they are part of. Finally the "backend" pops the IO operations
-    from the queue.
+    from the queue.  The backend is either a thread pool or an io_uring, and only one
+    of `pool_backend` and `uring_backend` is set.
 
     At two points in the process--once as soon as it is submitted, and again right
     as the backend pops it off the queue--its statistics are recorded. The "stack stats"
@@ -193,7 +223,8 @@ private:
     conflict_resolving_diskmgr_t conflict_resolver;
     accounting_diskmgr_t accounter;
     stats_diskmgr_2_t backend_stats;
-    pool_diskmgr_t backend;
+    scoped_ptr_t<pool_diskmgr_t> pool_backend;
+    scoped_ptr_t<uring_diskmgr_t> uring_backend;
 
 
     intptr_t outstanding_txn;
@@ -202,11 +233,14 @@ private:
 };
 
 io_backender_t::io_backender_t(file_direct_io_mode_t _direct_io_mode,
-                               int max_concurrent_io_requests)
+                               int max_concurrent_io_requests,
+                               io_backend_t io_backend)
     : direct_io_mode(_direct_io_mode),
+      stats_membership(&get_global_perfmon_collection(), &stats, "disk"),
       diskmgr(new linux_disk_manager_t(&linux_thread_pool_t::get_thread()->queue,
                                        DEFAULT_IO_BATCH_FACTOR,
                                        max_concurrent_io_requests,
+                                       io_backend,
                                        &stats)) { }
 
 io_backender_t::~io_backender_t() { }
@@ -222,7 +256,8 @@ linux_file_t::linux_file_t(scoped_fd_t &&_fd, int64_t _file_size, linux_disk_man
     // file_account_t outside of the thread pool?  But they're associated with the diskmgr,
     // aren't they?)
     if (linux_thread_pool_t::get_thread()) {
-        default_account.init(new file_account_t(this, 1, UNLIMITED_OUTSTANDING_REQUESTS));
+        default_account.init(new file_account_t(this, io_class_t::foreground_write, 1,
+                                                 UNLIMITED_OUTSTANDING_REQUESTS));
     }
 }
 
@@ -255,7 +290,6 @@ void linux_file_t::set_file_size(int64_t new_size) {
     file_size = new_size;
 }
 
-// For growing in large chunks at a time.
 int64_t chunk_factor(int64_t size, int64_t extent_size) {
     // x is at most 12.5% of size. Overall we align to chunks no larger than 64 extents.
     // This ratio was increased from 6.25% for performance reasons.  Resizing a file
@@ -356,6 +390,16 @@ void linux_file_t::writev_async(int64_t offset, size_t length,
 
 }
 
+void linux_file_t::co_datasync() {
+    int errsv;
+    thread_pool_t::run_in_blocker_pool([&]() {
+        errsv = perform_datasync(fd.get());
+    });
+    if (errsv != 0) {
+        crash("datasync failed.  (%s)", errno_string(errsv).c_str());
+    }
+}
+
 bool linux_file_t::coop_lock_and_check() {
 #ifdef _WIN32
     // TODO WINDOWS
@@ -369,9 +413,16 @@ bool linux_file_t::coop_lock_and_check() {
 #endif
 }
 
-void *linux_file_t::create_account(int priority, int outstanding_requests_limit) {
+file_load_t linux_file_t::get_load() {
+    rassert(diskmgr != nullptr,
+            "No diskmgr has been constructed (are we running without an event queue?)");
+    return diskmgr->get_load();
+}
+
+void *linux_file_t::create_account(io_class_t io_class, int priority,
+                                   int outstanding_requests_limit) {
     assert_thread();
-    return diskmgr->create_account(priority, outstanding_requests_limit);
+    return diskmgr->create_account(io_class, priority, outstanding_requests_limit);
 }
 
 void linux_file_t::destroy_account(void *account) {
@@ -602,6 +653,107 @@ void crash_due_to_inaccessible_database_file(const char *path, file_open_result_
         , path, errno_string(open_res.errsv).c_str());
 }
 
+#ifdef __linux__
+namespace {
+
+/* Tables each have their own file, so with many tables on one device, index writes
+at `durability: hard` turn into many small datasyncs that each flush the device's
+cache.  Datasyncs of direct I/O files on the same device are grouped instead: a
+thread that comes along while another one is syncing waits for it to finish, and then
+one of the waiting threads runs a single `syncfs()` for all of them.  A thread that's
+alone runs a plain `fdatasync()`, so a single table pays nothing extra.
+
+Buffered files always get `fdatasync()`, because older kernels don't report writeback
+errors from `syncfs()`.  Writes to direct I/O files report their errors directly. */
+struct device_sync_group_t {
+    device_sync_group_t()
+        : waiters(0), started(0), finished(0), in_progress(false),
+          last_failed(0), last_failed_error(0) { }
+
+    system_mutex_t mutex;
+    system_cond_t cond;
+    // The number of threads in `grouped_datasync()` for this device.
+    int waiters;
+    // Syncs are numbered in the order they start.  Only one runs at a time.
+    uint64_t started;
+    uint64_t finished;
+    bool in_progress;
+    // The most recent sync that failed, and with what error.
+    uint64_t last_failed;
+    int last_failed_error;
+};
+
+// The groups are never destroyed, because blocker threads can outlive static
+// destructors.
+device_sync_group_t *get_device_sync_group(dev_t device) {
+    static system_mutex_t *mutex = new system_mutex_t;
+    static std::map<dev_t, device_sync_group_t *> *groups
+        = new std::map<dev_t, device_sync_group_t *>;
+    system_mutex_t::lock_t lock(mutex);
+    device_sync_group_t **group = &(*groups)[device];
+    if (*group == nullptr) {
+        *group = new device_sync_group_t;
+    }
+    return *group;
+}
+
+int fdatasync_errno(fd_t fd) {
+    int res = fdatasync(fd);
+    return res == -1 ? get_errno() : 0;
+}
+
+int grouped_datasync(fd_t fd, device_sync_group_t *group) {
+    // Our writes have completed, so any sync that starts from now on covers them.
+    uint64_t needed;
+    {
+        system_mutex_t::lock_t lock(&group->mutex);
+        ++group->waiters;
+        needed = group->started + 1;
+    }
+
+    for (;;) {
+        uint64_t generation;
+        bool whole_device;
+        {
+            system_mutex_t::lock_t lock(&group->mutex);
+            while (group->in_progress && group->finished < needed) {
+                group->cond.wait(&group->mutex);
+            }
+            if (group->finished >= needed) {
+                --group->waiters;
+                return group->last_failed >= needed ? group->last_failed_error : 0;
+            }
+            group->in_progress = true;
+            generation = ++group->started;
+            // If nobody else is waiting, nobody else's writes need covering.  Threads
+            // that come along later need a sync that starts after this one.
+            whole_device = group->waiters > 1;
+        }
+
+        int errcode;
+        if (whole_device) {
+            int res = syncfs(fd);
+            errcode = res == -1 ? get_errno() : 0;
+        } else {
+            errcode = fdatasync_errno(fd);
+        }
+
+        {
+            system_mutex_t::lock_t lock(&group->mutex);
+            group->in_progress = false;
+            group->finished = generation;
+            if (errcode != 0) {
+                group->last_failed = generation;
+                group->last_failed_error = errcode;
+            }
+            group->cond.broadcast();
+        }
+    }
+}
+
+}  // namespace
+#endif  // __linux__
+
 // Upon error, returns the errno value.
 int perform_datasync(fd_t fd) {
     // On OS X, we use F_FULLFSYNC because fsync lies.  fdatasync is not available.  On
@@ -627,8 +779,12 @@ int perform_datasync(fd_t fd) {
 
 #elif defined(__linux__)
 
-    int res = fdatasync(fd);
-    return res == -1 ? get_errno() : 0;
+    struct stat st;
+    const int flags = fcntl(fd, F_GETFL);
+    if (flags == -1 || (flags & O_DIRECT) == 0 || fstat(fd, &st) != 0) {
+        return fdatasync_errno(fd);
+    }
+    return grouped_datasync(fd, get_device_sync_group(st.st_dev));
 
 #else
 #error "perform_datasync not implemented"
@@ -29,7 +29,8 @@ public:
     // stops us from specifying this on a file-by-file basis, but right now there's no desire for
     // that.  See https://github.com/rethinkdb/rethinkdb/issues/97#issuecomment-19778177 .
     io_backender_t(file_direct_io_mode_t direct_io_mode,
-                   int max_concurrent_io_requests = DEFAULT_MAX_CONCURRENT_IO_REQUESTS);
+                   int max_concurrent_io_requests = DEFAULT_MAX_CONCURRENT_IO_REQUESTS,
+                   io_backend_t io_backend = io_backend_t::pool);
     ~io_backender_t();
     linux_disk_manager_t *get_diskmgr_ptr() { return diskmgr.get(); }
     file_direct_io_mode_t get_direct_io_mode() const;
@@ -37,6 +38,8 @@ public:
 protected:
     const file_direct_io_mode_t direct_io_mode;
     perfmon_collection_t stats;
+    // Puts the disk stats, such as the read and write latencies, under "disk".
+    perfmon_membership_t stats_membership;
     scoped_ptr_t<linux_disk_manager_t> diskmgr;
 
 private:
@@ -83,9 +86,14 @@ public:
     void writev_async(int64_t offset, size_t length, scoped_array_t<iovec> &&bufs,
                       file_account_t *account, linux_iocallback_t *cb);
 
+    void co_datasync();
+
     bool coop_lock_and_check();
 
-    void *create_account(int priority, int outstanding_requests_limit);
+    file_load_t get_load();
+
+    void *create_account(io_class_t io_class, int priority,
+                         int outstanding_requests_limit);
     void destroy_account(void *account);
 
     ~linux_file_t();
@@ -123,6 +131,9 @@ void verify_aligned_file_access(int64_t file_size, int64_t offset, size_t length
 // Makes blocking syscalls.  Upon error, returns the errno value.
 int perform_datasync(fd_t fd);
 
+// For growing files in large chunks at a time.
+int64_t chunk_factor(int64_t size, int64_t extent_size);
+
 // Calls fsync() on the parent directory of the given path.
 // Returns the errno value in case of an error and 0 otherwise.
 MUST_USE int fsync_parent_directory(const char *path);
@@ -1,24 +1,48 @@
 #include "arch/io/disk/accounting.hpp"
 
+#include "config/args.hpp"
 #include "containers/printf_buffer.hpp"
 
+namespace {
+
+int64_t io_class_deadline_ms(io_class_t io_class) {
+    switch (io_class) {
+    case io_class_t::foreground_read: return FOREGROUND_READ_IO_DEADLINE_MS;
+    case io_class_t::foreground_write: return FOREGROUND_WRITE_IO_DEADLINE_MS;
+    case io_class_t::gc: return GC_IO_DEADLINE_MS;
+    case io_class_t::backfill: return BACKFILL_IO_DEADLINE_MS;
+    case io_class_t::sindex_post_construction:
+        return SINDEX_POST_CONSTRUCTION_IO_DEADLINE_MS;
+    case io_class_t::cache_warm_up: return CACHE_WARM_UP_IO_DEADLINE_MS;
+    default: unreachable();
+    }
+}
+
+}  // namespace
+
 /* Each account on the `accounting_diskmgr_t` has its own
    `unlimited_fifo_queue_t` associated with it. Operations for that account
    queue up on that queue while they wait for the `accounting_queue_t` on the
    `accounting_diskmgr_t` to draw from that account. */
-struct accounting_diskmgr_eager_account_t : public semaphore_available_callback_t {
+struct accounting_diskmgr_eager_account_t : public semaphore_available_callback_t,
+                                            public accounting_deadline_source_t {
     typedef accounting_diskmgr_action_t action_t;
 
     accounting_diskmgr_eager_account_t(accounting_diskmgr_t *par,
+                                       io_class_t io_class,
                                        int pri,
                                        int outstanding_requests_limit) :
+        deadline_nanos(io_class_deadline_ms(io_class) * MILLION),
         outstanding_requests_limiter(outstanding_requests_limit == UNLIMITED_OUTSTANDING_REQUESTS ? SEMAPHORE_NO_LIMIT : outstanding_requests_limit),
-        account(&par->queue, &queue, pri),
+        account(&par->queue, &queue, pri, this),
         accounter_lock(par->get_auto_drainer()) {
         rassert(outstanding_requests_limit == UNLIMITED_OUTSTANDING_REQUESTS || outstanding_requests_limit > 0);
     }
 
     void push(action_t *action) {
+        // The time a request spends held back by `outstanding_requests_limiter`
+        // counts against its deadline too.
+        action->deadline.nanos = get_ticks().nanos + deadline_nanos;
         throttled_queue.push_back(action);
         outstanding_requests_limiter.lock(this, 1);
     }
@@ -31,7 +55,14 @@ struct accounting_diskmgr_eager_account_t : public semaphore_available_callback_
         return &outstanding_requests_limiter;
     }
 
+    ticks_t next_deadline() const {
+        // Requests enter `queue` in the order they were pushed, so the first one has
+        // the earliest deadline.
+        return queue.front()->deadline;
+    }
+
 private:
+    const int64_t deadline_nanos;
     // It would be nice if we could just use a limited_fifo_queue to
     // implement the limitation of outstanding requests.
     // However this part of the code must not rely on coroutines, therefore
@@ -48,9 +79,10 @@ private:
 };
 
 accounting_diskmgr_account_t::accounting_diskmgr_account_t(accounting_diskmgr_t *_par,
+                                                           io_class_t _io_class,
                                                            int _pri,
                                                            int _outstanding_requests_limit)
-        : par(_par), pri(_pri),
+        : par(_par), io_class(_io_class), pri(_pri),
           outstanding_requests_limit(_outstanding_requests_limit) { }
 
 accounting_diskmgr_account_t::~accounting_diskmgr_account_t() {
@@ -83,7 +115,8 @@ co_semaphore_t *accounting_diskmgr_account_t::get_outstanding_requests_limiter()
 void accounting_diskmgr_account_t::maybe_init(){
     if (!eager_account.has()) {
         par->assert_thread();
-        eager_account.init(new eager_account_t(par, pri, outstanding_requests_limit));
+        eager_account.init(new eager_account_t(par, io_class, pri,
+                                               outstanding_requests_limit));
     }
 }
 
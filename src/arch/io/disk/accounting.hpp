@@ -32,7 +32,9 @@ private:
 };
 
 /* `accounting_diskmgr_t` shares disk throughput proportionally between a
-number of different "accounts". */
+number of different "accounts".  Each account belongs to an `io_class_t`, and a
+request that has waited longer than its class's deadline is sent to the disk before
+the requests that are still on time. */
 
 typedef stats_diskmgr_2_t::action_t accounting_payload_t;
 
@@ -46,6 +48,7 @@ struct accounting_diskmgr_account_t {
     typedef accounting_diskmgr_action_t action_t;
 
     accounting_diskmgr_account_t(accounting_diskmgr_t *_par,
+                                 io_class_t _io_class,
                                  int _pri,
                                  int _outstanding_requests_limit);
 
@@ -61,6 +64,7 @@ private:
     void maybe_init();
 
     accounting_diskmgr_t *par;
+    io_class_t io_class;
     int pri;
     int outstanding_requests_limit;
     scoped_ptr_t<eager_account_t> eager_account;
@@ -75,6 +79,8 @@ struct accounting_diskmgr_action_t
       public accounting_payload_t {
     accounting_diskmgr_account_t *account;
     auto_drainer_t::lock_t account_acq;
+    // When the request should leave the queue, according to its account's class.
+    ticks_t deadline;
 };
 
 void debug_print(printf_buffer_t *buf,
@@ -1,14 +1,26 @@
 #include "arch/io/disk/stats.hpp"
 
+// Each completed request moves `average_latency_nanos` this fraction of the way
+// towards its own latency.
+const int64_t LATENCY_AVERAGE_WEIGHT = 16;
+
 stats_diskmgr_t::stats_diskmgr_t(perfmon_collection_t *stats, const std::string &name) :
+    outstanding_requests(0),
+    average_latency_nanos(0),
     read_sampler(secs_to_ticks(1)),
     write_sampler(secs_to_ticks(1)),
+    read_latency(secs_to_ticks(1), false),
+    write_latency(secs_to_ticks(1), false),
     stats_membership(stats,
                      &read_sampler, (name + "_read").c_str(),
-                     &write_sampler, (name + "_write").c_str()) { }
+                     &write_sampler, (name + "_write").c_str(),
+                     &read_latency, (name + "_read_latency").c_str(),
+                     &write_latency, (name + "_write_latency").c_str()) { }
 
 
 void stats_diskmgr_t::submit(action_t *a) {
+    a->submit_time = get_ticks();
+    outstanding_requests.fetch_add(1, std::memory_order_relaxed);
     if (a->get_is_read()) {
         read_sampler.begin(&a->start_time);
     } else {
@@ -24,5 +36,19 @@ void stats_diskmgr_t::done(conflict_resolving_diskmgr_action_t *p) {
     } else {
         write_sampler.end(&a->start_time);
     }
+    outstanding_requests.fetch_sub(1, std::memory_order_relaxed);
+    const ticks_t now = get_ticks();
+    const int64_t latency = now.nanos - a->submit_time.nanos;
+    (a->get_is_read() ? &read_latency : &write_latency)->record(ticks_t{latency}, now);
+    const int64_t average = average_latency_nanos.load(std::memory_order_relaxed);
+    average_latency_nanos.store(average + (latency - average) / LATENCY_AVERAGE_WEIGHT,
+                                std::memory_order_relaxed);
     done_fun(a);
 }
+
+file_load_t stats_diskmgr_t::get_load() const {
+    file_load_t load;
+    load.outstanding_requests = outstanding_requests.load(std::memory_order_relaxed);
+    load.average_latency_nanos = average_latency_nanos.load(std::memory_order_relaxed);
+    return load;
+}
@@ -2,11 +2,13 @@
 #ifndef ARCH_IO_DISK_STATS_HPP_
 #define ARCH_IO_DISK_STATS_HPP_
 
+#include <atomic>
 #include <functional>
 #include <string>
 
 #include "arch/io/disk/pool.hpp"
 #include "arch/io/disk/conflict_resolving.hpp"
+#include "arch/types.hpp"
 #include "perfmon/types.hpp"
 
 /* There are two types of stat-collectors in the disk stack. One type is a passive
@@ -18,6 +20,7 @@ struct stats_diskmgr_t {
 
     struct action_t : public conflict_resolving_diskmgr_action_t {
         ticks_t start_time;
+        ticks_t submit_time;
     };
 
     void submit(action_t *a);
@@ -28,8 +31,18 @@ struct stats_diskmgr_t {
 
     void done(conflict_resolving_diskmgr_action_t *p);
 
+    /* Unlike the perfmons, this is always kept up to date, so that background work
+    can hold back when the disk is busy.  It can be called from any thread. */
+    file_load_t get_load() const;
+
 private:
+    // `submit()` and `done()` only run on one thread, but `get_load()` doesn't.
+    std::atomic<int64_t> outstanding_requests;
+    std::atomic<int64_t> average_latency_nanos;
+
     perfmon_duration_sampler_t read_sampler, write_sampler;
+    // The time from `submit()` to `done()`, including the time spent in queues.
+    perfmon_histogram_t read_latency, write_latency;
     perfmon_multi_membership_t stats_membership;
 };
 
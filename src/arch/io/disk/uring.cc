@@ -0,0 +1,284 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include "arch/io/disk/uring.hpp"
+
+#include <limits.h>
+#include <string.h>
+
+#if USE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+
+#include "arch/io/disk.hpp"
+#include "errors.hpp"
+#include "utils.hpp"
+
+namespace {
+
+// The number of blocker threads for the operations that don't go through the ring.
+// These are mostly resizes and the datasyncs around metablock writes.
+const int URING_FALLBACK_THREADS = 4;
+
+// We don't need a bigger ring than this to keep a device busy.
+const uint32_t URING_MAX_ENTRIES = 4096;
+
+// How long to wait before retrying a submission that the kernel had no resources for.
+const int64_t URING_MIN_RETRY_DELAY_MS = 1;
+const int64_t URING_MAX_RETRY_DELAY_MS = 64;
+
+#if USE_IO_URING
+int sys_io_uring_setup(uint32_t entries, io_uring_params *params) {
+    return syscall(__NR_io_uring_setup, entries, params);
+}
+
+int sys_io_uring_enter(int fd, uint32_t to_submit, uint32_t min_complete,
+                       uint32_t flags) {
+    return syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags,
+                   nullptr, 0);
+}
+
+int sys_io_uring_register(int fd, uint32_t opcode, const void *arg,
+                          uint32_t nr_args) {
+    return syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+void *map_ring(int fd, size_t size, off_t offset) {
+    void *ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, fd, offset);
+    guarantee_err(ptr != MAP_FAILED, "Could not map io_uring memory");
+    return ptr;
+}
+
+template <class T>
+T *ring_field(void *ring, uint32_t offset) {
+    return reinterpret_cast<T *>(static_cast<char *>(ring) + offset);
+}
+#endif  // USE_IO_URING
+
+}  // namespace
+
+bool uring_diskmgr_t::is_available() {
+#if USE_IO_URING
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    scoped_fd_t fd(sys_io_uring_setup(1, &params));
+    return fd.get() != INVALID_FD;
+#else
+    return false;
+#endif
+}
+
+uring_diskmgr_t::uring_diskmgr_t(linux_event_queue_t *_queue,
+                                 passive_producer_t<action_t *> *_source,
+                                 int max_concurrent_io_requests)
+    : queue(_queue),
+      source(_source),
+      queue_depth(max_concurrent_io_requests * 2),
+      n_pending(0),
+      ring_entries(0),
+      n_in_ring(0),
+      n_unsubmitted(0),
+      retry_timer(nullptr),
+      retry_delay_ms(URING_MIN_RETRY_DELAY_MS),
+      sq_ring(nullptr),
+      sq_ring_size(0),
+      cq_ring(nullptr),
+      cq_ring_size(0),
+      sqes(nullptr),
+      sqes_size(0),
+      fallback(_queue, &fallback_queue, URING_FALLBACK_THREADS) {
+#if USE_IO_URING
+    guarantee(max_concurrent_io_requests > 0);
+    guarantee(max_concurrent_io_requests < MAXIMUM_MAX_CONCURRENT_IO_REQUESTS);
+
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ring_fd.reset(sys_io_uring_setup(
+        std::min<uint32_t>(queue_depth, URING_MAX_ENTRIES), &params));
+    guarantee_err(ring_fd.get() != INVALID_FD, "io_uring_setup failed");
+    ring_entries = params.sq_entries;
+
+    sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    if ((params.features & IORING_FEAT_SINGLE_MMAP) != 0) {
+        sq_ring_size = std::max(sq_ring_size, cq_ring_size);
+        sq_ring = map_ring(ring_fd.get(), sq_ring_size, IORING_OFF_SQ_RING);
+        cq_ring = sq_ring;
+    } else {
+        sq_ring = map_ring(ring_fd.get(), sq_ring_size, IORING_OFF_SQ_RING);
+        cq_ring = map_ring(ring_fd.get(), cq_ring_size, IORING_OFF_CQ_RING);
+    }
+    sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    sqes = static_cast<io_uring_sqe *>(
+        map_ring(ring_fd.get(), sqes_size, IORING_OFF_SQES));
+
+    sq_head = ring_field<uint32_t>(sq_ring, params.sq_off.head);
+    sq_tail = ring_field<uint32_t>(sq_ring, params.sq_off.tail);
+    sq_mask = ring_field<uint32_t>(sq_ring, params.sq_off.ring_mask);
+    sq_array = ring_field<uint32_t>(sq_ring, params.sq_off.array);
+    cq_head = ring_field<uint32_t>(cq_ring, params.cq_off.head);
+    cq_tail = ring_field<uint32_t>(cq_ring, params.cq_off.tail);
+    cq_mask = ring_field<uint32_t>(cq_ring, params.cq_off.ring_mask);
+    cqes = ring_field<io_uring_cqe>(cq_ring, params.cq_off.cqes);
+
+    const int event_fd = completion_event.get_notify_fd();
+    int res = sys_io_uring_register(ring_fd.get(), IORING_REGISTER_EVENTFD,
+                                    &event_fd, 1);
+    guarantee_err(res == 0, "Could not register an eventfd with io_uring");
+    queue->watch_event(&completion_event, this);
+
+    fallback.done_fun = std::bind(&uring_diskmgr_t::on_fallback_done, this, ph::_1);
+
+    if (source->available->get()) { pump(); }
+    source->available->set_callback(this);
+#else
+    crash("This build doesn't support io_uring.");
+#endif
+}
+
+uring_diskmgr_t::~uring_diskmgr_t() {
+    assert_thread();
+    source->available->unset_callback();
+    if (retry_timer != nullptr) {
+        cancel_timer(retry_timer);
+    }
+#if USE_IO_URING
+    rassert(n_pending == 0);
+    queue->forget_event(&completion_event, this);
+    munmap(sqes, sqes_size);
+    if (cq_ring != sq_ring) {
+        munmap(cq_ring, cq_ring_size);
+    }
+    munmap(sq_ring, sq_ring_size);
+#endif
+}
+
+void uring_diskmgr_t::on_source_availability_changed() {
+    assert_thread();
+    if (source->available->get()) pump();
+}
+
+void uring_diskmgr_t::pump() {
+    assert_thread();
+#if USE_IO_URING
+    uint32_t tail = *sq_tail;
+    while (source->available->get() && n_pending < queue_depth
+           && n_in_ring < ring_entries) {
+        action_t *a = source->pop();
+        ++n_pending;
+
+        iovec *vecs;
+        size_t vecs_len;
+        a->get_bufs(&vecs, &vecs_len);
+        if (a->get_is_resize() || a->ds_op != datasync_op::no_datasyncs
+            || vecs_len > IOV_MAX) {
+            run_in_fallback(a);
+            continue;
+        }
+
+        const uint32_t index = tail & *sq_mask;
+        io_uring_sqe *sqe = &sqes[index];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = a->get_is_read() ? IORING_OP_READV : IORING_OP_WRITEV;
+        sqe->fd = a->fd;
+        sqe->addr = reinterpret_cast<uintptr_t>(vecs);
+        sqe->len = vecs_len;
+        sqe->off = a->offset;
+        sqe->user_data = reinterpret_cast<uintptr_t>(a);
+        sq_array[index] = index;
+        ++tail;
+        ++n_in_ring;
+        ++n_unsubmitted;
+    }
+    // The kernel mustn't see the new tail before the entries it covers.
+    __atomic_store_n(sq_tail, tail, __ATOMIC_RELEASE);
+    submit();
+#endif
+}
+
+void uring_diskmgr_t::submit() {
+#if USE_IO_URING
+    while (n_unsubmitted > 0) {
+        int res = sys_io_uring_enter(ring_fd.get(), n_unsubmitted, 0, 0);
+        if (res == -1) {
+            const int err = get_errno();
+            if (err == EINTR) {
+                continue;
+            }
+            guarantee_err(err == EAGAIN || err == EBUSY, "io_uring_enter failed");
+            // The kernel is out of resources for the moment.  We'll try again when
+            // some of the requests in flight complete, or after a while if there
+            // aren't any.
+            if (n_in_ring == n_unsubmitted && retry_timer == nullptr) {
+                retry_timer = fire_timer_once(retry_delay_ms, this);
+                retry_delay_ms = std::min(retry_delay_ms * 2, URING_MAX_RETRY_DELAY_MS);
+            }
+            return;
+        }
+        n_unsubmitted -= res;
+        retry_delay_ms = URING_MIN_RETRY_DELAY_MS;
+    }
+#endif
+}
+
+void uring_diskmgr_t::on_timer(UNUSED ticks_t ticks) {
+    assert_thread();
+    retry_timer = nullptr;
+    submit();
+}
+
+void uring_diskmgr_t::on_event(DEBUG_VAR int events) {
+    assert_thread();
+    rassert(events == poll_event_in);
+    completion_event.consume_wakey_wakeys();
+
+#if USE_IO_URING
+    std::vector<action_t *> completed;
+    std::vector<action_t *> retries;
+    uint32_t head = *cq_head;
+    const uint32_t tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+    for (; head != tail; ++head) {
+        const io_uring_cqe *cqe = &cqes[head & *cq_mask];
+        action_t *a = reinterpret_cast<action_t *>(cqe->user_data);
+        --n_in_ring;
+        if (cqe->res == static_cast<int64_t>(a->get_count())
+            || (cqe->res < 0 && cqe->res != -EAGAIN && cqe->res != -EINTR)) {
+            a->io_result = cqe->res;
+            completed.push_back(a);
+        } else {
+            // A short read or write.  The fallback redoes it with the loop in
+            // `pool_diskmgr_action_t::perform_read_write()`, which also reports
+            // running out of disk space.
+            retries.push_back(a);
+        }
+    }
+    // Lets the kernel reuse the entries.
+    __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+
+    for (action_t *a : retries) {
+        run_in_fallback(a);
+    }
+    for (action_t *a : completed) {
+        finish(a);
+    }
+    pump();
+#endif
+}
+
+void uring_diskmgr_t::run_in_fallback(action_t *action) {
+    fallback_queue.push(action);
+}
+
+void uring_diskmgr_t::on_fallback_done(action_t *action) {
+    finish(action);
+    pump();
+}
+
+void uring_diskmgr_t::finish(action_t *action) {
+    --n_pending;
+    done_fun(action);
+}
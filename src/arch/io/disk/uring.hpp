@@ -0,0 +1,110 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#ifndef ARCH_IO_DISK_URING_HPP_
+#define ARCH_IO_DISK_URING_HPP_
+
+#include <functional>
+#include <vector>
+
+#include "arch/io/disk/pool.hpp"
+#include "arch/io/io_utils.hpp"
+#include "arch/runtime/event_queue.hpp"
+#include "arch/runtime/system_event.hpp"
+#include "arch/timer.hpp"
+#include "concurrency/queue/passive_producer.hpp"
+#include "concurrency/queue/unlimited_fifo.hpp"
+#include "containers/scoped.hpp"
+
+#if defined(__linux__) && !defined(NO_EVENTFD) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define USE_IO_URING 1
+#endif
+#endif
+#ifndef USE_IO_URING
+#define USE_IO_URING 0
+#endif
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+/* The io_uring disk manager hands reads and writes to the kernel through an io_uring
+instead of running them on a thread pool.  Everything that's available from `source`
+gets submitted with a single system call, and the kernel signals completions through
+an eventfd that the event queue watches.
+
+Operations that io_uring doesn't do as one request (resizes, datasyncs, and writes
+with more than IOV_MAX buffers), and the rare read or write that comes back short,
+are run by a small `pool_diskmgr_t` instead.
+
+Use `uring_diskmgr_t::is_available()` to find out whether the kernel supports
+io_uring before constructing one. */
+class uring_diskmgr_t : private availability_callback_t,
+                        private timer_callback_t,
+                        public linux_event_callback_t,
+                        public home_thread_mixin_debug_only_t {
+public:
+    typedef pool_diskmgr_action_t action_t;
+
+    static bool is_available();
+
+    /* Like `pool_diskmgr_t`, the `uring_diskmgr_t` draws actions to run from `source`
+    and calls `done_fun` on each one when it's done. */
+    uring_diskmgr_t(linux_event_queue_t *queue, passive_producer_t<action_t *> *source,
+                    int max_concurrent_io_requests);
+    std::function<void(action_t *)> done_fun;
+    ~uring_diskmgr_t();
+
+private:
+    void on_source_availability_changed();
+    void on_event(int events);
+
+    void pump();
+    // Tells the kernel about the requests we put in the submission queue.
+    void submit();
+    void on_timer(ticks_t ticks);
+    void run_in_fallback(action_t *action);
+    void on_fallback_done(action_t *action);
+    void finish(action_t *action);
+
+    linux_event_queue_t *const queue;
+    passive_producer_t<action_t *> *const source;
+    // The maximum number of actions we have outstanding, in the ring or the fallback.
+    const int queue_depth;
+    int n_pending;
+
+    scoped_fd_t ring_fd;
+    uint32_t ring_entries;
+    // How many requests are in the ring; this can't exceed `ring_entries`.
+    uint32_t n_in_ring;
+    // How many of the requests in the submission queue the kernel hasn't seen yet.
+    uint32_t n_unsubmitted;
+    // If the kernel was out of resources and had none of our requests to complete,
+    // `submit()` tries again when this rings, waiting twice as long each time.
+    timer_token_t *retry_timer;
+    int64_t retry_delay_ms;
+
+    // The memory shared with the kernel.
+    void *sq_ring;
+    size_t sq_ring_size;
+    void *cq_ring;
+    size_t cq_ring_size;
+    io_uring_sqe *sqes;
+    size_t sqes_size;
+
+    uint32_t *sq_head;
+    uint32_t *sq_tail;
+    uint32_t *sq_mask;
+    uint32_t *sq_array;
+    uint32_t *cq_head;
+    uint32_t *cq_tail;
+    uint32_t *cq_mask;
+    io_uring_cqe *cqes;
+
+    system_event_t completion_event;
+
+    unlimited_fifo_queue_t<action_t *> fallback_queue;
+    pool_diskmgr_t fallback;
+
+    DISABLE_COPYING(uring_diskmgr_t);
+};
+
+#endif  // ARCH_IO_DISK_URING_HPP_
@@ -4,6 +4,7 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <string.h>
 #include <sys/types.h>
 
@@ -18,23 +19,28 @@
 #include <netinet/tcp.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #endif
 
+#include <array>
+#include <memory>
+
+#include "arch/runtime/event_queue.hpp"
 #include "arch/runtime/runtime.hpp"
 #include "arch/runtime/thread_pool.hpp"
 #include "arch/timing.hpp"
 #include "arch/types.hpp"
 #include "concurrency/auto_drainer.hpp"
+#include "concurrency/cache_line_padded.hpp"
 #include "concurrency/exponential_backoff.hpp"
 #include "concurrency/wait_any.hpp"
+#include "containers/lru_cache.hpp"
 #include "containers/printf_buffer.hpp"
 #include "logger.hpp"
 #include "perfmon/perfmon.hpp"
 #include "errors.hpp"
 
-#ifdef _WIN32
 #include "concurrency/pmap.hpp"
-#endif
 
 #ifdef TRACE_WINSOCK
 #define winsock_debugf(...) debugf("winsock: " __VA_ARGS__)
@@ -262,6 +268,18 @@ linux_tcp_conn_t::linux_tcp_conn_t(fd_t s) :
     int res = fcntl(sock.get(), F_SETFL, O_NONBLOCK);
     guarantee_err(res == 0, "Could not make socket non-blocking");
 #endif
+
+#ifdef SO_BUSY_POLL
+    // In busy-polling mode, let the kernel poll the device queue for incoming data as
+    // well. Going above `net.core.busy_read` needs CAP_NET_ADMIN; since this is only an
+    // optimization, we don't mind if it fails.
+    const ticks_t max_spin = busy_poll_policy_t::get_max_spin();
+    if (max_spin.nanos > 0) {
+        int busy_poll_usecs = static_cast<int>(max_spin.nanos / THOUSAND);
+        setsockopt(sock.get(), SOL_SOCKET, SO_BUSY_POLL,
+                   &busy_poll_usecs, sizeof(busy_poll_usecs));
+    }
+#endif
 }
 
 void linux_tcp_conn_t::enable_keepalive() THROWS_ONLY(tcp_conn_write_closed_exc_t) {
@@ -455,7 +473,11 @@ void linux_tcp_conn_t::read_more_buffered(signal_t *closer) THROWS_ONLY(tcp_conn
     read_op_wrapper_t sentry(this, closer);
 
     size_t old_size = read_buffer.size();
+    const size_t old_capacity = read_buffer.capacity();
     read_buffer.resize(old_size + IO_BUFFER_SIZE);
+    add_memory_usage(memory_tag_t::NETWORK_BUFFERS,
+                     static_cast<int64_t>(read_buffer.capacity())
+                     - static_cast<int64_t>(old_capacity));
     size_t delta = read_internal(read_buffer.data() + old_size, IO_BUFFER_SIZE);
 
     read_buffer.resize(old_size + delta);
@@ -521,19 +543,50 @@ linux_tcp_conn_t::write_handler_t::write_handler_t(linux_tcp_conn_t *_parent) :
 { }
 
 void linux_tcp_conn_t::write_handler_t::coro_pool_callback(write_queue_op_t *operation, UNUSED signal_t *interruptor) {
-    if (operation->buffer != nullptr) {
-        parent->perform_write(operation->buffer, operation->size);
-        if (operation->dealloc != nullptr) {
-            parent->release_write_buffer(operation->dealloc);
-            parent->write_queue_limiter.unlock(operation->size);
-        }
+    /* Take along the operations that have been queued up behind this one, so that
+    a client that pipelines many small queries doesn't cost us a system call per
+    response. `write_coro_pool` only has one coroutine, so nobody else pops from the
+    queue while we're running. */
+    write_queue_op_t *batch[WRITE_BATCH_MAX_OPS];
+    size_t batch_size = 0;
+    batch[batch_size++] = operation;
+    while (batch_size < WRITE_BATCH_MAX_OPS && parent->write_queue.available->get()) {
+        batch[batch_size++] = parent->write_queue.pop();
     }
 
-    if (operation->cond != nullptr) {
-        operation->cond->pulse();
+#ifdef _WIN32
+    for (size_t i = 0; i < batch_size; ++i) {
+        if (batch[i]->buffer != nullptr && batch[i]->size > 0) {
+            parent->perform_write(batch[i]->buffer, batch[i]->size);
+        }
     }
-    if (operation->dealloc != nullptr) {
-        parent->release_write_queue_op(operation);
+#else
+    iovec iov[WRITE_BATCH_MAX_OPS];
+    size_t iovcnt = 0;
+    for (size_t i = 0; i < batch_size; ++i) {
+        if (batch[i]->buffer != nullptr && batch[i]->size > 0) {
+            iov[iovcnt].iov_base = const_cast<void *>(batch[i]->buffer);
+            iov[iovcnt].iov_len = batch[i]->size;
+            ++iovcnt;
+        }
+    }
+    if (iovcnt > 0) {
+        parent->perform_writev(iov, iovcnt);
+    }
+#endif
+
+    for (size_t i = 0; i < batch_size; ++i) {
+        write_queue_op_t *op = batch[i];
+        if (op->buffer != nullptr && op->dealloc != nullptr) {
+            parent->release_write_buffer(op->dealloc);
+            parent->write_queue_limiter.unlock(op->size);
+        }
+        if (op->cond != nullptr) {
+            op->cond->pulse();
+        }
+        if (op->dealloc != nullptr) {
+            parent->release_write_queue_op(op);
+        }
     }
 }
 
@@ -598,8 +651,29 @@ void linux_tcp_conn_t::perform_write(const void *buf, size_t size) {
         rassert(op.nb_bytes == size);  // TODO WINDOWS: does windows guarantee this?
     }
 #else
-    while (size > 0) {
-        ssize_t res = ::write(sock.get(), buf, size);
+    iovec iov;
+    iov.iov_base = const_cast<void *>(buf);
+    iov.iov_len = size;
+    linux_tcp_conn_t::perform_writev(&iov, 1);
+#endif
+}
+
+#ifndef _WIN32
+void linux_tcp_conn_t::perform_writev(iovec *iov, size_t iovcnt) {
+    assert_thread();
+
+    if (write_closed.is_pulsed()) {
+        /* See `perform_write()`. */
+        return;
+    }
+
+    while (iovcnt > 0) {
+        if (iov->iov_len == 0) {
+            ++iov;
+            --iovcnt;
+            continue;
+        }
+        ssize_t res = ::writev(sock.get(), iov, std::min<size_t>(iovcnt, IOV_MAX));
 
         if (res == -1 && (get_errno() == EAGAIN || get_errno() == EWOULDBLOCK)) {
             /* Wait for a notification from the event queue, or for an order to
@@ -632,21 +706,30 @@ void linux_tcp_conn_t::perform_write(const void *buf, size_t size) {
         } else if (res == 0) {
             /* This should never happen either, but it's better to write an error message than to
                crash completely. */
-            logERR("Didn't expect write() to return 0.");
+            logERR("Didn't expect writev() to return 0.");
             on_shutdown_write();
             break;
 
         } else {
-            rassert(res <= static_cast<ssize_t>(size));
-            buf = reinterpret_cast<const void *>(reinterpret_cast<const char *>(buf) + res);
-            size -= res;
             if (write_perfmon) {
                 write_perfmon->record(res);
             }
+            /* Skip over what has been written. */
+            size_t written = res;
+            while (iovcnt > 0 && written >= iov->iov_len) {
+                written -= iov->iov_len;
+                ++iov;
+                --iovcnt;
+            }
+            rassert(iovcnt > 0 || written == 0);
+            if (written > 0) {
+                iov->iov_base = reinterpret_cast<char *>(iov->iov_base) + written;
+                iov->iov_len -= written;
+            }
         }
     }
-#endif
 }
+#endif
 
 void linux_tcp_conn_t::write(const void *buf, size_t size, signal_t *closer) THROWS_ONLY(tcp_conn_write_closed_exc_t) {
     write_op_wrapper_t sentry(this, closer);
@@ -804,6 +887,8 @@ linux_tcp_conn_t::~linux_tcp_conn_t() THROWS_NOTHING {
     if (is_write_open()) {
         shutdown_write();
     }
+    add_memory_usage(memory_tag_t::NETWORK_BUFFERS,
+                     -static_cast<int64_t>(read_buffer.capacity()));
 }
 
 void linux_tcp_conn_t::rethread(threadnum_t new_thread) {
@@ -875,6 +960,61 @@ void linux_tcp_conn_t::on_event(int /* events */) {
 }
 
 #ifdef ENABLE_TLS
+namespace {
+
+typedef lru_cache_t<std::string, std::shared_ptr<SSL_SESSION> > tls_session_cache_t;
+
+/* Only ever accessed on its own thread. */
+std::array<cache_line_padded_t<scoped_ptr_t<tls_session_cache_t> >, MAX_THREADS>
+    tls_client_sessions;
+
+tls_session_cache_t *get_tls_session_cache() {
+    scoped_ptr_t<tls_session_cache_t> *cache =
+        &tls_client_sessions[get_thread_id().threadnum].value;
+    if (!cache->has()) {
+        cache->init(new tls_session_cache_t(TLS_CLIENT_SESSIONS_PER_THREAD));
+    }
+    return cache->get();
+}
+
+// Called by OpenSSL whenever an outgoing connection gets a session that it could
+// resume later.  With TLS 1.3, that only happens after the handshake.
+int on_new_client_session(SSL *ssl, SSL_SESSION *session) {
+    const std::string *session_key = static_cast<const std::string *>(
+        SSL_get_app_data(ssl));
+    if (session_key == nullptr) {
+        return 0;
+    }
+    tls_session_cache_t *cache = get_tls_session_cache();
+    cache->erase(*session_key);
+    cache->insert(*session_key,
+                  std::shared_ptr<SSL_SESSION>(session, &SSL_SESSION_free));
+    // We took over the reference to `session`.
+    return 1;
+}
+
+}  // namespace
+
+void enable_tls_session_resumption_and_ktls(SSL_CTX *tls_ctx) {
+    // Incoming connections are resumed from OpenSSL's own cache, or from tickets that
+    // only we can decrypt.  Clients can only resume sessions of the same context.
+    static const unsigned char session_id_context[] = "rethinkdb";
+    SSL_CTX_set_session_id_context(tls_ctx, session_id_context,
+                                   sizeof(session_id_context) - 1);
+    SSL_CTX_set_timeout(tls_ctx, TLS_SESSION_TIMEOUT_SECS);
+    SSL_CTX_clear_options(tls_ctx, SSL_OP_NO_TICKET);
+
+    // OpenSSL can't look up the sessions of outgoing connections by host and port,
+    // so we keep those ourselves.
+    SSL_CTX_set_session_cache_mode(tls_ctx, SSL_SESS_CACHE_BOTH);
+    SSL_CTX_sess_set_new_cb(tls_ctx, &on_new_client_session);
+
+#ifdef SSL_OP_ENABLE_KTLS
+    // OpenSSL falls back to encrypting in userspace if the kernel can't do it.
+    SSL_CTX_set_options(tls_ctx, SSL_OP_ENABLE_KTLS);
+#endif
+}
+
 tls_conn_wrapper_t::tls_conn_wrapper_t(SSL_CTX *tls_ctx)
     THROWS_ONLY(crypto::openssl_error_t) {
     ERR_clear_error();
@@ -908,10 +1048,17 @@ linux_secure_tcp_conn_t::linux_secure_tcp_conn_t(
         signal_t *interruptor, int local_port)
         THROWS_ONLY(connect_failed_exc_t, crypto::openssl_error_t, interrupted_exc_t) :
     linux_tcp_conn_t(host, port, interruptor, local_port),
+    session_key(strprintf("%s:%d", host.to_string().c_str(), port)),
     conn(tls_ctx) {
 
     conn.set_fd(sock.get());
     SSL_set_connect_state(conn.get());
+    SSL_set_app_data(conn.get(), &session_key);
+    std::shared_ptr<SSL_SESSION> *session;
+    if (get_tls_session_cache()->lookup(session_key, &session)) {
+        // If the server doesn't resume it, we just get a full handshake.
+        SSL_set_session(conn.get(), session->get());
+    }
     perform_handshake(interruptor);
 }
 
@@ -1044,6 +1191,14 @@ size_t linux_secure_tcp_conn_t::read_internal(void *buffer, size_t size)
     }
 }
 
+#ifndef _WIN32
+void linux_secure_tcp_conn_t::perform_writev(iovec *iov, size_t iovcnt) {
+    for (size_t i = 0; i < iovcnt; ++i) {
+        perform_write(iov[i].iov_base, iov[i].iov_len);
+    }
+}
+#endif
+
 void linux_secure_tcp_conn_t::perform_write(const void *buffer, size_t size) {
     assert_thread();
 
@@ -1258,10 +1413,12 @@ void linux_tcp_conn_descriptor_t::make_server_connection(
 /* Network listener object */
 linux_nonthrowing_tcp_listener_t::linux_nonthrowing_tcp_listener_t(
          const std::set<ip_address_t> &bind_addresses, int _port,
-         const std::function<void(scoped_ptr_t<linux_tcp_conn_descriptor_t> &)> &cb) :
+         const std::function<void(scoped_ptr_t<linux_tcp_conn_descriptor_t> &)> &cb,
+         bool _reuse_port) :
     callback(cb),
     local_addresses(bind_addresses),
     port(_port),
+    reuse_port(_reuse_port),
     bound(false),
     socks(),
     last_used_socket_index(0),
@@ -1367,6 +1524,12 @@ int linux_nonthrowing_tcp_listener_t::init_sockets() {
         // to be re-bound quickly (e.g. if you restart the server).
         int res = setsockopt(sock_fd, SOL_SOCKET, SO_REUSEADDR, &sockoptval, sizeof(sockoptval)); 
         guarantee_err(res != -1, "Could not set REUSEADDR option");
+#ifdef SO_REUSEPORT
+        if (reuse_port) {
+            res = setsockopt(sock_fd, SOL_SOCKET, SO_REUSEPORT, &sockoptval, sizeof(sockoptval));
+            guarantee_err(res != -1, "Could not set REUSEPORT option");
+        }
+#endif
 #endif
         /* XXX Making our socket NODELAY prevents the problem where responses to
          * pipelined requests are delayed, since the TCP Nagle algorithm will
@@ -1700,6 +1863,56 @@ int linux_tcp_listener_t::get_port() const {
     return listener->get_port();
 }
 
+linux_reuseport_tcp_listener_t::linux_reuseport_tcp_listener_t(
+    const std::set<ip_address_t> &bind_addresses, int port,
+    const std::function<void(scoped_ptr_t<linux_tcp_conn_descriptor_t> &)> &callback) :
+        home_thread(get_thread_id()),
+        listeners(get_num_db_threads())
+{
+    guarantee(home_thread.threadnum < get_num_db_threads());
+
+    /* The first listener picks the port if we were given `ANY_PORT`, and the others
+    join it there. */
+    scoped_ptr_t<linux_nonthrowing_tcp_listener_t> *first = &listeners[home_thread.threadnum];
+    first->init(new linux_nonthrowing_tcp_listener_t(
+        bind_addresses, port, callback, true));
+    if (!(*first)->begin_listening()) {
+        throw address_in_use_exc_t("localhost", (*first)->get_port());
+    }
+
+#ifdef SO_REUSEPORT
+    const int bound_port = (*first)->get_port();
+    pmap(get_num_db_threads(), [&](int i) {
+        if (i == home_thread.threadnum) {
+            return;
+        }
+        on_thread_t thread_switcher((threadnum_t(i)));
+        scoped_ptr_t<linux_nonthrowing_tcp_listener_t> listener(
+            new linux_nonthrowing_tcp_listener_t(
+                bind_addresses, bound_port, callback, true));
+        if (listener->begin_listening()) {
+            listeners[i] = std::move(listener);
+        } else {
+            /* The other threads' listeners still take the connections. */
+            logWRN("Could not listen on port %d on thread %d as well.", bound_port, i);
+        }
+    });
+#endif
+}
+
+linux_reuseport_tcp_listener_t::~linux_reuseport_tcp_listener_t() {
+    pmap(listeners.size(), [&](int i) {
+        if (listeners[i].has()) {
+            on_thread_t thread_switcher((threadnum_t(i)));
+            listeners[i].reset();
+        }
+    });
+}
+
+int linux_reuseport_tcp_listener_t::get_port() const {
+    return listeners[home_thread.threadnum]->get_port();
+}
+
 linux_repeated_nonthrowing_tcp_listener_t::linux_repeated_nonthrowing_tcp_listener_t(
     const std::set<ip_address_t> &bind_addresses,
     int port,
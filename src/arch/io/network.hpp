@@ -35,6 +35,7 @@
 #include "arch/io/io_utils.hpp"
 #include "arch/io/openssl.hpp"
 #include "arch/runtime/event_queue.hpp"
+#include "arch/runtime/memory_usage.hpp"
 #include "arch/types.hpp"
 #include "concurrency/cond_var.hpp"
 #include "concurrency/queue/unlimited_fifo.hpp"
@@ -268,9 +269,19 @@ private:
 
     static const size_t WRITE_QUEUE_MAX_SIZE = 128 * KILOBYTE;
     static const size_t WRITE_CHUNK_SIZE = 8 * KILOBYTE;
+    /* How many queued write operations the write handler sends in a single
+    `perform_writev()` call (or one after another on Windows). */
+    static const size_t WRITE_BATCH_MAX_OPS = 64;
 
     /* Structs to avoid over-using dynamic allocation */
     struct write_buffer_t : public intrusive_list_node_t<write_buffer_t> {
+        write_buffer_t() {
+            add_memory_usage(memory_tag_t::NETWORK_BUFFERS, sizeof(write_buffer_t));
+        }
+        ~write_buffer_t() {
+            add_memory_usage(memory_tag_t::NETWORK_BUFFERS,
+                             -static_cast<int64_t>(sizeof(write_buffer_t)));
+        }
         char buffer[WRITE_CHUNK_SIZE];
         size_t size;
     };
@@ -345,10 +356,28 @@ private:
     /* Used to actually perform a write. If the write end of the connection is open, then
     writes `size` bytes from `buffer` to the socket. */
     virtual void perform_write(const void *buffer, size_t size);
+
+#ifndef _WIN32
+    /* Like `perform_write()`, but writes the `iovcnt` buffers in `iov` one after the
+    other. The entries of `iov` may get modified. */
+    virtual void perform_writev(iovec *iov, size_t iovcnt);
+#endif
 };
 
 #ifdef ENABLE_TLS
 
+/* How long a TLS session can be resumed after its full handshake, and how many
+sessions each thread keeps for resuming its outgoing connections. */
+#define TLS_SESSION_TIMEOUT_SECS         3600
+#define TLS_CLIENT_SESSIONS_PER_THREAD   256
+
+/* Lets the connections that use `tls_ctx` resume earlier sessions, with session IDs
+or tickets, instead of doing a full handshake each time.  Outgoing connections offer
+the last session they got from the same host and port.  If the kernel and OpenSSL
+support it, this also has the kernel encrypt and decrypt the data after the handshake
+(kTLS), so we don't copy it through userspace crypto. */
+void enable_tls_session_resumption_and_ktls(SSL_CTX *tls_ctx);
+
 /* tls_conn_wrapper_t wraps a TLS connection. */
 class tls_conn_wrapper_t {
 public:
@@ -409,11 +438,20 @@ private:
     writes `size` bytes from `buffer` to the socket. */
     virtual void perform_write(const void *buffer, size_t size);
 
+#ifndef _WIN32
+    /* Writes the buffers one by one, since every `SSL_write()` makes its own TLS
+    records anyway. */
+    virtual void perform_writev(iovec *iov, size_t iovcnt);
+#endif
+
     void shutdown();
     void shutdown_socket();
 
     bool is_open() { return !closed.is_pulsed(); }
 
+    // For outgoing connections, the host and port that the session is kept for.  It
+    // must outlive `conn`, which points to it.
+    std::string session_key;
     tls_conn_wrapper_t conn;
 
     cond_t closed;
@@ -452,8 +490,11 @@ the provided callback will be called in a new coroutine every time something con
 
 class linux_nonthrowing_tcp_listener_t : private linux_event_callback_t {
 public:
+    /* If `_reuse_port` is true, the sockets are bound with `SO_REUSEPORT`, so that
+    other listeners that do the same can share the port with us. */
     linux_nonthrowing_tcp_listener_t(const std::set<ip_address_t> &bind_addresses, int _port,
-        const std::function<void(scoped_ptr_t<linux_tcp_conn_descriptor_t> &)> &callback);
+        const std::function<void(scoped_ptr_t<linux_tcp_conn_descriptor_t> &)> &callback,
+        bool _reuse_port = false);
 
     ~linux_nonthrowing_tcp_listener_t();
 
@@ -499,6 +540,9 @@ private:
     // The port we're asked to bind to
     int port;
 
+    // Whether to set `SO_REUSEPORT` on the sockets
+    bool reuse_port;
+
     // Inidicates successful binding to a port
     bool bound;
 
@@ -539,6 +583,29 @@ private:
     scoped_ptr_t<linux_nonthrowing_tcp_listener_t> listener;
 };
 
+/* Listens on the same port on every db thread, through one `SO_REUSEPORT` socket per
+thread, and lets the kernel spread new connections over the threads. The callback is
+called on the thread that accepted the connection, so it must not use anything that
+belongs to the thread the listener was created on. Where `SO_REUSEPORT` isn't
+available, this only listens on the thread the listener was created on. */
+class linux_reuseport_tcp_listener_t {
+public:
+    linux_reuseport_tcp_listener_t(const std::set<ip_address_t> &bind_addresses, int port,
+        const std::function<void(scoped_ptr_t<linux_tcp_conn_descriptor_t> &)> &callback);
+    ~linux_reuseport_tcp_listener_t();
+
+    int get_port() const;
+
+private:
+    threadnum_t home_thread;
+
+    // One per db thread, indexed by thread number; empty on the threads that don't
+    // listen.
+    scoped_array_t<scoped_ptr_t<linux_nonthrowing_tcp_listener_t> > listeners;
+
+    DISABLE_COPYING(linux_reuseport_tcp_listener_t);
+};
+
 /* Like a linux tcp listener but repeatedly tries to bind to its port until successful */
 class linux_repeated_nonthrowing_tcp_listener_t {
 public:
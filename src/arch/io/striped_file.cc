@@ -0,0 +1,310 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "arch/io/striped_file.hpp"
+
+#ifndef _WIN32
+#include <sys/uio.h>
+#endif
+
+#include <algorithm>
+#include <limits>
+
+#include "arch/io/disk.hpp"
+#include "arch/runtime/coroutines.hpp"
+#include "concurrency/pmap.hpp"
+#include "containers/scoped.hpp"
+#include "math.hpp"
+#include "perfmon/perfmon.hpp"
+
+class striped_file_t::stripe_accounts_t {
+public:
+    std::vector<scoped_ptr_t<file_account_t> > accounts;
+};
+
+class striped_file_t::stripe_stats_t {
+public:
+    stripe_stats_t()
+        : read_bytes_per_sec(secs_to_ticks(1)),
+          written_bytes_per_sec(secs_to_ticks(1)) { }
+
+    void bytes_read(size_t count) {
+        read_bytes_per_sec.record(count);
+        read_bytes_total += count;
+    }
+    void bytes_written(size_t count) {
+        written_bytes_per_sec.record(count);
+        written_bytes_total += count;
+    }
+
+    perfmon_rate_monitor_t read_bytes_per_sec;
+    perfmon_counter_t read_bytes_total;
+    perfmon_rate_monitor_t written_bytes_per_sec;
+    perfmon_counter_t written_bytes_total;
+
+    perfmon_collection_t collection;
+    scoped_ptr_t<perfmon_membership_t> collection_membership;
+    scoped_ptr_t<perfmon_multi_membership_t> stats_membership;
+};
+
+/* Calls the request's callback once all of its pieces have completed.  The pieces are
+all submitted from the same thread, so their callbacks all come back on it. */
+class striped_file_t::split_callback_t : public linux_iocallback_t {
+public:
+    split_callback_t(linux_iocallback_t *_cb, int _pieces_left)
+        : cb(_cb), pieces_left(_pieces_left) { }
+
+    void on_io_complete() {
+        --pieces_left;
+        if (pieces_left == 0) {
+            cb->on_io_complete();
+            delete this;
+        }
+    }
+
+    void on_io_failure(int errsv, int64_t offset, int64_t count) {
+        cb->on_io_failure(errsv, offset, count);
+    }
+
+private:
+    linux_iocallback_t *cb;
+    int pieces_left;
+
+    DISABLE_COPYING(split_callback_t);
+};
+
+striped_file_t::striped_file_t(std::vector<scoped_ptr_t<file_t> > &&_stripes,
+                               int64_t _stripe_size)
+    : stripes(std::move(_stripes)), stripe_size(_stripe_size) {
+    guarantee(!stripes.empty());
+    guarantee(divides(DEVICE_BLOCK_SIZE, stripe_size));
+
+    // The file extends as far as every stripe has the units for, which after a crash
+    // in the middle of a resize may be less than some of them have.
+    file_size = std::numeric_limits<int64_t>::max();
+    const int64_t n = stripes.size();
+    for (int64_t i = 0; i < n; ++i) {
+        const int64_t size = stripes[i]->get_file_size();
+        file_size = std::min(file_size,
+                             (size / stripe_size * n + i) * stripe_size
+                             + size % stripe_size);
+    }
+
+    for (size_t i = 0; i < stripes.size(); ++i) {
+        stripe_stats.emplace_back(new stripe_stats_t());
+    }
+}
+
+striped_file_t::~striped_file_t() { }
+
+template <class callable_t>
+void striped_file_t::for_each_piece(int64_t offset, size_t length,
+                                    const callable_t &fn) const {
+    const int64_t n = stripes.size();
+    size_t piece_offset = 0;
+    while (piece_offset < length) {
+        const int64_t position = offset + piece_offset;
+        const int64_t unit = position / stripe_size;
+        const int64_t unit_offset = position % stripe_size;
+        const size_t piece_length =
+            std::min<int64_t>(length - piece_offset, stripe_size - unit_offset);
+        fn(static_cast<size_t>(unit % n), unit / n * stripe_size + unit_offset,
+           piece_offset, piece_length);
+        piece_offset += piece_length;
+    }
+}
+
+int64_t striped_file_t::stripe_file_size(size_t stripe, int64_t size) const {
+    const int64_t n = stripes.size();
+    const int64_t rounds = size / (stripe_size * n);
+    const int64_t rest = size - rounds * stripe_size * n;
+    return rounds * stripe_size
+        + clamp<int64_t>(rest - static_cast<int64_t>(stripe) * stripe_size,
+                         0, stripe_size);
+}
+
+file_account_t *striped_file_t::stripe_account(file_account_t *account,
+                                               size_t stripe) {
+    if (account == DEFAULT_DISK_ACCOUNT) {
+        return DEFAULT_DISK_ACCOUNT;
+    }
+    return static_cast<stripe_accounts_t *>(account->get_account())
+        ->accounts[stripe].get();
+}
+
+int64_t striped_file_t::get_file_size() {
+    return file_size;
+}
+
+void striped_file_t::set_file_size(int64_t size) {
+    assert_thread();
+    for (size_t i = 0; i < stripes.size(); ++i) {
+        const int64_t stripe_size_after = stripe_file_size(i, size);
+        if (stripes[i]->get_file_size() != stripe_size_after) {
+            stripes[i]->set_file_size(stripe_size_after);
+        }
+    }
+    file_size = size;
+}
+
+void striped_file_t::set_file_size_at_least(int64_t size, int64_t extent_size) {
+    assert_thread();
+    if (file_size < size) {
+        /* Grow in large chunks at a time, like a single file does.  The stripes are
+        resized to match exactly, so that their sizes always describe the file. */
+        set_file_size(ceil_aligned(size, chunk_factor(size, extent_size)));
+    }
+}
+
+void striped_file_t::read_async(int64_t offset, size_t length, void *buf,
+                                file_account_t *account, linux_iocallback_t *cb) {
+    int pieces = 0;
+    for_each_piece(offset, length, [&](size_t, int64_t, size_t, size_t) { ++pieces; });
+    linux_iocallback_t *piece_cb =
+        pieces == 1 ? cb : new split_callback_t(cb, pieces);
+    for_each_piece(offset, length,
+                   [&](size_t stripe, int64_t stripe_offset, size_t piece_offset,
+                       size_t piece_length) {
+        stripe_stats[stripe]->bytes_read(piece_length);
+        stripes[stripe]->read_async(stripe_offset, piece_length,
+                                    static_cast<char *>(buf) + piece_offset,
+                                    stripe_account(account, stripe), piece_cb);
+    });
+}
+
+void striped_file_t::write_async(int64_t offset, size_t length, const void *buf,
+                                 file_account_t *account, linux_iocallback_t *cb,
+                                 datasync_op ds_op) {
+    if (ds_op == datasync_op::no_datasyncs || stripes.size() == 1) {
+        submit_write(offset, length, buf, account, cb, ds_op);
+        return;
+    }
+
+    // The stripes that the write goes to get the datasyncs along with it.
+    std::vector<bool> others(stripes.size(), true);
+    for_each_piece(offset, length, [&](size_t stripe, int64_t, size_t, size_t) {
+        others[stripe] = false;
+    });
+    auto_drainer_t::lock_t lock(&drainer);
+    coro_t::spawn_sometime([this, offset, length, buf, account, cb, ds_op, others,
+                            lock /* important to capture */]() {
+        pmap(stripes.size(), [&](int64_t stripe) {
+            if (others[stripe]) {
+                stripes[stripe]->co_datasync();
+            }
+        });
+        submit_write(offset, length, buf, account, cb, ds_op);
+    });
+}
+
+void striped_file_t::submit_write(int64_t offset, size_t length, const void *buf,
+                                  file_account_t *account, linux_iocallback_t *cb,
+                                  datasync_op ds_op) {
+    int pieces = 0;
+    for_each_piece(offset, length, [&](size_t, int64_t, size_t, size_t) { ++pieces; });
+    linux_iocallback_t *piece_cb =
+        pieces == 1 ? cb : new split_callback_t(cb, pieces);
+    for_each_piece(offset, length,
+                   [&](size_t stripe, int64_t stripe_offset, size_t piece_offset,
+                       size_t piece_length) {
+        stripe_stats[stripe]->bytes_written(piece_length);
+        stripes[stripe]->write_async(stripe_offset, piece_length,
+                                     static_cast<const char *>(buf) + piece_offset,
+                                     stripe_account(account, stripe), piece_cb, ds_op);
+    });
+}
+
+void striped_file_t::writev_async(int64_t offset, size_t length,
+                                  scoped_array_t<iovec> &&bufs,
+                                  file_account_t *account, linux_iocallback_t *cb) {
+    int pieces = 0;
+    for_each_piece(offset, length, [&](size_t, int64_t, size_t, size_t) { ++pieces; });
+    if (pieces == 1) {
+        const size_t stripe = offset / stripe_size % stripes.size();
+        stripe_stats[stripe]->bytes_written(length);
+        stripes[stripe]->writev_async(
+            offset / stripe_size / stripes.size() * stripe_size + offset % stripe_size,
+            length, std::move(bufs), stripe_account(account, stripe), cb);
+        return;
+    }
+
+    // Each piece gets the parts of the buffers that fall into it.
+    linux_iocallback_t *piece_cb = new split_callback_t(cb, pieces);
+    size_t buf_index = 0;
+    size_t buf_offset = 0;
+    for_each_piece(offset, length,
+                   [&](size_t stripe, int64_t stripe_offset, size_t,
+                       size_t piece_length) {
+        std::vector<iovec> piece_bufs;
+        size_t remaining = piece_length;
+        while (remaining > 0) {
+            const size_t chunk =
+                std::min(remaining, bufs[buf_index].iov_len - buf_offset);
+            iovec piece_buf;
+            piece_buf.iov_base = static_cast<char *>(bufs[buf_index].iov_base)
+                + buf_offset;
+            piece_buf.iov_len = chunk;
+            piece_bufs.push_back(piece_buf);
+            remaining -= chunk;
+            buf_offset += chunk;
+            if (buf_offset == bufs[buf_index].iov_len) {
+                ++buf_index;
+                buf_offset = 0;
+            }
+        }
+        scoped_array_t<iovec> piece_array(piece_bufs.size());
+        std::copy(piece_bufs.begin(), piece_bufs.end(), piece_array.data());
+        stripe_stats[stripe]->bytes_written(piece_length);
+        stripes[stripe]->writev_async(stripe_offset, piece_length,
+                                      std::move(piece_array),
+                                      stripe_account(account, stripe), piece_cb);
+    });
+}
+
+void striped_file_t::co_datasync() {
+    pmap(stripes.size(), [&](int64_t stripe) {
+        stripes[stripe]->co_datasync();
+    });
+}
+
+void *striped_file_t::create_account(io_class_t io_class, int priority,
+                                     int outstanding_requests_limit) {
+    assert_thread();
+    stripe_accounts_t *accounts = new stripe_accounts_t();
+    for (size_t i = 0; i < stripes.size(); ++i) {
+        accounts->accounts.emplace_back(new file_account_t(
+            stripes[i].get(), io_class, priority, outstanding_requests_limit));
+    }
+    return accounts;
+}
+
+void striped_file_t::destroy_account(void *account) {
+    assert_thread();
+    delete static_cast<stripe_accounts_t *>(account);
+}
+
+bool striped_file_t::coop_lock_and_check() {
+    for (size_t i = 0; i < stripes.size(); ++i) {
+        if (!stripes[i]->coop_lock_and_check()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+file_load_t striped_file_t::get_load() {
+    // The stripes all share their `io_backender_t`'s I/O stack.
+    return stripes[0]->get_load();
+}
+
+void striped_file_t::add_device_stats(perfmon_collection_t *collection) {
+    for (size_t i = 0; i < stripes.size(); ++i) {
+        stripe_stats_t *stats = stripe_stats[i].get();
+        stats->collection_membership.init(new perfmon_membership_t(
+            collection, &stats->collection, strprintf("stripe_%zu", i)));
+        stats->stats_membership.init(new perfmon_multi_membership_t(
+            &stats->collection,
+            &stats->read_bytes_per_sec, "read_bytes_per_sec",
+            &stats->read_bytes_total, "read_bytes_total",
+            &stats->written_bytes_per_sec, "written_bytes_per_sec",
+            &stats->written_bytes_total, "written_bytes_total"));
+    }
+}
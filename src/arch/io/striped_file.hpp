@@ -0,0 +1,85 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef ARCH_IO_STRIPED_FILE_HPP_
+#define ARCH_IO_STRIPED_FILE_HPP_
+
+#include <vector>
+
+#include "arch/types.hpp"
+#include "concurrency/auto_drainer.hpp"
+#include "containers/scoped.hpp"
+#include "threading.hpp"
+
+/* A file whose contents are spread over several stripe files, typically on different
+devices, so that a single serializer can use the bandwidth of all of them.  The file is
+cut into units of `stripe_size` bytes that are dealt out to the stripes in turn: unit `k`
+of the file is unit `k / n` of stripe `k % n`.  With a `stripe_size` that's the
+serializer's extent size, consecutive extents land on consecutive devices.
+
+Requests that span several units are split up, and a write that asks for datasyncs
+first datasyncs the stripes it doesn't touch, so that it's ordered after everything
+written to the file before it, as with a single file. */
+class striped_file_t : public file_t, public home_thread_mixin_debug_only_t {
+public:
+    striped_file_t(std::vector<scoped_ptr_t<file_t> > &&stripes, int64_t stripe_size);
+    ~striped_file_t();
+
+    int64_t get_file_size();
+    void set_file_size(int64_t size);
+    void set_file_size_at_least(int64_t size, int64_t extent_size);
+
+    void read_async(int64_t offset, size_t length, void *buf, file_account_t *account,
+                    linux_iocallback_t *cb);
+    void write_async(int64_t offset, size_t length, const void *buf,
+                     file_account_t *account, linux_iocallback_t *cb,
+                     datasync_op ds_op);
+    void writev_async(int64_t offset, size_t length, scoped_array_t<iovec> &&bufs,
+                      file_account_t *account, linux_iocallback_t *cb);
+
+    void co_datasync();
+
+    // Every stripe gets an account of its own, with `outstanding_requests_limit`.
+    void *create_account(io_class_t io_class, int priority,
+                         int outstanding_requests_limit);
+    void destroy_account(void *account);
+
+    bool coop_lock_and_check();
+
+    file_load_t get_load();
+
+    // Adds a "stripe_<i>" collection with the bytes read from and written to each
+    // stripe.
+    void add_device_stats(perfmon_collection_t *collection);
+
+private:
+    class stripe_accounts_t;
+    class stripe_stats_t;
+    class split_callback_t;
+
+    // Calls `fn(stripe, stripe_offset, piece_offset, piece_length)` for each piece of
+    // the range that lies in a single unit, in order.
+    template <class callable_t>
+    void for_each_piece(int64_t offset, size_t length, const callable_t &fn) const;
+
+    // How large stripe `stripe` is when the whole file is `size` bytes large.
+    int64_t stripe_file_size(size_t stripe, int64_t size) const;
+
+    file_account_t *stripe_account(file_account_t *account, size_t stripe);
+
+    void submit_write(int64_t offset, size_t length, const void *buf,
+                      file_account_t *account, linux_iocallback_t *cb,
+                      datasync_op ds_op);
+
+    std::vector<scoped_ptr_t<file_t> > stripes;
+    const int64_t stripe_size;
+    int64_t file_size;
+
+    std::vector<scoped_ptr_t<stripe_stats_t> > stripe_stats;
+
+    // Writes with datasyncs wait for the other stripes in a coroutine that holds a
+    // lock on this.
+    auto_drainer_t drainer;
+
+    DISABLE_COPYING(striped_file_t);
+};
+
+#endif  // ARCH_IO_STRIPED_FILE_HPP_
@@ -0,0 +1,136 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "arch/io/tiered_file.hpp"
+
+#ifndef _WIN32
+#include <sys/uio.h>
+#endif
+
+#include "arch/io/disk.hpp"
+#include "arch/runtime/coroutines.hpp"
+#include "math.hpp"
+
+class tiered_file_t::tier_accounts_t {
+public:
+    scoped_ptr_t<file_account_t> fast;
+    scoped_ptr_t<file_account_t> cold;
+};
+
+tiered_file_t::tiered_file_t(scoped_ptr_t<file_t> &&_fast, scoped_ptr_t<file_t> &&_cold,
+                             int64_t _cold_offset)
+    : fast(std::move(_fast)), cold(std::move(_cold)), cold_offset(_cold_offset),
+      cold_written(false) {
+    guarantee(fast.has() && cold.has());
+    guarantee(divides(DEVICE_BLOCK_SIZE, cold_offset));
+}
+
+tiered_file_t::~tiered_file_t() { }
+
+file_t *tiered_file_t::tier_for(int64_t *offset, size_t length) {
+    if (*offset < cold_offset) {
+        guarantee(*offset + static_cast<int64_t>(length) <= cold_offset,
+                  "A request crosses the cold offset of a tiered file.");
+        return fast.get();
+    }
+    *offset -= cold_offset;
+    return cold.get();
+}
+
+file_account_t *tiered_file_t::tier_account(file_account_t *account, file_t *tier) {
+    if (account == DEFAULT_DISK_ACCOUNT) {
+        return DEFAULT_DISK_ACCOUNT;
+    }
+    tier_accounts_t *accounts = static_cast<tier_accounts_t *>(account->get_account());
+    return tier == fast.get() ? accounts->fast.get() : accounts->cold.get();
+}
+
+int64_t tiered_file_t::get_file_size() {
+    return fast->get_file_size();
+}
+
+void tiered_file_t::set_file_size(int64_t size) {
+    guarantee(size <= cold_offset);
+    fast->set_file_size(size);
+}
+
+void tiered_file_t::set_file_size_at_least(int64_t size, int64_t extent_size) {
+    guarantee(size <= cold_offset);
+    fast->set_file_size_at_least(size, extent_size);
+}
+
+void tiered_file_t::read_async(int64_t offset, size_t length, void *buf,
+                               file_account_t *account, linux_iocallback_t *cb) {
+    file_t *tier = tier_for(&offset, length);
+    tier->read_async(offset, length, buf, tier_account(account, tier), cb);
+}
+
+void tiered_file_t::write_async(int64_t offset, size_t length, const void *buf,
+                                file_account_t *account, linux_iocallback_t *cb,
+                                datasync_op ds_op) {
+    file_t *tier = tier_for(&offset, length);
+    if (tier == cold.get()) {
+        cold_written = true;
+    }
+    if (ds_op == datasync_op::no_datasyncs || tier == cold.get() || !cold_written) {
+        tier->write_async(offset, length, buf, tier_account(account, tier), cb, ds_op);
+        return;
+    }
+
+    cold_written = false;
+    auto_drainer_t::lock_t lock(&drainer);
+    coro_t::spawn_sometime([this, offset, length, buf, account, cb, ds_op,
+                            lock /* important to capture */]() {
+        cold->co_datasync();
+        fast->write_async(offset, length, buf, tier_account(account, fast.get()), cb,
+                          ds_op);
+    });
+}
+
+void tiered_file_t::writev_async(int64_t offset, size_t length,
+                                 scoped_array_t<iovec> &&bufs,
+                                 file_account_t *account, linux_iocallback_t *cb) {
+    file_t *tier = tier_for(&offset, length);
+    if (tier == cold.get()) {
+        cold_written = true;
+    }
+    tier->writev_async(offset, length, std::move(bufs), tier_account(account, tier),
+                       cb);
+}
+
+void tiered_file_t::co_datasync() {
+    cold_written = false;
+    cold->co_datasync();
+    fast->co_datasync();
+}
+
+void *tiered_file_t::create_account(io_class_t io_class, int priority,
+                                    int outstanding_requests_limit) {
+    assert_thread();
+    tier_accounts_t *accounts = new tier_accounts_t();
+    accounts->fast.init(new file_account_t(fast.get(), io_class, priority,
+                                           outstanding_requests_limit));
+    accounts->cold.init(new file_account_t(cold.get(), io_class, priority,
+                                           outstanding_requests_limit));
+    return accounts;
+}
+
+void tiered_file_t::destroy_account(void *account) {
+    assert_thread();
+    delete static_cast<tier_accounts_t *>(account);
+}
+
+bool tiered_file_t::coop_lock_and_check() {
+    return fast->coop_lock_and_check() && cold->coop_lock_and_check();
+}
+
+file_load_t tiered_file_t::get_load() {
+    // Both files share their `io_backender_t`'s I/O stack.
+    return fast->get_load();
+}
+
+void tiered_file_t::add_device_stats(perfmon_collection_t *collection) {
+    fast->add_device_stats(collection);
+}
+
+file_t *tiered_file_t::cold_tier() {
+    return cold.get();
+}
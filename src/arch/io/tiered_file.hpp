@@ -0,0 +1,74 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef ARCH_IO_TIERED_FILE_HPP_
+#define ARCH_IO_TIERED_FILE_HPP_
+
+#include "arch/types.hpp"
+#include "concurrency/auto_drainer.hpp"
+#include "containers/scoped.hpp"
+#include "threading.hpp"
+
+/* A file that is made of a file on fast storage and one on slower, cheaper storage.
+Offsets below `cold_offset` are in the fast file, and offset `cold_offset + x` is
+offset `x` of the cold file, so the caller decides what goes where by picking offsets.
+No request may cross `cold_offset`.
+
+The size functions are about the fast file; the cold file is resized through
+`cold_tier()`.  A write that asks for datasyncs first datasyncs the cold file if it has
+been written to since it was last datasynced, so that it's ordered after everything
+written to the file before it, as with a single file. */
+class tiered_file_t : public file_t, public home_thread_mixin_debug_only_t {
+public:
+    tiered_file_t(scoped_ptr_t<file_t> &&fast, scoped_ptr_t<file_t> &&cold,
+                  int64_t cold_offset);
+    ~tiered_file_t();
+
+    int64_t get_file_size();
+    void set_file_size(int64_t size);
+    void set_file_size_at_least(int64_t size, int64_t extent_size);
+
+    void read_async(int64_t offset, size_t length, void *buf, file_account_t *account,
+                    linux_iocallback_t *cb);
+    void write_async(int64_t offset, size_t length, const void *buf,
+                     file_account_t *account, linux_iocallback_t *cb,
+                     datasync_op ds_op);
+    void writev_async(int64_t offset, size_t length, scoped_array_t<iovec> &&bufs,
+                      file_account_t *account, linux_iocallback_t *cb);
+
+    void co_datasync();
+
+    // Both files get an account of their own, with `outstanding_requests_limit`.
+    void *create_account(io_class_t io_class, int priority,
+                         int outstanding_requests_limit);
+    void destroy_account(void *account);
+
+    bool coop_lock_and_check();
+
+    file_load_t get_load();
+
+    void add_device_stats(perfmon_collection_t *collection);
+
+    file_t *cold_tier();
+
+private:
+    class tier_accounts_t;
+
+    // Returns the file that `[offset, offset + length)` is in, and sets `*offset` to
+    // the offset in that file.
+    file_t *tier_for(int64_t *offset, size_t length);
+    file_account_t *tier_account(file_account_t *account, file_t *tier);
+
+    scoped_ptr_t<file_t> fast;
+    scoped_ptr_t<file_t> cold;
+    const int64_t cold_offset;
+
+    // Whether the cold file has been written to since it was last datasynced.
+    bool cold_written;
+
+    // Writes with datasyncs wait for the cold file in a coroutine that holds a lock on
+    // this.
+    auto_drainer_t drainer;
+
+    DISABLE_COPYING(tiered_file_t);
+};
+
+#endif  // ARCH_IO_TIERED_FILE_HPP_
@@ -353,6 +353,26 @@ artificial_stack_t::~artificial_stack_t() {
 #endif
 }
 
+void artificial_stack_t::release_unused_memory() {
+    rassert(!context.is_nil());
+    disable_overflow_protection();
+
+    // `context.pointer` is the stack pointer the context was switched out with.
+    // Everything below its page is dead and will be faulted back in as zeros.
+    const uintptr_t page_size = getpagesize();
+    const uintptr_t bound = reinterpret_cast<uintptr_t>(stack.get());
+    const uintptr_t in_use
+        = reinterpret_cast<uintptr_t>(context.pointer) & ~(page_size - 1);
+    rassert(in_use >= bound);
+    if (in_use > bound) {
+#ifdef __MACH__
+        madvise(stack.get(), in_use - bound, MADV_FREE);
+#else
+        madvise(stack.get(), in_use - bound, MADV_DONTNEED);
+#endif
+    }
+}
+
 /* Wrapper around `mprotect` that checks the return code. */
 void checked_mprotect_page(void *page_addr, int prot) {
     int res = mprotect(page_addr, getpagesize(), prot);
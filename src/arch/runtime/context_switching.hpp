@@ -28,6 +28,8 @@ public:
     I think fibers always have some overflow protection though? */
     void enable_overflow_protection() {}
     void disable_overflow_protection() {}
+
+    void release_unused_memory() {}
 };
 
 void context_switch(fiber_context_ref_t *current_context_out, fiber_context_ref_t *dest_context_in);
@@ -108,6 +110,11 @@ public:
     /* Disables stack-smashing protection for this stack, if currently enabled */
     void disable_overflow_protection();
 
+    /* Disables the protection and gives the memory below the stack's saved context
+    back to the operating system, while keeping the address space.  Must only be
+    called while the stack is switched out. */
+    void release_unused_memory();
+
 private:
     scoped_page_aligned_ptr_t<char> stack;
     size_t stack_size;
@@ -228,6 +235,8 @@ public:
     void enable_overflow_protection() {}
     void disable_overflow_protection() {}
 
+    void release_unused_memory() {}
+
 private:
     static void *internal_run(void *p);
     void get_stack_addr_size(void **stackaddr_out, size_t *stacksize_out) const;
@@ -0,0 +1,203 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include "arch/runtime/coro_sampler.hpp"
+
+#include <algorithm>
+#include <array>
+#include <map>
+#include <utility>
+
+#include "arch/runtime/runtime.hpp"
+#include "backtrace.hpp"
+#include "concurrency/cache_line_padded.hpp"
+#include "concurrency/pmap.hpp"
+#include "config/args.hpp"
+#include "rethinkdb_backtrace.hpp"
+#include "time.hpp"
+#include "utils.hpp"
+
+namespace {
+
+typedef std::array<void *, CORO_SAMPLER_BACKTRACE_DEPTH> sampled_trace_t;
+
+struct execution_point_samples_t {
+    execution_point_samples_t() : num_samples(0), run_nanos_total(0), run_nanos_max(0) { }
+    uint64_t num_samples;
+    int64_t run_nanos_total;
+    int64_t run_nanos_max;
+};
+
+/* Only ever accessed on its own thread. */
+struct thread_samples_t {
+    thread_samples_t()
+        : generation(0), yields_until_sample(CORO_SAMPLER_PERIOD),
+          resumed_at_nanos(0), num_samples_dropped(0) { }
+    uint64_t generation;
+    int yields_until_sample;
+    // Zero unless the next yield is going to be sampled.
+    int64_t resumed_at_nanos;
+    uint64_t num_samples_dropped;
+    std::map<sampled_trace_t, execution_point_samples_t> execution_points;
+};
+
+std::array<cache_line_padded_t<thread_samples_t>, MAX_THREADS> thread_samples;
+
+/* Bumped every time the sampler is turned on, so that the threads know to throw
+away what they sampled last time. */
+std::atomic<uint64_t> generation(0);
+std::atomic<int64_t> started_at_nanos(0);
+std::atomic<int64_t> active_until_nanos(0);
+
+std::string describe_frame(void *addr) {
+    backtrace_frame_t frame(addr);
+    frame.initialize_symbols();
+    std::string name;
+    try {
+        name = frame.get_demangled_name();
+    } catch (const demangle_failed_exc_t &) {
+        if (!frame.get_name().empty()) {
+            name = frame.get_name() + "+" + frame.get_offset();
+        } else if (!frame.get_symbols_line().empty()) {
+            name = frame.get_symbols_line();
+        } else {
+            name = "<unknown function>";
+        }
+    }
+    return strprintf("%p\t%s", frame.get_addr(), name.c_str());
+}
+
+}  // namespace
+
+std::atomic<bool> coro_sampler_t::active(false);
+
+void coro_sampler_t::record_resume() {
+    thread_samples_t *samples = &thread_samples[get_thread_id().threadnum].value;
+    if (samples->yields_until_sample <= 1) {
+        samples->resumed_at_nanos = get_ticks().nanos;
+    }
+}
+
+void coro_sampler_t::record_yield(size_t levels_to_strip_from_backtrace) {
+    thread_samples_t *samples = &thread_samples[get_thread_id().threadnum].value;
+    if (--samples->yields_until_sample > 0) {
+        return;
+    }
+    samples->yields_until_sample = CORO_SAMPLER_PERIOD;
+
+    const int64_t now = get_ticks().nanos;
+    if (now > active_until_nanos.load(std::memory_order_relaxed)) {
+        // Nobody has asked for a report in a while.
+        active.store(false, std::memory_order_relaxed);
+        samples->resumed_at_nanos = 0;
+        return;
+    }
+
+    const uint64_t current_generation = generation.load(std::memory_order_relaxed);
+    if (samples->generation != current_generation) {
+        samples->generation = current_generation;
+        samples->num_samples_dropped = 0;
+        samples->execution_points.clear();
+    }
+
+    if (samples->resumed_at_nanos == 0) {
+        // The sampler was turned on while this coroutine was running.
+        return;
+    }
+    const int64_t run_nanos = std::max<int64_t>(0, now - samples->resumed_at_nanos);
+    samples->resumed_at_nanos = 0;
+
+    // We strip the frames inside `rethinkdb_backtrace()` and ourselves.
+    const size_t levels_to_strip =
+        NUM_FRAMES_INSIDE_RETHINKDB_BACKTRACE + 1 + levels_to_strip_from_backtrace;
+    void *frames[CORO_SAMPLER_BACKTRACE_DEPTH + 16];
+    const size_t max_frames =
+        std::min<size_t>(CORO_SAMPLER_BACKTRACE_DEPTH + levels_to_strip,
+                         sizeof(frames) / sizeof(frames[0]));
+    const size_t num_frames = rethinkdb_backtrace(frames, max_frames);
+    sampled_trace_t trace;
+    for (size_t i = 0; i < CORO_SAMPLER_BACKTRACE_DEPTH; ++i) {
+        trace[i] = i + levels_to_strip < num_frames
+            ? frames[i + levels_to_strip]
+            : nullptr;
+    }
+
+    auto it = samples->execution_points.find(trace);
+    if (it == samples->execution_points.end()) {
+        if (samples->execution_points.size() >= CORO_SAMPLER_MAX_POINTS_PER_THREAD) {
+            ++samples->num_samples_dropped;
+            return;
+        }
+        it = samples->execution_points.insert(
+            std::make_pair(trace, execution_point_samples_t())).first;
+    }
+    ++it->second.num_samples;
+    it->second.run_nanos_total += run_nanos;
+    it->second.run_nanos_max = std::max(it->second.run_nanos_max, run_nanos);
+}
+
+coro_sampler_t::report_t coro_sampler_t::get_report() {
+    const int64_t now = get_ticks().nanos;
+    active_until_nanos.store(now + CORO_SAMPLER_ACTIVE_SECS * BILLION);
+    if (!active.exchange(true)) {
+        started_at_nanos.store(now);
+        generation.fetch_add(1);
+    }
+    const uint64_t current_generation = generation.load();
+
+    std::vector<std::map<sampled_trace_t, execution_point_samples_t> >
+        per_thread(get_num_threads());
+    std::vector<uint64_t> dropped_per_thread(get_num_threads(), 0);
+    pmap(get_num_threads(), [&](int i) {
+        on_thread_t thread_switcher((threadnum_t(i)));
+        const thread_samples_t &samples = thread_samples[i].value;
+        if (samples.generation == current_generation) {
+            per_thread[i] = samples.execution_points;
+            dropped_per_thread[i] = samples.num_samples_dropped;
+        }
+    });
+
+    report_t report;
+    report.active_secs = static_cast<double>(now - started_at_nanos.load()) / BILLION;
+    report.num_samples = 0;
+    report.num_samples_dropped = 0;
+
+    std::map<sampled_trace_t, execution_point_samples_t> merged;
+    for (size_t i = 0; i < per_thread.size(); ++i) {
+        report.num_samples_dropped += dropped_per_thread[i];
+        for (const auto &pair : per_thread[i]) {
+            execution_point_samples_t *point = &merged[pair.first];
+            point->num_samples += pair.second.num_samples;
+            point->run_nanos_total += pair.second.run_nanos_total;
+            point->run_nanos_max =
+                std::max(point->run_nanos_max, pair.second.run_nanos_max);
+            report.num_samples += pair.second.num_samples;
+        }
+    }
+    report.num_samples += report.num_samples_dropped;
+
+    std::vector<std::pair<sampled_trace_t, execution_point_samples_t> > points(
+        merged.begin(), merged.end());
+    const size_t num_reported =
+        std::min<size_t>(points.size(), CORO_SAMPLER_MAX_REPORTED_POINTS);
+    std::partial_sort(points.begin(), points.begin() + num_reported, points.end(),
+        [](const std::pair<sampled_trace_t, execution_point_samples_t> &a,
+           const std::pair<sampled_trace_t, execution_point_samples_t> &b) {
+            return a.second.run_nanos_total > b.second.run_nanos_total;
+        });
+
+    for (size_t i = 0; i < num_reported; ++i) {
+        execution_point_report_t point;
+        for (void *addr : points[i].first) {
+            if (addr == nullptr) {
+                break;
+            }
+            point.frames.push_back(describe_frame(addr));
+        }
+        point.num_samples = points[i].second.num_samples;
+        point.run_secs_total =
+            static_cast<double>(points[i].second.run_nanos_total) / BILLION;
+        point.run_secs_max =
+            static_cast<double>(points[i].second.run_nanos_max) / BILLION;
+        report.execution_points.push_back(std::move(point));
+    }
+    return report;
+}
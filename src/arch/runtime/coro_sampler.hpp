@@ -0,0 +1,84 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#ifndef ARCH_RUNTIME_CORO_SAMPLER_HPP_
+#define ARCH_RUNTIME_CORO_SAMPLER_HPP_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "errors.hpp"
+
+/* Depth of the backtraces that identify an execution point. */
+#define CORO_SAMPLER_BACKTRACE_DEPTH            12
+
+/* Every how many coroutine yields on a thread the sampler records a sample. */
+#define CORO_SAMPLER_PERIOD                     64
+
+/* How long the sampler stays on after the last report was requested. */
+#define CORO_SAMPLER_ACTIVE_SECS                60
+
+/* How many different execution points each thread keeps track of.  Samples at other
+execution points are only counted. */
+#define CORO_SAMPLER_MAX_POINTS_PER_THREAD      4096
+
+/* How many execution points a report lists, the ones with the most run time first. */
+#define CORO_SAMPLER_MAX_REPORTED_POINTS        50
+
+/*
+ * The `coro_sampler_t` is a sampling profiler for coroutines.  Unlike the
+ * `coro_profiler_t`, it's always compiled in, and meant to be cheap enough to use in
+ * production.  It is off until somebody asks for a report, and turns itself off
+ * again `CORO_SAMPLER_ACTIVE_SECS` after the last one; while it's off, it costs a
+ * relaxed atomic load per context switch.
+ *
+ * While it's on, every `CORO_SAMPLER_PERIOD`th yield on a thread records the
+ * execution point of the yielding coroutine (a backtrace of at most
+ * `CORO_SAMPLER_BACKTRACE_DEPTH` frames) and how long it has been running since it
+ * was last resumed.  The samples are aggregated by execution point on each thread.
+ * A report merges the threads' samples since the sampler was turned on.
+ *
+ * The reports can be read from the `rethinkdb._debug_profile` table.
+ */
+class coro_sampler_t {
+public:
+    struct execution_point_report_t {
+        std::vector<std::string> frames;
+        uint64_t num_samples;
+        double run_secs_total;
+        double run_secs_max;
+    };
+
+    struct report_t {
+        double active_secs;
+        uint64_t num_samples;
+        // Samples whose execution point didn't fit into the per-thread tables.
+        uint64_t num_samples_dropped;
+        std::vector<execution_point_report_t> execution_points;
+    };
+
+    /* Turns the sampler on, or keeps it on, and reports what it has sampled since it
+    was turned on.  Must be called in a coroutine. */
+    static report_t get_report();
+
+    static void on_resume() {
+        if (active.load(std::memory_order_relaxed)) {
+            record_resume();
+        }
+    }
+
+    static void on_yield(size_t levels_to_strip_from_backtrace) {
+        if (active.load(std::memory_order_relaxed)) {
+            record_yield(levels_to_strip_from_backtrace);
+        }
+    }
+
+private:
+    static void record_resume();
+    static NOINLINE void record_yield(size_t levels_to_strip_from_backtrace);
+
+    static std::atomic<bool> active;
+};
+
+#endif  // ARCH_RUNTIME_CORO_SAMPLER_HPP_
@@ -12,7 +12,10 @@
 #endif
 
 #include "arch/runtime/context_switching.hpp"
+#include "arch/runtime/coro_sampler.hpp"
+#include "arch/runtime/resource_usage.hpp"
 #include "arch/runtime/coro_profiler.hpp"
+#include "arch/runtime/memory_usage.hpp"
 #include "arch/runtime/runtime.hpp"
 #include "arch/runtime/thread_pool.hpp"
 #include "config/args.hpp"
@@ -27,10 +30,17 @@
 //Default, can be set through `set_coro_stack_size()`
 size_t coro_stack_size = COROUTINE_STACK_SIZE;
 
-// How many unused coroutine stacks to keep around (at most), before they are
-// freed. This value is per thread.
+// How many unused coroutine stacks to keep around (at most) with their memory
+// still resident. This value is per thread.
 const size_t COROUTINE_FREE_LIST_SIZE = 64;
 
+// How many more unused coroutines to keep around (by default) after their stack
+// memory has been given back to the operating system, before they are freed.  These
+// only cost address space, and save a burst of spawns the allocation and
+// protection syscalls.  This value is per thread, and can be changed with
+// `coro_t::set_parked_coroutine_limit()`.
+const size_t DEFAULT_PARKED_COROUTINE_LIMIT = 1024;
+
 // In debug mode, we print a warning if more than this many coroutines have been
 // allocated on one thread.
 #ifndef NDEBUG
@@ -68,9 +78,15 @@ struct coro_globals_t {
     /* The previous context. */
     coro_t *prev_coro;
 
-    /* A list of coro_t objects that are not in use. */
+    /* A list of coro_t objects that are not in use. The most recently used one is
+    at the back of the list. */
     intrusive_list_t<coro_t> free_coros;
 
+    /* Coroutines that have dropped out of the front of `free_coros`. Their stacks
+    don't hold any memory, but can be reused without a new allocation. */
+    intrusive_list_t<coro_t> parked_coros;
+    size_t parked_coros_limit;
+
     /* A list of coroutines that currently have protected stacks. The least recently
     used protected coroutine is always at the front of the list. */
     intrusive_list_t<coro_lru_entry_t> protected_coros_lru;
@@ -103,6 +119,7 @@ struct coro_globals_t {
     coro_globals_t()
         : current_coro(nullptr)
         , prev_coro(nullptr)
+        , parked_coros_limit(DEFAULT_PARKED_COROUTINE_LIMIT)
 #ifndef NDEBUG
         , coro_count(0)
         , printed_high_coro_count_warning(false)
@@ -124,6 +141,10 @@ struct coro_globals_t {
             free_coros.remove(s);
             delete s;
         }
+        while (coro_t *s = parked_coros.head()) {
+            parked_coros.remove(s);
+            delete s;
+        }
     }
 
 };
@@ -164,10 +185,13 @@ TLS_with_init(int64_t, coro_selfname_counter, 0);
 
 coro_t::coro_t() :
     stack(&coro_t::run, coro_stack_size),
+    stack_size_(coro_stack_size),
     current_thread_(linux_thread_pool_t::get_thread_id()),
     notified_(false),
     waiting_(false),
-    protected_stack_lru_entry_(this)
+    protected_stack_lru_entry_(this),
+    resource_usage_(nullptr),
+    resumed_at_nanos_(0)
 #ifndef NDEBUG
     , selfname_number(get_thread_id().threadnum + MAX_THREADS *
           // The comma here is the comma operator, to implement the semantics
@@ -180,6 +204,7 @@ coro_t::coro_t() :
 #endif
 {
     ++pm_allocated_coroutines;
+    add_memory_usage(memory_tag_t::COROUTINE_STACKS, stack_size_);
 
 #ifndef NDEBUG
     TLS_get_cglobals()->coro_count++;
@@ -200,14 +225,47 @@ void coro_t::return_coro_to_free_list(coro_t *coro) {
     // `coro_t::run`, that coroutine is still active and must not be deleted yet.
     static_assert(COROUTINE_FREE_LIST_SIZE > 0, "COROUTINE_FREE_LIST_SIZE cannot be 0");
     if (cglobals->free_coros.size() >= COROUTINE_FREE_LIST_SIZE) {
-        coro_t *coro_to_delete = cglobals->free_coros.tail();
-        cglobals->free_coros.remove(coro_to_delete);
-        delete coro_to_delete;
+        coro_t *coro_to_park = cglobals->free_coros.head();
+        cglobals->free_coros.remove(coro_to_park);
+        park_coro(coro_to_park);
     }
     rassert(cglobals->free_coros.size() < COROUTINE_FREE_LIST_SIZE);
     cglobals->free_coros.push_back(coro);
 }
 
+void coro_t::park_coro(coro_t *coro) {
+    coro_globals_t *cglobals = TLS_get_cglobals();
+    if (cglobals->parked_coros.size() >= cglobals->parked_coros_limit) {
+        delete coro;
+        return;
+    }
+    coro->stack.release_unused_memory();
+    cglobals->parked_coros.push_back(coro);
+}
+
+void coro_t::set_parked_coroutine_limit(size_t limit) {
+    coro_globals_t *cglobals = TLS_get_cglobals();
+    cglobals->parked_coros_limit = limit;
+    while (cglobals->parked_coros.size() > limit) {
+        coro_t *coro = cglobals->parked_coros.head();
+        cglobals->parked_coros.remove(coro);
+        delete coro;
+    }
+}
+
+void coro_t::preallocate_coroutines(size_t count) {
+    rassert(coroutines_have_been_initialized());
+    coro_globals_t *cglobals = TLS_get_cglobals();
+    while (count > 0 && cglobals->free_coros.size() < COROUTINE_FREE_LIST_SIZE) {
+        cglobals->free_coros.push_front(new coro_t());
+        --count;
+    }
+    while (count > 0 && cglobals->parked_coros.size() < cglobals->parked_coros_limit) {
+        park_coro(new coro_t());
+        --count;
+    }
+}
+
 coro_t::~coro_t() {
     /* We never move contexts from one thread to another. */
     rassert(get_thread_id() == home_thread());
@@ -216,6 +274,8 @@ coro_t::~coro_t() {
     TLS_get_cglobals()->coro_count--;
 #endif
     --pm_allocated_coroutines;
+    add_memory_usage(memory_tag_t::COROUTINE_STACKS,
+                     -static_cast<int64_t>(stack_size_));
 }
 
 /* Helper function for switching into a new context and making sure that the new context
@@ -274,7 +334,9 @@ void coro_t::run() {
         TLS_get_cglobals()->active_coroutines.insert(coro);
 #endif
         PROFILER_CORO_RESUME;
+        coro_sampler_t::on_resume();
         coro->action_wrapper.run();
+        coro_sampler_t::on_yield(0);
         PROFILER_CORO_YIELD(0);
 #ifndef NDEBUG
         TLS_get_cglobals()->running_coroutine_counts[coro->coroutine_type]--;
@@ -361,6 +423,8 @@ void coro_t::wait() {   /* class method */
     self()->waiting_ = true;
 
     PROFILER_CORO_YIELD(1);
+    coro_sampler_t::on_yield(1);
+    self()->charge_resource_usage_on_yield();
     if (TLS_get_cglobals()->prev_coro) {
         TLS_get_cglobals()->prev_coro->switch_to_coro_with_protection(
             &self()->stack.context);
@@ -368,12 +432,26 @@ void coro_t::wait() {   /* class method */
         switch_to_scheduler(&self()->stack.context, &TLS_get_cglobals()->scheduler);
     }
     PROFILER_CORO_RESUME;
+    coro_sampler_t::on_resume();
+    self()->charge_resource_usage_on_resume();
 
     rassert(self());
     rassert(self()->waiting_);
     self()->waiting_ = false;
 }
 
+void coro_t::charge_resource_usage_on_yield() {
+    if (resource_usage_ != nullptr) {
+        resource_usage_->run_nanos += get_ticks().nanos - resumed_at_nanos_;
+    }
+}
+
+void coro_t::charge_resource_usage_on_resume() {
+    if (resource_usage_ != nullptr) {
+        resumed_at_nanos_ = get_ticks().nanos;
+    }
+}
+
 void coro_t::yield() {  /* class method */
     rassert(self(), "Not in a coroutine context");
     self()->notify_sometime();
@@ -404,6 +482,8 @@ void coro_t::notify_now_deprecated() {
 
     if (coro_t::self() != nullptr) {
         PROFILER_CORO_YIELD(1);
+        coro_sampler_t::on_yield(1);
+        coro_t::self()->charge_resource_usage_on_yield();
     }
     coro_t *prev_prev_coro = TLS_get_cglobals()->prev_coro;
     TLS_get_cglobals()->prev_coro = TLS_get_cglobals()->current_coro;
@@ -420,6 +500,8 @@ void coro_t::notify_now_deprecated() {
     TLS_get_cglobals()->prev_coro = prev_prev_coro;
     if (coro_t::self() != nullptr) {
         PROFILER_CORO_RESUME;
+        coro_sampler_t::on_resume();
+        coro_t::self()->charge_resource_usage_on_resume();
     }
 
 #ifndef NDEBUG
@@ -518,11 +600,15 @@ coro_t * coro_t::get_coro() {
     rassert(coroutines_have_been_initialized());
     coro_t *coro;
 
-    if (TLS_get_cglobals()->free_coros.size() == 0) {
-        coro = new coro_t();
+    coro_globals_t *cglobals = TLS_get_cglobals();
+    if (!cglobals->free_coros.empty()) {
+        coro = cglobals->free_coros.tail();
+        cglobals->free_coros.remove(coro);
+    } else if (!cglobals->parked_coros.empty()) {
+        coro = cglobals->parked_coros.tail();
+        cglobals->parked_coros.remove(coro);
     } else {
-        coro = TLS_get_cglobals()->free_coros.tail();
-        TLS_get_cglobals()->free_coros.remove(coro);
+        coro = new coro_t();
     }
 
     rassert(!coro->intrusive_list_node_t<coro_t>::in_a_list());
@@ -26,6 +26,7 @@
 threadnum_t get_thread_id();
 struct coro_globals_t;
 class coro_t;
+struct resource_usage_t;
 
 
 struct coro_profiler_mixin_t {
@@ -150,6 +151,16 @@ public:
 
     static void set_coroutine_stack_size(size_t size);
 
+    /* Sets how many unused coroutines the current thread keeps parked, with their
+    stack memory released, in addition to its free list.  Parked coroutines cost
+    address space but hardly any memory, and spare a burst of spawns the stack
+    allocations. */
+    static void set_parked_coroutine_limit(size_t limit);
+
+    /* Allocates up to `count` unused coroutines on the current thread ahead of time,
+    as far as the free list and the parked coroutine limit allow. */
+    static void preallocate_coroutines(size_t count);
+
     coro_stack_t *get_stack();
 
     void set_priority(int _priority) {
@@ -208,6 +219,7 @@ private:
     static coro_t *get_coro();
 
     static void return_coro_to_free_list(coro_t *coro);
+    static void park_coro(coro_t *coro);
 
     NORETURN static void run();
 
@@ -215,9 +227,17 @@ private:
     friend struct coro_globals_t;
     ~coro_t();
 
+    /* Support for `scoped_resource_usage_t`, which charges the time a coroutine runs
+    to `resource_usage_`.  They only read the clock if `resource_usage_` is set. */
+    friend class scoped_resource_usage_t;
+    friend resource_usage_t *current_resource_usage();
+    void charge_resource_usage_on_yield();
+    void charge_resource_usage_on_resume();
+
     virtual void on_thread_switch();
 
     coro_stack_t stack;
+    const size_t stack_size_;
 
     threadnum_t current_thread_;
 
@@ -230,6 +250,9 @@ private:
     /* Used to eventually unprotect the coroutine if it has been inactive for a while. */
     coro_lru_entry_t protected_stack_lru_entry_;
 
+    resource_usage_t *resource_usage_;
+    int64_t resumed_at_nanos_;
+
 #ifndef NDEBUG
     int64_t selfname_number;
     std::string coroutine_type;
@@ -0,0 +1,58 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include "arch/runtime/cpu_task.hpp"
+
+#include <limits.h>
+
+#include <atomic>
+
+#include "arch/runtime/runtime.hpp"
+#include "config/args.hpp"
+#include "threading.hpp"
+
+namespace {
+
+// How many CPU tasks are running on each thread.
+std::atomic<int> cpu_tasks_on_thread[MAX_THREADS];
+
+threadnum_t pick_cpu_task_thread() {
+    const threadnum_t here = get_thread_id();
+    const int num_db_threads = get_num_db_threads();
+    threadnum_t best = here;
+    int best_load = here.threadnum < num_db_threads
+        ? cpu_tasks_on_thread[here.threadnum].load(std::memory_order_relaxed)
+        : INT_MAX;
+    for (int i = 0; i < num_db_threads; ++i) {
+        const int load = cpu_tasks_on_thread[i].load(std::memory_order_relaxed);
+        if (load < best_load) {
+            best = threadnum_t(i);
+            best_load = load;
+        }
+    }
+    return best;
+}
+
+class cpu_task_count_t {
+public:
+    explicit cpu_task_count_t(threadnum_t _thread) : thread(_thread) {
+        cpu_tasks_on_thread[thread.threadnum].fetch_add(1, std::memory_order_relaxed);
+    }
+    ~cpu_task_count_t() {
+        cpu_tasks_on_thread[thread.threadnum].fetch_sub(1, std::memory_order_relaxed);
+    }
+private:
+    const threadnum_t thread;
+    DISABLE_COPYING(cpu_task_count_t);
+};
+
+}  // namespace
+
+void run_cpu_task(const std::function<void()> &fun) {
+    const threadnum_t thread = pick_cpu_task_thread();
+    cpu_task_count_t count(thread);
+    if (thread == get_thread_id()) {
+        fun();
+    } else {
+        on_thread_t thread_switcher(thread);
+        fun();
+    }
+}
@@ -0,0 +1,18 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#ifndef ARCH_RUNTIME_CPU_TASK_HPP_
+#define ARCH_RUNTIME_CPU_TASK_HPP_
+
+#include <functional>
+
+/* `run_cpu_task()` calls `fun` in the current coroutine, but on whichever db thread
+has the fewest CPU tasks running right now.  If that isn't unique, we stay where we
+are, so the thread hop only happens when some other thread is less busy than ours.
+The coroutine is back on its own thread when `run_cpu_task()` returns or throws.
+
+This is meant for long pure computations, such as parsing a big JSON document, that
+would otherwise keep one thread busy while the others sit idle.  `fun` must not touch
+anything thread-local, or anything that another coroutine on the calling thread
+might use while `fun` is running. */
+void run_cpu_task(const std::function<void()> &fun);
+
+#endif  // ARCH_RUNTIME_CPU_TASK_HPP_
@@ -3,8 +3,15 @@
 
 #include <string.h>
 
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+
 #include "arch/runtime/thread_pool.hpp"
+#include "backtrace.hpp"
 #include "concurrency/cond_var.hpp"
+#include "logger.hpp"
 #include "utils.hpp"
 #include "perfmon/perfmon.hpp"
 
@@ -15,6 +22,238 @@ perfmon_duration_sampler_t *pm_eventloop_singleton_t::get() {
     return &pm_eventloop;
 }
 
+namespace {
+
+class event_loop_perfmons_t {
+public:
+    event_loop_perfmons_t()
+        : iteration(secs_to_ticks(1), true),
+          wait(secs_to_ticks(1), true),
+          event_loop_membership(&get_global_perfmon_collection(), &event_loop,
+                                "event_loop"),
+          iteration_membership(&event_loop, &iteration, "iteration"),
+          wait_membership(&event_loop, &wait, "wait"),
+          messages_membership(&event_loop, &messages, "messages") {
+        for (int p = MESSAGE_SCHEDULER_MIN_PRIORITY;
+             p <= MESSAGE_SCHEDULER_MAX_PRIORITY;
+             ++p) {
+            message_histograms.emplace_back(
+                new perfmon_histogram_t(secs_to_ticks(1), true));
+            message_memberships.emplace_back(new perfmon_membership_t(
+                &messages,
+                message_histograms.back().get(),
+                strprintf("priority_%d", p)));
+        }
+    }
+
+    perfmon_histogram_t *get_message_histogram(int priority) {
+        return message_histograms[priority - MESSAGE_SCHEDULER_MIN_PRIORITY].get();
+    }
+
+    perfmon_collection_t event_loop;
+    // The time between two waits for events, in which the thread is busy.
+    perfmon_histogram_t iteration;
+    // The time spent waiting for events.
+    perfmon_histogram_t wait;
+    perfmon_collection_t messages;
+    std::vector<std::unique_ptr<perfmon_histogram_t> > message_histograms;
+
+private:
+    perfmon_membership_t event_loop_membership;
+    perfmon_membership_t iteration_membership;
+    perfmon_membership_t wait_membership;
+    perfmon_membership_t messages_membership;
+    std::vector<std::unique_ptr<perfmon_membership_t> > message_memberships;
+};
+
+event_loop_perfmons_t *get_event_loop_perfmons() {
+    static event_loop_perfmons_t perfmons;
+    return &perfmons;
+}
+
+/* Only ever accessed on its own thread. */
+struct event_loop_thread_state_t {
+    // When the thread last stopped waiting for events, or zero while it's waiting.
+    ticks_t iteration_start;
+    // When the thread started waiting for events.
+    ticks_t wait_start;
+    // When the last callback or message finished.
+    ticks_t last_done;
+    ticks_t last_slow_log;
+    int num_slow_not_logged;
+    // The current window for the thread's load, and how long the thread has waited
+    // for events in it.
+    ticks_t load_window_start;
+    int64_t load_window_wait_nanos;
+};
+
+cache_line_padded_t<event_loop_thread_state_t> event_loop_thread_states[MAX_THREADS];
+
+/* Written by its own thread, read by any thread. */
+struct event_loop_thread_load_t {
+    // The load in the last complete window, in millionths.
+    std::atomic<int64_t> load_millionths;
+    // When that window ended.
+    std::atomic<int64_t> published_nanos;
+    std::atomic<bool> waiting;
+};
+
+cache_line_padded_t<event_loop_thread_load_t> event_loop_thread_loads[MAX_THREADS];
+
+std::atomic<int64_t> slow_callback_threshold_nanos(0);
+
+event_loop_thread_state_t *get_event_loop_thread_state() {
+    return &event_loop_thread_states[get_thread_id().threadnum].value;
+}
+
+void check_slow_callback(event_loop_thread_state_t *state, ticks_t now,
+                         ticks_t duration, const char *kind,
+                         const std::type_info &type) {
+    const int64_t threshold = slow_callback_threshold_nanos.load(
+        std::memory_order_relaxed);
+    if (threshold == 0 || duration.nanos <= threshold) {
+        return;
+    }
+    if (state->last_slow_log.nanos != 0
+        && now.nanos - state->last_slow_log.nanos < secs_to_ticks(1).nanos) {
+        ++state->num_slow_not_logged;
+        return;
+    }
+
+    std::string type_name;
+    try {
+        type_name = demangle_cpp_name(type.name());
+    } catch (const demangle_failed_exc_t &) {
+        type_name = type.name();
+    }
+    std::string not_logged;
+    if (state->num_slow_not_logged > 0) {
+        not_logged = strprintf(" (%d more slow callbacks or messages on this thread "
+                               "weren't logged)", state->num_slow_not_logged);
+    }
+    logWRN("The event loop of thread %d was blocked for %.3f ms by a %s of type %s.%s",
+           get_thread_id().threadnum, ticks_to_secs(duration) * THOUSAND, kind,
+           type_name.c_str(), not_logged.c_str());
+    state->last_slow_log = now;
+    state->num_slow_not_logged = 0;
+}
+
+void maybe_publish_load(event_loop_thread_state_t *state, ticks_t now) {
+    const int64_t window_nanos = now.nanos - state->load_window_start.nanos;
+    if (window_nanos < EVENT_LOOP_LOAD_WINDOW_MS * MILLION) {
+        return;
+    }
+    if (state->load_window_start.nanos != 0) {
+        event_loop_thread_load_t *load =
+            &event_loop_thread_loads[get_thread_id().threadnum].value;
+        const int64_t busy_nanos =
+            std::max<int64_t>(0, window_nanos - state->load_window_wait_nanos);
+        load->load_millionths.store(busy_nanos * MILLION / window_nanos,
+                                    std::memory_order_relaxed);
+        load->published_nanos.store(now.nanos, std::memory_order_relaxed);
+    }
+    state->load_window_start = now;
+    state->load_window_wait_nanos = 0;
+}
+
+}  // namespace
+
+void event_loop_stats_t::begin_wait() {
+    event_loop_thread_state_t *state = get_event_loop_thread_state();
+    const ticks_t now = get_ticks();
+    if (state->iteration_start.nanos != 0) {
+        get_event_loop_perfmons()->iteration.record(
+            ticks_t{now.nanos - state->iteration_start.nanos}, now);
+    }
+    state->iteration_start = ticks_t{0};
+    state->wait_start = now;
+    maybe_publish_load(state, now);
+    event_loop_thread_loads[get_thread_id().threadnum].value.waiting.store(
+        true, std::memory_order_relaxed);
+}
+
+void event_loop_stats_t::end_wait() {
+    event_loop_thread_state_t *state = get_event_loop_thread_state();
+    const ticks_t now = get_ticks();
+    if (state->wait_start.nanos != 0) {
+        get_event_loop_perfmons()->wait.record(
+            ticks_t{now.nanos - state->wait_start.nanos}, now);
+        state->load_window_wait_nanos += now.nanos - state->wait_start.nanos;
+    }
+    state->iteration_start = now;
+    state->last_done = now;
+    event_loop_thread_loads[get_thread_id().threadnum].value.waiting.store(
+        false, std::memory_order_relaxed);
+    maybe_publish_load(state, now);
+}
+
+void event_loop_stats_t::callback_done(const std::type_info &callback_type) {
+    event_loop_thread_state_t *state = get_event_loop_thread_state();
+    const ticks_t now = get_ticks();
+    const ticks_t duration{now.nanos - state->last_done.nanos};
+    state->last_done = now;
+    check_slow_callback(state, now, duration, "callback", callback_type);
+}
+
+void event_loop_stats_t::message_done(int priority,
+                                      const std::type_info &message_type) {
+    event_loop_thread_state_t *state = get_event_loop_thread_state();
+    const ticks_t now = get_ticks();
+    const ticks_t duration{now.nanos - state->last_done.nanos};
+    state->last_done = now;
+    get_event_loop_perfmons()->get_message_histogram(priority)->record(duration, now);
+    check_slow_callback(state, now, duration, "message", message_type);
+}
+
+void event_loop_stats_t::set_slow_callback_threshold(ticks_t threshold) {
+    slow_callback_threshold_nanos.store(threshold.nanos);
+}
+
+double event_loop_stats_t::get_load(threadnum_t thread) {
+    const event_loop_thread_load_t *load =
+        &event_loop_thread_loads[thread.threadnum].value;
+    const int64_t published_nanos =
+        load->published_nanos.load(std::memory_order_relaxed);
+    if (get_ticks().nanos - published_nanos > 2 * EVENT_LOOP_LOAD_WINDOW_MS * MILLION) {
+        // The thread hasn't gone through its event loop for a while, so it has either
+        // been waiting or been busy the whole time.
+        return load->waiting.load(std::memory_order_relaxed) ? 0.0 : 1.0;
+    }
+    return static_cast<double>(load->load_millionths.load(std::memory_order_relaxed))
+        / MILLION;
+}
+
+static std::atomic<int64_t> busy_poll_max_spin_nanos(0);
+
+busy_poll_policy_t::busy_poll_policy_t() : spin_nanos(0) { }
+
+void busy_poll_policy_t::set_max_spin(ticks_t max_spin) {
+    busy_poll_max_spin_nanos.store(max_spin.nanos);
+}
+
+ticks_t busy_poll_policy_t::get_max_spin() {
+    return ticks_t{busy_poll_max_spin_nanos.load(std::memory_order_relaxed)};
+}
+
+void busy_poll_policy_t::on_blocked(ticks_t blocked_for) {
+    const int64_t max_spin_nanos = get_max_spin().nanos;
+    if (max_spin_nanos == 0) {
+        spin_nanos = 0;
+        return;
+    }
+    const int64_t min_spin_nanos =
+        std::min<int64_t>(max_spin_nanos, BUSY_POLL_MIN_SPIN_USECS * THOUSAND);
+    if (blocked_for.nanos <= max_spin_nanos) {
+        spin_nanos = std::min(max_spin_nanos,
+                              std::max(min_spin_nanos, spin_nanos * 2));
+    } else {
+        spin_nanos /= 2;
+        if (spin_nanos < min_spin_nanos) {
+            spin_nanos = 0;
+        }
+    }
+}
+
 std::string format_poll_event(int event) {
     std::string s;
     if (event & poll_event_in) {
@@ -5,10 +5,17 @@
 #include <signal.h>
 
 #include <string>
+#include <typeinfo>
 
 #include "perfmon/types.hpp"
 #include "arch/runtime/runtime_utils.hpp"
 #include "arch/runtime/event_queue_types.hpp"
+#include "threading.hpp"
+#include "time.hpp"
+
+/* How often each thread measures how busy it is, for `event_loop_stats_t::get_load()`.
+*/
+#define EVENT_LOOP_LOAD_WINDOW_MS 100
 
 std::string format_poll_event(int event);
 
@@ -21,6 +28,28 @@ struct pm_eventloop_singleton_t {
     static perfmon_duration_sampler_t *get();
 };
 
+/* Times the event loop of each thread, for the per-thread histograms in the
+"event_loop" stats and for the slow callback log. The event queue calls `begin_wait()`
+and `end_wait()` around waiting for events, and `callback_done()` after each callback;
+the message hub calls `message_done()` after each message. Each of these attributes
+the time since the previous one to whatever just finished, so none of them takes more
+than one `get_ticks()`. Its perfmons are created on first use, like `pm_eventloop`. */
+class event_loop_stats_t {
+public:
+    static void begin_wait();
+    static void end_wait();
+    static void callback_done(const std::type_info &callback_type);
+    static void message_done(int priority, const std::type_info &message_type);
+
+    /* Callbacks and messages that run for longer than `threshold` get logged, at most
+    once a second per thread. Zero, the default, turns the log off. */
+    static void set_slow_callback_threshold(ticks_t threshold);
+
+    /* The fraction of the last `EVENT_LOOP_LOAD_WINDOW_MS` in which `thread` wasn't
+    waiting for events, between 0 and 1. Can be called from any thread. */
+    static double get_load(threadnum_t thread);
+};
+
 /* Pick the queue now*/
 
 #if defined(_WIN32)
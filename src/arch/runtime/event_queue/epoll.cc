@@ -59,7 +59,20 @@ void epoll_event_queue_t::run() {
     // Now, start the loop
     while (!parent->should_shut_down()) {
         // Grab the events from the kernel!
-        res = epoll_wait(epoll_fd, events, MAX_IO_EVENT_PROCESSING_BATCH_SIZE, -1);
+        event_loop_stats_t::begin_wait();
+        res = 0;
+        if (busy_poll.get_spin().nanos > 0) {
+            res = spin_for_events(busy_poll.get_spin());
+        }
+        if (res == 0) {
+            const bool busy_polling = busy_poll_policy_t::get_max_spin().nanos > 0;
+            const ticks_t blocked_since = busy_polling ? get_ticks() : ticks_t{0};
+            res = epoll_wait(epoll_fd, events, MAX_IO_EVENT_PROCESSING_BATCH_SIZE, -1);
+            if (busy_polling) {
+                busy_poll.on_blocked(ticks_t{get_ticks().nanos - blocked_since.nanos});
+            }
+        }
+        event_loop_stats_t::end_wait();
 
         // epoll_wait might return with EINTR in some cases (in
         // particular under GDB), we just need to retry.
@@ -112,7 +125,9 @@ void epoll_event_queue_t::run() {
                 if (events_gotten & poll_event_in) rassert(events_wanted & poll_event_in);
                 if (events_gotten & poll_event_out) rassert(events_wanted & poll_event_out);
 #endif
+                const std::type_info &callback_type = typeid(*cb);
                 cb->on_event(events_gotten);
+                event_loop_stats_t::callback_done(callback_type);
             }
         }
 
@@ -122,6 +137,26 @@ void epoll_event_queue_t::run() {
     }
 }
 
+int epoll_event_queue_t::spin_for_events(ticks_t spin) {
+    const int64_t deadline = get_ticks().nanos + spin.nanos;
+    for (int i = 0; ; ++i) {
+        // The kernel is only asked every so often, unless other threads have sent us
+        // messages, in which case the message hub's event is about to be readable.
+        if (i % BUSY_POLL_SYSCALL_INTERVAL == 0 || parent->has_pending_messages()) {
+            int res = epoll_wait(epoll_fd, events, MAX_IO_EVENT_PROCESSING_BATCH_SIZE, 0);
+            if (res != 0) {
+                return res;
+            }
+        }
+        if (get_ticks().nanos >= deadline) {
+            return 0;
+        }
+#if defined(__i386__) || defined(__x86_64__)
+        __builtin_ia32_pause();
+#endif
+    }
+}
+
 epoll_event_queue_t::~epoll_event_queue_t() {
     DEBUG_VAR int res = close(epoll_fd);
     rassert_err(res == 0, "Could not close epoll_fd");
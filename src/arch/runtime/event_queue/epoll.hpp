@@ -30,10 +30,16 @@ public:
     void forget_event(system_event_t *, linux_event_callback_t *cb);
 
 private:
+    // Polls for events without blocking until some come in or `spin` has passed.
+    // Returns the result of the last `epoll_wait()`.
+    int spin_for_events(ticks_t spin);
+
     linux_queue_parent_t *parent;
 
     fd_t epoll_fd;
 
+    busy_poll_policy_t busy_poll;
+
     // We store this as a class member because forget_resource needs
     // to go through the events and remove queued messages for
     // resources that are being destroyed.
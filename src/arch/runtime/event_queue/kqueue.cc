@@ -63,8 +63,10 @@ void kqueue_event_queue_t::run() {
     // Now, start the loop
     while (!parent->should_shut_down()) {
         // Grab the events from the kqueue!
+        event_loop_stats_t::begin_wait();
         nevents = call_kevent(kqueue_fd, nullptr, 0,
                               events, MAX_IO_EVENT_PROCESSING_BATCH_SIZE, nullptr);
+        event_loop_stats_t::end_wait();
 
         block_pm_duration event_loop_timer(pm_eventloop_singleton_t::get());
 
@@ -77,7 +79,9 @@ void kqueue_event_queue_t::run() {
             } else {
                 linux_event_callback_t *cb =
                     reinterpret_cast<linux_event_callback_t *>(events[i].udata);
+                const std::type_info &callback_type = typeid(*cb);
                 cb->on_event(kevent_filter_to_user(events[i].filter));
+                event_loop_stats_t::callback_done(callback_type);
             }
         }
 
@@ -103,6 +103,7 @@ void poll_event_queue_t::run() {
     // Now, start the loop
     while (!parent->should_shut_down()) {
         // Grab the events from the kernel!
+        event_loop_stats_t::begin_wait();
 #ifndef RDB_TIMER_PROVIDER
 #error "RDB_TIMER_PROVIDER not defined."
 #elif RDB_TIMER_PROVIDER == RDB_TIMER_PROVIDER_SIGNAL
@@ -110,6 +111,7 @@ void poll_event_queue_t::run() {
 #else
         res = poll(&watched_fds[0], watched_fds.size(), -1);
 #endif
+        event_loop_stats_t::end_wait();
         // ppoll might return with EINTR in some cases (in particular
         // under GDB), we just need to retry.
         if (res == -1 && get_errno() == EINTR) {
@@ -126,7 +128,9 @@ void poll_event_queue_t::run() {
         for (unsigned int i = 0; i < watched_fds.size(); i++) {
             if (watched_fds[i].revents != 0) {
                 linux_event_callback_t *cb = callbacks[watched_fds[i].fd];
+                const std::type_info &callback_type = typeid(*cb);
                 cb->on_event(poll_to_user(watched_fds[i].revents));
+                event_loop_stats_t::callback_done(callback_type);
                 count++;
             }
             if (count == res)
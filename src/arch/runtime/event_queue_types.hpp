@@ -3,6 +3,9 @@
 #define ARCH_RUNTIME_EVENT_QUEUE_TYPES_HPP_
 
 #include <signal.h>
+#include <stdint.h>
+
+#include "time.hpp"
 
 // Types that are used, in particular, by poll.hpp and epoll.hpp.
 
@@ -15,9 +18,33 @@ struct linux_event_callback_t {
 struct linux_queue_parent_t {
     virtual void pump() = 0;
     virtual bool should_shut_down() = 0;
+    // Cheap enough to call in a busy-polling loop, from the queue's own thread.
+    virtual bool has_pending_messages() = 0;
     virtual ~linux_queue_parent_t() {}
 };
 
+/* In busy-polling mode, an event queue that runs out of work keeps polling for events
+for a while before it blocks, which saves the wakeup latency at the cost of CPU time.
+How long it spins adapts to how long it has been blocking afterwards: if it would
+have caught the next event by spinning longer, it doubles the spin, up to the maximum,
+and if it blocked for longer than the maximum anyway, it halves the spin, so an idle
+thread soon stops spinning at all. Busy polling is off unless the maximum is set. */
+class busy_poll_policy_t {
+public:
+    busy_poll_policy_t();
+
+    static void set_max_spin(ticks_t max_spin);
+    static ticks_t get_max_spin();
+
+    // How long to poll before blocking.
+    ticks_t get_spin() const { return ticks_t{spin_nanos}; }
+    // Called when the queue had to block after spinning for `get_spin()`.
+    void on_blocked(ticks_t blocked_for);
+
+private:
+    int64_t spin_nanos;
+};
+
 const int poll_event_in = 1;
 const int poll_event_out = 2;
 const int poll_event_err = 4;
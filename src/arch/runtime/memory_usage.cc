@@ -0,0 +1,114 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "arch/runtime/memory_usage.hpp"
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "arch/compiler.hpp"
+#include "arch/runtime/runtime.hpp"
+#include "config/args.hpp"
+#include "perfmon/perfmon.hpp"
+#include "rdb_protocol/datum.hpp"
+
+namespace {
+
+// A POD, so that it can be thread local.
+struct memory_usage_counts_t {
+    int64_t bytes[NUM_MEMORY_TAGS];
+};
+
+THREAD_LOCAL memory_usage_counts_t thread_memory_usage_counts;
+
+NOINLINE memory_usage_counts_t get_thread_memory_usage_counts() {
+    return thread_memory_usage_counts;
+}
+
+const char *memory_tag_stat_name(memory_tag_t tag) {
+    switch (tag) {
+    case memory_tag_t::PAGE_CACHE: return "page_cache_bytes";
+    case memory_tag_t::LBA_INDEX: return "lba_index_bytes";
+    case memory_tag_t::QUERY_CACHE: return "query_cache_bytes";
+    case memory_tag_t::CHANGEFEED_QUEUES: return "changefeed_queues_bytes";
+    case memory_tag_t::DATUMS: return "datums_bytes";
+    case memory_tag_t::NETWORK_BUFFERS: return "network_buffers_bytes";
+    case memory_tag_t::COROUTINE_STACKS: return "coroutine_stacks_bytes";
+    default: unreachable();
+    }
+}
+
+// Returns -1 if the resident size can't be found out.
+int64_t get_resident_bytes() {
+#if defined(__MACH__) || defined(_WIN32)
+    return -1;
+#else
+    FILE *statm = fopen("/proc/self/statm", "r");
+    if (statm == nullptr) {
+        return -1;
+    }
+    unsigned long size_pages, resident_pages;  // NOLINT(runtime/int)
+    const int res = fscanf(statm, "%lu %lu", &size_pages, &resident_pages);
+    fclose(statm);
+    if (res != 2) {
+        return -1;
+    }
+    return static_cast<int64_t>(resident_pages) * getpagesize();
+#endif
+}
+
+/* Each thread fills in its own entry of the context. */
+class perfmon_memory_usage_t : public perfmon_t {
+public:
+    perfmon_memory_usage_t() { }
+
+    void *begin_stats() {
+        return new memory_usage_counts_t[MAX_THREADS]();
+    }
+
+    void visit_stats(void *ctx) {
+        static_cast<memory_usage_counts_t *>(ctx)[get_thread_id().threadnum] =
+            get_thread_memory_usage_counts();
+    }
+
+    ql::datum_t end_stats(void *ctx) {
+        memory_usage_counts_t *per_thread = static_cast<memory_usage_counts_t *>(ctx);
+        ql::datum_object_builder_t builder;
+        int64_t accounted_bytes = 0;
+        for (int tag = 0; tag < NUM_MEMORY_TAGS; ++tag) {
+            int64_t bytes = 0;
+            for (int i = 0; i < get_num_threads(); ++i) {
+                bytes += per_thread[i].bytes[tag];
+            }
+            accounted_bytes += bytes;
+            builder.overwrite(memory_tag_stat_name(static_cast<memory_tag_t>(tag)),
+                              ql::datum_t(static_cast<double>(bytes)));
+        }
+        delete[] per_thread;
+
+        const int64_t resident_bytes = get_resident_bytes();
+        if (resident_bytes >= 0) {
+            builder.overwrite("rss_bytes",
+                              ql::datum_t(static_cast<double>(resident_bytes)));
+            builder.overwrite("unaccounted_bytes", ql::datum_t(
+                static_cast<double>(resident_bytes - accounted_bytes)));
+        } else {
+            builder.overwrite("rss_bytes", ql::datum_t::null());
+            builder.overwrite("unaccounted_bytes", ql::datum_t::null());
+        }
+        return std::move(builder).to_datum();
+    }
+
+private:
+    DISABLE_COPYING(perfmon_memory_usage_t);
+};
+
+perfmon_memory_usage_t pm_memory_usage;
+perfmon_membership_t pm_memory_usage_membership(
+    &get_global_perfmon_collection(), &pm_memory_usage, "memory");
+
+}  // namespace
+
+// This accesses the thread local counts directly, so it must not be inlined into a
+// function that might switch threads.  See the comment in `thread_local.hpp`.
+NOINLINE void add_memory_usage(memory_tag_t tag, int64_t bytes) {
+    thread_memory_usage_counts.bytes[static_cast<int>(tag)] += bytes;
+}
@@ -0,0 +1,41 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef ARCH_RUNTIME_MEMORY_USAGE_HPP_
+#define ARCH_RUNTIME_MEMORY_USAGE_HPP_
+
+#include <stdint.h>
+
+/* Keeps track of how many bytes the big users of memory hold, so that one can tell
+where a server's memory went when its resident size is well above its cache size.
+The counts are kept per thread and summed up when the stats are read, in the
+"memory" stats of each server, which also show the resident size and how much of it
+isn't accounted for.  They show up in the server rows of `rethinkdb.stats`.
+
+Memory may be freed on another thread than the one it was counted on, so the counts
+of single threads can go negative; only the sums mean anything. */
+
+enum class memory_tag_t {
+    // The pages in the page caches' eviction bags and their compressed copies.
+    PAGE_CACHE,
+    // The serializers' in-memory LBA indexes.
+    LBA_INDEX,
+    // The parsed JSON of the queries that are running or have open cursors.
+    QUERY_CACHE,
+    // The queue entries of changefeed subscriptions, but not the datums in them,
+    // which count as `DATUMS` as long as they are serialized.
+    CHANGEFEED_QUEUES,
+    // The buffers of heap strings and serialized datums, which includes the queries
+    // as the clients sent them.
+    DATUMS,
+    // The read and write buffers of TCP connections.
+    NETWORK_BUFFERS,
+    // The coroutines' stacks, at their full size, though parked coroutines give the
+    // unused part of theirs back to the operating system.
+    COROUTINE_STACKS
+};
+
+const int NUM_MEMORY_TAGS = static_cast<int>(memory_tag_t::COROUTINE_STACKS) + 1;
+
+/* `bytes` is negative when memory is freed. */
+void add_memory_usage(memory_tag_t tag, int64_t bytes);
+
+#endif  // ARCH_RUNTIME_MEMORY_USAGE_HPP_
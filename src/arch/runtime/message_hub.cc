@@ -23,7 +23,7 @@ linux_message_hub_t::linux_message_hub_t(linux_event_queue_t *queue,
                                          threadnum_t current_thread)
     : queue_(queue),
       thread_pool_(thread_pool),
-      is_woken_up_(false),
+      incoming_messages_(nullptr),
       current_thread_(current_thread) {
 
 #ifndef NDEBUG
@@ -47,7 +47,7 @@ linux_message_hub_t::~linux_message_hub_t() {
         guarantee(get_priority_msg_list(p).empty());
     }
 
-    guarantee(incoming_messages_.empty());
+    guarantee(incoming_messages_.load() == nullptr);
 }
 
 void linux_message_hub_t::do_store_message(threadnum_t nthread, linux_thread_message_t *msg) {
@@ -94,19 +94,35 @@ void linux_message_hub_t::store_message_sometime(threadnum_t nthread, linux_thre
 
 
 void linux_message_hub_t::insert_external_message(linux_thread_message_t *msg) {
-    bool do_wake_up;
-    {
-        spinlock_acq_t acq(&incoming_messages_lock_);
-        do_wake_up = !check_and_set_is_woken_up();
-        incoming_messages_.push_back(msg);
-    }
+    msg_list_t msgs;
+    msgs.push_back(msg);
 
     // Wakey wakey eggs and bakey
-    if (do_wake_up) {
+    if (push_incoming_messages(&msgs)) {
         event_.wakey_wakey();
     }
 }
 
+bool linux_message_hub_t::push_incoming_messages(msg_list_t *msgs) {
+    rassert(!msgs->empty());
+    // Link the batch newest first, like the rest of the stack.
+    linux_thread_message_t *const oldest = msgs->head();
+    linux_thread_message_t *newest = nullptr;
+    while (linux_thread_message_t *m = msgs->head()) {
+        msgs->remove(m);
+        m->next_incoming_ = newest;
+        newest = m;
+    }
+
+    linux_thread_message_t *top = incoming_messages_.load(std::memory_order_relaxed);
+    do {
+        oldest->next_incoming_ = top;
+    } while (!incoming_messages_.compare_exchange_weak(top, newest,
+                                                       std::memory_order_release,
+                                                       std::memory_order_relaxed));
+    return top == nullptr;
+}
+
 linux_message_hub_t::msg_list_t &linux_message_hub_t::get_priority_msg_list(int priority) {
     rassert(priority >= MESSAGE_SCHEDULER_MIN_PRIORITY);
     rassert(priority <= MESSAGE_SCHEDULER_MAX_PRIORITY);
@@ -167,7 +183,10 @@ void linux_message_hub_t::on_event(int events) {
             }
 #endif
 
+            // `m` might not exist anymore once it has run.
+            const std::type_info &message_type = typeid(*m);
             m->on_thread_switch();
+            event_loop_stats_t::message_done(current_priority, message_type);
         }
     }
 
@@ -178,12 +197,9 @@ void linux_message_hub_t::on_event(int events) {
             // Place wakey_wakey and then yield to the event processing.
             // It will wake us up again immediately, but can handle a few
             // OS events (such as timers, network messages etc.) in the meantime.
-            bool do_wake_up;
-            {
-                spinlock_acq_t acq(&incoming_messages_lock_);
-                do_wake_up = !check_and_set_is_woken_up();
-            }
-            if (do_wake_up) {
+            // If new messages have come in, whoever sent the first of them has
+            // already woken us up.
+            if (incoming_messages_.load(std::memory_order_relaxed) == nullptr) {
                 event_.wakey_wakey();
             }
             break;
@@ -192,22 +208,22 @@ void linux_message_hub_t::on_event(int events) {
 }
 
 void linux_message_hub_t::sort_incoming_messages_by_priority() {
-    // We do this in two steps to release the spinlock faster.
-    // append_and_clear is a very cheap operation, while
-    // assigning each message to a different priority queue
-    // is more expensive.
-
-    // 1. Pull the messages
-    msg_list_t new_messages;
-    {
-        spinlock_acq_t acq(&incoming_messages_lock_);
-        new_messages.append_and_clear(&incoming_messages_);
-        is_woken_up_ = false;
+    // 1. Pull the messages.  They come newest first, so we reverse them to get
+    // each sender's messages back into the order they were sent in.
+    linux_thread_message_t *newest = incoming_messages_.exchange(
+        nullptr, std::memory_order_acquire);
+    linux_thread_message_t *oldest = nullptr;
+    while (newest != nullptr) {
+        linux_thread_message_t *next = newest->next_incoming_;
+        newest->next_incoming_ = oldest;
+        oldest = newest;
+        newest = next;
     }
 
     // 2. Sort the messages into their respective priority queues
-    while (linux_thread_message_t *m = new_messages.head()) {
-        new_messages.remove(m);
+    while (linux_thread_message_t *m = oldest) {
+        oldest = m->next_incoming_;
+        m->next_incoming_ = nullptr;
         int effective_priority = m->priority;
         if (m->is_ordered) {
             // Ordered messages are treated as if they had
@@ -221,12 +237,6 @@ void linux_message_hub_t::sort_incoming_messages_by_priority() {
     }
 }
 
-bool linux_message_hub_t::check_and_set_is_woken_up() {
-    const bool was_woken_up = is_woken_up_;
-    is_woken_up_ = true;
-    return was_woken_up;
-}
-
 // Pushes messages collected locally global lists available to all
 // threads.
 void linux_message_hub_t::push_messages() {
@@ -236,22 +246,13 @@ void linux_message_hub_t::push_messages() {
         thread_queue_t *queue = &queues_[i];
         if (!queue->msg_local_list.empty()) {
             // Transfer messages to the other core
+            linux_message_hub_t *target = &thread_pool_->threads[i]->message_hub;
 
-            bool do_wake_up;
-            {
-                spinlock_acq_t acq(&thread_pool_->threads[i]->message_hub.incoming_messages_lock_);
-
-                // We only need to do a wake up if we're the first people to do a
-                // wake up.
-                do_wake_up =
-                    !thread_pool_->threads[i]->message_hub.check_and_set_is_woken_up();
-
-                thread_pool_->threads[i]->message_hub.incoming_messages_.append_and_clear(&queue->msg_local_list);
-            }
-
-            // Wakey wakey, perhaps eggs and bakey
-            if (do_wake_up) {
-                thread_pool_->threads[i]->message_hub.event_.wakey_wakey();
+            // We only need to do a wake up if we're the first people to give it
+            // messages since it last looked.
+            if (target->push_incoming_messages(&queue->msg_local_list)) {
+                // Wakey wakey, perhaps eggs and bakey
+                target->event_.wakey_wakey();
             }
         }
     }
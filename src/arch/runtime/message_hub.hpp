@@ -4,10 +4,11 @@
 
 #include <pthread.h>
 
+#include <atomic>
+
 #include "arch/runtime/event_queue.hpp"
 #include "arch/runtime/runtime_utils.hpp"
 #include "arch/runtime/system_event.hpp"
-#include "arch/spinlock.hpp"
 #include "config/args.hpp"
 #include "containers/intrusive_list.hpp"
 #include "threading.hpp"
@@ -48,6 +49,11 @@ public:
     // (which does not have an event queue)
     void insert_external_message(linux_thread_message_t *msg);
 
+    // Whether other threads have sent us messages that we haven't looked at yet.
+    bool has_incoming_messages() const {
+        return incoming_messages_.load(std::memory_order_relaxed) != nullptr;
+    }
+
     ~linux_message_hub_t();
 
 private:
@@ -68,16 +74,20 @@ private:
     struct thread_queue_t {
         //TODO this doesn't need to be a class anymore
 
-        /* Messages are cached here before being pushed to the global list so that we don't
-        have to acquire the spinlock as often */
+        /* Messages are cached here before being pushed to the other thread's
+        incoming stack, so that we only need one atomic operation per batch */
         msg_list_t msg_local_list;
     } queues_[MAX_THREADS];
 
-    // Must only be used with acquired incoming_messages_lock_
-    bool check_and_set_is_woken_up();
-    bool is_woken_up_;
-    msg_list_t incoming_messages_;
-    spinlock_t incoming_messages_lock_;
+    // Moves all of `msgs` onto `incoming_messages_`, from any thread.  Returns true if
+    // the stack was empty, in which case the caller has to wake us up; otherwise
+    // whoever made it non-empty already did.
+    bool push_incoming_messages(msg_list_t *msgs);
+
+    // Messages sent to this thread, newest first, linked through their
+    // `next_incoming_` fields.  Other threads push whole batches onto it with a
+    // compare-and-swap, and our own thread takes everything at once.
+    std::atomic<linux_thread_message_t *> incoming_messages_;
 
     // Use `sort_incoming_messages_by_priority()` to sort incoming_messages_ into
     // these lists.
@@ -89,8 +99,8 @@ private:
 
     void on_event(int events);
 
-    // The eventfd (or pipe-based alternative) notified after the first incoming
-    // message is put onto incoming_messages_.
+    // The eventfd (or pipe-based alternative) notified when a message is put onto an
+    // empty incoming_messages_.
     system_event_t event_;
 
     /* The thread that we queue messages originating from. (Recall that there is one
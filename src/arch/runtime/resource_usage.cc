@@ -0,0 +1,26 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "arch/runtime/resource_usage.hpp"
+
+#include "arch/runtime/coroutines.hpp"
+
+resource_usage_t *current_resource_usage() {
+    coro_t *self = coro_t::self();
+    return self == nullptr ? nullptr : self->resource_usage_;
+}
+
+scoped_resource_usage_t::scoped_resource_usage_t(resource_usage_t *usage) {
+    coro_t *self = coro_t::self();
+    guarantee(self != nullptr);
+    // The time since the last resume belongs to the previous `resource_usage_t`.
+    self->charge_resource_usage_on_yield();
+    previous_usage = self->resource_usage_;
+    self->resource_usage_ = usage;
+    self->charge_resource_usage_on_resume();
+}
+
+scoped_resource_usage_t::~scoped_resource_usage_t() {
+    coro_t *self = coro_t::self();
+    self->charge_resource_usage_on_yield();
+    self->resource_usage_ = previous_usage;
+    self->charge_resource_usage_on_resume();
+}
@@ -0,0 +1,92 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef ARCH_RUNTIME_RESOURCE_USAGE_HPP_
+#define ARCH_RUNTIME_RESOURCE_USAGE_HPP_
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "errors.hpp"
+
+struct shard_usage_t;
+
+/* `resource_usage_t` counts what the coroutines it's attached to cost.  Queries use
+it to keep per-query accounting that's cheap enough to be always on; see
+`rdb_protocol/query_stats.hpp`.
+
+`run_nanos` is the time the coroutines spent running, i.e. not waiting.  Since our
+threads run one coroutine at a time, this is close to the CPU time they used.  The
+other fields are counted by the cache and the B-tree code.  Page loads are charged to
+the coroutine that triggered them, even though the disk read itself happens in a
+coroutine of its own.  The wait times only read the clock when the coroutine actually
+has to block. */
+struct resource_usage_t {
+    resource_usage_t()
+        : run_nanos(0), cache_hits(0), cache_misses(0), blocks_read(0),
+          rows_scanned(0), lock_wait_nanos(0), load_wait_nanos(0), primary_nanos(0),
+          shards(nullptr) { }
+
+    void add(const resource_usage_t &other) {
+        run_nanos += other.run_nanos;
+        cache_hits += other.cache_hits;
+        cache_misses += other.cache_misses;
+        blocks_read += other.blocks_read;
+        rows_scanned += other.rows_scanned;
+        lock_wait_nanos += other.lock_wait_nanos;
+        load_wait_nanos += other.load_wait_nanos;
+        primary_nanos += other.primary_nanos;
+    }
+
+    int64_t run_nanos;
+    uint64_t cache_hits;
+    uint64_t cache_misses;
+    uint64_t blocks_read;
+    uint64_t rows_scanned;
+    // The time spent waiting for block locks held by other transactions.
+    int64_t lock_wait_nanos;
+    // The time spent waiting for blocks to be loaded from disk.
+    int64_t load_wait_nanos;
+    // The wall-clock time primary replicas spent on the table reads and writes, from
+    // getting the request to sending the response.  Set by `primary_query_server_t`.
+    int64_t primary_nanos;
+
+    /* If this isn't `nullptr`, the table reads and writes that are charged to this
+    `resource_usage_t` append what each shard they went to cost to it.  The slow query
+    log and the query traces set it.  It isn't summed by `add()` and isn't serialized. */
+    std::vector<shard_usage_t> *shards;
+};
+
+/* What one shard of a table read or write cost, as seen by the server that sent it. */
+struct shard_usage_t {
+    // The shard's key range, as printed by `key_range_to_string()`.
+    std::string range;
+    // When the read or write was sent, from `get_ticks()`.
+    int64_t start_nanos;
+    // The time between starting to route the read or write and sending it.
+    int64_t route_nanos;
+    // The wall-clock time between sending the read or write and getting the response.
+    int64_t nanos;
+    // What the shard's primary replica was charged for it.
+    resource_usage_t usage;
+};
+
+/* Returns the `resource_usage_t` that the current coroutine is charged to, or
+`nullptr` if there is none (or if we aren't in a coroutine). */
+resource_usage_t *current_resource_usage();
+
+/* Charges the current coroutine to `usage` for the lifetime of the
+`scoped_resource_usage_t`, and then to whatever it was charged to before.  Coroutines
+that it spawns aren't charged to `usage`. */
+class scoped_resource_usage_t {
+public:
+    explicit scoped_resource_usage_t(resource_usage_t *usage);
+    ~scoped_resource_usage_t();
+
+private:
+    resource_usage_t *previous_usage;
+
+    DISABLE_COPYING(scoped_resource_usage_t);
+};
+
+#endif  // ARCH_RUNTIME_RESOURCE_USAGE_HPP_
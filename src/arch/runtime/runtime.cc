@@ -24,6 +24,11 @@ int get_num_threads() {
     return linux_thread_pool_t::get_thread_pool()->n_threads;
 }
 
+int get_thread_numa_node(threadnum_t thread) {
+    assert_good_thread_id(thread);
+    return linux_thread_pool_t::get_thread_pool()->thread_numa_nodes[thread.threadnum];
+}
+
 #ifndef NDEBUG
 void assert_good_thread_id(threadnum_t thread) {
     if (linux_thread_pool_t::get_thread_pool() == nullptr) {
@@ -71,8 +76,9 @@ private:
 };
 
 // Runs the action 'fun()' on thread zero.
-void run_in_thread_pool(const std::function<void()> &fun, int worker_threads) {
-    linux_thread_pool_t thread_pool(worker_threads, false);
+void run_in_thread_pool(const std::function<void()> &fun, int worker_threads,
+                        bool pin_threads) {
+    linux_thread_pool_t thread_pool(worker_threads, pin_threads);
     starter_t starter(&thread_pool, fun);
     thread_pool.run_thread_pool(&starter);
 }
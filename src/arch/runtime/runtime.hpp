@@ -11,6 +11,10 @@ threadnum_t get_thread_id();
 
 int get_num_threads();
 
+// Returns the NUMA node that `thread` runs on, or -1 if the thread isn't pinned to a
+// CPU.
+int get_thread_numa_node(threadnum_t thread);
+
 #ifndef NDEBUG
 bool in_thread_pool();
 void assert_good_thread_id(threadnum_t thread);
@@ -1,11 +1,16 @@
 // Copyright 2010-2012 RethinkDB, all rights reserved.
 #include "arch/runtime/runtime_utils.hpp"
 
+#include <stdio.h>
+#include <stdlib.h>
 #include <unistd.h>
 
+#include <set>
+
 #include "arch/runtime/context_switching.hpp"
 #include "arch/runtime/coroutines.hpp"
 #include "logger.hpp"
+#include "utils.hpp"
 
 int get_cpu_count() {
 #ifdef _WIN32
@@ -17,6 +22,87 @@ int get_cpu_count() {
 #endif
 }
 
+std::vector<int> parse_cpu_list(const std::string &list) {
+    std::vector<int> cpus;
+    const char *p = list.c_str();
+    while (*p != '\0' && *p != '\n') {
+        char *end;
+        const long first = strtol(p, &end, 10);
+        if (end == p || first < 0) {
+            return std::vector<int>();
+        }
+        long last = first;
+        p = end;
+        if (*p == '-') {
+            ++p;
+            last = strtol(p, &end, 10);
+            if (end == p || last < first) {
+                return std::vector<int>();
+            }
+            p = end;
+        }
+        for (long cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(cpu);
+        }
+        if (*p == ',') {
+            ++p;
+        } else if (*p != '\0' && *p != '\n') {
+            return std::vector<int>();
+        }
+    }
+    return cpus;
+}
+
+#ifdef __linux__
+namespace {
+
+// Returns an empty vector if the file can't be read or isn't a CPU list.
+std::vector<int> read_cpu_list_file(const std::string &path) {
+    FILE *file = fopen(path.c_str(), "r");
+    if (file == nullptr) {
+        return std::vector<int>();
+    }
+    char buf[4096];
+    const bool ok = fgets(buf, sizeof(buf), file) != nullptr;
+    fclose(file);
+    return ok ? parse_cpu_list(buf) : std::vector<int>();
+}
+
+}  // namespace
+#endif
+
+std::vector<cpu_placement_t> get_cpus_grouped_by_numa_node() {
+    std::set<int> online;
+#ifdef __linux__
+    for (int cpu : read_cpu_list_file("/sys/devices/system/cpu/online")) {
+        online.insert(cpu);
+    }
+#endif
+    if (online.empty()) {
+        for (int cpu = 0; cpu < get_cpu_count(); ++cpu) {
+            online.insert(cpu);
+        }
+    }
+
+    std::vector<cpu_placement_t> placements;
+#ifdef __linux__
+    // Node numbers can have gaps, so we don't stop at the first missing one.
+    const int MAX_NUMA_NODES = 1024;
+    for (int node = 0; node < MAX_NUMA_NODES && !online.empty(); ++node) {
+        for (int cpu : read_cpu_list_file(
+                 strprintf("/sys/devices/system/node/node%d/cpulist", node))) {
+            if (online.erase(cpu) == 1) {
+                placements.push_back(cpu_placement_t{cpu, node});
+            }
+        }
+    }
+#endif
+    for (int cpu : online) {
+        placements.push_back(cpu_placement_t{cpu, 0});
+    }
+    return placements;
+}
+
 callable_action_wrapper_t::callable_action_wrapper_t() :
     action_on_heap(false),
     action_(nullptr)
@@ -6,6 +6,9 @@
 #include <stdint.h>
 #include <unistd.h>
 
+#include <string>
+#include <vector>
+
 #include "config/args.hpp"
 #include "containers/intrusive_list.hpp"
 
@@ -47,14 +50,16 @@ class linux_thread_message_t : public intrusive_list_node_t<linux_thread_message
 public:
     explicit linux_thread_message_t(int _priority)
         : priority(_priority),
-        is_ordered(false)
+        is_ordered(false),
+        next_incoming_(nullptr)
 #ifndef NDEBUG
         , reloop_count_(0)
 #endif
         { }
     linux_thread_message_t()
         : priority(MESSAGE_SCHEDULER_DEFAULT_PRIORITY),
-        is_ordered(false)
+        is_ordered(false),
+        next_incoming_(nullptr)
 #ifndef NDEBUG
         , reloop_count_(0)
 #endif
@@ -69,6 +74,8 @@ private:
     friend class linux_message_hub_t;
     int priority;
     bool is_ordered; // Used internally by the message hub
+    // Links the message hub's lock-free stack of incoming messages.
+    linux_thread_message_t *next_incoming_;
 #ifndef NDEBUG
     int reloop_count_;
 #endif
@@ -78,6 +85,19 @@ typedef linux_thread_message_t thread_message_t;
 
 int get_cpu_count();
 
+struct cpu_placement_t {
+    int cpu;
+    int numa_node;
+};
+
+// Returns the online CPUs, with the CPUs of each NUMA node next to each other.  If
+// the system doesn't tell us its NUMA topology, all CPUs are on node 0.
+std::vector<cpu_placement_t> get_cpus_grouped_by_numa_node();
+
+// Parses a CPU list like "0-3,8,10-11", the format Linux uses in sysfs.  Returns an
+// empty vector if `list` isn't in that format.
+std::vector<int> parse_cpu_list(const std::string &list);
+
 // More pollution of runtime_utils.hpp.
 #ifndef NDEBUG
 
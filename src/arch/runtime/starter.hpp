@@ -8,8 +8,10 @@
 
 /* `run_in_thread_pool()` starts a RethinkDB thread pool, runs the given
 function in a coroutine inside of it, waits for the function to return, and then
-shuts down the thread pool. */
+shuts down the thread pool.  If `pin_threads` is set, each worker thread is pinned to
+a CPU. */
 
-void run_in_thread_pool(const std::function<void()> &fun, int worker_threads);
+void run_in_thread_pool(const std::function<void()> &fun, int worker_threads,
+                        bool pin_threads = false);
 
 #endif  // ARCH_RUNTIME_STARTER_HPP_
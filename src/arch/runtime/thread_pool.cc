@@ -6,6 +6,8 @@
 #include <string.h>
 #include <unistd.h>
 
+#include <vector>
+
 #ifndef _WIN32
 #include <sys/time.h>
 #endif
@@ -14,9 +16,11 @@
 #include "arch/barrier.hpp"
 #include "arch/os_signal.hpp"
 #include "arch/io/timer_provider.hpp"
+#include "arch/runtime/coroutines.hpp"
 #include "arch/runtime/event_queue.hpp"
 #include "arch/runtime/runtime.hpp"
 #include "arch/timing.hpp"
+#include "containers/shared_buffer.hpp"
 #include "errors.hpp"
 #include "logger.hpp"
 #include "utils.hpp"
@@ -71,6 +75,9 @@ linux_thread_pool_t::linux_thread_pool_t(int worker_threads, bool _do_set_affini
       n_threads(worker_threads + 1),    // we create an extra utility thread
       do_set_affinity(_do_set_affinity)
 {
+    for (int i = 0; i < MAX_THREADS; ++i) {
+        thread_numa_nodes[i] = NUMA_NODE_UNKNOWN;
+    }
     rassert(n_threads > 1);             // we want at least one non-utility thread
     rassert(n_threads <= MAX_THREADS);
 
@@ -134,6 +141,7 @@ void *linux_thread_pool_t::start_thread(void *arg) {
         linux_thread_t local_thread(tdata->thread_pool, tdata->current_thread);
         tdata->thread_pool->threads[tdata->current_thread] = &local_thread;
         set_thread(&local_thread);
+        coro_t::preallocate_coroutines(COROUTINE_PREALLOCATED_PER_THREAD);
         blocker_pool_t *generic_blocker_pool = nullptr; // Will only be instantiated by one thread
 
         /* Install a handler for segmentation faults that just prints a backtrace. If we're
@@ -199,6 +207,8 @@ void *linux_thread_pool_t::start_thread(void *arg) {
         set_thread(nullptr);
     }
 
+    shared_buf_t::free_thread_free_lists();
+
     delete tdata;
     return nullptr;
 }
@@ -215,6 +225,13 @@ void linux_thread_pool_t::run_thread_pool(linux_thread_message_t *initial_messag
     // Start child threads
     thread_barrier_t barrier(n_threads + 1);
 
+    // Consecutive threads go on CPUs of the same NUMA node, so the threads that a
+    // table gets from `thread_allocation_t` can share one.
+    std::vector<cpu_placement_t> cpus;
+    if (do_set_affinity) {
+        cpus = get_cpus_grouped_by_numa_node();
+    }
+
     for (int i = 0; i < n_threads; i++) {
         bool is_utility_thread = (i == n_threads - 1);
         thread_data_t *tdata = new thread_data_t();
@@ -232,12 +249,13 @@ void linux_thread_pool_t::run_thread_pool(linux_thread_message_t *initial_messag
             // On Apple, the thread affinity API has awful documentation, so we don't even bother.
 #ifdef _GNU_SOURCE
             // Distribute threads evenly among CPUs
-            int ncpus = get_cpu_count();
+            const cpu_placement_t &placement = cpus[i % cpus.size()];
             cpu_set_t mask;
             CPU_ZERO(&mask);
-            CPU_SET(i % ncpus, &mask);
+            CPU_SET(placement.cpu, &mask);
             res = pthread_setaffinity_np(pthreads[i], sizeof(cpu_set_t), &mask);
             guarantee_xerr(res == 0, res, "Could not set thread affinity");
+            thread_numa_nodes[i] = placement.numa_node;
 #endif
         }
     }
@@ -488,6 +506,10 @@ void linux_thread_t::pump() {
     message_hub.push_messages();
 }
 
+bool linux_thread_t::has_pending_messages() {
+    return message_hub.has_incoming_messages();
+}
+
 void linux_thread_t::on_event(int events) {
     // No-op. This is just to make sure that the event queue wakes up
     // so it can shut down.
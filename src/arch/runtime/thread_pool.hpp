@@ -14,6 +14,7 @@
 #include "arch/runtime/system_event.hpp"
 #include "arch/runtime/message_hub.hpp"
 #include "arch/runtime/coroutines.hpp"
+#include "arch/spinlock.hpp"
 #include "arch/io/blocker_pool.hpp"
 #include "arch/io/timer_provider.hpp"
 #include "arch/timer.hpp"
@@ -103,6 +104,11 @@ public:
     int n_threads;
     bool do_set_affinity;
 
+    static const int NUMA_NODE_UNKNOWN = -1;
+    // The NUMA node of the CPU each thread is pinned to.  Only known if
+    // `do_set_affinity` is set, and never for the utility thread.
+    int thread_numa_nodes[MAX_THREADS];
+
 #ifdef _WIN32
     static linux_thread_pool_t *get_global_thread_pool();
 #endif
@@ -190,6 +196,7 @@ public:
 
     void pump();   // Called by the event queue
     bool should_shut_down();   // Called by the event queue
+    bool has_pending_messages();   // Called by the event queue
 #ifndef NDEBUG
     void initiate_shut_down(std::map<std::string, size_t> *coroutine_counts); // Can be called from any thread
 #else
@@ -75,6 +75,7 @@ class linux_thread_pool_t;
 typedef linux_thread_pool_t thread_pool_t;
 
 class file_account_t;
+class perfmon_collection_t;
 
 class linux_iocallback_t;
 typedef linux_iocallback_t iocallback_t;
@@ -88,6 +89,9 @@ typedef linux_nonthrowing_tcp_listener_t non_throwing_tcp_listener_t;
 class linux_tcp_listener_t;
 typedef linux_tcp_listener_t tcp_listener_t;
 
+class linux_reuseport_tcp_listener_t;
+typedef linux_reuseport_tcp_listener_t reuseport_tcp_listener_t;
+
 class linux_repeated_nonthrowing_tcp_listener_t;
 typedef linux_repeated_nonthrowing_tcp_listener_t repeated_nonthrowing_tcp_listener_t;
 
@@ -105,8 +109,36 @@ enum class file_direct_io_mode_t {
     buffered_desired
 };
 
+// How the disk manager runs reads and writes.  `io_uring` falls back to `pool` if the
+// kernel doesn't support it.
+enum class io_backend_t {
+    pool,
+    io_uring
+};
+
 enum class datasync_op { no_datasyncs, wrap_in_datasyncs, datasync_after };
 
+/* How busy the I/O stack below a file is.  Every file opened with the same
+`io_backender_t` shares the stack, so this covers all of their requests. */
+struct file_load_t {
+    // Requests that have been submitted but haven't completed yet.
+    int64_t outstanding_requests;
+    // A moving average of how long requests took from submission to completion.
+    int64_t average_latency_nanos;
+};
+
+// The kinds of disk I/O that get their own deadline in the disk manager.  A request
+// that has waited longer than its class's deadline goes ahead of the others, no
+// matter what its account's priority is.
+enum class io_class_t {
+    foreground_read,
+    foreground_write,
+    gc,
+    backfill,
+    sindex_post_construction,
+    cache_warm_up
+};
+
 // A linux file.  It expects reads and writes and buffers to have an
 // alignment of DEVICE_BLOCK_SIZE.
 class file_t {
@@ -127,18 +159,35 @@ public:
     virtual void writev_async(int64_t offset, size_t length, scoped_array_t<iovec> &&bufs,
                               file_account_t *account, linux_iocallback_t *cb) = 0;
 
-    virtual void *create_account(int priority, int outstanding_requests_limit) = 0;
+    // Blocks the calling coroutine until the writes to the file that have completed
+    // are durable.
+    virtual void co_datasync() = 0;
+
+    virtual void *create_account(io_class_t io_class, int priority,
+                                 int outstanding_requests_limit) = 0;
     virtual void destroy_account(void *account) = 0;
 
     virtual bool coop_lock_and_check() = 0;
 
+    // Can be called from any thread.
+    virtual file_load_t get_load() = 0;
+
+    // Puts stats about the devices the file is on into `collection`, for as long as
+    // the file exists.  Files on a single device have none of their own.
+    virtual void add_device_stats(UNUSED perfmon_collection_t *collection) { }
+
+    // The file on slower storage that a tiered file (see `tiered_file_t`) puts the
+    // offsets from its cold offset on, or null if the file isn't tiered.
+    virtual file_t *cold_tier() { return nullptr; }
+
 private:
     DISABLE_COPYING(file_t);
 };
 
 class file_account_t {
 public:
-    file_account_t(file_t *f, int p, int outstanding_requests_limit = UNLIMITED_OUTSTANDING_REQUESTS);
+    file_account_t(file_t *f, io_class_t io_class, int p,
+                   int outstanding_requests_limit = UNLIMITED_OUTSTANDING_REQUESTS);
     ~file_account_t();
     void *get_account() { return account; }
 
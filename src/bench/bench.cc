@@ -0,0 +1,256 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "bench/bench.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+
+#include "arch/runtime/thread_pool.hpp"
+#include "concurrency/pmap.hpp"
+#include "perfmon/perfmon.hpp"
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
+#include "time.hpp"
+#include "utils.hpp"
+
+namespace bench {
+
+namespace {
+
+std::map<std::string, benchmark_fun_t> *benchmarks() {
+    // Not a global, since the registrations run before the globals of this file may
+    // have been constructed.
+    static std::map<std::string, benchmark_fun_t> map;
+    return &map;
+}
+
+}  // namespace
+
+/* Counts hardware events with `perf_event_open()` on every thread of the pool, so that
+work that hops to other threads is counted too.  Only the user-space part of each
+thread is counted, which unprivileged processes are usually allowed to. */
+class perf_counters_t {
+public:
+    static const int num_events = 3;
+
+    // The names of the metrics, per op, of each event.
+    static const char *metric_name(int event) {
+        static const char *names[num_events] =
+            {"cycles_per_op", "instructions_per_op", "cache_misses_per_op"};
+        return names[event];
+    }
+
+    // Must be called in a coroutine.
+    perf_counters_t() : fds_(get_num_threads() * num_events, -1) {
+#ifdef __linux__
+        const uint64_t configs[num_events] = {PERF_COUNT_HW_CPU_CYCLES,
+                                              PERF_COUNT_HW_INSTRUCTIONS,
+                                              PERF_COUNT_HW_CACHE_MISSES};
+        pmap(get_num_threads(), [&](int thread) {
+            on_thread_t thread_switcher((threadnum_t(thread)));
+            for (int event = 0; event < num_events; ++event) {
+                struct perf_event_attr attr;
+                memset(&attr, 0, sizeof(attr));
+                attr.size = sizeof(attr);
+                attr.type = PERF_TYPE_HARDWARE;
+                attr.config = configs[event];
+                attr.disabled = 1;
+                attr.exclude_kernel = 1;
+                attr.exclude_hv = 1;
+                // Counts the calling thread on whatever CPU it runs.
+                fds_[thread * num_events + event] =
+                    syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+            }
+        });
+#endif
+    }
+
+    ~perf_counters_t() {
+        for (int fd : fds_) {
+            if (fd != -1) {
+                close(fd);
+            }
+        }
+    }
+
+    bool ok() const {
+        return std::find(fds_.begin(), fds_.end(), -1) == fds_.end();
+    }
+
+    void start() {
+#ifdef __linux__
+        for (int fd : fds_) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    // Stops counting and returns the totals of each event over all threads.
+    std::vector<int64_t> stop() {
+        std::vector<int64_t> totals(num_events, 0);
+#ifdef __linux__
+        for (size_t i = 0; i < fds_.size(); ++i) {
+            ioctl(fds_[i], PERF_EVENT_IOC_DISABLE, 0);
+            uint64_t value;
+            if (read(fds_[i], &value, sizeof(value)) == sizeof(value)) {
+                totals[i % num_events] += value;
+            }
+        }
+#endif
+        return totals;
+    }
+
+private:
+    std::vector<int> fds_;
+
+    DISABLE_COPYING(perf_counters_t);
+};
+
+reporter_t::reporter_t(const options_t *options, std::vector<result_t> *results)
+    : options_(options), results_(results) { }
+
+reporter_t::~reporter_t() { }
+
+int64_t reporter_t::scaled(int64_t ops) const {
+    return std::max<int64_t>(1, static_cast<int64_t>(ops * options_->scale));
+}
+
+void reporter_t::measure(const std::string &name,
+                         const std::map<std::string, int64_t> &params,
+                         int64_t ops,
+                         const std::function<void(int64_t)> &op) {
+    if (options_->perf_counters && !perf_counters_.has()) {
+        perf_counters_.init(new perf_counters_t());
+        if (!perf_counters_->ok()) {
+            fprintf(stderr, "Hardware counters aren't available, so they won't be "
+                    "reported (see /proc/sys/kernel/perf_event_paranoid).\n");
+        }
+    }
+    const bool count = perf_counters_.has() && perf_counters_->ok();
+    if (count) {
+        perf_counters_->start();
+    }
+    const ticks_t start = get_ticks();
+    for (int64_t i = 0; i < ops; ++i) {
+        op(i);
+    }
+    const ticks_t end = get_ticks();
+    std::vector<int64_t> counts;
+    if (count) {
+        counts = perf_counters_->stop();
+    }
+
+    result_t result;
+    result.benchmark = benchmark_;
+    result.name = name;
+    result.params = params;
+    result.ops = ops;
+    result.nanos = end.nanos - start.nanos;
+    fprintf(stderr, "%s/%s: %" PRIi64 " ops in %.3f s\n",
+            benchmark_.c_str(), name.c_str(), ops, result.nanos / 1e9);
+    for (size_t event = 0; event < counts.size(); ++event) {
+        result.metrics[perf_counters_t::metric_name(event)] =
+            static_cast<double>(counts[event]) / ops;
+    }
+    results_->push_back(std::move(result));
+}
+
+void reporter_t::add_metric(const std::string &key, double value) {
+    guarantee(!results_->empty());
+    results_->back().metrics[key] = value;
+}
+
+registration_t::registration_t(const char *name, benchmark_fun_t fun) {
+    auto res = benchmarks()->insert(std::make_pair(std::string(name), fun));
+    guarantee(res.second, "Benchmark `%s` registered twice.", name);
+}
+
+const std::map<std::string, benchmark_fun_t> &registered_benchmarks() {
+    return *benchmarks();
+}
+
+void run_benchmark(const std::string &name, reporter_t *reporter) {
+    auto it = benchmarks()->find(name);
+    guarantee(it != benchmarks()->end());
+    reporter->benchmark_ = name;
+    it->second(reporter);
+}
+
+ql::datum_t get_stats(perfmon_collection_t *collection) {
+    void *ctx = collection->begin_stats();
+    collection->visit_stats(ctx);
+    return collection->end_stats(ctx);
+}
+
+void print_results(const std::vector<result_t> &results) {
+    rapidjson::StringBuffer buffer;
+    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+    writer.StartObject();
+    writer.Key("version");
+    writer.String(RETHINKDB_VERSION);
+    writer.Key("results");
+    writer.StartArray();
+    for (const result_t &result : results) {
+        writer.StartObject();
+        writer.Key("benchmark");
+        writer.String(result.benchmark.c_str());
+        writer.Key("name");
+        writer.String(result.name.c_str());
+        writer.Key("params");
+        writer.StartObject();
+        for (const auto &pair : result.params) {
+            writer.Key(pair.first.c_str());
+            writer.Int64(pair.second);
+        }
+        writer.EndObject();
+        writer.Key("ops");
+        writer.Int64(result.ops);
+        writer.Key("nanos");
+        writer.Int64(result.nanos);
+        writer.Key("nanos_per_op");
+        writer.Double(static_cast<double>(result.nanos) / result.ops);
+        writer.Key("ops_per_sec");
+        writer.Double(result.nanos == 0 ? 0.0 : result.ops * 1e9 / result.nanos);
+        writer.Key("metrics");
+        writer.StartObject();
+        for (const auto &pair : result.metrics) {
+            writer.Key(pair.first.c_str());
+            writer.Double(pair.second);
+        }
+        writer.EndObject();
+        writer.EndObject();
+    }
+    writer.EndArray();
+    writer.EndObject();
+    printf("%s\n", buffer.GetString());
+}
+
+temp_directory_t::temp_directory_t(const std::string &parent) : next_file_(0) {
+    std::string tmpl = parent + PATH_SEPARATOR "rethinkdb-bench.XXXXXX";
+    std::vector<char> buf(tmpl.begin(), tmpl.end());
+    buf.push_back('\0');
+    const char *res = mkdtemp(buf.data());
+    guarantee_err(res != nullptr, "Couldn't create a temporary directory in `%s`",
+                  parent.c_str());
+    path_ = base_path_t(std::string(res));
+    recreate_temporary_directory(path_);
+}
+
+temp_directory_t::~temp_directory_t() {
+    remove_directory_recursive(path_.path().c_str());
+}
+
+serializer_filepath_t temp_directory_t::new_file() {
+    return serializer_filepath_t(path_, strprintf("bench_%d.file", next_file_++));
+}
+
+}  // namespace bench
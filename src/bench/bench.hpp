@@ -0,0 +1,133 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef BENCH_BENCH_HPP_
+#define BENCH_BENCH_HPP_
+
+#include <stdint.h>
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "containers/scoped.hpp"
+#include "errors.hpp"
+#include "paths.hpp"
+#include "perfmon/types.hpp"
+
+namespace ql { class datum_t; }
+
+/* Microbenchmarks of the storage engine and the datum code, linked into the
+`rethinkdb-bench` binary.  Each benchmark is a function that sets up what it needs and
+then times one or more loops of operations through `reporter_t::measure()`.  The
+timings of all of them are printed as JSON when the binary exits. */
+
+namespace bench {
+
+struct options_t {
+    options_t() : scale(1.0), temp_dir("."), perf_counters(false) { }
+
+    // Multiplies the number of operations each loop runs.
+    double scale;
+    // Where benchmarks that need files create them.
+    std::string temp_dir;
+    // A trace recorded with the server's `--cache-trace` option, for the
+    // `cache_trace` benchmark.
+    std::string cache_trace;
+    // Whether to count CPU cycles, instructions and cache misses in each loop.
+    bool perf_counters;
+};
+
+/* The timing of one loop, along with the parameters it ran with. */
+struct result_t {
+    std::string benchmark;
+    std::string name;
+    std::map<std::string, int64_t> params;
+    int64_t ops;
+    int64_t nanos;
+    // Whatever else the benchmark computed about the loop.
+    std::map<std::string, double> metrics;
+};
+
+class perf_counters_t;
+
+class reporter_t {
+public:
+    reporter_t(const options_t *options, std::vector<result_t> *results);
+    ~reporter_t();
+
+    const options_t &options() const { return *options_; }
+
+    // `ops` multiplied by the `--scale` option, but at least 1.
+    int64_t scaled(int64_t ops) const;
+
+    // Calls `op(0)`, ..., `op(ops - 1)` and records how long that took.  With the
+    // `--perf-counters` option, also records the hardware counters of all the threads
+    // per op as metrics.
+    void measure(const std::string &name,
+                 const std::map<std::string, int64_t> &params,
+                 int64_t ops,
+                 const std::function<void(int64_t)> &op);
+
+    // Adds a value to the results of the last `measure()` call.
+    void add_metric(const std::string &key, double value);
+
+private:
+    friend void run_benchmark(const std::string &, reporter_t *);
+
+    const options_t *options_;
+    std::vector<result_t> *results_;
+    std::string benchmark_;
+    // Opened by the first `measure()` call, if `options_->perf_counters` is set.
+    scoped_ptr_t<perf_counters_t> perf_counters_;
+
+    DISABLE_COPYING(reporter_t);
+};
+
+typedef void (*benchmark_fun_t)(reporter_t *reporter);
+
+/* Registers a benchmark when the binary starts; use `BENCHMARK()` instead. */
+class registration_t {
+public:
+    registration_t(const char *name, benchmark_fun_t fun);
+};
+
+// The registered benchmarks by name.
+const std::map<std::string, benchmark_fun_t> &registered_benchmarks();
+
+// Runs the benchmark called `name`, whose results go to `reporter`.  Must be called
+// in a coroutine.
+void run_benchmark(const std::string &name, reporter_t *reporter);
+
+// The current values of the stats in `collection`.
+ql::datum_t get_stats(perfmon_collection_t *collection);
+
+// Prints `results` to stdout as a JSON object.
+void print_results(const std::vector<result_t> &results);
+
+/* A directory that is removed along with everything in it when this is destroyed.
+It is set up like a server's data directory, so stores can be created in it. */
+class temp_directory_t {
+public:
+    explicit temp_directory_t(const std::string &parent);
+    ~temp_directory_t();
+
+    const base_path_t &path() const { return path_; }
+
+    // The name of a new serializer file in the directory.
+    serializer_filepath_t new_file();
+
+private:
+    base_path_t path_;
+    int next_file_;
+
+    DISABLE_COPYING(temp_directory_t);
+};
+
+}  // namespace bench
+
+#define BENCHMARK(name)                                                              \
+    static void bench_##name(bench::reporter_t *reporter);                           \
+    static bench::registration_t bench_registration_##name(#name, &bench_##name);     \
+    static void bench_##name(bench::reporter_t *reporter)
+
+#endif  // BENCH_BENCH_HPP_
@@ -0,0 +1,152 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include <algorithm>
+
+#include "arch/io/disk.hpp"
+#include "bench/bench.hpp"
+#include "btree/operations.hpp"
+#include "btree/reql_specific.hpp"
+#include "buffer_cache/cache_balancer.hpp"
+#include "containers/uuid.hpp"
+#include "random.hpp"
+#include "rdb_protocol/btree.hpp"
+#include "rdb_protocol/env.hpp"
+#include "rdb_protocol/protocol.hpp"
+#include "rdb_protocol/store.hpp"
+#include "serializer/log/log_serializer.hpp"
+
+namespace bench {
+
+namespace {
+
+store_key_t row_key(int64_t i) {
+    return store_key_t(ql::datum_t(static_cast<double>(i)).print_primary());
+}
+
+ql::datum_t make_row(int64_t i, int64_t value_size) {
+    ql::datum_object_builder_t builder;
+    builder.overwrite("id", ql::datum_t(static_cast<double>(i)));
+    builder.overwrite("value",
+                      ql::datum_t(datum_string_t(std::string(value_size, 'x'))));
+    return std::move(builder).to_datum();
+}
+
+void set_row(store_t *store, int64_t i, int64_t value_size) {
+    cond_t non_interruptor;
+    scoped_ptr_t<txn_t> txn;
+    {
+        scoped_ptr_t<real_superblock_t> superblock;
+        write_token_t token;
+        store->new_write_token(&token);
+        store->acquire_superblock_for_write(
+            1, write_durability_t::SOFT, &token, &txn, &superblock, &non_interruptor);
+
+        // The store has no secondary indexes, so the modification report isn't used.
+        const store_key_t key = row_key(i);
+        point_write_response_t response;
+        rdb_modification_report_t mod_report(key);
+        rdb_live_deletion_context_t deletion_context;
+        rdb_set(key, make_row(i, value_size), true, store->btree.get(),
+                repli_timestamp_t::distant_past, superblock.get(), &deletion_context,
+                &response, &mod_report.info, nullptr);
+    }
+    txn->commit();
+}
+
+void get_row(store_t *store, int64_t i) {
+    cond_t non_interruptor;
+    read_token_t token;
+    store->new_read_token(&token);
+    scoped_ptr_t<txn_t> txn;
+    scoped_ptr_t<real_superblock_t> superblock;
+    store->acquire_superblock_for_read(
+        &token, &txn, &superblock, &non_interruptor, false);
+
+    point_read_response_t response;
+    rdb_get(row_key(i), store->btree.get(), superblock.get(), &response, nullptr);
+    guarantee(response.data.has());
+}
+
+void scan_rows(store_t *store, int64_t first, int64_t count) {
+    cond_t non_interruptor;
+    read_token_t token;
+    store->new_read_token(&token);
+    scoped_ptr_t<txn_t> txn;
+    scoped_ptr_t<real_superblock_t> superblock;
+    store->acquire_superblock_for_read(
+        &token, &txn, &superblock, &non_interruptor, true);
+
+    ql::env_t env(&non_interruptor,
+                  ql::return_empty_normal_batches_t::NO,
+                  reql_version_t::LATEST);
+    rget_read_response_t response;
+    rdb_rget_slice(
+        store->btree.get(),
+        region_t::universe(),
+        key_range_t(key_range_t::closed, row_key(first),
+                    key_range_t::open, row_key(first + count)),
+        r_nullopt,
+        superblock.get(),
+        &env,
+        ql::batchspec_t::all(),
+        std::vector<ql::transform_variant_t>(),
+        r_nullopt,
+        sorting_t::ASCENDING,
+        &response,
+        release_superblock_t::RELEASE);
+    guarantee(boost::get<ql::exc_t>(&response.result) == nullptr);
+}
+
+}  // namespace
+
+/* Point writes, point reads and range scans through `rdb_set()`, `rdb_get()` and
+`rdb_rget_slice()` on a store whose cache is large enough to hold all of it, so that
+these measure the B-tree code rather than the disk. */
+BENCHMARK(btree) {
+    temp_directory_t dir(reporter->options().temp_dir);
+    io_backender_t io_backender(file_direct_io_mode_t::buffered_desired);
+    dummy_cache_balancer_t balancer(GIGABYTE);
+
+    const int64_t rows = reporter->scaled(100000);
+    for (int64_t value_size : {16, 512}) {
+        filepath_file_opener_t file_opener(dir.new_file(), &io_backender);
+        log_serializer_t::create(&file_opener, log_serializer_t::static_config_t());
+        log_serializer_t serializer(log_serializer_t::dynamic_config_t(),
+                                    &file_opener,
+                                    &get_global_perfmon_collection());
+        store_t store(region_t::universe(),
+                      &serializer,
+                      &balancer,
+                      "bench_store",
+                      true,
+                      &get_global_perfmon_collection(),
+                      nullptr,
+                      &io_backender,
+                      dir.path(),
+                      generate_uuid(),
+                      update_sindexes_t::UPDATE,
+                      which_cpu_shard_t{0, 1});
+
+        const std::map<std::string, int64_t> params{
+            {"rows", rows}, {"value_size", value_size}};
+        rng_t rng(0);
+        reporter->measure("insert", params, rows, [&](int64_t i) {
+            set_row(&store, i, value_size);
+        });
+        reporter->measure("overwrite", params, rows, [&](int64_t) {
+            set_row(&store, rng.randuint64(rows), value_size);
+        });
+        reporter->measure("point_get", params, rows, [&](int64_t) {
+            get_row(&store, rng.randuint64(rows));
+        });
+        for (int64_t span : {10, 1000}) {
+            std::map<std::string, int64_t> scan_params = params;
+            scan_params["span"] = span;
+            const int64_t scans = reporter->scaled(1000000 / span);
+            reporter->measure("range_scan", scan_params, scans, [&](int64_t) {
+                scan_rows(&store, rng.randuint64(rows - std::min(rows, span) + 1), span);
+            });
+        }
+    }
+}
+
+}  // namespace bench
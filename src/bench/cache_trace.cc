@@ -0,0 +1,195 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include <stdio.h>
+
+#include <algorithm>
+#include <map>
+#include <utility>
+
+#include "arch/io/disk.hpp"
+#include "bench/bench.hpp"
+#include "buffer_cache/alt.hpp"
+#include "buffer_cache/block_trace.hpp"
+#include "buffer_cache/cache_balancer.hpp"
+#include "perfmon/perfmon.hpp"
+#include "serializer/log/log_serializer.hpp"
+
+namespace bench {
+
+namespace {
+
+/* What an access costs in the modeled latency: a hit copies a page in memory, a miss
+is a random read from an SSD. */
+const int64_t CACHE_TRACE_MODELED_HIT_NANOS = 1 * THOUSAND;
+const int64_t CACHE_TRACE_MODELED_MISS_NANOS = 100 * THOUSAND;
+
+/* The trace, with the blocks of all the page caches it saw renumbered to the blocks
+of the one cache it is replayed on. */
+struct replay_trace_t {
+    std::vector<block_id_t> block_ids;
+    std::vector<block_trace_access_t> accesses;
+    // Whether each block has to exist before the replay, because it wasn't created
+    // by its first access.
+    std::vector<bool> preexisting;
+};
+
+void load_trace(const std::vector<block_trace_record_t> &records,
+                replay_trace_t *trace_out) {
+    std::map<std::pair<uint32_t, block_id_t>, block_id_t> block_ids;
+    for (const block_trace_record_t &record : records) {
+        auto res = block_ids.insert(std::make_pair(
+            std::make_pair(record.cache, record.block_id), block_ids.size()));
+        if (res.second) {
+            trace_out->preexisting.push_back(
+                record.access != block_trace_access_t::CREATE);
+        }
+        trace_out->block_ids.push_back(res.first->second);
+        trace_out->accesses.push_back(record.access);
+    }
+}
+
+void create_blocks(cache_conn_t *cache_conn, const std::vector<bool> &preexisting) {
+    const block_id_t blocks_per_txn = 100;
+    for (block_id_t first = 0; first < preexisting.size(); first += blocks_per_txn) {
+        txn_t txn(cache_conn, write_durability_t::SOFT, blocks_per_txn);
+        const block_id_t end = std::min<block_id_t>(first + blocks_per_txn,
+                                                    preexisting.size());
+        for (block_id_t block_id = first; block_id < end; ++block_id) {
+            if (preexisting[block_id]) {
+                buf_lock_t lock(&txn, block_id, alt_create_t::create);
+                buf_write_t write(&lock);
+                write.get_data_write();
+            }
+        }
+        txn.commit();
+    }
+}
+
+void replay_access(cache_t *cache,
+                   cache_conn_t *cache_conn,
+                   block_id_t block_id,
+                   block_trace_access_t access,
+                   std::vector<bool> *exists) {
+    switch (access) {
+    case block_trace_access_t::READ: // fallthru
+    case block_trace_access_t::SCAN_READ: // fallthru
+    case block_trace_access_t::BYPASS_READ: {
+        if (!(*exists)[block_id]) {
+            // The block was deleted before the trace started, or its creation
+            // wasn't recorded.
+            return;
+        }
+        txn_t txn(cache_conn, read_access_t::read);
+        cache_account_t account;
+        if (access == block_trace_access_t::SCAN_READ) {
+            txn.set_scanning(true);
+        } else if (access == block_trace_access_t::BYPASS_READ) {
+            account = cache->create_cache_account(CACHE_READS_IO_PRIORITY,
+                                                  cache_access_pattern_t::BYPASS);
+            txn.set_account(&account);
+        }
+        buf_lock_t lock(buf_parent_t(&txn), block_id, access_t::read);
+        buf_read_t read(&lock);
+        read.get_data_read();
+    } break;
+    case block_trace_access_t::WRITE: // fallthru
+    case block_trace_access_t::CREATE: {
+        txn_t txn(cache_conn, write_durability_t::SOFT, 1);
+        {
+            buf_lock_t lock = (*exists)[block_id]
+                ? buf_lock_t(buf_parent_t(&txn), block_id, access_t::write)
+                : buf_lock_t(&txn, block_id, alt_create_t::create);
+            (*exists)[block_id] = true;
+            buf_write_t write(&lock);
+            write.get_data_write();
+        }
+        txn.commit();
+    } break;
+    default:
+        unreachable();
+    }
+}
+
+// The `misses_total` stat of the cache whose stats are in `stats`.
+int64_t cache_misses(perfmon_collection_t *stats) {
+    return get_stats(stats).get_field("cache").get_field("misses_total").as_int();
+}
+
+}  // namespace
+
+/* Replays a trace of block accesses recorded with the server's `--cache-trace`
+option on caches that hold different fractions of the blocks in the trace, under
+each eviction policy, and reports the hit rates and a modeled latency.  The blocks of
+all the tables in the trace share one cache, as the tables of a server share its
+cache memory.  Skipped unless `--cache-trace` is given. */
+BENCHMARK(cache_trace) {
+    if (reporter->options().cache_trace.empty()) {
+        return;
+    }
+    std::vector<block_trace_record_t> records;
+    if (!block_trace_t::read(reporter->options().cache_trace, &records)) {
+        fprintf(stderr, "Could not read the cache trace `%s`.\n",
+                reporter->options().cache_trace.c_str());
+        return;
+    }
+    replay_trace_t trace;
+    load_trace(records, &trace);
+    if (trace.block_ids.empty()) {
+        return;
+    }
+
+    temp_directory_t dir(reporter->options().temp_dir);
+    io_backender_t io_backender(file_direct_io_mode_t::buffered_desired);
+    const std::vector<std::pair<std::string, eviction_policy_t> > policies{
+        {"sampled_lru", eviction_policy_t::SAMPLED_LRU},
+        {"scan_resistant", eviction_policy_t::SCAN_RESISTANT}};
+    for (const auto &policy : policies) {
+        for (int64_t cache_percent : {5, 10, 25, 50, 100}) {
+            // Every replay starts from the same blocks on disk.
+            filepath_file_opener_t file_opener(dir.new_file(), &io_backender);
+            log_serializer_t::create(&file_opener,
+                                     log_serializer_t::static_config_t());
+            log_serializer_t serializer(log_serializer_t::dynamic_config_t(),
+                                        &file_opener,
+                                        &get_global_perfmon_collection());
+            {
+                dummy_cache_balancer_t balancer(GIGABYTE);
+                perfmon_collection_t stats;
+                cache_t cache(&serializer, &balancer, &stats, which_cpu_shard_t{0, 1});
+                cache_conn_t cache_conn(&cache);
+                create_blocks(&cache_conn, trace.preexisting);
+            }
+
+            const int64_t cache_bytes = std::max<int64_t>(
+                1, trace.preexisting.size() * cache_percent / 100
+                   * serializer.max_block_size().value());
+            dummy_cache_balancer_t balancer(cache_bytes, policy.second);
+            perfmon_collection_t stats;
+            cache_t cache(&serializer, &balancer, &stats, which_cpu_shard_t{0, 1});
+            cache_conn_t cache_conn(&cache);
+            std::vector<bool> exists = trace.preexisting;
+
+            const int64_t accesses = trace.block_ids.size();
+            const std::map<std::string, int64_t> params{
+                {"accesses", accesses},
+                {"blocks", static_cast<int64_t>(trace.preexisting.size())},
+                {"cache_percent", cache_percent},
+                {"cache_bytes", cache_bytes}};
+            reporter->measure(policy.first, params, accesses, [&](int64_t i) {
+                replay_access(&cache, &cache_conn, trace.block_ids[i],
+                              trace.accesses[i], &exists);
+            });
+
+            const int64_t misses = std::min(cache_misses(&stats), accesses);
+            reporter->add_metric("misses", misses);
+            reporter->add_metric("hit_rate",
+                                 static_cast<double>(accesses - misses) / accesses);
+            reporter->add_metric(
+                "modeled_nanos_per_access",
+                static_cast<double>((accesses - misses) * CACHE_TRACE_MODELED_HIT_NANOS
+                                    + misses * CACHE_TRACE_MODELED_MISS_NANOS)
+                / accesses);
+        }
+    }
+}
+
+}  // namespace bench
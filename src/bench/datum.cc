@@ -0,0 +1,371 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include <math.h>
+
+#include <algorithm>
+#include <utility>
+
+#include "bench/bench.hpp"
+#include "btree/keys.hpp"
+#include "containers/archive/buffer_stream.hpp"
+#include "containers/archive/vector_stream.hpp"
+#include "rapidjson/document.h"
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
+#include "random.hpp"
+#include "rdb_protocol/datum.hpp"
+#include "rdb_protocol/datum_allocations.hpp"
+#include "rdb_protocol/datum_json.hpp"
+#include "rdb_protocol/geo/geojson.hpp"
+#include "rdb_protocol/serialize_datum.hpp"
+
+namespace bench {
+
+namespace {
+
+// An object with `fields` fields of each of the common types, and an array of
+// `fields` numbers.
+ql::datum_t make_document(int fields) {
+    ql::configured_limits_t limits;
+    ql::datum_object_builder_t builder;
+    ql::datum_array_builder_t array(limits);
+    for (int i = 0; i < fields; ++i) {
+        builder.overwrite(strprintf("number_%d", i).c_str(),
+                          ql::datum_t(static_cast<double>(i)));
+        builder.overwrite(strprintf("string_%d", i).c_str(),
+                          ql::datum_t(datum_string_t(strprintf("value %d", i))));
+        builder.overwrite(strprintf("bool_%d", i).c_str(),
+                          ql::datum_t::boolean(i % 2 == 0));
+        array.add(ql::datum_t(static_cast<double>(i)));
+    }
+    builder.overwrite("array", std::move(array).to_datum());
+    return std::move(builder).to_datum();
+}
+
+std::vector<char> serialize_document(const ql::datum_t &document) {
+    write_message_t wm;
+    ql::datum_serialize(&wm, document, ql::check_datum_serialization_errors_t::NO);
+    vector_stream_t stream;
+    int res = send_write_message(&stream, &wm);
+    guarantee(res == 0);
+    return stream.vector();
+}
+
+std::string random_string(rng_t *rng, size_t length) {
+    std::string str;
+    for (size_t i = 0; i < length; ++i) {
+        str += static_cast<char>('a' + rng->randint(26));
+    }
+    return str;
+}
+
+ql::datum_t string_datum(std::string str) {
+    return ql::datum_t(datum_string_t(std::move(str)));
+}
+
+ql::datum_t binary_datum(rng_t *rng, size_t length) {
+    std::string data;
+    for (size_t i = 0; i < length; ++i) {
+        data += static_cast<char>(rng->randint(256));
+    }
+    return ql::datum_t::binary(datum_string_t(std::move(data)));
+}
+
+/* A document shape of the corpus.  Every document has an `id` for `print_primary()`
+and a `key` field for `print_secondary()`. */
+struct document_shape_t {
+    const char *name;
+    ql::datum_t (*make)(rng_t *rng);
+};
+
+// A user record, the most common shape there is.
+ql::datum_t make_flat_small(rng_t *rng) {
+    ql::datum_object_builder_t builder;
+    builder.overwrite("id", string_datum(random_string(rng, 36)));
+    builder.overwrite("name", string_datum(random_string(rng, 12)));
+    builder.overwrite("age", ql::datum_t(static_cast<double>(rng->randint(100))));
+    builder.overwrite("active", ql::datum_t::boolean(rng->randint(2) == 0));
+    builder.overwrite("score", ql::datum_t(rng->randdouble() * 1000));
+    builder.overwrite("country", string_datum("de"));
+    builder.overwrite("key", string_datum(random_string(rng, 20) + "@example.com"));
+    return std::move(builder).to_datum();
+}
+
+// Hundreds of short fields, like a denormalized analytics event.
+ql::datum_t make_wide(rng_t *rng) {
+    ql::datum_object_builder_t builder;
+    builder.overwrite("id", string_datum(random_string(rng, 36)));
+    for (int i = 0; i < 300; ++i) {
+        const std::string field = strprintf("attribute_%d", i);
+        switch (i % 3) {
+        case 0:
+            builder.overwrite(field.c_str(),
+                              ql::datum_t(static_cast<double>(rng->randint(10000))));
+            break;
+        case 1:
+            builder.overwrite(field.c_str(), string_datum(random_string(rng, 8)));
+            break;
+        default:
+            builder.overwrite(field.c_str(), ql::datum_t::boolean(i % 2 == 0));
+            break;
+        }
+    }
+    builder.overwrite("key", ql::datum_t(static_cast<double>(rng->randint(10000))));
+    return std::move(builder).to_datum();
+}
+
+// Objects and arrays sixteen levels deep, like a configuration tree.
+ql::datum_t make_deeply_nested(rng_t *rng) {
+    ql::configured_limits_t limits;
+    ql::datum_t child = ql::datum_t::null();
+    for (int depth = 0; depth < 16; ++depth) {
+        ql::datum_object_builder_t level;
+        level.overwrite("depth", ql::datum_t(static_cast<double>(depth)));
+        level.overwrite("label", string_datum(random_string(rng, 10)));
+        ql::datum_array_builder_t siblings(limits);
+        for (int i = 0; i < 3; ++i) {
+            siblings.add(ql::datum_t(static_cast<double>(rng->randint(100))));
+        }
+        level.overwrite("siblings", std::move(siblings).to_datum());
+        level.overwrite("child", child);
+        child = std::move(level).to_datum();
+    }
+    ql::datum_array_builder_t path(limits);
+    for (int i = 0; i < 4; ++i) {
+        path.add(string_datum(random_string(rng, 6)));
+    }
+    ql::datum_object_builder_t builder;
+    builder.overwrite("id", string_datum(random_string(rng, 36)));
+    builder.overwrite("tree", child);
+    builder.overwrite("key", std::move(path).to_datum());
+    return std::move(builder).to_datum();
+}
+
+// Time series samples.
+ql::datum_t make_number_heavy(rng_t *rng) {
+    ql::configured_limits_t limits;
+    ql::datum_array_builder_t samples(limits);
+    for (int i = 0; i < 500; ++i) {
+        samples.add(ql::datum_t(rng->randdouble() * 1e6 - 5e5));
+    }
+    ql::datum_object_builder_t builder;
+    builder.overwrite("id",
+                      ql::datum_t(static_cast<double>(rng->randuint64(1ULL << 52))));
+    builder.overwrite("samples", std::move(samples).to_datum());
+    builder.overwrite("min", ql::datum_t(-5e5));
+    builder.overwrite("max", ql::datum_t(5e5));
+    builder.overwrite("key", ql::datum_t(rng->randdouble()));
+    return std::move(builder).to_datum();
+}
+
+// A blog post with its comments.
+ql::datum_t make_string_heavy(rng_t *rng) {
+    ql::configured_limits_t limits;
+    ql::datum_array_builder_t comments(limits);
+    for (int i = 0; i < 20; ++i) {
+        comments.add(string_datum(random_string(rng, 60 + rng->randint(200))));
+    }
+    ql::datum_object_builder_t builder;
+    builder.overwrite("id", string_datum(random_string(rng, 36)));
+    builder.overwrite("body", string_datum(random_string(rng, 4000)));
+    builder.overwrite("comments", std::move(comments).to_datum());
+    // Longer than a secondary key can be, so it gets truncated.
+    builder.overwrite("key", string_datum(random_string(rng, 300)));
+    return std::move(builder).to_datum();
+}
+
+// A stored file with its thumbnail.
+ql::datum_t make_binary_heavy(rng_t *rng) {
+    ql::datum_object_builder_t builder;
+    builder.overwrite("id", string_datum(random_string(rng, 36)));
+    builder.overwrite("content_type", string_datum("image/png"));
+    builder.overwrite("data", binary_datum(rng, 16 * KILOBYTE));
+    builder.overwrite("thumbnail", binary_datum(rng, KILOBYTE));
+    builder.overwrite("key", binary_datum(rng, 16));
+    return std::move(builder).to_datum();
+}
+
+// A place with its location and outline.
+ql::datum_t make_geo(rng_t *rng) {
+    ql::configured_limits_t limits;
+    const double lon = rng->randdouble() * 300 - 150;
+    const double lat = rng->randdouble() * 140 - 70;
+    lon_lat_line_t shell;
+    for (int i = 0; i < 64; ++i) {
+        const double angle = 2 * M_PI * i / 64;
+        shell.push_back(lon_lat_point_t(lon + cos(angle), lat + sin(angle)));
+    }
+    ql::datum_object_builder_t builder;
+    builder.overwrite("id", string_datum(random_string(rng, 36)));
+    builder.overwrite("location",
+                      construct_geo_point(lon_lat_point_t(lon, lat), limits));
+    builder.overwrite("outline", construct_geo_polygon(shell, limits));
+    builder.overwrite("key", string_datum(random_string(rng, 16)));
+    return std::move(builder).to_datum();
+}
+
+const document_shape_t document_shapes[] = {
+    {"flat_small", &make_flat_small},
+    {"wide", &make_wide},
+    {"deeply_nested", &make_deeply_nested},
+    {"number_heavy", &make_number_heavy},
+    {"string_heavy", &make_string_heavy},
+    {"binary_heavy", &make_binary_heavy},
+    {"geo", &make_geo}};
+
+std::string to_json(const ql::datum_t &document) {
+    rapidjson::StringBuffer buffer;
+    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+    document.write_json(&writer);
+    return std::string(buffer.GetString(), buffer.GetSize());
+}
+
+/* Adds how many heap strings, arrays and objects the last loop created per op, from
+the counts of `datum_allocations.hpp` before it. */
+void add_allocation_metrics(reporter_t *reporter,
+                            const datum_allocation_counts_t &before,
+                            int64_t ops) {
+    const datum_allocation_counts_t after = get_datum_allocation_counts();
+    const uint64_t heap_strings = after.heap_strings - before.heap_strings;
+    const uint64_t arrays = after.arrays - before.arrays;
+    const uint64_t objects = after.objects - before.objects;
+    reporter->add_metric("heap_strings_per_op",
+                         static_cast<double>(heap_strings) / ops);
+    reporter->add_metric("arrays_per_op", static_cast<double>(arrays) / ops);
+    reporter->add_metric("objects_per_op", static_cast<double>(objects) / ops);
+    reporter->add_metric("allocations_per_op",
+                         static_cast<double>(heap_strings + arrays + objects) / ops);
+}
+
+}  // namespace
+
+/* The conversions every document goes through on its way between the client and the
+disk, for a corpus of realistic document shapes: parsing JSON into a `datum_t`, writing
+it as JSON, serializing and deserializing it, comparing it, and making primary and
+secondary index keys from it.  Each loop cycles through a set of different documents of
+one shape, so that it doesn't only measure one document that sits in the CPU cache.
+Along with the time, each loop reports how many heap strings, arrays and objects it
+allocated per document. */
+BENCHMARK(datum_corpus) {
+    const int documents_per_shape = 64;
+    const ql::configured_limits_t limits = ql::configured_limits_t::unlimited;
+    rng_t rng(0);
+    for (const document_shape_t &shape : document_shapes) {
+        std::vector<ql::datum_t> documents;
+        std::vector<std::string> jsons;
+        std::vector<std::vector<char> > serialized;
+        std::vector<ql::datum_t> copies;
+        std::vector<store_key_t> primary_keys;
+        int64_t json_bytes = 0;
+        int64_t serialized_bytes = 0;
+        for (int i = 0; i < documents_per_shape; ++i) {
+            documents.push_back(shape.make(&rng));
+            jsons.push_back(to_json(documents.back()));
+            serialized.push_back(serialize_document(documents.back()));
+            json_bytes += jsons.back().size();
+            serialized_bytes += serialized.back().size();
+            // Equal to the document but a different object, so that `cmp()` has to
+            // look at all of it.
+            buffer_read_stream_t stream(serialized.back().data(),
+                                        serialized.back().size());
+            ql::datum_t copy;
+            guarantee_deserialization(ql::datum_deserialize(&stream, &copy), "datum");
+            copies.push_back(copy);
+            primary_keys.push_back(
+                store_key_t(documents.back().get_field("id").print_primary()));
+        }
+        const std::map<std::string, int64_t> params{
+            {"documents", documents_per_shape},
+            {"json_bytes_per_document", json_bytes / documents_per_shape},
+            {"serialized_bytes_per_document",
+             serialized_bytes / documents_per_shape}};
+        const int64_t ops = reporter->scaled(
+            std::max<int64_t>(1000, 50 * MEGABYTE / json_bytes * documents_per_shape));
+        const std::string prefix = std::string(shape.name) + "/";
+
+        datum_allocation_counts_t before = get_datum_allocation_counts();
+        reporter->measure(prefix + "parse_json", params, ops, [&](int64_t i) {
+            rapidjson::Document json;
+            json.Parse(jsons[i % documents_per_shape].c_str());
+            guarantee(!json.HasParseError());
+            ql::datum_t datum = ql::to_datum(json, limits, reql_version_t::LATEST);
+        });
+        add_allocation_metrics(reporter, before, ops);
+
+        before = get_datum_allocation_counts();
+        reporter->measure(prefix + "write_json", params, ops, [&](int64_t i) {
+            rapidjson::StringBuffer buffer;
+            rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+            documents[i % documents_per_shape].write_json(&writer);
+        });
+        add_allocation_metrics(reporter, before, ops);
+
+        before = get_datum_allocation_counts();
+        reporter->measure(prefix + "serialize", params, ops, [&](int64_t i) {
+            write_message_t wm;
+            ql::datum_serialize(&wm, documents[i % documents_per_shape],
+                                ql::check_datum_serialization_errors_t::NO);
+        });
+        add_allocation_metrics(reporter, before, ops);
+
+        before = get_datum_allocation_counts();
+        reporter->measure(prefix + "deserialize", params, ops, [&](int64_t i) {
+            const std::vector<char> &bytes = serialized[i % documents_per_shape];
+            buffer_read_stream_t stream(bytes.data(), bytes.size());
+            ql::datum_t datum;
+            archive_result_t res = ql::datum_deserialize(&stream, &datum);
+            guarantee_deserialization(res, "datum");
+        });
+        add_allocation_metrics(reporter, before, ops);
+
+        before = get_datum_allocation_counts();
+        reporter->measure(prefix + "cmp", params, ops, [&](int64_t i) {
+            const size_t j = i % documents_per_shape;
+            guarantee(documents[j].cmp(copies[j]) == 0);
+        });
+        add_allocation_metrics(reporter, before, ops);
+
+        before = get_datum_allocation_counts();
+        reporter->measure(prefix + "print_primary", params, ops, [&](int64_t i) {
+            documents[i % documents_per_shape].get_field("id").print_primary();
+        });
+        add_allocation_metrics(reporter, before, ops);
+
+        before = get_datum_allocation_counts();
+        reporter->measure(prefix + "print_secondary", params, ops, [&](int64_t i) {
+            const size_t j = i % documents_per_shape;
+            documents[j].get_field("key").print_secondary(
+                reql_version_t::LATEST, primary_keys[j], optional<uint64_t>());
+        });
+        add_allocation_metrics(reporter, before, ops);
+    }
+}
+
+/* `datum_serialize()` and `datum_deserialize()`, which every row written to or read
+from disk goes through. */
+BENCHMARK(datum) {
+    for (int fields : {4, 64}) {
+        const ql::datum_t document = make_document(fields);
+        const std::vector<char> serialized = serialize_document(document);
+        const std::map<std::string, int64_t> params{
+            {"fields", fields}, {"bytes", static_cast<int64_t>(serialized.size())}};
+        const int64_t ops = reporter->scaled(20000000 / serialized.size());
+
+        reporter->measure("serialize", params, ops, [&](int64_t) {
+            write_message_t wm;
+            ql::datum_serialize(
+                &wm, document, ql::check_datum_serialization_errors_t::NO);
+        });
+        reporter->measure("serialized_size", params, ops, [&](int64_t) {
+            guarantee(ql::datum_serialized_size(
+                document, ql::check_datum_serialization_errors_t::NO) > 0);
+        });
+        reporter->measure("deserialize", params, ops, [&](int64_t) {
+            buffer_read_stream_t stream(serialized.data(), serialized.size());
+            ql::datum_t datum;
+            archive_result_t res = ql::datum_deserialize(&stream, &datum);
+            guarantee_deserialization(res, "datum");
+        });
+    }
+}
+
+}  // namespace bench
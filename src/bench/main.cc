@@ -0,0 +1,90 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "arch/runtime/starter.hpp"
+#include "bench/bench.hpp"
+#include "utils.hpp"
+
+/* The benchmarks run on the first thread; the others are there for the benchmarks of
+hops between threads. */
+#define BENCH_THREADS 2
+
+namespace {
+
+void print_usage(const char *program) {
+    fprintf(stderr,
+            "Usage: %s [--filter <substring>] [--scale <factor>] [--dir <path>] "
+            "[--cache-trace <file>] [--perf-counters] [--list]\n"
+            "Runs the storage engine microbenchmarks whose names contain <substring>, "
+            "and prints their timings to stdout as JSON.\n"
+            "  --scale          multiplies the number of operations of each benchmark\n"
+            "  --dir            where to create the files benchmarks need (default: .)\n"
+            "  --cache-trace    a trace recorded with `rethinkdb --cache-trace`, for\n"
+            "                   the cache_trace benchmark to replay\n"
+            "  --perf-counters  also reports CPU cycles, instructions and cache misses\n"
+            "                   per op\n"
+            "  --list           prints the names of the benchmarks and exits\n",
+            program);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    startup_shutdown_t startup_shutdown;
+
+    bench::options_t options;
+    std::string filter;
+    bool list = false;
+    for (int i = 1; i < argc; ++i) {
+        const bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "--filter") == 0 && has_value) {
+            filter = argv[++i];
+        } else if (strcmp(argv[i], "--scale") == 0 && has_value) {
+            options.scale = atof(argv[++i]);
+            if (!(options.scale > 0)) {
+                fprintf(stderr, "--scale must be positive.\n");
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--dir") == 0 && has_value) {
+            options.temp_dir = argv[++i];
+        } else if (strcmp(argv[i], "--cache-trace") == 0 && has_value) {
+            options.cache_trace = argv[++i];
+        } else if (strcmp(argv[i], "--perf-counters") == 0) {
+            options.perf_counters = true;
+        } else if (strcmp(argv[i], "--list") == 0) {
+            list = true;
+        } else {
+            print_usage(argv[0]);
+            return strcmp(argv[i], "--help") == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+
+    std::vector<std::string> names;
+    for (const auto &pair : bench::registered_benchmarks()) {
+        if (pair.first.find(filter) != std::string::npos) {
+            names.push_back(pair.first);
+        }
+    }
+    if (list) {
+        for (const std::string &name : names) {
+            printf("%s\n", name.c_str());
+        }
+        return EXIT_SUCCESS;
+    }
+
+    std::vector<bench::result_t> results;
+    run_in_thread_pool([&]() {
+        bench::reporter_t reporter(&options, &results);
+        for (const std::string &name : names) {
+            bench::run_benchmark(name, &reporter);
+        }
+    }, BENCH_THREADS);
+
+    bench::print_results(results);
+    return EXIT_SUCCESS;
+}
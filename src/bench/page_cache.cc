@@ -0,0 +1,86 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include <string.h>
+
+#include <algorithm>
+
+#include "arch/io/disk.hpp"
+#include "bench/bench.hpp"
+#include "buffer_cache/alt.hpp"
+#include "buffer_cache/cache_balancer.hpp"
+#include "random.hpp"
+#include "serializer/log/log_serializer.hpp"
+
+namespace bench {
+
+namespace {
+
+const int64_t PAGE_CACHE_BLOCKS = 20000;
+const int64_t PAGE_CACHE_BLOCKS_PER_TXN = 100;
+
+void write_blocks(cache_conn_t *cache_conn, int64_t first, int64_t count, bool create) {
+    txn_t txn(cache_conn, write_durability_t::HARD, count);
+    for (int64_t i = first; i < first + count; ++i) {
+        scoped_ptr_t<buf_lock_t> lock;
+        if (create) {
+            lock.init(new buf_lock_t(&txn, i, alt_create_t::create));
+        } else {
+            lock.init(new buf_lock_t(buf_parent_t(&txn), i, access_t::write));
+        }
+        buf_write_t write(lock.get());
+        memset(write.get_data_write(), static_cast<int>(i), 64);
+    }
+    txn.commit();
+}
+
+void read_block(cache_conn_t *cache_conn, int64_t block_id) {
+    txn_t txn(cache_conn, read_access_t::read);
+    buf_lock_t lock(buf_parent_t(&txn), block_id, access_t::read);
+    buf_read_t read(&lock);
+    guarantee(*static_cast<const char *>(read.get_data_read())
+              == static_cast<char>(block_id));
+}
+
+}  // namespace
+
+/* Block reads and writes through `cache_t` and `page_cache_t`.  With a cache that
+holds every block the reads are hits; with one that holds a tenth of them, most reads
+have to evict a page and load another from the serializer. */
+BENCHMARK(page_cache) {
+    temp_directory_t dir(reporter->options().temp_dir);
+    io_backender_t io_backender(file_direct_io_mode_t::buffered_desired);
+    const int64_t blocks = std::max<int64_t>(
+        1, reporter->scaled(PAGE_CACHE_BLOCKS) / PAGE_CACHE_BLOCKS_PER_TXN)
+        * PAGE_CACHE_BLOCKS_PER_TXN;
+
+    for (int64_t resident_percent : {100, 10}) {
+        filepath_file_opener_t file_opener(dir.new_file(), &io_backender);
+        log_serializer_t::create(&file_opener, log_serializer_t::static_config_t());
+        log_serializer_t serializer(log_serializer_t::dynamic_config_t(),
+                                    &file_opener,
+                                    &get_global_perfmon_collection());
+        const uint64_t memory = resident_percent == 100
+            ? GIGABYTE
+            : blocks * resident_percent / 100 * serializer.max_block_size().value();
+        dummy_cache_balancer_t balancer(memory);
+        cache_t cache(&serializer, &balancer, &get_global_perfmon_collection(),
+                      which_cpu_shard_t{0, 1});
+        cache_conn_t cache_conn(&cache);
+
+        const std::map<std::string, int64_t> params{
+            {"blocks", blocks}, {"resident_percent", resident_percent}};
+        reporter->measure("create", params, blocks / PAGE_CACHE_BLOCKS_PER_TXN,
+                          [&](int64_t i) {
+            write_blocks(&cache_conn, i * PAGE_CACHE_BLOCKS_PER_TXN,
+                         PAGE_CACHE_BLOCKS_PER_TXN, true);
+        });
+        rng_t rng(0);
+        reporter->measure("read", params, 10 * blocks, [&](int64_t) {
+            read_block(&cache_conn, rng.randuint64(blocks));
+        });
+        reporter->measure("write", params, blocks, [&](int64_t) {
+            write_blocks(&cache_conn, rng.randuint64(blocks), 1, false);
+        });
+    }
+}
+
+}  // namespace bench
@@ -0,0 +1,43 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "bench/bench.hpp"
+#include "perfmon/perfmon.hpp"
+#include "time.hpp"
+
+namespace bench {
+
+/* What recording an event costs for each type of perfmon, and what reading the clocks
+they use costs.  Perfmons record on hot paths such as every key read and every socket
+write. */
+BENCHMARK(perfmon) {
+    const int64_t ops = reporter->scaled(10 * MILLION);
+    const std::map<std::string, int64_t> no_params;
+
+    perfmon_counter_t counter;
+    reporter->measure("counter", no_params, ops, [&](int64_t) {
+        ++counter;
+    });
+
+    perfmon_rate_monitor_t rate(secs_to_ticks(1));
+    reporter->measure("rate_monitor", no_params, ops, [&](int64_t i) {
+        rate.record(i);
+    });
+
+    perfmon_sampler_t sampler(secs_to_ticks(1), true);
+    reporter->measure("sampler", no_params, ops, [&](int64_t i) {
+        sampler.record(i);
+    });
+
+    perfmon_histogram_t histogram(secs_to_ticks(1), false);
+    reporter->measure("histogram", no_params, ops, [&](int64_t i) {
+        histogram.record(ticks_t{i}, get_coarse_ticks());
+    });
+
+    reporter->measure("get_ticks", no_params, ops, [&](int64_t) {
+        get_ticks();
+    });
+    reporter->measure("get_coarse_ticks", no_params, ops, [&](int64_t) {
+        get_coarse_ticks();
+    });
+}
+
+}  // namespace bench
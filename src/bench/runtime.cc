@@ -0,0 +1,87 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "arch/runtime/coroutines.hpp"
+#include "arch/runtime/runtime.hpp"
+#include "arch/runtime/thread_pool.hpp"
+#include "bench/bench.hpp"
+#include "concurrency/cond_var.hpp"
+#include "concurrency/new_semaphore.hpp"
+#include "concurrency/pmap.hpp"
+
+namespace bench {
+
+/* The coroutine runtime: spawning coroutines, switching between them, and the
+primitives that everything else waits on.  These are overheads that every query pays
+many times, so they are worth tracking across compiler and allocator changes, with
+`--perf-counters` to see whether a change came from more instructions or from more
+cache misses. */
+BENCHMARK(runtime) {
+    const int64_t ops = reporter->scaled(200000);
+    const std::map<std::string, int64_t> no_params;
+
+    // Runs to completion before `spawn_now_dangerously()` returns, so it's the cost of
+    // getting a coroutine (from the free list) and two switches.
+    reporter->measure("spawn", no_params, ops, [&](int64_t) {
+        coro_t::spawn_now_dangerously([]() { });
+    });
+
+    // Goes through the event queue and back: the cost of a switch out and a switch in.
+    reporter->measure("yield", no_params, ops, [&](int64_t) {
+        coro_t::yield();
+    });
+
+    // To the other thread and back, through the message hubs of both threads.
+    guarantee(get_num_threads() > 1);
+    const threadnum_t other_thread(1);
+    reporter->measure("on_thread_round_trip", no_params, ops / 10, [&](int64_t) {
+        on_thread_t thread_switcher(other_thread);
+    });
+
+    // A signal that is already pulsed doesn't block.
+    reporter->measure("cond_pulse_then_wait", no_params, ops, [&](int64_t) {
+        cond_t cond;
+        cond.pulse();
+        cond.wait();
+    });
+
+    // The waiter blocks and another coroutine wakes it up.
+    reporter->measure("cond_wait_then_pulse", no_params, ops, [&](int64_t) {
+        cond_t cond;
+        coro_t::spawn_sometime([&]() { cond.pulse(); });
+        cond.wait();
+    });
+
+    new_semaphore_t semaphore(1);
+    reporter->measure("semaphore_uncontended", no_params, ops, [&](int64_t) {
+        new_semaphore_in_line_t acq(&semaphore, 1);
+        acq.acquisition_signal()->wait();
+    });
+
+    // Every acquirer but the first has to wait for the one ahead of it.
+    const int64_t acquirers = 16;
+    reporter->measure("semaphore_contended", {{"acquirers", acquirers}},
+                      ops / acquirers, [&](int64_t) {
+        pmap(acquirers, [&](int64_t) {
+            new_semaphore_in_line_t acq(&semaphore, 1);
+            acq.acquisition_signal()->wait();
+            coro_t::yield();
+        });
+    });
+
+    for (int64_t fan_out : {1, 16, 256}) {
+        reporter->measure("pmap", {{"fan_out", fan_out}}, ops / fan_out, [&](int64_t) {
+            pmap(fan_out, [](int64_t) { });
+        });
+    }
+
+    // What `pmap(get_num_threads(), ...)` with an `on_thread_t` costs; many
+    // cluster-wide operations are built like this.
+    const int64_t threads = get_num_threads();
+    reporter->measure("pmap_all_threads", {{"threads", threads}}, ops / 10,
+                      [&](int64_t) {
+        pmap(get_num_threads(), [](int thread) {
+            on_thread_t thread_switcher((threadnum_t(thread)));
+        });
+    });
+}
+
+}  // namespace bench
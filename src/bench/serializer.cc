@@ -0,0 +1,197 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include <string.h>
+
+#include <algorithm>
+
+#include "arch/io/disk.hpp"
+#include "bench/bench.hpp"
+#include "concurrency/new_mutex.hpp"
+#include "perfmon/perfmon.hpp"
+#include "random.hpp"
+#include "rdb_protocol/datum.hpp"
+#include "serializer/buf_ptr.hpp"
+#include "serializer/log/log_serializer.hpp"
+#include "time.hpp"
+
+namespace bench {
+
+namespace {
+
+struct write_cb_t : public iocallback_t, public cond_t {
+    void on_io_complete() {
+        pulse();
+    }
+};
+
+// Writes `count` blocks starting at `first` and points the index at them.
+void write_blocks(log_serializer_t *ser,
+                  file_account_t *account,
+                  const buf_ptr_t &buf,
+                  int64_t first,
+                  int64_t count,
+                  std::vector<counted_t<block_token_t> > *tokens) {
+    std::vector<buf_write_info_t> infos;
+    for (int64_t i = first; i < first + count; ++i) {
+        infos.push_back(buf_write_info_t(buf.ser_buffer(), buf.block_size(), i));
+    }
+    write_cb_t cb;
+    std::vector<counted_t<block_token_t> > new_tokens
+        = ser->block_writes(infos.data(), infos.size(), account, &cb);
+    cb.wait();
+
+    std::vector<index_write_op_t> write_ops;
+    for (int64_t i = 0; i < count; ++i) {
+        write_ops.push_back(index_write_op_t(
+            first + i,
+            make_optional(new_tokens[i]),
+            make_optional(repli_timestamp_t::distant_past)));
+        (*tokens)[first + i] = new_tokens[i];
+    }
+    // There are no other index writes to keep in order with.
+    new_mutex_in_line_t dummy_acq;
+    ser->index_write(&dummy_acq, []{ }, write_ops);
+}
+
+// The value of one of the `serializer_...` stats of a serializer created with `stats`.
+int64_t serializer_stat(perfmon_collection_t *stats, const char *name) {
+    return get_stats(stats).get_field("serializer").get_field(name).as_int();
+}
+
+int64_t percentile(const std::vector<int64_t> &sorted, double p) {
+    guarantee(!sorted.empty());
+    return sorted[std::min<size_t>(sorted.size() - 1, sorted.size() * p / 100)];
+}
+
+}  // namespace
+
+/* Block writes, index writes and block reads straight through `log_serializer_t`.
+Overwriting the blocks over and over leaves most of the file garbage, so the
+`overwrite` loop also measures the garbage collector moving the live blocks. */
+BENCHMARK(serializer) {
+    temp_directory_t dir(reporter->options().temp_dir);
+    io_backender_t io_backender(file_direct_io_mode_t::buffered_desired);
+
+    filepath_file_opener_t file_opener(dir.new_file(), &io_backender);
+    log_serializer_t::create(&file_opener, log_serializer_t::static_config_t());
+    log_serializer_t ser(log_serializer_t::dynamic_config_t(),
+                         &file_opener,
+                         &get_global_perfmon_collection());
+    scoped_ptr_t<file_account_t> account(
+        ser.make_io_account(io_class_t::foreground_read, 1));
+    buf_ptr_t buf = buf_ptr_t::alloc_zeroed(ser.max_block_size());
+    memset(buf.cache_data(), 'x', buf.block_size().value());
+
+    const int64_t blocks = reporter->scaled(20000);
+    std::vector<counted_t<block_token_t> > tokens(blocks);
+    for (int64_t batch_size : {1, 64}) {
+        const std::map<std::string, int64_t> params{
+            {"blocks", blocks}, {"batch_size", batch_size}};
+        rng_t rng(0);
+        // The index is pointed at the same blocks every time, so the earlier writes
+        // become garbage.
+        reporter->measure("overwrite", params, blocks / batch_size, [&](int64_t) {
+            write_blocks(&ser, account.get(), buf,
+                         rng.randuint64(blocks - std::min(blocks, batch_size) + 1),
+                         std::min(blocks, batch_size), &tokens);
+        });
+    }
+
+    // Writes each block once more, so that every one of them has a token.
+    const std::map<std::string, int64_t> params{{"blocks", blocks}};
+    reporter->measure("write", params, blocks, [&](int64_t i) {
+        write_blocks(&ser, account.get(), buf, i, 1, &tokens);
+    });
+    rng_t rng(0);
+    reporter->measure("read", params, blocks, [&](int64_t) {
+        buf_ptr_t read = ser.block_read(tokens[rng.randuint64(blocks)], account.get());
+        guarantee(read.block_size().value() == buf.block_size().value());
+    });
+    reporter->measure("index_read", params, 10 * blocks, [&](int64_t) {
+        guarantee(ser.index_read(rng.randuint64(blocks)).has());
+    });
+}
+
+/* The serializer in steady state: the file is filled with live blocks, and then they
+are overwritten at random, one write at a time, for several passes of as many writes as
+there are blocks.  The garbage collector has to keep up with the writes, so after each
+pass this reports how many bytes it wrote for each byte of foreground writes, the
+latency percentiles of the foreground writes, how much of the file is live data, how
+fragmented the free extents are and how big the LBA has grown.  For long runs on real
+hardware, give it a large `--scale` and a `--dir` on the device to evaluate. */
+BENCHMARK(serializer_gc) {
+    temp_directory_t dir(reporter->options().temp_dir);
+    io_backender_t io_backender(file_direct_io_mode_t::buffered_desired);
+
+    filepath_file_opener_t file_opener(dir.new_file(), &io_backender);
+    log_serializer_t::create(&file_opener, log_serializer_t::static_config_t());
+    perfmon_collection_t stats;
+    log_serializer_t ser(log_serializer_t::dynamic_config_t(), &file_opener, &stats);
+    scoped_ptr_t<file_account_t> account(
+        ser.make_io_account(io_class_t::foreground_read, 1));
+    buf_ptr_t buf = buf_ptr_t::alloc_zeroed(ser.max_block_size());
+    memset(buf.cache_data(), 'x', buf.block_size().value());
+
+    const int64_t blocks = reporter->scaled(25000);
+    const int64_t fill_batch_size = 64;
+    std::vector<counted_t<block_token_t> > tokens(blocks);
+    reporter->measure("fill", {{"blocks", blocks}},
+                      (blocks + fill_batch_size - 1) / fill_batch_size,
+                      [&](int64_t i) {
+        const int64_t first = i * fill_batch_size;
+        write_blocks(&ser, account.get(), buf, first,
+                     std::min(fill_batch_size, blocks - first), &tokens);
+    });
+
+    const int64_t passes = 4;
+    rng_t rng(0);
+    for (int64_t pass = 0; pass < passes; ++pass) {
+        const int64_t data_written_before =
+            serializer_stat(&stats, "serializer_data_written_bytes_total");
+        const int64_t gc_written_before =
+            serializer_stat(&stats, "serializer_gc_written_bytes_total");
+        const int64_t lba_gcs_before = serializer_stat(&stats, "serializer_lba_gcs");
+
+        std::vector<int64_t> latencies;
+        latencies.reserve(blocks);
+        reporter->measure("steady_overwrite", {{"blocks", blocks}, {"pass", pass}},
+                          blocks, [&](int64_t) {
+            const ticks_t start = get_ticks();
+            write_blocks(&ser, account.get(), buf, rng.randuint64(blocks), 1, &tokens);
+            latencies.push_back(get_ticks().nanos - start.nanos);
+        });
+        std::sort(latencies.begin(), latencies.end());
+
+        const int64_t data_written =
+            serializer_stat(&stats, "serializer_data_written_bytes_total")
+            - data_written_before;
+        const int64_t gc_written =
+            serializer_stat(&stats, "serializer_gc_written_bytes_total")
+            - gc_written_before;
+        reporter->add_metric("gc_write_amplification",
+            data_written == 0 ? 0.0
+            : static_cast<double>(data_written + gc_written) / data_written);
+        reporter->add_metric("write_p50_nanos", percentile(latencies, 50));
+        reporter->add_metric("write_p99_nanos", percentile(latencies, 99));
+        reporter->add_metric("write_max_nanos", latencies.back());
+
+        const int64_t file_size = serializer_stat(&stats, "serializer_file_size_bytes");
+        reporter->add_metric("file_size_bytes", file_size);
+        reporter->add_metric("live_fraction",
+            static_cast<double>(blocks * buf.block_size().ser_value()) / file_size);
+
+        const extent_free_space_t free_space = ser.extent_free_space();
+        reporter->add_metric("free_extents", free_space.free_extents);
+        reporter->add_metric("free_extent_runs", free_space.free_runs);
+        // 0 when all the free extents are adjacent, close to 1 when they are scattered.
+        reporter->add_metric("free_space_fragmentation",
+            free_space.free_extents == 0 ? 0.0
+            : 1.0 - static_cast<double>(free_space.largest_free_run)
+                    / free_space.free_extents);
+        reporter->add_metric("lba_extents",
+                             serializer_stat(&stats, "serializer_lba_extents"));
+        reporter->add_metric("lba_gcs",
+            serializer_stat(&stats, "serializer_lba_gcs") - lba_gcs_before);
+    }
+}
+
+}  // namespace bench
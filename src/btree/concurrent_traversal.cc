@@ -111,6 +111,10 @@ public:
         return cb_->get_trace();
     }
 
+    virtual size_t get_read_ahead_budget() THROWS_NOTHING {
+        return cb_->get_read_ahead_budget();
+    }
+
 private:
     friend class concurrent_traversal_fifo_enforcer_signal_t;
 
@@ -56,6 +56,9 @@ public:
 
     virtual profile::trace_t *get_trace() THROWS_NOTHING { return nullptr; }
 
+    // See `depth_first_traversal_callback_t::get_read_ahead_budget()`.
+    virtual size_t get_read_ahead_budget() THROWS_NOTHING { return 0; }
+
 protected:
     virtual ~concurrent_traversal_callback_t() { }
 private:
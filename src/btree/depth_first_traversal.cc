@@ -1,9 +1,16 @@
 // Copyright 2010-2014 RethinkDB, all rights reserved.
 #include "btree/depth_first_traversal.hpp"
 
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <utility>
+
+#include "arch/runtime/coroutines.hpp"
 #include "btree/internal_node.hpp"
 #include "btree/leaf_node.hpp"
 #include "btree/operations.hpp"
+#include "concurrency/auto_drainer.hpp"
 #include "concurrency/interruptor.hpp"
 #include "rdb_protocol/profile.hpp"
 
@@ -36,8 +43,106 @@ void scoped_key_value_t::reset() {
 }
 
 
+// The most children of one internal node that we read ahead at a time, so that the
+// upper levels of the tree can't use up the whole read-ahead budget.
+const int MAX_READ_AHEAD_CHILDREN = 32;
+
+// Shared by all levels of one traversal.  Tracks how many bytes' worth of blocks may
+// still be read ahead, and keeps the traversal from returning while read-ahead loads
+// are still holding buf locks in the caller's transaction.
+class read_ahead_budget_t {
+public:
+    explicit read_ahead_budget_t(size_t bytes) : bytes_available_(bytes) { }
+
+    bool try_take(size_t bytes) {
+        if (bytes > bytes_available_) {
+            return false;
+        }
+        bytes_available_ -= bytes;
+        return true;
+    }
+    void give_back(size_t bytes) {
+        bytes_available_ += bytes;
+    }
+    auto_drainer_t::lock_t lock() {
+        return drainer_.lock();
+    }
+
+private:
+    size_t bytes_available_;
+    // Must be destroyed (and drained) before anything the read-ahead coroutines use.
+    auto_drainer_t drainer_;
+
+    DISABLE_COPYING(read_ahead_budget_t);
+};
+
+void load_read_ahead_block(counted_t<counted_buf_lock_and_read_t> block,
+                           UNUSED auto_drainer_t::lock_t keepalive) {
+    uint16_t block_size;
+    block->read->get_data_read(&block_size);
+}
+
+// The children of one internal node that are being read ahead, in traversal order.
+class read_ahead_window_t {
+public:
+    read_ahead_window_t(read_ahead_budget_t *budget, size_t block_size)
+        : budget_(budget), block_size_(block_size), next_(0) { }
+    ~read_ahead_window_t() {
+        while (!blocks_.empty()) {
+            pop();
+        }
+    }
+
+    // Returns the read-ahead lock for the `i`th child in traversal order, if there is
+    // one, and forgets about the children before it.
+    counted_t<counted_buf_lock_and_read_t> take(int i) {
+        while (!blocks_.empty() && blocks_.front().first < i) {
+            pop();
+        }
+        counted_t<counted_buf_lock_and_read_t> ret;
+        if (!blocks_.empty() && blocks_.front().first == i) {
+            ret = std::move(blocks_.front().second);
+            pop();
+        }
+        return ret;
+    }
+
+    // Starts reading ahead the children after the `i`th one in traversal order, as
+    // far as the budget allows.  `child_block_id(j)` returns the `j`th child.
+    template <class child_block_id_fn_t>
+    void fill(buf_lock_t *parent, int i, int num_children,
+              const child_block_id_fn_t &child_block_id) {
+        next_ = std::max(next_, i + 1);
+        while (next_ < num_children
+               && next_ <= i + MAX_READ_AHEAD_CHILDREN
+               && budget_->try_take(block_size_)) {
+            auto block = make_counted<counted_buf_lock_and_read_t>(
+                parent, child_block_id(next_), access_t::read);
+            block->read.init(new buf_read_t(&block->lock));
+            coro_t::spawn_sometime(std::bind(&load_read_ahead_block,
+                                             block, budget_->lock()));
+            blocks_.push_back(std::make_pair(next_, std::move(block)));
+            ++next_;
+        }
+    }
+
+private:
+    void pop() {
+        blocks_.pop_front();
+        budget_->give_back(block_size_);
+    }
+
+    read_ahead_budget_t *const budget_;
+    const size_t block_size_;
+    std::deque<std::pair<int, counted_t<counted_buf_lock_and_read_t> > > blocks_;
+    // The next child that hasn't been considered for read-ahead yet.
+    int next_;
+
+    DISABLE_COPYING(read_ahead_window_t);
+};
+
 /* Returns `true` if we reached the end of the subtree or range, and `false` if
-`cb->handle_value()` returned `false`. */
+`cb->handle_value()` returned `false`. `read_ahead` is null if we don't read ahead. */
 continue_bool_t btree_depth_first_traversal(
         counted_t<counted_buf_lock_and_read_t> block,
         const key_range_t &range,
@@ -46,8 +151,24 @@ continue_bool_t btree_depth_first_traversal(
         direction_t direction,
         const btree_key_t *left_excl_or_null,
         const btree_key_t *right_incl,
+        read_ahead_budget_t *read_ahead,
         signal_t *interruptor);
 
+// Makes the transaction read through the cache's scan account while a traversal is
+// running, so that the blocks it loads don't evict the blocks that point reads use.
+class scan_account_switcher_t {
+public:
+    explicit scan_account_switcher_t(txn_t *txn) : txn_(txn) {
+        txn_->set_scanning(true);
+    }
+    ~scan_account_switcher_t() {
+        txn_->set_scanning(false);
+    }
+private:
+    txn_t *txn_;
+    DISABLE_COPYING(scan_account_switcher_t);
+};
+
 continue_bool_t btree_depth_first_traversal(
         superblock_t *superblock,
         const key_range_t &range,
@@ -60,6 +181,16 @@ continue_bool_t btree_depth_first_traversal(
         return continue_bool_t::CONTINUE;
     }
 
+    scan_account_switcher_t scan_account_switcher(superblock->expose_buf().txn());
+
+    // Declared before any buf locks are taken, so that it's destroyed (and waits for
+    // outstanding read-ahead loads) after all of ours are released.
+    scoped_ptr_t<read_ahead_budget_t> read_ahead;
+    const size_t read_ahead_budget = cb->get_read_ahead_budget();
+    if (access == access_t::read && read_ahead_budget > 0) {
+        read_ahead.init(new read_ahead_budget_t(read_ahead_budget));
+    }
+
     const btree_key_t *left_excl_or_null;
     store_key_t left_excl_buf(range.left);
     if (left_excl_buf.decrement()) {
@@ -106,7 +237,8 @@ continue_bool_t btree_depth_first_traversal(
 
         return btree_depth_first_traversal(
             std::move(root_block), range, cb, access, direction,
-            left_excl_or_null, right_incl_buf.btree_key(), interruptor);
+            left_excl_or_null, right_incl_buf.btree_key(), read_ahead.get(),
+            interruptor);
     }
 }
 
@@ -154,6 +286,7 @@ continue_bool_t btree_depth_first_traversal(
         direction_t direction,
         const btree_key_t *left_excl_or_null,
         const btree_key_t *right_incl,
+        read_ahead_budget_t *read_ahead,
         signal_t *interruptor) {
     bool skip;
     if (continue_bool_t::ABORT == cb->filter_range_ts(
@@ -164,7 +297,9 @@ continue_bool_t btree_depth_first_traversal(
     if (skip) {
         return continue_bool_t::CONTINUE;
     }
-    block->read.init(new buf_read_t(&block->lock));
+    if (!block->read.has()) {
+        block->read.init(new buf_read_t(&block->lock));
+    }
     const node_t *node = static_cast<const node_t *>(block->read->get_data_read());
     if (node::is_internal(node)) {
         if (continue_bool_t::ABORT == cb->handle_pre_internal(
@@ -181,8 +316,16 @@ continue_bool_t btree_depth_first_traversal(
             r.decrement();
             end_index = internal_node::get_offset_index(inode, r.btree_key()) + 1;
         }
+        auto child_index = [&](int i) {
+            return direction == FORWARD ? start_index + i : (end_index - 1) - i;
+        };
+        scoped_ptr_t<read_ahead_window_t> read_ahead_window;
+        if (read_ahead != nullptr) {
+            read_ahead_window.init(new read_ahead_window_t(
+                read_ahead, block->lock.cache()->max_block_size().value()));
+        }
         for (int i = 0; i < end_index - start_index; ++i) {
-            int true_index = (direction == FORWARD ? start_index + i : (end_index - 1) - i);
+            int true_index = child_index(i);
             const btree_internal_pair *pair = internal_node::get_pair_by_index(inode, true_index);
 
             // Get the child key range
@@ -203,13 +346,27 @@ continue_bool_t btree_depth_first_traversal(
                         cb->get_trace() != nullptr,
                         "Acquire block for read.",
                         cb->get_trace());
-                    lock = make_counted<counted_buf_lock_and_read_t>(
-                        &block->lock, pair->lnode, access);
+                    if (read_ahead_window.has()) {
+                        lock = read_ahead_window->take(i);
+                    }
+                    if (!lock.has()) {
+                        lock = make_counted<counted_buf_lock_and_read_t>(
+                            &block->lock, pair->lnode, access);
+                    }
+                    if (read_ahead_window.has()) {
+                        read_ahead_window->fill(
+                            &block->lock, i, end_index - start_index,
+                            [&](int j) {
+                                return internal_node::get_pair_by_index(
+                                    inode, child_index(j))->lnode;
+                            });
+                    }
                     wait_interruptible(lock->lock.read_acq_signal(), interruptor);
                 }
                 if (continue_bool_t::ABORT == btree_depth_first_traversal(
                         std::move(lock), range, cb, access, direction,
-                        child_left_excl_or_null, child_right_incl, interruptor)) {
+                        child_left_excl_or_null, child_right_incl, read_ahead,
+                        interruptor)) {
                     return continue_bool_t::ABORT;
                 }
             }
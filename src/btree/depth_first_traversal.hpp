@@ -127,6 +127,15 @@ public:
     cover the full range of the traversal. */
 
     virtual profile::trace_t *get_trace() THROWS_NOTHING { return nullptr; }
+
+    /* If this returns a nonzero number of bytes, then whenever the traversal enters an
+    internal node it starts loading the next few children (in traversal order) in the
+    background, so that a scan over a cold B-tree doesn't become a chain of dependent
+    disk reads. At most this many bytes' worth of blocks are being read ahead at any
+    time. Children are read ahead before `filter_range()` is called on them, so this
+    is only worth it if `filter_range()` rarely skips anything. Only read traversals
+    read ahead. */
+    virtual size_t get_read_ahead_budget() THROWS_NOTHING { return 0; }
 protected:
     virtual ~depth_first_traversal_callback_t() { }
 };
@@ -0,0 +1,74 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#include "btree/key_filter.hpp"
+
+#include <algorithm>
+
+#include "config/args.hpp"
+
+// Ten bits per key with seven probes gives a false positive rate of about 1%.
+static const uint64_t BITS_PER_KEY = 10;
+static const uint64_t MIN_FILTER_BITS = 1 << 16;
+static const uint64_t MAX_FILTER_BITS = KEY_FILTER_MAX_BYTES * 8;
+
+// FNV-1a followed by a 64-bit finalizer, so that keys that only differ in their
+// last bytes still end up with unrelated bits.  We can't use `hash_region_hasher`,
+// because all the keys of a store fall into the same hash shard.
+static uint64_t hash_key(const btree_key_t *key) {
+    uint64_t h = 14695981039346656037ULL;
+    for (int i = 0; i < key->size; ++i) {
+        h ^= key->contents[i];
+        h *= 1099511628211ULL;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+uint64_t key_filter_t::max_keys() {
+    return MAX_FILTER_BITS / BITS_PER_KEY;
+}
+
+key_filter_t::key_filter_t(uint64_t expected_keys)
+    : capacity_(std::min(expected_keys, max_keys())), num_inserted_(0) {
+    uint64_t num_bits = MIN_FILTER_BITS;
+    while (num_bits < capacity_ * BITS_PER_KEY) {
+        num_bits *= 2;
+    }
+    words_.resize(num_bits / 64, 0);
+    index_mask_ = num_bits - 1;
+}
+
+void key_filter_t::insert(const btree_key_t *key) {
+    // Keys that are already covered don't change any bits, and not counting them
+    // keeps rewrites of existing rows from making the filter look overfull.
+    if (may_contain(key)) {
+        return;
+    }
+    const uint64_t h = hash_key(key);
+    // Double hashing: probe `h1 + i * h2` for `i` in [0, NUM_PROBES).
+    uint64_t probe = h;
+    const uint64_t step = (h >> 32) | 1;
+    for (int i = 0; i < NUM_PROBES; ++i) {
+        const uint64_t bit = probe & index_mask_;
+        words_[bit / 64] |= uint64_t(1) << (bit % 64);
+        probe += step;
+    }
+    ++num_inserted_;
+}
+
+bool key_filter_t::may_contain(const btree_key_t *key) const {
+    const uint64_t h = hash_key(key);
+    uint64_t probe = h;
+    const uint64_t step = (h >> 32) | 1;
+    for (int i = 0; i < NUM_PROBES; ++i) {
+        const uint64_t bit = probe & index_mask_;
+        if ((words_[bit / 64] & (uint64_t(1) << (bit % 64))) == 0) {
+            return false;
+        }
+        probe += step;
+    }
+    return true;
+}
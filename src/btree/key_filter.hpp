@@ -0,0 +1,46 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#ifndef BTREE_KEY_FILTER_HPP_
+#define BTREE_KEY_FILTER_HPP_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "btree/keys.hpp"
+
+// An in-memory Bloom filter over the keys of a btree, which lets point lookups
+// of keys that definitely aren't there skip descending the btree.
+//
+// The filter only ever gains keys.  Deleting a key from the btree leaves its
+// bits set, which just turns later lookups of that key into false positives.
+// Once more keys have been inserted than the filter was sized for, its false
+// positive rate degrades, and `is_overfull()` tells the owner to build a
+// bigger one.  See `btree_slice_t::may_contain_key()`.
+class key_filter_t {
+public:
+    // Sized for about `expected_keys` keys at a false positive rate of about 1%, but
+    // never for more than `max_keys()`.
+    explicit key_filter_t(uint64_t expected_keys);
+
+    // The most keys a filter within `KEY_FILTER_MAX_BYTES` is sized for.
+    static uint64_t max_keys();
+
+    void insert(const btree_key_t *key);
+    // Returns `false` only if `key` was never inserted.
+    bool may_contain(const btree_key_t *key) const;
+
+    bool is_overfull() const { return num_inserted_ > capacity_; }
+    // Whether a rebuild couldn't make the filter any bigger.
+    bool is_max_size() const { return capacity_ == max_keys(); }
+    uint64_t num_inserted() const { return num_inserted_; }
+
+private:
+    static const int NUM_PROBES = 7;
+
+    std::vector<uint64_t> words_;
+    uint64_t index_mask_;
+    uint64_t capacity_;
+    uint64_t num_inserted_;
+};
+
+#endif  // BTREE_KEY_FILTER_HPP_
@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 
+#include "arch/runtime/resource_usage.hpp"
 #include "btree/internal_node.hpp"
 #include "btree/leaf_node.hpp"
 #include "buffer_cache/alt.hpp"
@@ -474,6 +475,42 @@ void find_keyvalue_location_for_write(
     keyvalue_location_out->buf.swap(buf);
 }
 
+// Follows the child pointers for `key`, starting at `block_id`, through the internal
+// nodes that can be read without acquiring them (see `txn_t::peek_block_for_read()`).
+// Returns the first block that can't be, or the leaf we got to.  Anybody changing the
+// tree's structure holds write locks on the affected internal nodes until they are
+// consistent again, so the nodes we get to see are.  The caller must get in line for
+// the returned block before blocking, or the path we took might change under it.
+block_id_t descend_without_acquiring(txn_t *txn, const btree_key_t *key,
+                                     block_id_t block_id) {
+    ASSERT_NO_CORO_WAITING;
+    for (;;) {
+        const void *data = txn->peek_block_for_read(block_id);
+        if (data == nullptr || !node::is_internal(static_cast<const node_t *>(data))) {
+            return block_id;
+        }
+        block_id = internal_node::lookup(static_cast<const internal_node_t *>(data),
+                                         key);
+        rassert(block_id != NULL_BLOCK_ID && block_id != SUPERBLOCK_ID);
+    }
+}
+
+// Acquires the node under `parent` that we need to get to next on our way to `key`,
+// which is `block_id` or one of its descendants.
+buf_lock_t acquire_next_node_for_read(buf_parent_t parent, const btree_key_t *key,
+                                      block_id_t block_id) {
+    if (parent.is_snapshotted()) {
+        return buf_lock_t(parent, block_id, access_t::read);
+    }
+    const block_id_t next_id = descend_without_acquiring(parent.txn(), key, block_id);
+    if (next_id == block_id) {
+        return buf_lock_t(parent, block_id, access_t::read);
+    }
+    // Non-snapshotted readers only use their parent to wait for it, and we've just
+    // read its descendants.
+    return buf_lock_t(buf_parent_t(parent.txn()), next_id, access_t::read);
+}
+
 void find_keyvalue_location_for_read(
         value_sizer_t *sizer,
         superblock_t *superblock, const btree_key_t *key,
@@ -481,6 +518,9 @@ void find_keyvalue_location_for_read(
         btree_stats_t *stats, profile::trace_t *trace) {
     stats->pm_keys_read.record();
     stats->pm_total_keys_read += 1;
+    if (resource_usage_t *usage = current_resource_usage()) {
+        ++usage->rows_scanned;
+    }
 
     const block_id_t root_id = superblock->get_root_block_id();
     rassert(root_id != SUPERBLOCK_ID);
@@ -495,7 +535,8 @@ void find_keyvalue_location_for_read(
     {
         PROFILE_STARTER_IF_ENABLED(
                 trace != nullptr, "Acquire a block for read.", trace);;
-        buf_lock_t tmp(superblock->expose_buf(), root_id, access_t::read);
+        buf_lock_t tmp
+            = acquire_next_node_for_read(superblock->expose_buf(), key, root_id);
         superblock->release();
         buf = std::move(tmp);
     }
@@ -507,6 +548,8 @@ void find_keyvalue_location_for_read(
     }
 #endif  // NDEBUG
 
+    // Under write contention on the upper levels of the tree, this only waits for the
+    // nodes that are being written to, not for every node on the way down.
     for (;;) {
         block_id_t node_id;
         {
@@ -524,7 +567,8 @@ void find_keyvalue_location_for_read(
         {
             PROFILE_STARTER_IF_ENABLED(
                 trace != nullptr, "Acquire a block for read.", trace);
-            buf_lock_t tmp(&buf, node_id, access_t::read);
+            buf_lock_t tmp
+                = acquire_next_node_for_read(buf_parent_t(&buf), key, node_id);
             buf.reset_buf_lock();
             buf = std::move(tmp);
         }
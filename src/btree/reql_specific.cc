@@ -173,10 +173,81 @@ btree_slice_t::btree_slice_t(cache_t *c, perfmon_collection_t *parent,
     : stats(parent,
             (index_type == index_type_t::SECONDARY ? "index-" : "") + identifier),
       cache_(c),
-      backfill_account_(cache()->create_cache_account(BACKFILL_CACHE_PRIORITY)) { }
+      backfill_account_(cache()->create_cache_account(
+          BACKFILL_CACHE_PRIORITY, cache_access_pattern_t::BYPASS,
+          io_class_t::backfill)),
+      key_filter_wanted_(false),
+      key_filter_disabled_(false) { }
 
 btree_slice_t::~btree_slice_t() { }
 
+bool btree_slice_t::may_contain_key(const btree_key_t *key) {
+    assert_thread();
+    if (key_filter_disabled_) {
+        return true;
+    }
+    if (!key_filter_.has()) {
+        key_filter_wanted_ = !pending_key_filter_.has();
+        return true;
+    }
+    if (key_filter_->is_overfull() && !pending_key_filter_.has()) {
+        if (key_filter_->is_max_size()) {
+            // A rebuild couldn't make it any bigger, and its false positive rate only
+            // gets worse from here.
+            disable_key_filter();
+            return true;
+        }
+        key_filter_wanted_ = true;
+    }
+    if (key_filter_->may_contain(key)) {
+        return true;
+    }
+    stats.pm_total_keys_filtered += 1;
+    return false;
+}
+
+void btree_slice_t::note_key_missing() {
+    if (key_filter_.has()) {
+        stats.pm_total_key_filter_false_positives += 1;
+    }
+}
+
+void btree_slice_t::note_key_inserted(const btree_key_t *key) {
+    assert_thread();
+    if (key_filter_.has()) {
+        key_filter_->insert(key);
+    }
+    if (pending_key_filter_.has()) {
+        pending_key_filter_->insert(key);
+    }
+}
+
+key_filter_t *btree_slice_t::start_key_filter(uint64_t expected_keys) {
+    assert_thread();
+    guarantee(!pending_key_filter_.has());
+    pending_key_filter_.init(new key_filter_t(expected_keys));
+    key_filter_wanted_ = false;
+    return pending_key_filter_.get();
+}
+
+void btree_slice_t::disable_key_filter() {
+    assert_thread();
+    guarantee(!pending_key_filter_.has());
+    key_filter_.reset();
+    key_filter_wanted_ = false;
+    key_filter_disabled_ = true;
+}
+
+void btree_slice_t::finish_key_filter(bool success) {
+    assert_thread();
+    guarantee(pending_key_filter_.has());
+    if (success) {
+        key_filter_ = std::move(pending_key_filter_);
+    } else {
+        pending_key_filter_.reset();
+    }
+}
+
 void superblock_metainfo_iterator_t::advance(char * p) {
     char* cur = p;
     if (cur == end) {
@@ -367,8 +438,10 @@ void get_btree_superblock_and_txn_for_writing(
         int expected_change_count,
         write_durability_t durability,
         scoped_ptr_t<real_superblock_t> *got_superblock_out,
-        scoped_ptr_t<txn_t> *txn_out) {
-    txn_t *txn = new txn_t(cache_conn, durability, expected_change_count);
+        scoped_ptr_t<txn_t> *txn_out,
+        signal_t *interruptor)
+        THROWS_ONLY(interrupted_exc_t) {
+    txn_t *txn = new txn_t(cache_conn, durability, expected_change_count, interruptor);
 
     txn_out->init(txn);
 
@@ -2,6 +2,7 @@
 #ifndef BTREE_REQL_SPECIFIC_HPP_
 #define BTREE_REQL_SPECIFIC_HPP_
 
+#include "btree/key_filter.hpp"
 #include "btree/operations.hpp"
 
 /* Most of the code in the `btree/` directory doesn't "know" about the format of the
@@ -98,6 +99,26 @@ public:
     cache_t *cache() { return cache_; }
     cache_account_t *get_backfill_account() { return &backfill_account_; }
 
+    /* The key filter lets point lookups on a primary btree skip keys that definitely
+    aren't there.  It isn't persisted: `store_t` builds it from a traversal the first
+    time a lookup wants it (see `store_t::maybe_build_key_filter()`), and until then
+    `may_contain_key()` always returns `true`.  Every key inserted into the btree must
+    be passed to `note_key_inserted()`, including while the filter is being built. */
+    bool may_contain_key(const btree_key_t *key);
+    // Called when a lookup that `may_contain_key()` let through found nothing.
+    void note_key_missing();
+    void note_key_inserted(const btree_key_t *key);
+    // Whether a lookup would have liked a (bigger) filter and none is being built.
+    bool key_filter_wanted() const { return key_filter_wanted_; }
+    // Starts building a new filter.  Keys inserted from now on are added to it; the
+    // caller has to add the ones that are already in the btree and then call
+    // `finish_key_filter()`.
+    key_filter_t *start_key_filter(uint64_t expected_keys);
+    void finish_key_filter(bool success);
+    // Drops the filter for good, for btrees that have too many keys for one that fits
+    // in `KEY_FILTER_MAX_BYTES`.
+    void disable_key_filter();
+
     btree_stats_t stats;
 
 private:
@@ -106,6 +127,11 @@ private:
     // Cache account to be used when backfilling.
     cache_account_t backfill_account_;
 
+    scoped_ptr_t<key_filter_t> key_filter_;
+    scoped_ptr_t<key_filter_t> pending_key_filter_;
+    bool key_filter_wanted_;
+    bool key_filter_disabled_;
+
     DISABLE_COPYING(btree_slice_t);
 };
 
@@ -192,7 +218,9 @@ void get_btree_superblock_and_txn_for_writing(
         int expected_change_count,
         write_durability_t durability,
         scoped_ptr_t<real_superblock_t> *got_superblock_out,
-        scoped_ptr_t<txn_t> *txn_out);
+        scoped_ptr_t<txn_t> *txn_out,
+        signal_t *interruptor)
+        THROWS_ONLY(interrupted_exc_t);
 
 void get_btree_superblock_and_txn_for_backfilling(
         cache_conn_t *cache_conn,
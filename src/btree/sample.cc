@@ -0,0 +1,208 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "btree/sample.hpp"
+
+#include <algorithm>
+#include <set>
+#include <vector>
+
+#include "btree/internal_node.hpp"
+#include "btree/leaf_node.hpp"
+#include "btree/node.hpp"
+#include "btree/operations.hpp"
+#include "buffer_cache/alt.hpp"
+#include "random.hpp"
+
+// The children of `node` that can have keys in `range`.
+static void overlapping_children(const internal_node_t *node, const key_range_t &range,
+                                 std::vector<block_id_t> *children_out) {
+    for (int i = 0; i < node->npairs; ++i) {
+        // Child `i` has the keys after the key of pair `i - 1`, up to and including
+        // the key of pair `i`.  The last child has no right bound.
+        const btree_internal_pair *pair = internal_node::get_pair_by_index(node, i);
+        if (i != node->npairs - 1
+            && btree_key_cmp(&pair->key, range.left.btree_key()) < 0) {
+            continue;
+        }
+        if (i != 0 && !range.right.unbounded) {
+            const btree_internal_pair *left_pair =
+                internal_node::get_pair_by_index(node, i - 1);
+            if (btree_key_cmp(&left_pair->key, range.right.key().btree_key()) >= 0) {
+                break;
+            }
+        }
+        children_out->push_back(pair->lnode);
+    }
+}
+
+static void keys_in_range(const leaf_node_t *node, const key_range_t &range,
+                          std::vector<leaf::iterator> *keys_out) {
+    for (auto it = leaf::begin(*node); it != leaf::end(*node); ++it) {
+        if (range.contains_key((*it).first)) {
+            keys_out->push_back(it);
+        }
+    }
+}
+
+/* Descends to a random key in `range`, and returns the product of the numbers of
+choices along the way, which is the inverse of the probability of ending up at that
+key, and an unbiased estimate of the number of keys in `range`.  Returns 0 if the
+descent ended up where `range` has no keys.
+
+If `cb` isn't null, the key is then kept with a probability of the estimate divided by
+`*bound`, so that every key is kept with about the same probability of `1 / *bound`
+however unevenly the tree is filled, and passed to `cb` unless it's already in
+`*picked`.  `*bound` is raised to the estimate if the estimate is bigger. */
+static int64_t random_descent(buf_parent_t parent, block_id_t root_id,
+                              const key_range_t &range,
+                              int64_t *bound,
+                              std::set<store_key_t> *picked,
+                              btree_sample_callback_t *cb) {
+    buf_lock_t buf(parent, root_id, access_t::read);
+    int64_t estimate = 1;
+    std::vector<block_id_t> children;
+    for (;;) {
+        block_id_t child_id;
+        {
+            buf_read_t read(&buf);
+            const node_t *node = static_cast<const node_t *>(read.get_data_read());
+            if (!node::is_internal(node)) {
+                break;
+            }
+            children.clear();
+            overlapping_children(reinterpret_cast<const internal_node_t *>(node), range,
+                                 &children);
+            if (children.empty()) {
+                return 0;
+            }
+            estimate *= children.size();
+            child_id = children[randsize(children.size())];
+        }
+        buf_lock_t tmp(buf_parent_t(&buf), child_id, access_t::read);
+        buf.reset_buf_lock();
+        buf = std::move(tmp);
+    }
+
+    buf_read_t read(&buf);
+    const leaf_node_t *node = static_cast<const leaf_node_t *>(read.get_data_read());
+    std::vector<leaf::iterator> keys;
+    keys_in_range(node, range, &keys);
+    if (keys.empty()) {
+        return 0;
+    }
+    estimate *= keys.size();
+    if (cb != nullptr) {
+        *bound = std::max(*bound, estimate);
+        if (randuint64(*bound) < static_cast<uint64_t>(estimate)) {
+            const std::pair<const btree_key_t *, const void *> pair =
+                *keys[randsize(keys.size())];
+            if (picked->insert(store_key_t(pair.first)).second) {
+                cb->on_sample(pair.first, pair.second, buf_parent_t(&buf));
+            }
+        }
+    }
+    return estimate;
+}
+
+/* Calls `fn` with each key in `range` below `block_id`, in order. */
+template <class fn_t>
+static void for_each_key(buf_parent_t parent, block_id_t block_id,
+                         const key_range_t &range, const fn_t &fn) {
+    buf_lock_t buf(parent, block_id, access_t::read);
+    std::vector<block_id_t> children;
+    {
+        buf_read_t read(&buf);
+        const node_t *node = static_cast<const node_t *>(read.get_data_read());
+        if (!node::is_internal(node)) {
+            std::vector<leaf::iterator> keys;
+            keys_in_range(reinterpret_cast<const leaf_node_t *>(node), range, &keys);
+            for (const leaf::iterator &it : keys) {
+                fn((*it).first, (*it).second, buf_parent_t(&buf));
+            }
+            return;
+        }
+        overlapping_children(reinterpret_cast<const internal_node_t *>(node), range,
+                             &children);
+    }
+    for (block_id_t child_id : children) {
+        for_each_key(buf_parent_t(&buf), child_id, range, fn);
+    }
+}
+
+/* Picks keys in `range` that aren't in `picked` at random, and calls `cb` with them,
+until `num` keys are picked in all or `range` has no more.  Returns the number of keys
+in `range`. */
+static uint64_t scan_sample(buf_parent_t parent, block_id_t root_id,
+                            const key_range_t &range, uint64_t num,
+                            const std::set<store_key_t> &picked,
+                            btree_sample_callback_t *cb) {
+    // Count the keys, and then go through them again to pick the rest.
+    uint64_t count = 0;
+    for_each_key(parent, root_id, range,
+                 [&](const btree_key_t *, const void *, buf_parent_t) {
+                     ++count;
+                 });
+    guarantee(picked.size() <= std::min(num, count));
+    const uint64_t unpicked = count - picked.size();
+    const uint64_t wanted = std::min(num, count) - picked.size();
+    // Floyd's algorithm picks `wanted` distinct indexes with equal probabilities.
+    std::set<uint64_t> picked_indexes;
+    for (uint64_t i = unpicked - wanted; i < unpicked; ++i) {
+        const uint64_t index = randuint64(i + 1);
+        if (!picked_indexes.insert(index).second) {
+            picked_indexes.insert(i);
+        }
+    }
+    if (picked_indexes.empty()) {
+        return count;
+    }
+    // The indexes count only the keys that aren't picked yet.
+    uint64_t index = 0;
+    for_each_key(parent, root_id, range,
+                 [&](const btree_key_t *key, const void *value, buf_parent_t leaf) {
+                     if (!picked.empty() && picked.count(store_key_t(key)) == 1) {
+                         return;
+                     }
+                     if (picked_indexes.count(index) == 1) {
+                         cb->on_sample(key, value, leaf);
+                     }
+                     ++index;
+                 });
+    return count;
+}
+
+int64_t sample_btree(superblock_t *superblock, const key_range_t &range, uint64_t num,
+                     btree_sample_callback_t *cb) {
+    const block_id_t root_id = superblock->get_root_block_id();
+    if (root_id == NULL_BLOCK_ID || num == 0) {
+        return 0;
+    }
+    const buf_parent_t parent = superblock->expose_buf();
+
+    int64_t estimate_sum = 0;
+    int64_t bound = 1;
+    uint64_t descents = 0;
+    for (; descents < BTREE_SAMPLE_PILOT_DESCENTS; ++descents) {
+        const int64_t estimate =
+            random_descent(parent, root_id, range, nullptr, nullptr, nullptr);
+        estimate_sum += estimate;
+        bound = std::max(bound, estimate);
+    }
+
+    std::set<store_key_t> picked;
+    if (static_cast<uint64_t>(estimate_sum / descents)
+            <= num * BTREE_SAMPLE_FULL_SCAN_FACTOR) {
+        return scan_sample(parent, root_id, range, num, picked, cb);
+    }
+
+    const uint64_t max_descents =
+        BTREE_SAMPLE_PILOT_DESCENTS + num * BTREE_SAMPLE_DESCENTS_PER_KEY;
+    for (; picked.size() < num && descents < max_descents; ++descents) {
+        estimate_sum += random_descent(parent, root_id, range, &bound, &picked, cb);
+    }
+    if (picked.size() < num) {
+        // The descents kept finding keys that were already picked, or were turned
+        // down, so the rest are picked from a full scan, which also counts the keys.
+        return scan_sample(parent, root_id, range, num, picked, cb);
+    }
+    return estimate_sum / descents;
+}
@@ -0,0 +1,55 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef BTREE_SAMPLE_HPP_
+#define BTREE_SAMPLE_HPP_
+
+#include <stdint.h>
+
+#include "btree/keys.hpp"
+#include "buffer_cache/types.hpp"
+
+class buf_parent_t;
+class superblock_t;
+
+/* How many random descents estimate the number of keys in the range before any keys
+are picked. */
+#define BTREE_SAMPLE_PILOT_DESCENTS 8
+
+/* A range with at most this many times as many keys as were asked for is sampled by
+going through all of its keys, since random descents would mostly find keys that were
+already picked. */
+#define BTREE_SAMPLE_FULL_SCAN_FACTOR 4
+
+/* Random descents give up after this many descents per key that was asked for, in case
+they keep finding keys that were already picked or turning keys down, and the rest of
+the keys are picked from a full scan. */
+#define BTREE_SAMPLE_DESCENTS_PER_KEY 8
+
+class btree_sample_callback_t {
+public:
+    // `value` is on `leaf`, which stays locked until this returns.
+    virtual void on_sample(const btree_key_t *key, const void *value,
+                           buf_parent_t leaf) = 0;
+protected:
+    virtual ~btree_sample_callback_t() { }
+};
+
+/* Calls `cb` for `num` distinct keys in `range`, picked at random, or for all of them if
+`range` has fewer, and returns an estimate of how many keys `range` has.  Doesn't
+release `superblock`.
+
+Each key is found by a descent from the root that picks one of the children of each
+internal node that overlap `range`, and then one of the leaf's keys in `range`, with
+equal probabilities.  The product of the numbers of choices along a descent is the
+inverse of the probability of finding that key, and an unbiased estimate of the number
+of keys in `range`; the estimate that's returned is the average over all descents.  A
+key that's found is kept with a probability proportional to that product, so keys in
+sparse subtrees aren't favoured over keys in full ones.  The largest product seen so
+far serves as the bound for that, so the keys kept before a larger one turns up are
+slightly biased, and the sample is close to uniform rather than exactly uniform.
+
+If the estimate is small, or the descents don't find enough keys, the rest are picked
+from a scan of all of the keys instead, and the count that's returned is exact. */
+int64_t sample_btree(superblock_t *superblock, const key_range_t &range, uint64_t num,
+                     btree_sample_callback_t *cb);
+
+#endif  // BTREE_SAMPLE_HPP_
@@ -14,7 +14,10 @@ public:
               &pm_keys_read, "keys_read",
               &pm_total_keys_read, "total_keys_read",
               &pm_keys_set, "keys_set",
-              &pm_total_keys_set, "total_keys_set") {
+              &pm_total_keys_set, "total_keys_set",
+              &pm_total_keys_filtered, "total_keys_filtered",
+              &pm_total_key_filter_false_positives,
+              "total_key_filter_false_positives") {
         if (parent != nullptr) {
             rename(parent, identifier);
         }
@@ -40,7 +43,11 @@ public:
         pm_keys_set;
     perfmon_counter_t
         pm_total_keys_read,
-        pm_total_keys_set;
+        pm_total_keys_set,
+        // Point lookups that the key filter answered without reading the btree, and
+        // ones it let through for keys that turned out not to exist.
+        pm_total_keys_filtered,
+        pm_total_key_filter_false_positives;
     perfmon_multi_membership_t pm_keys_membership;
 };
 
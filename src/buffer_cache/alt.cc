@@ -4,8 +4,10 @@
 
 #include "arch/types.hpp"
 #include "arch/runtime/coroutines.hpp"
+#include "arch/runtime/resource_usage.hpp"
 #include "buffer_cache/stats.hpp"
 #include "concurrency/auto_drainer.hpp"
+#include "concurrency/cond_var.hpp"
 #include "utils.hpp"
 
 #define ALT_DEBUG 0
@@ -30,6 +32,12 @@ const double SOFT_UNWRITTEN_CHANGES_MEMORY_FRACTION = 0.5;
 // proportionally to the unwritten block changes limit
 const int64_t INDEX_CHANGES_LIMIT_FACTOR = 5;
 
+// How full the unwritten block changes semaphore has to be before
+// `alt_txn_throttler_t` starts to pace new transactions, and the weight of each new
+// flush in its moving average of the flush bandwidth.
+const double THROTTLE_START_FRACTION = 0.5;
+const double WRITTEN_CHANGES_RATE_WEIGHT = 0.2;
+
 // There are very few ASSERT_NO_CORO_WAITING calls (instead we have
 // ASSERT_FINITE_CORO_WAITING) because most of the time we're at the mercy of the
 // page cache, which often may need to load or evict blocks, which may involve a
@@ -64,6 +72,9 @@ private:
 
 alt_txn_throttler_t::alt_txn_throttler_t(int64_t minimum_unwritten_changes_limit)
     : minimum_unwritten_changes_limit_(minimum_unwritten_changes_limit),
+      written_changes_per_sec_(0),
+      next_txn_start_{0},
+      throttled_micros_(0),
       unwritten_block_changes_semaphore_(SOFT_UNWRITTEN_CHANGES_LIMIT),
       unwritten_index_changes_semaphore_(
           SOFT_UNWRITTEN_CHANGES_LIMIT * INDEX_CHANGES_LIMIT_FACTOR) { }
@@ -72,7 +83,10 @@ alt_txn_throttler_t::~alt_txn_throttler_t() { }
 
 throttler_acq_t alt_txn_throttler_t::begin_txn_or_throttle(
         write_durability_t durability,
-        int64_t expected_change_count) {
+        int64_t expected_change_count,
+        signal_t *interruptor)
+        THROWS_ONLY(interrupted_exc_t) {
+    pace_txn(expected_change_count, interruptor);
     throttler_acq_t acq(durability, expected_change_count);
     if (!acq.pre_spawn_flush()) {
         // Changes don't count until we "want" to flush the txn -- which for hard
@@ -103,6 +117,51 @@ void alt_txn_throttler_t::inform_memory_limit_change(uint64_t memory_limit,
     unwritten_block_changes_semaphore_.set_capacity(throttler_limit);
 }
 
+void alt_txn_throttler_t::inform_changes_written(int64_t block_changes,
+                                                 int64_t micros) {
+    if (block_changes <= 0) {
+        return;
+    }
+    const double rate = block_changes * 1000000.0 / std::max<int64_t>(micros, 1);
+    if (written_changes_per_sec_ == 0) {
+        written_changes_per_sec_ = rate;
+    } else {
+        written_changes_per_sec_ += WRITTEN_CHANGES_RATE_WEIGHT
+            * (rate - written_changes_per_sec_);
+    }
+}
+
+void alt_txn_throttler_t::pace_txn(int64_t expected_change_count,
+                                   signal_t *interruptor)
+        THROWS_ONLY(interrupted_exc_t) {
+    const double fill = static_cast<double>(unwritten_block_changes_semaphore_.current())
+        / unwritten_block_changes_semaphore_.capacity();
+    if (written_changes_per_sec_ == 0 || fill <= THROTTLE_START_FRACTION) {
+        return;
+    }
+    // 0 when we start pacing, 1 once the semaphore is full, at which point changes
+    // come in exactly as fast as they are written.
+    const double pressure =
+        std::min(1.0, (fill - THROTTLE_START_FRACTION) / (1 - THROTTLE_START_FRACTION));
+    const int64_t delay_nanos = static_cast<int64_t>(
+        std::max<int64_t>(expected_change_count, 1) * pressure * BILLION
+        / written_changes_per_sec_);
+    const ticks_t now = get_ticks();
+    next_txn_start_.nanos = std::max(next_txn_start_.nanos, now.nanos) + delay_nanos;
+    // We only sleep once the delays add up to at least a millisecond; shorter ones
+    // are made up for by the transactions after us.
+    const int64_t wait_ms = (next_txn_start_.nanos - now.nanos) / MILLION;
+    if (wait_ms > 0) {
+        try {
+            nap(wait_ms, interruptor);
+        } catch (const interrupted_exc_t &) {
+            throttled_micros_ += (get_ticks().nanos - now.nanos) / THOUSAND;
+            throw;
+        }
+        throttled_micros_ += (get_ticks().nanos - now.nanos) / THOUSAND;
+    }
+}
+
 int64_t clamp_ring_length(which_cpu_shard_t w, int64_t interval) {
     if (w.which_shard == 0) {
         return interval;
@@ -122,7 +181,8 @@ cache_t::cache_t(serializer_t *serializer,
           // Smear it over 6.25% of the time.  (Not a well thought-through number.)
           // 6.25% is a worst case -- we'll smear faster if we can.
           page_cache_.soft_durability_interval_flush(
-              ticks_t{get_ticks().nanos + soft_durability_flusher_.interval_ms() * MILLION / 16});
+              ticks_t{get_ticks().nanos + soft_durability_flusher_.interval_ms() * MILLION / 16},
+              soft_durability_flusher_.interval_ms());
       }),
       which_cpu_shard_(which_cpu_shard) {
 
@@ -141,8 +201,22 @@ void cache_t::configure_flush_interval(flush_interval_t interval) {
         clamp_ring_length(which_cpu_shard_, interval.millis));
 }
 
-cache_account_t cache_t::create_cache_account(int priority) {
-    return page_cache_.create_cache_account(priority);
+void cache_t::configure_reservation(const cache_reservation_t &reservation) {
+    page_cache_.evicter().set_reservation(reservation);
+}
+
+std::vector<block_id_t> cache_t::hot_block_ids() {
+    return page_cache_.evicter().hot_block_ids();
+}
+
+void cache_t::warm_up(std::vector<block_id_t> block_ids, signal_t *interruptor)
+        THROWS_ONLY(interrupted_exc_t) {
+    page_cache_.warm_up(std::move(block_ids), interruptor);
+}
+
+cache_account_t cache_t::create_cache_account(
+        int priority, cache_access_pattern_t access_pattern, io_class_t io_class) {
+    return page_cache_.create_cache_account(priority, access_pattern, io_class);
 }
 
 alt_snapshot_node_t *
@@ -226,7 +300,8 @@ txn_t::txn_t(cache_conn_t *cache_conn,
     // Right now, cache_conn is only used to control flushing of write txns.  When we
     // need to support other cache_conn_t related features, we'll need to do something
     // fancier with read txns on cache conns.
-    help_construct(0, nullptr);
+    cond_t non_interruptor;
+    help_construct(0, nullptr, &non_interruptor);
 }
 
 txn_t::txn_t(cache_conn_t *cache_conn,
@@ -237,12 +312,26 @@ txn_t::txn_t(cache_conn_t *cache_conn,
       access_(access_t::write),
       durability_(durability),
       is_committed_(false) {
+    cond_t non_interruptor;
+    help_construct(expected_change_count, cache_conn, &non_interruptor);
+}
 
-    help_construct(expected_change_count, cache_conn);
+txn_t::txn_t(cache_conn_t *cache_conn,
+             write_durability_t durability,
+             int64_t expected_change_count,
+             signal_t *interruptor)
+    : cache_(cache_conn->cache()),
+      cache_account_(cache_->page_cache_.default_reads_account()),
+      access_(access_t::write),
+      durability_(durability),
+      is_committed_(false) {
+    help_construct(expected_change_count, cache_conn, interruptor);
 }
 
 void txn_t::help_construct(int64_t expected_change_count,
-                           cache_conn_t *cache_conn) {
+                           cache_conn_t *cache_conn,
+                           signal_t *interruptor)
+        THROWS_ONLY(interrupted_exc_t) {
     cache_->assert_thread();
     guarantee(expected_change_count >= 0);
     // We skip the throttler for read transactions.
@@ -254,7 +343,8 @@ void txn_t::help_construct(int64_t expected_change_count,
     }
     throttler_acq_t throttler_acq(
         access_ == access_t::write
-        ? cache_->throttler_.begin_txn_or_throttle(durability_, expected_change_count)
+        ? cache_->throttler_.begin_txn_or_throttle(
+            durability_, expected_change_count, interruptor)
         : throttler_acq_t(durability_, expected_change_count));
 
     ASSERT_FINITE_CORO_WAITING;
@@ -300,6 +390,20 @@ void txn_t::set_account(cache_account_t *cache_account) {
     cache_account_ = cache_account;
 }
 
+void txn_t::set_scanning(bool scanning) {
+    cache_account_t *default_account = cache_->page_cache_.default_reads_account();
+    cache_account_t *scan_account = cache_->page_cache_.scan_reads_account();
+    if (scanning && cache_account_ == default_account) {
+        cache_account_ = scan_account;
+    } else if (!scanning && cache_account_ == scan_account) {
+        cache_account_ = default_account;
+    }
+}
+
+const void *txn_t::peek_block_for_read(block_id_t block_id) {
+    return cache_->page_cache_.peek_current_page_for_read(block_id, cache_account_);
+}
+
 
 alt_snapshot_node_t::alt_snapshot_node_t(scoped_ptr_t<current_page_acq_t> &&acq)
     : current_page_acq_(std::move(acq)), ref_count_(0) { }
@@ -793,12 +897,27 @@ void buf_lock_t::set_recency(repli_timestamp_t recency) {
     current_page_acq_->set_recency(recency);
 }
 
+// Waits for `signal`, and if that blocks, charges the time to `wait_nanos` of
+// whatever the current coroutine is charged to.
+static void wait_charging_usage(signal_t *signal,
+                                int64_t resource_usage_t::*wait_nanos) {
+    resource_usage_t *usage =
+        signal->is_pulsed() ? nullptr : current_resource_usage();
+    if (usage == nullptr) {
+        signal->wait();
+        return;
+    }
+    const int64_t start_nanos = get_ticks().nanos;
+    signal->wait();
+    usage->*wait_nanos += get_ticks().nanos - start_nanos;
+}
+
 page_t *buf_lock_t::get_held_page_for_read() {
     guarantee(!empty());
     current_page_acq_t *cpa = current_page_acq();
     guarantee(cpa != nullptr);
     // We only wait here so that we can guarantee(!empty()) after it's pulsed.
-    cpa->read_acq_signal()->wait();
+    wait_charging_usage(cpa->read_acq_signal(), &resource_usage_t::lock_wait_nanos);
 
     ASSERT_FINITE_CORO_WAITING;
     guarantee(!empty());
@@ -809,7 +928,8 @@ page_t *buf_lock_t::get_held_page_for_write() {
     guarantee(!empty());
     rassert(snapshot_node_ == nullptr);
     // We only wait here so that we can guarantee(!empty()) after it's pulsed.
-    current_page_acq_->write_acq_signal()->wait();
+    wait_charging_usage(current_page_acq_->write_acq_signal(),
+                        &resource_usage_t::lock_wait_nanos);
 
     ASSERT_FINITE_CORO_WAITING;
     guarantee(!empty());
@@ -833,7 +953,8 @@ const void *buf_read_t::get_data_read(uint16_t *block_size_out) {
         page_acq_.init(page, &lock_->cache()->page_cache_,
                        lock_->txn()->account());
     }
-    page_acq_.buf_ready_signal()->wait();
+    wait_charging_usage(page_acq_.buf_ready_signal(),
+                        &resource_usage_t::load_wait_nanos);
     *block_size_out = page_acq_.get_buf_size().value();
     return page_acq_.get_buf_read();
 }
@@ -855,7 +976,8 @@ void *buf_write_t::get_data_write(uint16_t block_size) {
         page_acq_.init(page, &lock_->cache()->page_cache_,
                        lock_->txn()->account());
     }
-    page_acq_.buf_ready_signal()->wait();
+    wait_charging_usage(page_acq_.buf_ready_signal(),
+                        &resource_usage_t::load_wait_nanos);
     return page_acq_.get_buf_write(block_size_t::make_from_cache(block_size));
 }
 
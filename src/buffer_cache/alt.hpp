@@ -26,14 +26,47 @@ public:
     ~alt_txn_throttler_t();
 
     alt::throttler_acq_t begin_txn_or_throttle(
-        write_durability_t durability, int64_t expected_change_count);
+        write_durability_t durability, int64_t expected_change_count,
+        signal_t *interruptor)
+        THROWS_ONLY(interrupted_exc_t);
 
     void inform_memory_limit_change(uint64_t memory_limit,
                                     block_size_t max_block_size);
 
+    // Called by the page cache when a flush has written `block_changes` blocks in
+    // `micros` microseconds.
+    void inform_changes_written(int64_t block_changes, int64_t micros);
+
+    // The throttler's state, for the stats.
+    int64_t unwritten_block_changes() const {
+        return unwritten_block_changes_semaphore_.current();
+    }
+    int64_t unwritten_block_changes_limit() const {
+        return unwritten_block_changes_semaphore_.capacity();
+    }
+    double written_changes_per_sec() const { return written_changes_per_sec_; }
+    uint64_t throttled_micros() const { return throttled_micros_; }
+
 private:
+    // Once the unwritten changes fill more than THROTTLE_START_FRACTION of their
+    // limit, this delays new transactions so that changes come in at a rate that
+    // falls smoothly towards the rate at which flushes write them out, instead of
+    // letting writers run until the semaphores stop them dead.  Each transaction
+    // reserves its start time before it sleeps, so they still start in the order
+    // they came in.
+    void pace_txn(int64_t expected_change_count, signal_t *interruptor)
+        THROWS_ONLY(interrupted_exc_t);
+
     const int64_t minimum_unwritten_changes_limit_;
 
+    // A moving average of the rate at which flushes write changes, or 0 until the
+    // first flush that wasn't smeared over a soft durability interval.
+    double written_changes_per_sec_;
+    // When the next transaction may start if we're pacing them.
+    ticks_t next_txn_start_;
+    // The total time that `pace_txn()` has delayed transactions for.
+    uint64_t throttled_micros_;
+
     new_semaphore_t unwritten_block_changes_semaphore_;
     new_semaphore_t unwritten_index_changes_semaphore_;
 
@@ -55,9 +88,19 @@ public:
     // throttling systems.  TODO: Come up with a consistent priority scheme,
     // i.e. define a "default" priority etc.  TODO: As soon as we can support it, we
     // might consider supporting a mem_cap parameter.
-    cache_account_t create_cache_account(int priority);
+    cache_account_t create_cache_account(
+        int priority,
+        cache_access_pattern_t access_pattern = cache_access_pattern_t::RANDOM,
+        io_class_t io_class = io_class_t::foreground_read);
 
     void configure_flush_interval(flush_interval_t interval);
+    void configure_reservation(const cache_reservation_t &reservation);
+
+    // For the hot block manifest, see `evicter_t::hot_block_ids()` and
+    // `page_cache_t::warm_up()`.
+    std::vector<block_id_t> hot_block_ids();
+    void warm_up(std::vector<block_id_t> block_ids, signal_t *interruptor)
+        THROWS_ONLY(interrupted_exc_t);
 
 private:
     friend class txn_t;
@@ -96,6 +139,13 @@ public:
           write_durability_t durability,
           int64_t expected_change_count);
 
+    // Like the above, but stops waiting for the throttler if `interruptor` is pulsed.
+    txn_t(cache_conn_t *cache_conn,
+          write_durability_t durability,
+          int64_t expected_change_count,
+          signal_t *interruptor)
+        THROWS_ONLY(interrupted_exc_t);
+
     ~txn_t();
 
     // Every write transaction must be committed before it's
@@ -111,8 +161,21 @@ public:
     void set_account(cache_account_t *cache_account);
     cache_account_t *account() { return cache_account_; }
 
+    // Makes a transaction that reads through the default reads account use the
+    // cache's scan reads account instead (or, if `scanning` is false, switches it
+    // back).  Transactions with an account of their own are left alone.
+    void set_scanning(bool scanning);
+
+    // Returns the current contents of the block if a reader could see them right away,
+    // without waiting for write acquirers, or null.  The block doesn't get acquired,
+    // so the pointer is only valid until the caller blocks.  Don't use this on blocks
+    // that are under a snapshotted buf_lock_t.
+    const void *peek_block_for_read(block_id_t block_id);
+
 private:
-    void help_construct(int64_t expected_change_count, cache_conn_t *cache_conn);
+    void help_construct(int64_t expected_change_count, cache_conn_t *cache_conn,
+                        signal_t *interruptor)
+        THROWS_ONLY(interrupted_exc_t);
 
     cache_t *const cache_;
 
@@ -314,6 +377,10 @@ public:
         return txn_->cache();
     }
 
+    bool is_snapshotted() const {
+        return lock_or_null_ != nullptr && lock_or_null_->is_snapshotted();
+    }
+
 private:
     friend class buf_lock_t;
     txn_t *txn_;
@@ -8,6 +8,7 @@
 
 #include "buffer_cache/alt.hpp"
 #include "concurrency/pmap.hpp"
+#include "config/args.hpp"
 #include "containers/buffer_group.hpp"
 #include "containers/scoped.hpp"
 #include "math.hpp"
@@ -19,6 +20,11 @@
 // can allocate.
 const int64_t BLOB_TRAVERSAL_CONCURRENCY = 8;
 
+// The maximal number of leaf blocks whose loads are waited for concurrently when a
+// blob is exposed for reading.  The leaves stay in memory until the blob is released
+// anyway, so this only bounds how many reads are in flight at once.
+const int64_t BLOB_LEAF_READ_CONCURRENCY = 64;
+
 template <class T>
 void clear_and_delete(std::vector<T *> *vec) {
     while (!vec->empty()) {
@@ -218,6 +224,15 @@ int64_t value_size(const char *ref, int maxreflen) {
 
 
 int btree_maxreflen = 251;
+
+int btree_maxreflen_for(max_block_size_t block_size) {
+    // Existing data files have the default block size and depend on this staying
+    // `btree_maxreflen` for them.
+    if (block_size.ser_value() <= DEFAULT_BTREE_BLOCK_SIZE) {
+        return btree_maxreflen;
+    }
+    return block_size.ser_value() / (DEFAULT_BTREE_BLOCK_SIZE / 256);
+}
 block_magic_t internal_node_magic = { { 'l', 'a', 'r', 'i' } };
 block_magic_t leaf_node_magic = { { 'l', 'a', 'r', 'l' } };
 
@@ -441,6 +456,24 @@ void expose_tree_from_block_ids(buf_parent_t parent, access_t mode,
     blob::compute_acquisition_offsets(parent.cache()->max_block_size(), levels,
                                       offset, size, &lo, &hi);
 
+    // A leaf is only loaded once its data is asked for, so asking for the leaves one
+    // after another would wait for each of their disk reads in turn.  They're asked
+    // for concurrently instead, before they're exposed below.
+    std::vector<buf_read_t *> leaf_reads;
+    std::vector<const void *> leaf_bufs;
+    if (levels == 1 && mode == access_t::read) {
+        leaf_reads.resize(hi - lo);
+        leaf_bufs.resize(hi - lo);
+        for (int i = 0; i < hi - lo; ++i) {
+            leaf_reads[i] = new buf_read_t(tree[i].buf);
+        }
+        throttled_pmap(hi - lo, [&](int64_t i) {
+            // See the comment about the block size below.
+            uint16_t block_size;
+            leaf_bufs[i] = leaf_reads[i]->get_data_read(&block_size);
+        }, BLOB_LEAF_READ_CONCURRENCY);
+    }
+
     for (int i = 0; i < hi - lo; ++i) {
         int64_t suboffset, subsize;
         blob::shrink(parent.cache()->max_block_size(), levels, offset, size,
@@ -457,14 +490,12 @@ void expose_tree_from_block_ids(buf_parent_t parent, access_t mode,
             buf_lock_t *buf = tree[i].buf;
             void *leaf_buf;
             if (mode == access_t::read) {
-                buf_read_t *buf_read = new buf_read_t(buf);
                 // We can't assert a specific block size here (without undesirably
                 // intricate logic), because immediately after creation, the blob has
                 // size max_value_size, but after we've written to the block, its
                 // size could be shrunken.
-                uint16_t block_size;
-                leaf_buf = const_cast<void *>(buf_read->get_data_read(&block_size));
-                acq_group_out->add_buf(buf, buf_read);
+                leaf_buf = const_cast<void *>(leaf_bufs[i]);
+                acq_group_out->add_buf(buf, leaf_reads[i]);
             } else {
                 buf_write_t *buf_write = new buf_write_t(buf);
                 if (touches_end == touches_end_t::yes) {
@@ -562,6 +593,48 @@ void blob_t::write_from_string(const std::string &val,
     buffer_group_copy_data(&dest, const_view(&src));
 }
 
+bool blob_t::rewrite_changed_blocks(const std::vector<char> &val,
+                                    buf_parent_t parent) {
+    if (valuesize() != static_cast<int64_t>(val.size())
+        || blob::ref_info(parent.cache()->max_block_size(), ref_, maxreflen_).levels
+           == 0) {
+        return false;
+    }
+
+    // The byte ranges of the leaves whose contents change, with neighbouring leaves
+    // merged into one range.
+    std::vector<std::pair<int64_t, int64_t> > changed;
+    {
+        buffer_group_t current;
+        blob_acq_t acq;
+        expose_all(parent, access_t::read, &current, &acq);
+        int64_t offset = 0;
+        for (size_t i = 0; i < current.num_buffers(); ++i) {
+            buffer_group_t::buffer_t buf = current.get_buffer(i);
+            if (memcmp(buf.data, val.data() + offset, buf.size) != 0) {
+                if (!changed.empty()
+                    && changed.back().first + changed.back().second == offset) {
+                    changed.back().second += buf.size;
+                } else {
+                    changed.push_back(std::make_pair(offset, buf.size));
+                }
+            }
+            offset += buf.size;
+        }
+    }
+
+    for (const auto &range : changed) {
+        buffer_group_t dest;
+        blob_acq_t acq;
+        expose_region(parent, access_t::write, range.first, range.second, &dest, &acq);
+
+        buffer_group_t src;
+        src.add_buffer(range.second, val.data() + range.first);
+        buffer_group_copy_data(&dest, const_view(&src));
+    }
+    return true;
+}
+
 namespace blob {
 
 struct traverse_helper_t {
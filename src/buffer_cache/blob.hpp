@@ -123,6 +123,13 @@ void shrink(max_block_size_t block_size, int levels, int64_t offset, int64_t siz
 // It's 251.  This should be renamed.
 extern int btree_maxreflen;
 
+// The maxreflen of values in rdb_protocol btrees with the given block size, which is
+// also the size up to which values are stored inline in the leaf node.  It's
+// `btree_maxreflen` for the default block size and smaller ones, and grows with the
+// block size beyond that, so that every leaf fits about the same number of
+// maximum-size values.
+int btree_maxreflen_for(max_block_size_t block_size);
+
 // The size of a blob, equivalent to blob_t(ref, maxreflen).valuesize().
 int64_t value_size(const char *ref, int maxreflen);
 
@@ -202,6 +209,12 @@ public:
     void write_from_string(const std::string &val, buf_parent_t root,
                            int64_t offset);
 
+    // Writes val over the whole blob, acquiring for write only the leaf blocks whose
+    // bytes change.  Returns false without changing anything if val isn't exactly
+    // the blob's size or if the blob is stored inline in its ref, in which case the
+    // caller has to rewrite the blob.
+    bool rewrite_changed_blocks(const std::vector<char> &val, buf_parent_t root);
+
 private:
     bool traverse_to_dimensions(buf_parent_t parent, int levels,
                                 int64_t smaller_size, int64_t bigger_size,
@@ -0,0 +1,109 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "buffer_cache/block_trace.hpp"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+
+#include "arch/io/concurrency.hpp"
+#include "arch/runtime/runtime.hpp"
+#include "concurrency/cache_line_padded.hpp"
+#include "config/args.hpp"
+#include "time.hpp"
+
+static_assert(sizeof(block_trace_record_t) == 24,
+              "block trace records are written to the file as they are");
+
+// The start of every trace file, which also serves as its version.
+static const char block_trace_magic[8] = {'r', 'd', 'b', 't', 'r', 'c', '0', '1'};
+
+static FILE *block_trace_file = nullptr;
+static system_mutex_t block_trace_file_mutex;
+static std::atomic<uint32_t> block_trace_next_cache_number(0);
+static std::array<cache_line_padded_t<std::vector<block_trace_record_t> >, MAX_THREADS>
+    block_trace_buffers;
+
+bool block_trace_t::start(const std::string &path) {
+    guarantee(block_trace_file == nullptr);
+    FILE *file = fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        return false;
+    }
+    if (fwrite(block_trace_magic, sizeof(block_trace_magic), 1, file) != 1) {
+        fclose(file);
+        return false;
+    }
+    block_trace_file = file;
+    return true;
+}
+
+bool block_trace_t::is_enabled() {
+    return block_trace_file != nullptr;
+}
+
+uint32_t block_trace_t::new_cache_number() {
+    return block_trace_next_cache_number++;
+}
+
+void block_trace_t::record(uint32_t cache, block_id_t block_id,
+                           block_trace_access_t access) {
+    const int thread = get_thread_id().threadnum;
+    std::vector<block_trace_record_t> *buffer = &block_trace_buffers[thread].value;
+    block_trace_record_t record;
+    record.nanos = get_ticks().nanos;
+    record.block_id = block_id;
+    record.cache = cache;
+    record.thread = thread;
+    record.access = access;
+    record.unused = 0;
+    buffer->push_back(record);
+    if (buffer->size() >= BLOCK_TRACE_BUFFER_RECORDS) {
+        flush();
+    }
+}
+
+void block_trace_t::flush() {
+    std::vector<block_trace_record_t> *buffer =
+        &block_trace_buffers[get_thread_id().threadnum].value;
+    if (block_trace_file == nullptr || buffer->empty()) {
+        return;
+    }
+    {
+        // This blocks the thread on the disk, but only every few thousand
+        // acquisitions, and only while tracing.
+        system_mutex_t::lock_t lock(&block_trace_file_mutex);
+        size_t res = fwrite(buffer->data(), sizeof(block_trace_record_t),
+                            buffer->size(), block_trace_file);
+        guarantee_err(res == buffer->size(), "Could not write to the cache trace");
+        guarantee_err(fflush(block_trace_file) == 0,
+                      "Could not write to the cache trace");
+    }
+    buffer->clear();
+}
+
+bool block_trace_t::read(const std::string &path,
+                         std::vector<block_trace_record_t> *out) {
+    FILE *file = fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        return false;
+    }
+    char magic[sizeof(block_trace_magic)];
+    bool ok = fread(magic, sizeof(magic), 1, file) == 1
+        && memcmp(magic, block_trace_magic, sizeof(magic)) == 0;
+    out->clear();
+    block_trace_record_t record;
+    while (ok && fread(&record, sizeof(record), 1, file) == 1) {
+        out->push_back(record);
+    }
+    ok = ok && !ferror(file);
+    fclose(file);
+
+    std::stable_sort(out->begin(), out->end(),
+                     [](const block_trace_record_t &a, const block_trace_record_t &b) {
+                         return a.nanos < b.nanos;
+                     });
+    return ok;
+}
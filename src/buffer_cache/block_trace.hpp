@@ -0,0 +1,66 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef BUFFER_CACHE_BLOCK_TRACE_HPP_
+#define BUFFER_CACHE_BLOCK_TRACE_HPP_
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "serializer/types.hpp"
+
+/* How many records each thread buffers before it appends them to the trace file. */
+#define BLOCK_TRACE_BUFFER_RECORDS 4096
+
+/* Reads are recorded by the cache access pattern of the account they go through (see
+`cache_access_pattern_t`), since that changes how some eviction policies treat them. */
+enum class block_trace_access_t : uint8_t {
+    READ = 0,
+    SCAN_READ = 1,
+    BYPASS_READ = 2,
+    WRITE = 3,
+    CREATE = 4
+};
+
+/* One block access, as it is stored in the trace file. */
+struct block_trace_record_t {
+    // When the block was accessed, from `get_ticks()`.
+    int64_t nanos;
+    block_id_t block_id;
+    // Which page cache the block belongs to.  Page caches are numbered in the order
+    // they were created, so the numbers only mean something within one trace.
+    uint32_t cache;
+    uint16_t thread;
+    block_trace_access_t access;
+    uint8_t unused;
+};
+
+/* Records every block access of every page cache to a file, for the cache trace
+replay in `rethinkdb-bench`.  Writes are recorded when the block is acquired, reads
+when the acquirer gets the page, which is when a miss loads it.  It is off unless the
+server is started with `--cache-trace`.  Each thread buffers its records and appends
+them to the file when the buffer is full or its page caches are destroyed, so the
+records in the file are only ordered by time within each thread. */
+class block_trace_t {
+public:
+    // Starts recording to a new file at `path`.  Must be called before the thread
+    // pool starts.  Returns false, with errno set, if the file can't be created.
+    static bool start(const std::string &path);
+
+    static bool is_enabled();
+
+    // Returns the number a new page cache records its accesses under.
+    static uint32_t new_cache_number();
+
+    static void record(uint32_t cache, block_id_t block_id,
+                       block_trace_access_t access);
+
+    // Appends what the current thread has buffered to the file.
+    static void flush();
+
+    // Reads the trace at `path`, sorted by time.  Returns false if it can't be read
+    // or isn't a trace.
+    static bool read(const std::string &path, std::vector<block_trace_record_t> *out);
+};
+
+#endif  // BUFFER_CACHE_BLOCK_TRACE_HPP_
@@ -9,6 +9,17 @@ namespace alt {
 class page_cache_t;
 }
 
+// How the transactions using a cache account are expected to touch blocks.  Blocks
+// first loaded or touched through a `SCAN` account are kept "probationary" by
+// scan-resistant eviction policies (see `evicter_t`), so that a full table scan
+// doesn't push the hot set of point reads out of the cache.
+//
+// Blocks loaded through a `BYPASS` account are "transient": they're evicted as soon
+// as nobody holds them, whatever the eviction policy.  Blocks that are already in
+// the cache are read from there, so dirty pages and pages being written are seen as
+// usual.  This is for reads like backfills, which touch every block once.
+enum class cache_access_pattern_t { RANDOM, SCAN, BYPASS };
+
 class cache_account_t {
 public:
     cache_account_t();
@@ -19,17 +30,24 @@ public:
     file_account_t *get() const {
         return io_account_;
     }
+
+    cache_access_pattern_t access_pattern() const {
+        return access_pattern_;
+    }
 private:
     friend class alt::page_cache_t;
     // Takes ownership of the file_account_t pointee.
-    void init(threadnum_t thread, file_account_t *io_account);
-    cache_account_t(threadnum_t thread, file_account_t *io_account);
+    void init(threadnum_t thread, file_account_t *io_account,
+              cache_access_pattern_t access_pattern);
+    cache_account_t(threadnum_t thread, file_account_t *io_account,
+                    cache_access_pattern_t access_pattern);
     void reset();
 
     // I hate having this thread_ variable.  The file_account_t does need to be
     // destroyed on the right thread, though.
     threadnum_t thread_;
     file_account_t *io_account_;
+    cache_access_pattern_t access_pattern_;
     DISABLE_COPYING(cache_account_t);
 };
 
@@ -21,11 +21,15 @@ alt_cache_balancer_t::cache_data_t::cache_data_t(alt::evicter_t *_evicter) :
     evictable_disk_backed_size(evicter->evictable_disk_backed_size()),
     evictable_unbacked_size(evicter->evictable_unbacked_size()),
     bytes_loaded(evicter->get_bytes_loaded()),
-    access_count(evicter->access_count()) { }
+    miss_weight_adjustment(evicter->get_miss_weight_adjustment()),
+    access_count(evicter->access_count()),
+    reservation(evicter->reservation()) { }
 
 alt_cache_balancer_t::alt_cache_balancer_t(
-        clone_ptr_t<watchable_t<uint64_t> > _total_cache_size_watchable) :
+        clone_ptr_t<watchable_t<uint64_t> > _total_cache_size_watchable,
+        eviction_policy_t _eviction_policy) :
     total_cache_size_watchable(_total_cache_size_watchable),
+    eviction_policy_(_eviction_policy),
     rebalance_timer(make_scoped<repeating_timer_t>(rebalance_check_interval_ms, this)),
     rebalance_timer_state(rebalance_timer_state_t::normal),
     last_rebalance_time{0},
@@ -120,12 +124,14 @@ void alt_cache_balancer_t::rebalance_blocking(UNUSED signal_t *interruptor) {
     // Sum up the number of evicters, bytes loaded, and access counts
     size_t total_evicters = 0;
     uint64_t total_bytes_loaded = 0;
+    uint64_t total_demand = 0;
     uint64_t total_access_count = 0;
     for (size_t i = 0; i < num_threads; ++i) {
         total_evicters += cache_data[i].size();
         all_zero_access_counts &= zero_access_counts[i];
         for (size_t j = 0; j < cache_data[i].size(); ++j) {
             total_bytes_loaded += std::max<int64_t>(0, cache_data[i][j].bytes_loaded);
+            total_demand += cache_data[i][j].demand();
             total_access_count += cache_data[i][j].access_count;
         }
     }
@@ -161,11 +167,15 @@ void alt_cache_balancer_t::rebalance_blocking(UNUSED signal_t *interruptor) {
                 cache_data_t *data = &cache_data[i][j];
 
                 if (total_cache_size > 0) {
+                    // Every cache gives up memory in proportion to its size, and
+                    // gets it back in proportion to its demand.  So memory goes to
+                    // the caches whose misses it's most likely to save, and the
+                    // ones that take expensive random reads.
                     double temp = data->old_size;
                     temp /= static_cast<double>(total_cache_size);
-                    temp *= static_cast<double>(total_bytes_loaded);
+                    temp *= static_cast<double>(total_demand);
 
-                    int64_t new_size = std::max<int64_t>(0, data->bytes_loaded);
+                    int64_t new_size = data->demand();
                     new_size -= static_cast<int64_t>(temp);
                     new_size += data->old_size;
                     new_size = std::max<int64_t>(new_size, 0);
@@ -244,6 +254,8 @@ void alt_cache_balancer_t::rebalance_blocking(UNUSED signal_t *interruptor) {
 
         }
 
+        apply_reservations(total_cache_size, &cache_data);
+
         // Send new cache sizes to each thread
         pmap(num_threads,
              std::bind(&alt_cache_balancer_t::apply_rebalance_to_thread,
@@ -262,6 +274,95 @@ void alt_cache_balancer_t::rebalance_blocking(UNUSED signal_t *interruptor) {
     }
 }
 
+void alt_cache_balancer_t::apply_reservations(
+        uint64_t total_cache_size,
+        scoped_array_t<std::vector<cache_data_t> > *cache_data) {
+    std::vector<cache_data_t *> caches;
+    double total_min = 0;
+    bool any_reservations = false;
+    for (size_t i = 0; i < cache_data->size(); ++i) {
+        for (cache_data_t &data : (*cache_data)[i]) {
+            caches.push_back(&data);
+            total_min += data.reservation.min_bytes;
+            any_reservations |= data.reservation.min_bytes != 0
+                || data.reservation.max_bytes != UINT64_MAX;
+        }
+    }
+    if (!any_reservations) {
+        return;
+    }
+
+    const double min_scale = total_min > total_cache_size
+        ? total_cache_size / total_min
+        : 1.0;
+    std::vector<uint64_t> mins(caches.size());
+    for (size_t i = 0; i < caches.size(); ++i) {
+        mins[i] = caches[i]->reservation.min_bytes * min_scale;
+    }
+
+    // Each pass clamps the caches that are outside their reservations and spreads
+    // the difference over the rest, in proportion to their sizes, which may push
+    // some of those out of theirs.  Every pass but the last clamps at least one more
+    // cache, so this ends.
+    std::vector<bool> clamped(caches.size(), false);
+    for (;;) {
+        int64_t extra_bytes = 0;
+        for (size_t i = 0; i < caches.size(); ++i) {
+            cache_data_t *data = caches[i];
+            if (clamped[i]) {
+                continue;
+            }
+            if (data->new_size < mins[i]) {
+                extra_bytes -= mins[i] - data->new_size;
+                data->new_size = mins[i];
+                clamped[i] = true;
+            } else if (data->new_size > data->reservation.max_bytes) {
+                extra_bytes += data->new_size - data->reservation.max_bytes;
+                data->new_size = data->reservation.max_bytes;
+                clamped[i] = true;
+            }
+        }
+        if (extra_bytes == 0) {
+            break;
+        }
+
+        uint64_t unclamped_size = 0;
+        size_t unclamped_count = 0;
+        for (size_t i = 0; i < caches.size(); ++i) {
+            if (!clamped[i]) {
+                unclamped_size += caches[i]->new_size;
+                ++unclamped_count;
+            }
+        }
+        if (unclamped_count == 0) {
+            // Every cache is at a limit.  Memory that no cache may take stays unused.
+            break;
+        }
+
+        int64_t remaining = extra_bytes;
+        size_t last = 0;
+        for (size_t i = 0; i < caches.size(); ++i) {
+            if (clamped[i]) {
+                continue;
+            }
+            last = i;
+            const double share = unclamped_size > 0
+                ? static_cast<double>(caches[i]->new_size) / unclamped_size
+                : 1.0 / unclamped_count;
+            int64_t delta = static_cast<int64_t>(extra_bytes * share);
+            // Avoid underflow
+            delta = std::max<int64_t>(delta, -static_cast<int64_t>(caches[i]->new_size));
+            caches[i]->new_size += delta;
+            remaining -= delta;
+        }
+        // The rounding error goes to the last one.
+        if (remaining != 0) {
+            caches[last]->new_size = std::max<int64_t>(
+                0, static_cast<int64_t>(caches[last]->new_size) + remaining);
+        }
+    }
+}
+
 void alt_cache_balancer_t::collect_stats_from_thread(
         int index,
         scoped_array_t<std::vector<cache_data_t> > *data_out,
@@ -298,6 +399,7 @@ void alt_cache_balancer_t::apply_rebalance_to_thread(int index,
         if (evicters->find(new_size.evicter) != evicters->end()) {
             new_size.evicter->update_memory_limit(new_size.new_size,
                                                   new_size.bytes_loaded,
+                                                  new_size.miss_weight_adjustment,
                                                   new_size.access_count,
                                                   new_read_ahead_ok);
         }
@@ -2,12 +2,16 @@
 #define BUFFER_CACHE_CACHE_BALANCER_HPP_
 
 #include <stdint.h>
+
+#include <algorithm>
 #include <set>
 #include <vector>
 
 #include "errors.hpp"
 #include "time.hpp"
 
+#include "buffer_cache/types.hpp"
+
 #include "threading.hpp"
 #include "arch/timing.hpp"
 #include "concurrency/pump_coro.hpp"
@@ -18,6 +22,17 @@ namespace alt {
 class evicter_t;
 }
 
+// How a cache's evicter picks the pages to evict.
+enum class eviction_policy_t {
+    // Evicts the least recently used of a few randomly sampled pages.
+    SAMPLED_LRU,
+    // Like `SAMPLED_LRU`, but pages that have only been touched by scans (see
+    // `cache_access_pattern_t`) or by read-ahead stay probationary and get evicted
+    // before any page that has been accessed normally.  A scan of a block that was
+    // recently evicted while probationary admits it normally, in the style of 2Q.
+    SCAN_RESISTANT
+};
+
 // Base class so we can have a dummy implementation for tests
 class cache_balancer_t : public home_thread_mixin_t {
 public:
@@ -30,6 +45,9 @@ public:
     // Tells caches whether to start read ahead initially
     virtual bool read_ahead_ok_at_start() const = 0;
 
+    // Tells caches how to choose pages for eviction
+    virtual eviction_policy_t eviction_policy() const = 0;
+
     // Returns a pointer to a boolean for the given thread number (which must be the
     // current thread) which, when set to true, means you should notify the balancer
     // that it should wake up.  Stuff outside the balancer should only set it from
@@ -55,8 +73,11 @@ protected:
 // Dummy balancer that does nothing but provide the initial size of a cache
 class dummy_cache_balancer_t final : public cache_balancer_t {
 public:
-    explicit dummy_cache_balancer_t(uint64_t _base_mem_per_store)
+    explicit dummy_cache_balancer_t(
+            uint64_t _base_mem_per_store,
+            eviction_policy_t _eviction_policy = eviction_policy_t::SAMPLED_LRU)
         : base_mem_per_store_(_base_mem_per_store),
+          eviction_policy_(_eviction_policy),
           notify_activity_boolean_(false) { }
     ~dummy_cache_balancer_t() { }
 
@@ -68,6 +89,10 @@ public:
         return false;
     }
 
+    eviction_policy_t eviction_policy() const final {
+        return eviction_policy_;
+    }
+
     bool *notify_activity_boolean(threadnum_t) final {
         return &notify_activity_boolean_;
     }
@@ -79,6 +104,7 @@ private:
     void remove_evicter(alt::evicter_t *) { }
 
     uint64_t base_mem_per_store_;
+    eviction_policy_t eviction_policy_;
 
     bool notify_activity_boolean_;
 
@@ -90,7 +116,8 @@ class alt_cache_balancer_t final :
     public repeating_timer_callback_t {
 public:
     explicit alt_cache_balancer_t(
-        clone_ptr_t<watchable_t<uint64_t> > _total_cache_size_watchable);
+        clone_ptr_t<watchable_t<uint64_t> > _total_cache_size_watchable,
+        eviction_policy_t _eviction_policy = eviction_policy_t::SCAN_RESISTANT);
     ~alt_cache_balancer_t();
 
     uint64_t base_mem_per_store() const final {
@@ -101,6 +128,10 @@ public:
         return true;
     }
 
+    eviction_policy_t eviction_policy() const final {
+        return eviction_policy_;
+    }
+
     bool *notify_activity_boolean(threadnum_t thread) final;
 
     void wake_up_activity_happened() final;
@@ -148,9 +179,27 @@ private:
         uint64_t evictable_unbacked_size;
 
         int64_t bytes_loaded;
+        int64_t miss_weight_adjustment;
         uint64_t access_count;
+
+        cache_reservation_t reservation;
+
+        // What the cache gets memory for: the bytes it loaded, with the misses
+        // weighted by how much more memory would have saved them, and by what they
+        // cost, times the priority of its table.  See `evicter_t::note_miss()`.
+        int64_t demand() const {
+            return static_cast<int64_t>(
+                std::max<int64_t>(0, bytes_loaded + miss_weight_adjustment)
+                * reservation.priority);
+        }
     };
 
+    // Moves the new sizes into the caches' reservations, giving what that frees up
+    // or takes to the caches that are still within theirs.  If the reservations'
+    // minimums add up to more than the total cache size, they are scaled down.
+    void apply_reservations(uint64_t total_cache_size,
+                            scoped_array_t<std::vector<cache_data_t> > *cache_data);
+
     // Helper function to collect stats from each thread so we don't need
     //  atomic variables slowing down normal operations
     void collect_stats_from_thread(int index,
@@ -162,6 +211,7 @@ private:
                                    bool new_read_ahead_ok);
 
     clone_ptr_t<watchable_t<uint64_t> > total_cache_size_watchable;
+    const eviction_policy_t eviction_policy_;
     scoped_ptr_t<repeating_timer_t> rebalance_timer;
     enum class rebalance_timer_state_t {
         // Normal operating condition: there is a timer, and it'll ping soon.  Can
@@ -1,7 +1,14 @@
 #include "buffer_cache/evicter.hpp"
 
+#include <zlib.h>
+
+#include <algorithm>
+#include <unordered_set>
+
 #include "arch/runtime/coroutines.hpp"
+#include "arch/runtime/memory_usage.hpp"
 #include "buffer_cache/alt.hpp"
+#include "buffer_cache/cache_account.hpp"
 #include "buffer_cache/page.hpp"
 #include "buffer_cache/page_cache.hpp"
 #include "buffer_cache/cache_balancer.hpp"
@@ -14,15 +21,31 @@ evicter_t::evicter_t()
       balancer_(nullptr),
       balancer_notify_activity_boolean_(nullptr),
       throttler_(nullptr),
+      eviction_policy_(eviction_policy_t::SAMPLED_LRU),
       bytes_loaded_counter_(0),
       access_count_counter_(0),
       access_time_counter_(INITIAL_ACCESS_TIME),
       evict_if_necessary_active_(false),
+      unevictable_(true),
+      evictable_disk_backed_(true),
+      evictable_probationary_(true),
+      evictable_transient_(true),
+      evictable_unbacked_(true),
+      evicted_(false),
+      ghost_sequence_counter_(0),
+      evicted_bytes_counter_(0),
+      miss_weight_adjustment_(0),
+      ghost_hits_(0),
+      reservation_{0, UINT64_MAX, 1},
+      compressed_size_(0),
       last_force_flush_time_(ticks_t{0}) { }
 
 evicter_t::~evicter_t() {
     assert_thread();
     drainer_.drain();
+    while (compressed_pages_.head() != nullptr) {
+        remove_compressed_copy(compressed_pages_.head());
+    }
     if (initialized_) {
         balancer_->remove_evicter(this);
     }
@@ -37,6 +60,7 @@ void evicter_t::initialize(page_cache_t *page_cache,
     initialized_ = true;  // Can you really say this class is 'initialized_'?
     page_cache_ = page_cache;
     memory_limit_ = balancer->base_mem_per_store();
+    eviction_policy_ = balancer->eviction_policy();
     page_cache_ = page_cache;
     throttler_ = throttler;
     balancer_ = balancer;
@@ -49,6 +73,7 @@ void evicter_t::initialize(page_cache_t *page_cache,
 
 void evicter_t::update_memory_limit(uint64_t new_memory_limit,
                                     int64_t bytes_loaded_accounted_for,
+                                    int64_t miss_weight_adjustment_accounted_for,
                                     uint64_t access_count_accounted_for,
                                     bool read_ahead_ok) {
     guarantee_initialized();
@@ -58,6 +83,7 @@ void evicter_t::update_memory_limit(uint64_t new_memory_limit,
     }
 
     bytes_loaded_counter_ -= bytes_loaded_accounted_for;
+    miss_weight_adjustment_ -= miss_weight_adjustment_accounted_for;
     access_count_counter_ -= access_count_accounted_for;
     memory_limit_ = new_memory_limit;
     evict_if_necessary();
@@ -72,6 +98,19 @@ void wake_up_balancer(cache_balancer_t *balancer,
     balancer->wake_up_activity_happened();
 }
 
+void evicter_t::set_reservation(const cache_reservation_t &reservation) {
+    guarantee_initialized();
+    reservation_ = reservation;
+    // The balancer may be asleep if the table is idle.
+    if (*balancer_notify_activity_boolean_) {
+        *balancer_notify_activity_boolean_ = false;
+
+        coro_t::spawn_sometime(std::bind(&wake_up_balancer,
+                                         balancer_,
+                                         drainer_.lock()));
+    }
+}
+
 void evicter_t::notify_bytes_loading(int64_t in_memory_buf_change) {
     guarantee_initialized();
     bytes_loaded_counter_ += in_memory_buf_change;
@@ -127,7 +166,10 @@ void evicter_t::add_to_evictable_unbacked(page_t *page) {
 
 void evicter_t::add_to_evictable_disk_backed(page_t *page) {
     guarantee_initialized();
-    evictable_disk_backed_.add(page, page->hypothetical_memory_usage(page_cache_));
+    eviction_bag_t *bag = correct_eviction_category(page);
+    rassert(bag == &evictable_disk_backed_ || bag == &evictable_probationary_
+            || bag == &evictable_transient_);
+    bag->add(page, page->hypothetical_memory_usage(page_cache_));
     evict_if_necessary();
     notify_bytes_loading(page->hypothetical_memory_usage(page_cache_));
 }
@@ -138,6 +180,8 @@ void evicter_t::move_unevictable_to_evictable(page_t *page) {
     unevictable_.remove(page, page->hypothetical_memory_usage(page_cache_));
     eviction_bag_t *new_bag = correct_eviction_category(page);
     rassert(new_bag == &evictable_disk_backed_
+            || new_bag == &evictable_probationary_
+            || new_bag == &evictable_transient_
             || new_bag == &evictable_unbacked_);
     new_bag->add(page, page->hypothetical_memory_usage(page_cache_));
     evict_if_necessary();
@@ -153,6 +197,21 @@ void evicter_t::change_to_correct_eviction_bag(eviction_bag_t *current_bag,
     evict_if_necessary();
 }
 
+const void *evicter_t::peek_page_buf(page_t *page, const cache_account_t *account) {
+    guarantee_initialized();
+    rassert(page->is_loaded());
+    eviction_bag_t *old_bag = correct_eviction_category(page);
+    const void *buf = page->get_page_buf(page_cache_, is_scan(account));
+    eviction_bag_t *new_bag = correct_eviction_category(page);
+    if (new_bag != old_bag) {
+        // The page's memory usage is the same in either bag, so there is nothing
+        // to evict.
+        old_bag->remove(page, page->hypothetical_memory_usage(page_cache_));
+        new_bag->add(page, page->hypothetical_memory_usage(page_cache_));
+    }
+    return buf;
+}
+
 eviction_bag_t *evicter_t::correct_eviction_category(page_t *page) {
     guarantee_initialized();
     if (page->is_loading() || page->has_waiters()) {
@@ -160,6 +219,13 @@ eviction_bag_t *evicter_t::correct_eviction_category(page_t *page) {
     } else if (!page->is_loaded()) {
         return &evicted_;
     } else if (page->is_disk_backed()) {
+        if (page->access_time() == TRANSIENT_ACCESS_TIME) {
+            return &evictable_transient_;
+        }
+        if (eviction_policy_ == eviction_policy_t::SCAN_RESISTANT
+            && page->access_time() == PROBATIONARY_ACCESS_TIME) {
+            return &evictable_probationary_;
+        }
         return &evictable_disk_backed_;
     } else {
         return &evictable_unbacked_;
@@ -168,16 +234,211 @@ eviction_bag_t *evicter_t::correct_eviction_category(page_t *page) {
 
 void evicter_t::remove_page(page_t *page) {
     guarantee_initialized();
+    auto it = compressed_pages_by_page_.find(page);
+    if (it != compressed_pages_by_page_.end()) {
+        remove_compressed_copy(it->second);
+    }
     eviction_bag_t *bag = correct_eviction_category(page);
     bag->remove(page, page->hypothetical_memory_usage(page_cache_));
     evict_if_necessary();
 }
 
+bool evicter_t::is_scan(const cache_account_t *account) const {
+    guarantee_initialized();
+    if (account == nullptr) {
+        return false;
+    }
+    return account->access_pattern() == cache_access_pattern_t::BYPASS
+        || (eviction_policy_ == eviction_policy_t::SCAN_RESISTANT
+            && account->access_pattern() == cache_access_pattern_t::SCAN);
+}
+
+uint64_t evicter_t::access_time_for_load(block_id_t block_id,
+                                         const cache_account_t *account) {
+    guarantee_initialized();
+    if (account != nullptr
+        && account->access_pattern() == cache_access_pattern_t::BYPASS) {
+        return TRANSIENT_ACCESS_TIME;
+    }
+    // A block that was evicted as a probationary page not long ago is apparently
+    // being scanned over and over, so it's admitted like any other page.
+    if (is_scan(account) && !take_ghost(block_id)) {
+        return PROBATIONARY_ACCESS_TIME;
+    }
+    return next_access_time();
+}
+
+void evicter_t::add_ghost(block_id_t block_id) {
+    // We remember about as many ghosts as half the number of blocks that fit into
+    // the cache.
+    const uint64_t max_ghosts =
+        std::max<uint64_t>(16, memory_limit_ / page_cache_->max_block_size().ser_value()
+                               / 2);
+    const uint64_t sequence = ++ghost_sequence_counter_;
+    ghosts_[block_id] = sequence;
+    ghost_queue_.push_back(std::make_pair(block_id, sequence));
+    while (ghost_queue_.size() > max_ghosts) {
+        auto it = ghosts_.find(ghost_queue_.front().first);
+        if (it != ghosts_.end() && it->second == ghost_queue_.front().second) {
+            ghosts_.erase(it);
+        }
+        ghost_queue_.pop_front();
+    }
+}
+
+bool evicter_t::take_ghost(block_id_t block_id) {
+    return ghosts_.erase(block_id) != 0;
+}
+
+void evicter_t::add_evicted_block(page_t *page) {
+    evicted_bytes_counter_ += page->hypothetical_memory_usage(page_cache_);
+    evicted_blocks_[page->block_id()] = evicted_bytes_counter_;
+    evicted_blocks_queue_.push_back(
+        std::make_pair(page->block_id(), evicted_bytes_counter_));
+    const uint64_t window = memory_limit_ * CACHE_BALANCER_GHOST_FRACTION;
+    while (evicted_blocks_queue_.front().second + window < evicted_bytes_counter_) {
+        auto it = evicted_blocks_.find(evicted_blocks_queue_.front().first);
+        if (it != evicted_blocks_.end()
+            && it->second == evicted_blocks_queue_.front().second) {
+            evicted_blocks_.erase(it);
+        }
+        evicted_blocks_queue_.pop_front();
+    }
+}
+
+void evicter_t::note_miss(page_t *page, const cache_account_t *account) {
+    guarantee_initialized();
+    // The memory limit may have shrunk since the block was evicted, so we check the
+    // distance again.
+    const uint64_t window = memory_limit_ * CACHE_BALANCER_GHOST_FRACTION;
+    auto it = evicted_blocks_.find(page->block_id());
+    const bool ghost_hit = it != evicted_blocks_.end()
+        && it->second + window >= evicted_bytes_counter_;
+    if (it != evicted_blocks_.end()) {
+        evicted_blocks_.erase(it);
+    }
+
+    double weight = ghost_hit ? 1.0 : CACHE_BALANCER_COLD_MISS_WEIGHT;
+    if (account != nullptr
+        && account->access_pattern() != cache_access_pattern_t::RANDOM) {
+        weight *= CACHE_BALANCER_SEQUENTIAL_MISS_WEIGHT;
+    }
+    miss_weight_adjustment_ += static_cast<int64_t>(
+        (weight - 1.0) * page->hypothetical_memory_usage(page_cache_));
+    if (ghost_hit) {
+        ++ghost_hits_;
+    }
+}
+
+void evicter_t::add_compressed_copy(page_t *page) {
+    const uint64_t pool_limit = memory_limit_ * COMPRESSED_PAGE_POOL_FRACTION;
+    const block_size_t block_size = page->get_page_buf_size();
+    const uLong source_size = block_size.ser_value();
+    uLongf size = compressBound(source_size);
+    scoped_malloc_t<char> data(size);
+    int res = compress2(reinterpret_cast<Bytef *>(data.get()), &size,
+                        reinterpret_cast<const Bytef *>(page->get_loaded_ser_buffer()),
+                        source_size, Z_BEST_SPEED);
+    guarantee(res == Z_OK, "compress2 failed with %d", res);
+    if (size > source_size * COMPRESSED_PAGE_MAX_RATIO || size > pool_limit) {
+        return;
+    }
+
+    compressed_page_t *compressed
+        = new compressed_page_t(page, block_size, data.get(), size);
+    compressed_pages_.push_back(compressed);
+    compressed_pages_by_page_[page] = compressed;
+    compressed_size_ += size;
+    add_memory_usage(memory_tag_t::PAGE_CACHE, size);
+
+    while (compressed_size_ > pool_limit) {
+        drop_oldest_compressed_copy();
+    }
+}
+
+void evicter_t::remove_compressed_copy(compressed_page_t *compressed) {
+    compressed_pages_.remove(compressed);
+    compressed_pages_by_page_.erase(compressed->page);
+    compressed_size_ -= compressed->size;
+    add_memory_usage(memory_tag_t::PAGE_CACHE, -static_cast<int64_t>(compressed->size));
+    delete compressed;
+}
+
+bool evicter_t::drop_oldest_compressed_copy() {
+    compressed_page_t *oldest = compressed_pages_.head();
+    if (oldest == nullptr) {
+        return false;
+    }
+    const block_id_t block_id = oldest->page->block_id();
+    remove_compressed_copy(oldest);
+    // The copy was the only reason to keep the current_page_t around.
+    page_cache_->consider_evicting_current_page(block_id);
+    return true;
+}
+
+bool evicter_t::take_compressed_copy(page_t *page, buf_ptr_t *buf_out) {
+    guarantee_initialized();
+    auto it = compressed_pages_by_page_.find(page);
+    if (it == compressed_pages_by_page_.end()) {
+        return false;
+    }
+    compressed_page_t *compressed = it->second;
+    buf_ptr_t buf = buf_ptr_t::alloc_uninitialized(compressed->block_size);
+    uLongf size = compressed->block_size.ser_value();
+    int res = uncompress(reinterpret_cast<Bytef *>(buf.ser_buffer()), &size,
+                         reinterpret_cast<const Bytef *>(compressed->data.get()),
+                         compressed->size);
+    guarantee(res == Z_OK && size == compressed->block_size.ser_value(),
+              "uncompress failed with %d", res);
+    buf.fill_padding_zero();
+    remove_compressed_copy(compressed);
+    *buf_out = std::move(buf);
+    return true;
+}
+
 uint64_t evicter_t::in_memory_size() const {
     guarantee_initialized();
     return unevictable_.size()
         + evictable_disk_backed_.size()
-        + evictable_unbacked_.size();
+        + evictable_probationary_.size()
+        + evictable_transient_.size()
+        + evictable_unbacked_.size()
+        + compressed_size_;
+}
+
+std::vector<block_id_t> evicter_t::hot_block_ids() const {
+    guarantee_initialized();
+    std::vector<page_t *> pages;
+    unevictable_.append_pages(&pages);
+    evictable_disk_backed_.append_pages(&pages);
+    evictable_unbacked_.append_pages(&pages);
+
+    // Like in `eviction_bag_t::select_oldish`, access times are compared relative to
+    // the current one, in case they overflowed.
+    std::vector<std::pair<uint64_t, block_id_t> > ages;
+    ages.reserve(pages.size());
+    for (page_t *page : pages) {
+        if (!page->is_loaded()
+            || is_aux_block_id(page->block_id())
+            || page->access_time() == PROBATIONARY_ACCESS_TIME
+            || page->access_time() == TRANSIENT_ACCESS_TIME) {
+            continue;
+        }
+        ages.push_back(std::make_pair(access_time_counter_ - page->access_time(),
+                                      page->block_id()));
+    }
+    std::sort(ages.begin(), ages.end());
+
+    // Snapshots can leave several pages for one block.
+    std::vector<block_id_t> block_ids;
+    std::unordered_set<block_id_t> seen;
+    block_ids.reserve(ages.size());
+    for (const auto &pair : ages) {
+        if (seen.insert(pair.second).second) {
+            block_ids.push_back(pair.second);
+        }
+    }
+    return block_ids;
 }
 
 void evicter_t::evict_if_necessary() THROWS_NOTHING {
@@ -195,16 +456,40 @@ void evicter_t::evict_if_necessary() THROWS_NOTHING {
     // currently being written for the purpose of eviction.
 
     evict_if_necessary_active_ = true;
-    page_t *page;
-    while (in_memory_size() > memory_limit_
-           && eviction_bag_t::select_oldish(
-                &evictable_disk_backed_, access_time_counter_, &page)) {
-        uint32_t mem_usage = page->hypothetical_memory_usage(page_cache_);
-        evictable_disk_backed_.remove(page, mem_usage);
-        evicted_.add(page, mem_usage);
-        page->evict_self(page_cache_);
-        page_cache_->consider_evicting_current_page(page->block_id());
+    // Transient pages go whether or not we're over the limit.  Nobody wants them
+    // kept, so they don't get a ghost or a compressed copy either.
+    page_t *transient;
+    while (eviction_bag_t::select_oldish(&evictable_transient_, access_time_counter_,
+                                         &transient)) {
+        evictable_transient_.remove(transient,
+                                    transient->hypothetical_memory_usage(page_cache_));
+        transient->evict_self();
+        evicted_.add(transient, transient->hypothetical_memory_usage(page_cache_));
+        page_cache_->consider_evicting_current_page(transient->block_id());
+    }
+
+    // Probationary pages go first.  (The bag is empty unless the policy is
+    // `SCAN_RESISTANT`.)
+    eviction_bag_t *const bags[] = { &evictable_probationary_,
+                                     &evictable_disk_backed_ };
+    for (eviction_bag_t *bag : bags) {
+        page_t *page;
+        while (in_memory_size() > memory_limit_
+               && eviction_bag_t::select_oldish(bag, access_time_counter_, &page)) {
+            if (bag == &evictable_probationary_) {
+                add_ghost(page->block_id());
+            } else {
+                // Pages that never left probation aren't worth keeping around.
+                add_compressed_copy(page);
+            }
+            add_evicted_block(page);
+            bag->remove(page, page->hypothetical_memory_usage(page_cache_));
+            page->evict_self();
+            evicted_.add(page, page->hypothetical_memory_usage(page_cache_));
+            page_cache_->consider_evicting_current_page(page->block_id());
+        }
     }
+    while (in_memory_size() > memory_limit_ && drop_oldest_compressed_copy()) { }
 
     if (in_memory_size() > memory_limit_) {
         // This is pretty lame and hackish -- we'd like something better tuned.
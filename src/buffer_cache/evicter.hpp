@@ -3,22 +3,44 @@
 
 #include <stdint.h>
 
+#include <deque>
 #include <functional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "buffer_cache/eviction_bag.hpp"
+#include "buffer_cache/types.hpp"
 #include "concurrency/auto_drainer.hpp"
 #include "concurrency/cache_line_padded.hpp"
 #include "concurrency/pubsub.hpp"
+#include "containers/intrusive_list.hpp"
+#include "containers/scoped.hpp"
+#include "serializer/buf_ptr.hpp"
 #include "threading.hpp"
 #include "time.hpp"
 
+class cache_account_t;
 class cache_balancer_t;
 class alt_txn_throttler_t;
+enum class eviction_policy_t;
 
 namespace alt {
 
 class page_cache_t;
 
+// A compressed copy of an evicted page's contents.
+struct compressed_page_t : public intrusive_list_node_t<compressed_page_t> {
+    compressed_page_t(page_t *_page, block_size_t _block_size,
+                      const char *_data, size_t _size)
+        : page(_page), block_size(_block_size), data(_data, _size), size(_size) { }
+
+    page_t *page;
+    block_size_t block_size;
+    scoped_malloc_t<char> data;
+    size_t size;
+};
+
 class evicter_t : public home_thread_mixin_debug_only_t {
 public:
     void add_not_yet_loaded(page_t *page);
@@ -30,11 +52,22 @@ public:
     bool page_is_in_evicted_bag(page_t *page) const;
     void move_unevictable_to_evictable(page_t *page);
     void change_to_correct_eviction_bag(eviction_bag_t *current_bag, page_t *page);
+    // Returns the buffer of `page`, which is loaded, for a read through `account` that
+    // doesn't acquire the page.  The access can take the page out of probation, so
+    // this moves it to the right bag, but it doesn't evict anything.
+    const void *peek_page_buf(page_t *page, const cache_account_t *account);
     eviction_bag_t *correct_eviction_category(page_t *page);
     eviction_bag_t *evicted_category() { return &evicted_; }
     void remove_page(page_t *page);
     void reloading_page(page_t *page);
 
+    // If a compressed copy of the (evicted) page was kept, uncompresses it into
+    // `*buf_out`, forgets about it and returns true.
+    bool take_compressed_copy(page_t *page, buf_ptr_t *buf_out);
+    bool has_compressed_copy(page_t *page) const {
+        return compressed_pages_by_page_.count(page) != 0;
+    }
+
     // Evicter will be unusable until initialize is called
     evicter_t();
     ~evicter_t();
@@ -44,6 +77,7 @@ public:
                     alt_txn_throttler_t *throttler);
     void update_memory_limit(uint64_t new_memory_limit,
                              int64_t bytes_loaded_accounted_for,
+                             int64_t miss_weight_adjustment_accounted_for,
                              uint64_t access_count_accounted_for,
                              bool read_ahead_ok);
 
@@ -52,6 +86,21 @@ public:
         return ++access_time_counter_;
     }
 
+    eviction_policy_t eviction_policy() const {
+        guarantee_initialized();
+        return eviction_policy_;
+    }
+
+    // Whether accesses through `account` should leave probationary and transient
+    // pages as they are.  This is true for `BYPASS` accounts, and for `SCAN` accounts
+    // if the policy is `SCAN_RESISTANT`.
+    bool is_scan(const cache_account_t *account) const;
+
+    // The access time a page for `block_id` should start with when it's loaded
+    // through `account`.  This is `TRANSIENT_ACCESS_TIME`,
+    // `PROBATIONARY_ACCESS_TIME` or a fresh access time.
+    uint64_t access_time_for_load(block_id_t block_id, const cache_account_t *account);
+
     uint64_t memory_limit() const {
         guarantee_initialized();
         return memory_limit_;
@@ -66,7 +115,8 @@ public:
     }
     uint64_t evictable_disk_backed_size() const {
         guarantee_initialized();
-        return evictable_disk_backed_.size();
+        return evictable_disk_backed_.size() + evictable_probationary_.size()
+            + evictable_transient_.size();
     }
     uint64_t evictable_unbacked_size() const {
         guarantee_initialized();
@@ -78,6 +128,34 @@ public:
         return bytes_loaded_counter_;
     }
 
+    // Tells the evicter that `page` is being read from disk through `account`.  The
+    // balancer weighs the bytes loaded by misses by how much they cost and whether
+    // more memory would have saved them, and this is what the weights add to
+    // `get_bytes_loaded()`.
+    void note_miss(page_t *page, const cache_account_t *account);
+    int64_t get_miss_weight_adjustment() const {
+        guarantee_initialized();
+        return miss_weight_adjustment_;
+    }
+    // The number of misses of blocks that were evicted recently enough that a cache
+    // with CACHE_BALANCER_GHOST_FRACTION more memory would still have had them.
+    uint64_t ghost_hits() const {
+        guarantee_initialized();
+        return ghost_hits_;
+    }
+
+    // The balancer applies a new reservation the next time it rebalances.
+    void set_reservation(const cache_reservation_t &reservation);
+    cache_reservation_t reservation() const {
+        guarantee_initialized();
+        return reservation_;
+    }
+
+    // The block ids of the loaded pages, most recently used first, leaving out
+    // probationary and transient pages.  This is what the page cache's hot block
+    // manifest lists.
+    std::vector<block_id_t> hot_block_ids() const;
+
 
     uint64_t in_memory_size() const;
 
@@ -85,6 +163,15 @@ public:
     // rollovers.
     static const uint64_t INITIAL_ACCESS_TIME = UINT64_MAX - 100;
 
+    // Pages with this access time are older than all others, so they get evicted
+    // first.  Read-ahead pages start out this way, and under the `SCAN_RESISTANT`
+    // policy so do pages loaded by a scan.
+    static const uint64_t PROBATIONARY_ACCESS_TIME = INITIAL_ACCESS_TIME - 1;
+
+    // Pages loaded through a `BYPASS` account have this access time until something
+    // else touches them.  They get evicted as soon as they're evictable.
+    static const uint64_t TRANSIENT_ACCESS_TIME = INITIAL_ACCESS_TIME - 2;
+
 private:
     void guarantee_initialized() const {
         assert_thread();
@@ -99,6 +186,21 @@ private:
     // Evicts any evictable pages until under the memory limit
     void evict_if_necessary() THROWS_NOTHING;
 
+    // Remembers that `block_id` was evicted without ever leaving probation.
+    void add_ghost(block_id_t block_id);
+    // Returns true and forgets about `block_id` if it was a recent ghost.
+    bool take_ghost(block_id_t block_id);
+
+    // Remembers that `page` was evicted, for `note_miss()`.
+    void add_evicted_block(page_t *page);
+
+    // Keeps a compressed copy of `page`, which is about to be evicted, if it
+    // compresses well enough.
+    void add_compressed_copy(page_t *page);
+    void remove_compressed_copy(compressed_page_t *compressed);
+    // Drops the oldest compressed copy, and returns false if there was none.
+    bool drop_oldest_compressed_copy();
+
     bool initialized_;
     page_cache_t *page_cache_;
     cache_balancer_t *balancer_;
@@ -108,6 +210,8 @@ private:
 
     uint64_t memory_limit_;
 
+    eviction_policy_t eviction_policy_;
+
     // These are updated every time a page is loaded, created, or destroyed, and
     // cleared when cache memory limits are re-evaluated.  This value can go
     // negative, if you keep deleting blocks or suddenly drop a snapshot.
@@ -124,9 +228,47 @@ private:
     // These track every page's eviction status.
     eviction_bag_t unevictable_;
     eviction_bag_t evictable_disk_backed_;
+    // Under the `SCAN_RESISTANT` policy, disk backed pages with an access time of
+    // `PROBATIONARY_ACCESS_TIME` live here instead of in `evictable_disk_backed_`,
+    // and get evicted before any of those.
+    eviction_bag_t evictable_probationary_;
+    // Disk backed pages with an access time of `TRANSIENT_ACCESS_TIME`.  These are
+    // evicted right away, so the bag only holds pages while eviction is under way.
+    eviction_bag_t evictable_transient_;
     eviction_bag_t evictable_unbacked_;
     eviction_bag_t evicted_;
 
+    // The block ids of pages recently evicted while still probationary ("ghosts"),
+    // oldest first.  We only keep a bounded number of them.  Each entry carries a
+    // sequence number so that stale `ghost_queue_` entries (of block ids that have
+    // since been taken or re-added) can be recognized.
+    std::deque<std::pair<block_id_t, uint64_t> > ghost_queue_;
+    std::unordered_map<block_id_t, uint64_t> ghosts_;
+    uint64_t ghost_sequence_counter_;
+
+    // The blocks evicted recently, with the value `evicted_bytes_counter_` had after
+    // each one was evicted, oldest first.  Unlike the ghosts above, these are kept
+    // for all evicted pages, and only as long as they are within
+    // CACHE_BALANCER_GHOST_FRACTION of the memory limit of being evicted.  Stale
+    // `evicted_blocks_queue_` entries are recognized the same way.
+    std::deque<std::pair<block_id_t, uint64_t> > evicted_blocks_queue_;
+    std::unordered_map<block_id_t, uint64_t> evicted_blocks_;
+    uint64_t evicted_bytes_counter_;
+    // Cleared like `bytes_loaded_counter_`.
+    int64_t miss_weight_adjustment_;
+    uint64_t ghost_hits_;
+
+    // No reservation, until the table's config says otherwise.
+    cache_reservation_t reservation_;
+
+    // Compressed copies of cleanly evicted pages, oldest first.  Their memory counts
+    // towards `in_memory_size()`, and is capped at COMPRESSED_PAGE_POOL_FRACTION of
+    // the memory limit.  A page with a compressed copy keeps its current_page_t,
+    // so that reloading it finds the copy (see `page_t::load_using_block_token`).
+    intrusive_list_t<compressed_page_t> compressed_pages_;
+    std::unordered_map<page_t *, compressed_page_t *> compressed_pages_by_page_;
+    uint64_t compressed_size_;
+
     ticks_t last_force_flush_time_;
 
     auto_drainer_t drainer_;
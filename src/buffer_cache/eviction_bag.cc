@@ -2,14 +2,15 @@
 
 #include <inttypes.h>
 
+#include "arch/runtime/memory_usage.hpp"
 #include "buffer_cache/page.hpp"
 #include "random.hpp"
 #include "utils.hpp"
 
 namespace alt {
 
-eviction_bag_t::eviction_bag_t()
-    : bag_(), size_(0) { }
+eviction_bag_t::eviction_bag_t(bool in_memory)
+    : bag_(), in_memory_(in_memory), size_(0) { }
 
 eviction_bag_t::~eviction_bag_t() {
     guarantee(bag_.size() == 0);
@@ -18,12 +19,12 @@ eviction_bag_t::~eviction_bag_t() {
 
 void eviction_bag_t::change_size(int64_t adjustment) {
     rassert(adjustment >= 0 || size_ >= static_cast<uint64_t>(-adjustment));
-    size_ += adjustment;
+    adjust_size(adjustment);
 }
 
 void eviction_bag_t::add(page_t *page, uint32_t ser_buf_size) {
     bag_.add(page);
-    size_ += ser_buf_size;
+    adjust_size(ser_buf_size);
 }
 
 void eviction_bag_t::remove(page_t *page, uint32_t ser_buf_size) {
@@ -31,13 +32,27 @@ void eviction_bag_t::remove(page_t *page, uint32_t ser_buf_size) {
     uint64_t value = ser_buf_size;
     rassert(value <= size_, "value = %" PRIu64 ", size_ = %" PRIu64,
             value, size_);
-    size_ -= value;
+    adjust_size(-static_cast<int64_t>(value));
+}
+
+void eviction_bag_t::adjust_size(int64_t adjustment) {
+    size_ += adjustment;
+    if (in_memory_) {
+        add_memory_usage(memory_tag_t::PAGE_CACHE, adjustment);
+    }
 }
 
 bool eviction_bag_t::has_page(page_t *page) const {
     return bag_.has_element(page);
 }
 
+void eviction_bag_t::append_pages(std::vector<page_t *> *pages_out) const {
+    pages_out->reserve(pages_out->size() + bag_.size());
+    for (size_t i = 0; i < bag_.size(); ++i) {
+        pages_out->push_back(bag_.access_random(i));
+    }
+}
+
 bool eviction_bag_t::select_oldish(eviction_bag_t *eb, uint64_t access_time_offset,
                                    page_t **page_out) {
     if (eb->bag_.size() == 0) {
@@ -3,6 +3,8 @@
 
 #include <stdint.h>
 
+#include <vector>
+
 #include "containers/backindex_bag.hpp"
 
 namespace alt {
@@ -12,7 +14,9 @@ class page_cache_t;
 
 class eviction_bag_t {
 public:
-    eviction_bag_t();
+    // The pages of a bag that's `in_memory` count as page cache memory in the
+    // server's memory stats.
+    explicit eviction_bag_t(bool in_memory);
     ~eviction_bag_t();
 
     // Adjusts the size, given how much the size has changed of one of the pages in
@@ -30,6 +34,9 @@ public:
 
     uint64_t size() const { return size_; }
 
+    // Appends the bag's pages to `pages_out`, in no particular order.
+    void append_pages(std::vector<page_t *> *pages_out) const;
+
     static bool select_oldish(
         eviction_bag_t *eb, uint64_t access_time_offset,
         page_t **page_out);
@@ -39,7 +46,10 @@ public:
         page_t **page_out);
 
 private:
+    void adjust_size(int64_t adjustment);
+
     backindex_bag_t<page_t *> bag_;
+    const bool in_memory_;
     // The size in memory.
     uint64_t size_;
 
@@ -0,0 +1,90 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "buffer_cache/hot_block_manifest.hpp"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "arch/runtime/thread_pool.hpp"
+#include "arch/types.hpp"
+#include "logger.hpp"
+#include "paths.hpp"
+#include "utils.hpp"
+
+// The start of every manifest, which also serves as its version.  The block count and
+// the block ids follow, as they are in memory; the manifest never leaves the server.
+static const char hot_block_manifest_magic[8] = {'r', 'd', 'b', 'h', 'o', 't', '0', '1'};
+
+bool read_hot_block_manifest(const std::string &path,
+                             std::vector<block_id_t> *block_ids_out) {
+    std::string contents;
+    bool ok;
+    thread_pool_t::run_in_blocker_pool([&]() {
+        ok = blocking_read_file(path.c_str(), &contents);
+    });
+    uint64_t count;
+    const size_t header_size = sizeof(hot_block_manifest_magic) + sizeof(count);
+    if (!ok
+        || contents.size() < header_size
+        || memcmp(contents.data(), hot_block_manifest_magic,
+                  sizeof(hot_block_manifest_magic)) != 0) {
+        return false;
+    }
+    memcpy(&count, contents.data() + sizeof(hot_block_manifest_magic), sizeof(count));
+    const size_t body_size = contents.size() - header_size;
+    if (body_size % sizeof(block_id_t) != 0
+        || body_size / sizeof(block_id_t) != count) {
+        return false;
+    }
+    block_ids_out->resize(count);
+    memcpy(block_ids_out->data(), contents.data() + header_size,
+           count * sizeof(block_id_t));
+    return true;
+}
+
+void write_hot_block_manifest(const std::string &path,
+                              const std::vector<block_id_t> &block_ids) {
+    // We write a temporary file and rename it, so that a crash can't leave a
+    // truncated manifest behind.
+    const std::string temporary_path = path + ".tmp";
+    int errsv = 0;
+    thread_pool_t::run_in_blocker_pool([&]() {
+        FILE *file = fopen(temporary_path.c_str(), "wb");
+        if (file == nullptr) {
+            errsv = get_errno();
+            return;
+        }
+        const uint64_t count = block_ids.size();
+        const bool written =
+            fwrite(hot_block_manifest_magic, sizeof(hot_block_manifest_magic), 1,
+                   file) == 1
+            && fwrite(&count, sizeof(count), 1, file) == 1
+            && fwrite(block_ids.data(), sizeof(block_id_t), count, file) == count;
+        if (!written) {
+            errsv = get_errno();
+        }
+        if (fclose(file) != 0 && written) {
+            errsv = get_errno();
+        }
+        if (errsv != 0) {
+            ::remove(temporary_path.c_str());
+            return;
+        }
+#ifdef _WIN32
+        // Windows can't rename over an existing file.
+        ::remove(path.c_str());
+#endif
+        if (::rename(temporary_path.c_str(), path.c_str()) != 0) {
+            errsv = get_errno();
+        }
+    });
+    if (errsv != 0) {
+        logWRN("Could not write the hot block manifest %s: %s",
+               path.c_str(), errno_string(errsv).c_str());
+    }
+}
+
+void remove_hot_block_manifest(const std::string &path) {
+    thread_pool_t::run_in_blocker_pool([&]() {
+        ::remove(path.c_str());
+    });
+}
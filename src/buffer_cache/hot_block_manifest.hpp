@@ -0,0 +1,28 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef BUFFER_CACHE_HOT_BLOCK_MANIFEST_HPP_
+#define BUFFER_CACHE_HOT_BLOCK_MANIFEST_HPP_
+
+#include <string>
+#include <vector>
+
+#include "serializer/types.hpp"
+
+/* A hot block manifest lists the blocks a page cache had in memory, most recently used
+first, so that the cache can load them again after a restart instead of starting out
+cold (see `evicter_t::hot_block_ids()` and `page_cache_t::warm_up()`).  It's only a
+hint: if it's missing or broken the cache starts out cold, and blocks that don't exist
+anymore get skipped.
+
+These must be called in a coroutine.  They do the file I/O in the blocker pool. */
+
+// Returns false if there's no manifest at `path` or it can't be read.
+bool read_hot_block_manifest(const std::string &path,
+                             std::vector<block_id_t> *block_ids_out);
+
+// Replaces the manifest at `path`, if there is one.  Failures are only logged.
+void write_hot_block_manifest(const std::string &path,
+                              const std::vector<block_id_t> &block_ids);
+
+void remove_hot_block_manifest(const std::string &path);
+
+#endif  // BUFFER_CACHE_HOT_BLOCK_MANIFEST_HPP_
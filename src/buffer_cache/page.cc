@@ -1,6 +1,7 @@
 #include "buffer_cache/page.hpp"
 
 #include "arch/runtime/coroutines.hpp"
+#include "arch/runtime/resource_usage.hpp"
 #include "buffer_cache/page_cache.hpp"
 #include "serializer/serializer.hpp"
 
@@ -49,7 +50,15 @@ private:
 // access time counter overflows.  Performance degradation is "smooth" if
 // access_time_counter_ loops around past INITIAL_ACCESS_TIME -- which shouldn't be a
 // problem for now, as long as we increment it one value at a time.
-static const uint64_t READ_AHEAD_ACCESS_TIME = evicter_t::INITIAL_ACCESS_TIME - 1;
+static const uint64_t READ_AHEAD_ACCESS_TIME = evicter_t::PROBATIONARY_ACCESS_TIME;
+
+// Charges a block read to whatever the current coroutine is charged to, since the
+// loading coroutine that we spawn isn't.
+static void charge_block_read() {
+    if (resource_usage_t *usage = current_resource_usage()) {
+        ++usage->blocks_read;
+    }
+}
 
 
 page_t::page_t(block_id_t _block_id, page_cache_t *page_cache)
@@ -69,10 +78,12 @@ page_t::page_t(block_id_t _block_id, page_cache_t *page_cache,
                cache_account_t *account)
     : block_id_(_block_id),
       loader_(nullptr),
-      access_time_(page_cache->evicter().next_access_time()),
+      access_time_(page_cache->evicter().access_time_for_load(_block_id, account)),
       snapshot_refcount_(0) {
     page_cache->evicter().add_not_yet_loaded(this);
+    page_cache->evicter().note_miss(this, account);
 
+    charge_block_read();
     coro_t::spawn_now_dangerously(std::bind(&page_t::load_with_block_id,
                                             this,
                                             _block_id,
@@ -212,6 +223,7 @@ public:
     }
 
     void added_waiter(page_cache_t *page_cache, cache_account_t *account) final {
+        charge_block_read();
         coro_t::spawn_now_dangerously(std::bind(&page_t::catch_up_with_deferred_load,
                                                 this,
                                                 page_cache,
@@ -262,6 +274,7 @@ void page_t::catch_up_with_deferred_load(
     page_cache->evicter().catch_up_deferred_load(page);
 
     buf_ptr_t buf;
+    const ticks_t start_time = get_ticks();
     {
         serializer_t *const serializer = page_cache->serializer();
 
@@ -274,6 +287,7 @@ void page_t::catch_up_with_deferred_load(
         buf = serializer->block_read(block_token_ptr->token,
                                      account->get());
     }
+    page_cache->record_miss_latency(start_time);
 
     ASSERT_FINITE_CORO_WAITING;
     if (our_loader.abandon_page()) {
@@ -349,6 +363,7 @@ void page_t::load_with_block_id(page_t *page, block_id_t block_id,
     buf_ptr_t buf;
     counted_t<block_token_t> block_token;
 
+    const ticks_t start_time = get_ticks();
     {
         serializer_t *const serializer = page_cache->serializer();
         on_thread_t th(serializer->home_thread());
@@ -357,6 +372,7 @@ void page_t::load_with_block_id(page_t *page, block_id_t block_id,
         buf = serializer->block_read(block_token,
                                      account->get());
     }
+    page_cache->record_miss_latency(start_time);
 
     ASSERT_FINITE_CORO_WAITING;
     if (loader.abandon_page()) {
@@ -415,11 +431,16 @@ void page_t::add_waiter(page_acq_t *acq, cache_account_t *account) {
         = acq->page_cache()->evicter().correct_eviction_category(this);
     waiters_.push_front(acq);
     acq->page_cache()->evicter().change_to_correct_eviction_bag(old_bag, this);
+    resource_usage_t *usage = current_resource_usage();
+    if (usage != nullptr) {
+        ++(buf_.has() ? usage->cache_hits : usage->cache_misses);
+    }
     if (buf_.has()) {
         acq->buf_ready_signal_.pulse();
     } else if (loader_ != nullptr) {
         loader_->added_waiter(acq->page_cache(), account);
     } else if (block_token_.has()) {
+        charge_block_read();
         coro_t::spawn_now_dangerously(std::bind(&page_t::load_using_block_token,
                                                 this,
                                                 acq->page_cache(),
@@ -446,12 +467,17 @@ void page_t::load_using_block_token(page_t *page, page_cache_t *page_cache,
     rassert(block_token.has());
 
     buf_ptr_t buf;
-    {
-        serializer_t *const serializer = page_cache->serializer();
-
-        on_thread_t th(serializer->home_thread());
-        buf = serializer->block_read(block_token,
-                                     account->get());
+    if (!page_cache->evicter().take_compressed_copy(page, &buf)) {
+        page_cache->evicter().note_miss(page, account);
+        const ticks_t start_time = get_ticks();
+        {
+            serializer_t *const serializer = page_cache->serializer();
+
+            on_thread_t th(serializer->home_thread());
+            buf = serializer->block_read(block_token,
+                                         account->get());
+        }
+        page_cache->record_miss_latency(start_time);
     }
 
     ASSERT_FINITE_CORO_WAITING;
@@ -515,9 +541,15 @@ uint32_t page_t::hypothetical_memory_usage(page_cache_t *page_cache) const {
     }
 }
 
-void *page_t::get_page_buf(page_cache_t *page_cache) {
+void *page_t::get_page_buf(page_cache_t *page_cache, bool is_scan) {
     rassert(buf_.has());
-    access_time_ = page_cache->evicter().next_access_time();
+    // Scans don't get a page out of probation (or make a transient page stay), but
+    // they don't let hot pages age either.
+    if (!is_scan
+        || (access_time_ != evicter_t::PROBATIONARY_ACCESS_TIME
+            && access_time_ != evicter_t::TRANSIENT_ACCESS_TIME)) {
+        access_time_ = page_cache->evicter().next_access_time();
+    }
     return buf_.cache_data();
 }
 
@@ -528,7 +560,6 @@ void page_t::reset_block_token(DEBUG_VAR page_cache_t *page_cache) {
     rassert(!waiters_.empty());
     rassert(buf_.has());
     if (block_token_.has()) {
-        rassert(buf_.block_size() == block_token_->block_size());
 #ifndef NDEBUG
         const uint32_t usage_before = hypothetical_memory_usage(page_cache);
 #endif
@@ -550,19 +581,15 @@ void page_t::remove_waiter(page_acq_t *acq) {
     rassert(snapshot_refcount_ > 0);
 }
 
-void page_t::evict_self(DEBUG_VAR page_cache_t *page_cache) {
+void page_t::evict_self() {
     // A page_t can only self-evict if it has a block token (for now).
     rassert(waiters_.empty());
     rassert(block_token_.has());
     rassert(buf_.has());
-    rassert(block_token_->block_size() == buf_.block_size());
-#ifndef NDEBUG
-    const uint32_t usage_before = hypothetical_memory_usage(page_cache);
-#endif
+    // The hypothetical memory usage can change here: the block token has the block's
+    // size on disk, which is smaller if it got compressed.  The evicter accounts for
+    // that.
     buf_.reset();
-    // Hypothetical memory usage shouldn't have changed -- the block token has the
-    // same block size.
-    rassert(usage_before == hypothetical_memory_usage(page_cache));
 }
 
 ser_buffer_t *page_t::get_loaded_ser_buffer() {
@@ -574,20 +601,18 @@ ser_buffer_t *page_t::get_loaded_ser_buffer() {
 void page_t::init_block_token(counted_t<block_token_t> token,
                               DEBUG_VAR page_cache_t *page_cache) {
     rassert(buf_.has());
-    rassert(buf_.block_size() == token->block_size());
     rassert(!block_token_.has());
 #ifndef NDEBUG
     const uint32_t usage_before = hypothetical_memory_usage(page_cache);
 #endif
     block_token_ = std::move(token);
-    // Hypothetical memory usage shouldn't have changed -- the block token has the
-    // same block size.
+    // Hypothetical memory usage shouldn't have changed -- the buf is loaded.
     rassert(usage_before == hypothetical_memory_usage(page_cache));
 }
 
 
 
-page_acq_t::page_acq_t() : page_(nullptr), page_cache_(nullptr) {
+page_acq_t::page_acq_t() : page_(nullptr), page_cache_(nullptr), is_scan_(false) {
 }
 
 void page_acq_t::init(page_t *page, page_cache_t *_page_cache,
@@ -597,6 +622,7 @@ void page_acq_t::init(page_t *page, page_cache_t *_page_cache,
     rassert(!buf_ready_signal_.is_pulsed());
     page_ = page;
     page_cache_ = _page_cache;
+    is_scan_ = page_cache_->evicter().is_scan(account);
     page_->add_waiter(this, account);
 }
 
@@ -621,12 +647,12 @@ void *page_acq_t::get_buf_write(block_size_t block_size) {
     buf_ready_signal_.wait();
     page_->reset_block_token(page_cache_);
     page_->set_page_buf_size(block_size, page_cache_);
-    return page_->get_page_buf(page_cache_);
+    return page_->get_page_buf(page_cache_, false);
 }
 
 const void *page_acq_t::get_buf_read() {
     buf_ready_signal_.wait();
-    return page_->get_page_buf(page_cache_);
+    return page_->get_page_buf(page_cache_, is_scan_);
 }
 
 void page_ptr_t::init(page_t *page) {
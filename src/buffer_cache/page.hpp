@@ -43,7 +43,9 @@ public:
     void remove_waiter(page_acq_t *acq);
 
     // These may not be called until the page_acq_t's buf_ready_signal is pulsed.
-    void *get_page_buf(page_cache_t *page_cache);
+    // `is_scan` means the access doesn't take the page out of probation (see
+    // `evicter_t::is_scan()`).
+    void *get_page_buf(page_cache_t *page_cache, bool is_scan);
     void reset_block_token(page_cache_t *page_cache);
     void set_page_buf_size(block_size_t block_size, page_cache_t *page_cache);
 
@@ -66,7 +68,7 @@ public:
     bool is_loaded() const { return buf_.has(); }
     bool is_disk_backed() const { return block_token_.has(); }
 
-    void evict_self(page_cache_t *page_cache);
+    void evict_self();
 
     block_id_t block_id() const { return block_id_; }
 
@@ -146,11 +148,14 @@ private:
     // if loader_ is non-null:  unevictable_
     // else if waiters_ is non-empty: unevictable_
     // else if buf_ is null: evicted_ (and block_token_ is non-null)
-    // else if block_token_ is non-null: evictable_disk_backed_
+    // else if block_token_ is non-null: evictable_disk_backed_ (or
+    //     evictable_probationary_ or evictable_transient_, if the page is
+    //     probationary or transient)
     // else: evictable_unbacked_ (buf_ is non-null, block_token_ is null)
     //
     // So, when loader_, waiters_, buf_, or block_token_ is touched, we might
-    // need to change this page's eviction bag.
+    // need to change this page's eviction bag.  (access_time_ only changes while
+    // the page has waiters.)
     //
     // The logic above is implemented in evicter_t::correct_eviction_category.
     backindex_bag_index_t eviction_index_;
@@ -250,6 +255,7 @@ public:
     page_acq_t(page_acq_t &&other) noexcept
         : half_intrusive_list_node_t<page_acq_t>(std::move(other)),
           page_(other.page_), page_cache_(other.page_cache_),
+          is_scan_(other.is_scan_),
           buf_ready_signal_(std::move(other.buf_ready_signal_)) {
         other.page_ = nullptr;
         other.page_cache_ = nullptr;
@@ -282,6 +288,8 @@ private:
 
     page_t *page_;
     page_cache_t *page_cache_;
+    // Whether the page was acquired through a scan account.
+    bool is_scan_;
     cond_t buf_ready_signal_;
     DISABLE_COPYING(page_acq_t);
 };
@@ -9,10 +9,14 @@
 #include "arch/runtime/coroutines.hpp"
 #include "arch/runtime/runtime.hpp"
 #include "arch/runtime/runtime_utils.hpp"
+#include "arch/timing.hpp"
 #include "concurrency/auto_drainer.hpp"
 #include "concurrency/new_mutex.hpp"
+#include "concurrency/wait_any.hpp"
+#include "buffer_cache/alt.hpp"
 #include "buffer_cache/cache_balancer.hpp"
 #include "do_on_thread.hpp"
+#include "perfmon/perfmon.hpp"
 #include "serializer/serializer.hpp"
 #include "stl_utils.hpp"
 
@@ -98,12 +102,12 @@ void page_read_ahead_cb_t::offer_read_ahead_buf(
     buf_ptr_t local_buf = std::move(*buf);
 
     block_size_t block_size = block_size_t::undefined();
-    scoped_device_block_aligned_ptr_t<ser_buffer_t> ptr;
+    scoped_buf_slab_ptr_t<ser_buffer_t> ptr;
     local_buf.release(&block_size, &ptr);
 
     // We're going to reconstruct the buf_ptr_t on the other side of this do_on_thread
-    // call, so we'd better make sure the block size is right.
-    guarantee(block_size == token->block_size());
+    // call.  The block size can differ from the token's if the block was stored
+    // compressed.
 
     // Notably, this code relies on do_on_thread to preserve callback order (which it
     // does do).
@@ -111,7 +115,8 @@ void page_read_ahead_cb_t::offer_read_ahead_buf(
                  std::bind(&page_cache_t::add_read_ahead_buf,
                            page_cache_,
                            block_id,
-                           copyable_unique_t<scoped_device_block_aligned_ptr_t<ser_buffer_t> >(std::move(ptr)),
+                           block_size,
+                           copyable_unique_t<scoped_buf_slab_ptr_t<ser_buffer_t> >(std::move(ptr)),
                            token));
 }
 
@@ -144,7 +149,10 @@ void page_cache_t::consider_evicting_current_page(block_id_t block_id) {
     }
 
     current_page_t *page_ptr = page_it->second;
-    if (page_ptr->should_be_evicted()) {
+    // Pages with a compressed copy stay, or we'd lose track of the copy.
+    if (page_ptr->should_be_evicted()
+        && !(page_ptr->page_.has()
+             && evicter_.has_compressed_copy(page_ptr->page_.get_page_for_read()))) {
         current_pages_.erase(block_id);
         page_ptr->reset(this);
         delete page_ptr;
@@ -160,7 +168,8 @@ block_version_t page_cache_t::gen_block_version() {
 
 
 void page_cache_t::add_read_ahead_buf(block_id_t block_id,
-                                      scoped_device_block_aligned_ptr_t<ser_buffer_t> ptr,
+                                      block_size_t block_size,
+                                      scoped_buf_slab_ptr_t<ser_buffer_t> ptr,
                                       const counted_t<block_token_t> &token) {
     assert_thread();
 
@@ -182,7 +191,7 @@ void page_cache_t::add_read_ahead_buf(block_id_t block_id,
     // modified (not to mention that we've already got the page in memory, so there is
     // no useful work to be done).
 
-    buf_ptr_t buf(token->block_size(), std::move(ptr));
+    buf_ptr_t buf(block_size, std::move(ptr));
     current_pages_[block_id] = new current_page_t(block_id, std::move(buf), token, this);
 }
 
@@ -244,7 +253,18 @@ page_cache_t::page_cache_t(serializer_t *_serializer,
                            cache_balancer_t *balancer,
                            alt_txn_throttler_t *throttler)
     : max_block_size_(_serializer->max_block_size()),
+      num_active_asap_false_flushes_(0),
       serializer_(_serializer),
+      throttler_(throttler),
+      flush_planning_micros_(0),
+      oldest_waiting_for_spawn_flush_(ticks_t{0}),
+      soft_flushes_hurried_(0),
+      miss_latency_(make_scoped<perfmon_histogram_t>(secs_to_ticks(1), false)),
+      misses_(0),
+      warm_up_blocks_total_(0),
+      warm_up_blocks_done_(0),
+      block_trace_cache_(block_trace_t::is_enabled()
+                         ? block_trace_t::new_cache_number() : 0),
       // Start the counter at 1 so we can distinguish empty values.
       next_block_version_(block_version_t().subsequent()),
       free_list_(_serializer),
@@ -264,7 +284,15 @@ page_cache_t::page_cache_t(serializer_t *_serializer,
             local_read_ahead_cb = new page_read_ahead_cb_t(_serializer, this);
         }
         default_reads_account_.init(_serializer->home_thread(),
-                                    _serializer->make_io_account(CACHE_READS_IO_PRIORITY));
+                                    _serializer->make_io_account(
+                                        io_class_t::foreground_read,
+                                        CACHE_READS_IO_PRIORITY),
+                                    cache_access_pattern_t::RANDOM);
+        scan_reads_account_.init(_serializer->home_thread(),
+                                 _serializer->make_io_account(
+                                     io_class_t::foreground_read,
+                                     CACHE_READS_IO_PRIORITY),
+                                 cache_access_pattern_t::SCAN);
         index_write_sink_.init(new page_cache_index_write_sink_t);
         recencies_ = _serializer->get_all_recencies();
     }
@@ -290,6 +318,8 @@ page_cache_t::~page_cache_t() {
     // know the entire set of txn's will be flushed.
     begin_flush_pending_txns(true, ticks_t{0});
 
+    block_trace_t::flush();
+
     drainer_.reset();
     size_t i = 0;
     for (auto &&page : current_pages_) {
@@ -305,10 +335,11 @@ page_cache_t::~page_cache_t() {
         /* IO accounts and a few other fields must be destroyed on the serializer
         thread. */
         on_thread_t thread_switcher(serializer_->home_thread());
-        // Resetting default_reads_account_ is opportunistically done here, instead
-        // of making its destructor switch back to the serializer thread a second
-        // time.
+        // Resetting default_reads_account_ and scan_reads_account_ is
+        // opportunistically done here, instead of making their destructors switch
+        // back to the serializer thread a second time.
         default_reads_account_.reset();
+        scan_reads_account_.reset();
         index_write_sink_.reset();
     }
 }
@@ -324,6 +355,7 @@ void page_cache_t::begin_flush_pending_txns(bool asap, ticks_t soft_deadline) {
         }
     }
 
+    const ticks_t planning_start = get_ticks();
     while (page_txn_t *ptr = waiting_for_spawn_flush_.head()) {
         page_txn_t::propagate_pre_spawn_flush(ptr);
         std::vector<scoped_ptr_t<page_txn_t>> flush_set
@@ -332,16 +364,126 @@ void page_cache_t::begin_flush_pending_txns(bool asap, ticks_t soft_deadline) {
         std::move(flush_set.begin(), flush_set.end(),
                   std::back_inserter(full_flush_set));
     }
+    oldest_waiting_for_spawn_flush_ = ticks_t{0};
+    flush_planning_micros_ += (get_ticks().nanos - planning_start.nanos) / 1000;
     if (!full_flush_set.empty()) {
         spawn_flush_flushables(std::move(full_flush_set), asap, soft_deadline);
     }
 }
 
-void page_cache_t::soft_durability_interval_flush(ticks_t soft_deadline) {
+void page_cache_t::soft_durability_interval_flush(ticks_t soft_deadline,
+                                                  int64_t max_wait_ms) {
     // We only start a soft durability flush if one isn't already running.
     if (num_active_asap_false_flushes_ == 0) {
         begin_flush_pending_txns(false, soft_deadline);
+    } else if (oldest_waiting_for_spawn_flush_.nanos != 0
+               && static_cast<int64_t>(unflushed_write_age_micros())
+                  >= max_wait_ms * THOUSAND) {
+        ++soft_flushes_hurried_;
+        begin_flush_pending_txns(true, ticks_t{0});
+    }
+}
+
+void page_cache_t::record_miss_latency(ticks_t start_time) {
+    ++misses_;
+    const ticks_t now = get_ticks();
+    miss_latency_->record(ticks_t{now.nanos - start_time.nanos}, now);
+}
+
+void page_cache_t::warm_up(std::vector<block_id_t> block_ids,
+                           signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) {
+    assert_thread();
+    auto_drainer_t::lock_t lock = drainer_->lock();
+    wait_any_t interrupt(interruptor, lock.get_drain_signal());
+
+    cache_account_t account = create_cache_account(CACHE_WARM_UP_CACHE_PRIORITY,
+                                                   cache_access_pattern_t::RANDOM,
+                                                   io_class_t::cache_warm_up);
+
+    // Blocks that have been deleted since have no block token.  We sort the others
+    // by their offset, so that the reads are as sequential as the file allows.
+    {
+        on_thread_t thread_switcher(serializer_->home_thread());
+        std::vector<std::pair<int64_t, block_id_t> > offsets;
+        offsets.reserve(block_ids.size());
+        for (block_id_t block_id : block_ids) {
+            counted_t<block_token_t> token = serializer_->index_read(block_id);
+            if (token.has()) {
+                offsets.push_back(std::make_pair(token->offset(), block_id));
+            }
+        }
+        std::sort(offsets.begin(), offsets.end());
+        block_ids.clear();
+        for (const auto &pair : offsets) {
+            block_ids.push_back(pair.second);
+        }
+    }
+    warm_up_blocks_total_ = block_ids.size();
+    warm_up_blocks_done_ = 0;
+
+    for (size_t i = 0; i < block_ids.size(); i += CACHE_WARM_UP_BATCH_SIZE) {
+        if (evicter_.in_memory_size() >= evicter_.memory_limit()) {
+            // The balancer gives caches that load a lot more memory, but not right
+            // away.  If it doesn't, other caches need the memory more.
+            nap(CACHE_WARM_UP_FULL_CACHE_WAIT_MS, &interrupt);
+            if (evicter_.in_memory_size() >= evicter_.memory_limit()) {
+                return;
+            }
+        }
+
+        const size_t end = std::min<size_t>(block_ids.size(),
+                                            i + CACHE_WARM_UP_BATCH_SIZE);
+        std::vector<block_id_t> loading;
+        std::vector<page_ptr_t> pages;
+        loading.reserve(end - i);
+        pages.reserve(end - i);
+        {
+            // A block that's in `recencies_` and has no current page hasn't been
+            // deleted, and since nothing else runs until its current page exists and
+            // its load has started, the load reads the live block.  (Starting a load
+            // spawns a coroutine, so this is only finite waiting.)
+            ASSERT_FINITE_CORO_WAITING;
+            for (size_t j = i; j < end; ++j) {
+                const block_id_t block_id = block_ids[j];
+                if (current_pages_.count(block_id) != 0
+                    || recency_for_block_id(block_id) == repli_timestamp_t::invalid) {
+                    continue;
+                }
+                current_page_t *current_page = page_for_block_id(block_id);
+                loading.push_back(block_id);
+                pages.emplace_back(current_page->the_page_for_read(
+                    current_page_help_t(block_id, this), &account));
+            }
+        }
+
+        {
+            std::vector<page_acq_t> acqs(pages.size());
+            for (size_t j = 0; j < pages.size(); ++j) {
+                acqs[j].init(pages[j].get_page_for_read(), this, &account);
+            }
+            for (page_acq_t &acq : acqs) {
+                wait_any_t waiter(acq.buf_ready_signal(), &interrupt);
+                waiter.wait_lazily_unordered();
+            }
+        }
+        for (page_ptr_t &page : pages) {
+            page.reset_page_ptr(this);
+        }
+        for (block_id_t block_id : loading) {
+            consider_evicting_current_page(block_id);
+        }
+        if (interrupt.is_pulsed()) {
+            throw interrupted_exc_t();
+        }
+        warm_up_blocks_done_ = end;
+    }
+}
+
+uint64_t page_cache_t::unflushed_write_age_micros() const {
+    if (oldest_waiting_for_spawn_flush_.nanos == 0) {
+        return 0;
     }
+    return (get_ticks().nanos - oldest_waiting_for_spawn_flush_.nanos) / THOUSAND;
 }
 
 void page_cache_t::flush_and_destroy_txn(
@@ -389,6 +531,37 @@ current_page_t *page_cache_t::page_for_block_id(block_id_t block_id) {
     return page_it->second;
 }
 
+const void *page_cache_t::peek_current_page_for_read(block_id_t block_id,
+                                                     cache_account_t *account) {
+    assert_thread();
+    ASSERT_NO_CORO_WAITING;
+
+    auto page_it = current_pages_.find(block_id);
+    if (page_it == current_pages_.end()) {
+        return nullptr;
+    }
+    current_page_t *current_page = page_it->second;
+    if (current_page->is_deleted_ || !current_page->page_.has()) {
+        return nullptr;
+    }
+
+    // Write acquirers get read access before they're done with the page, and may be
+    // in the middle of a change that spans several blocks.
+    for (current_page_acq_t *acq = current_page->acquirers_.head();
+         acq != nullptr;
+         acq = current_page->acquirers_.next(acq)) {
+        if (acq->access() == access_t::write) {
+            return nullptr;
+        }
+    }
+
+    page_t *page = current_page->page_.get_page_for_read();
+    if (!page->is_loaded()) {
+        return nullptr;
+    }
+    return evicter_.peek_page_buf(page, account);
+}
+
 current_page_t *page_cache_t::page_for_new_block_id(
         block_type_t block_type,
         block_id_t *block_id_out) {
@@ -440,7 +613,8 @@ current_page_t *page_cache_t::internal_page_for_new_chosen(block_id_t block_id)
     return inserted_page.first->second;
 }
 
-cache_account_t page_cache_t::create_cache_account(int priority) {
+cache_account_t page_cache_t::create_cache_account(
+        int priority, cache_access_pattern_t access_pattern, io_class_t io_class) {
     // We assume that a priority of 100 means that the transaction should have the
     // same priority as all the non-accounted transactions together. Not sure if this
     // makes sense.
@@ -458,11 +632,11 @@ cache_account_t page_cache_t::create_cache_account(int priority) {
         // Ideally we shouldn't have to switch to the serializer thread.  But that's
         // what the file account API is right now, deep in the I/O layer.
         on_thread_t thread_switcher(serializer_->home_thread());
-        io_account = serializer_->make_io_account(io_priority,
+        io_account = serializer_->make_io_account(io_class, io_priority,
                                                   outstanding_requests_limit);
     }
 
-    return cache_account_t(serializer_->home_thread(), io_account);
+    return cache_account_t(serializer_->home_thread(), io_account, access_pattern);
 }
 
 
@@ -511,6 +685,9 @@ void current_page_acq_t::init(page_txn_t *txn,
         } else {
             current_page_ = page_cache_->page_for_block_id(_block_id);
         }
+        page_cache_->trace_access(_block_id, create == page_create_t::yes
+                                                 ? block_trace_access_t::CREATE
+                                                 : block_trace_access_t::WRITE);
         dirtied_page_ = false;
         touched_page_ = false;
 
@@ -529,6 +706,7 @@ void current_page_acq_t::init(page_txn_t *txn,
     access_ = access_t::write;
     declared_snapshotted_ = false;
     current_page_ = page_cache_->page_for_new_block_id(block_type, &block_id_);
+    page_cache_->trace_access(block_id_, block_trace_access_t::CREATE);
     dirtied_page_ = false;
     touched_page_ = false;
 
@@ -612,6 +790,20 @@ signal_t *current_page_acq_t::write_acq_signal() {
 page_t *current_page_acq_t::current_page_for_read(cache_account_t *account) {
     assert_thread();
     rassert(snapshotted_page_.has() || current_page_ != nullptr);
+    if (block_trace_t::is_enabled()) {
+        switch (account->access_pattern()) {
+        case cache_access_pattern_t::SCAN:
+            page_cache_->trace_access(block_id_, block_trace_access_t::SCAN_READ);
+            break;
+        case cache_access_pattern_t::BYPASS:
+            page_cache_->trace_access(block_id_, block_trace_access_t::BYPASS_READ);
+            break;
+        case cache_access_pattern_t::RANDOM: // fallthru
+        default:
+            page_cache_->trace_access(block_id_, block_trace_access_t::READ);
+            break;
+        }
+    }
     read_cond_.wait();
     if (snapshotted_page_.has()) {
         return snapshotted_page_.get_page_for_read();
@@ -1705,7 +1897,12 @@ void page_cache_t::do_flush_changes(
         ticks_t soft_deadline) {
     std::unordered_map<block_id_t, block_change_t> &changes = coltx->changes;
     rassert(!changes.empty());
+    const ticks_t flush_start = get_ticks();
+    // A flush that is smeared over a soft durability interval is slower than the disk
+    // on purpose, so it tells the throttler nothing about the disk's bandwidth.
+    const bool smeared = !asap && soft_deadline.nanos > flush_start.nanos;
     flush_prep_t prep = page_cache_t::prep_flush_changes(page_cache, changes);
+    const int64_t written_blocks = prep.write_infos.size();
 
     cond_t blocks_released_cond;
     {
@@ -1803,6 +2000,11 @@ void page_cache_t::do_flush_changes(
                     }
                     changes.clear();
                     coltx->acq.mark_dirty_pages_written();
+                    if (!smeared) {
+                        page_cache->throttler_->inform_changes_written(
+                            written_blocks,
+                            (get_ticks().nanos - flush_start.nanos) / THOUSAND);
+                    }
 
                     blocks_released_cond.pulse();
                 }, page_cache->home_thread());
@@ -1982,8 +2184,10 @@ void page_cache_t::spawn_flush_flushables(
     rassert(!flush_set.empty());
     // The flush set's txn's are already disconnected from the graph.
 
+    const ticks_t planning_start = get_ticks();
     collapsed_txns_t coltx
         = page_cache_t::compute_changes(this, std::move(flush_set));
+    flush_planning_micros_ += (get_ticks().nanos - planning_start.nanos) / 1000;
 
     if (!coltx.changes.empty()) {
         coro_t::spawn_now_dangerously(std::bind(&page_cache_t::do_flush_txn_set,
@@ -2000,6 +2204,7 @@ void page_cache_t::spawn_flush_flushables(
 void page_cache_t::merge_into_waiting_for_spawn_flush(scoped_ptr_t<page_txn_t> &&base) {
     if (waiting_for_spawn_flush_.empty()) {
         waiting_for_spawn_flush_.push_back(base.release());
+        oldest_waiting_for_spawn_flush_ = get_ticks();
         return;
     }
 
@@ -2027,11 +2232,15 @@ void page_cache_t::begin_waiting_for_flush(
         page_txn_t *base_unscoped = base.release();
         want_to_spawn_flush_.push_back(base_unscoped);
 
+        const ticks_t planning_start = get_ticks();
         std::vector<scoped_ptr_t<page_txn_t>> flush_set
             = page_cache_t::maximal_flushable_txn_set(base_unscoped);
 
         if (!flush_set.empty()) {
             page_cache_t::remove_txn_set_from_graph(this, flush_set);
+        }
+        flush_planning_micros_ += (get_ticks().nanos - planning_start.nanos) / 1000;
+        if (!flush_set.empty()) {
             spawn_flush_flushables(std::move(flush_set), true, ticks_t{0} /* no soft deadline */);
         }
     }
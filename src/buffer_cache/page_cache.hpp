@@ -9,6 +9,8 @@
 #include <utility>
 #include <vector>
 
+#include "arch/types.hpp"
+#include "buffer_cache/block_trace.hpp"
 #include "buffer_cache/block_version.hpp"
 #include "buffer_cache/cache_account.hpp"
 #include "buffer_cache/evicter.hpp"
@@ -19,10 +21,12 @@
 #include "concurrency/auto_drainer.hpp"
 #include "concurrency/cond_var.hpp"
 #include "concurrency/fifo_enforcer.hpp"
+#include "concurrency/interruptor.hpp"
 #include "concurrency/new_semaphore.hpp"
 #include "containers/backindex_bag.hpp"
 #include "containers/intrusive_list.hpp"
 #include "containers/segmented_vector.hpp"
+#include "perfmon/types.hpp"
 #include "repli_timestamp.hpp"
 #include "serializer/types.hpp"
 #include "time.hpp"
@@ -443,7 +447,10 @@ public:
     // Begins to flush pending txn's.
     void begin_flush_pending_txns(bool asap, ticks_t soft_deadline /* 0 is okay */);
     // Starts an official soft durability interval flush, if one isn't running already.
-    void soft_durability_interval_flush(ticks_t soft_deadline);
+    // If one is, and the oldest soft durability write that isn't being flushed has
+    // waited for `max_wait_ms`, flushes the pending txn's right away instead, so that
+    // a slow flush can't let writes pile up for more than one interval.
+    void soft_durability_interval_flush(ticks_t soft_deadline, int64_t max_wait_ms);
 
     // Takes a txn to be flushed.  Pulses on_complete_or_null when done.
     void flush_and_destroy_txn(
@@ -454,6 +461,13 @@ public:
     void end_read_txn(scoped_ptr_t<page_txn_t> txn);
 
     current_page_t *page_for_block_id(block_id_t block_id);
+
+    // Returns the current contents of the block, if they can be read right now without
+    // waiting: the block is in memory and nobody holds or waits for write access to
+    // it.  Returns null otherwise.  Nothing gets acquired, so the pointer is only valid
+    // until the caller blocks.
+    const void *peek_current_page_for_read(block_id_t block_id,
+                                           cache_account_t *account);
     current_page_t *page_for_new_block_id(
         block_type_t block_type,
         block_id_t *block_id_out);
@@ -466,12 +480,19 @@ public:
 
     max_block_size_t max_block_size() const { return max_block_size_; }
 
-    cache_account_t create_cache_account(int priority);
+    cache_account_t create_cache_account(int priority,
+                                         cache_access_pattern_t access_pattern,
+                                         io_class_t io_class);
 
     cache_account_t *default_reads_account() {
         return &default_reads_account_;
     }
 
+    // Used instead of the default reads account by reads that scan many blocks.
+    cache_account_t *scan_reads_account() {
+        return &scan_reads_account_;
+    }
+
     // Considers wiping out the current_page_t (and its page_t pointee) for a
     // particular block id, to save memory, if the right conditions are met.  (This
     // should only be called by things "outside" of current_page_t, like
@@ -484,6 +505,43 @@ public:
 
     evicter_t &evicter() { return evicter_; }
 
+    // The total time that flushes have spent picking the transactions to flush and
+    // combining their changes.
+    uint64_t flush_planning_micros() const { return flush_planning_micros_; }
+
+    // How long the oldest write whose flush hasn't started yet has been waiting, or 0.
+    uint64_t unflushed_write_age_micros() const;
+    // How many times a soft durability interval flush had to start right away
+    // because the previous one was still running.
+    uint64_t soft_flushes_hurried() const { return soft_flushes_hurried_; }
+
+    // How long loading a page that wasn't in memory took, from the serializer read
+    // that started at `start_time` until the page was back on our thread.
+    void record_miss_latency(ticks_t start_time);
+    perfmon_histogram_t *miss_latency() { return miss_latency_.get(); }
+    // How many pages have been loaded that way.
+    uint64_t misses() const { return misses_; }
+
+    // Loads the blocks in `block_ids` that aren't in memory or deleted, in the order
+    // they're in on disk, at a lower priority than other reads.  The block ids usually
+    // come from `evicter().hot_block_ids()` before a restart.  Stops early if the cache
+    // stays full.
+    void warm_up(std::vector<block_id_t> block_ids, signal_t *interruptor)
+        THROWS_ONLY(interrupted_exc_t);
+    // How many blocks `warm_up()` was given that still exist, and how many of them it
+    // has got through.
+    uint64_t warm_up_blocks_total() const { return warm_up_blocks_total_; }
+    uint64_t warm_up_blocks_done() const { return warm_up_blocks_done_; }
+
+    // Records an access to `block_id` if `--cache-trace` is on.
+    void trace_access(block_id_t block_id, block_trace_access_t access) {
+        if (block_trace_t::is_enabled()) {
+            block_trace_t::record(block_trace_cache_, block_id, access);
+        }
+    }
+
+    alt_txn_throttler_t *throttler() { return throttler_; }
+
     auto_drainer_t::lock_t drainer_lock() { return drainer_->lock(); }
     serializer_t *serializer() { return serializer_; }
 
@@ -493,7 +551,8 @@ private:
 
     friend class page_read_ahead_cb_t;
     void add_read_ahead_buf(block_id_t block_id,
-                            scoped_device_block_aligned_ptr_t<ser_buffer_t> ptr,
+                            block_size_t block_size,
+                            scoped_buf_slab_ptr_t<ser_buffer_t> ptr,
                             const counted_t<block_token_t> &token);
 
     void read_ahead_cb_is_destroyed();
@@ -600,6 +659,7 @@ private:
     // merger_serializer_t (as long as you use one, otherwise they use the
     // default account).
     cache_account_t default_reads_account_;
+    cache_account_t scan_reads_account_;
 
     // This fifo enforcement pair ensures ordering of index_write operations after we
     // move to the serializer thread and get a bunch of blocks written.
@@ -610,15 +670,31 @@ private:
     // than an ongoing write, the ongoing write becomes "asap" too.)
     state_timestamp_t ser_thread_max_asap_write_token_timestamp_;
     // Number of flushes started, not yet completed, that are asap=false.
-    bool num_active_asap_false_flushes_;
+    int num_active_asap_false_flushes_;
 
     scoped_ptr_t<page_cache_index_write_sink_t> index_write_sink_;
 
     serializer_t *serializer_;
+    alt_txn_throttler_t *throttler_;
     segmented_vector_t<repli_timestamp_t> recencies_;
 
     std::unordered_map<block_id_t, current_page_t *> current_pages_;
 
+    uint64_t flush_planning_micros_;
+
+    // When the first txn in `waiting_for_spawn_flush_` got there, or 0 if it's empty.
+    ticks_t oldest_waiting_for_spawn_flush_;
+    uint64_t soft_flushes_hurried_;
+
+    scoped_ptr_t<perfmon_histogram_t> miss_latency_;
+    uint64_t misses_;
+
+    uint64_t warm_up_blocks_total_;
+    uint64_t warm_up_blocks_done_;
+
+    // The number this cache's acquisitions are recorded under in the block trace.
+    uint32_t block_trace_cache_;
+
     // An incrementing 64-bit counter used to generate block versions, with values 1, 2,
     // 3, ...  This makes sure that block writes never get overwritten by previous block
     // writes.  alt_snapshot_node_t's will still hold a current_page_acq_t though --
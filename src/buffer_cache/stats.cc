@@ -1,6 +1,7 @@
 // Copyright 2010-2014 RethinkDB, all rights reserved.
 #include "buffer_cache/stats.hpp"
 
+#include "buffer_cache/alt.hpp"
 #include "perfmon/perfmon.hpp"
 
 alt_cache_stats_t::alt_cache_stats_t(alt::page_cache_t *_page_cache,
@@ -8,13 +9,82 @@ alt_cache_stats_t::alt_cache_stats_t(alt::page_cache_t *_page_cache,
     page_cache(_page_cache),
     cache_collection(),
     cache_membership(parent, &cache_collection, "cache"),
-    in_use_bytes(this),
+    in_use_bytes(this, [](alt::page_cache_t *pc) {
+        return pc->evicter().in_memory_size();
+    }),
     in_use_bytes_membership(&cache_collection,
                             &in_use_bytes, "in_use_bytes"),
+    memory_limit_bytes(this, [](alt::page_cache_t *pc) {
+        return pc->evicter().memory_limit();
+    }),
+    memory_limit_bytes_membership(&cache_collection,
+                                  &memory_limit_bytes, "memory_limit_bytes"),
+    ghost_hits(this, [](alt::page_cache_t *pc) {
+        return pc->evicter().ghost_hits();
+    }),
+    ghost_hits_membership(&cache_collection, &ghost_hits, "ghost_hits_total"),
+    flush_planning_micros(this, [](alt::page_cache_t *pc) {
+        return pc->flush_planning_micros();
+    }),
+    flush_planning_micros_membership(&cache_collection,
+                                     &flush_planning_micros,
+                                     "flush_planning_micros_total"),
+    unflushed_write_age_micros(this, [](alt::page_cache_t *pc) {
+        return pc->unflushed_write_age_micros();
+    }),
+    unflushed_write_age_micros_membership(&cache_collection,
+                                          &unflushed_write_age_micros,
+                                          "unflushed_write_age_micros"),
+    soft_flushes_hurried(this, [](alt::page_cache_t *pc) {
+        return pc->soft_flushes_hurried();
+    }),
+    soft_flushes_hurried_membership(&cache_collection,
+                                    &soft_flushes_hurried,
+                                    "soft_flushes_hurried_total"),
+    unwritten_changes(this, [](alt::page_cache_t *pc) {
+        return pc->throttler()->unwritten_block_changes();
+    }),
+    unwritten_changes_membership(&cache_collection,
+                                 &unwritten_changes, "unwritten_changes"),
+    unwritten_changes_limit(this, [](alt::page_cache_t *pc) {
+        return pc->throttler()->unwritten_block_changes_limit();
+    }),
+    unwritten_changes_limit_membership(&cache_collection,
+                                       &unwritten_changes_limit,
+                                       "unwritten_changes_limit"),
+    written_changes_per_sec(this, [](alt::page_cache_t *pc) {
+        return pc->throttler()->written_changes_per_sec();
+    }),
+    written_changes_per_sec_membership(&cache_collection,
+                                       &written_changes_per_sec,
+                                       "written_changes_per_sec"),
+    throttled_micros(this, [](alt::page_cache_t *pc) {
+        return pc->throttler()->throttled_micros();
+    }),
+    throttled_micros_membership(&cache_collection,
+                                &throttled_micros, "throttled_micros_total"),
+    miss_latency_membership(&cache_collection,
+                            _page_cache->miss_latency(), "miss_latency"),
+    misses(this, [](alt::page_cache_t *pc) {
+        return pc->misses();
+    }),
+    misses_membership(&cache_collection, &misses, "misses_total"),
+    warm_up_blocks_total(this, [](alt::page_cache_t *pc) {
+        return pc->warm_up_blocks_total();
+    }),
+    warm_up_blocks_total_membership(&cache_collection, &warm_up_blocks_total,
+                                    "warm_up_blocks_total"),
+    warm_up_blocks_done(this, [](alt::page_cache_t *pc) {
+        return pc->warm_up_blocks_done();
+    }),
+    warm_up_blocks_done_membership(&cache_collection, &warm_up_blocks_done,
+                                   "warm_up_blocks_done"),
     cache_collection_membership(&cache_collection) { }
 
-alt_cache_stats_t::perfmon_value_t::perfmon_value_t(alt_cache_stats_t *_parent) :
-    parent(_parent) { }
+alt_cache_stats_t::perfmon_value_t::perfmon_value_t(
+        alt_cache_stats_t *_parent,
+        std::function<uint64_t(alt::page_cache_t *)> _get) :
+    parent(_parent), get(std::move(_get)) { }
 
 void *alt_cache_stats_t::perfmon_value_t::begin_stats() {
     return new uint64_t;
@@ -23,7 +93,7 @@ void *alt_cache_stats_t::perfmon_value_t::begin_stats() {
 void alt_cache_stats_t::perfmon_value_t::visit_stats(void *ptr) {
     if (get_thread_id() == parent->home_thread()) {
         uint64_t *value = reinterpret_cast<uint64_t *>(ptr);
-        *value = parent->page_cache->evicter().in_memory_size();
+        *value = get(parent->page_cache);
     }
 }
 
@@ -2,6 +2,8 @@
 #ifndef BUFFER_CACHE_STATS_HPP_
 #define BUFFER_CACHE_STATS_HPP_
 
+#include <functional>
+
 #include "perfmon/perfmon.hpp"
 #include "buffer_cache/page_cache.hpp"
 
@@ -15,19 +17,55 @@ public:
     perfmon_collection_t cache_collection;
     perfmon_membership_t cache_membership;
 
+    // Reports a value that `get` reads from the page cache on its home thread.
     class perfmon_value_t : public perfmon_t {
     public:
-        explicit perfmon_value_t(alt_cache_stats_t *_parent);
+        perfmon_value_t(alt_cache_stats_t *_parent,
+                        std::function<uint64_t(alt::page_cache_t *)> _get);
         void *begin_stats();
         void visit_stats(void *);
         ql::datum_t end_stats(void *);
     private:
         alt_cache_stats_t *parent;
+        std::function<uint64_t(alt::page_cache_t *)> get;
         DISABLE_COPYING(perfmon_value_t);
     };
     perfmon_value_t in_use_bytes;
     perfmon_membership_t in_use_bytes_membership;
+    // What the cache balancer decided this cache may use, and the misses that led
+    // it to give the cache more (see `evicter_t::ghost_hits()`).
+    perfmon_value_t memory_limit_bytes;
+    perfmon_membership_t memory_limit_bytes_membership;
+    perfmon_value_t ghost_hits;
+    perfmon_membership_t ghost_hits_membership;
+    perfmon_value_t flush_planning_micros;
+    perfmon_membership_t flush_planning_micros_membership;
+    perfmon_value_t unflushed_write_age_micros;
+    perfmon_membership_t unflushed_write_age_micros_membership;
+    perfmon_value_t soft_flushes_hurried;
+    perfmon_membership_t soft_flushes_hurried_membership;
+
+    // The state of the cache's `alt_txn_throttler_t`.
+    perfmon_value_t unwritten_changes;
+    perfmon_membership_t unwritten_changes_membership;
+    perfmon_value_t unwritten_changes_limit;
+    perfmon_membership_t unwritten_changes_limit_membership;
+    perfmon_value_t written_changes_per_sec;
+    perfmon_membership_t written_changes_per_sec_membership;
+    perfmon_value_t throttled_micros;
+    perfmon_membership_t throttled_micros_membership;
+
+    // The page cache's histogram of how long loading a page from disk takes, and how
+    // many pages it has loaded.
+    perfmon_membership_t miss_latency_membership;
+    perfmon_value_t misses;
+    perfmon_membership_t misses_membership;
 
+    // The progress of the warm-up after a restart (see `page_cache_t::warm_up()`).
+    perfmon_value_t warm_up_blocks_total;
+    perfmon_membership_t warm_up_blocks_total_membership;
+    perfmon_value_t warm_up_blocks_done;
+    perfmon_membership_t warm_up_blocks_done_membership;
 
     perfmon_multi_membership_t cache_collection_membership;
 };
@@ -22,6 +22,15 @@ struct flush_interval_t {
     int64_t millis;
 };
 
+/* A store's share of the cache, from its table's `cache` config.  The cache balancer
+keeps the store's memory limit between `min_bytes` and `max_bytes`, and multiplies its
+demand for memory by `priority`. */
+struct cache_reservation_t {
+    uint64_t min_bytes;
+    uint64_t max_bytes;
+    double priority;
+};
+
 typedef uint32_t block_magic_comparison_t;
 
 struct block_magic_t {
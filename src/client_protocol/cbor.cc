@@ -0,0 +1,171 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#include "client_protocol/cbor.hpp"
+
+#include <string.h>
+
+#include "arch/io/network.hpp"
+#include "client_protocol/json.hpp"
+#include "client_protocol/protocols.hpp"
+#include "concurrency/pmap.hpp"
+#include "rdb_protocol/datum_cbor.hpp"
+#include "rdb_protocol/rdb_backtrace.hpp"
+#include "rdb_protocol/ql2proto.hpp"
+#include "rdb_protocol/query_params.hpp"
+#include "rdb_protocol/response.hpp"
+#include "rdb_protocol/term_storage.hpp"
+#include "utils.hpp"
+
+scoped_ptr_t<ql::query_params_t> cbor_protocol_t::parse_query(
+        tcp_conn_t *conn,
+        signal_t *interruptor,
+        ql::query_cache_t *query_cache) {
+    return json_protocol_t::parse_query(
+        conn, interruptor, query_cache, &cbor_protocol_t::send_response);
+}
+
+void write_cbor_key(const char *key, std::string *out) {
+    ql::write_cbor_text(key, 1, out);
+}
+
+void write_cbor_response_internal(ql::response_t *response,
+                                  std::string *buffer_out,
+                                  bool throw_errors) {
+    size_t start_offset = buffer_out->size();
+
+    try {
+        const bool has_error_type =
+            response->type() == Response::RUNTIME_ERROR && response->error_type();
+        const bool has_notes = response->type() == Response::SUCCESS_PARTIAL ||
+            response->type() == Response::SUCCESS_SEQUENCE;
+        const size_t num_keys = 2
+            + (has_error_type ? 1 : 0)
+            + (response->backtrace() ? 1 : 0)
+            + (response->profile() ? 1 : 0)
+            + (has_notes ? 1 : 0);
+        ql::write_cbor_head(ql::cbor_major_type_t::MAP, num_keys, buffer_out);
+
+        write_cbor_key("t", buffer_out);
+        ql::write_cbor_int(response->type(), buffer_out);
+        if (has_error_type) {
+            write_cbor_key("e", buffer_out);
+            ql::write_cbor_int(*response->error_type(), buffer_out);
+        }
+
+        write_cbor_key("r", buffer_out);
+        ql::write_cbor_head(ql::cbor_major_type_t::ARRAY, response->data().size(),
+                            buffer_out);
+        const size_t PARALLELIZATION_THRESHOLD = 500;
+        if (response->data().size() > PARALLELIZATION_THRESHOLD) {
+            int64_t num_threads = std::min<int64_t>(16, get_num_db_threads());
+            int32_t thread_offset = get_thread_id().threadnum;
+            std::vector<std::string> buffers(num_threads);
+
+            size_t per_thread = response->data().size() / num_threads;
+            pmap(num_threads, [&](int64_t m) {
+                    int32_t target_thread =
+                        (thread_offset + static_cast<int32_t>(m)) % get_num_db_threads();
+                    on_thread_t rethreader((threadnum_t(target_thread)));
+
+                    size_t offset = per_thread * m;
+                    size_t end = (m == num_threads - 1) ?
+                        response->data().size() : (per_thread * (m + 1));
+
+                    for (size_t i = offset; i < end; ++i) {
+                        const size_t YIELD_INTERVAL = 2000;
+                        if ((i + 1) % YIELD_INTERVAL == 0) {
+                            coro_t::yield();
+                        }
+                        ql::write_datum_cbor(response->data()[i], &buffers[m]);
+                    }
+                });
+
+            // Since the array has a definite length, the parts can just be appended.
+            for (const auto &buffer : buffers) {
+                buffer_out->append(buffer);
+            }
+        } else {
+            for (const auto &item : response->data()) {
+                ql::write_datum_cbor(item, buffer_out);
+            }
+        }
+        if (response->backtrace()) {
+            write_cbor_key("b", buffer_out);
+            ql::write_datum_cbor(*response->backtrace(), buffer_out);
+        }
+        if (response->profile()) {
+            write_cbor_key("p", buffer_out);
+            ql::write_datum_cbor(*response->profile(), buffer_out);
+        }
+        if (has_notes) {
+            write_cbor_key("n", buffer_out);
+            ql::write_cbor_head(ql::cbor_major_type_t::ARRAY, response->notes().size(),
+                                buffer_out);
+            for (const auto &note : response->notes()) {
+                ql::write_cbor_int(note, buffer_out);
+            }
+        }
+    } catch (const ql::base_exc_t &ex) {
+        buffer_out->resize(start_offset);
+        response->fill_error(Response::RUNTIME_ERROR, Response::QUERY_LOGIC,
+                             ex.what(), ql::backtrace_registry_t::EMPTY_BACKTRACE);
+        write_cbor_response_internal(response, buffer_out, true);
+    } catch (const std::exception &ex) {
+        if (throw_errors) {
+            throw;
+        }
+
+        buffer_out->resize(start_offset);
+        response->fill_error(Response::RUNTIME_ERROR, Response::INTERNAL,
+            strprintf("Internal error in cbor_protocol_t::write: %s", ex.what()),
+            ql::backtrace_registry_t::EMPTY_BACKTRACE);
+        write_cbor_response_internal(response, buffer_out, true);
+    }
+}
+
+// Small wrapper - in debug mode we would rather crash than send the error back
+void cbor_protocol_t::write_response_to_buffer(ql::response_t *response,
+                                               std::string *buffer_out) {
+#ifdef NDEBUG
+    write_cbor_response_internal(response, buffer_out, false);
+#else
+    write_cbor_response_internal(response, buffer_out, true);
+#endif
+}
+
+size_t cbor_protocol_t::send_response(ql::response_t *response,
+                                      int64_t token,
+                                      tcp_conn_t *conn,
+                                      signal_t *interruptor) {
+    uint32_t data_size; // filled in below
+    const size_t prefix_size = sizeof(token) + sizeof(data_size);
+
+    // Reserve space for the token and the size
+    std::string buffer(prefix_size, '\0');
+
+    write_response_to_buffer(response, &buffer);
+    int64_t payload_size = buffer.size() - prefix_size;
+    guarantee(payload_size > 0);
+
+    if (payload_size >= wire_protocol_t::TOO_LARGE_RESPONSE_SIZE) {
+        response->fill_error(Response::RUNTIME_ERROR,
+                             Response::RESOURCE_LIMIT,
+                             wire_protocol_t::too_large_response_message(payload_size),
+                             ql::backtrace_registry_t::EMPTY_BACKTRACE);
+        return send_response(response, token, conn, interruptor);
+    }
+
+    // The token and size are framed the same way as in the JSON protocol.
+#ifdef __s390x__
+    token = __builtin_bswap64(token);
+#endif
+    memcpy(&buffer[0], &token, sizeof(token));
+
+    data_size = static_cast<uint32_t>(payload_size);
+#ifdef __s390x__
+    data_size = __builtin_bswap32(data_size);
+#endif
+    memcpy(&buffer[sizeof(token)], &data_size, sizeof(data_size));
+
+    conn->write(buffer.data(), buffer.size(), interruptor);
+    return buffer.size();
+}
@@ -0,0 +1,39 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#ifndef CLIENT_PROTOCOL_CBOR_HPP_
+#define CLIENT_PROTOCOL_CBOR_HPP_
+
+#include <stdint.h>
+
+#include <string>
+
+#include "arch/types.hpp"
+#include "containers/scoped.hpp"
+
+class signal_t;
+
+namespace ql {
+class response_t;
+class query_cache_t;
+class query_params_t;
+}
+
+// A client can ask for this protocol with the `response_format` field of the V1_0
+// handshake.  Queries are still sent as JSON, but responses are encoded as CBOR (see
+// `write_datum_cbor`), as a map with the same keys as the JSON responses.
+class cbor_protocol_t {
+public:
+    static scoped_ptr_t<ql::query_params_t> parse_query(tcp_conn_t *conn,
+                                                        signal_t *interruptor,
+                                                        ql::query_cache_t *query_cache);
+
+    static void write_response_to_buffer(ql::response_t *response,
+                                         std::string *buffer_out);
+
+    // Returns how many bytes were sent.
+    static size_t send_response(ql::response_t *response,
+                                int64_t token,
+                                tcp_conn_t *conn,
+                                signal_t *interruptor);
+};
+
+#endif // CLIENT_PROTOCOL_CBOR_HPP_
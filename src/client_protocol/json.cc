@@ -1,6 +1,8 @@
 // Copyright 2010-2015 RethinkDB, all rights reserved.
 #include "client_protocol/json.hpp"
 
+#include <vector>
+
 #include "arch/io/network.hpp"
 #include "arch/timing.hpp"
 #include "client_protocol/protocols.hpp"
@@ -17,11 +19,11 @@
 #include "utils.hpp"
 
 scoped_ptr_t<ql::query_params_t> json_protocol_t::parse_query_from_buffer(
-        scoped_array_t<char> &&buffer, size_t offset,
+        counted_t<shared_buf_t> &&buffer, size_t offset,
         ql::query_cache_t *query_cache, int64_t token,
         ql::response_t *error_out) {
     rapidjson::Document doc;
-    doc.ParseInsitu(buffer.data() + offset);
+    doc.ParseInsitu(buffer->data(offset));
 
     scoped_ptr_t<ql::query_params_t> res;
     if (!doc.HasParseError()) {
@@ -48,7 +50,8 @@ scoped_ptr_t<ql::query_params_t> json_protocol_t::parse_query_from_buffer(
 scoped_ptr_t<ql::query_params_t> json_protocol_t::parse_query(
         tcp_conn_t *conn,
         signal_t *interruptor,
-        ql::query_cache_t *query_cache) {
+        ql::query_cache_t *query_cache,
+        send_response_fn_t send_error) {
     int64_t token;
     uint32_t size;
     conn->read_buffered(&token, sizeof(token), interruptor);
@@ -75,29 +78,37 @@ scoped_ptr_t<ql::query_params_t> json_protocol_t::parse_query(
             conn->pop(size, &pop_interruptor);
         }
 
-        send_response(&error, token, conn, interruptor);
+        send_error(&error, token, conn, interruptor);
         throw tcp_conn_read_closed_exc_t();
     }
 
-    scoped_array_t<char> data(size + 1);
+    // The query is read into a shared buffer, because the datums that are made from
+    // it reference the strings in it instead of copying them (see
+    // `json_term_storage_t`).
+    counted_t<shared_buf_t> data = shared_buf_t::create(size + 1);
     // It's *usually* more efficient to do an un-buffered read here. The client is
     // usually not going to group multiple queries into the same network package
     // (especially not with tcp_nodelay set), and using the non-buffered `read` can
     // avoid an extra copy.
-    conn->read(data.data(), size, interruptor);
-    data[size] = 0; // Null terminate the string, which the json parser requires
+    conn->read(data->data(), size, interruptor);
+    data->data()[size] = 0; // Null terminate the string, which the json parser requires
 
     scoped_ptr_t<ql::query_params_t> res =
         parse_query_from_buffer(std::move(data), 0, query_cache, token, &error);
 
     if (!res.has()) {
-        send_response(&error, token, conn, interruptor);
+        send_error(&error, token, conn, interruptor);
     }
     return res;
 }
 
+// If `rows_out` isn't null, the rows of large responses are left in `*rows_out`, one
+// JSON array per thread that serialized them, rather than copied into `buffer_out`.
+// They belong in its empty "r" array, at `*rows_offset_out`.
 void write_response_internal(ql::response_t *response,
                              rapidjson::StringBuffer *buffer_out,
+                             std::vector<rapidjson::StringBuffer> *rows_out,
+                             size_t *rows_offset_out,
                              bool throw_errors) {
     rapidjson::Writer<rapidjson::StringBuffer> writer(*buffer_out);
     size_t start_offset = buffer_out->GetSize();
@@ -145,8 +156,13 @@ void write_response_internal(ql::response_t *response,
                     thread_writer.EndArray();
                 });
 
-            for (const auto &buffer : buffers) {
-                writer.SpliceArray(buffer);
+            if (rows_out != nullptr) {
+                rows_out->swap(buffers);
+                *rows_offset_out = buffer_out->GetSize();
+            } else {
+                for (const auto &buffer : buffers) {
+                    writer.SpliceArray(buffer);
+                }
             }
         } else {
             for (const auto &item : response->data()) {
@@ -175,36 +191,49 @@ void write_response_internal(ql::response_t *response,
         guarantee(writer.IsComplete());
     } catch (const ql::base_exc_t &ex) {
         buffer_out->Pop(buffer_out->GetSize() - start_offset);
+        if (rows_out != nullptr) {
+            rows_out->clear();
+        }
         response->fill_error(Response::RUNTIME_ERROR, Response::QUERY_LOGIC,
                              ex.what(), ql::backtrace_registry_t::EMPTY_BACKTRACE);
-        write_response_internal(response, buffer_out, true);
+        write_response_internal(response, buffer_out, nullptr, nullptr, true);
     } catch (const std::exception &ex) {
         if (throw_errors) {
             throw;
         }
 
         buffer_out->Pop(buffer_out->GetSize() - start_offset);
+        if (rows_out != nullptr) {
+            rows_out->clear();
+        }
         response->fill_error(Response::RUNTIME_ERROR, Response::INTERNAL,
             strprintf("Internal error in json_protocol_t::write: %s", ex.what()),
             ql::backtrace_registry_t::EMPTY_BACKTRACE);
-        write_response_internal(response, buffer_out, true);
+        write_response_internal(response, buffer_out, nullptr, nullptr, true);
     }
 }
 
 // Small wrapper - in debug mode we would rather crash than send the error back
-void json_protocol_t::write_response_to_buffer(ql::response_t *response,
-                                               rapidjson::StringBuffer *buffer_out) {
+void write_response_parts(ql::response_t *response,
+                          rapidjson::StringBuffer *buffer_out,
+                          std::vector<rapidjson::StringBuffer> *rows_out,
+                          size_t *rows_offset_out) {
 #ifdef NDEBUG
-    write_response_internal(response, buffer_out, false);
+    write_response_internal(response, buffer_out, rows_out, rows_offset_out, false);
 #else
-    write_response_internal(response, buffer_out, true);
+    write_response_internal(response, buffer_out, rows_out, rows_offset_out, true);
 #endif
 }
 
-void json_protocol_t::send_response(ql::response_t *response,
-                                    int64_t token,
-                                    tcp_conn_t *conn,
-                                    signal_t *interruptor) {
+void json_protocol_t::write_response_to_buffer(ql::response_t *response,
+                                               rapidjson::StringBuffer *buffer_out) {
+    write_response_parts(response, buffer_out, nullptr, nullptr);
+}
+
+size_t json_protocol_t::send_response(ql::response_t *response,
+                                      int64_t token,
+                                      tcp_conn_t *conn,
+                                      signal_t *interruptor) {
     uint32_t data_size; // filled in below
     const size_t prefix_size = sizeof(token) + sizeof(data_size);
 
@@ -212,9 +241,25 @@ void json_protocol_t::send_response(ql::response_t *response,
     rapidjson::StringBuffer buffer;
     buffer.Push(prefix_size);
 
-    write_response_to_buffer(response, &buffer);
+    // The rows of large responses are sent straight from the buffers they were
+    // serialized into, so we don't hold a second copy of them.
+    std::vector<rapidjson::StringBuffer> rows;
+    size_t rows_offset = 0;
+    write_response_parts(response, &buffer, &rows, &rows_offset);
     int64_t payload_size = buffer.GetSize() - prefix_size;
     guarantee(payload_size > 0);
+    size_t num_row_parts = 0;
+    for (const auto &part : rows) {
+        // Each part is a JSON array, we only send what's between the brackets.
+        if (part.GetSize() > 2) {
+            payload_size += part.GetSize() - 2;
+            ++num_row_parts;
+        }
+    }
+    if (num_row_parts > 1) {
+        // The commas between the parts
+        payload_size += num_row_parts - 1;
+    }
 
     static_assert(std::is_same<decltype(wire_protocol_t::TOO_LARGE_RESPONSE_SIZE),
                                const uint32_t>::value,
@@ -225,8 +270,7 @@ void json_protocol_t::send_response(ql::response_t *response,
                              Response::RESOURCE_LIMIT,
                              wire_protocol_t::too_large_response_message(payload_size),
                              ql::backtrace_registry_t::EMPTY_BACKTRACE);
-        send_response(response, token, conn, interruptor);
-        return;
+        return send_response(response, token, conn, interruptor);
     }
 
     // Fill in the token and size
@@ -247,6 +291,24 @@ void json_protocol_t::send_response(ql::response_t *response,
             reinterpret_cast<const char *>(&data_size)[i];
     }
 
-    conn->write(buffer.GetString(), buffer.GetSize(), interruptor);
+    if (rows.empty()) {
+        conn->write(buffer.GetString(), buffer.GetSize(), interruptor);
+    } else {
+        conn->write_buffered(buffer.GetString(), rows_offset, interruptor);
+        bool first = true;
+        for (const auto &part : rows) {
+            if (part.GetSize() <= 2) {
+                continue;
+            }
+            if (!first) {
+                conn->write_buffered(",", 1, interruptor);
+            }
+            first = false;
+            conn->write(part.GetString() + 1, part.GetSize() - 2, interruptor);
+        }
+        conn->write(buffer.GetString() + rows_offset, buffer.GetSize() - rows_offset,
+                    interruptor);
+    }
+    return prefix_size + payload_size;
 }
 
@@ -6,6 +6,7 @@
 
 #include "arch/types.hpp"
 #include "containers/scoped.hpp"
+#include "containers/shared_buffer.hpp"
 #include "rapidjson/stringbuffer.h"
 
 class signal_t;
@@ -21,22 +22,32 @@ class query_params_t;
 class json_protocol_t {
 public:
     static scoped_ptr_t<ql::query_params_t> parse_query_from_buffer(
-            scoped_array_t<char> &&mutable_buffer, size_t offset,
+            counted_t<shared_buf_t> &&mutable_buffer, size_t offset,
             ql::query_cache_t *query_cache, int64_t token,
             ql::response_t *error_out);
 
-    static scoped_ptr_t<ql::query_params_t> parse_query(tcp_conn_t *conn,
-                                                        signal_t *interruptor,
-                                                        ql::query_cache_t *query_cache);
+    typedef size_t (*send_response_fn_t)(ql::response_t *response,
+                                         int64_t token,
+                                         tcp_conn_t *conn,
+                                         signal_t *interruptor);
+
+    // Queries are always JSON, but errors reading them are sent back with
+    // `send_error`, so that protocols with other response encodings can reuse this.
+    static scoped_ptr_t<ql::query_params_t> parse_query(
+            tcp_conn_t *conn,
+            signal_t *interruptor,
+            ql::query_cache_t *query_cache,
+            send_response_fn_t send_error = &json_protocol_t::send_response);
 
     // Used by the HTTP ReQL server to write the query response into the HTTP response
     static void write_response_to_buffer(ql::response_t *response,
                                          rapidjson::StringBuffer *buffer_out);
 
-    static void send_response(ql::response_t *response,
-                              int64_t token,
-                              tcp_conn_t *conn,
-                              signal_t *interruptor);
+    // Returns how many bytes were sent.
+    static size_t send_response(ql::response_t *response,
+                                int64_t token,
+                                tcp_conn_t *conn,
+                                signal_t *interruptor);
 };
 
 #endif // CLIENT_PROTOCOL_JSON_HPP_
@@ -18,6 +18,7 @@
 
 #include "arch/arch.hpp"
 #include "arch/io/network.hpp"
+#include "arch/runtime/event_queue.hpp"
 #include "client_protocol/client_server_error.hpp"
 #include "client_protocol/protocols.hpp"
 #include "clustering/administration/auth/authentication_error.hpp"
@@ -40,6 +41,8 @@
 #include "rdb_protocol/ql2proto.hpp"
 #include "rdb_protocol/query_server.hpp"
 #include "rdb_protocol/query_cache.hpp"
+#include "rdb_protocol/query_stats.hpp"
+#include "rdb_protocol/query_trace.hpp"
 #include "rdb_protocol/response.hpp"
 #include "rpc/semilattice/view.hpp"
 #include "time.hpp"
@@ -193,17 +196,26 @@ query_server_t::query_server_t(rdb_context_t *_rdb_ctx,
                                int port,
                                query_handler_t *_handler,
                                uint32_t http_timeout_sec,
-                               tls_ctx_t *_tls_ctx) :
+                               tls_ctx_t *_tls_ctx,
+                               bool accept_on_all_threads) :
         tls_ctx(_tls_ctx),
         rdb_ctx(_rdb_ctx),
         handler(_handler),
         http_conn_cache(http_timeout_sec),
         next_thread(0) {
     rassert(rdb_ctx != nullptr);
+    thread_drainers.init(new one_per_thread_t<auto_drainer_t>);
     try {
-        tcp_listener.init(new tcp_listener_t(local_addresses, port,
-            std::bind(&query_server_t::handle_conn,
-                      this, ph::_1, auto_drainer_t::lock_t(&drainer))));
+        if (accept_on_all_threads) {
+            reuseport_tcp_listener.init(new reuseport_tcp_listener_t(
+                local_addresses, port,
+                std::bind(&query_server_t::handle_conn_on_accepting_thread,
+                          this, ph::_1)));
+        } else {
+            tcp_listener.init(new tcp_listener_t(local_addresses, port,
+                std::bind(&query_server_t::handle_conn,
+                          this, ph::_1, auto_drainer_t::lock_t(&drainer))));
+        }
     } catch (const address_in_use_exc_t &ex) {
         throw address_in_use_exc_t(
             strprintf("Could not bind to RDB protocol port: %s", ex.what()));
@@ -213,7 +225,9 @@ query_server_t::query_server_t(rdb_context_t *_rdb_ctx,
 query_server_t::~query_server_t() { }
 
 int query_server_t::get_port() const {
-    return tcp_listener->get_port();
+    return tcp_listener.has()
+        ? tcp_listener->get_port()
+        : reuseport_tcp_listener->get_port();
 }
 
 void write_datum(tcp_conn_t *connection, ql::datum_t datum, signal_t *interruptor) {
@@ -258,11 +272,65 @@ void query_server_t::handle_conn(const scoped_ptr_t<tcp_conn_descriptor_t> &ncon
 
     cross_thread_signal_t ct_keepalive(keepalive.get_drain_signal(), chosen_thread);
     on_thread_t rethreader(chosen_thread);
+    serve_conn(nconn, &ct_keepalive);
+}
+
+void query_server_t::handle_conn_on_accepting_thread(
+        const scoped_ptr_t<tcp_conn_descriptor_t> &nconn) {
+    auto_drainer_t::lock_t keepalive(thread_drainers->get());
+    serve_conn(nconn, keepalive.get_drain_signal());
+}
+
+/* Moves `conn` between threads along with the coroutine, and back to the thread it
+started on when it's destroyed. */
+class conn_thread_switcher_t {
+public:
+    explicit conn_thread_switcher_t(tcp_conn_t *_conn)
+        : conn(_conn), thread_switcher(get_thread_id()) { }
+    ~conn_thread_switcher_t() {
+        move_to(thread_switcher.home_thread());
+    }
+
+    // Moves straight to `thread`, without going through the original thread.  It
+    // doesn't do anything if `thread` is the current thread.
+    void move_to(threadnum_t thread) {
+        if (thread != get_thread_id()) {
+            conn->rethread(INVALID_THREAD);
+            thread_switcher.switch_to(thread);
+            conn->rethread(thread);
+        }
+    }
+
+private:
+    tcp_conn_t *const conn;
+    on_thread_t thread_switcher;
+
+    DISABLE_COPYING(conn_thread_switcher_t);
+};
+
+// Returns the least busy db thread, if it's less busy than the current thread by at
+// least `CONNECTION_REBALANCE_MIN_LOAD_GAP`.
+optional<threadnum_t> find_less_busy_thread() {
+    const threadnum_t here = get_thread_id();
+    const double load_here = event_loop_stats_t::get_load(here);
+    optional<threadnum_t> best;
+    double best_load = load_here - CONNECTION_REBALANCE_MIN_LOAD_GAP;
+    for (int i = 0; i < get_num_db_threads(); ++i) {
+        const double load = event_loop_stats_t::get_load(threadnum_t(i));
+        if (i != here.threadnum && load <= best_load) {
+            best.set(threadnum_t(i));
+            best_load = load;
+        }
+    }
+    return best;
+}
 
+void query_server_t::serve_conn(const scoped_ptr_t<tcp_conn_descriptor_t> &nconn,
+                                signal_t *keepalive) {
     scoped_ptr_t<tcp_conn_t> conn;
 
     try {
-        nconn->make_server_connection(tls_ctx, &conn, &ct_keepalive);
+        nconn->make_server_connection(tls_ctx, &conn, keepalive);
     } catch (const interrupted_exc_t &) {
         // TLS handshake was interrupted.
         return;
@@ -273,6 +341,7 @@ void query_server_t::handle_conn(const scoped_ptr_t<tcp_conn_descriptor_t> &ncon
     }
 
     uint8_t version = 0;
+    bool use_cbor = false;
     std::unique_ptr<auth::base_authenticator_t> authenticator;
     uint32_t error_code = 0;
     std::string error_message;
@@ -281,7 +350,7 @@ void query_server_t::handle_conn(const scoped_ptr_t<tcp_conn_descriptor_t> &ncon
 
         int32_t client_magic_number;
         conn->read_buffered(
-            &client_magic_number, sizeof(client_magic_number), &ct_keepalive);
+            &client_magic_number, sizeof(client_magic_number), keepalive);
 #ifdef __s390x__
         client_magic_number = __builtin_bswap32(client_magic_number);
 #endif
@@ -319,7 +388,7 @@ void query_server_t::handle_conn(const scoped_ptr_t<tcp_conn_descriptor_t> &ncon
                 new auth::plaintext_authenticator_t(rdb_ctx->get_auth_watchable()));
 
             uint32_t auth_key_size;
-            conn->read_buffered(&auth_key_size, sizeof(uint32_t), &ct_keepalive);
+            conn->read_buffered(&auth_key_size, sizeof(uint32_t), keepalive);
 #ifdef __s390x__
             auth_key_size = __builtin_bswap32(auth_key_size);
 #endif
@@ -329,7 +398,7 @@ void query_server_t::handle_conn(const scoped_ptr_t<tcp_conn_descriptor_t> &ncon
             }
 
             scoped_array_t<char> auth_key_buffer(auth_key_size);
-            conn->read_buffered(auth_key_buffer.data(), auth_key_size, &ct_keepalive);
+            conn->read_buffered(auth_key_buffer.data(), auth_key_size, keepalive);
 
             try {
                 authenticator->next_message(
@@ -341,7 +410,7 @@ void query_server_t::handle_conn(const scoped_ptr_t<tcp_conn_descriptor_t> &ncon
             }
 
             int32_t wire_protocol;
-            conn->read_buffered(&wire_protocol, sizeof(wire_protocol), &ct_keepalive);
+            conn->read_buffered(&wire_protocol, sizeof(wire_protocol), keepalive);
 #ifdef __s390x__
             wire_protocol = __builtin_bswap32(wire_protocol);
 #endif
@@ -360,7 +429,7 @@ void query_server_t::handle_conn(const scoped_ptr_t<tcp_conn_descriptor_t> &ncon
             }
 
             char const *success_msg = "SUCCESS";
-            conn->write(success_msg, strlen(success_msg) + 1, &ct_keepalive);
+            conn->write(success_msg, strlen(success_msg) + 1, keepalive);
         } else {
             authenticator.reset(
                 new auth::scram_authenticator_t(rdb_ctx->get_auth_watchable()));
@@ -372,15 +441,20 @@ void query_server_t::handle_conn(const scoped_ptr_t<tcp_conn_descriptor_t> &ncon
                 datum_object_builder.overwrite("min_protocol_version", ql::datum_t(0.0));
                 datum_object_builder.overwrite(
                     "server_version", ql::datum_t(RETHINKDB_VERSION));
+                datum_object_builder.overwrite(
+                    "response_formats",
+                    ql::datum_t(std::vector<ql::datum_t>{
+                            ql::datum_t("JSON"), ql::datum_t("CBOR")},
+                        ql::configured_limits_t::unlimited));
 
                 write_datum(
                     conn.get(),
                     std::move(datum_object_builder).to_datum(),
-                    &ct_keepalive);
+                    keepalive);
             }
 
             {
-                ql::datum_t datum = read_datum(conn.get(), &ct_keepalive);
+                ql::datum_t datum = read_datum(conn.get(), keepalive);
 
                 ql::datum_t protocol_version =
                     datum.get_field("protocol_version", ql::NOTHROW);
@@ -404,6 +478,22 @@ void query_server_t::handle_conn(const scoped_ptr_t<tcp_conn_descriptor_t> &ncon
                         4, "Unsupported `authentication_method`.");
                 }
 
+                // `response_format` is optional, and defaults to JSON.
+                ql::datum_t response_format =
+                    datum.get_field("response_format", ql::NOTHROW);
+                if (response_format.has()) {
+                    if (response_format.get_type() != ql::datum_t::R_STR) {
+                        throw client_protocol::client_server_error_t(
+                            6, "Expected a string for `response_format`.");
+                    }
+                    if (response_format.as_str() == "CBOR") {
+                        use_cbor = true;
+                    } else if (response_format.as_str() != "JSON") {
+                        throw client_protocol::client_server_error_t(
+                            7, "Unsupported `response_format`.");
+                    }
+                }
+
                 ql::datum_t authentication =
                     datum.get_field("authentication", ql::NOTHROW);
                 if (authentication.get_type() != ql::datum_t::R_STR) {
@@ -421,11 +511,11 @@ void query_server_t::handle_conn(const scoped_ptr_t<tcp_conn_descriptor_t> &ncon
                 write_datum(
                     conn.get(),
                     std::move(datum_object_builder).to_datum(),
-                    &ct_keepalive);
+                    keepalive);
             }
 
             {
-                ql::datum_t datum = read_datum(conn.get(), &ct_keepalive);
+                ql::datum_t datum = read_datum(conn.get(), keepalive);
 
                 ql::datum_t authentication =
                     datum.get_field("authentication", ql::NOTHROW);
@@ -444,7 +534,7 @@ void query_server_t::handle_conn(const scoped_ptr_t<tcp_conn_descriptor_t> &ncon
                 write_datum(
                     conn.get(),
                     std::move(datum_object_builder).to_datum(),
-                    &ct_keepalive);
+                    keepalive);
             }
         }
 
@@ -452,21 +542,58 @@ void query_server_t::handle_conn(const scoped_ptr_t<tcp_conn_descriptor_t> &ncon
         UNUSED bool peer_res = conn->getpeername(&client_addr_port);
 
         guarantee(authenticator != nullptr);
-        ql::query_cache_t query_cache(
-            rdb_ctx,
-            client_addr_port,
-            (version < 4)
-                ? ql::return_empty_normal_batches_t::YES
-                : ql::return_empty_normal_batches_t::NO,
-            auth::user_context_t(authenticator->get_authenticated_username()));
-
-        connection_loop<json_protocol_t>(
-            conn.get(),
-            (version < 4)
-                ? 1
-                : 1024,
-            &query_cache,
-            &ct_keepalive);
+        const auth::user_context_t user_context(
+            authenticator->get_authenticated_username());
+
+        // The connection starts out on this thread, and `connection_loop` returns
+        // whenever it should move to another one.
+        const threadnum_t original_thread = get_thread_id();
+        optional<threadnum_t> query_thread(original_thread);
+        std::exception_ptr err;
+        {
+            conn_thread_switcher_t thread_switcher(conn.get());
+            while (query_thread.has_value() && !err) {
+                thread_switcher.move_to(*query_thread);
+                /* `keepalive` lives on the original thread.  All of our drainers are
+                pulsed when the server shuts down, so on other threads we use their own
+                drainers instead. */
+                scoped_ptr_t<auto_drainer_t::lock_t> thread_keepalive;
+                signal_t *conn_keepalive = keepalive;
+                if (*query_thread != original_thread) {
+                    thread_keepalive.init(
+                        new auto_drainer_t::lock_t(thread_drainers->get()));
+                    conn_keepalive = thread_keepalive->get_drain_signal();
+                }
+                try {
+                    ql::query_cache_t query_cache(
+                        rdb_ctx,
+                        client_addr_port,
+                        (version < 4)
+                            ? ql::return_empty_normal_batches_t::YES
+                            : ql::return_empty_normal_batches_t::NO,
+                        user_context);
+
+                    if (use_cbor) {
+                        query_thread = connection_loop<cbor_protocol_t>(
+                            conn.get(), 1024, &query_cache, conn_keepalive);
+                    } else {
+                        query_thread = connection_loop<json_protocol_t>(
+                            conn.get(),
+                            (version < 4)
+                                ? 1
+                                : 1024,
+                            &query_cache,
+                            conn_keepalive);
+                    }
+                } catch (...) {
+                    // We can't switch threads while the exception is active.
+                    err = std::current_exception();
+                }
+            }
+        }
+        if (err) {
+            std::rethrow_exception(err);
+        }
     } catch (client_protocol::client_server_error_t const &error) {
         // We can't write the response here due to coroutine switching inside an
         // exception handler
@@ -495,7 +622,7 @@ void query_server_t::handle_conn(const scoped_ptr_t<tcp_conn_descriptor_t> &ncon
         try {
             if (version < 10) {
                 std::string error = "ERROR: " + error_message + "\n";
-                conn->write(error.c_str(), error.length() + 1, &ct_keepalive);
+                conn->write(error.c_str(), error.length() + 1, keepalive);
             } else {
                 ql::datum_object_builder_t datum_object_builder;
                 datum_object_builder.overwrite("success", ql::datum_t::boolean(false));
@@ -506,7 +633,7 @@ void query_server_t::handle_conn(const scoped_ptr_t<tcp_conn_descriptor_t> &ncon
                 write_datum(
                     conn.get(),
                     std::move(datum_object_builder).to_datum(),
-                    &ct_keepalive);
+                    keepalive);
             }
 
             conn->shutdown_write();
@@ -560,11 +687,41 @@ void save_exception(std::exception_ptr *err,
     }
 }
 
+// Makes a CONTINUE query for the cursor with the given token, as if the client had
+// sent one.  Returns an empty pointer and fills in `error_out` if that fails.
+static scoped_ptr_t<ql::query_params_t> make_continue_query(
+        ql::query_cache_t *query_cache,
+        int64_t token,
+        ql::response_t *error_out) {
+    static const char continue_query[] = "[2]";
+    counted_t<shared_buf_t> continue_buf = shared_buf_t::create(sizeof(continue_query));
+    memcpy(continue_buf->data(), continue_query, sizeof(continue_query));
+    return json_protocol_t::parse_query_from_buffer(std::move(continue_buf), 0,
+                                                    query_cache, token, error_out);
+}
+
+// Keeps the trace of `query`, if it's one of the sampled ones, with the time it took to
+// write its response, if it had one.
+static void record_query_trace(ql::query_params_t *query,
+                               int64_t send_start_nanos,
+                               int64_t send_end_nanos) {
+    if (!query->trace.has()) {
+        return;
+    }
+    if (send_end_nanos != 0) {
+        query->trace->add_span(0, "response_write", send_start_nanos, send_end_nanos);
+    }
+    query->trace->fingerprint = query->fingerprint;
+    ql::query_trace_log_t::record(std::move(*query->trace));
+    query->trace.reset();
+}
+
 template <class protocol_t>
-void query_server_t::connection_loop(tcp_conn_t *conn,
-                                     size_t max_concurrent_queries,
-                                     ql::query_cache_t *query_cache,
-                                     signal_t *drain_signal) {
+optional<threadnum_t> query_server_t::connection_loop(tcp_conn_t *conn,
+                                                      size_t max_concurrent_queries,
+                                                      ql::query_cache_t *query_cache,
+                                                      signal_t *drain_signal) {
+    optional<threadnum_t> move_to;
     std::exception_ptr err;
     std::string err_str;
     cond_t abort;
@@ -580,17 +737,63 @@ void query_server_t::connection_loop(tcp_conn_t *conn,
 #endif  // __linux
 
     new_semaphore_t sem(max_concurrent_queries);
+    // The number of queries whose coroutines are still running, and a signal for when
+    // that drops to zero, if we're waiting for that.
+    int64_t num_running = 0;
+    scoped_ptr_t<cond_t> none_running;
+    ticks_t next_rebalance_check{
+        get_ticks().nanos + CONNECTION_REBALANCE_INTERVAL_MS * MILLION};
     auto_drainer_t coro_drainer;
     while (!err) {
+        if (get_ticks().nanos >= next_rebalance_check.nanos) {
+            next_rebalance_check.nanos =
+                get_ticks().nanos + CONNECTION_REBALANCE_INTERVAL_MS * MILLION;
+            optional<threadnum_t> thread = find_less_busy_thread();
+            if (thread.has_value() && query_cache->empty()) {
+                // Clients that pipeline their queries have to wait a bit here, but
+                // most wait for their queries' responses anyway.
+                if (num_running > 0) {
+                    none_running.init(new cond_t());
+                    wait_interruptible(none_running.get(), &interruptor);
+                    none_running.reset();
+                }
+                if (query_cache->empty()) {
+                    move_to = thread;
+                    break;
+                }
+            }
+        }
+
+#ifdef __linux
+        /* Wait for the next query, but only until the next rebalance check, so that
+        idle connections get moved too.  Reading is only interruptible by closing the
+        connection, so we wait for it to become readable instead.  That doesn't work
+        with TLS, which may already have read the data from the socket. */
+        const_charslice buffered = conn->peek();
+        if (tls_ctx == nullptr && buffered.beg == buffered.end) {
+            signal_timer_t check_timer(std::max<int64_t>(
+                0, (next_rebalance_check.nanos - get_ticks().nanos) / MILLION));
+            linux_event_watcher_t::watch_t readable(ew, poll_event_in);
+            wait_any_t readable_or_check(&readable, &check_timer);
+            wait_interruptible(&readable_or_check, &interruptor);
+            if (!readable.is_pulsed()) {
+                continue;
+            }
+        }
+#endif  // __linux
+
         scoped_ptr_t<ql::query_params_t> outer_query =
             protocol_t::parse_query(conn, &interruptor, query_cache);
         if (outer_query.has()) {
+            outer_query->trace =
+                ql::query_trace_log_t::maybe_start(outer_query->received_time);
             outer_query->throttler.init(&sem, 1);
             wait_interruptible(outer_query->throttler.acquisition_signal(),
                                &interruptor);
             coro_t::spawn_now_dangerously([&]() {
                 // We grab this right away while it's still valid.
                 scoped_ptr_t<ql::query_params_t> query = std::move(outer_query);
+                ++num_running;
                 // Since we `spawn_now_dangerously` it's always safe to acquire this.
                 auto_drainer_t::lock_t coro_drainer_lock(&coro_drainer);
                 wait_any_t cb_interruptor(coro_drainer_lock.get_drain_signal(),
@@ -602,9 +805,52 @@ void query_server_t::connection_loop(tcp_conn_t *conn,
                     handler->run_query(query.get(), &response, &cb_interruptor);
                     if (!query->noreply) {
                         new_mutex_acq_t send_lock(&send_mutex, &cb_interruptor);
-                        protocol_t::send_response(&response, query->token,
-                                                  conn, &cb_interruptor);
+                        const int64_t send_start_nanos = get_ticks().nanos;
+                        const size_t bytes_sent = protocol_t::send_response(
+                            &response, query->token, conn, &cb_interruptor);
                         replied = true;
+                        if (query->fingerprint) {
+                            ql::query_stats_t stats;
+                            stats.bytes_sent = bytes_sent;
+                            ql::record_query_stats(*query->fingerprint, stats);
+                        }
+                        record_query_trace(query.get(), send_start_nanos,
+                                           get_ticks().nanos);
+                    } else {
+                        record_query_trace(query.get(), 0, 0);
+                    }
+
+                    // The client granted the cursor credits, so we send it batches
+                    // without waiting for CONTINUE queries.  Each batch is sent before
+                    // the next one is read, so they go out in order even if the
+                    // client's own CONTINUE queries are being served at the same time.
+                    while (query_cache->take_credit(query->token)) {
+                        ql::response_t batch;
+                        scoped_ptr_t<ql::query_params_t> continue_query =
+                            make_continue_query(query_cache, query->token, &batch);
+                        if (continue_query.has()) {
+                            continue_query->trace = ql::query_trace_log_t::maybe_start(
+                                continue_query->received_time);
+                            continue_query->throttler.init(&sem, 1);
+                            wait_interruptible(
+                                continue_query->throttler.acquisition_signal(),
+                                &cb_interruptor);
+                            handler->run_query(continue_query.get(), &batch,
+                                               &cb_interruptor);
+                        }
+                        new_mutex_acq_t send_lock(&send_mutex, &cb_interruptor);
+                        const int64_t send_start_nanos = get_ticks().nanos;
+                        const size_t bytes_sent = protocol_t::send_response(
+                            &batch, query->token, conn, &cb_interruptor);
+                        if (continue_query.has() && continue_query->fingerprint) {
+                            ql::query_stats_t stats;
+                            stats.bytes_sent = bytes_sent;
+                            ql::record_query_stats(*continue_query->fingerprint, stats);
+                        }
+                        if (continue_query.has()) {
+                            record_query_trace(continue_query.get(), send_start_nanos,
+                                               get_ticks().nanos);
+                        }
                     }
                 });
                 save_exception(&err, &err_str, &abort, [&]() {
@@ -616,6 +862,10 @@ void query_server_t::connection_loop(tcp_conn_t *conn,
                                                   conn, &cb_interruptor);
                     }
                 });
+                --num_running;
+                if (num_running == 0 && none_running.has()) {
+                    none_running->pulse_if_not_already_pulsed();
+                }
             });
             guarantee(!outer_query.has());
             // Since we're using `spawn_now_dangerously` above, we need to yield
@@ -628,6 +878,28 @@ void query_server_t::connection_loop(tcp_conn_t *conn,
     if (err) {
         std::rethrow_exception(err);
     }
+    return move_to;
+}
+
+// Frames `response` for the HTTP interface, like the TCP protocol does.
+static std::string encode_http_response(ql::response_t *response, int64_t token) {
+    rapidjson::StringBuffer buffer;
+    json_protocol_t::write_response_to_buffer(response, &buffer);
+
+    uint32_t size = static_cast<uint32_t>(buffer.GetSize());
+#ifdef __s390x__
+    size = __builtin_bswap32(size);
+    token = __builtin_bswap64(token);
+#endif
+    char header_buffer[sizeof(token) + sizeof(size)];
+    memcpy(&header_buffer[0], &token, sizeof(token));
+    memcpy(&header_buffer[sizeof(token)], &size, sizeof(size));
+
+    std::string body_data;
+    body_data.reserve(sizeof(header_buffer) + buffer.GetSize());
+    body_data.append(&header_buffer[0], sizeof(header_buffer));
+    body_data.append(buffer.GetString(), buffer.GetSize());
+    return body_data;
 }
 
 void query_server_t::handle(const http_req_t &req,
@@ -668,12 +940,12 @@ void query_server_t::handle(const http_req_t &req,
     }
 
     // Copy the body into a mutable buffer so we can move it into parse_json_pb.
-    scoped_array_t<char> body_buf(req.body.size() + 1);
-    memcpy(body_buf.data(), req.body.data(), req.body.size());
-    body_buf[req.body.size()] = '\0';
+    counted_t<shared_buf_t> body_buf = shared_buf_t::create(req.body.size() + 1);
+    memcpy(body_buf->data(), req.body.data(), req.body.size());
+    body_buf->data()[req.body.size()] = '\0';
 
     // Parse the token out from the start of the request
-    char *data = body_buf.data();
+    char *data = body_buf->data();
     token = *reinterpret_cast<const int64_t *>(data);
 #ifdef __s390x__
     token = __builtin_bswap64(token);
@@ -704,68 +976,83 @@ void query_server_t::handle(const http_req_t &req,
                 return;
             }
 
-            wait_any_t true_interruptor(interruptor, conn->get_interruptor(),
-                                        drainer.get_drain_signal());
-
-            try {
-                ticks_t start = get_ticks();
-                // We don't throttle HTTP queries.
-                handler->run_query(query.get(), &response, &true_interruptor);
-                ticks_t ticks = ticks_t{get_ticks().nanos - start.nanos};
-
-                if (!response.profile()) {
-                    ql::datum_array_builder_t array_builder(
-                        ql::configured_limits_t::unlimited);
-                    ql::datum_object_builder_t object_builder;
-                    object_builder.overwrite("duration(ms)",
-                        ql::datum_t(static_cast<double>(ticks.nanos) / MILLION));
-                    array_builder.add(std::move(object_builder).to_datum());
-                    response.set_profile(std::move(array_builder).to_datum());
-                }
-            } catch (const interrupted_exc_t &ex) {
-                if (http_conn_cache.is_expired(*conn)) {
-                    response.fill_error(Response::RUNTIME_ERROR,
-                                        Response::OP_INDETERMINATE,
-                                        http_conn_cache.expired_error_message(),
-                                        ql::backtrace_registry_t::EMPTY_BACKTRACE);
-                } else if (interruptor->is_pulsed()) {
-                    response.fill_error(Response::RUNTIME_ERROR,
-                                        Response::OP_INDETERMINATE,
-                                        "This ReQL connection has been terminated.",
-                                        ql::backtrace_registry_t::EMPTY_BACKTRACE);
-                } else if (drainer.is_draining()) {
-                    response.fill_error(Response::RUNTIME_ERROR,
-                                        Response::OP_INDETERMINATE,
-                                        "Server is shutting down.",
-                                        ql::backtrace_registry_t::EMPTY_BACKTRACE);
-                } else if (conn->get_interruptor()->is_pulsed()) {
-                    response.fill_error(Response::RUNTIME_ERROR,
-                                        Response::OP_INDETERMINATE,
-                                        "This ReQL connection has been terminated.",
-                                        ql::backtrace_registry_t::EMPTY_BACKTRACE);
-                } else {
-                    throw;
-                }
-            }
+            run_http_query(conn.get(), query.get(), &response, interruptor);
         }
     }
 
-    rapidjson::StringBuffer buffer;
-    json_protocol_t::write_response_to_buffer(&response, &buffer);
+    result->set_body("application/octet-stream",
+                     encode_http_response(&response, token));
+    result->code = http_status_code_t::OK;
 
-    uint32_t size = static_cast<uint32_t>(buffer.GetSize());
-#ifdef __s390x__
-    size = __builtin_bswap32(size);
-    token = __builtin_bswap64(token);
-#endif
-    char header_buffer[sizeof(token) + sizeof(size)];
-    memcpy(&header_buffer[0], &token, sizeof(token));
-    memcpy(&header_buffer[sizeof(token)], &size, sizeof(size));
+    // With `stream=true`, we send all of a cursor's batches in one chunked response,
+    // each with the same framing as a single response.
+    optional<std::string> stream = req.find_query_param("stream");
+    if (conn.has() && response.type() == Response::SUCCESS_PARTIAL
+        && req.version == "1.1" && stream && *stream == "true") {
+        result->next_chunk = [this, conn, token, auto_drainer_lock, done = false](
+                std::string *chunk_out, signal_t *chunk_interruptor) mutable {
+            if (done) {
+                return false;
+            }
+            ql::response_t continue_response;
+            scoped_ptr_t<ql::query_params_t> query = make_continue_query(
+                conn->get_query_cache(), token, &continue_response);
+            if (query.has()) {
+                run_http_query(conn.get(), query.get(), &continue_response,
+                               chunk_interruptor);
+            }
+            done = continue_response.type() != Response::SUCCESS_PARTIAL;
+            *chunk_out = encode_http_response(&continue_response, token);
+            return true;
+        };
+    }
+}
 
-    std::string body_data;
-    body_data.reserve(sizeof(header_buffer) + buffer.GetSize());
-    body_data.append(&header_buffer[0], sizeof(header_buffer));
-    body_data.append(buffer.GetString(), buffer.GetSize());
-    result->set_body("application/octet-stream", body_data);
-    result->code = http_status_code_t::OK;
+void query_server_t::run_http_query(http_conn_cache_t::http_conn_t *conn,
+                                    ql::query_params_t *query,
+                                    ql::response_t *response,
+                                    signal_t *interruptor) {
+    wait_any_t true_interruptor(interruptor, conn->get_interruptor(),
+                                drainer.get_drain_signal());
+
+    try {
+        ticks_t start = get_ticks();
+        // We don't throttle HTTP queries.
+        handler->run_query(query, response, &true_interruptor);
+        ticks_t ticks = ticks_t{get_ticks().nanos - start.nanos};
+
+        if (!response->profile()) {
+            ql::datum_array_builder_t array_builder(
+                ql::configured_limits_t::unlimited);
+            ql::datum_object_builder_t object_builder;
+            object_builder.overwrite("duration(ms)",
+                ql::datum_t(static_cast<double>(ticks.nanos) / MILLION));
+            array_builder.add(std::move(object_builder).to_datum());
+            response->set_profile(std::move(array_builder).to_datum());
+        }
+    } catch (const interrupted_exc_t &ex) {
+        if (http_conn_cache.is_expired(*conn)) {
+            response->fill_error(Response::RUNTIME_ERROR,
+                                 Response::OP_INDETERMINATE,
+                                 http_conn_cache.expired_error_message(),
+                                 ql::backtrace_registry_t::EMPTY_BACKTRACE);
+        } else if (interruptor->is_pulsed()) {
+            response->fill_error(Response::RUNTIME_ERROR,
+                                 Response::OP_INDETERMINATE,
+                                 "This ReQL connection has been terminated.",
+                                 ql::backtrace_registry_t::EMPTY_BACKTRACE);
+        } else if (drainer.is_draining()) {
+            response->fill_error(Response::RUNTIME_ERROR,
+                                 Response::OP_INDETERMINATE,
+                                 "Server is shutting down.",
+                                 ql::backtrace_registry_t::EMPTY_BACKTRACE);
+        } else if (conn->get_interruptor()->is_pulsed()) {
+            response->fill_error(Response::RUNTIME_ERROR,
+                                 Response::OP_INDETERMINATE,
+                                 "This ReQL connection has been terminated.",
+                                 ql::backtrace_registry_t::EMPTY_BACKTRACE);
+        } else {
+            throw;
+        }
+    }
 }
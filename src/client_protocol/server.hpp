@@ -16,12 +16,20 @@
 #include "arch/timing.hpp"
 #include "concurrency/auto_drainer.hpp"
 #include "concurrency/cross_thread_signal.hpp"
+#include "concurrency/one_per_thread.hpp"
 #include "containers/archive/archive.hpp"
 #include "containers/counted.hpp"
+#include "containers/optional.hpp"
 #include "http/http.hpp"
 #include "perfmon/perfmon.hpp"
 #include "utils.hpp"
 
+/* How often each driver connection checks whether it should move to a less busy
+thread, and by how much (as a fraction of the time that it's not waiting for events)
+that thread must be less busy than the connection's thread. */
+#define CONNECTION_REBALANCE_INTERVAL_MS  10000
+#define CONNECTION_REBALANCE_MIN_LOAD_GAP 0.25
+
 class auth_key_t;
 
 class rdb_context_t;
@@ -103,7 +111,8 @@ public:
         int port,
         query_handler_t *_handler,
         uint32_t http_timeout_sec,
-        tls_ctx_t* tls_ctx);
+        tls_ctx_t* tls_ctx,
+        bool accept_on_all_threads = false);
     ~query_server_t();
 
     int get_port() const;
@@ -117,18 +126,30 @@ private:
     // For the client driver socket
     void handle_conn(const scoped_ptr_t<tcp_conn_descriptor_t> &nconn,
                      auto_drainer_t::lock_t);
-
-    // This is templatized based on the wire protocol requested by the client
+    // Called by `reuseport_tcp_listener`, on the thread that accepted the connection
+    void handle_conn_on_accepting_thread(
+        const scoped_ptr_t<tcp_conn_descriptor_t> &nconn);
+    void serve_conn(const scoped_ptr_t<tcp_conn_descriptor_t> &nconn,
+                    signal_t *keepalive);
+
+    // This is templatized based on the wire protocol requested by the client.  If
+    // the connection's thread has been busier than some other thread, it returns that
+    // thread once the connection has no queries running, no cursors, and no prepared
+    // queries, and `serve_conn` moves the connection there.
     template<class protocol_t>
-    void connection_loop(tcp_conn_t *conn,
-                         size_t max_concurrent_queries,
-                         ql::query_cache_t *query_cache,
-                         signal_t *interruptor);
+    optional<threadnum_t> connection_loop(tcp_conn_t *conn,
+                                          size_t max_concurrent_queries,
+                                          ql::query_cache_t *query_cache,
+                                          signal_t *interruptor);
 
     // For HTTP server
     void handle(const http_req_t &request,
                 http_res_t *result,
                 signal_t *interruptor);
+    void run_http_query(http_conn_cache_t::http_conn_t *conn,
+                        ql::query_params_t *query,
+                        ql::response_t *response,
+                        signal_t *interruptor);
 
     tls_ctx_t *tls_ctx;
     rdb_context_t *const rdb_ctx;
@@ -136,8 +157,14 @@ private:
 
     /* WARNING: The order here is fragile. */
     auto_drainer_t drainer;
+    /* Used instead of `drainer` by the connections that aren't on our thread: those
+    that `reuseport_tcp_listener` accepts, and those that `serve_conn` moves to another
+    thread to balance the load. */
+    scoped_ptr_t<one_per_thread_t<auto_drainer_t> > thread_drainers;
     http_conn_cache_t http_conn_cache;
+    /* Only one of these is used. */
     scoped_ptr_t<tcp_listener_t> tcp_listener;
+    scoped_ptr_t<reuseport_tcp_listener_t> reuseport_tcp_listener;
 
     int next_thread;
 };
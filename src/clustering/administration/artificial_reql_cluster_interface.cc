@@ -754,6 +754,8 @@ artificial_reql_cluster_backends_t::artificial_reql_cluster_backends_t(
         name_string_t::guarantee_valid("server_status"),
         std::make_pair(server_status_backend[0].get(), server_status_backend[1].get()));
 
+    stats_snapshot_cache.init(
+        new stats_snapshot_cache_t(directory_view, mailbox_manager));
     for (int format = 0; format < 2; ++format) {
         stats_backend[format].init(
             new stats_artificial_table_backend_t(
@@ -763,7 +765,7 @@ artificial_reql_cluster_backends_t::artificial_reql_cluster_backends_t(
                 cluster_semilattice_view,
                 server_config_client,
                 table_meta_client,
-                mailbox_manager,
+                stats_snapshot_cache.get(),
                 static_cast<admin_identifier_format_t>(format)));
     }
     stats_sentry = backend_sentry_t(
@@ -832,6 +834,8 @@ artificial_reql_cluster_backends_t::artificial_reql_cluster_backends_t(
 
     debug_stats_backend.init(
         new debug_stats_artificial_table_backend_t(
+            name_string_t::guarantee_valid("_debug_stats"),
+            std::vector<stat_manager_t::stat_id_t>(),
             rdb_context,
             name_resolver,
             directory_map_view,
@@ -842,6 +846,53 @@ artificial_reql_cluster_backends_t::artificial_reql_cluster_backends_t(
         name_string_t::guarantee_valid("_debug_stats"),
         std::make_pair(debug_stats_backend.get(), debug_stats_backend.get()));
 
+    debug_profile_backend.init(
+        new debug_stats_artificial_table_backend_t(
+            name_string_t::guarantee_valid("_debug_profile"),
+            std::vector<stat_manager_t::stat_id_t>{CORO_SAMPLER_STAT_NAME},
+            rdb_context,
+            name_resolver,
+            directory_map_view,
+            server_config_client,
+            mailbox_manager));
+    debug_profile_sentry = backend_sentry_t(
+        artificial_reql_cluster_interface->get_table_backends_map_mutable(),
+        name_string_t::guarantee_valid("_debug_profile"),
+        std::make_pair(debug_profile_backend.get(), debug_profile_backend.get()));
+
+    query_stats_backend.init(
+        new query_stats_artificial_table_backend_t(
+            rdb_context,
+            name_resolver,
+            directory_view,
+            mailbox_manager));
+    query_stats_sentry = backend_sentry_t(
+        artificial_reql_cluster_interface->get_table_backends_map_mutable(),
+        name_string_t::guarantee_valid("_query_stats"),
+        std::make_pair(query_stats_backend.get(), query_stats_backend.get()));
+
+    slow_queries_backend.init(
+        new slow_queries_artificial_table_backend_t(
+            rdb_context,
+            name_resolver,
+            directory_view,
+            mailbox_manager));
+    slow_queries_sentry = backend_sentry_t(
+        artificial_reql_cluster_interface->get_table_backends_map_mutable(),
+        name_string_t::guarantee_valid("_slow_queries"),
+        std::make_pair(slow_queries_backend.get(), slow_queries_backend.get()));
+
+    query_traces_backend.init(
+        new query_traces_artificial_table_backend_t(
+            rdb_context,
+            name_resolver,
+            directory_view,
+            mailbox_manager));
+    query_traces_sentry = backend_sentry_t(
+        artificial_reql_cluster_interface->get_table_backends_map_mutable(),
+        name_string_t::guarantee_valid("_query_traces"),
+        std::make_pair(query_traces_backend.get(), query_traces_backend.get()));
+
     debug_table_status_backend.init(
         new debug_table_status_artificial_table_backend_t(
             rdb_context,
@@ -11,6 +11,9 @@
 #include "clustering/administration/servers/server_config.hpp"
 #include "clustering/administration/servers/server_status.hpp"
 #include "clustering/administration/stats/debug_stats_backend.hpp"
+#include "clustering/administration/stats/query_stats_backend.hpp"
+#include "clustering/administration/stats/query_traces_backend.hpp"
+#include "clustering/administration/stats/slow_queries_backend.hpp"
 #include "clustering/administration/stats/stats_backend.hpp"
 #include "clustering/administration/tables/db_config.hpp"
 #include "clustering/administration/tables/debug_table_status.hpp"
@@ -327,6 +330,7 @@ private:
     scoped_ptr_t<server_status_artificial_table_backend_t> server_status_backend[2];
     backend_sentry_t server_status_sentry;
 
+    scoped_ptr_t<stats_snapshot_cache_t> stats_snapshot_cache;
     scoped_ptr_t<stats_artificial_table_backend_t> stats_backend[2];
     backend_sentry_t stats_sentry;
 
@@ -345,6 +349,18 @@ private:
     scoped_ptr_t<debug_stats_artificial_table_backend_t> debug_stats_backend;
     backend_sentry_t debug_stats_sentry;
 
+    scoped_ptr_t<debug_stats_artificial_table_backend_t> debug_profile_backend;
+    backend_sentry_t debug_profile_sentry;
+
+    scoped_ptr_t<query_stats_artificial_table_backend_t> query_stats_backend;
+    backend_sentry_t query_stats_sentry;
+
+    scoped_ptr_t<slow_queries_artificial_table_backend_t> slow_queries_backend;
+    backend_sentry_t slow_queries_sentry;
+
+    scoped_ptr_t<query_traces_artificial_table_backend_t> query_traces_backend;
+    backend_sentry_t query_traces_sentry;
+
     scoped_ptr_t<debug_table_status_artificial_table_backend_t>
         debug_table_status_backend;
     backend_sentry_t debug_table_status_sentry;
@@ -1,14 +1,67 @@
 // Copyright 2010-2015 RethinkDB, all rights reserved.
 #include "clustering/administration/auth/plaintext_authenticator.hpp"
 
+#include <array>
+
+#include "arch/runtime/runtime.hpp"
+#include "arch/runtime/thread_pool.hpp"
 #include "clustering/administration/auth/authentication_error.hpp"
 #include "clustering/administration/metadata.hpp"
+#include "concurrency/cache_line_padded.hpp"
+#include "containers/lru_cache.hpp"
 #include "crypto/compare_equal.hpp"
+#include "crypto/hmac.hpp"
 #include "crypto/pbkcs5_pbkdf2_hmac.hpp"
+#include "crypto/random.hpp"
 #include "crypto/saslprep.hpp"
 
 namespace auth {
 
+namespace {
+
+/* A user's last successful login on this thread.  `verifier` is an HMAC of the salted
+hash and the password, keyed with `get_login_secret()`.  Checking a password against it
+is cheap, so it would make guessing the password cheap for anyone who had both, but the
+secret never leaves this process's memory, where the passwords pass through anyway.
+The entry only counts while the user's hash is still `hash`, so changing the password
+invalidates it. */
+struct login_cache_entry_t {
+    std::array<unsigned char, SHA256_DIGEST_LENGTH> hash;
+    std::array<unsigned char, SHA256_DIGEST_LENGTH> verifier;
+};
+
+typedef lru_cache_t<std::string, login_cache_entry_t> login_cache_t;
+
+/* Picked when the first login is cached, and different every time the server starts. */
+const std::array<unsigned char, SHA256_DIGEST_LENGTH> &get_login_secret() {
+    static const std::array<unsigned char, SHA256_DIGEST_LENGTH> secret =
+        crypto::random_bytes<SHA256_DIGEST_LENGTH>();
+    return secret;
+}
+
+std::array<unsigned char, SHA256_DIGEST_LENGTH> compute_login_verifier(
+        const std::array<unsigned char, SHA256_DIGEST_LENGTH> &hash,
+        const std::string &prepared_password) {
+    std::string data(hash.begin(), hash.end());
+    data += prepared_password;
+    return crypto::hmac_sha256(get_login_secret(), data);
+}
+
+/* Only ever accessed on its own thread. */
+std::array<cache_line_padded_t<scoped_ptr_t<login_cache_t> >, MAX_THREADS>
+    login_caches;
+
+login_cache_t *get_login_cache() {
+    scoped_ptr_t<login_cache_t> *cache =
+        &login_caches[get_thread_id().threadnum].value;
+    if (!cache->has()) {
+        cache->init(new login_cache_t(PLAINTEXT_AUTH_CACHE_SIZE_PER_THREAD));
+    }
+    return cache->get();
+}
+
+}  // namespace
+
 plaintext_authenticator_t::plaintext_authenticator_t(
         clone_ptr_t<watchable_t<auth_semilattice_metadata_t>> auth_watchable,
         username_t const &username)
@@ -34,16 +87,38 @@ plaintext_authenticator_t::plaintext_authenticator_t(
         throw authentication_error_t(17, "Unknown user");
     }
 
-    std::array<unsigned char, SHA256_DIGEST_LENGTH> hash =
-        crypto::pbkcs5_pbkdf2_hmac_sha256(
-            crypto::saslprep(password),
-            user->get_password().get_salt(),
-            user->get_password().get_iteration_count());
+    const password_t &stored_password = user->get_password();
+    const std::string prepared_password = crypto::saslprep(password);
+    const std::array<unsigned char, SHA256_DIGEST_LENGTH> verifier =
+        compute_login_verifier(stored_password.get_hash(), prepared_password);
 
-    if (!crypto::compare_equal(user->get_password().get_hash(), hash)) {
+    login_cache_entry_t *cached;
+    if (get_login_cache()->lookup(m_username.to_string(), &cached)
+            && cached->hash == stored_password.get_hash()
+            && crypto::compare_equal(cached->verifier, verifier)) {
+        m_is_authenticated = true;
+        return "";
+    }
+
+    // The key derivation is slow on purpose, so we don't want to block the event
+    // loop with it.
+    std::array<unsigned char, SHA256_DIGEST_LENGTH> hash;
+    linux_thread_pool_t::run_in_blocker_pool([&]() {
+        hash = crypto::pbkcs5_pbkdf2_hmac_sha256(
+            prepared_password,
+            stored_password.get_salt(),
+            stored_password.get_iteration_count());
+    });
+
+    if (!crypto::compare_equal(stored_password.get_hash(), hash)) {
         throw authentication_error_t(12, "Wrong password");
     }
 
+    login_cache_t *cache = get_login_cache();
+    cache->erase(m_username.to_string());
+    cache->insert(m_username.to_string(),
+                  login_cache_entry_t{stored_password.get_hash(), verifier});
+
     m_is_authenticated = true;
 
     return "";
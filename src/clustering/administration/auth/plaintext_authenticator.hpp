@@ -7,6 +7,10 @@
 #include "clustering/administration/auth/base_authenticator.hpp"
 #include "clustering/administration/auth/user.hpp"
 
+/* How many users' last successful logins each thread remembers, so that their next
+login with the same password can skip the key derivation; see `next_message()`. */
+#define PLAINTEXT_AUTH_CACHE_SIZE_PER_THREAD 1024
+
 namespace auth {
 
 class plaintext_authenticator_t : public base_authenticator_t {
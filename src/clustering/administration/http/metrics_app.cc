@@ -0,0 +1,121 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "clustering/administration/http/metrics_app.hpp"
+
+#include <cmath>
+#include <map>
+#include <vector>
+
+#include "containers/uuid.hpp"
+#include "perfmon/collect.hpp"
+
+namespace {
+
+// Maps each metric name to its samples, so that every metric family is contiguous.
+typedef std::map<std::string, std::vector<std::string> > metric_families_t;
+
+std::string sanitize_metric_name(const std::string &name) {
+    std::string res = name;
+    for (char &c : res) {
+        if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')
+              || (c >= '0' && c <= '9') || c == '_')) {
+            c = '_';
+        }
+    }
+    return res;
+}
+
+std::string format_metric_value(double value) {
+    if (std::isnan(value)) {
+        return "NaN";
+    } else if (std::isinf(value)) {
+        return value > 0 ? "+Inf" : "-Inf";
+    }
+    return strprintf("%.15g", value);
+}
+
+std::string add_label(const std::string &labels,
+                      const char *label, const std::string &value) {
+    return labels + (labels.empty() ? "" : ",") + label + "=\"" + value + "\"";
+}
+
+void add_sample(const std::string &name, const std::string &labels, double value,
+                metric_families_t *families) {
+    (*families)[name].push_back(
+        name + (labels.empty() ? "" : "{" + labels + "}")
+        + " " + format_metric_value(value));
+}
+
+void collect_metrics(const ql::datum_t &stat,
+                     const std::string &name,
+                     const std::string &labels,
+                     metric_families_t *families) {
+    switch (stat.get_type()) {
+    case ql::datum_t::R_NUM:
+        add_sample(name, labels, stat.as_num(), families);
+        break;
+    case ql::datum_t::R_BOOL:
+        add_sample(name, labels, stat.as_bool() ? 1 : 0, families);
+        break;
+    case ql::datum_t::R_OBJECT:
+        for (size_t i = 0; i < stat.obj_size(); ++i) {
+            std::pair<datum_string_t, ql::datum_t> pair = stat.get_pair(i);
+            const std::string key = pair.first.to_std();
+            uuid_u table_id;
+            if (str_to_uuid(key, &table_id)) {
+                collect_metrics(pair.second, name, add_label(labels, "table", key),
+                                families);
+            } else {
+                collect_metrics(pair.second, name + "_" + sanitize_metric_name(key),
+                                labels, families);
+            }
+        }
+        break;
+    case ql::datum_t::R_ARRAY:
+        // Only per-thread perfmons report arrays of objects. The histograms' bucket
+        // arrays are left out.
+        for (size_t i = 0; i < stat.arr_size(); ++i) {
+            ql::datum_t thread_stat = stat.get(i);
+            if (thread_stat.get_type() == ql::datum_t::R_OBJECT) {
+                collect_metrics(thread_stat, name,
+                                add_label(labels, "thread", strprintf("%zu", i)),
+                                families);
+            }
+        }
+        break;
+    case ql::datum_t::UNINITIALIZED: // fallthru
+    case ql::datum_t::MINVAL: // fallthru
+    case ql::datum_t::R_BINARY: // fallthru
+    case ql::datum_t::R_NULL: // fallthru
+    case ql::datum_t::R_STR: // fallthru
+    case ql::datum_t::MAXVAL: // fallthru
+    default:
+        break;
+    }
+}
+
+}  // namespace
+
+std::string format_openmetrics(const ql::datum_t &stats) {
+    metric_families_t families;
+    collect_metrics(stats, "rethinkdb", "", &families);
+
+    std::string res;
+    for (const auto &family : families) {
+        res += "# TYPE " + family.first + " gauge\n";
+        for (const std::string &sample : family.second) {
+            res += sample + "\n";
+        }
+    }
+    res += "# EOF\n";
+    return res;
+}
+
+void metrics_http_app_t::handle(const http_req_t &req, http_res_t *result, signal_t *) {
+    if (req.method != http_method_t::GET) {
+        *result = http_res_t(http_status_code_t::METHOD_NOT_ALLOWED);
+        return;
+    }
+    *result = http_res_t(http_status_code_t::OK,
+                         "application/openmetrics-text; version=1.0.0; charset=utf-8",
+                         format_openmetrics(perfmon_get_stats()));
+}
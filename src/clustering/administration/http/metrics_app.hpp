@@ -0,0 +1,23 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef CLUSTERING_ADMINISTRATION_HTTP_METRICS_APP_HPP_
+#define CLUSTERING_ADMINISTRATION_HTTP_METRICS_APP_HPP_
+
+#include <string>
+
+#include "http/http.hpp"
+#include "rdb_protocol/datum.hpp"
+
+/* `metrics_http_app_t` serves this server's own perfmons at `/metrics` in the
+OpenMetrics text format, so monitoring systems can scrape every server directly.
+Unlike reading the `stats` table, it doesn't evaluate ReQL or contact other servers. */
+class metrics_http_app_t : public http_app_t {
+public:
+    void handle(const http_req_t &req, http_res_t *result, signal_t *interruptor);
+};
+
+/* Formats the output of `perfmon_get_stats()`. Every number becomes a gauge named
+after its path in the perfmon tree, except that table IDs become a `table` label and
+the entries of per-thread arrays get a `thread` label. Everything else is left out. */
+std::string format_openmetrics(const ql::datum_t &stats);
+
+#endif /* CLUSTERING_ADMINISTRATION_HTTP_METRICS_APP_HPP_ */
@@ -2,6 +2,7 @@
 #include "clustering/administration/http/server.hpp"
 
 #include "clustering/administration/http/cyanide.hpp"
+#include "clustering/administration/http/metrics_app.hpp"
 #include "http/file_app.hpp"
 #include "http/http.hpp"
 #include "http/routing_app.hpp"
@@ -20,6 +21,7 @@ administrative_http_server_manager_t::administrative_http_server_manager_t(
 #ifndef NDEBUG
     cyanide_app.init(new cyanide_http_app_t);
 #endif
+    metrics_app.init(new metrics_http_app_t);
 
     std::map<std::string, http_app_t *> ajax_routes;
     ajax_routes["reql"] = reql_app;
@@ -28,6 +30,7 @@ administrative_http_server_manager_t::administrative_http_server_manager_t(
 
     std::map<std::string, http_app_t *> root_routes;
     root_routes["ajax"] = ajax_routing_app.get();
+    root_routes["metrics"] = metrics_app.get();
     root_routing_app.init(new routing_http_app_t(file_app.get(), root_routes));
 
     server.init(new http_server_t(tls_ctx, local_addresses, port, root_routing_app.get()));
@@ -16,6 +16,7 @@ class http_server_t;
 class routing_http_app_t;
 class file_http_app_t;
 class cyanide_http_app_t;
+class metrics_http_app_t;
 
 class real_reql_cluster_interface_t;
 
@@ -37,6 +38,7 @@ private:
 #ifndef NDEBUG
     scoped_ptr_t<cyanide_http_app_t> cyanide_app;
 #endif
+    scoped_ptr_t<metrics_http_app_t> metrics_app;
     scoped_ptr_t<routing_http_app_t> ajax_routing_app;
     scoped_ptr_t<routing_http_app_t> root_routing_app;
     scoped_ptr_t<http_server_t> server;
@@ -20,6 +20,9 @@ const uuid_u jobs_manager_t::base_disk_compaction_id =
 const uuid_u jobs_manager_t::base_backfill_id =
     str_to_uuid("a5e1b38d-c712-42d7-ab4c-f177a3fb0d20");
 
+const uuid_u jobs_manager_t::base_expiry_id =
+    str_to_uuid("3f0c2a6e-5d8b-4e71-9a24-c6b1e07d94f3");
+
 jobs_manager_t::jobs_manager_t(mailbox_manager_t *_mailbox_manager,
                                server_id_t const &_server_id,
                                rdb_context_t *_rdb_context,
@@ -53,6 +56,7 @@ void jobs_manager_t::on_get_job_reports(
     std::vector<disk_compaction_job_report_t> disk_compaction_job_reports;
     std::vector<index_construction_job_report_t> index_construction_job_reports;
     std::vector<backfill_job_report_t> backfill_job_reports;
+    std::vector<expiry_job_report_t> expiry_job_reports;
 
     if (drainer.is_draining()) {
         // We're shutting down, send an empty reponse since we can't acquire a `drainer`
@@ -63,7 +67,8 @@ void jobs_manager_t::on_get_job_reports(
              query_job_reports,
              disk_compaction_job_reports,
              index_construction_job_reports,
-             backfill_job_reports);
+             backfill_job_reports,
+             expiry_job_reports);
         return;
     }
 
@@ -94,13 +99,19 @@ void jobs_manager_t::on_get_job_reports(
                         printed_query_columns,
                         pair.second->term_storage->root_term());
 
+                    const int64_t idle_micros = pair.second->num_refs == 0
+                        ? kticks.micros - std::min(pair.second->last_ref_time.micros,
+                                                   kticks.micros)
+                        : 0;
                     query_job_reports_inner.emplace_back(
                         pair.second->job_id,
                         kticks.micros - std::min(pair.second->start_time.micros, kticks.micros),
                         server_id,
                         query_cache->get_client_addr_port(),
                         std::move(render),
-                        query_cache->get_user_context());
+                        query_cache->get_user_context(),
+                        idle_micros,
+                        pair.second->prefetched_bytes);
                 }
             }
         }
@@ -171,6 +182,20 @@ void jobs_manager_t::on_get_job_reports(
                     backfill.second.source_server_id,
                     server_id);
             }
+
+            /* The primaries of a table all report the same job, so that it shows up as
+            a single row. */
+            std::map<region_t, expiry_progress_tracker_t::progress_tracker_t> expiries =
+                table_manager->get_expiry_progress_tracker().get_progress_trackers();
+            for (const auto &expiry : expiries) {
+                expiry_job_reports.emplace_back(
+                    uuid_u::from_hash(base_expiry_id, uuid_to_str(table_id)),
+                    time - std::min<double>(expiry.second.start_time, time),
+                    server_id,
+                    table_id,
+                    expiry.second.progress,
+                    expiry.second.rows_expired);
+            }
         });
 
         send(mailbox_manager,
@@ -178,7 +203,8 @@ void jobs_manager_t::on_get_job_reports(
              query_job_reports,
              disk_compaction_job_reports,
              index_construction_job_reports,
-             backfill_job_reports);
+             backfill_job_reports,
+             expiry_job_reports);
     } catch (const interrupted_exc_t &) {
         // Do nothing
     }
@@ -45,6 +45,71 @@ bool disk_compaction_job_report_t::info_derived(
 RDB_IMPL_SERIALIZABLE_4_FOR_CLUSTER(
     disk_compaction_job_report_t, type, id, duration, servers);
 
+expiry_job_report_t::expiry_job_report_t()
+    : job_report_base_t<expiry_job_report_t>() { }
+
+expiry_job_report_t::expiry_job_report_t(
+        uuid_u const &_id,
+        double _duration,
+        server_id_t const &_server_id,
+        namespace_id_t const &_table,
+        double _progress,
+        uint64_t _rows_expired)
+    : job_report_base_t<expiry_job_report_t>("expiry", _id, _duration, _server_id),
+      table(_table),
+      progress_numerator(_progress),
+      progress_denominator(1.0),
+      rows_expired(_rows_expired) { }
+
+void expiry_job_report_t::merge_derived(expiry_job_report_t const &job_report) {
+    progress_numerator += job_report.progress_numerator;
+    progress_denominator += job_report.progress_denominator;
+    rows_expired += job_report.rows_expired;
+}
+
+bool expiry_job_report_t::info_derived(
+        admin_identifier_format_t identifier_format,
+        UNUSED server_config_client_t *server_config_client,
+        table_meta_client_t *table_meta_client,
+        cluster_semilattice_metadata_t const &metadata,
+        ql::datum_object_builder_t *info_builder_out) const {
+    ql::datum_t table_name_or_uuid;
+    ql::datum_t db_name_or_uuid;
+    if (!convert_table_id_to_datums(
+            table,
+            identifier_format,
+            metadata,
+            table_meta_client,
+            &table_name_or_uuid,
+            nullptr,
+            &db_name_or_uuid,
+            nullptr)) {
+        return false;
+    }
+    info_builder_out->overwrite("table", table_name_or_uuid);
+    info_builder_out->overwrite("db", db_name_or_uuid);
+
+    /* Note that the progress only covers the shards that are currently making a pass
+    over their data. */
+    info_builder_out->overwrite("progress",
+        ql::datum_t(progress_numerator / progress_denominator));
+    info_builder_out->overwrite("rows_expired",
+        ql::datum_t(static_cast<double>(rows_expired)));
+
+    return true;
+}
+
+RDB_IMPL_SERIALIZABLE_8_FOR_CLUSTER(
+    expiry_job_report_t,
+    type,
+    id,
+    duration,
+    servers,
+    table,
+    progress_numerator,
+    progress_denominator,
+    rows_expired);
+
 backfill_job_report_t::backfill_job_report_t()
     : job_report_base_t<backfill_job_report_t>() { }
 
@@ -227,11 +292,15 @@ query_job_report_t::query_job_report_t(
         server_id_t const &_server_id,
         ip_and_port_t const &_client_addr_port,
         std::string const &_query,
-        auth::user_context_t const &_user_context)
+        auth::user_context_t const &_user_context,
+        double _idle,
+        int64_t _buffered_bytes)
     : job_report_base_t<query_job_report_t>("query", _id, _duration, _server_id),
       client_addr_port(_client_addr_port),
       query(_query),
-      user_context(_user_context) { }
+      user_context(_user_context),
+      idle(_idle),
+      buffered_bytes(_buffered_bytes) { }
 
 void query_job_report_t::merge_derived(query_job_report_t const &) { }
 
@@ -248,12 +317,16 @@ bool query_job_report_t::info_derived(
     info_builder_out->overwrite("query", convert_string_to_datum(query));
     info_builder_out->overwrite(
         "user", convert_string_to_datum(user_context.to_string()));
+    info_builder_out->overwrite("idle_sec", ql::datum_t(idle / 1e6));
+    info_builder_out->overwrite(
+        "buffered_bytes", ql::datum_t(static_cast<double>(buffered_bytes)));
 
     return true;
 }
 
-RDB_IMPL_SERIALIZABLE_7_FOR_CLUSTER(
-    query_job_report_t, type, id, duration, servers, client_addr_port, query, user_context);
+RDB_IMPL_SERIALIZABLE_9_FOR_CLUSTER(
+    query_job_report_t, type, id, duration, servers, client_addr_port, query,
+    user_context, idle, buffered_bytes);
 
 RDB_IMPL_SERIALIZABLE_2_FOR_CLUSTER(jobs_manager_business_card_t,
                                     get_job_reports_mailbox_address,
@@ -100,6 +100,33 @@ public:
 };
 RDB_DECLARE_SERIALIZABLE_FOR_CLUSTER(disk_compaction_job_report_t);
 
+class expiry_job_report_t : public job_report_base_t<expiry_job_report_t> {
+public:
+    expiry_job_report_t();
+    expiry_job_report_t(
+            uuid_u const &id,
+            double duration,
+            server_id_t const &server_id,
+            namespace_id_t const &table,
+            double progress,
+            uint64_t rows_expired);
+
+    void merge_derived(expiry_job_report_t const &job_report);
+
+    bool info_derived(
+            admin_identifier_format_t identifier_format,
+            server_config_client_t *server_config_client,
+            table_meta_client_t *table_meta_client,
+            cluster_semilattice_metadata_t const &metadata,
+            ql::datum_object_builder_t *info_builder_out) const;
+
+    namespace_id_t table;
+    double progress_numerator;
+    double progress_denominator;
+    uint64_t rows_expired;
+};
+RDB_DECLARE_SERIALIZABLE_FOR_CLUSTER(expiry_job_report_t);
+
 class index_construction_job_report_t
     : public job_report_base_t<index_construction_job_report_t> {
 public:
@@ -140,7 +167,9 @@ public:
             server_id_t const &server_id,
             ip_and_port_t const &client_addr_port,
             std::string const &query,
-            auth::user_context_t const &user_context);
+            auth::user_context_t const &user_context,
+            double idle,
+            int64_t buffered_bytes);
 
     void merge_derived(query_job_report_t const &job_report);
 
@@ -154,6 +183,11 @@ public:
     ip_and_port_t client_addr_port;
     std::string query;
     auth::user_context_t user_context;
+    // How long the client hasn't been asking for the cursor's next batch, in
+    // microseconds, or 0 if it's being read.
+    double idle;
+    // The size of the batch that was read before the client asked for it.
+    int64_t buffered_bytes;
 };
 RDB_DECLARE_SERIALIZABLE_FOR_CLUSTER(query_job_report_t);
 
@@ -162,7 +196,8 @@ public:
     typedef mailbox_t<std::vector<query_job_report_t>,
                       std::vector<disk_compaction_job_report_t>,
                       std::vector<index_construction_job_report_t>,
-                      std::vector<backfill_job_report_t>> return_mailbox_t;
+                      std::vector<backfill_job_report_t>,
+                      std::vector<expiry_job_report_t>> return_mailbox_t;
     typedef mailbox_t<return_mailbox_t::address_t> get_job_reports_mailbox_t;
     typedef mailbox_t<uuid_u, auth::user_context_t> job_interrupt_mailbox_t;
 
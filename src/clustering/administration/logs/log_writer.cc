@@ -8,6 +8,8 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include <deque>
+
 #ifdef _WIN32
 #include <io.h>
 #endif
@@ -327,8 +329,18 @@ private:
     friend void log_internal(const char *src_file, int src_line, log_level_t level, const char *format, ...);
     friend void vlog_internal(const char *src_file, int src_line, log_level_t level, const char *format, va_list args);
 
-    bool write(const log_message_t &msg, std::string *error_out);
+    bool write(const std::vector<log_message_t> &msgs, std::string *error_out);
+    bool write_to_console(const std::string &formatted, FILE *write_stream,
+                          fd_t filefd, std::string *error_out);
     void initiate_write(log_level_t level, const std::string &message);
+
+    /* If the `LOG_WRITER_RECENT_MESSAGES` most recently written messages have every
+    message that `thread_pool_log_writer_t::tail()` would read from the file, puts
+    them in `messages_out` and returns `true`. */
+    bool tail_recent(int max_lines,
+                     struct timespec min_timestamp,
+                     struct timespec max_timestamp,
+                     std::vector<log_message_t> *messages_out);
     base_path_t filename;
     struct timespec uptime_reference;
     struct timespec last_msg_timestamp;
@@ -341,11 +353,21 @@ private:
 #endif
     scoped_fd_t fd;
 
+    /* `recent_messages_complete` is whether `recent_messages` has every message that
+    was written since the file was opened, and `file_was_empty` is whether the file
+    had no earlier messages. */
+    std::deque<log_message_t> recent_messages;
+    bool recent_messages_complete;
+    bool file_was_empty;
+    spinlock_t recent_messages_lock;
+
     DISABLE_COPYING(fallback_log_writer_t);
 } fallback_log_writer;
 
 fallback_log_writer_t::fallback_log_writer_t() :
-    filename("-") {
+    filename("-"),
+    recent_messages_complete(true),
+    file_was_empty(false) {
     uptime_reference = clock_monotonic();
     last_msg_timestamp = clock_realtime();
 
@@ -390,6 +412,9 @@ void fallback_log_writer_t::install(const std::string &logfile_name) {
                                            logfile_name.c_str(),
                                            errno_string(errno).c_str()).c_str());
     }
+
+    struct stat file_stat;
+    file_was_empty = fstat(fd.get(), &file_stat) == 0 && file_stat.st_size == 0;
 #endif
 
     // Get the absolute path for the log file, so it will still be valid if
@@ -436,64 +461,33 @@ log_message_t fallback_log_writer_t::assemble_log_message(
 }
 
 // WINDOWS TODO: this function could benefit from some refactoring
-bool fallback_log_writer_t::write(const log_message_t &msg, std::string *error_out) {
-    std::string formatted = format_log_message(msg) + "\n";
-
-    FILE* write_stream = nullptr;
-    fd_t filefd = INVALID_FD;
-    switch (msg.level) {
-        case log_level_info:
-            // no message on stdout/stderr
-            break;
-        case log_level_notice:
-            write_stream = stdout;
-            filefd = STDOUT_FD;
-            break;
-        case log_level_debug:
-        case log_level_warn:
-        case log_level_error:
-            write_stream = stderr;
-            filefd = STDERR_FD;
-            break;
-        default:
-            unreachable();
-    }
-
-    if (msg.level != log_level_info) {
-        // Write to stdout/stderr for all log levels but info (#3040)
-        std::string console_formatted = format_log_message(msg, true) + "\n";
-#ifdef _WIN32
-        // WINDOWS TODO
-        (void) write_stream;
-#else
-        flockfile(write_stream);
-#endif
-
-        bool write_failure = false;
-        size_t write_res = ::fwrite(console_formatted.data(), 1, console_formatted.length(), write_stream);
-        if (write_res == console_formatted.length()) {
-            int fflush_res = ::fflush(write_stream);
-            write_failure = (fflush_res != 0);
-        } else {
-            write_failure = true;
-        }
-        if (write_failure) {
-            error_out->assign("cannot write to stdout/stderr: " + errno_string(get_errno()));
-            return false;
-        }
-
-#ifdef _WIN32
-        // WINDOWS TODO
-#else
-        int fsync_res = fsync(filefd);
-        if (fsync_res != 0 && !(get_errno() == EROFS || get_errno() == EINVAL ||
-                get_errno() == ENOTSUP)) {
-            error_out->assign("cannot flush stdout/stderr: " + errno_string(get_errno()));
-            return false;
+bool fallback_log_writer_t::write(const std::vector<log_message_t> &msgs,
+                                  std::string *error_out) {
+    std::string formatted;
+    // Write to stdout/stderr for all log levels but info (#3040)
+    std::string stdout_formatted, stderr_formatted;
+    for (const log_message_t &msg : msgs) {
+        formatted += format_log_message(msg) + "\n";
+        switch (msg.level) {
+            case log_level_info:
+                // no message on stdout/stderr
+                break;
+            case log_level_notice:
+                stdout_formatted += format_log_message(msg, true) + "\n";
+                break;
+            case log_level_debug:
+            case log_level_warn:
+            case log_level_error:
+                stderr_formatted += format_log_message(msg, true) + "\n";
+                break;
+            default:
+                unreachable();
         }
+    }
 
-        funlockfile(write_stream);
-#endif
+    if (!write_to_console(stdout_formatted, stdout, STDOUT_FD, error_out)
+        || !write_to_console(stderr_formatted, stderr, STDERR_FD, error_out)) {
+        return false;
     }
 
     if (fd.get() == INVALID_FD) {
@@ -531,13 +525,93 @@ bool fallback_log_writer_t::write(const log_message_t &msg, std::string *error_o
     }
 #endif
 
+    {
+        spinlock_acq_t lock_acq(&recent_messages_lock);
+        for (const log_message_t &msg : msgs) {
+            if (recent_messages.size() == LOG_WRITER_RECENT_MESSAGES) {
+                recent_messages.pop_front();
+                recent_messages_complete = false;
+            }
+            recent_messages.push_back(msg);
+        }
+    }
+
+    return true;
+}
+
+bool fallback_log_writer_t::write_to_console(const std::string &formatted,
+                                             FILE *write_stream,
+                                             fd_t filefd,
+                                             std::string *error_out) {
+    if (formatted.empty()) {
+        return true;
+    }
+#ifdef _WIN32
+    // WINDOWS TODO
+    (void) filefd;
+#else
+    flockfile(write_stream);
+#endif
+
+    bool write_failure = false;
+    size_t write_res = ::fwrite(formatted.data(), 1, formatted.length(), write_stream);
+    if (write_res == formatted.length()) {
+        int fflush_res = ::fflush(write_stream);
+        write_failure = (fflush_res != 0);
+    } else {
+        write_failure = true;
+    }
+    if (write_failure) {
+        error_out->assign("cannot write to stdout/stderr: " + errno_string(get_errno()));
+        return false;
+    }
+
+#ifdef _WIN32
+    // WINDOWS TODO
+#else
+    int fsync_res = fsync(filefd);
+    if (fsync_res != 0 && !(get_errno() == EROFS || get_errno() == EINVAL ||
+            get_errno() == ENOTSUP)) {
+        error_out->assign("cannot flush stdout/stderr: " + errno_string(get_errno()));
+        return false;
+    }
+
+    funlockfile(write_stream);
+#endif
     return true;
 }
 
+bool fallback_log_writer_t::tail_recent(int max_lines,
+                                        struct timespec min_timestamp,
+                                        struct timespec max_timestamp,
+                                        std::vector<log_message_t> *messages_out) {
+    spinlock_acq_t lock_acq(&recent_messages_lock);
+    if (recent_messages.empty()) {
+        return false;
+    }
+    std::vector<log_message_t> messages;
+    for (auto it = recent_messages.rbegin(); it != recent_messages.rend(); ++it) {
+        if (static_cast<int>(messages.size()) == max_lines
+            || it->timestamp < min_timestamp) {
+            *messages_out = std::move(messages);
+            return true;
+        }
+        if (!(it->timestamp > max_timestamp)) {
+            messages.push_back(*it);
+        }
+    }
+    // The older messages are only in the file, unless there are none.
+    if (recent_messages_complete && file_was_empty) {
+        *messages_out = std::move(messages);
+        return true;
+    }
+    return false;
+}
+
 void fallback_log_writer_t::initiate_write(log_level_t level, const std::string &message) {
     log_message_t log_msg = assemble_log_message(level, message);
     std::string error_message;
-    if (!write(log_msg, &error_message)) {
+    if (!write(std::vector<log_message_t>{log_msg}, &error_message)) {
         fprintf(stderr, "Previous message may not have been written to the log file (%s).\n", error_message.c_str());
     }
 }
@@ -549,7 +623,10 @@ TLS_with_init(auto_drainer_t *, global_log_drainer, nullptr);
 TLS_with_init(int, log_writer_block, 0);
 
 thread_pool_log_writer_t::thread_pool_log_writer_t()
-        : has_parse_error(false) {
+        : has_parse_error(false),
+          pending_repeats(0),
+          dropped_messages(0),
+          writing(false) {
     pmap(
         get_num_threads(),
         std::bind(&thread_pool_log_writer_t::install_on_thread, this, ph::_1));
@@ -578,9 +655,12 @@ std::vector<log_message_t> thread_pool_log_writer_t::tail(
     subscription.reset(interruptor);
 
     std::vector<log_message_t> log_messages;
+    if (fallback_log_writer.tail_recent(
+            max_lines, min_timestamp, max_timestamp, &log_messages)) {
+        return log_messages;
+    }
     std::string error_message;
 
-
     bool ok;
     thread_pool_t::run_in_blocker_pool(
         std::bind(
@@ -624,19 +704,66 @@ void thread_pool_log_writer_t::uninstall_on_thread(int i) {
 }
 
 void thread_pool_log_writer_t::write(const log_message_t &lm) {
-    mutex_t::acq_t write_mutex_acq(&write_mutex);
-    std::string error_message;
-    bool ok;
-    thread_pool_t::run_in_blocker_pool(std::bind(&thread_pool_log_writer_t::write_blocking, this, lm, &error_message, &ok));
-    if (ok) {
-        log_write_issue_tracker.report_success();
+    assert_thread();
+    if (!pending_messages.empty()
+        && pending_messages.back().level == lm.level
+        && pending_messages.back().message == lm.message) {
+        ++pending_repeats;
+    } else if (pending_messages.size() >= LOG_WRITER_MAX_PENDING_MESSAGES) {
+        ++dropped_messages;
     } else {
-        log_write_issue_tracker.report_error(error_message);
+        add_pending_notices();
+        pending_messages.push_back(lm);
+    }
+    if (writing) {
+        // The coroutine that's writing will write this too.
+        return;
+    }
+
+    writing = true;
+    while (!pending_messages.empty()) {
+        add_pending_notices();
+        std::vector<log_message_t> batch;
+        batch.swap(pending_messages);
+        std::string error_message;
+        bool ok;
+        thread_pool_t::run_in_blocker_pool(std::bind(
+            &thread_pool_log_writer_t::write_blocking,
+            this, &batch, &error_message, &ok));
+        if (ok) {
+            log_write_issue_tracker.report_success();
+        } else {
+            log_write_issue_tracker.report_error(error_message);
+        }
+    }
+    writing = false;
+}
+
+void thread_pool_log_writer_t::add_pending_notices() {
+    if (pending_repeats > 0) {
+        pending_messages.push_back(fallback_log_writer.assemble_log_message(
+            pending_messages.back().level,
+            strprintf("(The previous message was repeated %d more time%s.)",
+                      pending_repeats, pending_repeats == 1 ? "" : "s")));
+        pending_repeats = 0;
+    }
+    if (dropped_messages > 0) {
+        pending_messages.push_back(fallback_log_writer.assemble_log_message(
+            log_level_warn,
+            strprintf("%d log %s logged faster than %s could be written, and "
+                      "%s dropped.",
+                      dropped_messages,
+                      dropped_messages == 1 ? "message was" : "messages were",
+                      dropped_messages == 1 ? "it" : "they",
+                      dropped_messages == 1 ? "was" : "were")));
+        dropped_messages = 0;
     }
 }
 
-void thread_pool_log_writer_t::write_blocking(const log_message_t &msg, std::string *error_out, bool *ok_out) {
-    *ok_out = fallback_log_writer.write(msg, error_out);
+void thread_pool_log_writer_t::write_blocking(const std::vector<log_message_t> *msgs,
+                                              std::string *error_out,
+                                              bool *ok_out) {
+    *ok_out = fallback_log_writer.write(*msgs, error_out);
     return;
 }
 
@@ -16,6 +16,16 @@
 #include "rpc/mailbox/typed.hpp"
 #include "utils.hpp"
 
+/* Messages that are logged while earlier ones are being written are written together,
+in one batch.  At most this many of them wait to be written; any more are dropped,
+and the log says how many were. */
+#define LOG_WRITER_MAX_PENDING_MESSAGES 1000
+
+/* How many of the most recently written messages are kept in memory, so that reading
+the end of the log, as the `logs` table and its changefeeds do, doesn't have to read
+the file. */
+#define LOG_WRITER_RECENT_MESSAGES 1000
+
 ARCHIVE_PRIM_MAKE_RANGED_SERIALIZABLE(log_level_t, int, log_level_debug, log_level_error);
 RDB_DECLARE_SERIALIZABLE(struct timespec);
 
@@ -81,8 +91,14 @@ private:
     friend void vlog_internal(const char *src_file, int src_line, log_level_t level, const char *format, va_list args);
     void install_on_thread(int i);
     void uninstall_on_thread(int i);
+    /* Queues `msg`, and then writes the queued messages unless another coroutine is
+    already doing that.  A message that's the same as the last queued one isn't queued
+    again; the log says how many times it was repeated instead. */
     void write(const log_message_t &msg);
-    void write_blocking(const log_message_t &msg, std::string *error_out, bool *ok_out);
+    void add_pending_notices();
+    void write_blocking(const std::vector<log_message_t> *msgs,
+                        std::string *error_out,
+                        bool *ok_out);
     void tail_blocking(int max_lines,
                        struct timespec min_timestamp,
                        struct timespec max_timestamp,
@@ -91,10 +107,14 @@ private:
                        std::string *error_out,
                        bool *ok_out);
 
-    mutex_t write_mutex;
     log_write_issue_tracker_t log_write_issue_tracker;
     bool has_parse_error;
 
+    std::vector<log_message_t> pending_messages;
+    int pending_repeats;
+    int dropped_messages;
+    bool writing;
+
     DISABLE_COPYING(thread_pool_log_writer_t);
 };
 
@@ -39,10 +39,13 @@
 #include <re2/re2.h>
 
 #include "arch/io/disk.hpp"
+#include "arch/io/network.hpp"
 #include "arch/io/openssl.hpp"
 #include "arch/os_signal.hpp"
+#include "arch/runtime/event_queue.hpp"
 #include "arch/runtime/starter.hpp"
 #include "arch/filesystem.hpp"
+#include "buffer_cache/block_trace.hpp"
 
 #include "extproc/extproc_spawner.hpp"
 #include "clustering/administration/main/cache_size.hpp"
@@ -61,9 +64,12 @@
 #include "clustering/administration/persist/migrate/migrate_v1_16.hpp"
 #include "clustering/administration/persist/migrate/migrate_v2_1.hpp"
 #include "clustering/administration/servers/server_metadata.hpp"
+#include "clustering/query_routing/table_query_client.hpp"
 #include "containers/scoped.hpp"
 #include "crypto/random.hpp"
 #include "logger.hpp"
+#include "rdb_protocol/query_trace.hpp"
+#include "rdb_protocol/slow_query_log.hpp"
 
 #define RETHINKDB_EXPORT_SCRIPT "rethinkdb-export"
 #define RETHINKDB_IMPORT_SCRIPT "rethinkdb-import"
@@ -731,6 +737,7 @@ service_address_ports_t get_service_address_ports(const std::map<std::string, op
         exists_option(opts, "--no-http-admin"),
         offseted_port(get_single_int(opts, "--http-port"), port_offset),
         offseted_port(get_single_int(opts, "--driver-port"), port_offset),
+        exists_option(opts, "--reuse-driver-port"),
         port_offset);
 }
 
@@ -997,6 +1004,8 @@ bool initialize_tls_ctx(
         }
     }
 
+    enable_tls_session_resumption_and_ktls(tls_ctx_out->get());
+
     return true;
 }
 
@@ -1045,6 +1054,7 @@ void run_rethinkdb_create(const base_path_t &base_path,
                           optional<uint64_t> total_cache_size,
                           const file_direct_io_mode_t direct_io_mode,
                           const int max_concurrent_io_requests,
+                          const io_backend_t io_backend,
                           bool *const result_out) {
     server_id_t our_server_id = server_id_t::generate_server_id();
 
@@ -1058,7 +1068,8 @@ void run_rethinkdb_create(const base_path_t &base_path,
     server_config.config.cache_size_bytes = total_cache_size;
     server_config.version = 1;
 
-    io_backender_t io_backender(direct_io_mode, max_concurrent_io_requests);
+    io_backender_t io_backender(direct_io_mode, max_concurrent_io_requests,
+                                io_backend);
 
     perfmon_collection_t metadata_perfmon_collection;
     perfmon_membership_t metadata_perfmon_membership(&get_global_perfmon_collection(), &metadata_perfmon_collection, "metadata");
@@ -1139,6 +1150,7 @@ void run_rethinkdb_serve(const base_path_t &base_path,
                          const std::string &initial_password,
                          const file_direct_io_mode_t direct_io_mode,
                          const int max_concurrent_io_requests,
+                         const io_backend_t io_backend,
                          const optional<optional<uint64_t> >
                             &total_cache_size,
                          const server_id_t *our_server_id,
@@ -1156,7 +1168,8 @@ void run_rethinkdb_serve(const base_path_t &base_path,
 
     logNTC("Loading data from directory %s\n", base_path.path().c_str());
 
-    io_backender_t io_backender(direct_io_mode, max_concurrent_io_requests);
+    io_backender_t io_backender(direct_io_mode, max_concurrent_io_requests,
+                                io_backend);
 
     perfmon_collection_t metadata_perfmon_collection;
     perfmon_membership_t metadata_perfmon_membership(&get_global_perfmon_collection(), &metadata_perfmon_collection, "metadata");
@@ -1284,6 +1297,7 @@ void run_rethinkdb_porcelain(const base_path_t &base_path,
                              const std::string &initial_password,
                              const file_direct_io_mode_t direct_io_mode,
                              const int max_concurrent_io_requests,
+                             const io_backend_t io_backend,
                              const optional<optional<uint64_t> >
                                 &total_cache_size,
                              const bool new_directory,
@@ -1292,8 +1306,8 @@ void run_rethinkdb_porcelain(const base_path_t &base_path,
                              bool *const result_out) {
     if (!new_directory) {
         run_rethinkdb_serve(base_path, serve_info, initial_password, direct_io_mode,
-                            max_concurrent_io_requests, total_cache_size,
-                            nullptr, nullptr, nullptr, data_directory_lock,
+                            max_concurrent_io_requests, io_backend,
+                            total_cache_size, nullptr, nullptr, nullptr, data_directory_lock,
                             result_out);
     } else {
         logNTC("Initializing directory %s\n", base_path.path().c_str());
@@ -1328,7 +1342,7 @@ void run_rethinkdb_porcelain(const base_path_t &base_path,
         server_config.version = 1;
 
         run_rethinkdb_serve(base_path, serve_info, initial_password, direct_io_mode,
-                            max_concurrent_io_requests,
+                            max_concurrent_io_requests, io_backend,
                             optional<optional<uint64_t> >(),
                             &our_server_id, &server_config, &cluster_metadata,
                             data_directory_lock, result_out);
@@ -1392,9 +1406,51 @@ options::help_section_t get_log_options(std::vector<options::option_t> *options_
                                             options::OPTIONAL_NO_PARAMETER));
     help.add("--no-update-check", "disable checking for available updates.  Also turns "
              "off anonymous usage data collection.");
+    options_out->push_back(options::option_t(options::names_t("--slow-query-threshold"),
+                                             options::OPTIONAL));
+    help.add("--slow-query-threshold ms", "log queries that take longer than this many "
+             "milliseconds, and keep them in the `rethinkdb._slow_queries` table");
+    options_out->push_back(options::option_t(options::names_t("--trace-sample-rate"),
+                                             options::OPTIONAL));
+    help.add("--trace-sample-rate n", "trace where the time of one in every n queries "
+             "goes, and keep the traces in the `rethinkdb._query_traces` table");
     return help;
 }
 
+MUST_USE bool parse_slow_query_threshold_option(
+        const std::map<std::string, options::values_t> &opts) {
+    if (!exists_option(opts, "--slow-query-threshold")) {
+        return true;
+    }
+    const std::string threshold_opt = get_single_option(opts, "--slow-query-threshold");
+    uint64_t threshold_ms;
+    if (!strtou64_strict(threshold_opt, 10, &threshold_ms)
+        || threshold_ms > static_cast<uint64_t>(std::numeric_limits<int>::max())) {
+        fprintf(stderr, "ERROR: slow-query-threshold should be a number of "
+                "milliseconds, got '%s'\n", threshold_opt.c_str());
+        return false;
+    }
+    ql::slow_query_log_t::set_threshold(
+        ticks_t{static_cast<int64_t>(threshold_ms) * MILLION});
+    return true;
+}
+
+MUST_USE bool parse_trace_sample_rate_option(
+        const std::map<std::string, options::values_t> &opts) {
+    if (!exists_option(opts, "--trace-sample-rate")) {
+        return true;
+    }
+    const std::string rate_opt = get_single_option(opts, "--trace-sample-rate");
+    uint64_t rate;
+    if (!strtou64_strict(rate_opt, 10, &rate)) {
+        fprintf(stderr, "ERROR: trace-sample-rate should be a number of queries, "
+                "got '%s'\n", rate_opt.c_str());
+        return false;
+    }
+    ql::query_trace_log_t::set_sample_rate(rate);
+    return true;
+}
+
 
 options::help_section_t get_file_options(std::vector<options::option_t> *options_out) {
     options::help_section_t help("File path options");
@@ -1402,6 +1458,22 @@ options::help_section_t get_file_options(std::vector<options::option_t> *options
                                              options::OPTIONAL,
                                              "rethinkdb_data"));
     help.add("-d [ --directory ] path", "specify directory to store data and metadata");
+    options_out->push_back(options::option_t(options::names_t("--data-dirs"),
+                                             options::OPTIONAL_REPEAT));
+    help.add("--data-dirs path",
+             "stripe the data files of new tables over the data directory and this "
+             "directory, e.g. on another device. Can be specified multiple times.");
+    options_out->push_back(options::option_t(options::names_t("--cold-data-dir"),
+                                             options::OPTIONAL));
+    help.add("--cold-data-dir path",
+             "move the data that hasn't been used for a while to this directory, e.g. "
+             "on a slower and cheaper device");
+    options_out->push_back(options::option_t(options::names_t("--cold-after"),
+                                             options::OPTIONAL,
+                                             strprintf("%d", 24 * 60 * 60)));
+    help.add("--cold-after secs",
+             "how long data has to go unused before it's moved to the cold data "
+             "directory");
     options_out->push_back(options::option_t(options::names_t("--io-threads"),
                                              options::OPTIONAL,
                                              strprintf("%d", DEFAULT_MAX_CONCURRENT_IO_REQUESTS)));
@@ -1412,11 +1484,21 @@ options::help_section_t get_file_options(std::vector<options::option_t> *options
     options_out->push_back(options::option_t(options::names_t("--direct-io"),
                                              options::OPTIONAL_NO_PARAMETER));
     help.add("--direct-io", "use direct I/O for file access");
+    options_out->push_back(options::option_t(options::names_t("--io-backend"),
+                                             options::OPTIONAL,
+                                             "pool"));
+    help.add("--io-backend pool|io_uring",
+             "how to issue file I/O: on a pool of threads, or through io_uring if the "
+             "kernel supports it");
 #endif
     options_out->push_back(options::option_t(options::names_t("--cache-size"),
                                              options::OPTIONAL));
     help.add("--cache-size mb", "total cache size (in megabytes) for the process. Can "
         "be 'auto'.");
+    options_out->push_back(options::option_t(options::names_t("--cache-trace"),
+                                             options::OPTIONAL));
+    help.add("--cache-trace file", "record every block the cache acquires to this file, "
+             "for replaying it with rethinkdb-bench");
     return help;
 }
 
@@ -1428,6 +1510,51 @@ options::help_section_t get_config_file_options(std::vector<options::option_t> *
     return help;
 }
 
+std::vector<std::string> get_data_dirs(
+        const std::map<std::string, options::values_t> &opts) {
+    std::string source;
+    std::vector<std::string> data_dirs;
+    for (const std::string &dir : all_options(opts, "--data-dirs", &source)) {
+        base_path_t abs_path(render_as_path(parse_as_path(dir)));
+        if (!check_existence(abs_path)) {
+            throw std::runtime_error(strprintf("ERROR: data directory not found '%s'",
+                                               abs_path.path().c_str()).c_str());
+        }
+        abs_path.make_absolute();
+        data_dirs.push_back(abs_path.path());
+    }
+    return data_dirs;
+}
+
+// Returns the empty string if there's no cold data directory.
+std::string get_cold_data_dir(const std::map<std::string, options::values_t> &opts) {
+    if (!exists_option(opts, "--cold-data-dir")) {
+        return std::string();
+    }
+    base_path_t abs_path(
+        render_as_path(parse_as_path(get_single_option(opts, "--cold-data-dir"))));
+    if (!check_existence(abs_path)) {
+        throw std::runtime_error(strprintf("ERROR: cold data directory not found '%s'",
+                                           abs_path.path().c_str()).c_str());
+    }
+    abs_path.make_absolute();
+    return abs_path.path();
+}
+
+int64_t parse_cold_after_secs_option(
+        const std::map<std::string, options::values_t> &opts) {
+    const std::string cold_after_opt = get_single_option(opts, "--cold-after");
+    uint64_t cold_after_secs;
+    if (!strtou64_strict(cold_after_opt, 10, &cold_after_secs)
+        || cold_after_secs == 0
+        || cold_after_secs > static_cast<uint64_t>(std::numeric_limits<int>::max())) {
+        throw std::runtime_error(strprintf(
+                "ERROR: cold-after should be a positive number of seconds, got '%s'",
+                cold_after_opt.c_str()));
+    }
+    return cold_after_secs;
+}
+
 std::vector<host_and_port_t> parse_join_options(const std::map<std::string, options::values_t> &opts,
                                                 int default_port) {
     std::string source;
@@ -1594,6 +1721,16 @@ options::help_section_t get_network_options(const bool join_required, std::vecto
                                              strprintf("%d", port_defaults::reql_port)));
     help.add("--driver-port port", "port for rethinkdb protocol client drivers");
 
+    options_out->push_back(options::option_t(options::names_t("--reuse-driver-port"),
+                                             options::OPTIONAL_NO_PARAMETER));
+    help.add("--reuse-driver-port", "accept client driver connections on every thread, "
+             "through one SO_REUSEPORT socket per thread");
+
+    options_out->push_back(options::option_t(options::names_t("--coalesce-reads"),
+                                             options::OPTIONAL_NO_PARAMETER));
+    help.add("--coalesce-reads", "let identical point reads and small getAlls with "
+             "read_mode single or outdated share one read while it is in flight");
+
     options_out->push_back(options::option_t(options::names_t("--port-offset", "-o"),
                                              options::OPTIONAL,
                                              strprintf("%d", port_defaults::port_offset)));
@@ -1633,6 +1770,18 @@ options::help_section_t get_cpu_options(std::vector<options::option_t> *options_
                                              options::OPTIONAL,
                                              strprintf("%d", get_cpu_count())));
     help.add("-c [ --cores ] n", "the number of cores to use");
+    options_out->push_back(options::option_t(options::names_t("--pin-threads"),
+                                             options::OPTIONAL_NO_PARAMETER));
+    help.add("--pin-threads", "pin each thread to a CPU, and keep the threads of each "
+             "table on one NUMA node");
+    options_out->push_back(options::option_t(options::names_t("--slow-callback-threshold"),
+                                             options::OPTIONAL));
+    help.add("--slow-callback-threshold ms", "log a warning whenever a callback keeps a "
+             "thread's event loop busy for more than this many milliseconds");
+    options_out->push_back(options::option_t(options::names_t("--busy-poll"),
+                                             options::OPTIONAL));
+    help.add("--busy-poll usecs", "poll for events for up to this many microseconds "
+             "before putting an idle thread to sleep; trades CPU time for latency");
     return help;
 }
 
@@ -1647,6 +1796,56 @@ MUST_USE bool parse_cores_option(const std::map<std::string, options::values_t>
     return true;
 }
 
+MUST_USE bool parse_slow_callback_threshold_option(
+        const std::map<std::string, options::values_t> &opts) {
+    if (!exists_option(opts, "--slow-callback-threshold")) {
+        return true;
+    }
+    const std::string threshold_opt = get_single_option(opts, "--slow-callback-threshold");
+    uint64_t threshold_ms;
+    if (!strtou64_strict(threshold_opt, 10, &threshold_ms)
+        || threshold_ms > static_cast<uint64_t>(std::numeric_limits<int>::max())) {
+        fprintf(stderr, "ERROR: slow-callback-threshold should be a number of "
+                "milliseconds, got '%s'\n", threshold_opt.c_str());
+        return false;
+    }
+    event_loop_stats_t::set_slow_callback_threshold(
+        ticks_t{static_cast<int64_t>(threshold_ms) * MILLION});
+    return true;
+}
+
+MUST_USE bool parse_busy_poll_option(
+        const std::map<std::string, options::values_t> &opts) {
+    if (!exists_option(opts, "--busy-poll")) {
+        return true;
+    }
+    const std::string busy_poll_opt = get_single_option(opts, "--busy-poll");
+    uint64_t busy_poll_usecs;
+    if (!strtou64_strict(busy_poll_opt, 10, &busy_poll_usecs)
+        || busy_poll_usecs > static_cast<uint64_t>(MILLION)) {
+        fprintf(stderr, "ERROR: busy-poll should be a number of microseconds, at most "
+                "%lld, got '%s'\n", MILLION, busy_poll_opt.c_str());
+        return false;
+    }
+    busy_poll_policy_t::set_max_spin(
+        ticks_t{static_cast<int64_t>(busy_poll_usecs) * THOUSAND});
+    return true;
+}
+
+MUST_USE bool parse_cache_trace_option(
+        const std::map<std::string, options::values_t> &opts) {
+    if (!exists_option(opts, "--cache-trace")) {
+        return true;
+    }
+    const std::string path = get_single_option(opts, "--cache-trace");
+    if (!block_trace_t::start(path)) {
+        fprintf(stderr, "ERROR: could not create the cache trace '%s': %s\n",
+                path.c_str(), errno_string(get_errno()).c_str());
+        return false;
+    }
+    return true;
+}
+
 options::help_section_t get_service_options(std::vector<options::option_t> *options_out) {
     options::help_section_t help("Service options");
     options_out->push_back(options::option_t(options::names_t("--pid-file"),
@@ -1899,6 +2098,22 @@ file_direct_io_mode_t parse_direct_io_mode_option(const std::map<std::string, op
         file_direct_io_mode_t::buffered_desired;
 }
 
+io_backend_t parse_io_backend_option(const std::map<std::string, options::values_t> &opts) {
+#ifndef _WIN32
+    const std::string value = get_single_option(opts, "--io-backend");
+    if (value == "io_uring") {
+        return io_backend_t::io_uring;
+    } else if (value != "pool") {
+        throw std::runtime_error(strprintf(
+            "ERROR: io-backend should be 'pool' or 'io_uring', got '%s'",
+            value.c_str()));
+    }
+#else
+    (void)opts;
+#endif
+    return io_backend_t::pool;
+}
+
 int main_rethinkdb_create(int argc, char *argv[]) {
     std::vector<options::option_t> options;
     std::vector<options::help_section_t> help;
@@ -1948,6 +2163,7 @@ int main_rethinkdb_create(int argc, char *argv[]) {
         recreate_temporary_directory(base_path);
 
         const file_direct_io_mode_t direct_io_mode = parse_direct_io_mode_option(opts);
+        const io_backend_t io_backend = parse_io_backend_option(opts);
 
         bool result;
         run_in_thread_pool(std::bind(&run_rethinkdb_create,
@@ -1958,6 +2174,7 @@ int main_rethinkdb_create(int argc, char *argv[]) {
                                      total_cache_size,
                                      direct_io_mode,
                                      max_concurrent_io_requests,
+                                     io_backend,
                                      &result),
                            num_workers);
 
@@ -2046,12 +2263,37 @@ int main_rethinkdb_serve(int argc, char *argv[]) {
         service_address_ports_t address_ports = get_service_address_ports(opts);
 
         std::string web_path = get_web_path(opts);
+        std::vector<std::string> data_dirs = get_data_dirs(opts);
+        std::string cold_data_dir = get_cold_data_dir(opts);
+        const int64_t cold_after_secs = parse_cold_after_secs_option(opts);
 
         int num_workers;
         if (!parse_cores_option(opts, &num_workers)) {
             return EXIT_FAILURE;
         }
 
+        if (!parse_slow_callback_threshold_option(opts)) {
+            return EXIT_FAILURE;
+        }
+
+        if (!parse_busy_poll_option(opts)) {
+            return EXIT_FAILURE;
+        }
+
+        if (!parse_cache_trace_option(opts)) {
+            return EXIT_FAILURE;
+        }
+
+        if (!parse_slow_query_threshold_option(opts)) {
+            return EXIT_FAILURE;
+        }
+        if (!parse_trace_sample_rate_option(opts)) {
+            return EXIT_FAILURE;
+        }
+
+        table_query_client_t::set_coalesce_reads(
+            exists_option(opts, "--coalesce-reads"));
+
         int max_concurrent_io_requests;
         if (!parse_io_threads_option(opts, &max_concurrent_io_requests)) {
             return EXIT_FAILURE;
@@ -2108,8 +2350,12 @@ int main_rethinkdb_serve(int argc, char *argv[]) {
                                 join_delay_secs.value_or(0),
                                 node_reconnect_timeout_secs.value_or(cluster_defaults::reconnect_timeout),
                                 tls_configs);
+        serve_info.data_dirs = std::move(data_dirs);
+        serve_info.cold_data_dir = std::move(cold_data_dir);
+        serve_info.cold_after_secs = cold_after_secs;
 
         const file_direct_io_mode_t direct_io_mode = parse_direct_io_mode_option(opts);
+        const io_backend_t io_backend = parse_io_backend_option(opts);
 
         bool result;
         run_in_thread_pool(std::bind(&run_rethinkdb_serve,
@@ -2118,13 +2364,15 @@ int main_rethinkdb_serve(int argc, char *argv[]) {
                                      initial_password,
                                      direct_io_mode,
                                      max_concurrent_io_requests,
+                                     io_backend,
                                      total_cache_size,
                                      static_cast<server_id_t*>(nullptr),
                                      static_cast<server_config_versioned_t *>(nullptr),
                                      static_cast<cluster_semilattice_metadata_t*>(nullptr),
                                      &data_directory_lock,
                                      &result),
-                           num_workers);
+                           num_workers,
+                           exists_option(opts, "--pin-threads"));
         return result ? EXIT_SUCCESS : EXIT_FAILURE;
     } catch (const options::named_error_t &ex) {
         output_named_error(ex, help);
@@ -2168,6 +2416,16 @@ int main_rethinkdb_proxy(int argc, char *argv[]) {
         optional<int> node_reconnect_timeout_secs =
             parse_node_reconnect_timeout_secs_option(opts);
 
+        if (!parse_slow_query_threshold_option(opts)) {
+            return EXIT_FAILURE;
+        }
+        if (!parse_trace_sample_rate_option(opts)) {
+            return EXIT_FAILURE;
+        }
+
+        table_query_client_t::set_coalesce_reads(
+            exists_option(opts, "--coalesce-reads"));
+
 #ifndef _WIN32
         get_and_set_user_group(opts);
 #endif
@@ -2317,12 +2575,37 @@ int main_rethinkdb_porcelain(int argc, char *argv[]) {
         const service_address_ports_t address_ports = get_service_address_ports(opts);
 
         std::string web_path = get_web_path(opts);
+        std::vector<std::string> data_dirs = get_data_dirs(opts);
+        std::string cold_data_dir = get_cold_data_dir(opts);
+        const int64_t cold_after_secs = parse_cold_after_secs_option(opts);
 
         int num_workers;
         if (!parse_cores_option(opts, &num_workers)) {
             return EXIT_FAILURE;
         }
 
+        if (!parse_slow_callback_threshold_option(opts)) {
+            return EXIT_FAILURE;
+        }
+
+        if (!parse_busy_poll_option(opts)) {
+            return EXIT_FAILURE;
+        }
+
+        if (!parse_cache_trace_option(opts)) {
+            return EXIT_FAILURE;
+        }
+
+        if (!parse_slow_query_threshold_option(opts)) {
+            return EXIT_FAILURE;
+        }
+        if (!parse_trace_sample_rate_option(opts)) {
+            return EXIT_FAILURE;
+        }
+
+        table_query_client_t::set_coalesce_reads(
+            exists_option(opts, "--coalesce-reads"));
+
         int max_concurrent_io_requests;
         if (!parse_io_threads_option(opts, &max_concurrent_io_requests)) {
             return EXIT_FAILURE;
@@ -2401,8 +2684,12 @@ int main_rethinkdb_porcelain(int argc, char *argv[]) {
                                 join_delay_secs.value_or(0),
                                 node_reconnect_timeout_secs.value_or(cluster_defaults::reconnect_timeout),
                                 tls_configs);
+        serve_info.data_dirs = std::move(data_dirs);
+        serve_info.cold_data_dir = std::move(cold_data_dir);
+        serve_info.cold_after_secs = cold_after_secs;
 
         const file_direct_io_mode_t direct_io_mode = parse_direct_io_mode_option(opts);
+        const io_backend_t io_backend = parse_io_backend_option(opts);
 
         bool result;
         run_in_thread_pool(std::bind(&run_rethinkdb_porcelain,
@@ -2412,12 +2699,14 @@ int main_rethinkdb_porcelain(int argc, char *argv[]) {
                                      initial_password,
                                      direct_io_mode,
                                      max_concurrent_io_requests,
+                                     io_backend,
                                      total_cache_size,
                                      is_new_directory,
                                      &serve_info,
                                      &data_directory_lock,
                                      &result),
-                           num_workers);
+                           num_workers,
+                           exists_option(opts, "--pin-threads"));
 
         return result ? EXIT_SUCCESS : EXIT_FAILURE;
     } catch (const options::named_error_t &ex) {
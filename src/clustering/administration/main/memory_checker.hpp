@@ -16,6 +16,8 @@ class table_meta_client_t;
 // memory_checker_t is created in serve.cc, and calls a repeating timer to
 // Periodically check if we're using swap by looking at the proc file or system calls.
 // If we're using swap, it creates an issue in a local issue tracker, and logs an error.
+// It doesn't say where the memory went; the "memory" stats of the server rows in
+// `rethinkdb.stats` do that (see `arch/runtime/memory_usage.hpp`).
 class memory_checker_t : private repeating_timer_callback_t {
 public:
     memory_checker_t();
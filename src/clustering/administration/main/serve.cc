@@ -34,6 +34,7 @@
 #include "containers/lifetime.hpp"
 #include "containers/optional.hpp"
 #include "extproc/extproc_pool.hpp"
+#include "extproc/js_runner.hpp"
 #include "rdb_protocol/query_server.hpp"
 #include "rpc/connectivity/cluster.hpp"
 #include "rpc/directory/map_read_manager.hpp"
@@ -114,6 +115,7 @@ bool do_serve(io_backender_t *io_backender,
         we don't want to run in the main RethinkDB process, such as Javascript
         evaluations. */
         extproc_pool_t extproc_pool(get_num_threads());
+        js_runner_t::warm_up(&extproc_pool, JS_WARM_WORKERS);
 
         /* `thread_pool_log_writer_t` automatically registers itself. While it exists,
         log messages will be written using the event loop instead of blocking. */
@@ -282,7 +284,9 @@ bool do_serve(io_backender_t *io_backender,
                               nullptr,   /* we'll fill this in later */
                               semilattice_manager_auth.get_root_view(),
                               &get_global_perfmon_collection(),
-                              serve_info.reql_http_proxy);
+                              serve_info.reql_http_proxy,
+                              io_backender,
+                              base_path);
         {
             /* Extract a subview of the directory with all the table meta manager
             business cards. */
@@ -310,6 +314,9 @@ bool do_serve(io_backender_t *io_backender,
                         io_backender,
                         cache_balancer.get(),
                         base_path,
+                        serve_info.data_dirs,
+                        serve_info.cold_data_dir,
+                        serve_info.cold_after_secs,
                         &rdb_ctx,
                         metadata_file));
                 multi_table_manager.init(new multi_table_manager_t(
@@ -542,7 +549,8 @@ bool do_serve(io_backender_t *io_backender,
                     &rdb_ctx,
                     &server_config_client,
                     server_id,
-                    serve_info.tls_configs.driver.get());
+                    serve_info.tls_configs.driver.get(),
+                    serve_info.ports.reuse_driver_port);
                 logNTC("Listening for client driver connections on port %d\n",
                        rdb_query_server.get_port());
                 /* If `serve_info.ports.reql_port` was zero then the OS assigned us a
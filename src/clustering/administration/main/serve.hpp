@@ -48,6 +48,7 @@ struct service_address_ports_t {
         client_port(0),
         http_port(0),
         reql_port(0),
+        reuse_driver_port(false),
         port_offset(0) { }
 
     service_address_ports_t(const std::set<ip_address_t> &_local_addresses,
@@ -60,6 +61,7 @@ struct service_address_ports_t {
                             bool _http_admin_is_disabled,
                             int _http_port,
                             int _reql_port,
+                            bool _reuse_driver_port,
                             int _port_offset) :
         local_addresses(_local_addresses),
         local_addresses_cluster(_local_addresses_cluster),
@@ -71,6 +73,7 @@ struct service_address_ports_t {
         http_admin_is_disabled(_http_admin_is_disabled),
         http_port(_http_port),
         reql_port(_reql_port),
+        reuse_driver_port(_reuse_driver_port),
         port_offset(_port_offset)
     {
             sanitize_port(port, "port", port_offset);
@@ -94,6 +97,8 @@ struct service_address_ports_t {
     bool http_admin_is_disabled;
     int http_port;
     int reql_port;
+    /* Accept driver connections on every thread, through `SO_REUSEPORT`. */
+    bool reuse_driver_port;
     int port_offset;
 };
 
@@ -128,7 +133,8 @@ public:
         config_file(_config_file),
         argv(std::move(_argv)),
         join_delay_secs(_join_delay_secs),
-        node_reconnect_timeout_secs(_node_reconnect_timeout_secs)
+        node_reconnect_timeout_secs(_node_reconnect_timeout_secs),
+        cold_after_secs(0)
     {
         tls_configs = _tls_configs;
     }
@@ -150,6 +156,13 @@ public:
     int join_delay_secs;
     int node_reconnect_timeout_secs;
     tls_configs_t tls_configs;
+    /* The directories that new tables' data files are striped over, besides the data
+    directory itself. */
+    std::vector<std::string> data_dirs;
+    /* Where the data that hasn't been used for `cold_after_secs` is moved to, or the
+    empty string to keep all of it in the data directories. */
+    std::string cold_data_dir;
+    int64_t cold_after_secs;
 };
 
 /* This has been factored out from `command_line.hpp` because it takes a very
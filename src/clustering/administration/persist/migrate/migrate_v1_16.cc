@@ -302,6 +302,9 @@ void migrate_table(const server_id_t &this_server_id,
                 ::write_ack_config_t::SINGLE : ::write_ack_config_t::MAJORITY;
     config.config.durability = old_config.config.durability;
     config.config.user_data = default_user_data();
+    config.config.storage = default_table_storage_config();
+    config.config.expiry = default_table_expiry_config();
+    config.config.cache = default_table_cache_config();
     config.shard_scheme.split_points = old_config.shard_scheme.split_points;
 
     // Scan the servers in the old shard config - need to remove deleted and nil servers
@@ -562,7 +565,8 @@ void migrate_cluster_metadata_to_v2_1(io_backender_t *io_backender,
                       case cluster_version_t::v2_2:
                       case cluster_version_t::v2_3:
                       case cluster_version_t::v2_4:
-                      case cluster_version_t::v2_5_is_latest:
+                      case cluster_version_t::v2_5:
+                      case cluster_version_t::v2_6_is_latest:
                       default:
                         unreachable();
                       }
@@ -583,7 +587,8 @@ void migrate_cluster_metadata_to_v2_1(io_backender_t *io_backender,
                       case cluster_version_t::v2_2:
                       case cluster_version_t::v2_3:
                       case cluster_version_t::v2_4:
-                      case cluster_version_t::v2_5_is_latest:
+                      case cluster_version_t::v2_5:
+                      case cluster_version_t::v2_6_is_latest:
                       default:
                         unreachable();
                       }
@@ -659,7 +664,8 @@ void migrate_auth_metadata_to_v2_1(io_backender_t *io_backender,
                       case cluster_version_t::v2_2:
                       case cluster_version_t::v2_3:
                       case cluster_version_t::v2_4:
-                      case cluster_version_t::v2_5_is_latest:
+                      case cluster_version_t::v2_5:
+                      case cluster_version_t::v2_6_is_latest:
                       default:
                           unreachable();
                       }
@@ -681,7 +687,8 @@ void migrate_auth_metadata_to_v2_1(io_backender_t *io_backender,
                       case cluster_version_t::v2_2:
                       case cluster_version_t::v2_3:
                       case cluster_version_t::v2_4:
-                      case cluster_version_t::v2_5_is_latest:
+                      case cluster_version_t::v2_5:
+                      case cluster_version_t::v2_6_is_latest:
                       default:
                           unreachable();
                       }
@@ -4,6 +4,7 @@
 #include <algorithm>
 #include <array>
 
+#include "buffer_cache/hot_block_manifest.hpp"
 #include "clustering/administration/persist/branch_history_manager.hpp"
 #include "clustering/administration/persist/file_keys.hpp"
 #include "clustering/administration/persist/raft_storage_interface.hpp"
@@ -14,14 +15,25 @@
 #include "serializer/merger.hpp"
 #include "serializer/translator.hpp"
 
+/* The hot block manifest of each CPU shard's store lives next to the table's data
+file. */
+static std::string hot_block_manifest_path(const serializer_filepath_t &path,
+                                           int cpu_shard) {
+    return strprintf("%s.hot_blocks_%d", path.permanent_path().c_str(), cpu_shard);
+}
+
 class real_multistore_ptr_t :
     public multistore_ptr_t {
 public:
     real_multistore_ptr_t(
             const namespace_id_t &table_id,
+            const table_storage_config_t &storage_config,
             const serializer_filepath_t &path,
             scoped_ptr_t<real_branch_history_manager_t> &&bhm,
             const base_path_t &base_path,
+            const std::vector<std::string> &data_dirs,
+            const std::string &cold_data_dir,
+            int64_t cold_after_secs,
             io_backender_t *io_backender,
             cache_balancer_t *cache_balancer,
             rdb_context_t *rdb_context,
@@ -51,19 +63,23 @@ public:
         bool create = (res != 0);
 
         on_thread_t thread_switcher(serializer_thread_allocation->get_thread());
-        filepath_file_opener_t file_opener(path, io_backender);
+        filepath_file_opener_t file_opener(path, io_backender, data_dirs,
+                                           cold_data_dir);
 
         if (create) {
-            log_serializer_t::create(
-                &file_opener,
-                log_serializer_t::static_config_t());
+            log_serializer_t::static_config_t static_config;
+            static_config.block_size_ = storage_config.block_size;
+            log_serializer_t::create(&file_opener, static_config);
         }
 
         // TODO: Could we handle failure when loading the serializer?  Right
         // now, we don't.
 
+        log_serializer_t::dynamic_config_t dynamic_config;
+        dynamic_config.compression = storage_config.compression;
+        dynamic_config.cold_extent_age_secs = cold_after_secs;
         scoped_ptr_t<serializer_t> inner_serializer(new log_serializer_t(
-            log_serializer_t::dynamic_config_t(),
+            dynamic_config,
             &file_opener,
             perfmon_collection_serializers));
         serializer.init(new merger_serializer_t(
@@ -112,6 +128,10 @@ public:
                     write_durability_t::HARD,
                     &non_interruptor);
             }
+
+            // A new data file has nothing to warm up with.
+            stores[ix]->maintain_hot_block_manifest(
+                hot_block_manifest_path(path, ix), !create);
         });
 
         if (create) {
@@ -273,28 +293,36 @@ void real_table_persistence_interface_t::delete_metadata(
     write_txn.commit();
 }
 
-void real_table_persistence_interface_t::load_multistore(
+void real_table_persistence_interface_t::create_multistore(
         const namespace_id_t &table_id,
-        metadata_file_t::read_txn_t *metadata_read_txn,
+        const table_storage_config_t &storage_config,
         scoped_ptr_t<multistore_ptr_t> *multistore_ptr_out,
         signal_t *interruptor,
         perfmon_collection_t *perfmon_collection_serializers) {
-    scoped_ptr_t<real_branch_history_manager_t> bhm(
-        new real_branch_history_manager_t(
-            table_id, metadata_file, metadata_read_txn, interruptor));
+    scoped_ptr_t<real_branch_history_manager_t> bhm;
+    {
+        metadata_file_t::read_txn_t read_txn(metadata_file, interruptor);
+        bhm.init(new real_branch_history_manager_t(
+            table_id, metadata_file, &read_txn, interruptor));
+    }
 
     scoped_ptr_t<thread_allocation_t> serializer_thread(
         new thread_allocation_t(&thread_allocator));
     std::vector<scoped_ptr_t<thread_allocation_t> > store_threads;
     for (size_t i = 0; i < CPU_SHARDING_FACTOR; ++i) {
-        store_threads.emplace_back(new thread_allocation_t(&thread_allocator));
+        store_threads.emplace_back(new thread_allocation_t(
+            &thread_allocator, serializer_thread->get_thread()));
     }
 
     multistore_ptr_out->init(new real_multistore_ptr_t(
         table_id,
+        storage_config,
         file_name_for(table_id),
         std::move(bhm),
         base_path,
+        data_dirs,
+        cold_data_dir,
+        cold_after_secs,
         io_backender,
         cache_balancer,
         rdb_context,
@@ -304,17 +332,6 @@ void real_table_persistence_interface_t::load_multistore(
         &real_multistores));
 }
 
-void real_table_persistence_interface_t::create_multistore(
-        const namespace_id_t &table_id,
-        scoped_ptr_t<multistore_ptr_t> *multistore_ptr_out,
-        signal_t *interruptor,
-        perfmon_collection_t *perfmon_collection_serializers) {
-    metadata_file_t::read_txn_t read_txn(metadata_file, interruptor);
-    load_multistore(
-        table_id, &read_txn, multistore_ptr_out, interruptor,
-        perfmon_collection_serializers);
-}
-
 void real_table_persistence_interface_t::destroy_multistore(
         const namespace_id_t &table_id,
         scoped_ptr_t<multistore_ptr_t> *multistore_ptr_in) {
@@ -326,6 +343,10 @@ void real_table_persistence_interface_t::destroy_multistore(
     const int res = ::unlink(filepath.c_str());
     guarantee_err(res == 0 || get_errno() == ENOENT,
                   "unlink failed for file %s", filepath.c_str());
+    remove_serializer_file_stripes(filepath);
+    for (int ix = 0; ix < CPU_SHARDING_FACTOR; ++ix) {
+        remove_hot_block_manifest(hot_block_manifest_path(file_name_for(table_id), ix));
+    }
 }
 
 serializer_filepath_t real_table_persistence_interface_t::file_name_for(
@@ -2,6 +2,9 @@
 #ifndef CLUSTERING_ADMINISTRATION_PERSIST_TABLE_INTERFACE_HPP_
 #define CLUSTERING_ADMINISTRATION_PERSIST_TABLE_INTERFACE_HPP_
 
+#include <string>
+#include <vector>
+
 #include "clustering/administration/perfmon_collection_repo.hpp"
 #include "clustering/administration/persist/raft_storage_interface.hpp"
 #include "clustering/table_manager/table_metadata.hpp"
@@ -18,11 +21,17 @@ public:
             io_backender_t *_io_backender,
             cache_balancer_t *_cache_balancer,
             const base_path_t &_base_path,
+            const std::vector<std::string> &_data_dirs,
+            const std::string &_cold_data_dir,
+            int64_t _cold_after_secs,
             rdb_context_t *_rdb_context,
             metadata_file_t *_metadata_file) :
         io_backender(_io_backender),
         cache_balancer(_cache_balancer),
         base_path(_base_path),
+        data_dirs(_data_dirs),
+        cold_data_dir(_cold_data_dir),
+        cold_after_secs(_cold_after_secs),
         rdb_context(_rdb_context),
         metadata_file(_metadata_file),
         /* We assign threads from the lowest thread number upwards. This is to reduce
@@ -55,14 +64,9 @@ public:
     void delete_metadata(
         const namespace_id_t &table_id);
 
-    void load_multistore(
-        const namespace_id_t &table_id,
-        metadata_file_t::read_txn_t *metadata_read_txn,
-        scoped_ptr_t<multistore_ptr_t> *multistore_ptr_out,
-        signal_t *interruptor,
-        perfmon_collection_t *perfmon_collection_serializers);
     void create_multistore(
         const namespace_id_t &table_id,
+        const table_storage_config_t &storage_config,
         scoped_ptr_t<multistore_ptr_t> *multistore_ptr_out,
         signal_t *interruptor,
         perfmon_collection_t *perfmon_collection_serializers);
@@ -79,6 +83,13 @@ private:
     io_backender_t * const io_backender;
     cache_balancer_t * const cache_balancer;
     base_path_t const base_path;
+    /* New tables' data files are striped over a file in `base_path` and one in each of
+    these directories. */
+    std::vector<std::string> const data_dirs;
+    /* If this isn't empty, the data files get a cold tier here, which the blocks that
+    haven't been used for `cold_after_secs` are moved to. */
+    std::string const cold_data_dir;
+    int64_t const cold_after_secs;
     rdb_context_t * const rdb_context;
     metadata_file_t * const metadata_file;
 
@@ -41,6 +41,11 @@ real_reql_cluster_interface_t::real_reql_cluster_interface_t(
     m_auth_semilattice_view(auth_semilattice_view),
     m_cluster_semilattice_view(cluster_semilattice_view),
     m_table_meta_client(table_meta_client),
+    m_database_snapshot(
+        clone_ptr_t<semilattice_watchable_t<databases_semilattice_metadata_t> >(
+            new semilattice_watchable_t<databases_semilattice_metadata_t>(
+                metadata_field(&cluster_semilattice_metadata_t::databases,
+                               m_cluster_semilattice_view)))),
     m_cross_thread_database_watchables(get_num_threads()),
     m_rdb_context(rdb_context),
     m_namespace_repo(
@@ -55,7 +60,8 @@ real_reql_cluster_interface_t::real_reql_cluster_interface_t(
             return this->m_namespace_repo.get_namespace_interface(id, interruptor);
         },
         name_resolver),
-    m_server_config_client(server_config_client)
+    m_server_config_client(server_config_client),
+    m_query_result_cache(m_rdb_context, &m_changefeed_client)
 {
     guarantee(m_auth_semilattice_view->home_thread() == home_thread());
     guarantee(m_cluster_semilattice_view->home_thread() == home_thread());
@@ -64,10 +70,13 @@ real_reql_cluster_interface_t::real_reql_cluster_interface_t(
     for (int thr = 0; thr < get_num_threads(); ++thr) {
         m_cross_thread_database_watchables[thr].init(
             new cross_thread_watchable_variable_t<databases_semilattice_metadata_t>(
-                clone_ptr_t<semilattice_watchable_t<databases_semilattice_metadata_t> >
-                    (new semilattice_watchable_t<databases_semilattice_metadata_t>(
-                        metadata_field(&cluster_semilattice_metadata_t::databases, m_cluster_semilattice_view))), threadnum_t(thr)));
+                &m_database_snapshot, threadnum_t(thr)));
     }
+    m_rdb_context->query_result_cache = &m_query_result_cache;
+}
+
+real_reql_cluster_interface_t::~real_reql_cluster_interface_t() {
+    m_rdb_context->query_result_cache = nullptr;
 }
 
 bool real_reql_cluster_interface_t::db_create(
@@ -329,12 +338,15 @@ bool real_reql_cluster_interface_t::table_create(
         /* Pick which servers to host the data */
         table_generate_config(
             m_server_config_client, nil_uuid(), m_table_meta_client,
-            config_params, config.shard_scheme, &interruptor_on_home,
-            &config.config.shards, &config.server_names);
+            config_params, config.shard_scheme, nullptr, &interruptor_on_home,
+            &config.config.shards, &config.server_names, nullptr);
 
         config.config.write_ack_config = write_ack_config_t::MAJORITY;
         config.config.durability = durability;
         config.config.user_data = default_user_data();
+        config.config.storage = default_table_storage_config();
+        config.config.expiry = default_table_expiry_config();
+        config.config.cache = default_table_cache_config();
 
         table_id = generate_uuid();
         m_table_meta_client->create(table_id, config, &interruptor_on_home);
@@ -691,20 +703,39 @@ void real_reql_cluster_interface_t::reconfigure_internal(
     new_config.config.write_ack_config = old_config.config.write_ack_config;
     new_config.config.durability = old_config.config.durability;
     new_config.config.user_data = old_config.config.user_data;
+    new_config.config.storage = old_config.config.storage;
+    new_config.config.expiry = old_config.config.expiry;
+    new_config.config.cache = old_config.config.cache;
+
+    /* The distribution is used to pick the new split points if the number of shards
+    goes up, and it tells `table_generate_config()` how much data each shard has, so it
+    can keep the data where it is when it's cheaper. If the table isn't available to
+    read it, the config is generated without it, unless shards are being added. */
+    std::map<store_key_t, int64_t> distribution;
+    bool have_distribution = true;
+    try {
+        fetch_distribution(table_id, this, interruptor_on_home, &distribution);
+    } catch (const failed_table_op_exc_t &) {
+        if (params.num_shards > old_config.shard_scheme.num_shards()) {
+            throw;
+        }
+        have_distribution = false;
+    }
 
     calculate_split_points_intelligently(
-        table_id,
-        this,
         params.num_shards,
         old_config.shard_scheme,
-        interruptor_on_home,
+        have_distribution ? &distribution : nullptr,
         &new_config.shard_scheme);
 
     /* `table_generate_config()` just generates the config; it doesn't apply it */
+    int64_t docs_to_copy;
     table_generate_config(
         m_server_config_client, table_id, m_table_meta_client,
-        params, new_config.shard_scheme, interruptor_on_home, &new_config.config.shards,
-        &new_config.server_names);
+        params, new_config.shard_scheme,
+        have_distribution ? &distribution : nullptr, interruptor_on_home,
+        &new_config.config.shards, &new_config.server_names,
+        have_distribution ? &docs_to_copy : nullptr);
 
     if (!dry_run) {
         table_config_and_shards_change_t table_config_and_shards_change(
@@ -740,6 +771,10 @@ void real_reql_cluster_interface_t::reconfigure_internal(
         result_builder.overwrite("reconfigured", ql::datum_t(0.0));
         result_builder.overwrite("config_changes",
             make_replacement_pair(old_config_datum, new_config_datum));
+        if (have_distribution) {
+            result_builder.overwrite("estimated_docs_to_copy",
+                ql::datum_t(static_cast<double>(docs_to_copy)));
+        }
     }
     *result_out = std::move(result_builder).to_datum();
 }
@@ -12,6 +12,7 @@
 #include "concurrency/cross_thread_watchable.hpp"
 #include "concurrency/watchable.hpp"
 #include "rdb_protocol/context.hpp"
+#include "rdb_protocol/query_result_cache.hpp"
 #include "rpc/semilattice/view.hpp"
 
 class artificial_reql_cluster_interface_t;
@@ -43,6 +44,7 @@ public:
                 std::pair<peer_id_t, std::pair<namespace_id_t, branch_id_t> >,
                 table_query_bcard_t> *table_query_directory,
             lifetime_t<name_resolver_t const &> name_resolver);
+    ~real_reql_cluster_interface_t();
 
     bool db_create(
             auth::user_context_t const &user_context,
@@ -279,6 +281,8 @@ private:
     std::shared_ptr<semilattice_readwrite_view_t<
         cluster_semilattice_metadata_t> > m_cluster_semilattice_view;
     table_meta_client_t *m_table_meta_client;
+    // Shared by `m_cross_thread_database_watchables`, so it's declared before them.
+    watchable_snapshot_t<databases_semilattice_metadata_t> m_database_snapshot;
     scoped_array_t< scoped_ptr_t< cross_thread_watchable_variable_t<
         databases_semilattice_metadata_t > > > m_cross_thread_database_watchables;
     rdb_context_t *m_rdb_context;
@@ -286,6 +290,8 @@ private:
     namespace_repo_t m_namespace_repo;
     ql::changefeed::client_t m_changefeed_client;
     server_config_client_t *m_server_config_client;
+    // Watches tables through `m_changefeed_client`, so it must be destroyed first.
+    ql::query_result_cache_t m_query_result_cache;
 
     void wait_for_cluster_metadata_to_propagate(
             const cluster_semilattice_metadata_t &metadata,
@@ -14,11 +14,16 @@
 
 class server_config_client_t;
 
+/* Serves a table with one row per server holding that server's raw stats.  If
+`stat_path` isn't empty, the row only holds the stats under that path; this is how
+`_debug_profile` is served. */
 class debug_stats_artificial_table_backend_t :
     public common_server_artificial_table_backend_t
 {
 public:
     debug_stats_artificial_table_backend_t(
+            const name_string_t &table_name,
+            const std::vector<stat_manager_t::stat_id_t> &_stat_path,
             rdb_context_t *rdb_context,
             lifetime_t<name_resolver_t const &> name_resolver,
             watchable_map_t<peer_id_t, cluster_directory_metadata_t> *_directory,
@@ -50,6 +55,7 @@ private:
             ql::datum_t *stats_out,
             admin_err_t *error_out);
 
+    std::vector<stat_manager_t::stat_id_t> stat_path;
     watchable_map_t<peer_id_t, cluster_directory_metadata_t> *directory_view;
     mailbox_manager_t *mailbox_manager;
 };
@@ -0,0 +1,189 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "clustering/administration/stats/query_stats_backend.hpp"
+
+#include <map>
+#include <set>
+
+#include "clustering/administration/stats/request.hpp"
+#include "clustering/administration/stats/stat_manager.hpp"
+#include "concurrency/cross_thread_signal.hpp"
+#include "concurrency/pmap.hpp"
+
+query_stats_artificial_table_backend_t::query_stats_artificial_table_backend_t(
+        rdb_context_t *rdb_context,
+        lifetime_t<name_resolver_t const &> name_resolver,
+        const clone_ptr_t<watchable_t<change_tracking_map_t<peer_id_t,
+            cluster_directory_metadata_t> > >
+                &_directory_view,
+        mailbox_manager_t *_mailbox_manager) :
+    timer_cfeed_artificial_table_backend_t(
+        name_string_t::guarantee_valid("_query_stats"), rdb_context, name_resolver),
+    directory_view(_directory_view),
+    mailbox_manager(_mailbox_manager) { }
+
+query_stats_artificial_table_backend_t::~query_stats_artificial_table_backend_t() {
+    begin_changefeed_destruction();
+}
+
+std::string query_stats_artificial_table_backend_t::get_primary_key_name() {
+    return std::string("id");
+}
+
+// Sums the numeric fields of two rows for the same fingerprint.
+static ql::datum_t merge_query_stats(const ql::datum_t &a, const ql::datum_t &b) {
+    ql::datum_object_builder_t builder(a);
+    for (size_t i = 0; i < b.obj_size(); ++i) {
+        auto pair = b.get_pair(i);
+        ql::datum_t existing = a.get_field(pair.first, ql::NOTHROW);
+        if (existing.has() && existing.get_type() == ql::datum_t::R_NUM &&
+                pair.second.get_type() == ql::datum_t::R_NUM) {
+            builder.overwrite(pair.first,
+                ql::datum_t(existing.as_num() + pair.second.as_num()));
+        } else if (!existing.has()) {
+            builder.overwrite(pair.first, pair.second);
+        }
+    }
+    return std::move(builder).to_datum();
+}
+
+std::vector<ql::datum_t> fetch_stat_from_all_servers(
+        const clone_ptr_t<watchable_t<change_tracking_map_t<peer_id_t,
+            cluster_directory_metadata_t> > > &directory_view,
+        mailbox_manager_t *mailbox_manager,
+        const std::string &stat_name,
+        signal_t *interruptor_on_home) {
+    std::vector<peer_id_t> peers =
+        stats_request_t::all_peers(directory_view->get().get_inner());
+    std::set<std::vector<std::string> > filter;
+    filter.insert(std::vector<std::string>{stat_name});
+
+    std::vector<ql::datum_t> results(peers.size());
+    pmap(peers.size(), [&](int64_t index) {
+        get_stats_mailbox_address_t request_addr;
+        directory_view->apply_read(
+            [&](const change_tracking_map_t<peer_id_t,
+                    cluster_directory_metadata_t> *dir) {
+                auto const peer_it = dir->get_inner().find(peers[index]);
+                if (peer_it != dir->get_inner().end()) {
+                    request_addr = peer_it->second.get_stats_mailbox_address;
+                }
+            });
+        if (request_addr.is_nil()) {
+            return;
+        }
+        try {
+            admin_err_t dummy_error;
+            if (!fetch_stats_from_server(mailbox_manager, request_addr, filter,
+                    interruptor_on_home, &results[index], &dummy_error)) {
+                results[index] = ql::datum_t();
+            }
+        } catch (const interrupted_exc_t &) {
+            /* It doesn't matter what we return */
+        }
+    });
+    if (interruptor_on_home->is_pulsed()) {
+        throw interrupted_exc_t();
+    }
+
+    std::vector<ql::datum_t> reachable;
+    for (const ql::datum_t &result : results) {
+        if (result.has() && result.get_type() == ql::datum_t::R_OBJECT) {
+            reachable.push_back(result);
+        }
+    }
+    return reachable;
+}
+
+ql::datum_t query_stats_artificial_table_backend_t::get_merged_query_stats(
+        signal_t *interruptor_on_home) {
+    std::vector<ql::datum_t> results = fetch_stat_from_all_servers(
+        directory_view, mailbox_manager, QUERY_STATS_STAT_NAME, interruptor_on_home);
+
+    /* Servers we couldn't reach are left out; their stats are lost when they restart
+    anyway. */
+    std::map<datum_string_t, ql::datum_t> merged;
+    for (const ql::datum_t &result : results) {
+        ql::datum_t query_stats =
+            result.get_field(QUERY_STATS_STAT_NAME, ql::NOTHROW);
+        if (!query_stats.has() || query_stats.get_type() != ql::datum_t::R_OBJECT) {
+            continue;
+        }
+        for (size_t i = 0; i < query_stats.obj_size(); ++i) {
+            auto pair = query_stats.get_pair(i);
+            if (pair.second.get_type() != ql::datum_t::R_OBJECT) {
+                continue;
+            }
+            auto it = merged.find(pair.first);
+            if (it == merged.end()) {
+                merged.insert(std::make_pair(pair.first, pair.second));
+            } else {
+                it->second = merge_query_stats(it->second, pair.second);
+            }
+        }
+    }
+
+    ql::datum_object_builder_t builder;
+    for (const auto &pair : merged) {
+        ql::datum_object_builder_t row(pair.second);
+        row.overwrite("id", ql::datum_t(pair.first));
+        builder.overwrite(pair.first, std::move(row).to_datum());
+    }
+    return std::move(builder).to_datum();
+}
+
+bool query_stats_artificial_table_backend_t::read_all_rows_as_vector(
+        auth::user_context_t const &user_context,
+        signal_t *interruptor_on_caller,
+        std::vector<ql::datum_t> *rows_out,
+        UNUSED admin_err_t *error_out) {
+    // The queries' text can mention any database or table.
+    user_context.require_admin_user();
+
+    cross_thread_signal_t interruptor_on_home(interruptor_on_caller, home_thread());
+    on_thread_t rethreader(home_thread());
+    rows_out->clear();
+
+    ql::datum_t merged = get_merged_query_stats(&interruptor_on_home);
+    rows_out->reserve(merged.obj_size());
+    for (size_t i = 0; i < merged.obj_size(); ++i) {
+        rows_out->push_back(merged.get_pair(i).second);
+    }
+    return true;
+}
+
+bool query_stats_artificial_table_backend_t::read_row(
+        auth::user_context_t const &user_context,
+        ql::datum_t primary_key,
+        signal_t *interruptor_on_caller,
+        ql::datum_t *row_out,
+        UNUSED admin_err_t *error_out) {
+    user_context.require_admin_user();
+
+    cross_thread_signal_t interruptor_on_home(interruptor_on_caller, home_thread());
+    on_thread_t rethreader(home_thread());
+
+    // Any incorrect format means the row doesn't exist
+    if (primary_key.get_type() != ql::datum_t::R_STR) {
+        *row_out = ql::datum_t();
+        return true;
+    }
+
+    ql::datum_t merged = get_merged_query_stats(&interruptor_on_home);
+    *row_out = merged.get_field(primary_key.as_str(), ql::NOTHROW);
+    return true;
+}
+
+bool query_stats_artificial_table_backend_t::write_row(
+        auth::user_context_t const &user_context,
+        UNUSED ql::datum_t primary_key,
+        UNUSED bool pkey_was_autogenerated,
+        UNUSED ql::datum_t *new_value_inout,
+        UNUSED signal_t *interruptor_on_caller,
+        admin_err_t *error_out) {
+    user_context.require_admin_user();
+
+    *error_out = admin_err_t{
+        "It's illegal to write to the `rethinkdb._query_stats` table.",
+        query_state_t::FAILED};
+    return false;
+}
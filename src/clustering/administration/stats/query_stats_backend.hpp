@@ -0,0 +1,71 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef CLUSTERING_ADMINISTRATION_STATS_QUERY_STATS_BACKEND_HPP_
+#define CLUSTERING_ADMINISTRATION_STATS_QUERY_STATS_BACKEND_HPP_
+
+#include <string>
+#include <vector>
+
+#include "rdb_protocol/artificial_table/caching_cfeed_backend.hpp"
+#include "clustering/administration/metadata.hpp"
+#include "concurrency/watchable.hpp"
+
+/* Fetches the stat `stat_name` from all connected servers.  The results are the whole
+stats objects, which also hold the servers' ids.  Servers we couldn't reach are left
+out. */
+std::vector<ql::datum_t> fetch_stat_from_all_servers(
+        const clone_ptr_t<watchable_t<change_tracking_map_t<peer_id_t,
+            cluster_directory_metadata_t> > > &directory_view,
+        mailbox_manager_t *mailbox_manager,
+        const std::string &stat_name,
+        signal_t *interruptor_on_home);
+
+/* Serves `rethinkdb._query_stats`, which has one row per query fingerprint (see
+`rdb_protocol/query_stats.hpp`) holding what the queries with that fingerprint have
+cost on all servers since they started. */
+class query_stats_artificial_table_backend_t :
+    public timer_cfeed_artificial_table_backend_t
+{
+public:
+    query_stats_artificial_table_backend_t(
+        rdb_context_t *rdb_context,
+        lifetime_t<name_resolver_t const &> name_resolver,
+        const clone_ptr_t<watchable_t<change_tracking_map_t<peer_id_t,
+            cluster_directory_metadata_t> > >
+                &_directory_view,
+        mailbox_manager_t *_mailbox_manager);
+    ~query_stats_artificial_table_backend_t();
+
+    std::string get_primary_key_name();
+
+    bool read_all_rows_as_vector(
+            auth::user_context_t const &user_context,
+            signal_t *interruptor_on_caller,
+            std::vector<ql::datum_t> *rows_out,
+            admin_err_t *error_out);
+
+    bool read_row(
+            auth::user_context_t const &user_context,
+            ql::datum_t primary_key,
+            signal_t *interruptor_on_caller,
+            ql::datum_t *row_out,
+            admin_err_t *error_out);
+
+    bool write_row(
+            auth::user_context_t const &user_context,
+            ql::datum_t primary_key,
+            bool pkey_was_autogenerated,
+            ql::datum_t *new_value_inout,
+            signal_t *interruptor_on_caller,
+            admin_err_t *error_out);
+
+private:
+    /* Fetches the query stats of all connected servers and merges them into one object
+    that maps each fingerprint's id to its stats. */
+    ql::datum_t get_merged_query_stats(signal_t *interruptor_on_home);
+
+    clone_ptr_t<watchable_t<change_tracking_map_t<peer_id_t,
+        cluster_directory_metadata_t> > > directory_view;
+    mailbox_manager_t *mailbox_manager;
+};
+
+#endif /* CLUSTERING_ADMINISTRATION_STATS_QUERY_STATS_BACKEND_HPP_ */
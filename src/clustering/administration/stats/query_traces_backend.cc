@@ -0,0 +1,103 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "clustering/administration/stats/query_traces_backend.hpp"
+
+#include "clustering/administration/stats/query_stats_backend.hpp"
+#include "clustering/administration/stats/stat_manager.hpp"
+#include "concurrency/cross_thread_signal.hpp"
+
+query_traces_artificial_table_backend_t::query_traces_artificial_table_backend_t(
+        rdb_context_t *rdb_context,
+        lifetime_t<name_resolver_t const &> name_resolver,
+        const clone_ptr_t<watchable_t<change_tracking_map_t<peer_id_t,
+            cluster_directory_metadata_t> > >
+                &_directory_view,
+        mailbox_manager_t *_mailbox_manager) :
+    timer_cfeed_artificial_table_backend_t(
+        name_string_t::guarantee_valid("_query_traces"), rdb_context, name_resolver),
+    directory_view(_directory_view),
+    mailbox_manager(_mailbox_manager) { }
+
+query_traces_artificial_table_backend_t::~query_traces_artificial_table_backend_t() {
+    begin_changefeed_destruction();
+}
+
+std::string query_traces_artificial_table_backend_t::get_primary_key_name() {
+    return std::string("id");
+}
+
+std::vector<ql::datum_t> query_traces_artificial_table_backend_t::get_query_traces(
+        signal_t *interruptor_on_home) {
+    std::vector<ql::datum_t> results = fetch_stat_from_all_servers(
+        directory_view, mailbox_manager, QUERY_TRACES_STAT_NAME, interruptor_on_home);
+
+    std::vector<ql::datum_t> rows;
+    for (const ql::datum_t &result : results) {
+        ql::datum_t server_id = result.get_field("server_id", ql::NOTHROW);
+        ql::datum_t query_traces =
+            result.get_field(QUERY_TRACES_STAT_NAME, ql::NOTHROW);
+        if (!query_traces.has() || query_traces.get_type() != ql::datum_t::R_ARRAY) {
+            continue;
+        }
+        for (size_t i = 0; i < query_traces.arr_size(); ++i) {
+            ql::datum_t query_trace = query_traces.get(i);
+            if (query_trace.get_type() != ql::datum_t::R_OBJECT) {
+                continue;
+            }
+            ql::datum_object_builder_t row(query_trace);
+            row.overwrite("server",
+                server_id.has() ? server_id : ql::datum_t::null());
+            rows.push_back(std::move(row).to_datum());
+        }
+    }
+    return rows;
+}
+
+bool query_traces_artificial_table_backend_t::read_all_rows_as_vector(
+        auth::user_context_t const &user_context,
+        signal_t *interruptor_on_caller,
+        std::vector<ql::datum_t> *rows_out,
+        UNUSED admin_err_t *error_out) {
+    // The queries' text can mention any database or table.
+    user_context.require_admin_user();
+
+    cross_thread_signal_t interruptor_on_home(interruptor_on_caller, home_thread());
+    on_thread_t rethreader(home_thread());
+    *rows_out = get_query_traces(&interruptor_on_home);
+    return true;
+}
+
+bool query_traces_artificial_table_backend_t::read_row(
+        auth::user_context_t const &user_context,
+        ql::datum_t primary_key,
+        signal_t *interruptor_on_caller,
+        ql::datum_t *row_out,
+        UNUSED admin_err_t *error_out) {
+    user_context.require_admin_user();
+
+    cross_thread_signal_t interruptor_on_home(interruptor_on_caller, home_thread());
+    on_thread_t rethreader(home_thread());
+
+    *row_out = ql::datum_t();
+    for (const ql::datum_t &row : get_query_traces(&interruptor_on_home)) {
+        if (row.get_field("id", ql::NOTHROW) == primary_key) {
+            *row_out = row;
+            break;
+        }
+    }
+    return true;
+}
+
+bool query_traces_artificial_table_backend_t::write_row(
+        auth::user_context_t const &user_context,
+        UNUSED ql::datum_t primary_key,
+        UNUSED bool pkey_was_autogenerated,
+        UNUSED ql::datum_t *new_value_inout,
+        UNUSED signal_t *interruptor_on_caller,
+        admin_err_t *error_out) {
+    user_context.require_admin_user();
+
+    *error_out = admin_err_t{
+        "It's illegal to write to the `rethinkdb._query_traces` table.",
+        query_state_t::FAILED};
+    return false;
+}
@@ -31,15 +31,86 @@ const char *table_server_stats_request_t::table_server_request_type = "table_ser
     (BUILDER).overwrite(#NAME, ql::datum_t( \
         (STATS).accumulate_server(SERVER, &parsed_stats_t::table_stats_t::NAME)));
 
+parsed_stats_t::latency_stats_t::latency_stats_t() : count(0), max_secs(0) { }
+
+void parsed_stats_t::latency_stats_t::add_perfmon(const ql::datum_t &histogram) {
+    if (!histogram.has() || histogram.get_type() != ql::datum_t::R_OBJECT) {
+        return;
+    }
+    ql::datum_t hist_buckets = histogram.get_field("buckets", ql::throw_bool_t::NOTHROW);
+    if (!hist_buckets.has() || hist_buckets.get_type() != ql::datum_t::R_ARRAY) {
+        return;
+    }
+    for (size_t i = 0; i < hist_buckets.arr_size(); ++i) {
+        ql::datum_t bucket = hist_buckets.get(i);
+        r_sanity_check(bucket.get_type() == ql::datum_t::R_ARRAY
+                       && bucket.arr_size() == 2);
+        const double limit = bucket.get(0).get_type() == ql::datum_t::R_NULL
+            ? std::numeric_limits<double>::infinity()
+            : bucket.get(0).as_num();
+        buckets[limit] += bucket.get(1).as_num();
+        count += bucket.get(1).as_num();
+    }
+    ql::datum_t max = histogram.get_field("max", ql::throw_bool_t::NOTHROW);
+    if (max.has() && max.get_type() == ql::datum_t::R_NUM) {
+        max_secs = std::max(max_secs, max.as_num());
+    }
+}
+
+void parsed_stats_t::latency_stats_t::add(const latency_stats_t &other) {
+    for (const auto &pair : other.buckets) {
+        buckets[pair.first] += pair.second;
+    }
+    count += other.count;
+    max_secs = std::max(max_secs, other.max_secs);
+}
+
+double parsed_stats_t::latency_stats_t::percentile_secs(double percent) const {
+    // Like `perfmon_histogram::stats_t::percentile_nanos()`.
+    const double wanted = count * percent / 100.0;
+    double seen = 0;
+    for (const auto &pair : buckets) {
+        seen += pair.second;
+        if (seen >= wanted) {
+            return std::min(max_secs, pair.first);
+        }
+    }
+    return max_secs;
+}
+
+ql::datum_t parsed_stats_t::latency_stats_t::to_datum() const {
+    ql::datum_object_builder_t builder;
+    if (count > 0) {
+        builder.overwrite("p50", ql::datum_t(percentile_secs(50)));
+        builder.overwrite("p99", ql::datum_t(percentile_secs(99)));
+        builder.overwrite("p999", ql::datum_t(percentile_secs(99.9)));
+        builder.overwrite("max", ql::datum_t(max_secs));
+    } else {
+        builder.overwrite("p50", ql::datum_t::null());
+        builder.overwrite("p99", ql::datum_t::null());
+        builder.overwrite("p999", ql::datum_t::null());
+        builder.overwrite("max", ql::datum_t::null());
+    }
+    return std::move(builder).to_datum();
+}
+
 parsed_stats_t::server_stats_t::server_stats_t() :
     responsive(false),
     queries_per_sec(0), queries_total(0),
-    client_connections(0), clients_active(0) { }
+    client_connections(0), clients_active(0),
+    changefeed_queued_changes(0), changefeed_changes_dropped(0) { }
+
+parsed_stats_t::primary_shard_stats_t::primary_shard_stats_t() :
+    reads_per_sec(0), writes_per_sec(0) { }
 
 parsed_stats_t::table_stats_t::table_stats_t() :
     read_docs_per_sec(0), read_docs_total(0),
     written_docs_per_sec(0), written_docs_total(0),
-    in_use_bytes(0), metadata_bytes(0), data_bytes(0),
+    in_use_bytes(0), memory_limit_bytes(0), ghost_hits_total(0),
+    unwritten_changes(0), unwritten_changes_limit(0),
+    written_changes_per_sec(0), throttled_micros_total(0),
+    warm_up_blocks_total(0), warm_up_blocks_done(0),
+    metadata_bytes(0), data_bytes(0),
     garbage_bytes(0), preallocated_bytes(0),
     read_bytes_per_sec(0), read_bytes_total(0),
     written_bytes_per_sec(0), written_bytes_total(0) { }
@@ -65,6 +136,16 @@ parsed_stats_t::parsed_stats_t(const std::vector<ql::datum_t> &stats) {
             std::pair<datum_string_t, ql::datum_t> perf_pair = s.get_pair(i);
             if (perf_pair.first == "query_engine") {
                 store_query_engine_stats(perf_pair.second, &serv_stats);
+            } else if (perf_pair.first == "event_loop") {
+                serv_stats.event_loop_iteration = perf_pair.second.get_field(
+                    "iteration", ql::throw_bool_t::NOTHROW);
+            } else if (perf_pair.first == "memory") {
+                serv_stats.memory = perf_pair.second;
+            } else if (perf_pair.first == "disk") {
+                serv_stats.disk_read_latency.add_perfmon(perf_pair.second.get_field(
+                    "stack_read_latency", ql::throw_bool_t::NOTHROW));
+                serv_stats.disk_write_latency.add_perfmon(perf_pair.second.get_field(
+                    "stack_write_latency", ql::throw_bool_t::NOTHROW));
             } else {
                 namespace_id_t table_id;
                 res = str_to_uuid(perf_pair.first.to_std(), &table_id);
@@ -125,6 +206,24 @@ void parsed_stats_t::store_shard_values(const ql::datum_t &shard_perf,
                 } else if (key == "cache") {
                     add_perfmon_value(sub_pair.second, "in_use_bytes",
                                       &stats_out->in_use_bytes);
+                    add_perfmon_value(sub_pair.second, "memory_limit_bytes",
+                                      &stats_out->memory_limit_bytes);
+                    add_perfmon_value(sub_pair.second, "ghost_hits_total",
+                                      &stats_out->ghost_hits_total);
+                    add_perfmon_value(sub_pair.second, "unwritten_changes",
+                                      &stats_out->unwritten_changes);
+                    add_perfmon_value(sub_pair.second, "unwritten_changes_limit",
+                                      &stats_out->unwritten_changes_limit);
+                    add_perfmon_value(sub_pair.second, "written_changes_per_sec",
+                                      &stats_out->written_changes_per_sec);
+                    add_perfmon_value(sub_pair.second, "throttled_micros_total",
+                                      &stats_out->throttled_micros_total);
+                    add_perfmon_value(sub_pair.second, "warm_up_blocks_total",
+                                      &stats_out->warm_up_blocks_total);
+                    add_perfmon_value(sub_pair.second, "warm_up_blocks_done",
+                                      &stats_out->warm_up_blocks_done);
+                    stats_out->cache_miss_latency.add_perfmon(sub_pair.second.get_field(
+                        "miss_latency", ql::throw_bool_t::NOTHROW));
                 }
             }
         }
@@ -160,6 +259,34 @@ void parsed_stats_t::store_serializer_values(const ql::datum_t &ser_perf,
     stats_out->preallocated_bytes = std::max(0.0, stats_out->preallocated_bytes);
 }
 
+void parsed_stats_t::store_primary_values(const ql::datum_t &regions_perf,
+                                          table_stats_t *stats_out) {
+    r_sanity_check(regions_perf.get_type() == ql::datum_t::R_OBJECT);
+    for (size_t i = 0; i < regions_perf.obj_size(); ++i) {
+        std::pair<datum_string_t, ql::datum_t> pair = regions_perf.get_pair(i);
+        if (pair.first.to_std().find("primary-") != 0) {
+            continue;
+        }
+        r_sanity_check(pair.second.get_type() == ql::datum_t::R_OBJECT);
+        ql::datum_t key_range = pair.second.get_field("key_range",
+                                                      ql::throw_bool_t::NOTHROW);
+        ql::datum_t broadcaster = pair.second.get_field("broadcaster",
+                                                        ql::throw_bool_t::NOTHROW);
+        if (!key_range.has() || !broadcaster.has()) {
+            continue;
+        }
+        r_sanity_check(key_range.get_type() == ql::datum_t::R_STR);
+        r_sanity_check(broadcaster.get_type() == ql::datum_t::R_OBJECT);
+        // Every hash shard of a range shard has its own primary, so we sum them.
+        primary_shard_stats_t *shard_out =
+            &stats_out->primary_shards[key_range.as_str().to_std()];
+        add_perfmon_value(broadcaster, "reads_per_sec", &shard_out->reads_per_sec);
+        add_perfmon_value(broadcaster, "writes_per_sec", &shard_out->writes_per_sec);
+        stats_out->replication_ack_latency.add_perfmon(
+            broadcaster.get_field("ack_latency", ql::throw_bool_t::NOTHROW));
+    }
+}
+
 void parsed_stats_t::store_query_engine_stats(const ql::datum_t &qe_perf,
                                               server_stats_t *stats_out) {
     r_sanity_check(qe_perf.get_type() == ql::datum_t::R_OBJECT);
@@ -167,6 +294,12 @@ void parsed_stats_t::store_query_engine_stats(const ql::datum_t &qe_perf,
     store_perfmon_value(qe_perf, "queries_total", &stats_out->queries_total);
     store_perfmon_value(qe_perf, "client_connections", &stats_out->client_connections);
     store_perfmon_value(qe_perf, "clients_active", &stats_out->clients_active);
+    store_perfmon_value(qe_perf, "changefeed_queued_changes",
+                        &stats_out->changefeed_queued_changes);
+    store_perfmon_value(qe_perf, "changefeed_changes_dropped",
+                        &stats_out->changefeed_changes_dropped);
+    stats_out->query_latency.add_perfmon(
+        qe_perf.get_field("query_latency", ql::throw_bool_t::NOTHROW));
 }
 
 void parsed_stats_t::store_table_stats(const namespace_id_t &table_id,
@@ -187,6 +320,11 @@ void parsed_stats_t::store_table_stats(const namespace_id_t &table_id,
             store_serializer_values(sub_sers_perf, &table_stats_out);
         }
     }
+    ql::datum_t regions_perf = table_perf.get_field("regions",
+                                                    ql::throw_bool_t::NOTHROW);
+    if (regions_perf.has()) {
+        store_primary_values(regions_perf, &stats_out->tables[table_id]);
+    }
 }
 
 double parsed_stats_t::accumulate(double server_stats_t::*field) const {
@@ -230,6 +368,28 @@ double parsed_stats_t::accumulate_server(const server_id_t &server_id,
     return res;
 }
 
+parsed_stats_t::latency_stats_t parsed_stats_t::accumulate(
+        latency_stats_t server_stats_t::*field) const {
+    latency_stats_t res;
+    for (auto const &pair : servers) {
+        res.add(pair.second.*field);
+    }
+    return res;
+}
+
+parsed_stats_t::latency_stats_t parsed_stats_t::accumulate_table(
+        const namespace_id_t &table_id,
+        latency_stats_t table_stats_t::*field) const {
+    latency_stats_t res;
+    for (auto const &server_pair : servers) {
+        auto const &table_it = server_pair.second.tables.find(table_id);
+        if (table_it != server_pair.second.tables.end()) {
+            res.add(table_it->second.*field);
+        }
+    }
+    return res;
+}
+
 bool add_table_fields(const namespace_id_t &table_id,
                       const cluster_semilattice_metadata_t &metadata,
                       table_meta_client_t *table_meta_client,
@@ -253,7 +413,13 @@ bool add_table_fields(const namespace_id_t &table_id,
 std::set<std::vector<std::string> > stats_request_t::global_stats_filter() {
     return std::set<std::vector<std::string> >(
         { {"query_engine"},
-          {"[0-9A-Fa-f-]+", "serializers" } });
+          {"event_loop", "iteration"},
+          {"memory"},
+          {"disk", "stack_(read|write)_latency"},
+          {"[0-9A-Fa-f-]+", "serializers" },
+          {"[0-9A-Fa-f-]+", "regions", "primary-[0-9]+", "key_range" },
+          {"[0-9A-Fa-f-]+", "regions", "primary-[0-9]+", "broadcaster",
+           "((reads|writes)_per_sec|ack_latency)" } });
 }
 
 std::vector<peer_id_t> stats_request_t::all_peers(
@@ -283,12 +449,6 @@ bool cluster_stats_request_t::parse(const ql::datum_t &info,
 
 cluster_stats_request_t::cluster_stats_request_t() { }
 
-std::set<std::vector<std::string> > cluster_stats_request_t::get_filter() const {
-    return std::set<std::vector<std::string> >(
-        { {"query_engine" },
-          {".*", "serializers", "shard_[0-9]+", "btree-.*", "keys_.*" } });
-}
-
 std::vector<peer_id_t> cluster_stats_request_t::get_peers(
         const std::map<peer_id_t, cluster_directory_metadata_t> &directory,
         server_config_client_t *) const {
@@ -312,6 +472,8 @@ bool cluster_stats_request_t::to_datum(const parsed_stats_t &stats,
     ADD_CLUSTER_SERVER_STAT(qe_builder, stats, clients_active);
     ADD_CLUSTER_TABLE_STAT(qe_builder, stats, read_docs_per_sec);
     ADD_CLUSTER_TABLE_STAT(qe_builder, stats, written_docs_per_sec);
+    qe_builder.overwrite("query_latency",
+        stats.accumulate(&parsed_stats_t::server_stats_t::query_latency).to_datum());
     row_builder.overwrite("query_engine", std::move(qe_builder).to_datum());
 
     *result_out = std::move(row_builder).to_datum();
@@ -342,12 +504,6 @@ bool table_stats_request_t::parse(const ql::datum_t &info,
 table_stats_request_t::table_stats_request_t(const namespace_id_t &_table_id) :
     table_id(_table_id) { }
 
-std::set<std::vector<std::string> > table_stats_request_t::get_filter() const {
-    return std::set<std::vector<std::string> >({
-        { uuid_to_str(table_id), "serializers", "shard_[0-9]+", "btree-.*", "keys_.*" }
-        });
-}
-
 std::vector<peer_id_t> table_stats_request_t::get_peers(
         const std::map<peer_id_t, cluster_directory_metadata_t> &directory,
         server_config_client_t *) const {
@@ -374,6 +530,10 @@ bool table_stats_request_t::to_datum(const parsed_stats_t &stats,
     ql::datum_object_builder_t qe_builder;
     ADD_TABLE_STAT(qe_builder, stats, table_id, read_docs_per_sec);
     ADD_TABLE_STAT(qe_builder, stats, table_id, written_docs_per_sec);
+    qe_builder.overwrite("replication_ack_latency",
+        stats.accumulate_table(
+            table_id,
+            &parsed_stats_t::table_stats_t::replication_ack_latency).to_datum());
     row_builder.overwrite("query_engine", std::move(qe_builder).to_datum());
 
     *result_out = std::move(row_builder).to_datum();
@@ -404,12 +564,6 @@ bool server_stats_request_t::parse(const ql::datum_t &info,
 server_stats_request_t::server_stats_request_t(const server_id_t &_server_id) :
     server_id(_server_id) { }
 
-std::set<std::vector<std::string> > server_stats_request_t::get_filter() const {
-    return std::set<std::vector<std::string> >(
-        { {"query_engine"},
-          {".*", "serializers", "shard_[0-9]+", "btree-.*" } });
-}
-
 std::vector<peer_id_t> server_stats_request_t::get_peers(
         const std::map<peer_id_t, cluster_directory_metadata_t> &,
         server_config_client_t *server_config_client) const {
@@ -452,11 +606,47 @@ bool server_stats_request_t::to_datum(const parsed_stats_t &stats,
         ADD_STAT(qe_builder, server_stats, clients_active);
         ADD_STAT(qe_builder, server_stats, queries_per_sec);
         ADD_STAT(qe_builder, server_stats, queries_total);
+        ADD_STAT(qe_builder, server_stats, changefeed_queued_changes);
+        ADD_STAT(qe_builder, server_stats, changefeed_changes_dropped);
         ADD_SERVER_STAT(qe_builder, stats, server_id, read_docs_per_sec);
         ADD_SERVER_STAT(qe_builder, stats, server_id, read_docs_total);
         ADD_SERVER_STAT(qe_builder, stats, server_id, written_docs_per_sec);
         ADD_SERVER_STAT(qe_builder, stats, server_id, written_docs_total);
+        qe_builder.overwrite("query_latency", server_stats.query_latency.to_datum());
         row_builder.overwrite("query_engine", std::move(qe_builder).to_datum());
+
+        ql::datum_object_builder_t se_disk_builder;
+        se_disk_builder.overwrite("read_latency",
+                                  server_stats.disk_read_latency.to_datum());
+        se_disk_builder.overwrite("write_latency",
+                                  server_stats.disk_write_latency.to_datum());
+        ql::datum_object_builder_t se_builder;
+        se_builder.overwrite("disk", std::move(se_disk_builder).to_datum());
+        row_builder.overwrite("storage_engine", std::move(se_builder).to_datum());
+
+        // One entry per thread, saying how busy its event loop was in the last second
+        // and how long its event loop iterations took.
+        const ql::datum_t &iteration = server_stats.event_loop_iteration;
+        if (iteration.has() && iteration.get_type() == ql::datum_t::R_ARRAY) {
+            ql::datum_array_builder_t el_builder(ql::configured_limits_t::unlimited);
+            for (size_t i = 0; i < iteration.arr_size(); ++i) {
+                const ql::datum_t thread = iteration.get(i);
+                r_sanity_check(thread.get_type() == ql::datum_t::R_OBJECT);
+                ql::datum_object_builder_t thread_builder;
+                thread_builder.overwrite("busy_fraction",
+                    thread.get_field("busy_fraction", ql::throw_bool_t::NOTHROW));
+                thread_builder.overwrite("iteration_secs_p99",
+                    thread.get_field("p99", ql::throw_bool_t::NOTHROW));
+                thread_builder.overwrite("iteration_secs_max",
+                    thread.get_field("max", ql::throw_bool_t::NOTHROW));
+                el_builder.add(std::move(thread_builder).to_datum());
+            }
+            row_builder.overwrite("event_loop", std::move(el_builder).to_datum());
+        }
+
+        if (server_stats.memory.has()) {
+            row_builder.overwrite("memory", server_stats.memory);
+        }
     }
     *result_out = std::move(row_builder).to_datum();
     return true;
@@ -492,11 +682,6 @@ table_server_stats_request_t::table_server_stats_request_t(
         const server_id_t &_server_id) :
     table_id(_table_id), server_id(_server_id) { }
 
-std::set<std::vector<std::string> > table_server_stats_request_t::get_filter() const {
-    return std::set<std::vector<std::string> >({
-        { uuid_to_str(table_id), "serializers" } });
-}
-
 std::vector<peer_id_t> table_server_stats_request_t::get_peers(
         const std::map<peer_id_t, cluster_directory_metadata_t> &,
         server_config_client_t *server_config_client) const {
@@ -549,9 +734,21 @@ bool table_server_stats_request_t::to_datum(const parsed_stats_t &stats,
         ADD_STAT(qe_builder, table_stats, read_docs_total);
         ADD_STAT(qe_builder, table_stats, written_docs_per_sec);
         ADD_STAT(qe_builder, table_stats, written_docs_total);
+        qe_builder.overwrite("replication_ack_latency",
+                             table_stats.replication_ack_latency.to_datum());
 
         ql::datum_object_builder_t se_cache_builder;
         ADD_STAT(se_cache_builder, table_stats, in_use_bytes);
+        ADD_STAT(se_cache_builder, table_stats, memory_limit_bytes);
+        ADD_STAT(se_cache_builder, table_stats, ghost_hits_total);
+        ADD_STAT(se_cache_builder, table_stats, unwritten_changes);
+        ADD_STAT(se_cache_builder, table_stats, unwritten_changes_limit);
+        ADD_STAT(se_cache_builder, table_stats, written_changes_per_sec);
+        ADD_STAT(se_cache_builder, table_stats, throttled_micros_total);
+        ADD_STAT(se_cache_builder, table_stats, warm_up_blocks_total);
+        ADD_STAT(se_cache_builder, table_stats, warm_up_blocks_done);
+        se_cache_builder.overwrite("miss_latency",
+                                   table_stats.cache_miss_latency.to_datum());
 
         ql::datum_object_builder_t se_disk_space_builder;
         ADD_STAT(se_disk_space_builder, table_stats, metadata_bytes);
@@ -570,6 +767,16 @@ bool table_server_stats_request_t::to_datum(const parsed_stats_t &stats,
         se_builder.overwrite("cache", std::move(se_cache_builder).to_datum());
         se_builder.overwrite("disk", std::move(se_disk_builder).to_datum());
 
+        ql::datum_array_builder_t shards_builder(ql::configured_limits_t::unlimited);
+        for (auto const &pair : table_stats.primary_shards) {
+            ql::datum_object_builder_t shard_builder;
+            shard_builder.overwrite("key_range", ql::datum_t(datum_string_t(pair.first)));
+            ADD_STAT(shard_builder, pair.second, reads_per_sec);
+            ADD_STAT(shard_builder, pair.second, writes_per_sec);
+            shards_builder.add(std::move(shard_builder).to_datum());
+        }
+        qe_builder.overwrite("primary_shards", std::move(shards_builder).to_datum());
+
         row_builder.overwrite("query_engine", std::move(qe_builder).to_datum());
         row_builder.overwrite("storage_engine", std::move(se_builder).to_datum());
     }
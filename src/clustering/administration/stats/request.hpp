@@ -20,6 +20,39 @@ class table_meta_client_t;
 // rows in the `stats` table, without performing more requests.
 class parsed_stats_t {
 public:
+    // Latencies gathered from `perfmon_histogram_t`s.  Since it keeps their buckets,
+    // it can merge the histograms of several shards or servers and still report
+    // percentiles.
+    class latency_stats_t {
+    public:
+        latency_stats_t();
+
+        // Adds the output of a `perfmon_histogram_t`; ignores a missing value.
+        void add_perfmon(const ql::datum_t &histogram);
+        void add(const latency_stats_t &other);
+
+        // An object with the `p50`, `p99`, `p999` and `max` latencies in seconds, which
+        // are null if nothing happened.
+        ql::datum_t to_datum() const;
+
+    private:
+        double percentile_secs(double percent) const;
+
+        // Maps each bucket's upper bound in seconds (infinity for the last bucket) to
+        // the number of events in it.
+        std::map<double, double> buckets;
+        double count;
+        double max_secs;
+    };
+
+    // The load on one range shard of a table, summed over its hash shards.
+    struct primary_shard_stats_t {
+        primary_shard_stats_t();
+
+        double reads_per_sec;
+        double writes_per_sec;
+    };
+
     struct table_stats_t {
         table_stats_t();
 
@@ -28,6 +61,14 @@ public:
         double written_docs_per_sec;
         double written_docs_total;
         double in_use_bytes;
+        double memory_limit_bytes;
+        double ghost_hits_total;
+        double unwritten_changes;
+        double unwritten_changes_limit;
+        double written_changes_per_sec;
+        double throttled_micros_total;
+        double warm_up_blocks_total;
+        double warm_up_blocks_done;
         double metadata_bytes;
         double data_bytes;
         double garbage_bytes;
@@ -36,6 +77,11 @@ public:
         double read_bytes_total;
         double written_bytes_per_sec;
         double written_bytes_total;
+        latency_stats_t cache_miss_latency;
+        latency_stats_t replication_ack_latency;
+
+        // The range shards this server is the primary replica for, by key range.
+        std::map<std::string, primary_shard_stats_t> primary_shards;
     };
 
     struct server_stats_t {
@@ -46,6 +92,16 @@ public:
         double queries_total;
         double client_connections;
         double clients_active;
+        double changefeed_queued_changes;
+        double changefeed_changes_dropped;
+        // The per-thread "event_loop/iteration" histograms, if the server has them.
+        ql::datum_t event_loop_iteration;
+        // The "memory" stats: the bytes that each subsystem holds, and the resident
+        // size of the process.
+        ql::datum_t memory;
+        latency_stats_t query_latency;
+        latency_stats_t disk_read_latency;
+        latency_stats_t disk_write_latency;
 
         std::map<namespace_id_t, table_stats_t> tables;
     };
@@ -66,6 +122,11 @@ public:
     double accumulate_server(const server_id_t &server_id,
                              double table_stats_t::*field) const;
 
+    // The same for latencies, which are merged instead of summed.
+    latency_stats_t accumulate(latency_stats_t server_stats_t::*field) const;
+    latency_stats_t accumulate_table(const namespace_id_t &table_id,
+                                     latency_stats_t table_stats_t::*field) const;
+
     std::map<server_id_t, server_stats_t> servers;
 
 private:
@@ -87,6 +148,9 @@ private:
     void store_serializer_values(const ql::datum_t &ser_perf,
                                  table_stats_t *);
 
+    void store_primary_values(const ql::datum_t &regions_perf,
+                              table_stats_t *stats_out);
+
     void store_query_engine_stats(const ql::datum_t &qe_perf,
                                   server_stats_t *stats_out);
 
@@ -96,11 +160,11 @@ private:
 };
 
 /* A `stats_request_t` encapsulates all the behavior that differentiates between
-different types of rows in the `stats` table. First, `get_filter` provides a set of
-regular expressions for which stats are needed by the request. Then, `get_peers` will
-tell us which peers should be contacted to get the relevant data. Finally, `to_datum`
-will take the `parsed_stats_t` obtained from the cross-cluster stats and format it into
-the appropriate row format. Each subclass of `stats_request_t` should correspond to a
+different types of rows in the `stats` table. First, `get_peers` will tell us which
+peers' stats snapshots are relevant.  Then, `to_datum` will take the `parsed_stats_t`
+obtained from those snapshots and format it into the appropriate row format.  Every
+server's snapshot holds the perfmons that match `global_stats_filter()`, which covers
+all types of rows. Each subclass of `stats_request_t` should correspond to a
 category within the admin `stats` table. */
 class stats_request_t {
 public:
@@ -112,10 +176,7 @@ public:
 
     virtual ~stats_request_t() { }
 
-    // Gets the regex filter to be applied to the perfmons on every server
-    virtual std::set<std::vector<std::string> > get_filter() const = 0;
-
-    // Gets the list of servers/peers the request should be sent to
+    // Gets the list of servers/peers whose stats the row is built from
     virtual std::vector<peer_id_t> get_peers(
         const std::map<peer_id_t, cluster_directory_metadata_t> &directory,
         server_config_client_t *server_config_client) const = 0;
@@ -138,8 +199,6 @@ public:
 
     cluster_stats_request_t();
 
-    std::set<std::vector<std::string> > get_filter() const;
-
     std::vector<peer_id_t> get_peers(
         const std::map<peer_id_t, cluster_directory_metadata_t> &directory,
         server_config_client_t *server_config_client) const;
@@ -163,8 +222,6 @@ public:
 
     explicit table_stats_request_t(const namespace_id_t &_table_id);
 
-    std::set<std::vector<std::string> > get_filter() const;
-
     std::vector<peer_id_t> get_peers(
         const std::map<peer_id_t, cluster_directory_metadata_t> &directory,
         server_config_client_t *server_config_client) const;
@@ -187,8 +244,6 @@ public:
 
     explicit server_stats_request_t(const server_id_t &_server_id);
 
-    std::set<std::vector<std::string> > get_filter() const;
-
     std::vector<peer_id_t> get_peers(
         const std::map<peer_id_t, cluster_directory_metadata_t> &directory,
         server_config_client_t *server_config_client) const;
@@ -213,8 +268,6 @@ public:
     table_server_stats_request_t(const namespace_id_t &_table_id,
                                  const server_id_t &_server_id);
 
-    std::set<std::vector<std::string> > get_filter() const;
-
     std::vector<peer_id_t> get_peers(
         const std::map<peer_id_t, cluster_directory_metadata_t> &directory,
         server_config_client_t *server_config_client) const;
@@ -0,0 +1,103 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "clustering/administration/stats/snapshot_cache.hpp"
+
+#include "arch/runtime/coroutines.hpp"
+#include "clustering/administration/stats/request.hpp"
+#include "clustering/administration/stats/stat_manager.hpp"
+#include "concurrency/wait_any.hpp"
+#include "time.hpp"
+
+stats_snapshot_cache_t::stats_snapshot_cache_t(
+        const clone_ptr_t<watchable_t<change_tracking_map_t<peer_id_t,
+            cluster_directory_metadata_t> > > &_directory_view,
+        mailbox_manager_t *_mailbox_manager) :
+    directory_view(_directory_view),
+    mailbox_manager(_mailbox_manager) { }
+
+stats_snapshot_cache_t::~stats_snapshot_cache_t() {
+    drainer.drain();
+}
+
+void stats_snapshot_cache_t::get_snapshots(const std::vector<peer_id_t> &peers,
+                                           std::vector<ql::datum_t> *results_out,
+                                           signal_t *interruptor) {
+    assert_thread();
+    const int64_t now_nanos = get_ticks().nanos;
+    std::vector<std::shared_ptr<cond_t> > first_fetches;
+    for (const peer_id_t &peer : peers) {
+        snapshot_t *snapshot = &snapshots[peer];
+        const bool stale = now_nanos - snapshot->fetched_nanos
+            >= static_cast<int64_t>(STATS_SNAPSHOT_REFRESH_MS) * MILLION;
+        if (stale && snapshot->refresh_done.get() == nullptr) {
+            snapshot->refresh_done = std::make_shared<cond_t>();
+            coro_t::spawn_sometime(std::bind(&stats_snapshot_cache_t::refresh,
+                this, peer, auto_drainer_t::lock_t(&drainer)));
+        }
+        if (!snapshot->attempted) {
+            first_fetches.push_back(snapshot->refresh_done);
+        }
+    }
+
+    for (const auto &done : first_fetches) {
+        wait_interruptible(done.get(), interruptor);
+    }
+
+    results_out->clear();
+    results_out->reserve(peers.size());
+    for (const peer_id_t &peer : peers) {
+        results_out->push_back(snapshots[peer].stats);
+    }
+
+    // Forget the servers that left the cluster, so that the map doesn't keep growing.
+    directory_view->apply_read(
+        [&](const change_tracking_map_t<peer_id_t, cluster_directory_metadata_t> *dir) {
+            for (auto it = snapshots.begin(); it != snapshots.end();) {
+                if (it->second.refresh_done.get() == nullptr
+                        && dir->get_inner().count(it->first) == 0) {
+                    snapshots.erase(it++);
+                } else {
+                    ++it;
+                }
+            }
+        });
+}
+
+void stats_snapshot_cache_t::refresh(const peer_id_t &peer,
+                                     auto_drainer_t::lock_t keepalive) {
+    get_stats_mailbox_address_t request_addr;
+    directory_view->apply_read(
+        [&](const change_tracking_map_t<peer_id_t, cluster_directory_metadata_t> *dir) {
+            auto const peer_it = dir->get_inner().find(peer);
+            if (peer_it != dir->get_inner().end()) {
+                request_addr = peer_it->second.get_stats_mailbox_address;
+            }
+        });
+
+    ql::datum_t stats;
+    bool success = false;
+    if (!request_addr.is_nil()) {
+        try {
+            admin_err_t dummy_error;
+            success = fetch_stats_from_server(mailbox_manager, request_addr,
+                stats_request_t::global_stats_filter(), keepalive.get_drain_signal(),
+                &stats, &dummy_error);
+        } catch (const interrupted_exc_t &) {
+            // We're shutting down; the waiters are gone, too.
+            return;
+        }
+    }
+
+    snapshot_t *snapshot = &snapshots[peer];
+    const int64_t now_nanos = get_ticks().nanos;
+    if (success) {
+        snapshot->stats = stats;
+        snapshot->fetched_nanos = now_nanos;
+    } else if (now_nanos - snapshot->fetched_nanos
+            >= static_cast<int64_t>(STATS_SNAPSHOT_MAX_AGE_MS) * MILLION) {
+        snapshot->stats = ql::datum_t();
+    }
+    snapshot->attempted = true;
+    std::shared_ptr<cond_t> done = std::move(snapshot->refresh_done);
+    snapshot->refresh_done.reset();
+    done->pulse();
+}
@@ -0,0 +1,66 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef CLUSTERING_ADMINISTRATION_STATS_SNAPSHOT_CACHE_HPP_
+#define CLUSTERING_ADMINISTRATION_STATS_SNAPSHOT_CACHE_HPP_
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "clustering/administration/metadata.hpp"
+#include "concurrency/auto_drainer.hpp"
+#include "concurrency/cond_var.hpp"
+#include "concurrency/watchable.hpp"
+
+/* How old a server's stats snapshot may get before reading the `stats` table fetches
+a new one in the background. */
+#define STATS_SNAPSHOT_REFRESH_MS 1000
+
+/* How long we keep showing a server's last snapshot if it doesn't answer our requests
+for new ones.  After that, the server shows up as unresponsive. */
+#define STATS_SNAPSHOT_MAX_AGE_MS 10000
+
+/* Keeps the last stats we got from each server, so that reading `rethinkdb.stats`
+doesn't wait for every server in the cluster to answer.  Snapshots that are older than
+`STATS_SNAPSHOT_REFRESH_MS` are refreshed in the background when somebody asks for them,
+so no matter how many clients poll the table, each server only collects its perfmons
+about once per refresh period. */
+class stats_snapshot_cache_t : public home_thread_mixin_t {
+public:
+    stats_snapshot_cache_t(
+        const clone_ptr_t<watchable_t<change_tracking_map_t<peer_id_t,
+            cluster_directory_metadata_t> > > &_directory_view,
+        mailbox_manager_t *_mailbox_manager);
+    ~stats_snapshot_cache_t();
+
+    /* Fills `results_out` with the last snapshot of each of `peers`, or an empty
+    `datum_t` for each server that isn't responding.  Only waits for servers that we
+    haven't asked for their stats yet. */
+    void get_snapshots(const std::vector<peer_id_t> &peers,
+                       std::vector<ql::datum_t> *results_out,
+                       signal_t *interruptor);
+
+private:
+    struct snapshot_t {
+        snapshot_t() : fetched_nanos(0), attempted(false) { }
+        ql::datum_t stats;
+        int64_t fetched_nanos;
+        // Whether a request for the server's stats has finished, successfully or not.
+        bool attempted;
+        // Pulsed when the request in progress finishes; empty if there is none.
+        std::shared_ptr<cond_t> refresh_done;
+    };
+
+    void refresh(const peer_id_t &peer, auto_drainer_t::lock_t keepalive);
+
+    clone_ptr_t<watchable_t<change_tracking_map_t<peer_id_t,
+        cluster_directory_metadata_t> > > directory_view;
+    mailbox_manager_t *mailbox_manager;
+
+    std::map<peer_id_t, snapshot_t> snapshots;
+
+    auto_drainer_t drainer;
+
+    DISABLE_COPYING(stats_snapshot_cache_t);
+};
+
+#endif /* CLUSTERING_ADMINISTRATION_STATS_SNAPSHOT_CACHE_HPP_ */
@@ -3,16 +3,65 @@
 
 #include <functional>
 
+#include "arch/runtime/coro_sampler.hpp"
 #include "clustering/administration/datum_adapter.hpp"
 #include "concurrency/watchable.hpp"
 #include "perfmon/collect.hpp"
 #include "perfmon/filter.hpp"
+#include "rdb_protocol/datum_allocations.hpp"
+#include "rdb_protocol/query_stats.hpp"
+#include "rdb_protocol/query_trace.hpp"
+#include "rdb_protocol/slow_query_log.hpp"
 #include "stl_utils.hpp"
+#include "time.hpp"
+
+static ql::datum_t coro_sampler_report_to_datum(const coro_sampler_t::report_t &report) {
+    ql::datum_array_builder_t execution_points(ql::configured_limits_t::unlimited);
+    for (const auto &point : report.execution_points) {
+        ql::datum_array_builder_t trace(ql::configured_limits_t::unlimited);
+        for (const std::string &frame : point.frames) {
+            trace.add(ql::datum_t(datum_string_t(frame)));
+        }
+        ql::datum_object_builder_t builder;
+        builder.overwrite("trace", std::move(trace).to_datum());
+        builder.overwrite("num_samples",
+                          ql::datum_t(static_cast<double>(point.num_samples)));
+        builder.overwrite("run_secs_total", ql::datum_t(point.run_secs_total));
+        builder.overwrite("run_secs_max", ql::datum_t(point.run_secs_max));
+        execution_points.add(std::move(builder).to_datum());
+    }
+
+    ql::datum_object_builder_t builder;
+    builder.overwrite("active_secs", ql::datum_t(report.active_secs));
+    builder.overwrite("sample_period",
+                      ql::datum_t(static_cast<double>(CORO_SAMPLER_PERIOD)));
+    builder.overwrite("num_samples",
+                      ql::datum_t(static_cast<double>(report.num_samples)));
+    builder.overwrite("num_samples_dropped",
+                      ql::datum_t(static_cast<double>(report.num_samples_dropped)));
+    builder.overwrite("execution_points", std::move(execution_points).to_datum());
+
+    const datum_allocation_counts_t allocations = get_datum_allocation_counts();
+    ql::datum_object_builder_t allocations_builder;
+    allocations_builder.overwrite("inline_strings",
+        ql::datum_t(static_cast<double>(allocations.inline_strings)));
+    allocations_builder.overwrite("heap_strings",
+        ql::datum_t(static_cast<double>(allocations.heap_strings)));
+    allocations_builder.overwrite("interned_strings",
+        ql::datum_t(static_cast<double>(allocations.interned_strings)));
+    allocations_builder.overwrite("arrays",
+        ql::datum_t(static_cast<double>(allocations.arrays)));
+    allocations_builder.overwrite("objects",
+        ql::datum_t(static_cast<double>(allocations.objects)));
+    builder.overwrite("datum_allocations", std::move(allocations_builder).to_datum());
+    return std::move(builder).to_datum();
+}
 
 stat_manager_t::stat_manager_t(mailbox_manager_t* mm,
                                server_id_t _own_server_id) :
     own_server_id(_own_server_id),
     mailbox_manager(mm),
+    last_perfmon_nanos(0),
     get_stats_mailbox(mailbox_manager,
                       std::bind(&stat_manager_t::on_stats_request,
                                 this, ph::_1, ph::_2, ph::_3))
@@ -26,12 +75,53 @@ void stat_manager_t::on_stats_request(
         UNUSED signal_t *interruptor,
         const return_address_t& reply_address,
         const std::set<std::vector<stat_id_t> >& requested_stats) {
-    perfmon_filter_t request(requested_stats);
-    ql::datum_t perfmon_result(perfmon_get_stats());
-    perfmon_result = request.filter(perfmon_result);
+    const std::vector<stat_id_t> coro_sampler_path{CORO_SAMPLER_STAT_NAME};
+    const bool wants_coro_sampler = requested_stats.count(coro_sampler_path) == 1;
+    const std::vector<stat_id_t> query_stats_path{QUERY_STATS_STAT_NAME};
+    const bool wants_query_stats = requested_stats.count(query_stats_path) == 1;
+    const std::vector<stat_id_t> slow_queries_path{SLOW_QUERIES_STAT_NAME};
+    const bool wants_slow_queries = requested_stats.count(slow_queries_path) == 1;
+    const std::vector<stat_id_t> query_traces_path{QUERY_TRACES_STAT_NAME};
+    const bool wants_query_traces = requested_stats.count(query_traces_path) == 1;
+
+    // Gathering the perfmons isn't free, so we skip it if only the sampler, the query
+    // stats, the slow queries or the query traces are wanted.
+    const size_t num_special_stats = (wants_coro_sampler ? 1 : 0)
+        + (wants_query_stats ? 1 : 0) + (wants_slow_queries ? 1 : 0)
+        + (wants_query_traces ? 1 : 0);
+    ql::datum_t perfmon_result;
+    if (num_special_stats > 0 && requested_stats.size() == num_special_stats) {
+        perfmon_result = ql::datum_t::empty_object();
+    } else {
+        const int64_t now_nanos = get_ticks().nanos;
+        if (last_perfmon_result.has() && requested_stats == last_perfmon_filter
+                && now_nanos - last_perfmon_nanos
+                    < static_cast<int64_t>(STAT_MANAGER_REUSE_MS) * MILLION) {
+            perfmon_result = last_perfmon_result;
+        } else {
+            perfmon_filter_t request(requested_stats);
+            perfmon_result = request.filter(perfmon_get_stats());
+            last_perfmon_filter = requested_stats;
+            last_perfmon_result = perfmon_result;
+            last_perfmon_nanos = now_nanos;
+        }
+    }
 
     // Add in our own server id so the other side does not need to perform lookups
     ql::datum_object_builder_t stats(perfmon_result);
+    if (wants_coro_sampler) {
+        stats.overwrite(CORO_SAMPLER_STAT_NAME,
+                        coro_sampler_report_to_datum(coro_sampler_t::get_report()));
+    }
+    if (wants_query_stats) {
+        stats.overwrite(QUERY_STATS_STAT_NAME, ql::get_query_stats_report());
+    }
+    if (wants_slow_queries) {
+        stats.overwrite(SLOW_QUERIES_STAT_NAME, ql::slow_query_log_t::get_report());
+    }
+    if (wants_query_traces) {
+        stats.overwrite(QUERY_TRACES_STAT_NAME, ql::query_trace_log_t::get_report());
+    }
     stats.overwrite("server_id", convert_uuid_to_datum(own_server_id.get_uuid()));
     send(mailbox_manager, reply_address, std::move(stats).to_datum());
 }
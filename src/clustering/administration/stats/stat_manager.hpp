@@ -11,6 +11,27 @@
 
 struct admin_err_t;
 
+/* Requesting this stat turns on the `coro_sampler_t` and returns its report.  It
+isn't a perfmon, so that the sampler only runs while somebody is reading it. */
+#define CORO_SAMPLER_STAT_NAME "coro_sampler"
+
+/* Requesting this stat returns `ql::get_query_stats_report()`, which the
+`rethinkdb._query_stats` table merges across servers. */
+#define QUERY_STATS_STAT_NAME "query_stats"
+
+/* Requesting this stat returns `ql::slow_query_log_t::get_report()`, which the
+`rethinkdb._slow_queries` table collects from all servers. */
+#define SLOW_QUERIES_STAT_NAME "slow_queries"
+
+/* Requesting this stat returns `ql::query_trace_log_t::get_report()`, which the
+`rethinkdb._query_traces` table collects from all servers. */
+#define QUERY_TRACES_STAT_NAME "query_traces"
+
+/* Requests for the same perfmons that come in within this long of each other get the
+same answer, so that many servers reading our stats at once don't each make us collect
+all the perfmons. */
+#define STAT_MANAGER_REUSE_MS 500
+
 class stat_manager_t {
 public:
     typedef std::string stat_id_t;
@@ -31,6 +52,12 @@ private:
 
     server_id_t own_server_id;
     mailbox_manager_t *mailbox_manager;
+
+    // The last perfmons we collected, for `STAT_MANAGER_REUSE_MS`.
+    std::set<std::vector<stat_id_t> > last_perfmon_filter;
+    ql::datum_t last_perfmon_result;
+    int64_t last_perfmon_nanos;
+
     get_stats_mailbox_t get_stats_mailbox;
 
     DISABLE_COPYING(stat_manager_t);
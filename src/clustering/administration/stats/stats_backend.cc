@@ -15,7 +15,7 @@ stats_artificial_table_backend_t::stats_artificial_table_backend_t(
             _cluster_sl_view,
         server_config_client_t *_server_config_client,
         table_meta_client_t *_table_meta_client,
-        mailbox_manager_t *_mailbox_manager,
+        stats_snapshot_cache_t *_snapshot_cache,
         admin_identifier_format_t _admin_format) :
     timer_cfeed_artificial_table_backend_t(
         name_string_t::guarantee_valid("stats"), rdb_context, name_resolver),
@@ -23,7 +23,7 @@ stats_artificial_table_backend_t::stats_artificial_table_backend_t(
     cluster_sl_view(_cluster_sl_view),
     server_config_client(_server_config_client),
     table_meta_client(_table_meta_client),
-    mailbox_manager(_mailbox_manager),
+    snapshot_cache(_snapshot_cache),
     admin_format(_admin_format) { }
 
 stats_artificial_table_backend_t::~stats_artificial_table_backend_t() {
@@ -34,53 +34,6 @@ std::string stats_artificial_table_backend_t::get_primary_key_name() {
     return std::string("id");
 }
 
-// Since this is called through pmap, it will not throw an `interrupted_exc_t`. Instead,
-// the behavior is undefined if `interruptor` is pulsed.
-void stats_artificial_table_backend_t::get_peer_stats(
-        const peer_id_t &peer,
-        const std::set<std::vector<std::string> > &filter,
-        ql::datum_t *result_out,
-        signal_t *interruptor_on_home) {
-    // Loop up peer in directory - find get stats mailbox
-    get_stats_mailbox_address_t request_addr;
-    directory_view->apply_read(
-        [&](const change_tracking_map_t<peer_id_t, cluster_directory_metadata_t> *dir) {
-            auto const peer_it = dir->get_inner().find(peer);
-            if (peer_it != dir->get_inner().end()) {
-                request_addr = peer_it->second.get_stats_mailbox_address;
-            }
-        });
-
-    if (!request_addr.is_nil()) {
-        try {
-            admin_err_t dummy_error;
-            if (!fetch_stats_from_server(mailbox_manager, request_addr, filter,
-                    interruptor_on_home, result_out, &dummy_error)) {
-                /* Signal an error with an empty `datum_t` */
-                *result_out = ql::datum_t();
-            }
-        } catch (const interrupted_exc_t &) {
-            /* It doesn't matter what we return */
-        }
-    }
-}
-
-void stats_artificial_table_backend_t::perform_stats_request(
-        const std::vector<peer_id_t> &peers,
-        const std::set<std::vector<std::string> > &filter,
-        std::vector<ql::datum_t> *results_out,
-        signal_t *interruptor_on_home) {
-    results_out->resize(peers.size());
-    pmap(peers.size(),
-        [&](int64_t index) {
-            get_peer_stats(peers[index], filter, &results_out->at(index),
-                interruptor_on_home);
-        });
-    if (interruptor_on_home->is_pulsed()) {
-        throw interrupted_exc_t();
-    }
-}
-
 // A row is excluded if it fails to convert to a datum - which should only
 // happen if the entity was deleted from the metadata
 void maybe_append_result(const stats_request_t &request,
@@ -108,12 +61,11 @@ bool stats_artificial_table_backend_t::read_all_rows_as_vector(
 
     cluster_semilattice_metadata_t metadata = cluster_sl_view->get();
 
-    std::set<std::vector<std::string> > filter = stats_request_t::global_stats_filter();
     std::vector<peer_id_t> peers =
         stats_request_t::all_peers(directory_view->get().get_inner());
 
     std::vector<ql::datum_t> results;
-    perform_stats_request(peers, filter, &results, &interruptor_on_home);
+    snapshot_cache->get_snapshots(peers, &results, &interruptor_on_home);
     parsed_stats_t parsed_stats(results);
 
     // Start building results
@@ -190,8 +142,7 @@ bool stats_artificial_table_backend_t::read_row(
     std::vector<peer_id_t> peers = request->get_peers(
         directory_view->get().get_inner(), server_config_client);
     std::vector<ql::datum_t> results_map;
-    perform_stats_request(
-        peers, request->get_filter(), &results_map, &interruptor_on_home);
+    snapshot_cache->get_snapshots(peers, &results_map, &interruptor_on_home);
     parsed_stats_t parsed_stats(results_map);
     if (!request->to_datum(parsed_stats, cluster_sl_view->get(), server_config_client,
             table_meta_client, admin_format, row_out)) {
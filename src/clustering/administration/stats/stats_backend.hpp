@@ -9,6 +9,7 @@
 #include "rdb_protocol/artificial_table/caching_cfeed_backend.hpp"
 #include "clustering/administration/metadata.hpp"
 #include "clustering/administration/servers/config_client.hpp"
+#include "clustering/administration/stats/snapshot_cache.hpp"
 #include "concurrency/watchable.hpp"
 
 class stats_artificial_table_backend_t :
@@ -25,7 +26,7 @@ public:
             _cluster_sl_view,
         server_config_client_t *_server_config_client,
         table_meta_client_t *_table_meta_client,
-        mailbox_manager_t *_mailbox_manager,
+        stats_snapshot_cache_t *_snapshot_cache,
         admin_identifier_format_t _admin_format);
     ~stats_artificial_table_backend_t();
 
@@ -53,23 +54,13 @@ public:
             admin_err_t *error_out);
 
 private:
-    void get_peer_stats(const peer_id_t &peer,
-                        const std::set<std::vector<std::string> > &filter,
-                        ql::datum_t *result_out,
-                        signal_t *interruptor_on_home);
-
-    void perform_stats_request(const std::vector<peer_id_t> &peers,
-                               const std::set<std::vector<std::string> > &filter,
-                               std::vector<ql::datum_t> *results_out,
-                               signal_t *interruptor_on_home);
-
     clone_ptr_t<watchable_t<change_tracking_map_t<peer_id_t,
         cluster_directory_metadata_t> > > directory_view;
     std::shared_ptr<semilattice_read_view_t<cluster_semilattice_metadata_t> >
         cluster_sl_view;
     server_config_client_t *server_config_client;
     table_meta_client_t *table_meta_client;
-    mailbox_manager_t *mailbox_manager;
+    stats_snapshot_cache_t *snapshot_cache;
     admin_identifier_format_t admin_format;
 };
 
@@ -1,6 +1,9 @@
 // Copyright 2010-2014 RethinkDB, all rights reserved.
 #include "clustering/administration/tables/generate_config.hpp"
 
+#include <deque>
+#include <limits>
+
 #include "clustering/administration/servers/config_client.hpp"
 #include "clustering/table_manager/table_meta_client.hpp"
 #include "containers/counted.hpp"
@@ -243,15 +246,243 @@ void pick_best_pairings(
     }
 }
 
+/* `estimate_docs_per_old_shard()` estimates how many of the documents in each shard of
+the new shard scheme are currently in each shard of the old one. The entry for a pair of
+shards that don't overlap is -1. Each entry of `distribution` counts the documents from
+its key up to the next key, and they're all counted where that key is. If there's no
+distribution, the entries for overlapping shards are all 0. */
+static std::vector<std::vector<int64_t> > estimate_docs_per_old_shard(
+        const table_shard_scheme_t &new_scheme,
+        const table_shard_scheme_t &old_scheme,
+        const std::map<store_key_t, int64_t> *distribution) {
+    std::vector<std::vector<int64_t> > docs(
+        new_scheme.num_shards(), std::vector<int64_t>(old_scheme.num_shards(), -1));
+    for (size_t i = 0; i < new_scheme.num_shards(); ++i) {
+        for (size_t j = 0; j < old_scheme.num_shards(); ++j) {
+            if (new_scheme.get_shard_range(i).overlaps(old_scheme.get_shard_range(j))) {
+                docs[i][j] = 0;
+            }
+        }
+    }
+    if (distribution != nullptr) {
+        for (const auto &pair : *distribution) {
+            int64_t *entry = &docs[new_scheme.find_shard_for_key(pair.first)]
+                [old_scheme.find_shard_for_key(pair.first)];
+            guarantee(*entry >= 0);
+            *entry += pair.second;
+        }
+    }
+    return docs;
+}
+
+/* `min_cost_assignment()` assigns `demands[i]` different servers to each shard `i`, and
+at most `capacities[j]` shards to each server `j`, so that the sum of `costs[i][j]` over
+the assigned pairs is as small as possible. Pairs with a negative cost can't be assigned.
+It returns `false` if the demands can't all be met. Otherwise `assignment_out` lists the
+servers of each shard.
+
+This is a minimum-cost flow from a source through the shards and the servers to a sink,
+found by successive shortest paths. The paths are found with Bellman-Ford, because the
+reverse edges in the residual graph have negative costs. */
+static bool min_cost_assignment(
+        const std::vector<size_t> &demands,
+        const std::vector<size_t> &capacities,
+        const std::vector<std::vector<int64_t> > &costs,
+        long_calculation_yielder_t *yielder,
+        signal_t *interruptor,
+        std::vector<std::vector<size_t> > *assignment_out) {
+    struct edge_t {
+        size_t to;
+        size_t reverse;
+        int64_t capacity;
+        int64_t cost;
+    };
+    const size_t num_shards = demands.size();
+    const size_t num_servers = capacities.size();
+    const size_t first_server = 1 + num_shards;
+    const size_t source = 0;
+    const size_t sink = first_server + num_servers;
+    std::vector<std::vector<edge_t> > graph(sink + 1);
+    auto add_edge = [&](size_t from, size_t to, int64_t capacity, int64_t cost) {
+        graph[from].push_back(edge_t{to, graph[to].size(), capacity, cost});
+        graph[to].push_back(edge_t{from, graph[from].size() - 1, 0, -cost});
+    };
+    int64_t total_demand = 0;
+    for (size_t i = 0; i < num_shards; ++i) {
+        add_edge(source, 1 + i, demands[i], 0);
+        total_demand += demands[i];
+        for (size_t j = 0; j < num_servers; ++j) {
+            if (costs[i][j] >= 0) {
+                add_edge(1 + i, first_server + j, 1, costs[i][j]);
+            }
+        }
+    }
+    for (size_t j = 0; j < num_servers; ++j) {
+        add_edge(first_server + j, sink, capacities[j], 0);
+    }
+
+    const int64_t unreachable_distance = std::numeric_limits<int64_t>::max();
+    for (int64_t flow = 0; flow < total_demand;) {
+        std::vector<int64_t> distance(graph.size(), unreachable_distance);
+        std::vector<std::pair<size_t, size_t> > parent_edge(graph.size());
+        std::vector<bool> in_queue(graph.size(), false);
+        std::deque<size_t> queue;
+        distance[source] = 0;
+        queue.push_back(source);
+        in_queue[source] = true;
+        while (!queue.empty()) {
+            size_t node = queue.front();
+            queue.pop_front();
+            in_queue[node] = false;
+            for (size_t e = 0; e < graph[node].size(); ++e) {
+                const edge_t &edge = graph[node][e];
+                if (edge.capacity > 0
+                        && distance[node] + edge.cost < distance[edge.to]) {
+                    distance[edge.to] = distance[node] + edge.cost;
+                    parent_edge[edge.to] = std::make_pair(node, e);
+                    if (!in_queue[edge.to]) {
+                        in_queue[edge.to] = true;
+                        queue.push_back(edge.to);
+                    }
+                }
+            }
+            yielder->maybe_yield(interruptor);
+        }
+        if (distance[sink] == unreachable_distance) {
+            return false;
+        }
+        int64_t amount = total_demand - flow;
+        for (size_t node = sink; node != source; node = parent_edge[node].first) {
+            const std::pair<size_t, size_t> &p = parent_edge[node];
+            amount = std::min(amount, graph[p.first][p.second].capacity);
+        }
+        for (size_t node = sink; node != source; node = parent_edge[node].first) {
+            edge_t *edge = &graph[parent_edge[node].first][parent_edge[node].second];
+            edge->capacity -= amount;
+            graph[edge->to][edge->reverse].capacity += amount;
+        }
+        flow += amount;
+    }
+
+    assignment_out->assign(num_shards, std::vector<size_t>());
+    for (size_t i = 0; i < num_shards; ++i) {
+        for (const edge_t &edge : graph[1 + i]) {
+            /* The edges to servers had a capacity of one, so they're used if they have
+            none left. */
+            if (edge.to >= first_server && edge.capacity == 0) {
+                (*assignment_out)[i].push_back(edge.to - first_server);
+            }
+        }
+    }
+    return true;
+}
+
+/* `pick_best_pairings()` balances the replicas across the servers, but it picks them one
+at a time, so it can move more data than it has to. `minimize_backfill()` keeps the
+number of replicas and primary replicas that it put on each of `servers`, but solves
+again for which shards they're for, as a minimum-cost assignment in which each replica
+costs the documents that its server doesn't have yet. Then it picks the primary replicas
+among the new replicas in the same way, preferring the servers that are primary for the
+data now. If the primary replicas can't keep their numbers per server with the new
+replicas, it leaves the choices of `pick_best_pairings()` alone. */
+static void minimize_backfill(
+        const std::set<server_id_t> &servers,
+        bool is_primary_tag,
+        bool is_nonvoting_tag,
+        const table_config_t &old_config,
+        const std::vector<std::vector<int64_t> > &docs_per_old_shard,
+        long_calculation_yielder_t *yielder,
+        signal_t *interruptor,
+        std::vector<table_config_t::shard_t> *shards) {
+    const std::vector<server_id_t> server_list(servers.begin(), servers.end());
+    std::vector<size_t> demands(shards->size(), 0);
+    std::vector<size_t> capacities(server_list.size(), 0);
+    std::vector<size_t> primary_capacities(server_list.size(), 0);
+    std::vector<std::vector<int64_t> > costs(
+        shards->size(), std::vector<int64_t>(server_list.size(), 0));
+    std::vector<std::vector<int64_t> > primary_costs = costs;
+    for (size_t i = 0; i < shards->size(); ++i) {
+        for (size_t j = 0; j < server_list.size(); ++j) {
+            const server_id_t &server = server_list[j];
+            if ((*shards)[i].all_replicas.count(server) == 1) {
+                ++demands[i];
+                ++capacities[j];
+            }
+            if (is_primary_tag && (*shards)[i].primary_replica == server) {
+                ++primary_capacities[j];
+            }
+            for (size_t k = 0; k < old_config.shards.size(); ++k) {
+                if (docs_per_old_shard[i][k] < 0) {
+                    continue;
+                }
+                /* Every old shard that the server is missing costs something, even if
+                the distribution says it's empty. */
+                const int64_t weight = docs_per_old_shard[i][k] + 1;
+                if (old_config.shards[k].all_replicas.count(server) == 0) {
+                    costs[i][j] += weight;
+                }
+                if (old_config.shards[k].primary_replica != server) {
+                    primary_costs[i][j] += weight;
+                }
+            }
+        }
+        yielder->maybe_yield(interruptor);
+    }
+
+    std::vector<std::vector<size_t> > replicas;
+    if (!min_cost_assignment(
+            demands, capacities, costs, yielder, interruptor, &replicas)) {
+        /* `pick_best_pairings()` found an assignment with these numbers, so this can't
+        happen. */
+        unreachable();
+    }
+
+    std::vector<std::vector<size_t> > primaries;
+    if (is_primary_tag) {
+        for (size_t i = 0; i < shards->size(); ++i) {
+            std::vector<int64_t> replica_primary_costs(server_list.size(), -1);
+            for (size_t j : replicas[i]) {
+                replica_primary_costs[j] = primary_costs[i][j];
+            }
+            primary_costs[i] = std::move(replica_primary_costs);
+        }
+        if (!min_cost_assignment(
+                std::vector<size_t>(shards->size(), 1), primary_capacities,
+                primary_costs, yielder, interruptor, &primaries)) {
+            return;
+        }
+    }
+
+    for (size_t i = 0; i < shards->size(); ++i) {
+        table_config_t::shard_t *shard = &(*shards)[i];
+        for (const server_id_t &server : server_list) {
+            shard->all_replicas.erase(server);
+            shard->nonvoting_replicas.erase(server);
+        }
+        for (size_t j : replicas[i]) {
+            shard->all_replicas.insert(server_list[j]);
+            if (is_nonvoting_tag) {
+                shard->nonvoting_replicas.insert(server_list[j]);
+            }
+        }
+        if (is_primary_tag) {
+            guarantee(primaries[i].size() == 1);
+            shard->primary_replica = server_list[primaries[i][0]];
+        }
+    }
+}
+
 void table_generate_config(
         server_config_client_t *server_config_client,
         namespace_id_t table_id,
         table_meta_client_t *table_meta_client,
         const table_generate_config_params_t &params,
         const table_shard_scheme_t &shard_scheme,
+        const std::map<store_key_t, int64_t> *distribution,
         signal_t *interruptor,
         std::vector<table_config_t::shard_t> *config_shards_out,
-        server_name_map_t *server_names_out)
+        server_name_map_t *server_names_out,
+        int64_t *docs_to_copy_out)
         THROWS_ONLY(interrupted_exc_t, no_such_table_exc_t, failed_table_op_exc_t,
             admin_op_exc_t) {
     long_calculation_yielder_t yielder;
@@ -301,6 +532,14 @@ void table_generate_config(
         old_config = &it->second;
     }
 
+    /* Estimate where the table's data is now, so we can move as little of it as
+    possible */
+    std::vector<std::vector<int64_t> > docs_per_old_shard;
+    if (old_config != nullptr) {
+        docs_per_old_shard = estimate_docs_per_old_shard(
+            shard_scheme, old_config->shard_scheme, distribution);
+    }
+
     /* Calculate the current load on each server */
     std::map<server_id_t, int> server_usage;
     for (const auto &pair : old_table_configs) {
@@ -433,6 +672,18 @@ void table_generate_config(
                     (*config_shards_out)[shard].nonvoting_replicas.insert(server);
                 }
             });
+
+        if (old_config != nullptr) {
+            minimize_backfill(
+                servers_with_tags.at(server_tag),
+                server_tag == params.primary_replica_tag,
+                params.nonvoting_replica_tags.count(server_tag) == 1,
+                old_config->config,
+                docs_per_old_shard,
+                &yielder,
+                interruptor,
+                config_shards_out);
+        }
     }
 
     for (size_t shard_ix = 0; shard_ix < params.num_shards; ++shard_ix) {
@@ -443,5 +694,23 @@ void table_generate_config(
             server_names_out->names[replica] = server_names.names.at(replica);
         }
     }
+
+    if (docs_to_copy_out != nullptr) {
+        guarantee(distribution != nullptr);
+        guarantee(old_config != nullptr);
+        *docs_to_copy_out = 0;
+        for (size_t shard_ix = 0; shard_ix < params.num_shards; ++shard_ix) {
+            const table_config_t::shard_t &shard = (*config_shards_out)[shard_ix];
+            for (const server_id_t &replica : shard.all_replicas) {
+                for (size_t k = 0; k < old_config->config.shards.size(); ++k) {
+                    const int64_t docs = docs_per_old_shard[shard_ix][k];
+                    if (docs > 0 && old_config->config.shards[k].all_replicas.count(
+                            replica) == 0) {
+                        *docs_to_copy_out += docs;
+                    }
+                }
+            }
+        }
+    }
 }
 
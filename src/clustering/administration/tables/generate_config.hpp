@@ -32,11 +32,19 @@ void table_generate_config(
         /* What the new sharding scheme for the table will be. If `table_id` is
         `nil_uuid()` this is unused. */
         const table_shard_scheme_t &shard_scheme,
+        /* The result of `fetch_distribution()` for the table, if it could be read. It's
+        used to estimate how much data each server would have to copy, so that the new
+        config moves as little of it as possible. This can be `nullptr`. */
+        const std::map<store_key_t, int64_t> *distribution,
 
         signal_t *interruptor,
 
         std::vector<table_config_t::shard_t> *config_shards_out,
-        server_name_map_t *server_names_out)
+        server_name_map_t *server_names_out,
+        /* If this isn't `nullptr`, it's set to the estimated number of documents that
+        servers will have to copy to reach the new config. It requires `distribution`
+        and a `table_id`. */
+        int64_t *docs_to_copy_out)
 
         THROWS_ONLY(interrupted_exc_t, no_such_table_exc_t, failed_table_op_exc_t,
             admin_op_exc_t);
@@ -223,11 +223,23 @@ void calculate_split_points_intelligently(
         signal_t *interruptor,
         table_shard_scheme_t *split_points_out)
         THROWS_ONLY(interrupted_exc_t, failed_table_op_exc_t, no_such_table_exc_t) {
+    std::map<store_key_t, int64_t> counts;
     if (num_shards > old_split_points.num_shards()) {
-        std::map<store_key_t, int64_t> counts;
         fetch_distribution(table_id, reql_cluster_interface, interruptor, &counts);
+    }
+    calculate_split_points_intelligently(
+        num_shards, old_split_points, &counts, split_points_out);
+}
+
+void calculate_split_points_intelligently(
+        size_t num_shards,
+        const table_shard_scheme_t &old_split_points,
+        const std::map<store_key_t, int64_t> *counts,
+        table_shard_scheme_t *split_points_out) {
+    if (num_shards > old_split_points.num_shards()) {
+        guarantee(counts != nullptr);
         if (!calculate_split_points_with_distribution(
-                counts, num_shards, split_points_out)) {
+                *counts, num_shards, split_points_out)) {
             /* There aren't enough documents to calculate distribution. We'll just assume
             the user is going to use UUID primary keys. If we got it wrong, they will end
             up with horribly unbalanced data, but it's the best we can do. */
@@ -240,4 +252,3 @@ void calculate_split_points_intelligently(
             num_shards, old_split_points, split_points_out);
     }
 }
-
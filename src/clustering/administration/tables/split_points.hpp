@@ -59,5 +59,13 @@ void calculate_split_points_intelligently(
         table_shard_scheme_t *split_points_out)
         THROWS_ONLY(interrupted_exc_t, failed_table_op_exc_t, no_such_table_exc_t);
 
+/* The same, for a caller that has already fetched the distribution. `counts` may be
+null unless the number of shards is being increased. */
+void calculate_split_points_intelligently(
+        size_t num_shards,
+        const table_shard_scheme_t &old_split_points,
+        const std::map<store_key_t, int64_t> *counts,
+        table_shard_scheme_t *split_points_out);
+
 #endif /* CLUSTERING_ADMINISTRATION_TABLES_SPLIT_POINTS_HPP_ */
 
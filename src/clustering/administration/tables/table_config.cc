@@ -227,6 +227,34 @@ bool convert_durability_from_datum(
     return true;
 }
 
+ql::datum_t convert_compression_to_datum(block_compression_t compression) {
+    switch (compression) {
+        case block_compression_t::none:
+            return ql::datum_t("none");
+        case block_compression_t::zlib:
+            return ql::datum_t("zlib");
+        default:
+            unreachable();
+    }
+}
+
+bool convert_compression_from_datum(
+        const ql::datum_t &datum,
+        block_compression_t *compression_out,
+        admin_err_t *error_out) {
+    if (datum == ql::datum_t("none")) {
+        *compression_out = block_compression_t::none;
+    } else if (datum == ql::datum_t("zlib")) {
+        *compression_out = block_compression_t::zlib;
+    } else {
+        *error_out = admin_err_t{
+            "Expected \"none\" or \"zlib\", got: " + datum.print(),
+            query_state_t::FAILED};
+        return false;
+    }
+    return true;
+}
+
 struct convert_flush_interval_visitor_t : public boost::static_visitor<ql::datum_t> {
     ql::datum_t operator()(flush_interval_default_t) const {
         return ql::datum_t("default");
@@ -432,6 +460,165 @@ bool convert_sindexes_from_datum(
     return true;
 }
 
+bool convert_block_size_from_datum(
+        const ql::datum_t &datum,
+        uint32_t *block_size_out,
+        admin_err_t *error_out) {
+    if (datum.get_type() != ql::datum_t::R_NUM) {
+        *error_out = admin_err_t{
+            "Expected a number; got " + datum.print(), query_state_t::FAILED};
+        return false;
+    }
+    double val = datum.as_num();
+    bool is_power_of_two = false;
+    for (uint32_t size = MIN_BTREE_BLOCK_SIZE; size <= MAX_BTREE_BLOCK_SIZE;
+            size *= 2) {
+        is_power_of_two |= (val == size);
+    }
+    if (!is_power_of_two) {
+        *error_out = admin_err_t{
+            strprintf("Expected a power of two between %d and %d; got %s",
+                      static_cast<int>(MIN_BTREE_BLOCK_SIZE),
+                      static_cast<int>(MAX_BTREE_BLOCK_SIZE),
+                      datum.print().c_str()),
+            query_state_t::FAILED};
+        return false;
+    }
+    *block_size_out = static_cast<uint32_t>(val);
+    return true;
+}
+
+ql::datum_t convert_expiry_to_datum(const table_expiry_config_t &expiry) {
+    if (!expiry.is_enabled()) {
+        return ql::datum_t::null();
+    }
+    ql::datum_object_builder_t builder;
+    builder.overwrite("field", convert_string_to_datum(expiry.field));
+    builder.overwrite("seconds", ql::datum_t(expiry.seconds));
+    return std::move(builder).to_datum();
+}
+
+bool convert_expiry_from_datum(
+        const ql::datum_t &datum,
+        table_expiry_config_t *expiry_out,
+        admin_err_t *error_out) {
+    if (datum.get_type() == ql::datum_t::R_NULL) {
+        *expiry_out = default_table_expiry_config();
+        return true;
+    }
+
+    converter_from_datum_object_t converter;
+    if (!converter.init(datum, error_out)) {
+        return false;
+    }
+
+    ql::datum_t field_datum;
+    if (!converter.get("field", &field_datum, error_out)) {
+        return false;
+    }
+    if (!convert_string_from_datum(field_datum, &expiry_out->field, error_out)) {
+        error_out->msg = "In `field`: " + error_out->msg;
+        return false;
+    }
+    if (expiry_out->field.empty()) {
+        *error_out = admin_err_t{
+            "In `field`: Expected a non-empty string.", query_state_t::FAILED};
+        return false;
+    }
+
+    ql::datum_t seconds_datum;
+    if (!converter.get("seconds", &seconds_datum, error_out)) {
+        return false;
+    }
+    if (seconds_datum.get_type() != ql::datum_t::R_NUM ||
+            std::signbit(seconds_datum.as_num())) {
+        *error_out = admin_err_t{
+            "In `seconds`: Expected a non-negative number; got " +
+                seconds_datum.print(),
+            query_state_t::FAILED};
+        return false;
+    }
+    expiry_out->seconds = seconds_datum.as_num();
+
+    return converter.check_no_extra_keys(error_out);
+}
+
+ql::datum_t convert_cache_config_to_datum(const table_cache_config_t &cache) {
+    ql::datum_object_builder_t builder;
+    builder.overwrite("min_mb", ql::datum_t(cache.min_mb));
+    builder.overwrite("max_mb", cache.max_mb.has_value()
+        ? ql::datum_t(*cache.max_mb)
+        : ql::datum_t::null());
+    builder.overwrite("priority", ql::datum_t(cache.priority));
+    return std::move(builder).to_datum();
+}
+
+/* Keys that are missing keep their default values, so that `{priority: 2}` is enough to
+raise a table's priority. */
+bool convert_cache_config_from_datum(
+        const ql::datum_t &datum,
+        table_cache_config_t *cache_out,
+        admin_err_t *error_out) {
+    *cache_out = default_table_cache_config();
+
+    converter_from_datum_object_t converter;
+    if (!converter.init(datum, error_out)) {
+        return false;
+    }
+
+    if (converter.has("min_mb")) {
+        ql::datum_t min_mb_datum;
+        if (!converter.get("min_mb", &min_mb_datum, error_out)) {
+            return false;
+        }
+        if (min_mb_datum.get_type() != ql::datum_t::R_NUM ||
+                std::signbit(min_mb_datum.as_num())) {
+            *error_out = admin_err_t{
+                "In `min_mb`: Expected a non-negative number; got " +
+                    min_mb_datum.print(),
+                query_state_t::FAILED};
+            return false;
+        }
+        cache_out->min_mb = min_mb_datum.as_num();
+    }
+
+    if (converter.has("max_mb")) {
+        ql::datum_t max_mb_datum;
+        if (!converter.get("max_mb", &max_mb_datum, error_out)) {
+            return false;
+        }
+        if (max_mb_datum.get_type() != ql::datum_t::R_NULL) {
+            if (max_mb_datum.get_type() != ql::datum_t::R_NUM ||
+                    max_mb_datum.as_num() < cache_out->min_mb) {
+                *error_out = admin_err_t{
+                    "In `max_mb`: Expected `null` or a number no less than `min_mb`; "
+                    "got " + max_mb_datum.print(),
+                    query_state_t::FAILED};
+                return false;
+            }
+            cache_out->max_mb.set(max_mb_datum.as_num());
+        }
+    }
+
+    if (converter.has("priority")) {
+        ql::datum_t priority_datum;
+        if (!converter.get("priority", &priority_datum, error_out)) {
+            return false;
+        }
+        if (priority_datum.get_type() != ql::datum_t::R_NUM ||
+                !(priority_datum.as_num() > 0)) {
+            *error_out = admin_err_t{
+                "In `priority`: Expected a positive number; got " +
+                    priority_datum.print(),
+                query_state_t::FAILED};
+            return false;
+        }
+        cache_out->priority = priority_datum.as_num();
+    }
+
+    return converter.check_no_extra_keys(error_out);
+}
+
 /* This is separate from `format_row()` because it needs to be publicly exposed so it
    can be used to create the return value of `table.reconfigure()`. */
 ql::datum_t convert_table_config_to_datum(
@@ -461,6 +648,12 @@ ql::datum_t convert_table_config_to_datum(
     builder.overwrite("flush_interval",
         convert_flush_interval_to_datum(config.flush_interval));
     builder.overwrite("data", config.user_data.datum);
+    builder.overwrite("block_size",
+        ql::datum_t(static_cast<double>(config.storage.block_size)));
+    builder.overwrite("compression",
+        convert_compression_to_datum(config.storage.compression));
+    builder.overwrite("expiry", convert_expiry_to_datum(config.expiry));
+    builder.overwrite("cache", convert_cache_config_to_datum(config.cache));
     return std::move(builder).to_datum();
 }
 
@@ -531,7 +724,8 @@ bool convert_table_config_and_name_from_datum(
     }
 
     /* As a special case, we allow the user to omit `indexes`, `primary_key`, `shards`,
-    `write_acks`, `durability`, and/or `data` for newly-created tables. */
+    `write_acks`, `durability`, `data`, `block_size`, and/or `compression` for
+    newly-created tables. */
 
     if (converter.has("indexes")) {
         ql::datum_t indexes_datum;
@@ -610,7 +804,7 @@ bool convert_table_config_and_name_from_datum(
             table_generate_config(
                 server_config_client, nil_uuid(), table_meta_client,
                 table_generate_config_params_t::make_default(), table_shard_scheme_t(),
-                interruptor, &config_out->shards, server_names_out);
+                nullptr, interruptor, &config_out->shards, server_names_out, nullptr);
         } catch (const admin_op_exc_t &msg) {
             throw admin_op_exc_t(
                 "Unable to automatically generate configuration for "
@@ -703,6 +897,61 @@ bool convert_table_config_and_name_from_datum(
         config_out->user_data = default_user_data();
     }
 
+    if (existed_before || converter.has("block_size")) {
+        ql::datum_t block_size_datum;
+        if (!converter.get("block_size", &block_size_datum, error_out)) {
+            return false;
+        }
+        if (!convert_block_size_from_datum(block_size_datum,
+                &config_out->storage.block_size, error_out)) {
+            error_out->msg = "In `block_size`: " + error_out->msg;
+            return false;
+        }
+    } else {
+        config_out->storage.block_size = DEFAULT_BTREE_BLOCK_SIZE;
+    }
+
+    if (existed_before || converter.has("compression")) {
+        ql::datum_t compression_datum;
+        if (!converter.get("compression", &compression_datum, error_out)) {
+            return false;
+        }
+        if (!convert_compression_from_datum(compression_datum,
+                &config_out->storage.compression, error_out)) {
+            error_out->msg = "In `compression`: " + error_out->msg;
+            return false;
+        }
+    } else {
+        config_out->storage.compression = block_compression_t::none;
+    }
+
+    if (existed_before || converter.has("expiry")) {
+        ql::datum_t expiry_datum;
+        if (!converter.get("expiry", &expiry_datum, error_out)) {
+            return false;
+        }
+        if (!convert_expiry_from_datum(expiry_datum, &config_out->expiry, error_out)) {
+            error_out->msg = "In `expiry`: " + error_out->msg;
+            return false;
+        }
+    } else {
+        config_out->expiry = default_table_expiry_config();
+    }
+
+    if (existed_before || converter.has("cache")) {
+        ql::datum_t cache_datum;
+        if (!converter.get("cache", &cache_datum, error_out)) {
+            return false;
+        }
+        if (!convert_cache_config_from_datum(cache_datum, &config_out->cache,
+                                             error_out)) {
+            error_out->msg = "In `cache`: " + error_out->msg;
+            return false;
+        }
+    } else {
+        config_out->cache = default_table_cache_config();
+    }
+
     if (!converter.check_no_extra_keys(error_out)) {
         return false;
     }
@@ -729,6 +978,11 @@ void table_config_artificial_table_backend_t::do_modify(
                              query_state_t::FAILED);
     }
 
+    if (new_config.config.storage.block_size != old_config.config.storage.block_size) {
+        throw admin_op_exc_t("It's illegal to change a table's block size",
+                             query_state_t::FAILED);
+    }
+
     if (new_config.config.basic.database != old_config.config.basic.database ||
             new_config.config.basic.name != old_config.config.basic.name) {
         if (table_meta_client->exists(
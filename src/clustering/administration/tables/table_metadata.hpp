@@ -15,6 +15,7 @@
 #include "containers/optional.hpp"
 #include "containers/uuid.hpp"
 #include "rdb_protocol/protocol.hpp"
+#include "serializer/log/block_compression.hpp"
 #include "rpc/semilattice/joins/macros.hpp"
 #include "rpc/serialize_macros.hpp"
 
@@ -73,6 +74,59 @@ public:
 
 user_data_t default_user_data();
 
+/* `table_storage_config_t` describes how the table's data is laid out on disk. */
+class table_storage_config_t {
+public:
+    /* The size of the blocks in the table's data files, in bytes.  A data file's block
+    size is fixed when the file is created, so this can only be set when the table is
+    created. */
+    uint32_t block_size;
+
+    /* The codec the table's blocks are compressed with on disk.  Changes take effect
+    the next time a replica's data file is opened; blocks that were already written
+    stay as they are until they get rewritten. */
+    block_compression_t compression;
+};
+
+table_storage_config_t default_table_storage_config();
+
+RDB_DECLARE_SERIALIZABLE(table_storage_config_t);
+RDB_DECLARE_EQUALITY_COMPARABLE(table_storage_config_t);
+
+/* `table_expiry_config_t` makes the table's primary replicas delete rows whose `field`
+holds a time more than `seconds` in the past. Rows where `field` is missing or isn't a
+time never expire. */
+class table_expiry_config_t {
+public:
+    bool is_enabled() const { return !field.empty(); }
+
+    /* Expiry is disabled if this is empty. */
+    std::string field;
+    double seconds;
+};
+
+table_expiry_config_t default_table_expiry_config();
+
+RDB_DECLARE_SERIALIZABLE(table_expiry_config_t);
+RDB_DECLARE_EQUALITY_COMPARABLE(table_expiry_config_t);
+
+/* `table_cache_config_t` is the table's share of the cache on each server that holds
+it. The cache balancer never gives the table less than `min_mb` or more than `max_mb`,
+and otherwise divides the cache by how much each table would gain from it, multiplied
+by `priority`. */
+class table_cache_config_t {
+public:
+    double min_mb;
+    /* There is no limit if this is empty. */
+    optional<double> max_mb;
+    double priority;
+};
+
+table_cache_config_t default_table_cache_config();
+
+RDB_DECLARE_SERIALIZABLE(table_cache_config_t);
+RDB_DECLARE_EQUALITY_COMPARABLE(table_cache_config_t);
+
 /* `table_config_t` describes the complete contents of the `rethinkdb.table_config`
 artificial table. */
 
@@ -96,6 +150,10 @@ public:
     write_durability_t durability;
     flush_interval_config_t flush_interval;
     user_data_t user_data;  // has user-exposed name "data"
+    // has user-exposed names "block_size", "compression"
+    table_storage_config_t storage;
+    table_expiry_config_t expiry;
+    table_cache_config_t cache;
 };
 
 RDB_DECLARE_EQUALITY_COMPARABLE(table_config_t);
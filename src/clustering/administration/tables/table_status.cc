@@ -7,6 +7,7 @@
 #include "clustering/administration/servers/config_client.hpp"
 #include "clustering/table_contract/executor/exec_primary.hpp"
 #include "clustering/table_manager/table_meta_client.hpp"
+#include "concurrency/cross_thread_signal.hpp"
 
 table_status_artificial_table_backend_t::table_status_artificial_table_backend_t(
         rdb_context_t *rdb_context,
@@ -25,7 +26,8 @@ table_status_artificial_table_backend_t::table_status_artificial_table_backend_t
         _table_meta_client,
         _identifier_format),
       server_config_client(_server_config_client),
-      namespace_repo(_namespace_repo) {
+      namespace_repo(_namespace_repo),
+      cache_time{0} {
 }
 
 table_status_artificial_table_backend_t::~table_status_artificial_table_backend_t() {
@@ -156,6 +158,65 @@ ql::datum_t convert_table_status_to_datum(
     return std::move(builder).to_datum();
 }
 
+bool table_status_artificial_table_backend_t::cache_is_fresh() const {
+    return cache_time.micros != 0
+        && get_kiloticks().micros - cache_time.micros < TABLE_STATUS_CACHE_MS * THOUSAND;
+}
+
+bool table_status_artificial_table_backend_t::read_all_rows_as_vector(
+        auth::user_context_t const &user_context,
+        signal_t *interruptor_on_caller,
+        std::vector<ql::datum_t> *rows_out,
+        admin_err_t *error_out) {
+    cross_thread_signal_t interruptor_on_home(interruptor_on_caller, home_thread());
+    on_thread_t thread_switcher(home_thread());
+    new_mutex_in_line_t mutex_lock(&cache_mutex);
+    wait_interruptible(mutex_lock.acq_signal(), &interruptor_on_home);
+    if (!cache_is_fresh()) {
+        std::vector<ql::datum_t> rows;
+        if (!common_table_artificial_table_backend_t::read_all_rows_as_vector(
+                user_context, &interruptor_on_home, &rows, error_out)) {
+            return false;
+        }
+        cached_rows_by_id.clear();
+        for (const ql::datum_t &row : rows) {
+            namespace_id_t table_id;
+            admin_err_t dummy_error;
+            if (convert_uuid_from_datum(row.get_field("id"), &table_id, &dummy_error)) {
+                cached_rows_by_id[table_id] = row;
+            }
+        }
+        cached_rows = std::move(rows);
+        cache_time = get_kiloticks();
+    }
+    *rows_out = cached_rows;
+    return true;
+}
+
+bool table_status_artificial_table_backend_t::read_row(
+        auth::user_context_t const &user_context,
+        ql::datum_t primary_key,
+        signal_t *interruptor_on_caller,
+        ql::datum_t *row_out,
+        admin_err_t *error_out) {
+    {
+        on_thread_t thread_switcher(home_thread());
+        namespace_id_t table_id;
+        admin_err_t dummy_error;
+        if (cache_is_fresh()
+                && convert_uuid_from_datum(primary_key, &table_id, &dummy_error)) {
+            auto it = cached_rows_by_id.find(table_id);
+            if (it != cached_rows_by_id.end()) {
+                *row_out = it->second;
+                return true;
+            }
+        }
+    }
+    // The table may have been created since the rows were cached.
+    return common_table_artificial_table_backend_t::read_row(
+        user_context, primary_key, interruptor_on_caller, row_out, error_out);
+}
+
 void table_status_artificial_table_backend_t::format_row(
         UNUSED auth::user_context_t const &user_context,
         const namespace_id_t &table_id,
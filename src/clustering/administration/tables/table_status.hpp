@@ -2,15 +2,24 @@
 #ifndef CLUSTERING_ADMINISTRATION_TABLES_TABLE_STATUS_HPP_
 #define CLUSTERING_ADMINISTRATION_TABLES_TABLE_STATUS_HPP_
 
+#include <map>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "clustering/administration/tables/calculate_status.hpp"
 #include "clustering/administration/tables/table_common.hpp"
+#include "concurrency/new_mutex.hpp"
+#include "time.hpp"
 
 class namespace_repo_t;
 class server_config_client_t;
 
+/* Computing the rows of `rethinkdb.table_status` asks the servers of every table for
+their status, so reads of the whole table within this many milliseconds of each other
+share one computation.  Changefeeds on the table look for changes this often too. */
+#define TABLE_STATUS_CACHE_MS 1000
+
 ql::datum_t convert_table_status_to_datum(
         const table_status_t &status,
         admin_identifier_format_t identifier_format);
@@ -30,6 +39,19 @@ public:
             admin_identifier_format_t _identifier_format);
     ~table_status_artificial_table_backend_t();
 
+    bool read_all_rows_as_vector(
+            auth::user_context_t const &user_context,
+            signal_t *interruptor_on_caller,
+            std::vector<ql::datum_t> *rows_out,
+            admin_err_t *error_out);
+
+    bool read_row(
+            auth::user_context_t const &user_context,
+            ql::datum_t primary_key,
+            signal_t *interruptor_on_caller,
+            ql::datum_t *row_out,
+            admin_err_t *error_out);
+
     bool write_row(
             auth::user_context_t const &user_context,
             ql::datum_t primary_key,
@@ -55,8 +77,18 @@ private:
             const name_string_t &table_name,
             ql::datum_t *row_out);
 
+    bool cache_is_fresh() const;
+
     server_config_client_t *server_config_client;
     namespace_repo_t *namespace_repo;
+
+    /* The rows from the last time that `read_all_rows_as_vector()` computed them, and
+    when that was.  The rows don't depend on the user, so they're shared by all of
+    them.  `cache_mutex` makes concurrent reads wait for one computation. */
+    std::vector<ql::datum_t> cached_rows;
+    std::map<namespace_id_t, ql::datum_t> cached_rows_by_id;
+    kiloticks_t cache_time;
+    new_mutex_t cache_mutex;
 };
 
 #endif /* CLUSTERING_ADMINISTRATION_TABLES_TABLE_STATUS_HPP_ */
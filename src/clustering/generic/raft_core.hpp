@@ -751,6 +751,11 @@ private:
     a snapshot to compress them. */
     const size_t snapshot_threshold = 20;
 
+    /* The most log entries we'll send to a peer in one append-entries RPC. A peer that
+    is far behind gets the entries over several RPCs, and an RPC that the peer rejects
+    because it doesn't have the entry before them doesn't carry the whole log. */
+    const size_t max_entries_per_append = 64;
+
     /* Note: Methods prefixed with `follower_`, `candidate_`, or `leader_` are methods
     that are only used when in that state. This convention will hopefully make the code
     slightly clearer. */
@@ -1734,6 +1734,11 @@ void raft_member_t<state_t>::leader_send_updates(
         immediately. */
         exponential_backoff_t backoff(100, 1000);
 
+        /* `rejection_step` is how far we'll move `next_index` back the next time the
+        peer rejects an append-entries RPC. It doubles after each rejection and goes back
+        to one after a success. */
+        raft_log_index_t rejection_step = 1;
+
         /* This implementation deviates slightly from the Raft paper in that the initial
         message may not be an empty append-entries RPC. Because `leader_send_updates()`
         runs in its own coroutine, it's possible that entries may be appended to the log
@@ -1837,12 +1842,14 @@ void raft_member_t<state_t>::leader_send_updates(
                 request.entries.prev_index = next_index - 1;
                 request.entries.prev_term =
                     ps().log.get_entry_term(request.entries.prev_index);
-                for (raft_log_index_t i = next_index;
-                        i <= ps().log.get_latest_index(); ++i) {
+                /* If the peer is far behind, we send it the entries in several
+                batches; the loop will come back here right away for the next one. */
+                raft_log_index_t last_index = std::min(ps().log.get_latest_index(),
+                    next_index + max_entries_per_append - 1);
+                for (raft_log_index_t i = next_index; i <= last_index; ++i) {
                     request.entries.append(ps().log.get_entry_ref(i));
                 }
-                guarantee(request.entries.get_latest_index()
-                    == ps().log.get_latest_index());
+                guarantee(request.entries.get_latest_index() == last_index);
                 request.leader_commit = committed_state.get_ref().log_index;
                 raft_rpc_request_t<state_t> request_wrapper;
                 request_wrapper.request = request;
@@ -1900,10 +1907,26 @@ void raft_member_t<state_t>::leader_send_updates(
                             mutex_acq.get());
                     }
                     member_commit_index = request.leader_commit;
+                    rejection_step = 1;
                 } else {
                     /* Raft paper, Section 5.3: "After a rejection, the leader decrements
-                    nextIndex and retries the AppendEntries RPC. */
-                    --next_index;
+                    nextIndex and retries the AppendEntries RPC.
+                    This implementation deviates from the Raft paper slightly in that we
+                    move `next_index` back twice as far after each rejection in a row, so
+                    that we find where a peer that's missing many entries stands in a
+                    logarithmic number of RPCs. Going back too far is harmless, because
+                    the peer skips the entries it already has. We don't go back past the
+                    start of our log unless we're already there, so we don't send an
+                    install-snapshot RPC that the peer doesn't need. */
+                    raft_log_index_t min_next_index = ps().log.prev_index + 1;
+                    if (next_index > min_next_index) {
+                        next_index = next_index - min_next_index > rejection_step
+                            ? next_index - rejection_step
+                            : min_next_index;
+                        rejection_step *= 2;
+                    } else {
+                        --next_index;
+                    }
                 }
                 send_even_if_empty = false;
 
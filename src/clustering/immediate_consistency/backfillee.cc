@@ -11,6 +11,11 @@ backfiller. If it's too short, we'll waste resources sending lots of tiny
 acknowledgements; if it's too long, the pipeline might stall. */
 static const int ITEM_ACK_INTERVAL_MS = 100;
 
+/* We also send an acknowledgement as soon as we've applied this fraction of the item
+queue, so that a fast store doesn't leave the backfiller waiting for the next interval
+with nothing in flight. */
+static const size_t ITEM_ACK_QUEUE_FRACTION = 4;
+
 /* `backfillee_t::session_t` contains all the bits and pieces for managing a single
 backfill session. It's impossible to have multiple sessions running at once, so in
 principle this could have been implemented as some member variables on `backfillee_t`;
@@ -132,7 +137,8 @@ private:
                 range or we run out of items */
                 class producer_t : public store_view_t::backfill_item_producer_t {
                 public:
-                    explicit producer_t(session_t *_parent) : parent(_parent) {
+                    explicit producer_t(session_t *_parent) :
+                            parent(_parent), pulse_to_ack(nullptr) {
                         coro_t::spawn_sometime(std::bind(
                             &producer_t::ack_periodically, this, drainer.lock()));
                     }
@@ -147,6 +153,7 @@ private:
                             *is_item_out = true;
                             *item_out = parent->items.front();
                             parent->items.pop_front();
+                            wake_acker_if_needed();
                             return continue_bool_t::CONTINUE;
                         } else if (!parent->items.empty_domain()) {
                             /* There aren't any more items left in the queue, but there's
@@ -199,6 +206,19 @@ private:
                         parent->threshold = new_threshold;
                     }
                 private:
+                    /* `wake_acker_if_needed()` makes `ack_periodically()` send an
+                    acknowledgement right away once we've consumed enough of the queue.
+                    It doesn't send it itself because we might be holding B-tree locks
+                    here. */
+                    void wake_acker_if_needed() {
+                        size_t consumed =
+                            parent->items_mem_size_unacked - parent->items.get_mem_size();
+                        if (pulse_to_ack != nullptr
+                                && consumed >= parent->parent->backfill_config
+                                    .item_queue_mem_size / ITEM_ACK_QUEUE_FRACTION) {
+                            pulse_to_ack->pulse_if_not_already_pulsed();
+                        }
+                    }
                     /* `ack_periodically()` calls `session_t::send_ack_items()` every so
                     often during the backfill, so that the backfiller will keep sending
                     us items as they consume them and so ideally the `items` queue won't
@@ -206,7 +226,13 @@ private:
                     void ack_periodically(auto_drainer_t::lock_t keepalive2) {
                         try {
                             while (true) {
-                                nap(ITEM_ACK_INTERVAL_MS, keepalive2.get_drain_signal());
+                                cond_t ack_now;
+                                assignment_sentry_t<cond_t *> sentry(
+                                    &pulse_to_ack, &ack_now);
+                                signal_timer_t timer(ITEM_ACK_INTERVAL_MS);
+                                wait_any_t waiter(&timer, &ack_now);
+                                wait_interruptible(
+                                    &waiter, keepalive2.get_drain_signal());
                                 parent->send_ack_items();
                             }
                         } catch (const interrupted_exc_t &) {
@@ -214,6 +240,9 @@ private:
                         }
                     }
                     session_t *parent;
+                    /* `ack_periodically()` puts a `cond_t` here while it waits for the
+                    next interval; `wake_acker_if_needed()` pulses it. */
+                    cond_t *pulse_to_ack;
                     auto_drainer_t drainer;
                 } producer(this);
 
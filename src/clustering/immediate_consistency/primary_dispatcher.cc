@@ -1,6 +1,8 @@
 // Copyright 2010-2015 RethinkDB, all rights reserved.
 #include "clustering/immediate_consistency/primary_dispatcher.hpp"
 
+#include "config/args.hpp"
+
 /* Limits how many writes should be sent to a dispatchee at once. */
 const size_t DISPATCH_WRITES_CORO_POOL_SIZE = 64;
 
@@ -66,6 +68,13 @@ primary_dispatcher_t::primary_dispatcher_t(
         perfmon_collection_t *parent_perfmon_collection,
         const region_map_t<version_t> &base_version) :
     perfmon_membership(parent_perfmon_collection, &perfmon_collection, "broadcaster"),
+    reads_per_sec(secs_to_ticks(1)),
+    reads_per_sec_membership(&perfmon_collection, &reads_per_sec, "reads_per_sec"),
+    writes_per_sec(secs_to_ticks(1)),
+    writes_per_sec_membership(&perfmon_collection, &writes_per_sec, "writes_per_sec"),
+    ack_latency(secs_to_ticks(1), false),
+    ack_latency_membership(&perfmon_collection, &ack_latency, "ack_latency"),
+    point_reads_since_warmup(0),
     ready_dispatchees_as_set(std::set<server_id_t>())
 {
     current_timestamp = state_timestamp_t::zero();
@@ -90,6 +99,7 @@ void primary_dispatcher_t::read(
     assert_thread();
     rassert(region_is_superset(branch_bc.get_region(), _read.get_region()));
     order_token.assert_read_mode();
+    reads_per_sec.record();
 
     dispatchee_registration_t *dispatchee = nullptr;
     auto_drainer_t::lock_t dispatchee_lock;
@@ -129,6 +139,20 @@ void primary_dispatcher_t::read(
 
         order_checkpoint.check_through(order_token);
         min_timestamp = most_recent_acked_write_timestamp;
+
+        if (STANDBY_WARMUP_READ_INTERVAL > 0
+                && boost::get<point_read_t>(&_read.read) != nullptr
+                && ++point_reads_since_warmup >= STANDBY_WARMUP_READ_INTERVAL) {
+            point_reads_since_warmup = 0;
+            for (const auto &pair : dispatchees) {
+                if (pair.first != dispatchee && pair.first->is_ready
+                        && !pair.first->dispatchee->is_primary()) {
+                    coro_t::spawn_sometime(std::bind(
+                        &primary_dispatcher_t::warm_up_dispatchee,
+                        pair.first, pair.second, _read, min_timestamp));
+                }
+            }
+        }
     }
 
     try {
@@ -145,6 +169,20 @@ void primary_dispatcher_t::read(
     }
 }
 
+void primary_dispatcher_t::warm_up_dispatchee(
+        dispatchee_registration_t *dispatchee,
+        auto_drainer_t::lock_t dispatchee_lock,
+        const read_t &read,
+        state_timestamp_t min_timestamp) {
+    read_response_t response;
+    try {
+        dispatchee->dispatchee->do_read(
+            read, min_timestamp, dispatchee_lock.get_drain_signal(), &response);
+    } catch (const interrupted_exc_t &) {
+        /* The dispatchee went away, so there's nothing left to warm up. */
+    }
+}
+
 void primary_dispatcher_t::spawn_write(
         const write_t &write,
         order_token_t order_token,
@@ -174,6 +212,7 @@ void primary_dispatcher_t::spawn_write(
     /* Assign a new timestamp to the write, unless it's a dummy write. */
     if (boost::get<dummy_write_t>(&write.write) == nullptr) {
         current_timestamp = current_timestamp.next();
+        writes_per_sec.record();
     }
 
     counted_t<incomplete_write_t> incomplete_write = make_counted<incomplete_write_t>(
@@ -197,7 +236,8 @@ void primary_dispatcher_t::spawn_write(
 primary_dispatcher_t::incomplete_write_t::incomplete_write_t(
         const write_t &w, state_timestamp_t ts, order_token_t ot,
         write_durability_t dur, write_callback_t *cb) :
-    write(w), timestamp(ts), order_token(ot), durability(dur), callback(cb)
+    write(w), timestamp(ts), order_token(ot), durability(dur), callback(cb),
+    start_time(get_ticks())
     { }
 
 primary_dispatcher_t::incomplete_write_t::~incomplete_write_t() {
@@ -242,6 +282,9 @@ void primary_dispatcher_t::background_write(
             dispatchee->latest_acked_write =
                 std::max(dispatchee->latest_acked_write, write->timestamp);
 
+            const ticks_t now = get_ticks();
+            ack_latency.record(ticks_t{now.nanos - write->start_time.nanos}, now);
+
             /* The write could potentially get acked when we call `on_ack()` on the
             callback. So make sure all reads started after this point will see this
             write. This is more conservative than necessary, since the write might not
@@ -191,6 +191,7 @@ private:
         order_token_t order_token;
         write_durability_t durability;
         write_callback_t *callback;
+        ticks_t start_time;
     };
 
     void background_write(
@@ -200,12 +201,30 @@ private:
 
     void refresh_ready_dispatchees_as_set();
 
+    /* Performs `read` on a secondary replica and throws away the response. See
+    `STANDBY_WARMUP_READ_INTERVAL`. */
+    static void warm_up_dispatchee(
+        dispatchee_registration_t *dispatchee,
+        auto_drainer_t::lock_t dispatchee_lock,
+        const read_t &read,
+        state_timestamp_t min_timestamp);
+
     branch_id_t branch_id;
     branch_birth_certificate_t branch_bc;
 
     perfmon_collection_t perfmon_collection;
     perfmon_membership_t perfmon_membership;
 
+    /* How many reads and writes this primary serves per second, so hot shards show
+    up in the `stats` table. */
+    perfmon_rate_monitor_t reads_per_sec;
+    perfmon_membership_t reads_per_sec_membership;
+    perfmon_rate_monitor_t writes_per_sec;
+    perfmon_membership_t writes_per_sec_membership;
+    /* How long replicas take to ack writes, from `spawn_write()` to each ack. */
+    perfmon_histogram_t ack_latency;
+    perfmon_membership_t ack_latency_membership;
+
     mutex_assertion_t mutex;
 
     state_timestamp_t current_timestamp;
@@ -217,6 +236,10 @@ private:
     read to a listener. */
     state_timestamp_t most_recent_acked_write_timestamp;
 
+    /* Counts point reads so that every `STANDBY_WARMUP_READ_INTERVAL`th one can be
+    copied to the secondary replicas. */
+    uint64_t point_reads_since_warmup;
+
     std::map<dispatchee_registration_t *, auto_drainer_t::lock_t> dispatchees;
 
     /* This is just a set that contains the peer ID of each dispatchee in `dispatchees`
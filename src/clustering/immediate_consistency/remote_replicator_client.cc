@@ -4,6 +4,7 @@
 #include "clustering/immediate_consistency/backfill_throttler.hpp"
 #include "clustering/immediate_consistency/backfillee.hpp"
 #include "clustering/table_manager/backfill_progress_tracker.hpp"
+#include "concurrency/pmap.hpp"
 #include "stl_utils.hpp"
 #include "store_view.hpp"
 
@@ -167,7 +168,7 @@ remote_replicator_client_t::remote_replicator_client_t(
             ph::_1, ph::_2, ph::_3, ph::_4, ph::_5)),
     write_sync_mailbox_(mailbox_manager,
         std::bind(&remote_replicator_client_t::on_write_sync, this,
-            ph::_1, ph::_2, ph::_3, ph::_4, ph::_5, ph::_6)),
+            ph::_1, ph::_2, ph::_3)),
     dummy_write_mailbox_(mailbox_manager,
         std::bind(&remote_replicator_client_t::on_dummy_write, this,
             ph::_1, ph::_2)),
@@ -448,22 +449,51 @@ void remote_replicator_client_t::on_write_async(
 
 void remote_replicator_client_t::on_write_sync(
         signal_t *interruptor,
-        const write_t &write,
-        state_timestamp_t timestamp,
-        order_token_t order_token,
-        write_durability_t durability,
-        const mailbox_t<write_response_t>::address_t &ack_addr)
+        const std::vector<remote_replicator_sync_write_t> &writes,
+        const remote_replicator_client_bcard_t::write_sync_response_mailbox_t
+            ::address_t &ack_addr)
         THROWS_ONLY(interrupted_exc_t) {
-    /* The current implementation of the dispatcher will never send us an async write
-    once it's started sending sync writes, but we don't want to rely on that detail, so
-    we pass sync writes through the timestamp enforcer too. */
-    timestamp_enforcer_->complete(timestamp);
+    /* The writes in a batch are independent; `replica_t` puts them in timestamp order,
+    so we run them concurrently just as we would if they had arrived in separate
+    messages, and acknowledge each one as soon as it's done.
+
+    The current implementation of the dispatcher will never send us an async write once
+    it's started sending sync writes, but we don't want to rely on that detail, so we
+    pass sync writes through the timestamp enforcer too. */
+    bool consecutive = !writes.empty();
+    for (size_t i = 1; i < writes.size() && consecutive; ++i) {
+        consecutive = writes[i].timestamp == writes[i - 1].timestamp.next();
+    }
+    if (consecutive) {
+        /* Usually the batch is a run of consecutive timestamps, so the bookkeeping
+        that keeps the writes in order only has to be done once for all of them. */
+        timestamp_enforcer_->complete_range(
+            writes.front().timestamp, writes.back().timestamp);
+        replica_->do_writes(writes, interruptor,
+            [&](size_t i, const write_response_t &response) {
+                send(mailbox_manager_, ack_addr, writes[i].timestamp, response);
+            });
+        return;
+    }
 
-    write_response_t response;
-    replica_->do_write(
-        write, timestamp, order_token, durability,
-        interruptor, &response);
-    send(mailbox_manager_, ack_addr, response);
+    bool interrupted = false;
+    pmap(writes.size(), [&](int64_t i) {
+        const remote_replicator_sync_write_t &w = writes[i];
+        timestamp_enforcer_->complete(w.timestamp);
+        write_response_t response;
+        try {
+            replica_->do_write(
+                w.write, w.timestamp, w.order_token, w.durability,
+                interruptor, &response);
+        } catch (const interrupted_exc_t &) {
+            interrupted = true;
+            return;
+        }
+        send(mailbox_manager_, ack_addr, w.timestamp, response);
+    });
+    if (interrupted) {
+        throw interrupted_exc_t();
+    }
 }
 
 void remote_replicator_client_t::on_dummy_write(
@@ -91,11 +91,9 @@ private:
 
     void on_write_sync(
             signal_t *interruptor,
-            const write_t &write,
-            state_timestamp_t timestamp,
-            order_token_t order_token,
-            write_durability_t durability,
-            const mailbox_t<write_response_t>::address_t &ack_addr)
+            const std::vector<remote_replicator_sync_write_t> &writes,
+            const remote_replicator_client_bcard_t::write_sync_response_mailbox_t
+                ::address_t &ack_addr)
         THROWS_ONLY(interrupted_exc_t);
 
     void on_dummy_write(
@@ -4,6 +4,9 @@
 RDB_IMPL_SERIALIZABLE_2_FOR_CLUSTER(
     remote_replicator_client_intro_t,
     streaming_begin_timestamp, ready_mailbox);
+RDB_IMPL_SERIALIZABLE_4_FOR_CLUSTER(
+    remote_replicator_sync_write_t,
+    write, timestamp, order_token, durability);
 RDB_IMPL_SERIALIZABLE_6_FOR_CLUSTER(
     remote_replicator_client_bcard_t,
     server_id, intro_mailbox, write_async_mailbox, write_sync_mailbox,
@@ -2,8 +2,11 @@
 #ifndef CLUSTERING_IMMEDIATE_CONSISTENCY_REMOTE_REPLICATOR_METADATA_HPP_
 #define CLUSTERING_IMMEDIATE_CONSISTENCY_REMOTE_REPLICATOR_METADATA_HPP_
 
+#include <vector>
+
 #include "clustering/generic/registration_metadata.hpp"
 #include "clustering/immediate_consistency/history.hpp"
+#include "containers/archive/stl_types.hpp"
 #include "rdb_protocol/protocol.hpp"
 
 class remote_replicator_client_intro_t {
@@ -16,6 +19,19 @@ public:
 
 RDB_DECLARE_SERIALIZABLE(remote_replicator_client_intro_t);
 
+/* One of the sync writes in a `write_sync_mailbox_t` message. The primary collects the
+writes that it dispatches to a replica while the previous batch is being sent, so
+several of these usually travel together. */
+class remote_replicator_sync_write_t {
+public:
+    write_t write;
+    state_timestamp_t timestamp;
+    order_token_t order_token;
+    write_durability_t durability;
+};
+
+RDB_DECLARE_SERIALIZABLE(remote_replicator_sync_write_t);
+
 class remote_replicator_client_bcard_t {
 public:
     typedef mailbox_t<
@@ -25,9 +41,14 @@ public:
         write_t, state_timestamp_t, order_token_t,
         mailbox_t<>::address_t
         > write_async_mailbox_t;
+    /* The response to each write in a batch is sent separately, along with the
+    write's timestamp, as soon as that write is done. */
     typedef mailbox_t<
-        write_t, state_timestamp_t, order_token_t, write_durability_t,
-        mailbox_t<write_response_t>::address_t
+        state_timestamp_t, write_response_t
+        > write_sync_response_mailbox_t;
+    typedef mailbox_t<
+        std::vector<remote_replicator_sync_write_t>,
+        write_sync_response_mailbox_t::address_t
         > write_sync_mailbox_t;
     typedef mailbox_t<
         mailbox_t<write_response_t>::address_t
@@ -1,6 +1,8 @@
 // Copyright 2010-2015 RethinkDB, all rights reserved.
 #include "clustering/immediate_consistency/remote_replicator_server.hpp"
 
+#include "arch/timing.hpp"
+
 remote_replicator_server_t::remote_replicator_server_t(
         mailbox_manager_t *_mailbox_manager,
         primary_dispatcher_t *_primary) :
@@ -14,6 +16,10 @@ remote_replicator_server_t::proxy_replica_t::proxy_replica_t(
         const remote_replicator_client_bcard_t &_client_bcard,
         UNUSED signal_t *interruptor) :
     client_bcard(_client_bcard), parent(_parent), is_ready(false),
+    sync_write_flush_scheduled(false),
+    sync_response_mailbox(
+        parent->mailbox_manager,
+        std::bind(&proxy_replica_t::on_sync_response, this, ph::_1, ph::_2, ph::_3)),
     ready_mailbox(
         parent->mailbox_manager,
         std::bind(&proxy_replica_t::on_ready, this, ph::_1))
@@ -54,15 +60,26 @@ void remote_replicator_server_t::proxy_replica_t::do_write_sync(
         write_response_t *response_out) {
     guarantee(is_ready);
     cond_t got_response;
-    mailbox_t<write_response_t> response_mailbox(
-        parent->mailbox_manager,
-        [&](signal_t *, const write_response_t &response) {
-            *response_out = response;
-            got_response.pulse();
-        });
-    send(parent->mailbox_manager, client_bcard.write_sync_mailbox,
-        write, timestamp, order_token, durability, response_mailbox.get_address());
-    wait_interruptible(&got_response, interruptor);
+    auto res = sync_write_waiters.insert(std::make_pair(
+        timestamp, std::make_pair(&got_response, response_out)));
+    guarantee(res.second);
+    sync_write_batch.push_back(remote_replicator_sync_write_t {
+        write, timestamp, order_token, durability });
+    if (sync_write_batch.size() >= REPLICATION_MAX_WRITE_BATCH_SIZE) {
+        flush_sync_writes();
+    } else if (!sync_write_flush_scheduled) {
+        sync_write_flush_scheduled = true;
+        coro_t::spawn_sometime(std::bind(
+            &proxy_replica_t::flush_sync_writes_cb, this,
+            auto_drainer_t::lock_t(&drainer)));
+    }
+    try {
+        wait_interruptible(&got_response, interruptor);
+    } catch (const interrupted_exc_t &) {
+        /* The write may still be sent and performed; we just won't wait for it. */
+        sync_write_waiters.erase(timestamp);
+        throw;
+    }
 }
 
 void remote_replicator_server_t::proxy_replica_t::do_dummy_write(
@@ -95,6 +112,44 @@ void remote_replicator_server_t::proxy_replica_t::do_write_async(
     wait_interruptible(&got_ack, interruptor);
 }
 
+void remote_replicator_server_t::proxy_replica_t::flush_sync_writes() {
+    std::vector<remote_replicator_sync_write_t> batch;
+    batch.swap(sync_write_batch);
+    if (!batch.empty()) {
+        send(parent->mailbox_manager, client_bcard.write_sync_mailbox,
+            batch, sync_response_mailbox.get_address());
+    }
+}
+
+void remote_replicator_server_t::proxy_replica_t::flush_sync_writes_cb(
+        auto_drainer_t::lock_t keepalive) {
+    keepalive.assert_is_holding(&drainer);
+    if (REPLICATION_WRITE_BATCH_DELAY_MS > 0) {
+        try {
+            nap(REPLICATION_WRITE_BATCH_DELAY_MS, keepalive.get_drain_signal());
+        } catch (const interrupted_exc_t &) {
+            /* We're shutting down, so nobody is waiting for the responses. */
+            return;
+        }
+    }
+    sync_write_flush_scheduled = false;
+    flush_sync_writes();
+}
+
+void remote_replicator_server_t::proxy_replica_t::on_sync_response(
+        signal_t *,
+        const state_timestamp_t &timestamp,
+        const write_response_t &response) {
+    auto it = sync_write_waiters.find(timestamp);
+    if (it == sync_write_waiters.end()) {
+        /* `do_write_sync()` was interrupted before the response arrived */
+        return;
+    }
+    *it->second.second = response;
+    it->second.first->pulse();
+    sync_write_waiters.erase(it);
+}
+
 void remote_replicator_server_t::proxy_replica_t::on_ready(signal_t *) {
     // Can't block here, or we would need an auto drainer.
     ASSERT_FINITE_CORO_WAITING;
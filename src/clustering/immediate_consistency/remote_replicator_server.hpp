@@ -2,6 +2,10 @@
 #ifndef CLUSTERING_IMMEDIATE_CONSISTENCY_REMOTE_REPLICATOR_SERVER_HPP_
 #define CLUSTERING_IMMEDIATE_CONSISTENCY_REMOTE_REPLICATOR_SERVER_HPP_
 
+#include <map>
+#include <utility>
+#include <vector>
+
 #include "clustering/generic/registrar.hpp"
 #include "clustering/immediate_consistency/primary_dispatcher.hpp"
 #include "clustering/immediate_consistency/remote_replicator_metadata.hpp"
@@ -66,14 +70,34 @@ private:
     private:
         void on_ready(signal_t *interruptor);
 
+        /* `do_write_sync()` adds its write to `sync_write_batch` and waits for the
+        response to arrive on `sync_response_mailbox`. The batch is sent by
+        `flush_sync_writes()`, either when it's full or from a coroutine that
+        `do_write_sync()` spawns for the first write in the batch. */
+        void flush_sync_writes();
+        void flush_sync_writes_cb(auto_drainer_t::lock_t keepalive);
+        void on_sync_response(
+            signal_t *interruptor,
+            const state_timestamp_t &timestamp,
+            const write_response_t &response);
+
         remote_replicator_client_bcard_t client_bcard;
         remote_replicator_server_t *parent;
         bool is_ready;
 
+        std::vector<remote_replicator_sync_write_t> sync_write_batch;
+        bool sync_write_flush_scheduled;
+        std::map<state_timestamp_t, std::pair<cond_t *, write_response_t *> >
+            sync_write_waiters;
+        remote_replicator_client_bcard_t::write_sync_response_mailbox_t
+            sync_response_mailbox;
+
         // The destruction order matters: The `ready_mailbox` callback assumes
         // that `registration` is still valid.
         scoped_ptr_t<primary_dispatcher_t::dispatchee_registration_t> registration;
         remote_replicator_client_intro_t::ready_mailbox_t ready_mailbox;
+
+        auto_drainer_t drainer;
     };
 
     mailbox_manager_t *mailbox_manager;
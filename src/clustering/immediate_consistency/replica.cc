@@ -1,6 +1,7 @@
 // Copyright 2010-2015 RethinkDB, all rights reserved.
 #include "clustering/immediate_consistency/replica.hpp"
 
+#include "concurrency/pmap.hpp"
 #include "store_view.hpp"
 
 replica_t::replica_t(
@@ -64,9 +65,6 @@ void replica_t::do_write(
         signal_t *interruptor,
         write_response_t *response_out) {
     assert_thread();
-    rassert(region_is_superset(store->get_region(), write.get_region()));
-    rassert(!region_is_empty(write.get_region()));
-    order_token.assert_write_mode();
 
     write_token_t write_token;
     {
@@ -81,6 +79,68 @@ void replica_t::do_write(
         start_enforcer.complete(timestamp);
     }
 
+    perform_write(write, timestamp, order_token, durability, &write_token,
+                  interruptor, response_out);
+}
+
+void replica_t::do_writes(
+        const std::vector<remote_replicator_sync_write_t> &writes,
+        signal_t *interruptor,
+        const std::function<void(size_t, const write_response_t &)> &on_write_done) {
+    assert_thread();
+    if (writes.empty()) {
+        return;
+    }
+    const state_timestamp_t first_timestamp = writes.front().timestamp;
+    const state_timestamp_t last_timestamp = writes.back().timestamp;
+    for (size_t i = 1; i < writes.size(); ++i) {
+        guarantee(writes[i].timestamp == writes[i - 1].timestamp.next());
+    }
+
+    scoped_array_t<write_token_t> write_tokens(writes.size());
+    {
+        /* Wait until it's the first write's turn to go. The others are right behind
+        it, so they don't have to wait any longer. */
+        start_enforcer.wait_all_before(first_timestamp.pred(), interruptor);
+
+        for (size_t i = 0; i < writes.size(); ++i) {
+            store->new_write_token(&write_tokens[i]);
+        }
+
+        /* Notify the write after the last one (if any) that it's their turn to go. */
+        start_enforcer.complete_range(first_timestamp, last_timestamp);
+    }
+
+    bool interrupted = false;
+    pmap(writes.size(), [&](int64_t i) {
+        const remote_replicator_sync_write_t &w = writes[i];
+        write_response_t response;
+        try {
+            perform_write(w.write, w.timestamp, w.order_token, w.durability,
+                          &write_tokens[i], interruptor, &response);
+        } catch (const interrupted_exc_t &) {
+            interrupted = true;
+            return;
+        }
+        on_write_done(i, response);
+    });
+    if (interrupted) {
+        throw interrupted_exc_t();
+    }
+}
+
+void replica_t::perform_write(
+        const write_t &write,
+        state_timestamp_t timestamp,
+        order_token_t order_token,
+        write_durability_t durability,
+        write_token_t *write_token,
+        signal_t *interruptor,
+        write_response_t *response_out) {
+    rassert(region_is_superset(store->get_region(), write.get_region()));
+    rassert(!region_is_empty(write.get_region()));
+    order_token.assert_write_mode();
+
 #ifndef NDEBUG
     metainfo_checker_t metainfo_checker(store->get_region(),
         [&](const region_t &, const binary_blob_t &bb) {
@@ -99,7 +159,7 @@ void replica_t::do_write(
         durability,
         timestamp,
         order_token,
-        &write_token,
+        write_token,
         interruptor);
 
     /* Notify reads that were waiting for this write that it's OK to go */
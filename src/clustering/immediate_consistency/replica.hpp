@@ -4,6 +4,7 @@
 
 #include "clustering/immediate_consistency/backfill_metadata.hpp"
 #include "clustering/immediate_consistency/backfiller.hpp"
+#include "clustering/immediate_consistency/remote_replicator_metadata.hpp"
 #include "concurrency/timestamp_enforcer.hpp"
 
 /* `replica_t` represents a replica of a shard which is currently tracking changes to a
@@ -46,11 +47,32 @@ public:
         signal_t *interruptor,
         write_response_t *response_out);
 
+    /* Like calling `do_write()` for each of `writes` concurrently, but the timestamps
+    of `writes` must be consecutive, and the writes wait for their turn and claim their
+    tokens from the store together instead of each one waiting for the one before it.
+    Calls `on_write_done` with the index and response of each write as soon as that
+    write is done. The same warning about interruption applies. */
+    void do_writes(
+        const std::vector<remote_replicator_sync_write_t> &writes,
+        signal_t *interruptor,
+        const std::function<void(size_t, const write_response_t &)> &on_write_done);
+
     void do_dummy_write(
         signal_t *interruptor,
         write_response_t *response_out);
 
 private:
+    /* The part of `do_write()` and `do_writes()` that comes after the write has its
+    token. */
+    void perform_write(
+        const write_t &write,
+        state_timestamp_t timestamp,
+        order_token_t order_token,
+        write_durability_t durability,
+        write_token_t *write_token,
+        signal_t *interruptor,
+        write_response_t *response_out);
+
     void on_synchronize(
         signal_t *interruptor,
         state_timestamp_t timestamp,
@@ -3,8 +3,7 @@
 
 #include "concurrency/cross_thread_signal.hpp"
 #include "concurrency/wait_any.hpp"
-
-static const size_t max_active_backfills = 8;
+#include "config/args.hpp"
 
 standard_backfill_throttler_t::~standard_backfill_throttler_t() {
     guarantee(active.empty());
@@ -17,7 +16,7 @@ void standard_backfill_throttler_t::enter(lock_t *lock, signal_t *interruptor_on
     scoped_ptr_t<new_mutex_acq_t> mutex_acq(
         new new_mutex_acq_t(&mutex, &interruptor_on_home));
 
-    if (active.size() < max_active_backfills) {
+    if (active.size() < MAX_CONCURRENT_BACKFILLS) {
         /* There is no contention, so we can start right away */
         active.insert(std::make_pair(lock->priority, lock));
 
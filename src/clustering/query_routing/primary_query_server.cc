@@ -3,6 +3,7 @@
 
 #include "clustering/administration/admin_op_exc.hpp"
 #include "containers/archive/boost_types.hpp"
+#include "time.hpp"
 
 primary_query_server_t::primary_query_server_t(
         mailbox_manager_t *mm, region_t r, query_callback_t *cb)
@@ -39,6 +40,9 @@ void primary_query_server_t::client_t::perform_request(
         return;
     }
 
+    // How long we take is reported back, so that query traces can tell our time apart
+    // from the network's.
+    const ticks_t start_time = get_ticks();
     try {
         if (const primary_query_bcard_t::read_request_t *read =
                 boost::get<primary_query_bcard_t::read_request_t>(&request)) {
@@ -53,6 +57,9 @@ void primary_query_server_t::client_t::perform_request(
                 boost::get<read_response_t>(&reply), &error);
             if (!ok) {
                 reply = cannot_perform_query_exc_t(error.msg, error.query_state);
+            } else {
+                boost::get<read_response_t>(&reply)->resource_usage.primary_nanos =
+                    get_ticks().nanos - start_time.nanos;
             }
             send(parent->mailbox_manager, read->cont_addr, reply);
 
@@ -69,6 +76,9 @@ void primary_query_server_t::client_t::perform_request(
                 boost::get<write_response_t>(&reply), &error);
             if (!ok) {
                 reply = cannot_perform_query_exc_t(error.msg, error.query_state);
+            } else {
+                boost::get<write_response_t>(&reply)->resource_usage.primary_nanos =
+                    get_ticks().nanos - start_time.nanos;
             }
             send(parent->mailbox_manager, write->cont_addr, reply);
 
@@ -3,13 +3,47 @@
 
 #include <functional>
 
+#include "arch/runtime/resource_usage.hpp"
 #include "clustering/query_routing/primary_query_client.hpp"
 #include "clustering/table_contract/cpu_sharding.hpp"
 #include "clustering/table_manager/multi_table_manager.hpp"
 #include "concurrency/cross_thread_signal.hpp"
 #include "concurrency/fifo_enforcer.hpp"
+#include "concurrency/wait_any.hpp"
 #include "concurrency/watchable.hpp"
+#include "containers/archive/vector_stream.hpp"
 #include "rdb_protocol/env.hpp"
+#include "rdb_protocol/slow_query_log.hpp"
+#include "time.hpp"
+
+/* How much each outdated read's latency moves a replica's average. */
+static const double OUTDATED_READ_LATENCY_WEIGHT = 0.1;
+
+std::atomic<bool> table_query_client_t::coalesce_reads(false);
+
+struct table_query_client_t::coalesced_read_t {
+    cond_t done;
+    // If the read that the others waited for was interrupted, they run it again.
+    bool interrupted;
+    read_response_t response;
+    optional<cannot_perform_query_exc_t> failure;
+};
+
+/* Returns true if `r` can share its response with identical reads. */
+static bool can_coalesce_read(const read_t &r) {
+    if (r.profile == profile_bool_t::PROFILE
+        || (r.read_mode != read_mode_t::SINGLE
+            && r.read_mode != read_mode_t::OUTDATED)) {
+        return false;
+    }
+    if (boost::get<point_read_t>(&r.read) != nullptr) {
+        return true;
+    }
+    const rget_read_t *rget = boost::get<rget_read_t>(&r.read);
+    return rget != nullptr
+        && static_cast<bool>(rget->primary_keys)
+        && rget->primary_keys->size() <= COALESCED_READ_MAX_KEYS;
+}
 
 table_query_client_t::table_query_client_t(
         const namespace_id_t &_table_id,
@@ -113,6 +147,66 @@ void table_query_client_t::read(
 
     user_context.require_read_permission(ctx, table_basic_config.database, table_id);
 
+    if (!coalesce_reads.load(std::memory_order_relaxed) || !can_coalesce_read(r)) {
+        dispatch_read(r, response, order_token, interruptor);
+        return;
+    }
+
+    write_message_t wm;
+    serialize<cluster_version_t::CLUSTER>(&wm, r);
+    vector_stream_t stream;
+    int res = send_write_message(&stream, &wm);
+    guarantee(res == 0);
+    std::vector<char> key;
+    stream.swap(&key);
+
+    for (;;) {
+        auto it = coalesced_reads.find(key);
+        if (it != coalesced_reads.end()) {
+            std::shared_ptr<coalesced_read_t> coalesced = it->second;
+            wait_interruptible(&coalesced->done, interruptor);
+            if (coalesced->interrupted) {
+                continue;
+            }
+            if (coalesced->failure) {
+                throw *coalesced->failure;
+            }
+            *response = coalesced->response;
+            return;
+        }
+
+        std::shared_ptr<coalesced_read_t> coalesced =
+            std::make_shared<coalesced_read_t>();
+        coalesced->interrupted = false;
+        coalesced_reads.insert(std::make_pair(key, coalesced));
+        bool interrupted = false;
+        try {
+            dispatch_read(r, &coalesced->response, order_token, interruptor);
+        } catch (const cannot_perform_query_exc_t &ex) {
+            coalesced->failure.set(ex);
+        } catch (const interrupted_exc_t &) {
+            interrupted = true;
+        }
+        coalesced->interrupted = interrupted;
+        coalesced_reads.erase(key);
+        coalesced->done.pulse();
+        if (interrupted) {
+            throw interrupted_exc_t();
+        }
+        if (coalesced->failure) {
+            throw *coalesced->failure;
+        }
+        *response = coalesced->response;
+        return;
+    }
+}
+
+void table_query_client_t::dispatch_read(
+        const read_t &r,
+        read_response_t *response,
+        order_token_t order_token,
+        signal_t *interruptor)
+        THROWS_ONLY(interrupted_exc_t, cannot_perform_query_exc_t) {
     order_token.assert_read_mode();
     if (r.read_mode == read_mode_t::OUTDATED) {
         guarantee(!r.route_to_primary());
@@ -198,6 +292,12 @@ void table_query_client_t::dispatch_immediate_op(
 
     if (interruptor->is_pulsed()) throw interrupted_exc_t();
 
+    // The slow query log and query traces want to know how long each shard took.
+    resource_usage_t *usage = current_resource_usage();
+    std::vector<shard_usage_t> *shard_usages =
+        usage != nullptr ? usage->shards : nullptr;
+    const int64_t route_start_nanos = shard_usages != nullptr ? get_ticks().nanos : 0;
+
     std::vector<scoped_ptr_t<immediate_op_info_t<op_type, fifo_enforcer_token_type> > >
         primaries_to_contact;
     scoped_ptr_t<immediate_op_info_t<op_type, fifo_enforcer_token_type> >
@@ -227,6 +327,7 @@ void table_query_client_t::dispatch_immediate_op(
                               key_range_to_string(reg.inner).c_str()),
                     query_state_t::FAILED);
             }
+            new_op_info->region = reg;
             new_op_info->primary_client = chosen_relationship->primary_client;
             (new_op_info->primary_client->*how_to_make_token)(
                 &new_op_info->enforcement_token);
@@ -241,17 +342,25 @@ void table_query_client_t::dispatch_immediate_op(
     std::vector<op_response_type> results(primaries_to_contact.size());
     std::vector<optional<cannot_perform_query_exc_t> >
         failures(primaries_to_contact.size());
-    pmap(primaries_to_contact.size(), std::bind(
-             &table_query_client_t::template perform_immediate_op<
-                 op_type, fifo_enforcer_token_type, op_response_type>,
-             this,
-             how_to_run_query,
-             &primaries_to_contact,
-             &results,
-             &failures,
-             order_token,
-             ph::_1,
-             interruptor));
+    std::vector<int64_t> shard_start_nanos(
+        shard_usages != nullptr ? primaries_to_contact.size() : 0);
+    std::vector<int64_t> shard_nanos(
+        shard_usages != nullptr ? primaries_to_contact.size() : 0);
+    pmap(primaries_to_contact.size(), [&](size_t i) {
+        const int64_t start_nanos = shard_usages != nullptr ? get_ticks().nanos : 0;
+        perform_immediate_op<op_type, fifo_enforcer_token_type, op_response_type>(
+            how_to_run_query,
+            &primaries_to_contact,
+            &results,
+            &failures,
+            order_token,
+            i,
+            interruptor);
+        if (shard_usages != nullptr) {
+            shard_start_nanos[i] = start_nanos;
+            shard_nanos[i] = get_ticks().nanos - start_nanos;
+        }
+    });
 
     if (interruptor->is_pulsed()) throw interrupted_exc_t();
 
@@ -281,6 +390,18 @@ void table_query_client_t::dispatch_immediate_op(
         throw *first_failure;
     }
 
+    if (shard_usages != nullptr) {
+        for (size_t i = 0; i < primaries_to_contact.size()
+                 && shard_usages->size() < SLOW_QUERY_LOG_MAX_SHARDS; ++i) {
+            shard_usages->push_back(shard_usage_t{
+                key_range_to_string(primaries_to_contact[i]->region.inner),
+                shard_start_nanos[i],
+                shard_start_nanos[i] - route_start_nanos,
+                shard_nanos[i],
+                results[i].resource_usage});
+        }
+    }
+
     op.unshard(results.data(), results.size(), response, ctx, interruptor);
 }
 
@@ -360,8 +481,19 @@ void table_query_client_t::dispatch_outdated_read(
                 }
             }
             if (!chosen_relationship && !potential_relationships.empty()) {
-                chosen_relationship
-                    = potential_relationships[randint(potential_relationships.size())];
+                /* Prefer the replicas that have been answering our outdated reads the
+                fastest, which are usually the ones closest to us on the network. We
+                pick two replicas at random and use the faster one. That sends most
+                reads to the closest replicas without piling all of them onto one, and
+                keeps measuring the others. A replica we haven't measured yet counts as
+                the fastest, so that we try it. */
+                relationship_t *first =
+                    potential_relationships[randint(potential_relationships.size())];
+                relationship_t *second =
+                    potential_relationships[randint(potential_relationships.size())];
+                chosen_relationship =
+                    first->outdated_read_micros <= second->outdated_read_micros
+                        ? first : second;
             }
             if (!chosen_relationship) {
                 /* Don't bother looking for masters; if there are no direct
@@ -370,6 +502,7 @@ void table_query_client_t::dispatch_outdated_read(
                     "no replica is available",
                     query_state_t::FAILED);
             }
+            new_op_info->relationship = chosen_relationship;
             new_op_info->direct_bcard = chosen_relationship->direct_bcard;
             new_op_info->keepalive = auto_drainer_t::lock_t(
                 &chosen_relationship->drainer);
@@ -412,6 +545,7 @@ void table_query_client_t::perform_outdated_read(
                 done.pulse();
             });
 
+        kiloticks_t start = get_kiloticks();
         send(mailbox_manager,
             replica_to_contact->direct_bcard->read_mailbox,
             replica_to_contact->sharded_op,
@@ -422,6 +556,13 @@ void table_query_client_t::perform_outdated_read(
             /* `wait_interruptible()` returned because
             `replica_to_contact->keepalive.get_drain_signal()` was pulsed */
             failures->at(i).assign("lost contact with replica");
+        } else {
+            /* `keepalive` keeps the relationship alive, so it's safe to update. */
+            double micros = get_kiloticks().micros - start.micros;
+            double *average = &replica_to_contact->relationship->outdated_read_micros;
+            *average = *average == 0
+                ? micros
+                : *average + OUTDATED_READ_LATENCY_WEIGHT * (micros - *average);
         }
     } catch (const interrupted_exc_t &) {
         /* Return immediately. `dispatch_immediate_op()` will notice that the
@@ -553,6 +694,7 @@ void table_query_client_t::relationship_coroutine(
         } else {
             relationship_record.direct_bcard = nullptr;
         }
+        relationship_record.outdated_read_micros = 0;
 
         region_map_set_membership_t<relationship_t *> relationship_map_insertion(
             &relationships, bcard.region, &relationship_record);
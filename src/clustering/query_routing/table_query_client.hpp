@@ -4,7 +4,9 @@
 
 #include <math.h>
 
+#include <atomic>
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 #include <set>
@@ -21,6 +23,10 @@ class multi_table_manager_t;
 class primary_query_client_t;
 class table_meta_client_t;
 
+/* The most primary keys a `get_all` may look up and still share its read with other
+identical reads when read coalescing is on. */
+#define COALESCED_READ_MAX_KEYS 16
+
 /* `table_query_client_t` is responsible for sending queries to the cluster. It
 instantiates `primary_query_client_t` and `direct_query_client_t` internally; it covers
 the entire table whereas they cover single shards. */
@@ -67,13 +73,36 @@ public:
 
     std::set<region_t> get_sharding_scheme() THROWS_ONLY(cannot_perform_query_exc_t);
 
+    /* With read coalescing on, identical point reads and small `get_all`s with the
+    `single` or `outdated` read mode that arrive while one of them is in flight on the
+    same thread wait for it and share its response, instead of each going to the
+    shards.  They may then miss writes that were acknowledged after the shared read
+    was sent, so it's off by default. */
+    static void set_coalesce_reads(bool coalesce) {
+        coalesce_reads.store(coalesce, std::memory_order_relaxed);
+    }
+
 private:
+    struct coalesced_read_t;
+
+    static std::atomic<bool> coalesce_reads;
+
+    void dispatch_read(
+            const read_t &r,
+            read_response_t *response,
+            order_token_t order_token,
+            signal_t *interruptor)
+        THROWS_ONLY(interrupted_exc_t, cannot_perform_query_exc_t);
+
     class relationship_t {
     public:
         bool is_local;
         region_t region;
         primary_query_client_t *primary_client;
         const direct_query_bcard_t *direct_bcard;
+        /* A moving average of how long outdated reads sent to this replica took to
+        come back, in microseconds, or zero if we haven't sent it any yet. */
+        double outdated_read_micros;
         auto_drainer_t drainer;
     };
 
@@ -85,6 +114,7 @@ private:
     class immediate_op_info_t {
     public:
         op_type sharded_op;
+        region_t region;
         primary_query_client_t *primary_client;
         fifo_enforcer_token_type enforcement_token;
         auto_drainer_t::lock_t keepalive;
@@ -93,6 +123,7 @@ private:
     class outdated_read_info_t {
     public:
         read_t sharded_op;
+        relationship_t *relationship;
         const direct_query_bcard_t *direct_bcard;
         auto_drainer_t::lock_t keepalive;
     };
@@ -172,6 +203,9 @@ private:
     int start_count;
     bool starting_up;
 
+    /* The reads we're coalescing, keyed by their serialized `read_t`. */
+    std::map<std::vector<char>, std::shared_ptr<coalesced_read_t> > coalesced_reads;
+
     auto_drainer_t relationship_coroutine_auto_drainer;
 
     watchable_map_t<std::pair<peer_id_t, uuid_u>, table_query_bcard_t>::all_subs_t subs;
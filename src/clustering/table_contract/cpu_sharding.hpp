@@ -8,7 +8,12 @@
 
 class store_t;
 
-/* Changing this number would break backwards compatibility in the disk format. */
+/* Changing this number would break backwards compatibility in the disk format.  It
+would also break clusters whose servers disagree about it, since contracts are split
+into CPU shards.  The number of cores that a table uses still follows the host: the
+stores' threads are picked by the `thread_allocator_t`, so on a small host several
+stores share a thread, and on a big host different tables' stores are on different
+threads. */
 #define CPU_SHARDING_FACTOR 8
 
 /* `cpu_sharding_subspace()` returns a `region_t` that contains the full key-range space
@@ -124,6 +124,9 @@ void calculate_emergency_repair(
             old_state.config.config.write_ack_config;
         new_state_out->config.config.durability = old_state.config.config.durability;
         new_state_out->config.config.user_data = old_state.config.config.user_data;
+        new_state_out->config.config.storage = old_state.config.config.storage;
+        new_state_out->config.config.expiry = old_state.config.config.expiry;
+        new_state_out->config.config.cache = old_state.config.config.cache;
 
         /* We first calculate all the voting and nonvoting replicas for each range in a
         `range_map_t`. */
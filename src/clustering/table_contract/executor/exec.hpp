@@ -11,6 +11,7 @@
 
 class backfill_progress_tracker_t;
 class backfill_throttler_t;
+class expiry_progress_tracker_t;
 class io_backender_t;
 
 /* `contract_execution_bcard_t`s are passed around between the `contract_executor_t`s for
@@ -40,6 +41,7 @@ public:
         io_backender_t *io_backender;
         backfill_progress_tracker_t *backfill_progress_tracker;
         backfill_throttler_t *backfill_throttler;
+        expiry_progress_tracker_t *expiry_progress_tracker;
         watchable_map_t<std::pair<server_id_t, branch_id_t>,
             contract_execution_bcard_t> *remote_contract_execution_bcards;
         watchable_map_var_t<std::pair<server_id_t, branch_id_t>,
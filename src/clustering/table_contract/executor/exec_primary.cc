@@ -6,8 +6,12 @@
 #include "clustering/immediate_consistency/primary_dispatcher.hpp"
 #include "clustering/immediate_consistency/remote_replicator_server.hpp"
 #include "clustering/query_routing/direct_query_server.hpp"
+#include "clustering/table_manager/expiry_progress_tracker.hpp"
 #include "concurrency/cross_thread_signal.hpp"
 #include "concurrency/promise.hpp"
+#include "rdb_protocol/distribution_progress.hpp"
+#include "rdb_protocol/func.hpp"
+#include "rdb_protocol/pseudo_time.hpp"
 #include "store_view.hpp"
 
 primary_execution_t::primary_execution_t(
@@ -23,7 +27,8 @@ primary_execution_t::primary_execution_t(
     guarantee(raft_state.contracts.at(contract_id).first == region);
     latest_contract_home_thread = make_counted<contract_info_t>(
         contract_id, contract, raft_state.config.config.durability,
-        raft_state.config.config.write_ack_config);
+        raft_state.config.config.write_ack_config, raft_state.config.config.expiry,
+        raft_state.config.config.basic.primary_key);
     latest_contract_store_thread = latest_contract_home_thread;
     begin_write_mutex_assertion.rethread(store->home_thread());
     coro_t::spawn_sometime(std::bind(&primary_execution_t::run, this, drainer.lock()));
@@ -70,7 +75,9 @@ void primary_execution_t::update_contract_or_raft_state(
         contract_id,
         contract,
         raft_state.config.config.durability,
-        raft_state.config.config.write_ack_config);
+        raft_state.config.config.write_ack_config,
+        raft_state.config.config.expiry,
+        raft_state.config.config.basic.primary_key);
 
     /* Exit early if there aren't actually any changes. This is for performance reasons.
     */
@@ -124,6 +131,9 @@ void primary_execution_t::run(auto_drainer_t::lock_t keepalive) {
         perfmon_membership_t perfmon_membership(params->get_parent_perfmon_collection(),
                                                 &perfmon_collection,
                                                 params->get_perfmon_name());
+        perfmon_string_t key_range_perfmon(key_range_to_string(region.inner));
+        perfmon_membership_t key_range_membership(&perfmon_collection,
+                                                  &key_range_perfmon, "key_range");
 
         primary_dispatcher_t primary_dispatcher(&perfmon_collection, initial_version);
 
@@ -239,14 +249,156 @@ void primary_execution_t::run(auto_drainer_t::lock_t keepalive) {
             directory_entry_primary(
                 context->local_table_query_bcards, generate_uuid(), tq_bcard_primary);
 
-        /* Wait until we are no longer the primary, or it's time to shut down */
-        keepalive.get_drain_signal()->wait_lazily_unordered();
+        /* Delete expired rows until we are no longer the primary, or it's time to
+        shut down */
+        on_thread_t thread_switcher_5(store->home_thread());
+        expire_rows(&interruptor_store_thread);
 
     } catch (const interrupted_exc_t &) {
         /* do nothing */
     }
 }
 
+void primary_execution_t::expire_rows(signal_t *interruptor) {
+    store->assert_thread();
+    while (true) {
+        counted_t<contract_info_t> contract_snapshot = latest_contract_store_thread;
+        if (contract_snapshot->expiry.is_enabled()) {
+            expire_rows_pass(
+                contract_snapshot->expiry, contract_snapshot->primary_key, interruptor);
+        }
+        nap(EXPIRY_PASS_INTERVAL_MS, interruptor);
+    }
+}
+
+void primary_execution_t::expire_rows_pass(
+        const table_expiry_config_t &expiry,
+        const std::string &primary_key,
+        signal_t *interruptor) {
+    store->assert_thread();
+
+    expiry_progress_tracker_t::entry_t tracker_entry(
+        context->expiry_progress_tracker, region);
+    expiry_progress_tracker_t::progress_tracker_t *progress_tracker =
+        tracker_entry.get();
+    progress_tracker->start_time = current_microtime();
+    distribution_progress_estimator_t progress_estimator(store, interruptor);
+
+    /* The whole pass uses the same cutoff. The delete function checks the row against
+    it again, so a row that gets updated between our read and our write isn't deleted
+    unless it's still expired. */
+    ql::datum_t now = ql::pseudo::time_now();
+    ql::datum_t cutoff = ql::pseudo::make_time(
+        ql::pseudo::time_to_epoch_time(now) - expiry.seconds, "+00:00");
+    datum_string_t field(expiry.field);
+    serializable_env_t serializable_env{
+        ql::global_optargs_t(),
+        auth::user_context_t(auth::permissions_t(
+            tribool::True, tribool::True, tribool::False, tribool::False)),
+        now};
+
+    store_key_t next_key = region.inner.left;
+    while (true) {
+        region_t scan_region = region;
+        scan_region.inner.left = next_key;
+        rget_read_t rget(
+            optional<changefeed_stamp_t>(),
+            scan_region,
+            r_nullopt,
+            r_nullopt,
+            serializable_env,
+            "",
+            ql::batchspec_t::all().with_at_most(EXPIRY_SCAN_BATCH_SIZE),
+            std::vector<ql::transform_variant_t>(),
+            optional<ql::terminal_variant_t>(),
+            optional<sindex_rangespec_t>(),
+            sorting_t::ASCENDING);
+        rget.current_shard.set(region);
+
+        read_response_t read_response;
+        {
+            /* We read straight from our store, so we don't need a token. */
+            read_token_t token;
+#ifndef NDEBUG
+            metainfo_checker_t metainfo_checker(region,
+                [](const region_t &, const binary_blob_t &) { });
+#endif
+            store->read(DEBUG_ONLY(metainfo_checker, )
+                        read_t(std::move(rget), profile_bool_t::DONT_PROFILE,
+                               read_mode_t::SINGLE),
+                        &read_response,
+                        &token,
+                        interruptor);
+        }
+        rget_read_response_t *rget_response =
+            boost::get<rget_read_response_t>(&read_response.response);
+        guarantee(rget_response != nullptr);
+        ql::grouped_t<ql::stream_t> *groups =
+            boost::get<ql::grouped_t<ql::stream_t> >(&rget_response->result);
+        if (groups == nullptr) {
+            /* The read failed; we'll try again on the next pass. */
+            return;
+        }
+
+        /* If the read returned no rows, there are none left in our region. Otherwise
+        `last_key` is the maximum key if the read reached the end of the region, or
+        the last key it read if it stopped early. */
+        store_key_t last_key = store_key_t::max();
+        std::vector<store_key_t> expired_keys;
+        for (auto &&group : *groups) {
+            for (auto &&substream : group.second.substreams) {
+                for (const ql::rget_item_t &item : substream.second.stream) {
+                    ql::datum_t value = item.data.get_field(field, ql::NOTHROW);
+                    if (value.has() && value.is_ptype(ql::pseudo::time_string) &&
+                            ql::pseudo::time_cmp(value, cutoff) < 0) {
+                        expired_keys.push_back(item.key);
+                    }
+                }
+                last_key = substream.second.last_key;
+            }
+        }
+
+        if (!expired_keys.empty()) {
+            write_t write(
+                batched_replace_t(
+                    std::move(expired_keys),
+                    primary_key,
+                    ql::new_expired_row_delete_func(
+                        ql::datum_t(field), cutoff, ql::backtrace_id_t::empty()),
+                    r_nullopt,
+                    serializable_env,
+                    return_changes_t::NO),
+                DURABILITY_REQUIREMENT_DEFAULT,
+                profile_bool_t::DONT_PROFILE,
+                ql::configured_limits_t::unlimited);
+            write_response_t write_response;
+            if (!spawn_internal_write(write, interruptor, &write_response)) {
+                /* We can't write right now; we'll try again on the next pass. */
+                return;
+            }
+            const ql::datum_t *stats =
+                boost::get<batched_replace_response_t>(&write_response.response);
+            if (stats != nullptr) {
+                ql::datum_t deleted = stats->get_field("deleted", ql::NOTHROW);
+                if (deleted.has() && deleted.get_type() == ql::datum_t::R_NUM) {
+                    progress_tracker->rows_expired += deleted.as_num();
+                }
+            }
+        }
+
+        next_key = last_key;
+        if (last_key == store_key_t::max() || !next_key.increment() ||
+                !region.inner.contains_key(next_key)) {
+            progress_tracker->progress = 1.0;
+            break;
+        }
+        progress_tracker->progress = progress_estimator.estimate_progress(last_key);
+
+        /* Leave room for the other queries between batches */
+        nap(EXPIRY_BATCH_DELAY_MS, interruptor);
+    }
+}
+
 /* `write_callback_t` waits until the query is safe to ack, then pulses `done`. */
 class primary_execution_t::write_callback_t : public primary_dispatcher_t::write_callback_t {
 public:
@@ -293,6 +445,38 @@ private:
     write_response_t *response_out;
 };
 
+bool primary_execution_t::spawn_internal_write(
+        const write_t &request,
+        signal_t *interruptor,
+        write_response_t *response_out) {
+    store->assert_thread();
+    guarantee(our_dispatcher != nullptr);
+
+    /* See the comments in `on_write()` for an explanation about why we're acquiring
+    `begin_write_mutex_assertion` here and what we check before spawning the write. */
+    mutex_assertion_t::acq_t begin_write_mutex_acq(&begin_write_mutex_assertion);
+    DEBUG_ONLY(scoped_ptr_t<assert_finite_coro_waiting_t> finite_coro_waiting(
+                   make_scoped<assert_finite_coro_waiting_t>(__FILE__, __LINE__)));
+    counted_t<contract_info_t> contract_snapshot = latest_contract_store_thread;
+
+    if (static_cast<bool>(contract_snapshot->contract.primary->hand_over) ||
+            !is_majority_available(contract_snapshot, our_dispatcher)) {
+        return false;
+    }
+
+    write_callback_t write_callback(response_out,
+                                    contract_snapshot->default_write_durability,
+                                    contract_snapshot->write_ack_config,
+                                    &contract_snapshot->contract);
+    our_dispatcher->spawn_write(request, order_token_t::ignore, &write_callback);
+
+    DEBUG_ONLY(finite_coro_waiting.reset());
+    begin_write_mutex_acq.reset();
+
+    wait_interruptible(write_callback.result.get_ready_signal(), interruptor);
+    return write_callback.result.assert_get_value();
+}
+
 bool primary_execution_t::on_write(
         const write_t &request,
         fifo_enforcer_sink_t::exit_write_t *exiter,
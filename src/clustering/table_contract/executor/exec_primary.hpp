@@ -64,23 +64,30 @@ private:
         contract_info_t(const contract_id_t &_contract_id,
                         const contract_t &_contract,
                         write_durability_t _default_write_durability,
-                        write_ack_config_t _write_ack_config) :
+                        write_ack_config_t _write_ack_config,
+                        const table_expiry_config_t &_expiry,
+                        const std::string &_primary_key) :
                 contract_id(_contract_id),
                 contract(_contract),
                 default_write_durability(_default_write_durability),
-                write_ack_config(_write_ack_config) {
+                write_ack_config(_write_ack_config),
+                expiry(_expiry),
+                primary_key(_primary_key) {
         }
         bool equivalent(const contract_info_t &other) const {
             /* This method is called `equivalent` rather than `operator==` to avoid
             confusion, because it doesn't actually compare every member */
             return contract_id == other.contract_id &&
                 default_write_durability == other.default_write_durability &&
-                write_ack_config == other.write_ack_config;
+                write_ack_config == other.write_ack_config &&
+                expiry == other.expiry;
         }
         contract_id_t contract_id;
         contract_t contract;
         write_durability_t default_write_durability;
         write_ack_config_t write_ack_config;
+        table_expiry_config_t expiry;
+        std::string primary_key;
         cond_t obsolete;
     };
 
@@ -88,6 +95,26 @@ private:
     broadcaster, listener, etc. */
     void run(auto_drainer_t::lock_t keepalive);
 
+    /* `expire_rows()` is called by `run()` on the store's thread once the primary is
+    set up, and doesn't return until it's interrupted. If the table has expiry
+    configured, it periodically scans our region in primary key order and deletes the
+    expired rows in batches, using ordinary writes so that they get replicated. */
+    void expire_rows(signal_t *interruptor);
+
+    /* `expire_rows_pass()` makes one pass over our region. */
+    void expire_rows_pass(
+        const table_expiry_config_t &expiry,
+        const std::string &primary_key,
+        signal_t *interruptor);
+
+    /* `spawn_internal_write()` sends a write we generated ourselves through the
+    dispatcher like `on_write()` does, and waits for it to be acked. It returns `false`
+    if the write couldn't be performed or may not have been performed. */
+    bool spawn_internal_write(
+        const write_t &request,
+        signal_t *interruptor,
+        write_response_t *response_out);
+
     /* These override virtual methods on `master_t::query_callback_t`. They get called
     when we receive queries over the network. Warning: They are run on the store's home
     thread, which is not necessarily our home thread. */
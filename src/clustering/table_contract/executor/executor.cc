@@ -127,6 +127,7 @@ contract_executor_t::contract_executor_t(
         io_backender_t *_io_backender,
         backfill_throttler_t *_backfill_throttler,
         backfill_progress_tracker_t *_backfill_progress_tracker,
+        expiry_progress_tracker_t *_expiry_progress_tracker,
         perfmon_collection_t *_perfmons) :
     server_id(_server_id),
     raft_state(_raft_state),
@@ -149,6 +150,7 @@ contract_executor_t::contract_executor_t(
     execution_context.io_backender = _io_backender;
     execution_context.backfill_progress_tracker = _backfill_progress_tracker;
     execution_context.backfill_throttler = _backfill_throttler;
+    execution_context.expiry_progress_tracker = _expiry_progress_tracker;
     execution_context.remote_contract_execution_bcards
         = _remote_contract_execution_bcards;
     execution_context.local_contract_execution_bcards
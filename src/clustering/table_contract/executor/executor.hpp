@@ -11,6 +11,7 @@
 #include "store_subview.hpp"
 
 class backfill_progress_tracker_t;
+class expiry_progress_tracker_t;
 
 /* The `contract_executor_t` is responsible for executing the instructions contained in
 the `contract_t`s in the `table_raft_state_t`. Each server has one `contract_executor_t`
@@ -34,6 +35,7 @@ public:
         io_backender_t *io_backender,
         backfill_throttler_t *backfill_throttler,
         backfill_progress_tracker_t *backfill_progress_tracker,
+        expiry_progress_tracker_t *expiry_progress_tracker,
         perfmon_collection_t *perfmons);
     ~contract_executor_t();
 
@@ -0,0 +1,33 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+
+#include "clustering/table_manager/expiry_progress_tracker.hpp"
+
+expiry_progress_tracker_t::entry_t::entry_t(
+        expiry_progress_tracker_t *_parent, const region_t &_region) :
+    parent(_parent), region(_region) {
+    auto res = parent->progress_trackers.get()->insert(
+        std::make_pair(region, expiry_progress_tracker_t::progress_tracker_t()));
+    guarantee(res.second);
+    tracker = &res.first->second;
+}
+
+expiry_progress_tracker_t::entry_t::~entry_t() {
+    parent->progress_trackers.get()->erase(region);
+}
+
+std::map<region_t, expiry_progress_tracker_t::progress_tracker_t>
+expiry_progress_tracker_t::get_progress_trackers() {
+    std::map<region_t, progress_tracker_t> output;
+    pmap(get_num_threads(), [&](int thread) {
+        std::map<region_t, progress_tracker_t> inner;
+        {
+            on_thread_t on_thread((threadnum_t(thread)));
+            inner = *progress_trackers.get();
+        }
+        for (const auto &pair : inner) {
+            auto res = output.insert(std::move(pair));
+            guarantee(res.second);
+        }
+    });
+    return output;
+}
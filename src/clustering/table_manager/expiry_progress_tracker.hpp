@@ -0,0 +1,46 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef CLUSTERING_TABLE_MANAGER_EXPIRY_PROGRESS_TRACKER_HPP_
+#define CLUSTERING_TABLE_MANAGER_EXPIRY_PROGRESS_TRACKER_HPP_
+
+#include <map>
+
+#include "concurrency/one_per_thread.hpp"
+#include "region/region.hpp"
+#include "time.hpp"
+
+/* `expiry_progress_tracker_t` keeps track of the primaries on this server that are
+deleting expired rows, so that they show up in `rethinkdb.jobs`. */
+class expiry_progress_tracker_t {
+public:
+    class progress_tracker_t {
+    public:
+        progress_tracker_t() : start_time(0), progress(0), rows_expired(0) { }
+        microtime_t start_time;
+        double progress;
+        uint64_t rows_expired;
+    };
+
+    /* An `entry_t` registers a pass over `region` for as long as it exists. It must be
+    destroyed on the thread it was created on. */
+    class entry_t {
+    public:
+        entry_t(expiry_progress_tracker_t *parent, const region_t &region);
+        ~entry_t();
+        progress_tracker_t *get() { return tracker; }
+    private:
+        expiry_progress_tracker_t *parent;
+        region_t region;
+        progress_tracker_t *tracker;
+
+        DISABLE_COPYING(entry_t);
+    };
+
+    std::map<region_t, expiry_progress_tracker_t::progress_tracker_t>
+        get_progress_trackers();
+
+private:
+    one_per_thread_t<std::map<
+        region_t, expiry_progress_tracker_t::progress_tracker_t> > progress_trackers;
+};
+
+#endif /* CLUSTERING_TABLE_MANAGER_EXPIRY_PROGRESS_TRACKER_HPP_ */
@@ -5,8 +5,30 @@
 
 #include "concurrency/cross_thread_signal.hpp"
 #include "concurrency/pmap.hpp"
+#include "config/args.hpp"
 #include "rdb_protocol/store.hpp"
 
+/* Every CPU shard has its own store and cache, so each gets an even share of the
+table's reservation. */
+static uint64_t mb_to_bytes_per_store(double mb) {
+    const double bytes = mb * MEGABYTE / CPU_SHARDING_FACTOR;
+    // Huge values (which the config allows) mean no limit.
+    return bytes < static_cast<double>(INT64_MAX)
+        ? static_cast<uint64_t>(bytes)
+        : UINT64_MAX;
+}
+
+static cache_reservation_t get_cache_reservation_per_store(
+        const table_cache_config_t &cache) {
+    cache_reservation_t reservation;
+    reservation.min_bytes = mb_to_bytes_per_store(cache.min_mb);
+    reservation.max_bytes = cache.max_mb.has_value()
+        ? mb_to_bytes_per_store(*cache.max_mb)
+        : UINT64_MAX;
+    reservation.priority = cache.priority;
+    return reservation;
+}
+
 flush_interval_manager_t::flush_interval_manager_t(
         multistore_ptr_t *multistore_,
         const clone_ptr_t<watchable_t<table_config_t> > &table_config_) :
@@ -21,9 +43,11 @@ flush_interval_manager_t::flush_interval_manager_t(
 
 void flush_interval_manager_t::update_blocking(signal_t *interruptor) {
     flush_interval_t flush_interval;
+    cache_reservation_t reservation;
     table_config->apply_read([&](const table_config_t *config) {
         // HSI: Oh definitely read the value out of the config, thank you.
         flush_interval = get_flush_interval(*config);
+        reservation = get_cache_reservation_per_store(config->cache);
     });
 
     for (size_t i = 0; i < CPU_SHARDING_FACTOR; ++i) {
@@ -32,6 +56,7 @@ void flush_interval_manager_t::update_blocking(signal_t *interruptor) {
         on_thread_t thread_switcher(store->home_thread());
 
         store->configure_flush_interval(flush_interval);
+        store->configure_cache_reservation(reservation);
     }
 }
 
@@ -8,7 +8,9 @@
 #include "concurrency/watchable.hpp"
 
 /* The `flush_interval_manager_t` is responsible for reading the flush interval
-description from the `table_config_t` updating the flush interval on the `store_t`. */
+description from the `table_config_t` updating the flush interval on the `store_t`.
+It does the same for the bulk load fill factor from the table's storage config, and for
+the table's cache reservation, which is split evenly between the CPU shards. */
 
 class flush_interval_manager_t {
 public:
@@ -3,6 +3,8 @@
 
 #include "clustering/generic/raft_core.tcc"
 #include "clustering/table_manager/table_manager.hpp"
+#include "concurrency/pmap.hpp"
+#include "config/args.hpp"
 #include "logger.hpp"
 
 multi_table_manager_t::multi_table_manager_t(
@@ -31,27 +33,36 @@ multi_table_manager_t::multi_table_manager_t(
     io_backender(_io_backender),
     perfmon_collection_repo(_perfmon_collection_repo) {
 
-    /* Resurrect any tables that were sitting on disk from when we last shut down */
+    /* Resurrect any tables that were sitting on disk from when we last shut down. The
+    active ones are loaded by `load_tables()` once we're up. */
     cond_t non_interruptor;
     persistence_interface->read_all_metadata(
         [&](const namespace_id_t &table_id,
                 const table_active_persistent_state_t &state,
                 raft_storage_interface_t<table_raft_state_t> *raft_storage,
-                metadata::read_txn_t *metadata_read_txn) {
+                metadata::read_txn_t *) {
             guarantee(tables.count(table_id) == 0);
             table_t *table;
             tables[table_id].init(table = new table_t);
-            rwlock_acq_t table_lock_acq(&table->access_rwlock, access_t::write);
-            perfmon_collection_repo_t::collections_t *perfmon_collections =
-                perfmon_collection_repo->get_perfmon_collections_for_namespace(table_id);
-            table->status = table_t::status_t::ACTIVE;
-            persistence_interface->load_multistore(
-                table_id, metadata_read_txn, &table->multistore_ptr, &non_interruptor,
-                &perfmon_collections->serializers_collection);
-            table->active = make_scoped<active_table_t>(
-                this, table, table_id, state.epoch, state.raft_member_id, raft_storage,
-                raft_start_election_immediately_t::NO, table->multistore_ptr.get(),
-                &perfmon_collections->namespace_collection);
+            table_load_t load;
+            load.table_id = table_id;
+            load.table = table;
+            load.state = state;
+            load.raft_storage = raft_storage;
+            load.table_lock_acq =
+                make_scoped<rwlock_acq_t>(&table->access_rwlock, access_t::write);
+            table->status = table_t::status_t::LOADING;
+            /* Let the `table_meta_client_t` know about the table while it loads. The
+            `active_table_t` will bring this up to date. */
+            const raft_persistent_state_t<table_raft_state_t> *raft_state =
+                raft_storage->get();
+            multi_table_manager_timestamp_t timestamp;
+            timestamp.epoch = state.epoch;
+            timestamp.log_index = raft_state->log.prev_index;
+            table->basic_configs_entry.create(&table_basic_configs, table_id,
+                std::make_pair(raft_state->snapshot_state.config.config.basic,
+                               timestamp));
+            tables_to_load.push_back(std::move(load));
         },
         [&](const namespace_id_t &table_id,
                 const table_inactive_persistent_state_t &state,
@@ -67,6 +78,11 @@ multi_table_manager_t::multi_table_manager_t(
         &non_interruptor);
 
     help_construct();
+
+    if (!tables_to_load.empty()) {
+        coro_t::spawn_sometime(std::bind(
+            &multi_table_manager_t::load_tables, this, drainer.lock()));
+    }
 }
 
 /* This constructor is used for proxy servers. */
@@ -100,6 +116,9 @@ multi_table_manager_t::~multi_table_manager_t() {
     table_manager_directory_subs.reset();
     multi_table_manager_directory_subs.reset();
 
+    /* Don't wait for tables that haven't started loading yet. */
+    stop_loading.pulse();
+
     /* Next, destroy all of the `active_table_t`s. This is important because otherwise
     `active_table_t` can call `schedule_sync()`. */
     for (auto &&pair : tables) {
@@ -332,6 +351,7 @@ void multi_table_manager_t::on_action(
                 current_timestamp = multi_table_manager_timestamp_t::deletion();
                 break;
             case table_t::status_t::SHUTTING_DOWN:   /* fall through */
+            case table_t::status_t::LOADING:         /* fall through */
             default: unreachable();
         }
         /* Rejecting old actions is absolutely critical for correctness.
@@ -402,6 +422,7 @@ void multi_table_manager_t::on_action(
             cond_t non_interruptor;
             persistence_interface->create_multistore(
                 table_id,
+                initial_raft_state->snapshot_state.config.config.storage,
                 &table->multistore_ptr,
                 &non_interruptor,
                 &perfmon_collections->serializers_collection);
@@ -527,6 +548,49 @@ void multi_table_manager_t::on_action(
     }
 }
 
+void multi_table_manager_t::load_tables(UNUSED auto_drainer_t::lock_t keepalive) {
+    std::vector<table_load_t> loads;
+    std::swap(loads, tables_to_load);
+    ticks_t start_time = get_ticks();
+    throttled_pmap(loads.size(), [&](int64_t i) {
+        load_table(&loads[i]);
+    }, MAX_CONCURRENT_TABLE_LOADS);
+    if (!stop_loading.is_pulsed()) {
+        logINF("Loaded %zu tables in %.1f seconds.", loads.size(),
+            ticks_to_secs(ticks_t{get_ticks().nanos - start_time.nanos}));
+    }
+}
+
+void multi_table_manager_t::load_table(table_load_t *load) {
+    table_t *table = load->table;
+    guarantee(table->status == table_t::status_t::LOADING);
+    if (stop_loading.is_pulsed()) {
+        /* The destructor will take the lock next. */
+        table->status = table_t::status_t::SHUTTING_DOWN;
+        load->table_lock_acq.reset();
+        return;
+    }
+
+    perfmon_collection_repo_t::collections_t *perfmon_collections =
+        perfmon_collection_repo->get_perfmon_collections_for_namespace(load->table_id);
+    /* Don't interrupt here. A table can't be `ACTIVE` without a `multistore_ptr`, and
+    the destructor waits for the lock anyway. */
+    cond_t non_interruptor;
+    persistence_interface->create_multistore(
+        load->table_id, load->raft_storage->get()->snapshot_state.config.config.storage,
+        &table->multistore_ptr, &non_interruptor,
+        &perfmon_collections->serializers_collection);
+    table->status = table_t::status_t::ACTIVE;
+    table->active = make_scoped<active_table_t>(
+        this, table, load->table_id, load->state.epoch, load->state.raft_member_id,
+        load->raft_storage, raft_start_election_immediately_t::NO,
+        table->multistore_ptr.get(), &perfmon_collections->namespace_collection);
+
+    /* Any syncs that were scheduled while the table was loading have been waiting for
+    the lock, so they go out now. */
+    load->table_lock_acq.reset();
+}
+
 void multi_table_manager_t::on_get_status(
         signal_t *interruptor,
         const multi_table_manager_bcard_t::get_status_message_t &msg) {
@@ -541,7 +605,9 @@ void multi_table_manager_t::on_get_status(
         /* Fetch information for a specific table. */
         mutex_assertion_t::acq_t global_mutex_acq(&mutex);
         auto it = tables.find(table_id);
-        if (it != tables.end()) {
+        /* A table that's still loading has no status yet; the servers asking will see
+        our replicas of it as `transitioning`. */
+        if (it != tables.end() && it->second->status != table_t::status_t::LOADING) {
             rwlock_in_line_t table_lock_in_line(&it->second->access_rwlock, access_t::read);
             global_mutex_acq.reset();
             wait_interruptible(table_lock_in_line.read_signal(), interruptor);
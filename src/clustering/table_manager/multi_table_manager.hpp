@@ -6,6 +6,7 @@
 #include "clustering/immediate_consistency/standard_backfill_throttler.hpp"
 #include "clustering/table_contract/cpu_sharding.hpp"
 #include "clustering/table_manager/table_manager.hpp"
+#include "concurrency/cond_var.hpp"
 #include "concurrency/rwlock.hpp"
 #include "containers/optional.hpp"
 
@@ -131,8 +132,11 @@ public:
         std::map<namespace_id_t, scoped_ptr_t<rwlock_in_line_t> >
             table_lock_in_lines;
         for (const auto &pair : tables) {
-            table_lock_in_lines[pair.first] =
-                make_scoped<rwlock_in_line_t>(&pair.second->access_rwlock, access);
+            /* Tables that are still loading are skipped rather than waited for. */
+            if (pair.second->status != table_t::status_t::LOADING) {
+                table_lock_in_lines[pair.first] =
+                    make_scoped<rwlock_in_line_t>(&pair.second->access_rwlock, access);
+            }
         }
         global_mutex_acq.reset();
         for (const auto &pair : table_lock_in_lines) {
@@ -175,6 +179,10 @@ public:
             return;
         }
         table_t *table = it->second.get();
+        if (table->status == table_t::status_t::LOADING) {
+            callable(nullptr, nullptr);
+            return;
+        }
         rwlock_in_line_t lock_in_line(&table->access_rwlock, access);
         global_mutex_acq.reset();
         switch (access) {
@@ -215,6 +223,12 @@ private:
         `tables` map with status `DELETED`. We don't record anything on disk for the
         table. This means that if we restart, we'll forget that it ever existed and
         return to the first state in this list.
+
+    5. We are a replica for the table, but we just started up and haven't opened the
+        table's files yet. In this case, we store a `table_t` with status `LOADING`,
+        whose `access_rwlock` is held by `load_tables()` until the table is in the
+        `ACTIVE` state. The tables are opened a few at a time, so that each one becomes
+        available as soon as it's ready rather than after all of them are.
     */
 
     class table_t;
@@ -282,7 +296,7 @@ private:
     replica for this table. */
     class table_t {
     public:
-        enum class status_t { ACTIVE, INACTIVE, DELETED, SHUTTING_DOWN };
+        enum class status_t { ACTIVE, INACTIVE, DELETED, SHUTTING_DOWN, LOADING };
 
         table_t() : sync_coro_running(false) { }
 
@@ -294,7 +308,8 @@ private:
         bool sync_coro_running;
 
         /* You must hold this lock to access the other fields of the `table_t` except
-        for `to_sync_set` and `sync_coro_running` */
+        for `to_sync_set` and `sync_coro_running`. You may also check whether `status`
+        is `LOADING` without it; that way you can avoid waiting for a table to load. */
         rwlock_t access_rwlock;
 
         status_t status;
@@ -365,6 +380,21 @@ private:
         table_t *table,
         const peer_id_t &peer_id);
 
+    /* `load_tables()` opens the files of the tables in `tables_to_load`,
+    MAX_CONCURRENT_TABLE_LOADS at a time, and makes each table `ACTIVE` when it's done.
+    It's spawned by the constructor. */
+    class table_load_t {
+    public:
+        namespace_id_t table_id;
+        table_t *table;
+        table_active_persistent_state_t state;
+        raft_storage_interface_t<table_raft_state_t> *raft_storage;
+        /* Held from the constructor until the table is loaded. */
+        scoped_ptr_t<rwlock_acq_t> table_lock_acq;
+    };
+    void load_tables(auto_drainer_t::lock_t keepalive);
+    void load_table(table_load_t *load);
+
     /* If we're a proxy server, then `is_proxy_server` will be `true`; `server_id` will
     be `nil_uuid()`; `persistence_interface` will be `nullptr`; `base_path` will be
     empty; and `io_backender` will be `nullptr`. */
@@ -417,6 +447,11 @@ private:
     */
     mutex_assertion_t mutex;
 
+    std::vector<table_load_t> tables_to_load;
+    /* Pulsed by the destructor, so that `load_tables()` gives up on the tables it hasn't
+    started loading yet. */
+    cond_t stop_loading;
+
     auto_drainer_t drainer;
 
     scoped_ptr_t<watchable_map_t<peer_id_t, multi_table_manager_bcard_t>::all_subs_t>
@@ -45,7 +45,7 @@ table_manager_t::table_manager_t(
             }),
         execution_bcard_read_manager.get_values(), multistore_ptr, _base_path,
         _io_backender, _backfill_throttler, &backfill_progress_tracker,
-        &perfmon_collection),
+        &expiry_progress_tracker, &perfmon_collection),
     execution_bcard_write_manager(
         mailbox_manager,
         contract_executor.get_local_contract_execution_bcards(),
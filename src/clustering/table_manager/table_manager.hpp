@@ -5,6 +5,7 @@
 #include "clustering/table_contract/coordinator/coordinator.hpp"
 #include "clustering/table_contract/executor/executor.hpp"
 #include "clustering/table_manager/backfill_progress_tracker.hpp"
+#include "clustering/table_manager/expiry_progress_tracker.hpp"
 #include "clustering/table_manager/flush_interval_manager.hpp"
 #include "clustering/table_manager/server_name_cache_updater.hpp"
 #include "clustering/table_manager/sindex_manager.hpp"
@@ -57,6 +58,10 @@ public:
         return backfill_progress_tracker;
     }
 
+    expiry_progress_tracker_t &get_expiry_progress_tracker() {
+        return expiry_progress_tracker;
+    }
+
     const sindex_manager_t &get_sindex_manager() const {
         return sindex_manager;
     }
@@ -161,6 +166,10 @@ private:
     `contract_executor`. */
     backfill_progress_tracker_t backfill_progress_tracker;
 
+    /* The `expiry_progress_tracker` keeps track of the primaries that are deleting
+    expired rows. This must also be destructed after the `contract_executor`. */
+    expiry_progress_tracker_t expiry_progress_tracker;
+
     /* The `contract_executor_t` creates and destroys `broadcaster_t`s,
     `listener_t`s, etc. to handle queries. */
     contract_executor_t contract_executor;
@@ -182,7 +191,7 @@ private:
     sindex_manager_t sindex_manager;
 
     /* The `flush_interval_manager` watches the `table_config_t` and changes the flush
-    interval according to what it sees. */
+    interval and the cache reservation according to what it sees. */
     flush_interval_manager_t flush_interval_manager;
 
     auto_drainer_t drainer;
@@ -344,14 +344,13 @@ public:
     virtual void delete_metadata(
         const namespace_id_t &table_id) = 0;
 
-    virtual void load_multistore(
-        const namespace_id_t &table_id,
-        metadata::read_txn_t *metadata_read_txn,
-        scoped_ptr_t<multistore_ptr_t> *multistore_ptr_out,
-        signal_t *interruptor,
-        perfmon_collection_t *perfmon_collection_serializers) = 0;
+    /* `create_multistore()` opens the table's files, or creates them if they don't
+    exist yet, in which case `storage_config` determines their layout. It doesn't keep
+    the metadata locked while it opens the files, so several tables can be opened at
+    once without holding up metadata writes. */
     virtual void create_multistore(
         const namespace_id_t &table_id,
+        const table_storage_config_t &storage_config,
         scoped_ptr_t<multistore_ptr_t> *multistore_ptr_out,
         signal_t *interruptor,
         perfmon_collection_t *perfmon_collection_serializers) = 0;
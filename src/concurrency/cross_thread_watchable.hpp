@@ -2,6 +2,8 @@
 #ifndef CONCURRENCY_CROSS_THREAD_WATCHABLE_HPP_
 #define CONCURRENCY_CROSS_THREAD_WATCHABLE_HPP_
 
+#include <memory>
+
 #include "arch/runtime/runtime.hpp"
 #include "concurrency/watchable.hpp"
 #include "concurrency/watchable_map.hpp"
@@ -18,6 +20,31 @@ usable on the `_dest_thread` that you passed to the constructor.
 
 See also: `cross_thread_signal_t`, which is the same thing for `signal_t`. */
 
+/* `watchable_snapshot_t` keeps an immutable copy of a watchable's value, which it
+makes the first time it's asked for one after the value changes.  The
+`cross_thread_watchable_variable_t`s that proxy a watchable to several threads can
+share one, so that a change is copied once instead of once per thread.  Create and
+destroy it on the watchable's thread.  The copy is read on several threads at once,
+so the value mustn't hold anything with a non-atomic reference count. */
+template <class value_t>
+class watchable_snapshot_t {
+public:
+    explicit watchable_snapshot_t(const clone_ptr_t<watchable_t<value_t> > &watchable);
+
+    clone_ptr_t<watchable_t<value_t> > get_original() const {
+        return original;
+    }
+
+    std::shared_ptr<const value_t> get();
+
+private:
+    clone_ptr_t<watchable_t<value_t> > original;
+    std::shared_ptr<const value_t> snapshot;
+    typename watchable_t<value_t>::subscription_t subs;
+
+    DISABLE_COPYING(watchable_snapshot_t);
+};
+
 template <class value_t>
 class cross_thread_watchable_variable_t
 {
@@ -26,6 +53,11 @@ public:
         const clone_ptr_t<watchable_t<value_t> > &watchable,
         threadnum_t _dest_thread);
 
+    /* Gets its values from `snapshot`, which must outlive it. */
+    cross_thread_watchable_variable_t(
+        watchable_snapshot_t<value_t> *snapshot,
+        threadnum_t _dest_thread);
+
     clone_ptr_t<watchable_t<value_t> > get_watchable() {
         return clone_ptr_t<watchable_t<value_t> >(watchable.clone());
     }
@@ -35,7 +67,7 @@ public:
     template <class Callable>
     void apply_read(Callable &&read) {
         ASSERT_NO_CORO_WAITING;
-        const value_t *const_value = &value;
+        const value_t *const_value = value.get();
         read(const_value);
     }
 
@@ -51,7 +83,7 @@ private:
             return new w_t(parent);
         }
         value_t get() {
-            return parent->value;
+            return *parent->value;
         }
         void apply_read(const std::function<void(const value_t*)> &read) {
             return parent->apply_read(read);
@@ -68,10 +100,13 @@ private:
         cross_thread_watchable_variable_t<value_t> *parent;
     };
 
+    /* `snapshot` is `own_snapshot` unless it was passed to the constructor. */
+    scoped_ptr_t<watchable_snapshot_t<value_t> > own_snapshot;
+    watchable_snapshot_t<value_t> *snapshot;
     clone_ptr_t<watchable_t<value_t> > original;
     publisher_controller_t<std::function<void()> > publisher_controller;
     rwi_lock_assertion_t rwi_lock_assertion;
-    value_t value;
+    std::shared_ptr<const value_t> value;
     w_t watchable;
 
     threadnum_t watchable_thread;
@@ -111,7 +146,7 @@ private:
 /* `all_thread_watchable_variable_t` is like a `cross_thread_watchable_variable_t` except
 that `get_watchable()` works on every thread, not just a specified thread. Internally it
 constructs one `cross_thread_watchable_variable_t` for each thread, so it's a pretty
-heavy-weight object. */
+heavy-weight object, although they share one `watchable_snapshot_t`. */
 
 template<class value_t>
 class all_thread_watchable_variable_t {
@@ -122,6 +157,7 @@ public:
         return vars[get_thread_id().threadnum]->get_watchable();
     }
 private:
+    watchable_snapshot_t<value_t> snapshot;
     std::vector<scoped_ptr_t<cross_thread_watchable_variable_t<value_t> > > vars;
 };
 
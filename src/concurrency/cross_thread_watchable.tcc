@@ -1,11 +1,40 @@
 // Copyright 2010-2012 RethinkDB, all rights reserved.
 #include <functional>
 
+template <class value_t>
+watchable_snapshot_t<value_t>::watchable_snapshot_t(
+        const clone_ptr_t<watchable_t<value_t> > &watchable) :
+    original(watchable),
+    subs([this]() { snapshot.reset(); })
+{
+    typename watchable_t<value_t>::freeze_t freeze(original);
+    subs.reset(original, &freeze);
+}
+
+template <class value_t>
+std::shared_ptr<const value_t> watchable_snapshot_t<value_t>::get() {
+    original->assert_thread();
+    if (!snapshot) {
+        snapshot = std::make_shared<const value_t>(original->get());
+    }
+    return snapshot;
+}
+
 template <class value_t>
 cross_thread_watchable_variable_t<value_t>::cross_thread_watchable_variable_t(
         const clone_ptr_t<watchable_t<value_t> > &w,
         threadnum_t _dest_thread) :
-    original(w),
+    cross_thread_watchable_variable_t(new watchable_snapshot_t<value_t>(w), _dest_thread)
+{
+    own_snapshot.init(snapshot);
+}
+
+template <class value_t>
+cross_thread_watchable_variable_t<value_t>::cross_thread_watchable_variable_t(
+        watchable_snapshot_t<value_t> *_snapshot,
+        threadnum_t _dest_thread) :
+    snapshot(_snapshot),
+    original(snapshot->get_original()),
     watchable(this),
     watchable_thread(get_thread_id()),
     dest_thread(_dest_thread),
@@ -15,25 +44,26 @@ cross_thread_watchable_variable_t<value_t>::cross_thread_watchable_variable_t(
 {
     rassert(original->get_rwi_lock_assertion()->home_thread() == watchable_thread);
     typename watchable_t<value_t>::freeze_t freeze(original);
-    value = original->get();
+    value = snapshot->get();
     subs.reset(original, &freeze);
 }
 
 template <class value_t>
 void cross_thread_watchable_variable_t<value_t>::deliver(
         UNUSED signal_t *interruptor) {
-    value_t temp = original->get();
+    std::shared_ptr<const value_t> temp = snapshot->get();
     on_thread_t thread_switcher(dest_thread);
-    value = temp;
+    value = std::move(temp);
     publisher_controller.publish([](const std::function<void()> &f) { f(); });
 }
 
 template <class value_t>
 all_thread_watchable_variable_t<value_t>::all_thread_watchable_variable_t(
-        const clone_ptr_t<watchable_t<value_t> > &input) {
+        const clone_ptr_t<watchable_t<value_t> > &input) :
+    snapshot(input) {
     for (int i = 0; i < get_num_threads(); ++i) {
         vars.emplace_back(make_scoped<cross_thread_watchable_variable_t<value_t> >(
-            input, threadnum_t(i)));
+            &snapshot, threadnum_t(i)));
     }
 }
 
@@ -4,6 +4,7 @@
 
 #include "concurrency/queue/passive_producer.hpp"
 #include "containers/intrusive_list.hpp"
+#include "time.hpp"
 
 /* `accounting_queue_t` is useful when you have some number of actors competing
 for a shared resource, and you want them to be granted access to the resource in
@@ -15,7 +16,20 @@ from a number of other `passive_producer_t`s. To associate the
 `account_t`s determines which `passive_producer_t`s the `accounting_queue_t`
 will `pop()` from when its own `pop()` method is called. When one of the sub-
 `passive_producer_t`s is not available, then it is ignored until it becomes
-available. */
+available.
+
+An `account_t` can also be given an `accounting_deadline_source_t`, which reports
+when the next value from that account should be out of the queue.  As long as some
+account is past its deadline, the `accounting_queue_t` ignores the shares and pops
+from the account whose deadline is earliest. */
+
+class accounting_deadline_source_t {
+public:
+    // Only called while the account's source is available.
+    virtual ticks_t next_deadline() const = 0;
+protected:
+    virtual ~accounting_deadline_source_t() { }
+};
 
 template<class value_t>
 class accounting_queue_t :
@@ -26,6 +40,7 @@ public:
     explicit accounting_queue_t(int _batch_factor) :
         passive_producer_t<value_t>(&available_control),
         total_shares(0),
+        num_active_deadline_accounts(0),
         selector(0),
         batch_factor(_batch_factor) {
 
@@ -39,8 +54,10 @@ public:
 
     class account_t : private availability_callback_t, public intrusive_list_node_t<account_t> {
     public:
-        account_t(accounting_queue_t *p, passive_producer_t<value_t> *s, int _shares)
-            : parent(p), source(s), shares(_shares), active(false) {
+        account_t(accounting_queue_t *p, passive_producer_t<value_t> *s, int _shares,
+                  const accounting_deadline_source_t *_deadline_source = nullptr)
+            : parent(p), source(s), deadline_source(_deadline_source),
+              shares(_shares), active(false) {
             parent->assert_thread();
             rassert(shares > 0);
             if (source->available->get()) {
@@ -81,15 +98,22 @@ public:
             active = true;
             parent->active_accounts.push_back(this);
             parent->total_shares += shares;
+            if (deadline_source != nullptr) {
+                ++parent->num_active_deadline_accounts;
+            }
         }
         void deactivate() {
             active = false;
             parent->active_accounts.remove(this);
             parent->total_shares -= shares;
+            if (deadline_source != nullptr) {
+                --parent->num_active_deadline_accounts;
+            }
         }
 
         accounting_queue_t *parent;
         passive_producer_t<value_t> *source;
+        const accounting_deadline_source_t *deadline_source;
         int shares;
         bool active;
     };
@@ -99,12 +123,38 @@ private:
 
     intrusive_list_t<account_t> active_accounts, inactive_accounts;
 
-    int total_shares, selector, batch_factor;
+    int total_shares, num_active_deadline_accounts, selector, batch_factor;
 
     availability_control_t available_control;
+    // Returns the active account with the earliest deadline that has passed, or
+    // `nullptr` if none has.
+    account_t *overdue_account() {
+        account_t *overdue = nullptr;
+        ticks_t earliest = get_ticks();
+        for (account_t *acct = active_accounts.head();
+             acct != nullptr;
+             acct = active_accounts.next(acct)) {
+            if (acct->deadline_source != nullptr) {
+                const ticks_t deadline = acct->deadline_source->next_deadline();
+                if (deadline.nanos <= earliest.nanos) {
+                    earliest = deadline;
+                    overdue = acct;
+                }
+            }
+        }
+        return overdue;
+    }
+
     value_t produce_next_value() {
         assert_thread();
 
+        if (num_active_deadline_accounts > 0) {
+            account_t *overdue = overdue_account();
+            if (overdue != nullptr) {
+                return overdue->source->pop();
+            }
+        }
+
         selector %= total_shares * batch_factor;
         // TODO: Maybe that line should be like this instead?
         // It would be very fair, but there might be some issues with that (like
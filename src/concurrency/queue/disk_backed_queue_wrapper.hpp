@@ -31,7 +31,8 @@ class disk_backed_queue_wrapper_t : public passive_producer_t<T> {
 public:
     disk_backed_queue_wrapper_t(io_backender_t *_io_backender,
             const serializer_filepath_t &_filename, perfmon_collection_t *_stats_parent,
-            int64_t memory_queue_bytes) :
+            int64_t memory_queue_bytes,
+            disk_queue_format_t _disk_queue_format = disk_queue_format_t::BLOCKS) :
         passive_producer_t<T>(&available_control),
         memory_queue_free_space(memory_queue_bytes),
         notify_when_room_in_memory_queue(nullptr),
@@ -39,6 +40,7 @@ public:
         io_backender(_io_backender),
         filename(_filename),
         stats_parent(_stats_parent),
+        disk_queue_format(_disk_queue_format),
         restart_copy_coro(false)
         { }
 
@@ -63,8 +65,8 @@ public:
             }
         } else {
             if (memory_queue_free_space <= 0) {
-                disk_queue.init(new internal_disk_backed_queue_t(
-                    io_backender, filename, stats_parent));
+                disk_queue.init(make_disk_queue(
+                    disk_queue_format, io_backender, filename, stats_parent));
                 disk_queue->push(wm);
                 coro_t::spawn_sometime(std::bind(
                     &disk_backed_queue_wrapper_t<T>::copy_from_disk_queue_to_memory_queue,
@@ -144,7 +146,7 @@ private:
 
     availability_control_t available_control;
     mutex_t push_mutex;
-    scoped_ptr_t<internal_disk_backed_queue_t> disk_queue;
+    scoped_ptr_t<disk_queue_t> disk_queue;
     std::list<write_message_t> memory_queue;
     // Note that `memory_queue_free_space` can sometimes be negative
     int64_t memory_queue_free_space;
@@ -155,6 +157,7 @@ private:
     io_backender_t *io_backender;
     const serializer_filepath_t filename;
     perfmon_collection_t *stats_parent;
+    const disk_queue_format_t disk_queue_format;
 
     // This is used to tell a push operation to restart the copy_from_disk_queue_to_memory_queue
     //  coroutine since the coroutine exited instead of waiting for the push operation to finish
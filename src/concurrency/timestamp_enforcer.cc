@@ -19,16 +19,34 @@ void timestamp_enforcer_t::complete(state_timestamp_t completed) {
     guarantee(completed > timestamp);
     guarantee(future_completed.count(completed) == 0);
     if (completed == timestamp.next()) {
-        timestamp = completed;
-        while (!future_completed.empty() &&
-                *future_completed.begin() == timestamp.next()) {
-            timestamp = timestamp.next();
-            future_completed.erase(future_completed.begin());
-        }
-        for (auto it = waiters.begin(); it != waiters.upper_bound(timestamp); ++it) {
-            it->second->pulse_if_not_already_pulsed();
-        }
+        advance_to(completed);
     } else {
         future_completed.insert(completed);
     }
 }
+
+void timestamp_enforcer_t::complete_range(
+        state_timestamp_t first, state_timestamp_t last) {
+    guarantee(first > timestamp);
+    guarantee(last >= first);
+    if (first == timestamp.next()) {
+        guarantee(future_completed.empty() || *future_completed.begin() > last);
+        advance_to(last);
+    } else {
+        for (state_timestamp_t t = first; t <= last; t = t.next()) {
+            complete(t);
+        }
+    }
+}
+
+void timestamp_enforcer_t::advance_to(state_timestamp_t completed) {
+    timestamp = completed;
+    while (!future_completed.empty() &&
+            *future_completed.begin() == timestamp.next()) {
+        timestamp = timestamp.next();
+        future_completed.erase(future_completed.begin());
+    }
+    for (auto it = waiters.begin(); it != waiters.upper_bound(timestamp); ++it) {
+        it->second->pulse_if_not_already_pulsed();
+    }
+}
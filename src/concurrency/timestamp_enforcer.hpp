@@ -24,7 +24,16 @@ public:
     /* Marks the given timestamp as completed. */
     void complete(state_timestamp_t completed);
 
+    /* Marks all timestamps from `first` to `last`, inclusive, as completed. If `first`
+    is the next timestamp, this wakes up the waiters once for the whole range rather
+    than once per timestamp. */
+    void complete_range(state_timestamp_t first, state_timestamp_t last);
+
 private:
+    /* Moves `timestamp` up to `completed`, and past any timestamps right after it in
+    `future_completed`, and pulses the waiters that that satisfies. */
+    void advance_to(state_timestamp_t completed);
+
     /* `timestamp` is the latest timestamp such that all timestamps less than or equal to
     it have been completed. */
     state_timestamp_t timestamp;
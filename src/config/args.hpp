@@ -31,6 +31,11 @@
 // decrease concurrency
 #define MAX_IO_EVENT_PROCESSING_BATCH_SIZE        50
 
+// In busy-polling mode, the shortest spin an event queue bothers with, and every how
+// many spins it asks the kernel for new events if no messages have come in.
+#define BUSY_POLL_MIN_SPIN_USECS                  10
+#define BUSY_POLL_SYSCALL_INTERVAL                16
+
 // The io batch factor ensures a minimum number of i/o operations
 // which are picked from any specific i/o account consecutively.
 // A higher value might be advantageous for throughput if seek times
@@ -66,6 +71,22 @@
 // 0 = minimal priority
 #define SINDEX_POST_CONSTRUCTION_CACHE_PRIORITY   5
 
+// After a restart, each page cache warms up by loading the blocks in the hot block
+// manifest it wrote before, CACHE_WARM_UP_BATCH_SIZE blocks at a time, with this cache
+// priority.  When the cache is full, it gives the cache balancer
+// CACHE_WARM_UP_FULL_CACHE_WAIT_MS to make room before it stops.
+#define CACHE_WARM_UP_CACHE_PRIORITY              25
+#define CACHE_WARM_UP_BATCH_SIZE                  64
+#define CACHE_WARM_UP_FULL_CACHE_WAIT_MS          1000
+
+// How often each store writes the hot block manifest of its cache.  It also writes it
+// when it shuts down.
+#define HOT_BLOCK_MANIFEST_INTERVAL_MS            (10 * 60 * 1000)
+
+// How many bytes' worth of B-tree blocks a range read or a secondary index post
+// construction may read ahead of its depth-first traversal.
+#define TRAVERSAL_READ_AHEAD_BUDGET               (2 * MEGABYTE / CPU_SHARDING_FACTOR)
+
 // Size of the buffer used to perform IO operations (in bytes).
 #define IO_BUFFER_SIZE                            (4 * KILOBYTE)
 
@@ -75,6 +96,11 @@
 // Size of each btree node (in bytes) on disk
 #define DEFAULT_BTREE_BLOCK_SIZE                  (4 * KILOBYTE)
 
+// The range of block sizes a table can be configured to use (in bytes).  Offsets
+// within a block are 16 bits wide, which limits the maximum.
+#define MIN_BTREE_BLOCK_SIZE                      (1 * KILOBYTE)
+#define MAX_BTREE_BLOCK_SIZE                      (32 * KILOBYTE)
+
 // Size of each extent (in bytes)
 // This should not be too small, or garbage collection will become
 // inefficient (especially on rotational drives).
@@ -83,6 +109,19 @@
 // Ratio of free ram to use for the cache by default
 #define DEFAULT_MAX_CACHE_RATIO                   2
 
+// The fraction of a cache's memory limit that may hold compressed copies of evicted
+// pages, and how much a page has to shrink for a compressed copy to be kept.
+#define COMPRESSED_PAGE_POOL_FRACTION             0.25
+#define COMPRESSED_PAGE_MAX_RATIO                 0.75
+
+// The cache balancer gives memory to the caches whose misses more memory would save.
+// A miss of a block that was evicted less than this fraction of the cache's memory
+// limit ago is a "ghost hit", which would have been a hit with that much more memory.
+// Other misses, and misses of scans, are worth less.
+#define CACHE_BALANCER_GHOST_FRACTION             0.25
+#define CACHE_BALANCER_COLD_MISS_WEIGHT           0.25
+#define CACHE_BALANCER_SEQUENTIAL_MISS_WEIGHT     0.25
+
 // The maximum number of concurrently active
 // index writes per merger serializer.
 // The smaller the number, the more effective
@@ -95,6 +134,77 @@
 // I/O priority of block writes in the merger_serializer_t
 #define MERGER_BLOCK_WRITE_IO_PRIORITY            64
 
+// How long a disk request of each `io_class_t` may wait in the disk manager's queue
+// before it goes ahead of the requests from other accounts.  These are fixed at
+// build time; there is no command line option or system table field for them.
+#define FOREGROUND_READ_IO_DEADLINE_MS            25
+#define FOREGROUND_WRITE_IO_DEADLINE_MS           100
+#define GC_IO_DEADLINE_MS                         500
+#define BACKFILL_IO_DEADLINE_MS                   1000
+#define SINDEX_POST_CONSTRUCTION_IO_DEADLINE_MS   2000
+#define CACHE_WARM_UP_IO_DEADLINE_MS              2000
+
+// How long a changefeed server holds on to changes for a client so they can be
+// sent together, and the most changes it puts in one cluster message.
+#define CHANGEFEED_BATCH_DELAY_MS                 2
+#define CHANGEFEED_MAX_BATCH_SIZE                 256
+
+// How long a primary replica holds on to sync writes for a secondary replica so they
+// can be sent together, and the most writes it puts in one cluster message. With a
+// delay of 0 a batch holds the writes dispatched before its coroutine next runs.
+#define REPLICATION_WRITE_BATCH_DELAY_MS          0
+#define REPLICATION_MAX_WRITE_BATCH_SIZE          64
+
+// A primary replica also sends every this many point reads to each of its ready
+// secondary replicas, and ignores their answers. This keeps the pages that the read
+// workload uses in the secondaries' caches, so that the replica that takes over after
+// a failover doesn't start out with a cold cache. Zero turns this off.
+#define STANDBY_WARMUP_READ_INTERVAL              16
+
+// How many backfills a server runs at once. Each range shard is backfilled as
+// CPU_SHARDING_FACTOR hash sub-ranges, each with its own stream of messages, its own
+// queues limited by `backfill_config_t`, and its own store thread, so this lets the
+// sub-ranges of two range shards transfer and apply in parallel.
+#define MAX_CONCURRENT_BACKFILLS                  (2 * CPU_SHARDING_FACTOR)
+
+// A primary replica of a table with expiry configured scans its range for expired rows
+// in primary key order, this many rows per read, and deletes the expired ones in a
+// single write. It pauses between batches, and waits between passes over the range.
+#define EXPIRY_SCAN_BATCH_SIZE                    1000
+#define EXPIRY_BATCH_DELAY_MS                     100
+#define EXPIRY_PASS_INTERVAL_MS                   60000
+
+// Cluster messages of at least this many bytes are compressed, with this zlib level,
+// on connections where both servers support compression. Smaller messages would cost
+// more CPU than they save bandwidth.
+#define CLUSTER_COMPRESSION_MIN_MESSAGE_SIZE      256
+#define CLUSTER_COMPRESSION_LEVEL                 1
+// Bigger messages are sent uncompressed, so that a peer can't make the receiver set
+// aside memory for a compressed message that it claims is huge.
+#define CLUSTER_COMPRESSION_MAX_MESSAGE_SIZE      (64 * MEGABYTE)
+
+// The most changed keys a directory map sends to a peer in one cluster message.
+#define DIRECTORY_MAX_BATCH_SIZE                  64
+
+// How many rows past the end of an `order_by.limit` changefeed's window its
+// `limit_manager_t` keeps in memory, so that rows leaving the window can usually be
+// replaced without reading from disk.
+#define CHANGEFEED_LIMIT_OVERFLOW_SIZE            64
+
+// How many of the most recent changes each changefeed server keeps so that feeds
+// can resume with `changes(since: ...)`.  Zero turns the change log off.
+#define CHANGEFEED_LOG_SIZE                       1024
+
+// The most memory the key filter of one primary btree may use, at about ten bits per
+// key.  Btrees with more keys than fit in that don't get a filter.  Must be a power of
+// two.
+#define KEY_FILTER_MAX_BYTES                      (16 * MEGABYTE)
+
+// The most sorted runs an unindexed `order_by` that spills to disk keeps open at once.
+// Each open run holds a segment of its disk queue in memory; once this many runs of the
+// same size pile up, they're merged into one.
+#define EXTERNAL_SORT_MAX_FAN_IN                  16
+
 // Maximum number of threads we support
 // TODO: make this dynamic where possible
 #define MAX_THREADS                               128
@@ -141,6 +251,11 @@
 // block infos.
 #define LBA_RECONSTRUCTION_BATCH_SIZE             1024
 
+// How many tables a server opens at once when it starts up.  The others wait their
+// turn, and each table becomes available as soon as it's open.  Every table being
+// opened can use up to `LBA_READ_BUFFER_SIZE` while it reads its LBA.
+#define MAX_CONCURRENT_TABLE_LOADS                4
+
 #if defined (__powerpc64__)
 // getifaddrs() calls alloca() and it tries to allocate 64KB of memory
 // in stack frame. To avoid stack overflow, increasing the stack size
@@ -150,6 +265,10 @@
 #define COROUTINE_STACK_SIZE                      131072
 #endif
 
+// How many coroutines each thread allocates when it starts, so that the first burst
+// of spawns doesn't have to allocate stacks.
+#define COROUTINE_PREALLOCATED_PER_THREAD         256
+
 
 /**
  * Message scheduler configuration
@@ -10,6 +10,7 @@
 #endif
 
 #include <algorithm>
+#include <limits>
 
 #include "containers/archive/versioned.hpp"
 #include "containers/uuid.hpp"
@@ -65,9 +66,15 @@ write_message_t::~write_message_t() {
     }
 }
 
-void write_message_t::append(const void *p, int64_t n) {
+// Pieces of shared buffers smaller than this are cheaper to copy than to hold a
+// reference to.
+static const int64_t MIN_SHARED_APPEND_SIZE = write_buffer_t::DATA_SIZE;
+
+void write_message_t::append_slow(const void *p, int64_t n) {
     while (n > 0) {
-        if (buffers_.empty() || buffers_.tail()->size == write_buffer_t::DATA_SIZE) {
+        if (buffers_.empty()
+            || buffers_.tail()->shared.has()
+            || buffers_.tail()->size == write_buffer_t::DATA_SIZE) {
             buffers_.push_back(new write_buffer_t);
         }
 
@@ -81,6 +88,15 @@ void write_message_t::append(const void *p, int64_t n) {
     }
 }
 
+void write_message_t::append(const shared_buf_ref_t<char> &ref, int64_t n) {
+    if (n < MIN_SHARED_APPEND_SIZE || n > std::numeric_limits<int>::max()) {
+        append(ref.get(), n);
+        return;
+    }
+    ref.guarantee_in_boundary(n);
+    buffers_.push_back(new write_buffer_t(ref, n));
+}
+
 size_t write_message_t::size() const {
     size_t ret = 0;
     for (write_buffer_t *h = buffers_.head(); h != nullptr; h = buffers_.next(h)) {
@@ -92,7 +108,7 @@ size_t write_message_t::size() const {
 int send_write_message(write_stream_t *s, const write_message_t *wm) {
     intrusive_list_t<write_buffer_t> *list = const_cast<write_message_t *>(wm)->unsafe_expose_buffers();
     for (write_buffer_t *p = list->head(); p; p = list->next(p)) {
-        int64_t res = s->write(p->data, p->size);
+        int64_t res = s->write(p->contents(), p->size);
         if (res == -1) {
             return -1;
         }
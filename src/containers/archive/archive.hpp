@@ -3,12 +3,14 @@
 #define CONTAINERS_ARCHIVE_ARCHIVE_HPP_
 
 #include <stdint.h>
+#include <string.h>
 
 #include <string>
 #include <type_traits>
 
 #include "containers/intrusive_list.hpp"
 #include "containers/printf_buffer.hpp"
+#include "containers/shared_buffer.hpp"
 #include "version.hpp"
 #include "valgrind.hpp"
 
@@ -91,13 +93,22 @@ private:
     DISABLE_COPYING(write_stream_t);
 };
 
+// A chunk of a write_message_t.  Either holds up to DATA_SIZE bytes in `data`, or
+// refers to `size` bytes of a shared buffer, in which case `data` is unused.
 class write_buffer_t : public intrusive_list_node_t<write_buffer_t> {
 public:
     write_buffer_t() : size(0) { }
+    write_buffer_t(const shared_buf_ref_t<char> &_shared, int _size)
+        : size(_size), shared(_shared) { }
+
+    const char *contents() const {
+        return shared.has() ? shared.get() : data;
+    }
 
     static const int DATA_SIZE = 4096;
     int size;
     char data[DATA_SIZE];
+    shared_buf_ref_t<char> shared;
 
 private:
     DISABLE_COPYING(write_buffer_t);
@@ -106,8 +117,8 @@ private:
 // A set of buffers in which an atomic message to be sent on a stream
 // gets built up.  (This way we don't flush after the first four bytes
 // sent to a stream, or buffer things and then forget to manually
-// flush.  This type can be extended to support holding references to
-// large buffers, to save copying.)  Generally speaking, you serialize
+// flush.)  Large pieces of existing shared buffers can be appended by
+// reference instead of being copied.  Generally speaking, you serialize
 // to a write_message_t, and then flush that to a write_stream_t.
 class write_message_t {
 public:
@@ -115,7 +126,23 @@ public:
     explicit write_message_t(write_message_t &&) = default;
     ~write_message_t();
 
-    void append(const void *p, int64_t n);
+    // Field-by-field serialization mostly appends a few bytes at a time, so the
+    // common case of fitting in the last buffer is inlined.
+    void append(const void *p, int64_t n) {
+        write_buffer_t *tail = buffers_.tail();
+        if (tail != nullptr && !tail->shared.has()
+            && n <= write_buffer_t::DATA_SIZE - tail->size) {
+            memcpy(tail->data + tail->size, p, n);
+            tail->size += n;
+        } else {
+            append_slow(p, n);
+        }
+    }
+
+    // Appends the first `n` bytes at `ref`.  If there are enough of them, the
+    // message holds on to the shared buffer instead of copying them, so the buffer's
+    // contents must not change until the message is destroyed.
+    void append(const shared_buf_ref_t<char> &ref, int64_t n);
 
     size_t size() const;
 
@@ -124,6 +151,8 @@ public:
 private:
     friend int send_write_message(write_stream_t *s, const write_message_t *wm);
 
+    void append_slow(const void *p, int64_t n);
+
     intrusive_list_t<write_buffer_t> buffers_;
 
     DISABLE_COPYING(write_message_t);
@@ -6,11 +6,26 @@
 #include "buffer_cache/blob.hpp"
 #include "buffer_cache/cache_balancer.hpp"
 #include "buffer_cache/serialize_onto_blob.hpp"
+#include "containers/segment_file_queue.hpp"
 #include "serializer/log/log_serializer.hpp"
 
 
 #define DBQ_MAX_REF_SIZE 251
 
+disk_queue_t *make_disk_queue(disk_queue_format_t format,
+                              io_backender_t *io_backender,
+                              const serializer_filepath_t &filename,
+                              perfmon_collection_t *stats_parent) {
+    switch (format) {
+    case disk_queue_format_t::BLOCKS:
+        return new internal_disk_backed_queue_t(io_backender, filename, stats_parent);
+    case disk_queue_format_t::SEGMENT_FILE:
+        return new segment_file_queue_t(io_backender, filename);
+    default:
+        unreachable();
+    }
+}
+
 internal_disk_backed_queue_t::internal_disk_backed_queue_t(io_backender_t *io_backender,
                                                            const serializer_filepath_t &filename,
                                                            perfmon_collection_t *stats_parent)
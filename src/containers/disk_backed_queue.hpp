@@ -41,7 +41,44 @@ protected:
     DISABLE_COPYING(buffer_group_viewer_t);
 };
 
-class internal_disk_backed_queue_t {
+/* The untyped queue of serialized values that a disk backed queue keeps on disk.
+Disk backed queues are never read back after a restart, so their files are temporary
+and get removed when the queue is destroyed. */
+class disk_queue_t {
+public:
+    virtual ~disk_queue_t() { }
+
+    virtual void push(const write_message_t &value) = 0;
+    virtual void push(const scoped_array_t<write_message_t> &values) = 0;
+
+    virtual void pop(buffer_group_viewer_t *viewer) = 0;
+
+    virtual bool empty() = 0;
+
+    virtual int64_t size() = 0;
+
+protected:
+    disk_queue_t() { }
+
+    DISABLE_COPYING(disk_queue_t);
+};
+
+enum class disk_queue_format_t {
+    // Each value is a blob in a cache and serializer of the queue's own (see
+    // `internal_disk_backed_queue_t`).
+    BLOCKS,
+    // The values are appended to a plain file in large sequential writes (see
+    // `segment_file_queue_t`), which suits queues that are filled and drained in
+    // order, like sort runs.
+    SEGMENT_FILE
+};
+
+disk_queue_t *make_disk_queue(disk_queue_format_t format,
+                              io_backender_t *io_backender,
+                              const serializer_filepath_t &filename,
+                              perfmon_collection_t *stats_parent);
+
+class internal_disk_backed_queue_t : public disk_queue_t {
 public:
     internal_disk_backed_queue_t(io_backender_t *io_backender, const serializer_filepath_t& filename, perfmon_collection_t *stats_parent);
     ~internal_disk_backed_queue_t();
@@ -128,8 +165,11 @@ private:
 template <class T>
 class disk_backed_queue_t {
 public:
-    disk_backed_queue_t(io_backender_t *io_backender, const serializer_filepath_t& filename, perfmon_collection_t *stats_parent)
-        : internal_(io_backender, filename, stats_parent) { }
+    disk_backed_queue_t(io_backender_t *io_backender,
+                        const serializer_filepath_t& filename,
+                        perfmon_collection_t *stats_parent,
+                        disk_queue_format_t format = disk_queue_format_t::BLOCKS)
+        : internal_(make_disk_queue(format, io_backender, filename, stats_parent)) { }
 
     void push(const T &t) {
         // TODO: There's an unnecessary copying of data here (which would require a
@@ -140,24 +180,24 @@ public:
         // queues are not intended to persist across restarts, so this
         // is safe.
         serialize<cluster_version_t::LATEST_OVERALL>(&wm, t);
-        internal_.push(wm);
+        internal_->push(wm);
     }
 
     void pop(T *out) {
         deserializing_viewer_t<T> viewer(out);
-        internal_.pop(&viewer);
+        internal_->pop(&viewer);
     }
 
     bool empty() {
-        return internal_.empty();
+        return internal_->empty();
     }
 
     int64_t size() {
-        return internal_.size();
+        return internal_->size();
     }
 
 private:
-    internal_disk_backed_queue_t internal_;
+    scoped_ptr_t<disk_queue_t> internal_;
     DISABLE_COPYING(disk_backed_queue_t);
 };
 
@@ -28,6 +28,11 @@ public:
         return vec_.data() + erased_offset_;
     }
 
+    // Including the erased elements that haven't been freed yet.
+    size_t capacity() const {
+        return vec_.capacity();
+    }
+
     void resize(size_t new_size) {
         vec_.resize(new_size + erased_offset_);
     }
@@ -31,6 +31,17 @@ public:
         }
     }
 
+    // Removes the entry for a key.  Returns false if the key is not found.
+    bool erase(const K &key) {
+        auto it = map_.find(key);
+        if (it == map_.end()) {
+            return false;
+        }
+        list_.erase(it->second);
+        map_.erase(it);
+        return true;
+    }
+
     // Returns true if an insertion was performed.  (Does nothing, doesn't even update
     // LRU, if no insertion was performed.)
     bool insert(K key, V value) {
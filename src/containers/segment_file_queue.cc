@@ -0,0 +1,133 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "containers/segment_file_queue.hpp"
+
+#include <algorithm>
+
+#include "arch/arch.hpp"
+#include "arch/io/disk.hpp"
+#include "containers/archive/vector_stream.hpp"
+#include "serializer/log/log_serializer.hpp"
+
+segment_file_queue_t::segment_file_queue_t(io_backender_t *io_backender,
+                                           const serializer_filepath_t &filename)
+    : queue_size(0),
+      file_opener(new filepath_file_opener_t(filename, io_backender)),
+      file_bytes(0),
+      read_offset(0),
+      head_segment(SEGMENT_FILE_QUEUE_SEGMENT_SIZE),
+      head_segment_offset(-1) {
+    file_opener->open_serializer_file_create_temporary(&file);
+}
+
+segment_file_queue_t::~segment_file_queue_t() {
+    // As in `internal_disk_backed_queue_t`, the file is closed before it's removed.
+    file.reset();
+    file_opener->unlink_serializer_file();
+}
+
+void segment_file_queue_t::push(const write_message_t &value) {
+    mutex_t::acq_t mutex_acq(&mutex);
+    append(value);
+    write_full_segments();
+}
+
+void segment_file_queue_t::push(const scoped_array_t<write_message_t> &values) {
+    mutex_t::acq_t mutex_acq(&mutex);
+    for (size_t i = 0; i < values.size(); ++i) {
+        append(values[i]);
+    }
+    write_full_segments();
+}
+
+void segment_file_queue_t::append(const write_message_t &value) {
+    vector_stream_t stream;
+    stream.reserve(sizeof(int64_t) + value.size());
+    const int64_t value_size = value.size();
+    int64_t res = stream.write(&value_size, sizeof(value_size));
+    guarantee(res == sizeof(value_size));
+    int send_res = send_write_message(&stream, &value);
+    guarantee(send_res == 0);
+    tail.insert(tail.end(), stream.vector().begin(), stream.vector().end());
+    ++queue_size;
+}
+
+void segment_file_queue_t::write_full_segments() {
+    const int64_t segment_size = SEGMENT_FILE_QUEUE_SEGMENT_SIZE;
+    const int64_t full_bytes = tail.size() / segment_size * segment_size;
+    if (full_bytes == 0) {
+        return;
+    }
+    // The segments that have been popped from memory already needn't be written.
+    const int64_t popped_bytes = std::min(
+        full_bytes,
+        std::max<int64_t>(0, read_offset - file_bytes) / segment_size * segment_size);
+    if (popped_bytes < full_bytes) {
+        const int64_t write_bytes = full_bytes - popped_bytes;
+        scoped_device_block_aligned_ptr_t<char> buf(write_bytes);
+        memcpy(buf.get(), tail.data() + popped_bytes, write_bytes);
+        file->set_file_size_at_least(file_bytes + full_bytes, segment_size);
+        // The queue is thrown away if the server stops, and its temporary file with it,
+        // so the writes don't need to be durable.
+        co_write(file.get(), file_bytes + popped_bytes, write_bytes, buf.get(),
+                 DEFAULT_DISK_ACCOUNT, datasync_op::no_datasyncs);
+    }
+    tail.erase(tail.begin(), tail.begin() + full_bytes);
+    file_bytes += full_bytes;
+}
+
+void segment_file_queue_t::read(int64_t size, char *out) {
+    const int64_t segment_size = SEGMENT_FILE_QUEUE_SEGMENT_SIZE;
+    while (size > 0) {
+        int64_t chunk_size;
+        if (read_offset >= file_bytes) {
+            chunk_size = size;
+            guarantee(read_offset - file_bytes + size
+                      <= static_cast<int64_t>(tail.size()));
+            memcpy(out, tail.data() + (read_offset - file_bytes), chunk_size);
+        } else {
+            const int64_t segment_offset = read_offset / segment_size * segment_size;
+            if (head_segment_offset != segment_offset) {
+                co_read(file.get(), segment_offset, segment_size, head_segment.get(),
+                        DEFAULT_DISK_ACCOUNT);
+                head_segment_offset = segment_offset;
+            }
+            chunk_size = std::min(size, segment_offset + segment_size - read_offset);
+            memcpy(out, head_segment.get() + (read_offset - segment_offset),
+                   chunk_size);
+        }
+        read_offset += chunk_size;
+        out += chunk_size;
+        size -= chunk_size;
+    }
+}
+
+void segment_file_queue_t::pop(buffer_group_viewer_t *viewer) {
+    guarantee(size() != 0);
+    mutex_t::acq_t mutex_acq(&mutex);
+
+    int64_t value_size;
+    read(sizeof(value_size), reinterpret_cast<char *>(&value_size));
+    std::vector<char> value(value_size);
+    read(value_size, value.data());
+
+    --queue_size;
+    if (queue_size == 0) {
+        // Everything has been popped, so the file can be reused from its start.
+        tail.clear();
+        file_bytes = 0;
+        read_offset = 0;
+        head_segment_offset = -1;
+    }
+
+    buffer_group_t group;
+    group.add_buffer(value.size(), value.data());
+    viewer->view_buffer_group(const_view(&group));
+}
+
+bool segment_file_queue_t::empty() {
+    return queue_size == 0;
+}
+
+int64_t segment_file_queue_t::size() {
+    return queue_size;
+}
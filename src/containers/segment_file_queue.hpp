@@ -0,0 +1,70 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef CONTAINERS_SEGMENT_FILE_QUEUE_HPP_
+#define CONTAINERS_SEGMENT_FILE_QUEUE_HPP_
+
+#include <vector>
+
+#include "concurrency/mutex.hpp"
+#include "containers/disk_backed_queue.hpp"
+#include "containers/scoped.hpp"
+
+class file_t;
+class filepath_file_opener_t;
+
+/* How much of the queue is written or read at a time. */
+#define SEGMENT_FILE_QUEUE_SEGMENT_SIZE         MEGABYTE
+
+/* A disk queue that appends each value, behind its size, to a file of its own.  The
+end of the queue collects in memory until it fills whole segments, which are then
+written in one request, and the front is read from the file a segment at a time, so the
+file only sees large sequential writes and reads.  Values that are popped before their
+segment is full never reach the file at all.
+
+The file is only reused from its start once the queue has been emptied, so it keeps
+growing while the queue never runs empty. */
+class segment_file_queue_t : public disk_queue_t {
+public:
+    segment_file_queue_t(io_backender_t *io_backender,
+                         const serializer_filepath_t &filename);
+    ~segment_file_queue_t();
+
+    void push(const write_message_t &value);
+    void push(const scoped_array_t<write_message_t> &values);
+
+    void pop(buffer_group_viewer_t *viewer);
+
+    bool empty();
+
+    int64_t size();
+
+private:
+    void append(const write_message_t &value);
+    void write_full_segments();
+    void read(int64_t size, char *out);
+
+    mutex_t mutex;
+
+    int64_t queue_size;
+
+    scoped_ptr_t<filepath_file_opener_t> file_opener;
+    scoped_ptr_t<file_t> file;
+
+    // Positions are counted in bytes from the start of the file.  The bytes before
+    // `file_bytes` have been written to the file (or popped before they had to be),
+    // and `tail` holds the ones after it.  `file_bytes` is always a multiple of the
+    // segment size.
+    int64_t file_bytes;
+    std::vector<char> tail;
+
+    // Where the next value to pop starts.
+    int64_t read_offset;
+
+    // The segment that was last read from the file, which starts at
+    // `head_segment_offset`, or -1 if there's none.
+    scoped_device_block_aligned_ptr_t<char> head_segment;
+    int64_t head_segment_offset;
+
+    DISABLE_COPYING(segment_file_queue_t);
+};
+
+#endif  // CONTAINERS_SEGMENT_FILE_QUEUE_HPP_
@@ -3,18 +3,112 @@
 
 #include <stdlib.h>
 
+#include "arch/compiler.hpp"
+#include "arch/runtime/memory_usage.hpp"
 #include "utils.hpp"
 
+/* Short-lived small buffers (the strings a query builds, mostly) are the bulk of what
+datums allocate.  Like coroutines, freed small buffers go into a free list on the
+thread that frees them, rounded up to a few size classes so that they can be reused
+for any buffer of their class.  That keeps most of them away from the allocator and
+its cross-thread locking.
+
+Valgrind and threaded coroutines (where thread locals are per coroutine) get plain
+`malloc` and `free`. */
+#if !defined(VALGRIND) && !defined(THREADED_COROUTINES)
+#define SHARED_BUF_USE_FREE_LISTS
+#endif
+
+#ifdef SHARED_BUF_USE_FREE_LISTS
+const size_t SHARED_BUF_NUM_SIZE_CLASSES = 3;
+const size_t SHARED_BUF_SMALLEST_SIZE_CLASS = 64;
+const size_t SHARED_BUF_FREE_LIST_SIZE = 128;
+
+struct shared_buf_free_lists_t {
+    void *blocks[SHARED_BUF_NUM_SIZE_CLASSES][SHARED_BUF_FREE_LIST_SIZE];
+    size_t num_blocks[SHARED_BUF_NUM_SIZE_CLASSES];
+};
+
+// Zero-initialized, and a POD so that it can be thread local.
+static THREAD_LOCAL shared_buf_free_lists_t shared_buf_free_lists;
+
+// Returns `SHARED_BUF_NUM_SIZE_CLASSES` for blocks too large for the free lists.
+static size_t shared_buf_size_class(size_t memory_size) {
+    size_t class_size = SHARED_BUF_SMALLEST_SIZE_CLASS;
+    for (size_t size_class = 0; size_class < SHARED_BUF_NUM_SIZE_CLASSES; ++size_class) {
+        if (memory_size <= class_size) {
+            return size_class;
+        }
+        class_size *= 2;
+    }
+    return SHARED_BUF_NUM_SIZE_CLASSES;
+}
+#endif  // SHARED_BUF_USE_FREE_LISTS
+
+// These access thread locals, so they must not be inlined into code that might
+// switch threads.  See the comment in `thread_local.hpp`.
+static NOINLINE void *allocate_shared_buf_block(size_t memory_size) {
+#ifdef SHARED_BUF_USE_FREE_LISTS
+    const size_t size_class = shared_buf_size_class(memory_size);
+    if (size_class < SHARED_BUF_NUM_SIZE_CLASSES) {
+        size_t *num_blocks = &shared_buf_free_lists.num_blocks[size_class];
+        if (*num_blocks > 0) {
+            --*num_blocks;
+            return shared_buf_free_lists.blocks[size_class][*num_blocks];
+        }
+        return ::rmalloc(SHARED_BUF_SMALLEST_SIZE_CLASS << size_class);
+    }
+#endif
+    return ::rmalloc(memory_size);
+}
+
+static NOINLINE void release_shared_buf_block(void *block, size_t memory_size) {
+#ifdef SHARED_BUF_USE_FREE_LISTS
+    const size_t size_class = shared_buf_size_class(memory_size);
+    if (size_class < SHARED_BUF_NUM_SIZE_CLASSES) {
+        size_t *num_blocks = &shared_buf_free_lists.num_blocks[size_class];
+        if (*num_blocks < SHARED_BUF_FREE_LIST_SIZE) {
+            shared_buf_free_lists.blocks[size_class][*num_blocks] = block;
+            ++*num_blocks;
+            return;
+        }
+    }
+#else
+    (void)memory_size;
+#endif
+    ::free(block);
+}
+
+NOINLINE void shared_buf_t::free_thread_free_lists() {
+#ifdef SHARED_BUF_USE_FREE_LISTS
+    for (size_t size_class = 0; size_class < SHARED_BUF_NUM_SIZE_CLASSES; ++size_class) {
+        size_t *num_blocks = &shared_buf_free_lists.num_blocks[size_class];
+        for (size_t i = 0; i < *num_blocks; ++i) {
+            ::free(shared_buf_free_lists.blocks[size_class][i]);
+        }
+        *num_blocks = 0;
+    }
+#endif
+}
+
 counted_t<shared_buf_t> shared_buf_t::create(size_t size) {
     // This allocates size bytes for the data_ field (which is declared as char[1])
     size_t memory_size = sizeof(shared_buf_t) + size - 1;
-    void *raw_result = ::rmalloc(memory_size);
+    void *raw_result = allocate_shared_buf_block(memory_size);
     shared_buf_t *result = static_cast<shared_buf_t *>(raw_result);
     result->refcount_ = 0;
     result->size_ = size;
+    add_memory_usage(memory_tag_t::DATUMS, memory_size);
     return counted_t<shared_buf_t>(result);
 }
 
+void shared_buf_t::destroy(shared_buf_t *p) {
+    const size_t memory_size = sizeof(shared_buf_t) + p->size_ - 1;
+    p->~shared_buf_t();
+    release_shared_buf_block(p, memory_size);
+    add_memory_usage(memory_tag_t::DATUMS, -static_cast<int64_t>(memory_size));
+}
+
 void shared_buf_t::operator delete(void *p) {
     ::free(p);
 }
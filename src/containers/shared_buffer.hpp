@@ -17,6 +17,10 @@ public:
     static counted_t<shared_buf_t> create(size_t _size);
     static void operator delete(void *p);
 
+    // Small buffers are recycled through per-thread free lists.  A thread that's
+    // about to exit calls this to give the memory in its free lists back.
+    static void free_thread_free_lists();
+
     char *data(size_t offset = 0);
     const char *data(size_t offset = 0) const;
 
@@ -32,6 +36,8 @@ private:
     friend void counted_release(const shared_buf_t *p);
     friend intptr_t counted_use_count(const shared_buf_t *p);
 
+    static void destroy(shared_buf_t *p);
+
     mutable std::atomic<intptr_t> refcount_;
 
     // The size of data_, for boundary checking.
@@ -60,6 +66,10 @@ public:
         rassert(buf.has());
     }
 
+    bool has() const {
+        return buf.has();
+    }
+
     const T *get() const {
         rassert(buf.has());
         rassert(buf->size() >= offset);
@@ -103,7 +113,7 @@ inline void counted_release(const shared_buf_t *p) {
     int64_t res = --(p->refcount_);
     rassert(res >= 0);
     if (res == 0) {
-        delete const_cast<shared_buf_t *>(p);
+        shared_buf_t::destroy(const_cast<shared_buf_t *>(p));
     }
 }
 
@@ -1,6 +1,8 @@
 // Copyright 2010-2013 RethinkDB, all rights reserved.
-#include "containers/object_buffer.hpp"
 #include "extproc/extproc_pool.hpp"
+
+#include "arch/runtime/coroutines.hpp"
+#include "containers/object_buffer.hpp"
 #include "extproc/extproc_spawner.hpp"
 
 extproc_pool_t::extproc_pool_t(size_t worker_count) :
@@ -29,6 +31,16 @@ signal_t *extproc_pool_t::get_shutdown_signal() {
     return ct_interruptors.get();
 }
 
+void extproc_pool_t::warm_up(size_t num_workers, const std::function<void()> &fn) {
+    assert_thread();
+    for (size_t i = 0; i < num_workers; ++i) {
+        auto_drainer_t::lock_t keepalive(&drainer);
+        coro_t::spawn_sometime([fn, keepalive /* important to capture */]() {
+            fn();
+        });
+    }
+}
+
 void extproc_pool_t::on_ring() {
     dealloc_pumper.notify();
 }
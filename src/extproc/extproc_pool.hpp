@@ -3,10 +3,12 @@
 #define EXTPROC_EXTPROC_POOL_HPP_
 
 #include <atomic>
+#include <functional>
 
 #include "arch/timing.hpp"
 #include "utils.hpp"
 #include "containers/scoped.hpp"
+#include "concurrency/auto_drainer.hpp"
 #include "concurrency/cond_var.hpp"
 #include "concurrency/cross_thread_signal.hpp"
 #include "concurrency/cross_thread_semaphore.hpp"
@@ -28,6 +30,11 @@ public:
     // Get the semaphore of workers to obtain a lock (may be done from any thread)
     cross_thread_semaphore_t<extproc_worker_t> *get_worker_semaphore();
 
+    // Runs `fn` in `num_workers` coroutines at once, in the background.  `fn` is meant
+    // to acquire a worker and prepare it, so that the first jobs after startup don't
+    // have to wait for a worker process to spawn and initialize.
+    void warm_up(size_t num_workers, const std::function<void()> &fn);
+
     class worker_acq_t {
     public:
         explicit worker_acq_t(extproc_pool_t *_pool) : pool(_pool) {
@@ -82,6 +89,10 @@ private:
     // `dealloc_pumper` must be destroyed before everything else because it stops
     // `dealloc_blocking()`.
     pump_coro_t dealloc_pumper;
+
+    // Waits for the coroutines spawned by `warm_up()`.  It's destroyed first, after
+    // the destructor pulsed `interruptor`.
+    auto_drainer_t drainer;
 };
 
 #endif /* EXTPROC_EXTPROC_POOL_HPP_ */
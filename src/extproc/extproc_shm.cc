@@ -0,0 +1,214 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "extproc/extproc_shm.hpp"
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+
+#include "concurrency/cache_line_padded.hpp"
+
+namespace {
+
+// The ring positions live in the first page, the rings follow it.
+const size_t SHM_HEADER_SIZE = 4096;
+const size_t SHM_SIZE = SHM_HEADER_SIZE + 2 * EXTPROC_SHM_RING_SIZE;
+
+// `pos` of a chunk whose data follows its header on the socket.
+const uint64_t CHUNK_INLINE = UINT64_MAX;
+
+struct chunk_header_t {
+    uint64_t size;
+    uint64_t pos;
+};
+
+#if !defined(_WIN32) && defined(SYS_memfd_create)
+#define EXTPROC_SHM_MFD_CLOEXEC 0x0001U
+fd_t create_shm_fd() {
+    return syscall(SYS_memfd_create, "rethinkdb-extproc", EXTPROC_SHM_MFD_CLOEXEC);
+}
+#else
+fd_t create_shm_fd() {
+    return INVALID_FD;
+}
+#endif
+
+}  // namespace
+
+struct extproc_shm_t::header_t {
+    // How far the reader of each ring has read, indexed by the ring's writer.
+    cache_line_padded_t<std::atomic<uint64_t> > read_pos[2];
+};
+
+extproc_shm_t::extproc_shm_t(void *mapping, side_t side)
+    : mapping_(mapping), side_(side), write_pos_(0) {
+    static_assert(sizeof(header_t) <= SHM_HEADER_SIZE,
+                  "the ring positions must fit in the first page");
+}
+
+extproc_shm_t::~extproc_shm_t() {
+#ifndef _WIN32
+    int res = munmap(mapping_, SHM_SIZE);
+    guarantee_err(res == 0, "could not unmap extproc shared memory");
+#endif
+}
+
+scoped_ptr_t<extproc_shm_t> extproc_shm_t::create(scoped_fd_t *fd_out) {
+#ifdef _WIN32
+    (void)fd_out;
+    return scoped_ptr_t<extproc_shm_t>();
+#else
+    scoped_fd_t fd(create_shm_fd());
+    if (fd.get() == INVALID_FD || ftruncate(fd.get(), SHM_SIZE) != 0) {
+        return scoped_ptr_t<extproc_shm_t>();
+    }
+    void *mapping = mmap(nullptr, SHM_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED,
+                         fd.get(), 0);
+    if (mapping == MAP_FAILED) {
+        return scoped_ptr_t<extproc_shm_t>();
+    }
+    // The memory is zeroed, so we don't need to initialize the positions.
+    *fd_out = std::move(fd);
+    return scoped_ptr_t<extproc_shm_t>(new extproc_shm_t(mapping, side_t::PARENT));
+#endif
+}
+
+scoped_ptr_t<extproc_shm_t> extproc_shm_t::attach(fd_t fd) {
+#ifdef _WIN32
+    (void)fd;
+    return scoped_ptr_t<extproc_shm_t>();
+#else
+    void *mapping = mmap(nullptr, SHM_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) {
+        return scoped_ptr_t<extproc_shm_t>();
+    }
+    return scoped_ptr_t<extproc_shm_t>(new extproc_shm_t(mapping, side_t::WORKER));
+#endif
+}
+
+extproc_shm_t::header_t *extproc_shm_t::header() {
+    return static_cast<header_t *>(mapping_);
+}
+
+char *extproc_shm_t::ring(side_t writer) {
+    return static_cast<char *>(mapping_) + SHM_HEADER_SIZE
+        + static_cast<int>(writer) * EXTPROC_SHM_RING_SIZE;
+}
+
+extproc_shm_stream_t::extproc_shm_stream_t(read_stream_t *sock_in,
+                                           write_stream_t *sock_out,
+                                           extproc_shm_t *shm)
+    : sock_in_(sock_in), sock_out_(sock_out), shm_(shm),
+      chunk_remaining_(0), chunk_in_shm_(false), chunk_pos_(0) { }
+
+int64_t extproc_shm_stream_t::read(void *p, int64_t n) {
+    if (shm_ == nullptr) {
+        return sock_in_->read(p, n);
+    }
+    if (n == 0) {
+        return 0;
+    }
+
+    if (chunk_remaining_ == 0) {
+        chunk_header_t chunk;
+        int64_t res = force_read(sock_in_, &chunk, sizeof(chunk));
+        if (res == 0) {
+            return 0;
+        } else if (res != sizeof(chunk)) {
+            return -1;
+        }
+        if (chunk.size > static_cast<uint64_t>(INT64_MAX)) {
+            return -1;
+        }
+        if (chunk.pos != CHUNK_INLINE
+            && (chunk.size > EXTPROC_SHM_RING_SIZE
+                || chunk.pos % EXTPROC_SHM_RING_SIZE + chunk.size
+                   > EXTPROC_SHM_RING_SIZE)) {
+            // `write()` never announces a chunk that doesn't fit in the ring in one
+            // piece, so the other side is broken; don't copy from outside the ring.
+            return -1;
+        }
+        chunk_remaining_ = chunk.size;
+        chunk_in_shm_ = chunk.pos != CHUNK_INLINE;
+        chunk_pos_ = chunk.pos;
+        if (chunk_in_shm_) {
+            // Pairs with the fence in `write()`.
+            std::atomic_thread_fence(std::memory_order_acquire);
+        }
+    }
+
+    const int64_t count = std::min(n, chunk_remaining_);
+    if (!chunk_in_shm_) {
+        int64_t res = sock_in_->read(p, count);
+        if (res <= 0) {
+            // The other side went away in the middle of a write.
+            return -1;
+        }
+        chunk_remaining_ -= res;
+        return res;
+    }
+
+    const extproc_shm_t::side_t writer = shm_->side_ == extproc_shm_t::side_t::PARENT
+        ? extproc_shm_t::side_t::WORKER
+        : extproc_shm_t::side_t::PARENT;
+    memcpy(p, shm_->ring(writer) + chunk_pos_ % EXTPROC_SHM_RING_SIZE, count);
+    chunk_pos_ += count;
+    chunk_remaining_ -= count;
+    if (chunk_remaining_ == 0) {
+        // The writer may reuse the space now.
+        shm_->header()->read_pos[static_cast<int>(writer)].value.store(
+            chunk_pos_, std::memory_order_release);
+    }
+    return count;
+}
+
+int64_t extproc_shm_stream_t::write(const void *p, int64_t n) {
+    if (shm_ == nullptr) {
+        return sock_out_->write(p, n);
+    }
+
+    chunk_header_t chunk;
+    chunk.size = n;
+    chunk.pos = CHUNK_INLINE;
+    if (n >= EXTPROC_SHM_MIN_WRITE_SIZE && n <= EXTPROC_SHM_RING_SIZE) {
+        // Chunks never wrap around the end of the ring, so the reader can copy them
+        // out in one piece.
+        uint64_t pos = shm_->write_pos_;
+        const uint64_t offset = pos % EXTPROC_SHM_RING_SIZE;
+        if (offset + n > EXTPROC_SHM_RING_SIZE) {
+            pos += EXTPROC_SHM_RING_SIZE - offset;
+        }
+        const uint64_t read_pos =
+            shm_->header()->read_pos[static_cast<int>(shm_->side_)].value.load(
+                std::memory_order_acquire);
+        if (pos + n - read_pos <= EXTPROC_SHM_RING_SIZE) {
+            memcpy(shm_->ring(shm_->side_) + pos % EXTPROC_SHM_RING_SIZE, p, n);
+            std::atomic_thread_fence(std::memory_order_release);
+            shm_->write_pos_ = pos + n;
+            chunk.pos = pos;
+            if (sock_out_->write(&chunk, sizeof(chunk)) != sizeof(chunk)) {
+                return -1;
+            }
+            return n;
+        }
+    }
+
+    // Small writes go out with their header in a single write to the socket.
+    if (n < EXTPROC_SHM_MIN_WRITE_SIZE) {
+        char buf[sizeof(chunk) + EXTPROC_SHM_MIN_WRITE_SIZE];
+        memcpy(buf, &chunk, sizeof(chunk));
+        memcpy(buf + sizeof(chunk), p, n);
+        const int64_t total = sizeof(chunk) + n;
+        return sock_out_->write(buf, total) == total ? n : -1;
+    }
+    if (sock_out_->write(&chunk, sizeof(chunk)) != sizeof(chunk)) {
+        return -1;
+    }
+    return sock_out_->write(p, n);
+}
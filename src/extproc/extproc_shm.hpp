@@ -0,0 +1,86 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef EXTPROC_EXTPROC_SHM_HPP_
+#define EXTPROC_EXTPROC_SHM_HPP_
+
+#include <stdint.h>
+
+#include "arch/io/io_utils.hpp"
+#include "config/args.hpp"
+#include "containers/archive/archive.hpp"
+#include "containers/scoped.hpp"
+
+/* The size of each direction's ring buffer in the memory shared with an extproc
+worker.  Writes that don't fit in the free part of the ring go through the socket. */
+#define EXTPROC_SHM_RING_SIZE      (1 * MEGABYTE)
+
+/* Writes smaller than this go through the socket, since copying them through the
+kernel costs less than the header we'd have to send anyway. */
+#define EXTPROC_SHM_MIN_WRITE_SIZE 1024
+
+/* Memory shared between the main process and one extproc worker, with a ring buffer
+for each direction.  The data in the rings is announced by headers sent over the
+worker's socket, so the socket also serves to wake up the reader; see
+`extproc_shm_stream_t`. */
+class extproc_shm_t {
+public:
+    // Which side of the connection we are.  Each side only writes to one of the rings.
+    enum class side_t { PARENT, WORKER };
+
+    ~extproc_shm_t();
+
+    // Creates new shared memory, and returns the fd to send to the worker in
+    // `*fd_out`.  Returns an empty pointer if shared memory isn't available, in which
+    // case the worker communicates through its socket only.
+    static scoped_ptr_t<extproc_shm_t> create(scoped_fd_t *fd_out);
+
+    // Maps the shared memory that the main process created.  Returns an empty pointer
+    // if that fails.
+    static scoped_ptr_t<extproc_shm_t> attach(fd_t fd);
+
+private:
+    friend class extproc_shm_stream_t;
+
+    struct header_t;
+
+    extproc_shm_t(void *mapping, side_t side);
+
+    header_t *header();
+    char *ring(side_t writer);
+
+    void *mapping_;
+    side_t side_;
+    // The position after the last byte we wrote to our ring, counting from the
+    // creation of the shared memory.  Only we write to our ring, so this is local.
+    uint64_t write_pos_;
+
+    DISABLE_COPYING(extproc_shm_t);
+};
+
+/* Stream over an extproc worker's socket that passes large writes through the
+shared memory.  Every write is preceded by a header on the socket that says where
+the data is.  Both sides must use it if they share memory; if `shm` is `nullptr`,
+it's just a pass-through to `sock_in` and `sock_out`. */
+class extproc_shm_stream_t : public read_stream_t, public write_stream_t {
+public:
+    extproc_shm_stream_t(read_stream_t *sock_in,
+                         write_stream_t *sock_out,
+                         extproc_shm_t *shm);
+
+    MUST_USE int64_t read(void *p, int64_t n);
+    MUST_USE int64_t write(const void *p, int64_t n);
+
+private:
+    read_stream_t *sock_in_;
+    write_stream_t *sock_out_;
+    extproc_shm_t *shm_;
+
+    // The rest of the write we're reading.  If `chunk_in_shm_`, `chunk_pos_` is the
+    // position of its next byte in the other side's ring.
+    int64_t chunk_remaining_;
+    bool chunk_in_shm_;
+    uint64_t chunk_pos_;
+
+    DISABLE_COPYING(extproc_shm_stream_t);
+};
+
+#endif /* EXTPROC_EXTPROC_SHM_HPP_ */
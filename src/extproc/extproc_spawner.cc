@@ -51,7 +51,25 @@ public:
         serialize<cluster_version_t::LATEST_OVERALL>(&wm, getpid());
         int res = send_write_message(&socket_stream, &wm);
         guarantee(res == 0);
+
+        // The main process tells us whether it set up shared memory for us, and if
+        // so sends us its fd
+        bool use_shm;
+        archive_result_t archive_res =
+            deserialize<cluster_version_t::LATEST_OVERALL>(&socket_stream, &use_shm);
+        guarantee(archive_res == archive_result_t::SUCCESS,
+                  "worker: could not receive shared memory flag");
+        if (use_shm) {
+            fd_t shm_fd;
+            fd_recv_result_t recv_res = recv_fds(socket.get(), 1, &shm_fd);
+            guarantee(recv_res == FD_RECV_OK,
+                      "worker: could not receive shared memory fd");
+            scoped_fd_t shm_closer(shm_fd);
+            shm = extproc_shm_t::attach(shm_fd);
+            guarantee(shm.has(), "worker: could not map shared memory");
+        }
 #endif  // _WIN32
+        stream.create(&socket_stream, &socket_stream, shm.get_or_null());
     }
 
     ~worker_run_t() {
@@ -67,18 +85,18 @@ public:
         bool (*fn) (read_stream_t *, write_stream_t *);
         while (true) {
             int64_t read_size = sizeof(fn);
-            const int64_t read_res = force_read(&socket_stream, &fn, read_size);
+            const int64_t read_res = force_read(stream.get(), &fn, read_size);
             if (read_res != read_size) {
                 break;
             }
-            if (!fn(&socket_stream, &socket_stream)) {
+            if (!fn(stream.get(), stream.get())) {
                 break;
             }
             // Trade magic numbers with the parent
             uint64_t magic_from_parent;
             {
                 archive_result_t res =
-                    deserialize<cluster_version_t::LATEST_OVERALL>(&socket_stream,
+                    deserialize<cluster_version_t::LATEST_OVERALL>(stream.get(),
                                                                    &magic_from_parent);
                 if (res != archive_result_t::SUCCESS ||
                     magic_from_parent != extproc_worker_t::parent_to_worker_magic) {
@@ -88,7 +106,7 @@ public:
             write_message_t wm;
             serialize<cluster_version_t::LATEST_OVERALL>(
                     &wm, extproc_worker_t::worker_to_parent_magic);
-            int res = send_write_message(&socket_stream, &wm);
+            int res = send_write_message(stream.get(), &wm);
             if (res != 0) {
                 break;
             }
@@ -109,6 +127,9 @@ private:
 
     scoped_fd_t socket;
     socket_stream_t socket_stream;
+    scoped_ptr_t<extproc_shm_t> shm;
+    // Jobs talk to the main process through this, rather than `socket_stream`
+    object_buffer_t<extproc_shm_stream_t> stream;
 };
 
 #ifndef _WIN32
@@ -232,7 +253,8 @@ void extproc_spawner_t::fork_spawner() {
 #endif
 
 // Spawns a new worker process and returns the fd of the socket used to communicate with it
-scoped_fd_t extproc_spawner_t::spawn(process_id_t *pid_out) {
+scoped_fd_t extproc_spawner_t::spawn(process_id_t *pid_out,
+                                     scoped_ptr_t<extproc_shm_t> *shm_out) {
 #ifdef _WIN32
     static std::atomic<uint64_t> unique = 0;
 
@@ -277,6 +299,7 @@ scoped_fd_t extproc_spawner_t::spawn(process_id_t *pid_out) {
 
     *pid_out = process_id_t(GetProcessId(process_info.hProcess));
     CloseHandle(process_info.hThread);
+    shm_out->reset();
     return fd;
 #else  // _WIN32
     guarantee(spawner_socket.get() != INVALID_FD);
@@ -303,6 +326,23 @@ scoped_fd_t extproc_spawner_t::spawn(process_id_t *pid_out) {
         throw extproc_worker_exc_t("malformed response from fresh worker process");
     }
 
+    // Job payloads go through shared memory if we can set it up.  The worker has no
+    // other way to get at it, since the spawner rather than we forked it.
+    scoped_fd_t shm_fd;
+    scoped_ptr_t<extproc_shm_t> shm = extproc_shm_t::create(&shm_fd);
+    write_message_t wm;
+    serialize<cluster_version_t::LATEST_OVERALL>(&wm, shm.has());
+    if (send_write_message(&stream_out, &wm) != 0) {
+        throw extproc_worker_exc_t("could not send shared memory flag to worker");
+    }
+    if (shm.has()) {
+        fd_t fd_to_send = shm_fd.get();
+        if (send_fds(fds[0], 1, &fd_to_send) != 0) {
+            throw extproc_worker_exc_t("could not send shared memory to worker process");
+        }
+    }
+
+    *shm_out = std::move(shm);
     return fd0;
 #endif  // _WIN32
 }
@@ -8,6 +8,7 @@
 #include "arch/process.hpp"
 #include "containers/archive/socket_stream.hpp"
 #include "containers/object_buffer.hpp"
+#include "extproc/extproc_shm.hpp"
 
 #define SUBCOMMAND_START_WORKER "start-worker"
 
@@ -31,8 +32,9 @@ public:
     ~extproc_spawner_t();
 
     // Spawns a new worker, and returns the socket file descriptor for communication
-    //  with the worker process
-    scoped_fd_t spawn(process_id_t *pid_out);
+    //  with the worker process.  `*shm_out` is set to the memory shared with the
+    //  worker, or left empty if we couldn't set any up.
+    scoped_fd_t spawn(process_id_t *pid_out, scoped_ptr_t<extproc_shm_t> *shm_out);
 
     static extproc_spawner_t *get_instance();
 
@@ -35,6 +35,7 @@ extproc_worker_t::~extproc_worker_t() {
 #else
         socket_stream.create(socket.get());
 #endif
+        stream.create(socket_stream.get(), socket_stream.get(), shm.get_or_null());
         cond_t non_interruptor;
         socket_stream->set_interruptor(&non_interruptor);
         try {
@@ -48,11 +49,13 @@ extproc_worker_t::~extproc_worker_t() {
                 throw extproc_worker_exc_t("failed to send exit code to worker");
             }
 
+            stream.reset();
             socket_stream.reset();
 
             // TODO: Give some time to exit, then kill
         } catch (const extproc_worker_exc_t &ex) {
             logERR("Failed to shutdown worker process: '%s'.  Killing it.", ex.what());
+            stream.reset();
             socket_stream.reset();
             kill_process();
         }
@@ -68,7 +71,7 @@ void extproc_worker_t::acquired(signal_t *_interruptor) {
     bool new_worker = false;
 #endif
     if (worker_pid == INVALID_PROCESS_ID) {
-        socket = spawner->spawn(&worker_pid);
+        socket = spawner->spawn(&worker_pid, &shm);
 
 #ifdef _WIN32
         new_worker = true;
@@ -82,6 +85,7 @@ void extproc_worker_t::acquired(signal_t *_interruptor) {
 #else
     socket_stream.create(socket.get());
 #endif
+    stream.create(socket_stream.get(), socket_stream.get(), shm.get_or_null());
 
     // Apply the user interruptor to our stream along with the extproc pool's interruptor
     guarantee(interruptor == nullptr);
@@ -116,7 +120,7 @@ void extproc_worker_t::released(bool user_error, signal_t *user_interruptor) {
             write_message_t wm;
             serialize<cluster_version_t::LATEST_OVERALL>(&wm, parent_to_worker_magic);
             {
-                int res = send_write_message(socket_stream.get(), &wm);
+                int res = send_write_message(stream.get(), &wm);
                 if (res != 0) {
                     throw extproc_worker_exc_t("failed to send magic number");
                 }
@@ -124,7 +128,7 @@ void extproc_worker_t::released(bool user_error, signal_t *user_interruptor) {
 
             uint64_t magic_from_child;
             archive_result_t res
-                = deserialize<cluster_version_t::LATEST_OVERALL>(socket_stream.get(),
+                = deserialize<cluster_version_t::LATEST_OVERALL>(stream.get(),
                                                                  &magic_from_child);
             if (bad(res) || magic_from_child != worker_to_parent_magic) {
                 throw extproc_worker_exc_t("did not receive magic number");
@@ -139,6 +143,7 @@ void extproc_worker_t::released(bool user_error, signal_t *user_interruptor) {
         }
     }
 
+    stream.reset();
     socket_stream.reset();
     interruptor = nullptr;
 
@@ -171,8 +176,9 @@ void extproc_worker_t::kill_process() {
 
     worker_pid = INVALID_PROCESS_ID;
 
-    // Clean up our socket fd
+    // Clean up our socket fd and the memory we shared with the worker
     socket.reset();
+    shm.reset();
 }
 
 bool extproc_worker_t::is_process_alive() {
@@ -190,9 +196,9 @@ void extproc_worker_t::run_job(bool (*fn) (read_stream_t *, write_stream_t *)) {
 }
 
 read_stream_t *extproc_worker_t::get_read_stream() {
-    return socket_stream.get();
+    return stream.get();
 }
 
 write_stream_t *extproc_worker_t::get_write_stream() {
-    return socket_stream.get();
+    return stream.get();
 }
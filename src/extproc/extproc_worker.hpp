@@ -11,6 +11,7 @@
 #include "containers/scoped.hpp"
 #include "containers/archive/socket_stream.hpp"
 #include "containers/archive/archive.hpp"
+#include "extproc/extproc_shm.hpp"
 
 class extproc_spawner_t;
 
@@ -49,6 +50,11 @@ private:
 
     object_buffer_t<socket_stream_t> socket_stream;
 
+    // Memory shared with the worker process, if we could set it up, and the stream
+    //  over `socket_stream` that uses it
+    scoped_ptr_t<extproc_shm_t> shm;
+    object_buffer_t<extproc_shm_stream_t> stream;
+
 #ifdef _WIN32
     object_buffer_t<windows_event_watcher_t> socket_event_watcher;
 #endif
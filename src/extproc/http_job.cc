@@ -17,11 +17,14 @@
 #include "http/http_parser.hpp"
 #include "rapidjson/document.h"
 #include "rapidjson/error/en.h"
-#include "rdb_protocol/datum_json.hpp"
+#include "rdb_protocol/datum_json_parser.hpp"
 #include "rdb_protocol/env.hpp"
 
 #define RETHINKDB_USER_AGENT (SOFTWARE_NAME_STRING "/" RETHINKDB_VERSION)
 
+// How many idle keep-alive connections each worker keeps open, over all hosts
+#define HTTP_WORKER_MAX_CONNECTIONS 64
+
 void parse_header(const std::string &header,
                   http_result_t *res_out);
 
@@ -31,18 +34,17 @@ void save_cookies(CURL *curl_handle,
 enum class attach_json_to_error_t { YES, NO };
 void json_to_datum(const std::string &json,
                    const ql::configured_limits_t &limits,
-                   reql_version_t reql_version,
                    attach_json_to_error_t attach_json,
                    http_result_t *res_out);
 
 void jsonp_to_datum(const std::string &jsonp,
                     const ql::configured_limits_t &limits,
-                    reql_version_t reql_version,
                     attach_json_to_error_t attach_json,
                     http_result_t *res_out);
 
-void perform_http(http_opts_t *opts,
-                  http_result_t *res_out);
+void perform_http(std::vector<http_opts_t> *opts,
+                  uint32_t concurrency,
+                  std::vector<http_result_t> *results_out);
 
 class curl_exc_t : public std::exception {
 public:
@@ -184,10 +186,12 @@ size_t curl_data_t::read_internal(char *ptr, size_t size) {
 http_job_t::http_job_t(extproc_pool_t *pool, signal_t *interruptor) :
     extproc_job(pool, &worker_fn, interruptor) { }
 
-void http_job_t::http(const http_opts_t &opts,
-                      http_result_t *res_out) {
+void http_job_t::http(const std::vector<http_opts_t> &opts,
+                      uint32_t concurrency,
+                      std::vector<http_result_t> *results_out) {
     write_message_t msg;
     serialize<cluster_version_t::LATEST_OVERALL>(&msg, opts);
+    serialize<cluster_version_t::LATEST_OVERALL>(&msg, concurrency);
     {
         int res = send_write_message(extproc_job.write_stream(), &msg);
         if (res != 0) {
@@ -197,11 +201,14 @@ void http_job_t::http(const http_opts_t &opts,
 
     archive_result_t res
         = deserialize<cluster_version_t::LATEST_OVERALL>(extproc_job.read_stream(),
-                                                         res_out);
+                                                         results_out);
     if (bad(res)) {
         throw extproc_worker_exc_t(strprintf("failed to deserialize result from worker "
                                              "(%s)", archive_result_as_str(res)));
     }
+    if (results_out->size() != opts.size()) {
+        throw extproc_worker_exc_t("wrong number of results from worker");
+    }
 }
 
 void http_job_t::worker_error() {
@@ -210,16 +217,21 @@ void http_job_t::worker_error() {
 
 bool http_job_t::worker_fn(read_stream_t *stream_in, write_stream_t *stream_out) {
     static bool curl_initialized(false);
-    http_opts_t opts;
+    std::vector<http_opts_t> opts;
+    uint32_t concurrency;
     {
         archive_result_t res
             = deserialize<cluster_version_t::LATEST_OVERALL>(stream_in, &opts);
         if (bad(res)) { return false; }
+        res = deserialize<cluster_version_t::LATEST_OVERALL>(stream_in, &concurrency);
+        if (bad(res)) { return false; }
     }
 
-    http_result_t result;
-    result.header = ql::datum_t::null();
-    result.body = ql::datum_t::null();
+    std::vector<http_result_t> results(opts.size());
+    for (http_result_t &result : results) {
+        result.header = ql::datum_t::null();
+        result.body = ql::datum_t::null();
+    }
 
     CURLcode curl_res = CURLE_OK;
     if (!curl_initialized) {
@@ -229,19 +241,25 @@ bool http_job_t::worker_fn(read_stream_t *stream_in, write_stream_t *stream_out)
 
     if (curl_res == CURLE_OK) {
         try {
-            perform_http(&opts, &result);
+            perform_http(&opts, concurrency, &results);
         } catch (const std::exception &ex) {
-            result.error.assign(ex.what());
+            for (http_result_t &result : results) {
+                result.error.assign(ex.what());
+            }
         } catch (...) {
-            result.error.assign("unknown error");
+            for (http_result_t &result : results) {
+                result.error.assign("unknown error");
+            }
         }
     } else {
-        result.error.assign("global initialization");
+        for (http_result_t &result : results) {
+            result.error.assign("global initialization");
+        }
         curl_initialized = false;
     }
 
     write_message_t msg;
-    serialize<cluster_version_t::LATEST_OVERALL>(&msg, result);
+    serialize<cluster_version_t::LATEST_OVERALL>(&msg, results);
     int res = send_write_message(stream_out, &msg);
     if (res != 0) { return false; }
 
@@ -541,40 +559,66 @@ void set_default_opts(CURL *curl_handle,
     }
 }
 
-// TODO: implement streaming API support
-void perform_http(http_opts_t *opts, http_result_t *res_out) {
-    scoped_curl_handle_t curl_handle;
-    curl_data_t curl_data;
-
-    if (curl_handle.get() == nullptr) {
-        res_out->error.assign("initialization");
-        return;
+// One request of a job, which may take several attempts
+class http_request_t {
+public:
+    http_request_t(http_opts_t *_opts, http_result_t *_res_out) :
+        opts(_opts), res_out(_res_out), curl_res(CURLE_OK), response_code(0),
+        attempts_made(0), failed(false) { }
+
+    // Returns false if the request can't be performed, in which case `res_out` has
+    //  the error already
+    bool init(bool set_timeout) {
+        if (curl_handle.get() == nullptr) {
+            res_out->error.assign("initialization");
+            return false;
+        }
+        try {
+            set_default_opts(curl_handle.get(), opts->proxy, curl_data);
+            transfer_opts(opts, curl_handle.get(), &curl_data);
+            exc_setopt(curl_handle.get(), CURLOPT_PRIVATE, this, "PRIVATE");
+            if (set_timeout) {
+                // In a batch, the main process's timeout covers all the requests, so
+                //  each request has to time out on its own
+                exc_setopt(curl_handle.get(), CURLOPT_TIMEOUT_MS,
+                           static_cast<long>(opts->timeout_ms), // NOLINT(runtime/int)
+                           "TIMEOUT");
+            }
+        } catch (const std::exception &ex) {
+            res_out->error.assign(ex.what());
+            return false;
+        }
+        if (opts->attempts == 0) {
+            res_out->error.assign("could not perform, no attempts allowed");
+            return false;
+        }
+        return true;
     }
 
-    set_default_opts(curl_handle.get(), opts->proxy, curl_data);
-    transfer_opts(opts, curl_handle.get(), &curl_data);
-
-    CURLcode curl_res = CURLE_OK;
-    long response_code = 0; // NOLINT(runtime/int)
-    for (uint64_t attempts = 0; attempts < opts->attempts; ++attempts) {
-        // Do the HTTP operation, then check for errors
-        curl_res = curl_easy_perform(curl_handle.get());
+    CURL *handle() {
+        return curl_handle.get();
+    }
 
+    // Called when an attempt is done, returns true if we should try again
+    bool attempt_done(CURLcode attempt_res) {
+        ++attempts_made;
+        curl_res = attempt_res;
         if (curl_res == CURLE_SEND_ERROR ||
             curl_res == CURLE_RECV_ERROR ||
             curl_res == CURLE_COULDNT_CONNECT) {
             // Could be a temporary error, try again
-            continue;
+            return attempts_made < opts->attempts;
         } else if (curl_res != CURLE_OK) {
             res_out->error.assign(curl_easy_strerror(curl_res));
-            return;
+            failed = true;
+            return false;
         }
 
         curl_res = curl_easy_getinfo(curl_handle.get(),
                                      CURLINFO_RESPONSE_CODE,
                                      &response_code);
 
-        // Break on success, retry on temporary error
+        // Stop on success, retry on temporary error
         if (curl_res != CURLE_OK ||
             // Error codes that may be resolved by retrying
             (response_code != 408 &&
@@ -582,10 +626,42 @@ void perform_http(http_opts_t *opts, http_result_t *res_out) {
              response_code != 502 &&
              response_code != 503 &&
              response_code != 504)) {
-            break;
+            return false;
         }
+        return attempts_made < opts->attempts;
     }
 
+    // Fills in `res_out` once we're done with the attempts
+    void finish() {
+        if (failed) {
+            return;
+        }
+        try {
+            finish_internal();
+        } catch (const std::exception &ex) {
+            res_out->error.assign(ex.what());
+        } catch (...) {
+            res_out->error.assign("unknown error");
+        }
+    }
+
+private:
+    void finish_internal();
+
+    http_opts_t *opts;
+    http_result_t *res_out;
+    scoped_curl_handle_t curl_handle;
+    curl_data_t curl_data;
+
+    CURLcode curl_res;
+    long response_code; // NOLINT(runtime/int)
+    uint64_t attempts_made;
+    bool failed;
+
+    DISABLE_COPYING(http_request_t);
+};
+
+void http_request_t::finish_internal() {
     std::string body_data(curl_data.steal_body_data());
     std::string header_data(curl_data.steal_header_data());
     truncate_header_data(&header_data);
@@ -640,18 +716,18 @@ void perform_http(http_opts_t *opts, http_result_t *res_out) {
                 }
 
                 if (content_type.find("application/json") == 0) {
-                    json_to_datum(body_data, opts->limits, opts->version,
+                    json_to_datum(body_data, opts->limits,
                                   attach_json_to_error_t::YES, res_out);
                 } else if (content_type.find("text/javascript") == 0 ||
                            content_type.find("application/json-p") == 0 ||
                            content_type.find("text/json-p") == 0) {
                     // Try to parse the result as JSON, then as JSONP, then plaintext
                     // Do not use move semantics here, as we retry on errors
-                    json_to_datum(body_data, opts->limits, opts->version,
+                    json_to_datum(body_data, opts->limits,
                                   attach_json_to_error_t::NO, res_out);
                     if (!res_out->error.empty()) {
                         res_out->error.clear();
-                        jsonp_to_datum(body_data, opts->limits, opts->version,
+                        jsonp_to_datum(body_data, opts->limits,
                                        attach_json_to_error_t::NO, res_out);
                         if (!res_out->error.empty()) {
                             res_out->error.clear();
@@ -672,11 +748,11 @@ void perform_http(http_opts_t *opts, http_result_t *res_out) {
             }
             break;
         case http_result_format_t::JSON:
-            json_to_datum(body_data, opts->limits, opts->version,
+            json_to_datum(body_data, opts->limits,
                           attach_json_to_error_t::YES, res_out);
             break;
         case http_result_format_t::JSONP:
-            jsonp_to_datum(body_data, opts->limits, opts->version,
+            jsonp_to_datum(body_data, opts->limits,
                            attach_json_to_error_t::YES, res_out);
             break;
         case http_result_format_t::TEXT:
@@ -691,6 +767,110 @@ void perform_http(http_opts_t *opts, http_result_t *res_out) {
     }
 }
 
+// The worker keeps this multi handle for as long as it lives.  It owns the connection
+//  cache, so the requests of all jobs reuse the keep-alive connections of earlier
+//  ones.  Cookies belong to the easy handles, so they aren't shared between requests.
+CURLM *get_multi_handle() {
+    static CURLM *multi_handle = nullptr;
+    if (multi_handle == nullptr) {
+        multi_handle = curl_multi_init();
+        if (multi_handle != nullptr) {
+            curl_multi_setopt(multi_handle, CURLMOPT_MAXCONNECTS,
+                              static_cast<long>(HTTP_WORKER_MAX_CONNECTIONS)); // NOLINT
+        }
+    }
+    return multi_handle;
+}
+
+// Performs all the requests, with up to `concurrency` of them in flight at once
+void perform_http(std::vector<http_opts_t> *opts,
+                  uint32_t concurrency,
+                  std::vector<http_result_t> *results_out) {
+    guarantee(opts->size() == results_out->size());
+    CURLM *multi_handle = get_multi_handle();
+    if (multi_handle == nullptr) {
+        for (http_result_t &result : *results_out) {
+            result.error.assign("initialization");
+        }
+        return;
+    }
+
+    const bool set_timeouts = opts->size() > 1;
+    std::vector<scoped_ptr_t<http_request_t> > requests(opts->size());
+    size_t next = 0;
+    size_t running = 0;
+    auto start_requests = [&]() {
+        while (running < std::max<uint32_t>(concurrency, 1) && next < opts->size()) {
+            const size_t i = next++;
+            requests[i].init(new http_request_t(&(*opts)[i], &(*results_out)[i]));
+            if (!requests[i]->init(set_timeouts)) {
+                requests[i].reset();
+                continue;
+            }
+            CURLMcode multi_res = curl_multi_add_handle(multi_handle,
+                                                        requests[i]->handle());
+            if (multi_res != CURLM_OK) {
+                (*results_out)[i].error.assign(curl_multi_strerror(multi_res));
+                requests[i].reset();
+                continue;
+            }
+            ++running;
+        }
+    };
+
+    start_requests();
+    while (running > 0) {
+        int still_running;
+        CURLMcode multi_res = curl_multi_perform(multi_handle, &still_running);
+        if (multi_res != CURLM_OK) {
+            // Fail everything that is still in flight or hasn't started yet
+            for (size_t i = 0; i < requests.size(); ++i) {
+                if (requests[i].has()) {
+                    curl_multi_remove_handle(multi_handle, requests[i]->handle());
+                    requests[i].reset();
+                    (*results_out)[i].error.assign(curl_multi_strerror(multi_res));
+                } else if (i >= next) {
+                    (*results_out)[i].error.assign(curl_multi_strerror(multi_res));
+                }
+            }
+            return;
+        }
+
+        CURLMsg *msg;
+        int msgs_left;
+        while ((msg = curl_multi_info_read(multi_handle, &msgs_left)) != nullptr) {
+            if (msg->msg != CURLMSG_DONE) {
+                continue;
+            }
+            CURL *easy_handle = msg->easy_handle;
+            CURLcode attempt_res = msg->data.result;
+            char *private_data = nullptr;
+            curl_easy_getinfo(easy_handle, CURLINFO_PRIVATE, &private_data);
+            http_request_t *request = reinterpret_cast<http_request_t *>(private_data);
+
+            // Removing and re-adding the handle restarts its transfer
+            curl_multi_remove_handle(multi_handle, easy_handle);
+            if (request->attempt_done(attempt_res) &&
+                curl_multi_add_handle(multi_handle, easy_handle) == CURLM_OK) {
+                continue;
+            }
+            request->finish();
+            for (scoped_ptr_t<http_request_t> &r : requests) {
+                if (r.get_or_null() == request) {
+                    r.reset();
+                    break;
+                }
+            }
+            --running;
+        }
+
+        start_requests();
+        if (running > 0) {
+            curl_multi_wait(multi_handle, nullptr, 0, 1000, nullptr);
+        }
+    }
+}
+
 class header_parser_singleton_t {
 public:
     static ql::datum_t parse(const std::string &header);
@@ -866,17 +1046,16 @@ void save_cookies(CURL *curl_handle, http_result_t *res_out) {
 
 void json_to_datum(const std::string &json,
                    const ql::configured_limits_t &limits,
-                   reql_version_t reql_version,
                    attach_json_to_error_t attach_json,
                    http_result_t *res_out) {
-    rapidjson::Document doc;
-    doc.Parse(json.c_str());
-    if (!doc.HasParseError()) {
-        res_out->body = ql::to_datum(doc, limits, reql_version);
-    } else {
+    // RapidJSON's `Parse` stopped at the first null byte, so we do too.
+    ql::datum_json_parser_t parser(json.c_str(), strlen(json.c_str()));
+    const rapidjson::ParseErrorCode error = parser.to_datum(limits, &res_out->body);
+    if (error != rapidjson::kParseErrorNone) {
+        res_out->body = ql::datum_t();
         res_out->error.assign(
             strprintf("failed to parse JSON response: %s",
-                      rapidjson::GetParseError_En(doc.GetParseError())));
+                      rapidjson::GetParseError_En(error)));
         if (attach_json == attach_json_to_error_t::YES) {
             res_out->body = ql::datum_t(datum_string_t(json));
         }
@@ -937,12 +1116,11 @@ const char *jsonp_parser_singleton_t::js_ident =
     "\\s*";
 
 void jsonp_to_datum(const std::string &jsonp, const ql::configured_limits_t &limits,
-                    reql_version_t reql_version,
                     attach_json_to_error_t attach_json,
                     http_result_t *res_out) {
     std::string json_string;
     if (jsonp_parser_singleton_t::parse(jsonp, &json_string)) {
-        json_to_datum(json_string, limits, reql_version, attach_json, res_out);
+        json_to_datum(json_string, limits, attach_json, res_out);
     } else {
         res_out->error.assign("failed to parse JSONP response");
         if (attach_json == attach_json_to_error_t::YES) {
@@ -2,6 +2,8 @@
 #ifndef EXTPROC_HTTP_JOB_HPP_
 #define EXTPROC_HTTP_JOB_HPP_
 
+#include <vector>
+
 #include "errors.hpp"
 
 #include "extproc/extproc_pool.hpp"
@@ -14,7 +16,10 @@ class http_job_t {
 public:
     http_job_t(extproc_pool_t *pool, signal_t *interruptor);
 
-    void http(const http_opts_t &opts, http_result_t *res_out);
+    // Performs all the requests, up to `concurrency` of them at once
+    void http(const std::vector<http_opts_t> &opts,
+              uint32_t concurrency,
+              std::vector<http_result_t> *results_out);
 
     // Marks the extproc worker as errored to simplify cleanup later
     void worker_error();
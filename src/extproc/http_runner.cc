@@ -1,10 +1,20 @@
 // Copyright 2010-2014 RethinkDB, all rights reserved.
 #include "extproc/http_runner.hpp"
 
+#include <algorithm>
+#include <array>
+
 #include "extproc/http_job.hpp"
+#include "arch/runtime/runtime.hpp"
+#include "concurrency/cache_line_padded.hpp"
+#include "config/args.hpp"
 #include "containers/archive/stl_types.hpp"
+#include "containers/lru_cache.hpp"
 #include "arch/timing.hpp"
+#include "perfmon/perfmon.hpp"
 #include "protocol_api.hpp"
+#include "rdb_protocol/serialize_datum.hpp"
+#include "time.hpp"
 
 RDB_IMPL_SERIALIZABLE_4_FOR_CLUSTER(http_result_t, header, body, cookies, error);
 RDB_IMPL_SERIALIZABLE_3_SINCE_v1_13(http_opts_t::http_auth_t, type, username, password);
@@ -42,7 +52,8 @@ http_opts_t::http_opts_t() :
     timeout_ms(30000),
     attempts(5),
     max_redirects(1),
-    verify(true) { }
+    verify(true),
+    cache_ttl_ms(0) { }
 
 http_opts_t::http_auth_t::http_auth_t() :
     type(http_auth_type_t::NONE),
@@ -68,28 +79,170 @@ void http_opts_t::http_auth_t::make_digest_auth(std::string &&user,
     password.assign(std::move(pass));
 }
 
+namespace {
+
+struct http_cache_entry_t {
+    int64_t expiration_nanos;
+    http_result_t result;
+};
+
+// Only ever accessed on its own thread
+struct thread_http_cache_t {
+    thread_http_cache_t() : entries(HTTP_CACHE_ENTRIES_PER_THREAD) { }
+    lru_cache_t<std::string, http_cache_entry_t> entries;
+};
+
+std::array<cache_line_padded_t<thread_http_cache_t>, MAX_THREADS> http_caches;
+
+perfmon_collection_t pm_http_cache_collection;
+perfmon_membership_t pm_http_cache_membership(
+    &get_global_perfmon_collection(), &pm_http_cache_collection, "http_cache");
+perfmon_counter_t pm_http_cache_hits, pm_http_cache_misses;
+perfmon_multi_membership_t pm_http_cache_values_membership(&pm_http_cache_collection,
+    &pm_http_cache_hits, "hits",
+    &pm_http_cache_misses, "misses");
+
+void append_key_part(const std::string &part, std::string *key_out) {
+    *key_out += strprintf("%zu:", part.size());
+    *key_out += part;
+}
+
+// Requests with the same key get the same response from the cache
+std::string http_cache_key(const http_opts_t &opts) {
+    std::string key;
+    append_key_part(http_method_to_str(opts.method), &key);
+    append_key_part(opts.url, &key);
+    append_key_part(opts.url_params.print(), &key);
+    key += strprintf("%zu;", opts.header.size());
+    for (const std::string &line : opts.header) {
+        append_key_part(line, &key);
+    }
+    key += strprintf("%d;%d;%" PRIu32 ";%d;",
+                     static_cast<int>(opts.result_format),
+                     static_cast<int>(opts.auth.type),
+                     opts.max_redirects,
+                     opts.verify ? 1 : 0);
+    append_key_part(opts.auth.username, &key);
+    append_key_part(opts.auth.password, &key);
+    append_key_part(opts.proxy, &key);
+    return key;
+}
+
+}  // namespace
+
 http_runner_t::http_runner_t(extproc_pool_t *_pool) :
     pool(_pool) { }
 
 void http_runner_t::http(const http_opts_t &opts,
                          http_result_t *res_out,
                          signal_t *interruptor) {
+    std::vector<http_result_t> results;
+    http_batch(std::vector<http_opts_t>(1, opts), 1, &results, interruptor);
+    *res_out = std::move(results[0]);
+}
+
+void http_runner_t::http_batch(const std::vector<http_opts_t> &opts,
+                               uint32_t concurrency,
+                               std::vector<http_result_t> *results_out,
+                               signal_t *interruptor) {
+    assert_thread();
+    guarantee(concurrency > 0);
+    results_out->clear();
+    results_out->resize(opts.size());
+
+    // Look the cacheable requests up in this thread's cache
+    lru_cache_t<std::string, http_cache_entry_t> *cache =
+        &http_caches[get_thread_id().threadnum].value.entries;
+    const int64_t now_nanos = get_ticks().nanos;
+    std::vector<size_t> misses;
+    std::vector<std::string> keys(opts.size());
+    for (size_t i = 0; i < opts.size(); ++i) {
+        if (opts[i].cache_ttl_ms == 0) {
+            misses.push_back(i);
+            continue;
+        }
+        keys[i] = http_cache_key(opts[i]);
+        http_cache_entry_t *entry;
+        if (cache->lookup(keys[i], &entry)) {
+            if (entry->expiration_nanos > now_nanos) {
+                ++pm_http_cache_hits;
+                (*results_out)[i] = entry->result;
+                continue;
+            }
+            cache->erase(keys[i]);
+        }
+        ++pm_http_cache_misses;
+        misses.push_back(i);
+    }
+    if (misses.empty()) {
+        return;
+    }
+
+    std::vector<http_result_t> fetched;
+    if (misses.size() == opts.size()) {
+        run_job(opts, concurrency, &fetched, interruptor);
+    } else {
+        std::vector<http_opts_t> to_fetch;
+        to_fetch.reserve(misses.size());
+        for (size_t i : misses) {
+            to_fetch.push_back(opts[i]);
+        }
+        run_job(to_fetch, concurrency, &fetched, interruptor);
+    }
+
+    const int64_t fetched_nanos = get_ticks().nanos;
+    for (size_t j = 0; j < misses.size(); ++j) {
+        const size_t i = misses[j];
+        (*results_out)[i] = std::move(fetched[j]);
+        const http_result_t &result = (*results_out)[i];
+        if (opts[i].cache_ttl_ms == 0 || !result.error.empty()) {
+            continue;
+        }
+        if (result.body.has() &&
+            ql::serialized_size<cluster_version_t::LATEST_OVERALL>(result.body)
+                > static_cast<size_t>(HTTP_CACHE_MAX_RESPONSE_SIZE)) {
+            continue;
+        }
+        // Another coroutine may have cached the same request while we waited
+        cache->erase(keys[i]);
+        cache->insert(keys[i], http_cache_entry_t{
+            fetched_nanos + static_cast<int64_t>(opts[i].cache_ttl_ms) * MILLION,
+            result});
+    }
+}
+
+void http_runner_t::run_job(const std::vector<http_opts_t> &opts,
+                            uint32_t concurrency,
+                            std::vector<http_result_t> *results_out,
+                            signal_t *interruptor) {
+    // The requests go out in waves of `concurrency`, so that's how long it may take
+    uint64_t max_timeout_ms = 0;
+    for (const http_opts_t &o : opts) {
+        max_timeout_ms = std::max(max_timeout_ms, o.timeout_ms);
+    }
+    const uint64_t waves = (opts.size() + concurrency - 1) / concurrency;
+    const uint64_t timeout_ms = max_timeout_ms * waves;
+
     signal_timer_t timeout;
     wait_any_t combined_interruptor(interruptor, &timeout);
     http_job_t job(pool, &combined_interruptor);
 
     assert_thread();
-    timeout.start(opts.timeout_ms);
+    timeout.start(timeout_ms);
 
     try {
-        job.http(opts, res_out);
+        job.http(opts, concurrency, results_out);
     } catch (const interrupted_exc_t &ex) {
         if (!timeout.is_pulsed()) {
             throw;
         }
-        res_out->error =
-            strprintf("timed out after %" PRIu64 ".%03" PRIu64 " seconds",
-                      opts.timeout_ms / 1000, opts.timeout_ms % 1000);
+        results_out->clear();
+        results_out->resize(opts.size());
+        for (http_result_t &result : *results_out) {
+            result.error =
+                strprintf("timed out after %" PRIu64 ".%03" PRIu64 " seconds",
+                          timeout_ms / 1000, timeout_ms % 1000);
+        }
     } catch (...) {
         // This will mark the worker as errored so we don't try to re-sync with it
         //  on the next line (since we're in a catch statement, we aren't allowed)
@@ -16,6 +16,16 @@
 #include "concurrency/signal.hpp"
 #include "extproc/extproc_job.hpp"
 
+// How many requests of one `r.http` call on an array of URLs are in flight at once,
+// unless the query says otherwise with the `concurrency` optarg
+#define HTTP_DEFAULT_CONCURRENCY 8
+#define HTTP_MAX_CONCURRENCY     128
+
+// How many responses each thread's `r.http` cache holds, and the largest response
+// (as serialized) that it caches
+#define HTTP_CACHE_ENTRIES_PER_THREAD 256
+#define HTTP_CACHE_MAX_RESPONSE_SIZE  (1 * MEGABYTE)
+
 // http calls result either in a DATUM return value or an error string
 struct http_result_t {
     ql::datum_t header;
@@ -73,11 +83,13 @@ std::string http_method_to_str(http_method_t method);
 struct http_opts_t {
     // Sets the default options
     http_opts_t();
+    http_opts_t(const http_opts_t &) = default;
     http_opts_t(http_opts_t &&) = default;
 
     struct http_auth_t {
         // No auth by default
         http_auth_t();
+        http_auth_t(const http_auth_t &) = default;
         http_auth_t(http_auth_t &&auth);
 
         void make_basic_auth(std::string &&user,
@@ -117,6 +129,10 @@ struct http_opts_t {
     uint32_t max_redirects;
 
     bool verify;
+
+    // If this isn't 0, `http_runner_t` may answer the request from its cache, and
+    //  caches a successful response for this long.  It isn't sent to the worker.
+    uint64_t cache_ttl_ms;
 };
 
 RDB_DECLARE_SERIALIZABLE(http_opts_t);
@@ -132,7 +148,23 @@ public:
               http_result_t *res_out,
               signal_t *interruptor);
 
+    // Performs all the requests in one worker, with up to `concurrency` of them in
+    // flight at once.  The worker keeps connections alive between requests to the
+    // same host.  Each request times out after its own `timeout_ms`.  Requests with
+    // a `cache_ttl_ms` that were made on this thread recently are answered from the
+    // cache instead.
+    void http_batch(const std::vector<http_opts_t> &opts,
+                    uint32_t concurrency,
+                    std::vector<http_result_t> *results_out,
+                    signal_t *interruptor);
+
 private:
+    // Performs the requests that weren't answered from the cache
+    void run_job(const std::vector<http_opts_t> &opts,
+                 uint32_t concurrency,
+                 std::vector<http_result_t> *results_out,
+                 signal_t *interruptor);
+
     extproc_pool_t *pool;
 
     DISABLE_COPYING(http_runner_t);
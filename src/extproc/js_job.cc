@@ -10,6 +10,7 @@
 
 #include "containers/archive/boost_types.hpp"
 #include "containers/archive/stl_types.hpp"
+#include "containers/scoped.hpp"
 #include "extproc/extproc_job.hpp"
 #include "math.hpp"
 #include "rdb_protocol/pseudo_time.hpp"
@@ -22,6 +23,11 @@ const js_id_t MAX_ID = std::numeric_limits<js_id_t>::max();
 // Picked from a hat.
 #define TO_JSON_RECURSION_LIMIT  500
 
+/* How many compiled functions a job keeps around for later evals of the same source.
+This must be at least `js_runner_t::CACHE_SIZE`, so that a function a `js_runner_t`
+knows the id of is never dropped while the runner holds on to the job. */
+#define JS_WORKER_FUNCTION_CACHE_SIZE  1000
+
 // Returns an empty counted_t on error.
 ql::datum_t js_to_datum(const v8::Handle<v8::Value> &value,
                         const ql::configured_limits_t &limits,
@@ -116,7 +122,17 @@ public:
     v8::Persistent<v8::Value> value;
 };
 
-// Worker-side JS evaluation environment.
+// Wrapper around `v8::Persistent<v8::Context>` that calls `Reset()` on destruction
+class persistent_context_t {
+public:
+    ~persistent_context_t() {
+        context.Reset();
+    }
+    v8::Persistent<v8::Context> context;
+};
+
+// Worker-side JS evaluation environment.  Each job gets its own, so nothing a script
+// leaves behind in its globals is seen by other queries or users.
 class js_env_t {
 public:
     js_env_t();
@@ -127,32 +143,65 @@ public:
     void release(js_id_t id);
     void run_other_tasks(uint64_t task_counter);
 
+    // Creates the context that the next `eval()` will run in, if there isn't one yet.
+    // We do this while the worker would otherwise be idle, since creating a context
+    // is the most expensive part of evaluating a small script.
+    void prepare_context();
+
 private:
+    friend class js_context_t;
+
     js_id_t remember_value(const v8::Handle<v8::Value> &value);
     const std::shared_ptr<persistent_value_t> find_value(js_id_t id);
+    void trim_function_cache();
 
     js_id_t next_id;
     std::map<js_id_t, std::shared_ptr<persistent_value_t> > values;
+
+    struct cached_function_t {
+        js_id_t id;
+        uint64_t last_used;
+    };
+    // Functions that `eval()` compiled, by source.  Their ids stay valid until they're
+    // dropped from this cache, and `release()` doesn't drop them.
+    std::map<std::string, cached_function_t> function_cache;
+    std::map<js_id_t, std::string> function_cache_sources;
+    uint64_t function_cache_clock;
+
+    scoped_ptr_t<persistent_context_t> spare_context;
 };
 
-// Cleans the worker process's environment when instantiated
+// Gives each script a fresh context to run in when instantiated
 class js_context_t {
 public:
-    js_context_t() :
+    explicit js_context_t(js_env_t *env) :
         local_scope(js_instance_t::isolate()),
-        context(v8::Context::New(js_instance_t::isolate())),
+        context(take_context(env)),
         scope(context) { }
 
     v8::HandleScope local_scope;
     v8::Local<v8::Context> context;
     v8::Context::Scope scope;
+
+private:
+    static v8::Local<v8::Context> take_context(js_env_t *env) {
+        v8::Isolate *isolate = js_instance_t::isolate();
+        if (env->spare_context.has()) {
+            v8::Local<v8::Context> context =
+                v8::Local<v8::Context>::New(isolate, env->spare_context->context);
+            env->spare_context.reset();
+            return context;
+        }
+        return v8::Context::New(isolate);
+    }
 };
 
 enum js_task_t {
     TASK_EVAL,
     TASK_CALL,
     TASK_RELEASE,
-    TASK_EXIT
+    TASK_EXIT,
+    TASK_CALL_BATCH
 };
 
 // The job_t runs in the context of the main rethinkdb process
@@ -198,6 +247,26 @@ js_result_t js_job_t::call(js_id_t id, const std::vector<ql::datum_t> &args) {
         }
     }
 
+    return read_call_result();
+}
+
+void js_job_t::send_call_batch(
+        js_id_t id, const std::vector<std::vector<ql::datum_t> > &args) {
+    js_task_t task = js_task_t::TASK_CALL_BATCH;
+    write_message_t wm;
+    wm.append(&task, sizeof(task));
+    serialize<cluster_version_t::LATEST_OVERALL>(&wm, id);
+    serialize<cluster_version_t::LATEST_OVERALL>(&wm, args);
+    serialize<cluster_version_t::LATEST_OVERALL>(&wm, limits);
+    {
+        int res = send_write_message(extproc_job.write_stream(), &wm);
+        if (res != 0) {
+            throw extproc_worker_exc_t("failed to send data to the worker");
+        }
+    }
+}
+
+js_result_t js_job_t::read_call_result() {
     js_result_t result;
     archive_result_t res
         = deserialize<cluster_version_t::LATEST_OVERALL>(extproc_job.read_stream(),
@@ -308,7 +377,11 @@ bool run_eval(read_stream_t *stream_in,
     }
 
     js_env->run_other_tasks(task_counter);
-    return send_js_result(stream_out, js_result);
+    if (!send_js_result(stream_out, js_result)) {
+        return false;
+    }
+    js_env->prepare_context();
+    return true;
 }
 
 bool run_call(read_stream_t *stream_in,
@@ -341,6 +414,47 @@ bool run_call(read_stream_t *stream_in,
     return send_js_result(stream_out, js_result);
 }
 
+bool run_call_batch(read_stream_t *stream_in,
+                    write_stream_t *stream_out,
+                    js_env_t *js_env,
+                    uint64_t task_counter) {
+    js_id_t id;
+    std::vector<std::vector<ql::datum_t> > args;
+    ql::configured_limits_t limits;
+    {
+        archive_result_t res
+            = deserialize<cluster_version_t::LATEST_OVERALL>(stream_in, &id);
+        if (bad(res)) { return false; }
+        res = deserialize<cluster_version_t::LATEST_OVERALL>(stream_in, &args);
+        if (bad(res)) { return false; }
+        res = deserialize<cluster_version_t::LATEST_OVERALL>(stream_in, &limits);
+        if (bad(res)) { return false; }
+    }
+
+    // Every result is sent as soon as it's ready, so that the main process can time
+    // each call on its own.
+    for (const std::vector<ql::datum_t> &call_args : args) {
+        js_result_t js_result;
+        try {
+            js_result = js_env->call(id, call_args, limits);
+        } catch (const std::exception &e) {
+            js_result = std::string(e.what());
+        } catch (...) {
+            js_result = std::string("encountered an unknown exception");
+        }
+        if (!send_js_result(stream_out, js_result)) {
+            return false;
+        }
+        // The caller stops at the first error anyway.
+        if (boost::get<std::string>(&js_result) != nullptr) {
+            break;
+        }
+    }
+
+    js_env->run_other_tasks(task_counter);
+    return true;
+}
+
 bool run_release(read_stream_t *stream_in,
                  write_stream_t *stream_out,
                  js_env_t *js_env,
@@ -390,6 +504,11 @@ bool js_job_t::worker_fn(read_stream_t *stream_in, write_stream_t *stream_out) {
                 return false;
             }
             break;
+        case TASK_CALL_BATCH:
+            if (!run_call_batch(stream_in, stream_out, &js_env, task_counter)) {
+                return false;
+            }
+            break;
         case TASK_EXIT:
             return run_exit(stream_out);
         default:
@@ -410,11 +529,27 @@ static void append_caught_error(std::string *err_out, const v8::TryCatch &try_ca
 
 // The env_t runs in the context of the worker process
 js_env_t::js_env_t() :
-    next_id(MIN_ID) { }
+    next_id(MIN_ID), function_cache_clock(0) { }
+
+void js_env_t::prepare_context() {
+    if (spare_context.has()) {
+        return;
+    }
+    v8::Isolate *isolate = js_instance_t::isolate();
+    v8::HandleScope handle_scope(isolate);
+    spare_context.init(new persistent_context_t());
+    spare_context->context.Reset(isolate, v8::Context::New(isolate));
+}
 
 js_result_t js_env_t::eval(const std::string &source,
                            const ql::configured_limits_t &limits) {
-    js_context_t clean_context;
+    auto cached = function_cache.find(source);
+    if (cached != function_cache.end()) {
+        cached->second.last_used = ++function_cache_clock;
+        return js_result_t(cached->second.id);
+    }
+
+    js_context_t clean_context(this);
     js_result_t result("");
     std::string *err_out = boost::get<std::string>(&result);
 
@@ -450,7 +585,11 @@ js_result_t js_env_t::eval(const std::string &source,
             if (result_val->IsFunction()) {
                 v8::Handle<v8::Function> func
                     = v8::Handle<v8::Function>::Cast(result_val);
-                result = remember_value(func);
+                js_id_t id = remember_value(func);
+                trim_function_cache();
+                function_cache[source] = cached_function_t{id, ++function_cache_clock};
+                function_cache_sources[id] = source;
+                result = id;
             } else {
                 guarantee(!result_val.IsEmpty());
 
@@ -466,6 +605,22 @@ js_result_t js_env_t::eval(const std::string &source,
     return result;
 }
 
+void js_env_t::trim_function_cache() {
+    if (function_cache.size() < JS_WORKER_FUNCTION_CACHE_SIZE) {
+        return;
+    }
+    auto oldest = function_cache.begin();
+    for (auto it = function_cache.begin(); it != function_cache.end(); ++it) {
+        if (it->second.last_used < oldest->second.last_used) {
+            oldest = it;
+        }
+    }
+    size_t num_erased = values.erase(oldest->second.id);
+    guarantee(1 == num_erased);
+    function_cache_sources.erase(oldest->second.id);
+    function_cache.erase(oldest);
+}
+
 js_id_t js_env_t::remember_value(const v8::Handle<v8::Value> &value) {
     guarantee(next_id < MAX_ID);
     js_id_t id = next_id++;
@@ -518,7 +673,6 @@ v8::Local<v8::Value> run_js_func(v8::Handle<v8::Function> fn,
 js_result_t js_env_t::call(js_id_t id,
                            const std::vector<ql::datum_t> &args,
                            const ql::configured_limits_t &limits) {
-    js_context_t clean_context;
     js_result_t result("");
     std::string *err_out = boost::get<std::string>(&result);
 
@@ -533,6 +687,10 @@ js_result_t js_env_t::call(js_id_t id,
     v8::Local<v8::Value> local_handle =
         v8::Local<v8::Value>::New(isolate, found_value->value);
     v8::Local<v8::Function> fn = v8::Local<v8::Function>::Cast(local_handle);
+
+    // The function runs in the context it was compiled in no matter which context we
+    // call it from, so we don't create a new one for every call.
+    v8::Context::Scope context_scope(fn->CreationContext());
     v8::Handle<v8::Value> value = run_js_func(fn, args, err_out);
 
     if (!value.IsEmpty()) {
@@ -551,6 +709,10 @@ js_result_t js_env_t::call(js_id_t id,
 
 void js_env_t::release(js_id_t id) {
     guarantee(id < next_id);
+    if (function_cache_sources.count(id) == 1) {
+        // Later jobs may still use it; it's dropped by `trim_function_cache()`.
+        return;
+    }
     size_t num_erased = values.erase(id);
     guarantee(1 == num_erased);
 }
@@ -21,6 +21,11 @@ public:
 
     js_result_t eval(const std::string &source);
     js_result_t call(js_id_t id, const std::vector<ql::datum_t> &args);
+    // Asks the worker to call the function once for each element of `args`, in one
+    // message.  The worker answers every call as soon as it's done, and stops at the
+    // first call that fails; `read_call_result()` reads the answers one at a time.
+    void send_call_batch(js_id_t id, const std::vector<std::vector<ql::datum_t> > &args);
+    js_result_t read_call_result();
     void release(js_id_t id);
     void exit();
 
@@ -5,6 +5,7 @@
 
 #include <map>
 
+#include "extproc/extproc_pool.hpp"
 #include "extproc/js_job.hpp"
 #include "time.hpp"
 #include "utils.hpp"
@@ -225,6 +226,78 @@ js_result_t js_runner_t::call(const std::string &source,
     return result;
 }
 
+std::vector<js_result_t> js_runner_t::call_batch(
+        const std::string &source,
+        const std::vector<std::vector<ql::datum_t> > &args,
+        const req_config_t &config) {
+    assert_thread();
+    guarantee(job_data.has());
+
+    js_result_t fn = eval(source, config);
+    js_id_t *fn_id = boost::get<js_id_t>(&fn);
+    if (fn_id == nullptr) {
+        if (boost::get<ql::datum_t>(&fn) != nullptr) {
+            fn = strprintf("Javascript query `%s` returned a value when it should "
+                           "have returned a function.", source.c_str());
+        }
+        return std::vector<js_result_t>(1, fn);
+    }
+    if (args.empty()) {
+        return std::vector<js_result_t>();
+    }
+
+    std::vector<js_result_t> results;
+    results.reserve(args.size());
+    object_buffer_t<js_timeout_t::sentry_t> sentry;
+    bool is_timeout = false;
+    try {
+        try {
+            job_data->js_job.send_call_batch(*fn_id, args);
+            // Each call gets the whole timeout.
+            for (size_t i = 0; i < args.size(); ++i) {
+                sentry.create(&job_data->js_timeout, config.timeout_ms);
+                results.push_back(job_data->js_job.read_call_result());
+                sentry.reset();
+                if (boost::get<std::string>(&results.back()) != nullptr) {
+                    break;
+                }
+            }
+        } catch (...) {
+            // See `call()`.
+            is_timeout = job_data->js_timeout.get_signal()->is_pulsed();
+            sentry.reset();
+            job_data->js_job.worker_error();
+            job_data.reset();
+
+            throw;
+        }
+    } catch (interrupted_exc_t const &e) {
+        if (is_timeout) {
+            results.push_back(strprintf(
+                "JavaScript query `%s` timed out after %" PRIu64 ".%03" PRIu64 " seconds.",
+                source.c_str(), config.timeout_ms / 1000, config.timeout_ms % 1000));
+            return results;
+        } else {
+            throw;
+        }
+    }
+
+    return results;
+}
+
+void js_runner_t::warm_up(extproc_pool_t *pool, size_t num_workers) {
+    pool->warm_up(num_workers, [pool]() {
+        try {
+            // Creating the job spawns the worker if it isn't running yet, and the
+            // worker initializes V8 when it receives its first task.
+            js_job_t js_job(pool, nullptr, ql::configured_limits_t());
+            js_job.exit();
+        } catch (const std::exception &) {
+            // The worker will be respawned by the first query that needs it.
+        }
+    });
+}
+
 void js_runner_t::cache_id(js_id_t id, const std::string &source) {
     guarantee(job_data.has());
     guarantee(id != INVALID_ID);
@@ -16,6 +16,10 @@
 #include "arch/timing.hpp"
 #include "extproc/extproc_job.hpp"
 
+// How many JavaScript workers the server starts up and initializes V8 in at startup.
+// More are spawned on demand.
+#define JS_WARM_WORKERS 1
+
 // Unique ids used to refer to objects on the JS side.
 typedef uint64_t js_id_t;
 const js_id_t INVALID_ID = 0;
@@ -57,6 +61,19 @@ public:
                      const std::vector<ql::datum_t> &args,
                      const req_config_t &config);
 
+    // Calls a previously compiled function once for each element of `args`, in a
+    // single round trip to the worker.  The results are in the same order as `args`;
+    // if a call fails or times out, its error string is the last result.  The
+    // timeout applies to each call on its own.
+    std::vector<js_result_t> call_batch(
+        const std::string &source,
+        const std::vector<std::vector<ql::datum_t> > &args,
+        const req_config_t &config);
+
+    // Starts up to `num_workers` of the pool's worker processes and initializes V8
+    // in them, so the first JavaScript queries don't pay for it.
+    static void warm_up(extproc_pool_t *pool, size_t num_workers);
+
 private:
     static const size_t CACHE_SIZE;
 
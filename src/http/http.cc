@@ -11,6 +11,8 @@
 #include <boost/algorithm/string.hpp>
 
 #include "arch/io/network.hpp"
+#include "arch/timing.hpp"
+#include "concurrency/wait_any.hpp"
 #include "logger.hpp"
 #include "math.hpp"
 
@@ -204,7 +206,7 @@ void http_res_t::set_body(const std::string& content_type, const std::string& co
 bool maybe_gzip_response(const http_req_t &req, http_res_t *res) {
     // Don't bother zipping anything less than 0.5k
     size_t body_size = res->body.size();
-    if (body_size < 512) {
+    if (body_size < 512 || res->next_chunk) {
         return false;
     }
 
@@ -402,7 +404,31 @@ void write_http_msg(tcp_conn_t *conn, const http_res_t &res, signal_t *closer) T
         conn->writef(closer, "%s: %s\r\n", line.first.c_str(), line.second.c_str());
     }
     conn->writef(closer, "\r\n");
-    conn->write(res.body.c_str(), res.body.size(), closer);
+    if (!res.next_chunk) {
+        conn->write(res.body.c_str(), res.body.size(), closer);
+        return;
+    }
+
+    std::string chunk = res.body;
+    do {
+        if (!chunk.empty()) {
+            conn->writef(closer, "%zx\r\n", chunk.size());
+            conn->write(chunk.data(), chunk.size(), closer);
+            conn->writef(closer, "\r\n");
+        }
+        chunk.clear();
+    } while (res.next_chunk(&chunk, closer));
+    conn->writef(closer, "0\r\n\r\n");
+}
+
+// Whether the client wants to send more requests over the same connection.
+bool wants_keepalive(const http_req_t &req) {
+    optional<std::string> connection = req.find_header_line("connection");
+    std::string value = connection ? boost::to_lower_copy(*connection) : "";
+    if (req.version == "1.0") {
+        return value == "keep-alive";
+    }
+    return value != "close";
 }
 
 void http_server_t::handle_conn(const scoped_ptr_t<tcp_conn_descriptor_t> &nconn, auto_drainer_t::lock_t keepalive) {
@@ -419,47 +445,79 @@ void http_server_t::handle_conn(const scoped_ptr_t<tcp_conn_descriptor_t> &nconn
         return;
     }
 
-    http_req_t req;
     tcp_http_msg_parser_t http_msg_parser;
+    bool keep_alive = true;
+    while (keep_alive) {
+        http_req_t req;
+        try {
+            http_res_t res;
+            UNUSED bool peer_res = conn->getpeername(&req.peer);
+
+            bool parsed;
+            {
+                /* The timer restarts whenever more of the request arrives, so a
+                slow upload isn't cut off as long as data keeps coming. */
+                signal_timer_t idle_timer(HTTP_KEEPALIVE_TIMEOUT_MS);
+                wait_any_t read_closer(keepalive.get_drain_signal(), &idle_timer);
+                parsed = http_msg_parser.parse(conn.get(), &req, &read_closer,
+                    [&]() {
+                        if (!idle_timer.is_pulsed()) {
+                            idle_timer.cancel();
+                            idle_timer.start(HTTP_KEEPALIVE_TIMEOUT_MS);
+                        }
+                    });
+            }
+            if (parsed) {
+                application->handle(req, &res, keepalive.get_drain_signal());
+                res.version = req.version;
+                maybe_gzip_response(req, &res);
+                keep_alive = wants_keepalive(req);
+            } else {
+                res = http_res_t(http_status_code_t::BAD_REQUEST);
+                keep_alive = false;
+            }
 
-    // Parse the request
-    try {
-        http_res_t res;
-        UNUSED bool peer_res = conn->getpeername(&req.peer);
-
-        if (http_msg_parser.parse(conn.get(), &req, keepalive.get_drain_signal())) {
-            application->handle(req, &res, keepalive.get_drain_signal());
-            res.version = req.version;
-            maybe_gzip_response(req, &res);
-        } else {
-            res = http_res_t(http_status_code_t::BAD_REQUEST);
-        }
-
-        // Disable keepalive on Safari because it seems like a partial cause of #3983
-        auto user_agent = req.header_lines.find("user-agent");
-        if (user_agent != req.header_lines.end()) {
-            if (user_agent->second.find("Safari") != std::string::npos) {
-                // Chrome also has "Safari" in the user-agent string.
-                if (user_agent->second.find("Chrome") == std::string::npos) {
-                    res.add_header_line("Connection", "close");
+            // Disable keepalive on Safari because it seems like a partial cause of #3983
+            auto user_agent = req.header_lines.find("user-agent");
+            if (user_agent != req.header_lines.end()) {
+                if (user_agent->second.find("Safari") != std::string::npos) {
+                    // Chrome also has "Safari" in the user-agent string.
+                    if (user_agent->second.find("Chrome") == std::string::npos) {
+                        keep_alive = false;
+                    }
                 }
             }
+            if (!keep_alive) {
+                res.add_header_line("Connection", "close");
+            } else if (req.version == "1.0") {
+                res.add_header_line("Connection", "keep-alive");
+            }
+            if (res.next_chunk) {
+                res.header_lines.erase("content-length");
+                res.add_header_line("Transfer-Encoding", "chunked");
+            }
+            write_http_msg(conn.get(), res, keepalive.get_drain_signal());
+        } catch (const interrupted_exc_t &) {
+            // The query was interrupted, no response since we are shutting down, or
+            // the client didn't send another request in time.
+            return;
+        } catch (const tcp_conn_read_closed_exc_t &) {
+            // Someone disconnected before sending us all the information we
+            // needed... oh well.
+            return;
+        } catch (const tcp_conn_write_closed_exc_t &) {
+            // We were trying to write to someone and they didn't stick around long
+            // enough to write it.
+            return;
         }
-        write_http_msg(conn.get(), res, keepalive.get_drain_signal());
-    } catch (const interrupted_exc_t &) {
-        // The query was interrupted, no response since we are shutting down
-    } catch (const tcp_conn_read_closed_exc_t &) {
-        // Someone disconnected before sending us all the information we
-        // needed... oh well.
-    } catch (const tcp_conn_write_closed_exc_t &) {
-        // We were trying to write to someone and they didn't stick around long
-        // enough to write it.
     }
 }
 
 // Parse a http request off of the tcp conn and stuff it into the http_req_t object. Returns parse success.
-bool tcp_http_msg_parser_t::parse(tcp_conn_t *conn, http_req_t *req, signal_t *closer) THROWS_ONLY(tcp_conn_read_closed_exc_t) {
-    line_parser_t parser(conn);
+bool tcp_http_msg_parser_t::parse(tcp_conn_t *conn, http_req_t *req, signal_t *closer,
+                                  const std::function<void()> &on_read)
+        THROWS_ONLY(tcp_conn_read_closed_exc_t) {
+    line_parser_t parser(conn, on_read);
 
     std::string method = parser.readWord(closer);
     if (method == "HEAD") {
@@ -517,6 +575,14 @@ bool tcp_http_msg_parser_t::parse(tcp_conn_t *conn, http_req_t *req, signal_t *c
 
     // Parse body
     size_t body_length = content_length(*req);
+    for (;;) {
+        const_charslice buffered = conn->peek();
+        if (static_cast<size_t>(buffered.end - buffered.beg) >= body_length) {
+            break;
+        }
+        conn->read_more_buffered(closer);
+        on_read();
+    }
     const_charslice body = conn->peek(body_length, closer);
     req->body.append(body.beg, body_length);
     conn->pop(body_length, closer);
@@ -2,6 +2,7 @@
 #ifndef HTTP_HTTP_HPP_
 #define HTTP_HTTP_HPP_
 
+#include <functional>
 #include <map>
 #include <string>
 #include <stdexcept>
@@ -96,6 +97,11 @@ public:
     std::map<std::string, std::string> header_lines;
     std::string body;
 
+    /* If this is set, the response is sent with `Transfer-Encoding: chunked`: first
+    `body`, and then every chunk that `next_chunk` returns, until it returns false.
+    Only for HTTP/1.1 requests, and it isn't compressed. */
+    std::function<bool(std::string *chunk_out, signal_t *interruptor)> next_chunk;
+
     void add_header_line(const std::string&, const std::string&);
     void set_body(const std::string&, const std::string&);
 
@@ -113,7 +119,10 @@ http_res_t http_error_res(const std::string &content,
 class tcp_http_msg_parser_t {
 public:
     tcp_http_msg_parser_t() {}
-    bool parse(tcp_conn_t *conn, http_req_t *req, signal_t *closer) THROWS_ONLY(tcp_conn_read_closed_exc_t);
+    // `on_read` is called whenever more of the request has been read.
+    bool parse(tcp_conn_t *conn, http_req_t *req, signal_t *closer,
+               const std::function<void()> &on_read)
+        THROWS_ONLY(tcp_conn_read_closed_exc_t);
 private:
     struct version_parser_t {
         std::string version;
@@ -145,10 +154,15 @@ protected:
     virtual ~http_app_t() { }
 };
 
+/* How long a connection may go without sending anything while we wait for a request
+or read one before we close it. */
+#define HTTP_KEEPALIVE_TIMEOUT_MS 30000
+
 /* creating an http server will bind to the specified port and listen for http
  * connections, the data from incoming connections will be parsed into
  * http_req_ts and passed to the handle function which must then return an http
- * msg that's a meaningful response */
+ * msg that's a meaningful response.  Connections are kept alive, unless the client
+ * says otherwise, and pipelined requests are answered in order. */
 class http_server_t {
 public:
     http_server_t(
@@ -2,7 +2,8 @@
 #include "parsing/util.hpp"
 #include "arch/io/network.hpp"
 
-line_parser_t::line_parser_t(tcp_conn_t *_conn) : conn(_conn) {
+line_parser_t::line_parser_t(tcp_conn_t *_conn, std::function<void()> _on_read)
+    : conn(_conn), on_read(std::move(_on_read)) {
     peek();
     bytes_read = 0;
 }
@@ -50,6 +51,7 @@ void line_parser_t::pop(signal_t *closer) {
 char line_parser_t::current(signal_t *closer) {
     while (static_cast<int64_t>(bytes_read) >= (end_position - start_position)) {
         conn->read_more_buffered(closer);
+        on_read();
         peek();
     }
     return start_position[bytes_read];
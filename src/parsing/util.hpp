@@ -2,6 +2,7 @@
 #ifndef PARSING_UTIL_HPP_
 #define PARSING_UTIL_HPP_
 
+#include <functional>
 #include <string>
 
 #include "arch/types.hpp"
@@ -12,13 +13,15 @@
 class line_parser_t {
 private:
     tcp_conn_t *conn;
+    std::function<void()> on_read;
 
     const char *start_position;
     unsigned bytes_read;
     const char *end_position;
 
 public:
-    explicit line_parser_t(tcp_conn_t *conn_);
+    // `on_read` is called whenever more data has been read from the conn.
+    line_parser_t(tcp_conn_t *conn_, std::function<void()> on_read_);
 
     // Returns a charslice to the next CRLF line in the TCP conn's buffer
     // blocks until a full line is available
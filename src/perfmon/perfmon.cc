@@ -16,6 +16,11 @@ static const char *stat_per_sec = "per_sec";
 static const char *stat_count = "count";
 static const char *stat_mean = "mean";
 static const char *stat_std_dev = "std_dev";
+static const char *stat_busy = "busy_fraction";
+static const char *stat_p50 = "p50";
+static const char *stat_p99 = "p99";
+static const char *stat_p999 = "p999";
+static const char *stat_buckets = "buckets";
 
 
 #ifdef FULL_PERFMON
@@ -70,11 +75,15 @@ scoped_perfmon_counter_t::~scoped_perfmon_counter_t() {
 /* perfmon_sampler_t */
 
 perfmon_sampler_t::perfmon_sampler_t(ticks_t _length, bool _include_rate)
-    : perfmon_perthread_t<stats_t>(), thread_data(new thread_info_t[MAX_THREADS]), length(_length), include_rate(_include_rate)
+    : perfmon_perthread_t<stats_t>(),
+      thread_data(new cache_line_padded_t<thread_info_t>[MAX_THREADS]),
+      length(_length), include_rate(_include_rate)
 {
+    const ticks_t now = get_coarse_ticks();
     for (int i = 0; i < MAX_THREADS; i++) {
-        // TODO: Why is current_interval an int?
-        thread_data[i].current_interval = get_ticks().nanos / length.nanos;
+        thread_data[i].value.current_interval = now.nanos / length.nanos;
+        thread_data[i].value.next_interval_nanos =
+            (thread_data[i].value.current_interval + 1) * length.nanos;
     }
 }
 
@@ -82,41 +91,41 @@ perfmon_sampler_t::~perfmon_sampler_t() {
     delete[] thread_data;
 }
 
-void perfmon_sampler_t::update(ticks_t now) {
-    // TODO: Why is this an int?
-    int interval = now.nanos / length.nanos;
-    rassert(get_thread_id().threadnum >= 0);
-    thread_info_t *thread = &thread_data[get_thread_id().threadnum];
-
-    if (thread->current_interval == interval) {
+void perfmon_sampler_t::update(thread_info_t *thread, ticks_t now) {
+    if (now.nanos < thread->next_interval_nanos) {
         /* We're up to date; nothing to do */
-    } else if (thread->current_interval + 1 == interval) {
+        return;
+    }
+    const int64_t interval = now.nanos / length.nanos;
+    if (thread->current_interval + 1 == interval) {
         /* We're one step behind */
         thread->last_stats = thread->current_stats;
         thread->current_stats = stats_t();
-        thread->current_interval++;
     } else {
         /* We're more than one step behind */
         thread->last_stats = thread->current_stats = stats_t();
-        thread->current_interval = interval;
     }
+    thread->current_interval = interval;
+    thread->next_interval_nanos = (interval + 1) * length.nanos;
 }
 
 void perfmon_sampler_t::record(double v) {
-    ticks_t now = get_ticks();
-    update(now);
-    rassert(get_thread_id().threadnum >= 0);
-    thread_info_t *thread = &thread_data[get_thread_id().threadnum];
+    const threadnum_t thread_id = get_thread_id();
+    rassert(thread_id.threadnum >= 0);
+    thread_info_t *thread = &thread_data[thread_id.threadnum].value;
+    update(thread, get_coarse_ticks());
     thread->current_stats.record(v);
 }
 
 void perfmon_sampler_t::get_thread_stat(stats_t *stat) {
-    update(get_ticks());
+    const threadnum_t thread_id = get_thread_id();
+    rassert(thread_id.threadnum >= 0);
+    thread_info_t *thread = &thread_data[thread_id.threadnum].value;
+    update(thread, get_coarse_ticks());
     /* Return last_stats instead of current_stats so that we can give a complete interval's
     worth of stats. We might be halfway through an interval, in which case current_stats will
     only have half an interval worth. */
-    rassert(get_thread_id().threadnum >= 0);
-    *stat = thread_data[get_thread_id().threadnum].last_stats;
+    *stat = thread->last_stats;
 }
 
 perfmon_sampler_t::stats_t perfmon_sampler_t::combine_stats(const stats_t *stats) {
@@ -246,48 +255,51 @@ void perfmon_stddev_t::record(double value) {
 perfmon_rate_monitor_t::perfmon_rate_monitor_t(ticks_t _length)
     : perfmon_perthread_t<double>(), length(_length)
 {
+    const ticks_t now = get_coarse_ticks();
     for (int i = 0; i < MAX_THREADS; i++) {
-        thread_data[i].value.current_interval = get_ticks().nanos / length.nanos;
+        thread_data[i].value.current_interval = now.nanos / length.nanos;
+        thread_data[i].value.next_interval_nanos =
+            (thread_data[i].value.current_interval + 1) * length.nanos;
     }
 }
 
-void perfmon_rate_monitor_t::update(ticks_t now) {
-    // TODO: Why is this an int?
-    int interval = now.nanos / length.nanos;
-    rassert(get_thread_id().threadnum >= 0);
-    thread_info_t &thread = thread_data[get_thread_id().threadnum].value;
-
-    if (thread.current_interval == interval) {
+void perfmon_rate_monitor_t::update(thread_info_t *thread, ticks_t now) {
+    if (now.nanos < thread->next_interval_nanos) {
         /* We're up to date; nothing to do */
-    } else if (thread.current_interval + 1 == interval) {
+        return;
+    }
+    const int64_t interval = now.nanos / length.nanos;
+    if (thread->current_interval + 1 == interval) {
         /* We're one step behind */
-        thread.last_count = thread.current_count;
-        thread.current_count = 0;
-        thread.current_interval++;
+        thread->last_count = thread->current_count;
+        thread->current_count = 0;
     } else {
         /* We're more than one step behind */
-        thread.last_count = thread.current_count = 0;
-        thread.current_interval = interval;
+        thread->last_count = thread->current_count = 0;
     }
+    thread->current_interval = interval;
+    thread->next_interval_nanos = (interval + 1) * length.nanos;
 }
 
-void perfmon_rate_monitor_t::record(double count) {
-    ticks_t now = get_ticks();
-    update(now);
-    rassert(get_thread_id().threadnum >= 0);
-    thread_info_t &thread = thread_data[get_thread_id().threadnum].value;
-    thread.current_count += count;
+void perfmon_rate_monitor_t::record(int64_t count) {
+    const threadnum_t thread_id = get_thread_id();
+    rassert(thread_id.threadnum >= 0);
+    thread_info_t *thread = &thread_data[thread_id.threadnum].value;
+    update(thread, get_coarse_ticks());
+    thread->current_count += count;
 }
 
 void perfmon_rate_monitor_t::get_thread_stat(double *stat) {
-    ticks_t now = get_ticks();
-    update(now);
+    const threadnum_t thread_id = get_thread_id();
+    rassert(thread_id.threadnum >= 0);
+    thread_info_t *thread = &thread_data[thread_id.threadnum].value;
+    const ticks_t now = get_coarse_ticks();
+    update(thread, now);
 
     double ratio = 1.0 - (static_cast<double>(now.nanos % length.nanos) / length.nanos);
 
     // Return a rolling average of the current count plus the last count
-    thread_info_t &thread = thread_data[get_thread_id().threadnum].value;
-    *stat = thread.current_count + thread.last_count * ratio;
+    *stat = thread->current_count + thread->last_count * ratio;
 }
 
 double perfmon_rate_monitor_t::combine_stats(const double *stats) {
@@ -302,6 +314,168 @@ ql::datum_t perfmon_rate_monitor_t::output_stat(const double &stat) {
     return ql::datum_t(stat / ticks_to_secs(length));
 }
 
+/* perfmon_histogram_t */
+
+perfmon_histogram::stats_t::stats_t() : count(0), sum_nanos(0), max_nanos(0) {
+    for (int i = 0; i < NUM_BUCKETS; ++i) {
+        buckets[i] = 0;
+    }
+}
+
+void perfmon_histogram::stats_t::record(int64_t nanos) {
+    ++buckets[bucket_for_micros(nanos / THOUSAND)];
+    ++count;
+    sum_nanos += nanos;
+    max_nanos = std::max(max_nanos, nanos);
+}
+
+int perfmon_histogram::stats_t::bucket_for_micros(int64_t micros) {
+    // Durations below `SUB_BUCKETS` microseconds get one bucket per microsecond. Above
+    // that, the duration's highest bit picks a range of `SUB_BUCKETS` buckets and the
+    // next `SUB_BUCKET_BITS` bits pick the bucket within it.
+    if (micros < SUB_BUCKETS) {
+        return std::max<int64_t>(micros, 0);
+    }
+    const int shift = (63 - __builtin_clzll(micros)) - SUB_BUCKET_BITS;
+    const int64_t bucket =
+        (shift + 1) * SUB_BUCKETS + ((micros >> shift) - SUB_BUCKETS);
+    return std::min<int64_t>(bucket, NUM_BUCKETS - 1);
+}
+
+void perfmon_histogram::stats_t::aggregate(const stats_t &s) {
+    for (int i = 0; i < NUM_BUCKETS; ++i) {
+        buckets[i] += s.buckets[i];
+    }
+    count += s.count;
+    sum_nanos += s.sum_nanos;
+    max_nanos = std::max(max_nanos, s.max_nanos);
+}
+
+int64_t perfmon_histogram::stats_t::bucket_limit_nanos(int i) {
+    if (i < SUB_BUCKETS) {
+        return (i + 1) * THOUSAND;
+    }
+    const int shift = i / SUB_BUCKETS - 1;
+    return ((int64_t(SUB_BUCKETS + i % SUB_BUCKETS) + 1) << shift) * THOUSAND;
+}
+
+int64_t perfmon_histogram::stats_t::percentile_nanos(double percent) const {
+    const double wanted = count * percent / 100.0;
+    uint64_t seen = 0;
+    for (int i = 0; i < NUM_BUCKETS - 1; ++i) {
+        seen += buckets[i];
+        if (seen >= wanted) {
+            return std::min(max_nanos, bucket_limit_nanos(i));
+        }
+    }
+    return max_nanos;
+}
+
+static ql::datum_t nanos_to_secs_datum(int64_t nanos) {
+    return ql::datum_t(ticks_to_secs(ticks_t{nanos}));
+}
+
+perfmon_histogram_t::perfmon_histogram_t(ticks_t _length, bool _per_thread)
+    : perfmon_perthread_t<stats_t, std::vector<stats_t> >(),
+      length(_length), per_thread(_per_thread) { }
+
+perfmon_histogram_t::thread_info_t *perfmon_histogram_t::update(ticks_t now) {
+    int64_t interval = now.nanos / length.nanos;
+    rassert(get_thread_id().threadnum >= 0);
+    std::unique_ptr<thread_info_t> *thread_ptr = &thread_data[get_thread_id().threadnum];
+    if (!thread_ptr->get()) {
+        thread_ptr->reset(new thread_info_t(interval));
+    }
+    thread_info_t *thread = thread_ptr->get();
+
+    if (thread->current_interval == interval) {
+        /* We're up to date; nothing to do */
+    } else if (thread->current_interval + 1 == interval) {
+        /* We're one step behind */
+        thread->last_stats = thread->current_stats;
+        thread->current_stats = stats_t();
+        thread->current_interval++;
+    } else {
+        /* We're more than one step behind */
+        thread->last_stats = thread->current_stats = stats_t();
+        thread->current_interval = interval;
+    }
+    return thread;
+}
+
+void perfmon_histogram_t::record(ticks_t duration, ticks_t now) {
+    update(now)->current_stats.record(duration.nanos);
+}
+
+void perfmon_histogram_t::get_thread_stat(stats_t *stat) {
+    // Threads that never recorded anything don't need a histogram of their own.
+    if (!thread_data[get_thread_id().threadnum]) {
+        *stat = stats_t();
+        return;
+    }
+    *stat = update(get_ticks())->last_stats;
+}
+
+std::vector<perfmon_histogram::stats_t> perfmon_histogram_t::combine_stats(
+        const stats_t *stats) {
+    if (per_thread) {
+        return std::vector<stats_t>(stats, stats + get_num_threads());
+    }
+    std::vector<stats_t> aggregated(1);
+    for (int i = 0; i < get_num_threads(); i++) {
+        aggregated[0].aggregate(stats[i]);
+    }
+    return aggregated;
+}
+
+ql::datum_t perfmon_histogram_t::output_stat(const std::vector<stats_t> &stats) {
+    if (!per_thread) {
+        guarantee(stats.size() == 1);
+        return output_thread_stat(stats[0]);
+    }
+    ql::datum_array_builder_t builder(ql::configured_limits_t::unlimited);
+    for (const stats_t &stat : stats) {
+        builder.add(output_thread_stat(stat));
+    }
+    return std::move(builder).to_datum();
+}
+
+ql::datum_t perfmon_histogram_t::output_thread_stat(const stats_t &stat) {
+    ql::datum_object_builder_t builder;
+    const double length_secs = ticks_to_secs(length);
+    builder.overwrite(stat_per_sec,
+                      ql::datum_t(static_cast<double>(stat.count) / length_secs));
+    builder.overwrite(stat_busy,
+                      ql::datum_t(ticks_to_secs(ticks_t{stat.sum_nanos}) / length_secs));
+    if (stat.count > 0) {
+        builder.overwrite(stat_p50, nanos_to_secs_datum(stat.percentile_nanos(50)));
+        builder.overwrite(stat_p99, nanos_to_secs_datum(stat.percentile_nanos(99)));
+        builder.overwrite(stat_p999, nanos_to_secs_datum(stat.percentile_nanos(99.9)));
+        builder.overwrite(stat_max, nanos_to_secs_datum(stat.max_nanos));
+    } else {
+        builder.overwrite(stat_p50, ql::datum_t::null());
+        builder.overwrite(stat_p99, ql::datum_t::null());
+        builder.overwrite(stat_p999, ql::datum_t::null());
+        builder.overwrite(stat_max, ql::datum_t::null());
+    }
+
+    // Pairs of the bucket's upper bound in seconds and the number of events in it.
+    ql::datum_array_builder_t buckets(ql::configured_limits_t::unlimited);
+    for (int i = 0; i < perfmon_histogram::NUM_BUCKETS; ++i) {
+        if (stat.buckets[i] == 0) {
+            continue;
+        }
+        ql::datum_array_builder_t bucket(ql::configured_limits_t::unlimited);
+        bucket.add(i == perfmon_histogram::NUM_BUCKETS - 1
+                   ? ql::datum_t::null()
+                   : nanos_to_secs_datum(stats_t::bucket_limit_nanos(i)));
+        bucket.add(ql::datum_t(static_cast<double>(stat.buckets[i])));
+        buckets.add(std::move(bucket).to_datum());
+    }
+    builder.overwrite(stat_buckets, std::move(buckets).to_datum());
+    return std::move(builder).to_datum();
+}
+
 perfmon_duration_sampler_t::perfmon_duration_sampler_t(ticks_t length, bool _ignore_global_full_perfmon)
     : stat(), active(), total(), recent(length, true),
       active_membership(&stat, &active, "active_count"),
@@ -348,3 +522,16 @@ std::string perfmon_duration_sampler_t::call(UNUSED int argc, UNUSED char **argv
     }
 }
 
+/* perfmon_string_t */
+
+perfmon_string_t::perfmon_string_t(const std::string &_value) : value(_value) { }
+
+void *perfmon_string_t::begin_stats() {
+    return nullptr;
+}
+
+void perfmon_string_t::visit_stats(void *) { }
+
+ql::datum_t perfmon_string_t::end_stats(void *) {
+    return ql::datum_t(datum_string_t(value));
+}
@@ -13,6 +13,7 @@
 #include <string>
 #include <map>
 #include <memory>
+#include <vector>
 
 #include "concurrency/cache_line_padded.hpp"
 #include "config/args.hpp"
@@ -127,16 +128,18 @@ class perfmon_sampler_t : public perfmon_perthread_t<perfmon_sampler::stats_t> {
     typedef perfmon_sampler::stats_t stats_t;
     struct thread_info_t {
         stats_t current_stats, last_stats;
-        int current_interval;
+        int64_t current_interval;
+        // When the current interval ends, so that `record()` doesn't need to divide.
+        int64_t next_interval_nanos;
     };
 
-    thread_info_t *thread_data;
+    cache_line_padded_t<thread_info_t> *thread_data;
 
     void get_thread_stat(stats_t *);
     stats_t combine_stats(const stats_t *);
     ql::datum_t output_stat(const stats_t&);
 
-    void update(ticks_t now);
+    void update(thread_info_t *thread, ticks_t now);
 
     ticks_t length;
     bool include_rate;
@@ -193,18 +196,26 @@ private:
  * not associate a number with each event, but you can record many events at
  * once. For example, it would be good for recording how fast bytes are sent
  * over the network.
+ *
+ * It's used on hot paths, so `record()` only adds to an integer in the thread's
+ * own cache line and reads the coarse clock; the rate is only computed when the
+ * stats are collected.
  */
 class perfmon_rate_monitor_t : public perfmon_perthread_t<double> {
 private:
     struct thread_info_t {
-        double current_count, last_count;
-        int current_interval;
-
-        thread_info_t() : current_count(0), last_count(0), current_interval(1) { }
+        int64_t current_count, last_count;
+        int64_t current_interval;
+        // When the current interval ends, so that `record()` doesn't need to divide.
+        int64_t next_interval_nanos;
+
+        thread_info_t()
+            : current_count(0), last_count(0), current_interval(0),
+              next_interval_nanos(0) { }
     };
 
     cache_line_padded_t<thread_info_t> thread_data[MAX_THREADS];
-    void update(ticks_t now);
+    void update(thread_info_t *thread, ticks_t now);
     ticks_t length;
 
     void get_thread_stat(double *);
@@ -212,7 +223,72 @@ private:
     ql::datum_t output_stat(const double&);
 public:
     explicit perfmon_rate_monitor_t(ticks_t length);
-    void record(double value = 1.0);
+    void record(int64_t count = 1);
+};
+
+/* perfmon_histogram_t keeps a log-linear histogram of the durations of events: every
+ * power of two microseconds is split into `SUB_BUCKETS` equal buckets, so percentiles
+ * are accurate to within 1 / `SUB_BUCKETS` of their value. Like perfmon_sampler_t, it
+ * reports on the last complete interval of 'length' ticks: the number of events per
+ * second, the fraction of the time that was spent in them, estimated percentiles, the
+ * maximum and the non-empty buckets. Every thread records into its own histogram,
+ * which is only allocated once the thread records something, and the threads' histograms
+ * are merged when the stats are collected. If 'per_thread' is true, it reports an array
+ * with one entry per thread instead of merging them.
+ */
+namespace perfmon_histogram {
+
+static const int SUB_BUCKET_BITS = 3;
+static const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+// Enough for durations up to 2^28 microseconds (about 4.5 minutes); the last bucket
+// holds everything longer.
+static const int NUM_BUCKETS = (28 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+struct stats_t {
+    stats_t();
+    void record(int64_t nanos);
+    void aggregate(const stats_t &s);
+    // The bucket that a duration of `micros` goes into.
+    static int bucket_for_micros(int64_t micros);
+    // The (exclusive) upper bound of bucket `i`, in nanoseconds.
+    static int64_t bucket_limit_nanos(int i);
+    // An upper bound for the `percent`th percentile, in nanoseconds.
+    int64_t percentile_nanos(double percent) const;
+
+    uint64_t count;
+    int64_t sum_nanos;
+    int64_t max_nanos;
+    uint64_t buckets[NUM_BUCKETS];
+};
+
+}  /* namespace perfmon_histogram */
+
+class perfmon_histogram_t : public perfmon_perthread_t<perfmon_histogram::stats_t,
+        std::vector<perfmon_histogram::stats_t> > {
+    typedef perfmon_histogram::stats_t stats_t;
+    struct thread_info_t {
+        explicit thread_info_t(int64_t _current_interval)
+            : current_interval(_current_interval) { }
+        stats_t current_stats, last_stats;
+        int64_t current_interval;
+    };
+
+    // Each thread only ever touches its own entry, so no locking is needed.
+    std::unique_ptr<thread_info_t> thread_data[MAX_THREADS];
+
+    void get_thread_stat(stats_t *);
+    std::vector<stats_t> combine_stats(const stats_t *);
+    ql::datum_t output_stat(const std::vector<stats_t> &);
+    ql::datum_t output_thread_stat(const stats_t &);
+
+    thread_info_t *update(ticks_t now);
+
+    ticks_t length;
+    bool per_thread;
+public:
+    perfmon_histogram_t(ticks_t _length, bool _per_thread);
+    // `now` has to be recent; it saves a `get_ticks()` call when the caller has one.
+    void record(ticks_t duration, ticks_t now);
 };
 
 /* perfmon_duration_sampler_t is a perfmon_t that monitors events that have a
@@ -253,6 +329,19 @@ public:
     std::string call(UNUSED int argc, UNUSED char **argv);
 };
 
+/* perfmon_string_t reports a fixed string, so that a collection can say what it is
+ * about, e.g. which key range a shard's stats are for. */
+class perfmon_string_t : public perfmon_t {
+public:
+    explicit perfmon_string_t(const std::string &_value);
+    void *begin_stats();
+    void visit_stats(void *);
+    ql::datum_t end_stats(void *);
+private:
+    const std::string value;
+    DISABLE_COPYING(perfmon_string_t);
+};
+
 struct block_pm_duration {
     ticks_t time;
     bool ended;
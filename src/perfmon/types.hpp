@@ -8,6 +8,7 @@ class perfmon_sampler_t;
 struct perfmon_stddev_t;
 struct perfmon_duration_sampler_t;
 class perfmon_rate_monitor_t;
+class perfmon_histogram_t;
 struct perfmon_function_t;
 
 #endif  // PERFMON_TYPES_HPP_
@@ -915,6 +915,7 @@ static void pprint_update_reminder() {
     case Term::TABLE:
     case Term::GET:
     case Term::GET_ALL:
+    case Term::SEARCH:
     case Term::EQ:
     case Term::NE:
     case Term::LT:
@@ -1011,6 +1012,7 @@ static void pprint_update_reminder() {
     case Term::NOW:
     case Term::IN_TIMEZONE:
     case Term::DURING:
+    case Term::BUCKET:
     case Term::DATE:
     case Term::TIME_OF_DAY:
     case Term::TIMEZONE:
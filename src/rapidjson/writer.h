@@ -28,6 +28,10 @@
 #include "rapidjson/internal/itoa.h"
 #include "rapidjson/stringbuffer.h"
 #include <new>      // placement new
+#include <cstring>  // RethinkDB: memcpy in WriteString
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #if RAPIDJSON_HAS_STDSTRING
 #include <string>
@@ -417,6 +421,74 @@ inline bool Writer<StringBuffer>::WriteDouble(double d) {
     return true;
 }
 
+// RethinkDB addition: For UTF-8 to UTF-8 the generic version above only ever escapes
+// control characters, quotes and backslashes, and copies every other byte through
+// `Put()` one at a time.  This finds the runs of bytes that don't need escaping 16 at
+// a time and copies them in one go.
+template<>
+inline bool Writer<StringBuffer>::WriteString(const Ch* str, SizeType length) {
+    static const char hexDigits[16] = { '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'A', 'B', 'C', 'D', 'E', 'F' };
+    os_->Put('\"');
+    SizeType i = 0;
+    while (i < length) {
+        SizeType run_end = i;
+#if defined(__SSE2__)
+        const __m128i quote = _mm_set1_epi8('"');
+        const __m128i backslash = _mm_set1_epi8('\\');
+        const __m128i max_control = _mm_set1_epi8(0x1F);
+        for (; run_end + 16 <= length; run_end += 16) {
+            const __m128i c =
+                _mm_loadu_si128(reinterpret_cast<const __m128i *>(str + run_end));
+            const __m128i needs_escape = _mm_or_si128(
+                _mm_cmpeq_epi8(_mm_min_epu8(c, max_control), c),
+                _mm_or_si128(_mm_cmpeq_epi8(c, quote), _mm_cmpeq_epi8(c, backslash)));
+            const int mask = _mm_movemask_epi8(needs_escape);
+            if (mask != 0) {
+                run_end += __builtin_ctz(mask);
+                break;
+            }
+        }
+        if (run_end + 16 > length)
+#endif
+        {
+            while (run_end < length) {
+                const unsigned char c = static_cast<unsigned char>(str[run_end]);
+                if (c < 0x20 || c == '"' || c == '\\')
+                    break;
+                ++run_end;
+            }
+        }
+        if (run_end != i) {
+            std::memcpy(os_->Push(run_end - i), str + i, run_end - i);
+            i = run_end;
+        }
+        if (i == length)
+            break;
+
+        const unsigned char c = static_cast<unsigned char>(str[i++]);
+        os_->Put('\\');
+        switch (c) {
+        case '"':  os_->Put('"'); break;
+        case '\\': os_->Put('\\'); break;
+        case '\b': os_->Put('b'); break;
+        case '\t': os_->Put('t'); break;
+        case '\n': os_->Put('n'); break;
+        case '\f': os_->Put('f'); break;
+        case '\r': os_->Put('r'); break;
+        default: {
+            char *buffer = os_->Push(5);
+            buffer[0] = 'u';
+            buffer[1] = '0';
+            buffer[2] = '0';
+            buffer[3] = hexDigits[c >> 4];
+            buffer[4] = hexDigits[c & 0xF];
+        } break;
+        }
+    }
+    os_->Put('\"');
+    return true;
+}
+
 RAPIDJSON_NAMESPACE_END
 
 // RethinkDB: Re-enable all warnings
@@ -5,6 +5,7 @@
 #include "rdb_protocol/artificial_table/backend.hpp"
 #include "rdb_protocol/env.hpp"
 #include "rdb_protocol/func.hpp"
+#include "rdb_protocol/query_result_cache.hpp"
 #include "rdb_protocol/table_common.hpp"
 #include "rdb_protocol/datum_stream/readers.hpp"
 
@@ -38,6 +39,14 @@ bool checked_read_row_from_backend(
     return true;
 }
 
+/* We can't watch system tables for changes, so the results of queries that read them
+aren't cached. */
+static void untrack_read(ql::env_t *env) {
+    if (env->tracked_reads != nullptr) {
+        env->tracked_reads->untracked = true;
+    }
+}
+
 artificial_table_t::artificial_table_t(
         rdb_context_t *rdb_context,
         database_id_t const &database_id,
@@ -58,6 +67,7 @@ const std::string &artificial_table_t::get_pkey() const {
 
 ql::datum_t artificial_table_t::read_row(ql::env_t *env,
         ql::datum_t pval, UNUSED read_mode_t read_mode) {
+    untrack_read(env);
     ql::datum_t row;
 
     try {
@@ -89,6 +99,7 @@ counted_t<ql::datum_stream_t> artificial_table_t::read_all(
         const ql::datumspec_t &datumspec,
         sorting_t sorting,
         UNUSED read_mode_t read_mode) {
+    untrack_read(env);
     counted_t<ql::datum_stream_t> stream;
 
     try {
@@ -1,11 +1,37 @@
 // Copyright 2010-2015 RethinkDB, all rights reserved.
 #include "rdb_protocol/base64.hpp"
 
+#include <string.h>
+
+#include <algorithm>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define BASE64_HAS_X86_KERNELS
+#include <immintrin.h>
+#elif defined(__GNUC__) && defined(__aarch64__)
+#define BASE64_HAS_NEON_KERNELS
+#include <arm_neon.h>
+#endif
+
 #include "rdb_protocol/error.hpp"
 #include "utils.hpp"
 
 const char base64_map[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
 
+// The encoded data is broken into lines of this many characters, separated by CRLF.
+const size_t BASE64_LINE_LENGTH = 76;
+
+// The vector kernels encode or decode as much of the input as they can in whole
+// blocks, and return the number of input bytes they consumed.  The scalar code takes
+// care of the rest.  An encoding kernel always consumes a multiple of 3 bytes and
+// writes exactly 4 characters for each 3 bytes.  A decoding kernel stops at the first
+// block that contains anything but the 64 base64 characters, always consumes a
+// multiple of 4 characters, and may write up to `BASE64_DECODE_SLACK` bytes past the
+// end of what it decoded.
+typedef size_t (*base64_kernel_fn_t)(const char *in, size_t size, char *out);
+
+const size_t BASE64_DECODE_SLACK = 32;
+
 void binary_to_base64_chunk(const char *in, char *out) {
     CT_ASSERT(sizeof(base64_map) == 65);
     out[0] = base64_map[(in[0] & 0xFC) >> 2];
@@ -14,43 +40,353 @@ void binary_to_base64_chunk(const char *in, char *out) {
     out[3] = base64_map[in[2] & 0x3F];
 }
 
-std::string encode_base64(const char *data, size_t size) {
-    size_t remaining_bytes = size;
+#ifdef BASE64_HAS_X86_KERNELS
+// These follow Wojciech Muła's and Daniel Lemire's "Faster Base64 Encoding and
+// Decoding Using AVX2 Instructions".  The AVX2 versions do the same thing as the
+// SSSE3 ones in both 128-bit lanes.
 
-    if (remaining_bytes == 0) {
-        return std::string();
+// Turns 12 bytes (in the low 12 bytes of each lane) into 16 6-bit indices.
+__attribute__((target("ssse3")))
+inline __m128i base64_split_ssse3(__m128i in) {
+    in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7,
+                                           4, 5, 3, 4, 1, 2, 0, 1));
+    const __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+    const __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+    const __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+    const __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+    return _mm_or_si128(t1, t3);
+}
+
+// Maps each 6-bit index to its character, by adding the offset of the range it's in.
+__attribute__((target("ssse3")))
+inline __m128i base64_lookup_ssse3(__m128i indices) {
+    const __m128i offsets = _mm_setr_epi8(
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+    // 0 for 26..51 ('a'..'z'), 1..12 for 52..63 and 13 for 0..25 ('A'..'Z').
+    __m128i range = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+    const __m128i less = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+    range = _mm_or_si128(range, _mm_and_si128(less, _mm_set1_epi8(13)));
+    return _mm_add_epi8(indices, _mm_shuffle_epi8(offsets, range));
+}
+
+__attribute__((target("ssse3")))
+size_t encode_base64_ssse3(const char *in, size_t size, char *out) {
+    size_t i = 0;
+    // We load 16 bytes to use 12 of them.
+    for (; i + 16 <= size; i += 12, out += 16) {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out),
+                         base64_lookup_ssse3(base64_split_ssse3(block)));
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+inline __m256i base64_split_avx2(__m256i in) {
+    in = _mm256_shuffle_epi8(in, _mm256_set_epi8(10, 11, 9, 10, 7, 8, 6, 7,
+                                                 4, 5, 3, 4, 1, 2, 0, 1,
+                                                 10, 11, 9, 10, 7, 8, 6, 7,
+                                                 4, 5, 3, 4, 1, 2, 0, 1));
+    const __m256i t0 = _mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00));
+    const __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+    const __m256i t2 = _mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0));
+    const __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+    return _mm256_or_si256(t1, t3);
+}
+
+__attribute__((target("avx2")))
+inline __m256i base64_lookup_avx2(__m256i indices) {
+    const __m256i offsets = _mm256_setr_epi8(
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+    __m256i range = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+    const __m256i less = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+    range = _mm256_or_si256(range, _mm256_and_si256(less, _mm256_set1_epi8(13)));
+    return _mm256_add_epi8(indices, _mm256_shuffle_epi8(offsets, range));
+}
+
+__attribute__((target("avx2")))
+size_t encode_base64_avx2(const char *in, size_t size, char *out) {
+    size_t i = 0;
+    // Each lane gets 12 bytes, so the second load reads up to byte 28.
+    for (; i + 28 <= size; i += 24, out += 32) {
+        const __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+        const __m128i hi =
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i + 12));
+        const __m256i block = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out),
+                            base64_lookup_avx2(base64_split_avx2(block)));
+    }
+    return i + encode_base64_ssse3(in + i, size - i, out);
+}
+
+// The lookup tables for decoding, indexed by the high nibble of each character.  A
+// character is valid if it's between the lower and upper bound for its nibble, or if
+// it's '/' (which is the only valid character with a high nibble of 2 other than '+').
+// Characters with the top bit set compare as negative, so they're always below.
+#define BASE64_DECODE_LOWER_BOUNDS \
+    1, 1, 0x2b, 0x30, 0x41, 0x50, 0x61, 0x70, 1, 1, 1, 1, 1, 1, 1, 1
+#define BASE64_DECODE_UPPER_BOUNDS \
+    0, 0, 0x2b, 0x39, 0x4f, 0x5a, 0x6f, 0x7a, 0, 0, 0, 0, 0, 0, 0, 0
+#define BASE64_DECODE_SHIFTS \
+    0, 0, 62 - 0x2b, 52 - 0x30, 0 - 0x41, 15 - 0x50, 26 - 0x61, 41 - 0x70, \
+    0, 0, 0, 0, 0, 0, 0, 0
+
+// Returns false if the block has any characters that aren't base64.
+__attribute__((target("ssse3")))
+inline bool base64_unlookup_ssse3(__m128i in, __m128i *indices_out) {
+    const __m128i high_nibbles =
+        _mm_and_si128(_mm_srli_epi32(in, 4), _mm_set1_epi8(0x0f));
+    const __m128i lower_bounds =
+        _mm_shuffle_epi8(_mm_setr_epi8(BASE64_DECODE_LOWER_BOUNDS), high_nibbles);
+    const __m128i upper_bounds =
+        _mm_shuffle_epi8(_mm_setr_epi8(BASE64_DECODE_UPPER_BOUNDS), high_nibbles);
+    const __m128i is_slash = _mm_cmpeq_epi8(in, _mm_set1_epi8('/'));
+    const __m128i outside = _mm_andnot_si128(
+        is_slash,
+        _mm_or_si128(_mm_cmplt_epi8(in, lower_bounds), _mm_cmpgt_epi8(in, upper_bounds)));
+    if (_mm_movemask_epi8(outside) != 0) {
+        return false;
+    }
+    const __m128i shifts =
+        _mm_shuffle_epi8(_mm_setr_epi8(BASE64_DECODE_SHIFTS), high_nibbles);
+    // '/' gets the shift for '+', which is 3 too much.
+    *indices_out = _mm_add_epi8(_mm_add_epi8(in, shifts),
+                                _mm_and_si128(is_slash, _mm_set1_epi8(-3)));
+    return true;
+}
+
+// Packs 16 6-bit indices into 12 bytes, in the low 12 bytes of the result.
+__attribute__((target("ssse3")))
+inline __m128i base64_pack_ssse3(__m128i indices) {
+    const __m128i pairs = _mm_maddubs_epi16(indices, _mm_set1_epi32(0x01400140));
+    const __m128i quads = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00011000));
+    return _mm_shuffle_epi8(quads, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8,
+                                                 14, 13, 12, -1, -1, -1, -1));
+}
+
+__attribute__((target("ssse3")))
+size_t decode_base64_ssse3(const char *in, size_t size, char *out) {
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16, out += 12) {
+        __m128i indices;
+        if (!base64_unlookup_ssse3(
+                _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i)), &indices)) {
+            break;
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out), base64_pack_ssse3(indices));
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+size_t decode_base64_avx2(const char *in, size_t size, char *out) {
+    const __m256i lower_bound_table = _mm256_setr_epi8(
+        BASE64_DECODE_LOWER_BOUNDS, BASE64_DECODE_LOWER_BOUNDS);
+    const __m256i upper_bound_table = _mm256_setr_epi8(
+        BASE64_DECODE_UPPER_BOUNDS, BASE64_DECODE_UPPER_BOUNDS);
+    const __m256i shift_table = _mm256_setr_epi8(
+        BASE64_DECODE_SHIFTS, BASE64_DECODE_SHIFTS);
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32, out += 24) {
+        const __m256i block =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i));
+        const __m256i high_nibbles =
+            _mm256_and_si256(_mm256_srli_epi32(block, 4), _mm256_set1_epi8(0x0f));
+        const __m256i lower_bounds =
+            _mm256_shuffle_epi8(lower_bound_table, high_nibbles);
+        const __m256i upper_bounds =
+            _mm256_shuffle_epi8(upper_bound_table, high_nibbles);
+        const __m256i is_slash = _mm256_cmpeq_epi8(block, _mm256_set1_epi8('/'));
+        const __m256i outside = _mm256_andnot_si256(
+            is_slash,
+            _mm256_or_si256(_mm256_cmpgt_epi8(lower_bounds, block),
+                            _mm256_cmpgt_epi8(block, upper_bounds)));
+        if (_mm256_movemask_epi8(outside) != 0) {
+            break;
+        }
+        const __m256i indices = _mm256_add_epi8(
+            _mm256_add_epi8(block, _mm256_shuffle_epi8(shift_table, high_nibbles)),
+            _mm256_and_si256(is_slash, _mm256_set1_epi8(-3)));
+
+        const __m256i pairs =
+            _mm256_maddubs_epi16(indices, _mm256_set1_epi32(0x01400140));
+        const __m256i quads = _mm256_madd_epi16(pairs, _mm256_set1_epi32(0x00011000));
+        const __m256i packed = _mm256_shuffle_epi8(quads, _mm256_setr_epi8(
+            2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+            2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+        // Move the 12 bytes of the upper lane right behind the ones of the lower lane.
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out),
+                            _mm256_permutevar8x32_epi32(
+                                packed, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7)));
+    }
+    return i + decode_base64_ssse3(in + i, size - i, out);
+}
+#endif  // BASE64_HAS_X86_KERNELS
+
+#ifdef BASE64_HAS_NEON_KERNELS
+// NEON can deinterleave and interleave 3 and 4 vectors on load and store, and look up
+// 64 byte tables, which makes both directions straightforward.
+
+uint8x16x4_t load_neon_table(const uint8_t *table) {
+    uint8x16x4_t res;
+    for (int i = 0; i < 4; ++i) {
+        res.val[i] = vld1q_u8(table + 16 * i);
     }
+    return res;
+}
 
-    std::string res;
-    // Scale output size for base64 encoding and account for a CRLF every 76 characters
-    res.reserve(((remaining_bytes * 52) + 39) / 38);
+size_t encode_base64_neon(const char *in, size_t size, char *out) {
+    const uint8x16x4_t table = load_neon_table(
+        reinterpret_cast<const uint8_t *>(base64_map));
+    const uint8x16_t mask = vdupq_n_u8(0x3f);
+    size_t i = 0;
+    for (; i + 48 <= size; i += 48, out += 64) {
+        const uint8x16x3_t bytes = vld3q_u8(reinterpret_cast<const uint8_t *>(in + i));
+        uint8x16x4_t indices;
+        indices.val[0] = vshrq_n_u8(bytes.val[0], 2);
+        indices.val[1] = vandq_u8(
+            vorrq_u8(vshlq_n_u8(bytes.val[0], 4), vshrq_n_u8(bytes.val[1], 4)), mask);
+        indices.val[2] = vandq_u8(
+            vorrq_u8(vshlq_n_u8(bytes.val[1], 2), vshrq_n_u8(bytes.val[2], 6)), mask);
+        indices.val[3] = vandq_u8(bytes.val[2], mask);
+        uint8x16x4_t chars;
+        for (int j = 0; j < 4; ++j) {
+            chars.val[j] = vqtbl4q_u8(table, indices.val[j]);
+        }
+        vst4q_u8(reinterpret_cast<uint8_t *>(out), chars);
+    }
+    return i;
+}
 
-    char encoded_chunk[4];
-    const char *chunk = data;
+// Maps the characters 0..127 to their 6-bit values, or 0xff for anything else.
+const uint8_t base64_neon_unmap[128] = {
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 62, 255, 255, 255, 63,
+    52, 53, 54, 55, 56, 57, 58, 59, 60, 61, 255, 255, 255, 255, 255, 255,
+    255, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14,
+    15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 255, 255, 255, 255, 255,
+    255, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+    41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, 255, 255, 255, 255, 255
+};
 
-    for (; remaining_bytes > 3;
-         remaining_bytes -= 3) {
-        binary_to_base64_chunk(chunk, encoded_chunk);
-        res.append(encoded_chunk, 4);
-        if (res.size() % 78 == 76) {
-            res.append("\r\n");
+size_t decode_base64_neon(const char *in, size_t size, char *out) {
+    const uint8x16x4_t low_table = load_neon_table(base64_neon_unmap);
+    const uint8x16x4_t high_table = load_neon_table(base64_neon_unmap + 64);
+    const uint8x16_t sixty_four = vdupq_n_u8(64);
+    size_t i = 0;
+    for (; i + 64 <= size; i += 64, out += 48) {
+        const uint8x16x4_t chars = vld4q_u8(reinterpret_cast<const uint8_t *>(in + i));
+        uint8x16x4_t indices;
+        uint8x16_t invalid = vdupq_n_u8(0);
+        for (int j = 0; j < 4; ++j) {
+            // Out of range indices give 0 with `vqtbl4q_u8` and leave the value alone
+            // with `vqtbx4q_u8`, so characters above 127 come out as 0.  They're caught
+            // by checking the top bit of the characters themselves.
+            indices.val[j] = vqtbx4q_u8(vqtbl4q_u8(low_table, chars.val[j]),
+                                        high_table,
+                                        vsubq_u8(chars.val[j], sixty_four));
+            invalid = vorrq_u8(invalid, vorrq_u8(indices.val[j], chars.val[j]));
         }
-        chunk += 3;
+        // Valid values fit in 6 bits and valid characters in 7.
+        if (vmaxvq_u8(invalid) >= 0x80) {
+            break;
+        }
+        uint8x16x3_t bytes;
+        bytes.val[0] = vorrq_u8(vshlq_n_u8(indices.val[0], 2),
+                                vshrq_n_u8(indices.val[1], 4));
+        bytes.val[1] = vorrq_u8(vshlq_n_u8(indices.val[1], 4),
+                                vshrq_n_u8(indices.val[2], 2));
+        bytes.val[2] = vorrq_u8(vshlq_n_u8(indices.val[2], 6), indices.val[3]);
+        vst3q_u8(reinterpret_cast<uint8_t *>(out), bytes);
+    }
+    return i;
+}
+#endif  // BASE64_HAS_NEON_KERNELS
+
+base64_kernel_fn_t choose_encode_base64_kernel() {
+#ifdef BASE64_HAS_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return &encode_base64_avx2;
+    }
+    if (__builtin_cpu_supports("ssse3")) {
+        return &encode_base64_ssse3;
+    }
+#endif
+#ifdef BASE64_HAS_NEON_KERNELS
+    return &encode_base64_neon;
+#endif
+    return nullptr;
+}
+
+base64_kernel_fn_t choose_decode_base64_kernel() {
+#ifdef BASE64_HAS_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return &decode_base64_avx2;
+    }
+    if (__builtin_cpu_supports("ssse3")) {
+        return &decode_base64_ssse3;
+    }
+#endif
+#ifdef BASE64_HAS_NEON_KERNELS
+    return &decode_base64_neon;
+#endif
+    return nullptr;
+}
+
+std::string encode_base64_with(const char *data, size_t size, base64_kernel_fn_t kernel) {
+    if (size == 0) {
+        return std::string();
     }
 
-    char partial_chunk[4] = { 0, 0, 0, 0 };
-    for (size_t i = 0; i < remaining_bytes; ++i) {
-        partial_chunk[i] = chunk[i];
+    const size_t encoded_size = 4 * ((size + 2) / 3);
+    const size_t num_lines = (encoded_size + BASE64_LINE_LENGTH - 1) / BASE64_LINE_LENGTH;
+    std::string res(encoded_size + 2 * (num_lines - 1), '\0');
+    char *out = &res[0];
+
+    // First encode everything without line breaks...
+    size_t done = kernel != nullptr ? kernel(data, size, out) : 0;
+    char *chunk_out = out + (done / 3) * 4;
+    for (; done + 3 <= size; done += 3, chunk_out += 4) {
+        binary_to_base64_chunk(data + done, chunk_out);
+    }
+    if (done < size) {
+        char partial_chunk[3] = { 0, 0, 0 };
+        memcpy(partial_chunk, data + done, size - done);
+        binary_to_base64_chunk(partial_chunk, chunk_out);
+        for (size_t i = size - done + 1; i < 4; ++i) {
+            chunk_out[i] = '=';
+        }
     }
-    binary_to_base64_chunk(partial_chunk, encoded_chunk);
 
-    for (size_t i = remaining_bytes + 1; i < 4; ++i) {
-        encoded_chunk[i] = '=';
+    // ... and then move the lines apart from the back, so that each line only has to be
+    // moved once.
+    for (size_t line = num_lines - 1; line > 0; --line) {
+        char *line_start = out + line * BASE64_LINE_LENGTH;
+        const size_t line_size =
+            std::min(BASE64_LINE_LENGTH, encoded_size - line * BASE64_LINE_LENGTH);
+        memmove(line_start + 2 * line, line_start, line_size);
+        line_start[2 * line - 2] = '\r';
+        line_start[2 * line - 1] = '\n';
     }
-    res.append(encoded_chunk, 4);
     return res;
 }
 
+std::string encode_base64(const char *data, size_t size) {
+    static const base64_kernel_fn_t kernel = choose_encode_base64_kernel();
+    return encode_base64_with(data, size, kernel);
+}
+
+std::string encode_base64_scalar(const char *data, size_t size) {
+    return encode_base64_with(data, size, nullptr);
+}
+
 inline char base64_value(char c) {
     if (c >= 'A' && c <= 'Z') {
         return c - 'A';
@@ -90,29 +426,43 @@ const char* fill_chunk_values(const char *in, const char *in_end, char *out,
     return in;
 }
 
-std::string decode_base64(const char *bdata, size_t bsize) {
-    // This assumes no whitespace in the input, so we may be overallocating a bit
-    std::string res;
-    res.reserve((bsize / 4) * 3);
+std::string decode_base64_with(const char *bdata, size_t bsize,
+                               base64_kernel_fn_t kernel) {
+    // This assumes no whitespace in the input, so we may be overallocating a bit.  The
+    // slack is for the kernel's stores.
+    std::string res(((bsize + 3) / 4) * 3 + BASE64_DECODE_SLACK, '\0');
+    char *out = &res[0];
 
     bool done = false;
     size_t chars_filled;
     char chunk_values[4];
-    char decoded_chunk[3];
     const char *current_data = bdata;
     const char *data_end = bdata + bsize;
 
+    // The kernel stops at whitespace, so it gets to try again whenever the scalar code
+    // has skipped some.  Anything else it stops at is either the padding or something
+    // the scalar code will complain about.
+    bool try_kernel = kernel != nullptr;
     while (!done) {
+        if (try_kernel) {
+            const size_t consumed = kernel(current_data, data_end - current_data, out);
+            current_data += consumed;
+            out += (consumed / 4) * 3;
+        }
+
+        const char *chunk_start = current_data;
         current_data = fill_chunk_values(current_data, data_end, chunk_values,
                                          &done, &chars_filled);
-        base64_chunk_to_binary(chunk_values, decoded_chunk);
+        try_kernel = kernel != nullptr
+            && static_cast<size_t>(current_data - chunk_start) > chars_filled;
+        base64_chunk_to_binary(chunk_values, out);
 
         if (chars_filled == 1) {
             rfail_datum(ql::base_exc_t::LOGIC,
                         "Invalid base64 length: 1 character remaining, "
                         "cannot decode a full byte.");
         } else if (chars_filled != 0) {
-            res.append(decoded_chunk, chars_filled - 1);
+            out += chars_filled - 1;
         }
     }
 
@@ -125,5 +475,15 @@ std::string decode_base64(const char *bdata, size_t bsize) {
         }
     }
 
+    res.resize(out - res.data());
     return res;
 }
+
+std::string decode_base64(const char *bdata, size_t bsize) {
+    static const base64_kernel_fn_t kernel = choose_decode_base64_kernel();
+    return decode_base64_with(bdata, bsize, kernel);
+}
+
+std::string decode_base64_scalar(const char *bdata, size_t bsize) {
+    return decode_base64_with(bdata, bsize, nullptr);
+}
@@ -13,6 +13,12 @@ namespace ql {
 static const int64_t DEFAULT_MIN_ELS = 1;
 static const int64_t DEFAULT_FIRST_SCALEDOWN = 4;
 static const int64_t DEFAULT_MAX_SIZE = MEGABYTE;
+// The largest batches `adaptive_batch_size_t` grows to, unless `max_batch_bytes` says
+// otherwise.
+static const int64_t DEFAULT_MAX_ADAPTIVE_SIZE = 8 * MEGABYTE;
+// `adaptive_batch_size_t` shrinks the batches when reading one takes more than this
+// many times as long as the client's round trip.
+static const int64_t ADAPTIVE_SHRINK_RATIO = 4;
 // The maximum duration of a batch in microseconds.
 static const kiloticks_t DEFAULT_MAX_DURATION{500 * 1000};
 // These numbers are sort of arbitrary, but they seem to work. See `scale_down()`
@@ -137,6 +143,25 @@ batchspec_t batchspec_t::user(batch_type_t batch_type, env_t *env) {
                        get_kiloticks());
 }
 
+batchspec_t batchspec_t::user(batch_type_t batch_type,
+                              env_t *env,
+                              adaptive_batch_size_t *adaptive) {
+    batchspec_t ret = user(batch_type, env);
+    datum_t min_size_d, max_size_d;
+    set_if_present("min_batch_bytes", env, &min_size_d);
+    set_if_present("max_batch_bytes", env, &max_size_d);
+    int64_t max_size = max_size_d.has()
+                       ? max_size_d.as_int()
+                       : DEFAULT_MAX_ADAPTIVE_SIZE;
+    int64_t min_size = min_size_d.has()
+                       ? min_size_d.as_int()
+                       : DEFAULT_MAX_SIZE;
+    max_size = std::max<int64_t>(max_size, 1);
+    min_size = std::min(std::max<int64_t>(min_size, 1), max_size);
+    ret.max_size = adaptive->next_size(min_size, max_size);
+    return ret;
+}
+
 batchspec_t batchspec_t::with_new_batch_type(batch_type_t new_batch_type) const {
     return batchspec_t(new_batch_type, min_els, max_els, max_size,
                        first_scaledown_factor, max_dur, start_time);
@@ -241,6 +266,47 @@ batcher_t batchspec_t::to_batcher() const {
     return batcher_t(batch_type, real_min_els, real_max_els, real_max_size, end_time);
 }
 
+adaptive_batch_size_t::adaptive_batch_size_t()
+    : size(DEFAULT_MAX_SIZE),
+      last_bytes(0),
+      last_read_time{0},
+      sent_time{0},
+      idle_time{0},
+      has_new_idle_time(false) { }
+
+void adaptive_batch_size_t::note_request() {
+    if (sent_time.micros != 0) {
+        idle_time.micros = get_kiloticks().micros - sent_time.micros;
+        has_new_idle_time = true;
+    }
+}
+
+int64_t adaptive_batch_size_t::next_size(int64_t min_size, int64_t max_size) {
+    if (has_new_idle_time) {
+        has_new_idle_time = false;
+        if (idle_time.micros >= last_read_time.micros && last_bytes * 2 >= size) {
+            // The last batch was (about) as big as we allowed, and the round trip
+            // took longer than reading it.
+            size = size > std::numeric_limits<int64_t>::max() / 2
+                ? std::numeric_limits<int64_t>::max()
+                : size * 2;
+        } else if (last_read_time.micros > ADAPTIVE_SHRINK_RATIO * idle_time.micros) {
+            size /= 2;
+        }
+    }
+    size = std::min(std::max(size, min_size), max_size);
+    return size;
+}
+
+void adaptive_batch_size_t::note_batch(int64_t bytes, kiloticks_t read_time) {
+    last_bytes = bytes;
+    last_read_time = read_time;
+}
+
+void adaptive_batch_size_t::note_sent() {
+    sent_time = get_kiloticks();
+}
+
 template<cluster_version_t W>
 void serialize(write_message_t *wm, const batchspec_t &batchspec) {
     static_assert(
@@ -65,6 +65,7 @@ public:
                 0};
     }
     batch_type_t get_batch_type() { return batch_type; }
+    int64_t get_els_left() const { return els_left; }
 private:
     DISABLE_COPYING(batcher_t);
     friend class batchspec_t;
@@ -77,9 +78,48 @@ private:
     const kiloticks_t end_time;
 };
 
+/* `adaptive_batch_size_t` picks the byte size of the batches of one cursor.  When the
+client takes at least as long to ask for the next batch as we took to read the last
+one, round trips dominate (a slow link, or a far away client), so the batches grow to
+need fewer of them.  When reading takes much longer than the client's round trip, they
+shrink back so the client gets its rows sooner.  The size starts at the default batch
+size and stays within the `min_batch_bytes` and `max_batch_bytes` optargs, which
+default to not going below the default batch size. */
+class adaptive_batch_size_t {
+public:
+    adaptive_batch_size_t();
+
+    // Called when the client asks for the next batch.
+    void note_request();
+    // Returns the size to read the next batch with.  It only changes once per
+    // `note_request`.
+    int64_t next_size(int64_t min_size, int64_t max_size);
+    // Called once a batch has been read.
+    void note_batch(int64_t bytes, kiloticks_t read_time);
+    // Called when a batch is sent to the client.
+    void note_sent();
+
+    int64_t get_size() const { return size; }
+    kiloticks_t get_idle_time() const { return idle_time; }
+
+private:
+    int64_t size;
+    int64_t last_bytes;
+    kiloticks_t last_read_time;
+    // When the last batch was sent, or zero before the first one.
+    kiloticks_t sent_time;
+    kiloticks_t idle_time;
+    // Whether `idle_time` was measured since the size last changed.
+    bool has_new_idle_time;
+};
+
 class batchspec_t {
 public:
     static batchspec_t user(batch_type_t batch_type, env_t *env);
+    // Like `user`, but with the byte size chosen by `adaptive`.
+    static batchspec_t user(batch_type_t batch_type,
+                            env_t *env,
+                            adaptive_batch_size_t *adaptive);
     static batchspec_t all(); // Gimme everything.
     static batchspec_t empty() { return batchspec_t(); }
     static batchspec_t default_for(batch_type_t batch_type);
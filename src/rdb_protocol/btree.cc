@@ -4,14 +4,17 @@
 #include <algorithm>
 #include <functional>
 #include <iterator>
+#include <map>
 #include <set>
 #include <string>
 #include <vector>
 
+#include "arch/runtime/resource_usage.hpp"
 #include "btree/concurrent_traversal.hpp"
 #include "btree/get_distribution.hpp"
 #include "btree/operations.hpp"
 #include "btree/reql_specific.hpp"
+#include "btree/sample.hpp"
 #include "btree/superblock.hpp"
 #include "buffer_cache/serialize_onto_blob.hpp"
 #include "concurrency/coro_pool.hpp"
@@ -20,6 +23,7 @@
 #include "containers/archive/boost_types.hpp"
 #include "containers/archive/buffer_group_stream.hpp"
 #include "containers/archive/buffer_stream.hpp"
+#include "containers/archive/vector_stream.hpp"
 #include "containers/scoped.hpp"
 #include "rdb_protocol/geo/exceptions.hpp"
 #include "rdb_protocol/geo/indexing.hpp"
@@ -31,6 +35,7 @@
 #include "rdb_protocol/serialize_datum_onto_blob.hpp"
 #include "rdb_protocol/shards.hpp"
 #include "rdb_protocol/table_common.hpp"
+#include "rdb_protocol/text_index.hpp"
 
 #include "debug.hpp"
 
@@ -49,7 +54,7 @@ bool rdb_value_sizer_t::fits(const void *value, int length_available) const {
 }
 
 int rdb_value_sizer_t::max_possible_size() const {
-    return blob::btree_maxreflen;
+    return blob::btree_maxreflen_for(block_size_);
 }
 
 block_magic_t rdb_value_sizer_t::leaf_magic() {
@@ -64,15 +69,17 @@ block_magic_t rdb_value_sizer_t::btree_leaf_magic() const {
 max_block_size_t rdb_value_sizer_t::block_size() const { return block_size_; }
 
 bool btree_value_fits(max_block_size_t bs, int data_length, const rdb_value_t *value) {
-    return blob::ref_fits(bs, data_length, value->value_ref(), blob::btree_maxreflen);
+    return blob::ref_fits(bs, data_length, value->value_ref(),
+                          blob::btree_maxreflen_for(bs));
 }
 
 // Remember that secondary indexes and the main btree both point to the same rdb
 // value -- you don't want to double-delete that value!
 void actually_delete_rdb_value(buf_parent_t parent, void *value) {
-    blob_t blob(parent.cache()->max_block_size(),
+    const max_block_size_t bs = parent.cache()->max_block_size();
+    blob_t blob(bs,
                 static_cast<rdb_value_t *>(value)->value_ref(),
-                blob::btree_maxreflen);
+                blob::btree_maxreflen_for(bs));
     blob.clear(parent);
 }
 
@@ -80,15 +87,21 @@ void detach_rdb_value(buf_parent_t parent, const void *value) {
     // This const_cast is ok, since `detach_subtrees` is one of the operations
     // that does not actually change value.
     void *non_const_value = const_cast<void *>(value);
-    blob_t blob(parent.cache()->max_block_size(),
+    const max_block_size_t bs = parent.cache()->max_block_size();
+    blob_t blob(bs,
                 static_cast<rdb_value_t *>(non_const_value)->value_ref(),
-                blob::btree_maxreflen);
+                blob::btree_maxreflen_for(bs));
     blob.detach_subtrees(parent);
 }
 
 void rdb_get(const store_key_t &store_key, btree_slice_t *slice,
              superblock_t *superblock, point_read_response_t *response,
              profile::trace_t *trace) {
+    if (!slice->may_contain_key(store_key.btree_key())) {
+        superblock->release();
+        response->data = ql::datum_t::null();
+        return;
+    }
     keyvalue_location_t kv_location;
     rdb_value_sizer_t sizer(superblock->cache()->max_block_size());
     find_keyvalue_location_for_read(&sizer, superblock,
@@ -96,6 +109,7 @@ void rdb_get(const store_key_t &store_key, btree_slice_t *slice,
                                     &slice->stats, trace);
 
     if (!kv_location.value.has()) {
+        slice->note_key_missing();
         response->data = ql::datum_t::null();
     } else {
         response->data = get_data(static_cast<rdb_value_t *>(kv_location.value.get()),
@@ -134,23 +148,69 @@ void kv_location_delete(keyvalue_location_t *kv_location,
             deletion_context->balancing_detacher(), delete_mode);
 }
 
+/* Whether `kv_location_set` may rewrite a row's blob in place.  Index entries share
+the blobs of their rows, so that's only safe for tables without secondary indexes:
+the index entry of the old row would see the new row's bytes, and deleting it would
+free the blob that the row still uses. */
+enum class blob_rewrite_t { IN_PLACE_IF_POSSIBLE, NEW_BLOB };
+
 MUST_USE ql::serialization_result_t
 kv_location_set(keyvalue_location_t *kv_location,
                 const store_key_t &key,
                 ql::datum_t data,
                 repli_timestamp_t timestamp,
                 const deletion_context_t *deletion_context,
-                rdb_modification_info_t *mod_info_out) THROWS_NOTHING {
-    scoped_malloc_t<rdb_value_t> new_value(blob::btree_maxreflen);
-    memset(new_value.get(), 0, blob::btree_maxreflen);
-
+                rdb_modification_info_t *mod_info_out,
+                blob_rewrite_t blob_rewrite) THROWS_NOTHING {
     const max_block_size_t block_size = kv_location->buf.cache()->max_block_size();
+    const int maxreflen = blob::btree_maxreflen_for(block_size);
+
+    write_message_t wm;
+    ql::serialization_result_t res = datum_serialize(
+        &wm, data, ql::check_datum_serialization_errors_t::YES);
+    if (bad(res)) return res;
+
+    // A large row whose serialization keeps its size, as it does when an update
+    // changes a field to a value of the same size, only gets the blob blocks whose
+    // bytes change rewritten.  The row keeps its blob, so the old value is reported
+    // with the same ref as the new one, which tells `update_sindexes` not to delete it.
+    if (blob_rewrite == blob_rewrite_t::IN_PLACE_IF_POSSIBLE
+        && kv_location->value.has()
+        && blob::value_size(kv_location->value_as<rdb_value_t>()->value_ref(),
+                            maxreflen) == static_cast<int64_t>(wm.size())) {
+        vector_stream_t stream;
+        stream.reserve(wm.size());
+        int write_res = send_write_message(&stream, &wm);
+        guarantee(write_res == 0);
+        blob_t blob(block_size, kv_location->value_as<rdb_value_t>()->value_ref(),
+                    maxreflen);
+        if (blob.rewrite_changed_blocks(stream.vector(),
+                                        buf_parent_t(&kv_location->buf))) {
+            rdb_value_t *value = kv_location->value_as<rdb_value_t>();
+            if (mod_info_out != nullptr) {
+                guarantee(mod_info_out->added.second.empty());
+                guarantee(mod_info_out->deleted.second.empty());
+                mod_info_out->added.second.assign(
+                    value->value_ref(),
+                    value->value_ref() + value->inline_size(block_size));
+                mod_info_out->deleted.second = mod_info_out->added.second;
+            }
+            // Updates the row's timestamp in the leaf.
+            rdb_value_sizer_t sizer(block_size);
+            apply_keyvalue_change(&sizer, kv_location, key.btree_key(),
+                                  timestamp,
+                                  deletion_context->balancing_detacher(),
+                                  delete_mode_t::REGULAR_QUERY);
+            return ql::serialization_result_t::SUCCESS;
+        }
+    }
+
+    scoped_malloc_t<rdb_value_t> new_value(maxreflen);
+    memset(new_value.get(), 0, maxreflen);
+
     {
-        blob_t blob(block_size, new_value->value_ref(), blob::btree_maxreflen);
-        ql::serialization_result_t res
-            = datum_serialize_onto_blob(buf_parent_t(&kv_location->buf),
-                                        &blob, data);
-        if (bad(res)) return res;
+        blob_t blob(block_size, new_value->value_ref(), maxreflen);
+        write_onto_blob(buf_parent_t(&kv_location->buf), &blob, wm);
     }
 
     if (mod_info_out) {
@@ -212,12 +272,17 @@ batched_replace_response_t rdb_replace_and_return_superblock(
     const deletion_context_t *deletion_context,
     promise_t<superblock_t *> *superblock_promise,
     rdb_modification_info_t *mod_info_out,
+    blob_rewrite_t blob_rewrite,
     profile::trace_t *trace) {
     const return_changes_t return_changes = replacer->should_return_changes();
     const datum_string_t &primary_key = info.btree->primary_key;
     const store_key_t &key = *info.key;
 
     try {
+        // The key filter has to know about the key before we let go of the
+        // superblock, so that later reads never miss it.  If we end up not inserting
+        // it, that's just a false positive.
+        info.btree->slice->note_key_inserted(key.btree_key());
         keyvalue_location_t kv_location;
         rdb_value_sizer_t sizer(info.superblock->cache()->max_block_size());
         find_keyvalue_location_for_write(&sizer, info.superblock,
@@ -269,7 +334,7 @@ batched_replace_response_t rdb_replace_and_return_superblock(
                 ql::serialization_result_t res =
                     kv_location_set(&kv_location, *info.key, new_val,
                                     info.btree->timestamp, deletion_context,
-                                    mod_info_out);
+                                    mod_info_out, blob_rewrite);
                 if (res & ql::serialization_result_t::ARRAY_TOO_BIG) {
                     rfail_typed_target(&new_val, "Array too large for disk writes "
                                        "(limit 100,000 elements).");
@@ -314,12 +379,22 @@ batched_replace_response_t rdb_replace_and_return_superblock(
     }
 }
 
+ql::env_t *write_hook_env_t::get() {
+    if (!env.has()) {
+        env.init(new ql::env_t(&non_interruptor,
+                               ql::return_empty_normal_batches_t::NO,
+                               reql_version_t::LATEST));
+    }
+    return env.get();
+}
+
 ql::datum_t btree_batched_replacer_t::apply_write_hook(
     const datum_string_t &pkey,
     const ql::datum_t &d,
     const ql::datum_t &res_,
     const ql::datum_t &write_timestamp,
-    const counted_t<const ql::func_t> &write_hook) const {
+    const counted_t<const ql::func_t> &write_hook,
+    write_hook_env_t *write_hook_env) {
     ql::datum_t res = res_;
     if (write_hook.has()) {
         ql::datum_t primary_key;
@@ -333,16 +408,11 @@ ql::datum_t btree_batched_replacer_t::apply_write_hook(
         }
         ql::datum_t modified;
         try {
-            cond_t non_interruptor;
-            ql::env_t write_hook_env(&non_interruptor,
-                                     ql::return_empty_normal_batches_t::NO,
-                                     reql_version_t::LATEST);
-
             ql::datum_object_builder_t builder;
             builder.overwrite("primary_key", std::move(primary_key));
             builder.overwrite("timestamp", write_timestamp);
 
-            modified = write_hook->call(&write_hook_env,
+            modified = write_hook->call(write_hook_env->get(),
                                         std::vector<ql::datum_t>{
                                             std::move(builder).to_datum(),
                                                 d,
@@ -374,16 +444,18 @@ ql::datum_t btree_batched_replacer_t::apply_write_hook(
 
 class one_replace_t : public btree_point_replacer_t {
 public:
-    one_replace_t(const btree_batched_replacer_t *_replacer, size_t _index)
-        : replacer(_replacer), index(_index) { }
+    one_replace_t(const btree_batched_replacer_t *_replacer, size_t _index,
+                  write_hook_env_t *_write_hook_env)
+        : replacer(_replacer), index(_index), write_hook_env(_write_hook_env) { }
 
     ql::datum_t replace(const ql::datum_t &d) const {
-        return replacer->replace(d, index);
+        return replacer->replace(d, index, write_hook_env);
     }
     return_changes_t should_return_changes() const { return replacer->should_return_changes(); }
 private:
     const btree_batched_replacer_t *const replacer;
     const size_t index;
+    write_hook_env_t *const write_hook_env;
 };
 
 void do_a_replace_from_batched_replace(
@@ -411,6 +483,9 @@ void do_a_replace_from_batched_replace(
     rdb_modification_report_t mod_report(*info.key);
     ql::datum_t res = rdb_replace_and_return_superblock(
         info, &one_replace, &deletion_context, superblock_promise, &mod_report.info,
+        mod_cb->has_sindexes()
+            ? blob_rewrite_t::NEW_BLOB
+            : blob_rewrite_t::IN_PLACE_IF_POSSIBLE,
         trace);
     *stats_out = (*stats_out).merge(res, ql::stats_merge, limits, conditions);
 
@@ -439,6 +514,7 @@ batched_replace_response_t rdb_batched_replace(
     ql::datum_t stats = ql::datum_t::empty_object();
 
     std::set<std::string> conditions;
+    write_hook_env_t write_hook_env;
 
     // We have to drain write operations before destructing everything above us,
     // because the coroutines being drained use them.
@@ -466,6 +542,9 @@ batched_replace_response_t rdb_batched_replace(
         // write operations depending on the presence of limit changefeeds.
         scoped_ptr_t<real_superblock_t> current_superblock(superblock->release());
         bool update_pkey_cfeeds = sindex_cb->has_pkey_cfeeds(keys);
+        // The rows' secondary index changes are applied together once they've all
+        // been written (unless there are limit changefeeds on the indexes).
+        sindex_cb->batch_sindex_updates();
         {
             auto_drainer_t drainer;
             for (size_t i = 0; i < keys.size(); ++i) {
@@ -477,7 +556,7 @@ batched_replace_response_t rdb_batched_replace(
                         &sink,
                         source.enter_write(),
                         btree_loc_info_t(&info, current_superblock.release(), &keys[i]),
-                        one_replace_t(replacer, i),
+                        one_replace_t(replacer, i, &write_hook_env),
                         limits,
                         &superblock_promise,
                         sindex_cb,
@@ -493,6 +572,7 @@ batched_replace_response_t rdb_batched_replace(
                                             // we don't need to finish.
             }
         }
+        sindex_cb->apply_sindex_updates();
         // This needs to happen after draining.
         if (update_pkey_cfeeds) {
             guarantee(current_superblock.has());
@@ -516,6 +596,8 @@ void rdb_set(const store_key_t &key,
              rdb_modification_info_t *mod_info,
              profile::trace_t *trace,
              promise_t<superblock_t *> *pass_back_superblock) {
+    // See `rdb_replace_and_return_superblock()`.
+    slice->note_key_inserted(key.btree_key());
     keyvalue_location_t kv_location;
     rdb_value_sizer_t sizer(superblock->cache()->max_block_size());
     find_keyvalue_location_for_write(&sizer, superblock, key.btree_key(), timestamp,
@@ -536,7 +618,7 @@ void rdb_set(const store_key_t &key,
     if (overwrite || !had_value) {
         ql::serialization_result_t res =
             kv_location_set(&kv_location, key, data, timestamp, deletion_context,
-                            mod_info);
+                            mod_info, blob_rewrite_t::NEW_BLOB);
         if (res & ql::serialization_result_t::ARRAY_TOO_BIG) {
             rfail_typed_target(&data, "Array too large for disk writes "
                                "(limit 100,000 elements).");
@@ -552,6 +634,46 @@ void rdb_set(const store_key_t &key,
         (had_value ? point_write_result_t::DUPLICATE : point_write_result_t::STORED);
 }
 
+void rdb_set_serialized(const store_key_t &key,
+                        const std::vector<char> &serialized_data,
+                        btree_slice_t *slice,
+                        repli_timestamp_t timestamp,
+                        superblock_t *superblock,
+                        const deletion_context_t *deletion_context,
+                        promise_t<superblock_t *> *pass_back_superblock) {
+    // See `rdb_replace_and_return_superblock()`.
+    slice->note_key_inserted(key.btree_key());
+    keyvalue_location_t kv_location;
+    rdb_value_sizer_t sizer(superblock->cache()->max_block_size());
+    find_keyvalue_location_for_write(&sizer, superblock, key.btree_key(), timestamp,
+                                     deletion_context->balancing_detacher(),
+                                     &kv_location, nullptr, pass_back_superblock);
+    slice->stats.pm_keys_set.record();
+    slice->stats.pm_total_keys_set += 1;
+
+    const max_block_size_t block_size = kv_location.buf.cache()->max_block_size();
+    const int maxreflen = blob::btree_maxreflen_for(block_size);
+    scoped_malloc_t<rdb_value_t> new_value(maxreflen);
+    memset(new_value.get(), 0, maxreflen);
+    {
+        blob_t blob(block_size, new_value->value_ref(), maxreflen);
+        write_message_t wm;
+        wm.append(serialized_data.data(), serialized_data.size());
+        write_onto_blob(buf_parent_t(&kv_location.buf), &blob, wm);
+    }
+
+    if (kv_location.value.has()) {
+        deletion_context->in_tree_deleter()->delete_value(
+                buf_parent_t(&kv_location.buf), kv_location.value.get());
+    }
+
+    kv_location.value = std::move(new_value);
+    apply_keyvalue_change(&sizer, &kv_location, key.btree_key(),
+                          timestamp,
+                          deletion_context->balancing_detacher(),
+                          delete_mode_t::REGULAR_QUERY);
+}
+
 void rdb_delete(const store_key_t &key, btree_slice_t *slice,
                 repli_timestamp_t timestamp,
                 real_superblock_t *superblock,
@@ -603,13 +725,15 @@ public:
                        key_range_t *_active_region_range_inout,
                        reql_version_t wire_func_reql_version,
                        ql::map_wire_func_t wire_func,
-                       sindex_multi_bool_t _multi)
+                       sindex_multi_bool_t _multi,
+                       bool _hashed)
         : pkey_range(std::move(_pkey_range)),
           datumspec(std::move(_datumspec)),
           active_region_range_inout(_active_region_range_inout),
           func_reql_version(wire_func_reql_version),
           func(wire_func.compile_wire_func()),
-          multi(_multi) {
+          multi(_multi),
+          hashed(_hashed) {
         datumspec.visit<void>(
             [&](const ql::datum_range_t &r) {
                 lbound_trunc_key = r.get_left_bound_trunc_key(func_reql_version);
@@ -625,6 +749,9 @@ private:
     const reql_version_t func_reql_version;
     const counted_t<const ql::func_t> func;
     const sindex_multi_bool_t multi;
+    // Whether this is a hash index, whose keys say nothing about whether an entry
+    // matches.
+    const bool hashed;
     // The (truncated) boundary keys for the datum range stored in `datumspec`.
     std::string lbound_trunc_key;
     std::string rbound_trunc_key;
@@ -694,6 +821,8 @@ public:
         THROWS_ONLY(interrupted_exc_t);
     void finish(continue_bool_t last_cb) THROWS_ONLY(interrupted_exc_t);
 private:
+    bool sindex_needs_row(const store_key_t &key, const optional<std::string> &skey_left);
+
     const rget_io_data_t io; // How do get data in/out.
     job_data_t job; // What to do next (stateful).
     const optional<rget_sindex_data_t> sindex; // Optional sindex information.
@@ -703,6 +832,16 @@ private:
     // State for internal bookkeeping.
     bool bad_init;
     optional<std::string> last_truncated_secondary_for_abort;
+    // Whether the job looks at the rows, and whether it looks at nothing but their
+    // secondary index values (`distinct` on an index).
+    bool job_uses_rows;
+    bool job_uses_sindex_vals;
+    // The untruncated secondary key of the last index entry we loaded the row for
+    // because of `job_uses_sindex_vals`, and the index value computed for it.
+    // Entries with the same untruncated secondary key have the same index value.
+    optional<std::string> last_loaded_secondary;
+    std::string last_sindex_val_secondary;
+    ql::datum_t last_sindex_val;
     scoped_ptr_t<profile::disabler_t> disabler;
     scoped_ptr_t<profile::sampler_t> sampler;
 };
@@ -726,19 +865,74 @@ public:
             skey_left,
             std::move(waiter));
     }
+    virtual size_t get_read_ahead_budget() THROWS_NOTHING {
+        return TRAVERSAL_READ_AHEAD_BUDGET;
+    }
 private:
     rget_cb_t *cb;
     size_t copies;
     optional<std::string> skey_left;
 };
 
+/* `rget_keys_cb_wrapper_t` is for reads of a set of primary keys, as `get_all` does.
+Instead of looking the keys up one at a time, we make one traversal over the range they
+span and skip the subtrees that don't hold any of them. That way the keys share the walk
+down the B-tree, and their values are loaded concurrently. */
+class rget_keys_cb_wrapper_t : public concurrent_traversal_callback_t {
+public:
+    rget_keys_cb_wrapper_t(
+            rget_cb_t *_cb,
+            const std::map<store_key_t, uint64_t> *_keys)
+        : cb(_cb), keys(_keys), pairs_seen_(0) { }
+    virtual void filter_range(
+            const btree_key_t *left_excl_or_null,
+            const btree_key_t *right_incl,
+            bool *skip_out) {
+        auto it = left_excl_or_null == nullptr
+            ? keys->begin()
+            : keys->upper_bound(store_key_t(left_excl_or_null));
+        *skip_out = it == keys->end()
+            || btree_key_cmp(it->first.btree_key(), right_incl) > 0;
+    }
+    virtual continue_bool_t handle_pair(
+        scoped_key_value_t &&keyvalue,
+        concurrent_traversal_fifo_enforcer_signal_t waiter)
+        THROWS_ONLY(interrupted_exc_t) {
+        /* The leaves we visit hold other keys besides the ones we're looking for. */
+        auto it = keys->find(store_key_t(keyvalue.key()));
+        if (it == keys->end()) {
+            return continue_bool_t::CONTINUE;
+        }
+        ++pairs_seen_;
+        return cb->handle_pair(
+            std::move(keyvalue),
+            it->second,
+            r_nullopt,
+            std::move(waiter));
+    }
+    // How many of the keys the traversal found.
+    size_t pairs_seen() const { return pairs_seen_; }
+private:
+    rget_cb_t *cb;
+    const std::map<store_key_t, uint64_t> *keys;
+    size_t pairs_seen_;
+};
+
 rget_cb_t::rget_cb_t(rget_io_data_t &&_io,
                      job_data_t &&_job,
                      optional<rget_sindex_data_t> &&_sindex)
     : io(std::move(_io)),
       job(std::move(_job)),
       sindex(std::move(_sindex)),
-      bad_init(false) {
+      bad_init(false),
+      job_uses_rows(true),
+      job_uses_sindex_vals(false) {
+    if (job.transformers.empty()) {
+        job_uses_rows = job.accumulator->uses_val();
+    } else if (sindex && job.transformers[0]->replaces_row_with_sindex_val()) {
+        job_uses_rows = false;
+        job_uses_sindex_vals = true;
+    }
 
     if (sindex) {
         // Secondary index functions are deterministic (so no need for an
@@ -761,6 +955,40 @@ void rget_cb_t::finish(continue_bool_t last_cb) THROWS_ONLY(interrupted_exc_t) {
     job.accumulator->finish(last_cb, &io.response->result);
 }
 
+// Whether we have to load the row of the secondary index entry `key` even though the
+// job doesn't look at it: to check whether an entry on the boundary of the range, or
+// with a truncated secondary key, is actually in the range, or to compute an index
+// value we haven't seen yet.  This runs before `handle_pair` can block, so it sees the
+// entries in key order.
+bool rget_cb_t::sindex_needs_row(const store_key_t &key,
+                                 const optional<std::string> &skey_left) {
+    const size_t max_trunc_size = ql::datum_t::max_trunc_size();
+    const std::string skey_current =
+        ql::datum_t::extract_secondary(key_to_unescaped_str(key));
+    bool might_check_copies = skey_current.size() >= max_trunc_size
+        || sindex->datumspec.visit<bool>(
+            [&](const ql::datum_range_t &) {
+                return skey_current == sindex->lbound_trunc_key
+                    || skey_current == sindex->rbound_trunc_key;
+            },
+            [&](const std::map<ql::datum_t, uint64_t> &) {
+                guarantee(skey_left);
+                return sindex->hashed || skey_left->size() >= max_trunc_size;
+            });
+    if (might_check_copies) {
+        last_loaded_secondary.reset();
+        return true;
+    }
+    if (!job_uses_sindex_vals) {
+        return false;
+    }
+    if (last_loaded_secondary && *last_loaded_secondary == skey_current) {
+        return false;
+    }
+    last_loaded_secondary.set(skey_current);
+    return true;
+}
+
 // Handle a keyvalue pair.  Returns whether or not we're done early.
 continue_bool_t rget_cb_t::handle_pair(
     scoped_key_value_t &&keyvalue,
@@ -781,14 +1009,21 @@ continue_bool_t rget_cb_t::handle_pair(
     if (sindex && !sindex->pkey_range.contains_key(ql::datum_t::extract_primary(key))) {
         return continue_bool_t::CONTINUE;
     }
+    // When reading a secondary index, `keyvalue` is the index entry itself, which
+    // stores a copy of the row's primary btree value (the row inline, or a reference
+    // to the same blob).  So index reads never go back to the primary btree.
     lazy_btree_val_t row(static_cast<const rdb_value_t *>(keyvalue.value()),
                          keyvalue.expose_buf());
     ql::datum_t val;
     // Count stats whether or not we deserialize the value
     io.slice->stats.pm_keys_read.record();
     io.slice->stats.pm_total_keys_read += 1;
-    // We only load the value if we actually use it (`count` does not).
-    if (job.accumulator->uses_val() || job.transformers.size() != 0 || sindex) {
+    if (resource_usage_t *usage = current_resource_usage()) {
+        ++usage->rows_scanned;
+    }
+    // We only load the value if we actually use it (`count` does not, and neither
+    // does `distinct` on an index once it has seen the index value).
+    if (job_uses_rows || (sindex && sindex_needs_row(key, skey_left))) {
         val = row.get();
     } else {
         row.reset();
@@ -853,6 +1088,15 @@ continue_bool_t rget_cb_t::handle_pair(
         ql::datum_t sindex_val_cache; // an empty `datum_t` until initialized
         auto lazy_sindex_val = [&]() -> ql::datum_t {
             if (sindex && !sindex_val_cache.has()) {
+                std::string skey_current =
+                    ql::datum_t::extract_secondary(key_to_unescaped_str(key));
+                if (!val.has()) {
+                    // `sindex_needs_row` skipped the row because an earlier entry
+                    // had the same index value.
+                    guarantee(skey_current == last_sindex_val_secondary);
+                    sindex_val_cache = last_sindex_val;
+                    return sindex_val_cache;
+                }
                 sindex_val_cache =
                     sindex->func->call(sindex_env.get(), val)->as_datum();
                 if (sindex->multi == sindex_multi_bool_t::MULTI
@@ -861,6 +1105,10 @@ continue_bool_t rget_cb_t::handle_pair(
                     sindex_val_cache = sindex_val_cache.get(tag, ql::NOTHROW);
                     guarantee(sindex_val_cache.has());
                 }
+                if (job_uses_sindex_vals) {
+                    last_sindex_val_secondary = std::move(skey_current);
+                    last_sindex_val = sindex_val_cache;
+                }
             }
             return sindex_val_cache;
         };
@@ -962,7 +1210,9 @@ continue_bool_t rget_cb_t::handle_pair(
                     skey_current.size() >= max_trunc_size;
                 const bool skey_left_is_truncated = skey_left->size() >= max_trunc_size;
 
-                if (skey_current_is_truncated || skey_left_is_truncated) {
+                if (sindex->hashed
+                    || skey_current_is_truncated
+                    || skey_left_is_truncated) {
                     copies = sindex->datumspec.copies(lazy_sindex_val());
                 } else if (*skey_left != skey_current) {
                     copies = 0;
@@ -1040,31 +1290,29 @@ void rdb_rget_slice(
     direction_t direction = reversed(sorting) ? BACKWARD : FORWARD;
     continue_bool_t cont = continue_bool_t::CONTINUE;
     if (primary_keys.has_value()) {
-        auto cb = [&](const std::pair<store_key_t, uint64_t> &pair, bool is_last) {
-            rget_cb_wrapper_t wrapper(&callback, pair.second, r_nullopt);
-            return btree_concurrent_traversal(
+        std::map<store_key_t, uint64_t> keys;
+        for (const auto &pair : *primary_keys) {
+            if (slice->may_contain_key(pair.first.btree_key())) {
+                keys.insert(pair);
+            }
+        }
+        if (keys.empty()) {
+            if (release_superblock == release_superblock_t::RELEASE) {
+                superblock->release();
+            }
+        } else {
+            rget_keys_cb_wrapper_t wrapper(&callback, &keys);
+            // If required the superblock will get released further up the stack.
+            cont = btree_concurrent_traversal(
                 superblock,
-                key_range_t::one_key(pair.first),
+                key_range_t(key_range_t::closed, keys.begin()->first,
+                            key_range_t::closed, keys.rbegin()->first),
                 &wrapper,
                 direction,
-                is_last ? release_superblock : release_superblock_t::KEEP);
-        };
-        if (!reversed(sorting)) {
-            for (auto it = primary_keys->begin(); it != primary_keys->end();) {
-                auto this_it = it++;
-                if (cb(*this_it, it == primary_keys->end()) == continue_bool_t::ABORT) {
-                    // If required the superblock will get released further up the stack.
-                    cont = continue_bool_t::ABORT;
-                    break;
-                }
-            }
-        } else {
-            for (auto it = primary_keys->rbegin(); it != primary_keys->rend();) {
-                auto this_it = it++;
-                if (cb(*this_it, it == primary_keys->rend()) == continue_bool_t::ABORT) {
-                    // If required the superblock will get released further up the stack.
-                    cont = continue_bool_t::ABORT;
-                    break;
+                release_superblock);
+            if (cont == continue_bool_t::CONTINUE) {
+                for (size_t i = wrapper.pairs_seen(); i < keys.size(); ++i) {
+                    slice->note_key_missing();
                 }
             }
         }
@@ -1093,7 +1341,8 @@ void rdb_rget_secondary_slice(
         rget_read_response_t *response,
         release_superblock_t release_superblock) {
     r_sanity_check(boost::get<ql::exc_t>(&response->result) == nullptr);
-    guarantee(sindex_info.geo == sindex_geo_bool_t::REGULAR);
+    guarantee(sindex_info.kind != sindex_kind_t::GEO);
+    const bool hashed = sindex_info.kind == sindex_kind_t::HASH;
     PROFILE_STARTER_IF_ENABLED(
         ql_env->profile() == profile_bool_t::PROFILE,
         "Do range scan on secondary index.",
@@ -1121,15 +1370,15 @@ void rdb_rget_secondary_slice(
             &active_region_range,
             sindex_func_reql_version,
             sindex_info.mapping,
-            sindex_info.multi)));
+            sindex_info.multi,
+            hashed)));
 
     direction_t direction = reversed(sorting) ? BACKWARD : FORWARD;
-    auto cb = [&](const std::pair<ql::datum_range_t, uint64_t> &pair, bool is_last) {
-        key_range_t sindex_keyrange =
-            pair.first.to_sindex_keyrange(sindex_func_reql_version);
+    auto traverse = [&](const key_range_t &sindex_keyrange, uint64_t copies,
+                        bool is_last) {
         rget_cb_wrapper_t wrapper(
             &callback,
-            pair.second,
+            copies,
             make_optional(key_to_unescaped_str(sindex_keyrange.left)));
         key_range_t active_range = active_region_range.intersection(sindex_keyrange);
         // This can happen sometimes with truncated keys.
@@ -1141,7 +1390,51 @@ void rdb_rget_secondary_slice(
             direction,
             is_last ? release_superblock : release_superblock_t::KEEP);
     };
-    continue_bool_t cont = datumspec.iter(sorting, cb);
+    continue_bool_t cont = continue_bool_t::CONTINUE;
+    if (!hashed) {
+        cont = datumspec.iter(
+            sorting,
+            [&](const std::pair<ql::datum_range_t, uint64_t> &pair, bool is_last) {
+                return traverse(
+                    pair.first.to_sindex_keyrange(sindex_func_reql_version),
+                    pair.second,
+                    is_last);
+            });
+    } else {
+        // The keys of a hash index aren't ordered like the values they were computed
+        // from, so we visit the values in key order instead.  Otherwise a read that
+        // continues from the last key of the previous batch would skip values.  Values
+        // whose hashes collide share a key range, which we only traverse once; the
+        // callback checks every row against the whole datumspec anyway.
+        r_sanity_check(sorting == sorting_t::UNORDERED);
+        std::vector<std::pair<key_range_t, uint64_t> > keyranges;
+        datumspec.iter(
+            sorting,
+            [&](const std::pair<ql::datum_range_t, uint64_t> &pair, bool) {
+                keyranges.push_back(std::make_pair(
+                    pair.first.to_hashed_sindex_keyrange(sindex_func_reql_version),
+                    pair.second));
+                return continue_bool_t::CONTINUE;
+            });
+        std::sort(keyranges.begin(), keyranges.end(),
+                  [](const std::pair<key_range_t, uint64_t> &a,
+                     const std::pair<key_range_t, uint64_t> &b) {
+                      return a.first.left < b.first.left;
+                  });
+        keyranges.erase(
+            std::unique(keyranges.begin(), keyranges.end(),
+                        [](const std::pair<key_range_t, uint64_t> &a,
+                           const std::pair<key_range_t, uint64_t> &b) {
+                            return a.first.left == b.first.left;
+                        }),
+            keyranges.end());
+        for (size_t i = 0; i < keyranges.size(); ++i) {
+            cont = traverse(keyranges[i].first,
+                            keyranges[i].second,
+                            i + 1 == keyranges.size());
+            if (cont == continue_bool_t::ABORT) break;
+        }
+    }
     callback.finish(cont);
 }
 
@@ -1161,7 +1454,7 @@ void rdb_get_intersecting_slice(
         rget_read_response_t *response) {
     guarantee(query_geometry.has());
 
-    guarantee(sindex_info.geo == sindex_geo_bool_t::GEO);
+    guarantee(sindex_info.kind == sindex_kind_t::GEO);
     PROFILE_STARTER_IF_ENABLED(
         ql_env->profile() == profile_bool_t::PROFILE,
         "Do intersection scan on geospatial index.",
@@ -1202,7 +1495,7 @@ void rdb_get_nearest_slice(
     const sindex_disk_info_t &sindex_info,
     nearest_geo_read_response_t *response) {
 
-    guarantee(sindex_info.geo == sindex_geo_bool_t::GEO);
+    guarantee(sindex_info.kind == sindex_kind_t::GEO);
     PROFILE_STARTER_IF_ENABLED(
         ql_env->profile() == profile_bool_t::PROFILE,
         "Do nearest traversal on geospatial index.",
@@ -1274,6 +1567,30 @@ void rdb_distribution_get(int max_depth,
     }
 }
 
+class rdb_sample_callback_t : public btree_sample_callback_t {
+public:
+    explicit rdb_sample_callback_t(std::vector<ql::datum_t> *_rows) : rows(_rows) { }
+    void on_sample(const btree_key_t *, const void *value, buf_parent_t leaf) {
+        rows->push_back(get_data(static_cast<const rdb_value_t *>(value), leaf));
+    }
+private:
+    std::vector<ql::datum_t> *rows;
+};
+
+void rdb_sample(const key_range_t &range,
+                uint64_t num,
+                real_superblock_t *superblock,
+                sample_read_response_t *response) {
+    rdb_sample_callback_t cb(&response->rows);
+    response->population = sample_btree(superblock, range, num, &cb);
+    superblock->release();
+    if (resource_usage_t *usage = current_resource_usage()) {
+        usage->rows_scanned += response->rows.size();
+    }
+    // A full scan finds the rows in key order.
+    std::random_shuffle(response->rows.begin(), response->rows.end());
+}
+
 static const int8_t HAS_VALUE = 0;
 static const int8_t HAS_NO_VALUE = 1;
 
@@ -1378,6 +1695,28 @@ void rdb_modification_report_cb_t::finish(
     }
 }
 
+bool rdb_modification_report_cb_t::batch_sindex_updates() {
+    guarantee(!sindex_batch_.has());
+    auto cservers = store_->access_changefeed_servers();
+    for (auto &&pair : *cservers.first) {
+        for (const auto &sindex : sindexes_) {
+            if (pair.second->has_limit(make_optional(sindex->name.name),
+                                       pair.second->get_keepalive())) {
+                return false;
+            }
+        }
+    }
+    sindex_batch_.init(new sindex_update_batch_t());
+    return true;
+}
+
+void rdb_modification_report_cb_t::apply_sindex_updates() {
+    if (sindex_batch_.has()) {
+        sindex_batch_->apply(sindex_block_->txn());
+        sindex_batch_.reset();
+    }
+}
+
 new_mutex_in_line_t rdb_modification_report_cb_t::get_in_line_for_sindex() {
     return store_->get_in_line_for_sindex_queue(sindex_block_);
 }
@@ -1440,7 +1779,8 @@ void rdb_modification_report_cb_t::on_mod_report(
                         new_cfeed_keys,
                         report.primary_key,
                         report.info.deleted.first,
-                        report.info.added.first}),
+                        report.info.added.first,
+                        0 /* set by `send_all` */}),
                 report.primary_key,
                 cfeed_stamp_spot,
                 cserver.second);
@@ -1465,7 +1805,8 @@ void rdb_modification_report_cb_t::on_mod_report_sub(
                         &deletion_context,
                         keys_available_cond,
                         cfeed_old_keys_out,
-                        cfeed_new_keys_out);
+                        cfeed_new_keys_out,
+                        sindex_batch_.get_or_null());
     guarantee(keys_available_cond->is_pulsed());
     done_cond->pulse();
 }
@@ -1512,6 +1853,16 @@ std::vector<std::string> expand_geo_key(
     }
 }
 
+static std::string print_sindex_key(const sindex_disk_info_t &index_info,
+                                    reql_version_t reql_version,
+                                    const ql::datum_t &skey,
+                                    const store_key_t &primary_key,
+                                    optional<uint64_t> tag_num) {
+    return index_info.kind == sindex_kind_t::HASH
+        ? skey.print_hashed_secondary(reql_version, primary_key, tag_num)
+        : skey.print_secondary(reql_version, primary_key, tag_num);
+}
+
 void compute_keys(const store_key_t &primary_key,
                   ql::datum_t doc,
                   const sindex_disk_info_t &index_info,
@@ -1532,12 +1883,16 @@ void compute_keys(const store_key_t &primary_key,
 
     ql::datum_t index =
         index_info.mapping.compile_wire_func()->call(&sindex_env, doc)->as_datum();
+    if (index_info.kind == sindex_kind_t::TEXT) {
+        // The postings of a text index are the entries of a multi index on the words.
+        index = ql::text_index_value_to_words(index);
+    }
 
     if (index_info.multi == sindex_multi_bool_t::MULTI
         && index.get_type() == ql::datum_t::R_ARRAY) {
         for (uint64_t i = 0; i < index.arr_size(); ++i) {
             const ql::datum_t &skey = index.get(i, ql::THROW);
-            if (index_info.geo == sindex_geo_bool_t::GEO) {
+            if (index_info.kind == sindex_kind_t::GEO) {
                 std::vector<std::string> geo_keys = expand_geo_key(reql_version,
                                                                    skey,
                                                                    primary_key,
@@ -1558,8 +1913,8 @@ void compute_keys(const store_key_t &primary_key,
             } else {
                 try {
                     std::string store_key =
-                        skey.print_secondary(reql_version, primary_key,
-                                             make_optional(i));
+                        print_sindex_key(index_info, reql_version, skey, primary_key,
+                                         make_optional(i));
                     keys_out->push_back(
                         std::make_pair(store_key_t(store_key), skey));
                     if (cfeed_keys_out != nullptr) {
@@ -1576,7 +1931,7 @@ void compute_keys(const store_key_t &primary_key,
             }
         }
     } else {
-        if (index_info.geo == sindex_geo_bool_t::GEO) {
+        if (index_info.kind == sindex_kind_t::GEO) {
             std::vector<std::string> geo_keys = expand_geo_key(reql_version,
                                                                index,
                                                                primary_key,
@@ -1596,7 +1951,8 @@ void compute_keys(const store_key_t &primary_key,
             }
         } else {
             std::string store_key =
-                index.print_secondary(reql_version, primary_key, r_nullopt);
+                print_sindex_key(index_info, reql_version, index, primary_key,
+                                 r_nullopt);
             keys_out->push_back(
                 std::make_pair(store_key_t(store_key), index));
             if (cfeed_keys_out != nullptr) {
@@ -1619,7 +1975,7 @@ void serialize_sindex_info(write_message_t *wm,
 
     serialize<cluster_version_t::LATEST_DISK>(wm, info.mapping);
     serialize<cluster_version_t::LATEST_DISK>(wm, info.multi);
-    serialize<cluster_version_t::LATEST_DISK>(wm, info.geo);
+    serialize<cluster_version_t::LATEST_DISK>(wm, info.kind);
 }
 
 void deserialize_sindex_info(
@@ -1660,7 +2016,8 @@ void deserialize_sindex_info(
     case cluster_version_t::v2_2:
     case cluster_version_t::v2_3:
     case cluster_version_t::v2_4:
-    case cluster_version_t::v2_5_is_latest:
+    case cluster_version_t::v2_5:
+    case cluster_version_t::v2_6_is_latest:
         success = deserialize_reql_version(
                 &read_stream,
                 &info_out->mapping_version_info.original_reql_version,
@@ -1689,7 +2046,7 @@ void deserialize_sindex_info(
     throw_if_bad_deserialization(success, "sindex description");
     switch (cluster_version) {
     case cluster_version_t::v1_14:
-        info_out->geo = sindex_geo_bool_t::REGULAR;
+        info_out->kind = sindex_kind_t::REGULAR;
         break;
     case cluster_version_t::v1_15: // fallthru
     case cluster_version_t::v1_16: // fallthru
@@ -1698,8 +2055,9 @@ void deserialize_sindex_info(
     case cluster_version_t::v2_2: // fallthru
     case cluster_version_t::v2_3: // fallthru
     case cluster_version_t::v2_4: // fallthru
-    case cluster_version_t::v2_5_is_latest:
-        success = deserialize_for_version(cluster_version, &read_stream, &info_out->geo);
+    case cluster_version_t::v2_5: // fallthru
+    case cluster_version_t::v2_6_is_latest:
+        success = deserialize_for_version(cluster_version, &read_stream, &info_out->kind);
         throw_if_bad_deserialization(success, "sindex description");
         break;
     default: unreachable();
@@ -1742,7 +2100,8 @@ void rdb_update_single_sindex(
         auto_drainer_t::lock_t,
         cond_t *keys_available_cond,
         std::vector<index_pair_t> *cfeed_old_keys_out,
-        std::vector<index_pair_t> *cfeed_new_keys_out)
+        std::vector<index_pair_t> *cfeed_new_keys_out,
+        sindex_update_batch_t *batch)
     THROWS_NOTHING {
     // Note if you get this error it's likely that you've passed in a default
     // constructed mod_report. Don't do that.  Mod reports should always be passed
@@ -1755,7 +2114,8 @@ void rdb_update_single_sindex(
 
     sindex_disk_info_t sindex_info;
     try {
-        deserialize_sindex_info_or_crash(sindex->sindex.opaque_definition, &sindex_info);
+        store->get_sindex_info(sindex->sindex.id, sindex->sindex.opaque_definition,
+                               &sindex_info);
     } catch (const archive_exc_t &e) {
         crash("%s", e.what());
     }
@@ -1792,6 +2152,13 @@ void rdb_update_single_sindex(
                         }
                     }, cserver.second);
             }
+            if (batch != nullptr) {
+                for (const auto &pair : keys) {
+                    batch->del(sindex, sindex->sindex.post_construction_complete(),
+                               pair.first);
+                }
+                keys.clear();
+            }
             for (auto it = keys.begin(); it != keys.end(); ++it) {
                 promise_t<superblock_t *> return_superblock_local;
                 {
@@ -1869,6 +2236,13 @@ void rdb_update_single_sindex(
                         }
                     }, cserver.second);
             }
+            if (batch != nullptr) {
+                for (const auto &pair : keys) {
+                    batch->set(sindex, sindex->sindex.post_construction_complete(),
+                               pair.first, modification->info.added.second);
+                }
+                keys.clear();
+            }
             for (auto it = keys.begin(); it != keys.end(); ++it) {
                 promise_t<superblock_t *> return_superblock_local;
                 {
@@ -1941,6 +2315,45 @@ void rdb_update_single_sindex(
     }
 }
 
+/* Inserts `entries`, which `post_construct_traversal_helper_t` has collected for a
+chunk of rows, into the secondary index in key order. */
+void rdb_set_sindex_entries(
+        sindex_superblock_t *superblock,
+        std::vector<std::pair<store_key_t, std::vector<char> > > *entries,
+        const deletion_context_t *deletion_context) {
+    std::sort(entries->begin(), entries->end(),
+              [](const std::pair<store_key_t, std::vector<char> > &a,
+                 const std::pair<store_key_t, std::vector<char> > &b) {
+                  return a.first < b.first;
+              });
+    for (const auto &entry : *entries) {
+        promise_t<superblock_t *> return_superblock_local;
+        {
+            keyvalue_location_t kv_location;
+            rdb_value_sizer_t sizer(superblock->cache()->max_block_size());
+            find_keyvalue_location_for_write(
+                &sizer,
+                superblock,
+                entry.first.btree_key(),
+                repli_timestamp_t::distant_past,
+                deletion_context->balancing_detacher(),
+                &kv_location,
+                nullptr,
+                &return_superblock_local);
+
+            ql::serialization_result_t res =
+                kv_location_set(&kv_location, entry.first, entry.second,
+                                repli_timestamp_t::distant_past,
+                                deletion_context);
+            // this particular context cannot fail AT THE MOMENT.
+            guarantee(!bad(res));
+            // The keyvalue location gets destroyed here.
+        }
+        superblock = static_cast<sindex_superblock_t *>(return_superblock_local.wait());
+    }
+    entries->clear();
+}
+
 void rdb_update_sindexes(
     store_t *store,
     const store_t::sindex_access_vector_t &sindexes,
@@ -1949,7 +2362,8 @@ void rdb_update_sindexes(
     const deletion_context_t *deletion_context,
     cond_t *keys_available_cond,
     index_vals_t *cfeed_old_keys_out,
-    index_vals_t *cfeed_new_keys_out) {
+    index_vals_t *cfeed_new_keys_out,
+    sindex_update_batch_t *batch) {
 
     rdb_noop_deletion_context_t noop_deletion_context;
     {
@@ -1992,7 +2406,8 @@ void rdb_update_sindexes(
                             : &(*cfeed_old_keys_out)[sindex->name.name],
                         cfeed_new_keys_out == nullptr
                             ? nullptr
-                            : &(*cfeed_new_keys_out)[sindex->name.name]));
+                            : &(*cfeed_new_keys_out)[sindex->name.name],
+                        batch));
             }
         }
         if (counter == 0 && keys_available_cond != nullptr) {
@@ -2001,13 +2416,95 @@ void rdb_update_sindexes(
     }
 
     /* All of the sindex have been updated now it's time to actually clear the
-     * deleted blob if it exists. */
-    if (modification->info.deleted.first.has()) {
-        deletion_context->post_deleter()->delete_value(buf_parent_t(txn),
-                modification->info.deleted.second.data());
+     * deleted blob if it exists.  It doesn't if the row's blob was rewritten in
+     * place, which leaves the same ref in the old and the new value. */
+    if (modification->info.deleted.first.has()
+        && modification->info.deleted.second != modification->info.added.second) {
+        if (batch != nullptr) {
+            // The batched index entries still reference it.
+            batch->delete_value(std::vector<char>(modification->info.deleted.second));
+        } else {
+            deletion_context->post_deleter()->delete_value(buf_parent_t(txn),
+                    modification->info.deleted.second.data());
+        }
     }
 }
 
+void sindex_update_batch_t::set(const store_t::sindex_access_t *sindex,
+                                bool post_constructed,
+                                const store_key_t &key,
+                                const std::vector<char> &value) {
+    changes[sindex].push_back(change_t{key, post_constructed, make_optional(value)});
+}
+
+void sindex_update_batch_t::del(const store_t::sindex_access_t *sindex,
+                                bool post_constructed,
+                                const store_key_t &key) {
+    changes[sindex].push_back(change_t{key, post_constructed, r_nullopt});
+}
+
+void sindex_update_batch_t::delete_value(std::vector<char> &&value) {
+    deleted_values.push_back(std::move(value));
+}
+
+void sindex_update_batch_t::apply(txn_t *txn) {
+    for (auto &&pair : changes) {
+        std::vector<change_t> *sindex_changes = &pair.second;
+        // Changes to the same key (e.g. a row whose index value didn't change, which
+        // gets deleted and set again) have to stay in order.
+        std::stable_sort(sindex_changes->begin(), sindex_changes->end(),
+                         [](const change_t &a, const change_t &b) {
+                             return a.key < b.key;
+                         });
+        sindex_superblock_t *superblock = pair.first->superblock.get();
+        for (const change_t &change : *sindex_changes) {
+            const deletion_context_t *deletion_context = change.post_constructed
+                ? static_cast<const deletion_context_t *>(&live_deletion_context)
+                : &noop_deletion_context;
+            promise_t<superblock_t *> return_superblock_local;
+            {
+                keyvalue_location_t kv_location;
+                rdb_value_sizer_t sizer(superblock->cache()->max_block_size());
+                find_keyvalue_location_for_write(
+                    &sizer,
+                    superblock,
+                    change.key.btree_key(),
+                    repli_timestamp_t::distant_past,
+                    deletion_context->balancing_detacher(),
+                    &kv_location,
+                    nullptr,
+                    &return_superblock_local);
+                if (change.value.has_value()) {
+                    ql::serialization_result_t res =
+                        kv_location_set(&kv_location, change.key, *change.value,
+                                        repli_timestamp_t::distant_past,
+                                        deletion_context);
+                    // this particular context cannot fail AT THE MOMENT.
+                    guarantee(!bad(res));
+                } else if (kv_location.value.has()) {
+                    kv_location_delete(
+                        &kv_location,
+                        change.key,
+                        repli_timestamp_t::distant_past,
+                        deletion_context,
+                        delete_mode_t::REGULAR_QUERY,
+                        nullptr);
+                }
+                // The keyvalue location gets destroyed here.
+            }
+            superblock =
+                static_cast<sindex_superblock_t *>(return_superblock_local.wait());
+        }
+    }
+    changes.clear();
+
+    for (const std::vector<char> &value : deleted_values) {
+        live_deletion_context.post_deleter()->delete_value(buf_parent_t(txn),
+                                                           value.data());
+    }
+    deleted_values.clear();
+}
+
 class post_construct_traversal_helper_t : public concurrent_traversal_callback_t {
 public:
     post_construct_traversal_helper_t(
@@ -2023,7 +2520,8 @@ public:
           check_should_abort_(check_should_abort),
           pairs_constructed_(0),
           stopped_before_completion_(false),
-          current_chunk_size_(0) {
+          current_chunk_size_(0),
+          next_compute_thread_(0) {
         // Start an initial write transaction for the first chunk.
         // (this acquisition should never block)
         new_mutex_acq_t wtxn_acq(&wtxn_lock_);
@@ -2050,37 +2548,59 @@ public:
         store_->btree->stats.pm_keys_read.record();
         store_->btree->stats.pm_total_keys_read += 1;
 
-        // Grab the key and value and construct a modification report for the key/value
-        // pair.
+        // Grab the key and value of the row.
         const store_key_t primary_key(keyvalue.key());
         const rdb_value_t *rdb_value =
             static_cast<const rdb_value_t *>(keyvalue.value());
-        rdb_modification_report_t mod_report(primary_key);
         const max_block_size_t block_size =
             keyvalue.expose_buf().cache()->max_block_size();
-        mod_report.info.added
-            = std::make_pair(
-                get_data(rdb_value, buf_parent_t(keyvalue.expose_buf())),
-                std::vector<char>(rdb_value->value_ref(),
-                    rdb_value->value_ref() + rdb_value->inline_size(block_size)));
+        const ql::datum_t doc =
+            get_data(rdb_value, buf_parent_t(keyvalue.expose_buf()));
+        const std::vector<char> value(
+            rdb_value->value_ref(),
+            rdb_value->value_ref() + rdb_value->inline_size(block_size));
+        keyvalue.reset();
+
+        // Evaluating the index functions is what makes post construction slow, and
+        // reading the primary btree only takes one core, so we spread it over the
+        // threads.  (Datums and compiled functions can be shared between threads.)
+        // The traversal calls us for several rows at once, so they get evaluated in
+        // parallel.
+        std::vector<std::vector<std::pair<store_key_t, ql::datum_t> > > row_keys(
+            sindex_infos_.size());
+        {
+            const threadnum_t compute_thread(
+                next_compute_thread_++ % get_num_threads());
+            on_thread_t thread_switcher(compute_thread);
+            size_t i = 0;
+            for (const auto &pair : sindex_infos_) {
+                try {
+                    compute_keys(primary_key, doc, pair.second, &row_keys[i], nullptr);
+                } catch (const ql::base_exc_t &) {
+                    // Like `rdb_update_single_sindex`, we just drop the row from the
+                    // index.
+                    row_keys[i].clear();
+                }
+                ++i;
+            }
+        }
 
-        // Store the value into the secondary indexes
+        // Collect the index entries.  They are inserted in key order when the chunk
+        // ends (see `flush_entries`), which touches far fewer btree leaves than
+        // inserting them in primary key order.
         {
-            // We need this mutex because we don't want `wtxn` to be destructed,
-            // but also because only one coroutine can be traversing the indexes
-            // through `rdb_update_sindexes` at a time (or else the btree will get
-            // corrupted!).
+            // We need this mutex because we don't want `wtxn` to be destructed.
             new_mutex_acq_t wtxn_acq(&wtxn_lock_, interruptor_);
             guarantee(wtxn_.has());
-            const rdb_post_construction_deletion_context_t deletion_context;
-            rdb_update_sindexes(store_,
-                                sindexes_,
-                                &mod_report,
-                                wtxn_.get(),
-                                &deletion_context,
-                                nullptr,
-                                nullptr,
-                                nullptr);
+            size_t i = 0;
+            for (const auto &pair : sindex_infos_) {
+                std::vector<std::pair<store_key_t, std::vector<char> > > *entries =
+                    &pending_entries_[pair.first];
+                for (auto &key : row_keys[i]) {
+                    entries->push_back(std::make_pair(std::move(key.first), value));
+                }
+                ++i;
+            }
         }
 
         // Account for the sindex writes in the stats
@@ -2102,6 +2622,7 @@ public:
             ++current_chunk_size_;
             if (current_chunk_size_ >= MAX_CHUNK_SIZE) {
                 current_chunk_size_ = 0;
+                flush_entries(&wtxn_acq);
                 sindexes_.clear();
                 wtxn_->commit();
                 wtxn_.reset();
@@ -2122,11 +2643,37 @@ public:
         return traversed_right_bound_;
     }
 
+    // Inserts the entries of the last chunk.  Has to be called once the traversal is
+    // done, unless it got interrupted (in which case `traversed_right_bound_` doesn't
+    // matter, since the range gets constructed again).
+    void finish() {
+        new_mutex_acq_t wtxn_acq(&wtxn_lock_, interruptor_);
+        flush_entries(&wtxn_acq);
+    }
+
     bool stopped_before_completion() const {
         return stopped_before_completion_;
     }
 
+    size_t get_read_ahead_budget() THROWS_NOTHING {
+        return TRAVERSAL_READ_AHEAD_BUDGET;
+    }
+
 private:
+    void flush_entries(new_mutex_acq_t *wtxn_acq) {
+        wtxn_acq->guarantee_is_holding(&wtxn_lock_);
+        const rdb_post_construction_deletion_context_t deletion_context;
+        for (auto &&access : sindexes_) {
+            auto it = pending_entries_.find(access->sindex.id);
+            if (it != pending_entries_.end()) {
+                rdb_set_sindex_entries(
+                    access->superblock.get(), &it->second, &deletion_context);
+            }
+        }
+        // Entries for indexes that have been deleted in the meantime are dropped.
+        pending_entries_.clear();
+    }
+
     // Number of key/value pairs we process before releasing the write transaction
     // and waiting for the secondary index data to be flushed to disk.
     // Also see the comment above `scoped_ptr_t<txn_t> wtxn;` below.
@@ -2171,6 +2718,15 @@ private:
         guarantee(sindexes_.empty());
         for (auto &&access : all_sindexes) {
             if (!access->sindex.being_deleted) {
+                if (sindex_infos_.count(access->sindex.id) == 0) {
+                    try {
+                        deserialize_sindex_info_or_crash(
+                            access->sindex.opaque_definition,
+                            &sindex_infos_[access->sindex.id]);
+                    } catch (const archive_exc_t &e) {
+                        crash("%s", e.what());
+                    }
+                }
                 sindexes_.emplace_back(std::move(access));
             }
         }
@@ -2210,6 +2766,12 @@ private:
     scoped_ptr_t<txn_t> wtxn_;
     store_t::sindex_access_vector_t sindexes_;
     int current_chunk_size_;
+    // The definitions of the indexes, so we can compute their keys without holding
+    // the mutex, and the index entries of the current chunk.
+    std::map<uuid_u, sindex_disk_info_t> sindex_infos_;
+    std::map<uuid_u, std::vector<std::pair<store_key_t, std::vector<char> > > >
+        pending_entries_;
+    int next_compute_thread_;
     // Controls access to `sindexes_` and `wtxn_`.
     new_mutex_t wtxn_lock_;
 };
@@ -2256,7 +2818,9 @@ void post_construct_secondary_index_range(
         interruptor);
 
     cache_account
-        = txn->cache()->create_cache_account(SINDEX_POST_CONSTRUCTION_CACHE_PRIORITY);
+        = txn->cache()->create_cache_account(SINDEX_POST_CONSTRUCTION_CACHE_PRIORITY,
+                                             cache_access_pattern_t::BYPASS,
+                                             io_class_t::sindex_post_construction);
     txn->set_account(&cache_account);
 
     continue_bool_t cont = btree_concurrent_traversal(
@@ -2269,6 +2833,7 @@ void post_construct_secondary_index_range(
         && (interruptor->is_pulsed() || on_index_deleted_interruptor.is_pulsed())) {
         throw interrupted_exc_t();
     }
+    traversal_cb.finish();
 
     // Update the left bound of the construction range
     if (!traversal_cb.stopped_before_completion()) {
@@ -10,6 +10,7 @@
 
 #include "btree/types.hpp"
 #include "concurrency/auto_drainer.hpp"
+#include "concurrency/cond_var.hpp"
 #include "rdb_protocol/datum.hpp"
 #include "rdb_protocol/func.hpp"
 #include "rdb_protocol/protocol.hpp"
@@ -56,6 +57,7 @@ private:
 struct rdb_modification_info_t;
 struct rdb_modification_report_t;
 class rdb_modification_report_cb_t;
+class sindex_update_batch_t;
 
 void rdb_get(
     const store_key_t &key,
@@ -91,18 +93,34 @@ struct btree_loc_info_t {
     const store_key_t *const key;
 };
 
+/* The environment that write hooks run in.  `apply_write_hook()` runs while the row's
+leaf is locked, so all the rows of a batch share one environment instead of setting up
+their own.  It's only created once a row needs it. */
+class write_hook_env_t {
+public:
+    write_hook_env_t() { }
+    ql::env_t *get();
+
+private:
+    cond_t non_interruptor;
+    scoped_ptr_t<ql::env_t> env;
+
+    DISABLE_COPYING(write_hook_env_t);
+};
+
 struct btree_batched_replacer_t {
     virtual ~btree_batched_replacer_t() { }
     virtual ql::datum_t replace(
-        const ql::datum_t &d, size_t index) const = 0;
+        const ql::datum_t &d, size_t index, write_hook_env_t *write_hook_env) const = 0;
     virtual return_changes_t should_return_changes() const = 0;
 
-    ql::datum_t apply_write_hook(
+    static ql::datum_t apply_write_hook(
         const datum_string_t &pkey,
         const ql::datum_t &d,
         const ql::datum_t &res_,
         const ql::datum_t &write_timestamp,
-        const counted_t<const ql::func_t> &write_hook) const;
+        const counted_t<const ql::func_t> &write_hook,
+        write_hook_env_t *write_hook_env);
 };
 struct btree_point_replacer_t {
     virtual ~btree_point_replacer_t() { }
@@ -131,6 +149,18 @@ void rdb_set(const store_key_t &key, ql::datum_t data,
              profile::trace_t *trace,
              promise_t<superblock_t *> *pass_back_superblock = nullptr);
 
+/* Like `rdb_set()` with `overwrite` set, but `serialized_data` is the value as it is
+stored on disk, which is what backfills send. The value is copied onto disk as is,
+without being decoded into a datum, so there's no modification report; only use this
+when nothing needs one. */
+void rdb_set_serialized(const store_key_t &key,
+                        const std::vector<char> &serialized_data,
+                        btree_slice_t *slice,
+                        repli_timestamp_t timestamp,
+                        superblock_t *superblock,
+                        const deletion_context_t *deletion_context,
+                        promise_t<superblock_t *> *pass_back_superblock = nullptr);
+
 void rdb_delete(const store_key_t &key, btree_slice_t *slice, repli_timestamp_t
                 timestamp, real_superblock_t *superblock,
                 const deletion_context_t *deletion_context,
@@ -203,6 +233,11 @@ void rdb_distribution_get(int max_depth,
                           real_superblock_t *superblock,
                           distribution_read_response_t *response);
 
+void rdb_sample(const key_range_t &range,
+                uint64_t num,
+                real_superblock_t *superblock,
+                sample_read_response_t *response);
+
 /* Secondary Indexes */
 
 struct rdb_modification_info_t {
@@ -262,13 +297,13 @@ struct sindex_disk_info_t {
     sindex_disk_info_t(const ql::map_wire_func_t &_mapping,
                        const sindex_reql_version_info_t &_mapping_version_info,
                        sindex_multi_bool_t _multi,
-                       sindex_geo_bool_t _geo) :
+                       sindex_kind_t _kind) :
         mapping(_mapping), mapping_version_info(_mapping_version_info),
-        multi(_multi), geo(_geo) { }
+        multi(_multi), kind(_kind) { }
     ql::map_wire_func_t mapping;
     sindex_reql_version_info_t mapping_version_info;
     sindex_multi_bool_t multi;
-    sindex_geo_bool_t geo;
+    sindex_kind_t kind;
 };
 
 void serialize_sindex_info(write_message_t *wm,
@@ -307,8 +342,16 @@ public:
                        new_mutex_in_line_t *sindex_spot,
                        rwlock_in_line_t *stamp_spot);
     bool has_pkey_cfeeds(const std::vector<store_key_t> &keys);
+    bool has_sindexes() const { return !sindexes_.empty(); }
     void finish(btree_slice_t *btree, real_superblock_t *superblock);
 
+    // After `batch_sindex_updates`, the secondary index changes of the following mod
+    // reports are collected and only applied by `apply_sindex_updates`.  Returns
+    // false (and doesn't batch) if there are limit changefeeds on any of the
+    // indexes, since those read the index after every change.
+    bool batch_sindex_updates();
+    void apply_sindex_updates();
+
 private:
     void on_mod_report_sub(
         const rdb_modification_report_t &mod_report,
@@ -325,6 +368,8 @@ private:
 
     /* Fields initialized by calls to on_mod_report */
     store_t::sindex_access_vector_t sindexes_;
+
+    scoped_ptr_t<sindex_update_batch_t> sindex_batch_;
 };
 
 void rdb_update_sindexes(
@@ -335,7 +380,8 @@ void rdb_update_sindexes(
     const deletion_context_t *deletion_context,
     cond_t *keys_available_cond,
     index_vals_t *old_keys_out,
-    index_vals_t *new_keys_out);
+    index_vals_t *new_keys_out,
+    sindex_update_batch_t *batch);
 
 void post_construct_secondary_index_range(
         store_t *store,
@@ -393,5 +439,45 @@ private:
 };
 typedef rdb_noop_deletion_context_t rdb_post_construction_deletion_context_t;
 
+/* `sindex_update_batch_t` collects the secondary index changes of a batch of live
+writes.  Applying them per index in key order once the batch is done shares the
+btree descents (and leaf acquisitions) between rows, where applying them as they
+come would walk every index once per row.  The blobs of the replaced rows are
+deleted after that, since the index entries still referenced them. */
+class sindex_update_batch_t {
+public:
+    sindex_update_batch_t() { }
+
+    // `post_constructed` says whether `sindex` is post-constructed, which decides
+    // the deletion context we use for it (see `rdb_update_sindexes`).
+    void set(const store_t::sindex_access_t *sindex,
+             bool post_constructed,
+             const store_key_t &key,
+             const std::vector<char> &value);
+    void del(const store_t::sindex_access_t *sindex,
+             bool post_constructed,
+             const store_key_t &key);
+    // The value of a row that was replaced, to delete once it's out of the indexes.
+    void delete_value(std::vector<char> &&value);
+
+    void apply(txn_t *txn);
+
+private:
+    struct change_t {
+        store_key_t key;
+        bool post_constructed;
+        // Empty for deletions.
+        optional<std::vector<char> > value;
+    };
+
+    rdb_live_deletion_context_t live_deletion_context;
+    rdb_noop_deletion_context_t noop_deletion_context;
+    // The changes of each index, in the order they were made.
+    std::map<const store_t::sindex_access_t *, std::vector<change_t> > changes;
+    std::vector<std::vector<char> > deleted_values;
+
+    DISABLE_COPYING(sindex_update_batch_t);
+};
+
 
 #endif /* RDB_PROTOCOL_BTREE_HPP_ */
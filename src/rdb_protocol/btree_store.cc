@@ -12,6 +12,7 @@
 #include "btree/secondary_operations.hpp"
 #include "buffer_cache/alt.hpp"
 #include "buffer_cache/cache_balancer.hpp"
+#include "buffer_cache/hot_block_manifest.hpp"
 #include "clustering/administration/issues/outdated_index.hpp"
 #include "concurrency/wait_any.hpp"
 #include "containers/archive/buffer_stream.hpp"
@@ -42,6 +43,9 @@
 //  block out writes anyway.
 const int64_t WRITE_SUPERBLOCK_ACQ_WAITERS_LIMIT = 2;
 
+// The most single-document writes that `store_t::write()` applies in one transaction.
+const size_t WRITE_GROUP_MAX_SIZE = 32;
+
 // Some of this implementation is in store.cc and some in btree_store.cc for no
 // particularly good reason.  Historically it turned out that way, and for now
 // there's not enough refactoring urgency to combine them into one.
@@ -95,7 +99,9 @@ store_t::store_t(const region_t &_region,
       perfmon_collection_membership(parent_perfmon_collection, &perfmon_collection, perfmon_name),
       ctx(_ctx),
       table_id(_table_id),
-      write_superblock_acq_semaphore(WRITE_SUPERBLOCK_ACQ_WAITERS_LIMIT)
+      building_key_filter(false),
+      write_superblock_acq_semaphore(WRITE_SUPERBLOCK_ACQ_WAITERS_LIMIT),
+      open_write_group(nullptr)
 {
     cache.init(new cache_t(serializer, balancer, &perfmon_collection, which_cpu_shard));
     general_cache_conn.init(new cache_conn_t(cache.get()));
@@ -182,6 +188,9 @@ store_t::store_t(const region_t &_region,
 store_t::~store_t() {
     assert_thread();
     drainer.drain();
+    if (!hot_block_manifest_path.empty()) {
+        write_hot_block_manifest(hot_block_manifest_path, cache->hot_block_ids());
+    }
 }
 
 void store_t::read(
@@ -201,8 +210,28 @@ void store_t::read(
     DEBUG_ONLY_CODE(metainfo->visit(
         superblock.get(), metainfo_checker.region, metainfo_checker.callback));
     protocol_read(_read, response, superblock.get(), interruptor);
+    maybe_build_key_filter();
 }
 
+struct store_t::grouped_write_t {
+    DEBUG_ONLY(const metainfo_checker_t *metainfo_checker;)
+    const region_map_t<binary_blob_t> *new_metainfo;
+    const write_t *write;
+    write_response_t *response;
+    state_timestamp_t timestamp;
+    signal_t *interruptor;
+    bool interrupted;
+    cond_t done;
+};
+
+struct store_t::write_group_t {
+    write_group_t(write_durability_t _durability, new_mutex_t *mutex) :
+        durability(_durability), mutex_in_line(mutex) { }
+    const write_durability_t durability;
+    std::vector<grouped_write_t *> writes;
+    new_mutex_in_line_t mutex_in_line;
+};
+
 void store_t::write(
         DEBUG_ONLY(const metainfo_checker_t& metainfo_checker, )
         const region_map_t<binary_blob_t>& new_metainfo,
@@ -216,28 +245,143 @@ void store_t::write(
         THROWS_ONLY(interrupted_exc_t) {
     assert_thread();
 
+    if (_write.expected_document_changes() != 1) {
+        scoped_ptr_t<txn_t> txn;
+        scoped_ptr_t<real_superblock_t> real_superblock;
+        // We assume one block per document, plus changes to the stats block and
+        // superblock.
+        const int expected_change_count = 2 + _write.expected_document_changes();
+        acquire_superblock_for_write(expected_change_count, durability, token,
+                                     &txn, &real_superblock, interruptor);
+        DEBUG_ONLY_CODE(metainfo->visit(
+            real_superblock.get(), metainfo_checker.region, metainfo_checker.callback));
+        metainfo->update(real_superblock.get(), new_metainfo);
+        try {
+            protocol_write(_write, response, timestamp, &real_superblock, interruptor);
+        } catch (const interrupted_exc_t &) {
+            // We hope that the operation itself is interruption-safe (i.e. always
+            // either completes all necessary changes that are part of the
+            // transaction, or doesn't perform any changes at all).
+            // Hence it should be save to commit here even when interrupted.
+            real_superblock.reset();
+            txn->commit();
+            throw;
+        }
+        real_superblock.reset();
+        txn->commit();
+        return;
+    }
+
+    grouped_write_t grouped_write;
+    DEBUG_ONLY_CODE(grouped_write.metainfo_checker = &metainfo_checker);
+    grouped_write.new_metainfo = &new_metainfo;
+    grouped_write.write = &_write;
+    grouped_write.response = response;
+    grouped_write.timestamp = timestamp;
+    grouped_write.interruptor = interruptor;
+    grouped_write.interrupted = false;
+
+    scoped_ptr_t<write_group_t> led_group;
+    {
+        object_buffer_t<fifo_enforcer_sink_t::exit_write_t>::destruction_sentinel_t
+            destroyer(&token->main_write_token);
+        wait_interruptible(token->main_write_token.get(), interruptor);
+        if (open_write_group != nullptr
+                && open_write_group->durability == durability
+                && open_write_group->writes.size() < WRITE_GROUP_MAX_SIZE) {
+            open_write_group->writes.push_back(&grouped_write);
+        } else {
+            /* We get in line for the mutex before we release our write token, so the
+            writes with later tokens can't overtake our group. */
+            led_group.init(new write_group_t(durability, &write_group_mutex));
+            led_group->writes.push_back(&grouped_write);
+            open_write_group = led_group.get();
+        }
+    }
+
+    if (led_group.has()) {
+        perform_write_group(led_group.get());
+    } else {
+        /* The group's leader performs our write even if we're interrupted, and it
+        needs `grouped_write` until it's done, so we can't stop waiting early. */
+        grouped_write.done.wait_lazily_unordered();
+    }
+    if (grouped_write.interrupted) {
+        throw interrupted_exc_t();
+    }
+}
+
+void store_t::perform_write_group(write_group_t *group) {
+    assert_thread();
+    /* Writes keep joining the group until it reaches the front of the mutex's line. */
+    group->mutex_in_line.acq_signal()->wait_lazily_unordered();
+    if (open_write_group == group) {
+        open_write_group = nullptr;
+    }
+
     scoped_ptr_t<txn_t> txn;
     scoped_ptr_t<real_superblock_t> real_superblock;
-    // We assume one block per document, plus changes to the stats block and superblock.
-    const int expected_change_count = 2 + _write.expected_document_changes();
-    acquire_superblock_for_write(expected_change_count, durability, token,
-                                 &txn, &real_superblock, interruptor);
+    // One block per document, plus changes to the stats block and superblock.
+    const int expected_change_count = 2 + group->writes.size();
+    /* The writes in the group are performed even if their callers are interrupted,
+    so the throttler mustn't stop us either. */
+    cond_t non_interruptor;
+    get_btree_superblock_and_txn_for_writing(
+        general_cache_conn.get(),
+        &write_superblock_acq_semaphore,
+        write_access_t::write,
+        expected_change_count,
+        group->durability,
+        &real_superblock,
+        &txn,
+        &non_interruptor);
+
+    {
+        /* Every write in the group gets its own acquisition of the superblock within
+        the transaction, and they're all queued on it in the group's order before any
+        of them starts.  `protocol_write()` releases the superblock as soon as it has
+        locked the root, so the next write can descend the tree while the previous
+        one is still working on its leaf.  Locks are coupled on the way down, so
+        writes to the same key still happen in order, but writes to different parts
+        of the key space don't wait for each other. */
+        auto_drainer_t drainer;
+        for (grouped_write_t *w : group->writes) {
+            if (!real_superblock.has()) {
+                get_btree_superblock(txn.get(), access_t::write, &real_superblock);
+            }
+            coro_t::spawn_sometime(std::bind(&store_t::perform_grouped_write,
+                                             this,
+                                             w,
+                                             real_superblock.release(),
+                                             auto_drainer_t::lock_t(&drainer)));
+        }
+        /* The next group or write can queue up on the superblock behind ours. */
+        group->mutex_in_line.reset();
+    }
+    txn->commit();
+    txn.reset();
+
+    for (grouped_write_t *w : group->writes) {
+        w->done.pulse();
+    }
+}
+
+void store_t::perform_grouped_write(grouped_write_t *w,
+                                    real_superblock_t *superblock,
+                                    auto_drainer_t::lock_t) {
+    scoped_ptr_t<real_superblock_t> real_superblock(superblock);
     DEBUG_ONLY_CODE(metainfo->visit(
-        real_superblock.get(), metainfo_checker.region, metainfo_checker.callback));
-    metainfo->update(real_superblock.get(), new_metainfo);
+        real_superblock.get(),
+        w->metainfo_checker->region,
+        w->metainfo_checker->callback));
+    metainfo->update(real_superblock.get(), *w->new_metainfo);
     try {
-        protocol_write(_write, response, timestamp, &real_superblock, interruptor);
+        protocol_write(
+            *w->write, w->response, w->timestamp, &real_superblock, w->interruptor);
     } catch (const interrupted_exc_t &) {
-        // We hope that the operation itself is interruption-safe (i.e. always
-        // either completes all necessary changes that are part of the
-        // transaction, or doesn't perform any changes at all).
-        // Hence it should be save to commit here even when interrupted.
-        real_superblock.reset();
-        txn->commit();
-        throw;
+        // As in `write()`, the write either made all of its changes or none.
+        w->interrupted = true;
     }
-    real_superblock.reset();
-    txn->commit();
 }
 
 void store_t::reset_data(
@@ -250,11 +394,13 @@ void store_t::reset_data(
     assert_thread();
     with_priority_t p(CORO_PRIORITY_RESET_DATA);
 
-    // Erase the data in small chunks
+    // Erase the data in small chunks.  Without secondary indexes to update, the rows
+    // are cheaper to erase, so the chunks can be bigger.
     always_true_key_tester_t key_tester;
-    const uint64_t max_erased_per_pass = 100;
+    bool need_mod_reports = true;
     for (continue_bool_t done_erasing = continue_bool_t::CONTINUE;
          done_erasing == continue_bool_t::CONTINUE;) {
+        const uint64_t max_erased_per_pass = need_mod_reports ? 100 : 1000;
         scoped_ptr_t<txn_t> txn;
         scoped_ptr_t<real_superblock_t> superblock;
 
@@ -272,6 +418,10 @@ void store_t::reset_data(
                                 superblock->get_sindex_block_id(),
                                 access_t::write);
 
+        std::map<sindex_name_t, secondary_index_t> secondary_indexes;
+        get_secondary_indexes(&sindex_block, &secondary_indexes);
+        need_mod_reports = !secondary_indexes.empty() || !sindex_queues.empty();
+
         /* Note we don't allow interruption during this step; it's too easy to end up in
         an inconsistent state. */
         cond_t non_interruptor;
@@ -286,7 +436,7 @@ void store_t::reset_data(
                                              &deletion_context,
                                              &non_interruptor,
                                              max_erased_per_pass,
-                                             &mod_reports,
+                                             need_mod_reports ? &mod_reports : nullptr,
                                              &deleted_range);
 
         region_t deleted_region(subregion.beg, subregion.end, deleted_range);
@@ -336,7 +486,7 @@ std::map<std::string, std::pair<sindex_config_t, sindex_status_t> > store_t::sin
         res->first.func = disk_info.mapping;
         res->first.func_version = disk_info.mapping_version_info.original_reql_version;
         res->first.multi = disk_info.multi;
-        res->first.geo = disk_info.geo;
+        res->first.kind = disk_info.kind;
 
         res->second.outdated =
             (disk_info.mapping_version_info.latest_compatible_reql_version !=
@@ -362,13 +512,13 @@ std::map<std::string, std::pair<sindex_config_t, sindex_status_t> > store_t::sin
 void store_t::sindex_create(
         const std::string &name,
         const sindex_config_t &config,
-        UNUSED signal_t *interruptor)
+        signal_t *interruptor)
         THROWS_ONLY(interrupted_exc_t) {
     scoped_ptr_t<real_superblock_t> superblock;
     scoped_ptr_t<txn_t> txn;
     get_btree_superblock_and_txn_for_writing(general_cache_conn.get(),
         &write_superblock_acq_semaphore, write_access_t::write, 1,
-        write_durability_t::HARD, &superblock, &txn);
+        write_durability_t::HARD, &superblock, &txn, interruptor);
     buf_lock_t sindex_block(superblock->expose_buf(),
                             superblock->get_sindex_block_id(),
                             access_t::write);
@@ -383,7 +533,7 @@ void store_t::sindex_create(
     version_info.original_reql_version = config.func_version;
     version_info.latest_compatible_reql_version = config.func_version;
     version_info.latest_checked_reql_version = reql_version_t::LATEST;
-    sindex_disk_info_t info(config.func, version_info, config.multi, config.geo);
+    sindex_disk_info_t info(config.func, version_info, config.multi, config.kind);
 
     write_message_t wm;
     serialize_sindex_info(&wm, info);
@@ -410,13 +560,13 @@ void store_t::sindex_create(
 
 void store_t::sindex_rename_multi(
         const std::map<std::string, std::string> &name_changes,
-        UNUSED signal_t *interruptor)
+        signal_t *interruptor)
         THROWS_ONLY(interrupted_exc_t) {
     scoped_ptr_t<real_superblock_t> superblock;
     scoped_ptr_t<txn_t> txn;
     get_btree_superblock_and_txn_for_writing(general_cache_conn.get(),
         &write_superblock_acq_semaphore, write_access_t::write, 1,
-        write_durability_t::HARD, &superblock, &txn);
+        write_durability_t::HARD, &superblock, &txn, interruptor);
     buf_lock_t sindex_block(superblock->expose_buf(),
                             superblock->get_sindex_block_id(),
                             access_t::write);
@@ -457,13 +607,13 @@ void store_t::sindex_rename_multi(
 
 void store_t::sindex_drop(
         const std::string &name,
-        UNUSED signal_t *interruptor)
+        signal_t *interruptor)
         THROWS_ONLY(interrupted_exc_t) {
     scoped_ptr_t<real_superblock_t> superblock;
     scoped_ptr_t<txn_t> txn;
     get_btree_superblock_and_txn_for_writing(general_cache_conn.get(),
         &write_superblock_acq_semaphore, write_access_t::write, 1,
-        write_durability_t::HARD, &superblock, &txn);
+        write_durability_t::HARD, &superblock, &txn, interruptor);
     buf_lock_t sindex_block(superblock->expose_buf(),
                             superblock->get_sindex_block_id(),
                             access_t::write);
@@ -492,6 +642,123 @@ void store_t::configure_flush_interval(flush_interval_t interval) {
     cache->configure_flush_interval(interval);
 }
 
+void store_t::configure_cache_reservation(const cache_reservation_t &reservation) {
+    cache->configure_reservation(reservation);
+}
+
+void store_t::maybe_build_key_filter() {
+    assert_thread();
+    if (btree->key_filter_wanted() && !building_key_filter) {
+        building_key_filter = true;
+        coro_t::spawn_sometime(std::bind(&store_t::build_key_filter,
+                                         this,
+                                         drainer.lock()));
+    }
+}
+
+void store_t::maintain_hot_block_manifest(const std::string &path, bool warm_up) {
+    assert_thread();
+    guarantee(hot_block_manifest_path.empty());
+    hot_block_manifest_path = path;
+    coro_t::spawn_sometime(std::bind(&store_t::hot_block_manifest_loop,
+                                     this,
+                                     warm_up,
+                                     drainer.lock()));
+}
+
+void store_t::hot_block_manifest_loop(bool warm_up,
+                                      auto_drainer_t::lock_t store_keepalive)
+        THROWS_NOTHING {
+    assert_thread();
+    try {
+        std::vector<block_id_t> block_ids;
+        if (warm_up && read_hot_block_manifest(hot_block_manifest_path, &block_ids)) {
+            cache->warm_up(std::move(block_ids), store_keepalive.get_drain_signal());
+        }
+        for (;;) {
+            nap(HOT_BLOCK_MANIFEST_INTERVAL_MS, store_keepalive.get_drain_signal());
+            write_hot_block_manifest(hot_block_manifest_path, cache->hot_block_ids());
+        }
+    } catch (const interrupted_exc_t &) {
+        // The destructor writes the manifest one last time.
+    }
+}
+
+class key_filter_traversal_cb_t : public depth_first_traversal_callback_t {
+public:
+    explicit key_filter_traversal_cb_t(key_filter_t *_filter) : filter(_filter) { }
+    continue_bool_t handle_pair(scoped_key_value_t &&keyvalue, signal_t *) {
+        filter->insert(keyvalue.key());
+        return continue_bool_t::CONTINUE;
+    }
+    size_t get_read_ahead_budget() THROWS_NOTHING {
+        return TRAVERSAL_READ_AHEAD_BUDGET;
+    }
+private:
+    key_filter_t *filter;
+};
+
+void store_t::build_key_filter(auto_drainer_t::lock_t store_keepalive) THROWS_NOTHING {
+    assert_thread();
+    signal_t *interruptor = store_keepalive.get_drain_signal();
+    try {
+        // Size the filter from the population in the stat block, leaving room for
+        // the table to double before the filter has to be rebuilt.
+        int64_t population = 0;
+        {
+            read_token_t token;
+            new_read_token(&token);
+            scoped_ptr_t<txn_t> txn;
+            scoped_ptr_t<real_superblock_t> superblock;
+            acquire_superblock_for_read(&token, &txn, &superblock, interruptor, false);
+            block_id_t stat_block_id = superblock->get_stat_block_id();
+            if (stat_block_id != NULL_BLOCK_ID) {
+                buf_lock_t stat_block(buf_parent_t(txn.get()), stat_block_id,
+                                      access_t::read);
+                buf_read_t stat_block_read(&stat_block);
+                population = static_cast<const btree_statblock_t *>(
+                    stat_block_read.get_data_read())->population;
+            }
+        }
+
+        // A filter that's full from the start would only be dropped again.
+        if (static_cast<uint64_t>(std::max<int64_t>(population, 0)) + 1024
+                > key_filter_t::max_keys()) {
+            btree->disable_key_filter();
+            building_key_filter = false;
+            return;
+        }
+
+        // Writes add their keys to the new filter from here on, so the traversal only
+        // has to cover the keys in its snapshot.
+        key_filter_t *filter =
+            btree->start_key_filter(2 * std::max<int64_t>(population, 0) + 1024);
+        try {
+            read_token_t token;
+            new_read_token(&token);
+            scoped_ptr_t<txn_t> txn;
+            scoped_ptr_t<real_superblock_t> superblock;
+            acquire_superblock_for_read(&token, &txn, &superblock, interruptor, true);
+            txn->set_account(btree->get_backfill_account());
+            key_filter_traversal_cb_t cb(filter);
+            btree_depth_first_traversal(superblock.get(),
+                                        key_range_t::universe(),
+                                        &cb,
+                                        access_t::read,
+                                        direction_t::FORWARD,
+                                        release_superblock_t::RELEASE,
+                                        interruptor);
+        } catch (const interrupted_exc_t &) {
+            btree->finish_key_filter(false);
+            throw;
+        }
+        btree->finish_key_filter(true);
+    } catch (const interrupted_exc_t &) {
+        // The store is shutting down.
+    }
+    building_key_filter = false;
+}
+
 new_mutex_in_line_t store_t::get_in_line_for_sindex_queue(buf_lock_t *sindex_block) {
     assert_thread();
     // The line for the sindex queue is there to guarantee that we push things to
@@ -573,6 +840,7 @@ void store_t::update_sindexes(
                                 &deletion_context,
                                 NULL,
                                 NULL,
+                                NULL,
                                 NULL);
         }
     }
@@ -917,12 +1185,28 @@ void store_t::drop_sindex(uuid_u sindex_id) THROWS_NOTHING {
     ::delete_secondary_index(&sindex_block, compute_sindex_deletion_name(sindex.id));
     size_t num_erased = secondary_index_slices.erase(sindex.id);
     guarantee(num_erased == 1);
+    sindex_info_cache.erase(sindex.id);
 
     sindex_superblock_lock.reset_buf_lock();
     sindex_block.reset_buf_lock();
     txn->commit();
 }
 
+void store_t::get_sindex_info(uuid_u sindex_id,
+                              const std::vector<char> &opaque_definition,
+                              sindex_disk_info_t *sindex_info_out) {
+    assert_thread();
+    cached_sindex_info_t *cached = &sindex_info_cache[sindex_id];
+    if (cached->info.get() == nullptr
+        || cached->opaque_definition != opaque_definition) {
+        auto info = std::make_shared<sindex_disk_info_t>();
+        deserialize_sindex_info_or_crash(opaque_definition, info.get());
+        cached->opaque_definition = opaque_definition;
+        cached->info = std::move(info);
+    }
+    *sindex_info_out = *cached->info;
+}
+
 bool secondary_indexes_are_equivalent(const std::vector<char> &left,
                                       const std::vector<char> &right) {
     sindex_disk_info_t sindex_info_left;
@@ -931,7 +1215,7 @@ bool secondary_indexes_are_equivalent(const std::vector<char> &left,
     deserialize_sindex_info_or_crash(right, &sindex_info_right);
 
     if (sindex_info_left.multi == sindex_info_right.multi &&
-        sindex_info_left.geo == sindex_info_right.geo &&
+        sindex_info_left.kind == sindex_info_right.kind &&
         sindex_info_left.mapping_version_info.original_reql_version ==
             sindex_info_right.mapping_version_info.original_reql_version) {
         // Need to determine if the mapping function is the same, re-serialize them
@@ -1269,6 +1553,9 @@ void store_t::acquire_superblock_for_write(
     object_buffer_t<fifo_enforcer_sink_t::exit_write_t>::destruction_sentinel_t destroyer(&token->main_write_token);
     wait_interruptible(token->main_write_token.get(), interruptor);
 
+    /* Let any write groups ahead of us go first. */
+    new_mutex_acq_t write_group_acq(&write_group_mutex, interruptor);
+
     get_btree_superblock_and_txn_for_writing(
             general_cache_conn.get(),
             &write_superblock_acq_semaphore,
@@ -1276,7 +1563,8 @@ void store_t::acquire_superblock_for_write(
             expected_change_count,
             durability,
             sb_out,
-            txn_out);
+            txn_out,
+            interruptor);
 }
 
 /* store_view_t interface */
@@ -1,14 +1,20 @@
 // Copyright 2010-2015 RethinkDB, all rights reserved.
 #include "rdb_protocol/changefeed.hpp"
 
+#include <algorithm>
 #include <queue>
 
+#include "arch/runtime/memory_usage.hpp"
+#include "arch/timing.hpp"
 #include "btree/reql_specific.hpp"
 #include "clustering/administration/auth/user_context.hpp"
 #include "clustering/administration/tables/name_resolver.hpp"
 #include "concurrency/cross_thread_signal.hpp"
 #include "concurrency/interruptor.hpp"
+#include "config/args.hpp"
 #include "containers/archive/boost_types.hpp"
+#include "containers/archive/stl_types.hpp"
+#include "containers/archive/vector_stream.hpp"
 #include "rdb_protocol/artificial_table/backend.hpp"
 #include "rdb_protocol/btree.hpp"
 #include "rdb_protocol/env.hpp"
@@ -86,6 +92,12 @@ struct change_val_t {
     optional<indexed_datum_t> old_val;
     optional<indexed_datum_t> new_val;
     DEBUG_ONLY(optional<std::string> sindex;);
+    // Where each server's change log was when this change was queued.  Only
+    // filled in for subs that `include_tokens`.  Changes replayed from the log
+    // have a position for every server, live changes only for the servers their
+    // feed has heard from.
+    std::map<uuid_u, uint64_t> log_positions;
+    bool replayed = false;
 
     MOVABLE_BUT_NOT_COPYABLE(change_val_t);
 };
@@ -310,14 +322,67 @@ optional<datum_t> apply_ops(
     }
 }
 
+class transform_uses_now_visitor_t : public boost::static_visitor<bool> {
+public:
+    bool operator()(const map_wire_func_t &f) const {
+        return uses_now(f.compile_wire_func());
+    }
+    bool operator()(const group_wire_func_t &f) const {
+        for (const auto &func : f.compile_funcs()) {
+            if (uses_now(func)) {
+                return true;
+            }
+        }
+        return false;
+    }
+    bool operator()(const filter_wire_func_t &f) const {
+        return uses_now(f.filter_func.compile_wire_func())
+            || (f.default_filter_val.has_value()
+                && uses_now(f.default_filter_val->compile_wire_func()));
+    }
+    bool operator()(const concatmap_wire_func_t &f) const {
+        return uses_now(f.compile_wire_func());
+    }
+    bool operator()(const distinct_wire_func_t &) const { return false; }
+    bool operator()(const zip_wire_func_t &) const { return false; }
+private:
+    static bool uses_now(const counted_t<const func_t> &f) {
+        return !f->is_deterministic().test(single_server_t::yes, constant_now_t::no);
+    }
+};
+
+// Two subs with the same key get the same results from `apply_ops`, so a change
+// only has to run their transforms once.  The time of the query only matters to
+// transforms that use `r.now()`.
+std::string transforms_key(const std::vector<transform_variant_t> &transforms,
+                           serializable_env_t s_env) {
+    bool uses_now = false;
+    for (const auto &transform : transforms) {
+        uses_now |= boost::apply_visitor(transform_uses_now_visitor_t(), transform);
+    }
+    if (!uses_now) {
+        s_env.deterministic_time = datum_t::null();
+    }
+    write_message_t wm;
+    serialize<cluster_version_t::CLUSTER>(&wm, transforms);
+    serialize<cluster_version_t::CLUSTER>(&wm, s_env);
+    vector_stream_t stream;
+    stream.reserve(wm.size());
+    int res = send_write_message(&stream, &wm);
+    guarantee(res == 0);
+    return std::string(stream.vector().begin(), stream.vector().end());
+}
+
 server_t::client_info_t::client_info_t()
-    : limit_clients(),
+    : flush_scheduled(false),
+      limit_clients(),
       limit_clients_lock(new rwlock_t()) { }
 
 server_t::server_t(mailbox_manager_t *_manager, store_t *_parent)
     : uuid(generate_uuid()),
       manager(_manager),
       parent(_parent),
+      next_log_position(0),
       stop_mailbox(manager,
                    std::bind(&server_t::stop_mailbox_cb, this, ph::_1, ph::_2)),
       limit_stop_mailbox(manager, std::bind(&server_t::limit_stop_mailbox_cb,
@@ -486,18 +551,8 @@ void server_t::add_client_cb(
     guarantee(erased == 1);
 }
 
-struct stamped_msg_t {
-    stamped_msg_t() { }
-    stamped_msg_t(uuid_u _server_uuid, uint64_t _stamp, msg_t _submsg)
-        : server_uuid(std::move(_server_uuid)),
-          stamp(_stamp),
-          submsg(std::move(_submsg)) { }
-    uuid_u server_uuid;
-    uint64_t stamp;
-    msg_t submsg;
-};
-
-RDB_MAKE_SERIALIZABLE_3(stamped_msg_t, server_uuid, stamp, submsg);
+RDB_IMPL_SERIALIZABLE_3(stamped_msg_t, server_uuid, stamp, submsg);
+INSTANTIATE_SERIALIZABLE_FOR_CLUSTER(stamped_msg_t);
 
 // This function takes a `lock_t` to make sure you have one.  (We can't just
 // always acquire a drainer lock before sending because we sometimes send a
@@ -515,7 +570,62 @@ void server_t::send_one_with_lock(
         ASSERT_NO_CORO_WAITING;
         stamp = client->second.stamp++;
     }
-    send(manager, client->first, stamped_msg_t(uuid, stamp, std::move(msg)));
+    // These messages are rare (stops and limit changes), so rather than waiting
+    // for the batch delay we send them right away along with anything pending.
+    client->second.pending.push_back(stamped_msg_t(uuid, stamp, std::move(msg)));
+    flush(client);
+}
+
+bool server_t::enqueue(
+        std::pair<const client_t::addr_t, client_info_t> *client,
+        stamped_msg_t msg,
+        const auto_drainer_t::lock_t &keepalive) {
+    keepalive.assert_is_holding(&drainer);
+    ASSERT_NO_CORO_WAITING;
+    client_info_t *info = &client->second;
+    info->pending.push_back(std::move(msg));
+    if (info->pending.size() >= CHANGEFEED_MAX_BATCH_SIZE) {
+        return true;
+    }
+    if (!info->flush_scheduled) {
+        info->flush_scheduled = true;
+        coro_t::spawn_sometime(
+            std::bind(&server_t::flush_cb, this, client->first, keepalive));
+    }
+    return false;
+}
+
+void server_t::flush(std::pair<const client_t::addr_t, client_info_t> *client) {
+    std::vector<stamped_msg_t> batch;
+    batch.swap(client->second.pending);
+    if (!batch.empty()) {
+        send(manager, client->first, batch);
+    }
+}
+
+void server_t::flush_cb(client_t::addr_t addr, auto_drainer_t::lock_t keepalive) {
+    keepalive.assert_is_holding(&drainer);
+    try {
+        nap(CHANGEFEED_BATCH_DELAY_MS, keepalive.get_drain_signal());
+    } catch (const interrupted_exc_t &) {
+        // We still send what's pending so clients see everything before the
+        // `stop_t` they'll get when we finish draining.
+    }
+    std::vector<stamped_msg_t> batch;
+    {
+        rwlock_acq_t acq(&clients_lock, access_t::read);
+        auto it = clients.find(addr);
+        if (it == clients.end()) {
+            return;
+        }
+        it->second.flush_scheduled = false;
+        batch.swap(it->second.pending);
+    }
+    // Clients put messages back in order by their stamps, so it doesn't matter if
+    // a later batch for this client overtakes this one.
+    if (!batch.empty()) {
+        send(manager, addr, batch);
+    }
 }
 
 void server_t::send_all(
@@ -527,8 +637,20 @@ void server_t::send_all(
     stamp_spot->guarantee_is_for_lock(&parent->cfeed_stamp_lock);
     stamp_spot->write_signal()->wait_lazily_unordered();
 
+    // Changes are logged in the same order they're stamped in, so a resumed feed
+    // can tell which logged changes came before its subscription.
+    msg_t logged_msg = msg;
+    if (auto *change = boost::get<msg_t::change_t>(&logged_msg.op)) {
+        change->log_position = next_log_position++;
+        change_log.push_back(*change);
+        if (change_log.size() > CHANGEFEED_LOG_SIZE) {
+            change_log.pop_front();
+        }
+    }
+
     rwlock_acq_t acq(&clients_lock, access_t::read);
-    std::map<client_t::addr_t, uint64_t> stamps;
+    // Batches that filled up and have to be sent now rather than after the delay.
+    std::vector<std::pair<client_t::addr_t, std::vector<stamped_msg_t> > > full;
     for (auto &&pair : clients) {
         // We don't need a write lock as long as we make sure the coroutine
         // doesn't block between reading and updating the stamp.
@@ -536,13 +658,17 @@ void server_t::send_all(
         if (std::any_of(pair.second.regions.begin(),
                         pair.second.regions.end(),
                         std::bind(&region_contains_key, ph::_1, std::cref(key)))) {
-            stamps[pair.first] = pair.second.stamp++;
+            uint64_t stamp = pair.second.stamp++;
+            if (enqueue(&pair, stamped_msg_t(uuid, stamp, logged_msg), keepalive)) {
+                full.push_back(std::make_pair(pair.first, std::vector<stamped_msg_t>()));
+                full.back().second.swap(pair.second.pending);
+            }
         }
     }
     acq.reset();
     stamp_spot->reset(); // Done stamping, no need to hold onto it while we send.
-    for (const auto &pair : stamps) {
-        send(manager, pair.first, stamped_msg_t(uuid, pair.second, msg));
+    for (const auto &pair : full) {
+        send(manager, pair.first, pair.second);
     }
 }
 
@@ -557,15 +683,32 @@ server_t::limit_addr_t server_t::get_limit_stop_addr() {
 optional<uint64_t> server_t::get_stamp(
         const client_t::addr_t &addr,
         const auto_drainer_t::lock_t &keepalive) {
+    uint64_t log_position;
+    optional<std::vector<msg_t::change_t> > log_changes;
+    return get_stamp(addr, r_nullopt, &log_position, &log_changes, keepalive);
+}
+
+optional<uint64_t> server_t::get_stamp(
+        const client_t::addr_t &addr,
+        const optional<uint64_t> &since,
+        uint64_t *log_position_out,
+        optional<std::vector<msg_t::change_t> > *log_changes_out,
+        const auto_drainer_t::lock_t &keepalive) {
     keepalive.assert_is_holding(&drainer);
     rwlock_acq_t stamp_acq(&parent->cfeed_stamp_lock, access_t::read);
     rwlock_acq_t client_acq(&clients_lock, access_t::read);
     auto it = clients.find(addr);
     if (it == clients.end()) {
         return r_nullopt;
-    } else {
-        return make_optional(it->second.stamp);
     }
+    *log_position_out = next_log_position;
+    log_changes_out->reset();
+    uint64_t log_start = next_log_position - change_log.size();
+    if (since && *since >= log_start && *since <= next_log_position) {
+        log_changes_out->set(std::vector<msg_t::change_t>(
+            change_log.begin() + (*since - log_start), change_log.end()));
+    }
+    return make_optional(it->second.stamp);
 }
 
 uuid_u server_t::get_uuid() {
@@ -872,6 +1015,8 @@ limit_manager_t::limit_manager_t(
       spec(std::move(_spec)),
       gt(std::move(_gt)),
       item_queue(gt),
+      overflow(gt),
+      overflow_exhausted(false),
       aborted(false) {
     guarantee(clients_lock->read_signal()->is_pulsed());
 
@@ -941,14 +1086,14 @@ public:
                   const keyspec_t::limit_t *_spec,
                   sorting_t _sorting,
                   optional<item_t> _start,
-                  const item_queue_t *_item_queue)
+                  size_t _n)
         : env(_env),
           ops(_ops),
           pk_range(_pk_range),
           spec(_spec),
           sorting(_sorting),
           start(std::move(_start)),
-          item_queue(_item_queue) { }
+          n(_n) { }
 
     std::vector<item_t> operator()(const primary_ref_t &ref) {
         rget_read_response_t resp;
@@ -971,7 +1116,6 @@ public:
         case sorting_t::UNORDERED: // fallthru
         default: unreachable();
         }
-        size_t n = spec->limit - item_queue->size();
         rdb_rget_slice(
             ref.btree,
             region_t(),
@@ -1026,7 +1170,6 @@ public:
                 [](const datum_range_t &) { return true; },
                 [](const std::map<datum_t, uint64_t> &) { return false; }));
         datum_range_t srange = spec->range.datumspec.covering_range();
-        size_t n = spec->limit - item_queue->size();
         if (start) {
             datum_t dstart = start->second.first;
             switch (sorting) {
@@ -1039,14 +1182,6 @@ public:
             case sorting_t::UNORDERED: // fallthru
             default: unreachable();
             }
-
-            // Because we're using closed bounds, we have to make sure to read enough.
-            for (const auto &pair : *item_queue) {
-                if (pair->second.first != dstart) {
-                    break;
-                }
-                n += 1;
-            }
         }
         reql_version_t reql_version =
             ref.sindex_info->mapping_version_info.latest_compatible_reql_version;
@@ -1103,16 +1238,37 @@ private:
     const keyspec_t::limit_t *spec;
     sorting_t sorting;
     optional<item_t> start;
-    const item_queue_t *item_queue;
+    size_t n;
 };
 
 std::vector<item_t> limit_manager_t::read_more(
     const boost::variant<primary_ref_t, sindex_ref_t> &ref,
-    const optional<item_t> &start) {
+    const optional<item_t> &start,
+    size_t n) {
     guarantee(item_queue.size() < spec.limit);
+    if (start && spec.range.sindex) {
+        // Secondary index reads use closed bounds, so we have to make sure to read
+        // enough to get past the items we already have with the same index value.
+        datum_t dstart = start->second.first;
+        bool done = false;
+        for (const item_queue_t *queue : {&overflow, &item_queue}) {
+            for (const auto &pair : *queue) {
+                if (pair->second.first != dstart) {
+                    done = true;
+                    break;
+                }
+                n += 1;
+            }
+            if (done) {
+                break;
+            }
+        }
+    }
     ref_visitor_t visitor(
-        env.get(), &ops, &region.inner, &spec, spec.range.sorting, start, &item_queue);
-    return boost::apply_visitor(visitor, ref);
+        env.get(), &ops, &region.inner, &spec, spec.range.sorting, start, n);
+    std::vector<item_t> ret = boost::apply_visitor(visitor, ref);
+    overflow_exhausted = ret.size() < n;
+    return ret;
 }
 
 void limit_manager_t::commit(
@@ -1126,12 +1282,17 @@ void limit_manager_t::commit(
     // Before we delete anything, we get the boundary between the active set and
     // the data that didn't make it into the set.  Anything <= that according to
     // our ordering could never be kicked out of the set because of a read from
-    // disk.
+    // disk.  Likewise everything up to `overflow_boundary` is in memory.
     optional<item_t> active_boundary;
     auto item_queue_it = item_queue.begin();
     if (item_queue_it != item_queue.end()) {
         active_boundary.set(**item_queue_it);
     }
+    optional<item_t> overflow_boundary = active_boundary;
+    auto overflow_it = overflow.begin();
+    if (overflow_it != overflow.end()) {
+        overflow_boundary.set(**overflow_it);
+    }
 
     item_queue_t real_added(gt);
     std::set<std::string> real_deleted;
@@ -1140,10 +1301,13 @@ void limit_manager_t::commit(
         if (data_deleted) {
             bool inserted = real_deleted.insert(id).second;
             guarantee(inserted);
+        } else {
+            // The client never saw anything in `overflow`, so there's nothing
+            // to tell it.
+            UNUSED bool overflow_deleted = overflow.del_id(id);
         }
     }
     deleted.clear();
-    bool added_on_disk = false;
     for (const auto &pair : added) {
         // We only add to the set if we know we beat anything that might be read
         // off of disk below.  This is fine because if the resulting set is
@@ -1156,29 +1320,62 @@ void limit_manager_t::commit(
             guarantee(inserted);
             inserted = real_added.insert(pair).second;
             guarantee(inserted);
-        } else {
-            added_on_disk = true;
+        } else if (overflow_exhausted
+                   || (overflow_boundary && !gt(item_t(pair), *overflow_boundary))) {
+            // It lands in the range that `overflow` holds all of.
+            bool inserted = overflow.insert(pair).second;
+            guarantee(inserted);
         }
     }
     added.clear();
 
-    std::vector<std::string> truncated = item_queue.truncate_top(spec.limit);
-    for (auto &&id : truncated) {
-        auto it = real_added.find_id(id);
-        if (it != real_added.end()) {
-            real_added.erase(it);
-        } else {
-            bool inserted = real_deleted.insert(std::move(id)).second;
+    // Items that fall out of the active set are the best ones outside of it, so
+    // they go to the front of `overflow`.
+    auto evict = [&]() {
+        while (item_queue.size() > spec.limit) {
+            auto it = item_queue.begin();
+            item_t item = **it;
+            item_queue.erase(it);
+            auto added_it = real_added.find_id(item.first);
+            if (added_it != real_added.end()) {
+                real_added.erase(added_it);
+            } else {
+                bool inserted = real_deleted.insert(item.first).second;
+                guarantee(inserted);
+            }
+            bool inserted = overflow.insert(std::move(item)).second;
             guarantee(inserted);
         }
-    }
+        if (overflow.size() > CHANGEFEED_LIMIT_OVERFLOW_SIZE) {
+            overflow.truncate_top(CHANGEFEED_LIMIT_OVERFLOW_SIZE);
+            overflow_exhausted = false;
+        }
+    };
+    auto refill = [&]() {
+        while (item_queue.size() < spec.limit && overflow.size() != 0) {
+            auto it = std::prev(overflow.end());
+            item_t item = **it;
+            overflow.erase(it);
+            bool inserted = item_queue.insert(item).second;
+            guarantee(inserted);
+            inserted = real_added.insert(std::move(item)).second;
+            guarantee(inserted);
+        }
+    };
+    evict();
+    refill();
 
-    bool anything_on_disk = real_deleted.size() != 0 || added_on_disk;
-    if (item_queue.size() < spec.limit && anything_on_disk) {
+    if (item_queue.size() < spec.limit && !overflow_exhausted) {
+        // We've used up `overflow`, so we read enough to fill the active set and
+        // then `overflow` again.
+        guarantee(overflow.size() == 0);
         std::vector<item_t> s;
         optional<exc_t> exc;
         try {
-            s = read_more(sindex_ref, active_boundary);
+            s = read_more(
+                sindex_ref,
+                overflow_boundary,
+                spec.limit - item_queue.size() + CHANGEFEED_LIMIT_OVERFLOW_SIZE);
         } catch (const exc_t &e) {
             exc.set(e);
         }
@@ -1196,18 +1393,8 @@ void limit_manager_t::commit(
                 guarantee(added_insert);
             }
         }
-        // We need to truncate again because `read_more` may read too much in
-        // the secondary index case.
-        std::vector<std::string> read_trunc = item_queue.truncate_top(spec.limit);
-        for (auto &&id : read_trunc) {
-            auto it = real_added.find_id(id);
-            if (it != real_added.end()) {
-                real_added.erase(it);
-            } else {
-                bool inserted = real_deleted.insert(std::move(id)).second;
-                guarantee(inserted);
-            }
-        }
+        // This moves everything past the first `spec.limit` into `overflow`.
+        evict();
     }
     std::set<std::string> remaining_deleted;
     for (auto &&id : real_deleted) {
@@ -1258,9 +1445,9 @@ RDB_IMPL_SERIALIZABLE_3(msg_t::limit_change_t, sub, old_key, new_val);
 INSTANTIATE_SERIALIZABLE_FOR_CLUSTER(msg_t::limit_change_t);
 RDB_IMPL_SERIALIZABLE_2(msg_t::limit_stop_t, sub, exc);
 INSTANTIATE_SERIALIZABLE_FOR_CLUSTER(msg_t::limit_stop_t);
-RDB_IMPL_SERIALIZABLE_5(
+RDB_IMPL_SERIALIZABLE_6(
     msg_t::change_t,
-    old_indexes, new_indexes, pkey, old_val, new_val);
+    old_indexes, new_indexes, pkey, old_val, new_val, log_position);
 INSTANTIATE_SERIALIZABLE_FOR_CLUSTER(msg_t::change_t);
 RDB_IMPL_SERIALIZABLE_0_SINCE_v1_13(msg_t::stop_t);
 
@@ -1380,6 +1567,10 @@ protected:
                    bool include_types);
     void maybe_signal_cond() THROWS_NOTHING;
     void maybe_signal_queue_nearly_full_cond() THROWS_NOTHING;
+    // Keep the `changefeed_queued_changes` and `changefeed_changes_dropped` stats
+    // up to date.  `note_dropped` also bumps `skipped`.
+    void note_queue_depth(size_t depth) THROWS_NOTHING;
+    void note_dropped(size_t n) THROWS_NOTHING;
     void destructor_cleanup(std::function<void()> del_sub) THROWS_NOTHING;
 
     datum_t maybe_add_type(datum_t &&datum, change_type_t type);
@@ -1411,6 +1602,8 @@ private:
     // Used to block on more changes.  NULL unless we're waiting.
     cond_t *cond;
     cond_t *queue_nearly_full_cond;
+    // How much of `changefeed_queued_changes` is ours.
+    size_t reported_queue_depth;
     DISABLE_COPYING(subscription_t);
 };
 
@@ -1539,13 +1732,17 @@ enum class init_squashing_queue_t { NO, YES };
 class flat_sub_t : public subscription_t {
 public:
     template<class... Args>
-    explicit flat_sub_t(init_squashing_queue_t init_squashing_queue, Args &&... args)
+    explicit flat_sub_t(init_squashing_queue_t init_squashing_queue,
+                        queue_overflow_t _queue_overflow,
+                        Args &&... args)
         : subscription_t(std::forward<Args>(args)...),
+          squashing_allowed(init_squashing_queue == init_squashing_queue_t::YES),
+          squashing(false),
+          queue_overflow(_queue_overflow),
           last_stamp(std::make_pair(nil_uuid(), std::numeric_limits<uint64_t>::max())) {
-        if (init_squashing_queue == init_squashing_queue_t::YES && squash) {
-            queue = make_scoped<squashing_queue_t>();
-        } else {
-            queue = make_scoped<nonsquashing_queue_t>();
+        queue = make_scoped<nonsquashing_queue_t>();
+        if (squashing_allowed && squash) {
+            start_squashing();
         }
     }
     virtual void add_el(
@@ -1555,44 +1752,91 @@ public:
         const optional<std::string> &DEBUG_ONLY(sindex),
         optional<indexed_datum_t> old_val,
         optional<indexed_datum_t> new_val) {
-        if (!active()) return;
-        auto stamp_pair = std::make_pair(shard_uuid, stamp);
-        if (stamp_pair == last_stamp || update_stamp(shard_uuid, stamp)) {
-            // If we get the same stamp multiple times in a row, we skip the
-            // update step and always pass it through.  (This supports cases
-            // like `.get_all(1, 1)`).
-            last_stamp = stamp_pair;
-            queue->add(change_val_t(
+        add_change_val(
+            change_val_t(
                 std::make_pair(shard_uuid, stamp),
                 pkey,
                 std::move(old_val),
                 std::move(new_val)
-                DEBUG_ONLY(, sindex)));
-            if (queue->size() > limits.changefeed_queue_size()) {
-                skipped += queue->size();
-                queue->clear();
-            } else if (queue->size() > limits.changefeed_queue_size() / 2) {
-                // We do this even if the queue is only half full because we
-                // expect it to take some time to process and we want to be
-                // super safe.  (This will only affect anything if your `squash`
-                // timer is super long, in which case a more aggressive upper
-                // limit would let us respect the `squash` timer more closely,
-                // but since the timer is a hint it's OK to be safe in this edge
-                // case.)
-                maybe_signal_queue_nearly_full_cond();
-            }
-            maybe_signal_cond();
-        }
+                DEBUG_ONLY(, sindex)),
+            false);
     }
     bool has_change_val() { return queue->size() != 0; }
-    change_val_t pop_change_val() { return queue->pop(); }
+    change_val_t pop_change_val() {
+        change_val_t ret = queue->pop();
+        note_queue_depth(queue->size());
+        return ret;
+    }
     const change_val_t &peek_change_val() { return queue->peek(); }
     bool active() { return !exc; }
 protected:
+    // Changes replayed from a server's change log come from before the stamp we
+    // subscribed at, so they skip the stamp check.
+    void add_change_val(change_val_t change_val, bool replayed) {
+        if (!active()) return;
+        if (!replayed) {
+            const std::pair<uuid_u, uint64_t> &stamp_pair = change_val.source_stamp;
+            if (stamp_pair != last_stamp
+                && !update_stamp(stamp_pair.first, stamp_pair.second)) {
+                return;
+            }
+            // If we get the same stamp multiple times in a row, we skip the
+            // update step and always pass it through.  (This supports cases
+            // like `.get_all(1, 1)`).
+            last_stamp = stamp_pair;
+        }
+        if (discard_unread(change_val)) return;
+        queue->add(std::move(change_val));
+        if (queue_overflow == queue_overflow_t::SQUASH
+            && squashing_allowed
+            && queue->size() > limits.changefeed_queue_size() / 2) {
+            start_squashing();
+        }
+        if (queue->size() > limits.changefeed_queue_size()) {
+            if (queue_overflow == queue_overflow_t::DROP_OLDEST) {
+                queue->pop();
+                note_dropped(1);
+            } else {
+                note_dropped(queue->size());
+                queue->clear();
+            }
+        } else if (queue->size() > limits.changefeed_queue_size() / 2) {
+            // We do this even if the queue is only half full because we
+            // expect it to take some time to process and we want to be
+            // super safe.  (This will only affect anything if your `squash`
+            // timer is super long, in which case a more aggressive upper
+            // limit would let us respect the `squash` timer more closely,
+            // but since the timer is a hint it's OK to be safe in this edge
+            // case.)
+            maybe_signal_queue_nearly_full_cond();
+        }
+        note_queue_depth(queue->size());
+        maybe_signal_cond();
+    }
+    // Moves everything to a queue that squashes changes to the same key.
+    void start_squashing() {
+        guarantee(squashing_allowed);
+        if (squashing) return;
+        scoped_ptr_t<maybe_squashing_queue_t> old_queue = std::move(queue);
+        queue = make_scoped<squashing_queue_t>();
+        while (old_queue->size() != 0) {
+            queue->add(old_queue->pop());
+        }
+        squashing = true;
+        note_queue_depth(queue->size());
+    }
     // The queue of changes we've accumulated since the last time we were read from.
     scoped_ptr_t<maybe_squashing_queue_t> queue;
+    // Range subs can't squash until they've purged the changes from before their
+    // start stamps, which needs the changes in order.
+    bool squashing_allowed;
 private:
+    bool squashing;
+    const queue_overflow_t queue_overflow;
     std::pair<uuid_u, uint64_t> last_stamp;
+    // Lets a sub drop a change without queueing it if it knows the change would
+    // be thrown away when popped.
+    virtual bool discard_unread(const change_val_t &) { return false; }
     virtual void apply_queued_changes() { } // Changes are never queued.
     virtual bool update_stamp(const uuid_u &uuid, uint64_t new_stamp) = 0;
 };
@@ -1619,10 +1863,18 @@ public:
     void add_limit_sub(limit_sub_t *sub, const uuid_u &uuid) THROWS_NOTHING;
     void del_limit_sub(limit_sub_t *sub, const uuid_u &uuid) THROWS_NOTHING;
 
-    void each_range_sub(const auto_drainer_t::lock_t &lock,
-                        const std::function<void(range_sub_t *)> &f) THROWS_NOTHING;
+    // Calls `f` on every range sub that might see `change`, skipping the ones whose
+    // filter or secondary index range rules out both the old and the new value.
+    void each_range_sub_for_change(
+        const auto_drainer_t::lock_t &lock,
+        const msg_t::change_t &change,
+        const std::function<void(range_sub_t *)> &f) THROWS_NOTHING;
     void update_stamps(uuid_u server_uuid, uint64_t stamp);
     std::map<uuid_u, uint64_t> get_stamps();
+    // Records that we've seen the changes in `server_uuid`'s change log up to
+    // `next_position`, and returns where we are in every server's log.
+    std::map<uuid_u, uint64_t> note_log_position(
+        const uuid_u &server_uuid, uint64_t next_position);
     void on_point_sub(
         const store_key_t &key,
         const auto_drainer_t::lock_t &lock,
@@ -1657,6 +1909,8 @@ private:
 
     void add_sub_with_lock(
         rwlock_t *rwlock, const std::function<void()> &f) THROWS_NOTHING;
+    // Removes `sub` from `sindex_range_subs` and returns how many subs it removed.
+    size_t del_sindex_range_sub(range_sub_t *sub, const datumspec_t *ds);
     void del_sub_with_lock(
         rwlock_t *rwlock, const std::function<size_t()> &f) THROWS_NOTHING;
 
@@ -1680,11 +1934,28 @@ private:
         rwlock_in_line_t *spot,
         const std::function<void(limit_sub_t *)> &f) THROWS_NOTHING;
 
-    std::map<store_key_t, std::vector<std::set<point_sub_t *> > > point_subs;
+    // Point subs aren't split up by thread like the others.  Most keys only have
+    // one or two subs, and a set per thread for every key adds up with many point
+    // feeds open.
+    std::map<store_key_t, std::vector<point_sub_t *> > point_subs;
     rwlock_t point_subs_lock;
     std::vector<std::set<empty_sub_t *> > empty_subs;
     rwlock_t empty_subs_lock;
+    // Range subs whose first transform is a `filter` on `field == constant` are kept
+    // in `filtered_range_subs` under the field and the constant instead, so a change
+    // only visits the ones it might match.  Both are protected by `range_subs_lock`.
     std::vector<std::set<range_sub_t *> > range_subs;
+    std::map<datum_string_t, std::map<datum_t, std::vector<std::set<range_sub_t *> > > >
+        filtered_range_subs;
+    // Other range subs on a secondary index are kept in `sindex_range_subs` by index
+    // name, under each value they `get_all` or else ordered by the range they cover,
+    // so a change only visits the ones whose range holds one of its index values.
+    // These are protected by `range_subs_lock` too.
+    struct sindex_subs_t {
+        std::map<datum_t, std::set<range_sub_t *> > by_value;
+        std::multimap<datum_range_t, range_sub_t *> by_range;
+    };
+    std::map<std::string, sindex_subs_t> sindex_range_subs;
     rwlock_t range_subs_lock;
     std::map<uuid_u, std::vector<std::set<limit_sub_t *> > > limit_subs;
     rwlock_t limit_subs_lock;
@@ -1700,6 +1971,10 @@ private:
     // every sub do a thread switch to read the value.
     one_per_thread_t<stamps_t> stamps;
 
+    // The position after the last change we've seen from each server's change
+    // log.  Only accessed on the home thread.
+    std::map<uuid_u, uint64_t> log_positions;
+
     namespace_id_t table_id;
     name_resolver_t const &name_resolver;
 };
@@ -1715,6 +1990,14 @@ void feed_t::update_stamps(uuid_u server_uuid, uint64_t stamp) {
          });
 }
 
+std::map<uuid_u, uint64_t> feed_t::note_log_position(
+        const uuid_u &server_uuid, uint64_t next_position) {
+    assert_thread();
+    uint64_t *position = &log_positions[server_uuid];
+    *position = std::max(*position, next_position);
+    return log_positions;
+}
+
 // We have to return by value here because we release the lock right away.
 std::map<uuid_u, uint64_t> feed_t::get_stamps() {
     stamps_t *rs = stamps.get();
@@ -1740,14 +2023,14 @@ private:
     virtual void maybe_remove_feed() { client->maybe_remove_feed(client_lock, table_id); }
     virtual void stop_limit_sub(limit_sub_t *sub);
 
-    void mailbox_cb(signal_t *interruptor, stamped_msg_t msg);
+    void mailbox_cb(signal_t *interruptor, std::vector<stamped_msg_t> msgs);
     void constructor_cb();
 
     auto_drainer_t::lock_t client_lock;
     client_t *client;
     namespace_id_t table_id;
     mailbox_manager_t *manager;
-    mailbox_t<stamped_msg_t> mailbox;
+    mailbox_t<std::vector<stamped_msg_t> > mailbox;
     std::vector<server_t::addr_t> stop_addrs;
     std::vector<scoped_ptr_t<disconnect_watcher_t> > disconnect_watchers;
 
@@ -1893,9 +2176,11 @@ public:
                 configured_limits_t _limits,
                 const datum_t &_squash,
                 bool _include_states,
-                bool _include_types)
+                bool _include_types,
+                queue_overflow_t _queue_overflow)
     // There will never be any changes, safe to start squashing right away.
     : flat_sub_t(init_squashing_queue_t::YES,
+                 _queue_overflow,
                  _rdb_context,
                  _user_context,
                  _feed,
@@ -1977,9 +2262,11 @@ public:
                 const datum_t &_squash,
                 bool _include_states,
                 bool _include_types,
+                queue_overflow_t _queue_overflow,
                 datum_t _pkey)
         // For point changefeeds we start squashing right away.
         : flat_sub_t(init_squashing_queue_t::YES,
+                     _queue_overflow,
                      _rdb_context,
                      _user_context,
                      _feed,
@@ -2165,11 +2452,15 @@ public:
                 const datum_t &_squash,
                 bool _include_states,
                 bool _include_types,
+                bool _include_tokens,
+                optional<std::map<uuid_u, uint64_t> > _since,
+                queue_overflow_t _queue_overflow,
                 env_t *outer_env,
                 keyspec_t::range_t _spec)
         // We don't turn on squashing until later for range subs.  (We need to
         // wait until we've purged and all the initial values are reconciled.)
         : flat_sub_t(init_squashing_queue_t::NO,
+                     _queue_overflow,
                      _rdb_context,
                      _user_context,
                      _feed,
@@ -2177,6 +2468,8 @@ public:
                      _squash,
                      _include_states,
                      _include_types),
+          include_tokens(_include_tokens),
+          since(std::move(_since)),
           spec(std::move(_spec)),
           state(state_t::READY),
           sent_state(state_t::NONE),
@@ -2185,10 +2478,23 @@ public:
         for (const auto &transform : spec.transforms) {
             ops.push_back(make_op(transform));
         }
+        if (has_ops()) {
+            ops_key_ = transforms_key(spec.transforms,
+                                      outer_env->get_serializable_env());
+        }
         store_keys = spec.datumspec.primary_key_map();
         if (!store_keys.has_value()) {
             store_key_range.set(spec.datumspec.covering_range().to_primary_keyrange());
         }
+        if (!spec.transforms.empty()) {
+            // A `filter` with a default might keep rows it fails on, like the ones
+            // missing the field.
+            const filter_wire_func_t *filter =
+                boost::get<filter_wire_func_t>(&spec.transforms[0]);
+            if (filter != nullptr && !filter->default_filter_val.has_value()) {
+                filter_eq = filter->filter_func.compile_wire_func()->filter_equality();
+            }
+        }
         _feed->add_range_sub(this);
     }
     feed_type_t cfeed_type() const final { return feed_type_t::stream; }
@@ -2196,6 +2502,17 @@ public:
         destructor_cleanup(std::bind(&feed_t::del_range_sub, feed, this));
     }
     optional<std::string> sindex() const { return spec.sindex; }
+    // What a sub on a secondary index can be filed under by `feed_t`, or null if
+    // the sub has to see every change.  (Geo subs can't be filed because a range
+    // doesn't say what intersects them.)
+    const datumspec_t *indexed_datumspec() const {
+        return spec.sindex && !spec.intersect_geometry ? &spec.datumspec : nullptr;
+    }
+    // The field and constant of a leading `filter` that only keeps rows with that
+    // value, if there is one.  Rows without it can't change what the sub sees.
+    const optional<std::pair<datum_string_t, datum_t> > &filter_equality() const {
+        return filter_eq;
+    }
     size_t copies(const datum_t &sindex_key) const {
         guarantee(spec.sindex);
         if (spec.intersect_geometry) {
@@ -2222,7 +2539,116 @@ public:
         }
     }
 
+    // Queues whatever `change` means for this sub.  `transformed` caches the
+    // results of `apply_ops` by `ops_key()`, and `log_positions` is where we are in
+    // each server's change log.  Changes replayed from the log skip the stamp check.
+    void add_change(const msg_t::change_t &change,
+                    const uuid_u &server_uuid,
+                    uint64_t stamp,
+                    const std::map<uuid_u, uint64_t> &log_positions,
+                    std::map<std::string, std::pair<datum_t, datum_t> > *transformed,
+                    bool replayed) {
+        datum_t null = datum_t::null();
+        datum_t new_val = null, old_val = null;
+        if (!active()) return;
+        bool trivial = false;
+        if (has_ops()) {
+            auto it = transformed->find(ops_key());
+            if (it != transformed->end()) {
+                new_val = it->second.first;
+                old_val = it->second.second;
+            } else {
+                if (change.new_val.has()) {
+                    if (optional<datum_t> d = apply_ops(change.new_val)) {
+                        new_val = *d;
+                    }
+                }
+                if (!active()) return;
+                if (change.old_val.has()) {
+                    if (optional<datum_t> d = apply_ops(change.old_val)) {
+                        old_val = *d;
+                    }
+                }
+                if (!active()) return;
+                transformed->insert(std::make_pair(ops_key(),
+                                                   std::make_pair(new_val, old_val)));
+            }
+            // Duplicate values are caught before being written to disk and
+            // don't generate a `mod_report`, but if we have transforms the
+            // values might have changed.
+            trivial = (new_val == old_val);
+        } else {
+            guarantee(change.old_val.has() || change.new_val.has());
+            if (change.new_val.has()) {
+                new_val = change.new_val;
+            }
+            if (change.old_val.has()) {
+                old_val = change.old_val;
+            }
+        }
+        ASSERT_NO_CORO_WAITING;
+        optional<std::string> sindex_name = sindex();
+        if (sindex_name) {
+            std::vector<indexed_datum_t> old_idxs, new_idxs;
+            auto old_it = change.old_indexes.find(*sindex_name);
+            if (old_it != change.old_indexes.end()) {
+                for (const auto &idx : old_it->second) {
+                    for (size_t i = 0; i < copies(idx.first); ++i) {
+                        old_idxs.push_back(
+                            indexed_datum_t(old_val, make_optional(idx.second)));
+                    }
+                }
+            }
+            auto new_it = change.new_indexes.find(*sindex_name);
+            if (new_it != change.new_indexes.end()) {
+                for (const auto &idx : new_it->second) {
+                    for (size_t i = 0; i < copies(idx.first); ++i) {
+                        new_idxs.push_back(
+                            indexed_datum_t(new_val, make_optional(idx.second)));
+                    }
+                }
+            }
+            while (old_idxs.size() > 0 && new_idxs.size() > 0) {
+                if (!trivial) {
+                    add_val(replayed, log_positions, server_uuid, stamp, change.pkey, sindex_name,
+                            make_optional(std::move(old_idxs.back())),
+                            make_optional(std::move(new_idxs.back())));
+                }
+                old_idxs.pop_back();
+                new_idxs.pop_back();
+            }
+            while (old_idxs.size() > 0) {
+                guarantee(new_idxs.size() == 0);
+                if (old_val != null) {
+                    add_val(replayed, log_positions, server_uuid, stamp, change.pkey, sindex_name,
+                            make_optional(std::move(old_idxs.back())),
+                            r_nullopt);
+                }
+                old_idxs.pop_back();
+            }
+            while (new_idxs.size() > 0) {
+                guarantee(old_idxs.size() == 0);
+                if (new_val != null) {
+                    add_val(replayed, log_positions, server_uuid, stamp, change.pkey, sindex_name,
+                            r_nullopt,
+                            make_optional(std::move(new_idxs.back())));
+                }
+                new_idxs.pop_back();
+            }
+        } else {
+            if (!trivial) {
+                for (size_t i = 0; i < copies(change.pkey); ++i) {
+                    add_val(replayed, log_positions, server_uuid, stamp, change.pkey, sindex_name,
+                            make_optional(indexed_datum_t(old_val, r_nullopt)),
+                            make_optional(indexed_datum_t(new_val, r_nullopt)));
+                }
+            }
+        }
+    }
+
     bool has_ops() { return ops.size() != 0; }
+    // Subs with the same `ops_key()` always get the same results from `apply_ops`.
+    const std::string &ops_key() const { return ops_key_; }
 
     optional<datum_t> apply_ops(datum_t val) {
         guarantee(active());
@@ -2272,10 +2698,14 @@ public:
                 vals_to_change(datum_t(), d, true),
                 change_type_t::INITIAL);
         }
-        return change_val_to_change(pop_change_val(),
-                                    false,
-                                    false,
-                                    include_types);
+        change_val_t change_val = pop_change_val();
+        datum_t change = change_val_to_change(change_val,
+                                              false,
+                                              false,
+                                              include_types);
+        return include_tokens
+            ? add_token(std::move(change), change_val)
+            : change;
     }
     bool has_el() final {
         return (include_states && state != sent_state)
@@ -2284,12 +2714,9 @@ public:
     }
 
     void maybe_enable_squashing() {
+        squashing_allowed = true;
         if (squash) {
-            scoped_ptr_t<maybe_squashing_queue_t> old_queue = std::move(queue);
-            queue = make_scoped<squashing_queue_t>();
-            while (old_queue->size() != 0) {
-                queue->add(old_queue->pop());
-            }
+            start_squashing();
         }
     }
 
@@ -2305,10 +2732,12 @@ public:
         r_sanity_check(self.get() == this);
 
         read_response_t read_resp;
+        changefeed_stamp_t stamp_read(addr);
+        stamp_read.since = since;
         // Note that we use the `outer_env`'s interruptor for the read.
         nif->read(
             outer_env->get_user_context(),
-            read_t(changefeed_stamp_t(addr),
+            read_t(stamp_read,
                    profile_bool_t::DONT_PROFILE,
                    read_mode_t::SINGLE),
             &read_resp, order_token_t::ignore, outer_env->interruptor);
@@ -2318,6 +2747,15 @@ public:
                      "Unable to retrieve the start stamps.  Did you just reshard?");
         std::map<uuid_u, uint64_t> purge_stamps;
         for (const auto &pair : *resp->stamp_infos) {
+            start_log_positions[pair.first] = pair.second.log_position;
+            // A server that restarted or forgot the changes after `since` has no
+            // way to tell us what we missed.
+            rcheck_datum(!since || pair.second.log_changes.has_value(),
+                         base_exc_t::OP_FAILED,
+                         "Unable to resume the changefeed because the change log no "
+                         "longer covers the token passed to `since`.  Reload the "
+                         "data and open a new changefeed.");
+
             const auto id_stamp_pair = std::make_pair(pair.first, pair.second.stamp);
             auto orig_res = orig_stamps.insert(id_stamp_pair);
             guarantee(orig_res.second);
@@ -2332,8 +2770,12 @@ public:
             }
         }
         queue->purge_below(purge_stamps);
+        note_queue_depth(queue->size());
         rcheck_datum(orig_stamps.size() != 0, base_exc_t::RESUMABLE_OP_FAILED,
                      "Empty start stamps.  Did you just reshard?");
+        if (since) {
+            replay_log(*resp->stamp_infos);
+        }
 
         if (maybe_src) {
             // Nothing can happen between constructing the new `scoped_ptr_t` and
@@ -2358,6 +2800,8 @@ public:
         backtrace_id_t bt) {
         assert_thread();
         r_sanity_check(self.get() == this);
+        rcheck_src(bt, !include_tokens && !since, base_exc_t::LOGIC,
+                   "Cannot resume changefeeds on system tables.");
 
         artificial_include_initial = include_initial;
 
@@ -2380,7 +2824,77 @@ public:
     }
     const std::map<uuid_u, uint64_t> &get_next_stamps() { return next_stamps; }
     const std::map<uuid_u, uint64_t> &get_orig_stamps() { return orig_stamps; }
+    // Set by a `splice_stream_t` while it's reading the initial values.
+    void set_unread_filter(std::function<bool(const change_val_t &)> f) {
+        unread_filter = std::move(f);
+    }
 private:
+    bool discard_unread(const change_val_t &change_val) final {
+        return unread_filter && unread_filter(change_val);
+    }
+
+    void add_val(bool replayed,
+                 const std::map<uuid_u, uint64_t> &log_positions,
+                 const uuid_u &server_uuid,
+                 uint64_t stamp,
+                 const store_key_t &pkey,
+                 const optional<std::string> &DEBUG_ONLY(sindex_name),
+                 optional<indexed_datum_t> old_val,
+                 optional<indexed_datum_t> new_val) {
+        change_val_t change_val(std::make_pair(server_uuid, stamp),
+                                pkey,
+                                std::move(old_val),
+                                std::move(new_val)
+                                DEBUG_ONLY(, sindex_name));
+        if (include_tokens) {
+            change_val.log_positions = log_positions;
+            change_val.replayed = replayed;
+        }
+        add_change_val(std::move(change_val), replayed);
+    }
+    // Queues the changes from before our stamps that the servers' change logs say
+    // we missed since `since`, ahead of anything we've already queued.  A change
+    // that was already seen before the token was saved may be delivered again.
+    void replay_log(const std::map<uuid_u, shard_stamp_info_t> &stamp_infos) {
+        std::vector<change_val_t> queued;
+        while (queue->size() != 0) {
+            queued.push_back(queue->pop());
+        }
+        std::map<uuid_u, uint64_t> log_positions = *since;
+        for (const auto &pair : stamp_infos) {
+            for (const auto &change : *pair.second.log_changes) {
+                log_positions[pair.first] = change.log_position + 1;
+                std::map<std::string, std::pair<datum_t, datum_t> > transformed;
+                add_change(change, pair.first, 0, log_positions, &transformed, true);
+            }
+        }
+        for (auto &&change_val : queued) {
+            queue->add(std::move(change_val));
+        }
+    }
+    // The token is where the feed is in each server's change log once this change
+    // has been seen, and can be passed back as `since` to resume from there.
+    datum_t add_token(datum_t &&change, const change_val_t &change_val) {
+        std::map<datum_string_t, datum_t> token;
+        for (const auto &pair : start_log_positions) {
+            uint64_t position = pair.second;
+            auto it = change_val.log_positions.find(pair.first);
+            if (it != change_val.log_positions.end()) {
+                position = change_val.replayed
+                    ? it->second
+                    : std::max(position, it->second);
+            }
+            token[datum_string_t(uuid_to_str(pair.first))] =
+                datum_t(static_cast<double>(position));
+        }
+        return change.merge(
+            datum_t{
+                std::map<datum_string_t, datum_t>{
+                    std::pair<datum_string_t, datum_t>{
+                        datum_string_t("token"),
+                            datum_t(std::move(token))}}});
+    }
+
     scoped_ptr_t<env_t> make_env(env_t *outer_env) {
         // This is to support fake environments from the unit tests that don't
         // actually have a context.
@@ -2398,17 +2912,26 @@ private:
 
     scoped_ptr_t<env_t> env;
     std::vector<scoped_ptr_t<op_t> > ops;
+    std::string ops_key_;
 
     // The stamp (see `stamped_msg_t`) associated with our `changefeed_stamp_t`
     // read.  We use these to make sure we don't see changes from writes before
     // our subscription.
     std::map<uuid_u, uint64_t> orig_stamps, next_stamps;
+    // Tokens are only added if `include_tokens`.  `since` is the token we're
+    // resuming from, and `start_log_positions` is where each server's change log
+    // was when we subscribed.
+    bool include_tokens;
+    optional<std::map<uuid_u, uint64_t> > since;
+    std::map<uuid_u, uint64_t> start_log_positions;
     keyspec_t::range_t spec;
     optional<std::map<store_key_t, uint64_t> > store_keys;
     optional<key_range_t> store_key_range;
+    optional<std::pair<datum_string_t, datum_t> > filter_eq;
     state_t state, sent_state;
     std::vector<datum_t> artificial_initial_vals;
     bool artificial_include_initial;
+    std::function<bool(const change_val_t &)> unread_filter;
 
     auto_drainer_t *get_drainer() final { return &drainer; }
     auto_drainer_t drainer;
@@ -2836,96 +3359,17 @@ public:
             });
     }
     void operator()(const msg_t::change_t &change) const {
-        datum_t null = datum_t::null();
-
-        feed->each_range_sub(*lock, [&](range_sub_t *sub) {
-            datum_t new_val = null, old_val = null;
-            if (!sub->active()) return;
-            bool trivial = false;
-            if (sub->has_ops()) {
-                if (change.new_val.has()) {
-                    if (optional<datum_t> d = sub->apply_ops(change.new_val)) {
-                        new_val = *d;
-                    }
-                }
-                if (!sub->active()) return;
-                if (change.old_val.has()) {
-                    if (optional<datum_t> d = sub->apply_ops(change.old_val)) {
-                        old_val = *d;
-                    }
-                }
-                if (!sub->active()) return;
-                // Duplicate values are caught before being written to disk and
-                // don't generate a `mod_report`, but if we have transforms the
-                // values might have changed.
-                trivial = (new_val == old_val);
-            } else {
-                guarantee(change.old_val.has() || change.new_val.has());
-                if (change.new_val.has()) {
-                    new_val = change.new_val;
-                }
-                if (change.old_val.has()) {
-                    old_val = change.old_val;
-                }
-            }
-            ASSERT_NO_CORO_WAITING;
-            optional<std::string> sindex = sub->sindex();
-            if (sindex) {
-                std::vector<indexed_datum_t> old_idxs, new_idxs;
-                auto old_it = change.old_indexes.find(*sindex);
-                if (old_it != change.old_indexes.end()) {
-                    for (const auto &idx : old_it->second) {
-                        for (size_t i = 0; i < sub->copies(idx.first); ++i) {
-                            old_idxs.push_back(
-                                indexed_datum_t(old_val, make_optional(idx.second)));
-                        }
-                    }
-                }
-                auto new_it = change.new_indexes.find(*sindex);
-                if (new_it != change.new_indexes.end()) {
-                    for (const auto &idx : new_it->second) {
-                        for (size_t i = 0; i < sub->copies(idx.first); ++i) {
-                            new_idxs.push_back(
-                                indexed_datum_t(new_val, make_optional(idx.second)));
-                        }
-                    }
-                }
-                while (old_idxs.size() > 0 && new_idxs.size() > 0) {
-                    if (!trivial) {
-                        sub->add_el(server_uuid, stamp, change.pkey, sindex,
-                                    make_optional(std::move(old_idxs.back())),
-                                    make_optional(std::move(new_idxs.back())));
-                    }
-                    old_idxs.pop_back();
-                    new_idxs.pop_back();
-                }
-                while (old_idxs.size() > 0) {
-                    guarantee(new_idxs.size() == 0);
-                    if (old_val != null) {
-                        sub->add_el(server_uuid, stamp, change.pkey, sindex,
-                                    make_optional(std::move(old_idxs.back())),
-                                    r_nullopt);
-                    }
-                    old_idxs.pop_back();
-                }
-                while (new_idxs.size() > 0) {
-                    guarantee(old_idxs.size() == 0);
-                    if (new_val != null) {
-                        sub->add_el(server_uuid, stamp, change.pkey, sindex,
-                                    r_nullopt,
-                                    make_optional(std::move(new_idxs.back())));
-                    }
-                    new_idxs.pop_back();
-                }
-            } else {
-                if (!trivial) {
-                    for (size_t i = 0; i < sub->copies(change.pkey); ++i) {
-                        sub->add_el(server_uuid, stamp, change.pkey, sindex,
-                                    make_optional(indexed_datum_t(old_val, r_nullopt)),
-                                    make_optional(indexed_datum_t(new_val, r_nullopt)));
-                    }
-                }
-            }
+        // The transformed values on each thread, by `range_sub_t::ops_key()`, so subs
+        // with the same transforms only evaluate them once.
+        std::vector<std::map<std::string, std::pair<datum_t, datum_t> > >
+            transformed(get_num_threads());
+
+        std::map<uuid_u, uint64_t> log_positions =
+            feed->note_log_position(server_uuid, change.log_position + 1);
+        feed->each_range_sub_for_change(
+                *lock, change, [&](range_sub_t *sub) {
+            sub->add_change(change, server_uuid, stamp, log_positions,
+                            &transformed[get_thread_id().threadnum], false);
         });
         feed->on_point_sub(
             change.pkey,
@@ -2962,14 +3406,14 @@ void msg_visit(feed_t *feed,
     feed->update_stamps(server_uuid, stamp);
 }
 
-void real_feed_t::mailbox_cb(signal_t *, stamped_msg_t msg) {
+void real_feed_t::mailbox_cb(signal_t *, std::vector<stamped_msg_t> msgs) {
     // We stop receiving messages when detached (we're only receiving
     // messages because we haven't managed to get a message to the
     // stop mailboxes for some of the primary replicas yet).  This also stops
     // us from trying to handle a message while waiting on the auto
     // drainer. Because we acquire the auto drainer, we don't pay any
     // attention to the mailbox's signal.
-    if (!detached) {
+    if (!detached && !msgs.empty()) {
         auto_drainer_t::lock_t lock(&drainer);
 
         // We wait for the write to complete and the queues to be ready.
@@ -2979,7 +3423,9 @@ void real_feed_t::mailbox_cb(signal_t *, stamped_msg_t msg) {
         if (!lock.get_drain_signal()->is_pulsed()) {
             // We don't need a lock for this because the set of `uuid_u`s never
             // changes after it's initialized.
-            auto it = queues.find(msg.server_uuid);
+            // A batch always comes from a single `server_t`.
+            const uuid_u server_uuid = msgs[0].server_uuid;
+            auto it = queues.find(server_uuid);
             guarantee(it != queues.end());
             queue_t *queue = it->second.get();
             guarantee(queue != NULL);
@@ -2989,8 +3435,11 @@ void real_feed_t::mailbox_cb(signal_t *, stamped_msg_t msg) {
             if (detached) return;
 
             // Add us to the queue.
-            guarantee(msg.stamp >= queue->next);
-            queue->map.push(std::move(msg));
+            for (auto &&msg : msgs) {
+                guarantee(msg.server_uuid == server_uuid);
+                guarantee(msg.stamp >= queue->next);
+                queue->map.push(std::move(msg));
+            }
 
             // Read as much as we can from the queue (this enforces ordering.)
             while (queue->map.size() != 0 && queue->map.top().stamp == queue->next) {
@@ -3012,11 +3461,19 @@ public:
         : stream_t(std::forward<Args>(args)...),
           read_once(false),
           cached_ready(false),
+          reading(false),
           src(std::move(_src)) {
         r_sanity_check(src.has());
         for (const auto &p : sub->get_orig_stamps()) {
             stamped_ranges.insert(std::make_pair(p.first, stamped_range_t(p.second)));
         }
+        // Changes to rows we haven't read yet would be discarded once popped, so
+        // we don't let them pile up in the queue while the client reads slowly.
+        sub->set_unread_filter(
+            [this](const change_val_t &cv) { return unread(cv); });
+    }
+    ~splice_stream_t() {
+        sub->set_unread_filter(nullptr);
     }
 
 private:
@@ -3069,7 +3526,11 @@ private:
             if (!src->is_exhausted() && !batcher.should_send_batch()) {
                 // Sorting must be UNORDERED for our last_read range calculation to work.
                 batchspec_t new_bs = bs.with_lazy_sorting_override(sorting_t::UNORDERED);
+                // A read in flight may have a stamp older than the changes that
+                // come in while it's running, so `unread` can't drop them.
+                reading = true;
                 std::vector<datum_t> batch = src->next_batch(env, new_bs);
+                reading = false;
                 update_ranges();
                 r_sanity_check(active_state);
                 read_once = true;
@@ -3103,15 +3564,26 @@ private:
         return ret;
     }
 
+    static store_key_t change_key(const store_key_t &pkey, const indexed_datum_t &val) {
+        return val.btree_index_key ? store_key_t(*val.btree_index_key) : pkey;
+    }
+
+    // True if every value in `cv` is past what we've read so far.  The read that
+    // eventually covers them will have a later stamp, so `discard` would throw
+    // them away.
+    bool unread(const change_val_t &cv) {
+        if (!read_once || reading || cached_ready) return false;
+        auto it = stamped_ranges.find(cv.source_stamp.first);
+        if (it == stamped_ranges.end()) return false;
+        const store_key_t &right = it->second.get_right_fencepost();
+        return (!cv.old_val || change_key(cv.pkey, *cv.old_val) >= right)
+            && (!cv.new_val || change_key(cv.pkey, *cv.new_val) >= right);
+    }
+
     bool discard(const store_key_t &pkey,
                  const std::pair<uuid_u, uint64_t> &source_stamp,
                  const indexed_datum_t &val) {
-        store_key_t key;
-        if (val.btree_index_key) {
-            key = store_key_t(*val.btree_index_key);
-        } else {
-            key = pkey;
-        }
+        store_key_t key = change_key(pkey, val);
 
         auto it = stamped_ranges.find(source_stamp.first);
         r_sanity_check(it != stamped_ranges.end());
@@ -3135,6 +3607,12 @@ private:
             auto it = sub_stamps->find(pair.first);
             r_sanity_check(it != sub_stamps->end());
             uint64_t sub_stamp = it->second;
+            // Changes `unread` dropped never reach us, so once the queue is empty
+            // we've accounted for everything the subscription has seen.
+            if (!sub->has_change_val()) {
+                pair.second.next_expected_stamp =
+                    std::max(pair.second.next_expected_stamp, sub_stamp);
+            }
             // If we've consumed all the changes that the subscription has seen,
             // we can jump ahead to whatever stamp the parent feed says is the
             // latest it's decided whether or not to pass to the subscription.
@@ -3215,7 +3693,7 @@ private:
         return cached_ready;
     }
 
-    bool read_once, cached_ready;
+    bool read_once, cached_ready, reading;
     counted_t<datum_stream_t> src;
     optional<active_state_t> active_state;
     std::map<uuid_u, stamped_range_t> stamped_ranges;
@@ -3240,11 +3718,14 @@ subscription_t::subscription_t(
       rdb_context(_rdb_context),
       user_context(_user_context),
       cond(NULL),
-      queue_nearly_full_cond(NULL) {
+      queue_nearly_full_cond(NULL),
+      reported_queue_depth(0) {
     guarantee(feed != NULL);
 }
 
-subscription_t::~subscription_t() { }
+subscription_t::~subscription_t() {
+    note_queue_depth(0);
+}
 
 void subscription_t::set_notes(response_t *res) const {
     if (include_states) res->add_note(Response::INCLUDES_STATES);
@@ -3391,6 +3872,24 @@ void subscription_t::maybe_signal_cond() THROWS_NOTHING {
     }
 }
 
+void subscription_t::note_queue_depth(size_t depth) THROWS_NOTHING {
+    const int64_t change =
+        static_cast<int64_t>(depth) - static_cast<int64_t>(reported_queue_depth);
+    if (rdb_context != nullptr) {
+        rdb_context->stats.changefeed_queued_changes += change;
+    }
+    add_memory_usage(memory_tag_t::CHANGEFEED_QUEUES,
+                     change * static_cast<int64_t>(sizeof(change_val_t)));
+    reported_queue_depth = depth;
+}
+
+void subscription_t::note_dropped(size_t n) THROWS_NOTHING {
+    skipped += n;
+    if (rdb_context != nullptr) {
+        rdb_context->stats.changefeed_changes_dropped += n;
+    }
+}
+
 void subscription_t::maybe_signal_queue_nearly_full_cond() THROWS_NOTHING {
     assert_thread();
     if (queue_nearly_full_cond != NULL) {
@@ -3502,30 +4001,115 @@ size_t map_del_sub(Map *map, const Key &key, Sub *sub) THROWS_NOTHING {
 // If this throws we might leak the increment to `num_subs`.
 void feed_t::add_point_sub(point_sub_t *sub, const store_key_t &key) THROWS_NOTHING {
     add_sub_with_lock(&point_subs_lock, [this, sub, &key]() {
-            map_add_sub(&point_subs, key, sub);
+            std::vector<point_sub_t *> *subs = &point_subs[key];
+            guarantee(std::find(subs->begin(), subs->end(), sub) == subs->end());
+            subs->push_back(sub);
         });
 }
 
 // Can't throw because it's called in a destructor.
 void feed_t::del_point_sub(point_sub_t *sub, const store_key_t &key) THROWS_NOTHING {
-    del_sub_with_lock(&point_subs_lock, [this, sub, &key]() {
-            return map_del_sub(&point_subs, key, sub);
+    del_sub_with_lock(&point_subs_lock, [this, sub, &key]() -> size_t {
+            auto it = point_subs.find(key);
+            if (it == point_subs.end()) {
+                return 0;
+            }
+            std::vector<point_sub_t *> *subs = &it->second;
+            auto sub_it = std::find(subs->begin(), subs->end(), sub);
+            if (sub_it == subs->end()) {
+                return 0;
+            }
+            *sub_it = subs->back();
+            subs->pop_back();
+            if (subs->empty()) {
+                point_subs.erase(it);
+            }
+            return 1;
         });
 }
 
 // If this throws we might leak the increment to `num_subs`.
 void feed_t::add_range_sub(range_sub_t *sub) THROWS_NOTHING {
     add_sub_with_lock(&range_subs_lock, [this, sub]() {
-            auto pair = range_subs[sub->home_thread().threadnum].insert(sub);
-            guarantee(pair.second);
+            if (const auto &eq = sub->filter_equality()) {
+                map_add_sub(&filtered_range_subs[eq->first], eq->second, sub);
+            } else if (const datumspec_t *ds = sub->indexed_datumspec()) {
+                sindex_subs_t *subs = &sindex_range_subs[*sub->sindex()];
+                ds->visit<void>(
+                    [subs, sub](const datum_range_t &range) {
+                        subs->by_range.insert(std::make_pair(range, sub));
+                    },
+                    [subs, sub](const std::map<datum_t, uint64_t> &values) {
+                        for (const auto &pair : values) {
+                            auto res = subs->by_value[pair.first].insert(sub);
+                            guarantee(res.second);
+                        }
+                    });
+            } else {
+                auto pair = range_subs[sub->home_thread().threadnum].insert(sub);
+                guarantee(pair.second);
+            }
         });
 }
 
 // Can't throw because it's called in a destructor.
 void feed_t::del_range_sub(range_sub_t *sub) THROWS_NOTHING {
-    del_sub_with_lock(&range_subs_lock, [this, sub]() {
-            return range_subs[sub->home_thread().threadnum].erase(sub);
+    del_sub_with_lock(&range_subs_lock, [this, sub]() -> size_t {
+            const auto &eq = sub->filter_equality();
+            if (!eq) {
+                if (const datumspec_t *ds = sub->indexed_datumspec()) {
+                    return del_sindex_range_sub(sub, ds);
+                }
+                return range_subs[sub->home_thread().threadnum].erase(sub);
+            }
+            auto it = filtered_range_subs.find(eq->first);
+            if (it == filtered_range_subs.end()) {
+                return 0;
+            }
+            size_t erased = map_del_sub(&it->second, eq->second, sub);
+            if (it->second.empty()) {
+                filtered_range_subs.erase(it);
+            }
+            return erased;
+        });
+}
+
+size_t feed_t::del_sindex_range_sub(range_sub_t *sub, const datumspec_t *ds) {
+    auto it = sindex_range_subs.find(*sub->sindex());
+    if (it == sindex_range_subs.end()) {
+        return 0;
+    }
+    sindex_subs_t *subs = &it->second;
+    size_t erased = ds->visit<size_t>(
+        [subs, sub](const datum_range_t &range) -> size_t {
+            auto range_its = subs->by_range.equal_range(range);
+            for (auto range_it = range_its.first;
+                 range_it != range_its.second;
+                 ++range_it) {
+                if (range_it->second == sub) {
+                    subs->by_range.erase(range_it);
+                    return 1;
+                }
+            }
+            return 0;
+        },
+        [subs, sub](const std::map<datum_t, uint64_t> &values) -> size_t {
+            size_t erased_values = 0;
+            for (const auto &pair : values) {
+                auto value_it = subs->by_value.find(pair.first);
+                if (value_it != subs->by_value.end()) {
+                    erased_values += value_it->second.erase(sub);
+                    if (value_it->second.empty()) {
+                        subs->by_value.erase(value_it);
+                    }
+                }
+            }
+            return erased_values != 0 ? 1 : 0;
         });
+    if (subs->by_value.empty() && subs->by_range.empty()) {
+        sindex_range_subs.erase(it);
+    }
+    return erased;
 }
 
 // If this throws we might leak the increment to `num_subs`.
@@ -3584,19 +4168,105 @@ void feed_t::each_sub_in_vec(
          });
 }
 
-void feed_t::each_range_sub(
+void feed_t::each_range_sub_for_change(
     const auto_drainer_t::lock_t &lock,
+    const msg_t::change_t &change,
     const std::function<void(range_sub_t *)> &f) THROWS_NOTHING {
     assert_thread();
+    guarantee(lock.has_lock());
     rwlock_in_line_t spot(&range_subs_lock, access_t::read);
-    each_sub_in_vec(range_subs, &spot, lock, f);
+    spot.read_signal()->wait_lazily_unordered();
+
+    // A sub's filter drops every value whose field doesn't equal its constant (or
+    // that doesn't have the field at all), so only the subs filed under the old or
+    // the new value of the field can see the change.
+    std::vector<std::vector<range_sub_t *> > matching(get_num_threads());
+    for (const auto &field_pair : filtered_range_subs) {
+        datum_t vals[2];
+        size_t num_vals = 0;
+        for (const datum_t *val : { &change.old_val, &change.new_val }) {
+            if (val->has() && val->get_type() == datum_t::R_OBJECT) {
+                datum_t field_val = val->get_field(field_pair.first, NOTHROW);
+                if (field_val.has() && (num_vals == 0 || vals[0] != field_val)) {
+                    vals[num_vals++] = field_val;
+                }
+            }
+        }
+        for (size_t i = 0; i < num_vals; ++i) {
+            auto it = field_pair.second.find(vals[i]);
+            if (it != field_pair.second.end()) {
+                for (int thread = 0; thread < get_num_threads(); ++thread) {
+                    matching[thread].insert(matching[thread].end(),
+                                            it->second[thread].begin(),
+                                            it->second[thread].end());
+                }
+            }
+        }
+    }
+
+    // A sub on a secondary index only sees a change if one of the change's old or
+    // new values for that index is in its range.  The values were computed by the
+    // store when it updated the index.  (A sub can match more than one value, so
+    // we collect them in a set first.)
+    std::set<range_sub_t *> sindex_matching;
+    for (const auto &sindex_pair : sindex_range_subs) {
+        const sindex_subs_t &subs = sindex_pair.second;
+        for (const index_vals_t *index_vals : { &change.old_indexes,
+                                                &change.new_indexes }) {
+            auto vals_it = index_vals->find(sindex_pair.first);
+            if (vals_it == index_vals->end()) {
+                continue;
+            }
+            for (const auto &index_pair : vals_it->second) {
+                const datum_t &val = index_pair.first;
+                auto value_it = subs.by_value.find(val);
+                if (value_it != subs.by_value.end()) {
+                    sindex_matching.insert(value_it->second.begin(),
+                                           value_it->second.end());
+                }
+                // `by_range` is ordered by left bound, so we can stop at the
+                // first range that starts after `val`.
+                for (auto range_it = subs.by_range.begin();
+                     range_it != subs.by_range.end()
+                         && !range_it->first.is_after(val);
+                     ++range_it) {
+                    if (range_it->first.contains(val)) {
+                        sindex_matching.insert(range_it->second);
+                    }
+                }
+            }
+        }
+    }
+    for (range_sub_t *sub : sindex_matching) {
+        matching[sub->home_thread().threadnum].push_back(sub);
+    }
+
+    std::vector<int> subscription_threads;
+    for (int i = 0; i < get_num_threads(); ++i) {
+        if (range_subs[i].size() != 0 || matching[i].size() != 0) {
+            subscription_threads.push_back(i);
+        }
+    }
+    pmap(subscription_threads.size(),
+         [this, &f, &matching, &subscription_threads](int i) {
+             int thread = subscription_threads[i];
+             on_thread_t th((threadnum_t(thread)));
+             for (range_sub_t *sub : range_subs[thread]) {
+                 f(sub);
+             }
+             for (range_sub_t *sub : matching[thread]) {
+                 f(sub);
+             }
+         });
 }
 
 void feed_t::each_point_sub_cb(const std::function<void(point_sub_t *)> &f, int i) {
     on_thread_t th((threadnum_t(i)));
     for (auto const &pair : point_subs) {
-        for (point_sub_t *sub : pair.second[i]) {
-            f(sub);
+        for (point_sub_t *sub : pair.second) {
+            if (sub->home_thread().threadnum == i) {
+                f(sub);
+            }
         }
     }
 }
@@ -3644,7 +4314,24 @@ void feed_t::on_point_sub(
 
     auto point_sub = point_subs.find(key);
     if (point_sub != point_subs.end()) {
-        each_sub_in_vec(point_sub->second, &spot, lock, f);
+        const std::vector<point_sub_t *> &subs = point_sub->second;
+        std::vector<int> subscription_threads;
+        for (point_sub_t *sub : subs) {
+            int thread = sub->home_thread().threadnum;
+            if (std::find(subscription_threads.begin(), subscription_threads.end(),
+                          thread) == subscription_threads.end()) {
+                subscription_threads.push_back(thread);
+            }
+        }
+        pmap(subscription_threads.size(),
+             [&f, &subs, &subscription_threads](int i) {
+                 on_thread_t th((threadnum_t(subscription_threads[i])));
+                 for (point_sub_t *sub : subs) {
+                     if (sub->home_thread().threadnum == subscription_threads[i]) {
+                         f(sub);
+                     }
+                 }
+             });
     }
 }
 
@@ -3687,6 +4374,31 @@ void feed_t::stop_subs(const auto_drainer_t::lock_t &lock) {
             num_subs -= set.size();
             set.clear();
         }
+        for (const auto &field_pair : filtered_range_subs) {
+            for (const auto &value_pair : field_pair.second) {
+                each_sub_in_vec<range_sub_t>(value_pair.second, &spot, lock, f);
+                for (const auto &set : value_pair.second) {
+                    num_subs -= set.size();
+                }
+            }
+        }
+        filtered_range_subs.clear();
+        std::set<range_sub_t *> sindex_subs;
+        for (const auto &sindex_pair : sindex_range_subs) {
+            for (const auto &value_pair : sindex_pair.second.by_value) {
+                sindex_subs.insert(value_pair.second.begin(), value_pair.second.end());
+            }
+            for (const auto &range_pair : sindex_pair.second.by_range) {
+                sindex_subs.insert(range_pair.second);
+            }
+        }
+        std::vector<std::set<range_sub_t *> > sindex_subs_by_thread(get_num_threads());
+        for (range_sub_t *sub : sindex_subs) {
+            sindex_subs_by_thread[sub->home_thread().threadnum].insert(sub);
+        }
+        each_sub_in_vec<range_sub_t>(sindex_subs_by_thread, &spot, lock, f);
+        num_subs -= sindex_subs.size();
+        sindex_range_subs.clear();
     }
     {
         rwlock_in_line_t spot(&empty_subs_lock, access_t::write);
@@ -3702,9 +4414,7 @@ void feed_t::stop_subs(const auto_drainer_t::lock_t &lock) {
         spot.write_signal()->wait_lazily_unordered();
         each_point_sub_with_lock(&spot, f);
         for (auto &&pair : point_subs) {
-            for (auto &&set : pair.second) {
-                num_subs -= set.size();
-            }
+            num_subs -= pair.second.size();
         }
         point_subs.clear();
     }
@@ -3771,12 +4481,17 @@ scoped_ptr_t<subscription_t> new_sub(
                 ss->squash,
                 ss->include_states,
                 ss->include_types,
+                ss->include_tokens,
+                ss->since,
+                ss->queue_overflow,
                 env,
                 range);
         }
         subscription_t *operator()(const keyspec_t::empty_t &) const {
             rcheck_datum(!ss->include_offsets, base_exc_t::LOGIC,
                          "Cannot include offsets for empty subs.");
+            rcheck_datum(!ss->include_tokens && !ss->since, base_exc_t::LOGIC,
+                         "Cannot resume changefeeds on empty ranges.");
             return new empty_sub_t(
                 env->get_rdb_ctx(),
                 env->get_user_context(),
@@ -3784,9 +4499,16 @@ scoped_ptr_t<subscription_t> new_sub(
                 ss->limits,
                 ss->squash,
                 ss->include_states,
-                ss->include_types);
+                ss->include_types,
+                ss->queue_overflow);
         }
         subscription_t *operator()(const keyspec_t::limit_t &limit) const {
+            rcheck_datum(!ss->include_tokens && !ss->since, base_exc_t::LOGIC,
+                         "Cannot resume changefeeds on `order_by.limit`.");
+            rcheck_datum(ss->queue_overflow == queue_overflow_t::CLEAR,
+                         base_exc_t::LOGIC,
+                         "Cannot set `changefeed_queue_overflow` for "
+                         "`order_by.limit` changefeeds.");
             return new limit_sub_t(
                 env->get_rdb_ctx(),
                 env->get_user_context(),
@@ -3801,6 +4523,8 @@ scoped_ptr_t<subscription_t> new_sub(
         subscription_t *operator()(const keyspec_t::point_t &point) const {
             rcheck_datum(!ss->include_offsets, base_exc_t::LOGIC,
                          "Cannot include offsets for point subs.");
+            rcheck_datum(!ss->include_tokens && !ss->since, base_exc_t::LOGIC,
+                         "Cannot resume changefeeds on single documents.");
             return new point_sub_t(
                 env->get_rdb_ctx(),
                 env->get_user_context(),
@@ -3809,6 +4533,7 @@ scoped_ptr_t<subscription_t> new_sub(
                 ss->squash,
                 ss->include_states,
                 ss->include_types,
+                ss->queue_overflow,
                 point.key);
         }
         env_t *env;
@@ -3826,6 +4551,9 @@ streamspec_t::streamspec_t(counted_t<datum_stream_t> _maybe_src,
                            bool _include_types,
                            configured_limits_t _limits,
                            datum_t _squash,
+                           bool _include_tokens,
+                           optional<std::map<uuid_u, uint64_t> > _since,
+                           queue_overflow_t _queue_overflow,
                            keyspec_t::spec_t _spec) :
     maybe_src(std::move(_maybe_src)),
     table_name(std::move(_table_name)),
@@ -3834,6 +4562,9 @@ streamspec_t::streamspec_t(counted_t<datum_stream_t> _maybe_src,
     include_types(std::move(_include_types)),
     limits(std::move(_limits)),
     squash(std::move(_squash)),
+    include_tokens(_include_tokens),
+    since(std::move(_since)),
+    queue_overflow(_queue_overflow),
     spec(std::move(_spec)) { }
 
 counted_t<datum_stream_t> client_t::new_stream(
@@ -102,6 +102,9 @@ struct msg_t {
         `new_val` is an empty `datum_t`. */
         datum_t old_val;
         datum_t new_val;
+        // Where the change is in its `server_t`'s change log.  This is set by
+        // `server_t::send_all`.
+        uint64_t log_position;
         RDB_DECLARE_ME_SERIALIZABLE(change_t);
     };
     struct stop_t {
@@ -128,10 +131,27 @@ struct msg_t {
 
 RDB_DECLARE_SERIALIZABLE(msg_t);
 
+// A `msg_t` tagged with the `server_t` it came from and its position in the
+// stream of messages that server sends to one client.  The client uses the stamps
+// to process messages in order.
+struct stamped_msg_t {
+    stamped_msg_t() { }
+    stamped_msg_t(uuid_u _server_uuid, uint64_t _stamp, msg_t _submsg)
+        : server_uuid(std::move(_server_uuid)),
+          stamp(_stamp),
+          submsg(std::move(_submsg)) { }
+    uuid_u server_uuid;
+    uint64_t stamp;
+    msg_t submsg;
+};
+
+RDB_DECLARE_SERIALIZABLE(stamped_msg_t);
+
 class real_feed_t;
-struct stamped_msg_t;
 
-typedef mailbox_addr_t<stamped_msg_t> client_addr_t;
+// Servers coalesce the messages for a client into batches, so a client receives
+// a vector of stamped messages at a time.
+typedef mailbox_addr_t<std::vector<stamped_msg_t> > client_addr_t;
 
 struct keyspec_t {
     struct range_t {
@@ -177,6 +197,18 @@ struct keyspec_t {
 };
 region_t keyspec_to_region(const keyspec_t &keyspec);
 
+// What a subscription does with its queue of changes once it's over the
+// `changefeed_queue_size` because the client isn't reading fast enough.
+enum class queue_overflow_t {
+    // Throw away the whole queue and tell the client how many changes it missed.
+    CLEAR,
+    // Start squashing changes to the same key once the queue is half full, and
+    // `CLEAR` if that isn't enough.
+    SQUASH,
+    // Throw away the oldest change, and tell the client how many it missed.
+    DROP_OLDEST
+};
+
 class streamspec_t {
 public:
     counted_t<datum_stream_t> maybe_src; // Non-null iff `include_initial`.
@@ -186,6 +218,11 @@ public:
     bool include_types;
     configured_limits_t limits;
     datum_t squash;
+    // Whether changes include a `token` that `since` can resume the feed from, and
+    // the change log positions (by `server_t` uuid) to resume from.
+    bool include_tokens;
+    optional<std::map<uuid_u, uint64_t> > since;
+    queue_overflow_t queue_overflow;
     keyspec_t::spec_t spec;
     streamspec_t(counted_t<datum_stream_t> _maybe_src,
                  std::string _table_name,
@@ -194,6 +231,9 @@ public:
                  bool _include_types,
                  configured_limits_t _limits,
                  datum_t _squash,
+                 bool _include_tokens,
+                 optional<std::map<uuid_u, uint64_t> > _since,
+                 queue_overflow_t _queue_overflow,
                  keyspec_t::spec_t _spec);
 };
 
@@ -433,10 +473,13 @@ public:
     const optional<uuid_u> sindex_id;
     const uuid_u uuid;
 private:
-    // Can throw `exc_t` exceptions if an error occurs while reading from disk.
+    // Reads up to `n` items after `start` and sets `overflow_exhausted` if there
+    // were fewer than that.  Can throw `exc_t` exceptions if an error occurs while
+    // reading from disk.
     std::vector<item_t> read_more(
         const boost::variant<primary_ref_t, sindex_ref_t> &ref,
-        const optional<item_t> &start);
+        const optional<item_t> &start,
+        size_t n);
     void send(msg_t &&msg);
 
     scoped_ptr_t<env_t> env;
@@ -449,6 +492,12 @@ private:
 
     limit_order_t gt;
     item_queue_t item_queue;
+    // Up to `CHANGEFEED_LIMIT_OVERFLOW_SIZE` items that come right after the ones
+    // in `item_queue`.  Every item on disk between the end of `item_queue` and the
+    // end of `overflow` is in `overflow`, and if `overflow_exhausted` is true there
+    // are no items on disk past it at all.
+    item_queue_t overflow;
+    bool overflow_exhausted;
 
     std::map<std::string, std::pair<datum_t, datum_t> > added;
     std::set<std::string> deleted;
@@ -496,6 +545,16 @@ public:
     optional<uint64_t> get_stamp(
         const client_t::addr_t &addr,
         const auto_drainer_t::lock_t &keepalive);
+    // Like `get_stamp`, but also reads the change log at the same point.  Sets
+    // `*log_position_out` to the position the next logged change will get, and
+    // `*log_changes_out` to the logged changes from `since` on, unless the log
+    // no longer goes back that far.
+    optional<uint64_t> get_stamp(
+        const client_t::addr_t &addr,
+        const optional<uint64_t> &since,
+        uint64_t *log_position_out,
+        optional<std::vector<msg_t::change_t> > *log_changes_out,
+        const auto_drainer_t::lock_t &keepalive);
     uuid_u get_uuid();
     // `f` will be called with a read lock on `clients` and a write lock on the
     // limit manager.
@@ -534,6 +593,10 @@ private:
         client_info_t();
         scoped_ptr_t<cond_t> cond;
         uint64_t stamp;
+        // Stamped messages waiting to be sent in the next batch, and whether a
+        // coroutine to flush them has already been spawned.
+        std::vector<stamped_msg_t> pending;
+        bool flush_scheduled;
         std::vector<region_t> regions;
         std::map<optional<std::string>,
                  std::vector<scoped_ptr_t<limit_manager_t>>> limit_clients;
@@ -552,6 +615,17 @@ private:
                             msg_t msg,
                             const auto_drainer_t::lock_t &lock);
 
+    // Changes for a client are held for up to `CHANGEFEED_BATCH_DELAY_MS` (or
+    // until `CHANGEFEED_MAX_BATCH_SIZE` of them have piled up) so that they can
+    // be sent in one cluster message.  `enqueue` returns true if the client's
+    // batch is full and should be sent right away; otherwise `flush_cb` sends it
+    // once the delay has passed.
+    MUST_USE bool enqueue(std::pair<const client_t::addr_t, client_info_t> *client,
+                 stamped_msg_t msg,
+                 const auto_drainer_t::lock_t &lock);
+    void flush(std::pair<const client_t::addr_t, client_info_t> *client);
+    void flush_cb(client_t::addr_t addr, auto_drainer_t::lock_t keepalive);
+
     // Controls access to `clients`.  A `server_t` needs to read `clients` when:
     // * `send_all` is called
     // * `get_stamp` is called
@@ -566,6 +640,12 @@ private:
     // We need access to the stamp lock that exists on the parent.
     store_t *parent;
 
+    // The last `CHANGEFEED_LOG_SIZE` changes sent by `send_all`, so that feeds can
+    // resume from a position in it.  `next_log_position` is the position the next
+    // change will get.  Both are protected by the parent's `cfeed_stamp_lock`.
+    std::deque<msg_t::change_t> change_log;
+    uint64_t next_log_position;
+
     auto_drainer_t drainer;
     // Clients send a message to this mailbox with their address when they want
     // to unsubscribe.  The callback of this mailbox acquires the drainer, so it
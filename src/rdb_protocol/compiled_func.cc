@@ -0,0 +1,331 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#include "rdb_protocol/compiled_func.hpp"
+
+#include <cmath>
+
+#include "rdb_protocol/ql2proto.hpp"
+#include "rdb_protocol/term_storage.hpp"
+#include "rdb_protocol/var_types.hpp"
+
+namespace ql {
+
+scoped_ptr_t<compiled_func_t> compiled_func_t::compile(
+        const raw_term_t &body,
+        const std::vector<sym_t> &arg_names,
+        const var_scope_t &captured_scope) {
+    scoped_ptr_t<compiled_func_t> compiled(new compiled_func_t());
+    if (arg_names.empty()
+        || !compiled->compile_term(body, arg_names, captured_scope, &compiled->root)) {
+        return scoped_ptr_t<compiled_func_t>();
+    }
+    return compiled;
+}
+
+bool compiled_func_t::compile_term(const raw_term_t &term,
+                                   const std::vector<sym_t> &arg_names,
+                                   const var_scope_t &captured_scope,
+                                   size_t *node_out) {
+    node_t node;
+    node.arg = 0;
+    node.first_operand = 0;
+    node.num_operands = 0;
+    if (term.type() == Term::MAKE_OBJ) {
+        // The values are the optargs, so this can't go through the generic case.  A
+        // `$reql_type$` key would make a pseudotype, which can fail to validate.
+        if (term.num_args() != 0
+            || term.optarg(datum_t::reql_type_string.to_std()).has_value()) {
+            return false;
+        }
+        node.op = op_t::MAKE_OBJ;
+        std::vector<size_t> compiled_values;
+        bool ok = true;
+        term.each_optarg([&](const raw_term_t &value, const std::string &key) {
+                size_t operand;
+                if (ok && compile_term(value, arg_names, captured_scope, &operand)) {
+                    node.keys.push_back(datum_string_t(key));
+                    compiled_values.push_back(operand);
+                } else {
+                    ok = false;
+                }
+            });
+        if (!ok) {
+            return false;
+        }
+        node.first_operand = operands.size();
+        node.num_operands = compiled_values.size();
+        operands.insert(operands.end(), compiled_values.begin(), compiled_values.end());
+        nodes.push_back(std::move(node));
+        *node_out = nodes.size() - 1;
+        return true;
+    }
+    if (term.num_optargs() != 0) {
+        return false;
+    }
+    size_t min_operands = 1;
+    switch (static_cast<int>(term.type())) {
+    case Term::DATUM:
+        node.op = op_t::CONSTANT;
+        node.constant = term.datum();
+        min_operands = 0;
+        break;
+    case Term::VAR: {
+        if (term.num_args() != 1 || term.arg(0).type() != Term::DATUM) {
+            return false;
+        }
+        datum_t var = term.arg(0).datum();
+        int64_t var_id;
+        if (var.get_type() != datum_t::R_NUM
+            || !number_as_integer(var.as_num(), &var_id)) {
+            return false;
+        }
+        node.op = op_t::CONSTANT;
+        for (size_t i = 0; i < arg_names.size(); ++i) {
+            if (arg_names[i].value == var_id) {
+                node.op = op_t::ARG;
+                node.arg = i;
+            }
+        }
+        if (node.op == op_t::CONSTANT) {
+            // Anything else the body uses was captured when the function was made.
+            node.constant = captured_scope.lookup_var(sym_t(var_id));
+        }
+        nodes.push_back(std::move(node));
+        *node_out = nodes.size() - 1;
+        return true;
+    }
+    case Term::IMPLICIT_VAR:
+        if (!function_emits_implicit_variable(arg_names)) {
+            return false;
+        }
+        node.op = op_t::ARG;
+        min_operands = 0;
+        break;
+    case Term::GET_FIELD: // fallthru
+    case Term::BRACKET: {
+        if (term.num_args() != 2 || term.arg(1).type() != Term::DATUM) {
+            return false;
+        }
+        datum_t field = term.arg(1).datum();
+        if (field.get_type() != datum_t::R_STR) {
+            return false;
+        }
+        node.op = op_t::GET_FIELD;
+        node.field = field.as_str();
+        size_t object;
+        if (!compile_term(term.arg(0), arg_names, captured_scope, &object)) {
+            return false;
+        }
+        node.first_operand = operands.size();
+        node.num_operands = 1;
+        operands.push_back(object);
+        nodes.push_back(std::move(node));
+        *node_out = nodes.size() - 1;
+        return true;
+    }
+    case Term::ADD: node.op = op_t::ADD; break;
+    case Term::SUB: node.op = op_t::SUB; break;
+    case Term::MUL: node.op = op_t::MUL; break;
+    case Term::DIV: node.op = op_t::DIV; break;
+    case Term::EQ: node.op = op_t::EQ; min_operands = 2; break;
+    case Term::NE: node.op = op_t::NE; min_operands = 2; break;
+    case Term::LT: node.op = op_t::LT; min_operands = 2; break;
+    case Term::LE: node.op = op_t::LE; min_operands = 2; break;
+    case Term::GT: node.op = op_t::GT; min_operands = 2; break;
+    case Term::GE: node.op = op_t::GE; min_operands = 2; break;
+    case Term::AND: node.op = op_t::AND; min_operands = 0; break;
+    case Term::OR: node.op = op_t::OR; min_operands = 0; break;
+    case Term::NOT:
+        if (term.num_args() != 1) {
+            return false;
+        }
+        node.op = op_t::NOT;
+        break;
+    case Term::BRANCH:
+        if (term.num_args() < 3 || term.num_args() % 2 != 1) {
+            return false;
+        }
+        node.op = op_t::BRANCH;
+        break;
+    case Term::MERGE: node.op = op_t::MERGE; break;
+    default:
+        return false;
+    }
+    if (node.op == op_t::CONSTANT || node.op == op_t::ARG) {
+        if (term.num_args() != 0) {
+            return false;
+        }
+        nodes.push_back(std::move(node));
+        *node_out = nodes.size() - 1;
+        return true;
+    }
+    if (term.num_args() < min_operands) {
+        return false;
+    }
+
+    // The operands have to be compiled before we know where they go, and compiling
+    // them appends their own operands, so we collect them first.
+    std::vector<size_t> compiled_operands;
+    compiled_operands.reserve(term.num_args());
+    for (size_t i = 0; i < term.num_args(); ++i) {
+        size_t operand;
+        if (!compile_term(term.arg(i), arg_names, captured_scope, &operand)) {
+            return false;
+        }
+        compiled_operands.push_back(operand);
+    }
+    node.first_operand = operands.size();
+    node.num_operands = compiled_operands.size();
+    operands.insert(operands.end(), compiled_operands.begin(), compiled_operands.end());
+    nodes.push_back(std::move(node));
+    *node_out = nodes.size() - 1;
+    return true;
+}
+
+datum_t compiled_func_t::eval(const std::vector<datum_t> &args) const {
+    return eval_node(root, args);
+}
+
+datum_t compiled_func_t::eval_node(size_t index,
+                                   const std::vector<datum_t> &args) const {
+    const node_t &node = nodes[index];
+    const size_t *node_operands = operands.data() + node.first_operand;
+    switch (node.op) {
+    case op_t::CONSTANT:
+        return node.constant;
+    case op_t::ARG:
+        return args[node.arg];
+    case op_t::GET_FIELD: {
+        datum_t object = eval_node(node_operands[0], args);
+        if (!object.has() || object.get_type() != datum_t::R_OBJECT) {
+            return datum_t();
+        }
+        return object.get_field(node.field, NOTHROW);
+    }
+    case op_t::ADD: // fallthru
+    case op_t::SUB: // fallthru
+    case op_t::MUL: // fallthru
+    case op_t::DIV: {
+        // Only numbers: strings, arrays and times are left to the interpreter.
+        double acc = 0;
+        for (size_t i = 0; i < node.num_operands; ++i) {
+            datum_t operand = eval_node(node_operands[i], args);
+            if (!operand.has() || operand.get_type() != datum_t::R_NUM) {
+                return datum_t();
+            }
+            const double num = operand.as_num();
+            if (i == 0) {
+                acc = num;
+            } else if (node.op == op_t::ADD) {
+                acc += num;
+            } else if (node.op == op_t::SUB) {
+                acc -= num;
+            } else if (node.op == op_t::MUL) {
+                acc *= num;
+            } else {
+                if (num == 0) {
+                    return datum_t();
+                }
+                acc /= num;
+            }
+            if (!std::isfinite(acc)) {
+                return datum_t();
+            }
+        }
+        return datum_t(acc);
+    }
+    case op_t::EQ: // fallthru
+    case op_t::NE: // fallthru
+    case op_t::LT: // fallthru
+    case op_t::LE: // fallthru
+    case op_t::GT: // fallthru
+    case op_t::GE: {
+        // Like `predicate_term_t`, we stop evaluating at the first pair that fails.
+        datum_t lhs = eval_node(node_operands[0], args);
+        if (!lhs.has()) {
+            return datum_t();
+        }
+        bool holds = true;
+        for (size_t i = 1; i < node.num_operands && holds; ++i) {
+            datum_t rhs = eval_node(node_operands[i], args);
+            if (!rhs.has()) {
+                return datum_t();
+            }
+            switch (node.op) {
+            case op_t::EQ: // fallthru
+            case op_t::NE: holds = lhs == rhs; break;
+            case op_t::LT: holds = lhs.cmp(rhs) < 0; break;
+            case op_t::LE: holds = lhs.cmp(rhs) <= 0; break;
+            case op_t::GT: holds = lhs.cmp(rhs) > 0; break;
+            case op_t::GE: holds = lhs.cmp(rhs) >= 0; break;
+            default: unreachable();
+            }
+            lhs = std::move(rhs);
+        }
+        return datum_t::boolean(node.op == op_t::NE ? !holds : holds);
+    }
+    case op_t::AND: // fallthru
+    case op_t::OR: {
+        const bool is_and = node.op == op_t::AND;
+        datum_t value = datum_t::boolean(is_and);
+        for (size_t i = 0; i < node.num_operands; ++i) {
+            value = eval_node(node_operands[i], args);
+            if (!value.has()) {
+                return datum_t();
+            }
+            if (value.as_bool() != is_and) {
+                break;
+            }
+        }
+        return value;
+    }
+    case op_t::NOT: {
+        datum_t value = eval_node(node_operands[0], args);
+        if (!value.has()) {
+            return datum_t();
+        }
+        return datum_t::boolean(!value.as_bool());
+    }
+    case op_t::BRANCH: {
+        // Only the taken branch is evaluated, like in `branch_term_t`.
+        for (size_t i = 0; i + 1 < node.num_operands; i += 2) {
+            datum_t test = eval_node(node_operands[i], args);
+            if (!test.has()) {
+                return datum_t();
+            }
+            if (test.as_bool()) {
+                return eval_node(node_operands[i + 1], args);
+            }
+        }
+        return eval_node(node_operands[node.num_operands - 1], args);
+    }
+    case op_t::MAKE_OBJ: {
+        datum_object_builder_t builder;
+        for (size_t i = 0; i < node.num_operands; ++i) {
+            datum_t value = eval_node(node_operands[i], args);
+            if (!value.has() || value.is_ptype("LITERAL")) {
+                return datum_t();
+            }
+            builder.overwrite(node.keys[i], std::move(value));
+        }
+        return std::move(builder).to_datum();
+    }
+    case op_t::MERGE: {
+        // Only plain objects: sequences, functions and pseudotypes (including
+        // `r.literal`) are left to the interpreter.
+        datum_t acc;
+        for (size_t i = 0; i < node.num_operands; ++i) {
+            datum_t operand = eval_node(node_operands[i], args);
+            if (!operand.has()
+                || operand.get_type() != datum_t::R_OBJECT
+                || operand.is_ptype()) {
+                return datum_t();
+            }
+            acc = i == 0 ? std::move(operand) : acc.merge(operand);
+        }
+        return acc;
+    }
+    default: unreachable();
+    }
+}
+
+}  // namespace ql
@@ -0,0 +1,84 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#ifndef RDB_PROTOCOL_COMPILED_FUNC_HPP_
+#define RDB_PROTOCOL_COMPILED_FUNC_HPP_
+
+#include <vector>
+
+#include "containers/scoped.hpp"
+#include "rdb_protocol/datum.hpp"
+#include "rdb_protocol/datum_string.hpp"
+#include "rdb_protocol/sym.hpp"
+
+namespace ql {
+
+class raw_term_t;
+class var_scope_t;
+
+/* `compiled_func_t` is a compact form of the body of a `reql_func_t` that only uses
+literals, the function's arguments and captured variables, top-level field access,
+arithmetic on numbers, comparisons, `and`/`or`/`not`, `branch`, object literals and
+merging objects.  That covers field transforms like write hooks that set an
+`updated_at` field.  It evaluates straight on
+datums, without `val_t`s, scopes or virtual `eval` calls.
+
+It never reports errors itself: whenever the interpreter would fail (a missing field,
+a type mismatch, a division by zero, ...) `eval` returns an empty datum, and the
+caller evaluates the `term_t` tree instead to get the proper error and backtrace. */
+class compiled_func_t {
+public:
+    // Returns an empty pointer if `body` uses anything we don't compile.
+    static scoped_ptr_t<compiled_func_t> compile(const raw_term_t &body,
+                                                 const std::vector<sym_t> &arg_names,
+                                                 const var_scope_t &captured_scope);
+
+    // `args` has one datum per argument name.
+    datum_t eval(const std::vector<datum_t> &args) const;
+
+private:
+    enum class op_t {
+        CONSTANT,
+        ARG,
+        GET_FIELD,
+        ADD, SUB, MUL, DIV,
+        EQ, NE, LT, LE, GT, GE,
+        AND, OR, NOT,
+        BRANCH,
+        MAKE_OBJ, MERGE
+    };
+
+    struct node_t {
+        op_t op;
+        // The value of a `CONSTANT`.
+        datum_t constant;
+        // The field of a `GET_FIELD`.
+        datum_string_t field;
+        // The keys of a `MAKE_OBJ`, one per operand.
+        std::vector<datum_string_t> keys;
+        // The argument of an `ARG`.
+        size_t arg;
+        // The operands are `operands[first_operand, first_operand + num_operands)`.
+        size_t first_operand;
+        size_t num_operands;
+    };
+
+    compiled_func_t() { }
+
+    // Appends the nodes for `term` and sets `*node_out` to the index of its root, or
+    // returns `false` if it can't be compiled.
+    bool compile_term(const raw_term_t &term,
+                      const std::vector<sym_t> &arg_names,
+                      const var_scope_t &captured_scope,
+                      size_t *node_out);
+
+    datum_t eval_node(size_t node, const std::vector<datum_t> &args) const;
+
+    std::vector<node_t> nodes;
+    std::vector<size_t> operands;
+    size_t root;
+
+    DISABLE_COPYING(compiled_func_t);
+};
+
+}  // namespace ql
+
+#endif  // RDB_PROTOCOL_COMPILED_FUNC_HPP_
@@ -9,8 +9,33 @@
 #include "rpc/semilattice/watchable.hpp"
 #include "time.hpp"
 
+template <cluster_version_t W>
+void serialize(write_message_t *wm, const sindex_kind_t &kind) {
+    serialize<W>(wm, static_cast<int8_t>(kind));
+}
+
+template <cluster_version_t W>
+archive_result_t deserialize(read_stream_t *s, sindex_kind_t *kind) {
+    int8_t value;
+    archive_result_t res = deserialize<W>(s, &value);
+    if (bad(res)) {
+        return res;
+    }
+    const sindex_kind_t max_kind = W >= cluster_version_t::v2_6
+        ? sindex_kind_t::TEXT
+        : sindex_kind_t::GEO;
+    if (value < static_cast<int8_t>(sindex_kind_t::REGULAR)
+        || value > static_cast<int8_t>(max_kind)) {
+        return archive_result_t::RANGE_ERROR;
+    }
+    *kind = static_cast<sindex_kind_t>(value);
+    return archive_result_t::SUCCESS;
+}
+
+INSTANTIATE_SERIALIZABLE_SINCE_v1_13(sindex_kind_t);
+
 bool sindex_config_t::operator==(const sindex_config_t &o) const {
-    if (func_version != o.func_version || multi != o.multi || geo != o.geo) {
+    if (func_version != o.func_version || multi != o.multi || kind != o.kind) {
         return false;
     }
     /* This is kind of a hack--we compare the functions by serializing them and comparing
@@ -27,7 +52,7 @@ bool sindex_config_t::operator==(const sindex_config_t &o) const {
 }
 
 RDB_IMPL_SERIALIZABLE_4_SINCE_v2_1(sindex_config_t,
-    func, func_version, multi, geo);
+    func, func_version, multi, kind);
 
 bool write_hook_config_t::operator==(const write_hook_config_t &o) const {
     if (func_version != o.func_version) {
@@ -72,13 +97,24 @@ rdb_context_t::stats_t::stats_t(perfmon_collection_t *global_stats)
       queries_per_sec_membership(&qe_stats_collection,
                                  &queries_per_sec, "queries_per_sec"),
       queries_total_membership(&qe_stats_collection,
-                               &queries_total, "queries_total") { }
+                               &queries_total, "queries_total"),
+      query_latency(secs_to_ticks(1), false),
+      query_latency_membership(&qe_stats_collection,
+                               &query_latency, "query_latency"),
+      changefeed_queued_changes_membership(&qe_stats_collection,
+                                           &changefeed_queued_changes,
+                                           "changefeed_queued_changes"),
+      changefeed_changes_dropped_membership(&qe_stats_collection,
+                                            &changefeed_changes_dropped,
+                                            "changefeed_changes_dropped") { }
 
 rdb_context_t::rdb_context_t()
     : extproc_pool(nullptr),
       cluster_interface(nullptr),
+      query_result_cache(nullptr),
       manager(nullptr),
       reql_http_proxy(),
+      io_backender(nullptr),
       stats(&get_global_perfmon_collection()) { }
 
 rdb_context_t::rdb_context_t(
@@ -88,8 +124,10 @@ rdb_context_t::rdb_context_t(
             auth_semilattice_view)
     : extproc_pool(_extproc_pool),
       cluster_interface(_cluster_interface),
+      query_result_cache(nullptr),
       manager(nullptr),
       reql_http_proxy(),
+      io_backender(nullptr),
       stats(&get_global_perfmon_collection()) {
     init_auth_watchables(auth_semilattice_view);
 }
@@ -101,11 +139,16 @@ rdb_context_t::rdb_context_t(
         std::shared_ptr<semilattice_read_view_t<auth_semilattice_metadata_t>>
             auth_semilattice_view,
         perfmon_collection_t *global_stats,
-        const std::string &_reql_http_proxy)
+        const std::string &_reql_http_proxy,
+        io_backender_t *_io_backender,
+        const base_path_t &_base_path)
     : extproc_pool(_extproc_pool),
       cluster_interface(_cluster_interface),
+      query_result_cache(nullptr),
       manager(_mailbox_manager),
       reql_http_proxy(_reql_http_proxy),
+      io_backender(_io_backender),
+      base_path(_base_path),
       stats(global_stats) {
     init_auth_watchables(auth_semilattice_view);
 }
@@ -113,13 +156,14 @@ rdb_context_t::rdb_context_t(
 void rdb_context_t::init_auth_watchables(
     std::shared_ptr<semilattice_read_view_t<auth_semilattice_metadata_t>>
         auth_semilattice_view) {
+    m_auth_snapshot.reset(new watchable_snapshot_t<auth_semilattice_metadata_t>(
+        clone_ptr_t<semilattice_watchable_t<auth_semilattice_metadata_t>>(
+            new semilattice_watchable_t<auth_semilattice_metadata_t>(
+                auth_semilattice_view))));
     for (int thread = 0; thread < get_num_threads(); ++thread) {
         m_cross_thread_auth_watchables.emplace_back(
             new cross_thread_watchable_variable_t<auth_semilattice_metadata_t>(
-                clone_ptr_t<semilattice_watchable_t<auth_semilattice_metadata_t>>(
-                    new semilattice_watchable_t<auth_semilattice_metadata_t>(
-                        auth_semilattice_view)),
-                threadnum_t(thread)));
+                m_auth_snapshot.get(), threadnum_t(thread)));
     }
 }
 
@@ -17,6 +17,7 @@
 #include "containers/optional.hpp"
 #include "containers/scoped.hpp"
 #include "containers/uuid.hpp"
+#include "paths.hpp"
 #include "perfmon/perfmon.hpp"
 #include "protocol_api.hpp"
 #include "rdb_protocol/datum.hpp"
@@ -37,6 +38,7 @@ class configured_limits_t;
 class datumspec_t;
 class env_t;
 class query_cache_t;
+class query_result_cache_t;
 
 namespace changefeed {
 class streamspec_t;
@@ -57,25 +59,32 @@ ARCHIVE_PRIM_MAKE_RANGED_SERIALIZABLE(
 class auth_semilattice_metadata_t;
 class ellipsoid_spec_t;
 class extproc_pool_t;
+class io_backender_t;
 class name_string_t;
 class namespace_interface_t;
 template <class> class cross_thread_watchable_variable_t;
 template <class> class semilattice_read_view_t;
+template <class> class watchable_snapshot_t;
 
 enum class sindex_multi_bool_t { SINGLE = 0, MULTI = 1};
-enum class sindex_geo_bool_t { REGULAR = 0, GEO = 1};
+/* Hash and text indexes are new in v2_6, so `HASH` and `TEXT` don't deserialize for
+earlier versions. */
+enum class sindex_kind_t { REGULAR = 0, GEO = 1, HASH = 2, TEXT = 3};
 
 ARCHIVE_PRIM_MAKE_RANGED_SERIALIZABLE(sindex_multi_bool_t, int8_t,
         sindex_multi_bool_t::SINGLE, sindex_multi_bool_t::MULTI);
-ARCHIVE_PRIM_MAKE_RANGED_SERIALIZABLE(sindex_geo_bool_t, int8_t,
-        sindex_geo_bool_t::REGULAR, sindex_geo_bool_t::GEO);
+
+template <cluster_version_t W>
+void serialize(write_message_t *wm, const sindex_kind_t &kind);
+template <cluster_version_t W>
+MUST_USE archive_result_t deserialize(read_stream_t *s, sindex_kind_t *kind);
 
 class sindex_config_t {
 public:
     sindex_config_t() { }
     sindex_config_t(const ql::map_wire_func_t &_func, reql_version_t _func_version,
-            sindex_multi_bool_t _multi, sindex_geo_bool_t _geo) :
-        func(_func), func_version(_func_version), multi(_multi), geo(_geo) { }
+            sindex_multi_bool_t _multi, sindex_kind_t _kind) :
+        func(_func), func_version(_func_version), multi(_multi), kind(_kind) { }
 
     bool operator==(const sindex_config_t &o) const;
     bool operator!=(const sindex_config_t &o) const {
@@ -85,7 +94,7 @@ public:
     ql::map_wire_func_t func;
     reql_version_t func_version;
     sindex_multi_bool_t multi;
-    sindex_geo_bool_t geo;
+    sindex_kind_t kind;
 };
 RDB_DECLARE_SERIALIZABLE(sindex_config_t);
 
@@ -211,6 +220,17 @@ public:
         dist_unit_t dist_unit,
         const ql::configured_limits_t &limits) = 0;
 
+    /* Sets `*rows_out` to up to `num` rows of the table, picked at random without
+    reading the rest of the table.  Returns false if the table can't do that, in which
+    case the caller has to sample all of its rows. */
+    virtual bool read_sample(
+        ql::env_t *,
+        uint64_t,
+        read_mode_t,
+        std::vector<ql::datum_t> *) {
+        return false;
+    }
+
     virtual ql::datum_t write_batched_replace(
         ql::env_t *env,
         const std::vector<ql::datum_t> &keys,
@@ -477,17 +497,27 @@ public:
         std::shared_ptr<semilattice_read_view_t<auth_semilattice_metadata_t>>
             auth_semilattice_view,
         perfmon_collection_t *global_stats,
-        const std::string &_reql_http_proxy);
+        const std::string &_reql_http_proxy,
+        io_backender_t *_io_backender,
+        const base_path_t &_base_path);
 
     ~rdb_context_t();
 
     extproc_pool_t *extproc_pool;
     reql_cluster_interface_t *cluster_interface;
 
+    // Set by the cluster interface on servers that can cache query results.
+    ql::query_result_cache_t *query_result_cache;
+
     mailbox_manager_t *manager;
 
     const std::string reql_http_proxy;
 
+    // Used to spill large unindexed `order_by`s to disk.  `io_backender` is null if
+    // there's nowhere to write them, like on a proxy or in unit tests.
+    io_backender_t *const io_backender;
+    const base_path_t base_path;
+
     class stats_t {
     public:
         explicit stats_t(perfmon_collection_t *global_stats);
@@ -502,6 +532,16 @@ public:
         perfmon_membership_t queries_per_sec_membership;
         perfmon_counter_t queries_total;
         perfmon_membership_t queries_total_membership;
+        // How long it takes to answer a START query.  (A CONTINUE on a changefeed
+        // waits for changes, so it says nothing about how fast we are.)
+        perfmon_histogram_t query_latency;
+        perfmon_membership_t query_latency_membership;
+        // Changes waiting in changefeed subscriptions for their clients to read
+        // them, and changes thrown away because a queue overflowed.
+        perfmon_counter_t changefeed_queued_changes;
+        perfmon_membership_t changefeed_queued_changes_membership;
+        perfmon_counter_t changefeed_changes_dropped;
+        perfmon_membership_t changefeed_changes_dropped_membership;
     private:
         DISABLE_COPYING(stats_t);
     } stats;
@@ -515,6 +555,9 @@ private:
         std::shared_ptr<semilattice_read_view_t<auth_semilattice_metadata_t>>
             auth_semilattice_view);
 
+    // Shared by `m_cross_thread_auth_watchables`, so it's declared before them.
+    std::unique_ptr<watchable_snapshot_t<auth_semilattice_metadata_t>>
+        m_auth_snapshot;
     std::vector<std::unique_ptr<cross_thread_watchable_variable_t<
         auth_semilattice_metadata_t>>> m_cross_thread_auth_watchables;
 
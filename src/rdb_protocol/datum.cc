@@ -17,12 +17,15 @@
 #include "arch/runtime/coroutines.hpp"
 #include "cjson/json.hpp"
 #include "containers/archive/stl_types.hpp"
+#include "containers/archive/varint.hpp"
 #include "containers/scoped.hpp"
 #include "math.hpp"
 #include "rapidjson/prettywriter.h"
 #include "rapidjson/rapidjson.h"
 #include "rapidjson/stringbuffer.h"
 #include "rapidjson/writer.h"
+#include "rdb_protocol/datum_allocations.hpp"
+#include "rdb_protocol/datum_json.hpp"
 #include "rdb_protocol/datum_stream/array.hpp"
 #include "rdb_protocol/env.hpp"
 #include "rdb_protocol/error.hpp"
@@ -33,6 +36,7 @@
 #include "rdb_protocol/serialize_datum.hpp"
 #include "rdb_protocol/shards.hpp"
 #include "parsing/utf8.hpp"
+#include "region/hash_region.hpp"
 #include "stl_utils.hpp"
 
 namespace ql {
@@ -110,13 +114,16 @@ datum_t::data_wrapper_t::data_wrapper_t(const char *cstr) :
 
 datum_t::data_wrapper_t::data_wrapper_t(std::vector<datum_t> &&array) :
     r_array(new countable_wrapper_t<std::vector<datum_t> >(std::move(array))),
-    internal_type(internal_type_t::R_ARRAY) { }
+    internal_type(internal_type_t::R_ARRAY) {
+    count_datum_allocation(datum_allocation_t::ARRAY);
+}
 
 datum_t::data_wrapper_t::data_wrapper_t(
         std::vector<std::pair<datum_string_t, datum_t> > &&object) :
     r_object(new countable_wrapper_t<std::vector<std::pair<datum_string_t, datum_t> > >(
         std::move(object))),
     internal_type(internal_type_t::R_OBJECT) {
+    count_datum_allocation(datum_allocation_t::OBJECT);
 
 #ifndef NDEBUG
     auto key_cmp = [](const std::pair<datum_string_t, datum_t> &p1,
@@ -457,8 +464,27 @@ datum_t datum_t::utf8(datum_string_t _data) {
     return datum_t(std::move(_data));
 }
 
+// `json_term_storage_t` puts the length of short strings in front of them in the
+// buffer they were parsed from, so we can reference them where they are.
+datum_string_t json_string_to_datum_string(const rapidjson::Value &json,
+                                           const shared_buf_t *insitu_buffer,
+                                           bool is_key = false) {
+    const char *str = json.GetString();
+    const size_t size = json.GetStringLength();
+    if (insitu_buffer != nullptr
+        && str > insitu_buffer->data()
+        && str + size <= insitu_buffer->data() + insitu_buffer->size()
+        && varint_uint64_serialized_size(size) == 1
+        && static_cast<uint8_t>(str[-1]) == size) {
+        return datum_string_t(shared_buf_ref_t<char>(
+            counted_t<const shared_buf_t>(insitu_buffer),
+            str - 1 - insitu_buffer->data()));
+    }
+    return is_key ? datum_string_t::intern(size, str) : datum_string_t(size, str);
+}
+
 datum_t to_datum(const rapidjson::Value &json, const configured_limits_t &limits,
-                 reql_version_t reql_version) {
+                 reql_version_t reql_version, const shared_buf_t *insitu_buffer) {
     switch(json.GetType()) {
     case rapidjson::kNullType: {
         return datum_t::null();
@@ -477,9 +503,10 @@ datum_t to_datum(const rapidjson::Value &json, const configured_limits_t &limits
                  ++it) {
                 fail_if_invalid(it->name.GetString(),
                                 it->name.GetStringLength());
-                datum_string_t key(it->name.GetStringLength(),
-                                   it->name.GetString());
-                bool dup = builder.add(key, to_datum(it->value, limits, reql_version));
+                datum_string_t key =
+                    json_string_to_datum_string(it->name, insitu_buffer, true);
+                bool dup = builder.add(key, to_datum(it->value, limits, reql_version,
+                                                     insitu_buffer));
                 rcheck_datum(!dup, base_exc_t::LOGIC,
                              strprintf("Duplicate key %s in JSON.",
                                        datum_t(key).print().c_str()));
@@ -495,14 +522,14 @@ datum_t to_datum(const rapidjson::Value &json, const configured_limits_t &limits
             for (rapidjson::Value::ConstValueIterator it = json.Begin();
                  it != json.End();
                  ++it) {
-                builder.add(to_datum(*it, limits, reql_version));
+                builder.add(to_datum(*it, limits, reql_version, insitu_buffer));
             }
             return std::move(builder).to_datum();
         }, MIN_DATUM_RECURSION_STACK_SPACE);
     } break;
     case rapidjson::kStringType: {
         fail_if_invalid(json.GetString(), json.GetStringLength());
-        return datum_t(datum_string_t(json.GetStringLength(), json.GetString()));
+        return datum_t(json_string_to_datum_string(json, insitu_buffer));
     } break;
     case rapidjson::kNumberType: {
         return datum_t(json.GetDouble());
@@ -617,22 +644,14 @@ void datum_t::pt_to_str_key(std::string *str_out) const {
     }
 }
 
-void datum_t::num_to_str_key(std::string *str_out) const {
-    r_sanity_check(get_type() == R_NUM);
-    str_out->append("N");
+// Mangles the value so that lexicographic ordering matches double ordering.  Negative
+// zero has to be turned into 0 first.
+uint64_t mangle_double_for_key(double value) {
     union {
         double d;
         uint64_t u;
     } packed;
     guarantee(sizeof(packed.d) == sizeof(packed.u));
-
-    // Sort negative zero as equivalent to 0
-    double value = as_num();
-    if (value == -0.0) {
-        value = std::abs(value);
-    }
-
-    // Mangle the value so that lexicographic ordering matches double ordering
     packed.d = value;
     if (packed.u & (1ULL << 63)) {
         // If we have a negative double, flip all the bits.  Flipping the
@@ -647,11 +666,83 @@ void datum_t::num_to_str_key(std::string *str_out) const {
         // highest bit flipped as well).
         packed.u ^= (1ULL << 63);
     }
+    return packed.u;
+}
+
+void datum_t::num_to_str_key(std::string *str_out) const {
+    r_sanity_check(get_type() == R_NUM);
+    str_out->append("N");
+
+    // Sort negative zero as equivalent to 0
+    double value = as_num();
+    if (value == -0.0) {
+        value = std::abs(value);
+    }
+
+    const uint64_t mangled = mangle_double_for_key(value);
     // The formatting here is sensitive.  Talk to mlucy before changing it.
-    str_out->append(strprintf("%.*" PRIx64, static_cast<int>(sizeof(double)*2), packed.u));
+    str_out->append(strprintf("%.*" PRIx64, static_cast<int>(sizeof(double)*2), mangled));
     str_out->append(strprintf("#%" PR_RECONSTRUCTABLE_DOUBLE, value));
 }
 
+bool datum_t::append_sort_key(std::string *out) const {
+    // Datums of different types sort in the order of their `type_t`.
+    switch (get_type()) {
+    case R_NULL:
+        out->push_back(static_cast<char>(R_NULL));
+        return true;
+    case R_BOOL:
+        out->push_back(static_cast<char>(R_BOOL));
+        out->push_back(as_bool() ? 1 : 0);
+        return true;
+    case R_NUM: {
+        out->push_back(static_cast<char>(R_NUM));
+        double value = as_num();
+        if (value == -0.0) {
+            value = std::abs(value);
+        }
+        const uint64_t mangled = mangle_double_for_key(value);
+        for (int shift = 56; shift >= 0; shift -= 8) {
+            out->push_back(static_cast<char>(mangled >> shift));
+        }
+        return true;
+    }
+    case R_STR: {
+        out->push_back(static_cast<char>(R_STR));
+        // The same escaping as for strings in arrays in `str_to_str_key`, so that the
+        // terminating \x00 sorts below anything that can follow it.
+        const datum_string_t &str = as_str();
+        const char *data = str.data();
+        const size_t size = str.size();
+        out->reserve(out->size() + size + 1);
+        for (size_t i = 0; i < size; ++i) {
+            switch (data[i]) {
+            case '\x00':
+                out->append("\x01\x01", 2);
+                break;
+            case '\x01':
+                out->append("\x01\x02", 2);
+                break;
+            default:
+                out->push_back(data[i]);
+            }
+        }
+        out->push_back('\x00');
+        return true;
+    }
+    case MINVAL: // fallthru
+    case MAXVAL: // fallthru
+    case R_ARRAY: // fallthru
+    case R_BINARY: // fallthru
+    case R_OBJECT:
+        // Pseudo-types sort by their type names, and arrays and objects would need
+        // their elements' keys to be nested; none of that is worth doing here.
+        return false;
+    case UNINITIALIZED: // fallthru
+    default: unreachable();
+    }
+}
+
 void datum_t::binary_to_str_key(std::string *str_out) const {
     // We need to prepend "P" and append a character less than [a-zA-Z] so that
     // different pseudotypes sort correctly.
@@ -1152,27 +1243,20 @@ std::string datum_t::compose_secondary(
         skey_version, truncated_secondary_key, primary_key_string, tag_string);
 }
 
-std::string datum_t::print_secondary(reql_version_t reql_version,
-                                     const store_key_t &primary_key,
-                                     optional<uint64_t> tag_num) const {
-    std::string secondary_key_string;
-
-    // Reserve max key size to reduce reallocations
-    secondary_key_string.reserve(MAX_KEY_SIZE);
-
+void datum_t::append_secondary_key(reql_version_t reql_version,
+                                   std::string *out) const {
     escape_nulls_t escape_nulls = escape_nulls_from_reql_version_for_sindex(reql_version);
-    skey_version_t skey_version = skey_version_from_reql_version(reql_version);
     extrema_encoding_t extrema_encoding =
         extrema_encoding_from_reql_version_for_sindex(reql_version);
 
     if (get_type() == R_NUM) {
-        num_to_str_key(&secondary_key_string);
+        num_to_str_key(out);
     } else if (get_type() == R_STR) {
-        str_to_str_key(escape_nulls, &secondary_key_string);
+        str_to_str_key(escape_nulls, out);
     } else if (get_type() == R_BINARY) {
-        binary_to_str_key(&secondary_key_string);
+        binary_to_str_key(out);
     } else if (get_type() == R_BOOL) {
-        bool_to_str_key(&secondary_key_string);
+        bool_to_str_key(out);
     } else if (get_type() == R_ARRAY) {
         // Before version 2.3, `minval` and `maxval` were always allowed inside of
         // an array. Now they are no longer allowed in this context.
@@ -1182,15 +1266,28 @@ std::string datum_t::print_secondary(reql_version_t reql_version,
             ? extrema_ok_t::OK
             : extrema_ok_t::NOT_OK,
             escape_nulls,
-            &secondary_key_string);
+            out);
     } else if (get_type() == R_OBJECT && is_ptype()) {
-        pt_to_str_key(&secondary_key_string);
+        pt_to_str_key(out);
     } else {
         type_error(strprintf(
             "Secondary keys must be a number, string, bool, pseudotype, "
             "or array (got type %s):\n%s",
             get_type_name().c_str(), trunc_print().c_str()));
     }
+}
+
+std::string datum_t::print_secondary(reql_version_t reql_version,
+                                     const store_key_t &primary_key,
+                                     optional<uint64_t> tag_num) const {
+    std::string secondary_key_string;
+
+    // Reserve max key size to reduce reallocations
+    secondary_key_string.reserve(MAX_KEY_SIZE);
+
+    skey_version_t skey_version = skey_version_from_reql_version(reql_version);
+
+    append_secondary_key(reql_version, &secondary_key_string);
 
     switch (skey_version) {
     case skey_version_t::post_1_16:
@@ -1202,6 +1299,28 @@ std::string datum_t::print_secondary(reql_version_t reql_version,
     return compose_secondary(skey_version, secondary_key_string, primary_key, tag_num);
 }
 
+store_key_t datum_t::hashed_secondary(reql_version_t reql_version) const {
+    std::string s;
+    append_secondary_key(reql_version, &s);
+    guarantee(skey_version_from_reql_version(reql_version) == skey_version_t::post_1_16);
+    // The `hash_region_hasher` is fixed for good, because it decides which shard a
+    // key goes to, so the keys on disk will stay valid.
+    uint64_t hash =
+        hash_region_hasher(reinterpret_cast<const uint8_t *>(s.data()), s.size());
+    std::string hashed = strprintf("%016" PRIx64, hash);
+    hashed.push_back('\0');
+    return store_key_t(hashed);
+}
+
+std::string datum_t::print_hashed_secondary(reql_version_t reql_version,
+                                            const store_key_t &primary_key,
+                                            optional<uint64_t> tag_num) const {
+    return compose_secondary(skey_version_from_reql_version(reql_version),
+                             key_to_unescaped_str(hashed_secondary(reql_version)),
+                             primary_key,
+                             tag_num);
+}
+
 skey_version_t skey_version_from_reql_version(reql_version_t) {
     // We only have one value at the moment, since we've dropped support for pre-1.16
     // indexes.
@@ -1488,23 +1607,48 @@ std::pair<datum_string_t, datum_t> datum_t::unchecked_get_pair(size_t index) con
 }
 
 datum_t datum_t::get_field(const datum_string_t &key, throw_bool_t throw_bool) const {
-    // Use binary search on top of unchecked_get_pair()
-    size_t range_beg = 0;
-    // The obj_size() also makes sure that this has the right type (R_OBJECT)
-    size_t range_end = obj_size();
-    while (range_beg < range_end) {
-        const size_t center = range_beg + ((range_end - range_beg) / 2);
-        auto center_pair = unchecked_get_pair(center);
-        const int cmp_res = key.compare(center_pair.first);
-        if (cmp_res == 0) {
-            // Found it
-            return center_pair.second;
-        } else if (cmp_res < 0) {
-            range_end = center;
-        } else {
-            range_beg = center + 1;
+    if (data.get_internal_type() == internal_type_t::BUF_R_OBJECT) {
+        // Binary search on the serialized keys, so that we only decode the header
+        // once and don't deserialize any values besides the one we're looking for.
+        datum_buf_elements_t elements(&data.buf_ref, 0);
+        size_t range_beg = 0;
+        size_t range_end = elements.size();
+        while (range_beg < range_end) {
+            const size_t center = range_beg + ((range_end - range_beg) / 2);
+            const char *center_key;
+            size_t center_key_size;
+            const size_t value_offset = datum_peek_pair_key_from_buf(
+                data.buf_ref, elements.offset(center), &center_key, &center_key_size);
+            const int cmp_res = key.compare(center_key_size, center_key);
+            if (cmp_res == 0) {
+                // Found it
+                return datum_deserialize_from_buf(data.buf_ref, value_offset);
+            } else if (cmp_res < 0) {
+                range_end = center;
+            } else {
+                range_beg = center + 1;
+            }
+            rassert(range_beg <= range_end);
+        }
+    } else {
+        // Use binary search on top of unchecked_get_pair()
+        size_t range_beg = 0;
+        // The obj_size() also makes sure that this has the right type (R_OBJECT)
+        size_t range_end = obj_size();
+        while (range_beg < range_end) {
+            const size_t center = range_beg + ((range_end - range_beg) / 2);
+            auto center_pair = unchecked_get_pair(center);
+            const int cmp_res = key.compare(center_pair.first);
+            if (cmp_res == 0) {
+                // Found it
+                return center_pair.second;
+            } else if (cmp_res < 0) {
+                range_end = center;
+            } else {
+                range_beg = center + 1;
+            }
+            rassert(range_beg <= range_end);
         }
-        rassert(range_beg <= range_end);
     }
 
     // Didn't find it
@@ -1519,6 +1663,77 @@ datum_t datum_t::get_field(const char *key, throw_bool_t throw_bool) const {
     return get_field(datum_string_t(key), throw_bool);
 }
 
+template <class json_writer_t>
+void write_json_number(double d, json_writer_t *writer) {
+    // Always print -0.0 as a double since integers cannot represent -0.
+    // Otherwise check if the number is an integer and print it as such.
+    int64_t i;
+    if (!(d == 0.0 && std::signbit(d))
+        && number_as_integer(d, &i)) {
+        writer->Int64(i);
+    } else {
+        writer->Double(d);
+    }
+}
+
+template <class json_writer_t>
+void write_json_from_buf(const shared_buf_ref_t<char> &buf, size_t at_offset,
+                         json_writer_t *writer);
+
+/* Writes the array or object whose header starts at `at_offset` straight from the
+serialized buffer, so that the elements of a document we just read from disk or
+received from another server don't each have to be turned into a `datum_t` first. */
+template <class json_writer_t>
+void write_json_elements_from_buf(const shared_buf_ref_t<char> &buf, size_t at_offset,
+                                  bool is_object, json_writer_t *writer) {
+    datum_buf_elements_t elements(&buf, at_offset);
+    if (is_object) {
+        writer->StartObject();
+    } else {
+        writer->StartArray();
+    }
+    const size_t sz = elements.size();
+    for (size_t i = 0; i < sz; ++i) {
+        size_t value_offset = elements.offset(i);
+        if (is_object) {
+            const char *key;
+            size_t key_size;
+            value_offset = datum_peek_pair_key_from_buf(buf, value_offset,
+                                                        &key, &key_size);
+            writer->Key(key, key_size);
+        }
+        write_json_from_buf(buf, value_offset, writer);
+    }
+    if (is_object) {
+        writer->EndObject();
+    } else {
+        writer->EndArray();
+    }
+}
+
+template <class json_writer_t>
+void write_json_from_buf(const shared_buf_ref_t<char> &buf, size_t at_offset,
+                         json_writer_t *writer) {
+    const datum_buf_peek_t peek = datum_peek_from_buf(buf, at_offset);
+    switch (peek.kind) {
+    case datum_buf_peek_t::kind_t::R_NULL: writer->Null(); break;
+    case datum_buf_peek_t::kind_t::R_BOOL: writer->Bool(peek.boolean); break;
+    case datum_buf_peek_t::kind_t::R_NUM: write_json_number(peek.num, writer); break;
+    case datum_buf_peek_t::kind_t::R_STR: writer->String(peek.str, peek.str_size); break;
+    case datum_buf_peek_t::kind_t::BUF_R_ARRAY: // fallthru
+    case datum_buf_peek_t::kind_t::BUF_R_OBJECT: {
+        const bool is_object = peek.kind == datum_buf_peek_t::kind_t::BUF_R_OBJECT;
+        call_with_enough_stack([&] {
+                write_json_elements_from_buf(buf, peek.child_offset, is_object, writer);
+            }, MIN_DATUM_RECURSION_STACK_SPACE);
+    } break;
+    case datum_buf_peek_t::kind_t::OTHER:
+        datum_deserialize_from_buf(buf, at_offset).write_json(writer);
+        break;
+    default: unreachable();
+    }
+}
+
 template <class json_writer_t>
 void write_json_unchecked_stack(const datum_t &datum, json_writer_t *writer) {
     switch (datum.get_type()) {
@@ -1527,20 +1742,13 @@ void write_json_unchecked_stack(const datum_t &datum, json_writer_t *writer) {
     case datum_t::R_NULL: writer->Null(); break;
     case datum_t::R_BINARY: pseudo::encode_base64_ptype(datum.as_binary(), writer); break;
     case datum_t::R_BOOL: writer->Bool(datum.as_bool()); break;
-    case datum_t::R_NUM: {
-        const double d = datum.as_num();
-        // Always print -0.0 as a double since integers cannot represent -0.
-        // Otherwise check if the number is an integer and print it as such.
-        int64_t i;
-        if (!(d == 0.0 && std::signbit(d))
-            && number_as_integer(d, &i)) {
-            writer->Int64(i);
-        } else {
-            writer->Double(d);
-        }
-    } break;
+    case datum_t::R_NUM: write_json_number(datum.as_num(), writer); break;
     case datum_t::R_STR: writer->String(datum.as_str().data(), datum.as_str().size()); break;
     case datum_t::R_ARRAY: {
+        if (const shared_buf_ref_t<char> *buf_ref = datum.get_buf_ref()) {
+            write_json_elements_from_buf(*buf_ref, 0, false, writer);
+            break;
+        }
         writer->StartArray();
         const size_t sz = datum.arr_size();
         for (size_t i = 0; i < sz; ++i) {
@@ -1549,6 +1757,10 @@ void write_json_unchecked_stack(const datum_t &datum, json_writer_t *writer) {
         writer->EndArray();
     } break;
     case datum_t::R_OBJECT: {
+        if (const shared_buf_ref_t<char> *buf_ref = datum.get_buf_ref()) {
+            write_json_elements_from_buf(*buf_ref, 0, true, writer);
+            break;
+        }
         writer->StartObject();
         const size_t sz = datum.obj_size();
         for (size_t i = 0; i < sz; ++i) {
@@ -1655,42 +1867,78 @@ void datum_t::replace_field(const datum_string_t &key, datum_t val) {
     it->second = val;
 }
 
+/* Merges two objects by walking their sorted fields together, which only copies the
+references to their values.  `merge_field(key, lhs_val, rhs_val)` gives the value of a
+field that's in `rhs`, where `lhs_val` is empty if the field isn't in `lhs`, and it
+returns an empty datum to leave the field out.  Fields that are only in `lhs` are kept
+as they are, so their values are shared with `lhs`, and never decoded if `lhs` is
+still serialized. */
+template <class merge_field_t>
+static datum_t merge_sorted_objects(const datum_t &lhs,
+                                    const datum_t &rhs,
+                                    const merge_field_t &merge_field) {
+    const size_t sz = lhs.obj_size();
+    const size_t rhs_sz = rhs.obj_size();
+    std::vector<std::pair<datum_string_t, datum_t> > fields;
+    fields.reserve(sz + rhs_sz);
+    size_t i = 0;
+    for (size_t j = 0; j < rhs_sz; ++j) {
+        auto rhs_pair = rhs.get_pair(j);
+        datum_t lhs_val;
+        for (; i < sz; ++i) {
+            auto lhs_pair = lhs.get_pair(i);
+            if (!(lhs_pair.first < rhs_pair.first)) {
+                if (lhs_pair.first == rhs_pair.first) {
+                    lhs_val = std::move(lhs_pair.second);
+                    ++i;
+                }
+                break;
+            }
+            fields.push_back(std::move(lhs_pair));
+        }
+        datum_t val = merge_field(rhs_pair.first, lhs_val, rhs_pair.second);
+        if (val.has()) {
+            fields.push_back(std::make_pair(std::move(rhs_pair.first), std::move(val)));
+        }
+    }
+    for (; i < sz; ++i) {
+        fields.push_back(lhs.get_pair(i));
+    }
+    return datum_t(std::move(fields));
+}
+
 datum_t datum_t::default_merge_unchecked_stack(const datum_t &rhs) const {
     if (get_type() != R_OBJECT || rhs.get_type() != R_OBJECT) {
         bool encountered_literal;
         return rhs.drop_literals(&encountered_literal);
     }
+    if (rhs.obj_size() == 0) {
+        return *this;
+    }
 
-    datum_object_builder_t d(*this);
-    const size_t rhs_sz = rhs.obj_size();
-    for (size_t i = 0; i < rhs_sz; ++i) {
-        auto pair = rhs.unchecked_get_pair(i);
-        datum_t sub_lhs = d.try_get(pair.first);
-        bool is_literal = pair.second.is_ptype(pseudo::literal_string);
+    return merge_sorted_objects(*this, rhs,
+        [](const datum_string_t &, const datum_t &sub_lhs, const datum_t &sub_rhs) {
+            bool is_literal = sub_rhs.is_ptype(pseudo::literal_string);
 
-        if (pair.second.get_type() == R_OBJECT && sub_lhs.has() && !is_literal) {
-            d.overwrite(pair.first, sub_lhs.merge(pair.second));
-        } else {
+            if (sub_rhs.get_type() == R_OBJECT && sub_lhs.has() && !is_literal) {
+                return sub_lhs.merge(sub_rhs);
+            }
             datum_t val =
                 is_literal
-                ? pair.second.get_field(pseudo::value_key, NOTHROW)
-                : pair.second;
+                ? sub_rhs.get_field(pseudo::value_key, NOTHROW)
+                : sub_rhs;
             if (val.has()) {
                 // Since nested literal keywords are forbidden, this should be a no-op
                 // if `is_literal == true`.
                 bool encountered_literal;
                 val = val.drop_literals(&encountered_literal);
                 r_sanity_check(!encountered_literal || !is_literal);
-            }
-            if (val.has()) {
-                d.overwrite(pair.first, val);
             } else {
+                // The literal deletes the field.
                 r_sanity_check(is_literal);
-                UNUSED bool b = d.delete_field(pair.first);
             }
-        }
-    }
-    return std::move(d).to_datum();
+            return val;
+        });
 }
 
 datum_t datum_t::merge(const datum_t &rhs) const {
@@ -1703,19 +1951,10 @@ datum_t datum_t::custom_merge_unchecked_stack(const datum_t &rhs,
                        merge_resoluter_t f,
                        const configured_limits_t &limits,
                        std::set<std::string> *conditions_out) const {
-    datum_object_builder_t d(*this);
-    const size_t rhs_sz = rhs.obj_size();
-    for (size_t i = 0; i < rhs_sz; ++i) {
-        auto pair = rhs.unchecked_get_pair(i);
-        datum_t left = get_field(pair.first, NOTHROW);
-        if (left.has()) {
-            d.overwrite(pair.first, f(pair.first, left, pair.second, limits, conditions_out));
-        } else {
-            bool b = d.add(pair.first, pair.second);
-            r_sanity_check(!b);
-        }
-    }
-    return std::move(d).to_datum();
+    return merge_sorted_objects(*this, rhs,
+        [&](const datum_string_t &key, const datum_t &left, const datum_t &right) {
+            return left.has() ? f(key, left, right, limits, conditions_out) : right;
+        });
 }
 
 datum_t datum_t::merge(const datum_t &rhs,
@@ -1804,6 +2043,73 @@ int datum_t::cmp(const datum_t &rhs) const {
         });
 }
 
+static uint64_t hash_bytes(const datum_string_t &str) {
+    return hash_region_hasher(reinterpret_cast<const uint8_t *>(str.data()), str.size());
+}
+
+static uint64_t hash_num(double d) {
+    // 0.0 and -0.0 compare equal, so they need the same hash.
+    if (d == 0.0) {
+        d = 0.0;
+    }
+    uint64_t bits;
+    static_assert(sizeof(bits) == sizeof(d), "double isn't 64 bits");
+    memcpy(&bits, &d, sizeof(d));
+    return bits;
+}
+
+static uint64_t hash_combine(uint64_t h, uint64_t v) {
+    return h ^ (v + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2));
+}
+
+uint64_t datum_t::hash_unchecked_stack() const {
+    // This follows `cmp_unchecked_stack`.
+    if (is_ptype() && !pseudo_compares_as_obj()) {
+        if (get_type() == R_BINARY) {
+            return hash_combine(R_BINARY, hash_bytes(as_binary()));
+        } else if (get_reql_type() == pseudo::time_string) {
+            return hash_combine(R_OBJECT, hash_num(pseudo::time_to_epoch_time(*this)));
+        }
+        // Other pseudotypes can't be compared to each other, so they all get the
+        // same hash.
+        return hash_combine(R_OBJECT, 0);
+    }
+    uint64_t h = get_type();
+    switch (get_type()) {
+    case R_NULL: // fallthru
+    case MINVAL: // fallthru
+    case MAXVAL: return h;
+    case R_BOOL: return hash_combine(h, as_bool());
+    case R_NUM: return hash_combine(h, hash_num(as_num()));
+    case R_STR: return hash_combine(h, hash_bytes(as_str()));
+    case R_ARRAY: {
+        const size_t sz = arr_size();
+        for (size_t i = 0; i < sz; ++i) {
+            h = hash_combine(h, unchecked_get(i).hash());
+        }
+        return h;
+    } unreachable();
+    case R_OBJECT: {
+        const size_t sz = obj_size();
+        for (size_t i = 0; i < sz; ++i) {
+            auto pair = unchecked_get_pair(i);
+            h = hash_combine(h, hash_bytes(pair.first));
+            h = hash_combine(h, pair.second.hash());
+        }
+        return h;
+    } unreachable();
+    case R_BINARY: // This should be handled by the ptype code above
+    case UNINITIALIZED: // fallthru
+    default: unreachable();
+    }
+}
+
+uint64_t datum_t::hash() const {
+    return call_with_enough_stack_datum<uint64_t>([&] {
+            return this->hash_unchecked_stack();
+        });
+}
+
 bool datum_t::operator==(const datum_t &rhs) const { return cmp(rhs) == 0; }
 bool datum_t::operator!=(const datum_t &rhs) const { return cmp(rhs) != 0; }
 bool datum_t::operator<(const datum_t &rhs) const { return cmp(rhs) < 0; }
@@ -2023,7 +2329,7 @@ bool datum_object_builder_t::add(const datum_string_t &key, datum_t val) {
 }
 
 bool datum_object_builder_t::add(const char *key, datum_t val) {
-    return add(datum_string_t(key), val);
+    return add(datum_string_t::intern(strlen(key), key), val);
 }
 
 void datum_object_builder_t::overwrite(const datum_string_t &key,
@@ -2034,7 +2340,7 @@ void datum_object_builder_t::overwrite(const datum_string_t &key,
 
 void datum_object_builder_t::overwrite(const char *key,
                                        datum_t val) {
-    return overwrite(datum_string_t(key), val);
+    return overwrite(datum_string_t::intern(strlen(key), key), val);
 }
 
 void datum_object_builder_t::add_warning(const char *msg, const configured_limits_t &limits) {
@@ -228,6 +228,12 @@ public:
     std::string trunc_print() const;
     std::string print_primary() const;
     std::string print_primary_internal() const;
+    /* Appends a key to `out` that sorts with `memcmp` the way `cmp` sorts the datum, and
+    that no other key is a prefix of, so keys can be concatenated.  Numbers are mangled
+    and strings escaped like in secondary index keys, but nothing is truncated.  Only
+    null, booleans, numbers and strings have such keys; for other types this returns
+    `false` and appends nothing. */
+    MUST_USE bool append_sort_key(std::string *out) const;
     /* TODO: All of this key-mangling logic belongs elsewhere. Maybe
     `print_primary()` belongs there as well. */
     static std::string compose_secondary(skey_version_t skey_version,
@@ -244,6 +250,15 @@ public:
     std::string print_secondary(reql_version_t reql_version,
                                 const store_key_t &primary_key,
                                 optional<uint64_t> tag_num) const;
+    /* Hash indexes store a fixed-width hash of the secondary key instead of the key
+    itself, so their keys are short and never truncated, but they can only be used for
+    equality lookups, and every match has to be checked against the index value.
+    `hashed_secondary()` is the secondary part of such a key, and
+    `print_hashed_secondary()` the whole key, like `print_secondary()`. */
+    store_key_t hashed_secondary(reql_version_t reql_version) const;
+    std::string print_hashed_secondary(reql_version_t reql_version,
+                                       const store_key_t &primary_key,
+                                       optional<uint64_t> tag_num) const;
     /* An inverse to print_secondary. Returns the primary key. */
     static std::string extract_primary(const std::string &secondary_and_primary);
     static store_key_t extract_primary(const store_key_t &secondary_key);
@@ -312,6 +327,8 @@ public:
     // same type should compare appropriately, while disparate types are compared
     // alphabetically by type name.
     int cmp(const datum_t &rhs) const;
+    // Data that `cmp` says are equal have the same hash.
+    uint64_t hash() const;
 
     // operator== and operator!= don't take a reql_version_t, unlike other comparison
     // functions, because we know (by inspection) that the behavior of cmp() hasn't
@@ -386,12 +403,15 @@ private:
         escape_nulls_t escape_nulls,
         std::string *str_out) const;
     void binary_to_str_key(std::string *str_out) const;
+    // The untruncated secondary key, without the terminating null byte.
+    void append_secondary_key(reql_version_t reql_version, std::string *out) const;
     void extrema_to_str_key(
         extrema_encoding_t extrema_encoding,
         extrema_ok_t extrema_ok,
         std::string *str_out) const;
 
     int cmp_unchecked_stack(const datum_t &rhs) const;
+    uint64_t hash_unchecked_stack() const;
 
     int pseudo_cmp(const datum_t &rhs) const;
     bool pseudo_compares_as_obj() const;
@@ -0,0 +1,51 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#include "rdb_protocol/datum_allocations.hpp"
+
+#include <vector>
+
+#include "arch/compiler.hpp"
+#include "arch/runtime/runtime.hpp"
+#include "concurrency/pmap.hpp"
+
+static THREAD_LOCAL datum_allocation_counts_t thread_datum_allocation_counts;
+
+// These access the thread local counts directly, so they must not be inlined into a
+// function that might switch threads.  See the comment in `thread_local.hpp`.
+NOINLINE void count_datum_allocation(datum_allocation_t allocation) {
+    switch (allocation) {
+    case datum_allocation_t::INLINE_STRING:
+        ++thread_datum_allocation_counts.inline_strings; break;
+    case datum_allocation_t::HEAP_STRING:
+        ++thread_datum_allocation_counts.heap_strings; break;
+    case datum_allocation_t::INTERNED_STRING:
+        ++thread_datum_allocation_counts.interned_strings; break;
+    case datum_allocation_t::ARRAY:
+        ++thread_datum_allocation_counts.arrays; break;
+    case datum_allocation_t::OBJECT:
+        ++thread_datum_allocation_counts.objects; break;
+    default:
+        unreachable();
+    }
+}
+
+static NOINLINE datum_allocation_counts_t get_thread_datum_allocation_counts() {
+    return thread_datum_allocation_counts;
+}
+
+datum_allocation_counts_t get_datum_allocation_counts() {
+    std::vector<datum_allocation_counts_t> per_thread(get_num_threads());
+    pmap(get_num_threads(), [&](int i) {
+        on_thread_t thread_switcher((threadnum_t(i)));
+        per_thread[i] = get_thread_datum_allocation_counts();
+    });
+
+    datum_allocation_counts_t res = datum_allocation_counts_t();
+    for (const datum_allocation_counts_t &counts : per_thread) {
+        res.inline_strings += counts.inline_strings;
+        res.heap_strings += counts.heap_strings;
+        res.interned_strings += counts.interned_strings;
+        res.arrays += counts.arrays;
+        res.objects += counts.objects;
+    }
+    return res;
+}
@@ -0,0 +1,36 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#ifndef RDB_PROTOCOL_DATUM_ALLOCATIONS_HPP_
+#define RDB_PROTOCOL_DATUM_ALLOCATIONS_HPP_
+
+#include <stdint.h>
+
+/* Counts how many strings, arrays and objects `datum_t`s create on each thread, and
+for strings whether they fit into the `datum_string_t` or had to go to the heap.  The
+sums over all threads show up in the `rethinkdb._debug_profile` table, so one can see
+how much allocation a workload causes. */
+
+enum class datum_allocation_t {
+    INLINE_STRING,
+    HEAP_STRING,
+    // A field name that was found in the intern cache instead of being allocated.
+    INTERNED_STRING,
+    ARRAY,
+    OBJECT
+};
+
+// A POD, so that it can be thread local.  Value-initialize it to zero it.
+struct datum_allocation_counts_t {
+    uint64_t inline_strings;
+    uint64_t heap_strings;
+    uint64_t interned_strings;
+    uint64_t arrays;
+    uint64_t objects;
+};
+
+void count_datum_allocation(datum_allocation_t allocation);
+
+/* Sums up the counts of all threads since the server started.  Must be called in a
+coroutine. */
+datum_allocation_counts_t get_datum_allocation_counts();
+
+#endif  // RDB_PROTOCOL_DATUM_ALLOCATIONS_HPP_
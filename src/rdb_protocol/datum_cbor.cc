@@ -0,0 +1,158 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#include "rdb_protocol/datum_cbor.hpp"
+
+#include <string.h>
+
+#include <cmath>
+
+#include "arch/runtime/coroutines.hpp"
+#include "rdb_protocol/error.hpp"
+#include "rdb_protocol/pseudo_time.hpp"
+
+namespace ql {
+
+// The same as the one in `datum.cc`.
+const size_t MIN_CBOR_RECURSION_STACK_SPACE = 16 * KILOBYTE;
+
+const uint8_t CBOR_FALSE = 20;
+const uint8_t CBOR_TRUE = 21;
+const uint8_t CBOR_NULL = 22;
+const uint8_t CBOR_FLOAT32 = 26;
+const uint8_t CBOR_FLOAT64 = 27;
+
+const uint64_t CBOR_TAG_DATE_TIME_STRING = 0;
+const uint64_t CBOR_TAG_EPOCH_TIME = 1;
+
+void write_cbor_byte(uint8_t byte, std::string *out) {
+    out->push_back(static_cast<char>(byte));
+}
+
+void write_cbor_big_endian(uint64_t value, size_t num_bytes, std::string *out) {
+    char bytes[sizeof(value)];
+    for (size_t i = 0; i < num_bytes; ++i) {
+        bytes[i] = static_cast<char>(value >> (8 * (num_bytes - 1 - i)));
+    }
+    out->append(bytes, num_bytes);
+}
+
+void write_cbor_head(cbor_major_type_t major_type, uint64_t argument, std::string *out) {
+    const uint8_t major = static_cast<uint8_t>(major_type) << 5;
+    if (argument < 24) {
+        write_cbor_byte(major | static_cast<uint8_t>(argument), out);
+    } else if (argument <= UINT8_MAX) {
+        write_cbor_byte(major | 24, out);
+        write_cbor_big_endian(argument, 1, out);
+    } else if (argument <= UINT16_MAX) {
+        write_cbor_byte(major | 25, out);
+        write_cbor_big_endian(argument, 2, out);
+    } else if (argument <= UINT32_MAX) {
+        write_cbor_byte(major | 26, out);
+        write_cbor_big_endian(argument, 4, out);
+    } else {
+        write_cbor_byte(major | 27, out);
+        write_cbor_big_endian(argument, 8, out);
+    }
+}
+
+void write_cbor_int(int64_t i, std::string *out) {
+    if (i >= 0) {
+        write_cbor_head(cbor_major_type_t::UNSIGNED_INT, static_cast<uint64_t>(i), out);
+    } else {
+        // CBOR stores -1 - i, which can't overflow for negative values.
+        write_cbor_head(cbor_major_type_t::NEGATIVE_INT,
+                        static_cast<uint64_t>(-(i + 1)), out);
+    }
+}
+
+void write_cbor_text(const char *data, size_t size, std::string *out) {
+    write_cbor_head(cbor_major_type_t::TEXT_STRING, size, out);
+    out->append(data, size);
+}
+
+void write_cbor_simple(uint8_t value, std::string *out) {
+    write_cbor_byte((static_cast<uint8_t>(cbor_major_type_t::SIMPLE) << 5) | value, out);
+}
+
+void write_cbor_number(double d, std::string *out) {
+    // As in the JSON encoding, -0.0 has to stay a float.
+    int64_t i;
+    if (!(d == 0.0 && std::signbit(d)) && number_as_integer(d, &i)) {
+        write_cbor_int(i, out);
+        return;
+    }
+    const float f = static_cast<float>(d);
+    if (static_cast<double>(f) == d) {
+        uint32_t bits;
+        memcpy(&bits, &f, sizeof(bits));
+        write_cbor_simple(CBOR_FLOAT32, out);
+        write_cbor_big_endian(bits, sizeof(bits), out);
+    } else {
+        uint64_t bits;
+        memcpy(&bits, &d, sizeof(bits));
+        write_cbor_simple(CBOR_FLOAT64, out);
+        write_cbor_big_endian(bits, sizeof(bits), out);
+    }
+}
+
+void write_cbor_time(const datum_t &time, std::string *out) {
+    const datum_t tz = time.get_field("timezone", NOTHROW);
+    if (!tz.has() || (tz.get_type() == datum_t::R_STR && tz.as_str() == "+00:00")) {
+        write_cbor_head(cbor_major_type_t::TAG, CBOR_TAG_EPOCH_TIME, out);
+        write_cbor_number(pseudo::time_to_epoch_time(time), out);
+    } else {
+        const std::string iso8601 =
+            pseudo::time_to_iso8601(reql_version_t::LATEST, time);
+        write_cbor_head(cbor_major_type_t::TAG, CBOR_TAG_DATE_TIME_STRING, out);
+        write_cbor_text(iso8601.data(), iso8601.size(), out);
+    }
+}
+
+void write_datum_cbor_unchecked_stack(const datum_t &datum, std::string *out) {
+    switch (datum.get_type()) {
+    case datum_t::MINVAL: rfail_datum(base_exc_t::LOGIC, "Cannot convert `r.minval` to CBOR.");
+    case datum_t::MAXVAL: rfail_datum(base_exc_t::LOGIC, "Cannot convert `r.maxval` to CBOR.");
+    case datum_t::R_NULL: write_cbor_simple(CBOR_NULL, out); break;
+    case datum_t::R_BOOL:
+        write_cbor_simple(datum.as_bool() ? CBOR_TRUE : CBOR_FALSE, out);
+        break;
+    case datum_t::R_NUM: write_cbor_number(datum.as_num(), out); break;
+    case datum_t::R_STR:
+        write_cbor_text(datum.as_str().data(), datum.as_str().size(), out);
+        break;
+    case datum_t::R_BINARY: {
+        const datum_string_t &data = datum.as_binary();
+        write_cbor_head(cbor_major_type_t::BYTE_STRING, data.size(), out);
+        out->append(data.data(), data.size());
+    } break;
+    case datum_t::R_ARRAY: {
+        const size_t sz = datum.arr_size();
+        write_cbor_head(cbor_major_type_t::ARRAY, sz, out);
+        for (size_t i = 0; i < sz; ++i) {
+            write_datum_cbor(datum.unchecked_get(i), out);
+        }
+    } break;
+    case datum_t::R_OBJECT: {
+        if (datum.is_ptype(pseudo::time_string)) {
+            write_cbor_time(datum, out);
+            break;
+        }
+        const size_t sz = datum.obj_size();
+        write_cbor_head(cbor_major_type_t::MAP, sz, out);
+        for (size_t i = 0; i < sz; ++i) {
+            auto pair = datum.get_pair(i);
+            write_cbor_text(pair.first.data(), pair.first.size(), out);
+            write_datum_cbor(pair.second, out);
+        }
+    } break;
+    case datum_t::UNINITIALIZED: // fallthru
+    default: unreachable();
+    }
+}
+
+void write_datum_cbor(const datum_t &datum, std::string *out) {
+    call_with_enough_stack([&] {
+            write_datum_cbor_unchecked_stack(datum, out);
+        }, MIN_CBOR_RECURSION_STACK_SPACE);
+}
+
+}  // namespace ql
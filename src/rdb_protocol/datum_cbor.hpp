@@ -0,0 +1,44 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#ifndef RDB_PROTOCOL_DATUM_CBOR_HPP_
+#define RDB_PROTOCOL_DATUM_CBOR_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+#include "rdb_protocol/datum.hpp"
+
+namespace ql {
+
+/* Appends the CBOR (RFC 7049) encoding of `datum` to `out`.  Unlike the JSON encoding,
+this doesn't have to format numbers or escape strings, and a few types are sent natively
+instead of as pseudo-types:
+ - numbers that are integers are sent as CBOR integers, other numbers as single or
+   double precision floats, whichever represents them exactly;
+ - binary data is sent as a byte string instead of as a base64 encoded `BINARY`
+   pseudo-type;
+ - times in UTC are sent as an epoch time (tag 1), other times as a standard date/time
+   string (tag 0), so that their timezone is preserved.
+All arrays and maps have definite lengths.  Throws like `write_json` for `r.minval` and
+`r.maxval`. */
+void write_datum_cbor(const datum_t &datum, std::string *out);
+
+// The pieces `write_datum_cbor` is made of, for writing the envelope of a response.
+enum class cbor_major_type_t : uint8_t {
+    UNSIGNED_INT = 0,
+    NEGATIVE_INT = 1,
+    BYTE_STRING = 2,
+    TEXT_STRING = 3,
+    ARRAY = 4,
+    MAP = 5,
+    TAG = 6,
+    SIMPLE = 7
+};
+void write_cbor_head(cbor_major_type_t major_type, uint64_t argument, std::string *out);
+void write_cbor_int(int64_t i, std::string *out);
+void write_cbor_text(const char *data, size_t size, std::string *out);
+
+}  // namespace ql
+
+#endif  // RDB_PROTOCOL_DATUM_CBOR_HPP_
@@ -1,15 +1,19 @@
 #ifndef RDB_PROTOCOL_DATUM_JSON_HPP_
 #define RDB_PROTOCOL_DATUM_JSON_HPP_
 
+#include "containers/shared_buffer.hpp"
 #include "rapidjson/document.h"
 #include "rdb_protocol/configured_limits.hpp"
 #include "rdb_protocol/datum.hpp"
 
 namespace ql {
+// If `insitu_buffer` is given, strings that `json_term_storage_t` prepared inside of it
+// are referenced rather than copied.
 datum_t to_datum(
     const rapidjson::Value &json,
     const configured_limits_t &,
-    reql_version_t);
+    reql_version_t,
+    const shared_buf_t *insitu_buffer = nullptr);
 }
 
 #endif  // RDB_PROTOCOL_DATUM_JSON_HPP_
@@ -0,0 +1,537 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#include "rdb_protocol/datum_json_parser.hpp"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <set>
+#include <string>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define DATUM_JSON_PARSER_HAS_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "arch/runtime/coroutines.hpp"
+#include "rdb_protocol/error.hpp"
+#include "rdb_protocol/pseudo_literal.hpp"
+
+namespace ql {
+
+namespace {
+
+const size_t MIN_JSON_PARSER_STACK_SPACE = 16 * KILOBYTE;
+
+// The first stage looks at the document in blocks of this many bytes, one bit per byte.
+const size_t JSON_BLOCK_SIZE = 64;
+
+// Integers with at most this many digits are converted without `strtod`.
+const size_t MAX_FAST_INTEGER_DIGITS = 18;
+
+struct block_masks_t {
+    uint64_t quotes;
+    uint64_t backslashes;
+    uint64_t whitespace;
+    uint64_t operators;
+};
+
+#ifdef DATUM_JSON_PARSER_HAS_SSE2
+void classify_block(const char *block, block_masks_t *out) {
+    out->quotes = out->backslashes = out->whitespace = out->operators = 0;
+    for (size_t i = 0; i < JSON_BLOCK_SIZE / 16; ++i) {
+        const __m128i chunk =
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(block + 16 * i));
+        // Setting bit 5 turns '[' into '{' and ']' into '}'.
+        const __m128i folded = _mm_or_si128(chunk, _mm_set1_epi8(0x20));
+        const __m128i whitespace = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(' ')),
+                         _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\t'))),
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n')),
+                         _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\r'))));
+        const __m128i operators = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(folded, _mm_set1_epi8('{')),
+                         _mm_cmpeq_epi8(folded, _mm_set1_epi8('}'))),
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(':')),
+                         _mm_cmpeq_epi8(chunk, _mm_set1_epi8(','))));
+        const size_t shift = 16 * i;
+        out->quotes |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(
+            _mm_cmpeq_epi8(chunk, _mm_set1_epi8('"'))))) << shift;
+        out->backslashes |= static_cast<uint64_t>(static_cast<uint16_t>(
+            _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\\'))))) << shift;
+        out->whitespace |= static_cast<uint64_t>(static_cast<uint16_t>(
+            _mm_movemask_epi8(whitespace))) << shift;
+        out->operators |= static_cast<uint64_t>(static_cast<uint16_t>(
+            _mm_movemask_epi8(operators))) << shift;
+    }
+}
+#else
+void classify_block(const char *block, block_masks_t *out) {
+    out->quotes = out->backslashes = out->whitespace = out->operators = 0;
+    for (size_t i = 0; i < JSON_BLOCK_SIZE; ++i) {
+        const uint64_t bit = static_cast<uint64_t>(1) << i;
+        switch (block[i]) {
+        case '"': out->quotes |= bit; break;
+        case '\\': out->backslashes |= bit; break;
+        case ' ': case '\t': case '\n': case '\r': out->whitespace |= bit; break;
+        case '{': case '}': case '[': case ']': case ':': case ',':
+            out->operators |= bit; break;
+        default: break;
+        }
+    }
+}
+#endif  // DATUM_JSON_PARSER_HAS_SSE2
+
+/* Returns the bits of the bytes that follow an unescaped backslash.  Backslashes are
+rare enough outside of binary-ish strings that we just walk them one by one.
+`*next_escaped` carries the answer for the first byte of the next block. */
+uint64_t find_escaped(uint64_t backslashes, uint64_t *next_escaped) {
+    uint64_t escaped = *next_escaped;
+    *next_escaped = 0;
+    while (backslashes != 0) {
+        const int i = __builtin_ctzll(backslashes);
+        backslashes &= backslashes - 1;
+        const uint64_t bit = static_cast<uint64_t>(1) << i;
+        if ((escaped & bit) != 0) {
+            // This backslash is escaped itself.
+            continue;
+        }
+        if (i == 63) {
+            *next_escaped = 1;
+        } else {
+            escaped |= bit << 1;
+        }
+    }
+    return escaped;
+}
+
+// Bit `i` of the result is the XOR of bits 0 to `i` of `x`.
+uint64_t prefix_xor(uint64_t x) {
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+void find_structurals(const char *data, size_t size, std::vector<size_t> *out) {
+    out->reserve(size / 8);
+    // All ones if the previous block ended inside of a string.
+    uint64_t prev_in_string = 0;
+    // Bit 0 is set if the first byte of the block is escaped.
+    uint64_t next_escaped = 0;
+    // Bit 0 is set if the last byte of the previous block ends a value.
+    uint64_t prev_boundary = 1;
+    for (size_t base = 0; base < size; base += JSON_BLOCK_SIZE) {
+        const char *block = data + base;
+        char padded[JSON_BLOCK_SIZE];
+        if (size - base < JSON_BLOCK_SIZE) {
+            memset(padded, ' ', JSON_BLOCK_SIZE);
+            memcpy(padded, data + base, size - base);
+            block = padded;
+        }
+        block_masks_t masks;
+        classify_block(block, &masks);
+
+        const uint64_t quotes = masks.quotes & ~find_escaped(masks.backslashes,
+                                                             &next_escaped);
+        // Opening quotes and the bytes inside of strings, but not closing quotes.
+        const uint64_t in_string = prefix_xor(quotes) ^ prev_in_string;
+        prev_in_string = static_cast<uint64_t>(static_cast<int64_t>(in_string) >> 63);
+
+        // Numbers, `true`, `false` and `null` start after one of these.
+        const uint64_t boundaries = masks.operators | masks.whitespace | quotes;
+        const uint64_t scalar_starts =
+            ~(masks.operators | masks.whitespace | masks.quotes) & ~in_string
+            & ((boundaries << 1) | prev_boundary);
+        prev_boundary = boundaries >> 63;
+
+        uint64_t structurals =
+            (masks.operators & ~in_string) | (quotes & in_string) | scalar_starts;
+        while (structurals != 0) {
+            out->push_back(base + __builtin_ctzll(structurals));
+            structurals &= structurals - 1;
+        }
+    }
+}
+
+bool is_boundary(char c) {
+    switch (c) {
+    case ' ': case '\t': case '\n': case '\r':
+    case '{': case '}': case '[': case ']': case ':': case ',': case '"':
+        return true;
+    default:
+        return false;
+    }
+}
+
+void encode_utf8(unsigned codepoint, std::string *out) {
+    if (codepoint < 0x80) {
+        out->push_back(static_cast<char>(codepoint));
+    } else if (codepoint < 0x800) {
+        out->push_back(static_cast<char>(0xC0 | (codepoint >> 6)));
+        out->push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+    } else if (codepoint < 0x10000) {
+        out->push_back(static_cast<char>(0xE0 | (codepoint >> 12)));
+        out->push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
+        out->push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+    } else {
+        out->push_back(static_cast<char>(0xF0 | (codepoint >> 18)));
+        out->push_back(static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F)));
+        out->push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
+        out->push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+    }
+}
+
+/* The second stage.  It follows RapidJSON's recursive descent parser closely, so that
+it reports the same errors, except that it jumps from one structural character to
+the next instead of skipping whitespace. */
+class structural_walker_t {
+public:
+    structural_walker_t(const char *data, size_t size,
+                        const std::vector<size_t> &structurals,
+                        const configured_limits_t &limits)
+        : data_(data), size_(size), structurals_(structurals), next_(0),
+          limits_(limits), error_(rapidjson::kParseErrorNone) { }
+
+    rapidjson::ParseErrorCode parse_document(datum_t *out) {
+        if (structurals_.empty()) {
+            return rapidjson::kParseErrorDocumentEmpty;
+        }
+        if (parse_value(rapidjson::kParseErrorDocumentRootNotSingular, out)
+            && next_ != structurals_.size()) {
+            error_ = rapidjson::kParseErrorDocumentRootNotSingular;
+        }
+        return error_;
+    }
+
+private:
+    MUST_USE bool fail(rapidjson::ParseErrorCode error) {
+        error_ = error;
+        return false;
+    }
+
+    // Returns the next structural character, or '\0' at the end of the document.
+    char peek() const {
+        return next_ < structurals_.size() ? data_[structurals_[next_]] : '\0';
+    }
+
+    /* `trailing_error` is what RapidJSON reports if a number or literal is directly
+    followed by something other than whitespace or an operator. */
+    MUST_USE bool parse_value(rapidjson::ParseErrorCode trailing_error, datum_t *out) {
+        if (next_ == structurals_.size()) {
+            return fail(rapidjson::kParseErrorValueInvalid);
+        }
+        const size_t pos = structurals_[next_++];
+        switch (data_[pos]) {
+        case '{': {
+            bool ok;
+            *out = call_with_enough_stack<datum_t>([&]() {
+                datum_t res;
+                ok = parse_object(&res);
+                return res;
+            }, MIN_JSON_PARSER_STACK_SPACE);
+            return ok;
+        } break;
+        case '[': {
+            bool ok;
+            *out = call_with_enough_stack<datum_t>([&]() {
+                datum_t res;
+                ok = parse_array(&res);
+                return res;
+            }, MIN_JSON_PARSER_STACK_SPACE);
+            return ok;
+        } break;
+        case '"': {
+            datum_string_t str;
+            if (!parse_string(pos, false, &str)) {
+                return false;
+            }
+            *out = datum_t::utf8(std::move(str));
+            return true;
+        } break;
+        case 't':
+            return parse_literal(pos, "true", datum_t::boolean(true),
+                                 trailing_error, out);
+        case 'f':
+            return parse_literal(pos, "false", datum_t::boolean(false),
+                                 trailing_error, out);
+        case 'n':
+            return parse_literal(pos, "null", datum_t::null(), trailing_error, out);
+        default:
+            return parse_number(pos, trailing_error, out);
+        }
+    }
+
+    MUST_USE bool parse_object(datum_t *out) {
+        datum_object_builder_t builder;
+        if (peek() == '}') {
+            ++next_;
+        } else {
+            for (;;) {
+                if (peek() != '"') {
+                    return fail(rapidjson::kParseErrorObjectMissName);
+                }
+                datum_string_t key;
+                if (!parse_string(structurals_[next_++], true, &key)) {
+                    return false;
+                }
+                key = datum_t::utf8(std::move(key)).as_str();
+                if (peek() != ':') {
+                    return fail(rapidjson::kParseErrorObjectMissColon);
+                }
+                ++next_;
+                datum_t value;
+                if (!parse_value(rapidjson::kParseErrorObjectMissCommaOrCurlyBracket,
+                                 &value)) {
+                    return false;
+                }
+                bool dup = builder.add(key, std::move(value));
+                rcheck_datum(!dup, base_exc_t::LOGIC,
+                             strprintf("Duplicate key %s in JSON.",
+                                       datum_t(key).print().c_str()));
+                const char c = peek();
+                ++next_;
+                if (c == '}') {
+                    break;
+                } else if (c != ',') {
+                    return fail(rapidjson::kParseErrorObjectMissCommaOrCurlyBracket);
+                }
+            }
+        }
+        const std::set<std::string> pts = { pseudo::literal_string };
+        *out = std::move(builder).to_datum(pts);
+        return true;
+    }
+
+    MUST_USE bool parse_array(datum_t *out) {
+        datum_array_builder_t builder(limits_);
+        if (peek() == ']') {
+            ++next_;
+        } else {
+            for (;;) {
+                datum_t value;
+                if (!parse_value(rapidjson::kParseErrorArrayMissCommaOrSquareBracket,
+                                 &value)) {
+                    return false;
+                }
+                builder.add(std::move(value));
+                const char c = peek();
+                ++next_;
+                if (c == ']') {
+                    break;
+                } else if (c != ',') {
+                    return fail(rapidjson::kParseErrorArrayMissCommaOrSquareBracket);
+                }
+            }
+        }
+        *out = std::move(builder).to_datum();
+        return true;
+    }
+
+    // `pos` is the position of the opening quote.  Object keys are interned.
+    MUST_USE bool parse_string(size_t pos, bool is_key, datum_string_t *out) {
+        const size_t begin = pos + 1;
+        size_t i = begin;
+        // Most strings don't contain any escapes, so we can take them as they are.
+        while (i < size_ && data_[i] != '"' && data_[i] != '\\'
+               && static_cast<unsigned char>(data_[i]) >= 0x20) {
+            ++i;
+        }
+        if (i < size_ && data_[i] == '"') {
+            *out = is_key
+                ? datum_string_t::intern(i - begin, data_ + begin)
+                : datum_string_t(i - begin, data_ + begin);
+            return true;
+        }
+
+        scratch_.assign(data_ + begin, i - begin);
+        for (;;) {
+            if (i == size_ || data_[i] == '\0') {
+                return fail(rapidjson::kParseErrorStringMissQuotationMark);
+            }
+            const char c = data_[i++];
+            if (c == '"') {
+                break;
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                return fail(rapidjson::kParseErrorStringEscapeInvalid);
+            } else if (c != '\\') {
+                scratch_.push_back(c);
+                continue;
+            }
+            if (i == size_) {
+                return fail(rapidjson::kParseErrorStringEscapeInvalid);
+            }
+            switch (data_[i++]) {
+            case '"': scratch_.push_back('"'); break;
+            case '\\': scratch_.push_back('\\'); break;
+            case '/': scratch_.push_back('/'); break;
+            case 'b': scratch_.push_back('\b'); break;
+            case 'f': scratch_.push_back('\f'); break;
+            case 'n': scratch_.push_back('\n'); break;
+            case 'r': scratch_.push_back('\r'); break;
+            case 't': scratch_.push_back('\t'); break;
+            case 'u': {
+                unsigned codepoint;
+                if (!parse_hex4(&i, &codepoint)) {
+                    return false;
+                }
+                if (codepoint >= 0xD800 && codepoint <= 0xDBFF) {
+                    if (i + 2 > size_ || data_[i] != '\\' || data_[i + 1] != 'u') {
+                        return fail(rapidjson::kParseErrorStringUnicodeSurrogateInvalid);
+                    }
+                    i += 2;
+                    unsigned codepoint2;
+                    if (!parse_hex4(&i, &codepoint2)) {
+                        return false;
+                    }
+                    if (codepoint2 < 0xDC00 || codepoint2 > 0xDFFF) {
+                        return fail(rapidjson::kParseErrorStringUnicodeSurrogateInvalid);
+                    }
+                    codepoint = (((codepoint - 0xD800) << 10) | (codepoint2 - 0xDC00))
+                        + 0x10000;
+                }
+                encode_utf8(codepoint, &scratch_);
+            } break;
+            default:
+                return fail(rapidjson::kParseErrorStringEscapeInvalid);
+            }
+        }
+        *out = is_key
+            ? datum_string_t::intern(scratch_.size(), scratch_.data())
+            : datum_string_t(scratch_);
+        return true;
+    }
+
+    MUST_USE bool parse_hex4(size_t *i, unsigned *out) {
+        *out = 0;
+        for (size_t j = 0; j < 4; ++j, ++*i) {
+            const char c = *i < size_ ? data_[*i] : '\0';
+            *out <<= 4;
+            if (c >= '0' && c <= '9') {
+                *out |= c - '0';
+            } else if (c >= 'A' && c <= 'F') {
+                *out |= c - 'A' + 10;
+            } else if (c >= 'a' && c <= 'f') {
+                *out |= c - 'a' + 10;
+            } else {
+                return fail(rapidjson::kParseErrorStringUnicodeEscapeInvalidHex);
+            }
+        }
+        return true;
+    }
+
+    MUST_USE bool finish_scalar(size_t end, rapidjson::ParseErrorCode trailing_error) {
+        if (end < size_ && !is_boundary(data_[end])) {
+            return fail(trailing_error);
+        }
+        return true;
+    }
+
+    MUST_USE bool parse_literal(size_t pos, const char *literal, datum_t value,
+                                rapidjson::ParseErrorCode trailing_error,
+                                datum_t *out) {
+        const size_t length = strlen(literal);
+        if (size_ - pos < length || memcmp(data_ + pos, literal, length) != 0) {
+            return fail(rapidjson::kParseErrorValueInvalid);
+        }
+        *out = std::move(value);
+        return finish_scalar(pos + length, trailing_error);
+    }
+
+    MUST_USE bool parse_number(size_t pos, rapidjson::ParseErrorCode trailing_error,
+                               datum_t *out) {
+        auto is_digit = [&](size_t i) {
+            return i < size_ && data_[i] >= '0' && data_[i] <= '9';
+        };
+        size_t i = pos;
+        const bool minus = i < size_ && data_[i] == '-';
+        if (minus) {
+            ++i;
+        }
+        const size_t int_begin = i;
+        if (i < size_ && data_[i] == '0') {
+            ++i;
+        } else if (is_digit(i)) {
+            while (is_digit(i)) {
+                ++i;
+            }
+        } else {
+            return fail(rapidjson::kParseErrorValueInvalid);
+        }
+        const size_t int_digits = i - int_begin;
+        bool is_integer = true;
+        if (i < size_ && data_[i] == '.') {
+            is_integer = false;
+            ++i;
+            if (!is_digit(i)) {
+                return fail(rapidjson::kParseErrorNumberMissFraction);
+            }
+            while (is_digit(i)) {
+                ++i;
+            }
+        }
+        if (i < size_ && (data_[i] == 'e' || data_[i] == 'E')) {
+            is_integer = false;
+            ++i;
+            if (i < size_ && (data_[i] == '+' || data_[i] == '-')) {
+                ++i;
+            }
+            if (!is_digit(i)) {
+                return fail(rapidjson::kParseErrorNumberMissExponent);
+            }
+            while (is_digit(i)) {
+                ++i;
+            }
+        }
+
+        double d;
+        if (is_integer && int_digits <= MAX_FAST_INTEGER_DIGITS) {
+            int64_t value = 0;
+            for (size_t j = int_begin; j < i; ++j) {
+                value = value * 10 + (data_[j] - '0');
+            }
+            // Like RapidJSON, we read "-0" as an integer, which makes it 0.
+            d = static_cast<double>(minus ? -value : value);
+        } else {
+            // `strtod` needs a null-terminated string.
+            scratch_.assign(data_ + pos, i - pos);
+            d = strtod(scratch_.c_str(), nullptr);
+            if (isinf(d)) {
+                return fail(rapidjson::kParseErrorNumberTooBig);
+            }
+        }
+        *out = datum_t(d);
+        return finish_scalar(i, trailing_error);
+    }
+
+    const char *const data_;
+    const size_t size_;
+    const std::vector<size_t> &structurals_;
+    size_t next_;
+    const configured_limits_t &limits_;
+    rapidjson::ParseErrorCode error_;
+    // Holds strings with escapes while they are decoded.
+    std::string scratch_;
+
+    DISABLE_COPYING(structural_walker_t);
+};
+
+}  // namespace
+
+datum_json_parser_t::datum_json_parser_t(const char *data, size_t size)
+    : data_(data), size_(size) {
+    find_structurals(data_, size_, &structurals_);
+}
+
+rapidjson::ParseErrorCode datum_json_parser_t::to_datum(
+        const configured_limits_t &limits,
+        datum_t *datum_out) const {
+    structural_walker_t walker(data_, size_, structurals_, limits);
+    return walker.parse_document(datum_out);
+}
+
+}  // namespace ql
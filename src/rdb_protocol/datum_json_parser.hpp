@@ -0,0 +1,51 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#ifndef RDB_PROTOCOL_DATUM_JSON_PARSER_HPP_
+#define RDB_PROTOCOL_DATUM_JSON_PARSER_HPP_
+
+#include <stddef.h>
+
+#include <vector>
+
+#include "rapidjson/rapidjson.h"
+#include "rapidjson/error/error.h"
+#include "rdb_protocol/configured_limits.hpp"
+#include "rdb_protocol/datum.hpp"
+
+namespace ql {
+
+/* `datum_json_parser_t` turns a JSON document into a datum without building a
+`rapidjson::Document` first.  It gives the same datums, and the same
+`rapidjson::ParseErrorCode`s for malformed documents, as parsing the document with
+RapidJSON and calling `to_datum` on the result.  The one exception is that numbers
+with a fraction or an exponent are always rounded correctly, which RapidJSON's
+default mode doesn't quite manage.
+
+Parsing happens in two stages, as in simdjson.  The constructor finds the positions of
+all the structural characters (brackets, braces, colons, commas, the opening quotes of
+strings and the first characters of other values) in 64 byte blocks, using vector
+compares where the CPU has them.  It only reads the document, so it may run in a
+`run_cpu_task()`.  `to_datum()` then walks the structural characters and builds the
+datum; it has to run on the thread the datum is going to be used on.
+
+`data` must stay valid for as long as the parser exists. */
+class datum_json_parser_t {
+public:
+    datum_json_parser_t(const char *data, size_t size);
+
+    /* Returns `rapidjson::kParseErrorNone` and sets `*datum_out` if the document is
+    well-formed.  Throws the same datum errors as `to_datum`, for example for strings
+    that aren't valid UTF-8 or for duplicate keys. */
+    MUST_USE rapidjson::ParseErrorCode to_datum(const configured_limits_t &limits,
+                                                datum_t *datum_out) const;
+
+private:
+    const char *data_;
+    size_t size_;
+    std::vector<size_t> structurals_;
+
+    DISABLE_COPYING(datum_json_parser_t);
+};
+
+}  // namespace ql
+
+#endif  // RDB_PROTOCOL_DATUM_JSON_PARSER_HPP_
@@ -1,12 +1,21 @@
 // Copyright 2010-2015 RethinkDB, all rights reserved.
 #include "rdb_protocol/datum_stream.hpp"
 
+#include <algorithm>
+#include <exception>
 #include <map>
 
+#include "arch/runtime/coroutines.hpp"
+#include "concurrency/cross_thread_signal.hpp"
+#include "concurrency/pmap.hpp"
+#include "containers/uuid.hpp"
 #include "math.hpp"
+#include "paths.hpp"
 #include "rdb_protocol/batching.hpp"
+#include "rdb_protocol/context.hpp"
 #include "rdb_protocol/datum_stream/array.hpp"
 #include "rdb_protocol/datum_stream/eq_join.hpp"
+#include "rdb_protocol/datum_stream/external_sort.hpp"
 #include "rdb_protocol/datum_stream/fold.hpp"
 #include "rdb_protocol/datum_stream/indexed_sort.hpp"
 #include "rdb_protocol/datum_stream/lazy.hpp"
@@ -18,6 +27,7 @@
 #include "rdb_protocol/datum_stream/readers.hpp"
 #include "rdb_protocol/datum_stream/readgens.hpp"
 #include "rdb_protocol/datum_stream/slice.hpp"
+#include "rdb_protocol/datum_stream/text_search.hpp"
 #include "rdb_protocol/datum_stream/union.hpp"
 #include "rdb_protocol/datum_stream/vector.hpp"
 #include "rdb_protocol/env.hpp"
@@ -34,6 +44,7 @@
 #include "rdb_protocol/geo/s2/s2polyline.h"
 #include "rdb_protocol/math_utils.hpp"
 #include "rdb_protocol/term.hpp"
+#include "rdb_protocol/text_index.hpp"
 #include "rdb_protocol/val.hpp"
 #include "utils.hpp"
 
@@ -382,8 +393,13 @@ raw_stream_t rget_response_reader_t::unshard(
             }
         }
         active_ranges.set(new_active_ranges(
-            stream, readgen->original_keyrange(res.reql_version), opt_shard_ids,
+            stream,
+            res.hashed_sindex
+                ? key_range_t::universe()
+                : readgen->original_keyrange(res.reql_version),
+            opt_shard_ids,
             readgen->sindex_name() ? is_secondary_t::YES : is_secondary_t::NO));
+        active_ranges->hashed_sindex = res.hashed_sindex;
         readgen->restrict_active_ranges(sorting, &*active_ranges);
         reql_version.set(res.reql_version);
     } else {
@@ -1152,8 +1168,7 @@ void sindex_readgen_t::sindex_sort(
         return;
     }
     if (sorting(batchspec) != sorting_t::UNORDERED) {
-        std::stable_sort(vec->begin(), vec->end(),
-                         sindex_compare_t(sorting(batchspec)));
+        sindex_sort_items(vec, sorting(batchspec));
     }
 }
 
@@ -1169,7 +1184,9 @@ rget_read_t sindex_readgen_t::next_read_impl(
     if (active_ranges) {
         region.set(region_t(active_ranges_to_range(*active_ranges)));
         r_sanity_check(reql_version);
-        ds = datumspec.trim_secondary(region->inner, *reql_version);
+        ds = active_ranges->hashed_sindex
+            ? datumspec
+            : datumspec.trim_secondary(region->inner, *reql_version);
     } else {
         ds = datumspec;
         // We should send at most one read before we're able to calculate the
@@ -1621,6 +1638,159 @@ indexed_sort_datum_stream_t::next_raw_batch(env_t *env, const batchspec_t &batch
     return ret;
 }
 
+// EXTERNAL_SORT_DATUM_STREAM_T
+external_sort_datum_stream_t::external_sort_datum_stream_t(
+    lt_cmp_t _lt_cmp, backtrace_id_t bt)
+    : eager_datum_stream_t(bt), lt_cmp(std::move(_lt_cmp)), started(false) { }
+
+bool external_sort_datum_stream_t::can_spill(env_t *env) {
+    rdb_context_t *ctx = env->get_rdb_ctx();
+    return ctx != nullptr && ctx->io_backender != nullptr;
+}
+
+scoped_ptr_t<disk_backed_queue_t<datum_t> >
+external_sort_datum_stream_t::make_run_queue(env_t *env) {
+    rdb_context_t *ctx = env->get_rdb_ctx();
+    return scoped_ptr_t<disk_backed_queue_t<datum_t> >(
+        new disk_backed_queue_t<datum_t>(
+            ctx->io_backender,
+            serializer_filepath_t(ctx->base_path,
+                                  "sort_" + uuid_to_str(generate_uuid())),
+            &perfmon_collection,
+            disk_queue_format_t::SEGMENT_FILE));
+}
+
+void external_sort_datum_stream_t::push_run(env_t *env, std::vector<datum_t> &&run) {
+    r_sanity_check(!started);
+    r_sanity_check(can_spill(env));
+    scoped_ptr_t<disk_backed_queue_t<datum_t> > queue = make_run_queue(env);
+    {
+        profile::sampler_t sampler("Writing sorted rows to disk.", env->trace);
+        for (auto &&row : run) {
+            queue->push(row);
+            sampler.new_sample();
+        }
+    }
+    run.clear();
+    runs.push_back(std::move(queue));
+    run_tiers.push_back(0);
+
+    // Tiers never increase along `runs`, so if the first of the last
+    // `EXTERNAL_SORT_MAX_FAN_IN` runs has the same tier as the last, they all do.
+    while (runs.size() >= EXTERNAL_SORT_MAX_FAN_IN
+           && run_tiers[runs.size() - EXTERNAL_SORT_MAX_FAN_IN] == run_tiers.back()) {
+        const size_t first = runs.size() - EXTERNAL_SORT_MAX_FAN_IN;
+        const size_t tier = run_tiers.back();
+        merge_runs(env, first);
+        run_tiers.resize(first);
+        run_tiers.push_back(tier + 1);
+    }
+}
+
+void external_sort_datum_stream_t::merge_runs(env_t *env, size_t first) {
+    r_sanity_check(first < runs.size());
+    profile::sampler_t sampler("Merging sorted rows on disk.", env->trace);
+    scoped_ptr_t<disk_backed_queue_t<datum_t> > merged = make_run_queue(env);
+
+    // This is the same merge as in `next_raw_batch()`, over `runs[first]` onwards.
+    std::vector<datum_t> merge_heads(runs.size() - first);
+    std::vector<size_t> merge_heap;
+    auto heap_cmp = [&](size_t a, size_t b) {
+        if (lt_cmp(env, &sampler, merge_heads[b], merge_heads[a])) {
+            return true;
+        }
+        return b < a && !lt_cmp(env, &sampler, merge_heads[a], merge_heads[b]);
+    };
+    for (size_t i = 0; i < merge_heads.size(); ++i) {
+        if (!runs[first + i]->empty()) {
+            runs[first + i]->pop(&merge_heads[i]);
+            merge_heap.push_back(i);
+        }
+    }
+    std::make_heap(merge_heap.begin(), merge_heap.end(), heap_cmp);
+    while (!merge_heap.empty()) {
+        std::pop_heap(merge_heap.begin(), merge_heap.end(), heap_cmp);
+        const size_t i = merge_heap.back();
+        merged->push(merge_heads[i]);
+        sampler.new_sample();
+        if (!runs[first + i]->empty()) {
+            runs[first + i]->pop(&merge_heads[i]);
+            std::push_heap(merge_heap.begin(), merge_heap.end(), heap_cmp);
+        } else {
+            merge_heap.pop_back();
+        }
+    }
+
+    runs.resize(first);
+    runs.push_back(std::move(merged));
+}
+
+void external_sort_datum_stream_t::pop_head(size_t run) {
+    heads[run] = datum_t();
+    if (!runs[run]->empty()) {
+        runs[run]->pop(&heads[run]);
+    }
+}
+
+std::vector<datum_t>
+external_sort_datum_stream_t::next_raw_batch(env_t *env, const batchspec_t &batchspec) {
+    profile::sampler_t sampler("Merging sorted rows from disk.", env->trace);
+    // `heap_cmp(a, b)` is true if run `a`'s head comes after run `b`'s, so that the
+    // run with the first head is at the front of the heap.  Equal heads come out in
+    // the order of their runs.
+    auto heap_cmp = [&](size_t a, size_t b) {
+        if (lt_cmp(env, &sampler, heads[b], heads[a])) {
+            return true;
+        }
+        return b < a && !lt_cmp(env, &sampler, heads[a], heads[b]);
+    };
+
+    if (!started) {
+        started = true;
+        while (runs.size() > EXTERNAL_SORT_MAX_FAN_IN) {
+            merge_runs(env, runs.size() - EXTERNAL_SORT_MAX_FAN_IN);
+        }
+        run_tiers.clear();
+        heads.resize(runs.size());
+        for (size_t run = 0; run < runs.size(); ++run) {
+            pop_head(run);
+            if (heads[run].has()) {
+                heap.push_back(run);
+            }
+        }
+        std::make_heap(heap.begin(), heap.end(), heap_cmp);
+    }
+
+    std::vector<datum_t> ret;
+    batcher_t batcher = batchspec.to_batcher();
+    while (!heap.empty() && !batcher.should_send_batch()) {
+        std::pop_heap(heap.begin(), heap.end(), heap_cmp);
+        const size_t run = heap.back();
+        batcher.note_el(heads[run]);
+        ret.push_back(std::move(heads[run]));
+        pop_head(run);
+        if (heads[run].has()) {
+            std::push_heap(heap.begin(), heap.end(), heap_cmp);
+        } else {
+            heap.pop_back();
+        }
+    }
+    return ret;
+}
+
+bool external_sort_datum_stream_t::is_exhausted() const {
+    return started && heap.empty();
+}
+feed_type_t external_sort_datum_stream_t::cfeed_type() const {
+    return feed_type_t::not_feed;
+}
+bool external_sort_datum_stream_t::is_infinite() const {
+    return false;
+}
+bool external_sort_datum_stream_t::is_array() const {
+    return false;
+}
+
 // ORDERED_DISTINCT_DATUM_STREAM_T
 ordered_distinct_datum_stream_t::ordered_distinct_datum_stream_t(
     counted_t<datum_stream_t> _source) : wrapper_datum_stream_t(_source) { }
@@ -1669,6 +1839,44 @@ offsets_of_datum_stream_t::next_raw_batch(env_t *env, const batchspec_t &bs) {
     return ret;
 }
 
+// TEXT_SEARCH_DATUM_STREAM_T
+text_search_datum_stream_t::text_search_datum_stream_t(
+    counted_t<const func_t> _f,
+    std::set<std::string> _words,
+    counted_t<datum_stream_t> _source)
+    : wrapper_datum_stream_t(_source), f(_f), words(std::move(_words)) {
+    guarantee(f.has() && source.has());
+}
+
+std::vector<datum_t>
+text_search_datum_stream_t::next_raw_batch(env_t *env, const batchspec_t &bs) {
+    std::vector<datum_t> ret;
+    profile::sampler_t sampler("Matching text search words.", env->trace);
+    while (ret.size() == 0) {
+        std::vector<datum_t> v = source->next_batch(env, bs);
+        if (v.size() == 0) {
+            break;
+        }
+        for (auto &&row : v) {
+            bool matches;
+            try {
+                std::set<std::string> row_words =
+                    text_index_words(f->call(env, row)->as_datum());
+                matches = std::includes(row_words.begin(), row_words.end(),
+                                        words.begin(), words.end());
+            } catch (const base_exc_t &) {
+                // The index has no entries for documents it can't compute words for.
+                matches = false;
+            }
+            if (matches) {
+                ret.push_back(std::move(row));
+            }
+            sampler.new_sample();
+        }
+    }
+    return ret;
+}
+
 // SLICE_DATUM_STREAM_T
 slice_datum_stream_t::slice_datum_stream_t(
     uint64_t _left, uint64_t _right, counted_t<datum_stream_t> _src)
@@ -1724,6 +1932,9 @@ slice_datum_stream_t::next_raw_batch(env_t *env, const batchspec_t &batchspec) {
 
     std::vector<datum_t> ret;
 
+    // The rows before `left` are read and thrown away.  Btree nodes don't keep
+    // subtree entry counts, so there's no way to seek to the `left`th row of a table
+    // or an index range.
     while (index < left) {
         sampler.new_sample();
         std::vector<datum_t> v =
@@ -1904,6 +2115,20 @@ ordered_union_datum_stream_t::ordered_union_datum_stream_t(
     for (auto &&stream : _streams) {
         streams.push_back(std::move(stream));
     }
+    rows_taken.resize(streams.size(), 0);
+}
+
+batchspec_t ordered_union_datum_stream_t::source_batchspec(
+    const batchspec_t &batchspec, size_t source_index) {
+    // Infinite streams need the batchspec as it is to time out their batches, and
+    // terminals read everything anyway.
+    if (is_infinite_ordered_union
+        || (batchspec.get_batch_type() != batch_type_t::NORMAL
+            && batchspec.get_batch_type() != batch_type_t::NORMAL_FIRST)) {
+        return batchspec;
+    }
+    return batchspec.with_at_most(
+        std::max<uint64_t>(ORDERED_UNION_FIRST_READ_ROWS, rows_taken[source_index]));
 }
 
 std::vector<datum_t> ordered_union_datum_stream_t::next_raw_batch(
@@ -1919,14 +2144,15 @@ std::vector<datum_t> ordered_union_datum_stream_t::next_raw_batch(
 
     if (is_ordered_by_field) {
         if (do_prelim_cache) {
-            for (auto &&stream : streams) {
-                r_sanity_check(stream.has());
-                datum_t cache_item = stream->next(env, batchspec);
+            for (size_t i = 0; i < streams.size(); ++i) {
+                r_sanity_check(streams[i].has());
+                datum_t cache_item =
+                    streams[i]->next(env, source_batchspec(batchspec, i));
 
                 if (cache_item.has()) {
                     merge_cache.push(
                         merge_cache_item_t{std::move(cache_item),
-                                stream});
+                                streams[i], i});
                 }
             }
             do_prelim_cache = false;
@@ -1937,8 +2163,10 @@ std::vector<datum_t> ordered_union_datum_stream_t::next_raw_batch(
             merge_cache.pop();
 
             datum_t datum_on_deck = std::move(el.value);
+            ++rows_taken[el.source_index];
 
-            datum_t next_datum = el.source->next(env, batchspec);
+            datum_t next_datum =
+                el.source->next(env, source_batchspec(batchspec, el.source_index));
 
             if (next_datum.has()) {
                 // Enforce ordering in merge step
@@ -1950,7 +2178,7 @@ std::vector<datum_t> ordered_union_datum_stream_t::next_raw_batch(
 
                 merge_cache.push(
                     merge_cache_item_t{std::move(next_datum),
-                            el.source});
+                            el.source, el.source_index});
             }
 
             batcher.note_el(datum_on_deck);
@@ -2220,6 +2448,12 @@ bool range_datum_stream_t::is_exhausted() const {
 }
 
 // MAP_DATUM_STREAM_T
+
+// How many calls `map_datum_stream_t` gathers per thread before evaluating them in
+// parallel, and the fewest calls it's worth switching threads for.
+static const size_t PARALLEL_MAP_CALLS_PER_THREAD = 64;
+static const size_t MIN_PARALLEL_MAP_CALLS = 16;
+
 map_datum_stream_t::map_datum_stream_t(
         std::vector<counted_t<datum_stream_t> > &&_streams,
         counted_t<const func_t> &&_func,
@@ -2233,6 +2467,9 @@ map_datum_stream_t::map_datum_stream_t(
         is_infinite_map &= stream->is_infinite();
         cache.push_back(std::deque<datum_t>());
     }
+    parallel = union_type == feed_type_t::not_feed
+        && get_num_threads() > 1
+        && func->is_deterministic().test(single_server_t::yes, constant_now_t::yes);
 }
 
 std::vector<datum_t>
@@ -2251,55 +2488,136 @@ map_datum_stream_t::next_raw_batch(env_t *env, const batchspec_t &batchspec) {
     if (batchspec_inner.get_batch_type() == batch_type_t::TERMINAL) {
         batchspec_inner = batchspec_t::default_for(batch_type_t::NORMAL);
     }
-    while (!is_exhausted()) {
-        while (args.size() < streams.size()) {
-            if (cache[args.size()].size() == 0) {
-                std::vector<datum_t> new_items = streams[args.size()]->next_batch(
-                    env,
-                    batchspec_inner);
-                for (auto it = new_items.begin(); it != new_items.end(); ++it) {
-                    cache[args.size()].push_back(std::move(*it));
-                }
+    // We don't evaluate more calls at once than the batch has room for, so that
+    // e.g. a `limit` after the `map` doesn't pay for rows it drops.  (Profiled
+    // queries stay on this thread so the profile shows the work.)
+    const size_t max_calls = parallel && env->trace == nullptr
+        ? std::max<int64_t>(
+            1,
+            std::min<int64_t>(PARALLEL_MAP_CALLS_PER_THREAD * get_num_threads(),
+                              batcher.get_els_left()))
+        : 1;
+    for (;;) {
+        while (!mapped.empty()) {
+            batcher.note_el(mapped.front());
+            batch.push_back(std::move(mapped.front()));
+            mapped.pop_front();
+            if (batcher.should_send_batch()) {
+                return batch;
             }
-            if (cache[args.size()].size() == 0) {
-                if (union_type == feed_type_t::not_feed) {
-                    r_sanity_check(is_exhausted());
+        }
+        if (inputs_exhausted()) {
+            return batch;
+        }
+
+        std::vector<std::vector<datum_t> > calls;
+        while (calls.size() < max_calls && !inputs_exhausted()) {
+            while (args.size() < streams.size()) {
+                if (cache[args.size()].size() == 0) {
+                    std::vector<datum_t> new_items = streams[args.size()]->next_batch(
+                        env,
+                        batchspec_inner);
+                    for (auto it = new_items.begin(); it != new_items.end(); ++it) {
+                        cache[args.size()].push_back(std::move(*it));
+                    }
                 }
-                // If we have a feed, return with `args` partway full and continue
-                // next time the client asks for a batch.
-                return batch;
+                if (cache[args.size()].size() == 0) {
+                    if (union_type == feed_type_t::not_feed) {
+                        r_sanity_check(inputs_exhausted());
+                        break;
+                    }
+                    // If we have a feed, return with `args` partway full and
+                    // continue next time the client asks for a batch.  Feeds are
+                    // never evaluated in parallel, so `calls` is empty.
+                    r_sanity_check(calls.empty());
+                    return batch;
+                }
+                args.push_back(std::move(cache[args.size()].front()));
+                cache[args.size() - 1].pop_front();
             }
-            args.push_back(std::move(cache[args.size()].front()));
-            cache[args.size() - 1].pop_front();
-        }
-        datum_t datum = func->call(env, args)->as_datum();
-        r_sanity_check(datum.has());
-        args.clear();
-        batcher.note_el(datum);
-        batch.push_back(std::move(datum));
-        if (batcher.should_send_batch()) {
-            break;
+            if (args.size() < streams.size()) {
+                break;
+            }
+            calls.push_back(std::move(args));
+            args.clear();
+            args.reserve(streams.size());
+        }
+        for (datum_t &datum : call_func(env, std::move(calls))) {
+            mapped.push_back(std::move(datum));
         }
     }
+}
 
-    return batch;
+std::vector<datum_t> map_datum_stream_t::call_func(
+        env_t *env, std::vector<std::vector<datum_t> > &&calls) {
+    std::vector<datum_t> results(calls.size());
+    const int num_threads = get_num_threads();
+    if (!parallel || env->trace != nullptr || calls.size() < MIN_PARALLEL_MAP_CALLS) {
+        for (size_t i = 0; i < calls.size(); ++i) {
+            results[i] = func->call(env, calls[i])->as_datum();
+            r_sanity_check(results[i].has());
+        }
+        return results;
+    }
+
+    // Each thread evaluates a contiguous slice of `calls` in its own `env_t`.  Datums
+    // and compiled functions are reference counted atomically, so the threads can
+    // share them.
+    const size_t per_thread = ceil_divide(calls.size(), num_threads);
+    const serializable_env_t serializable = env->get_serializable_env();
+    std::vector<std::exception_ptr> errors(num_threads);
+    pmap(num_threads, [&](int thread) {
+        const size_t begin = std::min(calls.size(), thread * per_thread);
+        const size_t end = std::min(calls.size(), begin + per_thread);
+        if (begin == end) {
+            return;
+        }
+        cross_thread_signal_t interruptor(env->interruptor, threadnum_t(thread));
+        on_thread_t thread_switcher((threadnum_t(thread)));
+        try {
+            env_t thread_env(env->get_rdb_ctx(),
+                             env->return_empty_normal_batches,
+                             &interruptor,
+                             serializable,
+                             nullptr);
+            for (size_t i = begin; i < end; ++i) {
+                results[i] = func->call(&thread_env, calls[i])->as_datum();
+                r_sanity_check(results[i].has());
+            }
+        } catch (...) {
+            errors[thread] = std::current_exception();
+        }
+    });
+    // We report the error of the earliest call that failed, like the sequential
+    // evaluation would have.
+    for (const std::exception_ptr &error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+    return results;
 }
 
-bool map_datum_stream_t::is_exhausted() const {
+bool map_datum_stream_t::inputs_exhausted() const {
     for (size_t i = 0; i < streams.size(); ++i) {
         if (streams[i]->is_exhausted() &&
             cache[i].size() == 0) {
-            return batch_cache_exhausted();
+            return true;
         }
     }
     return false;
 }
 
+bool map_datum_stream_t::is_exhausted() const {
+    return inputs_exhausted() && mapped.empty() && batch_cache_exhausted();
+}
+
 eq_join_datum_stream_t::eq_join_datum_stream_t(counted_t<datum_stream_t> _stream,
                                                counted_t<table_t> _table,
                                                datum_string_t _join_index,
                                                counted_t<const func_t> _predicate,
                                                bool _ordered,
+                                               eq_join_strategy_t _strategy,
                                                backtrace_id_t _bt) :
     eager_datum_stream_t(_bt),
     stream(std::move(_stream)),
@@ -2307,13 +2625,111 @@ eq_join_datum_stream_t::eq_join_datum_stream_t(counted_t<datum_stream_t> _stream
     join_index(std::move(_join_index)),
     predicate(std::move(_predicate)),
     ordered(_ordered),
+    strategy(_strategy),
+    right_rows_loaded(false),
     is_array_eq_join(stream->is_array()),
     is_infinite_eq_join(stream->is_infinite()),
-    eq_join_type(stream->cfeed_type()) { }
+    eq_join_type(stream->cfeed_type()) {
+    if (eq_join_type != feed_type_t::not_feed || is_infinite_eq_join) {
+        // The right table would go stale while we wait for the changes.
+        strategy = eq_join_strategy_t::LOOKUP;
+    }
+}
+
+datum_t eq_join_datum_stream_t::join_key(env_t *env, const datum_t &row) const {
+    datum_t key_val;
+    try {
+        key_val = predicate->call(env, std::vector<datum_t>{row})->as_datum();
+    } catch (const exc_t &e) {
+        if (e.get_type() == base_exc_t::NON_EXISTENCE) {
+            return datum_t();
+        } else {
+            throw;
+        }
+    }
+    if (key_val.get_type() == datum_t::type_t::R_NULL) {
+        return datum_t();
+    }
+    return key_val;
+}
+
+datum_t make_eq_join_pair(const datum_t &left_row, const datum_t &right_row) {
+    ql::datum_object_builder_t res_item;
+    bool conflict = true;
+    conflict &= res_item.add(datum_string_t("right"), right_row);
+    conflict &= res_item.add(datum_string_t("left"), left_row);
+    guarantee(!conflict);
+    return std::move(res_item).to_datum();
+}
+
+void eq_join_datum_stream_t::load_right_rows(env_t *env) {
+    right_rows_loaded = true;
+    scoped_ptr_t<reader_t> reader = table->get_all_with_sindexes(
+        env,
+        datumspec_t(datum_range_t::universe()),
+        join_index.to_std(),
+        backtrace());
+    const size_t limit = env->limits().array_size_limit();
+    size_t num_rows = 0;
+    while (!reader->is_finished()) {
+        std::vector<rget_item_t> items =
+            reader->raw_next_batch(env, batchspec_t::default_for(batch_type_t::NORMAL));
+        num_rows += items.size();
+        if (num_rows > limit) {
+            // The right table doesn't fit in memory; the index is the next best thing.
+            right_rows.clear();
+            strategy = eq_join_strategy_t::LOOKUP;
+            return;
+        }
+        for (rget_item_t &item : items) {
+            datum_t key = item.sindex_key.has()
+                ? std::move(item.sindex_key)
+                : item.data.get_field(join_index);
+            right_rows.insert(std::make_pair(std::move(key), std::move(item.data)));
+        }
+    }
+}
+
+std::vector<datum_t> eq_join_datum_stream_t::next_scanned_batch(
+    env_t *env,
+    const batchspec_t &batchspec) {
+    batcher_t batcher = batchspec.to_batcher();
+
+    // The left rows are matched in the order they arrive, so this is always ordered.
+    std::vector<datum_t> res;
+    while (!stream->is_exhausted() && !batcher.should_send_batch()) {
+        std::vector<datum_t> stream_batch = stream->next_batch(env, batchspec);
+        if (stream_batch.empty()) {
+            break;
+        }
+        for (const datum_t &left_row : stream_batch) {
+            datum_t key_val = join_key(env, left_row);
+            if (!key_val.has()) {
+                continue;
+            }
+            auto range = right_rows.equal_range(key_val);
+            for (auto pair = range.first; pair != range.second; ++pair) {
+                datum_t res_datum = make_eq_join_pair(left_row, pair->second);
+                batcher.note_el(res_datum);
+                res.push_back(std::move(res_datum));
+            }
+        }
+    }
+    return res;
+}
 
 std::vector<datum_t> eq_join_datum_stream_t::next_raw_batch(
     env_t *env,
     const batchspec_t &batchspec) {
+    if (strategy == eq_join_strategy_t::SCAN) {
+        if (!right_rows_loaded) {
+            load_right_rows(env);
+        }
+        if (strategy == eq_join_strategy_t::SCAN) {
+            return next_scanned_batch(env, batchspec);
+        }
+    }
+
     batcher_t batcher = batchspec.to_batcher();
 
     batchspec_t inner_batchspec = ordered ?
@@ -2338,20 +2754,9 @@ std::vector<datum_t> eq_join_datum_stream_t::next_raw_batch(
             sindex_to_datum.clear();
             std::map<datum_t, uint64_t> keys;
             for (size_t i = 0; i < stream_batch.size(); ++i) {
-                datum_t key_val;
-                try {
-                    key_val = predicate->call(
-                        env,
-                        std::vector<datum_t>{stream_batch[i]})->as_datum();
-                } catch (const exc_t &e) {
-                    if (e.get_type() == base_exc_t::NON_EXISTENCE) {
-                        continue;
-                    } else {
-                        throw;
-                    }
-                }
+                datum_t key_val = join_key(env, stream_batch[i]);
                 // Build a multimap from sindex value to datums from left side stream.
-                if (key_val.get_type() != datum_t::type_t::R_NULL) {
+                if (key_val.has()) {
                     sindex_to_datum.insert(std::pair<datum_t, datum_t>{
                             key_val, stream_batch[i]});
                     keys[key_val] = 1;
@@ -2382,15 +2787,8 @@ std::vector<datum_t> eq_join_datum_stream_t::next_raw_batch(
         } else {
             range = sindex_to_datum.equal_range(item.data.get_field(join_index));
         }
-        datum_string_t right("right");
-        datum_string_t left("left");
         for (auto pair = range.first; pair != range.second; ++pair) {
-            ql::datum_object_builder_t res_item;
-            bool conflict = true;
-            conflict &= res_item.add(right, item.data);
-            conflict &= res_item.add(left, pair->second);
-            guarantee(!conflict);
-            datum_t res_datum = std::move(res_item).to_datum();
+            datum_t res_datum = make_eq_join_pair(pair->second, item.data);
             batcher.note_el(res_datum);
             res.push_back(std::move(res_datum));
         }
@@ -2466,21 +2864,20 @@ fold_datum_stream_t::next_raw_batch(env_t *env, const batchspec_t &batchspec) {
     while (!stream->is_exhausted()) {
         std::vector<datum_t> input_batch = stream->next_batch(env, batchspec);
         for (const datum_t &row : input_batch) {
-            datum_t new_acc = acc_func->call(
-                env,
-                std::vector<datum_t>{acc, row})->as_datum();
+            call_args.clear();
+            call_args.push_back(acc);
+            call_args.push_back(row);
+            datum_t new_acc = acc_func->call_datum(env, call_args);
 
             r_sanity_check(new_acc.has());
 
-            datum_t emit_elem = emit_func->call(
-                env,
-                std::vector<datum_t>{acc, row, new_acc})->as_datum();
+            call_args.push_back(new_acc);
+            datum_t emit_elem = emit_func->call_datum(env, call_args);
 
             r_sanity_check(emit_elem.has());
 
             for (size_t i = 0; i < emit_elem.arr_size(); ++i) {
-                datum_t emit_item = emit_elem.get(i);
-                batch.push_back(std::move(emit_item));
+                batch.push_back(emit_elem.get(i));
             }
 
             acc = std::move(new_acc);
@@ -2494,11 +2891,9 @@ fold_datum_stream_t::next_raw_batch(env_t *env, const batchspec_t &batchspec) {
     }
 
     if (stream->is_exhausted() && do_final_emit) {
-        std::vector<datum_t> final_emit_args;
-        final_emit_args.push_back(acc);
-        datum_t final_emit_elem = final_emit_func->call(
-            env,
-            final_emit_args)->as_datum();
+        call_args.clear();
+        call_args.push_back(acc);
+        datum_t final_emit_elem = final_emit_func->call_datum(env, call_args);
 
         for (size_t i = 0; i< final_emit_elem.arr_size(); ++i) {
             datum_t final_emit_item = final_emit_elem.get(i);
@@ -210,7 +210,11 @@ struct hash_ranges_t {
 void debug_print(printf_buffer_t *buf, const hash_ranges_t &hr);
 
 struct active_ranges_t {
+    active_ranges_t() : hashed_sindex(false) { }
     std::map<key_range_t, hash_ranges_t> ranges;
+    // If the ranges are in the key space of a hash index, they don't tell us which
+    // index values are left to read.
+    bool hashed_sindex;
     bool totally_exhausted() const;
 };
 void debug_print(printf_buffer_t *buf, const active_ranges_t &ar);
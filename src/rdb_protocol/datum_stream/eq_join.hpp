@@ -5,6 +5,13 @@
 
 namespace ql {
 
+/* `LOOKUP` does a `get_all` on the right table for every batch of the left stream.
+`SCAN` reads the whole right table into memory once and matches the left rows against
+that, which is much cheaper when the left side is large compared to the right side.  If
+the right table has more rows than the array size limit, or the left side is a
+changefeed, `SCAN` falls back to `LOOKUP`. */
+enum class eq_join_strategy_t { LOOKUP, SCAN };
+
 class eq_join_datum_stream_t : public eager_datum_stream_t {
 public:
     eq_join_datum_stream_t(counted_t<datum_stream_t> _stream,
@@ -12,6 +19,7 @@ public:
                            datum_string_t _join_index,
                            counted_t<const func_t> _predicate,
                            bool _ordered,
+                           eq_join_strategy_t _strategy,
                            backtrace_id_t bt);
 
     bool is_array() const final {
@@ -30,6 +38,11 @@ public:
     }
 
 private:
+    // Returns an empty `datum_t` if the row has no join key.
+    datum_t join_key(env_t *env, const datum_t &row) const;
+    void load_right_rows(env_t *env);
+    std::vector<datum_t> next_scanned_batch(env_t *env, const batchspec_t &batchspec);
+
     counted_t<datum_stream_t> stream;
     scoped_ptr_t<reader_t> get_all_reader;
     std::vector<rget_item_t> get_all_items;
@@ -44,6 +57,12 @@ private:
 
     bool ordered;
 
+    eq_join_strategy_t strategy;
+    bool right_rows_loaded;
+    // The rows of the right table by join key, for `eq_join_strategy_t::SCAN`.
+    std::multimap<ql::datum_t,
+                  ql::datum_t> right_rows;
+
     bool is_array_eq_join;
     bool is_infinite_eq_join;
     feed_type_t eq_join_type;
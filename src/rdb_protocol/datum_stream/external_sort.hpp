@@ -0,0 +1,69 @@
+#ifndef RDB_PROTOCOL_DATUM_STREAM_EXTERNAL_SORT_HPP_
+#define RDB_PROTOCOL_DATUM_STREAM_EXTERNAL_SORT_HPP_
+
+#include <vector>
+
+#include "containers/disk_backed_queue.hpp"
+#include "containers/scoped.hpp"
+#include "rdb_protocol/datum_stream.hpp"
+#include "rdb_protocol/order_util.hpp"
+
+class io_backender_t;
+
+namespace ql {
+
+/* `external_sort_datum_stream_t` is what an unindexed `order_by` turns into when it
+has more rows than fit in an array.  The rows are sorted in runs of at most the array
+size limit, each run is written to its own `disk_backed_queue_t` in the server's
+temporary directory, and the stream merges the heads of the runs as it's read.  Rows
+that compare equal come out in the order they were pushed, like with
+`lt_cmp_t::sort`.
+
+Every open run costs memory, so runs are merged in tiers: whenever the last
+`EXTERNAL_SORT_MAX_FAN_IN` runs are all of the same tier, they're merged into one run
+of the next tier.  Before the stream is read, the last runs are merged until at most
+`EXTERNAL_SORT_MAX_FAN_IN` are left. */
+class external_sort_datum_stream_t : public eager_datum_stream_t {
+public:
+    external_sort_datum_stream_t(lt_cmp_t _lt_cmp, backtrace_id_t bt);
+
+    // Whether `env` has somewhere to write the runs to.  Proxies don't.
+    static bool can_spill(env_t *env);
+
+    // `run` must already be sorted with `lt_cmp`.  All the runs have to be pushed
+    // before the stream is read.
+    void push_run(env_t *env, std::vector<datum_t> &&run);
+
+    bool is_exhausted() const final;
+    feed_type_t cfeed_type() const final;
+    bool is_infinite() const final;
+
+private:
+    bool is_array() const final;
+    std::vector<datum_t>
+    next_raw_batch(env_t *env, const batchspec_t &batchspec) final;
+
+    scoped_ptr_t<disk_backed_queue_t<datum_t> > make_run_queue(env_t *env);
+    // Replaces `runs[first]` and all the runs after it with a single merged run.
+    void merge_runs(env_t *env, size_t first);
+
+    // Refills `heads[run]` from its queue, or leaves it empty if the run is done.
+    void pop_head(size_t run);
+
+    const lt_cmp_t lt_cmp;
+
+    perfmon_collection_t perfmon_collection;
+    std::vector<scoped_ptr_t<disk_backed_queue_t<datum_t> > > runs;
+    // The tier of each run in `runs`: 0 for a pushed run, and one more than the tier
+    // of the runs it was merged from otherwise.  Never increases along `runs`.
+    std::vector<size_t> run_tiers;
+    std::vector<datum_t> heads;
+    // A heap of the indices of the runs that still have a head, ordered so that the
+    // smallest head is at the front.
+    std::vector<size_t> heap;
+    bool started;
+};
+
+}  // namespace ql
+
+#endif  // RDB_PROTOCOL_DATUM_STREAM_EXTERNAL_SORT_HPP_
@@ -41,6 +41,9 @@ private:
 
     datum_t acc;
     bool do_final_emit;
+
+    // The arguments of the function calls, kept so that each row doesn't allocate.
+    std::vector<datum_t> call_args;
 };
 
 }  // namespace ql
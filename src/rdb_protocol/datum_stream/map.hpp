@@ -1,6 +1,9 @@
 #ifndef RDB_PROTOCOL_DATUM_STREAM_MAP_HPP_
 #define RDB_PROTOCOL_DATUM_STREAM_MAP_HPP_
 
+#include <deque>
+#include <vector>
+
 #include "rdb_protocol/datum_stream.hpp"
 
 namespace ql {
@@ -26,11 +29,25 @@ public:
     }
 
 private:
+    // Whether one of the streams ran out; `is_exhausted` also waits for `mapped`.
+    bool inputs_exhausted() const;
+
+    // Calls `func` on each of `calls`, spread over the server's threads when there are
+    // enough of them and `parallel` is set, and returns the results in order.
+    std::vector<datum_t> call_func(env_t *env,
+                                   std::vector<std::vector<datum_t> > &&calls);
+
     std::vector<counted_t<datum_stream_t> > streams;
     counted_t<const func_t> func;
     feed_type_t union_type;
     bool is_array_map, is_infinite_map;
 
+    // Deterministic functions over streams that aren't feeds don't depend on the
+    // thread or the order they're called in, so we can evaluate chunks of them in
+    // parallel.  The results that didn't fit in the last batch are kept in `mapped`.
+    bool parallel;
+    std::deque<datum_t> mapped;
+
     // We need to preserve this between calls because we might have gotten data
     // from a few substreams before having to abort because we timed out on a
     // changefeed stream and return a partial batch.  (We still time out and
@@ -4,6 +4,14 @@
 #include "rdb_protocol/datum_stream.hpp"
 #include "rdb_protocol/order_util.hpp"
 
+/* An ordered `union` first reads this many rows from each of its streams, and then
+each stream reads as many rows as it has given the merge so far, up to the normal batch
+size.  (Terminals read everything, so they use normal batches all along.)  That way a
+stream whose rows don't reach the front of the merge, as in a
+`union(..., {interleave: field}).limit(n)` over many tables, doesn't read whole batches
+that get thrown away. */
+#define ORDERED_UNION_FIRST_READ_ROWS 8
+
 namespace ql {
 
 class ordered_union_datum_stream_t : public eager_datum_stream_t {
@@ -44,8 +52,15 @@ private:
     struct merge_cache_item_t {
         datum_t value;
         counted_t<datum_stream_t> source;
+        size_t source_index;
     };
 
+    // The batchspec to read the next row of the `source_index`th stream with.
+    batchspec_t source_batchspec(const batchspec_t &batchspec, size_t source_index);
+    // How many rows each stream has given the merge, which decides how many it reads
+    // at once next time.
+    std::vector<uint64_t> rows_taken;
+
     cond_t non_interruptor;
     scoped_ptr_t<env_t> merge_env;
 
@@ -0,0 +1,29 @@
+#ifndef RDB_PROTOCOL_DATUM_STREAM_TEXT_SEARCH_HPP_
+#define RDB_PROTOCOL_DATUM_STREAM_TEXT_SEARCH_HPP_
+
+#include <set>
+#include <string>
+
+#include "rdb_protocol/datum_stream.hpp"
+
+namespace ql {
+
+// Keeps the documents of `_source` whose text, as the text index function `_f` computes
+// it, contains all of `_words`.
+class text_search_datum_stream_t : public wrapper_datum_stream_t {
+public:
+    text_search_datum_stream_t(counted_t<const func_t> _f,
+                               std::set<std::string> _words,
+                               counted_t<datum_stream_t> _source);
+
+private:
+    std::vector<datum_t>
+    next_raw_batch(env_t *env, const batchspec_t &batchspec);
+
+    counted_t<const func_t> f;
+    const std::set<std::string> words;
+};
+
+}  // namespace ql
+
+#endif  // RDB_PROTOCOL_DATUM_STREAM_TEXT_SEARCH_HPP_
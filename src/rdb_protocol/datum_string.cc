@@ -11,7 +11,9 @@
 #include "containers/archive/archive.hpp"
 #include "containers/archive/buffer_stream.hpp"
 #include "containers/archive/varint.hpp"
+#include "arch/compiler.hpp"
 #include "containers/scoped.hpp"
+#include "rdb_protocol/datum_allocations.hpp"
 #include "debug.hpp"
 #include "utils.hpp"
 
@@ -23,11 +25,13 @@ datum_string_t::datum_string_t(size_t _size, const char *_data) {
     init(_size, _data);
 }
 
-datum_string_t::datum_string_t(const shared_buf_ref_t<char> &_ref)
-    : data_(_ref) { }
+datum_string_t::datum_string_t(const shared_buf_ref_t<char> &_ref) {
+    new (&data_) shared_buf_ref_t<char>(_ref);
+}
 
-datum_string_t::datum_string_t(shared_buf_ref_t<char> &&_ref)
-    : data_(std::move(_ref)) { }
+datum_string_t::datum_string_t(shared_buf_ref_t<char> &&_ref) {
+    new (&data_) shared_buf_ref_t<char>(std::move(_ref));
+}
 
 datum_string_t::datum_string_t(const char *c_str) {
     init(strlen(c_str), c_str);
@@ -37,15 +41,63 @@ datum_string_t::datum_string_t(const std::string &str) {
     init(str.size(), str.data());
 }
 
+// A miss simply replaces the entry, so the cache never holds more than
+// `INTERN_CACHE_SIZE` strings per thread.  Like the thread's `rng_t`, it's allocated
+// the first time it's needed and lives until the process exits.
+static const size_t INTERN_CACHE_SIZE = 1024;
+struct datum_string_intern_cache_t {
+    datum_string_t entries[INTERN_CACHE_SIZE];
+};
+
+static THREAD_LOCAL datum_string_intern_cache_t *thread_intern_cache = nullptr;
+
+// This accesses the thread local cache directly, so it must not be inlined into a
+// function that might switch threads.  See the comment in `thread_local.hpp`.
+NOINLINE datum_string_t datum_string_t::intern(size_t _size, const char *_data) {
+    if (_size <= MAX_INLINE_SIZE || _size > MAX_INTERNED_SIZE) {
+        return datum_string_t(_size, _data);
+    }
+
+    // FNV-1a, which is good enough for a few dozen characters.
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < _size; ++i) {
+        hash = (hash ^ static_cast<uint8_t>(_data[i])) * 16777619u;
+    }
+
+    if (thread_intern_cache == nullptr) {
+        thread_intern_cache = new datum_string_intern_cache_t;
+    }
+    datum_string_t *entry = &thread_intern_cache->entries[hash % INTERN_CACHE_SIZE];
+    if (entry->size() == _size && memcmp(entry->data(), _data, _size) == 0) {
+        count_datum_allocation(datum_allocation_t::INTERNED_STRING);
+        return *entry;
+    }
+    *entry = datum_string_t(_size, _data);
+    return *entry;
+}
+
+static_assert(sizeof(datum_string_t) == sizeof(shared_buf_ref_t<char>),
+              "datum_string_t is supposed to be no larger than a shared_buf_ref_t");
+
 void datum_string_t::init(size_t _size, const char *_data) {
+    if (_size <= MAX_INLINE_SIZE) {
+        count_datum_allocation(datum_allocation_t::INLINE_STRING);
+        inline_[0] = static_cast<char>((_size << 1) | 1);
+        memcpy(inline_ + 1, _data, _size);
+        return;
+    }
+    count_datum_allocation(datum_allocation_t::HEAP_STRING);
     const size_t str_offset = varint_uint64_serialized_size(_size);
     counted_t<shared_buf_t> buffer = shared_buf_t::create(str_offset + _size);
     serialize_varint_uint64_into_buf(_size, reinterpret_cast<uint8_t *>(buffer->data()));
     memcpy(buffer->data() + str_offset, _data, _size);
-    data_ = shared_buf_ref_t<char>(std::move(buffer), 0);
+    new (&data_) shared_buf_ref_t<char>(std::move(buffer), 0);
 }
 
 const char *datum_string_t::data() const {
+    if (is_inline()) {
+        return inline_ + 1;
+    }
     const size_t str_size = size();
     size_t data_offset = varint_uint64_serialized_size(str_size);
     data_.guarantee_in_boundary(data_offset + str_size);
@@ -53,6 +105,9 @@ const char *datum_string_t::data() const {
 }
 
 size_t datum_string_t::size() const {
+    if (is_inline()) {
+        return static_cast<uint8_t>(inline_[0]) >> 1;
+    }
     uint64_t res = 0;
     static_assert(sizeof(uint8_t) == sizeof(char), "sizeof(uint8_t) != sizeof(char)");
     buffer_read_stream_t data_stream(data_.get(), data_.get_safety_boundary());
@@ -67,6 +122,10 @@ bool datum_string_t::empty() const {
 }
 
 int datum_string_t::compare(const datum_string_t &other) const {
+    // Interned strings and copies of the same string share their buffer.
+    if (!is_inline() && !other.is_inline() && data_.get() == other.data_.get()) {
+        return 0;
+    }
     return compare(other.size(), other.data());
 }
 
@@ -126,6 +185,12 @@ std::string datum_string_t::to_std() const {
 datum_string_t concat(const datum_string_t &a, const datum_string_t &b) {
     const size_t a_size = a.size();
     const size_t b_size = b.size();
+    if (a_size + b_size <= datum_string_t::MAX_INLINE_SIZE) {
+        char chars[datum_string_t::MAX_INLINE_SIZE + 1];
+        memcpy(chars, a.data(), a_size);
+        memcpy(chars + a_size, b.data(), b_size);
+        return datum_string_t(a_size + b_size, chars);
+    }
     const size_t str_offset = varint_uint64_serialized_size(a_size + b_size);
     counted_t<shared_buf_t> buf = shared_buf_t::create(str_offset + a_size + b_size);
     serialize_varint_uint64_into_buf(a_size + b_size,
@@ -2,7 +2,12 @@
 #ifndef RDB_PROTOCOL_DATUM_STRING_HPP_
 #define RDB_PROTOCOL_DATUM_STRING_HPP_
 
+#include <stdint.h>
+#include <string.h>
+
+#include <new>
 #include <string>
+#include <utility>
 
 #include "containers/archive/archive.hpp"
 #include "containers/shared_buffer.hpp"
@@ -13,7 +18,11 @@
  * - it can contain any character, including '\0'
  *
  * Underneath `datum_string_t` uses a `shared_buf_ref_t`. This makes it
- * relatively cheap to copy.
+ * relatively cheap to copy.  Strings of up to `MAX_INLINE_SIZE` bytes that aren't
+ * created from an existing buffer are stored in the `datum_string_t` itself instead,
+ * so that they need neither an allocation nor reference counting.  The pointer
+ * returned by `data()` is therefore only valid as long as the `datum_string_t` it
+ * came from, not as long as any copy of it.
  */
 class datum_string_t {
 public:
@@ -35,6 +44,21 @@ public:
     explicit datum_string_t(const shared_buf_ref_t<char> &_ref);
     explicit datum_string_t(shared_buf_ref_t<char> &&_ref);
 
+    /* Returns a string equal to `datum_string_t(_size, _data)`.  Strings that are too
+    long to be stored inline but short enough to be field names are first looked up in
+    a small per-thread cache, so that the objects on a thread that have the same
+    field name share one copy of it instead of allocating their own.  Use this for
+    object keys, not for arbitrary values. */
+    static datum_string_t intern(size_t _size, const char *_data);
+    // Interned strings are longer than `MAX_INLINE_SIZE`, but no longer than this.
+    static const size_t MAX_INTERNED_SIZE = 64;
+
+    datum_string_t(const datum_string_t &copyee);
+    datum_string_t(datum_string_t &&movee) noexcept;
+    datum_string_t &operator=(const datum_string_t &copyee);
+    datum_string_t &operator=(datum_string_t &&movee) noexcept;
+    ~datum_string_t();
+
     // The result of data() is not automatically null terminated. Do not use
     // as a C string.
     const char *data() const;
@@ -42,6 +66,9 @@ public:
     bool empty() const;
 
     int compare(const datum_string_t &other) const;
+    // Compares to a string that isn't in a `datum_string_t`, such as a key that's
+    // still in a serialized object.
+    int compare(size_t other_size, const char *other_data) const;
 
     // Short cut for comparing to C-strings and STD strings
     bool operator==(const char *other) const;
@@ -55,15 +82,68 @@ public:
 
     std::string to_std() const;
 
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    static const size_t MAX_INLINE_SIZE = sizeof(shared_buf_ref_t<char>) - 1;
+#else
+    static const size_t MAX_INLINE_SIZE = 0;
+#endif
+
 private:
     void init(size_t _size, const char *_data);
-    int compare(size_t other_size, const char *other_data) const;
 
-    // Contains the length of the string in varint encoding, followed by the actual
-    // string content.
-    shared_buf_ref_t<char> data_;
+    bool is_inline() const {
+        // The first byte of `data_` is the lowest byte of an aligned pointer (or of
+        // `nullptr` after a move), which is even on little-endian machines.
+        return MAX_INLINE_SIZE != 0 && (static_cast<uint8_t>(inline_[0]) & 1) != 0;
+    }
+
+    union {
+        // Contains the length of the string in varint encoding, followed by the
+        // actual string content.
+        shared_buf_ref_t<char> data_;
+        // `(size << 1) | 1`, followed by the string content.
+        char inline_[sizeof(shared_buf_ref_t<char>)];
+    };
 };
 
+inline datum_string_t::datum_string_t(const datum_string_t &copyee) {
+    if (copyee.is_inline()) {
+        memcpy(inline_, copyee.inline_, sizeof(inline_));
+    } else {
+        new (&data_) shared_buf_ref_t<char>(copyee.data_);
+    }
+}
+
+inline datum_string_t::datum_string_t(datum_string_t &&movee) noexcept {
+    if (movee.is_inline()) {
+        memcpy(inline_, movee.inline_, sizeof(inline_));
+    } else {
+        new (&data_) shared_buf_ref_t<char>(std::move(movee.data_));
+    }
+}
+
+inline datum_string_t &datum_string_t::operator=(const datum_string_t &copyee) {
+    if (this != &copyee) {
+        this->~datum_string_t();
+        new (this) datum_string_t(copyee);
+    }
+    return *this;
+}
+
+inline datum_string_t &datum_string_t::operator=(datum_string_t &&movee) noexcept {
+    if (this != &movee) {
+        this->~datum_string_t();
+        new (this) datum_string_t(std::move(movee));
+    }
+    return *this;
+}
+
+inline datum_string_t::~datum_string_t() {
+    if (!is_inline()) {
+        data_.~shared_buf_ref_t<char>();
+    }
+}
+
 datum_string_t concat(const datum_string_t &a, const datum_string_t &b);
 
 void debug_print(printf_buffer_t *buf, const datum_string_t &s);
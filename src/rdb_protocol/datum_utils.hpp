@@ -17,4 +17,12 @@ public:
     }
 };
 
+class datum_hash_t {
+public:
+    datum_hash_t() { }
+    size_t operator()(const ql::datum_t &d) const {
+        return d.hash();
+    }
+};
+
 #endif /* RDB_PROTOCOL_DATUM_UTILS_HPP_ */
@@ -64,6 +64,13 @@ bool datum_range_t::contains(datum_t val) const {
             || (right_cmp == 0 && right_bound_type == key_range_t::closed));
 }
 
+bool datum_range_t::is_after(datum_t val) const {
+    r_sanity_check(left_bound.has());
+
+    int left_cmp = left_bound.cmp(val);
+    return left_cmp > 0 || (left_cmp == 0 && left_bound_type == key_range_t::open);
+}
+
 bool datum_range_t::is_empty() const {
     r_sanity_check(left_bound.has() && right_bound.has());
 
@@ -107,6 +114,15 @@ key_range_t datum_range_t::to_sindex_keyrange(reql_version_t reql_version) const
         right_bound_type);
 }
 
+key_range_t datum_range_t::to_hashed_sindex_keyrange(
+        reql_version_t reql_version) const {
+    r_sanity_check(left_bound.has() && left_bound == right_bound
+                   && left_bound_type == key_range_t::closed
+                   && right_bound_type == key_range_t::closed);
+    store_key_t key = left_bound.hashed_secondary(reql_version);
+    return rdb_protocol::sindex_key_range(key, key, key_range_t::closed);
+}
+
 std::string datum_range_t::get_left_bound_trunc_key(reql_version_t reql_ver) const {
     guarantee(left_bound_type != key_range_t::bound_t::none);
     return key_to_unescaped_str(left_bound.truncated_secondary(
@@ -26,6 +26,8 @@ public:
     bool operator<(const datum_range_t &o) const;
 
     bool contains(datum_t val) const;
+    // Whether every value in the range is greater than `val`.
+    bool is_after(datum_t val) const;
     bool is_empty() const;
     bool is_universe() const;
 
@@ -35,6 +37,8 @@ public:
     // truncated sindexes.
     key_range_t to_primary_keyrange() const;
     key_range_t to_sindex_keyrange(reql_version_t reql_version) const;
+    // The keys of a hash index that can hold the value of a one-value range.
+    key_range_t to_hashed_sindex_keyrange(reql_version_t reql_version) const;
 
     // Computes the truncated keys corresponding to `left_bound`/`right_bound`
     // respectively.
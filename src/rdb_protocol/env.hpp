@@ -11,7 +11,6 @@
 #include "clustering/administration/auth/user_context.hpp"
 #include "concurrency/one_per_thread.hpp"
 #include "containers/counted.hpp"
-#include "containers/lru_cache.hpp"
 #include "extproc/js_runner.hpp"
 #include "rdb_protocol/configured_limits.hpp"
 #include "rdb_protocol/context.hpp"
@@ -25,21 +24,13 @@
 
 class extproc_pool_t;
 
-namespace re2 {
-class RE2;
-}
-
 namespace ql {
 class datum_t;
 class term_t;
+struct tracked_reads_t;
 
 scoped_ptr_t<profile::trace_t> maybe_make_profile_trace(profile_bool_t profile);
 
-struct regex_cache_t {
-    explicit regex_cache_t(size_t cache_size) : regexes(cache_size) {}
-    lru_cache_t<std::string, std::shared_ptr<re2::RE2> > regexes;
-};
-
 class env_t : public home_thread_mixin_t {
 public:
     // This is _not_ to be used for secondary index function evaluation -- it doesn't
@@ -126,8 +117,6 @@ public:
         }
     }
 
-    regex_cache_t &regex_cache() { return regex_cache_; }
-
     reql_version_t reql_version() const { return reql_version_; }
 
 private:
@@ -141,9 +130,6 @@ private:
     // earlier value.
     const reql_version_t reql_version_;
 
-    // query specific cache parameters; for example match regexes.
-    regex_cache_t regex_cache_;
-
 public:
     const return_empty_normal_batches_t return_empty_normal_batches;
 
@@ -153,6 +139,10 @@ public:
     // This is non-empty when profiling is enabled.
     profile::trace_t *const trace;
 
+    // Set while a query whose result may be cached runs, to record the tables it
+    // reads.  See `query_result_cache_t`.
+    tracked_reads_t *tracked_reads;
+
     profile_bool_t profile() const;
 
     rdb_context_t *get_rdb_ctx() { return rdb_ctx_; }
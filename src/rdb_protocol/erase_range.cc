@@ -78,9 +78,10 @@ continue_bool_t rdb_erase_small_range(
         uint64_t max_keys_to_erase,
         std::vector<rdb_modification_report_t> *mod_reports_out,
         key_range_t *deleted_out) {
-    rassert(mod_reports_out != nullptr);
     rassert(deleted_out != nullptr);
-    mod_reports_out->clear();
+    if (mod_reports_out != nullptr) {
+        mod_reports_out->clear();
+    }
     *deleted_out = key_range_t::empty();
 
     /* Step 1: Collect all keys that we want to erase using a depth-first traversal. */
@@ -102,6 +103,7 @@ continue_bool_t rdb_erase_small_range(
     rdb_value_sizer_t sizer(max_block_size);
     for (const auto &key : key_collector.get_collected_keys()) {
         promise_t<superblock_t *> pass_back_superblock_promise;
+        std::vector<char> detached_value;
         {
             keyvalue_location_t kv_location;
             find_keyvalue_location_for_write(
@@ -122,20 +124,27 @@ continue_bool_t rdb_erase_small_range(
             // is going on.
             guarantee(kv_location.value.has());
 
-            // The mod_report we generate is a simple delete. While there is generally
-            // a difference between an erase and a delete (deletes get backfilled,
-            // while an erase is as if the value had never existed), that
-            // difference is irrelevant in the case of secondary indexes.
-            rdb_modification_report_t mod_report;
-            mod_report.primary_key = key;
-            // Get the full data
             const rdb_value_t *rdb_value = kv_location.value_as<rdb_value_t>();
-            mod_report.info.deleted.first = get_data(rdb_value,
-                                                     buf_parent_t(&kv_location.buf));
-            // Get the inline value
-            mod_report.info.deleted.second.assign(rdb_value->value_ref(),
-                rdb_value->value_ref() + rdb_value->inline_size(max_block_size));
-            mod_reports_out->push_back(mod_report);
+            if (mod_reports_out != nullptr) {
+                // The mod_report we generate is a simple delete. While there is
+                // generally a difference between an erase and a delete (deletes get
+                // backfilled, while an erase is as if the value had never existed),
+                // that difference is irrelevant in the case of secondary indexes.
+                rdb_modification_report_t mod_report;
+                mod_report.primary_key = key;
+                // Get the full data
+                mod_report.info.deleted.first = get_data(
+                    rdb_value, buf_parent_t(&kv_location.buf));
+                // Get the inline value
+                mod_report.info.deleted.second.assign(rdb_value->value_ref(),
+                    rdb_value->value_ref() + rdb_value->inline_size(max_block_size));
+                mod_reports_out->push_back(mod_report);
+            } else {
+                // Nobody needs the full value, so we only keep what we need to delete
+                // its blob once it's out of the tree.
+                detached_value.assign(rdb_value->value_ref(),
+                    rdb_value->value_ref() + rdb_value->inline_size(max_block_size));
+            }
 
             // Detach the value
             deletion_context->in_tree_deleter()->delete_value(
@@ -151,6 +160,11 @@ continue_bool_t rdb_erase_small_range(
           // gets deleted.
         guarantee(pass_back_superblock_promise.wait() == superblock);
 
+        if (!detached_value.empty()) {
+            deletion_context->post_deleter()->delete_value(
+                buf_parent_t(superblock->expose_buf().txn()), detached_value.data());
+        }
+
         guarantee(key >= deleted_out->right.key());
         *deleted_out = key_range_t(key_range_t::closed, key_range.left,
                                    key_range_t::closed, key);
@@ -42,6 +42,9 @@ It returns a number of modification reports that should be applied to secondary
 separately. Blobs are detached, and should be deleted later if required (passing the
 modification reports to store_t::update_sindexes() takes care of that).
 
+If `mod_reports_out` is null, the caller has no secondary indexes to update. Then the
+erased values aren't read in full, and their blobs are deleted right away.
+
 Returns `CONTINUE` if it stopped because it collected `max_keys_to_erase` and `ABORT` if
 it stopped because it hit the end of the range. */
 continue_bool_t rdb_erase_small_range(
@@ -52,7 +55,7 @@ continue_bool_t rdb_erase_small_range(
     const deletion_context_t *deletion_context,
     signal_t *interruptor,
     uint64_t max_keys_to_erase /* 0 = unlimited */,
-    std::vector<rdb_modification_report_t> *mod_reports_out,
+    std::vector<rdb_modification_report_t> *mod_reports_out /* may be null */,
     key_range_t *deleted_out);
 
 #endif  // RDB_PROTOCOL_ERASE_RANGE_HPP_
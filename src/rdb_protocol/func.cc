@@ -33,6 +33,16 @@ scoped_ptr_t<val_t> func_t::call(env_t *env,
     return call(env, make_vector(arg1, arg2), eval_flags);
 }
 
+datum_t func_t::call_datum(env_t *env, const std::vector<datum_t> &args) const {
+    return call(env, args)->as_datum();
+}
+
+void func_t::call_on_each(env_t *env, std::vector<datum_t> *args) const {
+    for (auto it = args->begin(); it != args->end(); ++it) {
+        *it = call(env, *it)->as_datum();
+    }
+}
+
 void func_t::assert_deterministic(constant_now_t cn, const char *extra_msg) const {
     rcheck(is_deterministic().test(single_server_t::no, cn),
            base_exc_t::LOGIC,
@@ -45,7 +55,10 @@ reql_func_t::reql_func_t(const var_scope_t &_captured_scope,
     : func_t(_body->backtrace()),
       captured_scope(_captured_scope),
       arg_names(std::move(_arg_names)),
-      body(std::move(_body)) { }
+      body(std::move(_body)),
+      compiled_body(compiled_func_t::compile(body->get_src(),
+                                             arg_names,
+                                             captured_scope)) { }
 
 reql_func_t::reql_func_t(scoped_ptr_t<term_storage_t> &&_storage,
                          const var_scope_t &_captured_scope,
@@ -55,7 +68,10 @@ reql_func_t::reql_func_t(scoped_ptr_t<term_storage_t> &&_storage,
       captured_scope(_captured_scope),
       arg_names(std::move(_arg_names)),
       term_storage(std::move(_storage)),
-      body(std::move(_body)) { }
+      body(std::move(_body)),
+      compiled_body(compiled_func_t::compile(body->get_src(),
+                                             arg_names,
+                                             captured_scope)) { }
 
 reql_func_t::~reql_func_t() { }
 
@@ -75,6 +91,11 @@ scoped_ptr_t<val_t> reql_func_t::call(env_t *env,
                          arg_names.size(),
                          (arg_names.size() == 1 ? "" : "s")));
 
+        datum_t compiled_result = call_compiled(env, args, eval_flags);
+        if (compiled_result.has()) {
+            return make_scoped<val_t>(std::move(compiled_result), backtrace());
+        }
+
         var_scope_t new_scope = arg_names.size() == 0
             ? captured_scope
             : captured_scope.with_func_arg_list(arg_names, args);
@@ -87,6 +108,34 @@ scoped_ptr_t<val_t> reql_func_t::call(env_t *env,
     }
 }
 
+datum_t reql_func_t::call_compiled(env_t *env,
+                                   const std::vector<datum_t> &args,
+                                   eval_flags_t eval_flags) const {
+    // Profiled queries go through the interpreter so the profile shows every term.
+    if (!compiled_body.has()
+        || eval_flags != NO_FLAGS
+        || env->trace != nullptr
+        || args.size() != arg_names.size()) {
+        return datum_t();
+    }
+    env->maybe_yield();
+    return compiled_body->eval(args);
+}
+
+datum_t reql_func_t::call_datum(env_t *env, const std::vector<datum_t> &args) const {
+    datum_t compiled_result;
+    try {
+        compiled_result = call_compiled(env, args, NO_FLAGS);
+    } catch (const datum_exc_t &e) {
+        rfail(e.get_type(), "%s", e.what());
+        unreachable();
+    }
+    if (compiled_result.has()) {
+        return compiled_result;
+    }
+    return call(env, args, NO_FLAGS)->as_datum();
+}
+
 optional<size_t> reql_func_t::arity() const {
     return make_optional(arg_names.size());
 }
@@ -99,6 +148,77 @@ bool reql_func_t::is_simple_selector() const {
     return body->is_simple_selector();
 }
 
+optional<datum_string_t> reql_func_t::field_of_arg(const raw_term_t &term) const {
+    if (arg_names.size() != 1
+        || (term.type() != Term::BRACKET && term.type() != Term::GET_FIELD)
+        || term.num_args() != 2 || term.num_optargs() != 0) {
+        return r_nullopt;
+    }
+    raw_term_t obj = term.arg(0);
+    if (obj.type() == Term::VAR) {
+        if (obj.num_args() != 1 || obj.arg(0).type() != Term::DATUM) {
+            return r_nullopt;
+        }
+        datum_t var = obj.arg(0).datum();
+        int64_t var_id;
+        if (var.get_type() != datum_t::R_NUM
+            || !number_as_integer(var.as_num(), &var_id)
+            || var_id != arg_names[0].value) {
+            return r_nullopt;
+        }
+    } else if (obj.type() != Term::IMPLICIT_VAR
+               || !function_emits_implicit_variable(arg_names)) {
+        return r_nullopt;
+    }
+    raw_term_t field = term.arg(1);
+    if (field.type() != Term::DATUM) {
+        return r_nullopt;
+    }
+    datum_t field_datum = field.datum();
+    if (field_datum.get_type() != datum_t::R_STR) {
+        return r_nullopt;
+    }
+    return make_optional(field_datum.as_str());
+}
+
+optional<datum_string_t> reql_func_t::selected_field() const {
+    return field_of_arg(body->get_src());
+}
+
+optional<std::pair<datum_string_t, datum_t> > reql_func_t::field_equality() const {
+    const raw_term_t &src = body->get_src();
+    if (src.type() != Term::EQ || src.num_args() != 2 || src.num_optargs() != 0) {
+        return r_nullopt;
+    }
+    for (size_t i = 0; i < 2; ++i) {
+        optional<datum_string_t> field = field_of_arg(src.arg(i));
+        raw_term_t value = src.arg(1 - i);
+        if (field.has_value() && value.type() == Term::DATUM) {
+            return make_optional(std::make_pair(*field, value.datum()));
+        }
+    }
+    return r_nullopt;
+}
+
+optional<std::pair<datum_string_t, datum_t> > reql_func_t::filter_equality() const {
+    const raw_term_t &src = body->get_src();
+    if (src.type() != Term::DATUM) {
+        return field_equality();
+    }
+    datum_t predicate = src.datum();
+    if (predicate.get_type() != datum_t::R_OBJECT || predicate.is_ptype()) {
+        return r_nullopt;
+    }
+    for (size_t i = 0; i < predicate.obj_size(); ++i) {
+        auto pair = predicate.get_pair(i);
+        // `filter_match` matches nested objects field by field.
+        if (pair.second.get_type() != datum_t::R_OBJECT) {
+            return make_optional(std::make_pair(pair.first, pair.second));
+        }
+    }
+    return r_nullopt;
+}
+
 js_func_t::js_func_t(const std::string &_js_source,
                      uint64_t timeout_ms,
                      backtrace_id_t _backtrace)
@@ -136,6 +256,45 @@ scoped_ptr_t<val_t> js_func_t::call(
     }
 }
 
+void js_func_t::call_on_each(env_t *env, std::vector<datum_t> *args) const {
+    if (args->size() <= 1) {
+        func_t::call_on_each(env, args);
+        return;
+    }
+    try {
+        js_runner_t::req_config_t config;
+        config.timeout_ms = js_timeout_ms;
+
+        r_sanity_check(!js_source.empty());
+        std::vector<std::vector<datum_t> > call_args;
+        call_args.reserve(args->size());
+        for (const datum_t &arg : *args) {
+            call_args.push_back(make_vector(arg));
+        }
+        std::vector<js_result_t> results;
+
+        try {
+            results = env->get_js_runner()->call_batch(js_source, call_args, config);
+        } catch (const extproc_worker_exc_t &e) {
+            rfail(base_exc_t::INTERNAL,
+                  "Javascript query `%s` caused a crash in a worker process.",
+                  js_source.c_str());
+        }
+
+        // If a call failed, its result is the last one, and visiting it throws.
+        r_sanity_check(!results.empty() && results.size() <= args->size());
+        js_result_visitor_t visitor(js_source, js_timeout_ms, this);
+        for (size_t i = 0; i < results.size(); ++i) {
+            (*args)[i] = scoped_ptr_t<val_t>(
+                boost::apply_visitor(visitor, results[i]))->as_datum();
+        }
+        r_sanity_check(results.size() == args->size());
+    } catch (const datum_exc_t &e) {
+        rfail(e.get_type(), "%s", e.what());
+        unreachable();
+    }
+}
+
 optional<size_t> js_func_t::arity() const {
     return r_nullopt;
 }
@@ -261,7 +420,10 @@ bool filter_match(datum_t predicate, datum_t value,
 }
 
 bool reql_func_t::filter_helper(env_t *env, datum_t arg) const {
-    datum_t d = call(env, make_vector(arg), NO_FLAGS)->as_datum();
+    datum_t d = call_compiled(env, make_vector(arg), NO_FLAGS);
+    if (!d.has()) {
+        d = call(env, make_vector(arg), NO_FLAGS)->as_datum();
+    }
     if (d.get_type() == datum_t::R_OBJECT &&
         (body->get_src().type() == Term::MAKE_OBJ ||
          body->get_src().type() == Term::DATUM)) {
@@ -422,6 +584,21 @@ counted_t<const func_t> new_page_func(datum_t method, backtrace_id_t bt) {
     return counted_t<const func_t>();
 }
 
+counted_t<const func_t> new_expired_row_delete_func(
+        datum_t field, datum_t cutoff, backtrace_id_t bt) {
+    minidriver_t r(bt);
+    auto row = minidriver_t::dummy_var_t::FUNC_EXPIRY_ROW;
+    // Only times expire; other values can sort before `cutoff` too.
+    minidriver_t::reql_t is_expired =
+        ((r.var(row)[field].call(Term::TYPE_OF) == r.expr(datum_t("PTYPE<TIME>")))
+         && (r.var(row)[field] < cutoff)).default_(false);
+    compile_env_t empty_compile_env((var_visibility_t()));
+    counted_t<func_term_t> func_term =
+        make_counted<func_term_t>(&empty_compile_env,
+            r.fun(row, r.branch(is_expired, r.null(), r.var(row))).root_term());
+    return func_term->eval_to_func(var_scope_t());
+}
+
 val_t *js_result_visitor_t::operator()(const std::string &err_val) const {
     rfail_target(parent, base_exc_t::LOGIC, "%s", err_val.c_str());
     unreachable();
@@ -11,7 +11,9 @@
 #include <boost/variant/static_visitor.hpp>
 
 #include "containers/counted.hpp"
+#include "containers/scoped.hpp"
 #include "containers/uuid.hpp"
+#include "rdb_protocol/compiled_func.hpp"
 #include "rdb_protocol/datum.hpp"
 #include "rdb_protocol/env.hpp"
 #include "rdb_protocol/op.hpp"
@@ -65,10 +67,39 @@ public:
                              datum_t arg2,
                              eval_flags_t eval_flags = NO_FLAGS) const;
 
+    // Replaces each element of `args` with the datum that calling the function on it
+    // returns.  `js_func_t` does this in one round trip to its worker process.
+    virtual void call_on_each(env_t *env, std::vector<datum_t> *args) const;
+
+    // Calls the function and returns the datum it evaluates to.  Unlike
+    // `call(...)->as_datum()` this doesn't allocate a `val_t` when the function can
+    // skip its term, so callers that call it on every row, like `fold`, use this with
+    // an `args` vector that they keep between calls.
+    virtual datum_t call_datum(env_t *env, const std::vector<datum_t> &args) const;
+
     virtual bool is_simple_selector() const {
         return false;
     }
 
+    // If this function just returns a top-level field of its argument, as in
+    // `r.row('a')`, returns the name of that field.
+    virtual optional<datum_string_t> selected_field() const {
+        return r_nullopt;
+    }
+
+    // If this function compares a top-level field of its argument with a constant,
+    // as in `r.row('a').eq(1)`, returns the field and the constant.
+    virtual optional<std::pair<datum_string_t, datum_t> > field_equality() const {
+        return r_nullopt;
+    }
+
+    // If `filter` with this function only keeps rows whose top-level field equals a
+    // constant, as for `{a: 1}` or `r.row('a').eq(1)`, returns the field and the
+    // constant.  (Other fields of an object predicate might rule out more rows.)
+    virtual optional<std::pair<datum_string_t, datum_t> > filter_equality() const {
+        return r_nullopt;
+    }
+
 protected:
     explicit func_t(backtrace_id_t bt);
 
@@ -98,6 +129,8 @@ public:
         const std::vector<datum_t> &args,
         eval_flags_t eval_flags) const;
 
+    datum_t call_datum(env_t *env, const std::vector<datum_t> &args) const final;
+
     optional<size_t> arity() const;
 
     deterministic_t is_deterministic() const;
@@ -109,10 +142,21 @@ public:
 
     bool is_simple_selector() const final;
 
+    optional<datum_string_t> selected_field() const final;
+    optional<std::pair<datum_string_t, datum_t> > field_equality() const final;
+    optional<std::pair<datum_string_t, datum_t> > filter_equality() const final;
+
 private:
     template <cluster_version_t> friend class wire_func_serialization_visitor_t;
     bool filter_helper(env_t *env, datum_t arg) const;
 
+    optional<datum_string_t> field_of_arg(const raw_term_t &term) const;
+
+    // Returns an empty datum if the call has to go through `body`.
+    datum_t call_compiled(env_t *env,
+                          const std::vector<datum_t> &args,
+                          eval_flags_t eval_flags) const;
+
     // Only contains the parts of the scope that `body` uses.
     var_scope_t captured_scope;
 
@@ -126,6 +170,9 @@ private:
     // The body of the function, which gets ->eval(...) called when call(...) is called.
     counted_t<const term_t> body;
 
+    // `body` in a form that evaluates without the interpreter, if it's simple enough.
+    scoped_ptr_t<const compiled_func_t> compiled_body;
+
     DISABLE_COPYING(reql_func_t);
 };
 
@@ -142,6 +189,8 @@ public:
                              const std::vector<datum_t> &args,
                              eval_flags_t eval_flags) const;
 
+    void call_on_each(env_t *env, std::vector<datum_t> *args) const;
+
     optional<size_t> arity() const;
 
     deterministic_t is_deterministic() const;
@@ -179,6 +228,11 @@ counted_t<const func_t> new_get_field_func(datum_t obj, backtrace_id_t bt);
 counted_t<const func_t> new_eq_comparison_func(datum_t obj, backtrace_id_t bt);
 counted_t<const func_t> new_page_func(datum_t method, backtrace_id_t bt);
 
+// Used by table expiry: a replace function that deletes rows whose `field` holds a
+// time before `cutoff`, and returns every other row unchanged.
+counted_t<const func_t> new_expired_row_delete_func(
+    datum_t field, datum_t cutoff, backtrace_id_t bt);
+
 class js_result_visitor_t : public boost::static_visitor<val_t *> {
 public:
     js_result_visitor_t(const std::string &_code,
@@ -1,43 +1,44 @@
 // Copyright 2010-2014 RethinkDB, all rights reserved.
 #include "rdb_protocol/geo/distances.hpp"
 
-#include "rdb_protocol/geo/ellipsoid.hpp"
+#include <math.h>
+
 #include "rdb_protocol/geo/exceptions.hpp"
 #include "rdb_protocol/geo/geojson.hpp"
 #include "rdb_protocol/geo/geo_visitor.hpp"
-#include "rdb_protocol/geo/karney/geodesic.h"
 #include "rdb_protocol/geo/s2/s2.h"
 #include "rdb_protocol/geo/s2/s2latlng.h"
 #include "rdb_protocol/geo/s2/s2latlngrect.h"
 #include "rdb_protocol/geo/s2/s2polygon.h"
 #include "rdb_protocol/geo/s2/s2polyline.h"
 
-double geodesic_distance(const lon_lat_point_t &p1,
-                         const lon_lat_point_t &p2,
-                         const ellipsoid_spec_t &e) {
+geodesic_solver_t::geodesic_solver_t(const ellipsoid_spec_t &e) : ellipsoid_(e) {
     // Use Karney's algorithm
-    struct geod_geodesic g;
-    geod_init(&g, e.equator_radius(), e.flattening());
+    geod_init(&geod_, e.equator_radius(), e.flattening());
+}
 
+double geodesic_solver_t::distance(const lon_lat_point_t &p1,
+                                   const lon_lat_point_t &p2) const {
     double dist;
-    geod_inverse(&g, p1.latitude, p1.longitude, p2.latitude, p2.longitude, &dist, NULL, NULL);
+    geod_inverse(&geod_, p1.latitude, p1.longitude, p2.latitude, p2.longitude,
+                 &dist, NULL, NULL);
 
     return dist;
 }
 
-double geodesic_distance(const geo::S2Point &p,
-                         const ql::datum_t &g,
-                         const ellipsoid_spec_t &e) {
+double geodesic_solver_t::distance(const geo::S2Point &p,
+                                   const ql::datum_t &g) const {
     class distance_estimator_t : public s2_geo_visitor_t<double> {
     public:
         distance_estimator_t(
-                lon_lat_point_t r, const geo::S2Point &r_s2, const ellipsoid_spec_t &_e)
-            : ref_(r), ref_s2_(r_s2), e_(_e) { }
+                lon_lat_point_t r, const geo::S2Point &r_s2,
+                const geodesic_solver_t *_solver)
+            : ref_(r), ref_s2_(r_s2), solver_(_solver) { }
         double on_point(const geo::S2Point &point) {
             lon_lat_point_t llpoint =
                 lon_lat_point_t(geo::S2LatLng::Longitude(point).degrees(),
                                 geo::S2LatLng::Latitude(point).degrees());
-            return geodesic_distance(ref_, llpoint, e_);
+            return solver_->distance(ref_, llpoint);
         }
         double on_line(const geo::S2Polyline &line) {
             // This sometimes over-estimates large distances, because the
@@ -51,7 +52,7 @@ double geodesic_distance(const geo::S2Point &p,
                 lon_lat_point_t llprj =
                     lon_lat_point_t(geo::S2LatLng::Longitude(prj).degrees(),
                                     geo::S2LatLng::Latitude(prj).degrees());
-                return geodesic_distance(ref_, llprj, e_);
+                return solver_->distance(ref_, llprj);
             }
         }
         double on_polygon(const geo::S2Polygon &polygon) {
@@ -65,7 +66,7 @@ double geodesic_distance(const geo::S2Point &p,
                 lon_lat_point_t llprj =
                     lon_lat_point_t(geo::S2LatLng::Longitude(prj).degrees(),
                                     geo::S2LatLng::Latitude(prj).degrees());
-                return geodesic_distance(ref_, llprj, e_);
+                return solver_->distance(ref_, llprj);
             }
         }
         double on_latlngrect(const geo::S2LatLngRect &) {
@@ -73,29 +74,71 @@ double geodesic_distance(const geo::S2Point &p,
         }
         lon_lat_point_t ref_;
         const geo::S2Point &ref_s2_;
-        const ellipsoid_spec_t &e_;
+        const geodesic_solver_t *solver_;
     };
     distance_estimator_t estimator(
             lon_lat_point_t(geo::S2LatLng::Longitude(p).degrees(),
                             geo::S2LatLng::Latitude(p).degrees()),
-        p, e);
+        p, this);
     return visit_geojson(&estimator, g);
 }
 
-lon_lat_point_t geodesic_point_at_dist(const lon_lat_point_t &p,
-                                       double dist,
-                                       double azimuth,
-                                       const ellipsoid_spec_t &e) {
-    // Use Karney's algorithm
-    struct geod_geodesic g;
-    geod_init(&g, e.equator_radius(), e.flattening());
+// The Earth-centered cartesian coordinates of `p` on `e`.
+static void to_cartesian(const lon_lat_point_t &p, const ellipsoid_spec_t &e,
+                         double *x, double *y, double *z) {
+    const double lat = p.latitude * (M_PI / 180.0);
+    const double lon = p.longitude * (M_PI / 180.0);
+    const double f = e.flattening();
+    const double e2 = f * (2.0 - f);
+    const double sin_lat = sin(lat);
+    const double cos_lat = cos(lat);
+    // The radius of curvature in the prime vertical
+    const double n = e.equator_radius() / sqrt(1.0 - e2 * sin_lat * sin_lat);
+    *x = n * cos_lat * cos(lon);
+    *y = n * cos_lat * sin(lon);
+    *z = n * (1.0 - e2) * sin_lat;
+}
+
+double geodesic_solver_t::distance_lower_bound(const lon_lat_point_t &p1,
+                                               const lon_lat_point_t &p2) const {
+    double x1, y1, z1, x2, y2, z2;
+    to_cartesian(p1, ellipsoid_, &x1, &y1, &z1);
+    to_cartesian(p2, ellipsoid_, &x2, &y2, &z2);
+    const double dx = x1 - x2;
+    const double dy = y1 - y2;
+    const double dz = z1 - z2;
+    // Leave some room for rounding errors, so this stays a lower bound.
+    return sqrt(dx * dx + dy * dy + dz * dz) * (1.0 - 1e-9);
+}
 
+lon_lat_point_t geodesic_solver_t::point_at_dist(const lon_lat_point_t &p,
+                                                 double dist,
+                                                 double azimuth) const {
     double lat, lon;
-    geod_direct(&g, p.latitude, p.longitude, azimuth, dist, &lat, &lon, NULL);
+    geod_direct(&geod_, p.latitude, p.longitude, azimuth, dist, &lat, &lon, NULL);
 
     return lon_lat_point_t(lon, lat);
 }
 
+double geodesic_distance(const lon_lat_point_t &p1,
+                         const lon_lat_point_t &p2,
+                         const ellipsoid_spec_t &e) {
+    return geodesic_solver_t(e).distance(p1, p2);
+}
+
+double geodesic_distance(const geo::S2Point &p,
+                         const ql::datum_t &g,
+                         const ellipsoid_spec_t &e) {
+    return geodesic_solver_t(e).distance(p, g);
+}
+
+lon_lat_point_t geodesic_point_at_dist(const lon_lat_point_t &p,
+                                       double dist,
+                                       double azimuth,
+                                       const ellipsoid_spec_t &e) {
+    return geodesic_solver_t(e).point_at_dist(p, dist, azimuth);
+}
+
 dist_unit_t parse_dist_unit(const std::string &s) {
     if (s == "m") {
         return dist_unit_t::M;
@@ -6,6 +6,8 @@
 #include <utility>
 
 #include "containers/counted.hpp"
+#include "rdb_protocol/geo/ellipsoid.hpp"
+#include "rdb_protocol/geo/karney/geodesic.h"
 #include "rdb_protocol/geo/lon_lat_types.hpp"
 #include "rdb_protocol/geo/s2/util/math/vector3.h"
 
@@ -13,11 +15,40 @@ namespace geo {
 typedef Vector3_d S2Point;
 }
 
-class ellipsoid_spec_t;
 namespace ql {
 class datum_t;
 }
 
+/* Solves geodesic problems on one ellipsoid.  Setting Karney's algorithm up for an
+ellipsoid takes about as long as solving a problem with it, so code that solves many
+problems on the same ellipsoid should keep one of these around instead of calling the
+functions below each time. */
+class geodesic_solver_t {
+public:
+    explicit geodesic_solver_t(const ellipsoid_spec_t &e);
+
+    const ellipsoid_spec_t &ellipsoid() const { return ellipsoid_; }
+
+    // See `geodesic_distance()` below.
+    double distance(const lon_lat_point_t &p1, const lon_lat_point_t &p2) const;
+    double distance(const geo::S2Point &p, const ql::datum_t &g) const;
+
+    // A lower bound of `distance(p1, p2)`, which is the length of the straight line
+    // between the points.  It's within about 0.1% of the distance for points up to
+    // 1000km apart, and only takes some trigonometry and a square root, so it can
+    // rule out far away points before computing their distance.
+    double distance_lower_bound(
+        const lon_lat_point_t &p1, const lon_lat_point_t &p2) const;
+
+    // See `geodesic_point_at_dist()` below.
+    lon_lat_point_t point_at_dist(
+        const lon_lat_point_t &p, double dist, double azimuth) const;
+
+private:
+    ellipsoid_spec_t ellipsoid_;
+    struct geod_geodesic geod_;
+};
+
 // Returns the ellipsoidal distance between p1 and p2 on e (in meters).
 // (solves the inverse geodesic problem)
 double geodesic_distance(const lon_lat_point_t &p1,
@@ -1,7 +1,9 @@
 // Copyright 2010-2016 RethinkDB, all rights reserved.
 #include "rdb_protocol/geo/indexing.hpp"
 
+#include <algorithm>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "btree/keys.hpp"
@@ -313,11 +315,28 @@ void geo_index_traversal_helper_t::init_query(
         const std::vector<geo::S2CellId> &query_interior_cell_covering) {
     guarantee(!is_initialized_);
     rassert(query_cells_.empty());
-    query_cells_ = query_cell_covering;
-    query_interior_cells_ = query_interior_cell_covering;
+    query_cells_ = to_cell_ranges(query_cell_covering);
+    query_interior_cells_ = to_cell_ranges(query_interior_cell_covering);
     is_initialized_ = true;
 }
 
+geo_index_traversal_helper_t::cell_ranges_t
+geo_index_traversal_helper_t::to_cell_ranges(std::vector<S2CellId> cells) {
+    std::sort(cells.begin(), cells.end());
+    cell_ranges_t result;
+    for (const auto &cell : cells) {
+        // Leaf cell IDs are odd, so the leaf cell after `x` is `x + 2`.
+        if (!result.empty()
+            && cell.range_min().id() <= result.back().second.id() + 2) {
+            // `cell` overlaps with or follows the last range.
+            result.back().second = std::max(result.back().second, cell.range_max());
+        } else {
+            result.push_back(std::make_pair(cell.range_min(), cell.range_max()));
+        }
+    }
+    return result;
+}
+
 continue_bool_t
 geo_index_traversal_helper_t::handle_pair(
     scoped_key_value_t &&keyvalue,
@@ -390,32 +409,26 @@ bool geo_index_traversal_helper_t::any_query_cell_intersects(
 }
 
 bool geo_index_traversal_helper_t::any_cell_intersects(
-        const std::vector<S2CellId> &cells,
-        const S2CellId left_min, const S2CellId right_max) {
-    // Check if any of the cells intersects with the given range
-    for (const auto &cell : cells) {
-        if (cell_intersects_with_range(cell, left_min, right_max)) {
-            return true;
-        }
-    }
-    return false;
-}
-
-bool geo_index_traversal_helper_t::cell_intersects_with_range(
-        const S2CellId c,
+        const cell_ranges_t &cells,
         const S2CellId left_min, const S2CellId right_max) {
-    return left_min <= c.range_max() && right_max >= c.range_min();
+    // The first range that doesn't end before `left_min` is the only one that can
+    // intersect with [left_min, right_max] without a range before it doing so too.
+    auto it = std::lower_bound(
+        cells.begin(), cells.end(), left_min,
+        [](const std::pair<S2CellId, S2CellId> &range, const S2CellId &id) {
+            return range.second < id;
+        });
+    return it != cells.end() && it->first <= right_max;
 }
 
 bool geo_index_traversal_helper_t::any_cell_contains(
-        const std::vector<S2CellId> &cells,
+        const cell_ranges_t &cells,
         const S2CellId key) {
-    // Check if any of the cells contains `key`
-    for (const auto &cell : cells) {
-        if (cell.contains(key)) {
-            return true;
-        }
-    }
-    return false;
+    auto it = std::lower_bound(
+        cells.begin(), cells.end(), key.range_max(),
+        [](const std::pair<S2CellId, S2CellId> &range, const S2CellId &id) {
+            return range.second < id;
+        });
+    return it != cells.end() && it->first <= key.range_min();
 }
 
@@ -3,6 +3,7 @@
 #define RDB_PROTOCOL_GEO_INDEXING_HPP_
 
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "btree/concurrent_traversal.hpp"
@@ -76,19 +77,23 @@ public:
             bool *skip_out);
 
 private:
-    static bool cell_intersects_with_range(const geo::S2CellId c,
-                                           const geo::S2CellId left_min,
-                                           const geo::S2CellId right_max);
+    /* A covering as sorted, disjoint ranges of leaf cells, from the `range_min()` to
+    the `range_max()` of the cells.  Cells that are next to each other in the key space
+    are merged into a single range, so that we can look cells up with a binary search
+    however many there are. */
+    typedef std::vector<std::pair<geo::S2CellId, geo::S2CellId> > cell_ranges_t;
+    static cell_ranges_t to_cell_ranges(std::vector<geo::S2CellId> cells);
+
     bool any_query_cell_intersects(const btree_key_t *left_excl_or_null,
                                    const btree_key_t *right_incl) const;
-    static bool any_cell_intersects(const std::vector<geo::S2CellId> &cells,
+    static bool any_cell_intersects(const cell_ranges_t &cells,
                                     const geo::S2CellId left_min,
                                     const geo::S2CellId right_max);
-    static bool any_cell_contains(const std::vector<geo::S2CellId> &cells,
+    static bool any_cell_contains(const cell_ranges_t &cells,
                                   const geo::S2CellId key);
 
-    std::vector<geo::S2CellId> query_cells_;
-    std::vector<geo::S2CellId> query_interior_cells_;
+    cell_ranges_t query_cells_;
+    cell_ranges_t query_interior_cells_;
     bool is_initialized_;
     const ql::skey_version_t skey_version_;
     const signal_t *interruptor_;
@@ -32,9 +32,10 @@ lon_lat_line_t build_circle(
     lon_lat_line_t result;
     result.reserve(num_vertices + 1);
 
+    const geodesic_solver_t solver(e);
     for (unsigned int i = 0; i < num_vertices; ++i) {
         double azimuth = -180.0 + (360.0 / num_vertices * i);
-        lon_lat_point_t v = geodesic_point_at_dist(center, radius, azimuth, e);
+        lon_lat_point_t v = solver.point_at_dist(center, radius, azimuth);
         result.push_back(v);
     }
 
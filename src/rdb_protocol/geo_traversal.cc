@@ -3,6 +3,7 @@
 
 #include <cmath>
 
+#include "arch/runtime/resource_usage.hpp"
 #include "rdb_protocol/batching.hpp"
 #include "rdb_protocol/configured_limits.hpp"
 #include "rdb_protocol/datum.hpp"
@@ -137,6 +138,9 @@ continue_bool_t geo_intersecting_cb_t::on_candidate(
     ql::datum_t val = row.get();
     slice->stats.pm_keys_read.record();
     slice->stats.pm_total_keys_read += 1;
+    if (resource_usage_t *usage = current_resource_usage()) {
+        ++usage->rows_scanned;
+    }
     guarantee(!row.references_parent());
     keyvalue.reset();
 
@@ -176,8 +180,9 @@ continue_bool_t geo_intersecting_cb_t::on_candidate(
 
         // TODO (daniel): This is a little inefficient because we re-parse
         // the query_geometry for each test.
-        if ((definitely_intersects || geo_does_intersect(query_geometry, sindex_val))
-            && post_filter(sindex_val, val)) {
+        const bool intersects =
+            definitely_intersects || geo_does_intersect(query_geometry, sindex_val);
+        if (intersects && post_filter(sindex_val, val)) {
             if (distinct_emitted->size() >= env->limits().array_size_limit()) {
                 emit_error(ql::exc_t(ql::base_exc_t::RESOURCE,
                     "Array size limit exceeded during geospatial index traversal.",
@@ -189,6 +194,9 @@ continue_bool_t geo_intersecting_cb_t::on_candidate(
                                std::move(store_key),
                                std::move(val));
         } else {
+            if (intersects) {
+                on_filtered_out(primary_and_tag, sindex_val, std::move(val));
+            }
             // Mark the document as processed so we don't have to load it again.
             // This is relevant only for polygons and lines, since those can be
             // encountered multiple times in the index.
@@ -274,7 +282,9 @@ nearest_traversal_state_t::nearest_traversal_state_t(
     center(_center),
     max_results(_max_results),
     max_radius(_max_radius),
-    reference_ellipsoid(_reference_ellipsoid) { }
+    reference_ellipsoid(_reference_ellipsoid),
+    solver(_reference_ellipsoid),
+    center_s2(S2LatLng::FromDegrees(_center.latitude, _center.longitude).ToPoint()) { }
 
 continue_bool_t nearest_traversal_state_t::proceed_to_next_batch() {
     // Estimate the result density based on the previous batch
@@ -321,6 +331,26 @@ nearest_traversal_cb_t::nearest_traversal_cb_t(
     geo_intersecting_cb_t(_slice, std::move(_sindex), _env, &_state->distinct_emitted),
     state(_state) {
     init_query_geometry();
+    use_deferred(_env);
+}
+
+void nearest_traversal_cb_t::use_deferred(ql::env_t *env) {
+    for (auto it = state->deferred.begin(); it != state->deferred.end();) {
+        if (it->second.first <= state->current_inradius) {
+            if (state->distinct_emitted.size() >= env->limits().array_size_limit()) {
+                emit_error(ql::exc_t(ql::base_exc_t::RESOURCE,
+                    "Array size limit exceeded during geospatial index traversal.",
+                    ql::backtrace_id_t::empty()));
+                return;
+            }
+            state->distinct_emitted.insert(it->first);
+            result_acc.push_back(std::move(it->second));
+            state->deferred.erase(it++);
+        } else {
+            mark_processed(it->first);
+            ++it;
+        }
+    }
 }
 
 void nearest_traversal_cb_t::init_query_geometry() {
@@ -378,29 +408,54 @@ bool nearest_traversal_cb_t::post_filter(
         const ql::datum_t &sindex_val,
         UNUSED const ql::datum_t &val)
         THROWS_ONLY(interrupted_exc_t, ql::base_exc_t, geo_exception_t) {
+    last_distance = r_nullopt;
+
+    // Most documents are points, and most of the ones that are outside of the current
+    // inradius can be ruled out without computing their exact distance.
+    if (sindex_val.get_field("type").as_str() == "Point") {
+        const lon_lat_point_t point = extract_lon_lat_point(sindex_val);
+        if (state->solver.distance_lower_bound(state->center, point)
+            > state->current_inradius) {
+            return false;
+        }
+        last_distance = make_optional(state->solver.distance(state->center, point));
+    } else {
+        last_distance =
+            make_optional(state->solver.distance(state->center_s2, sindex_val));
+    }
 
     // Filter out results that are outside of the current inradius
-    const S2Point s2center =
-        S2LatLng::FromDegrees(state->center.latitude, state->center.longitude).ToPoint();
-    const double dist = geodesic_distance(s2center, sindex_val, state->reference_ellipsoid);
-    return dist <= state->current_inradius;
+    return *last_distance <= state->current_inradius;
 }
 
 continue_bool_t nearest_traversal_cb_t::emit_result(
-        ql::datum_t &&sindex_val,
+        UNUSED ql::datum_t &&sindex_val,
         UNUSED store_key_t &&key,
         ql::datum_t &&val)
         THROWS_ONLY(interrupted_exc_t, ql::base_exc_t, geo_exception_t) {
-    // TODO (daniel): Could we avoid re-computing the distance? We have already
-    //   done it in post_filter().
-    const S2Point s2center =
-        S2LatLng::FromDegrees(state->center.latitude, state->center.longitude).ToPoint();
-    const double dist = geodesic_distance(s2center, sindex_val, state->reference_ellipsoid);
-    result_acc.push_back(std::make_pair(dist, std::move(val)));
+    // `post_filter()` accepted the document, so it has computed its distance.
+    guarantee(last_distance.has_value());
+    result_acc.push_back(std::make_pair(*last_distance, std::move(val)));
 
     return continue_bool_t::CONTINUE;
 }
 
+void nearest_traversal_cb_t::on_filtered_out(
+        const std::pair<store_key_t, optional<uint64_t> > &primary_and_tag,
+        const ql::datum_t &sindex_val,
+        ql::datum_t &&val)
+        THROWS_ONLY(interrupted_exc_t, ql::base_exc_t, geo_exception_t) {
+    // `post_filter()` rejected the document because it's too far away for this batch,
+    // but a later batch is going to want it.
+    if (state->deferred.size() < MAX_PROCESSED_SET_SIZE) {
+        const double dist = last_distance.has_value()
+            ? *last_distance
+            : state->solver.distance(state->center_s2, sindex_val);
+        state->deferred.insert(
+            std::make_pair(primary_and_tag, std::make_pair(dist, std::move(val))));
+    }
+}
+
 void nearest_traversal_cb_t::emit_error(
         const ql::exc_t &_error)
         THROWS_ONLY(interrupted_exc_t) {
@@ -2,6 +2,7 @@
 #ifndef RDB_PROTOCOL_GEO_TRAVERSAL_HPP_
 #define RDB_PROTOCOL_GEO_TRAVERSAL_HPP_
 
+#include <map>
 #include <set>
 #include <utility>
 #include <vector>
@@ -14,6 +15,7 @@
 #include "containers/optional.hpp"
 #include "containers/scoped.hpp"
 #include "rdb_protocol/batching.hpp"
+#include "rdb_protocol/geo/distances.hpp"
 #include "rdb_protocol/geo/ellipsoid.hpp"
 #include "rdb_protocol/geo/exceptions.hpp"
 #include "rdb_protocol/geo/indexing.hpp"
@@ -111,6 +113,20 @@ protected:
             const ql::exc_t &error)
             THROWS_ONLY(interrupted_exc_t) = 0;
 
+    // Called for documents that intersect with the query geometry but that
+    // `post_filter()` rejected.
+    virtual void on_filtered_out(
+            UNUSED const std::pair<store_key_t, optional<uint64_t> > &primary_and_tag,
+            UNUSED const ql::datum_t &sindex_val,
+            UNUSED ql::datum_t &&val)
+            THROWS_ONLY(interrupted_exc_t, ql::base_exc_t, geo_exception_t) { }
+
+    // Makes the traversal skip the document without loading it.
+    void mark_processed(
+            const std::pair<store_key_t, optional<uint64_t> > &primary_and_tag) {
+        already_processed.insert(primary_and_tag);
+    }
+
 private:
     btree_slice_t *slice;
     geo_sindex_data_t sindex;
@@ -183,6 +199,11 @@ private:
 
     /* State that changes over time */
     std::set<std::pair<store_key_t, optional<uint64_t> > > distinct_emitted;
+    // Documents that an earlier batch read but found to be too far away, with their
+    // distance, up to some limit.  Later batches use them instead of reading them
+    // again.
+    std::map<std::pair<store_key_t, optional<uint64_t> >,
+             std::pair<double, ql::datum_t> > deferred;
     size_t previous_size;
     // Which radius around `center` has been previously processed?
     double processed_inradius;
@@ -193,6 +214,8 @@ private:
     const uint64_t max_results;
     const double max_radius;
     const ellipsoid_spec_t reference_ellipsoid;
+    const geodesic_solver_t solver;
+    const geo::S2Point center_s2;
 };
 
 // Generates a batch of results, sorted by increasing distance.
@@ -222,8 +245,22 @@ protected:
             const ql::exc_t &error)
             THROWS_ONLY(interrupted_exc_t);
 
+    void on_filtered_out(
+            const std::pair<store_key_t, optional<uint64_t> > &primary_and_tag,
+            const ql::datum_t &sindex_val,
+            ql::datum_t &&val)
+            THROWS_ONLY(interrupted_exc_t, ql::base_exc_t, geo_exception_t);
+
 private:
     void init_query_geometry();
+    // Emits the deferred documents that are close enough for this batch, and makes
+    // the traversal skip the ones that still aren't.
+    void use_deferred(ql::env_t *env);
+
+    // The distance of the document that `post_filter()` was last called on, which
+    // `emit_result()` and `on_filtered_out()` get called on next.  It's empty if
+    // `post_filter()` could tell that the document is too far away without it.
+    optional<double> last_distance;
 
     // Accumulate results for the current batch until finish() is called
     std::vector<std::pair<double, ql::datum_t> > result_acc;
@@ -7,9 +7,10 @@
 
 ql::datum_t get_data(const rdb_value_t *value, buf_parent_t parent) {
     // TODO: Just use deserialize_from_blob?
-    rdb_blob_wrapper_t blob(parent.cache()->max_block_size(),
+    const max_block_size_t bs = parent.cache()->max_block_size();
+    rdb_blob_wrapper_t blob(bs,
                             const_cast<rdb_value_t *>(value)->value_ref(),
-                            blob::btree_maxreflen);
+                            blob::btree_maxreflen_for(bs));
 
     ql::datum_t data;
 
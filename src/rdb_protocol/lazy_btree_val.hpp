@@ -11,11 +11,11 @@ struct rdb_value_t {
 
 public:
     int inline_size(max_block_size_t bs) const {
-        return blob::ref_size(bs, contents, blob::btree_maxreflen);
+        return blob::ref_size(bs, contents, blob::btree_maxreflen_for(bs));
     }
 
-    int64_t value_size() const {
-        return blob::value_size(contents, blob::btree_maxreflen);
+    int64_t value_size(max_block_size_t bs) const {
+        return blob::value_size(contents, blob::btree_maxreflen_for(bs));
     }
 
     const char *value_ref() const {
@@ -51,7 +51,8 @@ public:
         FUNC_EQCOMPARISON,
         FUNC_PAGE,
         DISTINCT_ROW,
-        REPLACE_HELPER_ROW
+        REPLACE_HELPER_ROW,
+        FUNC_EXPIRY_ROW
     };
 
     /** reql_t
@@ -176,7 +177,7 @@ public:
 
     template <class T>
     reql_t error(T &&message) {
-        return reql_t(Term::ERROR, std::forward<T>(message));
+        return reql_t(this, Term::ERROR, std::forward<T>(message));
     }
 
     template <class Cond, class Then, class Else>
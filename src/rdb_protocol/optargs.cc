@@ -47,6 +47,7 @@ static const std::set<std::string> acceptable_optargs({
     "binary_format",
     "changefeed_queue_size",
     "conflict",
+    "credits",
     "data",
     "db",
     "default",
@@ -79,6 +80,7 @@ static const std::set<std::string> acceptable_optargs({
     "max_dist",
     "max_results",
     "method",
+    "min_batch_bytes",
     "min_batch_rows",
     "multi",
     "non_atomic",
@@ -91,10 +93,12 @@ static const std::set<std::string> acceptable_optargs({
     "params",
     "primary_key",
     "primary_replica_tag",
+    "priority",
     "profile",
     "read_mode",
     "redirects",
     "replicas",
+    "result_cache",
     "result_format",
     "return_changes",
     "return_vals",
@@ -1,6 +1,10 @@
 // Copyright 2010-2015 RethinkDB, all rights reserved.
 #include "rdb_protocol/order_util.hpp"
 
+#include <algorithm>
+#include <exception>
+#include <map>
+#include <numeric>
 #include <string>
 #include <utility>
 
@@ -141,4 +145,111 @@ bool lt_cmp_t::operator()(env_t *env,
     return false;
 }
 
+void lt_cmp_t::sort(env_t *env,
+                    profile::sampler_t *sampler,
+                    std::vector<datum_t> *data) const {
+    const size_t num_rows = data->size();
+    const size_t num_comparisons = comparisons.size();
+    if (num_rows < 2) {
+        // `std::stable_sort` wouldn't call the comparator either.
+        return;
+    }
+
+    // `values[row * num_comparisons + i]` is the result of the `i`th function for the
+    // row, or uninitialized if the row doesn't have the field.  Other errors are kept in
+    // `errors` and rethrown when a comparison gets to them.
+    std::vector<datum_t> values(num_rows * num_comparisons);
+    std::map<size_t, std::exception_ptr> errors;
+    for (size_t row = 0; row < num_rows; ++row) {
+        if (sampler != nullptr) {
+            sampler->new_sample();
+        }
+        for (size_t i = 0; i < num_comparisons; ++i) {
+            try {
+                values[row * num_comparisons + i] =
+                    comparisons[i].second->call(env, (*data)[row])->as_datum();
+            } catch (const base_exc_t &e) {
+                if (e.get_type() != base_exc_t::NON_EXISTENCE) {
+                    errors[row * num_comparisons + i] = std::current_exception();
+                }
+            }
+        }
+    }
+
+    std::vector<size_t> order(num_rows);
+    std::iota(order.begin(), order.end(), 0);
+
+    std::vector<std::string> keys;
+    if (errors.empty()) {
+        keys.resize(num_rows);
+        for (size_t row = 0; row < num_rows && !keys.empty(); ++row) {
+            for (size_t i = 0; i < num_comparisons; ++i) {
+                const datum_t &value = values[row * num_comparisons + i];
+                const size_t start = keys[row].size();
+                if (!value.has()) {
+                    // Missing values sort before everything else.
+                    keys[row].push_back('\0');
+                } else if (!value.append_sort_key(&keys[row])) {
+                    keys.clear();
+                    break;
+                }
+                if (comparisons[i].first == DESC) {
+                    // The keys are prefix-free, so inverting them reverses their order.
+                    for (size_t j = start; j < keys[row].size(); ++j) {
+                        keys[row][j] = ~keys[row][j];
+                    }
+                }
+            }
+        }
+    }
+
+    if (!keys.empty()) {
+        std::stable_sort(order.begin(), order.end(), [&](size_t l, size_t r) {
+                return keys[l] < keys[r];
+            });
+    } else {
+        std::stable_sort(order.begin(), order.end(), [&](size_t l, size_t r) {
+                for (size_t i = 0; i < num_comparisons; ++i) {
+                    const size_t l_index = l * num_comparisons + i;
+                    const size_t r_index = r * num_comparisons + i;
+                    if (!errors.empty()) {
+                        auto l_error = errors.find(l_index);
+                        if (l_error != errors.end()) {
+                            std::rethrow_exception(l_error->second);
+                        }
+                        auto r_error = errors.find(r_index);
+                        if (r_error != errors.end()) {
+                            std::rethrow_exception(r_error->second);
+                        }
+                    }
+                    const datum_t &lval = values[l_index];
+                    const datum_t &rval = values[r_index];
+                    const bool desc = comparisons[i].first == DESC;
+                    if (!lval.has() && !rval.has()) {
+                        continue;
+                    }
+                    if (!lval.has()) {
+                        return true != desc;
+                    }
+                    if (!rval.has()) {
+                        return false != desc;
+                    }
+                    int cmp_res = lval.cmp(rval);
+                    if (cmp_res == 0) {
+                        continue;
+                    }
+                    return (cmp_res < 0) != desc;
+                }
+                return false;
+            });
+    }
+
+    std::vector<datum_t> sorted;
+    sorted.reserve(num_rows);
+    for (size_t row : order) {
+        sorted.push_back(std::move((*data)[row]));
+    }
+    *data = std::move(sorted);
+}
+
 } // namespace ql
@@ -5,6 +5,7 @@
 
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "errors.hpp"
 
@@ -54,6 +55,16 @@ public:
                     datum_t l,
                     datum_t r) const;
 
+    /* Sorts `data` the way `std::stable_sort` with this comparator would, but calls
+    the functions only once per row instead of once per comparison.  When all the
+    values are null, booleans, numbers or strings, the rows are sorted by their
+    concatenated `append_sort_key`s instead of with `datum_t::cmp`.  Errors from the
+    functions are only thrown if the sort needs the value that caused them, like when
+    they're called from the comparator. */
+    void sort(env_t *env,
+              profile::sampler_t *sampler,
+              std::vector<datum_t> *data) const;
+
 private:
     const std::vector<std::pair<order_direction_t, counted_t<const func_t> > >
         comparisons;
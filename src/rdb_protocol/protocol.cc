@@ -13,6 +13,7 @@
 #include "containers/archive/boost_types.hpp"
 #include "containers/archive/optional.hpp"
 #include "containers/disk_backed_queue.hpp"
+#include "random.hpp"
 #include "rdb_protocol/btree.hpp"
 #include "rdb_protocol/changefeed.hpp"
 #include "rdb_protocol/distribution_progress.hpp"
@@ -143,7 +144,8 @@ void resume_construct_sindex(
                             store->base_path_,
                             "post_construction_" + uuid_to_str(post_construct_id)),
                         &store->perfmon_collection,
-                        MAX_MOD_QUEUE_MEMORY_BYTES));
+                        MAX_MOD_QUEUE_MEMORY_BYTES,
+                        disk_queue_format_t::SEGMENT_FILE));
 
             secondary_index_t sindex;
             bool found_index =
@@ -318,6 +320,7 @@ void post_construct_and_drain_queue(
                                         &deletion_context,
                                         NULL,
                                         NULL,
+                                        NULL,
                                         NULL);
                 }
             }
@@ -482,6 +485,10 @@ struct rdb_r_get_region_visitor : public boost::static_visitor<region_t> {
     region_t operator()(const dummy_read_t &d) const {
         return d.region;
     }
+
+    region_t operator()(const sample_read_t &sr) const {
+        return sr.region;
+    }
 };
 
 region_t read_t::get_region() const THROWS_NOTHING {
@@ -642,6 +649,10 @@ struct rdb_r_shard_visitor_t : public boost::static_visitor<bool> {
         return rangey_read(d);
     }
 
+    bool operator()(const sample_read_t &sr) const {
+        return rangey_read(sr);
+    }
+
     region_t region;
     read_t::variant_t *payload_out;
 };
@@ -709,6 +720,7 @@ public:
     void operator()(const changefeed_stamp_t &);
     void operator()(const changefeed_point_stamp_t &);
     void operator()(const dummy_read_t &);
+    void operator()(const sample_read_t &sr);
 
 private:
     // Shared by rget_read_t and intersecting_geo_read_t operators
@@ -915,6 +927,7 @@ void rdb_r_unshard_visitor_t::unshard_range_batch(const query_t &q, sorting_t so
 
         if (i == 0) {
             out->reql_version = resp->reql_version;
+            out->hashed_sindex = resp->hashed_sindex;
         } else {
 #ifndef NDEBUG
             guarantee(out->reql_version == resp->reql_version);
@@ -1028,6 +1041,49 @@ void rdb_r_unshard_visitor_t::operator()(const dummy_read_t &) {
     *response_out = responses[0];
 }
 
+void rdb_r_unshard_visitor_t::operator()(const sample_read_t &sr) {
+    // Each shard sampled up to `sr.num` of its own rows.  Every row of the combined
+    // sample is taken from a shard picked with probability proportional to how many
+    // of its rows haven't been taken yet, which is how a sample of the whole table
+    // would spread over the shards.
+    std::vector<sample_read_response_t *> results(count);
+    std::vector<uint64_t> remaining(count);
+    std::vector<size_t> taken(count, 0);
+    response_out->response = sample_read_response_t();
+    auto out = boost::get<sample_read_response_t>(&response_out->response);
+    for (size_t i = 0; i < count; ++i) {
+        results[i] = boost::get<sample_read_response_t>(&responses[i].response);
+        guarantee(results[i] != nullptr);
+        remaining[i] = std::max<uint64_t>(results[i]->population,
+                                          results[i]->rows.size());
+        out->population += remaining[i];
+    }
+    while (out->rows.size() < sr.num) {
+        uint64_t total = 0;
+        for (size_t i = 0; i < count; ++i) {
+            if (taken[i] < results[i]->rows.size()) {
+                total += remaining[i];
+            }
+        }
+        if (total == 0) {
+            break;
+        }
+        uint64_t pick = randuint64(total);
+        for (size_t i = 0; i < count; ++i) {
+            if (taken[i] == results[i]->rows.size()) {
+                continue;
+            }
+            if (pick < remaining[i]) {
+                out->rows.push_back(std::move(results[i]->rows[taken[i]]));
+                ++taken[i];
+                --remaining[i];
+                break;
+            }
+            pick -= remaining[i];
+        }
+    }
+}
+
 void read_t::unshard(read_response_t *responses, size_t count,
                      read_response_t *response_out, rdb_context_t *ctx,
                      signal_t *interruptor) const
@@ -1052,6 +1108,10 @@ void read_t::unshard(read_response_t *responses, size_t count,
             response_out->n_shards += responses[i].n_shards;
         }
     }
+    response_out->resource_usage = resource_usage_t();
+    for (size_t i = 0; i < count; ++i) {
+        response_out->resource_usage.add(responses[i].resource_usage);
+    }
 }
 
 struct use_snapshot_visitor_t : public boost::static_visitor<bool> {
@@ -1076,9 +1136,12 @@ struct use_snapshot_visitor_t : public boost::static_visitor<bool> {
     bool operator()(const changefeed_stamp_t &) const {           return false; }
     bool operator()(const changefeed_point_stamp_t &) const {     return false; }
     bool operator()(const distribution_read_t &) const {          return true;  }
+    bool operator()(const sample_read_t &) const {                return true;  }
 };
 
-// Only use snapshotting if we're doing a range get.
+// Only use snapshotting if we're doing a range get.  A snapshot lasts for one read,
+// which is one batch of a cursor, so writes don't wait for the cursor, but two batches
+// can see different versions of the table.
 bool read_t::use_snapshot() const THROWS_NOTHING {
     return boost::apply_visitor(use_snapshot_visitor_t(), read);
 }
@@ -1101,6 +1164,7 @@ struct route_to_primary_visitor_t : public boost::static_visitor<bool> {
     bool operator()(const changefeed_stamp_t &) const {           return true;  }
     bool operator()(const changefeed_point_stamp_t &) const {     return true;  }
     bool operator()(const distribution_read_t &) const {          return false; }
+    bool operator()(const sample_read_t &) const {                return false; }
 };
 
 // Route changefeed reads to the primary replica. For other reads we don't care.
@@ -1442,6 +1506,10 @@ void write_t::unshard(write_response_t *responses, size_t count,
             response_out->n_shards += responses[i].n_shards;
         }
     }
+    response_out->resource_usage = resource_usage_t();
+    for (size_t i = 0; i < count; ++i) {
+        response_out->resource_usage.add(responses[i].resource_usage);
+    }
 }
 
 struct rdb_w_expected_document_changes_visitor_t : public boost::static_visitor<int> {
@@ -1467,16 +1535,18 @@ RDB_IMPL_SERIALIZABLE_1_FOR_CLUSTER(point_read_response_t, data);
 ARCHIVE_PRIM_MAKE_RANGED_SERIALIZABLE(
     ql::skey_version_t, int8_t,
     ql::skey_version_t::post_1_16, ql::skey_version_t::post_1_16);
-RDB_IMPL_SERIALIZABLE_3_FOR_CLUSTER(
-    rget_read_response_t, stamp_response, result, reql_version);
+RDB_IMPL_SERIALIZABLE_4_FOR_CLUSTER(
+    rget_read_response_t, stamp_response, result, reql_version, hashed_sindex);
 RDB_IMPL_SERIALIZABLE_1_FOR_CLUSTER(nearest_geo_read_response_t, results_or_error);
 RDB_IMPL_SERIALIZABLE_2_FOR_CLUSTER(distribution_read_response_t, region, key_counts);
+RDB_IMPL_SERIALIZABLE_2_FOR_CLUSTER(sample_read_response_t, rows, population);
 RDB_IMPL_SERIALIZABLE_2_FOR_CLUSTER(
     changefeed_subscribe_response_t, server_uuids, addrs);
 RDB_IMPL_SERIALIZABLE_2_FOR_CLUSTER(
     changefeed_limit_subscribe_response_t, shards, limit_addrs);
-RDB_IMPL_SERIALIZABLE_3_FOR_CLUSTER(
-    shard_stamp_info_t, stamp, shard_region, last_read_start);
+RDB_IMPL_SERIALIZABLE_5_FOR_CLUSTER(
+    shard_stamp_info_t, stamp, shard_region, last_read_start,
+    log_position, log_changes);
 RDB_IMPL_SERIALIZABLE_1_FOR_CLUSTER(changefeed_stamp_response_t, stamp_infos);
 
 RDB_IMPL_SERIALIZABLE_2_FOR_CLUSTER(
@@ -1484,7 +1554,17 @@ RDB_IMPL_SERIALIZABLE_2_FOR_CLUSTER(
 RDB_IMPL_SERIALIZABLE_1_FOR_CLUSTER(
     changefeed_point_stamp_response_t, resp);
 
-RDB_IMPL_SERIALIZABLE_3_FOR_CLUSTER(read_response_t, response, event_log, n_shards);
+RDB_IMPL_SERIALIZABLE_8_FOR_CLUSTER(resource_usage_t,
+                                   run_nanos,
+                                   cache_hits,
+                                   cache_misses,
+                                   blocks_read,
+                                   rows_scanned,
+                                   lock_wait_nanos,
+                                   load_wait_nanos,
+                                   primary_nanos);
+RDB_IMPL_SERIALIZABLE_4_FOR_CLUSTER(
+    read_response_t, response, event_log, n_shards, resource_usage);
 RDB_IMPL_SERIALIZABLE_0_FOR_CLUSTER(dummy_read_response_t);
 
 RDB_IMPL_SERIALIZABLE_3_FOR_CLUSTER(
@@ -1539,6 +1619,7 @@ RDB_IMPL_SERIALIZABLE_8_FOR_CLUSTER(
 
 RDB_IMPL_SERIALIZABLE_3_FOR_CLUSTER(
         distribution_read_t, max_depth, result_limit, region);
+RDB_IMPL_SERIALIZABLE_2_FOR_CLUSTER(sample_read_t, num, region);
 
 RDB_IMPL_SERIALIZABLE_2_FOR_CLUSTER(changefeed_subscribe_t, addr, shard_region);
 RDB_IMPL_SERIALIZABLE_7_FOR_CLUSTER(
@@ -1550,7 +1631,7 @@ RDB_IMPL_SERIALIZABLE_7_FOR_CLUSTER(
     serializable_env,
     region,
     current_shard);
-RDB_IMPL_SERIALIZABLE_2_FOR_CLUSTER(changefeed_stamp_t, addr, region);
+RDB_IMPL_SERIALIZABLE_3_FOR_CLUSTER(changefeed_stamp_t, addr, region, since);
 RDB_IMPL_SERIALIZABLE_2_FOR_CLUSTER(changefeed_point_stamp_t, addr, key);
 
 RDB_IMPL_SERIALIZABLE_3_FOR_CLUSTER(read_t, read, profile, read_mode);
@@ -1560,7 +1641,8 @@ RDB_IMPL_SERIALIZABLE_1_FOR_CLUSTER(point_delete_response_t, result);
 RDB_IMPL_SERIALIZABLE_0_FOR_CLUSTER(sync_response_t);
 RDB_IMPL_SERIALIZABLE_0_FOR_CLUSTER(dummy_write_response_t);
 
-RDB_IMPL_SERIALIZABLE_3_FOR_CLUSTER(write_response_t, response, event_log, n_shards);
+RDB_IMPL_SERIALIZABLE_4_FOR_CLUSTER(
+    write_response_t, response, event_log, n_shards, resource_usage);
 
 RDB_IMPL_SERIALIZABLE_6_FOR_CLUSTER(
         batched_replace_t,
@@ -13,6 +13,7 @@
 #include "errors.hpp"
 #include <boost/variant.hpp>
 
+#include "arch/runtime/resource_usage.hpp"
 #include "btree/secondary_operations.hpp"
 #include "clustering/administration/auth/user_context.hpp"
 #include "concurrency/cond_var.hpp"
@@ -109,6 +110,11 @@ struct shard_stamp_info_t {
     region_t shard_region;
     // The starting points of the reads (assuming left to right traversal)
     store_key_t last_read_start;
+    // The position the next change in the `server_t`'s change log will get.
+    uint64_t log_position;
+    // The logged changes from the position in `changefeed_stamp_t::since` on, or
+    // empty if that isn't set or the log no longer goes back that far.
+    optional<std::vector<ql::changefeed::msg_t::change_t> > log_changes;
 };
 RDB_DECLARE_SERIALIZABLE_FOR_CLUSTER(shard_stamp_info_t);
 
@@ -126,11 +132,14 @@ struct rget_read_response_t {
     optional<changefeed_stamp_response_t> stamp_response;
     ql::result_t result;
     reql_version_t reql_version;
+    // Whether the read used a hash index, whose keys aren't ordered like the values
+    // they were computed from.
+    bool hashed_sindex;
 
     rget_read_response_t()
-        : reql_version(reql_version_t::EARLIEST) { }
+        : reql_version(reql_version_t::EARLIEST), hashed_sindex(false) { }
     explicit rget_read_response_t(const ql::exc_t &ex)
-        : result(ex), reql_version(reql_version_t::EARLIEST) { }
+        : result(ex), reql_version(reql_version_t::EARLIEST), hashed_sindex(false) { }
 };
 RDB_DECLARE_SERIALIZABLE_FOR_CLUSTER(rget_read_response_t);
 
@@ -165,6 +174,15 @@ struct distribution_read_response_t {
 };
 RDB_DECLARE_SERIALIZABLE_FOR_CLUSTER(distribution_read_response_t);
 
+struct sample_read_response_t {
+    sample_read_response_t() : population(0) { }
+    // The sampled rows, in random order.
+    std::vector<ql::datum_t> rows;
+    // An estimate of how many rows the region has.
+    uint64_t population;
+};
+RDB_DECLARE_SERIALIZABLE_FOR_CLUSTER(sample_read_response_t);
+
 struct changefeed_subscribe_response_t {
     changefeed_subscribe_response_t() { }
     std::set<uuid_u> server_uuids;
@@ -220,6 +238,8 @@ struct serializable_env_t {
 
 RDB_DECLARE_SERIALIZABLE_FOR_CLUSTER(serializable_env_t);
 
+RDB_DECLARE_SERIALIZABLE_FOR_CLUSTER(resource_usage_t);
+
 struct read_response_t {
     typedef boost::variant<point_read_response_t,
                            rget_read_response_t,
@@ -229,10 +249,13 @@ struct read_response_t {
                            changefeed_stamp_response_t,
                            changefeed_point_stamp_response_t,
                            distribution_read_response_t,
-                           dummy_read_response_t> variant_t;
+                           dummy_read_response_t,
+                           sample_read_response_t> variant_t;
     variant_t response;
     profile::event_log_t event_log;
     size_t n_shards;
+    // What the read cost on the shards, for the query's `rethinkdb._query_stats` row.
+    resource_usage_t resource_usage;
 
     read_response_t() { }
     explicit read_response_t(const variant_t &r)
@@ -290,6 +313,9 @@ struct changefeed_stamp_t {
         : addr(std::move(_addr)), region(region_t::universe()) { }
     ql::changefeed::client_t::addr_t addr;
     region_t region;
+    // If set, the change log positions (by `server_t` uuid) a resumed feed wants
+    // to replay changes from.
+    optional<std::map<uuid_u, uint64_t> > since;
 };
 RDB_DECLARE_SERIALIZABLE_FOR_CLUSTER(changefeed_stamp_t);
 
@@ -440,6 +466,18 @@ public:
 };
 RDB_DECLARE_SERIALIZABLE_FOR_CLUSTER(distribution_read_t);
 
+/* Picks up to `num` rows of the region at random, by random descents through the
+btree rather than by reading all of it. */
+class sample_read_t {
+public:
+    sample_read_t() : num(0), region(region_t::universe()) { }
+    explicit sample_read_t(uint64_t _num) : num(_num), region(region_t::universe()) { }
+
+    uint64_t num;
+    region_t region;
+};
+RDB_DECLARE_SERIALIZABLE_FOR_CLUSTER(sample_read_t);
+
 struct changefeed_subscribe_t {
     changefeed_subscribe_t() { }
     explicit changefeed_subscribe_t(ql::changefeed::client_t::addr_t _addr)
@@ -491,7 +529,8 @@ struct read_t {
                            changefeed_limit_subscribe_t,
                            changefeed_point_stamp_t,
                            distribution_read_t,
-                           dummy_read_t> variant_t;
+                           dummy_read_t,
+                           sample_read_t> variant_t;
 
     variant_t read;
     profile_bool_t profile;
@@ -564,6 +603,8 @@ struct write_response_t {
 
     profile::event_log_t event_log;
     size_t n_shards;
+    // What the write cost on the primary replicas, see `read_response_t`.
+    resource_usage_t resource_usage;
 
     write_response_t() { }
     template<class T>
@@ -581,6 +581,22 @@ datum_t time_in_tz(datum_t t, datum_t tz) {
     return std::move(t2).to_datum();
 }
 
+datum_t time_bucket(datum_t t, int64_t interval_ms) {
+    r_sanity_check(t.is_ptype(time_string));
+    r_sanity_check(interval_ms > 0);
+    // Epoch times are rounded to milliseconds, so this is exact, and doesn't need any
+    // calendar or timezone math.
+    const int64_t ms = llround(time_to_epoch_time(t) * 1000);
+    int64_t bucket = ms / interval_ms;
+    if (ms % interval_ms < 0) {
+        --bucket;
+    }
+    datum_object_builder_t t2(t);
+    t2.overwrite(epoch_time_key,
+                 datum_t(static_cast<double>(bucket * interval_ms) / 1000));
+    return std::move(t2).to_datum();
+}
+
 datum_t make_time(double epoch_time, std::string tz) {
     std::map<datum_string_t, datum_t> map
         = { { datum_string_t(datum_t::reql_type_string), datum_t(time_string) },
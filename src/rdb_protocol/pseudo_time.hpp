@@ -24,6 +24,9 @@ double time_to_epoch_time(datum_t d);
 datum_t time_now();
 datum_t time_tz(datum_t time);
 datum_t time_in_tz(datum_t t, datum_t tz);
+// The start of the `interval_ms`-millisecond bucket that `t` falls in, counting
+// buckets from the epoch, in `t`'s timezone.
+datum_t time_bucket(datum_t t, int64_t interval_ms);
 
 int time_cmp(const datum_t &x, const datum_t &y);
 void sanitize_time(datum_t *time);
@@ -1,9 +1,16 @@
 // Copyright 2010-2015 RethinkDB, all rights reserved.
 #include "rdb_protocol/query_cache.hpp"
 
+#include <functional>
+
+#include "arch/runtime/coroutines.hpp"
 #include "rdb_protocol/env.hpp"
+#include "rdb_protocol/func.hpp"
+#include "rdb_protocol/profile.hpp"
 #include "rdb_protocol/pseudo_time.hpp"
+#include "rdb_protocol/query_result_cache.hpp"
 #include "rdb_protocol/response.hpp"
+#include "rdb_protocol/serialize_datum.hpp"
 #include "rdb_protocol/term_walker.hpp"
 
 namespace ql {
@@ -18,7 +25,10 @@ query_cache_t::query_cache_t(
         return_empty_normal_batches(_return_empty_normal_batches),
         user_context(std::move(_user_context)),
         next_query_id(0),
-        oldest_outstanding_query_id(0) {
+        oldest_outstanding_query_id(0),
+        prefetched_bytes(0),
+        idle_timer(QUERY_CACHE_IDLE_CHECK_INTERVAL_MS,
+                   [this]() { close_idle_cursors(); }) {
     auto res = rdb_ctx->get_query_caches_for_this_thread()->insert(this);
     guarantee(res.second);
 }
@@ -28,6 +38,12 @@ query_cache_t::~query_cache_t() {
     guarantee(res == 1);
 }
 
+bool query_cache_t::use_result_cache(const query_params_t &query_params) const {
+    return query_params.result_cache
+        && !query_params.profile
+        && rdb_ctx->query_result_cache != nullptr;
+}
+
 query_cache_t::const_iterator query_cache_t::begin() const {
     return queries.begin();
 }
@@ -49,13 +65,21 @@ scoped_ptr_t<query_cache_t::ref_t> query_cache_t::create(query_params_t *query_p
 
     global_optargs_t global_optargs;
     counted_t<const term_t> term_tree;
+    std::shared_ptr<const query_fingerprint_t> fingerprint;
+    optional<std::string> result_cache_key;
+    const int64_t parse_start_nanos = get_ticks().nanos;
     try {
         query_params->term_storage->preprocess();
         global_optargs = query_params->term_storage->global_optargs();
 
         compile_env_t compile_env((var_visibility_t()));
         term_tree = compile_term(&compile_env, query_params->term_storage->root_term());
-
+        fingerprint = std::make_shared<const query_fingerprint_t>(
+            fingerprint_query(query_params->term_storage->root_term()));
+        if (use_result_cache(*query_params)) {
+            result_cache_key = query_result_cache_t::make_key(
+                query_params->term_storage->root_term(), global_optargs, user_context);
+        }
     } catch (const exc_t &e) {
         throw bt_exc_t(Response::COMPILE_ERROR,
             e.get_error_type(),
@@ -67,15 +91,22 @@ scoped_ptr_t<query_cache_t::ref_t> query_cache_t::create(query_params_t *query_p
                        e.what(),
                        backtrace_registry_t::EMPTY_BACKTRACE);
     }
+    if (query_params->trace.has()) {
+        query_params->trace->add_span(0, "parse", parse_start_nanos, get_ticks().nanos);
+    }
     scoped_ptr_t<entry_t> entry(new entry_t(query_params,
                                             std::move(global_optargs),
                                             std::move(deterministic_time),
-                                            std::move(term_tree)));
+                                            std::move(term_tree),
+                                            std::move(fingerprint)));
+    entry->result_cache_key = std::move(result_cache_key);
 
     scoped_ptr_t<ref_t> ref(new ref_t(this,
                                       query_params->token,
                                       std::move(query_params->throttler),
                                       entry.get(),
+                                      query_params->received_time,
+                                      query_params->trace.get_or_null(),
                                       interruptor));
     auto insert_res = queries.insert(std::make_pair(query_params->token,
                                                     std::move(entry)));
@@ -93,14 +124,156 @@ scoped_ptr_t<query_cache_t::ref_t> query_cache_t::get(query_params_t *query_para
             strprintf("Token %" PRIi64 " not in stream cache.", query_params->token),
             backtrace_registry_t::EMPTY_BACKTRACE);
     }
+    it->second->credits += query_params->credits;
 
     return scoped_ptr_t<ref_t>(new ref_t(this,
                                          query_params->token,
                                          std::move(query_params->throttler),
                                          it->second.get(),
+                                         query_params->received_time,
+                                         query_params->trace.get_or_null(),
                                          interruptor));
 }
 
+void query_cache_t::grant_credits(query_params_t *query_params) {
+    r_sanity_check(query_params->type == Query::CONTINUE);
+    guarantee(this == query_params->query_cache);
+    query_params->maybe_release_query_id();
+    auto it = queries.find(query_params->token);
+    if (it == queries.end()) {
+        throw bt_exc_t(Response::CLIENT_ERROR, Response::QUERY_LOGIC,
+            strprintf("Token %" PRIi64 " not in stream cache.", query_params->token),
+            backtrace_registry_t::EMPTY_BACKTRACE);
+    }
+    it->second->credits += query_params->credits;
+}
+
+bool query_cache_t::take_credit(int64_t token) {
+    assert_thread();
+    auto it = queries.find(token);
+    if (it == queries.end()
+        || it->second->state != entry_t::state_t::STREAM
+        || it->second->credits == 0) {
+        return false;
+    }
+    --it->second->credits;
+    return true;
+}
+
+void query_cache_t::prepare(query_params_t *query_params) {
+    r_sanity_check(query_params->type == Query::PREPARE);
+    guarantee(this == query_params->query_cache);
+    assert_thread();
+    query_params->maybe_release_query_id();
+    if (prepared_queries.count(query_params->token) == 0
+        && prepared_queries.size() >= MAX_PREPARED_QUERIES_PER_CONNECTION) {
+        throw bt_exc_t(Response::CLIENT_ERROR, Response::RESOURCE_LIMIT,
+            strprintf("Cannot prepare more than %d queries on one connection.",
+                      MAX_PREPARED_QUERIES_PER_CONNECTION),
+            backtrace_registry_t::EMPTY_BACKTRACE);
+    }
+
+    auto prepared = std::make_shared<prepared_query_t>();
+    try {
+        query_params->term_storage->preprocess();
+        const raw_term_t root_term = query_params->term_storage->root_term();
+        if (root_term.type() != Term::FUNC) {
+            throw bt_exc_t(Response::CLIENT_ERROR, Response::QUERY_LOGIC,
+                strprintf("Expected the query to prepare to be a FUNC, but found %s.",
+                          Term::TermType_Name(root_term.type()).c_str()),
+                backtrace_registry_t::EMPTY_BACKTRACE);
+        }
+        prepared->global_optargs = query_params->term_storage->global_optargs();
+
+        compile_env_t compile_env((var_visibility_t()));
+        prepared->func_term = compile_term(&compile_env, root_term);
+        prepared->fingerprint = std::make_shared<const query_fingerprint_t>(
+            fingerprint_query(root_term));
+        // Whether EXECUTE queries use the cache is up to them.
+        if (rdb_ctx->query_result_cache != nullptr) {
+            prepared->result_cache_key = query_result_cache_t::make_key(
+                root_term, prepared->global_optargs, user_context);
+        }
+    } catch (const exc_t &e) {
+        throw bt_exc_t(Response::COMPILE_ERROR,
+            e.get_error_type(),
+            e.what(),
+            query_params->term_storage->backtrace_registry().datum_backtrace(e));
+    } catch (const datum_exc_t &e) {
+        throw bt_exc_t(Response::COMPILE_ERROR,
+                       e.get_error_type(),
+                       e.what(),
+                       backtrace_registry_t::EMPTY_BACKTRACE);
+    }
+    prepared->term_storage = std::move(query_params->term_storage);
+    prepared_queries[query_params->token] = std::move(prepared);
+}
+
+void query_cache_t::unprepare(const query_params_t &query_params) {
+    r_sanity_check(query_params.type == Query::UNPREPARE);
+    guarantee(this == query_params.query_cache);
+    assert_thread();
+    prepared_queries.erase(query_params.token);
+}
+
+scoped_ptr_t<query_cache_t::ref_t> query_cache_t::execute(
+        query_params_t *query_params,
+        ql::datum_t &&deterministic_time,
+        signal_t *interruptor) {
+    guarantee(this == query_params->query_cache);
+    query_params->maybe_release_query_id();
+    if (queries.find(query_params->token) != queries.end()) {
+        throw bt_exc_t(Response::CLIENT_ERROR, Response::QUERY_LOGIC,
+            strprintf("ERROR: duplicate token %" PRIi64, query_params->token),
+            backtrace_registry_t::EMPTY_BACKTRACE);
+    }
+
+    int64_t prepared_token;
+    std::vector<datum_t> args;
+    try {
+        query_params->term_storage->execute_params(&prepared_token, &args);
+    } catch (const base_exc_t &e) {
+        throw bt_exc_t(Response::CLIENT_ERROR,
+                       e.get_error_type(),
+                       e.what(),
+                       backtrace_registry_t::EMPTY_BACKTRACE);
+    }
+    auto prepared_it = prepared_queries.find(prepared_token);
+    if (prepared_it == prepared_queries.end()) {
+        throw bt_exc_t(Response::CLIENT_ERROR, Response::QUERY_LOGIC,
+            strprintf("Token %" PRIi64 " is not a prepared query.", prepared_token),
+            backtrace_registry_t::EMPTY_BACKTRACE);
+    }
+    std::shared_ptr<const prepared_query_t> prepared = prepared_it->second;
+
+    global_optargs_t global_optargs = prepared->global_optargs;
+    std::shared_ptr<const query_fingerprint_t> fingerprint = prepared->fingerprint;
+    scoped_ptr_t<entry_t> entry(new entry_t(query_params,
+                                            std::move(global_optargs),
+                                            std::move(deterministic_time),
+                                            counted_t<const term_t>(),
+                                            std::move(fingerprint),
+                                            std::move(prepared),
+                                            std::move(args)));
+    if (use_result_cache(*query_params)
+        && entry->prepared_query->result_cache_key.has_value()) {
+        entry->result_cache_key.set(query_result_cache_t::make_prepared_key(
+            *entry->prepared_query->result_cache_key, entry->prepared_args));
+    }
+
+    scoped_ptr_t<ref_t> ref(new ref_t(this,
+                                      query_params->token,
+                                      std::move(query_params->throttler),
+                                      entry.get(),
+                                      query_params->received_time,
+                                      query_params->trace.get_or_null(),
+                                      interruptor));
+    auto insert_res = queries.insert(std::make_pair(query_params->token,
+                                                    std::move(entry)));
+    guarantee(insert_res.second);
+    return ref;
+}
+
 void query_cache_t::noreply_wait(const query_params_t &query_params,
                                  signal_t *interruptor) {
     guarantee(this == query_params.query_cache);
@@ -140,10 +313,17 @@ auth::user_context_t const &query_cache_t::get_user_context() const {
     return user_context;
 }
 
+bool query_cache_t::empty() const {
+    assert_thread();
+    return queries.empty() && prepared_queries.empty();
+}
+
 query_cache_t::ref_t::ref_t(query_cache_t *_query_cache,
                             int64_t _token,
                             new_semaphore_in_line_t _throttler,
                             query_cache_t::entry_t *_entry,
+                            ticks_t received_time,
+                            query_trace_t *_query_trace,
                             signal_t *interruptor) :
         entry(_entry),
         token(_token),
@@ -153,33 +333,86 @@ query_cache_t::ref_t::ref_t(query_cache_t *_query_cache,
         drainer_lock(&entry->drainer),
         combined_interruptor(interruptor, &entry->persistent_interruptor),
         mutex_lock(&entry->mutex) {
-    wait_interruptible(mutex_lock.acq_signal(), interruptor);
+    ++entry->num_refs;
+    try {
+        wait_interruptible(mutex_lock.acq_signal(), interruptor);
+        slot.acquire(query_cache, entry->priority, interruptor);
+    } catch (const interrupted_exc_t &) {
+        --entry->num_refs;
+        entry->last_ref_time = get_kiloticks();
+        throw;
+    }
+    const int64_t now_nanos = get_ticks().nanos;
+    queue_wait_nanos = now_nanos - received_time.nanos;
+    query_trace = _query_trace;
+    if (query_trace != nullptr) {
+        query_trace->add_span(0, "queue", received_time.nanos, now_nanos);
+    }
 }
 
 void query_cache_t::async_destroy_entry(query_cache_t::entry_t *entry) {
     delete entry;
 }
 
+void query_cache_t::remove_entry(
+        std::map<int64_t, scoped_ptr_t<entry_t> >::iterator it) {
+    // We do not delete the entry in this context for reasons:
+    //  1. If there is an active exception, we aren't allowed to switch coroutines
+    //  2. This will block until all auto-drainer locks on the entry have been
+    //     removed, including the one in the reference that's being destroyed
+    entry_t *entry = it->second.release();
+    entry->state = entry_t::state_t::DELETING;
+    prefetched_bytes -= entry->prefetched_bytes;
+    entry->prefetched_bytes = 0;
+    queries.erase(it);
+    coro_t::spawn_sometime(std::bind(&query_cache_t::async_destroy_entry, entry));
+}
+
+void query_cache_t::close_idle_cursors() {
+    assert_thread();
+    const int64_t now_micros = get_kiloticks().micros;
+    for (auto it = queries.begin(); it != queries.end();) {
+        entry_t *entry = it->second.get();
+        auto next = std::next(it);
+        if (entry->num_refs == 0
+            && entry->state == entry_t::state_t::STREAM
+            && now_micros - entry->last_ref_time.micros
+                > QUERY_CACHE_IDLE_CURSOR_TIMEOUT_MS * THOUSAND) {
+            // This interrupts a batch that's being read ahead for the cursor.
+            terminate_internal(entry);
+            remove_entry(it);
+        }
+        it = next;
+    }
+}
+
 query_cache_t::ref_t::~ref_t() {
     query_cache->assert_thread();
+    --entry->num_refs;
+    entry->last_ref_time = get_kiloticks();
 
     if (entry->state == entry_t::state_t::DONE
         || (entry->state != entry_t::state_t::DELETING && entry->persistent_interruptor.is_pulsed())) {
-        // We do not delete the entry in this context for reasons:
-        //  1. If there is an active exception, we aren't allowed to switch coroutines
-        //  2. This will block until all auto-drainer locks on the entry have been
-        //     removed, including the one in this reference
-        // We remove the entry from the cache so no new queries can acquire it
-        entry->state = entry_t::state_t::DELETING;
-
         auto it = query_cache->queries.find(token);
         guarantee(it != query_cache->queries.end());
-        coro_t::spawn_sometime(std::bind(&query_cache_t::async_destroy_entry,
-                                         it->second.release()));
-        query_cache->queries.erase(it);
+        query_cache->remove_entry(it);
     }
 }
 
+std::shared_ptr<const query_fingerprint_t>
+query_cache_t::ref_t::get_fingerprint() const {
+    return entry->fingerprint;
+}
+
+// The rows in a response are the elements of a sequence or of an array atom.
+static uint64_t count_rows_returned(const response_t &res) {
+    if (res.type() == Response::SUCCESS_ATOM && res.data().size() == 1) {
+        const datum_t &atom = res.data()[0];
+        return atom.get_type() == datum_t::R_ARRAY ? atom.arr_size() : 1;
+    }
+    return res.data().size();
+}
+
 void query_cache_t::ref_t::fill_response(response_t *res) {
     query_cache->assert_thread();
     if (entry->state != entry_t::state_t::START &&
@@ -194,6 +427,15 @@ void query_cache_t::ref_t::fill_response(response_t *res) {
             backtrace_registry_t::EMPTY_BACKTRACE);
     }
 
+    scoped_query_stats_t query_stats(entry->fingerprint);
+    query_stats.log_if_slow(queue_wait_nanos);
+    if (query_trace != nullptr) {
+        query_stats.add_to_trace(query_trace);
+    }
+    if (entry->state == entry_t::state_t::START) {
+        query_stats.stats()->calls = 1;
+    }
+
     try {
         serializable_env_t serializable{
                 entry->global_optargs,
@@ -207,8 +449,14 @@ void query_cache_t::ref_t::fill_response(response_t *res) {
             trace.get_or_null());
 
         if (entry->state == entry_t::state_t::START) {
-            run(&env, res);
+            if (entry->result_cache_key.has_value()
+                && query_cache->rdb_ctx->query_result_cache != nullptr) {
+                run_cached(&env, res);
+            } else {
+                run(&env, res);
+            }
             entry->term_tree.reset();
+            entry->prepared_args.clear();
         }
 
         if (entry->state == entry_t::state_t::STREAM) {
@@ -218,6 +466,7 @@ void query_cache_t::ref_t::fill_response(response_t *res) {
         if (trace.has()) {
             res->set_profile(trace->as_datum());
         }
+        query_stats.stats()->rows_returned = count_rows_returned(*res);
     } catch (const interrupted_exc_t &ex) {
         // We grab this before `terminate_internal` which will always pulse it.
         bool persistent_interruptor_pulsed = entry->persistent_interruptor.is_pulsed();
@@ -252,13 +501,13 @@ void query_cache_t::ref_t::fill_response(response_t *res) {
         throw bt_exc_t(Response::RUNTIME_ERROR,
                        ex.get_error_type(),
                        ex.what(),
-                       entry->term_storage->backtrace_registry().datum_backtrace(ex));
+                       entry->backtrace_registry().datum_backtrace(ex));
     } catch (const datum_exc_t &ex) {
         query_cache->terminate_internal(entry);
         throw bt_exc_t(Response::RUNTIME_ERROR,
                        ex.get_error_type(),
                        ex.what(),
-                       entry->term_storage->backtrace_registry().datum_backtrace(
+                       entry->backtrace_registry().datum_backtrace(
                             backtrace_id_t::empty(), 0));
     } catch (const std::exception &ex) {
         query_cache->terminate_internal(entry);
@@ -271,7 +520,14 @@ void query_cache_t::ref_t::fill_response(response_t *res) {
 
 void query_cache_t::ref_t::run(env_t *env, response_t *res) {
     scope_env_t scope_env(env, var_scope_t());
-    scoped_ptr_t<val_t> val = entry->term_tree->eval(&scope_env);
+    scoped_ptr_t<val_t> val;
+    if (entry->prepared_query) {
+        counted_t<const func_t> func =
+            entry->prepared_query->func_term->eval(&scope_env)->as_func();
+        val = func->call(env, entry->prepared_args);
+    } else {
+        val = entry->term_tree->eval(&scope_env);
+    }
 
     if (val->get_type().is_convertible(val_t::type_t::DATUM)) {
         res->set_type(Response::SUCCESS_ATOM);
@@ -303,6 +559,28 @@ void query_cache_t::ref_t::run(env_t *env, response_t *res) {
     }
 }
 
+void query_cache_t::ref_t::run_cached(env_t *env, response_t *res) {
+    query_result_cache_t *result_cache = query_cache->rdb_ctx->query_result_cache;
+    const std::string &key = *entry->result_cache_key;
+    optional<datum_t> cached = result_cache->get(key, env->get_user_context());
+    if (cached.has_value()) {
+        res->set_type(Response::SUCCESS_ATOM);
+        res->set_data(*cached);
+        entry->state = entry_t::state_t::DONE;
+        return;
+    }
+
+    const int64_t start_nanos = get_ticks().nanos;
+    tracked_reads_t reads;
+    env->tracked_reads = &reads;
+    run(env, res);
+    env->tracked_reads = nullptr;
+    // Streams aren't cached, since we would have to hold on to all of their rows.
+    if (entry->state == entry_t::state_t::DONE) {
+        result_cache->insert(key, res->data()[0], reads, start_nanos);
+    }
+}
+
 void query_cache_t::ref_t::serve(env_t *env, response_t *res) {
     guarantee(entry->stream.has());
 
@@ -310,13 +588,31 @@ void query_cache_t::ref_t::serve(env_t *env, response_t *res) {
     if (cfeed_type != feed_type_t::not_feed) {
         // We don't throttle changefeed queries because they can block forever.
         throttler.reset();
+        slot.reset();
     }
 
     batch_type_t batch_type = entry->has_sent_batch
                                   ? batch_type_t::NORMAL
                                   : batch_type_t::NORMAL_FIRST;
-    std::vector<datum_t> ds = entry->stream->next_batch(
-            env, batchspec_t::user(batch_type, env));
+    std::vector<datum_t> ds;
+    if (cfeed_type == feed_type_t::not_feed) {
+        entry->batch_size.note_request();
+        if (entry->prefetched_batch.has_value()) {
+            ds = std::move(*entry->prefetched_batch);
+            entry->prefetched_batch.reset();
+            query_cache->prefetched_bytes -= entry->prefetched_bytes;
+            entry->prefetched_bytes = 0;
+        } else if (entry->prefetch_error) {
+            // Thrown here so it's reported like any other error reading the batch.
+            std::exception_ptr error = entry->prefetch_error;
+            entry->prefetch_error = std::exception_ptr();
+            std::rethrow_exception(error);
+        } else {
+            ds = read_batch(env, entry, batch_type);
+        }
+    } else {
+        ds = entry->stream->next_batch(env, batchspec_t::user(batch_type, env));
+    }
     entry->has_sent_batch = true;
     res->set_data(std::move(ds));
 
@@ -354,25 +650,134 @@ void query_cache_t::ref_t::serve(env_t *env, response_t *res) {
     default: unreachable();
     }
     entry->stream->set_notes(res);
+
+    if (cfeed_type == feed_type_t::not_feed) {
+        entry->batch_size.note_sent();
+        // We don't prefetch for profiled queries, since the read wouldn't show up in
+        // the profile of the batch that returns it.
+        if (res->type() == Response::SUCCESS_PARTIAL
+            && entry->profile == profile_bool_t::DONT_PROFILE
+            && query_cache->prefetched_bytes < QUERY_CACHE_MAX_PREFETCHED_BYTES) {
+            coro_t::spawn_sometime(std::bind(&query_cache_t::prefetch_batch,
+                                             query_cache,
+                                             entry,
+                                             auto_drainer_t::lock_t(&entry->drainer)));
+        }
+    }
 }
 
-query_cache_t::entry_t::entry_t(query_params_t *query_params,
-                                global_optargs_t &&_global_optargs,
-                                ql::datum_t && _deterministic_time,
-                                counted_t<const term_t> &&_term_tree) :
+std::vector<datum_t> query_cache_t::read_batch(env_t *env,
+                                               entry_t *entry,
+                                               batch_type_t batch_type,
+                                               int64_t *bytes_out) {
+    // Feeds can block for as long as they like, so their read times don't say
+    // anything about how big their batches should be.
+    batchspec_t batchspec = batchspec_t::user(batch_type, env, &entry->batch_size);
+    profile::starter_t starter(
+        strprintf("Reading a batch of up to %" PRIi64 " bytes (the client took "
+                  "%" PRIi64 " microseconds to ask for it).",
+                  entry->batch_size.get_size(),
+                  entry->batch_size.get_idle_time().micros),
+        env->trace);
+    const kiloticks_t read_start = get_kiloticks();
+    std::vector<datum_t> ds = entry->stream->next_batch(env, batchspec);
+    int64_t bytes = 0;
+    for (const datum_t &d : ds) {
+        bytes += serialized_size<cluster_version_t::CLUSTER>(d);
+    }
+    entry->batch_size.note_batch(
+        bytes, kiloticks_t{get_kiloticks().micros - read_start.micros});
+    if (bytes_out != nullptr) {
+        *bytes_out = bytes;
+    }
+    return ds;
+}
+
+void query_cache_t::prefetch_batch(entry_t *entry,
+                                   auto_drainer_t::lock_t entry_keepalive) {
+    assert_thread();
+    wait_any_t interruptor(entry_keepalive.get_drain_signal(),
+                           &entry->persistent_interruptor);
+    try {
+        new_mutex_in_line_t mutex_lock(&entry->mutex);
+        wait_interruptible(mutex_lock.acq_signal(), &interruptor);
+
+        // The client may have asked for the next batch (and we may have read it)
+        // before we got the mutex.
+        if (entry->state != entry_t::state_t::STREAM
+            || entry->persistent_interruptor.is_pulsed()
+            || entry->prefetched_batch.has_value()
+            || entry->prefetch_error
+            || entry->stream->is_exhausted()) {
+            return;
+        }
+
+        serializable_env_t serializable{
+                entry->global_optargs,
+                get_user_context(),
+                entry->deterministic_time};
+        env_t env(rdb_ctx,
+                  return_empty_normal_batches,
+                  &interruptor,
+                  serializable,
+                  nullptr);
+        // The rows are counted when the batch is served.
+        scoped_query_stats_t query_stats(entry->fingerprint);
+        try {
+            int64_t bytes;
+            entry->prefetched_batch.set(
+                read_batch(&env, entry, batch_type_t::NORMAL, &bytes));
+            // The entry may have been closed for being idle during the read.
+            if (entry->state != entry_t::state_t::DELETING) {
+                entry->prefetched_bytes = bytes;
+                prefetched_bytes += bytes;
+            }
+        } catch (const interrupted_exc_t &) {
+            throw;
+        } catch (const std::exception &) {
+            entry->prefetch_error = std::current_exception();
+        }
+    } catch (const interrupted_exc_t &) {
+        // The query was stopped or is being deleted, which the next `ref_t` (if
+        // there is one) will deal with.
+    }
+}
+
+query_cache_t::entry_t::entry_t(
+            query_params_t *query_params,
+            global_optargs_t &&_global_optargs,
+            ql::datum_t && _deterministic_time,
+            counted_t<const term_t> &&_term_tree,
+            std::shared_ptr<const query_fingerprint_t> &&_fingerprint,
+            std::shared_ptr<const prepared_query_t> &&_prepared_query,
+            std::vector<datum_t> &&_prepared_args) :
         state(state_t::START),
         interrupt_reason(interrupt_reason_t::UNKNOWN),
         job_id(generate_uuid()),
         noreply(query_params->noreply),
         profile(query_params->profile ? profile_bool_t::PROFILE :
                                         profile_bool_t::DONT_PROFILE),
+        priority(query_params->priority),
         term_storage(std::move(query_params->term_storage)),
         global_optargs(std::move(_global_optargs)),
         deterministic_time(_deterministic_time),
         start_time(get_kiloticks()),
+        fingerprint(std::move(_fingerprint)),
         term_tree(std::move(_term_tree)),
-        has_sent_batch(false) { }
+        prepared_query(std::move(_prepared_query)),
+        prepared_args(std::move(_prepared_args)),
+        has_sent_batch(false),
+        credits(query_params->credits),
+        prefetched_bytes(0),
+        num_refs(0),
+        last_ref_time(get_kiloticks()) { }
 
 query_cache_t::entry_t::~entry_t() { }
 
+const backtrace_registry_t &query_cache_t::entry_t::backtrace_registry() const {
+    return prepared_query
+        ? prepared_query->term_storage->backtrace_registry()
+        : term_storage->backtrace_registry();
+}
+
 } // namespace ql
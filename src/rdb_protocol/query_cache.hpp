@@ -6,10 +6,12 @@
 
 #include <exception>
 #include <map>
+#include <memory>
 #include <set>
 #include <string>
 
 #include "arch/address.hpp"
+#include "arch/timing.hpp"
 #include "clustering/administration/auth/user_context.hpp"
 #include "concurrency/auto_drainer.hpp"
 #include "concurrency/new_mutex.hpp"
@@ -20,16 +22,35 @@
 #include "containers/counted.hpp"
 #include "containers/intrusive_list.hpp"
 #include "containers/object_buffer.hpp"
+#include "containers/optional.hpp"
+#include "rdb_protocol/batching.hpp"
 #include "rdb_protocol/datum_stream.hpp"
 #include "rdb_protocol/rdb_backtrace.hpp"
 #include "rdb_protocol/error.hpp"
 #include "rdb_protocol/env.hpp"
 #include "rdb_protocol/ql2proto.hpp"
 #include "rdb_protocol/query_params.hpp"
+#include "rdb_protocol/query_scheduler.hpp"
+#include "rdb_protocol/query_stats.hpp"
 #include "rdb_protocol/term.hpp"
 #include "rdb_protocol/term_storage.hpp"
 #include "rdb_protocol/wire_func.hpp"
 
+/* How many queries a client may have prepared on one connection at a time. */
+#define MAX_PREPARED_QUERIES_PER_CONNECTION 1024
+
+/* A cursor that the client hasn't asked for a batch of in this long is closed, so
+that cursors that a client forgot about don't keep their batches and their reads'
+state until the connection is closed. */
+#define QUERY_CACHE_IDLE_CURSOR_TIMEOUT_MS (30 * 60 * THOUSAND)
+
+/* How often the cursors are checked for being idle. */
+#define QUERY_CACHE_IDLE_CHECK_INTERVAL_MS (60 * THOUSAND)
+
+/* Cursors on a connection stop reading batches before the client asks for them while
+the batches that they have read that way take up this many bytes. */
+#define QUERY_CACHE_MAX_PREFETCHED_BYTES (16 * MEGABYTE)
+
 namespace ql {
 
 class query_cache_t : public home_thread_mixin_t {
@@ -47,16 +68,23 @@ public:
     public:
         ~ref_t();
         void fill_response(response_t *res);
+
+        std::shared_ptr<const query_fingerprint_t> get_fingerprint() const;
     private:
         friend class query_cache_t;
         ref_t(query_cache_t *_query_cache,
               int64_t _token,
               new_semaphore_in_line_t _throttler,
               query_cache_t::entry_t *_entry,
+              ticks_t received_time,
+              query_trace_t *_query_trace,
               signal_t *interruptor);
 
         // Run a new query
         void run(env_t *env, response_t *res);
+        // Run a new query whose result may be in the server's result cache, and
+        // cache its result if it isn't
+        void run_cached(env_t *env, response_t *res);
         // Serve a batch from a stream
         void serve(env_t *env, response_t *res);
 
@@ -69,6 +97,12 @@ public:
         auto_drainer_t::lock_t drainer_lock;
         wait_any_t combined_interruptor;
         new_mutex_in_line_t mutex_lock;
+        query_slot_t slot;
+        // How long the query waited between being read from the client and getting
+        // hold of the entry and a slot to run in.
+        int64_t queue_wait_nanos;
+        // Set if the query batch is being traced.
+        query_trace_t *query_trace;
 
         DISABLE_COPYING(ref_t);
     };
@@ -89,6 +123,23 @@ public:
     scoped_ptr_t<ref_t> get(query_params_t *query_params,
                             signal_t *interruptor);
 
+    // Adds the `credits` of a CONTINUE query to its cursor, without reading a batch.
+    void grant_credits(query_params_t *query_params);
+    // Uses up one of the cursor's credits, if it has one and isn't done.  The caller
+    // then sends the client the cursor's next batch as if it had asked for it.
+    bool take_credit(int64_t token);
+
+    // Compiles the function of a PREPARE query and keeps it under the query's token,
+    // until an UNPREPARE query for the token or the connection is closed.
+    void prepare(query_params_t *query_params);
+    void unprepare(const query_params_t &query_params);
+
+    // Starts running a prepared query with the arguments of an EXECUTE query, like
+    // `create()` does with the term of a START query.
+    scoped_ptr_t<ref_t> execute(query_params_t *query_params,
+                                ql::datum_t &&deterministic_time,
+                                signal_t *interruptor);
+
     void noreply_wait(const query_params_t &query_params,
                       signal_t *interruptor);
 
@@ -102,21 +153,50 @@ public:
 
     auth::user_context_t const &get_user_context() const;
 
+    // Whether there are no cursors or prepared queries, so that nothing would be lost
+    // if the connection went on with a new cache.
+    bool empty() const;
+
+    // How many bytes the batches that the connection's cursors have read before the
+    // client asked for them take up.
+    int64_t get_prefetched_bytes() const { return prefetched_bytes; }
+
 private:
+    // A query compiled by `prepare()`.  Its term is a function, which EXECUTE
+    // queries call with their arguments.
+    struct prepared_query_t {
+        scoped_ptr_t<const term_storage_t> term_storage;
+        global_optargs_t global_optargs;
+        counted_t<const term_t> func_term;
+        std::shared_ptr<const query_fingerprint_t> fingerprint;
+        // The key of the function in the server's result cache, if it can be cached.
+        optional<std::string> result_cache_key;
+    };
+
     class entry_t {
     public:
         entry_t(query_params_t *query_params,
                 global_optargs_t &&_global_optargs,
                 ql::datum_t &&_deterministic_time,
-                counted_t<const term_t> &&_term_tree);
+                counted_t<const term_t> &&_term_tree,
+                std::shared_ptr<const query_fingerprint_t> &&_fingerprint,
+                std::shared_ptr<const prepared_query_t> &&_prepared_query =
+                    std::shared_ptr<const prepared_query_t>(),
+                std::vector<datum_t> &&_prepared_args = std::vector<datum_t>());
         ~entry_t();
 
+        // The backtraces of errors refer to the prepared query's terms if there is
+        // one.
+        const backtrace_registry_t &backtrace_registry() const;
+
         enum class state_t { START, STREAM, DONE, DELETING } state;
         interrupt_reason_t interrupt_reason;
 
         const uuid_u job_id;
         const bool noreply;
         const profile_bool_t profile;
+        // Also used for the query's CONTINUE requests.
+        const query_priority_t priority;
         const scoped_ptr_t<const term_storage_t> term_storage;
         const global_optargs_t global_optargs;
         // TODO: deterministic_time and start_time represent approximately the same
@@ -124,17 +204,46 @@ private:
         // boost::posix_time.
         const ql::datum_t deterministic_time;
         const kiloticks_t start_time;
+        // What serving the query costs is recorded under this in the
+        // `rethinkdb._query_stats` table.
+        const std::shared_ptr<const query_fingerprint_t> fingerprint;
 
         cond_t persistent_interruptor;
 
         // This will be empty if the root term has already been run
         counted_t<const term_t> term_tree;
 
+        // For EXECUTE queries, which run this instead of `term_tree`.  Holding on to
+        // the prepared query keeps it alive if it's unprepared in the meantime.
+        const std::shared_ptr<const prepared_query_t> prepared_query;
+        std::vector<datum_t> prepared_args;
+
+        // Set if the query's result may come from the server's result cache.
+        optional<std::string> result_cache_key;
+
         // This will be empty until the root term has been evaluated
         // If this resulted in a stream, this will not be empty until the
         // stream is finished
         counted_t<datum_stream_t> stream;
         bool has_sent_batch;
+        adaptive_batch_size_t batch_size;
+
+        // The batch after the last one we sent, read while the client was busy with
+        // that one, or the error we got reading it.  At most one of them is set.
+        optional<std::vector<datum_t> > prefetched_batch;
+        std::exception_ptr prefetch_error;
+
+        // How many more batches the client is ready for; see `take_credit()`.
+        int64_t credits;
+
+        // The serialized size of `prefetched_batch`, which is also counted in the
+        // cache's `prefetched_bytes`.
+        int64_t prefetched_bytes;
+
+        // How many `ref_t`s there are for the entry, and when the last one was
+        // destroyed.  The entry is idle while there are none.
+        int64_t num_refs;
+        kiloticks_t last_ref_time;
 
         // The order of these is very important, do not move them around
         new_mutex_t mutex; // Only one coroutine may be using this query at a time
@@ -146,11 +255,35 @@ private:
 
     static void async_destroy_entry(entry_t *entry);
 
+    // Removes the entry from `queries`, so that no new `ref_t`s can get it, and
+    // deletes it once the existing ones are gone.
+    void remove_entry(std::map<int64_t, scoped_ptr_t<entry_t> >::iterator it);
+
+    // Called by `idle_timer` to close the cursors that have been idle for longer than
+    // `QUERY_CACHE_IDLE_CURSOR_TIMEOUT_MS`.
+    void close_idle_cursors();
+
+    // Whether the query asked for its result to be cached, and we can do that.
+    bool use_result_cache(const query_params_t &query_params) const;
+
+    // Reads the next batch of a cursor that isn't a feed, sized by its
+    // `adaptive_batch_size_t`.
+    static std::vector<datum_t> read_batch(env_t *env,
+                                           entry_t *entry,
+                                           batch_type_t batch_type,
+                                           int64_t *bytes_out = nullptr);
+
+    // Runs in its own coroutine, after a batch was sent, to read the next one before
+    // the client asks for it.  It queues up on the entry's mutex like a `ref_t` would,
+    // and gives up if the query is stopped or deleted in the meantime.
+    void prefetch_batch(entry_t *entry, auto_drainer_t::lock_t entry_keepalive);
+
     rdb_context_t *const rdb_ctx;
     ip_and_port_t client_addr_port;
     return_empty_normal_batches_t return_empty_normal_batches;
     auth::user_context_t user_context;
     std::map<int64_t, scoped_ptr_t<entry_t> > queries;
+    std::map<int64_t, std::shared_ptr<const prepared_query_t> > prepared_queries;
 
     // Used for noreply waiting, this contains all allocated-but-incomplete query ids
     friend class query_params_t::query_id_t;
@@ -158,6 +291,9 @@ private:
     intrusive_list_t<query_params_t::query_id_t> outstanding_query_ids;
     watchable_variable_t<uint64_t> oldest_outstanding_query_id;
 
+    int64_t prefetched_bytes;
+    repeating_timer_t idle_timer;
+
     DISABLE_COPYING(query_cache_t);
 };
 
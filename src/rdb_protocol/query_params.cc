@@ -68,11 +68,38 @@ query_params_t::query_params_t(int64_t _token,
                                scoped_ptr_t<term_storage_t> &&_term_storage) :
         query_cache(_query_cache),
         term_storage(std::move(_term_storage)),
-        id(query_cache), token(_token), noreply(false), profile(false) {
+        id(query_cache), token(_token), noreply(false), profile(false),
+        priority(query_priority_t::NORMAL), result_cache(false), credits(0),
+        received_time(get_ticks()) {
     // Parse out information that is needed before query evaluation
     type = term_storage->query_type();
     noreply = term_storage->static_optarg_as_bool("noreply", noreply);
     profile = term_storage->static_optarg_as_bool("profile", profile);
+    if (type == Query::START || type == Query::EXECUTE) {
+        const std::string priority_str =
+            term_storage->static_optarg_as_string("priority", "normal");
+        if (priority_str == "high") {
+            priority = query_priority_t::HIGH;
+        } else if (priority_str == "low") {
+            priority = query_priority_t::LOW;
+        } else if (priority_str != "normal") {
+            throw bt_exc_t(Response::CLIENT_ERROR, Response::QUERY_LOGIC,
+                           strprintf("Priority `%s` unrecognized (options are "
+                                     "\"high\", \"normal\", and \"low\").",
+                                     priority_str.c_str()),
+                           backtrace_registry_t::EMPTY_BACKTRACE);
+        }
+        result_cache = term_storage->static_optarg_as_bool("result_cache", result_cache);
+    }
+    if (type == Query::START || type == Query::EXECUTE || type == Query::CONTINUE) {
+        credits = term_storage->static_optarg_as_int("credits", credits);
+        if (credits < 0 || credits > MAX_QUERY_CREDITS) {
+            throw bt_exc_t(Response::CLIENT_ERROR, Response::QUERY_LOGIC,
+                           strprintf("Credits must be between 0 and %d.",
+                                     MAX_QUERY_CREDITS),
+                           backtrace_registry_t::EMPTY_BACKTRACE);
+        }
+    }
 }
 
 } // namespace ql
@@ -2,16 +2,25 @@
 #ifndef RDB_PROTOCOL_QUERY_PARAMS_HPP_
 #define RDB_PROTOCOL_QUERY_PARAMS_HPP_
 
+#include <memory>
+
 #include "concurrency/new_semaphore.hpp"
 #include "containers/intrusive_list.hpp"
 #include "containers/scoped.hpp"
 #include "rdb_protocol/error.hpp"
 #include "rdb_protocol/ql2proto.hpp"
+#include "rdb_protocol/query_scheduler.hpp"
+#include "rdb_protocol/query_trace.hpp"
+#include "time.hpp"
+
+/* The most batches a client can grant a cursor with one query's `credits` optarg. */
+#define MAX_QUERY_CREDITS 1000000
 
 namespace ql {
 
 class query_cache_t;
 class term_storage_t;
+struct query_fingerprint_t;
 
 class query_params_t {
 public:
@@ -45,6 +54,22 @@ public:
     Query::QueryType type;
     bool noreply;
     bool profile;
+    query_priority_t priority;
+    // Whether the result may come from, and go into, the server's query result cache.
+    bool result_cache;
+    // How many more of a cursor's batches the client is ready for, which we send
+    // without waiting for CONTINUE queries.
+    int64_t credits;
+
+    // When the query was read from the client, for the slow query log.
+    ticks_t received_time;
+
+    // Set if this query is one of those sampled by `query_trace_log_t`.
+    scoped_ptr_t<query_trace_t> trace;
+
+    // Set once the query has been found in the cache, so that sending the response
+    // can be recorded in the `rethinkdb._query_stats` table.
+    std::shared_ptr<const query_fingerprint_t> fingerprint;
 
     new_semaphore_in_line_t throttler;
 
@@ -0,0 +1,364 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "rdb_protocol/query_result_cache.hpp"
+
+#include <functional>
+#include <list>
+#include <set>
+#include <unordered_map>
+#include <utility>
+
+#include "arch/runtime/coroutines.hpp"
+#include "clustering/administration/auth/permission_error.hpp"
+#include "concurrency/auto_drainer.hpp"
+#include "containers/archive/vector_stream.hpp"
+#include "rdb_protocol/changefeed.hpp"
+#include "rdb_protocol/env.hpp"
+#include "rdb_protocol/optargs.hpp"
+#include "rdb_protocol/ql2proto.hpp"
+#include "rdb_protocol/serialize_datum.hpp"
+#include "rdb_protocol/term_storage.hpp"
+#include "time.hpp"
+
+namespace ql {
+
+namespace {
+
+// Queries nested deeper than this aren't cached.
+const size_t MAX_KEY_DEPTH = 256;
+
+// Whether a query containing a term of this type may be cached.  These terms write,
+// return something different every time, or read something that isn't a table.
+bool is_cacheable_term_type(Term::TermType type) {
+    switch (type) {
+    case Term::NOW: // fallthru
+    case Term::RANDOM: // fallthru
+    case Term::UUID: // fallthru
+    case Term::SAMPLE: // fallthru
+    case Term::HTTP: // fallthru
+    case Term::JAVASCRIPT: // fallthru
+    case Term::INSERT: // fallthru
+    case Term::UPDATE: // fallthru
+    case Term::REPLACE: // fallthru
+    case Term::DELETE: // fallthru
+    case Term::SYNC: // fallthru
+    case Term::FOR_EACH: // fallthru
+    case Term::CHANGES: // fallthru
+    case Term::DB_CREATE: // fallthru
+    case Term::DB_DROP: // fallthru
+    case Term::DB_LIST: // fallthru
+    case Term::TABLE_CREATE: // fallthru
+    case Term::TABLE_DROP: // fallthru
+    case Term::TABLE_LIST: // fallthru
+    case Term::CONFIG: // fallthru
+    case Term::STATUS: // fallthru
+    case Term::WAIT: // fallthru
+    case Term::RECONFIGURE: // fallthru
+    case Term::REBALANCE: // fallthru
+    case Term::INDEX_CREATE: // fallthru
+    case Term::INDEX_DROP: // fallthru
+    case Term::INDEX_LIST: // fallthru
+    case Term::INDEX_STATUS: // fallthru
+    case Term::INDEX_WAIT: // fallthru
+    case Term::INDEX_RENAME: // fallthru
+    case Term::SET_WRITE_HOOK: // fallthru
+    case Term::GET_WRITE_HOOK: // fallthru
+    case Term::GRANT: // fallthru
+    case Term::INFO:
+        return false;
+    default:
+        return true;
+    }
+}
+
+// Appends the text of `term` to `out`.  Unlike the fingerprint of the query, this
+// keeps all of its constants.  Returns false if the query can't be cached.
+bool print_term(const raw_term_t &term, size_t depth, std::string *out) {
+    if (depth > MAX_KEY_DEPTH || out->size() > QUERY_RESULT_CACHE_MAX_KEY_SIZE) {
+        return false;
+    }
+    const Term::TermType type = term.type();
+    if (type == Term::DATUM) {
+        *out += term.datum().print();
+        return true;
+    }
+    if (!is_cacheable_term_type(type)) {
+        return false;
+    }
+
+    *out += strprintf("%d(", static_cast<int>(type));
+    for (size_t i = 0; i < term.num_args(); ++i) {
+        if (i != 0) {
+            *out += ",";
+        }
+        if (!print_term(term.arg(i), depth + 1, out)) {
+            return false;
+        }
+    }
+    // Sorted, so that the order the client sent them in doesn't matter.
+    std::map<std::string, raw_term_t> optargs;
+    term.each_optarg([&](const raw_term_t &optarg, const std::string &name) {
+        optargs.insert(std::make_pair(name, optarg));
+    });
+    for (const auto &pair : optargs) {
+        *out += "," + pair.first + "=";
+        if (!print_term(pair.second, depth + 1, out)) {
+            return false;
+        }
+    }
+    *out += ")";
+    return true;
+}
+
+}  // namespace
+
+struct query_result_cache_t::table_watcher_t {
+    table_watcher_t() : ready_nanos(0), last_change_nanos(0) { }
+
+    // When the changefeed on the table was set up, or 0 until then.
+    int64_t ready_nanos;
+    // When the changefeed last reported a change.
+    int64_t last_change_nanos;
+    // The keys of the cached results that read the table.
+    std::set<std::string> keys;
+};
+
+/* Only ever accessed on its own thread. */
+struct query_result_cache_t::thread_cache_t {
+    explicit thread_cache_t(query_result_cache_t *_parent)
+        : parent(_parent), size(0) { }
+
+    struct entry_t {
+        datum_t result;
+        size_t size;
+        std::map<namespace_id_t, database_id_t> tables;
+        // Where the entry is in `lru`.
+        std::list<const std::string *>::iterator lru_it;
+    };
+
+    void erase(std::unordered_map<std::string, entry_t>::iterator it) {
+        for (const auto &pair : it->second.tables) {
+            auto watcher_it = watchers.find(pair.first);
+            if (watcher_it != watchers.end()) {
+                watcher_it->second.keys.erase(it->first);
+            }
+        }
+        lru.erase(it->second.lru_it);
+        size -= it->second.size;
+        entries.erase(it);
+    }
+
+    void erase_table(const namespace_id_t &table_id) {
+        auto watcher_it = watchers.find(table_id);
+        if (watcher_it == watchers.end()) {
+            return;
+        }
+        std::set<std::string> keys;
+        keys.swap(watcher_it->second.keys);
+        for (const std::string &key : keys) {
+            auto it = entries.find(key);
+            if (it != entries.end()) {
+                erase(it);
+            }
+        }
+    }
+
+    // Subscribes to the changes on the table, and throws away the results that read
+    // it whenever there is one.  If the changefeed fails, we stop watching the table
+    // until another query reads it.
+    void watch(const namespace_id_t &table_id,
+               const tracked_reads_t::table_t &table,
+               auto_drainer_t::lock_t keepalive) {
+        try {
+            // The changefeed only needs read access to the table, and we never
+            // return what it reads to anyone.
+            env_t env(parent->rdb_ctx,
+                      return_empty_normal_batches_t::NO,
+                      keepalive.get_drain_signal(),
+                      global_optargs_t(),
+                      auth::user_context_t(auth::permissions_t(
+                          tribool::True, tribool::False, tribool::False,
+                          tribool::False)),
+                      datum_t(),
+                      nullptr);
+            counted_t<datum_stream_t> stream = parent->changefeed_client->new_stream(
+                &env,
+                changefeed::streamspec_t(
+                    counted_t<datum_stream_t>(),
+                    table.name,
+                    false,
+                    false,
+                    false,
+                    configured_limits_t(),
+                    datum_t::boolean(false),
+                    false,
+                    r_nullopt,
+                    changefeed::queue_overflow_t::CLEAR,
+                    changefeed::keyspec_t::range_t{
+                        std::vector<transform_variant_t>(),
+                        r_nullopt,
+                        sorting_t::UNORDERED,
+                        datumspec_t(datum_range_t::universe()),
+                        r_nullopt}),
+                table_id,
+                backtrace_id_t::empty());
+            watchers[table_id].ready_nanos = get_ticks().nanos;
+
+            while (!stream->is_exhausted()) {
+                stream->next_batch(&env, batchspec_t::default_for(batch_type_t::NORMAL));
+                watchers[table_id].last_change_nanos = get_ticks().nanos;
+                erase_table(table_id);
+            }
+        } catch (const interrupted_exc_t &) {
+            // We're shutting down.
+        } catch (const std::exception &) {
+            // The table was deleted or isn't available right now.
+        }
+        erase_table(table_id);
+        watchers.erase(table_id);
+    }
+
+    query_result_cache_t *parent;
+
+    std::unordered_map<std::string, entry_t> entries;
+    // The keys of `entries`, least recently used first.
+    std::list<const std::string *> lru;
+    // The total size of `entries`.
+    size_t size;
+
+    std::map<namespace_id_t, table_watcher_t> watchers;
+
+    // Destroyed first, so that the watchers stop while the maps still exist.
+    auto_drainer_t drainer;
+};
+
+query_result_cache_t::query_result_cache_t(rdb_context_t *_rdb_ctx,
+                                           changefeed::client_t *_changefeed_client)
+    : rdb_ctx(_rdb_ctx),
+      changefeed_client(_changefeed_client),
+      thread_caches(this) { }
+
+query_result_cache_t::~query_result_cache_t() { }
+
+optional<std::string> query_result_cache_t::make_key(
+        const raw_term_t &root_term,
+        const global_optargs_t &global_optargs,
+        const auth::user_context_t &user_context) {
+    std::string key;
+    if (!print_term(root_term, 0, &key)) {
+        return r_nullopt;
+    }
+    key += '\0';
+    key += user_context.to_string();
+    key += '\0';
+
+    // Global optargs like `db` and `read_mode` change what the query returns.
+    write_message_t wm;
+    serialize<cluster_version_t::CLUSTER>(&wm, global_optargs);
+    vector_stream_t stream;
+    int res = send_write_message(&stream, &wm);
+    guarantee(res == 0);
+    key.append(stream.vector().begin(), stream.vector().end());
+
+    if (key.size() > QUERY_RESULT_CACHE_MAX_KEY_SIZE) {
+        return r_nullopt;
+    }
+    return make_optional(std::move(key));
+}
+
+std::string query_result_cache_t::make_prepared_key(
+        const std::string &func_key,
+        const std::vector<datum_t> &args) {
+    std::string key = func_key;
+    for (const datum_t &arg : args) {
+        key += '\0';
+        key += arg.print();
+    }
+    return key;
+}
+
+optional<datum_t> query_result_cache_t::get(
+        const std::string &key,
+        const auth::user_context_t &user_context) {
+    thread_cache_t *cache = thread_caches.get();
+    auto it = cache->entries.find(key);
+    if (it == cache->entries.end()) {
+        return r_nullopt;
+    }
+    // The user's permissions may have been revoked since the result was cached.
+    const std::map<namespace_id_t, database_id_t> tables = it->second.tables;
+    const datum_t result = it->second.result;
+    try {
+        for (const auto &pair : tables) {
+            user_context.require_read_permission(rdb_ctx, pair.second, pair.first);
+        }
+    } catch (const auth::permission_error_t &) {
+        return r_nullopt;
+    }
+
+    it = cache->entries.find(key);
+    if (it != cache->entries.end()) {
+        cache->lru.splice(cache->lru.end(), cache->lru, it->second.lru_it);
+    }
+    return make_optional(result);
+}
+
+void query_result_cache_t::insert(const std::string &key,
+                                  const datum_t &result,
+                                  const tracked_reads_t &reads,
+                                  int64_t start_nanos) {
+    if (reads.untracked || reads.tables.empty()) {
+        return;
+    }
+    thread_cache_t *cache = thread_caches.get();
+
+    // We can only be sure the result is still valid if the changefeeds on its tables
+    // were set up before the query started, and haven't seen a change since.
+    bool valid = true;
+    for (const auto &pair : reads.tables) {
+        auto watcher_it = cache->watchers.find(pair.first);
+        if (watcher_it == cache->watchers.end()) {
+            valid = false;
+            if (cache->watchers.size() < QUERY_RESULT_CACHE_MAX_TABLES_PER_THREAD) {
+                cache->watchers[pair.first];
+                coro_t::spawn_sometime(std::bind(&thread_cache_t::watch,
+                                                 cache,
+                                                 pair.first,
+                                                 pair.second,
+                                                 auto_drainer_t::lock_t(
+                                                     &cache->drainer)));
+            }
+        } else if (watcher_it->second.ready_nanos == 0
+                   || watcher_it->second.ready_nanos > start_nanos
+                   || watcher_it->second.last_change_nanos >= start_nanos) {
+            valid = false;
+        }
+    }
+    if (!valid) {
+        return;
+    }
+
+    const size_t size = key.size()
+        + datum_serialized_size(result, check_datum_serialization_errors_t::NO);
+    if (size > QUERY_RESULT_CACHE_SIZE_PER_THREAD) {
+        return;
+    }
+    auto it = cache->entries.find(key);
+    if (it != cache->entries.end()) {
+        cache->erase(it);
+    }
+    while (cache->size + size > QUERY_RESULT_CACHE_SIZE_PER_THREAD) {
+        cache->erase(cache->entries.find(*cache->lru.front()));
+    }
+
+    it = cache->entries.insert(std::make_pair(key, thread_cache_t::entry_t())).first;
+    it->second.result = result;
+    it->second.size = size;
+    for (const auto &pair : reads.tables) {
+        it->second.tables.insert(std::make_pair(pair.first, pair.second.database));
+        cache->watchers[pair.first].keys.insert(key);
+    }
+    it->second.lru_it = cache->lru.insert(cache->lru.end(), &it->first);
+    cache->size += size;
+}
+
+}  // namespace ql
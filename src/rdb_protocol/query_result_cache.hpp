@@ -0,0 +1,104 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef RDB_PROTOCOL_QUERY_RESULT_CACHE_HPP_
+#define RDB_PROTOCOL_QUERY_RESULT_CACHE_HPP_
+
+#include <stdint.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "clustering/administration/auth/user_context.hpp"
+#include "concurrency/one_per_thread.hpp"
+#include "containers/optional.hpp"
+#include "containers/uuid.hpp"
+#include "rdb_protocol/datum.hpp"
+
+/* How much memory the results cached on each thread may take up.  The least recently
+used results are thrown away to make room for new ones. */
+#define QUERY_RESULT_CACHE_SIZE_PER_THREAD         (16 * MEGABYTE)
+
+/* Queries whose text is longer than this aren't cached, since they are unlikely to be
+repeated. */
+#define QUERY_RESULT_CACHE_MAX_KEY_SIZE            (16 * KILOBYTE)
+
+/* How many tables each thread watches for changes.  Queries that read other tables
+aren't cached. */
+#define QUERY_RESULT_CACHE_MAX_TABLES_PER_THREAD   64
+
+class rdb_context_t;
+
+namespace ql {
+
+class global_optargs_t;
+class raw_term_t;
+
+namespace changefeed {
+class client_t;
+}
+
+/* The tables a query reads, recorded through `env_t::tracked_reads` while the query
+runs, so that its result can be thrown away when one of them changes. */
+struct tracked_reads_t {
+    tracked_reads_t() : untracked(false) { }
+
+    struct table_t {
+        database_id_t database;
+        std::string name;
+    };
+    std::map<namespace_id_t, table_t> tables;
+
+    // Set if the query read something we can't watch for changes, like a system
+    // table.
+    bool untracked;
+};
+
+/* Caches the results of read queries that opt in with the `result_cache` global
+optarg.  A result is cached under the query's text, its global optargs and the user
+that ran it, and is thrown away as soon as a changefeed on one of the tables it read
+reports a change.  A result is only cached if its tables were already being watched
+when the query started, so the first run of a query on a table isn't cached.
+
+There is one cache per server, but each thread keeps its own results and changefeeds,
+so that a cache hit never has to switch threads. */
+class query_result_cache_t {
+public:
+    query_result_cache_t(rdb_context_t *rdb_ctx,
+                         changefeed::client_t *changefeed_client);
+    ~query_result_cache_t();
+
+    // Returns the key to cache the result of the query under, or `r_nullopt` if the
+    // query can't be cached because it writes, isn't deterministic or is too long.
+    static optional<std::string> make_key(const raw_term_t &root_term,
+                                          const global_optargs_t &global_optargs,
+                                          const auth::user_context_t &user_context);
+    // The key of a prepared query run with `args`, from the key of its function.
+    static std::string make_prepared_key(const std::string &func_key,
+                                         const std::vector<datum_t> &args);
+
+    // Returns the cached result, if there is one and `user_context` may still read
+    // the tables it came from.
+    optional<datum_t> get(const std::string &key,
+                          const auth::user_context_t &user_context);
+
+    // Caches the result of a query that started at `start_nanos` and read `reads`,
+    // unless one of the tables may have changed since then.
+    void insert(const std::string &key,
+                const datum_t &result,
+                const tracked_reads_t &reads,
+                int64_t start_nanos);
+
+private:
+    struct table_watcher_t;
+    struct thread_cache_t;
+
+    rdb_context_t *const rdb_ctx;
+    changefeed::client_t *const changefeed_client;
+    one_per_thread_t<thread_cache_t> thread_caches;
+
+    DISABLE_COPYING(query_result_cache_t);
+};
+
+}  // namespace ql
+
+#endif  // RDB_PROTOCOL_QUERY_RESULT_CACHE_HPP_
@@ -0,0 +1,191 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "rdb_protocol/query_scheduler.hpp"
+
+#include <array>
+#include <deque>
+#include <map>
+
+#include "arch/runtime/runtime.hpp"
+#include "concurrency/cache_line_padded.hpp"
+#include "concurrency/interruptor.hpp"
+#include "perfmon/perfmon.hpp"
+
+namespace ql {
+
+namespace {
+
+perfmon_collection_t pm_query_scheduler_collection;
+perfmon_membership_t pm_query_scheduler_membership(
+    &get_global_perfmon_collection(), &pm_query_scheduler_collection,
+    "query_scheduler");
+perfmon_counter_t pm_queries_running, pm_queries_waiting;
+perfmon_histogram_t pm_queue_wait(secs_to_ticks(1), false);
+perfmon_multi_membership_t pm_query_scheduler_values_membership(
+    &pm_query_scheduler_collection,
+    &pm_queries_running, "running",
+    &pm_queries_waiting, "waiting",
+    &pm_queue_wait, "queue_wait");
+
+}  // namespace
+
+/* Only ever accessed on its own thread. */
+class query_scheduler_t {
+public:
+    typedef query_slot_t::waiter_t waiter_t;
+
+    query_scheduler_t() : running(0) { }
+
+    // Returns whether `waiter` got a slot right away.
+    bool enqueue(waiter_t *waiter) {
+        ++pm_queries_waiting;
+        if (running < QUERY_SCHEDULER_SLOTS_PER_THREAD && !has_waiters()) {
+            grant(waiter);
+            return true;
+        }
+        class_queue_t *queue = &queues[static_cast<int>(waiter->priority)];
+        std::deque<waiter_t *> *client_queue = &queue->waiting[waiter->client];
+        if (client_queue->empty()) {
+            queue->turns.push_back(waiter->client);
+        }
+        client_queue->push_back(waiter);
+        return false;
+    }
+
+    // For a waiter that gave up before it got a slot.
+    void remove(waiter_t *waiter) {
+        class_queue_t *queue = &queues[static_cast<int>(waiter->priority)];
+        auto it = queue->waiting.find(waiter->client);
+        guarantee(it != queue->waiting.end());
+        for (auto jt = it->second.begin(); jt != it->second.end(); ++jt) {
+            if (*jt == waiter) {
+                it->second.erase(jt);
+                break;
+            }
+        }
+        if (it->second.empty()) {
+            queue->waiting.erase(it);
+            for (auto jt = queue->turns.begin(); jt != queue->turns.end(); ++jt) {
+                if (*jt == waiter->client) {
+                    queue->turns.erase(jt);
+                    break;
+                }
+            }
+        }
+        --pm_queries_waiting;
+    }
+
+    void release() {
+        guarantee(running > 0);
+        --running;
+        --pm_queries_running;
+        if (running < QUERY_SCHEDULER_SLOTS_PER_THREAD) {
+            grant_next();
+        }
+    }
+
+private:
+    struct class_queue_t {
+        std::map<const void *, std::deque<waiter_t *> > waiting;
+        // The clients with waiting queries, in the order they get their turns.
+        std::deque<const void *> turns;
+    };
+
+    bool has_waiters() const {
+        for (const class_queue_t &queue : queues) {
+            if (!queue.turns.empty()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void grant(waiter_t *waiter) {
+        ++running;
+        ++pm_queries_running;
+        --pm_queries_waiting;
+        const ticks_t now = get_ticks();
+        pm_queue_wait.record(ticks_t{now.nanos - waiter->enqueue_time.nanos}, now);
+        waiter->granted.pulse();
+    }
+
+    void grant_next() {
+        for (class_queue_t &queue : queues) {
+            if (queue.turns.empty()) {
+                continue;
+            }
+            const void *client = queue.turns.front();
+            queue.turns.pop_front();
+            auto it = queue.waiting.find(client);
+            guarantee(it != queue.waiting.end() && !it->second.empty());
+            waiter_t *waiter = it->second.front();
+            it->second.pop_front();
+            if (it->second.empty()) {
+                queue.waiting.erase(it);
+            } else {
+                queue.turns.push_back(client);
+            }
+            grant(waiter);
+            return;
+        }
+    }
+
+    int64_t running;
+    class_queue_t queues[NUM_QUERY_PRIORITIES];
+
+    DISABLE_COPYING(query_scheduler_t);
+};
+
+static std::array<cache_line_padded_t<query_scheduler_t>, MAX_THREADS>
+    query_schedulers;
+
+query_slot_t::query_slot_t() : scheduler(nullptr) { }
+
+query_slot_t::query_slot_t(query_slot_t &&movee)
+    : scheduler(movee.scheduler) {
+    movee.scheduler = nullptr;
+}
+
+query_slot_t &query_slot_t::operator=(query_slot_t &&movee) {
+    reset();
+    scheduler = movee.scheduler;
+    movee.scheduler = nullptr;
+    return *this;
+}
+
+query_slot_t::~query_slot_t() {
+    reset();
+}
+
+void query_slot_t::acquire(const void *client,
+                           query_priority_t priority,
+                           signal_t *interruptor) {
+    guarantee(scheduler == nullptr);
+    query_scheduler_t *thread_scheduler =
+        &query_schedulers[get_thread_id().threadnum].value;
+    waiter_t waiter;
+    waiter.client = client;
+    waiter.priority = priority;
+    waiter.enqueue_time = get_ticks();
+    if (!thread_scheduler->enqueue(&waiter)) {
+        try {
+            wait_interruptible(&waiter.granted, interruptor);
+        } catch (const interrupted_exc_t &) {
+            if (waiter.granted.is_pulsed()) {
+                thread_scheduler->release();
+            } else {
+                thread_scheduler->remove(&waiter);
+            }
+            throw;
+        }
+    }
+    scheduler = thread_scheduler;
+}
+
+void query_slot_t::reset() {
+    if (scheduler != nullptr) {
+        scheduler->release();
+        scheduler = nullptr;
+    }
+}
+
+}  // namespace ql
@@ -0,0 +1,58 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef RDB_PROTOCOL_QUERY_SCHEDULER_HPP_
+#define RDB_PROTOCOL_QUERY_SCHEDULER_HPP_
+
+#include "concurrency/cond_var.hpp"
+#include "concurrency/signal.hpp"
+#include "time.hpp"
+
+/* How many queries may run on each thread at once.  Queries spend much of their time
+waiting for disk and the network, so this is more than one, but a thread can't do more
+than one thread's worth of work, so clients that send more queries than this have to
+wait for their turn. */
+#define QUERY_SCHEDULER_SLOTS_PER_THREAD 16
+
+namespace ql {
+
+/* Set with the `priority` global optarg.  Queries only get a slot while no query with
+a higher priority is waiting. */
+enum class query_priority_t { HIGH = 0, NORMAL = 1, LOW = 2 };
+
+static const int NUM_QUERY_PRIORITIES = 3;
+
+class query_scheduler_t;
+
+/* A slot for running a query on the current thread.  Each thread's scheduler gives
+the free slots to the waiting queries of the highest priority, taking turns between
+the connections that have queries waiting, so that a connection that pipelines many
+queries doesn't hold up the others. */
+class query_slot_t {
+public:
+    query_slot_t();
+    query_slot_t(query_slot_t &&movee);
+    query_slot_t &operator=(query_slot_t &&movee);
+    ~query_slot_t();
+
+    // Waits for a slot.  `client` identifies the connection the query came from.
+    void acquire(const void *client, query_priority_t priority, signal_t *interruptor);
+
+    // Gives up the slot, if we have one.
+    void reset();
+
+private:
+    friend class query_scheduler_t;
+    struct waiter_t {
+        const void *client;
+        query_priority_t priority;
+        ticks_t enqueue_time;
+        cond_t granted;
+    };
+
+    query_scheduler_t *scheduler;
+
+    DISABLE_COPYING(query_slot_t);
+};
+
+}  // namespace ql
+
+#endif  // RDB_PROTOCOL_QUERY_SCHEDULER_HPP_
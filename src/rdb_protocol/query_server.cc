@@ -12,10 +12,12 @@
 rdb_query_server_t::rdb_query_server_t(
     const std::set<ip_address_t> &local_addresses, int port,
     rdb_context_t *_rdb_ctx, server_config_client_t *_server_config_client,
-    const server_id_t &_server_id, tls_ctx_t *tls_ctx
+    const server_id_t &_server_id, tls_ctx_t *tls_ctx,
+    bool accept_on_all_threads
 ) :
     server(
-        _rdb_ctx, local_addresses, port, this, default_http_timeout_sec, tls_ctx
+        _rdb_ctx, local_addresses, port, this, default_http_timeout_sec, tls_ctx,
+        accept_on_all_threads
     ),
     rdb_ctx(_rdb_ctx),
     server_config_client(_server_config_client),
@@ -35,6 +37,7 @@ void rdb_query_server_t::run_query(ql::query_params_t *query_params,
                                    signal_t *interruptor) {
     guarantee(interruptor != nullptr);
     guarantee(rdb_ctx->cluster_interface != nullptr);
+    const ticks_t start_time = get_ticks();
     try {
         // TODO: make this perfmon correct now that we have parallelized queries
         scoped_perfmon_counter_t client_active(&rdb_ctx->stats.clients_active);
@@ -44,11 +47,19 @@ void rdb_query_server_t::run_query(ql::query_params_t *query_params,
             scoped_ptr_t<ql::query_cache_t::ref_t> query_ref =
                 query_params->query_cache->create(query_params, ql::pseudo::time_now(),
                                                   interruptor);
+            query_params->fingerprint = query_ref->get_fingerprint();
             query_ref->fill_response(response_out);
         } break;
         case Query::CONTINUE: {
+            if (query_params->noreply && query_params->credits > 0) {
+                // The client only wants to grant credits.  The connection sends the
+                // batches they're for.
+                query_params->query_cache->grant_credits(query_params);
+                break;
+            }
             scoped_ptr_t<ql::query_cache_t::ref_t> query_ref =
                 query_params->query_cache->get(query_params, interruptor);
+            query_params->fingerprint = query_ref->get_fingerprint();
             query_ref->fill_response(response_out);
         } break;
         case Query::STOP: {
@@ -63,6 +74,23 @@ void rdb_query_server_t::run_query(ql::query_params_t *query_params,
             fill_server_info(response_out);
             response_out->set_type(Response::SERVER_INFO);
         } break;
+        case Query::PREPARE: {
+            query_params->query_cache->prepare(query_params);
+            response_out->set_type(Response::SUCCESS_ATOM);
+            response_out->set_data(ql::datum_t::null());
+        } break;
+        case Query::EXECUTE: {
+            scoped_ptr_t<ql::query_cache_t::ref_t> query_ref =
+                query_params->query_cache->execute(query_params, ql::pseudo::time_now(),
+                                                   interruptor);
+            query_params->fingerprint = query_ref->get_fingerprint();
+            query_ref->fill_response(response_out);
+        } break;
+        case Query::UNPREPARE: {
+            query_params->query_cache->unprepare(*query_params);
+            response_out->set_type(Response::SUCCESS_ATOM);
+            response_out->set_data(ql::datum_t::null());
+        } break;
         default: unreachable();
         }
     } catch (const ql::bt_exc_t &ex) {
@@ -81,6 +109,10 @@ void rdb_query_server_t::run_query(ql::query_params_t *query_params,
 
     rdb_ctx->stats.queries_per_sec.record();
     ++rdb_ctx->stats.queries_total;
+    if (query_params->type == Query::START || query_params->type == Query::EXECUTE) {
+        const ticks_t now = get_ticks();
+        rdb_ctx->stats.query_latency.record(ticks_t{now.nanos - start_time.nanos}, now);
+    }
 }
 
 void rdb_query_server_t::fill_server_info(ql::response_t *out) {
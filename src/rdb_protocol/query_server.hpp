@@ -23,7 +23,8 @@ public:
     rdb_query_server_t(
       const std::set<ip_address_t> &local_addresses, int port,
       rdb_context_t *_rdb_ctx, server_config_client_t *_server_config_client,
-      const server_id_t &_server_id, tls_ctx_t *tls_ctx);
+      const server_id_t &_server_id, tls_ctx_t *tls_ctx,
+      bool accept_on_all_threads = false);
 
     http_app_t *get_http_app();
     int get_port() const;
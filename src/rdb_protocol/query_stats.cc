@@ -0,0 +1,279 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "rdb_protocol/query_stats.hpp"
+
+#include <inttypes.h>
+
+#include <array>
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "arch/runtime/runtime.hpp"
+#include "concurrency/cache_line_padded.hpp"
+#include "concurrency/pmap.hpp"
+#include "rdb_protocol/ql2proto.hpp"
+#include "rdb_protocol/query_trace.hpp"
+#include "rdb_protocol/slow_query_log.hpp"
+#include "rdb_protocol/term_storage.hpp"
+#include "time.hpp"
+
+namespace ql {
+
+namespace {
+
+// Deeper terms are shown as `...`, like in the pretty printer.
+const size_t MAX_NORMALIZED_DEPTH = 64;
+// We stop normalizing a query once its text is this long.  The fingerprint is a hash
+// of the text, so queries that only differ after that have the same fingerprint.
+const size_t MAX_NORMALIZED_LENGTH = 16 * KILOBYTE;
+
+// Whether the datum arguments of a term of this type are names, which we keep, rather
+// than constants.
+bool has_name_args(Term::TermType type) {
+    switch (type) {
+    case Term::DB: // fallthru
+    case Term::TABLE: // fallthru
+    case Term::GET_FIELD: // fallthru
+    case Term::BRACKET: // fallthru
+    case Term::HAS_FIELDS: // fallthru
+    case Term::PLUCK: // fallthru
+    case Term::WITHOUT:
+        return true;
+    default:
+        return false;
+    }
+}
+
+void normalize_datum(const raw_term_t &term, bool is_name, std::string *out) {
+    if (is_name) {
+        datum_t d = term.datum();
+        if (d.get_type() == datum_t::R_STR) {
+            *out += d.print();
+            return;
+        }
+    }
+    *out += "?";
+}
+
+void normalize_term(const raw_term_t &term, size_t depth, std::string *out) {
+    if (depth > MAX_NORMALIZED_DEPTH || out->size() > MAX_NORMALIZED_LENGTH) {
+        *out += "...";
+        return;
+    }
+    const Term::TermType type = term.type();
+    if (type == Term::DATUM) {
+        normalize_datum(term, false, out);
+        return;
+    }
+
+    // Literal arrays of constants are normalized the same no matter how long they are.
+    if (type == Term::MAKE_ARRAY && term.num_optargs() == 0) {
+        bool all_constants = true;
+        for (size_t i = 0; i < term.num_args() && all_constants; ++i) {
+            all_constants = term.arg(i).type() == Term::DATUM;
+        }
+        if (all_constants) {
+            *out += "[?]";
+            return;
+        }
+    }
+
+    *out += Term::TermType_Name(type);
+    *out += "(";
+    const bool name_args = has_name_args(type);
+    for (size_t i = 0; i < term.num_args(); ++i) {
+        if (i != 0) {
+            *out += ", ";
+        }
+        raw_term_t arg = term.arg(i);
+        if (arg.type() == Term::DATUM) {
+            normalize_datum(arg, name_args, out);
+        } else {
+            normalize_term(arg, depth + 1, out);
+        }
+    }
+
+    // Sorted, so that the order the client sent them in doesn't matter.
+    std::map<std::string, raw_term_t> optargs;
+    term.each_optarg([&](const raw_term_t &optarg, const std::string &name) {
+        optargs.insert(std::make_pair(name, optarg));
+    });
+    bool first = term.num_args() == 0;
+    for (const auto &pair : optargs) {
+        if (!first) {
+            *out += ", ";
+        }
+        first = false;
+        *out += pair.first + "=";
+        if (pair.second.type() == Term::DATUM) {
+            normalize_datum(pair.second, pair.first == "index", out);
+        } else {
+            normalize_term(pair.second, depth + 1, out);
+        }
+    }
+    *out += ")";
+}
+
+// 64-bit FNV-1a.  Unlike `std::hash`, this is the same on all servers, so the
+// `rethinkdb._query_stats` table can merge their stats.
+uint64_t hash_query(const std::string &query) {
+    uint64_t hash = UINT64_C(14695981039346656037);
+    for (char c : query) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= UINT64_C(1099511628211);
+    }
+    // 0 is the fingerprint of the queries we don't have room for.
+    return hash == 0 ? 1 : hash;
+}
+
+struct fingerprint_stats_t {
+    std::string query;
+    query_stats_t stats;
+};
+
+/* Only ever accessed on its own thread. */
+struct thread_query_stats_t {
+    std::unordered_map<uint64_t, fingerprint_stats_t> fingerprints;
+};
+
+std::array<cache_line_padded_t<thread_query_stats_t>, MAX_THREADS> thread_query_stats;
+
+datum_t to_datum(const fingerprint_stats_t &fingerprint_stats) {
+    const query_stats_t &stats = fingerprint_stats.stats;
+    datum_object_builder_t builder;
+    builder.overwrite("query", datum_t(datum_string_t(fingerprint_stats.query)));
+    builder.overwrite("calls", datum_t(static_cast<double>(stats.calls)));
+    builder.overwrite("total_secs",
+                      datum_t(static_cast<double>(stats.total_nanos) / BILLION));
+    builder.overwrite("run_secs",
+                      datum_t(static_cast<double>(stats.usage.run_nanos) / BILLION));
+    builder.overwrite("cache_hits",
+                      datum_t(static_cast<double>(stats.usage.cache_hits)));
+    builder.overwrite("cache_misses",
+                      datum_t(static_cast<double>(stats.usage.cache_misses)));
+    builder.overwrite("blocks_read",
+                      datum_t(static_cast<double>(stats.usage.blocks_read)));
+    builder.overwrite("rows_scanned",
+                      datum_t(static_cast<double>(stats.usage.rows_scanned)));
+    builder.overwrite("rows_returned",
+                      datum_t(static_cast<double>(stats.rows_returned)));
+    builder.overwrite("bytes_sent", datum_t(static_cast<double>(stats.bytes_sent)));
+    return std::move(builder).to_datum();
+}
+
+}  // namespace
+
+query_fingerprint_t fingerprint_query(const raw_term_t &root_term) {
+    query_fingerprint_t fingerprint;
+    normalize_term(root_term, 0, &fingerprint.query);
+    fingerprint.id = hash_query(fingerprint.query);
+    if (fingerprint.query.size() > QUERY_STATS_MAX_QUERY_LENGTH) {
+        fingerprint.query.resize(QUERY_STATS_MAX_QUERY_LENGTH);
+        fingerprint.query += "...";
+    }
+    return fingerprint;
+}
+
+void query_stats_t::add(const query_stats_t &other) {
+    calls += other.calls;
+    total_nanos += other.total_nanos;
+    usage.add(other.usage);
+    rows_returned += other.rows_returned;
+    bytes_sent += other.bytes_sent;
+}
+
+void record_query_stats(const query_fingerprint_t &fingerprint,
+                        const query_stats_t &stats) {
+    std::unordered_map<uint64_t, fingerprint_stats_t> *fingerprints =
+        &thread_query_stats[get_thread_id().threadnum].value.fingerprints;
+    auto it = fingerprints->find(fingerprint.id);
+    if (it == fingerprints->end()) {
+        if (fingerprints->size() >= QUERY_STATS_MAX_FINGERPRINTS_PER_THREAD) {
+            it = fingerprints->find(0);
+            if (it == fingerprints->end()) {
+                it = fingerprints->insert(std::make_pair(
+                    0, fingerprint_stats_t{"<other queries>", query_stats_t()})).first;
+            }
+        } else {
+            it = fingerprints->insert(std::make_pair(
+                fingerprint.id,
+                fingerprint_stats_t{fingerprint.query, query_stats_t()})).first;
+        }
+    }
+    it->second.stats.add(stats);
+}
+
+scoped_query_stats_t::scoped_query_stats_t(
+        std::shared_ptr<const query_fingerprint_t> fingerprint)
+    : fingerprint_(std::move(fingerprint)),
+      start_nanos_(get_ticks().nanos),
+      usage_scope_(new scoped_resource_usage_t(&stats_.usage)),
+      trace_(nullptr) { }
+
+scoped_query_stats_t::~scoped_query_stats_t() {
+    // This charges the time since the coroutine was last resumed to `stats_`.
+    usage_scope_.reset();
+    const int64_t end_nanos = get_ticks().nanos;
+    stats_.total_nanos = end_nanos - start_nanos_;
+    stats_.usage.shards = nullptr;
+    if (trace_ != nullptr) {
+        if (slow_query_.has()) {
+            trace_->shards = slow_query_->shards;
+        }
+        trace_->add_execute_spans(start_nanos_, end_nanos);
+    }
+    if (slow_query_.has()) {
+        if (slow_query_log_t::is_slow(stats_.total_nanos)) {
+            slow_query_->fingerprint = fingerprint_;
+            slow_query_->stats = stats_;
+            slow_query_log_t::record(std::move(*slow_query_));
+        }
+    }
+    record_query_stats(*fingerprint_, stats_);
+}
+
+void scoped_query_stats_t::log_if_slow(int64_t queue_wait_nanos) {
+    if (!slow_query_log_t::is_enabled()) {
+        return;
+    }
+    slow_query_.init(new slow_query_t());
+    slow_query_->queue_wait_nanos = queue_wait_nanos;
+    stats_.usage.shards = &slow_query_->shards;
+}
+
+void scoped_query_stats_t::add_to_trace(query_trace_t *trace) {
+    trace_ = trace;
+    // The slow query log may already be collecting the shards, in which case we take
+    // them from it.
+    if (stats_.usage.shards == nullptr) {
+        stats_.usage.shards = &trace_->shards;
+    }
+}
+
+datum_t get_query_stats_report() {
+    std::vector<std::unordered_map<uint64_t, fingerprint_stats_t> >
+        per_thread(get_num_threads());
+    pmap(get_num_threads(), [&](int i) {
+        on_thread_t thread_switcher((threadnum_t(i)));
+        per_thread[i] = thread_query_stats[i].value.fingerprints;
+    });
+
+    std::map<uint64_t, fingerprint_stats_t> merged;
+    for (const auto &fingerprints : per_thread) {
+        for (const auto &pair : fingerprints) {
+            fingerprint_stats_t *fingerprint_stats = &merged[pair.first];
+            fingerprint_stats->query = pair.second.query;
+            fingerprint_stats->stats.add(pair.second.stats);
+        }
+    }
+
+    datum_object_builder_t builder;
+    for (const auto &pair : merged) {
+        builder.overwrite(datum_string_t(strprintf("%016" PRIx64, pair.first)),
+                          to_datum(pair.second));
+    }
+    return std::move(builder).to_datum();
+}
+
+}  // namespace ql
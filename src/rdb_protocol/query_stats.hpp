@@ -0,0 +1,94 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef RDB_PROTOCOL_QUERY_STATS_HPP_
+#define RDB_PROTOCOL_QUERY_STATS_HPP_
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+
+#include "arch/runtime/resource_usage.hpp"
+#include "containers/scoped.hpp"
+#include "rdb_protocol/datum.hpp"
+
+/* How many different fingerprints each thread keeps stats for.  Queries with other
+fingerprints are counted together under the fingerprint 0. */
+#define QUERY_STATS_MAX_FINGERPRINTS_PER_THREAD  1000
+
+/* How much of a query's normalized text we keep. */
+#define QUERY_STATS_MAX_QUERY_LENGTH             1024
+
+namespace ql {
+
+class raw_term_t;
+struct query_trace_t;
+struct slow_query_t;
+
+/* Queries that only differ in their constants have the same fingerprint, like in
+Postgres's `pg_stat_statements`.  `query` is the normalized text of the query, which
+keeps the names of databases, tables, fields and indexes, but replaces all other
+constants with `?`. */
+struct query_fingerprint_t {
+    uint64_t id;
+    std::string query;
+};
+
+query_fingerprint_t fingerprint_query(const raw_term_t &root_term);
+
+/* What serving one or more batches of queries with the same fingerprint cost. */
+struct query_stats_t {
+    query_stats_t() : calls(0), total_nanos(0), rows_returned(0), bytes_sent(0) { }
+
+    void add(const query_stats_t &other);
+
+    // How many times the query was started, not counting its CONTINUE requests.
+    uint64_t calls;
+    // The wall-clock time spent serving the query's batches.
+    int64_t total_nanos;
+    resource_usage_t usage;
+    uint64_t rows_returned;
+    uint64_t bytes_sent;
+};
+
+/* Adds `stats` to the current thread's stats for `fingerprint`. */
+void record_query_stats(const query_fingerprint_t &fingerprint,
+                        const query_stats_t &stats);
+
+/* Charges the current coroutine's work (and the reads and writes it does) to
+`fingerprint` until it's destroyed, and then records it with `record_query_stats`. */
+class scoped_query_stats_t {
+public:
+    explicit scoped_query_stats_t(
+        std::shared_ptr<const query_fingerprint_t> fingerprint);
+    ~scoped_query_stats_t();
+
+    query_stats_t *stats() { return &stats_; }
+
+    /* Records the query in the slow query log if it turns out to take longer than the
+    threshold.  This also makes the query's table reads and writes report what each
+    shard cost. */
+    void log_if_slow(int64_t queue_wait_nanos);
+
+    /* Adds the "execute" span of the batch, and the spans of its table reads and
+    writes, to `trace`.  Must be called after `log_if_slow()`. */
+    void add_to_trace(query_trace_t *trace);
+
+private:
+    std::shared_ptr<const query_fingerprint_t> fingerprint_;
+    query_stats_t stats_;
+    int64_t start_nanos_;
+    scoped_ptr_t<scoped_resource_usage_t> usage_scope_;
+    scoped_ptr_t<slow_query_t> slow_query_;
+    query_trace_t *trace_;
+
+    DISABLE_COPYING(scoped_query_stats_t);
+};
+
+/* Merges the stats of all threads into an object that maps each fingerprint's id to
+its stats.  Must be called in a coroutine.  The `rethinkdb._query_stats` table merges
+these objects from all servers. */
+datum_t get_query_stats_report();
+
+}  // namespace ql
+
+#endif  // RDB_PROTOCOL_QUERY_STATS_HPP_
@@ -0,0 +1,206 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "rdb_protocol/query_trace.hpp"
+
+#include <inttypes.h>
+
+#include <algorithm>
+#include <array>
+#include <deque>
+#include <utility>
+
+#include "arch/runtime/runtime.hpp"
+#include "concurrency/cache_line_padded.hpp"
+#include "concurrency/pmap.hpp"
+#include "rdb_protocol/pseudo_time.hpp"
+
+namespace ql {
+
+namespace {
+
+/* Only ever accessed on its own thread. */
+struct query_trace_thread_state_t {
+    std::deque<query_trace_t> traces;
+    // How many queries this thread has seen since it last sampled one.
+    uint64_t queries_since_sample;
+};
+
+std::array<cache_line_padded_t<query_trace_thread_state_t>, MAX_THREADS>
+    query_trace_thread_states;
+
+void add_shard_spans(query_trace_t *trace, int parent, const shard_usage_t &shard) {
+    const int64_t sent_nanos = shard.start_nanos;
+    const int64_t received_nanos = shard.start_nanos + shard.nanos;
+    trace->add_span(parent, "route", sent_nanos - shard.route_nanos, sent_nanos,
+                    shard.range);
+    const int shard_span = trace->add_span(
+        parent, "shard", sent_nanos, received_nanos, shard.range);
+
+    const int64_t primary_nanos = std::min(shard.usage.primary_nanos, shard.nanos);
+    const int64_t primary_start_nanos = sent_nanos + (shard.nanos - primary_nanos) / 2;
+    const int64_t primary_end_nanos = primary_start_nanos + primary_nanos;
+    trace->add_span(shard_span, "network", sent_nanos, primary_start_nanos,
+                    shard.range);
+    const int primary_span = trace->add_span(
+        shard_span, "primary", primary_start_nanos, primary_end_nanos, shard.range);
+    trace->add_span(shard_span, "network", primary_end_nanos, received_nanos,
+                    shard.range);
+
+    // The waits are spread over the primary's work, but we only know their totals, so
+    // they are drawn from its start.
+    if (shard.usage.lock_wait_nanos > 0) {
+        trace->add_span(primary_span, "cache_wait", primary_start_nanos,
+            primary_start_nanos + std::min(shard.usage.lock_wait_nanos, primary_nanos),
+            shard.range);
+    }
+    if (shard.usage.load_wait_nanos > 0) {
+        trace->add_span(primary_span, "disk", primary_start_nanos,
+            primary_start_nanos + std::min(shard.usage.load_wait_nanos, primary_nanos),
+            shard.range);
+    }
+}
+
+datum_t string_datum(const std::string &str) {
+    return datum_t(datum_string_t(str));
+}
+
+std::string span_id(int index) {
+    // Span ids only have to be unique within their trace, and mustn't be zero.
+    return strprintf("%016" PRIx64, static_cast<uint64_t>(index) + 1);
+}
+
+/* The spans are in the OTLP/JSON format of OpenTelemetry, so that a collector can take
+them without any conversion. */
+datum_t to_datum(const query_trace_t &trace) {
+    std::string trace_id;
+    for (size_t i = 0; i < uuid_u::static_size(); ++i) {
+        trace_id += strprintf("%02x", trace.id.data()[i]);
+    }
+    // The spans' times are from `get_ticks()`.  The root span ended when the trace
+    // was recorded at `trace.time`.
+    const int64_t unix_offset_nanos =
+        static_cast<int64_t>(trace.time) * THOUSAND - trace.spans[0].end_nanos;
+
+    datum_array_builder_t spans(configured_limits_t::unlimited);
+    for (size_t i = 0; i < trace.spans.size(); ++i) {
+        const query_trace_span_t &span = trace.spans[i];
+        datum_object_builder_t builder;
+        builder.overwrite("traceId", string_datum(trace_id));
+        builder.overwrite("spanId", string_datum(span_id(i)));
+        if (span.parent >= 0) {
+            builder.overwrite("parentSpanId", string_datum(span_id(span.parent)));
+        }
+        builder.overwrite("name", string_datum(span.name));
+        builder.overwrite("startTimeUnixNano", string_datum(
+            strprintf("%" PRIi64, span.start_nanos + unix_offset_nanos)));
+        builder.overwrite("endTimeUnixNano", string_datum(
+            strprintf("%" PRIi64, span.end_nanos + unix_offset_nanos)));
+        datum_array_builder_t attributes(configured_limits_t::unlimited);
+        if (!span.shard.empty()) {
+            datum_object_builder_t value;
+            value.overwrite("stringValue", string_datum(span.shard));
+            datum_object_builder_t attribute;
+            attribute.overwrite("key", string_datum("rethinkdb.shard"));
+            attribute.overwrite("value", std::move(value).to_datum());
+            attributes.add(std::move(attribute).to_datum());
+        }
+        builder.overwrite("attributes", std::move(attributes).to_datum());
+        spans.add(std::move(builder).to_datum());
+    }
+
+    datum_object_builder_t builder;
+    builder.overwrite("id", string_datum(uuid_to_str(trace.id)));
+    builder.overwrite("time", pseudo::make_time(
+        static_cast<double>(trace.time) / MILLION, "+00:00"));
+    if (trace.fingerprint) {
+        builder.overwrite("fingerprint", string_datum(
+            strprintf("%016" PRIx64, trace.fingerprint->id)));
+        builder.overwrite("query", string_datum(trace.fingerprint->query));
+    } else {
+        builder.overwrite("fingerprint", datum_t::null());
+        builder.overwrite("query", datum_t::null());
+    }
+    builder.overwrite("total_secs", datum_t(
+        static_cast<double>(trace.spans[0].end_nanos - trace.spans[0].start_nanos)
+        / BILLION));
+    builder.overwrite("spans", std::move(spans).to_datum());
+    return std::move(builder).to_datum();
+}
+
+}  // namespace
+
+query_trace_t::query_trace_t(ticks_t received_time)
+    : id(generate_uuid()), time(0) {
+    add_span(-1, "query", received_time.nanos, received_time.nanos);
+}
+
+int query_trace_t::add_span(int parent, const char *name, int64_t start_nanos,
+                            int64_t end_nanos, const std::string &shard) {
+    spans.push_back(query_trace_span_t{parent, name, start_nanos, end_nanos, shard});
+    return spans.size() - 1;
+}
+
+void query_trace_t::add_execute_spans(int64_t start_nanos, int64_t end_nanos) {
+    const int execute_span = add_span(0, "execute", start_nanos, end_nanos);
+    for (const shard_usage_t &shard : shards) {
+        add_shard_spans(this, execute_span, shard);
+    }
+    shards.clear();
+}
+
+std::atomic<uint64_t> query_trace_log_t::sample_rate(0);
+
+void query_trace_log_t::set_sample_rate(uint64_t _sample_rate) {
+    sample_rate.store(_sample_rate);
+}
+
+scoped_ptr_t<query_trace_t> query_trace_log_t::maybe_start(ticks_t received_time) {
+    const uint64_t rate = sample_rate.load(std::memory_order_relaxed);
+    if (rate == 0) {
+        return scoped_ptr_t<query_trace_t>();
+    }
+    query_trace_thread_state_t *state =
+        &query_trace_thread_states[get_thread_id().threadnum].value;
+    if (++state->queries_since_sample < rate) {
+        return scoped_ptr_t<query_trace_t>();
+    }
+    state->queries_since_sample = 0;
+    return make_scoped<query_trace_t>(received_time);
+}
+
+void query_trace_log_t::record(query_trace_t &&trace) {
+    query_trace_thread_state_t *state =
+        &query_trace_thread_states[get_thread_id().threadnum].value;
+    trace.spans[0].end_nanos = get_ticks().nanos;
+    trace.time = current_microtime();
+    state->traces.push_back(std::move(trace));
+    if (state->traces.size() > QUERY_TRACE_ENTRIES_PER_THREAD) {
+        state->traces.pop_front();
+    }
+}
+
+datum_t query_trace_log_t::get_report() {
+    std::vector<std::deque<query_trace_t> > per_thread(get_num_threads());
+    pmap(get_num_threads(), [&](int i) {
+        on_thread_t thread_switcher((threadnum_t(i)));
+        per_thread[i] = query_trace_thread_states[i].value.traces;
+    });
+
+    std::vector<const query_trace_t *> traces;
+    for (const auto &thread_traces : per_thread) {
+        for (const query_trace_t &trace : thread_traces) {
+            traces.push_back(&trace);
+        }
+    }
+    std::sort(traces.begin(), traces.end(),
+        [](const query_trace_t *a, const query_trace_t *b) {
+            return a->time < b->time;
+        });
+
+    datum_array_builder_t builder(configured_limits_t::unlimited);
+    for (const query_trace_t *trace : traces) {
+        builder.add(to_datum(*trace));
+    }
+    return std::move(builder).to_datum();
+}
+
+}  // namespace ql
@@ -0,0 +1,103 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef RDB_PROTOCOL_QUERY_TRACE_HPP_
+#define RDB_PROTOCOL_QUERY_TRACE_HPP_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "arch/runtime/resource_usage.hpp"
+#include "containers/scoped.hpp"
+#include "containers/uuid.hpp"
+#include "rdb_protocol/datum.hpp"
+#include "rdb_protocol/query_stats.hpp"
+#include "time.hpp"
+
+/* How many traces each thread remembers.  Older ones are forgotten. */
+#define QUERY_TRACE_ENTRIES_PER_THREAD          100
+
+namespace ql {
+
+/* One timed step of a traced query batch.  Spans nest like OpenTelemetry spans: the
+root span covers the whole batch, from reading the query to writing the response, and
+every other span has a parent. */
+struct query_trace_span_t {
+    // The index of the parent span in `query_trace_t::spans`, or -1 for the root.
+    int parent;
+    std::string name;
+    // From `get_ticks()`.
+    int64_t start_nanos;
+    int64_t end_nanos;
+    // The key range of the shard, for the spans of a table read or write.
+    std::string shard;
+};
+
+/* Where the time of one query batch went.  The spans are:
+ - "queue": waiting for the query's cache entry and a slot to run in;
+ - "parse": preprocessing and compiling the query;
+ - "execute": running it, with the spans of each table read or write under it;
+ - "route": choosing a shard's primary replica and getting an order token;
+ - "shard": sending a read or write to a shard and getting the response, made of
+   "network", "primary" and "network" again;
+ - "cache_wait" and "disk": how long the primary waited for block locks and for blocks
+   to be loaded, under "primary";
+ - "response_write": serializing the response and writing it to the client. */
+struct query_trace_t {
+    explicit query_trace_t(ticks_t received_time);
+
+    // Adds a span and returns its index, for use as the parent of other spans.
+    int add_span(int parent, const char *name, int64_t start_nanos, int64_t end_nanos,
+                 const std::string &shard = std::string());
+
+    // Adds the "execute" span of a batch that ran from `start_nanos` to `end_nanos`,
+    // with the spans of the table reads and writes in `shards` under it.
+    void add_execute_spans(int64_t start_nanos, int64_t end_nanos);
+
+    // Also the OpenTelemetry trace id.
+    uuid_u id;
+    // When the trace was recorded.
+    microtime_t time;
+    std::shared_ptr<const query_fingerprint_t> fingerprint;
+    std::vector<query_trace_span_t> spans;
+    // Filled in by the table reads and writes while the batch runs.
+    std::vector<shard_usage_t> shards;
+};
+
+/* Query tracing records the spans of one in every N query batches, where N is set
+with `--trace-sample-rate`.  It's off by default, and while it's off it costs a
+relaxed atomic load per query.  The traces are kept in memory for the
+`rethinkdb._query_traces` table, whose rows are shaped so that they can be sent to an
+OpenTelemetry collector as they are.
+
+Clocks can't be compared across servers, so a table read or write is split into
+"network" and "primary" by the time the primary reports it took, and the network time
+is assumed to be the same in both directions. */
+class query_trace_log_t {
+public:
+    // A sample rate of 0 turns tracing off.
+    static void set_sample_rate(uint64_t sample_rate);
+    static bool is_enabled() {
+        return sample_rate.load(std::memory_order_relaxed) != 0;
+    }
+
+    /* Returns a new trace if the query that was read at `received_time` is one of the
+    sampled ones, and an empty pointer otherwise. */
+    static scoped_ptr_t<query_trace_t> maybe_start(ticks_t received_time);
+
+    /* Ends the root span of `trace` and keeps it. */
+    static void record(query_trace_t &&trace);
+
+    /* Returns the traces that all threads remember, as an array of objects.  Must be
+    called in a coroutine. */
+    static datum_t get_report();
+
+private:
+    static std::atomic<uint64_t> sample_rate;
+};
+
+}  // namespace ql
+
+#endif  // RDB_PROTOCOL_QUERY_TRACE_HPP_
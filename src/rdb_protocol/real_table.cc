@@ -1,6 +1,7 @@
 // Copyright 2010-2014 RethinkDB, all rights reserved
 #include "rdb_protocol/real_table.hpp"
 
+#include "arch/runtime/resource_usage.hpp"
 #include "clustering/administration/auth/permission_error.hpp"
 #include "clustering/administration/tables/table_metadata.hpp"
 #include "clustering/table_manager/table_meta_client.hpp"
@@ -15,8 +16,25 @@
 #include "rdb_protocol/func.hpp"
 #include "rdb_protocol/math_utils.hpp"
 #include "rdb_protocol/protocol.hpp"
+#include "rdb_protocol/query_result_cache.hpp"
 
 
+real_table_t::real_table_t(
+        namespace_id_t _uuid,
+        namespace_interface_access_t _namespace_access,
+        const std::string &_pkey,
+        ql::changefeed::client_t *_changefeed_client,
+        table_meta_client_t *table_meta_client) :
+    uuid(_uuid),
+    namespace_access(_namespace_access),
+    pkey(_pkey),
+    changefeed_client(_changefeed_client),
+    m_table_meta_client(table_meta_client),
+    write_hook_fetched(false) { }
+
+// Out of line because `ql::func_t` is incomplete in the header.
+real_table_t::~real_table_t() { }
+
 namespace_id_t real_table_t::get_id() const {
     return uuid;
 }
@@ -150,6 +168,7 @@ ql::datum_t real_table_t::read_nearest(
         env->get_serializable_env());
     read_t read(geo_read, env->profile(), read_mode);
     read_response_t res;
+    track_read(env);
     try {
         namespace_access.get()->read(
             env->get_user_context(), read, &res, order_token_t::ignore, env->interruptor);
@@ -188,6 +207,29 @@ ql::datum_t real_table_t::read_nearest(
     return std::move(formatted_result).to_datum();
 }
 
+bool real_table_t::read_sample(
+        ql::env_t *env,
+        uint64_t num,
+        read_mode_t read_mode,
+        std::vector<ql::datum_t> *rows_out) {
+    read_t read(sample_read_t(num), env->profile(), read_mode);
+    read_response_t res;
+    track_read(env);
+    try {
+        namespace_access.get()->read(
+            env->get_user_context(), read, &res, order_token_t::ignore, env->interruptor);
+    } catch (const cannot_perform_query_exc_t &ex) {
+        rfail_datum(ql::base_exc_t::OP_FAILED, "Cannot perform read: %s", ex.what());
+    } catch (auth::permission_error_t const &error) {
+        rfail_datum(ql::base_exc_t::PERMISSION_ERROR, "%s", error.what());
+    }
+
+    sample_read_response_t *s_res = boost::get<sample_read_response_t>(&res.response);
+    r_sanity_check(s_res);
+    *rows_out = std::move(s_res->rows);
+    return true;
+}
+
 const size_t split_size = 128;
 template<class T>
 std::vector<std::vector<T> > split(std::vector<T> &&v) {
@@ -222,14 +264,16 @@ std::vector<std::vector<T> > split(std::vector<T> &&v) {
 optional<counted_t<const ql::func_t> > real_table_t::get_write_hook(
     ql::env_t *env,
     ignore_write_hook_t ignore_write_hook) {
-    optional<counted_t<const ql::func_t> > write_hook;
-    table_config_and_shards_t config;
-
-    m_table_meta_client->get_config(uuid, env->interruptor, &config);
-
-    if (config.config.write_hook &&
-        ignore_write_hook == ignore_write_hook_t::NO) {
-        write_hook.set(config.config.write_hook->func.compile_wire_func());
+    if (ignore_write_hook == ignore_write_hook_t::YES) {
+        return optional<counted_t<const ql::func_t> >();
+    }
+    if (!write_hook_fetched) {
+        table_config_and_shards_t config;
+        m_table_meta_client->get_config(uuid, env->interruptor, &config);
+        if (config.config.write_hook) {
+            write_hook.set(config.config.write_hook->func.compile_wire_func());
+        }
+        write_hook_fetched = true;
     }
     return write_hook;
 }
@@ -352,6 +396,7 @@ void real_table_t::read_with_profile(ql::env_t *env, const read_t &read,
     profile::splitter_t splitter(env->trace);
     /* propagate whether or not we're doing profiles */
     r_sanity_check(read.profile == env->profile());
+    track_read(env);
 
     /* Do the actual read. */
     try {
@@ -369,6 +414,26 @@ void real_table_t::read_with_profile(ql::env_t *env, const read_t &read,
 
     /* Append the results of the profile to the current task */
     splitter.give_splits(response->n_shards, response->event_log);
+
+    if (resource_usage_t *usage = current_resource_usage()) {
+        usage->add(response->resource_usage);
+    }
+}
+
+void real_table_t::track_read(ql::env_t *env) {
+    if (env->tracked_reads == nullptr
+        || env->tracked_reads->tables.count(uuid) != 0) {
+        return;
+    }
+    table_basic_config_t table_basic_config;
+    try {
+        m_table_meta_client->get_name(uuid, &table_basic_config);
+    } catch (const no_such_table_exc_t &) {
+        env->tracked_reads->untracked = true;
+        return;
+    }
+    env->tracked_reads->tables[uuid] = ql::tracked_reads_t::table_t{
+        table_basic_config.database, table_basic_config.name.str()};
 }
 
 void real_table_t::write_with_profile(ql::env_t *env, write_t *write,
@@ -405,5 +470,9 @@ void real_table_t::write_with_profile(ql::env_t *env, write_t *write,
 
     /* Append the results of the profile to the current task */
     splitter.give_splits(response->n_shards, response->event_log);
+
+    if (resource_usage_t *usage = current_resource_usage()) {
+        usage->add(response->resource_usage);
+    }
 }
 
@@ -35,12 +35,8 @@ public:
             namespace_interface_access_t _namespace_access,
             const std::string &_pkey,
             ql::changefeed::client_t *_changefeed_client,
-            table_meta_client_t *table_meta_client) :
-        uuid(_uuid),
-        namespace_access(_namespace_access),
-        pkey(_pkey),
-        changefeed_client(_changefeed_client),
-        m_table_meta_client(table_meta_client) { }
+            table_meta_client_t *table_meta_client);
+    ~real_table_t();
 
     namespace_id_t get_id() const;
     const std::string &get_pkey() const;
@@ -76,6 +72,11 @@ public:
         const ellipsoid_spec_t &geo_system,
         dist_unit_t dist_unit,
         const ql::configured_limits_t &limits);
+    bool read_sample(
+        ql::env_t *env,
+        uint64_t num,
+        read_mode_t read_mode,
+        std::vector<ql::datum_t> *rows_out);
 
     ql::datum_t write_batched_replace(
         ql::env_t *env,
@@ -119,6 +120,9 @@ public:
     void write_with_profile(ql::env_t *env, write_t *, write_response_t *response);
 
 private:
+    // Records that the query reads this table, if its result may be cached.
+    void track_read(ql::env_t *env);
+
     optional<counted_t<const ql::func_t> > get_write_hook(
         ql::env_t *env,
         ignore_write_hook_t ignore_write_hook);
@@ -128,6 +132,12 @@ private:
     std::string pkey;
     ql::changefeed::client_t *changefeed_client;
     table_meta_client_t *m_table_meta_client;
+
+    /* The table's write hook, looked up the first time a write needs it.  Fetching
+    the table config is a round trip to another server, so a query that writes in
+    many batches only does it once. */
+    bool write_hook_fetched;
+    optional<counted_t<const ql::func_t> > write_hook;
 };
 
 #endif /* RDB_PROTOCOL_REAL_TABLE_HPP_ */
@@ -13,6 +13,7 @@
 #include "containers/archive/versioned.hpp"
 #include "containers/counted.hpp"
 #include "containers/shared_buffer.hpp"
+#include "math.hpp"
 #include "rdb_protocol/datum.hpp"
 #include "rdb_protocol/env.hpp"
 #include "rdb_protocol/error.hpp"
@@ -304,7 +305,7 @@ serialization_result_t datum_array_serialize(
         && check_errors == check_datum_serialization_errors_t::NO) {
 
         // Subtract 1 for the type byte, which we don't have to rewrite
-        wm->append(existing_buf_ref->get(), precomputed_sizes.size - 1);
+        wm->append(*existing_buf_ref, precomputed_sizes.size - 1);
         return serialization_result_t::SUCCESS;
     }
 
@@ -412,7 +413,7 @@ serialization_result_t datum_object_serialize(
         && check_errors == check_datum_serialization_errors_t::NO) {
 
         // Subtract 1 for the type byte, which we don't have to rewrite
-        wm->append(existing_buf_ref->get(), precomputed_sizes.size - 1);
+        wm->append(*existing_buf_ref, precomputed_sizes.size - 1);
         return serialization_result_t::SUCCESS;
     }
 
@@ -438,6 +439,12 @@ serialization_result_t datum_object_serialize(
     return res;
 }
 
+// Interns the string if `is_key` is true.
+MUST_USE archive_result_t datum_deserialize_string(
+        read_stream_t *s,
+        bool is_key,
+        datum_string_t *out);
+
 // For legacy R_OBJECT datums. BUF_R_OBJECT datums are not deserialized through this.
 MUST_USE archive_result_t datum_deserialize_object(
         read_stream_t *s,
@@ -456,7 +463,7 @@ MUST_USE archive_result_t datum_deserialize_object(
 
     for (uint64_t i = 0; i < sz; ++i) {
         std::pair<datum_string_t, datum_t> p;
-        res = datum_deserialize(s, &p.first);
+        res = datum_deserialize_string(s, true, &p.first);
         if (bad(res)) { return res; }
         res = datum_deserialize(s, &p.second);
         if (bad(res)) { return res; }
@@ -871,38 +878,36 @@ std::pair<datum_string_t, datum_t> datum_deserialize_pair_from_buf(
      varint num_elements
      ... */
 size_t datum_get_array_size(const shared_buf_ref_t<char> &array) {
-    buffer_read_stream_t sz_read_stream(array.get(), array.get_safety_boundary());
-    uint64_t ser_size;
-    guarantee_deserialization(deserialize_varint_uint64(&sz_read_stream, &ser_size),
-                              "datum decode array");
-    uint64_t num_elements = 0;
-    guarantee_deserialization(deserialize_varint_uint64(&sz_read_stream, &num_elements),
-                              "datum decode array");
-    guarantee(num_elements <= std::numeric_limits<size_t>::max());
-    return static_cast<size_t>(num_elements);
+    return datum_buf_elements_t(&array, 0).size();
 }
 
-/* The format of `array` is:
+size_t datum_get_element_offset(const shared_buf_ref_t<char> &array, size_t index) {
+    return datum_buf_elements_t(&array, 0).offset(index);
+}
+
+/* The format of an array is:
      varint ser_size
      varint num_elements
      uint*_t offsets[num_elements - 1] // counted from `data`, first element omitted
      T data[num_elements] */
-size_t datum_get_element_offset(const shared_buf_ref_t<char> &array, size_t index) {
-    buffer_read_stream_t sz_read_stream(array.get(), array.get_safety_boundary());
+datum_buf_elements_t::datum_buf_elements_t(const shared_buf_ref_t<char> *buf,
+                                           size_t at_offset)
+    : buf_(buf) {
+    buf_->guarantee_in_boundary(at_offset);
+    buffer_read_stream_t sz_read_stream(buf_->get() + at_offset,
+                                        buf_->get_safety_boundary() - at_offset);
     uint64_t ser_size = 0;
     guarantee_deserialization(deserialize_varint_uint64(&sz_read_stream, &ser_size),
                               "datum decode array");
-    const datum_offset_size_t offset_size = get_offset_size_from_inner_size(ser_size);
-    size_t serialized_offset_size;
-    switch (offset_size) {
+    switch (get_offset_size_from_inner_size(ser_size)) {
     case datum_offset_size_t::U8BIT:
-        serialized_offset_size = serialize_universal_size_t<uint8_t>::value; break;
+        serialized_offset_size_ = serialize_universal_size_t<uint8_t>::value; break;
     case datum_offset_size_t::U16BIT:
-        serialized_offset_size = serialize_universal_size_t<uint16_t>::value; break;
+        serialized_offset_size_ = serialize_universal_size_t<uint16_t>::value; break;
     case datum_offset_size_t::U32BIT:
-        serialized_offset_size = serialize_universal_size_t<uint32_t>::value; break;
+        serialized_offset_size_ = serialize_universal_size_t<uint32_t>::value; break;
     case datum_offset_size_t::U64BIT:
-        serialized_offset_size = serialize_universal_size_t<uint64_t>::value; break;
+        serialized_offset_size_ = serialize_universal_size_t<uint64_t>::value; break;
     default:
         unreachable();
     }
@@ -911,59 +916,139 @@ size_t datum_get_element_offset(const shared_buf_ref_t<char> &array, size_t inde
     guarantee_deserialization(deserialize_varint_uint64(&sz_read_stream, &num_elements),
                               "datum decode array");
     guarantee(num_elements <= std::numeric_limits<size_t>::max());
-    const size_t sz = static_cast<size_t>(num_elements);
-
-    guarantee(index < sz);
+    num_elements_ = static_cast<size_t>(num_elements);
 
-    rassert(sz > 0);
-    const size_t data_offset =
-        static_cast<size_t>(sz_read_stream.tell())
-        + (num_elements - 1) * serialized_offset_size;
+    offsets_offset_ = at_offset + static_cast<size_t>(sz_read_stream.tell());
+    data_offset_ = num_elements_ == 0
+        ? offsets_offset_
+        : offsets_offset_ + (num_elements_ - 1) * serialized_offset_size_;
+}
 
+size_t datum_buf_elements_t::offset(size_t index) const {
+    guarantee(index < num_elements_);
     if (index == 0) {
-        return data_offset;
-    } else {
-        const size_t element_offset_offset =
-            static_cast<size_t>(sz_read_stream.tell())
-            + (index - 1) * serialized_offset_size;
+        return data_offset_;
+    }
+
+    const size_t element_offset_offset =
+        offsets_offset_ + (index - 1) * serialized_offset_size_;
+    buf_->guarantee_in_boundary(element_offset_offset);
+    buffer_read_stream_t read_stream(
+        buf_->get() + element_offset_offset,
+        buf_->get_safety_boundary() - element_offset_offset);
+
+    uint64_t element_offset;
+    switch (serialized_offset_size_) {
+    case serialize_universal_size_t<uint8_t>::value: {
+        uint8_t off;
+        guarantee_deserialization(deserialize_universal(&read_stream, &off),
+                                  "datum decode array offset");
+        element_offset = off;
+    } break;
+    case serialize_universal_size_t<uint16_t>::value: {
+        uint16_t off;
+        guarantee_deserialization(deserialize_universal(&read_stream, &off),
+                                  "datum decode array offset");
+        element_offset = off;
+    } break;
+    case serialize_universal_size_t<uint32_t>::value: {
+        uint32_t off;
+        guarantee_deserialization(deserialize_universal(&read_stream, &off),
+                                  "datum decode array offset");
+        element_offset = off;
+    } break;
+    case serialize_universal_size_t<uint64_t>::value: {
+        uint64_t off;
+        guarantee_deserialization(deserialize_universal(&read_stream, &off),
+                                  "datum decode array offset");
+        element_offset = off;
+    } break;
+    default:
+        unreachable();
+    }
+    guarantee(element_offset <= std::numeric_limits<size_t>::max(),
+              "Datum too large for this architecture.");
 
-        array.guarantee_in_boundary(element_offset_offset);
-        buffer_read_stream_t read_stream(
-            array.get() + element_offset_offset,
-            array.get_safety_boundary() - element_offset_offset);
+    return data_offset_ + static_cast<size_t>(element_offset);
+}
 
-        uint64_t element_offset;
-        switch (offset_size) {
-        case datum_offset_size_t::U8BIT: {
-            uint8_t off;
-            guarantee_deserialization(deserialize_universal(&read_stream, &off),
-                                      "datum decode array offset");
-            element_offset = off;
-        } break;
-        case datum_offset_size_t::U16BIT: {
-            uint16_t off;
-            guarantee_deserialization(deserialize_universal(&read_stream, &off),
-                                      "datum decode array offset");
-            element_offset = off;
-        } break;
-        case datum_offset_size_t::U32BIT: {
-            uint32_t off;
-            guarantee_deserialization(deserialize_universal(&read_stream, &off),
-                                      "datum decode array offset");
-            element_offset = off;
-        } break;
-        case datum_offset_size_t::U64BIT: {
-            uint64_t off;
-            guarantee_deserialization(deserialize_universal(&read_stream, &off),
-                                      "datum decode array offset");
-            element_offset = off;
-        } break;
-        }
-        guarantee(element_offset <= std::numeric_limits<size_t>::max(),
-                  "Datum too large for this architecture.");
-
-        return data_offset + static_cast<size_t>(element_offset);
+// Keep in sync with `datum_deserialize`.
+datum_buf_peek_t datum_peek_from_buf(const shared_buf_ref_t<char> &buf,
+                                     size_t at_offset) {
+    buf.guarantee_in_boundary(at_offset);
+    buffer_read_stream_t read_stream(buf.get() + at_offset,
+                                     buf.get_safety_boundary() - at_offset);
+    datum_serialized_type_t type = datum_serialized_type_t::R_NULL;
+    guarantee_deserialization(datum_deserialize(&read_stream, &type),
+                              "datum type from buf");
+
+    datum_buf_peek_t res;
+    res.kind = datum_buf_peek_t::kind_t::OTHER;
+    switch (type) {
+    case datum_serialized_type_t::R_NULL: {
+        res.kind = datum_buf_peek_t::kind_t::R_NULL;
+    } break;
+    case datum_serialized_type_t::R_BOOL: {
+        guarantee_deserialization(deserialize_universal(&read_stream, &res.boolean),
+                                  "datum bool from buf");
+        res.kind = datum_buf_peek_t::kind_t::R_BOOL;
+    } break;
+    case datum_serialized_type_t::DOUBLE: {
+        guarantee_deserialization(deserialize_universal(&read_stream, &res.num),
+                                  "datum double from buf");
+        // Leave numbers that `datum_t` would reject to `datum_deserialize_from_buf`.
+        if (risfinite(res.num)) {
+            res.kind = datum_buf_peek_t::kind_t::R_NUM;
+        }
+    } break;
+    case datum_serialized_type_t::INT_NEGATIVE:  // fall through
+    case datum_serialized_type_t::INT_POSITIVE: {
+        uint64_t unsigned_value;
+        guarantee_deserialization(deserialize_varint_uint64(&read_stream,
+                                                            &unsigned_value),
+                                  "datum int from buf");
+        if (unsigned_value <= max_dbl_int) {
+            const double d = unsigned_value;
+            // This might give the signed-zero double, -0.0.
+            res.num = type == datum_serialized_type_t::INT_NEGATIVE ? -d : d;
+            res.kind = datum_buf_peek_t::kind_t::R_NUM;
+        }
+    } break;
+    case datum_serialized_type_t::R_STR: {
+        const size_t str_offset = at_offset + static_cast<size_t>(read_stream.tell());
+        datum_peek_pair_key_from_buf(buf, str_offset, &res.str, &res.str_size);
+        res.kind = datum_buf_peek_t::kind_t::R_STR;
+    } break;
+    case datum_serialized_type_t::BUF_R_ARRAY: {
+        res.child_offset = at_offset + static_cast<size_t>(read_stream.tell());
+        res.kind = datum_buf_peek_t::kind_t::BUF_R_ARRAY;
+    } break;
+    case datum_serialized_type_t::BUF_R_OBJECT: {
+        res.child_offset = at_offset + static_cast<size_t>(read_stream.tell());
+        res.kind = datum_buf_peek_t::kind_t::BUF_R_OBJECT;
+    } break;
+    default:
+        break;
     }
+    return res;
+}
+
+// Keep in sync with `datum_serialize(write_message_t *, const datum_string_t &)`.
+size_t datum_peek_pair_key_from_buf(const shared_buf_ref_t<char> &buf,
+                                    size_t at_offset,
+                                    const char **key_out,
+                                    size_t *key_size_out) {
+    buf.guarantee_in_boundary(at_offset);
+    buffer_read_stream_t read_stream(buf.get() + at_offset,
+                                     buf.get_safety_boundary() - at_offset);
+    uint64_t size;
+    guarantee_deserialization(deserialize_varint_uint64(&read_stream, &size),
+                              "datum string size from buf");
+    const size_t data_offset = at_offset + static_cast<size_t>(read_stream.tell());
+    guarantee(size <= buf.get_safety_boundary() - data_offset);
+    *key_out = buf.get() + data_offset;
+    *key_size_out = static_cast<size_t>(size);
+    return data_offset + static_cast<size_t>(size);
 }
 
 size_t datum_serialized_size(const datum_string_t &s) {
@@ -978,8 +1063,9 @@ serialization_result_t datum_serialize(write_message_t *wm, const datum_string_t
     return serialization_result_t::SUCCESS;
 }
 
-MUST_USE archive_result_t datum_deserialize(
+MUST_USE archive_result_t datum_deserialize_string(
         read_stream_t *s,
+        bool is_key,
         datum_string_t *out) {
     uint64_t sz;
     archive_result_t res = deserialize_varint_uint64(s, &sz);
@@ -989,6 +1075,23 @@ MUST_USE archive_result_t datum_deserialize(
         return archive_result_t::RANGE_ERROR;
     }
 
+    // Short strings don't need a buffer of their own, and keys might not need one at
+    // all if they're interned.
+    if (sz <= datum_string_t::MAX_INTERNED_SIZE) {
+        char chars[datum_string_t::MAX_INTERNED_SIZE];
+        int64_t num_read = force_read(s, chars, sz);
+        if (num_read == -1) {
+            return archive_result_t::SOCK_ERROR;
+        }
+        if (static_cast<uint64_t>(num_read) < sz) {
+            return archive_result_t::SOCK_EOF;
+        }
+        *out = is_key
+            ? datum_string_t::intern(static_cast<size_t>(sz), chars)
+            : datum_string_t(static_cast<size_t>(sz), chars);
+        return archive_result_t::SUCCESS;
+    }
+
     const size_t str_offset = varint_uint64_serialized_size(sz);
     counted_t<shared_buf_t> buf =
         shared_buf_t::create(str_offset + static_cast<size_t>(sz));
@@ -1006,4 +1109,10 @@ MUST_USE archive_result_t datum_deserialize(
     return archive_result_t::SUCCESS;
 }
 
+MUST_USE archive_result_t datum_deserialize(
+        read_stream_t *s,
+        datum_string_t *out) {
+    return datum_deserialize_string(s, false, out);
+}
+
 }  // namespace ql
@@ -58,6 +58,47 @@ size_t datum_get_element_offset(const shared_buf_ref_t<char> &array, size_t inde
 // Reads the number of elements in the array stored in the buffer
 size_t datum_get_array_size(const shared_buf_ref_t<char> &array);
 
+// Decodes the header of the array or object stored in `*buf` at `at_offset` once, so
+// that the elements can be walked without decoding it again for each of them, as
+// `datum_get_element_offset` does.  Offsets are relative to the start of `*buf`.
+class datum_buf_elements_t {
+public:
+    datum_buf_elements_t(const shared_buf_ref_t<char> *buf, size_t at_offset);
+
+    size_t size() const { return num_elements_; }
+    size_t offset(size_t index) const;
+
+private:
+    const shared_buf_ref_t<char> *buf_;
+    size_t num_elements_;
+    size_t offsets_offset_;
+    size_t data_offset_;
+    size_t serialized_offset_size_;
+};
+
+// What `datum_peek_from_buf` found in a buffer.  Strings, numbers, booleans and nulls
+// are decoded in place, without creating a `datum_t`.  For arrays and objects in the
+// buffer format, `child_offset` is where their header starts.  Anything else (binary
+// data, arrays and objects in the old format, ...) is `OTHER` and has to be
+// deserialized with `datum_deserialize_from_buf`.
+struct datum_buf_peek_t {
+    enum class kind_t { R_NULL, R_BOOL, R_NUM, R_STR, BUF_R_ARRAY, BUF_R_OBJECT, OTHER };
+    kind_t kind;
+    bool boolean;
+    double num;
+    const char *str;
+    size_t str_size;
+    size_t child_offset;
+};
+datum_buf_peek_t datum_peek_from_buf(const shared_buf_ref_t<char> &buf,
+                                     size_t at_offset);
+// Finds the key of the object pair at `at_offset` (as found by `datum_buf_elements_t`)
+// and returns the offset of its value.
+size_t datum_peek_pair_key_from_buf(const shared_buf_ref_t<char> &buf,
+                                    size_t at_offset,
+                                    const char **key_out,
+                                    size_t *key_size_out);
+
 size_t datum_serialized_size(const datum_string_t &s);
 serialization_result_t datum_serialize(write_message_t *wm, const datum_string_t &s);
 
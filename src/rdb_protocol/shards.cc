@@ -1,6 +1,7 @@
 // Copyright 2010-2014 RethinkDB, all rights reserved.
 #include "rdb_protocol/shards.hpp"
 
+#include <algorithm>
 #include <utility>
 
 #include "errors.hpp"
@@ -8,6 +9,7 @@
 
 #include "debug.hpp"
 #include "rdb_protocol/func.hpp"
+#include "rdb_protocol/order_util.hpp"
 #include "rdb_protocol/profile.hpp"
 #include "rdb_protocol/protocol.hpp"
 
@@ -16,6 +18,13 @@ bool reversed(sorting_t sorting) { return sorting == sorting_t::DESCENDING; }
 namespace ql {
 
 
+void sindex_sort_items(std::vector<rget_item_t> *items, sorting_t sorting) {
+    sindex_compare_t compare(sorting);
+    if (!std::is_sorted(items->begin(), items->end(), compare)) {
+        std::stable_sort(items->begin(), items->end(), compare);
+    }
+}
+
 void debug_print(printf_buffer_t *buf, const rget_item_t &item) {
     buf->appendf("rget_item{key=");
     debug_print(buf, item.key);
@@ -89,15 +98,27 @@ private:
             auto pair = acc.insert(std::make_pair(it->first, default_val));
             auto t_it = pair.first;
             bool keep = !pair.second;
-            for (auto el = it->second.begin(); el != it->second.end(); ++el) {
-                keep |= accumulate(env, *el, &t_it->second, key, lazy_sindex_val);
-            }
+            keep |= accumulate_batch(env, it->second, &t_it->second, key,
+                                     lazy_sindex_val);
             if (!keep) {
                 acc.erase(t_it);
             }
         }
         return should_send_batch() ? continue_bool_t::ABORT : continue_bool_t::CONTINUE;
     }
+    // Accumulates all of a group's elements, and returns whether any of them were
+    // accumulated.  Terminals override this to go through whole batches at once.
+    virtual bool accumulate_batch(env_t *env,
+                                  const datums_t &els,
+                                  T *t,
+                                  const store_key_t &key,
+                                  const std::function<datum_t()> &lazy_sindex_val) {
+        bool keep = false;
+        for (auto el = els.begin(); el != els.end(); ++el) {
+            keep |= accumulate(env, *el, t, key, lazy_sindex_val);
+        }
+        return keep;
+    }
     virtual bool accumulate(env_t *env,
                             const datum_t &el,
                             T *t,
@@ -108,19 +129,58 @@ private:
 
     virtual void unshard(env_t *env, const std::vector<result_t *> &results) {
         guarantee(acc.size() == 0);
-        std::map<datum_t, std::vector<T *>, optional_datum_less_t> vecs;
         r_sanity_check(results.size() != 0);
-        for (auto res = results.begin(); res != results.end(); ++res) {
-            guarantee(*res);
-            grouped_t<T> *gres = boost::get<grouped_t<T> >(*res);
+
+        // Every result holds its groups in the same order, so we merge them with a
+        // heap over the results instead of looking every group up in a map.  Each
+        // cursor is (result index, position, end).
+        typedef typename std::map<datum_t, T, optional_datum_less_t>::iterator it_t;
+        typedef std::pair<size_t, std::pair<it_t, it_t> > cursor_t;
+        std::vector<cursor_t> cursors;
+        cursors.reserve(results.size());
+        for (size_t i = 0; i < results.size(); ++i) {
+            guarantee(results[i]);
+            grouped_t<T> *gres = boost::get<grouped_t<T> >(results[i]);
             guarantee(gres);
-            for (auto kv = gres->begin(); kv != gres->end(); ++kv) {
-                vecs[kv->first].push_back(&kv->second);
+            if (gres->begin() != gres->end()) {
+                cursors.push_back(
+                    std::make_pair(i, std::make_pair(gres->begin(), gres->end())));
             }
         }
-        for (auto kv = vecs.begin(); kv != vecs.end(); ++kv) {
-            auto t_it = acc.insert(std::make_pair(kv->first, default_val)).first;
-            unshard_impl(env, &t_it->second, kv->second);
+        const optional_datum_less_t less;
+        auto heap_cmp = [&](const cursor_t &a, const cursor_t &b) {
+            return less(b.second.first->first, a.second.first->first);
+        };
+        std::make_heap(cursors.begin(), cursors.end(), heap_cmp);
+
+        std::map<datum_t, T, optional_datum_less_t> *out = acc.get_underlying_map();
+        std::vector<std::pair<size_t, T *> > group;
+        std::vector<T *> ts;
+        while (!cursors.empty()) {
+            datum_t key = cursors.front().second.first->first;
+            group.clear();
+            while (!cursors.empty()
+                   && !less(key, cursors.front().second.first->first)) {
+                std::pop_heap(cursors.begin(), cursors.end(), heap_cmp);
+                cursor_t *cursor = &cursors.back();
+                group.push_back(
+                    std::make_pair(cursor->first, &cursor->second.first->second));
+                if (++cursor->second.first == cursor->second.second) {
+                    cursors.pop_back();
+                } else {
+                    std::push_heap(cursors.begin(), cursors.end(), heap_cmp);
+                }
+            }
+            // Combine the partial results in the order of `results`, like we always
+            // have.
+            std::sort(group.begin(), group.end());
+            ts.clear();
+            for (const auto &pair : group) {
+                ts.push_back(pair.second);
+            }
+            // The keys come out in order, so the end is always the right hint.
+            auto t_it = out->insert(out->end(), std::make_pair(std::move(key), default_val));
+            unshard_impl(env, &t_it->second, ts);
         }
     }
     virtual void unshard_impl(env_t *env, T *acc, const std::vector<T *> &ts) = 0;
@@ -431,9 +491,7 @@ private:
                         bool is_sindex = pair.second.stream[0].sindex_key.get_type()
                             != datum_t::UNINITIALIZED;
                         if (is_sindex) {
-                            std::stable_sort(pair.second.stream.begin(),
-                                             pair.second.stream.end(),
-                                             sindex_compare_t(sorting));
+                            sindex_sort_items(&pair.second.stream, sorting);
                         }
                         if (is_sindex_sort) {
                             r_sanity_check(*is_sindex_sort == is_sindex);
@@ -517,9 +575,7 @@ private:
             auto pair = _acc->insert(std::make_pair(it->first, *_default_val));
             auto t_it = pair.first;
             bool keep = !pair.second;
-            for (auto el = it->second.begin(); el != it->second.end(); ++el) {
-                keep |= accumulate(env, *el, &t_it->second);
-            }
+            keep |= accumulate_batch(env, it->second, &t_it->second);
             if (!keep) {
                 _acc->erase(t_it);
             }
@@ -569,13 +625,49 @@ private:
             // Order in fact does NOT matter here.  The reason is, each `kv->first`
             // value is different, which means each operation works on a different
             // key/value pair of `acc`.
-            for (auto kv = gres->begin(); kv != gres->end(); ++kv) {
-                auto t_it = _acc->insert(std::make_pair(kv->first, *_default_val)).first;
-                unshard_impl(env, &t_it->second, &kv->second);
+            //
+            // Both maps are sorted the same way though, so unless `gres` is much
+            // smaller than `acc`, it's cheaper to walk them together than to look up
+            // every key of `gres` in `acc`.
+            std::map<datum_t, T, optional_datum_less_t> *acc_map =
+                _acc->get_underlying_map();
+            if (gres->size() * MERGE_WALK_RATIO < acc_map->size()) {
+                for (auto kv = gres->begin(); kv != gres->end(); ++kv) {
+                    auto t_it = acc_map->insert(
+                        std::make_pair(kv->first, *_default_val)).first;
+                    unshard_impl(env, &t_it->second, &kv->second);
+                }
+            } else {
+                const optional_datum_less_t less;
+                auto pos = acc_map->begin();
+                for (auto kv = gres->begin(); kv != gres->end(); ++kv) {
+                    while (pos != acc_map->end() && less(pos->first, kv->first)) {
+                        ++pos;
+                    }
+                    if (pos == acc_map->end() || less(kv->first, pos->first)) {
+                        pos = acc_map->insert(
+                            pos, std::make_pair(kv->first, *_default_val));
+                    }
+                    unshard_impl(env, &pos->second, &kv->second);
+                }
             }
         }
     }
 
+    virtual bool accumulate_batch(env_t *env,
+                                  const datums_t &els,
+                                  T *t,
+                                  const store_key_t &,
+                                  const std::function<datum_t()> &) {
+        return accumulate_batch(env, els, t);
+    }
+    virtual bool accumulate_batch(env_t *env, const datums_t &els, T *t) {
+        bool keep = false;
+        for (auto el = els.begin(); el != els.end(); ++el) {
+            keep |= accumulate(env, *el, t);
+        }
+        return keep;
+    }
     virtual bool accumulate(env_t *env,
                             const datum_t &el,
                             T *t,
@@ -595,6 +687,9 @@ private:
     }
     virtual void unshard_impl(env_t *env, T *out, T *el) = 0;
     virtual bool should_send_batch() { return false; }
+
+    // Roughly the number of comparisons a lookup in a big group map takes.
+    static const size_t MERGE_WALK_RATIO = 16;
 };
 
 class count_terminal_t : public terminal_t<uint64_t> {
@@ -619,14 +714,72 @@ private:
 
 class acc_func_t {
 public:
-    explicit acc_func_t(const counted_t<const func_t> &_f) : f(_f) { }
+    explicit acc_func_t(const counted_t<const func_t> &_f)
+        : f(_f),
+          field(f.has() ? f->selected_field() : r_nullopt),
+          reads_numbers(!f.has() || field.has_value()) { }
     datum_t operator()(env_t *env, const datum_t &el) const {
         return f.has() ? f->call(env, el)->as_datum() : el;
     }
+    // If the function's value on `el` is a number that can be read without calling
+    // the function, because the function is missing or just selects a field of an
+    // object, sets `*num_out` to it and returns true.
+    bool read_number(const datum_t &el, double *num_out) const {
+        if (!reads_numbers) {
+            return false;
+        }
+        datum_t val = el;
+        if (field.has_value()) {
+            if (el.get_type() != datum_t::R_OBJECT) {
+                return false;
+            }
+            val = el.get_field(*field, NOTHROW);
+            if (!val.has()) {
+                return false;
+            }
+        }
+        if (val.get_type() != datum_t::R_NUM) {
+            return false;
+        }
+        *num_out = val.as_num();
+        return true;
+    }
 private:
     counted_t<const func_t> f;
+    optional<datum_string_t> field;
+    bool reads_numbers;
 };
 
+/* These reduce batches of numbers for `sum`, `avg`, `min` and `max`.  They keep four
+independent partial results, which the compiler can keep in one vector register and
+which don't have to wait on each other. */
+static double sum_numbers(const double *nums, size_t n) {
+    double sums[4] = {0.0, 0.0, 0.0, 0.0};
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        for (size_t j = 0; j < 4; ++j) {
+            sums[j] += nums[i + j];
+        }
+    }
+    double sum = (sums[0] + sums[1]) + (sums[2] + sums[3]);
+    for (; i < n; ++i) {
+        sum += nums[i];
+    }
+    return sum;
+}
+
+// Returns the index of the first of the `n` numbers that no other number beats.
+static size_t best_number(const double *nums, size_t n, bool (*beats)(double, double)) {
+    r_sanity_check(n != 0);
+    size_t best = 0;
+    for (size_t i = 1; i < n; ++i) {
+        if (beats(nums[i], nums[best])) {
+            best = i;
+        }
+    }
+    return best;
+}
+
 template<class T>
 class skip_terminal_t : public terminal_t<T> {
 protected:
@@ -634,6 +787,24 @@ protected:
         : terminal_t<T>(std::move(t)),
           f(wf.compile_wire_func_or_null()),
           bt(wf.bt) { }
+    virtual bool accumulate_batch(env_t *env, const datums_t &els, T *out) {
+        // The longest run of elements at the front whose values are numbers is
+        // reduced at once, and the rest go through `accumulate` one at a time.
+        numbers.clear();
+        double num;
+        while (numbers.size() < els.size() && f.read_number(els[numbers.size()], &num)) {
+            numbers.push_back(num);
+        }
+        bool keep = false;
+        if (!numbers.empty()) {
+            acc_numbers(env, numbers.data(), numbers.size(), els, out, f);
+            keep = true;
+        }
+        for (size_t i = numbers.size(); i < els.size(); ++i) {
+            keep |= accumulate(env, els[i], out);
+        }
+        return keep;
+    }
     virtual bool accumulate(env_t *env,
                             const datum_t &el,
                             T *out) {
@@ -656,9 +827,18 @@ private:
                            const datum_t &el,
                            T *out,
                            const acc_func_t &f) = 0;
+    // Accumulates the first `n` elements of `els`, whose values are `nums`.
+    virtual void acc_numbers(env_t *env,
+                             const double *nums,
+                             size_t n,
+                             const datums_t &els,
+                             T *out,
+                             const acc_func_t &f) = 0;
 
     acc_func_t f;
     backtrace_id_t bt;
+    // Reused between batches so that it doesn't get reallocated.
+    std::vector<double> numbers;
 };
 
 class sum_terminal_t : public skip_terminal_t<double> {
@@ -672,6 +852,14 @@ private:
                            const acc_func_t &_f) {
         *out += _f(env, el).as_num();
     }
+    virtual void acc_numbers(env_t *,
+                             const double *nums,
+                             size_t n,
+                             const datums_t &,
+                             double *out,
+                             const acc_func_t &) {
+        *out += sum_numbers(nums, n);
+    }
     virtual datum_t unpack(double *d) {
         return datum_t(*d);
     }
@@ -693,6 +881,15 @@ private:
         out->first += _f(env, el).as_num();
         out->second += 1;
     }
+    virtual void acc_numbers(env_t *,
+                             const double *nums,
+                             size_t n,
+                             const datums_t &,
+                             std::pair<double, uint64_t> *out,
+                             const acc_func_t &) {
+        out->first += sum_numbers(nums, n);
+        out->second += n;
+    }
     virtual datum_t unpack(
         std::pair<double, uint64_t> *p) {
         rcheck_datum(p->second != 0, base_exc_t::NON_EXISTENCE,
@@ -747,14 +944,19 @@ bool datum_gt(const datum_t &val1, const datum_t &val2) {
     return val1 > val2;
 }
 
+static bool number_lt(double num1, double num2) { return num1 < num2; }
+static bool number_gt(double num1, double num2) { return num1 > num2; }
+
 class optimizing_terminal_t : public skip_terminal_t<optimizer_t> {
 public:
     optimizing_terminal_t(const skip_wire_func_t &_f,
                           const char *_name,
-                          bool (*_cmp)(const datum_t &val1, const datum_t &val2))
+                          bool (*_cmp)(const datum_t &val1, const datum_t &val2),
+                          bool (*_num_cmp)(double num1, double num2))
         : skip_terminal_t<optimizer_t>(_f, optimizer_t()),
           name(_name),
-          cmp(_cmp) { }
+          cmp(_cmp),
+          num_cmp(_num_cmp) { }
 private:
     virtual void maybe_acc(env_t *env,
                            const datum_t &el,
@@ -763,6 +965,16 @@ private:
         optimizer_t other(el, _f(env, el));
         out->swap_if_other_better(&other, cmp);
     }
+    virtual void acc_numbers(env_t *env,
+                             const double *nums,
+                             size_t n,
+                             const datums_t &els,
+                             optimizer_t *out,
+                             const acc_func_t &_f) {
+        // Numbers compare the same way as datums and as doubles, and ties go to the
+        // earlier element either way.
+        maybe_acc(env, els[best_number(nums, n, num_cmp)], out, _f);
+    }
     virtual datum_t unpack(optimizer_t *el) {
         return el->unpack(name);
     }
@@ -771,6 +983,7 @@ private:
     }
     const char *name;
     bool (*cmp)(const datum_t &val1, const datum_t &val2);
+    bool (*num_cmp)(double num1, double num2);
 };
 
 const char *const empty_stream_msg =
@@ -805,6 +1018,80 @@ private:
     counted_t<const func_t> f;
 };
 
+// Keeps the first `k` rows of each group in an array, sorted the way `lt_cmp_t::sort`
+// would sort them.  Rows that compare equal stay in the order they were read in.
+class top_k_terminal_t : public terminal_t<datum_t> {
+public:
+    explicit top_k_terminal_t(const top_k_wire_func_t &f)
+        : terminal_t<datum_t>(datum_t::empty_array()),
+          k(f.k),
+          lt_cmp(f.compile_comparisons()),
+          bt(f.bt) { }
+private:
+    bool lt(env_t *env, const datum_t &l, const datum_t &r) const {
+        try {
+            return lt_cmp(env, nullptr, l, r);
+        } catch (const datum_exc_t &e) {
+            throw exc_t(e, bt);
+        }
+    }
+
+    virtual bool accumulate(env_t *env,
+                            const datum_t &el,
+                            datum_t *out) {
+        const size_t size = out->arr_size();
+        if (size == k && (k == 0 || !lt(env, el, out->get(size - 1)))) {
+            // The common case once the array is full: `el` doesn't make the cut.
+            return true;
+        }
+        // Find the first row that comes after `el`.
+        size_t lo = 0, hi = size;
+        while (lo < hi) {
+            const size_t mid = lo + (hi - lo) / 2;
+            if (lt(env, el, out->get(mid))) {
+                hi = mid;
+            } else {
+                lo = mid + 1;
+            }
+        }
+        std::vector<datum_t> rows;
+        rows.reserve(std::min<size_t>(size + 1, k));
+        for (size_t i = 0; i < lo; ++i) {
+            rows.push_back(out->get(i));
+        }
+        rows.push_back(el);
+        for (size_t i = lo; i < size && rows.size() < k; ++i) {
+            rows.push_back(out->get(i));
+        }
+        *out = datum_t(std::move(rows), datum_t::no_array_size_limit_check_t());
+        return true;
+    }
+    virtual datum_t unpack(datum_t *el) {
+        return std::move(*el);
+    }
+    virtual void unshard_impl(env_t *env, datum_t *out, datum_t *el) {
+        // A stable merge, with the rows of `out` first.
+        const size_t out_size = out->arr_size();
+        const size_t el_size = el->arr_size();
+        std::vector<datum_t> rows;
+        rows.reserve(std::min<size_t>(out_size + el_size, k));
+        size_t i = 0, j = 0;
+        while (rows.size() < k && (i < out_size || j < el_size)) {
+            if (j == el_size
+                || (i < out_size && !lt(env, el->get(j), out->get(i)))) {
+                rows.push_back(out->get(i++));
+            } else {
+                rows.push_back(el->get(j++));
+            }
+        }
+        *out = datum_t(std::move(rows), datum_t::no_array_size_limit_check_t());
+    }
+
+    const size_t k;
+    const lt_cmp_t lt_cmp;
+    const backtrace_id_t bt;
+};
+
 template<class T>
 class terminal_visitor_t : public boost::static_visitor<T *> {
 public:
@@ -818,14 +1105,17 @@ public:
         return new avg_terminal_t(f);
     }
     T *operator()(const min_wire_func_t &f) const {
-        return new optimizing_terminal_t(f, "min", datum_lt);
+        return new optimizing_terminal_t(f, "min", datum_lt, number_lt);
     }
     T *operator()(const max_wire_func_t &f) const {
-        return new optimizing_terminal_t(f, "max", datum_gt);
+        return new optimizing_terminal_t(f, "max", datum_gt, number_gt);
     }
     T *operator()(const reduce_wire_func_t &f) const {
         return new reduce_terminal_t(f);
     }
+    T *operator()(const top_k_wire_func_t &f) const {
+        return new top_k_terminal_t(f);
+    }
     T *operator()(const limit_read_t &lr) const {
         return new limit_append_t(
             lr.is_primary,
@@ -987,9 +1277,7 @@ private:
     virtual void lst_transform(
         env_t *env, datums_t *lst, const std::function<datum_t()> &) {
         try {
-            for (auto it = lst->begin(); it != lst->end(); ++it) {
-                *it = f->call(env, *it)->as_datum();
-            }
+            f->call_on_each(env, lst);
         } catch (const datum_exc_t &e) {
             throw exc_t(e, f->backtrace(), 1);
         }
@@ -1004,6 +1292,7 @@ private:
 class distinct_trans_t : public ungrouped_op_t {
 public:
     explicit distinct_trans_t(const distinct_wire_func_t &f) : use_index(f.use_index) { }
+    virtual bool replaces_row_with_sindex_val() const { return use_index; }
 private:
     // sindex_val may be NULL
     virtual void lst_transform(
@@ -92,6 +92,11 @@ private:
     size_t iterations_since_last_yield;
 };
 
+/* Sorts `items` with `sindex_compare_t`.  The items of an index read come back in the
+order of their btree keys, which is already the order of their index values unless
+some keys were truncated, so this usually only has to check that they're sorted. */
+void sindex_sort_items(std::vector<rget_item_t> *items, sorting_t sorting);
+
 void debug_print(printf_buffer_t *, const rget_item_t &);
 
 typedef std::vector<rget_item_t> raw_stream_t;
@@ -364,6 +369,10 @@ public:
                             groups_t *groups,
                             // Returns a datum that might be null
                             const std::function<datum_t()> &lazy_sindex_val) = 0;
+    // Whether the op replaces every row with its secondary index value without
+    // looking at the row (currently `distinct` on an index), so that secondary index
+    // reads don't have to load the rows at all.
+    virtual bool replaces_row_with_sindex_val() const { return false; }
 };
 
 struct limit_read_t {
@@ -384,7 +393,8 @@ typedef boost::variant<count_wire_func_t,
                        min_wire_func_t,
                        max_wire_func_t,
                        reduce_wire_func_t,
-                       limit_read_t
+                       limit_read_t,
+                       top_k_wire_func_t
                        > terminal_variant_t;
 
 class accumulator_t {
@@ -0,0 +1,147 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "rdb_protocol/slow_query_log.hpp"
+
+#include <inttypes.h>
+
+#include <algorithm>
+#include <array>
+#include <deque>
+#include <utility>
+
+#include "arch/runtime/runtime.hpp"
+#include "concurrency/cache_line_padded.hpp"
+#include "concurrency/pmap.hpp"
+#include "logger.hpp"
+#include "rdb_protocol/pseudo_time.hpp"
+
+namespace ql {
+
+namespace {
+
+/* Only ever accessed on its own thread. */
+struct slow_query_thread_state_t {
+    std::deque<slow_query_t> queries;
+    // When the current one-second logging period started, and how many slow queries
+    // have been logged in it.
+    ticks_t period_start;
+    int num_logged_in_period;
+    int num_not_logged;
+};
+
+std::array<cache_line_padded_t<slow_query_thread_state_t>, MAX_THREADS>
+    slow_query_thread_states;
+
+datum_t usage_to_datum(const resource_usage_t &usage,
+                       datum_object_builder_t *builder) {
+    builder->overwrite("run_secs",
+                       datum_t(static_cast<double>(usage.run_nanos) / BILLION));
+    builder->overwrite("cache_hits", datum_t(static_cast<double>(usage.cache_hits)));
+    builder->overwrite("cache_misses",
+                       datum_t(static_cast<double>(usage.cache_misses)));
+    builder->overwrite("blocks_read", datum_t(static_cast<double>(usage.blocks_read)));
+    builder->overwrite("rows_scanned",
+                       datum_t(static_cast<double>(usage.rows_scanned)));
+    return std::move(*builder).to_datum();
+}
+
+datum_t to_datum(const slow_query_t &query) {
+    datum_object_builder_t builder;
+    builder.overwrite("id", datum_t(datum_string_t(uuid_to_str(query.id))));
+    builder.overwrite("time", pseudo::make_time(
+        static_cast<double>(query.time) / MILLION, "+00:00"));
+    builder.overwrite("fingerprint", datum_t(datum_string_t(
+        strprintf("%016" PRIx64, query.fingerprint->id))));
+    builder.overwrite("query", datum_t(datum_string_t(query.fingerprint->query)));
+    builder.overwrite("total_secs",
+        datum_t(static_cast<double>(query.stats.total_nanos) / BILLION));
+    builder.overwrite("queue_wait_secs",
+        datum_t(static_cast<double>(query.queue_wait_nanos) / BILLION));
+    builder.overwrite("rows_returned",
+        datum_t(static_cast<double>(query.stats.rows_returned)));
+
+    datum_array_builder_t shards(configured_limits_t::unlimited);
+    for (const shard_usage_t &shard : query.shards) {
+        datum_object_builder_t shard_builder;
+        shard_builder.overwrite("range", datum_t(datum_string_t(shard.range)));
+        shard_builder.overwrite("secs",
+            datum_t(static_cast<double>(shard.nanos) / BILLION));
+        shards.add(usage_to_datum(shard.usage, &shard_builder));
+    }
+    builder.overwrite("shards", std::move(shards).to_datum());
+    return usage_to_datum(query.stats.usage, &builder);
+}
+
+}  // namespace
+
+std::atomic<int64_t> slow_query_log_t::threshold_nanos(0);
+
+void slow_query_log_t::set_threshold(ticks_t threshold) {
+    threshold_nanos.store(threshold.nanos);
+}
+
+void slow_query_log_t::record(slow_query_t &&query) {
+    slow_query_thread_state_t *state =
+        &slow_query_thread_states[get_thread_id().threadnum].value;
+    const ticks_t now = get_ticks();
+    if (state->period_start.nanos == 0
+        || now.nanos - state->period_start.nanos >= secs_to_ticks(1).nanos) {
+        state->period_start = now;
+        state->num_logged_in_period = 0;
+    }
+    if (state->num_logged_in_period >= SLOW_QUERY_LOG_MAX_PER_SEC) {
+        ++state->num_not_logged;
+        return;
+    }
+    ++state->num_logged_in_period;
+
+    std::string not_logged;
+    if (state->num_not_logged > 0) {
+        not_logged = strprintf(" (%d more slow queries on this thread weren't logged)",
+                               state->num_not_logged);
+        state->num_not_logged = 0;
+    }
+    logNTC("Slow query %016" PRIx64 " took %.3f ms (%.3f ms queued, %.3f ms running, "
+           "%" PRIu64 " blocks read, %" PRIu64 " rows scanned): %s%s",
+           query.fingerprint->id,
+           static_cast<double>(query.stats.total_nanos) / MILLION,
+           static_cast<double>(query.queue_wait_nanos) / MILLION,
+           static_cast<double>(query.stats.usage.run_nanos) / MILLION,
+           query.stats.usage.blocks_read,
+           query.stats.usage.rows_scanned,
+           query.fingerprint->query.c_str(),
+           not_logged.c_str());
+
+    query.id = generate_uuid();
+    query.time = current_microtime();
+    state->queries.push_back(std::move(query));
+    if (state->queries.size() > SLOW_QUERY_LOG_ENTRIES_PER_THREAD) {
+        state->queries.pop_front();
+    }
+}
+
+datum_t slow_query_log_t::get_report() {
+    std::vector<std::deque<slow_query_t> > per_thread(get_num_threads());
+    pmap(get_num_threads(), [&](int i) {
+        on_thread_t thread_switcher((threadnum_t(i)));
+        per_thread[i] = slow_query_thread_states[i].value.queries;
+    });
+
+    std::vector<const slow_query_t *> queries;
+    for (const auto &thread_queries : per_thread) {
+        for (const slow_query_t &query : thread_queries) {
+            queries.push_back(&query);
+        }
+    }
+    std::sort(queries.begin(), queries.end(),
+        [](const slow_query_t *a, const slow_query_t *b) {
+            return a->time < b->time;
+        });
+
+    datum_array_builder_t builder(configured_limits_t::unlimited);
+    for (const slow_query_t *query : queries) {
+        builder.add(to_datum(*query));
+    }
+    return std::move(builder).to_datum();
+}
+
+}  // namespace ql
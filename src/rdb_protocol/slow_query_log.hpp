@@ -0,0 +1,71 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef RDB_PROTOCOL_SLOW_QUERY_LOG_HPP_
+#define RDB_PROTOCOL_SLOW_QUERY_LOG_HPP_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "arch/runtime/resource_usage.hpp"
+#include "containers/uuid.hpp"
+#include "rdb_protocol/datum.hpp"
+#include "rdb_protocol/query_stats.hpp"
+#include "time.hpp"
+
+/* How many slow queries each thread remembers.  Older ones are forgotten. */
+#define SLOW_QUERY_LOG_ENTRIES_PER_THREAD       100
+
+/* How many slow queries each thread logs per second at most.  Slow queries beyond
+that are only counted, so that a burst of slow queries doesn't make things worse. */
+#define SLOW_QUERY_LOG_MAX_PER_SEC              5
+
+/* How many shards the per-shard breakdown of a slow query lists at most. */
+#define SLOW_QUERY_LOG_MAX_SHARDS               32
+
+namespace ql {
+
+/* A query batch that took longer than the slow query threshold. */
+struct slow_query_t {
+    uuid_u id;
+    // When the batch finished.
+    microtime_t time;
+    std::shared_ptr<const query_fingerprint_t> fingerprint;
+    // The time between receiving the query and starting to run it.
+    int64_t queue_wait_nanos;
+    query_stats_t stats;
+    std::vector<shard_usage_t> shards;
+};
+
+/* The slow query log keeps the query batches that took longer than a threshold, set
+with `--slow-query-threshold`.  It's off by default, and while it's off it costs a
+relaxed atomic load per batch.  Slow queries are written to the server's log file (so
+they show up in `rethinkdb.logs`) and kept in memory for the
+`rethinkdb._slow_queries` table. */
+class slow_query_log_t {
+public:
+    // A threshold of 0 turns the log off.
+    static void set_threshold(ticks_t threshold);
+    static bool is_enabled() {
+        return threshold_nanos.load(std::memory_order_relaxed) != 0;
+    }
+    static bool is_slow(int64_t nanos) {
+        const int64_t threshold = threshold_nanos.load(std::memory_order_relaxed);
+        return threshold != 0 && nanos >= threshold;
+    }
+
+    /* Logs `query`, unless this thread has already logged too many this second. */
+    static void record(slow_query_t &&query);
+
+    /* Returns the slow queries that all threads remember, as an array of objects.
+    Must be called in a coroutine. */
+    static datum_t get_report();
+
+private:
+    static std::atomic<int64_t> threshold_nanos;
+};
+
+}  // namespace ql
+
+#endif  // RDB_PROTOCOL_SLOW_QUERY_LOG_HPP_
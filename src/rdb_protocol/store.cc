@@ -3,6 +3,7 @@
 
 #include <list>
 
+#include "arch/runtime/resource_usage.hpp"
 #include "btree/backfill_debug.hpp"
 #include "btree/reql_specific.hpp"
 #include "btree/superblock.hpp"
@@ -186,7 +187,7 @@ scoped_ptr_t<sindex_superblock_t> acquire_sindex_for_read(
     }
 
     try {
-        deserialize_sindex_info_or_crash(sindex_mapping_data, sindex_info_out);
+        store->get_sindex_info(sindex_uuid, sindex_mapping_data, sindex_info_out);
     } catch (const archive_exc_t &e) {
         crash("%s", e.what());
     }
@@ -244,14 +245,34 @@ void do_read(ql::env_t *env,
             reql_version_t reql_version =
                 sindex_info.mapping_version_info.latest_compatible_reql_version;
             res->reql_version = reql_version;
+            res->hashed_sindex = sindex_info.kind == sindex_kind_t::HASH;
             if (rget.sindex->region.has_value()) {
                 sindex_range = rget.sindex->region->inner;
+            } else if (res->hashed_sindex) {
+                // The values don't tell us where their keys are in a hash index.
+                sindex_range = key_range_t::universe();
             } else {
                 sindex_range =
                     rget.sindex->datumspec.covering_range().to_sindex_keyrange(
                         reql_version);
             }
-            if (sindex_info.geo == sindex_geo_bool_t::GEO) {
+            if (res->hashed_sindex
+                && (rget.sorting != sorting_t::UNORDERED
+                    || rget.sindex->datumspec.visit<bool>(
+                        [](const ql::datum_range_t &) { return true; },
+                        [](const std::map<ql::datum_t, uint64_t> &) {
+                            return false;
+                        }))) {
+                res->result = ql::exc_t(
+                    ql::base_exc_t::LOGIC,
+                    strprintf(
+                        "Index `%s` is a hash index.  Only get_all can use a hash "
+                        "index.",
+                        rget.sindex->id.c_str()),
+                    ql::backtrace_id_t::empty());
+                return;
+            }
+            if (sindex_info.kind == sindex_kind_t::GEO) {
                 res->result = ql::exc_t(
                     ql::base_exc_t::LOGIC,
                     strprintf(
@@ -404,14 +425,29 @@ struct rdb_read_visitor_t : public boost::static_visitor<void> {
 
         auto cserver = store->changefeed_server(s.region);
         if (cserver.first != nullptr) {
+            optional<uint64_t> since;
+            if (s.since) {
+                auto it = s.since->find(cserver.first->get_uuid());
+                if (it != s.since->end()) {
+                    since.set(it->second);
+                }
+            }
+            uint64_t log_position;
+            optional<std::vector<ql::changefeed::msg_t::change_t> > log_changes;
             if (optional<uint64_t> stamp
-                    = cserver.first->get_stamp(s.addr, cserver.second)) {
+                    = cserver.first->get_stamp(s.addr,
+                                               since,
+                                               &log_position,
+                                               &log_changes,
+                                               cserver.second)) {
                 changefeed_stamp_response_t out;
                 out.stamp_infos.set(std::map<uuid_u, shard_stamp_info_t>());
                 (*out.stamp_infos)[cserver.first->get_uuid()] = shard_stamp_info_t{
                     *stamp,
                     current_shard,
-                    read_start};
+                    read_start,
+                    log_position,
+                    std::move(log_changes)};
                 return out;
             }
         }
@@ -509,7 +545,7 @@ struct rdb_read_visitor_t : public boost::static_visitor<void> {
         res->reql_version =
             sindex_info.mapping_version_info.latest_compatible_reql_version;
 
-        if (sindex_info.geo != sindex_geo_bool_t::GEO) {
+        if (sindex_info.kind != sindex_kind_t::GEO) {
             res->result = ql::exc_t(
                 ql::base_exc_t::LOGIC,
                 strprintf(
@@ -566,7 +602,7 @@ struct rdb_read_visitor_t : public boost::static_visitor<void> {
             return;
         }
 
-        if (sindex_info.geo != sindex_geo_bool_t::GEO) {
+        if (sindex_info.kind != sindex_kind_t::GEO) {
             res->results_or_error = ql::exc_t(
                 ql::base_exc_t::LOGIC,
                 strprintf(
@@ -673,6 +709,13 @@ struct rdb_read_visitor_t : public boost::static_visitor<void> {
         response->response = dummy_read_response_t();
     }
 
+    void operator()(const sample_read_t &sr) {
+        response->response = sample_read_response_t();
+        sample_read_response_t *res =
+            boost::get<sample_read_response_t>(&response->response);
+        rdb_sample(sr.region.inner, sr.num, superblock, res);
+    }
+
     rdb_read_visitor_t(btree_slice_t *_btree,
                        store_t *_store,
                        real_superblock_t *_superblock,
@@ -708,6 +751,7 @@ void store_t::protocol_read(const read_t &_read,
     scoped_ptr_t<profile::trace_t> trace = ql::maybe_make_profile_trace(_read.profile);
 
     {
+        scoped_resource_usage_t usage_scope(&response->resource_usage);
         PROFILE_STARTER_IF_ENABLED(
             _read.profile == profile_bool_t::PROFILE, "Perform read on shard.", trace);
         rdb_read_visitor_t v(btree.get(), this,
@@ -741,12 +785,13 @@ public:
           write_hook(std::move(wh)),
           return_changes(_return_changes) { }
     ql::datum_t replace(
-        const ql::datum_t &d, size_t) const {
+        const ql::datum_t &d, size_t, write_hook_env_t *write_hook_env) const {
         ql::datum_t res = f->call(env, d, ql::LITERAL_OK)->as_datum();
 
         const ql::datum_t &write_timestamp = env->get_deterministic_time();
         r_sanity_check(write_timestamp.has());
-        return apply_write_hook(pkey, d, res, write_timestamp, write_hook);
+        return apply_write_hook(
+            pkey, d, res, write_timestamp, write_hook, write_hook_env);
     }
     return_changes_t should_return_changes() const { return return_changes; }
 private:
@@ -765,6 +810,7 @@ public:
           datums(&bi.inserts),
           conflict_behavior(bi.conflict_behavior),
           pkey(bi.pkey),
+          pkey_string(bi.pkey),
           return_changes(bi.return_changes) {
         if (bi.conflict_func.has_value()) {
             conflict_func.set(bi.conflict_func->compile_wire_func());
@@ -774,19 +820,19 @@ public:
         }
     }
     ql::datum_t replace(const ql::datum_t &d,
-                        size_t index) const {
+                        size_t index,
+                        write_hook_env_t *write_hook_env) const {
         guarantee(index < datums->size());
-        ql::datum_t newd = (*datums)[index];
         ql::datum_t res = resolve_insert_conflict(env,
                                              pkey,
                                              d,
-                                             newd,
+                                             (*datums)[index],
                                              conflict_behavior,
                                              conflict_func);
         const ql::datum_t &write_timestamp = env->get_deterministic_time();
         r_sanity_check(write_timestamp.has());
-        res = apply_write_hook(datum_string_t(pkey), d, res, write_timestamp,
-                               write_hook);
+        res = apply_write_hook(
+            pkey_string, d, res, write_timestamp, write_hook, write_hook_env);
         return res;
     }
     return_changes_t should_return_changes() const { return return_changes; }
@@ -798,6 +844,7 @@ private:
     const std::vector<ql::datum_t> *const datums;
     const conflict_behavior_t conflict_behavior;
     const std::string pkey;
+    const datum_string_t pkey_string;
     const return_changes_t return_changes;
     optional<counted_t<const ql::func_t> > conflict_func;
 };
@@ -972,6 +1019,7 @@ void store_t::protocol_write(const write_t &_write,
     scoped_ptr_t<profile::trace_t> trace = ql::maybe_make_profile_trace(_write.profile);
 
     {
+        scoped_resource_usage_t usage_scope(&response->resource_usage);
         profile::sampler_t start_write("Perform write on shard.", trace);
         rdb_write_visitor_t v(btree.get(),
                               this,
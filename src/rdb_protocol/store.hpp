@@ -3,6 +3,7 @@
 #define RDB_PROTOCOL_STORE_HPP_
 
 #include <map>
+#include <memory>
 #include <set>
 #include <string>
 #include <vector>
@@ -40,6 +41,7 @@ class superblock_t;
 class txn_t;
 class cache_balancer_t;
 struct rdb_modification_report_t;
+struct sindex_disk_info_t;
 
 class sindex_not_ready_exc_t : public std::exception {
 public:
@@ -201,6 +203,19 @@ public:
 
     void configure_flush_interval(flush_interval_t interval);
 
+    // This store's share of the table's `cache` config.
+    void configure_cache_reservation(const cache_reservation_t &reservation);
+
+    // Starts building the primary btree's key filter in the background if a lookup
+    // asked for one.  See `btree_slice_t::may_contain_key()`.
+    void maybe_build_key_filter();
+
+    // Keeps the cache's hot block manifest in the file at `path` (see
+    // `hot_block_manifest.hpp`).  If `warm_up` is true, warms up the cache from the
+    // manifest first.  The manifest is then written every
+    // HOT_BLOCK_MANIFEST_INTERVAL_MS, and when the store is destroyed.
+    void maintain_hot_block_manifest(const std::string &path, bool warm_up);
+
     new_mutex_in_line_t get_in_line_for_sindex_queue(buf_lock_t *sindex_block);
     rwlock_in_line_t get_in_line_for_cfeed_stamp(access_t access);
 
@@ -357,9 +372,24 @@ private:
             buf_lock_t *sindex_block,
             const sindex_name_t &name);
 
+    // Fills a new key filter from a snapshotted traversal of the primary btree.  To be
+    // run in a coroutine.
+    void build_key_filter(auto_drainer_t::lock_t store_keepalive) THROWS_NOTHING;
+
+    // To be run in a coroutine by `maintain_hot_block_manifest()`.
+    void hot_block_manifest_loop(bool warm_up, auto_drainer_t::lock_t store_keepalive)
+        THROWS_NOTHING;
+
 public:
     namespace_id_t const &get_table_id() const;
 
+    // Deserializes a secondary index's definition, which compiles its mapping
+    // function, or returns the result of an earlier call with the same
+    // `opaque_definition`.  Must be called on the store's home thread.
+    void get_sindex_info(uuid_u sindex_id,
+                         const std::vector<char> &opaque_definition,
+                         sindex_disk_info_t *sindex_info_out);
+
     // The `double` is the progress of the secondary index construction.
     typedef std::map<uuid_u, std::pair<microtime_t, double const *> >
         sindex_context_map_t;
@@ -403,6 +433,15 @@ public:
 
 private:
     rdb_context_t *ctx;
+
+    // Used by `get_sindex_info()`.  An index keeps its id when it's renamed, and its
+    // definition changes when its ReQL version is upgraded, so an entry is valid as
+    // long as its `opaque_definition` matches.  `drop_sindex()` removes entries.
+    struct cached_sindex_info_t {
+        std::vector<char> opaque_definition;
+        std::shared_ptr<const sindex_disk_info_t> info;
+    };
+    std::map<uuid_u, cached_sindex_info_t> sindex_info_cache;
     // We store regions here even though we only really need the key ranges
     // because it's nice to have a unique identifier across `store_t`s.  In the
     // future we may use these `region_t`s instead of the `uuid_u`s in the
@@ -431,6 +470,11 @@ public:
 private:
     namespace_id_t table_id;
 
+    bool building_key_filter;
+
+    // Empty unless `maintain_hot_block_manifest()` was called.
+    std::string hot_block_manifest_path;
+
     sindex_context_map_t sindex_context;
 
     // Having a lot of writes queued up waiting for the superblock to become available
@@ -440,6 +484,25 @@ private:
     // the superblock, if any).
     new_semaphore_t write_superblock_acq_semaphore;
 
+    /* Single-document writes that come in while another one is waiting for the
+    superblock join its `write_group_t`, and the group's leader applies all of them in
+    one transaction, running them concurrently. `open_write_group` is the group that
+    is still taking new writes, if any. Groups and the writes that
+    `acquire_superblock_for_write()` performs on their own go through
+    `write_group_mutex` in the order of their write tokens, and hold it only until
+    they're in line for the superblock, so they reach the superblock in that order
+    too. */
+    struct grouped_write_t;
+    struct write_group_t;
+    void perform_write_group(write_group_t *group);
+    // Runs in a coroutine for each write of a group, and takes ownership of
+    // `superblock`.
+    void perform_grouped_write(grouped_write_t *w,
+                               real_superblock_t *superblock,
+                               auto_drainer_t::lock_t group_keepalive);
+    write_group_t *open_write_group;
+    new_mutex_t write_group_mutex;
+
 public:
     // This lock is used to pause backfills while secondary indexes are being
     // post constructed. Secondary index post construction gets in line for a write
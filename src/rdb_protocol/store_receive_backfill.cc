@@ -1,7 +1,9 @@
 #include "rdb_protocol/store.hpp"
 
 #include "btree/backfill.hpp"
+#include "btree/depth_first_traversal.hpp"
 #include "btree/reql_specific.hpp"
+#include "btree/secondary_operations.hpp"
 #include "rdb_protocol/btree.hpp"
 
 /* `MAX_CONCURRENT_BACKFILL_ITEMS` is the maximum number of coroutines we'll spawn in
@@ -14,17 +16,23 @@ backfill faster, but it will also cause the backfill-related transactions to hol
 superblock for a longer time. */
 static const int MAX_CHANGES_PER_TXN = 16;
 
+/* `MAX_SEED_CHANGES_PER_TXN` replaces `MAX_CHANGES_PER_TXN` when the range we're
+backfilling into held no keys when the backfill started. Then there's nothing to erase,
+so a transaction only applies pairs, and it can apply more of them. */
+static const int MAX_SEED_CHANGES_PER_TXN = 64;
+
 /* `MAX_UNSAVED_CHANGES` is the maximum number of keys we'll modify or delete before
 flushing our changes out to disk. This prevents the backfill from using too much of the
 cache's unsaved data limit, which would slow down queries on other shards. */
 static const int MAX_UNSAVED_CHANGES = 1000;
 
-void flush_cache(cache_conn_t *cache, UNUSED signal_t *interruptor) {
+void flush_cache(cache_conn_t *cache, signal_t *interruptor) {
     scoped_ptr_t<txn_t> txn;
     {
         scoped_ptr_t<real_superblock_t> superblock;
         get_btree_superblock_and_txn_for_writing(cache, nullptr,
-            write_access_t::write, 1, write_durability_t::HARD, &superblock, &txn);
+            write_access_t::write, 1, write_durability_t::HARD, &superblock, &txn,
+            interruptor);
         buf_write_t write(superblock->get());
     }
     /* `commit` will block until all of the transactions that acquired the
@@ -91,18 +99,26 @@ entire backfill task, that the tokens need access to. */
 class receive_backfill_info_t {
 public:
     receive_backfill_info_t(
-            cache_conn_t *c, btree_slice_t *s, unsaved_data_limiter_t *l) :
-        cache_conn(c), slice(s), limiter(l),
+            store_t *st, cache_conn_t *c, btree_slice_t *s, unsaved_data_limiter_t *l,
+            bool se) :
+        store(st), cache_conn(c), slice(s), limiter(l), seeding(se),
         semaphore(MAX_CONCURRENT_BACKFILL_ITEMS) { }
 
-    /* `cache_conn` and `slice` are just copied from the corresponding fields of the
-    `store_t` object */
+    /* `cache_conn` and `slice` are just copied from the corresponding fields of
+    `store` */
+    store_t *store;
     cache_conn_t *cache_conn;
     btree_slice_t *slice;
 
     /* `limiter` lives on the stack in `receive_backfill()` */
     unsaved_data_limiter_t *limiter;
 
+    /* `seeding` is true if the region we're backfilling into held no keys when the
+    backfill started. Writes only reach the parts of the region that we've already
+    committed, so the range of every item we get is still empty when we apply it, and
+    `apply_multi_key_item()` can skip erasing it first. */
+    bool seeding;
+
     /* `semaphore` limits how many coroutines can be running at once. */
     new_semaphore_t semaphore;
 
@@ -162,7 +178,8 @@ void apply_empty_range(
                 &tokens.info->btree_fifo_sink, tokens.write_token);
             wait_interruptible(&exiter, tokens.keepalive.get_drain_signal());
             get_btree_superblock_and_txn_for_writing(tokens.info->cache_conn, nullptr,
-                write_access_t::write, 1, write_durability_t::SOFT, &superblock, &txn);
+                write_access_t::write, 1, write_durability_t::SOFT, &superblock, &txn,
+                tokens.keepalive.get_drain_signal());
 
             /* Update the metainfo and release the superblock. */
             tokens.update_metainfo_cb(empty_range, superblock.get());
@@ -181,16 +198,56 @@ void apply_empty_range(
     }
 }
 
+/* `needs_mod_reports()` returns true if the changes made in a transaction that holds
+`sindex_block` for write must be reported with their old and new values, because there
+are secondary indexes to update or secondary index construction queues to push the
+reports onto. A construction queue is only registered while its index is in the sindex
+block and the block is held for write, so neither can show up before we release it. */
+bool needs_mod_reports(store_t *store, buf_lock_t *sindex_block) {
+    std::map<sindex_name_t, secondary_index_t> sindexes;
+    get_secondary_indexes(sindex_block, &sindexes);
+    return !sindexes.empty() || !store->sindex_queues.empty();
+}
+
+/* `range_has_keys()` returns true if the B-tree has any key-value pairs in `range`. */
+bool range_has_keys(
+        cache_conn_t *cache_conn, const key_range_t &range, signal_t *interruptor) {
+    class has_keys_cb_t : public depth_first_traversal_callback_t {
+    public:
+        has_keys_cb_t() : found(false) { }
+        continue_bool_t handle_pair(scoped_key_value_t &&, signal_t *) {
+            found = true;
+            return continue_bool_t::ABORT;
+        }
+        bool found;
+    } cb;
+    scoped_ptr_t<txn_t> txn;
+    scoped_ptr_t<real_superblock_t> superblock;
+    get_btree_superblock_and_txn_for_reading(
+        cache_conn, CACHE_SNAPSHOTTED_NO, &superblock, &txn);
+    btree_depth_first_traversal(superblock.get(), range, &cb, access_t::read,
+        direction_t::FORWARD, release_superblock_t::RELEASE, interruptor);
+    return cb.found;
+}
+
 /* `apply_item_pair()` is a helper function for `apply_single_key_item()` and
 `apply_multi_key_item()`. It applies a single `backfill_item_t::pair_t` to the B-tree.
-It doesn't call `on_commit()` or modify the metainfo. */
+It doesn't call `on_commit()` or modify the metainfo. If `need_mod_reports` is false, a
+new value is written to disk exactly as the backfiller sent it instead of being decoded
+and encoded again, and no modification report is made for it. */
 void apply_item_pair(
         btree_slice_t *slice,
         real_superblock_t *superblock,
         backfill_item_t::pair_t &&pair,
+        bool need_mod_reports,
         std::vector<rdb_modification_report_t> *mod_reports_out,
         promise_t<superblock_t *> *pass_back_superblock) {
     rdb_live_deletion_context_t deletion_context;
+    if (static_cast<bool>(pair.value) && !need_mod_reports) {
+        rdb_set_serialized(pair.key, *pair.value, slice, pair.recency, superblock,
+            &deletion_context, pass_back_superblock);
+        return;
+    }
     mod_reports_out->resize(mod_reports_out->size() + 1);
     mod_reports_out->back().primary_key = pair.key;
     if (static_cast<bool>(pair.value)) {
@@ -240,7 +297,8 @@ void apply_single_key_item(
                 1, tokens.keepalive.get_drain_signal());
 
             get_btree_superblock_and_txn_for_writing(tokens.info->cache_conn, nullptr,
-                write_access_t::write, 1, write_durability_t::SOFT, &superblock, &txn);
+                write_access_t::write, 1, write_durability_t::SOFT, &superblock, &txn,
+                tokens.keepalive.get_drain_signal());
 
             /* Acquire the sindex block and update the metainfo now, because we'll
             release the superblock soon */
@@ -249,10 +307,13 @@ void apply_single_key_item(
             tokens.update_metainfo_cb(item.range.right, superblock.get());
         }
 
-        /* Actually apply the change, releasing the superblock in the process. */
+        /* Actually apply the change, releasing the superblock in the process. We
+        always make a modification report here; finding out if we need one would mean
+        waiting for the sindex block while we hold the superblock, which would stop the
+        next item from pipelining with this one. */
         std::vector<rdb_modification_report_t> mod_reports;
         apply_item_pair(tokens.info->slice, superblock.get(),
-            std::move(item.pairs[0]), &mod_reports, nullptr);
+            std::move(item.pairs[0]), true, &mod_reports, nullptr);
 
         /* Notify that we're done and update the sindexes */
         fifo_enforcer_sink_t::exit_write_t exiter(
@@ -270,7 +331,7 @@ void apply_single_key_item(
 
 /* `apply_multi_key_item()` is for items that apply to a range of keys. We must first
 delete any existing values or deletion entries in that range, and then apply the contents
-of `item.pairs`. */
+of `item.pairs`. If we're seeding an empty region there's nothing to delete. */
 void apply_multi_key_item(
         const receive_backfill_tokens_t &tokens,
         /* `item` is conceptually passed by move, but `std::bind()` isn't smart enough to
@@ -290,6 +351,8 @@ void apply_multi_key_item(
 
         /* It's possible that there are a lot of keys to be deleted, so we might do the
         backfill item in several chunks. */
+        const size_t max_pairs_per_txn = tokens.info->seeding
+            ? MAX_SEED_CHANGES_PER_TXN : MAX_CHANGES_PER_TXN / 2;
         bool is_first = true;
         size_t next_pair = 0;
         key_range_t::right_bound_t threshold(item.range.left);
@@ -299,7 +362,8 @@ void apply_multi_key_item(
             /* Block until there's not too much unsaved data. Note that
             `MAX_CHANGES_PER_TXN` might be an overestimate, but that's OK. */
             tokens.info->limiter->prepare_for_changes(
-                MAX_CHANGES_PER_TXN, tokens.keepalive.get_drain_signal());
+                tokens.info->seeding ? MAX_SEED_CHANGES_PER_TXN : MAX_CHANGES_PER_TXN,
+                tokens.keepalive.get_drain_signal());
 
             /* We must not throw within the transaction. So we check the
             drain signal now. */
@@ -312,7 +376,8 @@ void apply_multi_key_item(
             scoped_ptr_t<txn_t> txn;
             scoped_ptr_t<real_superblock_t> superblock;
             get_btree_superblock_and_txn_for_writing(tokens.info->cache_conn, nullptr,
-                write_access_t::write, 1, write_durability_t::SOFT, &superblock, &txn);
+                write_access_t::write, 1, write_durability_t::SOFT, &superblock, &txn,
+                tokens.keepalive.get_drain_signal());
 
             /* If we haven't already done so, then update the min deletion timstamps.
             See `btree/backfill.hpp` for an explanation of what this is. Note that we do
@@ -328,36 +393,47 @@ void apply_multi_key_item(
                 is_first = false;
             }
 
+            /* Acquire the sindex block. We hold both `fifo_enforcer_sink_t`s, so
+            waiting for it doesn't hold up any other backfill item. */
+            buf_lock_t sindex_block(superblock->expose_buf(),
+                superblock->get_sindex_block_id(), access_t::write);
+            bool need_mod_reports =
+                needs_mod_reports(tokens.info->store, &sindex_block);
+
             /* Establish an upper limit on how much of the range we're willing to delete
             in this cycle. We choose the upper limit such that it contains no more than
-            `MAX_CHANGES_PER_TXN / 2` of the pairs in the backfill item. */
+            `max_pairs_per_txn` of the pairs in the backfill item. */
             key_range_t range_to_delete;
             range_to_delete.left = threshold.key();
-            if (next_pair + MAX_CHANGES_PER_TXN / 2 + 1 < item.pairs.size()) {
+            if (next_pair + max_pairs_per_txn + 1 < item.pairs.size()) {
                 range_to_delete.right = key_range_t::right_bound_t(
-                    item.pairs[next_pair + MAX_CHANGES_PER_TXN / 2 + 1].key);
+                    item.pairs[next_pair + max_pairs_per_txn + 1].key);
             } else {
                 range_to_delete.right = item.range.right;
             }
 
             /* Delete a chunk of the range, making sure to do no more than
             `MAX_CHANGES_PER_TXN / 2` changes at once. */
-            always_true_key_tester_t key_tester;
             key_range_t range_deleted;
-            rdb_live_deletion_context_t deletion_context;
-            continue_bool_t res = rdb_erase_small_range(tokens.info->slice, &key_tester,
-                range_to_delete, superblock.get(), &deletion_context,
-                &non_interruptor, MAX_CHANGES_PER_TXN / 2,
-                &mod_reports, &range_deleted);
-            guarantee(range_deleted.right == range_to_delete.right
-                || res == continue_bool_t::CONTINUE);
+            if (tokens.info->seeding) {
+                range_deleted = range_to_delete;
+            } else {
+                always_true_key_tester_t key_tester;
+                rdb_live_deletion_context_t deletion_context;
+                continue_bool_t res = rdb_erase_small_range(tokens.info->slice,
+                    &key_tester, range_to_delete, superblock.get(), &deletion_context,
+                    &non_interruptor, MAX_CHANGES_PER_TXN / 2,
+                    &mod_reports, &range_deleted);
+                guarantee(range_deleted.right == range_to_delete.right
+                    || res == continue_bool_t::CONTINUE);
+            }
 
             /* Apply any pairs from the item that fall within the deleted region */
             while (next_pair < item.pairs.size() &&
                     range_deleted.contains_key(item.pairs[next_pair].key)) {
                 promise_t<superblock_t *> pass_back_superblock;
                 apply_item_pair(tokens.info->slice, superblock.get(),
-                    std::move(item.pairs[next_pair]), &mod_reports,
+                    std::move(item.pairs[next_pair]), need_mod_reports, &mod_reports,
                     &pass_back_superblock);
                 guarantee(superblock.get() == pass_back_superblock.assert_get_value());
                 ++next_pair;
@@ -366,9 +442,7 @@ void apply_multi_key_item(
             /* Update `threshold` to reflect the changes we've made */
             threshold = range_deleted.right;
 
-            /* Acquire the sindex block and update the metainfo */
-            buf_lock_t sindex_block(superblock->expose_buf(),
-                superblock->get_sindex_block_id(), access_t::write);
+            /* Update the metainfo */
             tokens.update_metainfo_cb(threshold, superblock.get());
             superblock->release();
 
@@ -390,8 +464,9 @@ continue_bool_t store_t::receive_backfill(
     guarantee(_region.beg == get_region().beg && _region.end == get_region().end);
 
     unsaved_data_limiter_t unsaved_data_limiter(general_cache_conn.get());
-    receive_backfill_info_t info(
-        general_cache_conn.get(), btree.get(), &unsaved_data_limiter);
+    bool seeding = !range_has_keys(general_cache_conn.get(), _region.inner, interruptor);
+    receive_backfill_info_t info(this, general_cache_conn.get(), btree.get(),
+        &unsaved_data_limiter, seeding);
 
     /* `spawn_threshold` is the point up to which we've spawned coroutines.
     `metainfo_threshold` is the point up to which we've applied the metainfo to the
@@ -183,7 +183,7 @@ public:
         rdb_blob_wrapper_t blob_wrapper(
             parent.cache()->max_block_size(),
             const_cast<rdb_value_t *>(v)->value_ref(),
-            blob::btree_maxreflen);
+            blob::btree_maxreflen_for(parent.cache()->max_block_size()));
         blob_acq_t acq_group;
         buffer_group_t buffer_group;
         blob_wrapper.expose_all(
@@ -205,7 +205,7 @@ public:
         rdb_blob_wrapper_t blob_wrapper(
             parent.cache()->max_block_size(),
             const_cast<rdb_value_t *>(v)->value_ref(),
-            blob::btree_maxreflen);
+            blob::btree_maxreflen_for(parent.cache()->max_block_size()));
         return blob_wrapper.valuesize();
     }
     size_t remaining;
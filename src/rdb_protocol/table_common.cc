@@ -200,10 +200,10 @@ ql::datum_t make_row_replacement_error_stats(
 ql::datum_t resolve_insert_conflict(
     ql::env_t *env,
     const std::string &primary_key,
-    ql::datum_t old_row,
-    ql::datum_t insert_row,
+    const ql::datum_t &old_row,
+    const ql::datum_t &insert_row,
     conflict_behavior_t conflict_behavior,
-    optional<counted_t<const ql::func_t> > conflict_func) {
+    const optional<counted_t<const ql::func_t> > &conflict_func) {
 
     if (old_row.get_type() == ql::datum_t::R_NULL) {
         return insert_row;
@@ -64,10 +64,10 @@ exception. */
 ql::datum_t resolve_insert_conflict(
         ql::env_t *env,
         const std::string &primary_key,
-        ql::datum_t old_row,
-        ql::datum_t insert_row,
+        const ql::datum_t &old_row,
+        const ql::datum_t &insert_row,
         conflict_behavior_t conflict_behavior,
-        optional<counted_t<const ql::func_t> > conflict_func);
+        const optional<counted_t<const ql::func_t> > &conflict_func);
 
 #endif /* RDB_PROTOCOL_TABLE_COMMON_HPP_ */
 
@@ -39,6 +39,7 @@ counted_t<const term_t> compile_on_current_stack(
     case Term::TABLE:              return make_table_term(env, t);
     case Term::GET:                return make_get_term(env, t);
     case Term::GET_ALL:            return make_get_all_term(env, t);
+    case Term::SEARCH:             return make_search_term(env, t);
     case Term::EQ:                 // fallthru
     case Term::NE:                 // fallthru
     case Term::LT:                 // fallthru
@@ -161,6 +162,7 @@ counted_t<const term_t> compile_on_current_stack(
     case Term::NOW:                return make_now_term(env, t);
     case Term::IN_TIMEZONE:        return make_in_timezone_term(env, t);
     case Term::DURING:             return make_during_term(env, t);
+    case Term::BUCKET:             return make_bucket_term(env, t);
     case Term::DATE:               return make_date_term(env, t);
     case Term::TIME_OF_DAY:        return make_time_of_day_term(env, t);
     case Term::TIMEZONE:           return make_timezone_term(env, t);
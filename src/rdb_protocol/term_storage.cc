@@ -1,7 +1,10 @@
 // Copyright 2010-2015 RethinkDB, all rights reserved.
 #include "rdb_protocol/term_storage.hpp"
 
+#include <vector>
+
 #include "arch/runtime/coroutines.hpp"
+#include "arch/runtime/memory_usage.hpp"
 #include "rapidjson/writer.h"
 #include "rdb_protocol/datum_json.hpp"
 #include "rdb_protocol/optargs.hpp"
@@ -32,6 +35,9 @@ bool query_type_is_valid(Query::QueryType query_type) {
     case Query::STOP:
     case Query::NOREPLY_WAIT:
     case Query::SERVER_INFO:
+    case Query::PREPARE:
+    case Query::EXECUTE:
+    case Query::UNPREPARE:
         return true;
     default:
         return false;
@@ -48,7 +54,7 @@ raw_term_t::raw_term_t(const term_variant_t &source) {
     public:
         explicit param_visitor_t(raw_term_t *_parent) : parent(_parent) { }
         void operator() (const rapidjson::Value *json_source) {
-            parent->init_json(json_source);
+            parent->init_json(json_source, nullptr);
         }
         void operator() (const counted_t<generated_term_t> &gen_source) {
             parent->info = gen_source;
@@ -59,10 +65,17 @@ raw_term_t::raw_term_t(const term_variant_t &source) {
     boost::apply_visitor(visitor, source);
 }
 
-void raw_term_t::init_json(const rapidjson::Value *src) {
+raw_term_t::raw_term_t(const rapidjson::Value *source,
+                       const shared_buf_t *insitu_buffer) {
+    init_json(source, insitu_buffer);
+}
+
+void raw_term_t::init_json(const rapidjson::Value *src,
+                           const shared_buf_t *insitu_buffer) {
     info = json_data_t();
     json_data_t *data = boost::get<json_data_t>(&info);
     data->source = src;
+    data->insitu_buffer = insitu_buffer;
 
     r_sanity_check(src->IsArray());
     size_t size = src->Size();
@@ -130,7 +143,7 @@ raw_term_t raw_term_t::arg(size_t index) const {
     visit_source(
         [&](const json_data_t &source) {
             guarantee(source.args->Size() > index);
-            res.init_json(&(*source.args)[index]);
+            res.init_json(&(*source.args)[index], source.insitu_buffer);
         },
         [&](const counted_t<generated_term_t> &source) {
             guarantee(source->args.size() > index);
@@ -146,7 +159,7 @@ optional<raw_term_t> raw_term_t::optarg(const std::string &name) const {
             if (source.optargs != nullptr) {
                 auto it = source.optargs->FindMember(name.c_str());
                 if (it != source.optargs->MemberEnd()) {
-                    res.set(raw_term_t(&it->value));
+                    res.set(raw_term_t(&it->value, source.insitu_buffer));
                 }
             }
         },
@@ -165,7 +178,7 @@ datum_t raw_term_t::datum(const configured_limits_t &limits,
     visit_source(
         [&](const json_data_t &source) {
             if (source.datum != nullptr) {
-                res = to_datum(*source.datum, limits, version);
+                res = to_datum(*source.datum, limits, version, source.insitu_buffer);
             }
         },
         [&](const counted_t<generated_term_t> &source) {
@@ -231,20 +244,87 @@ bool term_storage_t::static_optarg_as_bool(UNUSED const std::string &key,
     unreachable();
 }
 
+std::string term_storage_t::static_optarg_as_string(
+        UNUSED const std::string &key, UNUSED const std::string &default_value) const {
+    r_sanity_check(false, "static_optarg_as_string() is unimplemented "
+                   "for this term_storage_t type");
+    unreachable();
+}
+
+int64_t term_storage_t::static_optarg_as_int(UNUSED const std::string &key,
+                                             UNUSED int64_t default_value) const {
+    r_sanity_check(false, "static_optarg_as_int() is unimplemented "
+                   "for this term_storage_t type");
+    unreachable();
+}
+
 global_optargs_t term_storage_t::global_optargs() {
     r_sanity_check(false, "global_optargs() is unimplemented "
                    "for this term_storage_t type");
     unreachable();
 }
 
+void term_storage_t::execute_params(UNUSED int64_t *prepared_token_out,
+                                    UNUSED std::vector<datum_t> *args_out) const {
+    r_sanity_check(false, "execute_params() is unimplemented "
+                   "for this term_storage_t type");
+    unreachable();
+}
+
 const backtrace_registry_t &term_storage_t::backtrace_registry() const {
     return bt_reg;
 }
 
-json_term_storage_t::json_term_storage_t(scoped_array_t<char> &&_original_data,
+// See the comment on `json_term_storage_t`.
+void prefix_insitu_strings(shared_buf_t *buffer, rapidjson::Value *root) {
+    const char *buffer_begin = buffer->data();
+    const char *buffer_end = buffer_begin + buffer->size();
+    auto prefix = [&](const char *str, size_t size) {
+        if (str > buffer_begin && str + size <= buffer_end
+            && size < json_term_storage_t::INSITU_STRING_MAX_SIZE) {
+            char *quote = buffer->data(str - 1 - buffer_begin);
+            rassert(*quote == '"');
+            *quote = static_cast<char>(size);
+        }
+    };
+
+    // The term tree can be deeply nested, so we walk it without recursing.
+    std::vector<rapidjson::Value *> stack(1, root);
+    while (!stack.empty()) {
+        rapidjson::Value *value = stack.back();
+        stack.pop_back();
+        switch (value->GetType()) {
+        case rapidjson::kStringType:
+            prefix(value->GetString(), value->GetStringLength());
+            break;
+        case rapidjson::kArrayType:
+            for (auto it = value->Begin(); it != value->End(); ++it) {
+                stack.push_back(&*it);
+            }
+            break;
+        case rapidjson::kObjectType:
+            for (auto it = value->MemberBegin(); it != value->MemberEnd(); ++it) {
+                prefix(it->name.GetString(), it->name.GetStringLength());
+                stack.push_back(&it->value);
+            }
+            break;
+        case rapidjson::kNullType:
+        case rapidjson::kFalseType:
+        case rapidjson::kTrueType:
+        case rapidjson::kNumberType:
+        default:
+            break;
+        }
+    }
+}
+
+json_term_storage_t::json_term_storage_t(counted_t<shared_buf_t> &&_original_data,
                                          rapidjson::Document &&_query_json) :
         original_data(std::move(_original_data)),
-        query_json(std::move(_query_json)) {
+        query_json(std::move(_query_json)),
+        counted_memory_usage(0) {
+    prefix_insitu_strings(original_data.get(), &query_json);
+
     // We throw `bt_exc_t`s here because we cannot use backtrace IDs until the
     // `preprocess` step has completed.
     if (!query_json.IsArray()) {
@@ -281,6 +361,20 @@ json_term_storage_t::json_term_storage_t(scoped_array_t<char> &&_original_data,
                            backtrace_registry_t::EMPTY_BACKTRACE);
         }
     }
+    update_memory_usage();
+}
+
+json_term_storage_t::~json_term_storage_t() {
+    add_memory_usage(memory_tag_t::QUERY_CACHE,
+                     -static_cast<int64_t>(counted_memory_usage));
+}
+
+void json_term_storage_t::update_memory_usage() {
+    const size_t memory_usage = query_json.GetAllocator().Capacity();
+    add_memory_usage(memory_tag_t::QUERY_CACHE,
+                     static_cast<int64_t>(memory_usage)
+                     - static_cast<int64_t>(counted_memory_usage));
+    counted_memory_usage = memory_usage;
 }
 
 Query::QueryType json_term_storage_t::query_type() const {
@@ -290,11 +384,13 @@ Query::QueryType json_term_storage_t::query_type() const {
 void json_term_storage_t::preprocess() {
     r_sanity_check(query_json.Size() >= 2);
     preprocess_term_tree(&query_json[1], &query_json.GetAllocator(), &bt_reg);
+    // Preprocessing adds terms.
+    update_memory_usage();
 }
 
 raw_term_t json_term_storage_t::root_term() const {
     r_sanity_check(query_json.Size() >= 2);
-    return raw_term_t(&query_json[1]);
+    return raw_term_t(&query_json[1], original_data.get());
 }
 
 bool json_term_storage_t::static_optarg_as_bool(const std::string &key,
@@ -324,6 +420,81 @@ bool json_term_storage_t::static_optarg_as_bool(const std::string &key,
 
 }
 
+std::string json_term_storage_t::static_optarg_as_string(
+        const std::string &key, const std::string &default_value) const {
+    r_sanity_check(query_json.IsArray());
+    if (query_json.Size() < 3) {
+        return default_value;
+    }
+
+    const rapidjson::Value *_global_optargs = &query_json[2];
+    r_sanity_check(_global_optargs->IsObject());
+
+    const auto it = _global_optargs->FindMember(key.c_str());
+    if (it == _global_optargs->MemberEnd()) {
+        return default_value;
+    } else if (it->value.IsString()) {
+        return std::string(it->value.GetString(), it->value.GetStringLength());
+    } else if (!it->value.IsArray() ||
+               it->value.Size() != 2 ||
+               !it->value[0].IsNumber() ||
+               static_cast<Term::TermType>(it->value[0].GetInt()) != Term::DATUM) {
+        return default_value;
+    } else if (!it->value[1].IsString()) {
+        return default_value;
+    }
+    return std::string(it->value[1].GetString(), it->value[1].GetStringLength());
+}
+
+int64_t json_term_storage_t::static_optarg_as_int(const std::string &key,
+                                                  int64_t default_value) const {
+    r_sanity_check(query_json.IsArray());
+    if (query_json.Size() < 3) {
+        return default_value;
+    }
+
+    const rapidjson::Value *_global_optargs = &query_json[2];
+    r_sanity_check(_global_optargs->IsObject());
+
+    const auto it = _global_optargs->FindMember(key.c_str());
+    if (it == _global_optargs->MemberEnd()) {
+        return default_value;
+    } else if (it->value.IsInt64()) {
+        return it->value.GetInt64();
+    } else if (!it->value.IsArray() ||
+               it->value.Size() != 2 ||
+               !it->value[0].IsNumber() ||
+               static_cast<Term::TermType>(it->value[0].GetInt()) != Term::DATUM) {
+        return default_value;
+    } else if (!it->value[1].IsInt64()) {
+        return default_value;
+    }
+    return it->value[1].GetInt64();
+}
+
+void json_term_storage_t::execute_params(int64_t *prepared_token_out,
+                                         std::vector<datum_t> *args_out) const {
+    r_sanity_check(query_json.IsArray());
+    if (query_json.Size() < 2
+        || !query_json[1].IsArray()
+        || query_json[1].Size() != 2
+        || !query_json[1][0].IsInt64()
+        || !query_json[1][1].IsArray()) {
+        throw bt_exc_t(Response::CLIENT_ERROR, Response::QUERY_LOGIC,
+                       "Expected an EXECUTE query to hold the token of a prepared "
+                       "query and an array of arguments.",
+                       backtrace_registry_t::EMPTY_BACKTRACE);
+    }
+    *prepared_token_out = query_json[1][0].GetInt64();
+    const rapidjson::Value &args = query_json[1][1];
+    args_out->clear();
+    args_out->reserve(args.Size());
+    for (rapidjson::SizeType i = 0; i < args.Size(); ++i) {
+        args_out->push_back(to_datum(args[i], configured_limits_t::unlimited,
+                                     reql_version_t::LATEST, original_data.get()));
+    }
+}
+
 global_optargs_t json_term_storage_t::global_optargs() {
     auto &allocator = query_json.GetAllocator();
     rapidjson::Value *src;
@@ -357,7 +528,8 @@ global_optargs_t json_term_storage_t::global_optargs() {
     // This must be done last, because adding the 'db' optarg may cause reallocation
     for (auto it = src->MemberBegin(); it != src->MemberEnd(); ++it) {
         preprocess_global_optarg(&it->value, &allocator);
-        res.add_optarg(raw_term_t(&it->value), it->name.GetString());
+        res.add_optarg(raw_term_t(&it->value, original_data.get()),
+                       it->name.GetString());
     }
 
     return res;
@@ -554,7 +726,13 @@ MUST_USE archive_result_t deserialize_term_tree<cluster_version_t::v2_4>(
 }
 
 template <>
-MUST_USE archive_result_t deserialize_term_tree<cluster_version_t::v2_5_is_latest>(
+MUST_USE archive_result_t deserialize_term_tree<cluster_version_t::v2_5>(
+        read_stream_t *s, scoped_ptr_t<term_storage_t> *term_storage_out) {
+    return deserialize_term_tree<cluster_version_t::v2_2>(s, term_storage_out);
+}
+
+template <>
+MUST_USE archive_result_t deserialize_term_tree<cluster_version_t::v2_6_is_latest>(
         read_stream_t *s, scoped_ptr_t<term_storage_t> *term_storage_out) {
     return deserialize_term_tree<cluster_version_t::v2_2>(s, term_storage_out);
 }
@@ -11,6 +11,7 @@
 
 #include "containers/counted.hpp"
 #include "containers/scoped.hpp"
+#include "containers/shared_buffer.hpp"
 #include "rapidjson/document.h"
 #include "rapidjson/rapidjson.h"
 #include "rdb_protocol/rdb_backtrace.hpp"
@@ -47,6 +48,9 @@ struct generated_term_t : public slow_atomic_countable_t<generated_term_t> {
 class raw_term_t {
 public:
     explicit raw_term_t(const term_variant_t &source);
+    // `insitu_buffer` is the buffer the JSON was parsed in situ from, if the strings
+    // in it may be referenced by datums; see `json_term_storage_t`.
+    raw_term_t(const rapidjson::Value *source, const shared_buf_t *insitu_buffer);
     raw_term_t(const raw_term_t &) = default;
 
     size_t num_args() const;
@@ -61,7 +65,8 @@ public:
                 if (source.optargs != nullptr) {
                     for (auto it = source.optargs->MemberBegin();
                          it != source.optargs->MemberEnd(); ++it) {
-                        cb(raw_term_t(&it->value), it->name.GetString());
+                        cb(raw_term_t(&it->value, source.insitu_buffer),
+                           it->name.GetString());
                     }
                 }
             },
@@ -85,10 +90,11 @@ public:
 
 private:
     raw_term_t();
-    void init_json(const rapidjson::Value *src);
+    void init_json(const rapidjson::Value *src, const shared_buf_t *insitu_buffer);
 
     struct json_data_t {
         const rapidjson::Value *source;
+        const shared_buf_t *insitu_buffer;
         const rapidjson::Value *args;
         const rapidjson::Value *optargs;
         const rapidjson::Value *datum;
@@ -132,26 +138,54 @@ public:
     virtual Query::QueryType query_type() const;
     virtual bool static_optarg_as_bool(const std::string &key,
                                        bool default_value) const;
+    virtual std::string static_optarg_as_string(
+        const std::string &key, const std::string &default_value) const;
+    virtual int64_t static_optarg_as_int(const std::string &key,
+                                         int64_t default_value) const;
     virtual void preprocess();
     virtual global_optargs_t global_optargs();
+    // For EXECUTE queries: the token of the prepared query and its arguments.
+    virtual void execute_params(int64_t *prepared_token_out,
+                                std::vector<datum_t> *args_out) const;
 
 protected:
     backtrace_registry_t bt_reg;
 };
 
+// The query JSON is parsed in situ from `original_data`, and the strings it contains
+// are turned into datums that reference `original_data` rather than copies where
+// possible.  To make that possible, the constructor replaces the opening quote of
+// every string shorter than `INSITU_STRING_MAX_SIZE` with the string's length, which
+// is how a `datum_string_t` starts.
 class json_term_storage_t : public term_storage_t {
 public:
-    json_term_storage_t(scoped_array_t<char> &&_original_data,
+    // Strings of this size and longer have a varint length that's longer than the
+    // one byte of the opening quote.
+    static const size_t INSITU_STRING_MAX_SIZE = 128;
+
+    json_term_storage_t(counted_t<shared_buf_t> &&_original_data,
                         rapidjson::Document &&_query_json);
+    ~json_term_storage_t();
     Query::QueryType query_type() const;
     bool static_optarg_as_bool(const std::string &key,
                                bool default_value) const;
+    std::string static_optarg_as_string(const std::string &key,
+                                        const std::string &default_value) const;
+    int64_t static_optarg_as_int(const std::string &key,
+                                 int64_t default_value) const;
     void preprocess();
     raw_term_t root_term() const;
     global_optargs_t global_optargs();
+    void execute_params(int64_t *prepared_token_out,
+                        std::vector<datum_t> *args_out) const;
 private:
-    scoped_array_t<char> original_data;
+    // Counts the memory of `query_json` as query cache memory.  The strings are in
+    // `original_data`, which counts as datum memory.
+    void update_memory_usage();
+
+    counted_t<shared_buf_t> original_data;
     rapidjson::Document query_json;
+    size_t counted_memory_usage;
 };
 
 class wire_term_storage_t : public term_storage_t {
@@ -239,6 +239,7 @@ bool term_type_is_valid(Term::TermType type) {
     case Term::TABLE:
     case Term::GET:
     case Term::GET_ALL:
+    case Term::SEARCH:
     case Term::EQ:
     case Term::NE:
     case Term::LT:
@@ -336,6 +337,7 @@ bool term_type_is_valid(Term::TermType type) {
     case Term::NOW:
     case Term::IN_TIMEZONE:
     case Term::DURING:
+    case Term::BUCKET:
     case Term::DATE:
     case Term::TIME_OF_DAY:
     case Term::TIMEZONE:
@@ -436,6 +438,7 @@ bool term_is_write_or_meta(Term::TermType type) {
     case Term::TABLE:
     case Term::GET:
     case Term::GET_ALL:
+    case Term::SEARCH:
     case Term::EQ:
     case Term::NE:
     case Term::LT:
@@ -533,6 +536,7 @@ bool term_is_write_or_meta(Term::TermType type) {
     case Term::NOW:
     case Term::IN_TIMEZONE:
     case Term::DURING:
+    case Term::BUCKET:
     case Term::DATE:
     case Term::TIME_OF_DAY:
     case Term::TIMEZONE:
@@ -630,6 +634,7 @@ bool term_forbids_writes(Term::TermType type) {
     case Term::TABLE:
     case Term::GET:
     case Term::GET_ALL:
+    case Term::SEARCH:
     case Term::EQ:
     case Term::NE:
     case Term::LT:
@@ -734,6 +739,7 @@ bool term_forbids_writes(Term::TermType type) {
     case Term::NOW:
     case Term::IN_TIMEZONE:
     case Term::DURING:
+    case Term::BUCKET:
     case Term::DATE:
     case Term::TIME_OF_DAY:
     case Term::TIMEZONE:
@@ -2,16 +2,21 @@
 #include "rdb_protocol/terms/terms.hpp"
 
 #include <map>
+#include <set>
 #include <string>
 
 #include "clustering/administration/admin_op_exc.hpp"
 #include "clustering/administration/auth/permissions.hpp"
 #include "clustering/administration/auth/username.hpp"
 #include "containers/name_string.hpp"
+#include "rdb_protocol/datum_stream/text_search.hpp"
 #include "rdb_protocol/datum_string.hpp"
+#include "rdb_protocol/func.hpp"
 #include "rdb_protocol/op.hpp"
 #include "rdb_protocol/pseudo_geometry.hpp"
+#include "rdb_protocol/table_common.hpp"
 #include "rdb_protocol/terms/writes.hpp"
+#include "rdb_protocol/text_index.hpp"
 
 namespace ql {
 
@@ -948,6 +953,65 @@ private:
     virtual const char *name() const { return "get_all"; }
 };
 
+/* `search` looks up the documents that contain all of the query's words in a text
+index.  Rather than merging the postings of every word, it reads those of the
+longest word, which is the likeliest to be rare, and checks the other words against
+each of those documents. */
+class search_term_t : public op_term_t {
+public:
+    search_term_t(compile_env_t *env, const raw_term_t &term)
+        : op_term_t(env, term, argspec_t(2), optargspec_t({ "index" })) { }
+private:
+    virtual scoped_ptr_t<val_t> eval_impl(
+        scope_env_t *env, args_t *args, eval_flags_t) const {
+        counted_t<table_t> table = args->arg(env, 0)->as_table();
+        const datum_string_t query = args->arg(env, 1)->as_str();
+        scoped_ptr_t<val_t> index = args->optarg(env, "index");
+        rcheck(index.has(), base_exc_t::LOGIC,
+               "`search` requires the `index` optarg.");
+        const std::string index_str = index->as_str().to_std();
+
+        std::set<std::string> words;
+        tokenize_text(query.data(), query.size(), &words);
+        rcheck(!words.empty(), base_exc_t::LOGIC,
+               "The query of `search` has no words.");
+
+        std::map<std::string, std::pair<sindex_config_t, sindex_status_t> >
+            configs_and_statuses;
+        admin_err_t error;
+        if (!env->env->reql_cluster_interface()->sindex_list(
+                table->db, name_string_t::guarantee_valid(table->name.c_str()),
+                env->env->interruptor, &error, &configs_and_statuses)) {
+            REQL_RETHROW(error);
+        }
+        auto it = configs_and_statuses.find(index_str);
+        rcheck(it != configs_and_statuses.end(), base_exc_t::OP_FAILED,
+               error_message_index_not_found(index_str, table->display_name()));
+        const sindex_config_t &config = it->second.first;
+        rcheck(config.kind == sindex_kind_t::TEXT, base_exc_t::LOGIC,
+               strprintf("Index `%s` is not a text index.", index_str.c_str()));
+
+        std::string longest_word;
+        for (const std::string &word : words) {
+            if (word.size() > longest_word.size()) {
+                longest_word = word;
+            }
+        }
+        std::map<datum_t, uint64_t> keys;
+        keys.insert(std::make_pair(datum_t(longest_word), 1));
+        counted_t<datum_stream_t> postings =
+            table->get_all(env->env, datumspec_t(std::move(keys)), index_str,
+                           backtrace());
+
+        return new_val(
+            make_counted<selection_t>(
+                table,
+                make_counted<text_search_datum_stream_t>(
+                    config.func.compile_wire_func(), std::move(words), postings)));
+    }
+    virtual const char *name() const { return "search"; }
+};
+
 counted_t<term_t> make_db_term(
         compile_env_t *env, const raw_term_t &term) {
     return make_counted<db_term_t>(env, term);
@@ -968,6 +1032,11 @@ counted_t<term_t> make_get_all_term(
     return make_counted<get_all_term_t>(env, term);
 }
 
+counted_t<term_t> make_search_term(
+        compile_env_t *env, const raw_term_t &term) {
+    return make_counted<search_term_t>(env, term);
+}
+
 counted_t<term_t> make_db_create_term(
         compile_env_t *env, const raw_term_t &term) {
     return make_counted<db_create_term_t>(env, term);
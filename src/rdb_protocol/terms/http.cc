@@ -30,7 +30,9 @@ public:
                                   "page",
                                   "page_limit",
                                   "auth",
-                                  "result_format" }))
+                                  "result_format",
+                                  "concurrency",
+                                  "cache" }))
     { }
 private:
     virtual const char *name() const { return "http"; }
@@ -89,6 +91,18 @@ private:
                          args_t *args,
                          http_opts_t::http_auth_t *auth_out);
 
+    static uint32_t get_concurrency(scope_env_t *env, args_t *args);
+
+    static void get_cache_ttl_ms(scope_env_t *env,
+                                 args_t *args,
+                                 http_method_t method,
+                                 uint64_t *cache_ttl_ms_out);
+
+    scoped_ptr_t<val_t> eval_batch(scope_env_t *env,
+                                   args_t *args,
+                                   const datum_t &urls,
+                                   http_opts_t &&opts) const;
+
     static void get_page_and_limit(scope_env_t *env,
                                    args_t *args,
                                    counted_t<const func_t> *depaginate_fn_out,
@@ -233,8 +247,15 @@ scoped_ptr_t<val_t> http_term_t::eval_impl(scope_env_t *env, args_t *args,
     http_opts_t opts;
     opts.limits = env->env->limits();
     opts.version = env->env->reql_version();
-    opts.url.assign(args->arg(env, 0)->as_str().to_std());
     opts.proxy.assign(env->env->get_reql_http_proxy());
+
+    // An array of URLs fetches all of them at once, with the same options
+    datum_t url = args->arg(env, 0)->as_datum();
+    if (url.get_type() == datum_t::R_ARRAY) {
+        get_optargs(env, args, &opts);
+        return eval_batch(env, args, url, std::move(opts));
+    }
+    opts.url.assign(url.as_str().to_std());
     get_optargs(env, args, &opts);
 
     counted_t<const func_t> depaginate_fn;
@@ -259,6 +280,61 @@ scoped_ptr_t<val_t> http_term_t::eval_impl(scope_env_t *env, args_t *args,
     return new_val(res.body);
 }
 
+scoped_ptr_t<val_t> http_term_t::eval_batch(scope_env_t *env,
+                                            args_t *args,
+                                            const datum_t &urls,
+                                            http_opts_t &&opts) const {
+    rcheck(!args->optarg(env, "page").has(), base_exc_t::LOGIC,
+           "Cannot use `page` with an ARRAY of URLs.");
+    const uint32_t concurrency = get_concurrency(env, args);
+
+    std::vector<http_opts_t> batch;
+    batch.reserve(urls.arr_size());
+    for (size_t i = 0; i < urls.arr_size(); ++i) {
+        batch.push_back(opts);
+        batch.back().url.assign(urls.get(i).as_str().to_std());
+    }
+
+    std::vector<http_result_t> results;
+    http_runner_t runner(env->env->get_extproc_pool());
+    try {
+        runner.http_batch(batch, concurrency, &results, env->env->interruptor);
+    } catch (const extproc_worker_exc_t &ex) {
+        results.assign(batch.size(), http_result_t());
+        for (http_result_t &res : results) {
+            res.error.assign("crash in a worker process");
+        }
+    } catch (const interrupted_exc_t &ex) {
+        results.assign(batch.size(), http_result_t());
+        for (http_result_t &res : results) {
+            res.error.assign("interrupted");
+        }
+    }
+
+    // Like a single request, we fail on the first request that failed
+    datum_array_builder_t bodies(env->env->limits());
+    for (size_t i = 0; i < results.size(); ++i) {
+        check_error_result(results[i], batch[i], this);
+        bodies.add(results[i].body);
+    }
+    return new_val(std::move(bodies).to_datum());
+}
+
+// The `concurrency` optarg limits how many requests of an ARRAY of URLs are in flight
+// at once.  It must be a positive NUMBER.
+uint32_t http_term_t::get_concurrency(scope_env_t *env, args_t *args) {
+    scoped_ptr_t<val_t> concurrency = args->optarg(env, "concurrency");
+    if (!concurrency.has()) {
+        return HTTP_DEFAULT_CONCURRENCY;
+    }
+    int64_t value = concurrency->as_int<int64_t>();
+    if (value < 1 || value > HTTP_MAX_CONCURRENCY) {
+        rfail_target(concurrency.get(), base_exc_t::LOGIC,
+                     "`concurrency` must be between 1 and %d.", HTTP_MAX_CONCURRENCY);
+    }
+    return static_cast<uint32_t>(value);
+}
+
 std::vector<datum_t>
 http_datum_stream_t::next_page(env_t *env) {
     profile::sampler_t sampler(strprintf("Performing HTTP %s of `%s`",
@@ -449,6 +525,47 @@ void http_term_t::get_optargs(scope_env_t *env,
     get_attempts(env, args, &opts_out->attempts);
     get_redirects(env, args, &opts_out->max_redirects);
     get_bool_optarg("verify", env, args, &opts_out->verify);
+    get_cache_ttl_ms(env, args, opts_out->method, &opts_out->cache_ttl_ms);
+}
+
+// The `cache` optarg lets the server answer the request with a response it got for
+// the same request recently.  It must be an OBJECT with a `ttl` field, the number
+// of seconds to keep the response for.  Only GET and HEAD requests may be cached.
+void http_term_t::get_cache_ttl_ms(scope_env_t *env,
+                                   args_t *args,
+                                   http_method_t method,
+                                   uint64_t *cache_ttl_ms_out) {
+    scoped_ptr_t<val_t> cache = args->optarg(env, "cache");
+    if (!cache.has()) {
+        return;
+    }
+    if (method != http_method_t::GET && method != http_method_t::HEAD) {
+        rfail_target(cache.get(), base_exc_t::LOGIC,
+                     "`cache` may only be used with GET and HEAD requests.");
+    }
+    datum_t datum_cache = cache->as_datum();
+    if (datum_cache.get_type() != datum_t::R_OBJECT) {
+        rfail_target(cache.get(), base_exc_t::LOGIC,
+                     "Expected `cache` to be an OBJECT, but found %s.",
+                     datum_cache.get_type_name().c_str());
+    }
+    for (size_t i = 0; i < datum_cache.obj_size(); ++i) {
+        auto pair = datum_cache.get_pair(i);
+        if (pair.first != "ttl") {
+            rfail_target(cache.get(), base_exc_t::LOGIC,
+                         "Unrecognized field `cache.%s`.", pair.first.to_std().c_str());
+        }
+    }
+    datum_t ttl = datum_cache.get_field("ttl", NOTHROW);
+    if (!ttl.has() || ttl.get_type() != datum_t::R_NUM) {
+        rfail_target(cache.get(), base_exc_t::LOGIC,
+                     "Expected `cache.ttl` to be a NUMBER.");
+    }
+    double ttl_ms = ttl.as_num() * 1000;
+    if (!(ttl_ms > 0)) {
+        rfail_target(cache.get(), base_exc_t::LOGIC, "`cache.ttl` must be positive.");
+    }
+    *cache_ttl_ms_out = std::max<uint64_t>(clamp<double>(ttl_ms, 0, MAX_TIMEOUT_MS), 1);
 }
 
 // The `timeout` optarg specifies the number of seconds to wait before erroring
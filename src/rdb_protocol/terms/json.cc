@@ -1,6 +1,7 @@
 // Copyright 2010-2015 RethinkDB, all rights reserved.
+#include "arch/runtime/cpu_task.hpp"
 #include "cjson/json.hpp"
-#include "rdb_protocol/datum_json.hpp"
+#include "rdb_protocol/datum_json_parser.hpp"
 #include "rdb_protocol/op.hpp"
 #include "rdb_protocol/term.hpp"
 #include "rdb_protocol/terms/terms.hpp"
@@ -11,6 +12,10 @@
 #include "rapidjson/writer.h"
 
 namespace ql {
+
+// Parsing a document this big takes long enough to be worth a thread hop.
+const size_t CPU_TASK_MIN_JSON_SIZE = 64 * KILOBYTE;
+
 class json_term_t : public op_term_t {
 public:
     json_term_t(compile_env_t *env, const raw_term_t &term)
@@ -30,30 +35,32 @@ public:
             return new_val(to_datum(cjson.get(), env->env->limits(),
                                     env->env->reql_version()));
         } else {
-            // Copy the string into a null-terminated c-string that we can write
-            // to, so we can use RapidJSON in-situ parsing (and at least avoid
-            // some additional copying).
-            std::vector<char> str_buf(data.size() + 1);
-            memcpy(str_buf.data(), data.data(), data.size());
-            for (size_t i = 0; i < data.size(); ++i) {
-                rcheck(str_buf[i] != '\0', base_exc_t::LOGIC,
-                       "Encountered unescaped null byte in JSON string.");
-            }
-            str_buf[data.size()] = '\0';
+            rcheck(memchr(data.data(), '\0', data.size()) == nullptr,
+                   base_exc_t::LOGIC,
+                   "Encountered unescaped null byte in JSON string.");
 
-            rapidjson::Document json;
-            // Note: Insitu will cause some parts of `json` to directly point into
-            // `str_buf`. `str_buf`'s life time must be at least as long as `json`'s.
-            json.ParseInsitu(str_buf.data());
+            // The parser reads `data` in place.
+            scoped_ptr_t<datum_json_parser_t> parser;
+            if (data.size() >= CPU_TASK_MIN_JSON_SIZE) {
+                // Finding the structure of the document only involves `data` and
+                // `parser`, so for big documents it can happen on a less busy thread.
+                run_cpu_task([&]() {
+                    parser.init(new datum_json_parser_t(data.data(), data.size()));
+                });
+            } else {
+                parser.init(new datum_json_parser_t(data.data(), data.size()));
+            }
 
-            rcheck(!json.HasParseError(), base_exc_t::LOGIC,
+            datum_t res;
+            const rapidjson::ParseErrorCode error =
+                parser->to_datum(env->env->limits(), &res);
+            rcheck(error == rapidjson::kParseErrorNone, base_exc_t::LOGIC,
                    strprintf("Failed to parse \"%s\" as JSON: %s",
                        (data.size() > 40
                         ? (data.to_std().substr(0, 37) + "...").c_str()
                         : data.to_std().c_str()),
-                       rapidjson::GetParseError_En(json.GetParseError())));
-            return new_val(to_datum(json, env->env->limits(),
-                                    env->env->reql_version()));
+                       rapidjson::GetParseError_En(error)));
+            return new_val(res);
         }
     }
 
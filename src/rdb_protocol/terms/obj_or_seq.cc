@@ -348,11 +348,17 @@ private:
 
 counted_t<term_t> make_get_field_term(
         compile_env_t *env, const raw_term_t &term) {
+    if (can_push_down_projection(term)) {
+        return make_projection_pushdown_term(env, term);
+    }
     return make_counted<get_field_term_t>(env, term);
 }
 
 counted_t<term_t> make_bracket_term(
         compile_env_t *env, const raw_term_t &term) {
+    if (can_push_down_projection(term)) {
+        return make_projection_pushdown_term(env, term);
+    }
     return make_counted<bracket_term_t>(env, term);
 }
 
@@ -363,11 +369,17 @@ counted_t<term_t> make_has_fields_term(
 
 counted_t<term_t> make_pluck_term(
         compile_env_t *env, const raw_term_t &term) {
+    if (can_push_down_projection(term)) {
+        return make_projection_pushdown_term(env, term);
+    }
     return make_counted<pluck_term_t>(env, term);
 }
 
 counted_t<term_t> make_without_term(
         compile_env_t *env, const raw_term_t &term) {
+    if (can_push_down_projection(term)) {
+        return make_projection_pushdown_term(env, term);
+    }
     return make_counted<without_term_t>(env, term);
 }
 
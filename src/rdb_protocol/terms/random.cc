@@ -33,6 +33,24 @@ public:
         counted_t<datum_stream_t> seq;
         scoped_ptr_t<val_t> v = args->arg(env, 0);
 
+        /* A whole table is sampled by the shards, which find random rows without
+        reading the others. */
+        if (v->get_type().get_raw_type() == val_t::type_t::TABLE) {
+            t = v->as_table();
+            std::vector<datum_t> rows;
+            bool sampled;
+            {
+                profile::sampler_t sampler("Sampling table.", env->env->trace);
+                sampled = t->sample(env->env, num, &rows);
+            }
+            if (sampled) {
+                counted_t<datum_stream_t> new_ds(
+                    new array_datum_stream_t(
+                        datum_t(std::move(rows), env->env->limits()), backtrace()));
+                return new_val(make_counted<selection_t>(t, new_ds));
+            }
+        }
+
         if (v->get_type().is_convertible(val_t::type_t::SELECTION)) {
             counted_t<selection_t> t_seq = v->as_selection(env->env);
             t = t_seq->table;
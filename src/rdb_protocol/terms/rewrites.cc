@@ -1,7 +1,10 @@
 // Copyright 2010-2015 RethinkDB, all rights reserved.
 #include "rdb_protocol/terms/terms.hpp"
 
+#include <algorithm>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "rdb_protocol/error.hpp"
 #include "rdb_protocol/minidriver.hpp"
@@ -230,6 +233,136 @@ private:
     virtual const char *name() const { return "with_fields"; }
 };
 
+/* An `order_by` without an index reads the whole sequence onto the parsing node before it
+sorts it, so a projection after it only runs once the full rows have crossed the
+network.  When the `order_by` only sorts by top-level fields, we also project the rows
+before the `order_by`, keeping the sort fields, so that the projection is shipped to the
+shards with the rest of the read:
+    seq.order_by('a').pluck('b')  =>  seq.pluck('b', 'a').order_by('a').pluck('b')
+    seq.order_by('a')('b')        =>  seq.pluck('b', 'a').order_by('a')('b')
+    seq.order_by('a').without('b')  =>  seq.without('b').order_by('a').without('b') */
+bool constant_string_args(const raw_term_t &term, size_t start,
+                          std::vector<datum_string_t> *out) {
+    for (size_t i = start; i < term.num_args(); ++i) {
+        raw_term_t arg = term.arg(i);
+        if (arg.type() != Term::DATUM) {
+            return false;
+        }
+        datum_t d = arg.datum();
+        if (d.get_type() != datum_t::R_STR) {
+            return false;
+        }
+        out->push_back(d.as_str());
+    }
+    return true;
+}
+
+bool order_by_fields(const raw_term_t &order_by, std::vector<datum_string_t> *out) {
+    if (order_by.type() != Term::ORDER_BY
+        || order_by.num_args() < 2
+        || order_by.num_optargs() != 0) {
+        return false;
+    }
+    // Don't push a projection below one we've already pushed down.
+    const Term::TermType source_type = order_by.arg(0).type();
+    if (source_type == Term::PLUCK || source_type == Term::WITHOUT) {
+        return false;
+    }
+    for (size_t i = 1; i < order_by.num_args(); ++i) {
+        raw_term_t arg = order_by.arg(i);
+        if (arg.type() == Term::ASC || arg.type() == Term::DESC) {
+            if (arg.num_args() != 1 || arg.num_optargs() != 0) {
+                return false;
+            }
+            arg = arg.arg(0);
+        }
+        if (arg.type() != Term::DATUM) {
+            return false;
+        }
+        datum_t d = arg.datum();
+        if (d.get_type() != datum_t::R_STR) {
+            return false;
+        }
+        out->push_back(d.as_str());
+    }
+    return true;
+}
+
+// Returns the projection to apply below the `order_by`, or `false` if there is none.
+bool pushed_down_projection(const raw_term_t &in,
+                            Term::TermType *type_out,
+                            std::vector<datum_string_t> *fields_out) {
+    if (in.num_args() < 2 || in.num_optargs() != 0) {
+        return false;
+    }
+    std::vector<datum_string_t> sort_fields;
+    std::vector<datum_string_t> fields;
+    if (!order_by_fields(in.arg(0), &sort_fields)
+        || !constant_string_args(in, 1, &fields)) {
+        return false;
+    }
+    switch (in.type()) {
+    case Term::PLUCK: // fallthru
+    case Term::GET_FIELD: // fallthru
+    case Term::BRACKET:
+        *type_out = Term::PLUCK;
+        *fields_out = std::move(fields);
+        fields_out->insert(fields_out->end(), sort_fields.begin(), sort_fields.end());
+        return true;
+    case Term::WITHOUT:
+        *type_out = Term::WITHOUT;
+        for (const datum_string_t &field : fields) {
+            if (std::find(sort_fields.begin(), sort_fields.end(), field)
+                == sort_fields.end()) {
+                fields_out->push_back(field);
+            }
+        }
+        return !fields_out->empty();
+    default:
+        return false;
+    }
+}
+
+class projection_pushdown_term_t : public rewrite_term_t {
+public:
+    projection_pushdown_term_t(compile_env_t *env, const raw_term_t &term)
+        : rewrite_term_t(env, term, argspec_t(2, -1), rewrite) { }
+private:
+    static minidriver_t::reql_t rewrite(const raw_term_t &in) {
+        minidriver_t r(in.bt());
+        raw_term_t order_by = in.arg(0);
+
+        Term::TermType projection_type;
+        std::vector<datum_string_t> fields;
+        guarantee(pushed_down_projection(in, &projection_type, &fields));
+        minidriver_t::reql_t projection =
+            r.expr(order_by.arg(0)).call(projection_type);
+        for (const datum_string_t &field : fields) {
+            projection.add_arg(datum_t(field));
+        }
+        minidriver_t::reql_t sorted = projection.call(Term::ORDER_BY);
+        sorted.copy_args_from_term(order_by, 1);
+        minidriver_t::reql_t term = sorted.call(in.type());
+        term.copy_args_from_term(in, 1);
+        return term;
+    }
+    virtual const char *name() const {
+        switch (get_src().type()) {
+        case Term::PLUCK: return "pluck";
+        case Term::WITHOUT: return "without";
+        case Term::GET_FIELD: return "get_field";
+        case Term::BRACKET: return "bracket";
+        default: unreachable();
+        }
+    }
+};
+
+bool can_push_down_projection(const raw_term_t &term) {
+    Term::TermType type;
+    std::vector<datum_string_t> fields;
+    return pushed_down_projection(term, &type, &fields);
+}
+
 counted_t<term_t> make_skip_term(
         compile_env_t *env, const raw_term_t &term) {
     return make_counted<skip_term_t>(env, term);
@@ -258,5 +391,9 @@ counted_t<term_t> make_with_fields_term(
         compile_env_t *env, const raw_term_t &term) {
     return make_counted<with_fields_term_t>(env, term);
 }
+counted_t<term_t> make_projection_pushdown_term(
+        compile_env_t *env, const raw_term_t &term) {
+    return make_counted<projection_pushdown_term_t>(env, term);
+}
 
 } // namespace ql
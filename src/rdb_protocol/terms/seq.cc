@@ -1,10 +1,12 @@
 // Copyright 2010-2015 RethinkDB, all rights reserved.
 #include "rdb_protocol/terms/terms.hpp"
 
+#include <map>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "clustering/administration/admin_op_exc.hpp"
 #include "parsing/utf8.hpp"
 #include "rdb_protocol/datum_stream/eq_join.hpp"
 #include "rdb_protocol/datum_stream/fold.hpp"
@@ -18,6 +20,8 @@
 #include "rdb_protocol/math_utils.hpp"
 #include "rdb_protocol/op.hpp"
 #include "rdb_protocol/order_util.hpp"
+#include "rdb_protocol/profile.hpp"
+#include "rdb_protocol/protocol.hpp"
 
 namespace ql {
 
@@ -204,7 +208,15 @@ private:
                              (args->num_args() == 2 ? " was" : "s were")));
         }
 
-        if (args->num_args() == 2) {
+        // A `map` over an eager stream runs on this thread, so if the function
+        // doesn't care which thread it runs on we let `map_datum_stream_t` spread
+        // it over all of them.
+        const bool evaluate_in_parallel = args->num_args() == 2
+            && dynamic_cast<eager_datum_stream_t *>(streams.front().get()) != nullptr
+            && !streams.front()->is_grouped()
+            && streams.front()->cfeed_type() == feed_type_t::not_feed
+            && func->is_deterministic().test(single_server_t::yes, constant_now_t::yes);
+        if (args->num_args() == 2 && !evaluate_in_parallel) {
             streams.front()->add_transformation(
                     map_wire_func_t(std::move(func)), backtrace());
             return new_val(env->env, streams.front());
@@ -223,7 +235,7 @@ public:
         : grouped_seq_op_term_t(env,
                                 term,
                                 argspec_t(3),
-                                optargspec_t({"index", "ordered"})) { }
+                                optargspec_t({"index", "ordered", "strategy"})) { }
 
     virtual const char *name() const { return "eqjoin"; }
 private:
@@ -243,6 +255,17 @@ private:
         if (maybe_ordered.has()) {
             ordered = maybe_ordered->as_bool();
         }
+        eq_join_strategy_t strategy = eq_join_strategy_t::LOOKUP;
+        if (scoped_ptr_t<val_t> v = args->optarg(env, "strategy")) {
+            const std::string strategy_str = v->as_str().to_std();
+            if (strategy_str == "scan") {
+                strategy = eq_join_strategy_t::SCAN;
+            } else {
+                rcheck_target(v, strategy_str == "lookup", base_exc_t::LOGIC,
+                              strprintf("`strategy` must be `lookup` or `scan` "
+                                        "(got `%s`).", strategy_str.c_str()));
+            }
+        }
         datum_t key;
         scoped_ptr_t<val_t> maybe_key = args->optarg(env, "index");
         if (maybe_key.has()) {
@@ -256,6 +279,7 @@ private:
                                                  key.as_str(),
                                                  predicate_function,
                                                  ordered,
+                                                 strategy,
                                                  backtrace());
 
         return new_val(env->env, eq_join_stream);
@@ -302,7 +326,7 @@ private:
                     acc_args.push_back(std::move(result));
                     acc_args.push_back(std::move(row));
 
-                    result = acc_func->call(env->env, acc_args)->as_datum();
+                    result = acc_func->call_datum(env->env, acc_args);
 
                     r_sanity_check(result.has());
                     acc_args.clear();
@@ -314,7 +338,7 @@ private:
                 std::vector<datum_t> final_args{std::move(result)};
 
                 counted_t<const func_t> final_emit_func = final_emit_arg->as_func();
-                final_result = final_emit_func->call(env->env, final_args)->as_datum();
+                final_result = final_emit_func->call_datum(env->env, final_args);
                 r_sanity_check(final_result.has());
                 return new_val(final_result);
             } else {
@@ -415,6 +439,94 @@ private:
     virtual const char *name() const { return "group"; }
 };
 
+/* A `filter` on a whole table with an equality predicate, like `table.filter({a: 1})`
+or `table.filter(r.row('a').eq(1))`, reads its candidate rows with `get_all` on an index
+of that field instead of scanning the table.  The filter still runs on the rows that
+`get_all` returns, so the index only has to produce a superset of the matching rows. */
+bool is_filter_index_key(const datum_t &value, bool primary) {
+    switch (value.get_type()) {
+    case datum_t::R_BOOL: // fallthru
+    case datum_t::R_NUM:
+        return true;
+    case datum_t::R_STR:
+        // `get_all` rejects primary keys that are too long, where `filter` would just
+        // find nothing.  Secondary keys are truncated instead.
+        return !primary
+            || value.as_str().size() + 1 <= rdb_protocol::MAX_PRIMARY_KEY_SIZE;
+    default:
+        // Objects and pseudotypes are matched field by field by `filter`, and arrays
+        // can't be compared with a single index key.
+        return false;
+    }
+}
+
+std::vector<std::pair<datum_string_t, datum_t> > filter_equalities(
+        const scoped_ptr_t<val_t> &predicate, const counted_t<const func_t> &f) {
+    std::vector<std::pair<datum_string_t, datum_t> > res;
+    if (predicate->get_type().get_raw_type() == val_t::type_t::DATUM) {
+        datum_t d = predicate->as_datum();
+        if (d.get_type() == datum_t::R_OBJECT && !d.is_ptype()) {
+            for (size_t i = 0; i < d.obj_size(); ++i) {
+                res.push_back(d.get_pair(i));
+            }
+        }
+    } else if (auto equality = f->field_equality()) {
+        res.push_back(std::move(*equality));
+    }
+    return res;
+}
+
+/* Prefers the primary key, since it matches at most one row, and otherwise takes the
+first field with a usable index.  Outdated and unfinished indexes are never used, and
+neither are multi or geo indexes, whose keys don't correspond to equality. */
+optional<std::string> choose_filter_index(
+        env_t *env,
+        const counted_t<table_t> &table,
+        const std::vector<std::pair<datum_string_t, datum_t> > &equalities,
+        datum_t *key_out) {
+    if (equalities.empty()) {
+        return r_nullopt;
+    }
+    const datum_string_t pkey(table->get_pkey());
+    for (const auto &equality : equalities) {
+        if (equality.first == pkey && is_filter_index_key(equality.second, true)) {
+            *key_out = equality.second;
+            return make_optional(table->get_pkey());
+        }
+    }
+
+    std::map<std::string, std::pair<sindex_config_t, sindex_status_t> >
+        configs_and_statuses;
+    admin_err_t error;
+    if (!env->reql_cluster_interface()->sindex_list(
+            table->db, name_string_t::guarantee_valid(table->name.c_str()),
+            env->interruptor, &error, &configs_and_statuses)) {
+        // Just scan the table then; if the table is really gone, the scan will say so.
+        return r_nullopt;
+    }
+    for (const auto &equality : equalities) {
+        if (!is_filter_index_key(equality.second, false)) {
+            continue;
+        }
+        for (const auto &pair : configs_and_statuses) {
+            const sindex_config_t &config = pair.second.first;
+            const sindex_status_t &status = pair.second.second;
+            if (!status.ready || status.outdated
+                || config.multi != sindex_multi_bool_t::SINGLE
+                || config.kind == sindex_kind_t::GEO) {
+                continue;
+            }
+            optional<datum_string_t> field =
+                config.func.compile_wire_func()->selected_field();
+            if (field.has_value() && *field == equality.first) {
+                *key_out = equality.second;
+                return make_optional(pair.first);
+            }
+        }
+    }
+    return r_nullopt;
+}
+
 class filter_term_t : public grouped_seq_op_term_t {
 public:
     filter_term_t(compile_env_t *env, const raw_term_t &term)
@@ -432,6 +544,25 @@ private:
             defval.set(wire_func_t(default_filter_term->eval_to_func(env->scope)));
         }
 
+        if (v0->get_type().get_raw_type() == val_t::type_t::TABLE
+            && !defval.has_value()) {
+            counted_t<table_t> table = v0->as_table();
+            datum_t key;
+            optional<std::string> index = choose_filter_index(
+                env->env, table, filter_equalities(v1, f), &key);
+            if (index.has_value()) {
+                profile::starter_t starter(
+                    strprintf("Filter rows read from index `%s`.", index->c_str()),
+                    env->env->trace);
+                std::map<datum_t, uint64_t> keys;
+                keys.insert(std::make_pair(key, 1));
+                counted_t<datum_stream_t> stream = table->get_all(
+                    env->env, datumspec_t(std::move(keys)), *index, backtrace());
+                stream->add_transformation(filter_wire_func_t(f, defval), backtrace());
+                return new_val(make_counted<selection_t>(table, stream));
+            }
+        }
+
         if (v0->get_type().is_convertible(val_t::type_t::SELECTION)) {
             counted_t<selection_t> ts = v0->as_selection(env->env);
             ts->seq->add_transformation(filter_wire_func_t(f, defval), backtrace());
@@ -535,11 +666,14 @@ public:
         : op_term_t(
             env, term, argspec_t(1),
             optargspec_t({"squash",
+                          "changefeed_queue_overflow",
                           "changefeed_queue_size",
                           "include_initial",
                           "include_offsets",
                           "include_states",
-                          "include_types"})) { }
+                          "include_tokens",
+                          "include_types",
+                          "since"})) { }
 private:
     virtual scoped_ptr_t<val_t> eval_impl(
         scope_env_t *env, args_t *args, eval_flags_t) const {
@@ -576,6 +710,53 @@ private:
             include_offsets = v->as_bool();
         }
 
+        bool include_tokens = false;
+        if (scoped_ptr_t<val_t> v = args->optarg(env, "include_tokens")) {
+            include_tokens = v->as_bool();
+        }
+
+        // `since` is a token from a change emitted with `include_tokens`.
+        optional<std::map<uuid_u, uint64_t> > since;
+        if (scoped_ptr_t<val_t> v = args->optarg(env, "since")) {
+            rcheck_target(v, !include_initial, base_exc_t::LOGIC,
+                          "Cannot use `since` with `include_initial`.");
+            datum_t token = v->as_datum();
+            rcheck_target(v, token.get_type() == datum_t::R_OBJECT, base_exc_t::LOGIC,
+                          strprintf("Expected `since` to be an OBJECT but found %s.",
+                                    token.get_type_name().c_str()));
+            since.set(std::map<uuid_u, uint64_t>());
+            for (size_t i = 0; i < token.obj_size(); ++i) {
+                auto pair = token.get_pair(i);
+                uuid_u server_uuid;
+                rcheck_target(v, str_to_uuid(pair.first.to_std(), &server_uuid),
+                              base_exc_t::LOGIC,
+                              strprintf("Invalid token passed to `since`:\n%s",
+                                        token.print().c_str()));
+                rcheck_target(v, pair.second.get_type() == datum_t::R_NUM
+                                  && pair.second.as_num() >= 0.0,
+                              base_exc_t::LOGIC,
+                              strprintf("Invalid token passed to `since`:\n%s",
+                                        token.print().c_str()));
+                (*since)[server_uuid] = pair.second.as_int();
+            }
+        }
+
+        changefeed::queue_overflow_t queue_overflow = changefeed::queue_overflow_t::CLEAR;
+        if (scoped_ptr_t<val_t> v = args->optarg(env, "changefeed_queue_overflow")) {
+            if (v->as_str() == "clear") {
+                queue_overflow = changefeed::queue_overflow_t::CLEAR;
+            } else if (v->as_str() == "squash") {
+                queue_overflow = changefeed::queue_overflow_t::SQUASH;
+            } else if (v->as_str() == "drop_oldest") {
+                queue_overflow = changefeed::queue_overflow_t::DROP_OLDEST;
+            } else {
+                rfail_target(v, base_exc_t::LOGIC,
+                             "Unknown changefeed queue overflow policy: '%s', must be "
+                             "one of 'clear', 'squash', or 'drop_oldest'",
+                             v->as_str().to_std().c_str());
+            }
+        }
+
         scoped_ptr_t<val_t> v = args->arg(env, 0);
         configured_limits_t limits = env->env->limits_with_changefeed_queue_size(
                 args->optarg(env, "changefeed_queue_size"));
@@ -603,6 +784,9 @@ private:
                             include_types,
                             limits,
                             squash,
+                            include_tokens,
+                            since,
+                            queue_overflow,
                             std::move(changespec.keyspec.spec)),
                         backtrace()));
             }
@@ -637,6 +821,9 @@ private:
                         include_types,
                         limits,
                         squash,
+                        include_tokens,
+                        since,
+                        queue_overflow,
                         sel->get_spec()),
                     sel->get_bt()));
         }
@@ -26,7 +26,7 @@ datum_string_t sindex_config_to_string(const sindex_config_t &config) {
     version.original_reql_version = config.func_version;
     version.latest_compatible_reql_version = config.func_version;
     version.latest_checked_reql_version = reql_version_t::LATEST;
-    sindex_disk_info_t disk_info(config.func, version, config.multi, config.geo);
+    sindex_disk_info_t disk_info(config.func, version, config.multi, config.kind);
 
     write_message_t wm;
     serialize_sindex_info(&wm, disk_info);
@@ -87,7 +87,7 @@ sindex_config_t sindex_config_from_string(
         sindex_info.mapping,
         sindex_info.mapping_version_info.original_reql_version,
         sindex_info.multi,
-        sindex_info.geo);
+        sindex_info.kind);
 }
 
 // Helper for `sindex_status_to_datum()`
@@ -108,7 +108,7 @@ std::string format_index_create_query(
         }
         ret += "multi: true";
     }
-    if (config.geo == sindex_geo_bool_t::GEO) {
+    if (config.kind == sindex_kind_t::GEO) {
         if (first_optarg) {
             ret += ", {";
             first_optarg = false;
@@ -117,6 +117,24 @@ std::string format_index_create_query(
         }
         ret += "geo: true";
     }
+    if (config.kind == sindex_kind_t::HASH) {
+        if (first_optarg) {
+            ret += ", {";
+            first_optarg = false;
+        } else {
+            ret += ", ";
+        }
+        ret += "type: 'hash'";
+    }
+    if (config.kind == sindex_kind_t::TEXT) {
+        if (first_optarg) {
+            ret += ", {";
+            first_optarg = false;
+        } else {
+            ret += ", ";
+        }
+        ret += "type: 'text'";
+    }
     if (!first_optarg) {
         ret += "}";
     }
@@ -143,7 +161,11 @@ ql::datum_t sindex_status_to_datum(
     stat.overwrite("multi",
         ql::datum_t::boolean(config.multi == sindex_multi_bool_t::MULTI));
     stat.overwrite("geo",
-        ql::datum_t::boolean(config.geo == sindex_geo_bool_t::GEO));
+        ql::datum_t::boolean(config.kind == sindex_kind_t::GEO));
+    stat.overwrite("hash",
+        ql::datum_t::boolean(config.kind == sindex_kind_t::HASH));
+    stat.overwrite("text",
+        ql::datum_t::boolean(config.kind == sindex_kind_t::TEXT));
     stat.overwrite("function",
         ql::datum_t::binary(sindex_config_to_string(config)));
     stat.overwrite("query",
@@ -154,7 +176,7 @@ ql::datum_t sindex_status_to_datum(
 class sindex_create_term_t : public op_term_t {
 public:
     sindex_create_term_t(compile_env_t *env, const raw_term_t &term)
-        : op_term_t(env, term, argspec_t(2, 3), optargspec_t({"multi", "geo"})) { }
+        : op_term_t(env, term, argspec_t(2, 3), optargspec_t({"multi", "geo", "type", "where"})) { }
 
     virtual scoped_ptr_t<val_t> eval_impl(
         scope_env_t *env, args_t *args, eval_flags_t) const {
@@ -169,7 +191,8 @@ public:
         /* Parse the sindex configuration */
         sindex_config_t config;
         config.multi = sindex_multi_bool_t::SINGLE;
-        config.geo = sindex_geo_bool_t::REGULAR;
+        config.kind = sindex_kind_t::REGULAR;
+        bool got_blob = false;
         if (args->num_args() == 3) {
             scoped_ptr_t<val_t> v = args->arg(env, 2);
             bool got_func = false;
@@ -182,6 +205,7 @@ public:
                     // to do some conversions for compatibility.
                     config.func_version = reql_version_t::LATEST;
                     got_func = true;
+                    got_blob = true;
                 }
             }
             // We do it this way so that if someone passes a string, we produce
@@ -203,6 +227,36 @@ public:
             config.func_version = reql_version_t::LATEST;
         }
 
+        /* A partial index only has entries for the rows that match `where`.  We fold
+        the predicate into the index function, which raises an error for the other
+        rows, and rows whose index function fails aren't indexed.  The combined
+        function no longer selects a single field, so `filter` never mistakes a
+        partial index for one that covers the whole table. */
+        if (optional<raw_term_t> where_term = get_src().optarg("where")) {
+            rcheck(!got_blob,
+                   base_exc_t::LOGIC,
+                   "Cannot use `where` with a function returned from `index_status`, "
+                   "which already contains the index's predicate.");
+            // Check that it's a function now, rather than skipping every row later.
+            args->optarg(env, "where")->as_func();
+
+            minidriver_t r(backtrace());
+            auto x = minidriver_t::dummy_var_t::SINDEXCREATE_X;
+            minidriver_t::reql_t mapping = args->num_args() == 3
+                ? r.expr(get_src().arg(2))(r.var(x))
+                : r.var(x)[name_datum];
+            compile_env_t compile_env(env->scope.compute_visibility());
+            counted_t<func_term_t> func_term_term =
+                make_counted<func_term_t>(
+                    &compile_env,
+                    r.fun(x, r.branch(r.expr(*where_term)(r.var(x)),
+                                      mapping,
+                                      r.error(std::string(
+                                          "Row excluded by the index's `where` "
+                                          "predicate.")))).root_term());
+            config.func = ql::map_wire_func_t(func_term_term->eval_to_func(env->scope));
+        }
+
         config.func.compile_wire_func()->assert_deterministic(
                 constant_now_t::no,
                 "Index functions must be deterministic.");
@@ -215,9 +269,30 @@ public:
         }
         /* Do we want to create a geo index? */
         if (scoped_ptr_t<val_t> geo_val = args->optarg(env, "geo")) {
-            config.geo = geo_val->as_bool()
-                ? sindex_geo_bool_t::GEO
-                : sindex_geo_bool_t::REGULAR;
+            config.kind = geo_val->as_bool()
+                ? sindex_kind_t::GEO
+                : sindex_kind_t::REGULAR;
+        }
+        /* A hash index only supports `get_all`, but its keys don't grow with the
+        indexed values.  A text index maps every word of the indexed text to the
+        documents it's in, for `search`. */
+        if (scoped_ptr_t<val_t> type_val = args->optarg(env, "type")) {
+            const datum_string_t type = type_val->as_str();
+            rcheck(type == "hash" || type == "text",
+                   base_exc_t::LOGIC,
+                   strprintf("Unrecognized index type `%s` (the index types are "
+                             "`hash` and `text`).", type.to_std().c_str()));
+            rcheck(config.kind != sindex_kind_t::GEO,
+                   base_exc_t::LOGIC,
+                   strprintf("A geospatial index can't be a %s index.",
+                             type.to_std().c_str()));
+            if (type == "hash") {
+                config.kind = sindex_kind_t::HASH;
+            } else {
+                // Every word gets its own index entry, as in a multi index.
+                config.kind = sindex_kind_t::TEXT;
+                config.multi = sindex_multi_bool_t::MULTI;
+            }
         }
 
         try {
@@ -1,12 +1,16 @@
 // Copyright 2010-2015 RethinkDB, all rights reserved.
 #include "rdb_protocol/terms/terms.hpp"
 
+#include <algorithm>
 #include <string>
+#include <unordered_set>
 #include <utility>
 
 #include "rdb_protocol/datum_stream.hpp"
 #include "rdb_protocol/datum_stream/array.hpp"
+#include "rdb_protocol/datum_stream/external_sort.hpp"
 #include "rdb_protocol/datum_stream/indexed_sort.hpp"
+#include "rdb_protocol/datum_utils.hpp"
 #include "rdb_protocol/error.hpp"
 #include "rdb_protocol/func.hpp"
 #include "rdb_protocol/minidriver.hpp"
@@ -51,7 +55,7 @@ public:
     orderby_term_t(compile_env_t *env, const raw_term_t &term)
         : op_term_t(env, term, argspec_t(1, -1),
           optargspec_t({"index"})) { }
-private:
+protected:
     virtual scoped_ptr_t<val_t>
     eval_impl(scope_env_t *env, args_t *args, eval_flags_t) const {
         std::vector<std::pair<order_direction_t, counted_t<const func_t> > > comparisons
@@ -106,6 +110,11 @@ private:
             rcheck(!comparisons.empty(), base_exc_t::LOGIC,
                    "Must specify something to order by.");
             std::vector<datum_t> to_sort;
+            // Once there are more rows than fit in an array, they're sorted in runs
+            // that are written to disk and merged afterwards.
+            counted_t<external_sort_datum_stream_t> spilled;
+            const bool can_spill = external_sort_datum_stream_t::can_spill(env->env);
+            const size_t run_size = env->env->limits().array_size_limit();
             batchspec_t batchspec = batchspec_t::user(batch_type_t::TERMINAL, env->env);
             for (;;) {
                 std::vector<datum_t> data
@@ -114,14 +123,31 @@ private:
                     break;
                 }
                 std::move(data.begin(), data.end(), std::back_inserter(to_sort));
-                rcheck_array_size(to_sort, env->env->limits());
+                if (can_spill && to_sort.size() > run_size) {
+                    if (!spilled.has()) {
+                        spilled = make_counted<external_sort_datum_stream_t>(
+                            lt_cmp, backtrace());
+                    }
+                    profile::sampler_t sampler("Sorting in-memory.", env->env->trace);
+                    lt_cmp.sort(env->env, &sampler, &to_sort);
+                    spilled->push_run(env->env, std::move(to_sort));
+                    to_sort.clear();
+                } else {
+                    rcheck_array_size(to_sort, env->env->limits());
+                }
             }
             profile::sampler_t sampler("Sorting in-memory.", env->env->trace);
-            auto fn = std::bind(lt_cmp, env->env, &sampler, ph::_1, ph::_2);
-            std::stable_sort(to_sort.begin(), to_sort.end(), fn);
-            seq = make_counted<array_datum_stream_t>(
-                datum_t(std::move(to_sort), env->env->limits()),
-                backtrace());
+            lt_cmp.sort(env->env, &sampler, &to_sort);
+            if (spilled.has()) {
+                if (!to_sort.empty()) {
+                    spilled->push_run(env->env, std::move(to_sort));
+                }
+                seq = spilled;
+            } else {
+                seq = make_counted<array_datum_stream_t>(
+                    datum_t(std::move(to_sort), env->env->limits()),
+                    backtrace());
+            }
         }
         return tbl_slice.has()
             ? new_val(make_counted<selection_t>(tbl_slice->get_tbl(), seq))
@@ -131,6 +157,86 @@ private:
     virtual const char *name() const { return "orderby"; }
 };
 
+/* `orderby_limit_term_t` is an unindexed `order_by` followed by a `limit`.  Instead of
+sorting the whole sequence, it runs a `top_k_wire_func_t` terminal on it, so that each
+shard only sends its first `k` rows and nothing ever holds more than `k` rows per
+shard.  The term is compiled from the `limit`'s `order_by` argument, so that errors
+about the sort still point at the `order_by`. */
+class orderby_limit_term_t : public orderby_term_t {
+public:
+    orderby_limit_term_t(compile_env_t *env, const raw_term_t &term)
+        : orderby_term_t(env, term.arg(0)),
+          limit_bt(term.bt()),
+          limit_arg(compile_term(env, term.arg(1))) { }
+private:
+    virtual void accumulate_captures(var_captures_t *captures) const {
+        orderby_term_t::accumulate_captures(captures);
+        limit_arg->accumulate_captures(captures);
+    }
+    virtual deterministic_t is_deterministic() const {
+        return orderby_term_t::is_deterministic().join(limit_arg->is_deterministic());
+    }
+
+    virtual scoped_ptr_t<val_t>
+    eval_impl(scope_env_t *env, args_t *args, eval_flags_t flags) const {
+        const int32_t k = limit_arg->eval(env)->as_int<int32_t>();
+        rcheck_src(limit_bt, k >= 0, base_exc_t::LOGIC,
+                   strprintf("LIMIT takes a non-negative argument (got %d)", k));
+        // The shards return up to `k` rows per group in an array, so past the array
+        // size limit we have to sort everything.
+        if (static_cast<size_t>(k) > env->env->limits().array_size_limit()
+            || args->optarg(env, "index").has()) {
+            return limit(env, orderby_term_t::eval_impl(env, args, flags), k);
+        }
+
+        std::vector<std::pair<order_direction_t, counted_t<const func_t> > > comparisons
+            = build_comparisons_from_raw_term(this, env, args, get_src());
+        counted_t<table_t> tbl;
+        counted_t<datum_stream_t> seq;
+        scoped_ptr_t<val_t> v0 = args->arg(env, 0);
+        if (v0->get_type().is_convertible(val_t::type_t::TABLE_SLICE)) {
+            counted_t<table_slice_t> tbl_slice = v0->as_table_slice();
+            tbl = tbl_slice->get_tbl();
+            seq = tbl_slice->as_seq(env->env, backtrace());
+        } else if (v0->get_type().is_convertible(val_t::type_t::SELECTION)) {
+            auto selection = v0->as_selection(env->env);
+            tbl = selection->table;
+            seq = selection->seq;
+        } else {
+            seq = v0->as_seq(env->env);
+        }
+        rcheck(!comparisons.empty(), base_exc_t::LOGIC,
+               "Must specify something to order by.");
+
+        datum_t top_k = seq->run_terminal(
+            env->env, top_k_wire_func_t(k, comparisons, backtrace()))->as_datum();
+        seq = make_counted<array_datum_stream_t>(std::move(top_k), backtrace());
+        return tbl.has()
+            ? new_val(make_counted<selection_t>(tbl, seq))
+            : new_val(env->env, seq);
+    }
+
+    // What `limit_term_t` does with the sorted sequence.
+    scoped_ptr_t<val_t> limit(scope_env_t *env, scoped_ptr_t<val_t> v, int32_t k) const {
+        counted_t<table_t> t;
+        counted_t<datum_stream_t> ds;
+        if (v->get_type().is_convertible(val_t::type_t::SELECTION)) {
+            auto selection = v->as_selection(env->env);
+            t = selection->table;
+            ds = selection->seq;
+        } else {
+            ds = v->as_seq(env->env);
+        }
+        counted_t<datum_stream_t> new_ds = ds->slice(0, k);
+        return t.has()
+            ? new_val(make_counted<selection_t>(t, new_ds))
+            : new_val(env->env, new_ds);
+    }
+
+    const backtrace_id_t limit_bt;
+    counted_t<const term_t> limit_arg;
+};
+
 class distinct_term_t : public op_term_t {
 public:
     distinct_term_t(compile_env_t *env, const raw_term_t &term)
@@ -166,9 +272,9 @@ private:
         rcheck(!idx, base_exc_t::LOGIC,
                "Can only perform an indexed distinct on a TABLE.");
         counted_t<datum_stream_t> s = v->as_seq(env->env);
-        // The reql_version matters here, because we copy `results` into `toret`
-        // in ascending order.
-        std::set<datum_t, optional_datum_less_t> results;
+        // Duplicates are dropped by hash as they come in, which is cheaper than
+        // keeping them sorted, and only the distinct elements get sorted at the end.
+        std::unordered_set<datum_t, datum_hash_t> results;
         batchspec_t batchspec = batchspec_t::user(batch_type_t::TERMINAL, env->env);
         {
             profile::sampler_t sampler("Evaluating elements in distinct.",
@@ -181,7 +287,12 @@ private:
             }
         }
         std::vector<datum_t> toret;
+        toret.reserve(results.size());
         std::move(results.begin(), results.end(), std::back_inserter(toret));
+        {
+            profile::sampler_t sampler("Sorting distinct elements.", env->env->trace);
+            std::sort(toret.begin(), toret.end(), optional_datum_less_t());
+        }
         return new_val(datum_t(std::move(toret), env->env->limits()));
     }
 
@@ -192,6 +303,19 @@ counted_t<term_t> make_orderby_term(
         compile_env_t *env, const raw_term_t &term) {
     return make_counted<orderby_term_t>(env, term);
 }
+bool can_fuse_orderby_limit(const raw_term_t &term) {
+    if (term.type() != Term::LIMIT || term.num_args() != 2 || term.num_optargs() != 0) {
+        return false;
+    }
+    raw_term_t orderby = term.arg(0);
+    return orderby.type() == Term::ORDER_BY
+        && orderby.num_args() >= 2
+        && !orderby.optarg("index").has_value();
+}
+counted_t<term_t> make_orderby_limit_term(
+        compile_env_t *env, const raw_term_t &term) {
+    return make_counted<orderby_limit_term_t>(env, term);
+}
 counted_t<term_t> make_distinct_term(
         compile_env_t *env, const raw_term_t &term) {
     return make_counted<distinct_term_t>(env, term);
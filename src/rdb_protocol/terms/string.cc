@@ -4,11 +4,21 @@
 #include <re2/re2.h>
 
 #include <algorithm>
+#include <array>
+#include <memory>
 
+#include "arch/runtime/runtime.hpp"
+#include "concurrency/cache_line_padded.hpp"
+#include "containers/lru_cache.hpp"
 #include "parsing/utf8.hpp"
+#include "perfmon/perfmon.hpp"
 #include "rdb_protocol/error.hpp"
 #include "rdb_protocol/op.hpp"
 
+/* How many compiled regexes each thread keeps for `match`.  The least recently used
+ones are thrown away to make room for new ones. */
+#define REGEX_CACHE_ENTRIES_PER_THREAD 1000
+
 namespace ql {
 
 // Closed interval ranges of combining chars.
@@ -55,6 +65,40 @@ static bool is_whitespace_character(char32_t c) {
     return is_in_a_range(whitespace_ranges, whitespace_ranges + n, c);
 }
 
+// Only ever accessed on its own thread.  Queries on the same thread share the
+// compiled regexes, so a pattern that many queries use is only compiled once.
+struct thread_regex_cache_t {
+    thread_regex_cache_t() : regexes(REGEX_CACHE_ENTRIES_PER_THREAD) { }
+    lru_cache_t<std::string, std::shared_ptr<re2::RE2> > regexes;
+};
+
+static std::array<cache_line_padded_t<thread_regex_cache_t>, MAX_THREADS> regex_caches;
+
+static perfmon_collection_t pm_regex_cache_collection;
+static perfmon_membership_t pm_regex_cache_membership(
+    &get_global_perfmon_collection(), &pm_regex_cache_collection, "regex_cache");
+static perfmon_counter_t pm_regex_cache_hits, pm_regex_cache_misses;
+static perfmon_multi_membership_t pm_regex_cache_values_membership(
+    &pm_regex_cache_collection,
+    &pm_regex_cache_hits, "hits",
+    &pm_regex_cache_misses, "misses");
+
+// Patterns that don't compile are cached too, so that the caller can report the
+// error without compiling them again.
+static std::shared_ptr<re2::RE2> get_compiled_regex(const std::string &pattern) {
+    lru_cache_t<std::string, std::shared_ptr<re2::RE2> > *regexes =
+        &regex_caches[get_thread_id().threadnum].value.regexes;
+    std::shared_ptr<re2::RE2> *found;
+    if (regexes->lookup(pattern, &found)) {
+        ++pm_regex_cache_hits;
+        return *found;
+    }
+    ++pm_regex_cache_misses;
+    auto regexp = std::make_shared<re2::RE2>(pattern, re2::RE2::Quiet);
+    regexes->insert(pattern, regexp);
+    return regexp;
+}
+
 class match_term_t : public op_term_t {
 public:
     match_term_t(compile_env_t *env, const raw_term_t &term)
@@ -63,23 +107,15 @@ private:
     virtual scoped_ptr_t<val_t> eval_impl(scope_env_t *env, args_t *args, eval_flags_t) const {
         std::string str = args->arg(env, 0)->as_str().to_std();
         std::string re = args->arg(env, 1)->as_str().to_std();
-        std::shared_ptr<re2::RE2> regexp;
-        regex_cache_t &cache = env->env->regex_cache();
-        std::shared_ptr<re2::RE2> *found;
-        if (!cache.regexes.lookup(re, &found)) {
-            regexp.reset(new re2::RE2(re, re2::RE2::Quiet));
-            if (!regexp->ok()) {
-                rfail(base_exc_t::LOGIC,
-                      "Error in regexp `%s` (portion `%s`): %s",
-                      regexp->pattern().c_str(),
-                      regexp->error_arg().c_str(),
-                      regexp->error().c_str());
-            }
-            cache.regexes.insert(re, regexp);
-        } else {
-            regexp = *found;
-        }
+        std::shared_ptr<re2::RE2> regexp = get_compiled_regex(re);
         r_sanity_check(static_cast<bool>(regexp));
+        if (!regexp->ok()) {
+            rfail(base_exc_t::LOGIC,
+                  "Error in regexp `%s` (portion `%s`): %s",
+                  regexp->pattern().c_str(),
+                  regexp->error_arg().c_str(),
+                  regexp->error().c_str());
+        }
         // We add 1 to account for $0.
         int ngroups = regexp->NumberOfCapturingGroups() + 1;
         scoped_array_t<re2::StringPiece> groups(ngroups);
@@ -105,6 +105,8 @@ counted_t<term_t> make_get_term(
     compile_env_t *env, const raw_term_t &term);
 counted_t<term_t> make_get_all_term(
     compile_env_t *env, const raw_term_t &term);
+counted_t<term_t> make_search_term(
+    compile_env_t *env, const raw_term_t &term);
 counted_t<term_t> make_db_create_term(
     compile_env_t *env, const raw_term_t &term);
 counted_t<term_t> make_db_drop_term(
@@ -241,6 +243,11 @@ counted_t<term_t> make_difference_term(
     compile_env_t *env, const raw_term_t &term);
 counted_t<term_t> make_with_fields_term(
     compile_env_t *env, const raw_term_t &term);
+// Whether `term` is a projection after an `order_by` that `make_projection_pushdown_term`
+// can also apply before the `order_by`.
+bool can_push_down_projection(const raw_term_t &term);
+counted_t<term_t> make_projection_pushdown_term(
+    compile_env_t *env, const raw_term_t &term);
 
 // seq.cc
 counted_t<term_t> make_minval_term(
@@ -305,6 +312,11 @@ counted_t<term_t> make_sindex_rename_term(
 // sort.cc
 counted_t<term_t> make_orderby_term(
     compile_env_t *env, const raw_term_t &term);
+// Whether `term` is a `limit` of an unindexed `order_by` that
+// `make_orderby_limit_term` can evaluate without sorting the whole sequence.
+bool can_fuse_orderby_limit(const raw_term_t &term);
+counted_t<term_t> make_orderby_limit_term(
+    compile_env_t *env, const raw_term_t &term);
 counted_t<term_t> make_distinct_term(
     compile_env_t *env, const raw_term_t &term);
 counted_t<term_t> make_asc_term(
@@ -327,6 +339,8 @@ counted_t<term_t> make_in_timezone_term(
     compile_env_t *env, const raw_term_t &term);
 counted_t<term_t> make_during_term(
     compile_env_t *env, const raw_term_t &term);
+counted_t<term_t> make_bucket_term(
+    compile_env_t *env, const raw_term_t &term);
 counted_t<term_t> make_date_term(
     compile_env_t *env, const raw_term_t &term);
 counted_t<term_t> make_time_of_day_term(
@@ -109,6 +109,34 @@ private:
     virtual const char *name() const { return "during"; }
 };
 
+class bucket_term_t : public op_term_t {
+public:
+    bucket_term_t(compile_env_t *env, const raw_term_t &term)
+        : op_term_t(env, term, argspec_t(2)) { }
+private:
+    scoped_ptr_t<val_t> eval_impl(scope_env_t *env, args_t *args, eval_flags_t) const {
+        scoped_ptr_t<val_t> v = args->arg(env, 0);
+        scoped_ptr_t<val_t> interval_val = args->arg(env, 1);
+        const double interval = interval_val->as_num();
+        datum_t d = v->as_datum();
+        if (d.is_ptype(pseudo::time_string)) {
+            // Times are bucketed by whole milliseconds, which is all they keep.
+            const double interval_ms = round(interval * 1000);
+            rcheck_target(interval_val.get(), interval_ms >= 1
+                          && interval_ms <= static_cast<double>(INT64_MAX / 2),
+                          base_exc_t::LOGIC,
+                          strprintf("Cannot bucket times by an interval of %s "
+                                    "seconds.", interval_val->print().c_str()));
+            return new_val(pseudo::time_bucket(d, static_cast<int64_t>(interval_ms)));
+        }
+        rcheck_target(interval_val.get(), interval > 0, base_exc_t::LOGIC,
+                      strprintf("Cannot bucket numbers by an interval of %s.",
+                                interval_val->print().c_str()));
+        return new_val(datum_t(floor(v->as_num() / interval) * interval));
+    }
+    virtual const char *name() const { return "bucket"; }
+};
+
 class date_term_t : public op_term_t {
 public:
     date_term_t(compile_env_t *env, const raw_term_t &term)
@@ -246,6 +274,11 @@ counted_t<term_t> make_during_term(
     return make_counted<during_term_t>(env, term);
 }
 
+counted_t<term_t> make_bucket_term(
+        compile_env_t *env, const raw_term_t &term) {
+    return make_counted<bucket_term_t>(env, term);
+}
+
 counted_t<term_t> make_date_term(
         compile_env_t *env, const raw_term_t &term) {
     return make_counted<date_term_t>(env, term);
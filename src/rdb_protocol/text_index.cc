@@ -0,0 +1,65 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "rdb_protocol/text_index.hpp"
+
+#include <vector>
+
+#include "rdb_protocol/configured_limits.hpp"
+#include "rdb_protocol/error.hpp"
+
+namespace ql {
+
+static bool is_word_byte(unsigned char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')
+        || c >= 0x80;
+}
+
+void tokenize_text(const char *text, size_t size, std::set<std::string> *words_out) {
+    size_t i = 0;
+    while (i < size) {
+        if (!is_word_byte(text[i])) {
+            ++i;
+            continue;
+        }
+        std::string word;
+        for (; i < size && is_word_byte(text[i]); ++i) {
+            if (word.size() < TEXT_INDEX_MAX_WORD_LENGTH) {
+                const char c = text[i];
+                word.push_back(c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c);
+            }
+        }
+        words_out->insert(std::move(word));
+    }
+}
+
+static void add_words(const datum_t &str, std::set<std::string> *words_out) {
+    rcheck_datum(str.get_type() == datum_t::R_STR,
+                 base_exc_t::LOGIC,
+                 strprintf("A text index can only index strings and arrays of "
+                           "strings, not a value of type %s.",
+                           str.get_type_name().c_str()));
+    tokenize_text(str.as_str().data(), str.as_str().size(), words_out);
+}
+
+std::set<std::string> text_index_words(const datum_t &value) {
+    std::set<std::string> words;
+    if (value.get_type() == datum_t::R_ARRAY) {
+        for (size_t i = 0; i < value.arr_size(); ++i) {
+            add_words(value.get(i), &words);
+        }
+    } else {
+        add_words(value, &words);
+    }
+    return words;
+}
+
+datum_t text_index_value_to_words(const datum_t &value) {
+    std::set<std::string> words = text_index_words(value);
+    std::vector<datum_t> array;
+    array.reserve(words.size());
+    for (const std::string &word : words) {
+        array.push_back(datum_t(word));
+    }
+    return datum_t(std::move(array), configured_limits_t::unlimited);
+}
+
+}  // namespace ql
@@ -0,0 +1,31 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#ifndef RDB_PROTOCOL_TEXT_INDEX_HPP_
+#define RDB_PROTOCOL_TEXT_INDEX_HPP_
+
+#include <set>
+#include <string>
+
+#include "rdb_protocol/datum.hpp"
+
+/* Words longer than this are cut off, so that a single huge word can't make an index
+key too long.  Queries get cut off the same way, so they still match. */
+#define TEXT_INDEX_MAX_WORD_LENGTH 64
+
+namespace ql {
+
+/* Splits `text` into the words that a text index stores.  A word is a run of ASCII
+letters and digits, or bytes of multibyte UTF-8 characters, and ASCII letters are
+lowercased. */
+void tokenize_text(const char *text, size_t size, std::set<std::string> *words_out);
+
+/* The words of a text index's value, which is a string or an array of strings.
+Throws if it's anything else. */
+std::set<std::string> text_index_words(const datum_t &value);
+
+/* A text index is a multi index on its value's words, so it's computed as one on
+this array. */
+datum_t text_index_value_to_words(const datum_t &value);
+
+}  // namespace ql
+
+#endif  // RDB_PROTOCOL_TEXT_INDEX_HPP_
@@ -551,6 +551,10 @@ datum_t table_t::get_nearest(
         limits);
 }
 
+bool table_t::sample(env_t *env, uint64_t num, std::vector<datum_t> *rows_out) {
+    return tbl->read_sample(env, num, read_mode, rows_out);
+}
+
 val_t::type_t::type_t(val_t::type_t::raw_type_t _raw_type) : raw_type(_raw_type) { }
 
 // NOTE: This *MUST* be kept in sync with the surrounding code (not that it
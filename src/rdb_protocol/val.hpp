@@ -56,6 +56,9 @@ public:
             const std::string &new_sindex_id,
             const configured_limits_t &limits);
 
+    // Returns false if the table can't be sampled without reading all of it.
+    MUST_USE bool sample(env_t *env, uint64_t num, std::vector<datum_t> *rows_out);
+
     scoped_ptr_t<reader_t> get_all_with_sindexes(
         env_t *env,
         const datumspec_t &datumspec,
@@ -243,9 +243,15 @@ archive_result_t deserialize<cluster_version_t::v2_4>(
 }
 
 template <>
-archive_result_t deserialize<cluster_version_t::v2_5_is_latest>(
+archive_result_t deserialize<cluster_version_t::v2_5>(
         read_stream_t *s, wire_func_t *wf) {
-    return deserialize_wire_func<cluster_version_t::v2_5_is_latest>(s, wf);
+    return deserialize_wire_func<cluster_version_t::v2_5>(s, wf);
+}
+
+template <>
+archive_result_t deserialize<cluster_version_t::v2_6_is_latest>(
+        read_stream_t *s, wire_func_t *wf) {
+    return deserialize_wire_func<cluster_version_t::v2_6_is_latest>(s, wf);
 }
 
 template <cluster_version_t W>
@@ -324,4 +330,30 @@ RDB_IMPL_SERIALIZABLE_2_SINCE_v1_13(filter_wire_func_t, filter_func, default_fil
 
 RDB_MAKE_SERIALIZABLE_1_FOR_CLUSTER(distinct_wire_func_t, use_index);
 
+top_k_wire_func_t::top_k_wire_func_t(
+        uint64_t _k,
+        const std::vector<std::pair<order_direction_t, counted_t<const func_t> > >
+            &_comparisons,
+        backtrace_id_t _bt)
+    : k(_k), bt(_bt) {
+    comparisons.reserve(_comparisons.size());
+    for (const auto &pair : _comparisons) {
+        comparisons.push_back(std::make_pair(pair.first, wire_func_t(pair.second)));
+    }
+}
+
+std::vector<std::pair<order_direction_t, counted_t<const func_t> > >
+top_k_wire_func_t::compile_comparisons() const {
+    std::vector<std::pair<order_direction_t, counted_t<const func_t> > > ret;
+    ret.reserve(comparisons.size());
+    for (const auto &pair : comparisons) {
+        ret.push_back(std::make_pair(pair.first, pair.second.compile_wire_func()));
+    }
+    return ret;
+}
+
+ARCHIVE_PRIM_MAKE_RANGED_SERIALIZABLE(order_direction_t, int8_t, ASC, DESC);
+
+RDB_MAKE_SERIALIZABLE_3_FOR_CLUSTER(top_k_wire_func_t, k, comparisons, bt);
+
 }  // namespace ql
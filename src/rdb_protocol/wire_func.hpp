@@ -2,10 +2,12 @@
 #ifndef RDB_PROTOCOL_WIRE_FUNC_HPP_
 #define RDB_PROTOCOL_WIRE_FUNC_HPP_
 
+#include <utility>
 #include <vector>
 
 #include "containers/counted.hpp"
 #include "containers/optional.hpp"
+#include "rdb_protocol/order_util.hpp"
 #include "rdb_protocol/sym.hpp"
 #include "rdb_protocol/error.hpp"
 #include "rpc/serialize_macros.hpp"
@@ -141,6 +143,27 @@ public:
 };
 RDB_DECLARE_SERIALIZABLE_FOR_CLUSTER(distinct_wire_func_t);
 
+/* The first `k` rows of a stream in the order given by `comparisons`, the way
+`order_by(...).limit(k)` would return them.  Each shard only keeps its own first `k`
+rows, so an unindexed `order_by` followed by a `limit` doesn't have to sort (or even
+hold) the whole table. */
+class top_k_wire_func_t {
+public:
+    top_k_wire_func_t() : k(0), bt(backtrace_id_t::empty()) { }
+    top_k_wire_func_t(
+        uint64_t _k,
+        const std::vector<std::pair<order_direction_t, counted_t<const func_t> > >
+            &_comparisons,
+        backtrace_id_t _bt);
+    std::vector<std::pair<order_direction_t, counted_t<const func_t> > >
+    compile_comparisons() const;
+
+    uint64_t k;
+    std::vector<std::pair<order_direction_t, wire_func_t> > comparisons;
+    backtrace_id_t bt;
+};
+RDB_DECLARE_SERIALIZABLE_FOR_CLUSTER(top_k_wire_func_t);
+
 template <class T>
 class skip_terminal_t;
 
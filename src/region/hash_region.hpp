@@ -18,6 +18,7 @@ struct store_key_t;
 
 // Returns a value in [0, HASH_REGION_HASH_SIZE).
 const uint64_t HASH_REGION_HASH_SIZE = 1ULL << 63;
+uint64_t hash_region_hasher(const uint8_t *s, ssize_t len);
 uint64_t hash_region_hasher(const btree_key_t *key);
 uint64_t hash_region_hasher(const store_key_t &key);
 
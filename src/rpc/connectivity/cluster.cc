@@ -29,15 +29,19 @@
 #define MESSAGE_HANDLER_MAX_BATCH_SIZE           16
 
 // The cluster communication protocol version.
-static_assert(cluster_version_t::CLUSTER == cluster_version_t::v2_5_is_latest,
+static_assert(cluster_version_t::CLUSTER == cluster_version_t::v2_6_is_latest,
               "We need to update CLUSTER_VERSION_STRING when we add a new cluster "
               "version.");
 
-#define CLUSTER_VERSION_STRING "2.5.0"
+#define CLUSTER_VERSION_STRING "2.6.0"
 
 const std::string connectivity_cluster_t::cluster_proto_header("RethinkDB cluster\n");
 const std::string connectivity_cluster_t::cluster_version_string(CLUSTER_VERSION_STRING);
 
+// The codec we offer other servers during the handshake.
+static const cluster_compression_t supported_cluster_compression =
+    cluster_compression_t::zlib;
+
 // Returns true and sets *out to the version number, if the version number in
 // version_string is a recognized version and the same or earlier than our version.
 static bool version_number_recognized_compatible(const std::string &version_string,
@@ -133,7 +137,8 @@ connectivity_cluster_t::connection_t::connection_t(
         const peer_id_t &_peer_id,
         const server_id_t &_server_id,
         keepalive_tcp_conn_stream_t *_conn,
-        const peer_address_t &_peer_address) THROWS_NOTHING :
+        const peer_address_t &_peer_address,
+        cluster_compression_t compression) THROWS_NOTHING :
     conn(_conn),
     peer_address(_peer_address),
     flusher([&](signal_t *) {
@@ -145,13 +150,24 @@ connectivity_cluster_t::connection_t::connection_t(
         // must be handled elsewhere.
         this->conn->flush_buffer();
     }, 1),
+    compressor(compression == cluster_compression_t::zlib
+        ? new cluster_compressor_t() : nullptr),
     pm_collection(),
     pm_bytes_sent(secs_to_ticks(1), true),
+    pm_bytes_sent_total(),
     pm_collection_membership(
         &_parent->parent->connectivity_collection,
         &pm_collection,
         uuid_to_str(_peer_id.get_uuid())),
     pm_bytes_sent_membership(&pm_collection, &pm_bytes_sent, "bytes_sent"),
+    pm_bytes_sent_total_membership(
+        &pm_collection, &pm_bytes_sent_total, "bytes_sent_total"),
+    pm_bytes_before_compression_membership(
+        &pm_collection, &pm_bytes_before_compression, "bytes_before_compression"),
+    pm_compressed_bytes_membership(
+        &pm_collection, &pm_compressed_bytes, "compressed_bytes"),
+    pm_compression_usecs_membership(
+        &pm_collection, &pm_compression_usecs, "compression_usecs"),
     parent(_parent),
     peer_id(_peer_id),
     server_id(_server_id),
@@ -257,7 +273,8 @@ connectivity_cluster_t::run_t::run_t(
     `connection_map` on each thread and notifying any listeners that we're now
     connected to ourself. The destructor will remove us from the
     `connection_map` and again notify any listeners. */
-    connection_to_ourself(this, parent->me, _server_id, nullptr, routing_table[parent->me]),
+    connection_to_ourself(this, parent->me, _server_id, nullptr, routing_table[parent->me],
+        cluster_compression_t::none),
 
     heartbeat_sl_view(_heartbeat_sl_view),
     auth_sl_view(_auth_sl_view),
@@ -857,6 +874,18 @@ void fail_handshake(keepalive_tcp_conn_stream_t *conn,
 // - warning: invalid header
 // - error: id or address don't match expected id or address; deserialization range error; unknown error
 // In all cases we close the connection and quit.
+cluster_message_handler_t *connectivity_cluster_t::run_t::get_message_handler(
+        message_tag_t tag, cluster_version_t resolved_version) {
+    cluster_message_handler_t *handler = parent->message_handlers[tag];
+    guarantee(handler != nullptr, "Got a message for an unfamiliar tag. "
+        "Apparently we aren't compatible with the cluster on the other end.");
+
+    /* If you really want to support old cluster versions, the resolved_version should
+    be passed into the on_message() handler. */
+    guarantee(resolved_version == cluster_version_t::CLUSTER);
+    return handler;
+}
+
 join_result_t connectivity_cluster_t::run_t::handle(
         /* `conn` should remain valid until `handle()` returns.
          * `handle()` does not take ownership of `conn`. */
@@ -1096,6 +1125,27 @@ join_result_t connectivity_cluster_t::run_t::handle(
         }
     }
 
+    // Servers from 2.6.0 on exchange the codecs they support once both sides have
+    // accepted each other's version, since earlier servers wouldn't expect it. The
+    // connection is compressed if the other server supports the same codec as we do.
+    cluster_compression_t compression = cluster_compression_t::none;
+    if (resolved_version >= cluster_version_t::v2_6) {
+        write_message_t wm;
+        serialize_universal(&wm, static_cast<uint8_t>(supported_cluster_compression));
+        if (send_write_message(conn, &wm)) {
+            return join_result_t::TEMPORARY_ERROR; // network error.
+        }
+
+        uint8_t remote_compression;
+        if (deserialize_universal_and_check(conn, &remote_compression, peername)) {
+            return join_result_t::TEMPORARY_ERROR;
+        }
+
+        if (remote_compression == static_cast<uint8_t>(supported_cluster_compression)) {
+            compression = supported_cluster_compression;
+        }
+    }
+
     // Look up the ip addresses for the other host
     object_buffer_t<peer_address_t> other_peer_addr;
 
@@ -1317,7 +1367,13 @@ join_result_t connectivity_cluster_t::run_t::handle(
         constructor registers it in the `connectivity_cluster_t`'s connection
         map. */
         connection_t conn_structure(
-            this, other_id, remote_server_id, conn, *other_peer_addr.get());
+            this, other_id, remote_server_id, conn, *other_peer_addr.get(),
+            compression);
+
+        /* Decompresses the messages the other server compressed, if any. */
+        scoped_ptr_t<cluster_decompressor_t> decompressor(
+            compression == cluster_compression_t::zlib
+                ? new cluster_decompressor_t() : nullptr);
 
         /* `heartbeat_manager` will periodically send a heartbeat message to
         other servers, and it will also close the connection if we don't
@@ -1340,17 +1396,41 @@ join_result_t connectivity_cluster_t::run_t::handle(
 
                 /* Ignore messages tagged with the heartbeat tag. The
                 `keepalive_tcp_conn_stream_t` will have already notified the
-                `heartbeat_manager_t` as soon as the heartbeat arrived. */
-                if (tag != heartbeat_tag) {
-                    cluster_message_handler_t *handler = parent->message_handlers[tag];
-                    guarantee(handler != nullptr, "Got a message for an unfamiliar tag. "
-                        "Apparently we aren't compatible with the cluster on the other "
-                        "end.");
-
-                    /* If you really want to support old cluster versions, the
-                    resolved_version should be passed into the on_message() handler. */
-                    guarantee(resolved_version == cluster_version_t::CLUSTER);
-                    handler->on_message(
+                `heartbeat_manager_t` as soon as the heartbeat arrived. Compressed
+                messages are decompressed into memory and handed to the handler for
+                the tag they were sent with. */
+                if (tag == compressed_tag) {
+                    if (!decompressor.has()) { throw fake_archive_exc_t(); }
+                    uint64_t message_size, compressed_size;
+                    if (bad(deserialize_universal(conn, &tag))
+                            || bad(deserialize_universal(conn, &message_size))
+                            || bad(deserialize_universal(conn, &compressed_size))) {
+                        throw fake_archive_exc_t();
+                    }
+                    if (!cluster_decompressor_t::sizes_are_valid(
+                            compressed_size, message_size)) {
+                        throw fake_archive_exc_t();
+                    }
+                    std::vector<char> compressed(compressed_size);
+                    int64_t res = force_read(conn, compressed.data(), compressed_size);
+                    if (res != static_cast<int64_t>(compressed_size)) {
+                        throw fake_archive_exc_t();
+                    }
+                    std::vector<char> message;
+                    kiloticks_t start = get_kiloticks();
+                    if (!decompressor->decompress(compressed.data(), compressed_size,
+                                                  message_size, &message)) {
+                        throw fake_archive_exc_t();
+                    }
+                    conn_structure.pm_compression_usecs +=
+                        get_kiloticks().micros - start.micros;
+                    vector_read_stream_t message_stream(std::move(message));
+                    get_message_handler(tag, resolved_version)->on_message(
+                        &conn_structure,
+                        auto_drainer_t::lock_t(conn_structure.drainers.get()),
+                        &message_stream); // might raise fake_archive_exc_t
+                } else if (tag != heartbeat_tag) {
+                    get_message_handler(tag, resolved_version)->on_message(
                         &conn_structure,
                         auto_drainer_t::lock_t(conn_structure.drainers.get()),
                         conn); // might raise fake_archive_exc_t
@@ -1535,6 +1615,28 @@ void connectivity_cluster_t::send_message(connection_t *connection,
             optimization in this case. */
             mutex_t::acq_t acq(&connection->send_mutex, true);
 
+            /* Compress the message if the connection is compressed and the message
+            is big enough for it to be worth it, but not so big that the other server
+            would refuse it. This has to happen while we hold the `send_mutex`, so the
+            compressed messages reach the wire in the same order they went into the
+            stream. */
+            std::vector<char> compressed;
+            if (connection->compressor.has()
+                    && buffer.vector().size() >= CLUSTER_COMPRESSION_MIN_MESSAGE_SIZE
+                    && buffer.vector().size() <= CLUSTER_COMPRESSION_MAX_MESSAGE_SIZE) {
+                kiloticks_t start = get_kiloticks();
+                connection->compressor->compress(
+                    buffer.vector().data(), buffer.vector().size(), &compressed);
+                connection->pm_compression_usecs +=
+                    get_kiloticks().micros - start.micros;
+                connection->pm_bytes_before_compression += buffer.vector().size();
+                connection->pm_compressed_bytes += compressed.size();
+            }
+            const bool is_compressed = !compressed.empty();
+            const std::vector<char> &payload =
+                is_compressed ? compressed : buffer.vector();
+            bytes_sent = payload.size();
+
             /* Write the tag to the network */
             {
                 // All cluster versions use a uint8_t tag here.
@@ -1544,7 +1646,15 @@ void connectivity_cluster_t::send_message(connection_t *connection,
                               "changed, the cluster communication format has changed and "
                               "you need to ask yourself whether live cluster upgrades work."
                               );
-                serialize_universal(&wm, tag);
+                if (is_compressed) {
+                    serialize_universal(&wm, compressed_tag);
+                    serialize_universal(&wm, tag);
+                    serialize_universal(
+                        &wm, static_cast<uint64_t>(buffer.vector().size()));
+                    serialize_universal(&wm, static_cast<uint64_t>(compressed.size()));
+                } else {
+                    serialize_universal(&wm, tag);
+                }
                 make_buffered_tcp_conn_stream_wrapper_t buffered_conn(connection->conn);
                 int res = send_write_message(&buffered_conn, &wm);
                 if (res == -1) {
@@ -1560,15 +1670,15 @@ void connectivity_cluster_t::send_message(connection_t *connection,
 
             /* Write the message itself to the network */
             {
-                int64_t res = connection->conn->write_buffered(buffer.vector().data(),
-                                                               buffer.vector().size());
+                int64_t res = connection->conn->write_buffered(payload.data(),
+                                                               payload.size());
                 if (res == -1) {
                     if (connection->conn->is_read_open()) {
                         connection->conn->shutdown_read();
                     }
                     return;
                 } else {
-                    guarantee(res == static_cast<int64_t>(buffer.vector().size()));
+                    guarantee(res == static_cast<int64_t>(payload.size()));
                 }
             }
         } /* Releases the send_mutex */
@@ -1585,6 +1695,7 @@ void connectivity_cluster_t::send_message(connection_t *connection,
     }
 
     connection->pm_bytes_sent.record(bytes_sent);
+    connection->pm_bytes_sent_total += bytes_sent;
 }
 
 cluster_message_handler_t::cluster_message_handler_t(
@@ -1596,6 +1707,9 @@ cluster_message_handler_t::cluster_message_handler_t(
     rassert(tag != connectivity_cluster_t::heartbeat_tag,
         "Tag %" PRIu8 " is reserved for heartbeat messages.",
         connectivity_cluster_t::heartbeat_tag);
+    rassert(tag != connectivity_cluster_t::compressed_tag,
+        "Tag %" PRIu8 " is reserved for compressed messages.",
+        connectivity_cluster_t::compressed_tag);
     rassert(connectivity_cluster->message_handlers[tag] == nullptr);
     connectivity_cluster->message_handlers[tag] = this;
 }
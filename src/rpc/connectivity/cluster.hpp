@@ -16,9 +16,11 @@
 #include "concurrency/watchable_map.hpp"
 #include "containers/archive/tcp_conn_stream.hpp"
 #include "containers/map_sentries.hpp"
+#include "containers/scoped.hpp"
 #include "concurrency/pump_coro.hpp"
 #include "perfmon/perfmon.hpp"
 #include "random.hpp"
+#include "rpc/connectivity/cluster_compression.hpp"
 #include "rpc/connectivity/peer_id.hpp"
 #include "rpc/connectivity/server_id.hpp"
 #include "utils.hpp"
@@ -105,6 +107,10 @@ public:
     /* This tag is reserved exclusively for heartbeat messages. */
     static const message_tag_t heartbeat_tag = 'H';
 
+    /* This tag is reserved for compressed messages. It's followed by the tag of the
+    message inside, the message's size, the compressed size and the compressed data. */
+    static const message_tag_t compressed_tag = 'Z';
+
     class run_t;
 
     /* `connection_t` represents an open connection to another server. If we lose
@@ -154,7 +160,8 @@ public:
             const peer_id_t &peer_id,
             const server_id_t &server_id,
             keepalive_tcp_conn_stream_t *,
-            const peer_address_t &peer_address) THROWS_NOTHING;
+            const peer_address_t &peer_address,
+            cluster_compression_t compression) THROWS_NOTHING;
         ~connection_t() THROWS_NOTHING;
 
         /* NULL for the loopback connection (i.e. our "connection" to ourself) */
@@ -172,9 +179,23 @@ public:
         buffered write makes it to the TCP stack. */
         pump_coro_t flusher;
 
+        /* Empty unless both servers agreed to compress the connection. Only used
+        while holding `send_mutex`, because the messages have to go into the stream in
+        the same order they go onto the wire. */
+        scoped_ptr_t<cluster_compressor_t> compressor;
+
         perfmon_collection_t pm_collection;
         perfmon_sampler_t pm_bytes_sent;
-        perfmon_membership_t pm_collection_membership, pm_bytes_sent_membership;
+        /* Everything sent over the connection, including the message headers. */
+        perfmon_counter_t pm_bytes_sent_total;
+        /* The ratio of `compressed_bytes` to `bytes_before_compression` is the
+        compression ratio; `compression_usecs` is the CPU time spent compressing and
+        decompressing. */
+        perfmon_counter_t pm_bytes_before_compression, pm_compressed_bytes,
+            pm_compression_usecs;
+        perfmon_membership_t pm_collection_membership, pm_bytes_sent_membership,
+            pm_bytes_sent_total_membership, pm_bytes_before_compression_membership, pm_compressed_bytes_membership,
+            pm_compression_usecs_membership;
 
         /* We only hold this information so we can deregister ourself */
         run_t *parent;
@@ -281,6 +302,11 @@ public:
         disconnects or we are shut down, and sending out the
         disconnect-notification. It returns a join_result_t indicating the outcome
         of the attempted join. */
+        /* Returns the handler for messages with the given tag, which `handle()`
+        passes the messages it receives to. */
+        cluster_message_handler_t *get_message_handler(
+            message_tag_t tag, cluster_version_t resolved_version);
+
         join_result_t handle(keepalive_tcp_conn_stream_t *c,
             optional<peer_id_t> expected_id,
             optional<peer_address_t> expected_address,
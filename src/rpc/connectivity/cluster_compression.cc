@@ -0,0 +1,88 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#include "rpc/connectivity/cluster_compression.hpp"
+
+#include <limits>
+
+#include <zlib.h>
+
+#include "config/args.hpp"
+
+cluster_compressor_t::cluster_compressor_t() : stream(new z_stream) {
+    stream->zalloc = Z_NULL;
+    stream->zfree = Z_NULL;
+    stream->opaque = Z_NULL;
+    int res = deflateInit(stream, CLUSTER_COMPRESSION_LEVEL);
+    guarantee(res == Z_OK, "deflateInit failed with %d", res);
+}
+
+cluster_compressor_t::~cluster_compressor_t() {
+    deflateEnd(stream);
+    delete stream;
+}
+
+void cluster_compressor_t::compress(const char *data, size_t size,
+                                    std::vector<char> *out) {
+    guarantee(size <= std::numeric_limits<uInt>::max());
+    stream->next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+    stream->avail_in = size;
+    // The extra space is for the block that the sync flush ends the message with.
+    out->resize(deflateBound(stream, size) + 16);
+    size_t produced = 0;
+    do {
+        if (produced == out->size()) {
+            out->resize(out->size() * 2);
+        }
+        stream->next_out = reinterpret_cast<Bytef *>(out->data() + produced);
+        stream->avail_out = out->size() - produced;
+        int res = deflate(stream, Z_SYNC_FLUSH);
+        guarantee(res == Z_OK || res == Z_BUF_ERROR, "deflate failed with %d", res);
+        produced = out->size() - stream->avail_out;
+    } while (stream->avail_out == 0);
+    guarantee(stream->avail_in == 0);
+    out->resize(produced);
+}
+
+cluster_decompressor_t::cluster_decompressor_t() : stream(new z_stream) {
+    stream->zalloc = Z_NULL;
+    stream->zfree = Z_NULL;
+    stream->opaque = Z_NULL;
+    stream->next_in = Z_NULL;
+    stream->avail_in = 0;
+    int res = inflateInit(stream);
+    guarantee(res == Z_OK, "inflateInit failed with %d", res);
+}
+
+cluster_decompressor_t::~cluster_decompressor_t() {
+    inflateEnd(stream);
+    delete stream;
+}
+
+bool cluster_decompressor_t::decompress(const char *data, size_t size,
+                                        size_t message_size, std::vector<char> *out) {
+    if (!sizes_are_valid(size, message_size)) {
+        return false;
+    }
+    stream->next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+    stream->avail_in = size;
+    /* We leave room for one more byte than we expect, so that `inflate()` doesn't stop
+    before it has read the sync flush at the end of the message. */
+    out->resize(message_size + 1);
+    stream->next_out = reinterpret_cast<Bytef *>(out->data());
+    stream->avail_out = message_size + 1;
+    int res = inflate(stream, Z_SYNC_FLUSH);
+    if (res != Z_OK || stream->avail_in != 0 || stream->avail_out != 1) {
+        return false;
+    }
+    out->resize(message_size);
+    return true;
+}
+
+bool cluster_decompressor_t::sizes_are_valid(size_t size, size_t message_size) {
+    static_assert(CLUSTER_COMPRESSION_MAX_MESSAGE_SIZE
+                      < std::numeric_limits<uInt>::max() / 2,
+                  "zlib can't take messages that big in one call.");
+    /* `compressBound()` allows for data that doesn't compress at all; the sync flush
+    at the end of every message adds a few bytes more. */
+    return message_size <= CLUSTER_COMPRESSION_MAX_MESSAGE_SIZE
+        && size <= compressBound(message_size) + 16;
+}
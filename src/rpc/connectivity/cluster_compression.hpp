@@ -0,0 +1,65 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#ifndef RPC_CONNECTIVITY_CLUSTER_COMPRESSION_HPP_
+#define RPC_CONNECTIVITY_CLUSTER_COMPRESSION_HPP_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "errors.hpp"
+
+struct z_stream_s;
+
+/* The codecs an intra-cluster connection can compress its messages with. Each side
+sends the codec it supports during the handshake, and a connection is compressed only
+if both sides sent the same one. The values are sent over the wire, so don't renumber
+them. */
+enum class cluster_compression_t : uint8_t {
+    none = 0,
+    zlib = 1,
+};
+
+/* `cluster_compressor_t` and `cluster_decompressor_t` are the two ends of the zlib
+stream that carries the compressed messages in one direction of a connection. All of
+the messages go into the same stream, so a message can refer back to strings in the
+ones before it; this is what makes compressing small, similar messages worthwhile.
+Every message ends with a sync flush, so the receiver can decode it as soon as it
+arrives. The receiver must decompress the messages in the order they were
+compressed. */
+class cluster_compressor_t {
+public:
+    cluster_compressor_t();
+    ~cluster_compressor_t();
+
+    /* Replaces the contents of `out` with the compressed form of `data`. */
+    void compress(const char *data, size_t size, std::vector<char> *out);
+
+private:
+    z_stream_s *stream;
+
+    DISABLE_COPYING(cluster_compressor_t);
+};
+
+class cluster_decompressor_t {
+public:
+    cluster_decompressor_t();
+    ~cluster_decompressor_t();
+
+    /* Replaces the contents of `out` with the message that `data` decompresses to.
+    Returns false if `data` is corrupt or the message isn't `message_size` bytes long;
+    the stream can't be used after that. */
+    MUST_USE bool decompress(const char *data, size_t size, size_t message_size,
+                             std::vector<char> *out);
+
+    /* Returns false if no message the other server is allowed to compress can be
+    `message_size` bytes long and compress to `size` bytes. This is checked before the
+    compressed message is read off the connection. */
+    static MUST_USE bool sizes_are_valid(size_t size, size_t message_size);
+
+private:
+    z_stream_s *stream;
+
+    DISABLE_COPYING(cluster_decompressor_t);
+};
+
+#endif  // RPC_CONNECTIVITY_CLUSTER_COMPRESSION_HPP_
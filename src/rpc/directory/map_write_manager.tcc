@@ -5,7 +5,9 @@
 #include "rpc/directory/map_write_manager.hpp"
 
 #include "concurrency/wait_any.hpp"
+#include "config/args.hpp"
 #include "containers/archive/optional.hpp"
+#include "containers/archive/stl_types.hpp"
 
 template<class key_t, class value_t>
 directory_map_write_manager_t<key_t, value_t>::directory_map_write_manager_t(
@@ -42,14 +44,14 @@ class directory_map_write_manager_t<key_t, value_t>::update_writer_t :
 {
 public:
     update_writer_t(
-            uint64_t _timestamp, const key_t &_key, optional<value_t> &&_value) :
-        timestamp(_timestamp), key(_key), value(std::move(_value)) { }
+            uint64_t _timestamp,
+            std::vector<std::pair<key_t, optional<value_t> > > &&_changes) :
+        timestamp(_timestamp), changes(std::move(_changes)) { }
 
     void write(write_stream_t *s) {
         write_message_t wm;
         serialize<cluster_version_t::CLUSTER>(&wm, timestamp);
-        serialize<cluster_version_t::CLUSTER>(&wm, key);
-        serialize<cluster_version_t::CLUSTER>(&wm, value);
+        serialize<cluster_version_t::CLUSTER>(&wm, changes);
         int res = send_write_message(s, &wm);
         if (res) {
             throw fake_archive_exc_t();
@@ -66,8 +68,7 @@ public:
 
 private:
     uint64_t timestamp;
-    key_t key;
-    optional<value_t> value;
+    std::vector<std::pair<key_t, optional<value_t> > > changes;
 };
 
 template<class key_t, class value_t>
@@ -111,19 +112,28 @@ void directory_map_write_manager_t<key_t, value_t>::stream_to_conn(
             /* Copy all dirty keys to a local variable, then iterate over that variable.
             The naive approach would be to always send the first dirty key in
             `conns_entry` until there are no dirty keys left; but that has starvation
-            issues. */
+            issues. We send the keys in batches of up to `DIRECTORY_MAX_BATCH_SIZE`, so
+            that a change to many keys at once (such as a reconfiguration touching many
+            tables) doesn't cost a message per key. */
             std::set<key_t> dirty_keys;
             std::swap(dirty_keys, conns_entry->second.dirty_keys);
-            for (const key_t &key : dirty_keys) {
+            auto it = dirty_keys.begin();
+            while (it != dirty_keys.end()) {
                 if (interruptor.is_pulsed()) {
                     throw interrupted_exc_t();
                 }
-                /* If the key changed again since we copied `dirty_keys`, we'll be
+                /* If a key changed again since we copied `dirty_keys`, we'll be
                 sending the newest value, because we didn't copy the value at the same
                 time as we copied `dirty_keys`. So it's OK to remove the key from
-                `dirty_keys` to prevent sending a redundant message. */
-                conns_entry->second.dirty_keys.erase(key);
-                update_writer_t writer(timestamp, key, value->get_key(key));
+                `dirty_keys` to prevent sending a redundant message. The values in a
+                batch are all read at once, so they're all current as of `timestamp`. */
+                std::vector<std::pair<key_t, optional<value_t> > > changes;
+                for (; it != dirty_keys.end()
+                        && changes.size() < DIRECTORY_MAX_BATCH_SIZE; ++it) {
+                    conns_entry->second.dirty_keys.erase(*it);
+                    changes.push_back(std::make_pair(*it, value->get_key(*it)));
+                }
+                update_writer_t writer(timestamp, std::move(changes));
                 connectivity_cluster->send_message(
                     connection, connection_keepalive, message_tag, &writer);
             }
@@ -0,0 +1,232 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include "serializer/buf_slab.hpp"
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+#include <atomic>
+
+#include "arch/spinlock.hpp"
+#include "containers/intrusive_list.hpp"
+#include "math.hpp"
+#include "memory_utils.hpp"
+#include "perfmon/perfmon.hpp"
+
+namespace {
+
+const size_t REGION_SIZE = 2 * MEGABYTE;
+
+const size_t NUM_SIZE_CLASSES = BUF_SLAB_MAX_CHUNK_SIZE / DEVICE_BLOCK_SIZE + 1;
+
+// Lives at the start of each region, in space that would otherwise hold the
+// region's first chunk.
+struct region_t : public intrusive_list_node_t<region_t> {
+    size_t chunk_size;
+    size_t num_chunks;
+    // Chunks [num_carved, num_chunks) have never been handed out.
+    size_t num_carved;
+    size_t num_used;
+    // Freed chunks, linked through their first bytes.
+    void *free_chunks;
+
+    char *chunk(size_t i) {
+        return reinterpret_cast<char *>(this) + (i + 1) * chunk_size;
+    }
+};
+
+struct size_class_t {
+    size_class_t() : num_unused(0) { }
+
+    spinlock_t lock;
+    // The regions that have a chunk to spare.
+    intrusive_list_t<region_t> available;
+    // The number of regions in `available` whose chunks are all free.
+    size_t num_unused;
+};
+
+struct slab_allocator_t {
+    slab_allocator_t()
+        : mapped_bytes(0), used_bytes(0), no_reserved_huge_pages(false) { }
+
+    size_class_t size_classes[NUM_SIZE_CLASSES];
+    std::atomic<int64_t> mapped_bytes;
+    std::atomic<int64_t> used_bytes;
+    // Set once a MAP_HUGETLB mapping has failed, so that we don't keep trying.
+    std::atomic<bool> no_reserved_huge_pages;
+};
+
+// This is never destroyed, because buffers can outlive static destructors.
+slab_allocator_t *get_allocator() {
+    static slab_allocator_t *allocator = new slab_allocator_t;
+    return allocator;
+}
+
+void *map_region(slab_allocator_t *allocator) {
+#ifdef _WIN32
+    (void)allocator;
+    return raw_malloc_aligned(REGION_SIZE, REGION_SIZE);
+#else
+#if defined(MAP_HUGETLB) && defined(MAP_HUGE_SHIFT)
+    if (!allocator->no_reserved_huge_pages.load()) {
+        // Asks for 2MB pages in particular (log2(REGION_SIZE) is 21), in case the
+        // default huge page size is something else.
+        const int huge_2mb = 21 << MAP_HUGE_SHIFT;
+        void *ptr = mmap(nullptr, REGION_SIZE, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | huge_2mb,
+                         -1, 0);
+        if (ptr != MAP_FAILED) {
+            return ptr;
+        }
+        allocator->no_reserved_huge_pages.store(true);
+    }
+#endif
+
+    // Map twice the size we need, so that we can cut out an aligned region.
+    char *ptr = static_cast<char *>(mmap(nullptr, 2 * REGION_SIZE,
+                                         PROT_READ | PROT_WRITE,
+                                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    if (ptr == MAP_FAILED) {
+        crash_oom();
+    }
+    const uintptr_t addr = reinterpret_cast<uintptr_t>(ptr);
+    char *region = reinterpret_cast<char *>(ceil_aligned(addr, REGION_SIZE));
+    if (region != ptr) {
+        guarantee_err(munmap(ptr, region - ptr) == 0, "munmap failed");
+    }
+    char *end = region + REGION_SIZE;
+    if (end != ptr + 2 * REGION_SIZE) {
+        guarantee_err(munmap(end, ptr + 2 * REGION_SIZE - end) == 0, "munmap failed");
+    }
+#ifdef MADV_HUGEPAGE
+    // This is just advice; the region works fine with regular pages.
+    madvise(region, REGION_SIZE, MADV_HUGEPAGE);
+#endif
+    return region;
+#endif  // _WIN32
+}
+
+void unmap_region(void *region) {
+#ifdef _WIN32
+    raw_free_aligned(region);
+#else
+    guarantee_err(munmap(region, REGION_SIZE) == 0, "munmap failed");
+#endif
+}
+
+region_t *region_of(void *ptr) {
+    return reinterpret_cast<region_t *>(
+        floor_aligned(reinterpret_cast<uintptr_t>(ptr), REGION_SIZE));
+}
+
+class perfmon_slab_value_t : public perfmon_t {
+public:
+    explicit perfmon_slab_value_t(int64_t buf_slab_stats_t::*field) : field_(field) { }
+    void *begin_stats() { return nullptr; }
+    void visit_stats(void *) { }
+    ql::datum_t end_stats(void *) {
+        return ql::datum_t(static_cast<double>(get_buf_slab_stats().*field_));
+    }
+private:
+    int64_t buf_slab_stats_t::*field_;
+    DISABLE_COPYING(perfmon_slab_value_t);
+};
+
+perfmon_collection_t pm_buf_slab_collection;
+perfmon_membership_t pm_buf_slab_membership(
+    &get_global_perfmon_collection(), &pm_buf_slab_collection, "buf_slab");
+perfmon_slab_value_t pm_buf_slab_mapped_bytes(&buf_slab_stats_t::mapped_bytes);
+perfmon_slab_value_t pm_buf_slab_used_bytes(&buf_slab_stats_t::used_bytes);
+perfmon_multi_membership_t pm_buf_slab_values_membership(&pm_buf_slab_collection,
+    &pm_buf_slab_mapped_bytes, "mapped_bytes",
+    &pm_buf_slab_used_bytes, "used_bytes");
+
+}  // namespace
+
+void *buf_slab_alloc(size_t size) {
+    const bool is_aligned = size % DEVICE_BLOCK_SIZE == 0;
+    guarantee(size != 0 && is_aligned && size <= BUF_SLAB_MAX_CHUNK_SIZE,
+              "Bad slab buffer size: %zu", size);
+    slab_allocator_t *allocator = get_allocator();
+    size_class_t *size_class = &allocator->size_classes[size / DEVICE_BLOCK_SIZE];
+
+    void *ret;
+    {
+        spinlock_acq_t acq(&size_class->lock);
+        region_t *region = size_class->available.head();
+        if (region == nullptr) {
+            region = new (map_region(allocator)) region_t();
+            region->chunk_size = size;
+            region->num_chunks = REGION_SIZE / size - 1;
+            region->num_carved = 0;
+            region->num_used = 0;
+            region->free_chunks = nullptr;
+            size_class->available.push_front(region);
+            ++size_class->num_unused;
+            allocator->mapped_bytes += REGION_SIZE;
+        }
+
+        if (region->num_used == 0) {
+            --size_class->num_unused;
+        }
+        if (region->free_chunks != nullptr) {
+            ret = region->free_chunks;
+            region->free_chunks = *static_cast<void **>(ret);
+        } else {
+            rassert(region->num_carved < region->num_chunks);
+            ret = region->chunk(region->num_carved);
+            ++region->num_carved;
+        }
+        ++region->num_used;
+        if (region->num_used == region->num_chunks) {
+            size_class->available.remove(region);
+        }
+    }
+    allocator->used_bytes += size;
+    return ret;
+}
+
+void buf_slab_free(void *ptr) {
+    if (ptr == nullptr) {
+        return;
+    }
+    slab_allocator_t *allocator = get_allocator();
+    region_t *region = region_of(ptr);
+    const size_t size = region->chunk_size;
+    size_class_t *size_class = &allocator->size_classes[size / DEVICE_BLOCK_SIZE];
+
+    bool unmap = false;
+    {
+        spinlock_acq_t acq(&size_class->lock);
+        rassert(region->num_used > 0);
+        if (region->num_used == region->num_chunks) {
+            size_class->available.push_front(region);
+        }
+        *static_cast<void **>(ptr) = region->free_chunks;
+        region->free_chunks = ptr;
+        --region->num_used;
+        if (region->num_used == 0) {
+            if (size_class->num_unused > 0) {
+                size_class->available.remove(region);
+                unmap = true;
+            } else {
+                ++size_class->num_unused;
+            }
+        }
+    }
+    allocator->used_bytes -= size;
+
+    if (unmap) {
+        region->~region_t();
+        unmap_region(region);
+        allocator->mapped_bytes -= REGION_SIZE;
+    }
+}
+
+buf_slab_stats_t get_buf_slab_stats() {
+    slab_allocator_t *allocator = get_allocator();
+    buf_slab_stats_t ret;
+    ret.mapped_bytes = allocator->mapped_bytes.load();
+    ret.used_bytes = allocator->used_bytes.load();
+    return ret;
+}
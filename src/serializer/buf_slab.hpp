@@ -0,0 +1,43 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#ifndef SERIALIZER_BUF_SLAB_HPP_
+#define SERIALIZER_BUF_SLAB_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "config/args.hpp"
+#include "containers/scoped.hpp"
+
+// A slab allocator for the block buffers of `buf_ptr_t`.
+//
+// Buffers are carved out of 2MB regions, each of which holds buffers of a single
+// size (a multiple of DEVICE_BLOCK_SIZE).  Regions are backed by huge pages if the
+// system has some reserved, and are otherwise advised to be backed by transparent
+// huge pages.  Freed buffers go on their region's free list and get reused by the
+// next allocation of the same size.  A size keeps at most one entirely unused region
+// around; other regions that become unused are returned to the OS, so that the
+// process's memory usage doesn't stay at its high-water mark.
+//
+// Buffers may be allocated and freed on any thread.
+
+// The largest buffer `buf_slab_alloc` can allocate.
+const size_t BUF_SLAB_MAX_CHUNK_SIZE = 64 * KILOBYTE;
+
+// `size` must be a nonzero multiple of DEVICE_BLOCK_SIZE, at most
+// BUF_SLAB_MAX_CHUNK_SIZE.  The returned buffer is DEVICE_BLOCK_SIZE-aligned.
+void *buf_slab_alloc(size_t size);
+void buf_slab_free(void *ptr);
+
+struct buf_slab_stats_t {
+    // The memory used by the regions that are currently mapped.
+    int64_t mapped_bytes;
+    // The memory used by allocated buffers.
+    int64_t used_bytes;
+};
+
+buf_slab_stats_t get_buf_slab_stats();
+
+template <class T>
+TEMPLATE_ALIAS(scoped_buf_slab_ptr_t, scoped_alloc_t<T, buf_slab_alloc, buf_slab_free>);
+
+#endif  // SERIALIZER_BUF_SLAB_HPP_
@@ -1,8 +1,24 @@
 #include "serializer/checksum.hpp"
 
-// The return value of this function or its behavior can't be changed -- the on-disk
-// format obviously requires a specific checksum algorithm.
-serializer_checksum compute_checksum(const void *word32s, size_t wordcount) {
+#include <string.h>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define CHECKSUM_HAS_X86_CRC32C
+#include <immintrin.h>
+#elif defined(__GNUC__) && defined(__aarch64__) && defined(__linux__)
+#define CHECKSUM_HAS_ARM_CRC32C
+#include <arm_acle.h>
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+#include "errors.hpp"
+
+namespace {
+
+// The return value of these functions or their behavior can't be changed -- the
+// on-disk format obviously requires a specific checksum algorithm.
+serializer_checksum fletcher64_checksum(const void *word32s, size_t wordcount) {
     const uint32_t *p = static_cast<const uint32_t *>(word32s);
 
     // This is the Fletcher-64 algorithm, applied to the input whose words are xored with
@@ -60,9 +76,9 @@ serializer_checksum compute_checksum(const void *word32s, size_t wordcount) {
     return serializer_checksum{(b << 32) | a};
 }
 
-serializer_checksum compute_checksum_concat(serializer_checksum left,
-                                            serializer_checksum right,
-                                            uint64_t right_wordcount) {
+serializer_checksum fletcher64_checksum_concat(serializer_checksum left,
+                                               serializer_checksum right,
+                                               uint64_t right_wordcount) {
     uint64_t a_left = left.value & 0xFFFFFFFFull;
     uint64_t b_left = left.value >> 32;
     uint64_t a_right = right.value & 0xFFFFFFFFull;
@@ -88,3 +104,231 @@ serializer_checksum compute_checksum_concat(serializer_checksum left,
 
     return serializer_checksum{(b << 32) | a};
 }
+
+// CRC32C (the Castagnoli polynomial), with the bits reflected the way the SSE4.2 and
+// ARMv8 instructions compute it.  In this representation, bit 31 of a 32-bit value is
+// the coefficient of x^0.
+const uint32_t CRC32C_POLYNOMIAL = 0x82F63B78;
+
+// A CRC32C `serializer_checksum` holds the CRC in its upper word.  The lower word can
+// be anything but zero, so that `has_checksum()` holds.
+const uint64_t CRC32C_LOWER_WORD = 1;
+
+// The hardware kernels run three independent CRCs over consecutive stripes of this
+// many bytes, because one CRC instruction has a latency of three cycles but the CPU
+// can start one every cycle.
+const size_t CRC32C_STRIPE = 256;
+
+typedef uint32_t (*crc32c_fn_t)(uint32_t, const char *, size_t);
+
+// Returns a * b modulo the polynomial.
+uint32_t crc32c_multiply(uint32_t a, uint32_t b) {
+    uint32_t product = 0;
+    for (uint32_t bit = 1u << 31; bit != 0; bit >>= 1) {
+        if ((a & bit) != 0) {
+            product ^= b;
+        }
+        b = (b & 1) != 0 ? (b >> 1) ^ CRC32C_POLYNOMIAL : b >> 1;
+    }
+    return product;
+}
+
+// Returns x^(8 * n) modulo the polynomial.  Appending n bytes to a buffer multiplies
+// the CRC register by this.
+uint32_t crc32c_zeros_operator(uint64_t n) {
+    uint32_t result = 1u << 31;
+    uint32_t power = 1u << (31 - 8);
+    while (n != 0) {
+        if ((n & 1) != 0) {
+            result = crc32c_multiply(result, power);
+        }
+        power = crc32c_multiply(power, power);
+        n >>= 1;
+    }
+    return result;
+}
+
+struct crc32c_tables_t {
+    crc32c_tables_t() {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t crc = i;
+            for (int j = 0; j < 8; ++j) {
+                crc = (crc & 1) != 0 ? (crc >> 1) ^ CRC32C_POLYNOMIAL : crc >> 1;
+            }
+            bytewise[i] = crc;
+        }
+        const uint32_t one_stripe = crc32c_zeros_operator(CRC32C_STRIPE);
+        const uint32_t two_stripes = crc32c_zeros_operator(2 * CRC32C_STRIPE);
+        for (int k = 0; k < 4; ++k) {
+            for (uint32_t i = 0; i < 256; ++i) {
+                skip_one_stripe[k][i] = crc32c_multiply(i << (8 * k), one_stripe);
+                skip_two_stripes[k][i] = crc32c_multiply(i << (8 * k), two_stripes);
+            }
+        }
+    }
+
+    // Multiplies `crc` by a constant, using a table for each of its bytes.
+    static uint32_t multiply(const uint32_t (&table)[4][256], uint32_t crc) {
+        return table[0][crc & 0xFF] ^ table[1][(crc >> 8) & 0xFF]
+            ^ table[2][(crc >> 16) & 0xFF] ^ table[3][crc >> 24];
+    }
+
+    uint32_t bytewise[256];
+    // Multiplication by x^(8 * CRC32C_STRIPE) and x^(16 * CRC32C_STRIPE).
+    uint32_t skip_one_stripe[4][256];
+    uint32_t skip_two_stripes[4][256];
+};
+
+const crc32c_tables_t &crc32c_tables() {
+    static const crc32c_tables_t tables;
+    return tables;
+}
+
+// Combines the CRCs of three consecutive stripes, where only the first one started
+// from the running CRC.
+uint32_t crc32c_merge_stripes(uint32_t a, uint32_t b, uint32_t c) {
+    const crc32c_tables_t &tables = crc32c_tables();
+    return crc32c_tables_t::multiply(tables.skip_two_stripes, a)
+        ^ crc32c_tables_t::multiply(tables.skip_one_stripe, b)
+        ^ c;
+}
+
+uint64_t load_uint64(const char *p) {
+    uint64_t ret;
+    memcpy(&ret, p, sizeof(ret));
+    return ret;
+}
+
+uint32_t crc32c_software(uint32_t crc, const char *p, size_t n) {
+    const crc32c_tables_t &tables = crc32c_tables();
+    for (size_t i = 0; i < n; ++i) {
+        crc = tables.bytewise[(crc ^ static_cast<uint8_t>(p[i])) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+#ifdef CHECKSUM_HAS_X86_CRC32C
+__attribute__((target("sse4.2")))
+uint32_t crc32c_sse42(uint32_t crc, const char *p, size_t n) {
+    for (; n >= 3 * CRC32C_STRIPE; p += 3 * CRC32C_STRIPE, n -= 3 * CRC32C_STRIPE) {
+        uint64_t a = crc;
+        uint64_t b = 0;
+        uint64_t c = 0;
+        for (size_t i = 0; i < CRC32C_STRIPE; i += 8) {
+            a = _mm_crc32_u64(a, load_uint64(p + i));
+            b = _mm_crc32_u64(b, load_uint64(p + CRC32C_STRIPE + i));
+            c = _mm_crc32_u64(c, load_uint64(p + 2 * CRC32C_STRIPE + i));
+        }
+        crc = crc32c_merge_stripes(a, b, c);
+    }
+    for (; n >= 8; p += 8, n -= 8) {
+        crc = _mm_crc32_u64(crc, load_uint64(p));
+    }
+    for (; n > 0; ++p, --n) {
+        crc = _mm_crc32_u8(crc, static_cast<uint8_t>(*p));
+    }
+    return crc;
+}
+#endif  // CHECKSUM_HAS_X86_CRC32C
+
+#ifdef CHECKSUM_HAS_ARM_CRC32C
+__attribute__((target("+crc")))
+uint32_t crc32c_armv8(uint32_t crc, const char *p, size_t n) {
+    for (; n >= 3 * CRC32C_STRIPE; p += 3 * CRC32C_STRIPE, n -= 3 * CRC32C_STRIPE) {
+        uint32_t a = crc;
+        uint32_t b = 0;
+        uint32_t c = 0;
+        for (size_t i = 0; i < CRC32C_STRIPE; i += 8) {
+            a = __crc32cd(a, load_uint64(p + i));
+            b = __crc32cd(b, load_uint64(p + CRC32C_STRIPE + i));
+            c = __crc32cd(c, load_uint64(p + 2 * CRC32C_STRIPE + i));
+        }
+        crc = crc32c_merge_stripes(a, b, c);
+    }
+    for (; n >= 8; p += 8, n -= 8) {
+        crc = __crc32cd(crc, load_uint64(p));
+    }
+    for (; n > 0; ++p, --n) {
+        crc = __crc32cb(crc, static_cast<uint8_t>(*p));
+    }
+    return crc;
+}
+#endif  // CHECKSUM_HAS_ARM_CRC32C
+
+// Returns the hardware kernel, or null if the CPU doesn't have one.
+crc32c_fn_t choose_crc32c_hardware() {
+#ifdef CHECKSUM_HAS_X86_CRC32C
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.2")) {
+        return &crc32c_sse42;
+    }
+#endif
+#ifdef CHECKSUM_HAS_ARM_CRC32C
+    if ((getauxval(AT_HWCAP) & HWCAP_CRC32) != 0) {
+        return &crc32c_armv8;
+    }
+#endif
+    return nullptr;
+}
+
+crc32c_fn_t crc32c_hardware() {
+    static const crc32c_fn_t fn = choose_crc32c_hardware();
+    return fn;
+}
+
+serializer_checksum crc32c_checksum(const void *word32s, size_t wordcount) {
+    // We still need the software version to read files written on a machine that had
+    // the instructions.
+    crc32c_fn_t fn = crc32c_hardware();
+    if (fn == nullptr) {
+        fn = &crc32c_software;
+    }
+    const uint32_t crc = ~fn(~0u, static_cast<const char *>(word32s),
+                             wordcount * serializer_checksum::word_size);
+    return serializer_checksum{(static_cast<uint64_t>(crc) << 32) | CRC32C_LOWER_WORD};
+}
+
+serializer_checksum crc32c_checksum_concat(serializer_checksum left,
+                                           serializer_checksum right,
+                                           uint64_t right_wordcount) {
+    const uint32_t crc_left = left.value >> 32;
+    const uint32_t crc_right = right.value >> 32;
+    const uint32_t crc = crc32c_multiply(
+        crc32c_zeros_operator(right_wordcount * serializer_checksum::word_size),
+        crc_left) ^ crc_right;
+    return serializer_checksum{(static_cast<uint64_t>(crc) << 32) | CRC32C_LOWER_WORD};
+}
+
+}  // namespace
+
+checksum_algorithm_t default_checksum_algorithm() {
+    return crc32c_hardware() != nullptr
+        ? checksum_algorithm_t::crc32c
+        : checksum_algorithm_t::fletcher64;
+}
+
+serializer_checksum compute_checksum(checksum_algorithm_t algorithm,
+                                     const void *word32s, size_t wordcount) {
+    switch (algorithm) {
+    case checksum_algorithm_t::fletcher64:
+        return fletcher64_checksum(word32s, wordcount);
+    case checksum_algorithm_t::crc32c:
+        return crc32c_checksum(word32s, wordcount);
+    default:
+        unreachable();
+    }
+}
+
+serializer_checksum compute_checksum_concat(checksum_algorithm_t algorithm,
+                                            serializer_checksum left,
+                                            serializer_checksum right,
+                                            uint64_t right_wordcount) {
+    switch (algorithm) {
+    case checksum_algorithm_t::fletcher64:
+        return fletcher64_checksum_concat(left, right, right_wordcount);
+    case checksum_algorithm_t::crc32c:
+        return crc32c_checksum_concat(left, right, right_wordcount);
+    default:
+        unreachable();
+    }
+}
@@ -15,24 +15,41 @@ ATTR_PACKED(struct serializer_checksum {
     static const size_t word_size = sizeof(uint32_t);
 });
 
+// The algorithm a checksum is computed with.  This is stored in the metablock, so
+// don't renumber these.
+enum class checksum_algorithm_t : uint32_t {
+    // Fletcher-64 over 32-bit words.  Files written before CRC32C was added only have
+    // these.
+    fletcher64 = 0,
+    crc32c = 1,
+};
+
+// The algorithm we checksum new writes with.  This is CRC32C if the CPU has
+// instructions for it, and Fletcher-64 otherwise.
+checksum_algorithm_t default_checksum_algorithm();
+
 // Computes a checksum of a buffer of length 4*wordcount.
+// algorithm: the checksum algorithm
 // word32s: a pointer to the buffer
 // wordcount: the number of 32-bit words in the buffer.
 // return value: the checksum.
 // The checksum is never zero.
-serializer_checksum compute_checksum(const void *word32s, size_t wordcount);
+serializer_checksum compute_checksum(checksum_algorithm_t algorithm,
+                                     const void *word32s, size_t wordcount);
 
 // Combines checksums into the checksum of the concatenated buffer.  Given two buffers,
 // s, and t, serializer_checksum_concat(serializer_checksum(s), serializer_checksum(t),
-// t.wordcount) computes serializer_checksum(concat(s, t)).
-serializer_checksum compute_checksum_concat(serializer_checksum left,
+// t.wordcount) computes serializer_checksum(concat(s, t)).  All three checksums use
+// `algorithm`.
+serializer_checksum compute_checksum_concat(checksum_algorithm_t algorithm,
+                                            serializer_checksum left,
                                             serializer_checksum right,
                                             uint64_t right_wordcount);
 
 // The checksum of an empty buffer.
-inline serializer_checksum identity_checksum() {
+inline serializer_checksum identity_checksum(checksum_algorithm_t algorithm) {
     char buf[1];
-    return compute_checksum(&buf, 0);
+    return compute_checksum(algorithm, &buf, 0);
 }
 
 inline serializer_checksum no_checksum() {
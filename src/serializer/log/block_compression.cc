@@ -0,0 +1,81 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include "serializer/log/block_compression.hpp"
+
+#include <string.h>
+#include <zlib.h>
+
+const block_magic_t compressed_block_header_t::expected_magic = { { 'z', 'b', 'l', 'k' } };
+
+namespace {
+
+const size_t COMPRESSED_BLOCK_OVERHEAD
+    = sizeof(ls_buf_data_t) + sizeof(compressed_block_header_t);
+
+compressed_block_header_t *header_of(ser_buffer_t *buf) {
+    return reinterpret_cast<compressed_block_header_t *>(buf->cache_data);
+}
+
+}  // namespace
+
+buf_ptr_t compress_block(block_compression_t codec,
+                         const ser_buffer_t *buf, block_size_t block_size) {
+    guarantee(codec == block_compression_t::zlib);
+
+    // It's only worth it if the block ends up taking fewer device blocks.
+    const uint16_t aligned_size = buf_ptr_t::compute_aligned_block_size(block_size);
+    if (aligned_size <= DEVICE_BLOCK_SIZE
+        || static_cast<size_t>(aligned_size - DEVICE_BLOCK_SIZE)
+           <= COMPRESSED_BLOCK_OVERHEAD) {
+        return buf_ptr_t();
+    }
+    buf_ptr_t ret = buf_ptr_t::alloc_uninitialized(
+        block_size_t::unsafe_make(aligned_size - DEVICE_BLOCK_SIZE));
+
+    uLongf compressed_size = ret.block_size().ser_value() - COMPRESSED_BLOCK_OVERHEAD;
+    compressed_block_header_t *header = header_of(ret.ser_buffer());
+    int res = compress2(reinterpret_cast<Bytef *>(header + 1), &compressed_size,
+                        reinterpret_cast<const Bytef *>(buf->cache_data),
+                        block_size.value(), Z_BEST_SPEED);
+    if (res == Z_BUF_ERROR) {
+        // It didn't fit.
+        return buf_ptr_t();
+    }
+    guarantee(res == Z_OK, "compress2 failed with %d", res);
+
+    ret.ser_buffer()->ser_header = buf->ser_header;
+    header->magic = compressed_block_header_t::expected_magic;
+    header->codec = static_cast<int8_t>(codec);
+    header->ser_block_size = block_size.ser_value();
+    header->compressed_size = compressed_size;
+    ret.resize_fill_zero(
+        block_size_t::unsafe_make(COMPRESSED_BLOCK_OVERHEAD + compressed_size));
+    return ret;
+}
+
+bool maybe_decompress_block(buf_ptr_t *buf) {
+    if (buf->block_size().ser_value() < COMPRESSED_BLOCK_OVERHEAD) {
+        return false;
+    }
+    const compressed_block_header_t *header = header_of(buf->ser_buffer());
+    if (header->magic != compressed_block_header_t::expected_magic) {
+        return false;
+    }
+    guarantee(header->codec == static_cast<int8_t>(block_compression_t::zlib),
+              "Compressed block has unknown codec %d", header->codec);
+    guarantee(COMPRESSED_BLOCK_OVERHEAD + header->compressed_size
+              == buf->block_size().ser_value(),
+              "Compressed block has the wrong size");
+
+    const block_size_t block_size = block_size_t::unsafe_make(header->ser_block_size);
+    buf_ptr_t ret = buf_ptr_t::alloc_uninitialized(block_size);
+    ret.ser_buffer()->ser_header = buf->ser_buffer()->ser_header;
+    uLongf size = block_size.value();
+    int res = uncompress(reinterpret_cast<Bytef *>(ret.cache_data()), &size,
+                         reinterpret_cast<const Bytef *>(header + 1),
+                         header->compressed_size);
+    guarantee(res == Z_OK && size == block_size.value(),
+              "Could not decompress block (zlib returned %d)", res);
+    ret.fill_padding_zero();
+    *buf = std::move(ret);
+    return true;
+}
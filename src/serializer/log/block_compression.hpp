@@ -0,0 +1,46 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#ifndef SERIALIZER_LOG_BLOCK_COMPRESSION_HPP_
+#define SERIALIZER_LOG_BLOCK_COMPRESSION_HPP_
+
+#include <stdint.h>
+
+#include "buffer_cache/types.hpp"
+#include "containers/archive/archive.hpp"
+#include "serializer/buf_ptr.hpp"
+
+/* The codec `log_serializer_t` compresses blocks with before writing them.  The
+values are stored in the header of every compressed block, so don't renumber them. */
+enum class block_compression_t : int8_t {
+    none = 0,
+    zlib = 1,
+};
+
+ARCHIVE_PRIM_MAKE_RANGED_SERIALIZABLE(block_compression_t, int8_t,
+                                      block_compression_t::none,
+                                      block_compression_t::zlib);
+
+/* A compressed block starts with the usual `ls_buf_data_t`, followed by a
+`compressed_block_header_t` and then the compressed cache data of the original block.
+Everything written above the serializer starts with a `block_magic_t`, which is how
+compressed blocks are told apart from uncompressed ones.  Since each block describes
+itself, a file can hold a mix of both, and the codec can change from run to run. */
+ATTR_PACKED(struct compressed_block_header_t {
+    block_magic_t magic;
+    int8_t codec;
+    // The size of the original block.
+    uint16_t ser_block_size;
+    uint32_t compressed_size;
+
+    static const block_magic_t expected_magic;
+});
+
+/* Returns the compressed version of the block in `buf`, or an empty `buf_ptr_t` if
+compressing it wouldn't save any space on disk.  `codec` must not be `none`. */
+buf_ptr_t compress_block(block_compression_t codec,
+                         const ser_buffer_t *buf, block_size_t block_size);
+
+/* If `buf` holds a compressed block, replaces it with the original block and returns
+true.  Crashes if a compressed block is corrupt. */
+bool maybe_decompress_block(buf_ptr_t *buf);
+
+#endif  // SERIALIZER_LOG_BLOCK_COMPRESSION_HPP_
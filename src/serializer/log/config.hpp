@@ -7,6 +7,7 @@
 #include "config/args.hpp"
 #include "containers/archive/archive.hpp"
 #include "serializer/types.hpp"
+#include "serializer/log/block_compression.hpp"
 #include "rpc/serialize_macros.hpp"
 
 /* Configuration for the serializer that can change from run to run */
@@ -17,6 +18,8 @@ struct log_serializer_dynamic_config_t {
         // This is probably too low, thanks to status quo bias (the status quo having
         // been to never compute checksums).
         checksum_threshold = 65536;
+        compression = block_compression_t::none;
+        cold_extent_age_secs = 0;
     }
 
     /* Enable reading more data than requested to let the cache warmup more quickly
@@ -26,6 +29,12 @@ struct log_serializer_dynamic_config_t {
        writing the serializer superblock.  Designed to make single-document writes
        fast. */
     uint32_t checksum_threshold;
+    /* The codec blocks get compressed with when they're written, if any.  Blocks
+       that were written with a different setting can still be read. */
+    block_compression_t compression;
+    /* If the serializer file has a cold tier, GC moves the blocks of extents that
+       haven't been read from or written to for this long onto it.  Zero means never. */
+    int64_t cold_extent_age_secs;
 };
 
 /* This is equivalent to log_serializer_static_config_t below, but is an on-disk
@@ -4,10 +4,12 @@
 #include <inttypes.h>
 #include <sys/uio.h>
 
+#include <algorithm>
 #include <functional>
 
 #include "arch/arch.hpp"
 #include "arch/runtime/coroutines.hpp"
+#include "arch/timing.hpp"
 #include "concurrency/mutex.hpp"
 #include "concurrency/new_mutex.hpp"
 #include "errors.hpp"
@@ -37,6 +39,17 @@ const size_t MAX_CONCURRENT_GCS = 64;
 const int GC_IO_PRIORITY_NICE = 8;
 // 4 times the priority of all caches combined
 const int GC_IO_PRIORITY_HIGH = 4 * MERGER_BLOCK_WRITE_IO_PRIORITY;
+// How many requests the nice account can have in the disk queue at a time.  This keeps
+// the many concurrent GCs from filling up the queue in front of foreground requests.
+const int GC_NICE_OUTSTANDING_REQUESTS_LIMIT = 8;
+
+// While the garbage ratio is below GC_HIGH_RATIO, GC pauses for GC_THROTTLE_NAP_MS
+// before each extent whenever the disk looks busy: when there are more than
+// GC_THROTTLE_OUTSTANDING_REQUESTS requests queued, or requests take longer than
+// GC_THROTTLE_LATENCY_NANOS on average.
+const int64_t GC_THROTTLE_OUTSTANDING_REQUESTS = 4 * GC_NICE_OUTSTANDING_REQUESTS_LIMIT;
+const int64_t GC_THROTTLE_LATENCY_NANOS = 20 * MILLION;
+const int64_t GC_THROTTLE_NAP_MS = 10;
 
 // The ratio at which we start GCing.
 constexpr double GC_START_RATIO = 0.1;
@@ -51,6 +64,9 @@ const size_t GC_YOUNG_EXTENT_MAX_SIZE = 50;
 // What's the definition of a "young" extent in microseconds?
 const kiloticks_t GC_YOUNG_EXTENT_TIMELIMIT = { 50000 };
 
+// How often we look for extents to move to the cold tier, if there is one.
+const int64_t COLD_MIGRATION_INTERVAL_MS = 60 * THOUSAND;
+
 
 // Identifies an extent, the time we started writing to the
 // extent, whether it's the extent we're currently writing to, and
@@ -68,10 +84,13 @@ private:
 
 public:
     /* This constructor is for starting a new active extent. */
-    explicit gc_entry_t(data_block_manager_t *_parent)
+    gc_entry_t(data_block_manager_t *_parent, unsigned int _generation)
         : parent(_parent),
-          extent_ref(parent->extent_manager->gen_extent()),
+          extent_ref(parent->extent_manager->gen_extent(
+              _generation == DBM_COLD_GENERATION)),
           timestamp(get_kiloticks()),
+          last_access(timestamp),
+          generation(_generation),
           was_written(false),
           state(state_active),
           garbage_bytes_stat(_parent->static_config->extent_size()),
@@ -87,6 +106,8 @@ public:
         : parent(_parent),
           extent_ref(parent->extent_manager->reserve_extent(_offset)),
           timestamp(get_kiloticks()),
+          last_access(timestamp),
+          generation(extent_manager_t::in_cold_tier(_offset) ? DBM_COLD_GENERATION : 0),
           was_written(false),
           state(state_reconstructing),
           garbage_bytes_stat(_parent->static_config->extent_size()),
@@ -249,6 +270,16 @@ public:
 
         uint32_t _relative_offset = offset - extent_ref.offset();
 
+        if (state == state_reconstructing) {
+            // Blocks get marked in block id order, not in offset order, so keeping
+            // `block_infos` sorted here would be quadratic in the number of blocks in
+            // the extent.  `finish_reconstruct()` sorts them once instead.
+            rassert(divides(DEVICE_BLOCK_SIZE, _relative_offset));
+            block_infos.push_back(block_info_t{static_cast<uint16_t>(_relative_offset / DEVICE_BLOCK_SIZE), false, true, _block_size});
+            update_stats(nullptr, &block_infos.back());
+            return;
+        }
+
         auto it = find_lower_bound_iter(_relative_offset);
         if (it == block_infos.end()) {
             block_infos.push_back(block_info_t{static_cast<uint16_t>(_relative_offset / DEVICE_BLOCK_SIZE), false, true, _block_size});
@@ -289,6 +320,40 @@ public:
         return b;
     }
 
+    // Puts the blocks that were marked live during startup in order.  Call this
+    // before taking the extent out of `state_reconstructing`.
+    void finish_reconstruct() {
+        guarantee(state == state_reconstructing);
+        std::sort(block_infos.begin(), block_infos.end(),
+                  [](const block_info_t &x, const block_info_t &y) {
+                      return x.relative_offset_in_dblocks < y.relative_offset_in_dblocks;
+                  });
+
+        // A block that got marked twice is only counted once, like it would have been
+        // if we had kept the blocks sorted all along.
+        size_t num_unique = 0;
+        for (size_t i = 0; i < block_infos.size(); ++i) {
+            if (num_unique > 0) {
+                const block_info_t &prev = block_infos[num_unique - 1];
+                if (prev.relative_offset_in_dblocks
+                    == block_infos[i].relative_offset_in_dblocks) {
+                    guarantee(prev.block_size == block_infos[i].block_size);
+                    const block_info_t duplicate = block_infos[i];
+                    block_infos[i].index_referenced = false;
+                    update_stats(&duplicate, &block_infos[i]);
+                    continue;
+                }
+                guarantee(uint32_t(prev.relative_offset_in_dblocks * DEVICE_BLOCK_SIZE)
+                          + aligned_value(prev.block_size)
+                          <= uint32_t(block_infos[i].relative_offset_in_dblocks
+                                      * DEVICE_BLOCK_SIZE));
+            }
+            block_infos[num_unique] = block_infos[i];
+            ++num_unique;
+        }
+        block_infos.erase(block_infos.begin() + num_unique, block_infos.end());
+    }
+
     void make_active() {
         guarantee(state == state_reconstructing);
         state = state_active;
@@ -360,6 +425,15 @@ public:
     // When we started writing to the extent (this time).
     const kiloticks_t timestamp;
 
+    // When a block was last read from the extent, or when we started writing to it if
+    // that was later.  Reads that the cache serves don't count.
+    kiloticks_t last_access;
+
+    // Which generation the blocks in the extent belong to.  We don't know for
+    // reconstructed extents, so they're treated as generation 0, unless they're on the
+    // cold tier.
+    const unsigned int generation;
+
     // The PQ entry pointing to us.
     priority_queue_t<gc_entry_t *, gc_entry_less_t>::entry_t *our_pq_entry;
 
@@ -369,8 +443,8 @@ public:
     enum state_t {
         // It has been, or is being, reconstructed from data on disk.
         state_reconstructing,
-        // We are currently putting things on this extent. It is equal to
-        // last_data_extent.
+        // We are currently putting things on this extent. It is in
+        // `active_extents`.
         state_active,
         // Not active, but not a GC candidate yet. It is in young_extent_queue.
         state_young,
@@ -407,7 +481,8 @@ data_block_manager_t::data_block_manager_t(
       /* The capacity of the gc_index_write_semaphore will be scaled
       based on the active number of GC threads. */
       gc_index_write_semaphore(1),
-      gc_stats(stats)
+      gc_stats(stats),
+      cold_migration_active(false)
 {
     rassert(static_config != nullptr);
     rassert(extent_manager != nullptr);
@@ -436,7 +511,8 @@ void data_block_manager_t::mark_live(int64_t offset, block_size_t ser_block_size
     if (entries.get(extent_id) == nullptr) {
         guarantee(state == state_unstarted); // This is called at startup.
 
-        gc_entry_t *entry = new gc_entry_t(this, extent_id * extent_manager->extent_size);
+        const int64_t extent_offset = extent_id * extent_manager->extent_size;
+        gc_entry_t *entry = new gc_entry_t(this, extent_offset);
         reconstructed_extents.push_back(entry);
     }
 
@@ -453,12 +529,17 @@ void data_block_manager_t::start_existing(
         const dbm_metablock_mixin_t *last_metablock) {
     guarantee(state == state_unstarted);
     dbfile = file;
-    gc_io_account_nice.init(new file_account_t(file, GC_IO_PRIORITY_NICE));
-    gc_io_account_high.init(new file_account_t(file, GC_IO_PRIORITY_HIGH));
+    gc_io_account_nice.init(new file_account_t(file, io_class_t::gc, GC_IO_PRIORITY_NICE,
+                                               GC_NICE_OUTSTANDING_REQUESTS_LIMIT));
+    gc_io_account_high.init(new file_account_t(file, io_class_t::gc,
+                                               GC_IO_PRIORITY_HIGH));
 
     /* Reconstruct the active data block extents from the metablock. */
     const int64_t offset = last_metablock->active_extent;
 
+    for (unsigned int i = 0; i < DBM_NUM_GENERATIONS; ++i) {
+        active_extents[i] = nullptr;
+    }
     if (offset != NULL_OFFSET) {
         /* It is (perhaps) possible to have an active data block extent with no
            actual data blocks in it. In this case we would not have created a
@@ -468,16 +549,16 @@ void data_block_manager_t::start_existing(
             reconstructed_extents.push_back(e);
         }
 
-        active_extent = entries.get(offset / extent_manager->extent_size);
+        gc_entry_t *active_extent = entries.get(offset / extent_manager->extent_size);
         guarantee(active_extent != nullptr);
 
         /* Turn the extent from a reconstructing extent into an active extent */
         guarantee(active_extent->state == gc_entry_t::state_reconstructing);
         reconstructed_extents.remove(active_extent);
 
+        active_extent->finish_reconstruct();
         active_extent->make_active();
-    } else {
-        active_extent = nullptr;
+        active_extents[0] = active_extent;
     }
 
     /* Convert any extents that we found live blocks in, but that are not active
@@ -485,7 +566,7 @@ void data_block_manager_t::start_existing(
     while (gc_entry_t *entry = reconstructed_extents.head()) {
         reconstructed_extents.remove(entry);
 
-        guarantee(entry->state == gc_entry_t::state_reconstructing);
+        entry->finish_reconstruct();
         entry->state = gc_entry_t::state_old;
         entry->shrink_to_fit();
 
@@ -496,6 +577,12 @@ void data_block_manager_t::start_existing(
     }
 
     state = state_ready;
+
+    if (extent_manager->has_cold_tier()
+        && serializer->dynamic_config.cold_extent_age_secs > 0) {
+        cold_migration_timer.init(new repeating_timer_t(
+            COLD_MIGRATION_INTERVAL_MS, [this]() { start_cold_migration(); }));
+    }
 }
 
 // Computes an offset and end offset for the purposes of readahead.  Returns an interval
@@ -699,6 +786,7 @@ bool data_block_manager_t::should_perform_read_ahead(int64_t offset) {
 buf_ptr_t data_block_manager_t::read(int64_t off_in, block_size_t block_size,
                                    file_account_t *io_account) {
     guarantee(state == state_ready);
+    entries.get(static_config->extent_index(off_in))->last_access = get_kiloticks();
     if (should_perform_read_ahead(off_in)) {
         buf_ptr_t ret = buf_ptr_t::alloc_uninitialized(block_size);
         dbm_read_ahead_t::perform_read_ahead(this, off_in, block_size.ser_value(),
@@ -736,17 +824,27 @@ buf_ptr_t data_block_manager_t::read(int64_t off_in, block_size_t block_size,
     }
 }
 
-// Sets maybe_checksum_out if one was computed, or sets it to zero otherwise.
 std::vector<counted_t<block_token_t>>
 data_block_manager_t::many_writes(const buf_write_info_t *writes,
                                   size_t writes_count,
                                   file_account_t *io_account,
                                   iocallback_t *cb) {
+    return many_writes_to_generation(writes, writes_count, 0, io_account, cb);
+}
+
+// Sets maybe_checksum_out if one was computed, or sets it to zero otherwise.
+std::vector<counted_t<block_token_t>>
+data_block_manager_t::many_writes_to_generation(const buf_write_info_t *writes,
+                                                size_t writes_count,
+                                                unsigned int generation,
+                                                file_account_t *io_account,
+                                                iocallback_t *cb) {
     // These tokens are grouped by extent.  You can do a contiguous write in each
     // extent.
     uint64_t cumulative_aligned_size;
     std::vector<std::vector<counted_t<block_token_t>>> token_groups
-        = gimme_some_new_offsets(writes, writes_count, &cumulative_aligned_size);
+        = gimme_some_new_offsets(writes, writes_count, generation,
+                                 &cumulative_aligned_size);
     const bool wants_checksum
         = cumulative_aligned_size <= serializer->dynamic_config.checksum_threshold;
 
@@ -804,7 +902,8 @@ data_block_manager_t::many_writes(const buf_write_info_t *writes,
             void *buf = writes[write_number].buf;
             if (wants_checksum) {
                 size_t wordcount = j_aligned_size / serializer_checksum::word_size;
-                serializer_checksum chksum = compute_checksum(buf, wordcount);
+                serializer_checksum chksum = compute_checksum(
+                    extent_manager->checksum_algorithm, buf, wordcount);
                 token->checksum_ = chksum;
             }
 
@@ -821,6 +920,11 @@ data_block_manager_t::many_writes(const buf_write_info_t *writes,
                              std::move(iovecs), io_account, intermediate_cb);
 
         stats->bytes_written(total_aligned_size);
+        if (generation == 0) {
+            stats->pm_serializer_data_written_bytes_total += total_aligned_size;
+        } else {
+            stats->pm_serializer_gc_written_bytes_total += total_aligned_size;
+        }
     }
 
     // Call on_io_complete for degenerate case (we added 1 to ops_remaining
@@ -935,6 +1039,17 @@ size_t data_block_manager_t::compute_gc_concurrency() const {
     }
 }
 
+bool data_block_manager_t::should_throttle_gc() {
+    // Once we're running out of space, getting the garbage down is more important
+    // than the latency of other requests.
+    if (garbage_ratio() > GC_HIGH_RATIO) {
+        return false;
+    }
+    const file_load_t load = dbfile->get_load();
+    return load.outstanding_requests > GC_THROTTLE_OUTSTANDING_REQUESTS
+        || load.average_latency_nanos > GC_THROTTLE_LATENCY_NANOS;
+}
+
 file_account_t *data_block_manager_t::choose_gc_io_account() {
     // Start going into high priority as soon as the garbage ratio is more than
     // GC_HIGH_RATIO.
@@ -1033,26 +1148,87 @@ void data_block_manager_t::run_gc(gc_state_t *gc_state) {
     while (!gc_pq.empty()
            && should_we_keep_gcing()
            && !should_terminate_one_gc_thread()) {
-        gc_one_extent(gc_state);
+        if (should_throttle_gc()) {
+            ++stats->pm_serializer_gc_throttle_pauses;
+            nap(GC_THROTTLE_NAP_MS);
+        } else {
+            gc_one_extent(gc_state, gc_pq.peak());
+        }
 
         if (state == state_shutting_down) {
-            active_gcs.remove(gc_state);
-            gc_index_write_semaphore.set_capacity(
-                std::max<int64_t>(1, active_gcs.size()));
-            delete gc_state;
-            if (active_gcs.empty()) {
-                actually_shutdown();
-            }
-            return;
+            break;
         }
     }
 
+    end_gc(gc_state);
+}
+
+void data_block_manager_t::end_gc(gc_state_t *gc_state) {
     active_gcs.remove(gc_state);
     gc_index_write_semaphore.set_capacity(std::max<int64_t>(1, active_gcs.size()));
     delete gc_state;
+    if (state == state_shutting_down && active_gcs.empty()) {
+        actually_shutdown();
+    }
+}
+
+void data_block_manager_t::start_cold_migration() {
+    if (state != state_ready || !gc_enabled || cold_migration_active) {
+        return;
+    }
+    cold_migration_active = true;
+    gc_state_t *new_gc_state = new gc_state_t();
+    new_gc_state->to_cold_tier = true;
+    active_gcs.push_back(new_gc_state);
+    gc_index_write_semaphore.set_capacity(std::max<int64_t>(1, active_gcs.size()));
+    coro_t::spawn_sometime(std::bind(&data_block_manager_t::run_cold_migration, this,
+                                     new_gc_state));
+}
+
+void data_block_manager_t::run_cold_migration(gc_state_t *gc_state) {
+    // The extents of the fast tier are the ones that fit in its file.
+    std::vector<uint64_t> extent_ids;
+    {
+        ASSERT_NO_CORO_WAITING;
+        const uint64_t num_extents =
+            dbfile->get_file_size() / static_config->extent_size();
+        for (uint64_t extent_id = 0; extent_id < num_extents; ++extent_id) {
+            gc_entry_t *entry = entries.get(extent_id);
+            if (entry != nullptr && should_move_to_cold_tier(entry)) {
+                extent_ids.push_back(extent_id);
+            }
+        }
+    }
+
+    size_t i = 0;
+    while (i < extent_ids.size() && gc_enabled && state == state_ready) {
+        if (should_throttle_gc()) {
+            ++stats->pm_serializer_gc_throttle_pauses;
+            nap(GC_THROTTLE_NAP_MS);
+        } else {
+            // The extent may have been GCed or read from since we looked at it.
+            gc_entry_t *entry = entries.get(extent_ids[i]);
+            if (entry != nullptr && should_move_to_cold_tier(entry)) {
+                ++stats->pm_serializer_data_extents_moved_cold;
+                gc_one_extent(gc_state, entry);
+            }
+            ++i;
+        }
+    }
+
+    cold_migration_active = false;
+    end_gc(gc_state);
 }
 
-void data_block_manager_t::gc_one_extent(gc_state_t *gc_state) {
+bool data_block_manager_t::should_move_to_cold_tier(const gc_entry_t *entry) const {
+    const int64_t age_micros =
+        serializer->dynamic_config.cold_extent_age_secs * MILLION;
+    return entry->state == gc_entry_t::state_old
+        && entry->generation != DBM_COLD_GENERATION
+        && get_kiloticks().micros - entry->last_access.micros > age_micros;
+}
+
+void data_block_manager_t::gc_one_extent(gc_state_t *gc_state, gc_entry_t *entry) {
     // A buffer for blocks we're transferring.
     scoped_device_block_aligned_ptr_t<char> gc_blocks;
     size_t total_bytes_read = 0;
@@ -1087,9 +1263,10 @@ void data_block_manager_t::gc_one_extent(gc_state_t *gc_state) {
         ++stats->pm_serializer_data_extents_gced;
 
         /* grab the entry */
-        guarantee (!gc_pq.empty());
+        guarantee(entry->state == gc_entry_t::state_old);
         guarantee(gc_state->current_entry == nullptr);
-        gc_state->current_entry = gc_pq.pop();
+        gc_pq.remove(entry->our_pq_entry);
+        gc_state->current_entry = entry;
         gc_state->current_entry->our_pq_entry = nullptr;
 
         guarantee(gc_state->current_entry->state == gc_entry_t::state_old);
@@ -1241,6 +1418,11 @@ void data_block_manager_t::write_gcs(
         scoped_device_block_aligned_ptr_t<char> &&gc_blocks,
         new_semaphore_in_line_t &&index_write_semaphore_acq) {
     guarantee(gc_state->current_entry != nullptr);
+    const unsigned int generation =
+        gc_state->to_cold_tier
+            || gc_state->current_entry->generation == DBM_COLD_GENERATION
+        ? DBM_COLD_GENERATION
+        : std::min(gc_state->current_entry->generation + 1, DBM_COLD_GENERATION - 1);
 
     block_write_cond_t block_write_cond;
 
@@ -1271,9 +1453,11 @@ void data_block_manager_t::write_gcs(
                                                   writes[i].buf->ser_header.block_id));
         }
 
-        new_block_tokens = many_writes(the_writes.data(), the_writes.size(),
-                                       choose_gc_io_account(),
-                                       &block_write_cond);
+        new_block_tokens = many_writes_to_generation(the_writes.data(),
+                                                     the_writes.size(),
+                                                     generation,
+                                                     choose_gc_io_account(),
+                                                     &block_write_cond);
 
         guarantee(new_block_tokens.size() == writes.size());
     }
@@ -1387,8 +1571,8 @@ void data_block_manager_t::flush_gc_index_writes(signal_t *) {
 void data_block_manager_t::prepare_metablock(dbm_metablock_mixin_t *metablock) {
     guarantee(state == state_ready || state == state_shutting_down);
 
-    if (active_extent != nullptr) {
-        metablock->active_extent = active_extent->extent_ref.offset();
+    if (active_extents[0] != nullptr) {
+        metablock->active_extent = active_extents[0]->extent_ref.offset();
     } else {
         metablock->active_extent = NULL_OFFSET;
     }
@@ -1402,6 +1586,7 @@ bool data_block_manager_t::shutdown(data_block_manager::shutdown_callback_t *cb)
     rassert(cb != nullptr);
     guarantee(state == state_ready);
     state = state_shutting_down;
+    cold_migration_timer.reset();
 
     if (!active_gcs.empty()) {
         shutdown_callback = cb;
@@ -1419,10 +1604,12 @@ void data_block_manager_t::actually_shutdown() {
 
     guarantee(reconstructed_extents.head() == nullptr);
 
-    if (active_extent != nullptr) {
-        UNUSED int64_t extent = active_extent->extent_ref.release();
-        delete active_extent;
-        active_extent = nullptr;
+    for (unsigned int i = 0; i < DBM_NUM_GENERATIONS; ++i) {
+        if (active_extents[i] != nullptr) {
+            UNUSED int64_t extent = active_extents[i]->extent_ref.release();
+            delete active_extents[i];
+            active_extents[i] = nullptr;
+        }
     }
 
     while (gc_entry_t *entry = young_extent_queue.head()) {
@@ -1447,16 +1634,18 @@ void data_block_manager_t::actually_shutdown() {
 std::vector<std::vector<counted_t<block_token_t>>>
 data_block_manager_t::gimme_some_new_offsets(const buf_write_info_t *writes,
                                              size_t writes_count,
+                                             unsigned int generation,
                                              uint64_t *cumulative_aligned_size_out) {
     ASSERT_NO_CORO_WAITING;
+    guarantee(generation < DBM_NUM_GENERATIONS);
+    gc_entry_t *&active_extent = active_extents[generation];
 
     // Start a new extent if necessary.
     if (active_extent == nullptr) {
-        active_extent = new gc_entry_t(this);
+        active_extent = new gc_entry_t(this, generation);
         ++stats->pm_serializer_data_extents_allocated;
     }
 
-
     guarantee(active_extent->state == gc_entry_t::state_active);
 
     std::vector<std::vector<counted_t<block_token_t>>> ret;
@@ -1474,14 +1663,14 @@ data_block_manager_t::gimme_some_new_offsets(const buf_write_info_t *writes,
             // not already empty), and make a new gc_entry_t.
             if (active_extent->num_live_blocks() == 0) {
                 gc_entry_t *old_active_extent = active_extent;
-                active_extent = new gc_entry_t(this);
+                active_extent = new gc_entry_t(this, generation);
                 destroy_entry(old_active_extent);
             } else {
                 active_extent->state = gc_entry_t::state_young;
                 active_extent->shrink_to_fit();
                 young_extent_queue.push_back(active_extent);
                 mark_unyoung_entries();
-                active_extent = new gc_entry_t(this);
+                active_extent = new gc_entry_t(this, generation);
             }
 
             ++stats->pm_serializer_data_extents_allocated;
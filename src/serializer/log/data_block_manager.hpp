@@ -22,6 +22,7 @@ class buf_ptr_t;
 class log_serializer_t;
 class data_block_manager_t;
 class gc_entry_t;
+class repeating_timer_t;
 
 struct dbm_metablock_mixin_t;
 
@@ -33,6 +34,20 @@ namespace data_block_manager {
 struct shutdown_callback_t;  // see log_serializer.hpp.
 }  // namespace data_block_manager
 
+/* Blocks that GC moves are written to a different active extent than new blocks, and
+blocks that GC moves again go to yet another one.  A block that has survived GC is
+likely to be long-lived, so this keeps cold blocks apart from blocks that are about to
+be overwritten, and GC doesn't have to copy the same cold blocks over and over.
+Generation 0 holds newly written blocks; blocks from generation `g` get moved to
+generation `g + 1`, up to the one before `DBM_COLD_GENERATION`.
+
+The cold generation is only used if the serializer file has a cold tier, which its
+extents are on.  The blocks of extents that haven't been read from or written to for the
+serializer's `cold_extent_age_secs` are moved there, and they stay there when GC moves
+them again. */
+const unsigned int DBM_NUM_GENERATIONS = 4;
+const unsigned int DBM_COLD_GENERATION = DBM_NUM_GENERATIONS - 1;
+
 class data_block_manager_t {
     friend class gc_entry_t;
     friend class dbm_read_ahead_t;
@@ -94,6 +109,7 @@ public:
 
     std::vector<std::vector<counted_t<block_token_t> > >
     gimme_some_new_offsets(const buf_write_info_t *writes, size_t writes_count,
+                           unsigned int generation,
                            uint64_t *cumulative_aligned_size_out);
 
     bool is_gc_active() const;
@@ -101,6 +117,14 @@ public:
 private:
     void actually_shutdown();
 
+    // Like `many_writes()`, but puts the blocks on the active extent of `generation`.
+    std::vector<counted_t<block_token_t> >
+    many_writes_to_generation(const buf_write_info_t *writes,
+                              size_t writes_count,
+                              unsigned int generation,
+                              file_account_t *io_account,
+                              iocallback_t *cb);
+
     struct gc_state_t : public intrusive_list_node_t<gc_state_t>{
     public:
         // The entry we're currently GCing.
@@ -109,8 +133,11 @@ private:
         // That will cause the GC to abort.
         gc_entry_t *current_entry;
 
+        // Whether the blocks go to the cold tier.
+        bool to_cold_tier;
+
         gc_state_t()
-            : current_entry(nullptr) { }
+            : current_entry(nullptr), to_cold_tier(false) { }
     };
 
     struct gc_write_t {
@@ -127,7 +154,21 @@ private:
     we should keep GCing. */
     void run_gc(gc_state_t *gc_state);
 
-    void gc_one_extent(gc_state_t *gc_state);
+    // GCs `entry`, which must be in `gc_pq`.
+    void gc_one_extent(gc_state_t *gc_state, gc_entry_t *entry);
+
+    // Removes a GC coroutine's state once it's done, and finishes shutting down if
+    // it's the last one.
+    void end_gc(gc_state_t *gc_state);
+
+    // Starts moving cold extents to the cold tier, unless that's already going on.
+    void start_cold_migration();
+
+    /* Runs in a coroutine and GCs the extents that should be moved to the cold
+    tier onto it. */
+    void run_cold_migration(gc_state_t *gc_state);
+
+    bool should_move_to_cold_tier(const gc_entry_t *entry) const;
 
     void write_gcs(
         std::vector<gc_write_t> &&writes,
@@ -144,6 +185,9 @@ private:
     // Picks an i/o account for GC to use, based on the current garbage rate
     file_account_t *choose_gc_io_account();
 
+    // Tells if GC should hold back because the disk is busy with other requests.
+    bool should_throttle_gc();
+
     // Checks whether the extent is empty and if it is, notifies the extent manager
     // and cleans up
     void check_and_handle_empty_extent(uint64_t extent_id);
@@ -198,8 +242,11 @@ private:
     /* Contains every extent in the gc_entry_t::state_reconstructing state */
     intrusive_list_t<gc_entry_t> reconstructed_extents;
 
-    /* Contains the extent in the gc_entry_t::state_active state. */
-    gc_entry_t *active_extent;
+    /* Contains the extents in the gc_entry_t::state_active state, one per generation.
+    Only the one for generation 0 gets recorded in the metablock.  On restart the
+    others are reconstructed like any other extent, and their unused space counts as
+    garbage. */
+    gc_entry_t *active_extents[DBM_NUM_GENERATIONS];
 
     /* Contains every extent in the gc_entry_t::state_young state */
     intrusive_list_t<gc_entry_t> young_extent_queue;
@@ -269,6 +316,11 @@ private:
 
     gc_stats_t gc_stats;
 
+    /* Starts moving cold extents now and then, if there's a cold tier to move them
+    to. */
+    scoped_ptr_t<repeating_timer_t> cold_migration_timer;
+    bool cold_migration_active;
+
     DISABLE_COPYING(data_block_manager_t);
 };
 
@@ -1,6 +1,7 @@
 // Copyright 2010-2014 RethinkDB, all rights reserved.
 #include "serializer/log/extent_manager.hpp"
 
+#include <algorithm>
 #include <queue>
 
 #include "arch/arch.hpp"
@@ -44,9 +45,14 @@ public:
 class extent_zone_t {
     const uint64_t extent_size;
 
+    // Where the zone starts in the serializer file.  The zone's extents are at
+    // `base_offset` and after it, and at the offsets relative to it in `dbfile`.
+    const int64_t base_offset;
+
     size_t offset_to_id(int64_t extent) const {
-        rassert(divides(extent_size, extent));
-        return extent / extent_size;
+        rassert(extent >= base_offset);
+        rassert(divides(extent_size, extent - base_offset));
+        return (extent - base_offset) / extent_size;
     }
 
     /* free-list and extent map. Contains one entry per extent.  During the
@@ -76,9 +82,28 @@ public:
         return held_extents_;
     }
 
-    extent_zone_t(file_t *_dbfile, uint64_t _extent_size,
+    extent_free_space_t free_space() const {
+        extent_free_space_t res{0, 0, 0};
+        size_t run = 0;
+        for (const extent_info_t &info : extents) {
+            if (info.state() == extent_info_t::state_free) {
+                ++res.free_extents;
+                if (run == 0) {
+                    ++res.free_runs;
+                }
+                ++run;
+                res.largest_free_run = std::max(res.largest_free_run, run);
+            } else {
+                run = 0;
+            }
+        }
+        return res;
+    }
+
+    extent_zone_t(file_t *_dbfile, uint64_t _extent_size, int64_t _base_offset,
                   log_serializer_stats_t *_stats)
-        : extent_size(_extent_size), dbfile(_dbfile), stats(_stats), held_extents_(0) {
+        : extent_size(_extent_size), base_offset(_base_offset), dbfile(_dbfile),
+          stats(_stats), held_extents_(0) {
         // (Avoid a bunch of reallocations by resize calls (avoiding O(n log n)
         // work on average).)
         extents.reserve(dbfile->get_file_size() / extent_size);
@@ -117,7 +142,7 @@ public:
 
         if (free_queue.empty()) {
             rassert(held_extents_ == 0);
-            extent = extents.size() * extent_size;
+            extent = base_offset + extents.size() * extent_size;
             extents.push_back(extent_info_t());
         } else if (free_queue.top() >= extents.size()) {
             rassert(held_extents_ == 0);
@@ -125,10 +150,10 @@ public:
                                 std::vector<size_t>,
                                 std::greater<size_t> > tmp;
             free_queue = tmp;
-            extent = extents.size() * extent_size;
+            extent = base_offset + extents.size() * extent_size;
             extents.push_back(extent_info_t());
         } else {
-            extent = free_queue.top() * extent_size;
+            extent = base_offset + free_queue.top() * extent_size;
             free_queue.pop();
             --held_extents_;
         }
@@ -144,7 +169,8 @@ public:
             // the way it handles multi-threading.
             // So we calculate the *change* in file size and update it accordingly.
             const int64_t old_file_size = dbfile->get_file_size();
-            dbfile->set_file_size_at_least(extent + extent_size, extent_size);
+            dbfile->set_file_size_at_least(extent - base_offset + extent_size,
+                                           extent_size);
             stats->pm_file_size_bytes += dbfile->get_file_size() - old_file_size;
         }
 
@@ -160,6 +186,10 @@ public:
         return extent_reference_t(extent);
     }
 
+    bool contains(int64_t extent) const {
+        return extent >= base_offset;
+    }
+
     void try_shrink_file() {
         // Now potentially shrink the file.
         bool shrink_file = false;
@@ -222,10 +252,16 @@ extent_manager_t::extent_manager_t(file_t *file,
                                    const log_serializer_on_disk_static_config_t *static_config,
                                    log_serializer_stats_t *_stats)
     : stats(_stats), extent_size(static_config->extent_size()),
+      checksum_algorithm(checksum_algorithm_t::fletcher64),
       state(state_reserving_extents) {
     guarantee(divides(DEVICE_BLOCK_SIZE, extent_size));
 
-    zone.init(new extent_zone_t(file, extent_size, stats));
+    zone.init(new extent_zone_t(file, extent_size, 0, stats));
+    if (file->cold_tier() != nullptr) {
+        guarantee(divides(extent_size, SERIALIZER_COLD_TIER_OFFSET));
+        cold_zone.init(new extent_zone_t(file->cold_tier(), extent_size,
+                                         SERIALIZER_COLD_TIER_OFFSET, stats));
+    }
 }
 
 extent_manager_t::~extent_manager_t() {
@@ -236,7 +272,23 @@ extent_reference_t extent_manager_t::reserve_extent(int64_t extent) {
     assert_thread();
     rassert(state == state_reserving_extents);
     ++stats->pm_extents_in_use;
-    return zone->reserve_extent(extent);
+    return zone_for(extent)->reserve_extent(extent);
+}
+
+bool extent_manager_t::in_cold_tier(int64_t extent) {
+    return extent >= SERIALIZER_COLD_TIER_OFFSET;
+}
+
+extent_zone_t *extent_manager_t::zone_for(int64_t extent) {
+    if (cold_zone.has() && cold_zone->contains(extent)) {
+        return cold_zone.get();
+    }
+    guarantee(!in_cold_tier(extent), "An extent is in a cold tier that doesn't exist.");
+    return zone.get();
+}
+
+bool extent_manager_t::has_cold_tier() const {
+    return cold_zone.has();
 }
 
 void extent_manager_t::prepare_initial_metablock(extent_manager_metablock_mixin_t *mb) {
@@ -248,8 +300,10 @@ void extent_manager_t::start_existing() {
     rassert(state == state_reserving_extents);
     current_transaction = nullptr;
     zone->reconstruct_free_list();
+    if (cold_zone.has()) {
+        cold_zone->reconstruct_free_list();
+    }
     state = state_running;
-
 }
 
 void extent_manager_t::prepare_metablock(extent_manager_metablock_mixin_t *metablock) {
@@ -272,18 +326,19 @@ void extent_manager_t::begin_transaction(extent_transaction_t *out) {
     out->init();
 }
 
-extent_reference_t extent_manager_t::gen_extent() {
+extent_reference_t extent_manager_t::gen_extent(bool cold_tier) {
     assert_thread();
     rassert(state == state_running);
+    guarantee(!cold_tier || cold_zone.has());
     ++stats->pm_extents_in_use;
 
-    return zone->gen_extent();
+    return cold_tier ? cold_zone->gen_extent() : zone->gen_extent();
 }
 
 extent_reference_t
 extent_manager_t::copy_extent_reference(const extent_reference_t &extent_ref) {
     int64_t offset = extent_ref.offset();
-    return zone->make_extent_reference(offset);
+    return zone_for(offset)->make_extent_reference(offset);
 }
 
 void extent_manager_t::release_extent_into_transaction(extent_reference_t &&extent_ref,
@@ -295,7 +350,8 @@ void extent_manager_t::release_extent_into_transaction(extent_reference_t &&exte
 
 void extent_manager_t::release_extent(extent_reference_t &&extent_ref) {
     release_extent_preliminaries();
-    zone->release_extent(std::move(extent_ref));
+    extent_zone_t *extent_zone = zone_for(extent_ref.offset());
+    extent_zone->release_extent(std::move(extent_ref));
 }
 
 void extent_manager_t::release_extent_preliminaries() {
@@ -317,11 +373,17 @@ void extent_manager_t::commit_transaction(extent_transaction_t *t) {
     assert_thread();
     std::vector<extent_reference_t> extents = t->reset();
     for (auto it = extents.begin(); it != extents.end(); ++it) {
-        zone->release_extent(std::move(*it));
+        extent_zone_t *extent_zone = zone_for(it->offset());
+        extent_zone->release_extent(std::move(*it));
     }
 }
 
 size_t extent_manager_t::held_extents() {
     assert_thread();
-    return zone->held_extents();
+    return zone->held_extents() + (cold_zone.has() ? cold_zone->held_extents() : 0);
+}
+
+extent_free_space_t extent_manager_t::free_space() {
+    assert_thread();
+    return zone->free_space();
 }
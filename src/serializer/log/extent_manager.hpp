@@ -12,6 +12,7 @@
 #include "arch/types.hpp"
 #include "config/args.hpp"
 #include "containers/scoped.hpp"
+#include "serializer/checksum.hpp"
 #include "serializer/log/config.hpp"
 
 #define NULL_OFFSET int64_t(-1)
@@ -19,6 +20,15 @@
 class extent_zone_t;
 
 struct log_serializer_stats_t;
+
+/* How the free extents are spread over the file.  Free extents past the last extent in
+use aren't counted, since the file is shrunk to get rid of them. */
+struct extent_free_space_t {
+    size_t free_extents;
+    // The number of maximal runs of adjacent free extents.
+    size_t free_runs;
+    size_t largest_free_run;
+};
 struct extent_manager_metablock_mixin_t;
 
 // A reference to an extent in the extent manager.  An extent may not be freed until
@@ -121,7 +131,9 @@ public:
     MUST_USE extent_reference_t copy_extent_reference(const extent_reference_t &copyee);
 
     void begin_transaction(extent_transaction_t *out);
-    MUST_USE extent_reference_t gen_extent();
+    // Takes an extent from the file's cold tier if `cold_tier` is true, which requires
+    // that the file has one.
+    MUST_USE extent_reference_t gen_extent(bool cold_tier = false);
     void release_extent_into_transaction(extent_reference_t &&extent_ref,
                                          extent_transaction_t *txn);
     void release_extent(extent_reference_t &&extent_ref);
@@ -131,13 +143,30 @@ public:
     /* Number of extents that have been released but not handed back out again. */
     size_t held_extents();
 
+    /* Walks the whole extent map of the fast tier, so it's meant for benchmarks and
+    debugging. */
+    extent_free_space_t free_space();
+
+    /* If the file is tiered (see `tiered_file_t`), the extents at
+    `SERIALIZER_COLD_TIER_OFFSET` and after it are on its cold tier. */
+    bool has_cold_tier() const;
+    static bool in_cold_tier(int64_t extent);
+
     log_serializer_stats_t *const stats;
     const uint64_t extent_size;   /* Same as static_config->extent_size */
 
+    /* The algorithm that writes to the file are checksummed with.  The metablock
+    manager sets this from the file's latest metablock when the file is opened. */
+    checksum_algorithm_t checksum_algorithm;
+
 private:
     void release_extent_preliminaries();
 
+    extent_zone_t *zone_for(int64_t extent);
+
     scoped_ptr_t<extent_zone_t> zone;
+    // Null if the file has no cold tier.
+    scoped_ptr_t<extent_zone_t> cold_zone;
 
     /* During serializer startup, each component informs the extent manager
     which extents in the file it was using at shutdown. This is the
@@ -3,8 +3,241 @@
 
 #include <inttypes.h>
 
+#include <utility>
+
+#include "arch/runtime/memory_usage.hpp"
+#include "containers/scoped.hpp"
 #include "serializer/log/lba/disk_format.hpp"
 
+namespace {
+
+const size_t CHUNK_SIZE = 1 << 14;
+
+// A narrow offset is the distance from the chunk's base in device blocks, plus one,
+// so that zero can stand for `flagged_off64_t::unused()`.
+const uint32_t NARROW_NO_OFFSET = 0;
+// A narrow recency is the distance from the chunk's base.
+const uint32_t NARROW_INVALID_RECENCY = UINT32_MAX;
+
+// The bases are put in the middle of the range a narrow value can cover, because the
+// values that come later can be smaller as well as bigger than the first one.
+const uint64_t NARROW_WINDOW_BEFORE_BASE = 1u << 31;
+
+uint64_t window_base(uint64_t first_value) {
+    return first_value > NARROW_WINDOW_BEFORE_BASE
+        ? first_value - NARROW_WINDOW_BEFORE_BASE
+        : 0;
+}
+
+}  // namespace
+
+class compact_block_info_array_t::chunk_t {
+public:
+    explicit chunk_t(const index_block_info_t &first_info)
+        : count(0),
+          offset_base(first_info.offset.has_value()
+                      ? window_base(first_info.offset.get_value() / DEVICE_BLOCK_SIZE)
+                      : 0),
+          recency_base(repli_timestamp_t::invalid) {
+        narrow_offsets.init(CHUNK_SIZE);
+        for (size_t i = 0; i < CHUNK_SIZE; ++i) {
+            narrow_offsets[i] = NARROW_NO_OFFSET;
+            ser_block_sizes[i] = 0;
+        }
+    }
+
+    index_block_info_t get(size_t i) const {
+        return index_block_info_t(get_offset(i), get_recency(i), ser_block_sizes[i]);
+    }
+
+    void set(size_t i, const index_block_info_t &info) {
+        set_offset(i, info.offset);
+        set_recency(i, info.recency);
+        ser_block_sizes[i] = info.ser_block_size;
+    }
+
+    size_t memory_usage() const {
+        return sizeof(chunk_t)
+            + narrow_offsets.size() * sizeof(uint32_t)
+            + wide_offsets.size() * sizeof(flagged_off64_t)
+            + narrow_recencies.size() * sizeof(uint32_t)
+            + wide_recencies.size() * sizeof(repli_timestamp_t);
+    }
+
+    // The number of entries that aren't `index_block_info_t()`.
+    size_t count;
+
+private:
+    flagged_off64_t get_offset(size_t i) const {
+        if (wide_offsets.has()) {
+            return wide_offsets[i];
+        }
+        const uint32_t narrow = narrow_offsets[i];
+        if (narrow == NARROW_NO_OFFSET) {
+            return flagged_off64_t::unused();
+        }
+        return flagged_off64_t::make((offset_base + narrow - 1) * DEVICE_BLOCK_SIZE);
+    }
+
+    void set_offset(size_t i, flagged_off64_t offset) {
+        if (!wide_offsets.has()) {
+            uint32_t narrow;
+            if (narrow_offset(offset, &narrow)) {
+                narrow_offsets[i] = narrow;
+                return;
+            }
+            widen_offsets();
+        }
+        wide_offsets[i] = offset;
+    }
+
+    bool narrow_offset(flagged_off64_t offset, uint32_t *out) const {
+        if (!offset.has_value()) {
+            *out = NARROW_NO_OFFSET;
+            return offset == flagged_off64_t::unused();
+        }
+        const uint64_t value = offset.get_value();
+        const uint64_t device_blocks = value / DEVICE_BLOCK_SIZE;
+        if (device_blocks * DEVICE_BLOCK_SIZE != value
+            || device_blocks < offset_base
+            || device_blocks - offset_base >= UINT32_MAX) {
+            return false;
+        }
+        *out = device_blocks - offset_base + 1;
+        return true;
+    }
+
+    void widen_offsets() {
+        scoped_array_t<flagged_off64_t> wide(CHUNK_SIZE);
+        for (size_t i = 0; i < CHUNK_SIZE; ++i) {
+            wide[i] = get_offset(i);
+        }
+        wide_offsets = std::move(wide);
+        narrow_offsets.reset();
+    }
+
+    repli_timestamp_t get_recency(size_t i) const {
+        if (wide_recencies.has()) {
+            return wide_recencies[i];
+        }
+        if (!narrow_recencies.has() || narrow_recencies[i] == NARROW_INVALID_RECENCY) {
+            return repli_timestamp_t::invalid;
+        }
+        repli_timestamp_t ret;
+        ret.longtime = recency_base.longtime + narrow_recencies[i];
+        return ret;
+    }
+
+    void set_recency(size_t i, repli_timestamp_t recency) {
+        if (!wide_recencies.has()) {
+            if (!narrow_recencies.has()) {
+                if (recency == repli_timestamp_t::invalid) {
+                    return;
+                }
+                recency_base.longtime = window_base(recency.longtime);
+                narrow_recencies.init(CHUNK_SIZE);
+                for (size_t j = 0; j < CHUNK_SIZE; ++j) {
+                    narrow_recencies[j] = NARROW_INVALID_RECENCY;
+                }
+            }
+            if (recency == repli_timestamp_t::invalid) {
+                narrow_recencies[i] = NARROW_INVALID_RECENCY;
+                return;
+            }
+            if (recency >= recency_base
+                && recency.longtime - recency_base.longtime < NARROW_INVALID_RECENCY) {
+                narrow_recencies[i] = recency.longtime - recency_base.longtime;
+                return;
+            }
+            widen_recencies();
+        }
+        wide_recencies[i] = recency;
+    }
+
+    void widen_recencies() {
+        scoped_array_t<repli_timestamp_t> wide(CHUNK_SIZE);
+        for (size_t i = 0; i < CHUNK_SIZE; ++i) {
+            wide[i] = get_recency(i);
+        }
+        wide_recencies = std::move(wide);
+        narrow_recencies.reset();
+    }
+
+    const uint64_t offset_base;
+    repli_timestamp_t recency_base;
+
+    // Exactly one of `narrow_offsets` and `wide_offsets` is allocated.
+    scoped_array_t<uint32_t> narrow_offsets;
+    scoped_array_t<flagged_off64_t> wide_offsets;
+    // At most one of these is allocated; if neither is, all recencies are invalid.
+    scoped_array_t<uint32_t> narrow_recencies;
+    scoped_array_t<repli_timestamp_t> wide_recencies;
+    uint16_t ser_block_sizes[CHUNK_SIZE];
+
+    DISABLE_COPYING(chunk_t);
+};
+
+compact_block_info_array_t::compact_block_info_array_t()
+    : size_(0), memory_usage_(0) { }
+
+compact_block_info_array_t::~compact_block_info_array_t() {
+    for (chunk_t *chunk : chunks_) {
+        delete chunk;
+    }
+    add_memory_usage(memory_tag_t::LBA_INDEX, -static_cast<int64_t>(memory_usage_));
+}
+
+index_block_info_t compact_block_info_array_t::get(block_id_t id) const {
+    const size_t chunk_id = id / CHUNK_SIZE;
+    if (chunk_id >= chunks_.size() || chunks_[chunk_id] == nullptr) {
+        return index_block_info_t();
+    }
+    return chunks_[chunk_id]->get(id % CHUNK_SIZE);
+}
+
+void compact_block_info_array_t::set(block_id_t id, const index_block_info_t &info) {
+    const size_t chunk_id = id / CHUNK_SIZE;
+    const size_t index = id % CHUNK_SIZE;
+    const bool is_default = info == index_block_info_t();
+    if (chunk_id >= chunks_.size()) {
+        if (is_default) {
+            return;
+        }
+        chunks_.resize(chunk_id + 1, nullptr);
+    }
+
+    chunk_t *chunk = chunks_[chunk_id];
+    const int64_t old_memory_usage = memory_usage_;
+    if (chunk == nullptr) {
+        if (is_default) {
+            return;
+        }
+        chunk = new chunk_t(info);
+        chunks_[chunk_id] = chunk;
+    } else {
+        memory_usage_ -= chunk->memory_usage();
+    }
+
+    const bool was_default = chunk->get(index) == index_block_info_t();
+    chunk->set(index, info);
+    if (was_default && !is_default) {
+        ++chunk->count;
+        ++size_;
+    } else if (!was_default && is_default) {
+        --chunk->count;
+        --size_;
+    }
+
+    if (chunk->count == 0) {
+        delete chunk;
+        chunks_[chunk_id] = nullptr;
+    } else {
+        memory_usage_ += chunk->memory_usage();
+    }
+    add_memory_usage(memory_tag_t::LBA_INDEX,
+                     static_cast<int64_t>(memory_usage_) - old_memory_usage);
+}
+
 in_memory_index_t::in_memory_index_t()
     : end_block_id_(0), end_aux_block_id_(FIRST_AUX_BLOCK_ID) { }
 
@@ -18,11 +251,7 @@ block_id_t in_memory_index_t::end_aux_block_id() {
 
 index_block_info_t in_memory_index_t::get_block_info(block_id_t id) {
     if (is_aux_block_id(id)) {
-        index_aux_block_info_t aux_info
-            = aux_infos_.get(make_aux_block_id_relative(id));
-        return index_block_info_t(aux_info.offset,
-                                  repli_timestamp_t::invalid,
-                                  aux_info.ser_block_size);
+        return aux_infos_.get(make_aux_block_id_relative(id));
     } else {
         return infos_.get(id);
     }
@@ -39,7 +268,7 @@ void in_memory_index_t::set_block_info(block_id_t id, repli_timestamp_t recency,
         // other than `invalid`, you might be doing something wrong. It will be
         // discarded anyway.
         rassert(recency == repli_timestamp_t::invalid);
-        index_aux_block_info_t info(offset, ser_block_size);
+        index_block_info_t info(offset, repli_timestamp_t::invalid, ser_block_size);
         aux_infos_.set(make_aux_block_id_relative(id), info);
     } else {
         if (id >= end_block_id_) {
@@ -50,3 +279,10 @@ void in_memory_index_t::set_block_info(block_id_t id, repli_timestamp_t recency,
     }
 }
 
+size_t in_memory_index_t::num_block_infos() const {
+    return infos_.size() + aux_infos_.size();
+}
+
+size_t in_memory_index_t::memory_usage() const {
+    return infos_.memory_usage() + aux_infos_.memory_usage();
+}
@@ -2,8 +2,9 @@
 #ifndef SERIALIZER_LOG_LBA_IN_MEMORY_INDEX_HPP_
 #define SERIALIZER_LOG_LBA_IN_MEMORY_INDEX_HPP_
 
+#include <vector>
+
 #include "arch/compiler.hpp"
-#include "containers/two_level_array.hpp"
 #include "config/args.hpp"
 #include "serializer/serializer.hpp"
 #include "serializer/log/lba/disk_format.hpp"
@@ -21,7 +22,6 @@ ATTR_PACKED(struct index_block_info_t {
           recency(_recency),
           ser_block_size(_ser_block_size) { }
 
-    // For two_level_array_t.
     bool operator==(const index_block_info_t &other) const {
         return offset == other.offset &&
             recency == other.recency &&
@@ -33,35 +33,45 @@ ATTR_PACKED(struct index_block_info_t {
     uint16_t ser_block_size;
 });
 
-/* This is a reduced-size block info for auxiliary blocks (currently
-blob blocks used for large values). It doesn't store a replication
-timestamp, because we don't need it for those blocks. */
-ATTR_PACKED(struct index_aux_block_info_t {
-    index_aux_block_info_t()
-        : offset(flagged_off64_t::unused()),
-          ser_block_size(0) { }
+/* Stores an `index_block_info_t` for each block id, in much less than the 18 bytes
+that a plain array of them would take.  Ids are grouped in chunks, and only chunks
+with at least one non-default entry are allocated.
+
+Within a chunk, offsets are kept as 32-bit distances in device blocks from a base
+that's picked when the chunk is created.  Recencies are kept as 32-bit distances from
+a base as well, and the chunk doesn't store them at all until one of its entries gets
+a valid recency, which is never the case for aux blocks.  If a value doesn't fit, the
+chunk switches to storing all the values of that kind at full width.  So an entry
+usually takes 10 bytes, or 6 bytes without a recency. */
+class compact_block_info_array_t {
+public:
+    compact_block_info_array_t();
+    ~compact_block_info_array_t();
 
-    index_aux_block_info_t(flagged_off64_t _offset,
-                           uint16_t _ser_block_size)
-        : offset(_offset),
-          ser_block_size(_ser_block_size) { }
+    index_block_info_t get(block_id_t id) const;
+    void set(block_id_t id, const index_block_info_t &info);
 
-    // For two_level_array_t.
-    bool operator==(const index_aux_block_info_t &other) const {
-        return offset == other.offset &&
-            ser_block_size == other.ser_block_size;
-    }
+    // The number of ids with a non-default entry.
+    size_t size() const { return size_; }
+    // The bytes allocated for the chunks.
+    size_t memory_usage() const { return memory_usage_; }
 
-    flagged_off64_t offset;
-    uint16_t ser_block_size;
-});
+private:
+    class chunk_t;
 
+    std::vector<chunk_t *> chunks_;
+    size_t size_;
+    size_t memory_usage_;
 
+    DISABLE_COPYING(compact_block_info_array_t);
+};
 
 class in_memory_index_t {
-    two_level_array_t<index_block_info_t> infos_;
+    compact_block_info_array_t infos_;
     block_id_t end_block_id_;
-    two_level_array_t<index_aux_block_info_t> aux_infos_;
+    // Aux blocks (currently blob blocks used for large values) don't have a
+    // replication timestamp, because we don't need it for those blocks.
+    compact_block_info_array_t aux_infos_;
     block_id_t end_aux_block_id_;
 
 public:
@@ -75,6 +85,9 @@ public:
     void set_block_info(block_id_t id, repli_timestamp_t recency,
                         flagged_off64_t offset, uint16_t ser_block_size);
 
+    // The number of blocks that have an entry, and the memory the entries take.
+    size_t num_block_infos() const;
+    size_t memory_usage() const;
 };
 
 #endif  // SERIALIZER_LOG_LBA_IN_MEMORY_INDEX_HPP_
@@ -112,6 +112,7 @@ public:
                         static_cast<uint16_t>(e->ser_block_size));
             }
 
+            owner->update_index_stats();
             owner->state = lba_list_t::state_ready;
             if (callback) callback->on_lba_ready();
             delete this;
@@ -124,7 +125,7 @@ bool lba_list_t::start_existing(file_t *file, lba_metablock_mixin_t *last_metabl
     rassert(state == state_unstarted);
 
     dbfile = file;
-    gc_io_account.init(new file_account_t(dbfile, LBA_GC_IO_PRIORITY));
+    gc_io_account.init(new file_account_t(dbfile, io_class_t::gc, LBA_GC_IO_PRIORITY));
 
     lba_start_fsm_t *starter = new lba_start_fsm_t(this, last_metablock);
     if (state == state_ready) {
@@ -197,6 +198,7 @@ void lba_list_t::set_block_info(block_id_t block, repli_timestamp_t recency,
     rassert(state == state_ready || state == state_gc_shutting_down);
 
     in_memory_index.set_block_info(block, recency, offset, ser_block_size);
+    update_index_stats();
 
     // If the inline LBA is full, free it up first by moving its entries to
     // the LBA extents
@@ -213,6 +215,11 @@ bool lba_list_t::check_inline_lba_full() const {
     return inline_lba_entries_count == LBA_NUM_INLINE_ENTRIES;
 }
 
+void lba_list_t::update_index_stats() {
+    extent_manager->stats->pm_serializer_index_bytes_per_block.set(
+        in_memory_index.memory_usage(), in_memory_index.num_block_infos());
+}
+
 void lba_list_t::move_inline_entries_to_extents(
         file_account_t *io_account, extent_transaction_t *txn,
         optional<std::vector<checksum_filerange>> *checksums) {
@@ -127,6 +127,9 @@ private:
 
     lba_disk_structure_t *disk_structures[LBA_SHARD_FACTOR];
 
+    // Reports the size of `in_memory_index` to the stats.
+    void update_index_stats();
+
     // Garbage-collect the given shard
     void gc(int lba_shard, auto_drainer_t::lock_t gc_drainer_lock);
 
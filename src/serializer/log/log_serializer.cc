@@ -9,6 +9,8 @@
 #include <functional>
 
 #include "arch/io/disk.hpp"
+#include "arch/io/striped_file.hpp"
+#include "arch/io/tiered_file.hpp"
 #include "arch/runtime/runtime.hpp"
 #include "arch/runtime/coroutines.hpp"
 #include "buffer_cache/types.hpp"
@@ -16,12 +18,138 @@
 #include "logger.hpp"
 #include "perfmon/perfmon.hpp"
 #include "serializer/buf_ptr.hpp"
+#include "serializer/log/block_compression.hpp"
 #include "serializer/log/data_block_manager.hpp"
 
-filepath_file_opener_t::filepath_file_opener_t(const serializer_filepath_t &filepath,
-                                               io_backender_t *backender)
+/* Manifests are small text files next to a serializer file that say where its other
+parts are, one line each.  `what` names the kind of manifest in error messages. */
+
+// Returns false if there's no manifest at `path`.
+static bool read_manifest(const std::string &path, const char *what,
+                          std::vector<std::string> *lines_out) {
+    if (::access(path.c_str(), F_OK) != 0) {
+        return false;
+    }
+    std::string contents;
+    if (!blocking_read_file(path.c_str(), &contents)) {
+        crash("Could not read the %s %s (%s)\n",
+              what, path.c_str(), errno_string(get_errno()).c_str());
+    }
+    lines_out->clear();
+    size_t line_start = 0;
+    while (line_start < contents.size()) {
+        size_t line_end = contents.find('\n', line_start);
+        if (line_end == std::string::npos) {
+            line_end = contents.size();
+        }
+        lines_out->push_back(contents.substr(line_start, line_end - line_start));
+        line_start = line_end + 1;
+    }
+    return true;
+}
+
+static void write_manifest(const std::string &path, const char *what,
+                           const std::vector<std::string> &lines) {
+    std::string contents;
+    for (const std::string &line : lines) {
+        contents += line + "\n";
+    }
+    FILE *file = fopen(path.c_str(), "wb");
+    bool written = file != nullptr
+        && fwrite(contents.data(), 1, contents.size(), file) == contents.size()
+        && fflush(file) == 0;
+#ifndef _WIN32
+    written = written && fsync(fileno(file)) == 0;
+#endif
+    if (file != nullptr && fclose(file) != 0) {
+        written = false;
+    }
+    if (!written) {
+        crash("Could not write the %s %s (%s)\n",
+              what, path.c_str(), errno_string(get_errno()).c_str());
+    }
+    warn_fsync_parent_directory(path.c_str());
+}
+
+/* A striped file's stripe manifest holds a line with its magic, a line with the stripe
+size, and a line with the path of each of its stripes besides the file itself. */
+static const char *const stripe_manifest_magic = "rdbstripes01";
+
+static std::string stripe_manifest_path(const std::string &permanent_path) {
+    return permanent_path + ".stripes";
+}
+
+// Leaves the outputs alone if there's no manifest, which means that the file isn't
+// striped.
+static void read_stripe_manifest(const std::string &permanent_path,
+                                 int64_t *stripe_size_out,
+                                 std::vector<std::string> *extra_stripe_paths_out) {
+    const std::string path = stripe_manifest_path(permanent_path);
+    std::vector<std::string> lines;
+    if (!read_manifest(path, "stripe manifest", &lines)) {
+        return;
+    }
+    if (lines.size() < 2
+        || lines[0] != stripe_manifest_magic
+        || !strtoi64_strict(lines[1], 10, stripe_size_out)) {
+        crash("The stripe manifest %s is corrupted.\n", path.c_str());
+    }
+    extra_stripe_paths_out->assign(lines.begin() + 2, lines.end());
+}
+
+static void write_stripe_manifest(const std::string &permanent_path,
+                                  int64_t stripe_size,
+                                  const std::vector<std::string> &extra_stripe_paths) {
+    std::vector<std::string> lines;
+    lines.push_back(stripe_manifest_magic);
+    lines.push_back(strprintf("%" PRIi64, stripe_size));
+    lines.insert(lines.end(), extra_stripe_paths.begin(), extra_stripe_paths.end());
+    write_manifest(stripe_manifest_path(permanent_path), "stripe manifest", lines);
+}
+
+/* A tiered file's cold tier manifest holds a line with its magic and a line with the
+path of its cold tier. */
+static const char *const cold_tier_manifest_magic = "rdbcoldtier01";
+
+static std::string cold_tier_manifest_path(const std::string &permanent_path) {
+    return permanent_path + ".cold";
+}
+
+// Returns the empty string if there's no manifest, which means that the file isn't
+// tiered.
+static std::string read_cold_tier_manifest(const std::string &permanent_path) {
+    const std::string path = cold_tier_manifest_path(permanent_path);
+    std::vector<std::string> lines;
+    if (!read_manifest(path, "cold tier manifest", &lines)) {
+        return std::string();
+    }
+    if (lines.size() != 2 || lines[0] != cold_tier_manifest_magic || lines[1].empty()) {
+        crash("The cold tier manifest %s is corrupted.\n", path.c_str());
+    }
+    return lines[1];
+}
+
+static void write_cold_tier_manifest(const std::string &permanent_path,
+                                     const std::string &cold_tier_path) {
+    write_manifest(cold_tier_manifest_path(permanent_path), "cold tier manifest",
+                   std::vector<std::string>{cold_tier_manifest_magic, cold_tier_path});
+}
+
+// The name of the file at `path`, without its directory.
+static std::string file_base_name(const std::string &path) {
+    const size_t separator = path.rfind(PATH_SEPARATOR);
+    return separator == std::string::npos ? path : path.substr(separator + 1);
+}
+
+filepath_file_opener_t::filepath_file_opener_t(
+        const serializer_filepath_t &filepath,
+        io_backender_t *backender,
+        const std::vector<std::string> &stripe_dirs,
+        const std::string &cold_dir)
     : filepath_(filepath),
       backender_(backender),
+      stripe_dirs_(stripe_dirs),
+      cold_dir_(cold_dir),
       opened_temporary_(false) { }
 
 filepath_file_opener_t::~filepath_file_opener_t() { }
@@ -43,6 +171,24 @@ std::string filepath_file_opener_t::current_file_name() const {
     return opened_temporary_ ? temporary_file_name() : file_name();
 }
 
+std::vector<std::string> filepath_file_opener_t::new_extra_stripe_paths(
+        bool temporary) const {
+#ifdef _WIN32
+    // TODO WINDOWS: use temporary files
+    (void) temporary;
+    const char *suffix = "";
+#else
+    const char *suffix = temporary ? ".create" : "";
+#endif
+    // The stripes are named after the file itself.
+    const std::string name = file_base_name(file_name());
+    std::vector<std::string> paths;
+    for (const std::string &dir : stripe_dirs_) {
+        paths.push_back(dir + PATH_SEPARATOR + name + suffix);
+    }
+    return paths;
+}
+
 void filepath_file_opener_t::open_serializer_file(const std::string &path,
                                                   int extra_flags,
                                                   scoped_ptr_t<file_t> *file_out) {
@@ -64,12 +210,32 @@ void filepath_file_opener_t::open_serializer_file(const std::string &path,
     }
 }
 
+void filepath_file_opener_t::open_striped_serializer_file(
+        const std::string &path,
+        const std::vector<std::string> &extra_stripe_paths,
+        int64_t stripe_size,
+        int extra_flags,
+        scoped_ptr_t<file_t> *file_out) {
+    if (extra_stripe_paths.empty()) {
+        open_serializer_file(path, extra_flags, file_out);
+        return;
+    }
+    std::vector<scoped_ptr_t<file_t> > stripes(extra_stripe_paths.size() + 1);
+    open_serializer_file(path, extra_flags, &stripes[0]);
+    for (size_t i = 0; i < extra_stripe_paths.size(); ++i) {
+        open_serializer_file(extra_stripe_paths[i], extra_flags, &stripes[i + 1]);
+    }
+    file_out->init(new striped_file_t(std::move(stripes), stripe_size));
+}
+
 void filepath_file_opener_t::open_serializer_file_create_temporary(
         scoped_ptr_t<file_t> *file_out) {
     mutex_assertion_t::acq_t acq(&reentrance_mutex_);
-    open_serializer_file(temporary_file_name(),
-                         linux_file_t::mode_create | linux_file_t::mode_truncate,
-                         file_out);
+    open_striped_serializer_file(temporary_file_name(),
+                                 new_extra_stripe_paths(true),
+                                 SERIALIZER_FILE_STRIPE_SIZE,
+                                 linux_file_t::mode_create | linux_file_t::mode_truncate,
+                                 file_out);
     opened_temporary_ = true;
 }
 
@@ -81,6 +247,28 @@ void filepath_file_opener_t::move_serializer_file_to_permanent_location() {
 
     guarantee(opened_temporary_);
 
+    // The file itself is moved last, because once it's there it gets opened as it is,
+    // and so the other stripes and the stripe manifest must be in place by then.
+    const std::vector<std::string> temporary_stripe_paths = new_extra_stripe_paths(true);
+    const std::vector<std::string> permanent_stripe_paths =
+        new_extra_stripe_paths(false);
+#ifndef _WIN32
+    for (size_t i = 0; i < temporary_stripe_paths.size(); ++i) {
+        const int res = ::rename(temporary_stripe_paths[i].c_str(),
+                                 permanent_stripe_paths[i].c_str());
+        if (res != 0) {
+            crash("Could not rename database file %s to permanent location %s (%s)\n",
+                  temporary_stripe_paths[i].c_str(), permanent_stripe_paths[i].c_str(),
+                  errno_string(errno).c_str());
+        }
+        warn_fsync_parent_directory(permanent_stripe_paths[i].c_str());
+    }
+#endif
+    if (!permanent_stripe_paths.empty()) {
+        write_stripe_manifest(file_name(), SERIALIZER_FILE_STRIPE_SIZE,
+                              permanent_stripe_paths);
+    }
+
 #ifdef _WIN32
     // TODO WINDOWS: temporary files are not used because, by default,
     // files cannot be renamed while still open
@@ -101,7 +289,41 @@ void filepath_file_opener_t::move_serializer_file_to_permanent_location() {
 
 void filepath_file_opener_t::open_serializer_file_existing(scoped_ptr_t<file_t> *file_out) {
     mutex_assertion_t::acq_t acq(&reentrance_mutex_);
-    open_serializer_file(current_file_name(), 0, file_out);
+    if (opened_temporary_) {
+        open_striped_serializer_file(temporary_file_name(),
+                                     new_extra_stripe_paths(true),
+                                     SERIALIZER_FILE_STRIPE_SIZE, 0, file_out);
+    } else {
+        int64_t stripe_size = SERIALIZER_FILE_STRIPE_SIZE;
+        std::vector<std::string> extra_stripe_paths;
+        read_stripe_manifest(file_name(), &stripe_size, &extra_stripe_paths);
+        open_striped_serializer_file(file_name(), extra_stripe_paths, stripe_size, 0,
+                                     file_out);
+        add_cold_tier(file_out);
+    }
+}
+
+void filepath_file_opener_t::add_cold_tier(scoped_ptr_t<file_t> *file) {
+    std::string cold_tier_path = read_cold_tier_manifest(file_name());
+    scoped_ptr_t<file_t> cold_tier;
+    if (!cold_tier_path.empty()) {
+        open_serializer_file(cold_tier_path, 0, &cold_tier);
+    } else if (!cold_dir_.empty()) {
+        // Nothing gets put on the cold tier before the manifest names it, so if we
+        // crash before that, the cold tier that we leave behind is just truncated the
+        // next time.
+        cold_tier_path = cold_dir_ + PATH_SEPARATOR + file_base_name(file_name());
+        open_serializer_file(cold_tier_path,
+                             linux_file_t::mode_create | linux_file_t::mode_truncate,
+                             &cold_tier);
+        warn_fsync_parent_directory(cold_tier_path.c_str());
+        write_cold_tier_manifest(file_name(), cold_tier_path);
+    } else {
+        return;
+    }
+    scoped_ptr_t<file_t> fast_tier(std::move(*file));
+    file->init(new tiered_file_t(std::move(fast_tier), std::move(cold_tier),
+                                 SERIALIZER_COLD_TIER_OFFSET));
 }
 
 void filepath_file_opener_t::unlink_serializer_file() {
@@ -112,6 +334,27 @@ void filepath_file_opener_t::unlink_serializer_file() {
     guarantee(opened_temporary_);
     const int res = ::unlink(current_file_name().c_str());
     guarantee_err(res == 0, "unlink() failed");
+    for (const std::string &path : new_extra_stripe_paths(true)) {
+        const int stripe_res = ::unlink(path.c_str());
+        guarantee_err(stripe_res == 0, "unlink() failed");
+    }
+}
+
+void remove_serializer_file_stripes(const std::string &permanent_path) {
+    int64_t stripe_size;
+    std::vector<std::string> extra_stripe_paths;
+    read_stripe_manifest(permanent_path, &stripe_size, &extra_stripe_paths);
+    extra_stripe_paths.push_back(stripe_manifest_path(permanent_path));
+    const std::string cold_tier_path = read_cold_tier_manifest(permanent_path);
+    if (!cold_tier_path.empty()) {
+        extra_stripe_paths.push_back(cold_tier_path);
+    }
+    extra_stripe_paths.push_back(cold_tier_manifest_path(permanent_path));
+    for (const std::string &path : extra_stripe_paths) {
+        const int res = ::unlink(path.c_str());
+        guarantee_err(res == 0 || get_errno() == ENOENT,
+                      "unlink failed for file %s", path.c_str());
+    }
 }
 
 
@@ -135,7 +378,16 @@ log_serializer_stats_t::log_serializer_stats_t(perfmon_collection_t *parent)
       pm_serializer_data_extents_gced(),
       pm_serializer_old_garbage_block_bytes(),
       pm_serializer_old_total_block_bytes(),
+      pm_serializer_data_written_bytes_total(),
+      pm_serializer_gc_written_bytes_total(),
+      pm_serializer_gc_throttle_pauses(),
+      pm_serializer_data_extents_moved_cold(),
       pm_serializer_lba_gcs(),
+      pm_serializer_index_bytes_per_block(),
+      pm_serializer_blocks_compressed(),
+      pm_serializer_blocks_decompressed(),
+      pm_serializer_compression_input_bytes(),
+      pm_serializer_compression_output_bytes(),
       parent_collection_membership(parent, &serializer_collection, "serializer"),
       stats_membership(&serializer_collection,
           &pm_serializer_block_reads, "serializer_block_reads",
@@ -155,9 +407,30 @@ log_serializer_stats_t::log_serializer_stats_t(perfmon_collection_t *parent)
           &pm_serializer_data_extents_gced, "serializer_data_extents_gced",
           &pm_serializer_old_garbage_block_bytes, "serializer_old_garbage_block_bytes",
           &pm_serializer_old_total_block_bytes, "serializer_old_total_block_bytes",
-          &pm_serializer_lba_gcs, "serializer_lba_gcs")
+          &pm_serializer_data_written_bytes_total, "serializer_data_written_bytes_total",
+          &pm_serializer_gc_written_bytes_total, "serializer_gc_written_bytes_total",
+          &pm_serializer_gc_throttle_pauses, "serializer_gc_throttle_pauses",
+          &pm_serializer_data_extents_moved_cold,
+          "serializer_data_extents_moved_cold",
+          &pm_serializer_lba_gcs, "serializer_lba_gcs",
+          &pm_serializer_index_bytes_per_block, "serializer_index_bytes_per_block",
+          &pm_serializer_blocks_compressed, "serializer_blocks_compressed",
+          &pm_serializer_blocks_decompressed, "serializer_blocks_decompressed",
+          &pm_serializer_compression_input_bytes,
+          "serializer_compression_input_bytes",
+          &pm_serializer_compression_output_bytes,
+          "serializer_compression_output_bytes")
 { }
 
+ql::datum_t perfmon_index_bytes_per_block_t::end_stats(void *) {
+    const int64_t blocks = index_blocks.load(std::memory_order_relaxed);
+    if (blocks == 0) {
+        return ql::datum_t(0.0);
+    }
+    return ql::datum_t(static_cast<double>(index_bytes.load(std::memory_order_relaxed))
+                       / blocks);
+}
+
 void log_serializer_stats_t::bytes_read(size_t count) {
     pm_serializer_read_bytes_per_sec.record(count);
     pm_serializer_read_bytes_total += count;
@@ -216,8 +489,10 @@ struct ls_start_existing_fsm_t :
         scoped_ptr_t<file_t> dbfile;
         file_opener->open_serializer_file_existing(&dbfile);
         ser->dbfile = dbfile.release();
+        ser->dbfile->add_device_stats(&ser->disk_stats_collection);
         ser->index_writes_io_account.init(
-            new file_account_t(ser->dbfile, INDEX_WRITE_IO_PRIORITY));
+            new file_account_t(ser->dbfile, io_class_t::foreground_write,
+                               INDEX_WRITE_IO_PRIORITY));
 
         start_existing_state = state_read_static_header;
         // STATE A above implies STATE B here
@@ -446,11 +721,11 @@ log_serializer_t::~log_serializer_t() {
     rassert(active_write_count == 0);
 }
 
-file_account_t *log_serializer_t::make_io_account(int priority,
+file_account_t *log_serializer_t::make_io_account(io_class_t io_class, int priority,
                                                   int outstanding_requests_limit) {
     assert_thread();
     rassert(dbfile);
-    return new file_account_t(dbfile, priority, outstanding_requests_limit);
+    return new file_account_t(dbfile, io_class, priority, outstanding_requests_limit);
 }
 
 buf_ptr_t log_serializer_t::block_read(const counted_t<block_token_t> &token,
@@ -464,6 +739,9 @@ buf_ptr_t log_serializer_t::block_read(const counted_t<block_token_t> &token,
 
     buf_ptr_t ret = data_block_manager->read(token->offset_, token->block_size(),
                                              io_account);
+    if (maybe_decompress_block(&ret)) {
+        ++stats->pm_serializer_blocks_decompressed;
+    }
 
     stats->pm_serializer_block_reads.end(&pm_time);
     return ret;
@@ -699,8 +977,48 @@ log_serializer_t::block_writes(const buf_write_info_t *write_infos,
     assert_thread();
     stats->pm_serializer_block_writes += write_infos_count;
 
+    if (dynamic_config.compression == block_compression_t::none) {
+        std::vector<counted_t<block_token_t> > result
+            = data_block_manager->many_writes(write_infos, write_infos_count,
+                                              io_account, cb);
+        guarantee(result.size() == write_infos_count);
+        return result;
+    }
+
+    // The compressed buffers have to stay around until the writes are done.
+    struct compressed_writes_cb_t : public iocallback_t {
+        void on_io_complete() {
+            iocallback_t *local_cb = cb;
+            delete this;
+            local_cb->on_io_complete();
+        }
+
+        std::vector<buf_ptr_t> bufs;
+        iocallback_t *cb;
+    };
+
+    compressed_writes_cb_t *const compressed_cb = new compressed_writes_cb_t;
+    compressed_cb->cb = cb;
+    compressed_cb->bufs.reserve(write_infos_count);
+    std::vector<buf_write_info_t> infos(write_infos, write_infos + write_infos_count);
+    for (buf_write_info_t &info : infos) {
+        buf_ptr_t compressed = compress_block(dynamic_config.compression,
+                                              info.buf, info.block_size);
+        if (compressed.has()) {
+            ++stats->pm_serializer_blocks_compressed;
+            stats->pm_serializer_compression_input_bytes
+                += info.block_size.ser_value();
+            stats->pm_serializer_compression_output_bytes
+                += compressed.block_size().ser_value();
+            info.buf = compressed.ser_buffer();
+            info.block_size = compressed.block_size();
+            compressed_cb->bufs.push_back(std::move(compressed));
+        }
+    }
+
     std::vector<counted_t<block_token_t> > result
-        = data_block_manager->many_writes(write_infos, write_infos_count, io_account, cb);
+        = data_block_manager->many_writes(infos.data(), infos.size(), io_account,
+                                          compressed_cb);
     guarantee(result.size() == write_infos_count);
     return result;
 }
@@ -793,6 +1111,12 @@ bool log_serializer_t::is_gc_active() const {
     return data_block_manager->is_gc_active() || lba_index->is_any_gc_active();
 }
 
+extent_free_space_t log_serializer_t::extent_free_space() {
+    assert_thread();
+    rassert(state == state_ready);
+    return extent_manager->free_space();
+}
+
 block_id_t log_serializer_t::end_block_id() {
     assert_thread();
     rassert(state == state_ready);
@@ -1002,6 +1326,9 @@ void log_serializer_t::offer_buf_to_read_ahead_callbacks(
     assert_thread();
 
     buf_ptr_t local_buf = std::move(buf);
+    if (maybe_decompress_block(&local_buf)) {
+        ++stats->pm_serializer_blocks_decompressed;
+    }
     for (size_t i = 0; local_buf.has() && i < read_ahead_callbacks.size(); ++i) {
         read_ahead_callbacks[i]->offer_read_ahead_buf(block_id,
                                                       &local_buf,
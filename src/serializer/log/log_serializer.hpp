@@ -46,11 +46,29 @@ struct shutdown_callback_t {
  * respect that it deserves.
  */
 
-// Used to open a file (with the given filepath) for the log serializer.
+/* The size of the units that a striped serializer file is dealt out to its stripes in,
+which is the size of an extent so that consecutive extents go to different devices. */
+#define SERIALIZER_FILE_STRIPE_SIZE DEFAULT_EXTENT_SIZE
+
+/* Where the cold tier of a tiered serializer file starts.  Its extents get offsets from
+here on, which is far beyond where any fast tier's extents get to. */
+#define SERIALIZER_COLD_TIER_OFFSET (int64_t(1) << 46)
+
+// Used to open a file (with the given filepath) for the log serializer.  If
+// `stripe_dirs` isn't empty, a new file is striped (see `striped_file_t`) over the file
+// at the filepath and a file of the same name in each of the directories.  The stripes
+// of a file are recorded in a stripe manifest next to it, so once the file exists it
+// doesn't matter what `stripe_dirs` is.  Likewise, if `cold_dir` isn't empty, a file
+// that is opened at its permanent location gets a cold tier (see `tiered_file_t`) in a
+// file of the same name in `cold_dir`, unless its cold tier manifest says that it has
+// one already.
 class filepath_file_opener_t : public serializer_file_opener_t {
 public:
     filepath_file_opener_t(const serializer_filepath_t &filepath,
-                           io_backender_t *backender);
+                           io_backender_t *backender,
+                           const std::vector<std::string> &stripe_dirs
+                               = std::vector<std::string>(),
+                           const std::string &cold_dir = std::string());
     ~filepath_file_opener_t();
 
     // The path of the final position of the file.
@@ -64,6 +82,21 @@ public:
 private:
     void open_serializer_file(const std::string &path, int extra_flags, scoped_ptr_t<file_t> *file_out);
 
+    // Opens the file at `path` by itself if `extra_stripe_paths` is empty, and striped
+    // over it and the files at `extra_stripe_paths` otherwise.
+    void open_striped_serializer_file(const std::string &path,
+                                      const std::vector<std::string> &extra_stripe_paths,
+                                      int64_t stripe_size,
+                                      int extra_flags,
+                                      scoped_ptr_t<file_t> *file_out);
+
+    // The stripes that a new file has in `stripe_dirs_`, at their temporary or
+    // permanent paths.
+    std::vector<std::string> new_extra_stripe_paths(bool temporary) const;
+
+    // Puts `*file` together with its cold tier, if it has or should get one.
+    void add_cold_tier(scoped_ptr_t<file_t> *file);
+
     // The path of the temporary file.  This is file_name() with some suffix appended.
     std::string temporary_file_name() const;
 
@@ -76,6 +109,9 @@ private:
 
     io_backender_t *const backender_;
 
+    const std::vector<std::string> stripe_dirs_;
+    const std::string cold_dir_;
+
     // Makes sure that only one member function gets called at a time.  Some of them are
     // blocking, and we don't want to have to worry about stuff like what the value of
     // opened_temporary_ should be during the blocking call to
@@ -91,6 +127,11 @@ private:
     DISABLE_COPYING(filepath_file_opener_t);
 };
 
+// Removes the stripes of the serializer file at `permanent_path` besides the file
+// itself and its cold tier, and their manifests, if it has them.  Makes blocking
+// syscalls.
+void remove_serializer_file_stripes(const std::string &permanent_path);
+
 // Used internally
 struct ls_start_existing_fsm_t;
 
@@ -124,7 +165,8 @@ public:
     virtual ~log_serializer_t();
 
     using serializer_t::make_io_account;
-    file_account_t *make_io_account(int priority, int outstanding_requests_limit);
+    file_account_t *make_io_account(io_class_t io_class, int priority,
+                                    int outstanding_requests_limit);
 
     void register_read_ahead_cb(serializer_read_ahead_callback_t *cb);
     void unregister_read_ahead_cb(serializer_read_ahead_callback_t *cb);
@@ -155,6 +197,9 @@ public:
 
     virtual bool is_gc_active() const;
 
+    // See `extent_manager_t::free_space()`.
+    extent_free_space_t extent_free_space();
+
 private:
     void unregister_block_token(block_token_t *token);
     void remap_block_to_new_offset(int64_t current_offset, int64_t new_offset);
@@ -117,7 +117,8 @@ ATTR_PACKED(struct crc_metablock_t {
     // The version that differs only when the software is upgraded to a newer
     // version.  This field might allow for in-place upgrading of the cluster.
     uint32_t disk_format_version;
-    // The CRC checksum of [disk_format_version]+[version]+[metablock].
+    // The CRC checksum of [disk_format_version]+[version]+[metablock], followed by
+    // [checksum_algorithm] from v2_6 on.
     uint32_t _crc;
     // The version that increments every time a metablock is written.
     metablock_version_t version;
@@ -127,10 +128,16 @@ ATTR_PACKED(struct crc_metablock_t {
     log_serializer_metablock_t metablock;
 
     // Pre-v2_5 version, this field did not exist.  The space was filled with zeros.
-    // Offset: 3760, size: 192.
+    // Offset: 3760, size: 136.
     metablock_fileranges_checksum_t fileranges_checksum_v2_5;
 
-    // Total size: 3952 bytes.
+    // The `checksum_algorithm_t` of the fileranges checksum.  Pre-v2_6 version, this
+    // field did not exist, and the checksum is always Fletcher-64.  It is covered by
+    // `_crc` from v2_6 on.
+    // Offset: 3896, size: 4.
+    uint32_t checksum_algorithm;
+
+    // Total size: 3900 bytes.
 });
 
 
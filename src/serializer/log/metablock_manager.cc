@@ -27,9 +27,31 @@ uint32_t compute_metablock_crc(const crc_metablock_t *crc_mb) {
     crc.process_bytes(&crc_mb->disk_format_version, sizeof(crc_mb->disk_format_version));
     crc.process_bytes(&crc_mb->version, sizeof(crc_mb->version));
     crc.process_bytes(&crc_mb->metablock, sizeof(crc_mb->metablock));
+    if (crc_mb->disk_format_version >= static_cast<uint32_t>(cluster_version_t::v2_6)) {
+        crc.process_bytes(&crc_mb->checksum_algorithm,
+                          sizeof(crc_mb->checksum_algorithm));
+    }
     return crc.checksum();
 }
 
+// The algorithm of the metablock's fileranges checksum.  Metablocks from before v2_6
+// don't record it, and always use Fletcher-64.
+checksum_algorithm_t get_checksum_algorithm(const crc_metablock_t *crc_mb) {
+    if (crc_mb->disk_format_version < static_cast<uint32_t>(cluster_version_t::v2_6)) {
+        return checksum_algorithm_t::fletcher64;
+    }
+    const uint32_t algorithm = crc_mb->checksum_algorithm;
+    if (algorithm != static_cast<uint32_t>(checksum_algorithm_t::fletcher64)
+        && algorithm != static_cast<uint32_t>(checksum_algorithm_t::crc32c)) {
+        fail_due_to_user_error(
+                "Checksum algorithm not recognized. Is the data "
+                "directory from a newer version of RethinkDB? "
+                "(algorithm on disk: %" PRIu32 ")",
+                algorithm);
+    }
+    return static_cast<checksum_algorithm_t>(algorithm);
+}
+
 struct checksum_filerange_less {
     bool operator()(const checksum_filerange &x, const checksum_filerange &y) const {
         return x.offset < y.offset;
@@ -37,7 +59,8 @@ struct checksum_filerange_less {
 };
 
 // Returns true if we should double-datasync (ranges are all padding).
-bool prepare_checksums(metablock_fileranges_checksum_t *disk_list,
+bool prepare_checksums(checksum_algorithm_t algorithm,
+                       metablock_fileranges_checksum_t *disk_list,
                        optional<std::vector<checksum_filerange>> &&checksums) {
     if (!checksums.has_value()) {
         goto prepare_padding_ranges;
@@ -58,7 +81,8 @@ bool prepare_checksums(metablock_fileranges_checksum_t *disk_list,
         for (size_t i = 1; i < ranges.size(); ++i) {
             if (ranges[merge_ix].offset + ranges[merge_ix].size == ranges[i].offset) {
                 serializer_checksum concat
-                    = compute_checksum_concat(ranges[merge_ix].checksum,
+                    = compute_checksum_concat(algorithm,
+                                              ranges[merge_ix].checksum,
                                               ranges[i].checksum,
                                               uint64_t(ranges[i].size) / serializer_checksum::word_size);
                 ranges[merge_ix].size += ranges[i].size;
@@ -74,9 +98,10 @@ bool prepare_checksums(metablock_fileranges_checksum_t *disk_list,
             goto prepare_padding_ranges;
         }
 
-        serializer_checksum combined_sum = identity_checksum();
+        serializer_checksum combined_sum = identity_checksum(algorithm);
         for (size_t i = 0; i < checksum_count; ++i) {
-            combined_sum = compute_checksum_concat(combined_sum, ranges[i].checksum,
+            combined_sum = compute_checksum_concat(algorithm,
+                                                   combined_sum, ranges[i].checksum,
                                                    ranges[i].size / serializer_checksum::word_size);
             metablock_filerange_t range = { ranges[i].offset, ranges[i].size };
             disk_list->fileranges[i] = range;
@@ -95,7 +120,7 @@ bool prepare_checksums(metablock_fileranges_checksum_t *disk_list,
     for (size_t i = 0; i < METABLOCK_NUM_CHECKSUMS; ++i) {
         disk_list->fileranges[i] = zero_range;
     }
-    disk_list->checksum = identity_checksum();
+    disk_list->checksum = identity_checksum(algorithm);
     return true;
 }
 
@@ -103,12 +128,15 @@ bool prepare_checksums(metablock_fileranges_checksum_t *disk_list,
 // Returns true if we should double-datasync.
 bool prepare(crc_metablock_t *crc_mb, uint32_t _disk_format_version,
              metablock_version_t vers,
+             checksum_algorithm_t algorithm,
              optional<std::vector<checksum_filerange>> &&checksums) {
     crc_mb->disk_format_version = _disk_format_version;
     memcpy(crc_mb->magic_marker, MB_MARKER_MAGIC, sizeof(MB_MARKER_MAGIC));
     crc_mb->version = vers;
 
-    bool double_datasync = prepare_checksums(&crc_mb->fileranges_checksum_v2_5,
+    crc_mb->checksum_algorithm = static_cast<uint32_t>(algorithm);
+    bool double_datasync = prepare_checksums(algorithm,
+                                             &crc_mb->fileranges_checksum_v2_5,
                                              std::move(checksums));
 
     crc_mb->_crc = compute_metablock_crc(crc_mb);
@@ -215,6 +243,7 @@ void metablock_manager_t::create(
     crc_metablock::prepare(buffer.get(),
                            static_cast<uint32_t>(cluster_version_t::LATEST_DISK),
                            MB_START_VERSION,
+                           default_checksum_algorithm(),
                            std::move(checksums));
     co_write(dbfile, metablock_offsets::get(extent_size, 0), METABLOCK_SIZE, buffer.get(),
              DEFAULT_DISK_ACCOUNT, datasync_op::wrap_in_datasyncs);
@@ -244,8 +273,9 @@ bool disk_format_version_is_recognized(uint32_t disk_format_version) {
         || disk_format_version == static_cast<uint32_t>(cluster_version_t::v2_2)
         || disk_format_version == static_cast<uint32_t>(cluster_version_t::v2_3)
         || disk_format_version == static_cast<uint32_t>(cluster_version_t::v2_4)
+        || disk_format_version == static_cast<uint32_t>(cluster_version_t::v2_5)
         || disk_format_version ==
-            static_cast<uint32_t>(cluster_version_t::v2_5_is_latest_disk);
+            static_cast<uint32_t>(cluster_version_t::v2_6_is_latest_disk);
 }
 
 bool metablock_manager_t::verify_checksum_fileranges(const crc_metablock_t *mb) {
@@ -257,11 +287,15 @@ bool metablock_manager_t::verify_checksum_fileranges(const crc_metablock_t *mb)
                 mb->disk_format_version);
     }
 
-    if (mb->disk_format_version != static_cast<uint32_t>(cluster_version_t::v2_5_is_latest_disk)) {
+    if (mb->disk_format_version != static_cast<uint32_t>(cluster_version_t::v2_5)
+        && mb->disk_format_version
+           != static_cast<uint32_t>(cluster_version_t::v2_6_is_latest_disk)) {
         // There are no checksums.
         return true;
     }
 
+    const checksum_algorithm_t algorithm = crc_metablock::get_checksum_algorithm(mb);
+
     // (These file ranges are supposed to be a small amount of data that we can load
     // into memory all at once.)
 
@@ -299,13 +333,13 @@ bool metablock_manager_t::verify_checksum_fileranges(const crc_metablock_t *mb)
     callback.wait();
     extent_manager->stats->bytes_read(total_read);
 
-    serializer_checksum combined_sum = identity_checksum();
+    serializer_checksum combined_sum = identity_checksum(algorithm);
     for (size_t i = 0; i < num_fileranges; ++i) {
         serializer_checksum x = compute_checksum(
-                bufs[i].get(),
+                algorithm, bufs[i].get(),
                 disk_list->fileranges[i].size / serializer_checksum::word_size);
         combined_sum = compute_checksum_concat(
-                combined_sum, x,
+                algorithm, combined_sum, x,
                 disk_list->fileranges[i].size / serializer_checksum::word_size);
     }
     if (combined_sum.value != disk_list->checksum.value) {
@@ -326,26 +360,17 @@ void metablock_manager_t::co_start_existing(file_t *file, bool *mb_found_out,
     dbfile->set_file_size_at_least(metablock_offsets::min_filesize(extent_size),
                                    extent_size);
 
-    // Reading metablocks by issuing one I/O request at a time is
-    // slow. Read all of them in one batch, and check them later.
+    // The metablock slots sit next to each other right after the static header, so
+    // all of them are read in one request and checked afterwards.  There are never
+    // more than `MB_BLOCKS_PER_EXTENT - 1` of them, however big the file is.
     state = state_reading;
 
     scoped_device_block_aligned_ptr_t<char> lbm(METABLOCK_SIZE * num_metablocks);
-
-    struct : public iocallback_t, public cond_t {
-        size_t refcount;
-        void on_io_complete() {
-            refcount--;
-            if (refcount == 0) { pulse(); }
-        }
-    } callback;
-    callback.refcount = num_metablocks;
-    for (size_t i = 0; i < num_metablocks; ++i) {
-        dbfile->read_async(metablock_offsets::get(extent_size, i), METABLOCK_SIZE,
-                           lbm.get() + i * METABLOCK_SIZE,
-                           DEFAULT_DISK_ACCOUNT, &callback);
-    }
-    callback.wait();
+    rassert(metablock_offsets::get(extent_size, num_metablocks - 1)
+            == metablock_offsets::get(extent_size, 0)
+               + static_cast<int64_t>((num_metablocks - 1) * METABLOCK_SIZE));
+    co_read(dbfile, metablock_offsets::get(extent_size, 0),
+            METABLOCK_SIZE * num_metablocks, lbm.get(), DEFAULT_DISK_ACCOUNT);
     extent_manager->stats->bytes_read(METABLOCK_SIZE * metablock_offsets::count(extent_size));
 
     static_assert(MB_BAD_VERSION < 0, "MB_BAD_VERSION is not -1, not unsigned");
@@ -383,6 +408,8 @@ void metablock_manager_t::co_start_existing(file_t *file, bool *mb_found_out,
             next_mb_slot = metablock_offsets::next(extent_size, index);
             *mb_found_out = true;
             memcpy(mb_out, &latest_crc_mb->metablock, sizeof(log_serializer_metablock_t));
+            extent_manager->checksum_algorithm
+                = crc_metablock::get_checksum_algorithm(latest_crc_mb);
         } else {
             if (indices_by_version.size() == 1) {
                 /* no metablock found anywhere -- the DB is toast */
@@ -402,6 +429,8 @@ void metablock_manager_t::co_start_existing(file_t *file, bool *mb_found_out,
                 next_mb_slot = metablock_offsets::next(extent_size, index);
                 *mb_found_out = true;
                 memcpy(mb_out, &latest_crc_mb->metablock, sizeof(log_serializer_metablock_t));
+                extent_manager->checksum_algorithm
+                    = crc_metablock::get_checksum_algorithm(latest_crc_mb);
             }
         }
 
@@ -439,6 +468,7 @@ void metablock_manager_t::co_write_metablock(
         = crc_metablock::prepare(crc_mb.get(),
                                  static_cast<uint32_t>(cluster_version_t::LATEST_DISK),
                                  next_version_number++,
+                                 extent_manager->checksum_algorithm,
                                  std::move(checksums));
     rassert(crc_metablock::check_crc(crc_mb.get()));
 
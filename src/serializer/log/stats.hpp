@@ -2,8 +2,30 @@
 #ifndef SERIALIZER_LOG_STATS_HPP_
 #define SERIALIZER_LOG_STATS_HPP_
 
+#include <atomic>
+
 #include "perfmon/perfmon.hpp"
 
+/* Reports the bytes of memory the in-memory LBA index uses per block that it has an
+entry for. */
+class perfmon_index_bytes_per_block_t : public perfmon_t {
+public:
+    perfmon_index_bytes_per_block_t() : index_bytes(0), index_blocks(0) { }
+    void set(int64_t bytes, int64_t blocks) {
+        index_bytes.store(bytes, std::memory_order_relaxed);
+        index_blocks.store(blocks, std::memory_order_relaxed);
+    }
+
+    void *begin_stats() { return nullptr; }
+    void visit_stats(void *) { }
+    ql::datum_t end_stats(void *);
+private:
+    // These are read from whichever thread collects the stats.
+    std::atomic<int64_t> index_bytes;
+    std::atomic<int64_t> index_blocks;
+    DISABLE_COPYING(perfmon_index_bytes_per_block_t);
+};
+
 struct log_serializer_stats_t {
     perfmon_collection_t serializer_collection;
     explicit log_serializer_stats_t(perfmon_collection_t *perfmon_collection);
@@ -35,9 +57,25 @@ struct log_serializer_stats_t {
     perfmon_counter_t pm_serializer_data_extents_gced;
     perfmon_counter_t pm_serializer_old_garbage_block_bytes;
     perfmon_counter_t pm_serializer_old_total_block_bytes;
+    /* Data block bytes written for new blocks and for blocks moved by GC.  Their sum
+    divided by the first is the write amplification that GC causes. */
+    perfmon_counter_t pm_serializer_data_written_bytes_total;
+    perfmon_counter_t pm_serializer_gc_written_bytes_total;
+    // How many times GC paused because the disk was busy.
+    perfmon_counter_t pm_serializer_gc_throttle_pauses;
+    // How many extents GC moved to the cold tier.
+    perfmon_counter_t pm_serializer_data_extents_moved_cold;
 
     /* used in serializer/log/lba/lba_list.cc */
     perfmon_counter_t pm_serializer_lba_gcs;
+    perfmon_index_bytes_per_block_t pm_serializer_index_bytes_per_block;
+
+    /* Block compression.  The byte counts only include blocks that got compressed,
+    before and after compression. */
+    perfmon_counter_t pm_serializer_blocks_compressed;
+    perfmon_counter_t pm_serializer_blocks_decompressed;
+    perfmon_counter_t pm_serializer_compression_input_bytes;
+    perfmon_counter_t pm_serializer_compression_output_bytes;
 
     perfmon_membership_t parent_collection_membership;
     perfmon_multi_membership_t stats_membership;
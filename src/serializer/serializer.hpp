@@ -48,8 +48,8 @@ public:
 
     /* Allocates a new io account for the underlying file.
     Use delete to free it. */
-    file_account_t *make_io_account(int priority);
-    virtual file_account_t *make_io_account(int priority,
+    file_account_t *make_io_account(io_class_t io_class, int priority);
+    virtual file_account_t *make_io_account(io_class_t io_class, int priority,
                                             int outstanding_requests_limit) = 0;
 
     /* Some serializer implementations support read-ahead to speed up cache warmup.
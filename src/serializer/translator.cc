@@ -235,8 +235,8 @@ translator_serializer_t::translator_serializer_t(serializer_t *_inner, int _mod_
     rassert(mod_id < mod_count);
 }
 
-file_account_t *translator_serializer_t::make_io_account(int priority, int outstanding_requests_limit) {
-    return inner->make_io_account(priority, outstanding_requests_limit);
+file_account_t *translator_serializer_t::make_io_account(io_class_t io_class, int priority, int outstanding_requests_limit) {
+    return inner->make_io_account(io_class, priority, outstanding_requests_limit);
 }
 
 void translator_serializer_t::index_write(
@@ -43,6 +43,9 @@ on_thread_t::on_thread_t(threadnum_t thread) {
 on_thread_t::~on_thread_t() {
     coro_t::move_to_thread(home_thread());
 }
+void on_thread_t::switch_to(threadnum_t thread) {
+    coro_t::move_to_thread(thread);
+}
 
 
 // The last thread is used as a utility thread, and is the launching point for the
@@ -66,16 +69,32 @@ thread_allocator_t::~thread_allocator_t() {
 thread_allocation_t::thread_allocation_t(thread_allocator_t *p)
     : thread(0), /* temporary, will be overwritten below */
       parent(p) {
+    allocate(-1);
+}
+
+thread_allocation_t::thread_allocation_t(thread_allocator_t *p, threadnum_t near)
+    : thread(0), /* temporary, will be overwritten below */
+      parent(p) {
+    allocate(get_thread_numa_node(near));
+}
+
+void thread_allocation_t::allocate(int numa_node) {
     parent->assert_thread();
-    int32_t best_thread = 0;
-    for (int32_t i = 1; static_cast<size_t>(i) < parent->num_allocated.size(); ++i) {
-        if (parent->num_allocated[i] < parent->num_allocated[best_thread]) {
+    int32_t best_thread = -1;
+    for (int32_t i = 0; static_cast<size_t>(i) < parent->num_allocated.size(); ++i) {
+        if (numa_node != -1 && get_thread_numa_node(threadnum_t(i)) != numa_node) {
+            continue;
+        }
+        if (best_thread == -1 ||
+            parent->num_allocated[i] < parent->num_allocated[best_thread]) {
             best_thread = i;
         } else if (parent->num_allocated[i] == parent->num_allocated[best_thread] &&
                    parent->secondary_lt(threadnum_t(i), threadnum_t(best_thread))) {
             best_thread = i;
         }
     }
+    // `numa_node` is the node of a thread we have, so it can't be empty.
+    guarantee(best_thread != -1);
     thread = threadnum_t(best_thread);
     ++parent->num_allocated[best_thread];
 }
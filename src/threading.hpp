@@ -90,6 +90,10 @@ class on_thread_t : public home_thread_mixin_t {
 public:
     explicit on_thread_t(threadnum_t thread);
     ~on_thread_t();
+
+    // Moves to `thread` without going back to the home thread first.  The destructor
+    // still returns to the home thread.
+    void switch_to(threadnum_t thread);
 };
 
 int get_num_db_threads();
@@ -111,9 +115,13 @@ private:
 class thread_allocation_t {
 public:
     explicit thread_allocation_t(thread_allocator_t *p);
+    // Only considers the threads on the same NUMA node as `near`, if we know it.
+    thread_allocation_t(thread_allocator_t *p, threadnum_t near);
     ~thread_allocation_t();
     threadnum_t get_thread() const;
 private:
+    void allocate(int numa_node);
+
     threadnum_t thread;
     thread_allocator_t *parent;
     DISABLE_COPYING(thread_allocation_t);
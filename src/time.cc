@@ -184,6 +184,18 @@ ticks_t get_ticks() {
     return ticks;
 }
 
+ticks_t get_coarse_ticks() {
+#ifdef CLOCK_MONOTONIC_COARSE
+    timespec tv;
+    int res = clock_gettime(CLOCK_MONOTONIC_COARSE, &tv);
+    guarantee_err(res == 0, "clock_gettime(CLOCK_MONOTONIC_COARSE, ...) failed");
+    ticks_t ticks = { secs_to_ticks(tv.tv_sec).nanos + int64_t(tv.tv_nsec) };
+    return ticks;
+#else
+    return get_ticks();
+#endif
+}
+
 kiloticks_t get_kiloticks() {
     return kiloticks_t{get_ticks().nanos / 1000};
 }
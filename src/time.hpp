@@ -14,6 +14,11 @@ struct ticks_t {
 };
 ticks_t get_ticks();
 
+// get_coarse_ticks() is like get_ticks(), but may lag behind it by a few milliseconds.
+// Where the OS has a coarse clock, it's several times cheaper, so perfmons that only
+// need to know which second an event happened in use it.
+ticks_t get_coarse_ticks();
+
 // get_kiloticks() is get_ticks() / 1000.  Used in migrating from legacy wall-clock
 // current_microtime().
 struct kiloticks_t {
@@ -0,0 +1,66 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include "concurrency/queue/accounting.hpp"
+#include "concurrency/queue/unlimited_fifo.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+class test_deadline_source_t : public accounting_deadline_source_t {
+public:
+    test_deadline_source_t() {
+        deadline.nanos = INT64_MAX;
+    }
+    ticks_t next_deadline() const {
+        return deadline;
+    }
+    ticks_t deadline;
+};
+
+TPTEST(AccountingQueueTest, Shares) {
+    accounting_queue_t<int> queue(1);
+    unlimited_fifo_queue_t<int> big, small;
+    accounting_queue_t<int>::account_t big_account(&queue, &big, 3);
+    accounting_queue_t<int>::account_t small_account(&queue, &small, 1);
+    for (int i = 0; i < 100; ++i) {
+        big.push(1);
+        small.push(2);
+    }
+    int from_big = 0;
+    for (int i = 0; i < 40; ++i) {
+        from_big += queue.pop() == 1 ? 1 : 0;
+    }
+    EXPECT_EQ(30, from_big);
+}
+
+TPTEST(AccountingQueueTest, OverdueGoesFirst) {
+    accounting_queue_t<int> queue(1);
+    unlimited_fifo_queue_t<int> big, small, later;
+    test_deadline_source_t small_deadline, later_deadline;
+    accounting_queue_t<int>::account_t big_account(&queue, &big, 1000);
+    accounting_queue_t<int>::account_t small_account(
+        &queue, &small, 1, &small_deadline);
+    accounting_queue_t<int>::account_t later_account(
+        &queue, &later, 1, &later_deadline);
+    for (int i = 0; i < 10; ++i) {
+        big.push(1);
+    }
+    small.push(2);
+    small.push(2);
+    later.push(3);
+
+    // Nobody is late, so the big account wins.
+    EXPECT_EQ(1, queue.pop());
+
+    // Both are late; the one with the earlier deadline goes first.
+    small_deadline.deadline.nanos = get_ticks().nanos - 1000;
+    later_deadline.deadline.nanos = small_deadline.deadline.nanos - 1000;
+    EXPECT_EQ(3, queue.pop());
+    EXPECT_EQ(2, queue.pop());
+    EXPECT_EQ(2, queue.pop());
+
+    // Accounts that have run dry don't count, however late they were.
+    EXPECT_EQ(1, queue.pop());
+}
+
+}  // namespace unittest
@@ -13,7 +13,7 @@ void dump_to_string(write_message_t *wm, std::string *out) {
 
     out->clear();
     for (write_buffer_t *p = buffers->head(); p; p = buffers->next(p)) {
-        out->append(p->data, p->data + p->size);
+        out->append(p->contents(), p->contents() + p->size);
     }
 }
 
@@ -34,6 +34,36 @@ TEST(WriteMessageTest, Variant) {
     ASSERT_EQ(15u, s.size());
 }
 
+TEST(WriteMessageTest, SharedBuffer) {
+    const size_t buf_size = 3 * write_buffer_t::DATA_SIZE;
+    counted_t<shared_buf_t> buf = shared_buf_t::create(buf_size);
+    for (size_t i = 0; i < buf_size; ++i) {
+        buf->data()[i] = static_cast<char>(i % 251);
+    }
+    shared_buf_ref_t<char> ref(counted_t<const shared_buf_t>(buf), 0);
+
+    write_message_t wm;
+    wm.append("ab", 2);
+    intptr_t refs_before = counted_use_count(buf.get());
+    // A large piece is held by reference...
+    wm.append(ref.make_child(1), buf_size - 1);
+    ASSERT_EQ(refs_before + 1, counted_use_count(buf.get()));
+    // ...while a small one is copied.
+    wm.append(ref, 10);
+    ASSERT_EQ(refs_before + 1, counted_use_count(buf.get()));
+    wm.append("c", 1);
+
+    std::string expected = "ab";
+    expected.append(buf->data(1), buf_size - 1);
+    expected.append(buf->data(), 10);
+    expected.append("c");
+
+    std::string s;
+    dump_to_string(&wm, &s);
+    ASSERT_EQ(expected, s);
+    ASSERT_EQ(expected.size(), wm.size());
+}
+
 
 
 }  // namespace unittest
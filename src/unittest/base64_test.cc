@@ -0,0 +1,113 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#include <string>
+
+#include "random.hpp"
+#include "rdb_protocol/base64.hpp"
+#include "rdb_protocol/error.hpp"
+#include "time.hpp"
+#include "unittest/gtest.hpp"
+
+namespace unittest {
+
+std::string random_bytes(rng_t *rng, size_t size) {
+    std::string res(size, '\0');
+    for (char &c : res) {
+        c = static_cast<char>(rng->randint(256));
+    }
+    return res;
+}
+
+TEST(Base64Test, KnownValues) {
+    EXPECT_EQ("", encode_base64("", 0));
+    EXPECT_EQ("Zg==", encode_base64("f", 1));
+    EXPECT_EQ("Zm8=", encode_base64("fo", 2));
+    EXPECT_EQ("Zm9v", encode_base64("foo", 3));
+    EXPECT_EQ("Zm9vYmFy", encode_base64("foobar", 6));
+    const std::string line(57, '\xff');
+    EXPECT_EQ(std::string(76, '/'), encode_base64(line.data(), line.size()));
+    EXPECT_EQ(std::string(76, '/') + "\r\n////",
+              encode_base64((line + "\xff\xff\xff").data(), line.size() + 3));
+
+    EXPECT_EQ("foobar", decode_base64("Zm9v\r\nYm Fy", 11));
+    EXPECT_EQ("fo", decode_base64("Zm8", 3));
+    EXPECT_THROW(decode_base64("Zm9vY", 5), ql::base_exc_t);
+    EXPECT_THROW(decode_base64("Zm9v!mFy", 8), ql::base_exc_t);
+    EXPECT_THROW(decode_base64("Zm8=Zm8=", 8), ql::base_exc_t);
+}
+
+TEST(Base64Test, SameAsScalar) {
+    rng_t rng(0);
+    for (int i = 0; i < 2000; ++i) {
+        const std::string data = random_bytes(&rng, rng.randint(i < 1000 ? 100 : 2000));
+        const std::string encoded = encode_base64(data.data(), data.size());
+        ASSERT_EQ(encode_base64_scalar(data.data(), data.size()), encoded);
+        ASSERT_EQ(data, decode_base64(encoded.data(), encoded.size()));
+
+        // Without the line breaks there is nothing to interrupt the vector code.
+        std::string unbroken;
+        for (char c : encoded) {
+            if (c != '\r' && c != '\n') {
+                unbroken.push_back(c);
+            }
+        }
+        ASSERT_EQ(data, decode_base64(unbroken.data(), unbroken.size()));
+
+        // Invalid characters are reported the same way wherever they are.
+        if (!unbroken.empty()) {
+            unbroken[rng.randint(unbroken.size())] = "!-.@[`{\x80"[rng.randint(8)];
+            std::string expected_error, actual_error;
+            try {
+                decode_base64_scalar(unbroken.data(), unbroken.size());
+            } catch (const ql::base_exc_t &ex) {
+                expected_error = ex.what();
+            }
+            try {
+                decode_base64(unbroken.data(), unbroken.size());
+            } catch (const ql::base_exc_t &ex) {
+                actual_error = ex.what();
+            }
+            ASSERT_NE("", expected_error);
+            ASSERT_EQ(expected_error, actual_error);
+        }
+    }
+}
+
+// This is not really a unit test, but a micro benchmark that compares the vector
+// and scalar base64 code on a large binary value.  No need to run this in debug mode.
+#ifdef NDEBUG
+template <class fn_t>
+double mb_per_sec(const std::string &in, const fn_t &fn) {
+    const int NUM_REPETITIONS = 20;
+    ticks_t start_ticks = get_ticks();
+    size_t total_size = 0;
+    for (int i = 0; i < NUM_REPETITIONS; ++i) {
+        total_size += fn(in.data(), in.size()).size();
+    }
+    int64_t nanos = get_ticks().nanos - start_ticks.nanos;
+    EXPECT_NE(0u, total_size);
+    return static_cast<double>(in.size()) * NUM_REPETITIONS * 1000.0 / nanos;
+}
+
+TEST(Base64Test, Benchmark) {
+    rng_t rng(0);
+    const std::string data = random_bytes(&rng, 4 * MEGABYTE);
+    const std::string encoded = encode_base64(data.data(), data.size());
+    std::string unbroken;
+    for (char c : encoded) {
+        if (c != '\r' && c != '\n') {
+            unbroken.push_back(c);
+        }
+    }
+    printf("Base64 of %zu bytes:\n", data.size());
+    printf("  encode:                   %.1f MB/s (scalar %.1f MB/s)\n",
+           mb_per_sec(data, &encode_base64), mb_per_sec(data, &encode_base64_scalar));
+    printf("  decode:                   %.1f MB/s (scalar %.1f MB/s)\n",
+           mb_per_sec(encoded, &decode_base64),
+           mb_per_sec(encoded, &decode_base64_scalar));
+    printf("  decode without newlines:  %.1f MB/s (scalar %.1f MB/s)\n",
+           mb_per_sec(unbroken, &decode_base64),
+           mb_per_sec(unbroken, &decode_base64_scalar));
+}
+#endif  // NDEBUG
+
+}  // namespace unittest
@@ -0,0 +1,54 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#include "rdb_protocol/batching.hpp"
+#include "unittest/gtest.hpp"
+
+namespace unittest {
+
+TEST(BatchingTest, AdaptiveBatchSize) {
+    const int64_t min_size = 1000, max_size = 8000;
+    ql::adaptive_batch_size_t adaptive;
+    // The first size is the default one, within the bounds.
+    EXPECT_EQ(max_size, adaptive.next_size(min_size, max_size));
+
+    // A batch that was read instantly, so the client's round trip took longer.
+    adaptive.note_batch(max_size, kiloticks_t{0});
+    adaptive.note_sent();
+    adaptive.note_request();
+    EXPECT_EQ(max_size, adaptive.next_size(min_size, max_size));
+    adaptive.note_batch(max_size, kiloticks_t{0});
+    adaptive.note_sent();
+    adaptive.note_request();
+    EXPECT_EQ(4000, adaptive.next_size(min_size, 4000));
+
+    // A batch that took much longer to read than the client took to ask again.
+    int64_t size = 4000;
+    adaptive.note_batch(size, kiloticks_t{1000 * 1000 * 1000});
+    adaptive.note_sent();
+    adaptive.note_request();
+    EXPECT_EQ(size / 2, adaptive.next_size(min_size, max_size));
+    size /= 2;
+
+    // Batches that didn't fill up don't make the next one bigger.
+    adaptive.note_batch(size / 4, kiloticks_t{0});
+    adaptive.note_sent();
+    adaptive.note_request();
+    EXPECT_EQ(size, adaptive.next_size(min_size, max_size));
+    adaptive.note_batch(size, kiloticks_t{0});
+    adaptive.note_sent();
+    adaptive.note_request();
+    EXPECT_EQ(size * 2, adaptive.next_size(min_size, max_size));
+
+    // Without a new request the size stays the same.
+    EXPECT_EQ(size * 2, adaptive.next_size(min_size, max_size));
+
+    // It never goes below the minimum.
+    for (int i = 0; i < 10; ++i) {
+        adaptive.note_batch(min_size, kiloticks_t{1000 * 1000 * 1000});
+        adaptive.note_sent();
+        adaptive.note_request();
+        EXPECT_LE(min_size, adaptive.next_size(min_size, max_size));
+    }
+    EXPECT_EQ(min_size, adaptive.get_size());
+}
+
+}  // namespace unittest
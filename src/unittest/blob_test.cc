@@ -130,10 +130,29 @@ public:
         check(txn);
     }
 
+    // Returns whether the blob could be rewritten in place.
+    bool rewrite(txn_t *txn, const std::string &x) {
+        SCOPED_TRACE(strprintf("rewrite (%zu)", x.size()));
+        const std::string old_ref = ref(txn->cache()->max_block_size());
+        const bool res = blob_.rewrite_changed_blocks(
+            std::vector<char>(x.begin(), x.end()), buf_parent_t(txn));
+        if (res) {
+            expected_ = x;
+            // The blob keeps its blocks.
+            EXPECT_EQ(old_ref, ref(txn->cache()->max_block_size()));
+        }
+        check(txn);
+        return res;
+    }
+
     size_t refsize(max_block_size_t block_size) const {
         return blob_.refsize(block_size);
     }
 
+    std::string ref(max_block_size_t block_size) const {
+        return std::string(buf_.data(), refsize(block_size));
+    }
+
 private:
     std::string expected_;
     scoped_array_t<char> buf_;
@@ -270,6 +289,45 @@ void combinations_test(cache_t *cache) {
 }
 
 
+void rewrite_changed_blocks_test(cache_t *cache) {
+    SCOPED_TRACE("rewrite_changed_blocks_test");
+    cache_conn_t cache_conn(cache);
+    txn_t txn(&cache_conn, write_durability_t::SOFT, 0);
+
+    // A value stored inline in its ref has to be rewritten by the caller.
+    {
+        blob_tracker_t tk(251);
+        tk.append(&txn, std::string(100, 'a'));
+        EXPECT_FALSE(tk.rewrite(&txn, std::string(100, 'b')));
+        tk.clear(&txn);
+    }
+
+    const int64_t l2_sz = size_after_magic * (size_after_magic / sizeof(block_id_t));
+    for (int64_t size : std::vector<int64_t>{size_after_magic * 3 + 10, l2_sz + 1}) {
+        SCOPED_TRACE(strprintf("size %" PRIi64, size));
+        blob_tracker_t tk(251);
+        tk.append(&txn, std::string(size, 'a'));
+
+        // A value of a different size has to be rewritten by the caller.
+        EXPECT_FALSE(tk.rewrite(&txn, std::string(size + 1, 'a')));
+        EXPECT_FALSE(tk.rewrite(&txn, std::string(size - 1, 'a')));
+
+        // Values of the same size are written over the blob's blocks: one byte in
+        // the middle, bytes at both ends, all of them, and none.
+        std::string x(size, 'a');
+        x[size / 2] = 'b';
+        EXPECT_TRUE(tk.rewrite(&txn, x));
+        x[0] = 'c';
+        x[size - 1] = 'c';
+        EXPECT_TRUE(tk.rewrite(&txn, x));
+        EXPECT_TRUE(tk.rewrite(&txn, std::string(size, 'd')));
+        EXPECT_TRUE(tk.rewrite(&txn, std::string(size, 'd')));
+        tk.clear(&txn);
+    }
+
+    txn.commit();
+}
+
 void run_tests(cache_t *cache) {
     // The tests above hard-code constants related to these numbers.
     EXPECT_EQ(251, blob::btree_maxreflen);
@@ -282,6 +340,7 @@ void run_tests(cache_t *cache) {
     small_value_test(cache);
     small_value_boundary_test(cache);
     combinations_test(cache);
+    rewrite_changed_blocks_test(cache);
 }
 
 TPTEST(BlobTest, AllTests) {
@@ -301,4 +360,24 @@ TPTEST(BlobTest, AllTests) {
     run_tests(&cache);
 }
 
+TEST(BlobTest, BtreeMaxreflen) {
+    // Data files with the default block size have to keep reading their values
+    // the way they were written.
+    EXPECT_EQ(blob::btree_maxreflen, blob::btree_maxreflen_for(
+        max_block_size_t::unsafe_make(DEFAULT_BTREE_BLOCK_SIZE)));
+    EXPECT_EQ(blob::btree_maxreflen, blob::btree_maxreflen_for(
+        max_block_size_t::unsafe_make(MIN_BTREE_BLOCK_SIZE)));
+
+    int prev = blob::btree_maxreflen;
+    for (int bs = 2 * DEFAULT_BTREE_BLOCK_SIZE; bs <= MAX_BTREE_BLOCK_SIZE; bs *= 2) {
+        max_block_size_t block_size = max_block_size_t::unsafe_make(bs);
+        int maxreflen = blob::btree_maxreflen_for(block_size);
+        EXPECT_LT(prev, maxreflen);
+        // The ref of a big value must still fit at least one block id.
+        EXPECT_LE(blob::maxreflen_from_blockid_count(1), maxreflen);
+        EXPECT_GE(bs / 8, maxreflen);
+        prev = maxreflen;
+    }
+}
+
 }  // namespace unittest
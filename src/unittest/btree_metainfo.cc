@@ -82,9 +82,10 @@ TPTEST(BtreeMetainfo, MetainfoTest) {
             scoped_ptr_t<txn_t> txn;
             {
                 scoped_ptr_t<real_superblock_t> superblock;
+                cond_t non_interruptor;
                 get_btree_superblock_and_txn_for_writing(
                     &cache_conn, nullptr, write_access_t::write, 1,
-                    write_durability_t::SOFT, &superblock, &txn);
+                    write_durability_t::SOFT, &superblock, &txn, &non_interruptor);
                 std::vector<std::vector<char> > keys;
                 std::vector<binary_blob_t> values;
                 for (const auto &pair : metainfo) {
@@ -0,0 +1,170 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include <set>
+#include <string>
+
+#include "arch/io/disk.hpp"
+#include "btree/reql_specific.hpp"
+#include "btree/sample.hpp"
+#include "buffer_cache/alt.hpp"
+#include "buffer_cache/cache_balancer.hpp"
+#include "concurrency/cond_var.hpp"
+#include "containers/uuid.hpp"
+#include "rdb_protocol/protocol.hpp"
+#include "rdb_protocol/store.hpp"
+#include "serializer/log/log_serializer.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/mock_store.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+/* A `store_t` on a temporary file, for sampling its primary btree. */
+class sample_store_t {
+public:
+    sample_store_t() :
+        io_backender(file_direct_io_mode_t::buffered_desired),
+        balancer(GIGABYTE),
+        file_opener(temp_file.name(), &io_backender),
+        serializer(create_serializer(&file_opener)),
+        store(region_t::universe(),
+              serializer.get(),
+              &balancer,
+              "unit_test_store",
+              true,
+              &get_global_perfmon_collection(),
+              nullptr,
+              &io_backender,
+              base_path_t("."),
+              generate_uuid(),
+              update_sindexes_t::UPDATE,
+              which_cpu_shard_t{0, 1}),
+        timestamp(state_timestamp_t::zero()) { }
+
+    void insert(const std::string &key, const std::string &value) {
+#ifndef NDEBUG
+        metainfo_checker_t checker(region_t::universe(),
+            [](const region_t &, const binary_blob_t &) { });
+#endif
+        cond_t non_interruptor;
+        write_token_t token;
+        store.new_write_token(&token);
+        write_response_t response;
+        timestamp = timestamp.next();
+        store.write(
+            DEBUG_ONLY(checker, )
+            region_map_t<binary_blob_t>(
+                region_t::universe(), binary_blob_t(timestamp)),
+            mock_overwrite(key, value), &response, write_durability_t::SOFT,
+            timestamp, order_token_t::ignore, &token, &non_interruptor);
+    }
+
+    // Samples `num` keys in `range` into `keys_out`, and returns the estimate.
+    int64_t sample(const key_range_t &range, uint64_t num,
+                   std::multiset<store_key_t> *keys_out) {
+        class callback_t : public btree_sample_callback_t {
+        public:
+            explicit callback_t(std::multiset<store_key_t> *_keys) : keys(_keys) { }
+            void on_sample(const btree_key_t *key, const void *, buf_parent_t) {
+                keys->insert(store_key_t(key));
+            }
+            std::multiset<store_key_t> *keys;
+        } cb(keys_out);
+
+        cond_t non_interruptor;
+        read_token_t token;
+        store.new_read_token(&token);
+        scoped_ptr_t<txn_t> txn;
+        scoped_ptr_t<real_superblock_t> superblock;
+        store.acquire_superblock_for_read(
+            &token, &txn, &superblock, &non_interruptor, false);
+        return sample_btree(superblock.get(), range, num, &cb);
+    }
+
+private:
+    static scoped_ptr_t<log_serializer_t> create_serializer(
+            filepath_file_opener_t *opener) {
+        recreate_temporary_directory(base_path_t("."));
+        log_serializer_t::create(opener, log_serializer_t::static_config_t());
+        return make_scoped<log_serializer_t>(
+            log_serializer_t::dynamic_config_t(), opener,
+            &get_global_perfmon_collection());
+    }
+
+    temp_file_t temp_file;
+    io_backender_t io_backender;
+    dummy_cache_balancer_t balancer;
+    filepath_file_opener_t file_opener;
+    scoped_ptr_t<log_serializer_t> serializer;
+    store_t store;
+    state_timestamp_t timestamp;
+};
+
+/* The keys `a0000` to `a0999` have short values, and `b0000` to `b0999` long ones, so
+the `b` keys are spread over many more leaves than the `a` keys. */
+const int keys_per_prefix = 1000;
+
+void insert_uneven_keys(sample_store_t *s) {
+    for (int i = 0; i < keys_per_prefix; ++i) {
+        s->insert(strprintf("a%04d", i), "x");
+        s->insert(strprintf("b%04d", i), std::string(150, 'x'));
+    }
+}
+
+TPTEST(BtreeSampleTest, DistinctKeys) {
+    sample_store_t s;
+    insert_uneven_keys(&s);
+    const uint64_t total = 2 * keys_per_prefix;
+
+    // However many keys are asked for, that many distinct keys are found, or all of
+    // them if there are fewer.
+    for (uint64_t num : {1, 10, 100, 500, 1000, 1999, 2000, 5000}) {
+        std::multiset<store_key_t> keys;
+        const int64_t estimate = s.sample(key_range_t::universe(), num, &keys);
+        EXPECT_EQ(std::min(num, total), keys.size());
+        EXPECT_EQ(keys.size(), std::set<store_key_t>(keys.begin(), keys.end()).size());
+        EXPECT_LT(0, estimate);
+        if (num >= total) {
+            EXPECT_EQ(static_cast<int64_t>(total), estimate);
+        }
+    }
+
+    // The same goes for part of the keys.
+    const key_range_t range(key_range_t::closed, store_key_t("a0500"),
+                            key_range_t::open, store_key_t("b0500"));
+    for (uint64_t num : {10, 100, 999, 1000, 2000}) {
+        std::multiset<store_key_t> keys;
+        s.sample(range, num, &keys);
+        EXPECT_EQ(std::min<uint64_t>(num, keys_per_prefix), keys.size());
+        EXPECT_EQ(keys.size(), std::set<store_key_t>(keys.begin(), keys.end()).size());
+        for (const store_key_t &key : keys) {
+            EXPECT_TRUE(range.contains_key(key));
+        }
+    }
+}
+
+TPTEST(BtreeSampleTest, Uniform) {
+    sample_store_t s;
+    insert_uneven_keys(&s);
+
+    /* Half of the keys are `a` keys, so about half of the sampled keys should be too,
+    even though a descent that picked leaves with equal probabilities would mostly end
+    up at `b` keys. */
+    const uint64_t num = 20;
+    const int runs = 200;
+    int a_keys = 0;
+    for (int i = 0; i < runs; ++i) {
+        std::multiset<store_key_t> keys;
+        s.sample(key_range_t::universe(), num, &keys);
+        ASSERT_EQ(num, keys.size());
+        for (const store_key_t &key : keys) {
+            if (key.contents()[0] == 'a') {
+                ++a_keys;
+            }
+        }
+    }
+    const double a_fraction = static_cast<double>(a_keys) / (num * runs);
+    EXPECT_LT(0.35, a_fraction);
+    EXPECT_GT(0.65, a_fraction);
+}
+
+}  // namespace unittest
@@ -56,10 +56,11 @@ TPTEST(BTreeSindex, LowLevelOps) {
         scoped_ptr_t<txn_t> txn;
         {
             scoped_ptr_t<real_superblock_t> superblock;
+            cond_t non_interruptor;
             get_btree_superblock_and_txn_for_writing(&cache_conn, nullptr,
                 write_access_t::write, 1,
                 write_durability_t::SOFT,
-                &superblock, &txn);
+                &superblock, &txn, &non_interruptor);
 
             buf_lock_t sindex_block(superblock->expose_buf(),
                 superblock->get_sindex_block_id(),
@@ -84,6 +85,7 @@ TPTEST(BTreeSindex, LowLevelOps) {
         scoped_ptr_t<txn_t> txn;
         {
             scoped_ptr_t<real_superblock_t> superblock;
+            cond_t non_interruptor;
             get_btree_superblock_and_txn_for_writing(
                 &cache_conn,
                 nullptr,
@@ -91,7 +93,8 @@ TPTEST(BTreeSindex, LowLevelOps) {
                 1,
                 write_durability_t::SOFT,
                 &superblock,
-                &txn);
+                &txn,
+                &non_interruptor);
             buf_lock_t sindex_block(
                 superblock->expose_buf(),
                 superblock->get_sindex_block_id(),
@@ -106,6 +109,7 @@ TPTEST(BTreeSindex, LowLevelOps) {
         scoped_ptr_t<txn_t> txn;
         {
             scoped_ptr_t<real_superblock_t> superblock;
+            cond_t non_interruptor;
             get_btree_superblock_and_txn_for_writing(
                 &cache_conn,
                 nullptr,
@@ -113,7 +117,8 @@ TPTEST(BTreeSindex, LowLevelOps) {
                 1,
                 write_durability_t::SOFT,
                 &superblock,
-                &txn);
+                &txn,
+                &non_interruptor);
             buf_lock_t sindex_block(
                 superblock->expose_buf(),
                 superblock->get_sindex_block_id(),
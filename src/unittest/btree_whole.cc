@@ -17,7 +17,13 @@ namespace unittest {
 
 class map_filler_callback_t : public depth_first_traversal_callback_t {
 public:
-    explicit map_filler_callback_t(std::map<store_key_t, std::string> *m_out) : m_out_(m_out) { }
+    explicit map_filler_callback_t(std::map<store_key_t, std::string> *m_out,
+                                   size_t read_ahead_budget = 0)
+        : m_out_(m_out), read_ahead_budget_(read_ahead_budget) { }
+
+    size_t get_read_ahead_budget() THROWS_NOTHING {
+        return read_ahead_budget_;
+    }
 
     continue_bool_t handle_pair(scoped_key_value_t &&keyvalue, UNUSED signal_t *interruptor) {
         store_key_t store_key(keyvalue.key());
@@ -34,6 +40,7 @@ public:
 
 private:
     std::map<store_key_t, std::string> *m_out_;
+    size_t read_ahead_budget_;
     scoped_ptr_t<store_key_t> last_key;
 };
 
@@ -79,6 +86,7 @@ public:
         scoped_ptr_t<real_superblock_t> superblock;
 
         if (readwrite) {
+            cond_t non_interruptor;
             get_btree_superblock_and_txn_for_writing(
                 cache_conn.get(),
                 nullptr,
@@ -86,7 +94,8 @@ public:
                 1,
                 write_durability_t::SOFT,
                 &superblock,
-                &txn);
+                &txn,
+                &non_interruptor);
         } else {
             get_btree_superblock_and_txn_for_reading(
                 cache_conn.get(),
@@ -217,7 +226,9 @@ public:
         run_txn_fn(false, [&](scoped_ptr_t<real_superblock_t> &&superblock){
             cond_t interruptor;
 
-            map_filler_callback_t filler_cb(&bt_map);
+            // Range reads read ahead (a few blocks at a time, so that the budget
+            // actually runs out), full traversals in `verify()` don't.
+            map_filler_callback_t filler_cb(&bt_map, 16 * KILOBYTE);
 
             btree_depth_first_traversal(
                 superblock.get(),
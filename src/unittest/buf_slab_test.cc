@@ -0,0 +1,63 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include <string.h>
+
+#include <set>
+#include <vector>
+
+#include "serializer/buf_ptr.hpp"
+#include "serializer/buf_slab.hpp"
+#include "unittest/gtest.hpp"
+
+namespace unittest {
+
+TEST(BufSlabTest, AllocFree) {
+    const buf_slab_stats_t before = get_buf_slab_stats();
+
+    std::vector<void *> ptrs;
+    std::set<void *> distinct;
+    for (size_t size = DEVICE_BLOCK_SIZE; size <= BUF_SLAB_MAX_CHUNK_SIZE;
+         size += 7 * DEVICE_BLOCK_SIZE) {
+        for (int i = 0; i < 100; ++i) {
+            void *ptr = buf_slab_alloc(size);
+            ASSERT_EQ(0u, reinterpret_cast<uintptr_t>(ptr) % DEVICE_BLOCK_SIZE);
+            memset(ptr, i, size);
+            ptrs.push_back(ptr);
+            distinct.insert(ptr);
+        }
+    }
+    ASSERT_EQ(ptrs.size(), distinct.size());
+
+    const buf_slab_stats_t during = get_buf_slab_stats();
+    ASSERT_GT(during.used_bytes, before.used_bytes);
+    ASSERT_GE(during.mapped_bytes, during.used_bytes);
+
+    // Freed chunks get reused.
+    buf_slab_free(ptrs.back());
+    ASSERT_EQ(ptrs.back(), buf_slab_alloc(DEVICE_BLOCK_SIZE +
+                                          7 * DEVICE_BLOCK_SIZE * (ptrs.size() / 100 - 1)));
+
+    for (void *ptr : ptrs) {
+        buf_slab_free(ptr);
+    }
+    const buf_slab_stats_t after = get_buf_slab_stats();
+    ASSERT_EQ(before.used_bytes, after.used_bytes);
+    ASSERT_LT(after.mapped_bytes, during.mapped_bytes);
+}
+
+TEST(BufSlabTest, BufPtr) {
+    const int64_t used_before = get_buf_slab_stats().used_bytes;
+    {
+        buf_ptr_t buf = buf_ptr_t::alloc_zeroed(block_size_t::unsafe_make(4096));
+        ASSERT_EQ(used_before + buf.aligned_block_size(),
+                  get_buf_slab_stats().used_bytes);
+        buf.resize_fill_zero(block_size_t::unsafe_make(8000));
+        ASSERT_EQ(used_before + buf.aligned_block_size(),
+                  get_buf_slab_stats().used_bytes);
+        buf_ptr_t copy = buf_ptr_t::alloc_copy(buf);
+        ASSERT_EQ(used_before + 2 * buf.aligned_block_size(),
+                  get_buf_slab_stats().used_bytes);
+    }
+    ASSERT_EQ(used_before, get_buf_slab_stats().used_bytes);
+}
+
+}  // namespace unittest
@@ -0,0 +1,35 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include "arch/runtime/event_queue_types.hpp"
+#include "config/args.hpp"
+#include "unittest/gtest.hpp"
+
+namespace unittest {
+
+TEST(BusyPollTest, AdaptiveSpin) {
+    busy_poll_policy_t::set_max_spin(ticks_t{100 * THOUSAND});
+    busy_poll_policy_t policy;
+    EXPECT_EQ(0, policy.get_spin().nanos);
+
+    // Events that would have been caught by spinning make it spin longer.
+    const int64_t growing[] = { 10, 20, 40, 80, 100, 100 };
+    for (int64_t usecs : growing) {
+        policy.on_blocked(ticks_t{50 * THOUSAND});
+        EXPECT_EQ(usecs * THOUSAND, policy.get_spin().nanos);
+    }
+
+    // Long waits make it back off until it doesn't spin at all.
+    const int64_t shrinking[] = { 50000, 25000, 12500, 0, 0 };
+    for (int64_t nanos : shrinking) {
+        policy.on_blocked(secs_to_ticks(1));
+        EXPECT_EQ(nanos, policy.get_spin().nanos);
+    }
+
+    // Turning busy polling off stops the spinning.
+    policy.on_blocked(ticks_t{50 * THOUSAND});
+    EXPECT_LT(0, policy.get_spin().nanos);
+    busy_poll_policy_t::set_max_spin(ticks_t{0});
+    policy.on_blocked(ticks_t{50 * THOUSAND});
+    EXPECT_EQ(0, policy.get_spin().nanos);
+}
+
+}  // namespace unittest
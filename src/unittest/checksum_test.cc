@@ -0,0 +1,60 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include <string.h>
+
+#include <vector>
+
+#include "serializer/checksum.hpp"
+#include "unittest/gtest.hpp"
+
+namespace unittest {
+
+void check_concat(checksum_algorithm_t algorithm) {
+    std::vector<uint32_t> words(3000);
+    uint32_t x = 12345;
+    for (uint32_t &word : words) {
+        x = x * 1103515245 + 12345;
+        word = x;
+    }
+
+    const serializer_checksum whole
+        = compute_checksum(algorithm, words.data(), words.size());
+    ASSERT_TRUE(has_checksum(whole));
+    for (size_t split : { 0, 1, 7, 64, 192, 1000, 2999, 3000 }) {
+        const serializer_checksum left
+            = compute_checksum(algorithm, words.data(), split);
+        const serializer_checksum right
+            = compute_checksum(algorithm, words.data() + split, words.size() - split);
+        EXPECT_EQ(whole.value,
+                  compute_checksum_concat(algorithm, left, right,
+                                          words.size() - split).value);
+    }
+    EXPECT_EQ(whole.value,
+              compute_checksum_concat(algorithm, identity_checksum(algorithm),
+                                      whole, words.size()).value);
+}
+
+TEST(ChecksumTest, Fletcher64Concat) {
+    check_concat(checksum_algorithm_t::fletcher64);
+}
+
+TEST(ChecksumTest, Crc32cConcat) {
+    check_concat(checksum_algorithm_t::crc32c);
+}
+
+TEST(ChecksumTest, Crc32cVectors) {
+    // From RFC 3720, appendix B.4.
+    char buf[32];
+    memset(buf, 0, sizeof(buf));
+    EXPECT_EQ(0x8A9136AAull << 32,
+              compute_checksum(checksum_algorithm_t::crc32c, buf, 8).value >> 32 << 32);
+    memset(buf, 0xFF, sizeof(buf));
+    EXPECT_EQ(0x62A8AB43ull << 32,
+              compute_checksum(checksum_algorithm_t::crc32c, buf, 8).value >> 32 << 32);
+    for (int i = 0; i < 32; ++i) {
+        buf[i] = i;
+    }
+    EXPECT_EQ(0x46DD794Eull << 32,
+              compute_checksum(checksum_algorithm_t::crc32c, buf, 8).value >> 32 << 32);
+}
+
+}  // namespace unittest
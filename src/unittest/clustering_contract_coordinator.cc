@@ -53,6 +53,9 @@ public:
         cs.config.write_ack_config = write_ack_config_t::MAJORITY;
         cs.config.durability = write_durability_t::HARD;
         cs.config.user_data = default_user_data();
+        cs.config.storage = default_table_storage_config();
+        cs.config.expiry = default_table_expiry_config();
+        cs.config.cache = default_table_cache_config();
 
         key_range_t::right_bound_t prev_right(store_key_t::min());
         for (const quick_shard_args_t &qs : qss) {
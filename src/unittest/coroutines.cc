@@ -1,9 +1,11 @@
 // Copyright 2010-2015 RethinkDB, all rights reserved.
 
+#include "arch/runtime/coro_sampler.hpp"
 #include "arch/runtime/coroutines.hpp"
 #include "arch/runtime/runtime.hpp"
 #include "concurrency/auto_drainer.hpp"
 #include "config/args.hpp"
+#include "time.hpp"
 #include "unittest/gtest.hpp"
 #include "unittest/unittest_utils.hpp"
 #include "utils.hpp"
@@ -106,6 +108,74 @@ TEST(CoroutinesTest, NotifyNow) {
     });
 }
 
+TEST(CoroutinesTest, ReuseParkedCoroutines) {
+    // More coroutines than fit on the free list get parked when they finish, and
+    // must still run correctly when they are picked up again.
+    run_in_thread_pool([&]() {
+        coro_t::set_parked_coroutine_limit(1000);
+        for (int round = 0; round < 3; ++round) {
+            int num_waiting = 500;
+            int sum = 0;
+            cond_t all_ran;
+            for (int i = 0; i < 500; ++i) {
+                coro_t::spawn_sometime([&, i]() {
+                    // Dirty a few pages of the stack, so there's something to release.
+                    volatile char buf[16 * KILOBYTE];
+                    for (size_t j = 0; j < sizeof(buf); j += 512) {
+                        buf[j] = i;
+                    }
+                    coro_t::yield();
+                    sum += buf[0] == static_cast<char>(i) ? 1 : 0;
+                    if (--num_waiting == 0) {
+                        all_ran.pulse();
+                    }
+                });
+            }
+            all_ran.wait_lazily_unordered();
+            ASSERT_EQ(500, sum);
+        }
+        coro_t::set_parked_coroutine_limit(0);
+    });
+}
+
+TPTEST(CoroutinesTest, CoroSamplerReport) {
+    // The first report turns the sampler on; the yields after it get sampled.
+    coro_sampler_t::get_report();
+    for (int i = 0; i < 100 * CORO_SAMPLER_PERIOD; ++i) {
+        coro_t::yield();
+    }
+    coro_sampler_t::report_t report = coro_sampler_t::get_report();
+    EXPECT_LE(50u, report.num_samples);
+    ASSERT_FALSE(report.execution_points.empty());
+    uint64_t num_samples = report.num_samples_dropped;
+    for (const auto &point : report.execution_points) {
+        EXPECT_FALSE(point.frames.empty());
+        EXPECT_LE(point.run_secs_max, point.run_secs_total);
+        num_samples += point.num_samples;
+    }
+    EXPECT_EQ(report.num_samples, num_samples);
+}
+
+// This is not really a unit test, but a micro benchmark that prints how long it
+// takes a coroutine to hop to another thread and back.
+#ifdef NDEBUG
+TEST(CoroutinesTest, ThreadHopBenchmark) {
+    run_in_thread_pool([&]() {
+        const int NUM_ROUND_TRIPS = 200000;
+        const threadnum_t home = get_thread_id();
+        const threadnum_t other(1);
+        ticks_t start_ticks = get_ticks();
+        for (int i = 0; i < NUM_ROUND_TRIPS; ++i) {
+            on_thread_t t(other);
+        }
+        int64_t nanos = get_ticks().nanos - start_ticks.nanos;
+        ASSERT_EQ(home, get_thread_id());
+        printf("%.0f ns per thread hop\n",
+               static_cast<double>(nanos) / (2 * NUM_ROUND_TRIPS));
+    }, 2);
+}
+#endif
+
 // The following test does not work on 32 bit architectures because it will exceed
 // their virtual memory.
 #if defined (__x86_64__) || defined (_WIN64)
@@ -0,0 +1,50 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include "arch/runtime/coroutines.hpp"
+#include "arch/runtime/cpu_task.hpp"
+#include "arch/runtime/runtime.hpp"
+#include "concurrency/cond_var.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+TPTEST(CpuTaskTest, StaysHomeWhenIdle, 4) {
+    const threadnum_t home = get_thread_id();
+    threadnum_t ran_on(-1);
+    run_cpu_task([&]() { ran_on = get_thread_id(); });
+    EXPECT_EQ(home, ran_on);
+    EXPECT_EQ(home, get_thread_id());
+}
+
+TPTEST(CpuTaskTest, SpreadsOverThreads, 4) {
+    const threadnum_t home = get_thread_id();
+    // The first task keeps its thread busy until we let it go.
+    cond_t release, first_started, first_done;
+    threadnum_t first_thread(-1);
+    coro_t::spawn_sometime([&]() {
+        run_cpu_task([&]() {
+            first_thread = get_thread_id();
+            first_started.pulse();
+            release.wait();
+        });
+        first_done.pulse();
+    });
+    first_started.wait();
+
+    threadnum_t second_thread(-1);
+    run_cpu_task([&]() { second_thread = get_thread_id(); });
+    EXPECT_EQ(home, get_thread_id());
+    EXPECT_NE(first_thread, second_thread);
+
+    release.pulse();
+    first_done.wait();
+}
+
+TPTEST(CpuTaskTest, Exceptions, 4) {
+    const threadnum_t home = get_thread_id();
+    EXPECT_THROW(run_cpu_task([]() { throw std::runtime_error("x"); }),
+                 std::runtime_error);
+    EXPECT_EQ(home, get_thread_id());
+}
+
+}  // namespace unittest
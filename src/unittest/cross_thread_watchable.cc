@@ -57,4 +57,27 @@ TPTEST(CrossThreadWatchable, CrossThreadWatchableTest) {
     }
 }
 
+TPTEST(CrossThreadWatchable, SharedSnapshotTest, 3) {
+    on_thread_t thread_switcher((threadnum_t(0)));
+    watchable_variable_t<int> watchable(0);
+    watchable_snapshot_t<int> snapshot(watchable.get_watchable());
+    cross_thread_watchable_variable_t<int> ctw1(&snapshot, threadnum_t(1));
+    cross_thread_watchable_variable_t<int> ctw2(&snapshot, threadnum_t(2));
+
+    watchable.set_value(7);
+    const int *values[2];
+    for (int t = 1; t <= 2; ++t) {
+        cross_thread_watchable_variable_t<int> *ctw = t == 1 ? &ctw1 : &ctw2;
+        on_thread_t switcher((threadnum_t(t)));
+        signal_timer_t timer;
+        timer.start(5000);
+        ctw->get_watchable()->run_until_satisfied(
+            [](int b) -> bool { return b == 7; }, &timer);
+        ctw->apply_read([&](const int *value) { values[t - 1] = value; });
+    }
+
+    // Both threads got the same copy of the value.
+    ASSERT_EQ(values[0], values[1]);
+}
+
 } //namespace unittest
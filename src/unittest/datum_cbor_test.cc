@@ -0,0 +1,65 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "rdb_protocol/datum_cbor.hpp"
+#include "rdb_protocol/error.hpp"
+#include "rdb_protocol/pseudo_time.hpp"
+#include "unittest/gtest.hpp"
+
+namespace unittest {
+
+std::string to_cbor(const ql::datum_t &datum) {
+    std::string out;
+    ql::write_datum_cbor(datum, &out);
+    return out;
+}
+
+TEST(DatumCborTest, Scalars) {
+    EXPECT_EQ(std::string("\xf6", 1), to_cbor(ql::datum_t::null()));
+    EXPECT_EQ(std::string("\xf5", 1), to_cbor(ql::datum_t::boolean(true)));
+    EXPECT_EQ(std::string("\xf4", 1), to_cbor(ql::datum_t::boolean(false)));
+    EXPECT_EQ(std::string("\x00", 1), to_cbor(ql::datum_t(0.0)));
+    EXPECT_EQ(std::string("\x17", 1), to_cbor(ql::datum_t(23.0)));
+    EXPECT_EQ(std::string("\x18\x18", 2), to_cbor(ql::datum_t(24.0)));
+    EXPECT_EQ(std::string("\x19\x03\xe8", 3), to_cbor(ql::datum_t(1000.0)));
+    EXPECT_EQ(std::string("\x1a\x00\x0f\x42\x40", 5), to_cbor(ql::datum_t(1000000.0)));
+    EXPECT_EQ(std::string("\x20", 1), to_cbor(ql::datum_t(-1.0)));
+    EXPECT_EQ(std::string("\x38\x63", 2), to_cbor(ql::datum_t(-100.0)));
+    EXPECT_EQ(std::string("\xfa\x3f\xc0\x00\x00", 5), to_cbor(ql::datum_t(1.5)));
+    EXPECT_EQ(std::string("\xfa\x80\x00\x00\x00", 5), to_cbor(ql::datum_t(-0.0)));
+    EXPECT_EQ(std::string("\xfb\x3f\xf1\x99\x99\x99\x99\x99\x9a", 9),
+              to_cbor(ql::datum_t(1.1)));
+    EXPECT_EQ(std::string("\x64" "abcd", 5), to_cbor(ql::datum_t("abcd")));
+    EXPECT_EQ(std::string("\x43\x00\x01\xff", 4),
+              to_cbor(ql::datum_t::binary(datum_string_t(3, "\x00\x01\xff"))));
+    EXPECT_THROW(to_cbor(ql::datum_t::minval()), ql::base_exc_t);
+}
+
+TEST(DatumCborTest, Containers) {
+    ql::datum_t array(std::vector<ql::datum_t>{
+            ql::datum_t(1.0), ql::datum_t("x"), ql::datum_t::empty_array()},
+        ql::configured_limits_t::unlimited);
+    EXPECT_EQ(std::string("\x83\x01\x61x\x80", 5), to_cbor(array));
+
+    ql::datum_t object(std::map<datum_string_t, ql::datum_t>{
+        std::make_pair(datum_string_t("a"), ql::datum_t(1.0)),
+        std::make_pair(datum_string_t("b"), ql::datum_t::null())});
+    EXPECT_EQ(std::string("\xa2\x61" "a\x01\x61" "b\xf6", 7), to_cbor(object));
+
+    std::vector<ql::datum_t> items(30, ql::datum_t::boolean(true));
+    const std::string encoded = to_cbor(
+        ql::datum_t(std::move(items), ql::configured_limits_t::unlimited));
+    EXPECT_EQ(std::string("\x98\x1e", 2) + std::string(30, '\xf5'), encoded);
+}
+
+TEST(DatumCborTest, Times) {
+    EXPECT_EQ(std::string("\xc1\xfa\x3f\xc0\x00\x00", 6),
+              to_cbor(ql::pseudo::make_time(1.5, "+00:00")));
+    const std::string local = to_cbor(ql::pseudo::make_time(0.0, "-07:00"));
+    EXPECT_EQ(std::string("\xc0\x78\x1d" "1969-12-31T17:00:00.000-07:00", 32), local);
+}
+
+}  // namespace unittest
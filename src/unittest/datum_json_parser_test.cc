@@ -0,0 +1,168 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#include <string>
+#include <vector>
+
+#include "random.hpp"
+#include "rapidjson/document.h"
+#include "rdb_protocol/datum_json.hpp"
+#include "rdb_protocol/datum_json_parser.hpp"
+#include "rdb_protocol/error.hpp"
+#include "time.hpp"
+#include "unittest/gtest.hpp"
+#include "utils.hpp"
+
+namespace unittest {
+
+rapidjson::ParseErrorCode parse_with_rapidjson(const std::string &json,
+                                               ql::datum_t *datum_out) {
+    rapidjson::Document doc;
+    doc.Parse(json.c_str());
+    if (doc.HasParseError()) {
+        return doc.GetParseError();
+    }
+    *datum_out = ql::to_datum(doc, ql::configured_limits_t::unlimited,
+                              reql_version_t::LATEST);
+    return rapidjson::kParseErrorNone;
+}
+
+rapidjson::ParseErrorCode parse_directly(const std::string &json,
+                                         ql::datum_t *datum_out) {
+    ql::datum_json_parser_t parser(json.data(), json.size());
+    return parser.to_datum(ql::configured_limits_t::unlimited, datum_out);
+}
+
+void check_same_as_rapidjson(const std::string &json) {
+    ql::datum_t expected, actual;
+    const rapidjson::ParseErrorCode expected_error =
+        parse_with_rapidjson(json, &expected);
+    const rapidjson::ParseErrorCode actual_error = parse_directly(json, &actual);
+    EXPECT_EQ(expected_error, actual_error) << json;
+    if (expected_error == rapidjson::kParseErrorNone
+        && actual_error == rapidjson::kParseErrorNone) {
+        EXPECT_EQ(expected, actual) << json;
+    }
+}
+
+TEST(DatumJsonParserTest, WellFormed) {
+    const std::vector<std::string> documents = {
+        "null", "true", "false", "0", "-0", "-0.0", "12", "-12", "1.5", "2.5e3",
+        "1E-2", "9007199254740993", "12345678901234567890",
+        "\"\"", "\"abc\"", "  [ ]  ", "{}", "[1,2,[3,[4]],{\"a\":[]}]",
+        "{\"a\" : 1 , \"b\" : {\"c\" : \"d\"}}",
+        "\"escapes: \\\" \\\\ \\/ \\b \\f \\n \\r \\t\"",
+        "\"\\u00e9\\u20ac\\ud83d\\ude00\"", "\"\\\\\\\"\"",
+        "\"h\xc3\xa9llo\"", "{\"$reql_type$\":\"LITERAL\",\"value\":1}",
+        std::string("[\"") + std::string(200, 'x') + "\\\\\", 1]",
+        std::string(100, ' ') + "{\"key\":" + std::string(100, '\n') + "true}"
+    };
+    for (const std::string &json : documents) {
+        check_same_as_rapidjson(json);
+    }
+}
+
+TEST(DatumJsonParserTest, Malformed) {
+    const std::vector<std::string> documents = {
+        "", "   ", "[", "{", "[1,]", "[1 2]", "{\"a\" 1}", "{\"a\":1,}", "{1:2}",
+        "{\"a\":1 \"b\":2}", "tru", "truex", "nul", "[true false]", "01", "-",
+        "1.", "1.e5", "1e", "1e+", "1e400", "\"abc", "\"\\x\"", "\"\\u12g4\"",
+        "\"\\ud800\"", "\"\\ud800\\u0041\"", "\"a\nb\"", "1 2", "[] []", "]",
+        "[1}", "{\"a\":1]", "\"a\"b", "[1,\"a\"\"b\"]", "\\", "[\\\"]"
+    };
+    for (const std::string &json : documents) {
+        check_same_as_rapidjson(json);
+    }
+}
+
+TEST(DatumJsonParserTest, DatumErrors) {
+    const std::vector<std::string> documents = {
+        // Invalid UTF-8, in a value and in a key.
+        "\"\xff\"", "{\"\xff\":1}", "{\"a\":1,\"a\":2}"
+    };
+    for (const std::string &json : documents) {
+        ql::datum_t datum;
+        EXPECT_THROW(parse_with_rapidjson(json, &datum), ql::base_exc_t);
+        EXPECT_THROW(parse_directly(json, &datum), ql::base_exc_t);
+    }
+}
+
+/* Generates documents like the ones people insert: objects with short keys and a mix
+of strings, numbers, nested objects and arrays. */
+std::string random_document(rng_t *rng, int depth) {
+    std::string json;
+    const int num_fields = 1 + rng->randint(8);
+    json += "{";
+    for (int i = 0; i < num_fields; ++i) {
+        json += strprintf("%s\"field_%d\": ", i == 0 ? "" : ", ", i);
+        switch (rng->randint(depth > 0 ? 6 : 4)) {
+        case 0:
+            json += strprintf("%d", rng->randint(2000000) - 1000000);
+            break;
+        case 1:
+            json += strprintf("%d.%d", rng->randint(1000), rng->randint(100));
+            break;
+        case 2: {
+            std::string str = "\"";
+            const int length = rng->randint(40);
+            for (int j = 0; j < length; ++j) {
+                const int r = rng->randint(30);
+                str += r == 0 ? "\\n" : r == 1 ? "\\\"" : r == 2 ? "\\u00e9"
+                    : std::string(1, 'a' + rng->randint(26));
+            }
+            json += str + "\"";
+        } break;
+        case 3:
+            json += rng->randint(2) == 0 ? "true" : "null";
+            break;
+        case 4:
+            json += random_document(rng, depth - 1);
+            break;
+        case 5:
+            json += "[" + random_document(rng, depth - 1) + ", "
+                + random_document(rng, depth - 1) + "]";
+            break;
+        default: unreachable();
+        }
+    }
+    json += "}";
+    return json;
+}
+
+TEST(DatumJsonParserTest, RandomDocuments) {
+    rng_t rng(0);
+    for (int i = 0; i < 200; ++i) {
+        check_same_as_rapidjson(random_document(&rng, 3));
+    }
+}
+
+// This is not really a unit test, but a micro benchmark that compares parsing a
+// batch of documents into datums with and without the intermediate RapidJSON DOM.
+// No need to run this in debug mode.
+#ifdef NDEBUG
+template <class parse_t>
+double mb_per_sec(const std::string &json, const parse_t &parse) {
+    const int NUM_REPETITIONS = 50;
+    ticks_t start_ticks = get_ticks();
+    for (int i = 0; i < NUM_REPETITIONS; ++i) {
+        ql::datum_t datum;
+        EXPECT_EQ(rapidjson::kParseErrorNone, parse(json, &datum));
+    }
+    int64_t nanos = get_ticks().nanos - start_ticks.nanos;
+    return static_cast<double>(json.size()) * NUM_REPETITIONS * 1000.0 / nanos;
+}
+
+TEST(DatumJsonParserTest, ParseBenchmark) {
+    rng_t rng(0);
+    std::string batch = "[";
+    for (int i = 0; i < 2000; ++i) {
+        batch += (i == 0 ? "" : ",\n") + random_document(&rng, 2);
+    }
+    batch += "]";
+    printf("Batch of 2000 documents (%zu bytes):\n", batch.size());
+    printf("  rapidjson + to_datum:  %.1f MB/s\n",
+           mb_per_sec(batch, &parse_with_rapidjson));
+    printf("  datum_json_parser_t:   %.1f MB/s\n",
+           mb_per_sec(batch, &parse_directly));
+}
+#endif  // NDEBUG
+
+}  // namespace unittest
@@ -1,9 +1,15 @@
 // Copyright 2010-2013 RethinkDB, all rights reserved.
 
+#include <string.h>
+
 #include "containers/archive/string_stream.hpp"
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
 #include "rdb_protocol/datum.hpp"
 #include "rdb_protocol/datum_string.hpp"
 #include "rdb_protocol/env.hpp"
+#include "rdb_protocol/pseudo_time.hpp"
+#include "rdb_protocol/term_storage.hpp"
 #include "unittest/gtest.hpp"
 
 
@@ -205,4 +211,277 @@ TEST(DatumTest, OffsetScaling) {
     }
 }
 
+std::string write_compact_json(const ql::datum_t &datum) {
+    rapidjson::StringBuffer buffer;
+    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+    datum.write_json(&writer);
+    return std::string(buffer.GetString(), buffer.GetSize());
+}
+
+// Buffer-backed arrays and objects are written as JSON straight from the buffer.
+TEST(DatumTest, JsonFromBuffer) {
+    std::string escapes = "quote \" backslash \\ tab \t del \x7f";
+    for (char c = 0; c < 0x20; ++c) {
+        escapes += c;
+    }
+    escapes += std::string(40, 'z') + "\xc3\xa9\n";
+    ql::datum_t inner(std::map<datum_string_t, ql::datum_t>
+        {std::make_pair(datum_string_t("bin"),
+                        ql::datum_t::binary(datum_string_t(std::string("\0\1", 2)))),
+         std::make_pair(datum_string_t(escapes), ql::datum_t(-0.0))});
+    ql::datum_t datum(std::map<datum_string_t, ql::datum_t>
+        {std::make_pair(datum_string_t("a"), ql::datum_t(1.0)),
+         std::make_pair(datum_string_t("b"), ql::datum_t(-1.5e300)),
+         std::make_pair(datum_string_t("c"), ql::datum_t(escapes)),
+         std::make_pair(datum_string_t("d"), ql::datum_t::boolean(false)),
+         std::make_pair(datum_string_t("e"), ql::datum_t::null()),
+         std::make_pair(datum_string_t("f"), ql::datum_t(
+             std::vector<ql::datum_t>{inner, ql::datum_t(9007199254740992.0), inner},
+             ql::configured_limits_t::unlimited)),
+         std::make_pair(datum_string_t("g"), ql::datum_t(
+             std::vector<ql::datum_t>(), ql::configured_limits_t::unlimited))});
+
+    ql::datum_t deserialized;
+    {
+        string_stream_t write_stream;
+        write_message_t wm;
+        serialize<cluster_version_t::LATEST_OVERALL>(&wm, datum);
+        ASSERT_EQ(0, send_write_message(&write_stream, &wm));
+        string_read_stream_t read_stream(std::move(write_stream.str()), 0);
+        ASSERT_EQ(archive_result_t::SUCCESS,
+                  deserialize<cluster_version_t::LATEST_OVERALL>(&read_stream,
+                                                                 &deserialized));
+    }
+    ASSERT_TRUE(deserialized.get_buf_ref() != nullptr);
+    EXPECT_EQ(write_compact_json(datum), write_compact_json(deserialized));
+    EXPECT_EQ(datum.print(), deserialized.print());
+}
+
+// `get_field` on a buffer-backed object searches the serialized keys.
+TEST(DatumTest, GetFieldFromBuffer) {
+    std::map<datum_string_t, ql::datum_t> fields;
+    for (int i = 0; i < 300; i += 3) {
+        fields[datum_string_t(strprintf("field_%d", i))] =
+            ql::datum_t(static_cast<double>(i));
+    }
+    fields[datum_string_t("")] = ql::datum_t("empty");
+    fields[datum_string_t("long_" + std::string(300, 'x'))] = ql::datum_t::null();
+    const ql::datum_t datum(std::move(fields));
+
+    ql::datum_t deserialized;
+    {
+        string_stream_t write_stream;
+        write_message_t wm;
+        serialize<cluster_version_t::LATEST_OVERALL>(&wm, datum);
+        ASSERT_EQ(0, send_write_message(&write_stream, &wm));
+        string_read_stream_t read_stream(std::move(write_stream.str()), 0);
+        ASSERT_EQ(archive_result_t::SUCCESS,
+                  deserialize<cluster_version_t::LATEST_OVERALL>(&read_stream,
+                                                                 &deserialized));
+    }
+    ASSERT_TRUE(deserialized.get_buf_ref() != nullptr);
+
+    for (int i = -1; i < 301; ++i) {
+        const datum_string_t key(strprintf("field_%d", i));
+        EXPECT_EQ(datum.get_field(key, ql::NOTHROW),
+                  deserialized.get_field(key, ql::NOTHROW));
+        EXPECT_EQ(i >= 0 && i % 3 == 0, deserialized.get_field(key, ql::NOTHROW).has());
+    }
+    EXPECT_EQ(ql::datum_t("empty"), deserialized.get_field(""));
+    EXPECT_EQ(ql::datum_t::null(),
+              deserialized.get_field(
+                  datum_string_t("long_" + std::string(300, 'x'))));
+    EXPECT_FALSE(deserialized.get_field("long_", ql::NOTHROW).has());
+    EXPECT_THROW(deserialized.get_field("missing"), ql::base_exc_t);
+}
+
+// Short strings are stored inline, longer ones in a shared buffer.
+TEST(DatumTest, InlineStrings) {
+    for (size_t size = 0; size < 2 * datum_string_t::MAX_INLINE_SIZE + 3; ++size) {
+        std::string chars;
+        for (size_t i = 0; i < size; ++i) {
+            chars += static_cast<char>(i % 3 == 0 ? '\0' : 'a' + i);
+        }
+        datum_string_t str(chars);
+        EXPECT_EQ(size, str.size());
+        EXPECT_EQ(chars, str.to_std());
+
+        datum_string_t copy(str);
+        datum_string_t moved(std::move(copy));
+        EXPECT_EQ(str, moved);
+        copy = moved;
+        EXPECT_EQ(str, copy);
+        EXPECT_EQ(0, str.compare(copy.size(), copy.data()));
+
+        const size_t half = size / 2;
+        datum_string_t joined = concat(datum_string_t(chars.substr(0, half)),
+                                       datum_string_t(chars.substr(half)));
+        EXPECT_EQ(str, joined);
+
+        ql::datum_t datum(str);
+        EXPECT_EQ(chars, datum.as_str().to_std());
+        test_datum_serialization(datum);
+    }
+}
+
+// Field names that don't fit inline are shared between objects on the same thread.
+TEST(DatumTest, InternedStrings) {
+    const std::string name = "a_rather_long_field_name";
+    datum_string_t a = datum_string_t::intern(name.size(), name.data());
+    datum_string_t b = datum_string_t::intern(name.size(), name.data());
+    EXPECT_EQ(name, a.to_std());
+    EXPECT_EQ(a.data(), b.data());
+    EXPECT_EQ(a, b);
+    EXPECT_NE(a.data(), datum_string_t(name).data());
+    EXPECT_EQ(a, datum_string_t(name));
+
+    const std::string too_long(datum_string_t::MAX_INTERNED_SIZE + 1, 'x');
+    EXPECT_NE(datum_string_t::intern(too_long.size(), too_long.data()).data(),
+              datum_string_t::intern(too_long.size(), too_long.data()).data());
+
+    // Objects deserialized from the legacy format share their keys.  This one is
+    // {a_rather_long_field_name: null}.
+    std::vector<char> legacy_object = {0x05, 0x01, static_cast<char>(name.size())};
+    legacy_object.insert(legacy_object.end(), name.begin(), name.end());
+    legacy_object.push_back(0x03);
+    ql::datum_t objects[2];
+    for (int i = 0; i < 2; ++i) {
+        std::vector<char> copy = legacy_object;
+        vector_read_stream_t s(std::move(copy));
+        ASSERT_EQ(archive_result_t::SUCCESS, datum_deserialize(&s, &objects[i]));
+        ASSERT_EQ(ql::datum_t::null(), objects[i].get_field(a));
+    }
+    EXPECT_EQ(objects[0].get_pair(0).first.data(), objects[1].get_pair(0).first.data());
+}
+
+// Short strings in a client query become datums that reference the query buffer.
+TEST(DatumTest, InsituQueryStrings) {
+    const std::string long_string(200, 'x');
+    const std::string query =
+        "[1,[2,[\"short\",\"\",\"a\\nb\",\"" + long_string + "\"]]]";
+    counted_t<shared_buf_t> buffer = shared_buf_t::create(query.size() + 1);
+    memcpy(buffer->data(), query.c_str(), query.size() + 1);
+    const char *buffer_begin = buffer->data();
+    const char *buffer_end = buffer_begin + buffer->size();
+
+    rapidjson::Document doc;
+    doc.ParseInsitu(buffer->data());
+    ASSERT_FALSE(doc.HasParseError());
+    ql::json_term_storage_t storage(std::move(buffer), std::move(doc));
+    storage.preprocess();
+    ql::raw_term_t make_array = storage.root_term();
+    ASSERT_EQ(4u, make_array.num_args());
+
+    const std::string expected[] = { "short", "", "a\nb", long_string };
+    for (size_t i = 0; i < 4; ++i) {
+        ql::datum_t datum = make_array.arg(i).datum();
+        const datum_string_t &str = datum.as_str();
+        EXPECT_EQ(expected[i], str.to_std());
+        const bool in_buffer = str.data() >= buffer_begin && str.data() < buffer_end;
+        EXPECT_EQ(i != 3, in_buffer);
+    }
+}
+
+// Sort keys order datums the same way `cmp` does.
+TEST(DatumTest, SortKeys) {
+    const std::vector<ql::datum_t> datums = {
+        ql::datum_t::null(), ql::datum_t::boolean(false), ql::datum_t::boolean(true),
+        ql::datum_t(-1e300), ql::datum_t(-2.5), ql::datum_t(-0.0), ql::datum_t(0.0),
+        ql::datum_t(1e-300), ql::datum_t(3.0), ql::datum_t(1e300),
+        ql::datum_t(""), ql::datum_t(datum_string_t(1, "\0")),
+        ql::datum_t(datum_string_t(2, "\0\0")), ql::datum_t(datum_string_t(1, "\1")),
+        ql::datum_t(datum_string_t(2, "\1\0")), ql::datum_t("\2"), ql::datum_t("a"),
+        ql::datum_t("ab"), ql::datum_t("b"), ql::datum_t("\xc3\xa9")
+    };
+    for (const ql::datum_t &l : datums) {
+        for (const ql::datum_t &r : datums) {
+            std::string l_key, r_key;
+            ASSERT_TRUE(l.append_sort_key(&l_key));
+            ASSERT_TRUE(r.append_sort_key(&r_key));
+            const int expected = l.cmp(r);
+            const int actual = l_key.compare(r_key);
+            EXPECT_EQ(expected < 0, actual < 0) << l.print() << " " << r.print();
+            EXPECT_EQ(expected == 0, actual == 0) << l.print() << " " << r.print();
+
+            // Appending another key doesn't change the order.
+            if (expected != 0) {
+                EXPECT_EQ(expected < 0, (l_key + r_key).compare(r_key + l_key) < 0);
+            }
+        }
+    }
+
+    std::string key;
+    EXPECT_FALSE(ql::datum_t::empty_array().append_sort_key(&key));
+    EXPECT_FALSE(ql::datum_t::empty_object().append_sort_key(&key));
+    EXPECT_EQ("", key);
+}
+
+ql::datum_t make_test_object(
+        std::initializer_list<std::pair<const char *, ql::datum_t> > fields) {
+    std::map<datum_string_t, ql::datum_t> map;
+    for (const auto &field : fields) {
+        map[datum_string_t(field.first)] = field.second;
+    }
+    return ql::datum_t(std::move(map));
+}
+
+TEST(DatumTest, MergeInterleavedFields) {
+    ql::datum_t nested = make_test_object({{"x", ql::datum_t(1.0)}});
+    ql::datum_t lhs = make_test_object({
+        {"a", ql::datum_t(1.0)}, {"c", nested}, {"e", ql::datum_t(5.0)},
+        {"g", ql::datum_t(7.0)}});
+    ql::datum_t rhs = make_test_object({
+        {"b", ql::datum_t(2.0)}, {"c", make_test_object({{"y", ql::datum_t(2.0)}})},
+        {"e", ql::datum_t("e")}, {"h", ql::datum_t(8.0)}});
+    ql::datum_t expected = make_test_object({
+        {"a", ql::datum_t(1.0)}, {"b", ql::datum_t(2.0)},
+        {"c", make_test_object({{"x", ql::datum_t(1.0)}, {"y", ql::datum_t(2.0)}})},
+        {"e", ql::datum_t("e")}, {"g", ql::datum_t(7.0)}, {"h", ql::datum_t(8.0)}});
+    EXPECT_EQ(expected, lhs.merge(rhs));
+    EXPECT_EQ(lhs, lhs.merge(ql::datum_t::empty_object()));
+    EXPECT_EQ(rhs, ql::datum_t::empty_object().merge(rhs));
+
+    // The same goes for objects that are still serialized.
+    ql::datum_t serialized_lhs;
+    {
+        string_stream_t write_stream;
+        write_message_t wm;
+        serialize<cluster_version_t::LATEST_OVERALL>(&wm, lhs);
+        ASSERT_EQ(0, send_write_message(&write_stream, &wm));
+        string_read_stream_t read_stream(std::move(write_stream.str()), 0);
+        ASSERT_EQ(archive_result_t::SUCCESS,
+                  deserialize<cluster_version_t::LATEST_OVERALL>(&read_stream,
+                                                                 &serialized_lhs));
+    }
+    EXPECT_EQ(expected, serialized_lhs.merge(rhs));
+}
+
+// `distinct` relies on equal data having equal hashes.
+TEST(DatumTest, HashFollowsEquality) {
+    std::vector<ql::datum_t> datums = {
+        ql::datum_t::null(), ql::datum_t::boolean(false), ql::datum_t::boolean(true),
+        ql::datum_t(0.0), ql::datum_t(-0.0), ql::datum_t(1.0), ql::datum_t(""),
+        ql::datum_t("a"), ql::datum_t("b"), ql::datum_t::empty_array(),
+        ql::datum_t::empty_object(),
+        ql::datum_t(std::vector<ql::datum_t>{ql::datum_t(0.0), ql::datum_t("a")},
+                    ql::configured_limits_t::unlimited),
+        ql::datum_t(std::vector<ql::datum_t>{ql::datum_t(-0.0), ql::datum_t("a")},
+                    ql::configured_limits_t::unlimited),
+        ql::datum_t(std::map<datum_string_t, ql::datum_t>{
+            {datum_string_t("a"), ql::datum_t(1.0)}}),
+        ql::datum_t(std::map<datum_string_t, ql::datum_t>{
+            {datum_string_t("b"), ql::datum_t(1.0)}}),
+        ql::pseudo::make_time(1.5, "+00:00"), ql::pseudo::make_time(1.5, "-07:00"),
+        ql::pseudo::make_time(2.5, "+00:00")
+    };
+    for (const ql::datum_t &l : datums) {
+        for (const ql::datum_t &r : datums) {
+            if (l == r) {
+                EXPECT_EQ(l.hash(), r.hash()) << l.print() << " " << r.print();
+            }
+        }
+    }
+    EXPECT_NE(ql::datum_t("a").hash(), ql::datum_t("b").hash());
+}
+
 }  // namespace unittest
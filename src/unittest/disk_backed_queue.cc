@@ -1,4 +1,5 @@
 // Copyright 2010-2013 RethinkDB, all rights reserved.
+#include <functional>
 #include <queue>
 
 #include "arch/io/disk.hpp"
@@ -18,13 +19,15 @@ serializer_filepath_t dbq_serializer_path() {
     return manual_serializer_filepath(DBQ_TEST_PATH, std::string(DBQ_TEST_PATH) + ".create");
 }
 
-void run_many_ints_test() {
+void run_many_ints_test(io_backend_t io_backend, disk_queue_format_t format) {
     static const int NUM_ELTS_IN_QUEUE = 1000;
-    io_backender_t io_backender(file_direct_io_mode_t::buffered_desired);
+    io_backender_t io_backender(file_direct_io_mode_t::buffered_desired,
+                                DEFAULT_MAX_CONCURRENT_IO_REQUESTS, io_backend);
 
     const serializer_filepath_t serializer_path = dbq_serializer_path();
 
-    disk_backed_queue_t<int> queue(&io_backender, serializer_path, &get_global_perfmon_collection());
+    disk_backed_queue_t<int> queue(&io_backender, serializer_path,
+                                   &get_global_perfmon_collection(), format);
     std::queue<int> ref_queue;
 
     for (int i = 0; i < NUM_ELTS_IN_QUEUE; ++i) {
@@ -42,16 +45,30 @@ void run_many_ints_test() {
 }
 
 TEST(DiskBackedQueue, ManyInts) {
-    unittest::run_in_thread_pool(&run_many_ints_test, 2);
+    unittest::run_in_thread_pool(std::bind(&run_many_ints_test, io_backend_t::pool,
+                                           disk_queue_format_t::BLOCKS), 2);
+}
+
+TEST(DiskBackedQueue, ManyIntsSegmentFile) {
+    unittest::run_in_thread_pool(std::bind(&run_many_ints_test, io_backend_t::pool,
+                                           disk_queue_format_t::SEGMENT_FILE), 2);
+}
+
+// This falls back to the thread pool if the kernel doesn't support io_uring.
+TEST(DiskBackedQueue, ManyIntsIoUring) {
+    unittest::run_in_thread_pool(
+        std::bind(&run_many_ints_test, io_backend_t::io_uring,
+                  disk_queue_format_t::BLOCKS), 2);
 }
 
-void run_big_values_test() {
+void run_big_values_test(disk_queue_format_t format) {
     static const int NUM_BIG_ELTS_IN_QUEUE = 100;
     io_backender_t io_backender(file_direct_io_mode_t::buffered_desired);
 
     const serializer_filepath_t serializer_path = dbq_serializer_path();
 
-    disk_backed_queue_t<std::string> queue(&io_backender, serializer_path, &get_global_perfmon_collection());
+    disk_backed_queue_t<std::string> queue(&io_backender, serializer_path,
+                                           &get_global_perfmon_collection(), format);
     std::queue<std::string> ref_queue;
 
     std::string val;
@@ -71,7 +88,54 @@ void run_big_values_test() {
 }
 
 TEST(DiskBackedQueue, BigVals) {
-    unittest::run_in_thread_pool(&run_big_values_test, 2);
+    unittest::run_in_thread_pool(
+        std::bind(&run_big_values_test, disk_queue_format_t::BLOCKS), 2);
+}
+
+TEST(DiskBackedQueue, BigValsSegmentFile) {
+    unittest::run_in_thread_pool(
+        std::bind(&run_big_values_test, disk_queue_format_t::SEGMENT_FILE), 2);
+}
+
+// Pops some values before their segments are written and empties the queue in
+// between, so that the segment file gets reused from its start.
+void run_interleaved_segment_file_test() {
+    io_backender_t io_backender(file_direct_io_mode_t::buffered_desired);
+
+    disk_backed_queue_t<std::string> queue(&io_backender, dbq_serializer_path(),
+                                           &get_global_perfmon_collection(),
+                                           disk_queue_format_t::SEGMENT_FILE);
+    std::queue<std::string> ref_queue;
+
+    int next_value = 0;
+    for (int round = 0; round < 3; ++round) {
+        for (int step = 0; step < 4; ++step) {
+            for (int i = 0; i < 25; ++i) {
+                std::string val(100 * KILOBYTE, 'a' + next_value % 26);
+                ++next_value;
+                queue.push(val);
+                ref_queue.push(val);
+            }
+            for (int i = 0; i < 10; ++i) {
+                std::string x;
+                queue.pop(&x);
+                EXPECT_EQ(ref_queue.front(), x);
+                ref_queue.pop();
+            }
+        }
+        while (!ref_queue.empty()) {
+            EXPECT_FALSE(queue.empty());
+            std::string x;
+            queue.pop(&x);
+            EXPECT_EQ(ref_queue.front(), x);
+            ref_queue.pop();
+        }
+        EXPECT_TRUE(queue.empty());
+    }
+}
+
+TEST(DiskBackedQueue, InterleavedSegmentFile) {
+    unittest::run_in_thread_pool(&run_interleaved_segment_file_test, 2);
 }
 
 static void randomly_delay(int, signal_t *) {
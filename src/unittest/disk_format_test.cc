@@ -148,6 +148,9 @@ TEST(DiskFormatTest, CrcMetablockT) {
     EXPECT_EQ(n, offsetof(crc_metablock_t, fileranges_checksum_v2_5));
     n += 136;
     EXPECT_EQ(3896, n);
+    EXPECT_EQ(n, offsetof(crc_metablock_t, checksum_algorithm));
+    n += 4;
+    EXPECT_EQ(3900, n);
     EXPECT_EQ(n, sizeof(crc_metablock_t));
 }
 
@@ -1,5 +1,7 @@
 // Copyright 2010-2014 RethinkDB, all rights reserved.
+#include <algorithm>
 #include <functional>
+#include <string>
 
 #include "arch/runtime/coroutines.hpp"
 #include "containers/archive/archive.hpp"
@@ -173,6 +175,63 @@ SPAWNER_TEST(ExtProc, TalkativeJob) {
     } while (n != 1);
 }
 
+// Sends a string to the worker, which sends it back reversed.  Large strings go
+// through the memory shared with the worker, or through the socket if they don't fit.
+class echo_job_t {
+public:
+    echo_job_t(extproc_pool_t *pool, signal_t *interruptor) :
+        extproc_job(pool, &worker_fn, interruptor) { }
+
+    std::string run(const std::string &data) {
+        write_message_t wm;
+        serialize<cluster_version_t::LATEST_OVERALL>(&wm, data);
+        {
+            int res = send_write_message(extproc_job.write_stream(), &wm);
+            guarantee(res == 0);
+        }
+
+        std::string result;
+        archive_result_t res
+            = deserialize<cluster_version_t::LATEST_OVERALL>(extproc_job.read_stream(),
+                                                             &result);
+        guarantee_deserialization(res, "echo_job_t result");
+        return result;
+    }
+
+private:
+    static bool worker_fn(read_stream_t *stream_in, write_stream_t *stream_out) {
+        std::string data;
+        archive_result_t res
+            = deserialize<cluster_version_t::LATEST_OVERALL>(stream_in, &data);
+        if (bad(res)) { return false; }
+
+        std::reverse(data.begin(), data.end());
+        write_message_t wm;
+        serialize<cluster_version_t::LATEST_OVERALL>(&wm, data);
+        return send_write_message(stream_out, &wm) == 0;
+    }
+
+    extproc_job_t extproc_job;
+};
+
+SPAWNER_TEST(ExtProc, LargePayloads) {
+    extproc_pool_t pool(1);
+
+    // Enough rounds to wrap around the shared memory's rings several times
+    const size_t sizes[] = { 0, 10, 5000, 300000, 700000, 3000000 };
+    for (size_t round = 0; round < 4; ++round) {
+        for (size_t size : sizes) {
+            std::string data(size, '\0');
+            for (size_t i = 0; i < size; ++i) {
+                data[i] = static_cast<char>(i * 7 + round);
+            }
+            echo_job_t job(&pool, nullptr);
+            std::string expected(data.rbegin(), data.rend());
+            ASSERT_EQ(expected, job.run(data));
+        }
+    }
+}
+
 void run_single_job(extproc_pool_t *pool, size_t *counter, cond_t *done) {
     fib_job_t job(10, pool, nullptr);
 
@@ -0,0 +1,163 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#include <map>
+#include <string>
+#include <utility>
+
+#include "rdb_protocol/compiled_func.hpp"
+#include "rdb_protocol/func.hpp"
+#include "rdb_protocol/minidriver.hpp"
+#include "rdb_protocol/wire_func.hpp"
+#include "unittest/gtest.hpp"
+
+namespace unittest {
+
+counted_t<const ql::func_t> make_func(const ql::raw_term_t &body, ql::sym_t arg) {
+    return ql::map_wire_func_t(body, make_vector(arg)).compile_wire_func();
+}
+
+TEST(FuncTest, SelectedField) {
+    ql::sym_t one(1), two(2);
+    ql::minidriver_t r(ql::backtrace_id_t::empty());
+
+    optional<datum_string_t> field =
+        make_func(r.var(one)["sid"].root_term(), one)->selected_field();
+    ASSERT_TRUE(field.has_value());
+    EXPECT_EQ("sid", field->to_std());
+
+    // Not a field of the function's own argument.
+    EXPECT_FALSE(make_func(r.var(two)["sid"].root_term(), one)
+                     ->selected_field().has_value());
+    // Nested fields aren't top-level fields.
+    EXPECT_FALSE(make_func(r.var(one)["a"]["b"].root_term(), one)
+                     ->selected_field().has_value());
+    EXPECT_FALSE(make_func(r.var(one)["sid"].root_term(), one)
+                     ->field_equality().has_value());
+}
+
+TEST(FuncTest, FieldEquality) {
+    ql::sym_t one(1);
+    ql::minidriver_t r(ql::backtrace_id_t::empty());
+
+    for (const ql::raw_term_t &body : { (r.var(one)["sid"] == r.expr(5.0)).root_term(),
+                                        (r.expr(5.0) == r.var(one)["sid"]).root_term() }) {
+        optional<std::pair<datum_string_t, ql::datum_t> > equality =
+            make_func(body, one)->field_equality();
+        ASSERT_TRUE(equality.has_value());
+        EXPECT_EQ("sid", equality->first.to_std());
+        EXPECT_EQ(ql::datum_t(5.0), equality->second);
+    }
+
+    // Comparing two fields, or a field with something that isn't a constant.
+    EXPECT_FALSE(make_func((r.var(one)["a"] == r.var(one)["b"]).root_term(), one)
+                     ->field_equality().has_value());
+    EXPECT_FALSE(make_func((r.var(one)["a"] > r.expr(5.0)).root_term(), one)
+                     ->field_equality().has_value());
+}
+
+TEST(FuncTest, FilterEquality) {
+    ql::sym_t one(1);
+    ql::minidriver_t r(ql::backtrace_id_t::empty());
+
+    optional<std::pair<datum_string_t, ql::datum_t> > equality =
+        make_func((r.var(one)["room"] == r.expr("x")).root_term(), one)
+            ->filter_equality();
+    ASSERT_TRUE(equality.has_value());
+    EXPECT_EQ("room", equality->first.to_std());
+    EXPECT_EQ(ql::datum_t("x"), equality->second);
+
+    // Object predicates, as in `filter({room: 'x'})`, skip the nested objects that
+    // `filter` matches field by field.
+    ql::datum_t predicate(std::map<datum_string_t, ql::datum_t>{
+        std::make_pair(datum_string_t("a"), ql::datum_t(
+            std::map<datum_string_t, ql::datum_t>{
+                std::make_pair(datum_string_t("b"), ql::datum_t(1.0))})),
+        std::make_pair(datum_string_t("room"), ql::datum_t("x"))});
+    equality = ql::new_constant_func(predicate, ql::backtrace_id_t::empty())
+        ->filter_equality();
+    ASSERT_TRUE(equality.has_value());
+    EXPECT_EQ("room", equality->first.to_std());
+    EXPECT_EQ(ql::datum_t("x"), equality->second);
+
+    EXPECT_FALSE(make_func((r.var(one)["a"] > r.expr(5.0)).root_term(), one)
+                     ->filter_equality().has_value());
+}
+
+TEST(FuncTest, Compiled) {
+    ql::sym_t one(1);
+    ql::minidriver_t r(ql::backtrace_id_t::empty());
+    const std::vector<ql::sym_t> args = make_vector(one);
+    const ql::var_scope_t no_captures;
+    const ql::datum_t row(std::map<datum_string_t, ql::datum_t>{
+        std::make_pair(datum_string_t("a"), ql::datum_t(3.0)),
+        std::make_pair(datum_string_t("s"), ql::datum_t("str"))});
+
+    scoped_ptr_t<ql::compiled_func_t> compiled = ql::compiled_func_t::compile(
+        ((r.var(one)["a"] + r.expr(1.0)) / r.expr(2.0)).root_term(), args, no_captures);
+    ASSERT_TRUE(compiled.has());
+    EXPECT_EQ(ql::datum_t(2.0), compiled->eval(make_vector(row)));
+
+    compiled = ql::compiled_func_t::compile(
+        (r.var(one)["a"] > r.expr(1.0) && r.var(one)["s"] == r.expr("str")).root_term(),
+        args, no_captures);
+    ASSERT_TRUE(compiled.has());
+    EXPECT_EQ(ql::datum_t::boolean(true), compiled->eval(make_vector(row)));
+
+    // Whatever would fail is left to the interpreter, so it can report the error.
+    compiled = ql::compiled_func_t::compile(
+        (r.var(one)["nope"] + r.expr(1.0)).root_term(), args, no_captures);
+    ASSERT_TRUE(compiled.has());
+    EXPECT_FALSE(compiled->eval(make_vector(row)).has());
+    compiled = ql::compiled_func_t::compile(
+        (r.var(one)["s"] + r.expr(1.0)).root_term(), args, no_captures);
+    ASSERT_TRUE(compiled.has());
+    EXPECT_FALSE(compiled->eval(make_vector(row)).has());
+    compiled = ql::compiled_func_t::compile(
+        (r.var(one)["a"] / r.expr(0.0)).root_term(), args, no_captures);
+    ASSERT_TRUE(compiled.has());
+    EXPECT_FALSE(compiled->eval(make_vector(row)).has());
+
+    // Terms we don't compile.
+    EXPECT_FALSE(ql::compiled_func_t::compile(
+        r.var(one).has_fields(r.expr("s")).root_term(), args, no_captures).has());
+    EXPECT_FALSE(ql::compiled_func_t::compile(
+        r.boolean(true).root_term(), std::vector<ql::sym_t>(), no_captures).has());
+}
+
+TEST(FuncTest, CompiledWriteHook) {
+    // `function(ctx, old_val, new_val) { return r.branch(new_val.eq(null), null,
+    // new_val.merge({updated_at: ctx('timestamp')})); }`
+    ql::sym_t ctx(1), old_val(2), new_val(3);
+    ql::minidriver_t r(ql::backtrace_id_t::empty());
+    const std::vector<ql::sym_t> args{ctx, old_val, new_val};
+    const ql::var_scope_t no_captures;
+    scoped_ptr_t<ql::compiled_func_t> compiled = ql::compiled_func_t::compile(
+        r.branch(r.var(new_val) == r.null(),
+                 r.null(),
+                 r.var(new_val).merge(r.object(r.optarg("updated_at",
+                                                        r.var(ctx)["timestamp"]))))
+            .root_term(),
+        args, no_captures);
+    ASSERT_TRUE(compiled.has());
+
+    const ql::datum_t hook_ctx(std::map<datum_string_t, ql::datum_t>{
+        std::make_pair(datum_string_t("timestamp"), ql::datum_t(5.0))});
+    const ql::datum_t row(std::map<datum_string_t, ql::datum_t>{
+        std::make_pair(datum_string_t("id"), ql::datum_t(1.0)),
+        std::make_pair(datum_string_t("updated_at"), ql::datum_t(4.0))});
+    const ql::datum_t expected(std::map<datum_string_t, ql::datum_t>{
+        std::make_pair(datum_string_t("id"), ql::datum_t(1.0)),
+        std::make_pair(datum_string_t("updated_at"), ql::datum_t(5.0))});
+    EXPECT_EQ(expected, compiled->eval(make_vector(hook_ctx, row, row)));
+    EXPECT_EQ(ql::datum_t::null(),
+              compiled->eval(make_vector(hook_ctx, row, ql::datum_t::null())));
+
+    // Merging into something that isn't an object is left to the interpreter.
+    compiled = ql::compiled_func_t::compile(
+        r.var(new_val).merge(r.object(r.optarg("updated_at", r.var(ctx)["timestamp"])))
+            .root_term(),
+        args, no_captures);
+    ASSERT_TRUE(compiled.has());
+    EXPECT_FALSE(compiled->eval(make_vector(hook_ctx, row, ql::datum_t::null())).has());
+}
+
+}  // namespace unittest
@@ -106,5 +106,30 @@ TPTEST(GeoPrimitives, InExRadiusTest) {
     }
 }
 
+// `nearest_traversal_cb_t` relies on `distance_lower_bound()` never exceeding the
+// distance.
+TPTEST(GeoPrimitives, DistanceLowerBoundTest) {
+    const int rng_seed = randint(INT_MAX);
+    debugf("Using RNG seed %i\n", rng_seed);
+    rng_t rng(rng_seed);
+    const geodesic_solver_t solver(WGS84_ELLIPSOID);
+    for (int i = 0; i < 10000; ++i) {
+        lon_lat_point_t p1(rng.randdouble() * 360.0 - 180.0,
+                           rng.randdouble() * 180.0 - 90.0);
+        // Half of the pairs are far apart, the other half within a degree or so.
+        lon_lat_point_t p2 = i % 2 == 0
+            ? lon_lat_point_t(rng.randdouble() * 360.0 - 180.0,
+                              rng.randdouble() * 180.0 - 90.0)
+            : solver.point_at_dist(p1, rng.randdouble() * 100000.0,
+                                   rng.randdouble() * 360.0 - 180.0);
+        const double dist = solver.distance(p1, p2);
+        const double bound = solver.distance_lower_bound(p1, p2);
+        ASSERT_LE(bound, dist);
+        if (dist < 1000000.0) {
+            ASSERT_GE(bound, dist * 0.998);
+        }
+    }
+}
+
 }   /* namespace unittest */
 
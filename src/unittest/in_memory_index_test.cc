@@ -0,0 +1,76 @@
+// Copyright 2010-2014 RethinkDB, all rights reserved.
+#include <vector>
+
+#include "serializer/log/lba/in_memory_index.hpp"
+#include "unittest/gtest.hpp"
+
+namespace unittest {
+
+repli_timestamp_t make_recency(uint64_t longtime) {
+    repli_timestamp_t ret;
+    ret.longtime = longtime;
+    return ret;
+}
+
+void expect_info(const index_block_info_t &expected, const index_block_info_t &actual) {
+    EXPECT_EQ(expected.offset.the_value_, actual.offset.the_value_);
+    EXPECT_EQ(expected.recency.longtime, actual.recency.longtime);
+    EXPECT_EQ(expected.ser_block_size, actual.ser_block_size);
+}
+
+TEST(InMemoryIndexTest, RoundTrip) {
+    compact_block_info_array_t array;
+    std::vector<index_block_info_t> infos;
+    for (block_id_t i = 0; i < (1 << 17); ++i) {
+        infos.push_back(index_block_info_t(
+            flagged_off64_t::make(((i * 7919) % 1000000) * DEVICE_BLOCK_SIZE),
+            make_recency(1000 + i), 4096));
+        array.set(i, infos.back());
+    }
+    EXPECT_EQ(infos.size(), array.size());
+    for (block_id_t i = 0; i < infos.size(); ++i) {
+        expect_info(infos[i], array.get(i));
+    }
+    // The offsets and recencies all fit in 32 bits.
+    EXPECT_GT(12 * infos.size(), array.memory_usage());
+}
+
+TEST(InMemoryIndexTest, WideValues) {
+    compact_block_info_array_t array;
+    const index_block_info_t small(
+        flagged_off64_t::make(DEVICE_BLOCK_SIZE), make_recency(1), 512);
+    // Far outside the narrow range of the first entry's chunk, and not aligned.
+    const index_block_info_t big(
+        flagged_off64_t::make(uint64_t(1) << 50), make_recency(uint64_t(1) << 40), 512);
+    const index_block_info_t unaligned(
+        flagged_off64_t::make(DEVICE_BLOCK_SIZE + 1), repli_timestamp_t::invalid, 1);
+    array.set(0, small);
+    array.set(1, big);
+    array.set(2, unaligned);
+    expect_info(small, array.get(0));
+    expect_info(big, array.get(1));
+    expect_info(unaligned, array.get(2));
+    expect_info(index_block_info_t(), array.get(3));
+    expect_info(index_block_info_t(), array.get(1000000));
+}
+
+TEST(InMemoryIndexTest, FreesChunks) {
+    compact_block_info_array_t array;
+    const index_block_info_t info(
+        flagged_off64_t::make(DEVICE_BLOCK_SIZE), repli_timestamp_t::invalid, 512);
+    array.set(5, info);
+    array.set(1000000, info);
+    EXPECT_EQ(2u, array.size());
+    const size_t without_recencies = array.memory_usage();
+
+    array.set(6, index_block_info_t(info.offset, make_recency(5), 512));
+    EXPECT_LT(without_recencies, array.memory_usage());
+
+    array.set(5, index_block_info_t());
+    array.set(6, index_block_info_t());
+    array.set(1000000, index_block_info_t());
+    EXPECT_EQ(0u, array.size());
+    EXPECT_EQ(0u, array.memory_usage());
+}
+
+}  // namespace unittest
@@ -117,6 +117,73 @@ SPAWNER_TEST(JSProc, EvalAndCall) {
     ASSERT_EQ(res_datum->as_int(), 10337);
 }
 
+SPAWNER_TEST(JSProc, CallBatch) {
+    extproc_pool_t extproc_pool(1);
+    js_runner_t js_runner;
+    ql::configured_limits_t limits;
+
+    js_runner.begin(&extproc_pool, nullptr, limits);
+
+    const std::string source_code =
+        "(function (x) { if (x < 0) { throw 'negative'; } return x * 2; })";
+
+    js_runner_t::req_config_t config;
+    config.timeout_ms = 10000;
+
+    std::vector<std::vector<ql::datum_t> > args;
+    for (int i = 0; i < 5; ++i) {
+        args.push_back(std::vector<ql::datum_t>(1, ql::datum_t(static_cast<double>(i))));
+    }
+    std::vector<js_result_t> results = js_runner.call_batch(source_code, args, config);
+    ASSERT_TRUE(js_runner.connected());
+    ASSERT_EQ(5u, results.size());
+    for (int i = 0; i < 5; ++i) {
+        ql::datum_t *res_datum = boost::get<ql::datum_t>(&results[i]);
+        ASSERT_TRUE(res_datum != nullptr);
+        ASSERT_EQ(i * 2, res_datum->as_int());
+    }
+
+    // The batch stops at the first call that fails
+    args[2][0] = ql::datum_t(-1.0);
+    results = js_runner.call_batch(source_code, args, config);
+    ASSERT_TRUE(js_runner.connected());
+    ASSERT_EQ(3u, results.size());
+    ASSERT_TRUE(boost::get<ql::datum_t>(&results[1]) != nullptr);
+    ASSERT_TRUE(boost::get<std::string>(&results[2]) != nullptr);
+}
+
+SPAWNER_TEST(JSProc, CallBatchTimeout) {
+    extproc_pool_t extproc_pool(1);
+    js_runner_t js_runner;
+    ql::configured_limits_t limits;
+
+    js_runner.begin(&extproc_pool, nullptr, limits);
+
+    const std::string source_code =
+        "(function (x) { if (x == 2) { for (var y = 0; y < 4e10; y++) {} } return x; })";
+
+    js_runner_t::req_config_t config;
+    config.timeout_ms = 10000;
+
+    js_result_t result = js_runner.eval(source_code, config);
+    ASSERT_TRUE(boost::get<js_id_t>(&result) != nullptr);
+
+    // Every call gets the whole timeout, and the batch stops at the one that runs
+    // out of time.
+    config.timeout_ms = 10;
+    std::vector<std::vector<ql::datum_t> > args;
+    for (int i = 0; i < 5; ++i) {
+        args.push_back(std::vector<ql::datum_t>(1, ql::datum_t(static_cast<double>(i))));
+    }
+    std::vector<js_result_t> results = js_runner.call_batch(source_code, args, config);
+    ASSERT_EQ(3u, results.size());
+    ASSERT_TRUE(boost::get<ql::datum_t>(&results[1]) != nullptr);
+    std::string value = boost::get<std::string>(results[2]);
+    ASSERT_EQ(strprintf("JavaScript query `%s` timed out after 0.010 seconds.",
+                        source_code.c_str()), value);
+    ASSERT_FALSE(js_runner.connected());
+}
+
 SPAWNER_TEST(JSProc, BrokenFunction) {
     extproc_pool_t extproc_pool(1);
     js_runner_t js_runner;
@@ -0,0 +1,58 @@
+// Copyright 2010-2015 RethinkDB, all rights reserved.
+#include <string>
+
+#include "btree/key_filter.hpp"
+#include "unittest/gtest.hpp"
+#include "utils.hpp"
+
+namespace unittest {
+
+TEST(KeyFilterTest, NoFalseNegatives) {
+    key_filter_t filter(1000);
+    for (int i = 0; i < 1000; ++i) {
+        filter.insert(store_key_t(strprintf("key%d", i)).btree_key());
+    }
+    EXPECT_FALSE(filter.is_overfull());
+    for (int i = 0; i < 1000; ++i) {
+        EXPECT_TRUE(filter.may_contain(store_key_t(strprintf("key%d", i)).btree_key()));
+    }
+
+    // Inserting a key again doesn't count towards the capacity.
+    filter.insert(store_key_t("key0").btree_key());
+    EXPECT_EQ(1000u, filter.num_inserted());
+}
+
+TEST(KeyFilterTest, FalsePositiveRate) {
+    key_filter_t filter(10000);
+    for (int i = 0; i < 10000; ++i) {
+        filter.insert(store_key_t(strprintf("in%d", i)).btree_key());
+    }
+    int false_positives = 0;
+    for (int i = 0; i < 10000; ++i) {
+        if (filter.may_contain(store_key_t(strprintf("out%d", i)).btree_key())) {
+            ++false_positives;
+        }
+    }
+    // About 1% is expected.
+    EXPECT_LT(false_positives, 300);
+}
+
+TEST(KeyFilterTest, Overfull) {
+    key_filter_t filter(10);
+    // The smallest filter has room for a lot more than 10 keys, but it's only
+    // sized for 10.
+    for (int i = 0; i < 11; ++i) {
+        filter.insert(store_key_t(strprintf("key%d", i)).btree_key());
+    }
+    EXPECT_TRUE(filter.is_overfull());
+    EXPECT_FALSE(filter.is_max_size());
+}
+
+TEST(KeyFilterTest, MaxSize) {
+    // A filter can't be sized for more than `max_keys()`, however many keys are
+    // expected.
+    key_filter_t filter(4 * key_filter_t::max_keys());
+    EXPECT_TRUE(filter.is_max_size());
+}
+
+}  // namespace unittest
@@ -38,4 +38,24 @@ TEST(LRUCacheTest, Basic) {
     EXPECT_FALSE(res);
 }
 
+TEST(LRUCacheTest, Erase) {
+    lru_cache_t<std::string, std::string> cache(2);
+    EXPECT_TRUE(cache.insert("1", "a"));
+    EXPECT_TRUE(cache.insert("2", "b"));
+    EXPECT_TRUE(cache.erase("1"));
+    EXPECT_FALSE(cache.erase("1"));
+    EXPECT_EQ(1, cache.size());
+    std::string *p;
+    EXPECT_FALSE(cache.lookup("1", &p));
+    // Erasing makes room, so nothing is evicted.
+    EXPECT_TRUE(cache.insert("3", "c"));
+    ASSERT_TRUE(cache.lookup("2", &p));
+    EXPECT_EQ("b", *p);
+    // The key can be inserted again with a new value.
+    EXPECT_TRUE(cache.insert("1", "d"));
+    ASSERT_TRUE(cache.lookup("1", &p));
+    EXPECT_EQ("d", *p);
+    EXPECT_FALSE(cache.lookup("3", &p));
+}
+
 } // namespace unittest
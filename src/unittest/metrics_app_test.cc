@@ -0,0 +1,43 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "clustering/administration/http/metrics_app.hpp"
+#include "rdb_protocol/configured_limits.hpp"
+#include "unittest/gtest.hpp"
+
+namespace unittest {
+
+TEST(MetricsAppTest, FormatOpenMetrics) {
+    ql::datum_object_builder_t cache;
+    cache.overwrite("hits", ql::datum_t(2.5));
+    cache.overwrite("name", ql::datum_t("not a number"));
+    ql::datum_object_builder_t table;
+    table.overwrite("cache", std::move(cache).to_datum());
+
+    std::vector<ql::datum_t> threads;
+    for (double n = 1; n <= 2; ++n) {
+        ql::datum_object_builder_t thread;
+        thread.overwrite("count", ql::datum_t(n));
+        threads.push_back(std::move(thread).to_datum());
+    }
+
+    ql::datum_object_builder_t stats;
+    stats.overwrite("11111111-2222-3333-4444-555555555555", std::move(table).to_datum());
+    stats.overwrite("query-engine", ql::datum_t(7.0));
+    stats.overwrite("ready", ql::datum_t::boolean(true));
+    stats.overwrite("threads", ql::datum_t(std::move(threads),
+                                          ql::configured_limits_t::unlimited));
+
+    EXPECT_EQ(
+        "# TYPE rethinkdb_cache_hits gauge\n"
+        "rethinkdb_cache_hits{table=\"11111111-2222-3333-4444-555555555555\"} 2.5\n"
+        "# TYPE rethinkdb_query_engine gauge\n"
+        "rethinkdb_query_engine 7\n"
+        "# TYPE rethinkdb_ready gauge\n"
+        "rethinkdb_ready 1\n"
+        "# TYPE rethinkdb_threads_count gauge\n"
+        "rethinkdb_threads_count{thread=\"0\"} 1\n"
+        "rethinkdb_threads_count{thread=\"1\"} 2\n"
+        "# EOF\n",
+        format_openmetrics(std::move(stats).to_datum()));
+}
+
+}  // namespace unittest
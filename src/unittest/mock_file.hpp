@@ -32,7 +32,12 @@ public:
     void writev_async(int64_t offset, size_t length, scoped_array_t<iovec> &&bufs,
                       file_account_t *account, linux_iocallback_t *cb);
 
-    void *create_account(UNUSED int priority, UNUSED int outstanding_requests_limit) {
+    void co_datasync() {
+        // The data is in memory, so there's nothing to make durable.
+    }
+
+    void *create_account(UNUSED io_class_t io_class, UNUSED int priority,
+                         UNUSED int outstanding_requests_limit) {
         // We don't care about accounts.  Return an arbitrary non-null pointer.
         return this;
     }
@@ -43,6 +48,11 @@ public:
 
     bool coop_lock_and_check();
 
+    file_load_t get_load() {
+        // There's never anything to wait for.
+        return file_load_t{0, 0};
+    }
+
 private:
     mode_t mode_;
     std::vector<char> *data_;
@@ -1,4 +1,6 @@
 // Copyright 2010-2014 RethinkDB, all rights reserved.
+#include <vector>
+
 #include "arch/runtime/coroutines.hpp"
 #include "arch/timing.hpp"
 #include "buffer_cache/page_cache.hpp"
@@ -59,7 +61,9 @@ public:
     alt::throttler_acq_t make_throttler_acq() {
         // KSI: We could make these tests better by varying the expected change
         // count.
-        return throttler_->begin_txn_or_throttle(write_durability_t::SOFT, 0);
+        cond_t non_interruptor;
+        return throttler_->begin_txn_or_throttle(
+            write_durability_t::SOFT, 0, &non_interruptor);
     }
 
 private:
@@ -97,6 +101,10 @@ public:
         return current_page_acq_t::current_page_for_read(
                 page_cache()->default_reads_account());
     }
+
+    page_t *current_page_for_read(cache_account_t *account) {
+        return current_page_acq_t::current_page_for_read(account);
+    }
 };
 
 class test_acq_t : public page_acq_t {
@@ -105,6 +113,9 @@ public:
     void init(page_t *page, page_cache_t *_page_cache) {
         page_acq_t::init(page, _page_cache, _page_cache->default_reads_account());
     }
+    void init(page_t *page, page_cache_t *_page_cache, cache_account_t *account) {
+        page_acq_t::init(page, _page_cache, account);
+    }
 
     void *get_buf_write() {
         return page_acq_t::get_buf_write(page_cache()->max_block_size());
@@ -310,6 +321,206 @@ TPTEST(PageTest, WriteWaitForFlush, 4) {
     pmap(2, std::bind(&WriteWaitForFlush_cases, &s, &page_cache, ph::_1));
 }
 
+TPTEST(PageTest, PeekCurrentPage, 4) {
+    mock_ser_t mock;
+    dummy_cache_balancer_t balancer(GIGABYTE);
+    test_cache_t page_cache(mock.ser.get(), &balancer, mock.throttler.get());
+    cache_account_t *account = page_cache.default_reads_account();
+    block_id_t block_id;
+    {
+        auto txn = make_scoped<test_txn_t>(&page_cache);
+        {
+            current_test_acq_t acq(txn.get(), alt_create_t::create);
+            block_id = acq.block_id();
+            test_acq_t page_acq;
+            page_acq.init(acq.current_page_for_write(), &page_cache);
+            *static_cast<char *>(page_acq.get_buf_write()) = 'a';
+            // Somebody is writing the page.
+            ASSERT_EQ(nullptr, page_cache.peek_current_page_for_read(block_id, account));
+        }
+        page_cache.flush(std::move(txn));
+    }
+
+    const void *data = page_cache.peek_current_page_for_read(block_id, account);
+    ASSERT_NE(nullptr, data);
+    ASSERT_EQ('a', *static_cast<const char *>(data));
+
+    {
+        // Readers don't get in the way.
+        current_test_acq_t acq(&page_cache, block_id, read_access_t::read);
+        ASSERT_EQ(data, page_cache.peek_current_page_for_read(block_id, account));
+    }
+
+    {
+        auto txn = make_scoped<test_txn_t>(&page_cache);
+        {
+            // Write acquirers get in the way even before they get write access.
+            current_test_acq_t read_acq(&page_cache, block_id, read_access_t::read);
+            current_test_acq_t acq(txn.get(), block_id, access_t::write);
+            ASSERT_FALSE(acq.write_acq_signal()->is_pulsed());
+            ASSERT_EQ(nullptr, page_cache.peek_current_page_for_read(block_id, account));
+        }
+        page_cache.flush(std::move(txn));
+    }
+
+    ASSERT_NE(nullptr, page_cache.peek_current_page_for_read(block_id, account));
+    ASSERT_EQ(nullptr, page_cache.peek_current_page_for_read(block_id + 1, account));
+}
+
+char read_test_block(test_cache_t *cache, block_id_t block_id,
+                     cache_account_t *account) {
+    current_test_acq_t acq(cache, block_id, read_access_t::read);
+    test_acq_t page_acq;
+    page_acq.init(acq.current_page_for_read(account), cache, account);
+    return *static_cast<const char *>(page_acq.get_buf_read());
+}
+
+TPTEST(PageTest, ScanResistantEviction, 4) {
+    mock_ser_t mock;
+    const int num_blocks = 64;
+    std::vector<block_id_t> block_ids;
+    {
+        dummy_cache_balancer_t balancer(GIGABYTE);
+        test_cache_t page_cache(mock.ser.get(), &balancer, mock.throttler.get());
+        auto txn = make_scoped<test_txn_t>(&page_cache);
+        for (int i = 0; i < num_blocks; ++i) {
+            current_test_acq_t acq(txn.get(), alt_create_t::create);
+            block_ids.push_back(acq.block_id());
+            test_acq_t page_acq;
+            page_acq.init(acq.current_page_for_write(), &page_cache);
+            *static_cast<char *>(page_acq.get_buf_write()) = static_cast<char>(i);
+        }
+        page_cache.flush(std::move(txn));
+    }
+
+    // Room for a few blocks, so that the scan below has to evict.
+    dummy_cache_balancer_t balancer(
+        8 * mock.ser->max_block_size().ser_value(),
+        eviction_policy_t::SCAN_RESISTANT);
+    test_cache_t page_cache(mock.ser.get(), &balancer, mock.throttler.get());
+    cache_account_t scan_account
+        = page_cache.create_cache_account(100, cache_access_pattern_t::SCAN,
+                                          io_class_t::foreground_read);
+
+    // The first block is read normally, then we scan all the others (twice).
+    ASSERT_EQ(0, read_test_block(&page_cache, block_ids[0],
+                                 page_cache.default_reads_account()));
+    for (int pass = 0; pass < 2; ++pass) {
+        for (int i = 1; i < num_blocks; ++i) {
+            ASSERT_EQ(static_cast<char>(i),
+                      read_test_block(&page_cache, block_ids[i], &scan_account));
+        }
+    }
+
+    // The scan only ever evicted probationary pages, so the first block is still in
+    // memory.
+    {
+        current_test_acq_t acq(&page_cache, block_ids[0], read_access_t::read);
+        ASSERT_TRUE(acq.current_page_for_read()->is_loaded());
+    }
+    ASSERT_EQ(0, read_test_block(&page_cache, block_ids[0],
+                                 page_cache.default_reads_account()));
+}
+
+TPTEST(PageTest, BypassReads, 4) {
+    mock_ser_t mock;
+    const int num_blocks = 16;
+    std::vector<block_id_t> block_ids;
+    {
+        dummy_cache_balancer_t balancer(GIGABYTE);
+        test_cache_t page_cache(mock.ser.get(), &balancer, mock.throttler.get());
+        auto txn = make_scoped<test_txn_t>(&page_cache);
+        for (int i = 0; i < num_blocks; ++i) {
+            current_test_acq_t acq(txn.get(), alt_create_t::create);
+            block_ids.push_back(acq.block_id());
+            test_acq_t page_acq;
+            page_acq.init(acq.current_page_for_write(), &page_cache);
+            *static_cast<char *>(page_acq.get_buf_write()) = static_cast<char>(i);
+        }
+        page_cache.flush(std::move(txn));
+    }
+
+    // Plenty of room, so that nothing has to be evicted.
+    dummy_cache_balancer_t balancer(GIGABYTE);
+    test_cache_t page_cache(mock.ser.get(), &balancer, mock.throttler.get());
+    cache_account_t bypass_account
+        = page_cache.create_cache_account(100, cache_access_pattern_t::BYPASS,
+                                          io_class_t::backfill);
+
+    // The first block is read normally, and the second one is changed but not
+    // flushed.
+    ASSERT_EQ(0, read_test_block(&page_cache, block_ids[0],
+                                 page_cache.default_reads_account()));
+    auto txn = make_scoped<test_txn_t>(&page_cache);
+    {
+        current_test_acq_t acq(txn.get(), block_ids[1], access_t::write);
+        test_acq_t page_acq;
+        page_acq.init(acq.current_page_for_write(), &page_cache);
+        *static_cast<char *>(page_acq.get_buf_write()) = 'x';
+    }
+    const uint64_t in_memory_size = page_cache.evicter().in_memory_size();
+
+    // Bypassing reads see the dirty page, and don't keep the pages they load.
+    for (int i = 0; i < num_blocks; ++i) {
+        ASSERT_EQ(i == 1 ? 'x' : static_cast<char>(i),
+                  read_test_block(&page_cache, block_ids[i], &bypass_account));
+    }
+    ASSERT_EQ(in_memory_size, page_cache.evicter().in_memory_size());
+    {
+        current_test_acq_t acq(&page_cache, block_ids[0], read_access_t::read);
+        ASSERT_TRUE(acq.current_page_for_read()->is_loaded());
+    }
+    page_cache.flush(std::move(txn));
+}
+
+TPTEST(PageTest, CompressedEviction, 4) {
+    mock_ser_t mock;
+    const int num_blocks = 64;
+    std::vector<block_id_t> block_ids;
+    {
+        dummy_cache_balancer_t balancer(GIGABYTE);
+        test_cache_t page_cache(mock.ser.get(), &balancer, mock.throttler.get());
+        auto txn = make_scoped<test_txn_t>(&page_cache);
+        for (int i = 0; i < num_blocks; ++i) {
+            current_test_acq_t acq(txn.get(), alt_create_t::create);
+            block_ids.push_back(acq.block_id());
+            test_acq_t page_acq;
+            page_acq.init(acq.current_page_for_write(), &page_cache);
+            *static_cast<char *>(page_acq.get_buf_write()) = static_cast<char>(i);
+        }
+        page_cache.flush(std::move(txn));
+    }
+
+    // Room for a few blocks, so that reading them all has to evict.  The blocks are
+    // mostly zeros, so they compress well.
+    dummy_cache_balancer_t balancer(8 * mock.ser->max_block_size().ser_value());
+    test_cache_t page_cache(mock.ser.get(), &balancer, mock.throttler.get());
+    cache_account_t *account = page_cache.default_reads_account();
+    for (int i = 0; i < num_blocks; ++i) {
+        ASSERT_EQ(static_cast<char>(i),
+                  read_test_block(&page_cache, block_ids[i], account));
+    }
+
+    int num_compressed = 0;
+    for (int i = 0; i < num_blocks; ++i) {
+        current_test_acq_t acq(&page_cache, block_ids[i], read_access_t::read);
+        page_t *page = acq.current_page_for_read();
+        if (page_cache.evicter().has_compressed_copy(page)) {
+            ASSERT_FALSE(page->is_loaded());
+            ++num_compressed;
+        }
+    }
+    ASSERT_GT(num_compressed, num_blocks / 2);
+    ASSERT_LE(page_cache.evicter().in_memory_size(),
+              page_cache.evicter().memory_limit());
+
+    // Reloading from the compressed copies gives back the original contents.
+    for (int i = 0; i < num_blocks; ++i) {
+        ASSERT_EQ(static_cast<char>(i),
+                  read_test_block(&page_cache, block_ids[i], account));
+    }
+}
+
 class bigger_test_t {
 public:
     explicit bigger_test_t(uint64_t _memory_limit)
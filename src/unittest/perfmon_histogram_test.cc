@@ -0,0 +1,44 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "perfmon/perfmon.hpp"
+#include "unittest/gtest.hpp"
+
+namespace unittest {
+
+using perfmon_histogram::stats_t;
+
+TEST(PerfmonHistogramTest, Buckets) {
+    // Every bucket holds the durations from the previous bucket's limit up to its own.
+    for (int i = 0; i < perfmon_histogram::NUM_BUCKETS - 1; ++i) {
+        const int64_t limit_micros = stats_t::bucket_limit_nanos(i) / THOUSAND;
+        EXPECT_EQ(i, stats_t::bucket_for_micros(limit_micros - 1));
+        EXPECT_EQ(i + 1, stats_t::bucket_for_micros(limit_micros));
+        if (i > 0) {
+            EXPECT_LT(stats_t::bucket_limit_nanos(i - 1), stats_t::bucket_limit_nanos(i));
+        }
+    }
+    EXPECT_EQ(perfmon_histogram::NUM_BUCKETS - 1,
+              stats_t::bucket_for_micros(int64_t(1) << 40));
+}
+
+TEST(PerfmonHistogramTest, Percentiles) {
+    stats_t stats;
+    for (int i = 1; i <= 1000; ++i) {
+        stats.record(i * THOUSAND);
+    }
+    stats_t other;
+    other.record(100 * MILLION);
+    stats.aggregate(other);
+    EXPECT_EQ(1001u, stats.count);
+    EXPECT_EQ(100 * MILLION, stats.max_nanos);
+
+    // The estimates are upper bounds that are off by at most one bucket, which is
+    // 1 / `SUB_BUCKETS` of the value.
+    const double tolerance = 1.0 + 1.0 / perfmon_histogram::SUB_BUCKETS;
+    EXPECT_LE(500 * THOUSAND, stats.percentile_nanos(50));
+    EXPECT_GE(500 * THOUSAND * tolerance, stats.percentile_nanos(50));
+    EXPECT_LE(990 * THOUSAND, stats.percentile_nanos(99));
+    EXPECT_GE(990 * THOUSAND * tolerance, stats.percentile_nanos(99));
+    EXPECT_EQ(100 * MILLION, stats.percentile_nanos(100));
+}
+
+}  // namespace unittest
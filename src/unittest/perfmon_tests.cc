@@ -7,6 +7,7 @@
 
 #include "perfmon/perfmon.hpp"
 #include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
 
 namespace unittest {
 
@@ -57,4 +58,49 @@ TEST(PerfmonTest, StddevComputation) {
     }
 }
 
+TEST(PerfmonTest, HistogramBuckets) {
+    perfmon_histogram::stats_t stats;
+    EXPECT_EQ(0u, stats.count);
+
+    // Below a microsecond, and then one per power of two microseconds.
+    stats.record(500);
+    stats.record(1500);
+    stats.record(3 * THOUSAND);
+    stats.record(3 * THOUSAND);
+    stats.record(100 * MILLION);
+    EXPECT_EQ(5u, stats.count);
+    EXPECT_EQ(1u, stats.buckets[0]);
+    EXPECT_EQ(1u, stats.buckets[1]);
+    EXPECT_EQ(2u, stats.buckets[2]);
+    EXPECT_EQ(100 * MILLION, stats.max_nanos);
+
+    EXPECT_EQ(4 * THOUSAND, stats.percentile_nanos(50));
+    EXPECT_EQ(4 * THOUSAND, stats.percentile_nanos(80));
+    EXPECT_EQ(100 * MILLION, stats.percentile_nanos(99));
+
+    // Anything too long for the buckets ends up in the last one.
+    stats.record(INT64_MAX / 2);
+    EXPECT_EQ(1u, stats.buckets[perfmon_histogram::NUM_BUCKETS - 1]);
+
+    perfmon_histogram::stats_t other;
+    other.record(1500);
+    other.aggregate(stats);
+    EXPECT_EQ(7u, other.count);
+    EXPECT_EQ(2u, other.buckets[1]);
+    EXPECT_EQ(INT64_MAX / 2, other.max_nanos);
+}
+
+TPTEST(PerfmonTest, RateMonitor) {
+    perfmon_rate_monitor_t rate(secs_to_ticks(1));
+    rate.record();
+    rate.record(41);
+
+    // The rate counts the events in the current interval and a decreasing part of
+    // those in the last one, so it's a little less if a new interval just started.
+    void *ctx = rate.begin_stats();
+    rate.visit_stats(ctx);
+    ql::datum_t stats = rate.end_stats(ctx);
+    EXPECT_NEAR(42.0, stats.as_num(), 1.0);
+}
+
 }  // namespace unittest
@@ -0,0 +1,121 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include <map>
+#include <string>
+#include <vector>
+
+#include "arch/timing.hpp"
+#include "containers/archive/buffer_stream.hpp"
+#include "containers/archive/vector_stream.hpp"
+#include "rdb_protocol/protocol.hpp"
+#include "unittest/gtest.hpp"
+
+namespace unittest {
+
+read_t make_point_read(int i) {
+    return read_t(point_read_t(store_key_t(strprintf("key%d", i))),
+                  profile_bool_t::DONT_PROFILE, read_mode_t::SINGLE);
+}
+
+write_t make_point_write(int i) {
+    std::map<datum_string_t, ql::datum_t> doc;
+    doc[datum_string_t("id")] = ql::datum_t(static_cast<double>(i));
+    doc[datum_string_t("name")] = ql::datum_t(datum_string_t(strprintf("name%d", i)));
+    doc[datum_string_t("score")] = ql::datum_t(i * 0.5);
+    return write_t(point_write_t(store_key_t(strprintf("key%d", i)),
+                                 ql::datum_t(std::move(doc))),
+                   DURABILITY_REQUIREMENT_DEFAULT, profile_bool_t::DONT_PROFILE,
+                   ql::configured_limits_t());
+}
+
+rget_read_response_t make_rget_response(int num_items) {
+    ql::stream_t stream(region_t::universe(), store_key_t::max());
+    ql::raw_stream_t *items = &stream.substreams.begin()->second.stream;
+    for (int i = 0; i < num_items; ++i) {
+        std::map<datum_string_t, ql::datum_t> doc;
+        doc[datum_string_t("id")] = ql::datum_t(static_cast<double>(i));
+        doc[datum_string_t("value")] = ql::datum_t(datum_string_t(std::string(40, 'x')));
+        items->push_back(ql::rget_item_t(store_key_t(strprintf("key%d", i)),
+                                         ql::datum_t(),
+                                         ql::datum_t(std::move(doc))));
+    }
+    ql::grouped_t<ql::stream_t> grouped;
+    grouped[ql::datum_t()] = std::move(stream);
+    rget_read_response_t response;
+    response.result = std::move(grouped);
+    return response;
+}
+
+template <class T>
+std::vector<char> serialize_to_vector(const T &value) {
+    write_message_t wm;
+    serialize<cluster_version_t::CLUSTER>(&wm, value);
+    vector_stream_t stream;
+    int res = send_write_message(&stream, &wm);
+    guarantee(res == 0);
+    std::vector<char> vec;
+    stream.swap(&vec);
+    return vec;
+}
+
+template <class T>
+void deserialize_from_vector(const std::vector<char> &vec, T *value_out) {
+    buffer_read_stream_t stream(vec.data(), vec.size());
+    archive_result_t res = deserialize<cluster_version_t::CLUSTER>(&stream, value_out);
+    guarantee_deserialization(res, "protocol_serialization_test");
+    guarantee(stream.tell() == static_cast<int64_t>(vec.size()));
+}
+
+// Deserializing and serializing again has to give back the same bytes.
+template <class T>
+void check_round_trip(const T &value) {
+    std::vector<char> bytes = serialize_to_vector(value);
+    T copy;
+    deserialize_from_vector(bytes, &copy);
+    ASSERT_EQ(bytes, serialize_to_vector(copy));
+}
+
+TEST(ProtocolSerializationTest, RoundTrip) {
+    check_round_trip(make_point_read(7));
+    check_round_trip(make_point_write(7));
+    check_round_trip(make_rget_response(100));
+}
+
+// This is not really a unit test, but a micro benchmark that prints how fast the
+// most common protocol messages serialize and deserialize.  No need to run this in
+// debug mode.
+#ifdef NDEBUG
+template <class T>
+void print_throughput(const char *name, const T &value, int repetitions) {
+    std::vector<char> bytes = serialize_to_vector(value);
+
+    size_t total_size = 0;
+    ticks_t start_ticks = get_ticks();
+    for (int i = 0; i < repetitions; ++i) {
+        write_message_t wm;
+        serialize<cluster_version_t::CLUSTER>(&wm, value);
+        total_size += wm.size();
+    }
+    int64_t serialize_nanos = get_ticks().nanos - start_ticks.nanos;
+    EXPECT_EQ(bytes.size() * repetitions, total_size);
+
+    start_ticks = get_ticks();
+    for (int i = 0; i < repetitions; ++i) {
+        T copy;
+        deserialize_from_vector(bytes, &copy);
+    }
+    int64_t deserialize_nanos = get_ticks().nanos - start_ticks.nanos;
+
+    printf("%s (%zu bytes): serialize %.1f ns, deserialize %.1f ns\n",
+           name, bytes.size(),
+           static_cast<double>(serialize_nanos) / repetitions,
+           static_cast<double>(deserialize_nanos) / repetitions);
+}
+
+TEST(ProtocolSerializationTest, ThroughputBenchmark) {
+    print_throughput("read_t (point read)", make_point_read(7), 200000);
+    print_throughput("write_t (point write)", make_point_write(7), 100000);
+    print_throughput("rget_read_response_t (100 rows)", make_rget_response(100), 2000);
+}
+#endif  // NDEBUG
+
+}  // namespace unittest
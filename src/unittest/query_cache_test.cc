@@ -0,0 +1,181 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include <string>
+
+#include "clustering/administration/auth/user_context.hpp"
+#include "concurrency/cond_var.hpp"
+#include "containers/shared_buffer.hpp"
+#include "rapidjson/document.h"
+#include "rdb_protocol/pseudo_time.hpp"
+#include "rdb_protocol/query_cache.hpp"
+#include "rdb_protocol/query_params.hpp"
+#include "rdb_protocol/response.hpp"
+#include "rdb_protocol/term_storage.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/rdb_env.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+/* Plays the part of a client connection: sends queries, given as the JSON a driver
+would send, to a `query_cache_t` and runs them the way `rdb_query_server_t` does. */
+class query_client_t {
+public:
+    explicit query_client_t(rdb_context_t *rdb_ctx)
+        : cache(rdb_ctx,
+                ip_and_port_t(ip_address_t("127.0.0.1"), port_t(0)),
+                ql::return_empty_normal_batches_t::NO,
+                auth::user_context_t(auth::username_t("admin"))) { }
+
+    void run(int64_t token, const std::string &json, ql::response_t *res) {
+        cond_t non_interruptor;
+        try {
+            scoped_ptr_t<ql::query_params_t> params = parse(token, json);
+            switch (params->type) {
+            case Query::START: {
+                cache.create(params.get(), ql::pseudo::time_now(), &non_interruptor)
+                    ->fill_response(res);
+            } break;
+            case Query::CONTINUE: {
+                if (params->noreply && params->credits > 0) {
+                    cache.grant_credits(params.get());
+                    break;
+                }
+                cache.get(params.get(), &non_interruptor)->fill_response(res);
+            } break;
+            case Query::PREPARE: {
+                cache.prepare(params.get());
+                res->set_type(Response::SUCCESS_ATOM);
+                res->set_data(ql::datum_t::null());
+            } break;
+            case Query::EXECUTE: {
+                cache.execute(params.get(), ql::pseudo::time_now(), &non_interruptor)
+                    ->fill_response(res);
+            } break;
+            case Query::UNPREPARE: {
+                cache.unprepare(*params);
+                res->set_type(Response::SUCCESS_ATOM);
+                res->set_data(ql::datum_t::null());
+            } break;
+            default: unreachable();
+            }
+        } catch (const ql::bt_exc_t &ex) {
+            res->fill_error(ex.response_type, ex.error_type, ex.message, ex.bt_datum);
+        }
+    }
+
+    ql::query_cache_t cache;
+
+private:
+    scoped_ptr_t<ql::query_params_t> parse(int64_t token, const std::string &json) {
+        counted_t<shared_buf_t> buffer = shared_buf_t::create(json.size() + 1);
+        memcpy(buffer->data(), json.c_str(), json.size() + 1);
+        rapidjson::Document doc;
+        doc.ParseInsitu(buffer->data());
+        guarantee(!doc.HasParseError());
+        return make_scoped<ql::query_params_t>(token, &cache,
+            scoped_ptr_t<ql::term_storage_t>(
+                new ql::json_term_storage_t(std::move(buffer), std::move(doc))));
+    }
+};
+
+// `[69, [[2, [1]], [24, [[10, [1]], 10]]]]` is `lambda x: x + 10`.
+const char *const add_ten_func = "[69,[[2,[1]],[24,[[10,[1]],10]]]]";
+
+void run_prepared_queries(test_rdb_env_t *test_env) {
+    scoped_ptr_t<test_rdb_env_t::instance_t> env_instance = test_env->make_env();
+    query_client_t client(env_instance->get_rdb_context());
+
+    {
+        ql::response_t res;
+        client.run(1, strprintf("[6,%s,{}]", add_ten_func), &res);
+        ASSERT_EQ(Response::SUCCESS_ATOM, res.type());
+    }
+
+    // Each EXECUTE calls the prepared function with its own arguments.
+    for (int64_t i = 0; i < 3; ++i) {
+        ql::response_t res;
+        client.run(2 + i, strprintf("[7,[1,[%" PRIi64 "]],{}]", i), &res);
+        ASSERT_EQ(Response::SUCCESS_ATOM, res.type());
+        ASSERT_EQ(1u, res.data().size());
+        EXPECT_EQ(ql::datum_t(static_cast<double>(i + 10)), res.data()[0]);
+    }
+
+    // Only functions can be prepared.
+    {
+        ql::response_t res;
+        client.run(10, "[6,[24,[1,2]],{}]", &res);
+        EXPECT_EQ(Response::CLIENT_ERROR, res.type());
+    }
+
+    // Executing something that isn't prepared is an error.
+    {
+        ql::response_t res;
+        client.run(11, "[7,[10,[5]],{}]", &res);
+        EXPECT_EQ(Response::CLIENT_ERROR, res.type());
+    }
+
+    // After UNPREPARE the token can no longer be executed.
+    {
+        ql::response_t res;
+        client.run(1, "[8]", &res);
+        ASSERT_EQ(Response::SUCCESS_ATOM, res.type());
+    }
+    {
+        ql::response_t res;
+        client.run(12, "[7,[1,[5]],{}]", &res);
+        EXPECT_EQ(Response::CLIENT_ERROR, res.type());
+    }
+}
+
+TEST(QueryCacheTest, PreparedQueries) {
+    test_rdb_env_t test_env;
+    unittest::run_in_thread_pool(std::bind(run_prepared_queries, &test_env));
+}
+
+void run_credits(test_rdb_env_t *test_env) {
+    scoped_ptr_t<test_rdb_env_t::instance_t> env_instance = test_env->make_env();
+    query_client_t client(env_instance->get_rdb_context());
+
+    // `r.range(100)` in batches of ten rows, with two batches' worth of credits.
+    {
+        ql::response_t res;
+        client.run(1, "[1,[173,[100]],{\"max_batch_rows\":10,\"credits\":2}]", &res);
+        ASSERT_EQ(Response::SUCCESS_PARTIAL, res.type());
+        EXPECT_EQ(10u, res.data().size());
+    }
+    EXPECT_TRUE(client.cache.take_credit(1));
+    EXPECT_TRUE(client.cache.take_credit(1));
+    EXPECT_FALSE(client.cache.take_credit(1));
+
+    // A noreply CONTINUE only grants more credits, and a normal one adds its own.
+    {
+        ql::response_t res;
+        client.run(1, "[2,{\"noreply\":true,\"credits\":1}]", &res);
+    }
+    {
+        ql::response_t res;
+        client.run(1, "[2,{\"credits\":1}]", &res);
+        ASSERT_EQ(Response::SUCCESS_PARTIAL, res.type());
+        EXPECT_EQ(10u, res.data().size());
+    }
+    EXPECT_TRUE(client.cache.take_credit(1));
+    EXPECT_TRUE(client.cache.take_credit(1));
+    EXPECT_FALSE(client.cache.take_credit(1));
+
+    // Tokens that aren't streaming have no credits.
+    EXPECT_FALSE(client.cache.take_credit(2));
+
+    // Credits out of range are rejected before the query runs.
+    for (const char *credits : {"-1", "1000001"}) {
+        ql::response_t res;
+        client.run(3, strprintf("[1,[173,[100]],{\"credits\":%s}]", credits), &res);
+        EXPECT_EQ(Response::CLIENT_ERROR, res.type());
+    }
+}
+
+TEST(QueryCacheTest, Credits) {
+    test_rdb_env_t test_env;
+    unittest::run_in_thread_pool(std::bind(run_credits, &test_env));
+}
+
+}  // namespace unittest
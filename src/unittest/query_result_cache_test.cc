@@ -0,0 +1,91 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include <string>
+#include <vector>
+
+#include "clustering/administration/auth/user_context.hpp"
+#include "rdb_protocol/minidriver.hpp"
+#include "rdb_protocol/optargs.hpp"
+#include "rdb_protocol/query_result_cache.hpp"
+#include "unittest/gtest.hpp"
+
+namespace unittest {
+
+class result_cache_keys_t {
+public:
+    result_cache_keys_t() : r(ql::backtrace_id_t::empty()) { }
+
+    optional<std::string> key(ql::minidriver_t::reql_t query,
+                              const auth::user_context_t &user) {
+        return ql::query_result_cache_t::make_key(
+            query.root_term(), ql::global_optargs_t(), user);
+    }
+
+    ql::minidriver_t r;
+};
+
+TEST(QueryResultCacheTest, Keys) {
+    result_cache_keys_t k;
+    ql::minidriver_t &r = k.r;
+    const auth::user_context_t alice(auth::username_t("alice"));
+    const auth::user_context_t bob(auth::username_t("bob"));
+
+    optional<std::string> get_1 = k.key(r.db("test").table("t").get_(1.0), alice);
+    ASSERT_TRUE(get_1.has_value());
+
+    // The same query by the same user has the same key.
+    optional<std::string> again = k.key(r.db("test").table("t").get_(1.0), alice);
+    ASSERT_TRUE(again.has_value());
+    EXPECT_EQ(*get_1, *again);
+
+    // Unlike the query's fingerprint, the key keeps the constants.
+    optional<std::string> get_2 = k.key(r.db("test").table("t").get_(2.0), alice);
+    ASSERT_TRUE(get_2.has_value());
+    EXPECT_NE(*get_1, *get_2);
+
+    // Users don't share results, since they may not be allowed to read the same
+    // tables.
+    optional<std::string> bob_get_1 = k.key(r.db("test").table("t").get_(1.0), bob);
+    ASSERT_TRUE(bob_get_1.has_value());
+    EXPECT_NE(*get_1, *bob_get_1);
+}
+
+TEST(QueryResultCacheTest, Uncacheable) {
+    result_cache_keys_t k;
+    ql::minidriver_t &r = k.r;
+    const auth::user_context_t alice(auth::username_t("alice"));
+
+    EXPECT_TRUE(k.key(r.db("test").table("t").count(), alice).has_value());
+
+    // Writes.
+    EXPECT_FALSE(k.key(r.db("test").table("t").insert(r.object()), alice).has_value());
+    EXPECT_FALSE(k.key(r.db("test").table("t").get_(1.0).delete_(), alice).has_value());
+
+    // Terms that return something different each time, even deep inside the query.
+    EXPECT_FALSE(k.key(r.expr(1.0).call(Term::RANDOM), alice).has_value());
+    EXPECT_FALSE(k.key(r.db("test").table("t").filter(
+                           r.fun(r.expr(0.5) < r.expr(1.0).call(Term::RANDOM))),
+                       alice).has_value());
+
+    // Admin terms.
+    EXPECT_FALSE(k.key(r.db("test").table("t").call(Term::CONFIG), alice).has_value());
+
+    // Queries that are too long to be worth caching.
+    std::string long_string(QUERY_RESULT_CACHE_MAX_KEY_SIZE, 'x');
+    EXPECT_FALSE(k.key(r.db("test").table("t").get_(long_string), alice).has_value());
+}
+
+TEST(QueryResultCacheTest, PreparedKeys) {
+    const std::string func_key("prepared");
+    const std::string key_1 = ql::query_result_cache_t::make_prepared_key(
+        func_key, std::vector<ql::datum_t>{ql::datum_t(1.0)});
+
+    EXPECT_EQ(key_1, ql::query_result_cache_t::make_prepared_key(
+        func_key, std::vector<ql::datum_t>{ql::datum_t(1.0)}));
+    EXPECT_NE(key_1, ql::query_result_cache_t::make_prepared_key(
+        func_key, std::vector<ql::datum_t>{ql::datum_t(2.0)}));
+    EXPECT_NE(key_1, ql::query_result_cache_t::make_prepared_key(
+        func_key, std::vector<ql::datum_t>{ql::datum_t(1.0), ql::datum_t(1.0)}));
+    EXPECT_NE(key_1, func_key);
+}
+
+}  // namespace unittest
@@ -0,0 +1,125 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include <string>
+#include <vector>
+
+#include "arch/runtime/coroutines.hpp"
+#include "concurrency/cond_var.hpp"
+#include "concurrency/interruptor.hpp"
+#include "rdb_protocol/query_scheduler.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+/* Takes all of the current thread's slots, so that later queries have to wait. */
+class full_scheduler_t {
+public:
+    full_scheduler_t() : slots(QUERY_SCHEDULER_SLOTS_PER_THREAD) {
+        cond_t non_interruptor;
+        for (ql::query_slot_t &slot : slots) {
+            slot.acquire(this, ql::query_priority_t::NORMAL, &non_interruptor);
+        }
+    }
+    // Gives back one slot.
+    void release_one() {
+        guarantee(!slots.empty());
+        slots.pop_back();
+    }
+private:
+    std::vector<ql::query_slot_t> slots;
+};
+
+/* A query that waits for a slot in a coroutine of its own, and notes in `order`
+when it gets one. */
+class waiting_query_t {
+public:
+    waiting_query_t(const std::string &_name,
+                    const void *client,
+                    ql::query_priority_t priority,
+                    std::vector<std::string> *_order)
+        : name(_name), order(_order), interrupted(false) {
+        coro_t::spawn_now_dangerously([this, client, priority]() {
+            try {
+                slot.acquire(client, priority, &interruptor);
+                order->push_back(name);
+            } catch (const interrupted_exc_t &) {
+                interrupted = true;
+            }
+            done.pulse();
+        });
+    }
+
+    const std::string name;
+    std::vector<std::string> *order;
+    ql::query_slot_t slot;
+    cond_t interruptor;
+    cond_t done;
+    bool interrupted;
+};
+
+TPTEST(QuerySchedulerTest, FreeSlot) {
+    // With no other queries around, a slot is granted right away.
+    int client;
+    cond_t non_interruptor;
+    ql::query_slot_t slot;
+    slot.acquire(&client, ql::query_priority_t::LOW, &non_interruptor);
+    slot.reset();
+}
+
+TPTEST(QuerySchedulerTest, PrioritiesAndTurns) {
+    full_scheduler_t full;
+    int a, b, c;
+    std::vector<std::string> order;
+
+    // Client `a` pipelines three queries before `b` sends its one.  A high priority
+    // query overtakes all of them, and a low priority one comes last.
+    waiting_query_t a1("a1", &a, ql::query_priority_t::NORMAL, &order);
+    waiting_query_t a2("a2", &a, ql::query_priority_t::NORMAL, &order);
+    waiting_query_t a3("a3", &a, ql::query_priority_t::NORMAL, &order);
+    waiting_query_t b1("b1", &b, ql::query_priority_t::NORMAL, &order);
+    waiting_query_t low("low", &c, ql::query_priority_t::LOW, &order);
+    waiting_query_t high("high", &c, ql::query_priority_t::HIGH, &order);
+    EXPECT_TRUE(order.empty());
+
+    for (size_t i = 1; i <= 6; ++i) {
+        full.release_one();
+        while (order.size() < i) {
+            coro_t::yield();
+        }
+    }
+    const std::vector<std::string> expected{"high", "a1", "b1", "a2", "a3", "low"};
+    EXPECT_EQ(expected, order);
+
+    for (waiting_query_t *query : {&a1, &a2, &a3, &b1, &low, &high}) {
+        query->done.wait();
+        EXPECT_FALSE(query->interrupted);
+    }
+}
+
+TPTEST(QuerySchedulerTest, Interrupt) {
+    full_scheduler_t full;
+    int a, b;
+    std::vector<std::string> order;
+
+    waiting_query_t a1("a1", &a, ql::query_priority_t::NORMAL, &order);
+    waiting_query_t b1("b1", &b, ql::query_priority_t::NORMAL, &order);
+
+    // A query that gives up leaves the queue, and the slot goes to the next one.
+    a1.interruptor.pulse();
+    a1.done.wait();
+    EXPECT_TRUE(a1.interrupted);
+
+    full.release_one();
+    b1.done.wait();
+    EXPECT_FALSE(b1.interrupted);
+    const std::vector<std::string> expected{"b1"};
+    EXPECT_EQ(expected, order);
+
+    // Giving the slot back makes it available again.
+    b1.slot.reset();
+    waiting_query_t a2("a2", &a, ql::query_priority_t::NORMAL, &order);
+    a2.done.wait();
+    EXPECT_FALSE(a2.interrupted);
+}
+
+}  // namespace unittest
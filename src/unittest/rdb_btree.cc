@@ -97,7 +97,7 @@ sindex_name_t create_sindex(store_t *store) {
         ql::map_wire_func_t(mapping, make_vector(one)),
         reql_version_t::LATEST,
         sindex_multi_bool_t::SINGLE,
-        sindex_geo_bool_t::REGULAR);
+        sindex_kind_t::REGULAR);
 
     cond_t non_interruptor;
     store->sindex_create(name, config, &non_interruptor);
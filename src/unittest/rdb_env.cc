@@ -124,6 +124,11 @@ void NORETURN mock_namespace_interface_t::read_visitor_t::operator()(
     throw cannot_perform_query_exc_t("unimplemented", query_state_t::FAILED);
 }
 
+void NORETURN mock_namespace_interface_t::read_visitor_t::operator()(
+        UNUSED const sample_read_t &sr) {
+    throw cannot_perform_query_exc_t("unimplemented", query_state_t::FAILED);
+}
+
 mock_namespace_interface_t::read_visitor_t::read_visitor_t(
         mock_namespace_interface_t *_parent,
         read_response_t *_response) :
@@ -84,6 +84,7 @@ private:
         void NORETURN operator()(UNUSED const intersecting_geo_read_t &gr);
         void NORETURN operator()(UNUSED const nearest_geo_read_t &gr);
         void NORETURN operator()(UNUSED const distribution_read_t &dg);
+        void NORETURN operator()(UNUSED const sample_read_t &sr);
 
         read_visitor_t(mock_namespace_interface_t *parent, read_response_t *_response);
 
@@ -217,7 +217,7 @@ std::string create_sindex(const std::vector<scoped_ptr_t<store_t> > *stores) {
         ql::map_wire_func_t(mapping, make_vector(arg)),
         reql_version_t::LATEST,
         sindex_multi_bool_t::SINGLE,
-        sindex_geo_bool_t::REGULAR);
+        sindex_kind_t::REGULAR);
 
     cond_t non_interruptor;
     for (const auto &store : *stores) {
@@ -923,6 +923,9 @@ TPTEST(RDBProtocol, ArtificialChangefeeds) {
                               false,
                               ql::configured_limits_t(),
                               ql::datum_t::boolean(false),
+                              false,
+                              r_nullopt,
+                              ql::changefeed::queue_overflow_t::CLEAR,
                               keyspec_t::point_t{ql::datum_t(0.0)}),
                           "id",
                           std::vector<ql::datum_t>(),
@@ -938,6 +941,9 @@ TPTEST(RDBProtocol, ArtificialChangefeeds) {
                                false,
                                ql::configured_limits_t(),
                                ql::datum_t::boolean(false),
+                               false,
+                               r_nullopt,
+                               ql::changefeed::queue_overflow_t::CLEAR,
                                keyspec_t::point_t{ql::datum_t(10.0)}),
                            "id",
                            std::vector<ql::datum_t>(),
@@ -953,6 +959,9 @@ TPTEST(RDBProtocol, ArtificialChangefeeds) {
                             false,
                             ql::configured_limits_t(),
                             ql::datum_t::boolean(false),
+                            false,
+                            r_nullopt,
+                            ql::changefeed::queue_overflow_t::CLEAR,
                             keyspec_t::range_t{
                                 std::vector<ql::transform_variant_t>(),
                                     optional<std::string>(),
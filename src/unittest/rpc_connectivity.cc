@@ -9,11 +9,13 @@
 
 #include "arch/runtime/thread_pool.hpp"
 #include "arch/timing.hpp"
+#include "config/args.hpp"
 #include "containers/scoped.hpp"
 #include "containers/archive/socket_stream.hpp"
 #include "unittest/clustering_utils.hpp"
 #include "unittest/unittest_utils.hpp"
 #include "rpc/connectivity/cluster.hpp"
+#include "rpc/connectivity/cluster_compression.hpp"
 #include "unittest/gtest.hpp"
 
 namespace unittest {
@@ -452,6 +454,97 @@ TPTEST_MULTITHREAD(RPCConnectivityTest, BinaryData, 3) {
     EXPECT_TRUE(a2.got_spectrum);
 }
 
+/* `CompressedData` sends messages that are big enough to be compressed, interleaved
+with ones that aren't, and makes sure they all arrive intact and in order. */
+
+class compressed_test_application_t : public cluster_message_handler_t {
+public:
+    explicit compressed_test_application_t(connectivity_cluster_t *cm) :
+        cluster_message_handler_t(cm, 'C')
+        { }
+    static std::string make_message(int i) {
+        std::string message = strprintf("%d:", i);
+        if (i % 2 == 0) {
+            while (message.size() < CLUSTER_COMPRESSION_MIN_MESSAGE_SIZE * 10) {
+                message += strprintf("{\"id\": %zu, \"value\": \"message %d\"}",
+                                     message.size(), i);
+            }
+        }
+        return message;
+    }
+    void send_message(int i, peer_id_t peer) {
+        class message_writer_t : public cluster_send_message_write_callback_t {
+        public:
+            explicit message_writer_t(const std::string &_message) :
+                message(_message) { }
+            virtual ~message_writer_t() { }
+            void write(write_stream_t *stream) {
+                write_message_t wm;
+                serialize<cluster_version_t::CLUSTER>(&wm, message);
+                int res = send_write_message(stream, &wm);
+                if (res) { throw fake_archive_exc_t(); }
+            }
+#ifdef ENABLE_MESSAGE_PROFILER
+            const char *message_profiler_tag() const {
+                return "unittest";
+            }
+#endif
+            std::string message;
+        } writer(make_message(i));
+        auto_drainer_t::lock_t connection_keepalive;
+        connectivity_cluster_t::connection_t *connection =
+            get_connectivity_cluster()->get_connection(peer, &connection_keepalive);
+        ASSERT_TRUE(connection != nullptr);
+        get_connectivity_cluster()->send_message(connection, connection_keepalive,
+                                                 get_message_tag(), &writer);
+    }
+    void on_message(connectivity_cluster_t::connection_t *,
+                    auto_drainer_t::lock_t,
+                    read_stream_t *stream) {
+        std::string message;
+        archive_result_t res
+            = deserialize<cluster_version_t::CLUSTER>(stream, &message);
+        if (bad(res)) { throw fake_archive_exc_t(); }
+        received.push_back(message);
+    }
+    std::vector<std::string> received;
+};
+
+TPTEST_MULTITHREAD(RPCConnectivityTest, CompressedData, 3) {
+    connectivity_cluster_t c1, c2;
+    compressed_test_application_t a1(&c1), a2(&c2);
+    test_cluster_run_t cr1(&c1);
+    test_cluster_run_t cr2(&c2);
+    cr1.join(get_cluster_local_address(&c2), 0);
+
+    let_stuff_happen();
+
+    const int num_messages = 20;
+    for (int i = 0; i < num_messages; ++i) {
+        a1.send_message(i, c2.get_me());
+    }
+
+    let_stuff_happen();
+
+    ASSERT_EQ(static_cast<size_t>(num_messages), a2.received.size());
+    for (int i = 0; i < num_messages; ++i) {
+        EXPECT_EQ(compressed_test_application_t::make_message(i), a2.received[i]);
+    }
+}
+
+/* `CompressedSizes` makes sure that a peer can't make us read or inflate a compressed
+message that no server would have sent. */
+TEST(RPCConnectivityTest, CompressedSizes) {
+    EXPECT_TRUE(cluster_decompressor_t::sizes_are_valid(100, 1000));
+    // Data that doesn't compress comes out a little bigger than it went in.
+    EXPECT_TRUE(cluster_decompressor_t::sizes_are_valid(1020, 1000));
+    EXPECT_FALSE(cluster_decompressor_t::sizes_are_valid(MEGABYTE, 1000));
+    EXPECT_TRUE(cluster_decompressor_t::sizes_are_valid(
+        100, CLUSTER_COMPRESSION_MAX_MESSAGE_SIZE));
+    EXPECT_FALSE(cluster_decompressor_t::sizes_are_valid(
+        100, CLUSTER_COMPRESSION_MAX_MESSAGE_SIZE + 1));
+}
+
 /* `PeerIDSemantics` makes sure that `peer_id_t::is_nil()` works as expected. */
 TPTEST_MULTITHREAD(RPCConnectivityTest, PeerIDSemantics, 3) {
     peer_id_t nil_peer;
@@ -1,3 +1,5 @@
+#include <string.h>
+
 #include <functional>
 
 #include "arch/runtime/starter.hpp"
@@ -30,7 +32,7 @@ void run_AddDeleteRepeatedly(bool perform_index_write) {
 
     buf_ptr_t buf = buf_ptr_t::alloc_zeroed(ser.max_block_size());
 
-    scoped_ptr_t<file_account_t> account(ser.make_io_account(1));
+    scoped_ptr_t<file_account_t> account(ser.make_io_account(io_class_t::foreground_read, 1));
 
     // We run enough create/delete operations to run ourselves through the young
     // extent queue and (with perform_index_write true) kick off a GC that reproduces
@@ -90,5 +92,111 @@ TEST(SerializerTest, AddDeleteRepeatedlyWithIndex) {
     run_in_thread_pool(std::bind(run_AddDeleteRepeatedly, true), 4);
 }
 
+TPTEST(SerializerTest, CompressedBlocks, 4) {
+    mock_file_opener_t file_opener;
+    log_serializer_t::create(&file_opener, log_serializer_t::static_config_t());
+    log_serializer_t::dynamic_config_t dynamic_config;
+    dynamic_config.compression = block_compression_t::zlib;
+    log_serializer_t ser(dynamic_config,
+                         &file_opener,
+                         &get_global_perfmon_collection());
+
+    scoped_ptr_t<file_account_t> account(ser.make_io_account(io_class_t::foreground_read, 1));
+
+    // One block that compresses well, and one that doesn't.
+    std::vector<buf_ptr_t> bufs;
+    bufs.push_back(buf_ptr_t::alloc_zeroed(ser.max_block_size()));
+    memset(bufs[0].cache_data(), 'a', ser.max_block_size().value() / 2);
+    bufs.push_back(buf_ptr_t::alloc_zeroed(ser.max_block_size()));
+    char *data = static_cast<char *>(bufs[1].cache_data());
+    uint32_t x = 12345;
+    for (uint16_t i = 0; i < ser.max_block_size().value(); ++i) {
+        x = x * 1103515245 + 12345;
+        data[i] = static_cast<char>(x >> 16);
+    }
+
+    std::vector<buf_write_info_t> infos;
+    for (size_t i = 0; i < bufs.size(); ++i) {
+        infos.push_back(buf_write_info_t(bufs[i].ser_buffer(), bufs[i].block_size(), i));
+    }
+
+    struct : public iocallback_t, public cond_t {
+        void on_io_complete() {
+            pulse();
+        }
+    } cb;
+    std::vector<counted_t<block_token_t>> tokens
+        = ser.block_writes(infos.data(), infos.size(), account.get(), &cb);
+    cb.wait();
+
+    ASSERT_EQ(2u, tokens.size());
+    ASSERT_LT(tokens[0]->block_size().ser_value(),
+              ser.max_block_size().ser_value());
+    ASSERT_EQ(ser.max_block_size().ser_value(), tokens[1]->block_size().ser_value());
+
+    for (size_t i = 0; i < bufs.size(); ++i) {
+        buf_ptr_t read = ser.block_read(tokens[i], account.get());
+        ASSERT_EQ(bufs[i].block_size().ser_value(), read.block_size().ser_value());
+        ASSERT_EQ(0, memcmp(bufs[i].cache_data(), read.cache_data(),
+                            bufs[i].block_size().value()));
+    }
+}
+
+TPTEST(SerializerTest, ReconstructAfterRestart, 4) {
+    mock_file_opener_t file_opener;
+    log_serializer_t::create(&file_opener, log_serializer_t::static_config_t());
+
+    // The blocks get written in the opposite order of their block ids, so that on
+    // restart they get marked live in the opposite order of their offsets.
+    const block_id_t num_blocks = 64;
+    std::vector<buf_ptr_t> bufs;
+    {
+        log_serializer_t ser(log_serializer_t::dynamic_config_t(),
+                             &file_opener,
+                             &get_global_perfmon_collection());
+        scoped_ptr_t<file_account_t> account(ser.make_io_account(io_class_t::foreground_read, 1));
+
+        std::vector<buf_write_info_t> infos;
+        for (block_id_t i = 0; i < num_blocks; ++i) {
+            bufs.push_back(buf_ptr_t::alloc_zeroed(ser.max_block_size()));
+            memset(bufs.back().cache_data(), static_cast<int>(i), 16);
+        }
+        for (block_id_t i = num_blocks; i-- > 0;) {
+            infos.push_back(buf_write_info_t(bufs[i].ser_buffer(), bufs[i].block_size(),
+                                             i));
+        }
+
+        struct : public iocallback_t, public cond_t {
+            void on_io_complete() {
+                pulse();
+            }
+        } cb;
+        std::vector<counted_t<block_token_t>> tokens
+            = ser.block_writes(infos.data(), infos.size(), account.get(), &cb);
+        cb.wait();
+
+        std::vector<index_write_op_t> write_ops;
+        for (size_t i = 0; i < tokens.size(); ++i) {
+            write_ops.push_back(index_write_op_t(infos[i].block_id,
+                                                 make_optional(tokens[i]),
+                                                 make_optional(repli_timestamp_t::distant_past)));
+        }
+        new_mutex_in_line_t dummy_acq;
+        ser.index_write(&dummy_acq, []{ }, write_ops);
+    }
+
+    log_serializer_t ser(log_serializer_t::dynamic_config_t(),
+                         &file_opener,
+                         &get_global_perfmon_collection());
+    scoped_ptr_t<file_account_t> account(ser.make_io_account(io_class_t::foreground_read, 1));
+    ASSERT_EQ(num_blocks, ser.end_block_id());
+    for (block_id_t i = 0; i < num_blocks; ++i) {
+        counted_t<block_token_t> token = ser.index_read(i);
+        ASSERT_TRUE(token.has());
+        buf_ptr_t read = ser.block_read(token, account.get());
+        ASSERT_EQ(0, memcmp(bufs[i].cache_data(), read.cache_data(),
+                            bufs[i].block_size().value()));
+    }
+}
 
 }  // namespace unittest
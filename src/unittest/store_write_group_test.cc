@@ -0,0 +1,217 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include <string>
+#include <vector>
+
+#include "arch/io/disk.hpp"
+#include "arch/runtime/coroutines.hpp"
+#include "btree/reql_specific.hpp"
+#include "buffer_cache/alt.hpp"
+#include "buffer_cache/cache_balancer.hpp"
+#include "concurrency/cond_var.hpp"
+#include "containers/uuid.hpp"
+#include "rdb_protocol/protocol.hpp"
+#include "rdb_protocol/store.hpp"
+#include "serializer/log/log_serializer.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/mock_store.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+/* A `store_t` on a temporary file. */
+class write_group_store_t {
+public:
+    write_group_store_t() :
+        io_backender(file_direct_io_mode_t::buffered_desired),
+        balancer(GIGABYTE),
+        file_opener(temp_file.name(), &io_backender),
+        serializer(create_serializer(&file_opener)),
+        store(region_t::universe(),
+              serializer.get(),
+              &balancer,
+              "unit_test_store",
+              true,
+              &get_global_perfmon_collection(),
+              nullptr,
+              &io_backender,
+              base_path_t("."),
+              generate_uuid(),
+              update_sindexes_t::UPDATE,
+              which_cpu_shard_t{0, 1}) { }
+
+    // The metainfo a write with the given timestamp leaves behind.
+    static region_map_t<binary_blob_t> metainfo_for(state_timestamp_t timestamp) {
+        return region_map_t<binary_blob_t>(
+            region_t::universe(), binary_blob_t(timestamp));
+    }
+
+    region_map_t<binary_blob_t> get_metainfo() {
+        cond_t non_interruptor;
+        read_token_t token;
+        store.new_read_token(&token);
+        return store.get_metainfo(
+            order_token_t::ignore, &token, region_t::universe(), &non_interruptor);
+    }
+
+private:
+    static scoped_ptr_t<log_serializer_t> create_serializer(
+            filepath_file_opener_t *opener) {
+        recreate_temporary_directory(base_path_t("."));
+        log_serializer_t::create(opener, log_serializer_t::static_config_t());
+        return make_scoped<log_serializer_t>(
+            log_serializer_t::dynamic_config_t(), opener,
+            &get_global_perfmon_collection());
+    }
+
+    temp_file_t temp_file;
+    io_backender_t io_backender;
+    dummy_cache_balancer_t balancer;
+    filepath_file_opener_t file_opener;
+    scoped_ptr_t<log_serializer_t> serializer;
+
+public:
+    store_t store;
+};
+
+/* A single-document write, which takes its write token when it's constructed and
+then waits for the store in a coroutine of its own, so that it can join a write
+group with the writes around it. */
+class grouped_write_t {
+public:
+    grouped_write_t(store_t *store,
+                    const std::string &key,
+                    const std::string &value,
+                    state_timestamp_t timestamp)
+        : write(mock_overwrite(key, value)), interrupted(false) {
+        store->new_write_token(&token);
+        coro_t::spawn_now_dangerously([this, store, timestamp]() {
+#ifndef NDEBUG
+            metainfo_checker_t checker(region_t::universe(),
+                [](const region_t &, const binary_blob_t &) { });
+#endif
+            try {
+                store->write(
+                    DEBUG_ONLY(checker, )
+                    write_group_store_t::metainfo_for(timestamp),
+                    write, &response, write_durability_t::SOFT, timestamp,
+                    order_token_t::ignore, &token, &interruptor);
+            } catch (const interrupted_exc_t &) {
+                interrupted = true;
+            }
+            done.pulse();
+        });
+    }
+
+    write_t write;
+    write_response_t response;
+    write_token_t token;
+    cond_t interruptor;
+    cond_t done;
+    bool interrupted;
+};
+
+/* Holds the superblock, so that the writes behind it pile up and are grouped. */
+class superblock_holder_t {
+public:
+    explicit superblock_holder_t(store_t *store) {
+        cond_t non_interruptor;
+        write_token_t token;
+        store->new_write_token(&token);
+        store->acquire_superblock_for_write(
+            1, write_durability_t::SOFT, &token, &txn, &superblock, &non_interruptor);
+    }
+    void release() {
+        superblock.reset();
+        txn->commit();
+        txn.reset();
+    }
+private:
+    scoped_ptr_t<txn_t> txn;
+    scoped_ptr_t<real_superblock_t> superblock;
+};
+
+TPTEST(StoreWriteGroupTest, Ordering) {
+    write_group_store_t s;
+    superblock_holder_t holder(&s.store);
+
+    /* Every write sets its own key, and also overwrites a key that all of them
+    share.  Writes to the shared key have to be applied in token order, while the
+    others can run alongside them. */
+    const int num_writes = 40;
+    std::vector<scoped_ptr_t<grouped_write_t> > writes;
+    state_timestamp_t timestamp = state_timestamp_t::zero();
+    for (int i = 0; i < num_writes; ++i) {
+        timestamp = timestamp.next();
+        writes.push_back(make_scoped<grouped_write_t>(
+            &s.store, "shared", std::to_string(i), timestamp));
+        timestamp = timestamp.next();
+        writes.push_back(make_scoped<grouped_write_t>(
+            &s.store, strprintf("key%d", i), std::to_string(i), timestamp));
+    }
+    for (int i = 0; i < 10; ++i) {
+        coro_t::yield();
+    }
+    holder.release();
+
+    for (const auto &w : writes) {
+        w->done.wait();
+        EXPECT_FALSE(w->interrupted);
+    }
+    EXPECT_EQ(std::to_string(num_writes - 1), mock_lookup(&s.store, "shared"));
+    for (int i = 0; i < num_writes; ++i) {
+        EXPECT_EQ(std::to_string(i), mock_lookup(&s.store, strprintf("key%d", i)));
+    }
+    // The metainfo is that of the last write.
+    EXPECT_TRUE(write_group_store_t::metainfo_for(timestamp) == s.get_metainfo());
+}
+
+TPTEST(StoreWriteGroupTest, Interruption) {
+    write_group_store_t s;
+    superblock_holder_t holder(&s.store);
+
+    state_timestamp_t timestamp = state_timestamp_t::zero();
+    auto next_write = [&](const std::string &key, const std::string &value) {
+        timestamp = timestamp.next();
+        return make_scoped<grouped_write_t>(&s.store, key, value, timestamp);
+    };
+    scoped_ptr_t<grouped_write_t> a1 = next_write("a", "1");
+    scoped_ptr_t<grouped_write_t> b1 = next_write("b", "1");
+    scoped_ptr_t<grouped_write_t> c1 = next_write("c", "1");
+    scoped_ptr_t<grouped_write_t> c2 = next_write("c", "2");
+    scoped_ptr_t<grouped_write_t> a2 = next_write("a", "2");
+    for (int i = 0; i < 10; ++i) {
+        coro_t::yield();
+    }
+
+    /* `c1` has joined a group by now.  The group still applies it or leaves it
+    out as a whole, whether or not `c1` notices the interruption, and the writes
+    around it are unaffected. */
+    c1->interruptor.pulse();
+    holder.release();
+
+    for (grouped_write_t *w : {a1.get(), b1.get(), c1.get(), c2.get(), a2.get()}) {
+        w->done.wait();
+    }
+    for (grouped_write_t *w : {a1.get(), b1.get(), c2.get(), a2.get()}) {
+        EXPECT_FALSE(w->interrupted);
+    }
+    EXPECT_EQ("2", mock_lookup(&s.store, "a"));
+    EXPECT_EQ("1", mock_lookup(&s.store, "b"));
+    EXPECT_EQ("2", mock_lookup(&s.store, "c"));
+
+    /* A write interrupted while it waits for its token drops out without holding up
+    the writes behind it. */
+    scoped_ptr_t<write_token_t> earlier(new write_token_t);
+    s.store.new_write_token(earlier.get());
+    scoped_ptr_t<grouped_write_t> d1 = next_write("d", "1");
+    scoped_ptr_t<grouped_write_t> d2 = next_write("d", "2");
+    d1->interruptor.pulse();
+    d1->done.wait();
+    EXPECT_TRUE(d1->interrupted);
+    earlier.reset();
+    d2->done.wait();
+    EXPECT_FALSE(d2->interrupted);
+    EXPECT_EQ("2", mock_lookup(&s.store, "d"));
+}
+
+}  // namespace unittest
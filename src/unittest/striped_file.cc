@@ -0,0 +1,82 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include <unistd.h>
+
+#include "arch/arch.hpp"
+#include "arch/io/disk.hpp"
+#include "paths.hpp"
+#include "serializer/log/log_serializer.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+TPTEST(StripedFile, ReadsBackAcrossStripes) {
+    temp_directory_t data_dir;
+    temp_directory_t stripe_dir;
+    recreate_temporary_directory(data_dir.path());
+    io_backender_t io_backender(file_direct_io_mode_t::buffered_desired);
+    const serializer_filepath_t path(data_dir.path(), "striped");
+
+    // Three units, so that the file itself gets the first and the last of them.
+    const int64_t stripe_size = SERIALIZER_FILE_STRIPE_SIZE;
+    const int64_t size = 3 * stripe_size;
+    scoped_device_block_aligned_ptr_t<char> expected(size);
+    for (int64_t i = 0; i < size; ++i) {
+        expected.get()[i] = static_cast<char>(i % 251);
+    }
+
+    {
+        filepath_file_opener_t opener(path, &io_backender,
+                                      std::vector<std::string>{
+                                          stripe_dir.path().path()});
+        scoped_ptr_t<file_t> file;
+        opener.open_serializer_file_create_temporary(&file);
+        file->set_file_size(size);
+        co_write(file.get(), 0, size, expected.get(), DEFAULT_DISK_ACCOUNT,
+                 datasync_op::no_datasyncs);
+
+        // This only goes to the second stripe, so the first one gets datasynced
+        // separately.
+        scoped_device_block_aligned_ptr_t<char> block(DEVICE_BLOCK_SIZE);
+        memset(block.get(), 'x', DEVICE_BLOCK_SIZE);
+        memset(expected.get() + stripe_size, 'x', DEVICE_BLOCK_SIZE);
+        co_write(file.get(), stripe_size, DEVICE_BLOCK_SIZE, block.get(),
+                 DEFAULT_DISK_ACCOUNT, datasync_op::wrap_in_datasyncs);
+
+        file.reset();
+        opener.move_serializer_file_to_permanent_location();
+    }
+
+    {
+        // The stripes are found through the stripe manifest.
+        filepath_file_opener_t opener(path, &io_backender);
+        scoped_ptr_t<file_t> file;
+        opener.open_serializer_file_existing(&file);
+        ASSERT_EQ(size, file->get_file_size());
+
+        // A read that starts and ends in the middle of units.
+        const int64_t length = size - 2 * DEVICE_BLOCK_SIZE;
+        scoped_device_block_aligned_ptr_t<char> actual(length);
+        co_read(file.get(), DEVICE_BLOCK_SIZE, length, actual.get(),
+                DEFAULT_DISK_ACCOUNT);
+        EXPECT_EQ(0, memcmp(expected.get() + DEVICE_BLOCK_SIZE, actual.get(), length));
+    }
+
+    const std::string first_stripe = blocking_read_file(path.permanent_path().c_str());
+    ASSERT_EQ(static_cast<size_t>(2 * stripe_size), first_stripe.size());
+    EXPECT_EQ(0, memcmp(expected.get(), first_stripe.data(), stripe_size));
+    EXPECT_EQ(0, memcmp(expected.get() + 2 * stripe_size,
+                        first_stripe.data() + stripe_size, stripe_size));
+    const std::string second_stripe_path =
+        stripe_dir.path().path() + PATH_SEPARATOR + "striped";
+    const std::string second_stripe = blocking_read_file(second_stripe_path.c_str());
+    ASSERT_EQ(static_cast<size_t>(stripe_size), second_stripe.size());
+    EXPECT_EQ(0, memcmp(expected.get() + stripe_size, second_stripe.data(),
+                        stripe_size));
+
+    remove_serializer_file_stripes(path.permanent_path());
+    EXPECT_NE(0, access(second_stripe_path.c_str(), F_OK));
+    EXPECT_NE(0, access((path.permanent_path() + ".stripes").c_str(), F_OK));
+}
+
+}  // namespace unittest
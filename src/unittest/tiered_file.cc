@@ -0,0 +1,75 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include <unistd.h>
+
+#include "arch/arch.hpp"
+#include "arch/io/disk.hpp"
+#include "paths.hpp"
+#include "serializer/log/log_serializer.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+TPTEST(TieredFile, ReadsBackFromBothTiers) {
+    temp_directory_t data_dir;
+    temp_directory_t cold_dir;
+    recreate_temporary_directory(data_dir.path());
+    io_backender_t io_backender(file_direct_io_mode_t::buffered_desired);
+    const serializer_filepath_t path(data_dir.path(), "tiered");
+
+    const int64_t size = 2 * DEVICE_BLOCK_SIZE;
+    scoped_device_block_aligned_ptr_t<char> fast_data(size);
+    scoped_device_block_aligned_ptr_t<char> cold_data(size);
+    memset(fast_data.get(), 'f', size);
+    memset(cold_data.get(), 'c', size);
+
+    {
+        filepath_file_opener_t opener(path, &io_backender, std::vector<std::string>(),
+                                      cold_dir.path().path());
+        scoped_ptr_t<file_t> file;
+        opener.open_serializer_file_create_temporary(&file);
+        // The file only gets its cold tier at its permanent location.
+        ASSERT_EQ(nullptr, file->cold_tier());
+        file.reset();
+        opener.move_serializer_file_to_permanent_location();
+
+        opener.open_serializer_file_existing(&file);
+        ASSERT_NE(nullptr, file->cold_tier());
+        file->set_file_size(size);
+        file->cold_tier()->set_file_size(size);
+        co_write(file.get(), 0, size, fast_data.get(), DEFAULT_DISK_ACCOUNT,
+                 datasync_op::no_datasyncs);
+        co_write(file.get(), SERIALIZER_COLD_TIER_OFFSET, size, cold_data.get(),
+                 DEFAULT_DISK_ACCOUNT, datasync_op::no_datasyncs);
+        // This gets ordered after the write to the cold tier.
+        co_write(file.get(), 0, DEVICE_BLOCK_SIZE, fast_data.get(),
+                 DEFAULT_DISK_ACCOUNT, datasync_op::wrap_in_datasyncs);
+    }
+
+    {
+        // The cold tier is found through the cold tier manifest.
+        filepath_file_opener_t opener(path, &io_backender);
+        scoped_ptr_t<file_t> file;
+        opener.open_serializer_file_existing(&file);
+        ASSERT_EQ(size, file->get_file_size());
+
+        scoped_device_block_aligned_ptr_t<char> actual(DEVICE_BLOCK_SIZE);
+        co_read(file.get(), SERIALIZER_COLD_TIER_OFFSET + DEVICE_BLOCK_SIZE,
+                DEVICE_BLOCK_SIZE, actual.get(), DEFAULT_DISK_ACCOUNT);
+        EXPECT_EQ(0, memcmp(cold_data.get(), actual.get(), DEVICE_BLOCK_SIZE));
+        co_read(file.get(), DEVICE_BLOCK_SIZE, DEVICE_BLOCK_SIZE, actual.get(),
+                DEFAULT_DISK_ACCOUNT);
+        EXPECT_EQ(0, memcmp(fast_data.get(), actual.get(), DEVICE_BLOCK_SIZE));
+    }
+
+    const std::string cold_path = cold_dir.path().path() + PATH_SEPARATOR + "tiered";
+    const std::string cold_contents = blocking_read_file(cold_path.c_str());
+    ASSERT_EQ(static_cast<size_t>(size), cold_contents.size());
+    EXPECT_EQ(0, memcmp(cold_data.get(), cold_contents.data(), size));
+
+    remove_serializer_file_stripes(path.permanent_path());
+    EXPECT_NE(0, access(cold_path.c_str(), F_OK));
+    EXPECT_NE(0, access((path.permanent_path() + ".cold").c_str(), F_OK));
+}
+
+}  // namespace unittest
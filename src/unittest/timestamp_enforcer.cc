@@ -0,0 +1,45 @@
+// Copyright 2010-2016 RethinkDB, all rights reserved.
+#include "concurrency/timestamp_enforcer.hpp"
+
+#include "arch/runtime/coroutines.hpp"
+#include "concurrency/cond_var.hpp"
+#include "unittest/gtest.hpp"
+#include "unittest/unittest_utils.hpp"
+
+namespace unittest {
+
+static state_timestamp_t nth_timestamp(int n) {
+    state_timestamp_t t = state_timestamp_t::zero();
+    for (int i = 0; i < n; ++i) {
+        t = t.next();
+    }
+    return t;
+}
+
+TPTEST(TimestampEnforcer, CompleteRange) {
+    timestamp_enforcer_t enforcer(state_timestamp_t::zero());
+    cond_t non_interruptor;
+
+    /* A range that doesn't start at the next timestamp waits for the gap. */
+    enforcer.complete_range(nth_timestamp(3), nth_timestamp(5));
+    EXPECT_EQ(state_timestamp_t::zero(), enforcer.get_latest_all_before_completed());
+
+    bool woken = false;
+    coro_t::spawn_now_dangerously([&]() {
+        enforcer.wait_all_before(nth_timestamp(6), &non_interruptor);
+        woken = true;
+    });
+    EXPECT_FALSE(woken);
+
+    /* Filling the gap picks up the range that was completed early. */
+    enforcer.complete_range(nth_timestamp(1), nth_timestamp(2));
+    EXPECT_EQ(nth_timestamp(5), enforcer.get_latest_all_before_completed());
+    EXPECT_FALSE(woken);
+
+    enforcer.complete(nth_timestamp(6));
+    EXPECT_EQ(nth_timestamp(6), enforcer.get_latest_all_before_completed());
+    coro_t::yield();
+    EXPECT_TRUE(woken);
+}
+
+}  // namespace unittest
@@ -158,4 +158,13 @@ TEST(StlUtilsTest, SplitString) {
     EXPECT_EQ(make_vector<std::string>("1", " 2 3"), split_string("1, 2 3", ','));
 }
 
+TEST(UtilsTest, ParseCpuList) {
+    EXPECT_EQ(make_vector<int>(0, 1, 2, 3, 8, 10, 11), parse_cpu_list("0-3,8,10-11\n"));
+    EXPECT_EQ(make_vector<int>(5), parse_cpu_list("5"));
+    EXPECT_EQ(std::vector<int>(), parse_cpu_list(""));
+    EXPECT_EQ(std::vector<int>(), parse_cpu_list("3-1"));
+    EXPECT_EQ(std::vector<int>(), parse_cpu_list("0,,1"));
+    EXPECT_EQ(std::vector<int>(), parse_cpu_list("a"));
+}
+
 }  // namespace unittest
@@ -0,0 +1,198 @@
+#!/usr/bin/env python
+# Copyright 2010-2016 RethinkDB, all rights reserved.
+
+'''Measure what changefeeds cost: how long changes take to reach each kind of feed,
+how much server CPU each delivered change takes, and how much memory each open feed
+holds on to.'''
+
+from __future__ import print_function
+
+import argparse
+import json
+import math
+import os
+import sys
+import threading
+import time
+
+sys.path.append(os.path.abspath(os.path.join(os.path.dirname(__file__), os.path.pardir, 'common')))
+import driver, utils
+
+r = utils.import_python_driver()
+
+# Each kind of feed we open, by name.  Every write sets `ts` to the time it was made,
+# so a feed can tell how long the change took to reach it.
+feed_kinds = {
+    "all": lambda tbl: tbl.changes(),
+    "filter": lambda tbl: tbl.filter(r.row["writer"] == 0).changes(),
+    "between": lambda tbl: tbl.between(0, 1000, index="value").changes(),
+    "limit": lambda tbl: tbl.order_by(index=r.desc("value")).limit(10).changes(),
+    "squash": lambda tbl: tbl.changes(squash=0.05),
+    "point": lambda tbl: tbl.get(0).changes()
+}
+
+table_name = "cfeed_bench"
+num_keys = 10000 # Writes pick their key from this many ids
+
+def percentile(sorted_vals, p):
+    if len(sorted_vals) == 0:
+        return None
+    return sorted_vals[min(len(sorted_vals) - 1, int(math.floor(len(sorted_vals) / 100. * p)))]
+
+def server_cpu_seconds(pid):
+    '''User plus system CPU time the server has used so far.'''
+    with open('/proc/%d/stat' % pid) as f:
+        fields = f.read().rsplit(')', 1)[1].split()
+    return (int(fields[11]) + int(fields[12])) / float(os.sysconf('SC_CLK_TCK'))
+
+def server_rss_bytes(pid):
+    with open('/proc/%d/status' % pid) as f:
+        for line in f:
+            if line.startswith('VmRSS:'):
+                return int(line.split()[1]) * 1024
+    return 0
+
+class Feed(threading.Thread):
+    def __init__(self, server, kind):
+        super(Feed, self).__init__()
+        self.daemon = True
+        self.kind = kind
+        self.latencies = []
+        self.conn = r.connect(host="localhost", port=server.driver_port)
+        self.cursor = feed_kinds[kind](r.db("test").table(table_name)).run(self.conn)
+
+    def run(self):
+        try:
+            for change in self.cursor:
+                now = time.time()
+                new_val = change.get("new_val")
+                if new_val is not None and "ts" in new_val:
+                    self.latencies.append(now - new_val["ts"])
+        except r.errors.ReqlError:
+            pass # The cursor was closed.
+
+    def close(self):
+        self.conn.close(noreply_wait=False)
+
+class Writer(threading.Thread):
+    def __init__(self, server, writer_id, duration):
+        super(Writer, self).__init__()
+        self.daemon = True
+        self.writer_id = writer_id
+        self.duration = duration
+        self.writes = 0
+        self.conn = r.connect(host="localhost", port=server.driver_port)
+
+    def run(self):
+        tbl = r.db("test").table(table_name)
+        start = time.time()
+        while time.time() - start < self.duration:
+            key = (self.writes * 7919 + self.writer_id) % num_keys
+            tbl.insert({"id": key,
+                        "writer": self.writer_id,
+                        "value": self.writes % 2000,
+                        "ts": time.time()},
+                       conflict="replace").run(self.conn, durability="soft")
+            self.writes += 1
+        self.conn.close()
+
+def run_round(server, kinds, num_feeds, num_writers, duration):
+    '''Opens `num_feeds` feeds of each kind in `kinds`, runs `num_writers` writers
+    against them for `duration` seconds and returns what it measured.'''
+    pid = server.pid
+    rss_before = server_rss_bytes(pid)
+    feeds = [Feed(server, kind) for kind in kinds for _ in range(num_feeds)]
+    for feed in feeds:
+        feed.start()
+    time.sleep(1)
+    rss_with_feeds = server_rss_bytes(pid)
+
+    cpu_before = server_cpu_seconds(pid)
+    writers = [Writer(server, i, duration) for i in range(num_writers)]
+    for writer in writers:
+        writer.start()
+    for writer in writers:
+        writer.join()
+    # Give the feeds a moment to catch up before we stop counting.
+    time.sleep(1)
+    cpu_used = server_cpu_seconds(pid) - cpu_before
+    rss_peak = server_rss_bytes(pid)
+
+    for feed in feeds:
+        feed.close()
+
+    result = {
+        "writes": sum(w.writes for w in writers),
+        "feeds": len(feeds),
+        "server_cpu_seconds": cpu_used,
+        "memory_per_idle_feed_bytes": (rss_with_feeds - rss_before) / float(len(feeds)),
+        "memory_per_feed_bytes": (rss_peak - rss_before) / float(len(feeds)),
+        "kinds": {}
+    }
+    delivered = 0
+    for kind in kinds:
+        latencies = sorted(l for f in feeds if f.kind == kind for l in f.latencies)
+        delivered += len(latencies)
+        result["kinds"][kind] = {
+            "delivered": len(latencies),
+            "p50": percentile(latencies, 50),
+            "p90": percentile(latencies, 90),
+            "p99": percentile(latencies, 99),
+            "max": latencies[-1] if latencies else None
+        }
+    result["delivered"] = delivered
+    result["server_cpu_seconds_per_delivered_change"] = \
+        cpu_used / delivered if delivered else None
+    return result
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('--build', default=None, help='directory with the rethinkdb executable')
+    parser.add_argument('--data-dir', default='./', help='where to put the server data')
+    parser.add_argument('--writers', type=int, nargs='+', default=[1, 4])
+    parser.add_argument('--feeds', type=int, nargs='+', default=[1, 10, 100],
+                        help='number of feeds of each kind')
+    parser.add_argument('--kinds', nargs='+', default=sorted(feed_kinds.keys()),
+                        choices=sorted(feed_kinds.keys()))
+    parser.add_argument('--duration', type=float, default=10, help='seconds of writes per round')
+    options = parser.parse_args()
+
+    executable_path = utils.find_rethinkdb_executable() if options.build is None \
+        else os.path.realpath(os.path.join(options.build, 'rethinkdb'))
+    if not os.path.basename(os.path.dirname(executable_path)).startswith('release'):
+        sys.stderr.write('Warning: Testing a non-release build: %s\n' % executable_path)
+
+    results = {}
+    with driver.Process(name=os.path.join(options.data_dir, 'changefeeds'),
+                        executable_path=executable_path) as server:
+        conn = r.connect(host="localhost", port=server.driver_port)
+        if "test" not in r.db_list().run(conn):
+            r.db_create("test").run(conn)
+        if table_name in r.db("test").table_list().run(conn):
+            r.db("test").table_drop(table_name).run(conn)
+        r.db("test").table_create(table_name).run(conn)
+        r.db("test").table(table_name).index_create("value").run(conn)
+        r.db("test").table(table_name).index_wait().run(conn)
+
+        for kind in options.kinds:
+            for num_feeds in options.feeds:
+                for num_writers in options.writers:
+                    tag = "%s-%dfeeds-%dwriters" % (kind, num_feeds, num_writers)
+                    print("Running %s..." % tag, end=' ')
+                    sys.stdout.flush()
+                    results[tag] = run_round(server, [kind], num_feeds, num_writers,
+                                             options.duration)
+                    print(" Done. p99 %s s, %s CPU s/change" % (
+                        results[tag]["kinds"][kind]["p99"],
+                        results[tag]["server_cpu_seconds_per_delivered_change"]))
+                    sys.stdout.flush()
+
+    if not os.path.exists("results"):
+        os.makedirs("results")
+    path = "results/changefeeds_" + time.strftime("%y.%m.%d-%H:%M:%S") + ".txt"
+    with open(path, "w") as f:
+        f.write(json.dumps(results, indent=2))
+    print("Results saved to %s" % path)
+
+if __name__ == "__main__":
+    main()
@@ -10,7 +10,7 @@ import os
 import math
 import subprocess
 
-from util import gen_doc, gen_num_docs, compare
+from util import gen_doc, gen_num_docs, compare, plan_shape
 from queries import constant_queries, table_queries, write_queries, delete_queries
 
 sys.path.append(os.path.abspath(os.path.join(os.path.dirname(__file__), os.path.pardir, 'common')))
@@ -241,6 +241,7 @@ def execute_read_write_queries(suffix):
             else:
                 max_i = 1
 
+            stats_before = query_stats_snapshot()
             durations = []
             start = time.time()
             while time.time() - start < time_per_query and count < executions_per_query:
@@ -263,13 +264,18 @@ def execute_read_write_queries(suffix):
                 durations.append(time.time() - start_query)
                 count += 1
 
+            end = time.time()
+            counters = counters_per_call(stats_before, query_stats_snapshot())
+
             durations.sort()
             results[table_queries[p]["tag"] + "-" + table["name"] + "-" + suffix] = {
-                "average": (time.time() - start) / count,
+                "average": (end - start) / count,
                 "min": durations[0],
                 "max": durations[len(durations) - 1],
                 "first_centile": durations[int(math.floor(len(durations) / 100. * 1))],
-                "last_centile": durations[int(math.floor(len(durations) / 100. * 99))]
+                "last_centile": durations[int(math.floor(len(durations) / 100. * 99))],
+                "plan": profile_plan(eval(table_queries[p]["query"])),
+                "counters": counters
             }
 
 
@@ -360,6 +366,45 @@ def execute_constant_queries():
     print(" Done.")
     sys.stdout.flush()
 
+def profile_plan(query):
+    """Runs `query` once with `profile: true` and returns the shape of its plan, or
+    `None` if no profile came back"""
+    res = query.run(connection, profile=True)
+    profile = None
+    if isinstance(res, dict) and "profile" in res:
+        profile = res["profile"]
+        res = res["value"]
+    if isinstance(res, r.net.Cursor):
+        list(res)
+        res.close()
+        if profile is None:
+            profile = getattr(res, "profile", None)
+    return None if profile is None else plan_shape(profile)
+
+# The counters of `rethinkdb._query_stats` that say how much work a query did
+query_counters = ["cache_misses", "blocks_read", "rows_scanned", "rows_returned", "bytes_sent"]
+
+def query_stats_snapshot():
+    """The rows of `rethinkdb._query_stats` by query fingerprint"""
+    return dict((row["id"], row) for row in
+                r.db("rethinkdb").table("_query_stats").run(connection))
+
+def counters_per_call(before, after):
+    """The average of each counter of `query_counters` over the calls made between the
+    two snapshots, leaving out the snapshots themselves"""
+    calls = 0
+    totals = dict((counter, 0) for counter in query_counters)
+    for fingerprint, row in after.items():
+        if "_query_stats" in row["query"]:
+            continue
+        previous = before.get(fingerprint, {})
+        calls += row["calls"] - previous.get("calls", 0)
+        for counter in query_counters:
+            totals[counter] += row[counter] - previous.get(counter, 0)
+    if calls == 0:
+        return None
+    return dict((counter, total / float(calls)) for counter, total in totals.items())
+
 def stop_cluster(cluster):
     """Stop the cluster"""
     cluster.check_and_stop()
@@ -386,6 +431,9 @@ def save_compare_results():
     file_paths = []
     for root, directories, files in os.walk("results/"):
         for filename in files:
+            # Other benchmarks save their results in the same directory.
+            if not filename.startswith("result_"):
+                continue
             # Join the two strings in order to form the full filepath.
             filepath = os.path.join(root, filename)
             file_paths.append(filepath)  # Add it to the list.
@@ -48,6 +48,62 @@ def gen_num_docs(size_doc):
         # 58000 fits in memory for the table with the big cache
         return 30000
 
+# The steps of a `profile: true` trace that say how a query was executed rather than
+# how long it took.  A change in how many times any of them happens means the plan of
+# the query changed.
+plan_steps = {
+    "Perform read on shard.": "shard reads",
+    "Perform write on shard.": "shard writes",
+    "Do range scan on primary index.": "primary index scans",
+    "Do range scan on secondary index.": "secondary index scans",
+    "Do intersection scan on geospatial index.": "geospatial index scans",
+    "Do nearest traversal on geospatial index.": "geospatial nearest traversals",
+    "Sorting in-memory.": "in-memory sorts",
+    "Sorting by index.": "index sorts",
+    "Writing sorted rows to disk.": "sorts spilled to disk",
+    "Evaluating stream eagerly.": "eager stream evaluations"
+}
+
+# How much more a per-call counter from `rethinkdb._query_stats` has to grow before it
+# counts as a plan change rather than noise.
+counter_change_ratio = 2.0
+
+def plan_shape(profile):
+    """Counts the steps of `plan_steps` in a profile trace, ignoring their durations"""
+    shape = {}
+    def walk(node):
+        if isinstance(node, list):
+            for child in node:
+                walk(child)
+        elif isinstance(node, dict):
+            step = plan_steps.get(node.get("description"))
+            if step is not None:
+                shape[step] = shape.get(step, 0) + 1
+            walk(node.get("sub_tasks", []))
+            walk(node.get("parallel_tasks", []))
+    walk(profile)
+    return shape
+
+def plan_changes(new_result, previous_result):
+    """Lists the ways the plan of a query changed between two results: steps of the
+    profile that happen a different number of times, and per-call counters (rows
+    scanned, blocks read, ...) that grew or shrank by more than `counter_change_ratio`
+    times"""
+    changes = []
+    new_plan = new_result.get("plan")
+    previous_plan = previous_result.get("plan")
+    if new_plan is not None and previous_plan is not None:
+        for step in sorted(set(new_plan) | set(previous_plan)):
+            if new_plan.get(step, 0) != previous_plan.get(step, 0):
+                changes.append("%s: %d -> %d" % (step, previous_plan.get(step, 0), new_plan.get(step, 0)))
+    new_counters = new_result.get("counters") or {}
+    previous_counters = previous_result.get("counters") or {}
+    for counter in sorted(set(new_counters) & set(previous_counters)):
+        old, cur = previous_counters[counter], new_counters[counter]
+        if max(old, cur) >= 1 and max(old, cur) > counter_change_ratio * max(min(old, cur), 1e-9):
+            changes.append("%s per call: %.1f -> %.1f" % (counter, old, cur))
+    return changes
+
 def compare(new_results, previous_results):
     str_date = time.strftime("%y.%m.%d-%H:%M:%S")
     
@@ -83,6 +139,7 @@ def compare(new_results, previous_results):
 			<th>99 centile q/s</th>
 			<th>Diff</th>
 			<th>Status</th>
+			<th>Plan</th>
 		</tr></thead>
 		<tbody>
 ''' % {
@@ -97,7 +154,8 @@ def compare(new_results, previous_results):
                 'key50': str(key)[:50], 'status_color':'gray', 'status': 'Unknown', 'diff': 'undefined',
                 'inverse_prev_average': 'Unknown',       'inverse_new_average': "%.2f" % (1 / new_results[key]["average"]),
                 'inverse_prev_first_centile': 'Unknown', 'inverse_new_first_centile': "%.2f" % (1 / new_results[key]["first_centile"]),
-                'inverse_prev_last_centile': 'Unknown',  'inverse_new_last_centile': "%.2f" % (1 / new_results[key]["last_centile"])
+                'inverse_prev_last_centile': 'Unknown',  'inverse_new_last_centile': "%.2f" % (1 / new_results[key]["last_centile"]),
+                'plan_color': 'gray', 'plan': 'Unknown'
             }
             
             if key in previous_results:
@@ -118,6 +176,18 @@ def compare(new_results, previous_results):
                     reportValues['inverse_prev_average'] = "%.2f" % (1 / previous_results[key]["average"])
                     reportValues['inverse_prev_first_centile'] =  "%.2f" % (1 / previous_results[key]["first_centile"])
                     reportValues['inverse_prev_last_centile'] = "%.2f" % (1 / previous_results[key]["last_centile"])
+
+                # A changed plan is reported on its own, so it isn't mistaken for noise
+                # in the timings.
+                if "plan" in new_results[key] and "plan" in previous_results[key]:
+                    changes = plan_changes(new_results[key], previous_results[key])
+                    if changes:
+                        reportValues['plan'] = "Changed: " + "; ".join(changes)
+                        reportValues['plan_color'] = "orange"
+                        print("Plan of %s changed: %s" % (key, "; ".join(changes)))
+                    else:
+                        reportValues['plan'] = "Same"
+                        reportValues['plan_color'] = "green"
             
             try:
                 f.write('''			<tr>
@@ -130,6 +200,7 @@ def compare(new_results, previous_results):
 				<td>%(inverse_new_last_centile)s</td>
 				<td>%(diff)s</td>
 				<td style='background: %(status_color)s'>%(status)s</td>
+				<td style='background: %(plan_color)s'>%(plan)s</td>
 			</tr>
 ''' % reportValues)
             except Exception as e:
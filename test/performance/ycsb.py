@@ -0,0 +1,366 @@
+#!/usr/bin/env python
+# Copyright 2010-2016 RethinkDB, all rights reserved.
+
+'''Run the YCSB core workloads (A to F) against a server or a cluster started from this
+build, and report the throughput and latency percentiles of each workload over time as
+JSON, so that the results of two releases can be compared with `--compare`.'''
+
+from __future__ import print_function
+
+import argparse
+import json
+import math
+import multiprocessing
+import os
+import random
+import sys
+import threading
+import time
+
+sys.path.append(os.path.abspath(os.path.join(os.path.dirname(__file__), os.path.pardir, 'common')))
+import driver, utils
+
+r = utils.import_python_driver()
+
+try:
+    xrange
+except NameError:
+    xrange = range
+
+# The operation mix of each workload, as in YCSB's `workloads/workload[a-f]`, and the
+# distribution its keys are picked from.
+workloads = {
+    "A": {"mix": {"read": 0.5, "update": 0.5}, "distribution": "zipfian"},
+    "B": {"mix": {"read": 0.95, "update": 0.05}, "distribution": "zipfian"},
+    "C": {"mix": {"read": 1.0}, "distribution": "zipfian"},
+    "D": {"mix": {"read": 0.95, "insert": 0.05}, "distribution": "latest"},
+    "E": {"mix": {"scan": 0.95, "insert": 0.05}, "distribution": "zipfian"},
+    "F": {"mix": {"read": 0.5, "read_modify_write": 0.5}, "distribution": "zipfian"}
+}
+
+table_name = "ycsb"
+fields_per_doc = 10
+num_groups = 1000 # Distinct values of the indexed `group` field
+zipfian_constant = 0.99
+
+def percentile(sorted_vals, p):
+    if len(sorted_vals) == 0:
+        return None
+    return sorted_vals[min(len(sorted_vals) - 1, int(math.floor(len(sorted_vals) / 100. * p)))]
+
+def latency_summary(latencies):
+    latencies = sorted(latencies)
+    return {
+        "count": len(latencies),
+        "p50": percentile(latencies, 50),
+        "p95": percentile(latencies, 95),
+        "p99": percentile(latencies, 99),
+        "p999": percentile(latencies, 99.9),
+        "max": latencies[-1] if latencies else None
+    }
+
+def zeta(n, theta):
+    return sum(1 / math.pow(i, theta) for i in xrange(1, n + 1))
+
+def fnv_hash(value):
+    '''64-bit FNV-1a of `value`, which YCSB uses to spread the popular keys of the
+    zipfian distribution over the key space.'''
+    h = 0xCBF29CE484222325
+    for _ in range(8):
+        h ^= value & 0xff
+        h = (h * 0x100000001B3) & 0xFFFFFFFFFFFFFFFF
+        value >>= 8
+    return h
+
+class Zipfian(object):
+    '''Picks numbers in [0, n) with item i having a probability proportional to
+    1 / (i + 1) ^ theta, following Gray et al., "Quickly Generating Billion-Record
+    Synthetic Databases".  `zetan` can be passed in since it takes O(n) to compute.'''
+    def __init__(self, n, theta=zipfian_constant, zetan=None):
+        self.n = n
+        self.theta = theta
+        self.zetan = zeta(n, theta) if zetan is None else zetan
+        zeta2 = zeta(2, theta)
+        self.alpha = 1 / (1 - theta)
+        self.eta = (1 - math.pow(2. / n, 1 - theta)) / (1 - zeta2 / self.zetan)
+
+    def next(self, rand):
+        u = rand.random()
+        uz = u * self.zetan
+        if uz < 1:
+            return 0
+        if uz < 1 + math.pow(0.5, self.theta):
+            return 1
+        return min(self.n - 1, int(self.n * math.pow(self.eta * u - self.eta + 1, self.alpha)))
+
+class KeyChooser(object):
+    '''Picks the key of each read, update or scan.  "zipfian" scrambles the popular
+    keys over the whole key space; "latest" favours the most recently inserted keys.'''
+    def __init__(self, distribution, num_records, zetan, next_key):
+        self.distribution = distribution
+        self.num_records = num_records
+        self.next_key = next_key
+        self.zipfian = Zipfian(num_records, zetan=zetan) if distribution != "uniform" else None
+
+    def choose(self, rand):
+        if self.distribution == "uniform":
+            return rand.randrange(self.num_records)
+        elif self.distribution == "latest":
+            return max(0, self.next_key.value - 1 - self.zipfian.next(rand))
+        else:
+            return fnv_hash(self.zipfian.next(rand)) % self.num_records
+
+def make_doc(key, doc_size, rand):
+    field_size = max(1, doc_size // fields_per_doc)
+    doc = {"id": key, "group": key % num_groups, "ts": time.time()}
+    for i in xrange(fields_per_doc):
+        doc["field%d" % i] = "".join(rand.choice("abcdefghijklmnopqrstuvwxyz")
+                                     for _ in xrange(field_size))
+    return doc
+
+def run_op(op, tbl, conn, keys, options, rand):
+    if op == "read":
+        if rand.random() < options.index_reads:
+            list(tbl.get_all(rand.randrange(num_groups), index="group").limit(10).run(conn))
+        else:
+            tbl.get(keys.choose(rand)).run(conn)
+    elif op == "update":
+        field_size = max(1, options.doc_size // fields_per_doc)
+        tbl.get(keys.choose(rand)).update({
+            "field%d" % rand.randrange(fields_per_doc): "u" * field_size,
+            "ts": time.time()}).run(conn, durability=options.durability)
+    elif op == "insert":
+        with keys.next_key.get_lock():
+            key = keys.next_key.value
+            keys.next_key.value += 1
+        tbl.insert(make_doc(key, options.doc_size, rand)).run(conn, durability=options.durability)
+    elif op == "scan":
+        start = keys.choose(rand)
+        length = rand.randint(1, options.max_scan_length)
+        list(tbl.between(start, r.maxval).order_by(index="id").limit(length).run(conn))
+    elif op == "read_modify_write":
+        key = keys.choose(rand)
+        doc = tbl.get(key).run(conn)
+        if doc is not None:
+            field = "field%d" % rand.randrange(fields_per_doc)
+            tbl.get(key).update({field: doc[field][::-1], "ts": time.time()}) \
+               .run(conn, durability=options.durability)
+    else:
+        raise ValueError("unknown operation: %s" % op)
+
+def client_proc(port, workload, options, zetan, next_key, seed, start_event, sample_queue):
+    '''One client: runs operations of `workload` back to back until the duration is
+    up, then sends its (start time, operation, latency, error) samples back.'''
+    rand = random.Random(seed)
+    keys = KeyChooser(options.distribution or workloads[workload]["distribution"],
+                      options.records, zetan, next_key)
+    mix = sorted(workloads[workload]["mix"].items())
+    tbl = r.db("test").table(table_name)
+    samples = []
+    conn = r.connect(host="localhost", port=port)
+    start_event.wait()
+    end_time = time.time() + options.duration
+    while time.time() < end_time:
+        pick = rand.random()
+        op = mix[-1][0]
+        for name, fraction in mix:
+            if pick < fraction:
+                op = name
+                break
+            pick -= fraction
+        start = time.time()
+        error = None
+        try:
+            run_op(op, tbl, conn, keys, options, rand)
+        except r.errors.ReqlError as ex:
+            error = str(ex)
+        samples.append((start, op, time.time() - start, error))
+    conn.close()
+    sample_queue.put(samples)
+
+class Subscriber(threading.Thread):
+    '''A changefeed on the whole table, which measures how long after each write the
+    change reaches it from the `ts` field the write set.'''
+    def __init__(self, port):
+        super(Subscriber, self).__init__()
+        self.daemon = True
+        self.latencies = []
+        self.conn = r.connect(host="localhost", port=port)
+        self.cursor = r.db("test").table(table_name).changes().run(self.conn)
+
+    def run(self):
+        try:
+            for change in self.cursor:
+                new_val = change.get("new_val")
+                if new_val is not None and "ts" in new_val:
+                    self.latencies.append(time.time() - new_val["ts"])
+        except r.errors.ReqlError:
+            pass # The cursor was closed.
+
+    def close(self):
+        self.conn.close(noreply_wait=False)
+
+def load(conn, options):
+    tbl = r.db("test").table(table_name)
+    rand = random.Random(options.seed)
+    batch_size = 1000
+    for start in xrange(0, options.records, batch_size):
+        end = min(start + batch_size, options.records)
+        res = tbl.insert([make_doc(i, options.doc_size, rand) for i in xrange(start, end)]) \
+                 .run(conn, durability="soft")
+        if res["inserted"] != end - start:
+            raise RuntimeError("Load failed: %s" % res.get("first_error"))
+    tbl.sync().run(conn)
+
+def run_workload(ports, workload, options, zetan, next_key):
+    start_event = multiprocessing.Event()
+    sample_queue = multiprocessing.Queue()
+    procs = [multiprocessing.Process(target=client_proc,
+                                     args=(ports[i % len(ports)], workload, options, zetan,
+                                           next_key, options.seed * 1000 + i, start_event,
+                                           sample_queue))
+             for i in xrange(options.clients)]
+    for proc in procs:
+        proc.start()
+    subscribers = [Subscriber(ports[i % len(ports)]) for i in xrange(options.changefeeds)]
+    for subscriber in subscribers:
+        subscriber.start()
+
+    time.sleep(1) # Let the clients connect.
+    start_time = time.time()
+    start_event.set()
+    samples = []
+    for _ in procs:
+        samples.extend(sample_queue.get())
+    for proc in procs:
+        proc.join()
+    time.sleep(1) # Give the changefeeds a moment to catch up.
+    for subscriber in subscribers:
+        subscriber.close()
+
+    ok = [s for s in samples if s[3] is None]
+    duration = max(s[0] + s[2] for s in samples) - start_time if samples else 0
+    result = {
+        "ops": len(ok),
+        "errors": len(samples) - len(ok),
+        "duration": duration,
+        "ops_per_sec": len(ok) / duration if duration else None,
+        "latency": latency_summary([s[2] for s in ok]),
+        "operations": {},
+        "timeline": []
+    }
+    for op in sorted(workloads[workload]["mix"]):
+        result["operations"][op] = latency_summary([s[2] for s in ok if s[1] == op])
+    buckets = {}
+    for s in ok:
+        buckets.setdefault(int((s[0] - start_time) // options.interval), []).append(s[2])
+    for i in xrange(int(math.ceil(duration / options.interval))):
+        latencies = sorted(buckets.get(i, []))
+        result["timeline"].append({
+            "time": i * options.interval,
+            "ops_per_sec": len(latencies) / options.interval,
+            "p50": percentile(latencies, 50),
+            "p99": percentile(latencies, 99)
+        })
+    if subscribers:
+        result["changefeed_latency"] = latency_summary(
+            [l for s in subscribers for l in s.latencies])
+    return result
+
+def compare(new, previous):
+    '''Prints how the throughput and tail latency of each workload changed.'''
+    print("Compared to %s:" % previous.get("version"))
+    for workload in sorted(new["workloads"]):
+        if workload not in previous["workloads"]:
+            continue
+        a = previous["workloads"][workload]
+        b = new["workloads"][workload]
+        def change(old, cur):
+            if not old or cur is None:
+                return "n/a"
+            return "%+.1f%%" % (100. * (cur - old) / old)
+        print("  %s: %.1f -> %.1f ops/s (%s), p99 %s -> %s s (%s)" % (
+            workload, a["ops_per_sec"] or 0, b["ops_per_sec"] or 0,
+            change(a["ops_per_sec"], b["ops_per_sec"]),
+            a["latency"]["p99"], b["latency"]["p99"],
+            change(a["latency"]["p99"], b["latency"]["p99"])))
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('--build', default=None, help='directory with the rethinkdb executable')
+    parser.add_argument('--data-dir', default='./', help='where to put the server data')
+    parser.add_argument('--servers', type=int, default=1, help='number of servers in the cluster')
+    parser.add_argument('--shards', type=int, default=1)
+    parser.add_argument('--replicas', type=int, default=1)
+    parser.add_argument('--workloads', nargs='+', default=sorted(workloads.keys()),
+                        choices=sorted(workloads.keys()))
+    parser.add_argument('--records', type=int, default=100000, help='documents loaded before the workloads')
+    parser.add_argument('--doc-size', type=int, default=1000, help='approximate bytes per document')
+    parser.add_argument('--distribution', default=None, choices=['zipfian', 'latest', 'uniform'],
+                        help="overrides each workload's key distribution")
+    parser.add_argument('--index-reads', type=float, default=0.0,
+                        help='fraction of reads that go through a secondary index')
+    parser.add_argument('--max-scan-length', type=int, default=100)
+    parser.add_argument('--changefeeds', type=int, default=0,
+                        help='changefeed subscribers open during each workload')
+    parser.add_argument('--clients', type=int, default=16)
+    parser.add_argument('--duration', type=float, default=30, help='seconds per workload')
+    parser.add_argument('--interval', type=float, default=1, help='seconds per timeline entry')
+    parser.add_argument('--durability', default='hard', choices=['hard', 'soft'])
+    parser.add_argument('--seed', type=int, default=0)
+    parser.add_argument('--compare', default=None, help='results of a previous run to compare with')
+    options = parser.parse_args()
+
+    executable_path = utils.find_rethinkdb_executable() if options.build is None \
+        else os.path.realpath(os.path.join(options.build, 'rethinkdb'))
+    if not os.path.basename(os.path.dirname(executable_path)).startswith('release'):
+        sys.stderr.write('Warning: Testing a non-release build: %s\n' % executable_path)
+
+    print("Computing the zipfian constants...", end=' ')
+    sys.stdout.flush()
+    zetan = zeta(options.records, zipfian_constant)
+    print(" Done.")
+
+    results = {"options": vars(options), "workloads": {}}
+    with driver.Cluster(initial_servers=options.servers,
+                        output_folder=os.path.join(options.data_dir, 'ycsb'),
+                        executable_path=executable_path) as cluster:
+        ports = [server.driver_port for server in cluster]
+        conn = r.connect(host="localhost", port=ports[0])
+        results["version"] = list(r.db("rethinkdb").table("server_status")
+                                  ["process"]["version"].run(conn))[0]
+        for workload in options.workloads:
+            # Each workload starts from freshly loaded records, since D and E insert.
+            print("Loading %d records for workload %s..." % (options.records, workload), end=' ')
+            sys.stdout.flush()
+            if "test" not in r.db_list().run(conn):
+                r.db_create("test").run(conn)
+            if table_name in r.db("test").table_list().run(conn):
+                r.db("test").table_drop(table_name).run(conn)
+            r.db("test").table_create(table_name, shards=options.shards,
+                                      replicas=options.replicas).run(conn)
+            r.db("test").table(table_name).index_create("group").run(conn)
+            r.db("test").table(table_name).index_wait().run(conn)
+            r.db("test").table(table_name).wait().run(conn)
+            load(conn, options)
+            print(" Done.\nRunning workload %s..." % workload, end=' ')
+            sys.stdout.flush()
+            next_key = multiprocessing.Value('l', options.records)
+            res = run_workload(ports, workload, options, zetan, next_key)
+            results["workloads"][workload] = res
+            print(" Done. %s ops/s, p99 %s s" % (res["ops_per_sec"], res["latency"]["p99"]))
+            sys.stdout.flush()
+
+    if not os.path.exists("results"):
+        os.makedirs("results")
+    path = "results/ycsb_" + time.strftime("%y.%m.%d-%H:%M:%S") + ".json"
+    with open(path, "w") as f:
+        f.write(json.dumps(results, indent=2, sort_keys=True))
+    print("Results saved to %s" % path)
+
+    if options.compare is not None:
+        with open(options.compare) as f:
+            compare(results, json.load(f))
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,197 @@
+#!/usr/bin/env python
+# Copyright 2010-2016 RethinkDB, all rights reserved.
+
+'''Measures how fast data moves between servers: loads a table, then changes its
+number of replicas step by step, and for each step reports the backfill throughput,
+the time until all replicas are ready, the latency of a foreground workload before and
+during the backfill, and the cluster traffic per replicated write afterwards.'''
+
+from __future__ import print_function
+
+import json, math, os, random, sys, threading, time
+
+startTime = time.time()
+
+sys.path.append(os.path.abspath(os.path.join(os.path.dirname(__file__), os.path.pardir, 'common')))
+import driver, scenario_common, utils, vcoptparse
+
+class ReplicaSequence(object):
+    def __init__(self, string):
+        assert set(string) < set("0123456789+-")
+        string = string.replace("-", "\0-").replace("+", "\0+")
+        parts = string.split("\0")
+        assert set(parts[0]) < set("0123456789")
+        self.initial = int(parts[0])
+        self.steps = [int(x) for x in parts[1:]]
+        current = self.initial
+        for step in self.steps:
+            current += step
+            assert current >= 1
+    def peak(self):
+        peak = current = self.initial
+        for step in self.steps:
+            current += step
+            peak = max(current, peak)
+        return peak
+    def __repr__(self):
+        return str(self.initial) + "".join(("+" if s > 0 else "-") + str(abs(s)) for s in self.steps)
+
+op = vcoptparse.OptParser()
+scenario_common.prepare_option_parser_mode_flags(op)
+op["sequence"] = vcoptparse.PositionalArg(converter=ReplicaSequence)
+op["data-mb"] = vcoptparse.IntFlag("--data-mb", 1024)
+op["doc-size"] = vcoptparse.IntFlag("--doc-size", 1000)
+op["shards"] = vcoptparse.IntFlag("--shards", 1)
+op["baseline-secs"] = vcoptparse.FloatFlag("--baseline-secs", 10)
+op["replicated-writes"] = vcoptparse.IntFlag("--replicated-writes", 2000)
+op["results"] = vcoptparse.StringFlag("--results", None)
+opts = op.parse(sys.argv)
+_, command_prefix, server_options = scenario_common.parse_mode_flags(opts)
+
+r = utils.import_python_driver()
+dbName, tableName = utils.get_test_db_table()
+
+numServers = opts["sequence"].peak()
+numDocs = opts["data-mb"] * 1024 * 1024 // opts["doc-size"]
+
+def percentile(sorted_vals, p):
+    if len(sorted_vals) == 0:
+        return None
+    return sorted_vals[min(len(sorted_vals) - 1, int(math.floor(len(sorted_vals) / 100. * p)))]
+
+def latency_summary(latencies):
+    latencies = sorted(latencies)
+    return {"count": len(latencies), "p50": percentile(latencies, 50),
+            "p99": percentile(latencies, 99), "max": latencies[-1] if latencies else None}
+
+def cluster_bytes_sent(conn):
+    '''Bytes sent over all the intra-cluster connections of all the servers so far.'''
+    total = 0
+    for row in r.db('rethinkdb').table('_debug_stats').run(conn):
+        for peer in (row.get('stats') or {}).get('connectivity', {}).values():
+            if isinstance(peer, dict):
+                total += peer.get('bytes_sent_total', 0)
+    return total
+
+class ForegroundLoad(threading.Thread):
+    '''Point reads and writes against the table, one at a time, recording when each
+    started and how long it took.'''
+    def __init__(self, server):
+        super(ForegroundLoad, self).__init__()
+        self.daemon = True
+        self.conn = r.connect(host=server.host, port=server.driver_port)
+        self.samples = []
+        self.stopping = threading.Event()
+
+    def run(self):
+        tbl = r.db(dbName).table(tableName)
+        rand = random.Random(0)
+        while not self.stopping.is_set():
+            key = rand.randrange(numDocs)
+            start = time.time()
+            if rand.random() < 0.5:
+                tbl.get(key).run(self.conn)
+            else:
+                tbl.get(key).update({'fg': start}).run(self.conn)
+            self.samples.append((start, time.time() - start))
+
+    def latencies(self, start, end):
+        return latency_summary([l for t, l in self.samples if start <= t < end])
+
+    def stop(self):
+        self.stopping.set()
+        self.join()
+        self.conn.close()
+
+def set_replicas(conn, servers, count):
+    shards = []
+    for i in range(opts["shards"]):
+        replicas = [servers[(i + j) % len(servers)].name for j in range(count)]
+        shards.append({'primary_replica': replicas[0], 'replicas': replicas})
+    res = r.db(dbName).table(tableName).config().update({'shards': shards}).run(conn)
+    assert res['errors'] == 0, res
+
+results = {"options": {"sequence": repr(opts["sequence"]), "data_mb": opts["data-mb"],
+                       "doc_size": opts["doc-size"], "shards": opts["shards"]},
+           "steps": []}
+
+with driver.Cluster(output_folder='.', initial_servers=numServers, console_output=True, command_prefix=command_prefix, extra_options=server_options) as cluster:
+    servers = list(cluster)
+    primary = servers[0]
+
+    utils.print_with_time('Establishing ReQL connection')
+    conn = r.connect(host=primary.host, port=primary.driver_port)
+
+    utils.print_with_time('Creating db/table %s/%s' % (dbName, tableName))
+    if dbName not in r.db_list().run(conn):
+        r.db_create(dbName).run(conn)
+    if tableName in r.db(dbName).table_list().run(conn):
+        r.db(dbName).table_drop(tableName).run(conn)
+    r.db(dbName).table_create(tableName).run(conn)
+    current = opts["sequence"].initial
+    set_replicas(conn, servers, current)
+    r.db(dbName).wait(wait_for="all_replicas_ready").run(conn)
+
+    utils.print_with_time('Loading %d documents (%d MB)' % (numDocs, opts["data-mb"]))
+    payload = 'x' * max(1, opts["doc-size"] - 20)
+    batch = 1000
+    for first in range(0, numDocs, batch):
+        docs = [{'id': i, 'payload': payload} for i in range(first, min(numDocs, first + batch))]
+        res = r.db(dbName).table(tableName).insert(docs).run(conn, durability='soft')
+        assert res['inserted'] == len(docs), res
+    r.db(dbName).table(tableName).sync().run(conn)
+
+    for i, step in enumerate(opts["sequence"].steps):
+        utils.print_with_time("Changing the number of replicas from %d to %d" % (current, current + step))
+
+        load = ForegroundLoad(primary)
+        load.start()
+        baselineStart = time.time()
+        time.sleep(opts["baseline-secs"])
+
+        bytesBefore = cluster_bytes_sent(conn)
+        stepStart = time.time()
+        set_replicas(conn, servers, current + step)
+        r.db(dbName).wait(wait_for="all_replicas_ready", timeout=24 * 60 * 60).run(conn)
+        stepEnd = time.time()
+        bytesDuring = cluster_bytes_sent(conn) - bytesBefore
+        load.stop()
+        current += step
+
+        # The writes after the step go to `current` replicas, with nothing else
+        # running.
+        bytesBefore = cluster_bytes_sent(conn)
+        tbl = r.db(dbName).table(tableName)
+        for j in range(opts["replicated-writes"]):
+            tbl.get(j % numDocs).update({'rw': j}).run(conn)
+        bytesPerWrite = (cluster_bytes_sent(conn) - bytesBefore) / float(opts["replicated-writes"])
+
+        secs = stepEnd - stepStart
+        # Each added replica receives the whole table.
+        backfilledBytes = max(step, 0) * numDocs * opts["doc-size"]
+        result = {
+            "replicas_before": current - step,
+            "replicas_after": current,
+            "time_to_ready_secs": secs,
+            "backfill_mb_per_sec": backfilledBytes / secs / (1024 * 1024) if step > 0 else None,
+            "cluster_mb_sent": bytesDuring / (1024. * 1024),
+            "foreground_latency_before": load.latencies(baselineStart, stepStart),
+            "foreground_latency_during": load.latencies(stepStart, stepEnd),
+            "cluster_bytes_per_replicated_write": bytesPerWrite
+        }
+        results["steps"].append(result)
+        utils.print_with_time("Step %d: ready after %.1f s, %s MB/s, foreground p99 %s s -> %s s, %.0f bytes per write" % (
+            i, secs, result["backfill_mb_per_sec"], result["foreground_latency_before"]["p99"],
+            result["foreground_latency_during"]["p99"], bytesPerWrite))
+
+        cluster.check()
+        issues = list(r.db('rethinkdb').table('current_issues').filter(r.row["type"] != "memory_error").run(conn))
+        assert issues == [], 'There were unexpected issues after step %d: \n%s' % (i, utils.RePrint.pformat(issues))
+
+    utils.print_with_time('Cleaning up')
+
+print(json.dumps(results, indent=2))
+if opts["results"] is not None:
+    with open(opts["results"], "w") as f:
+        f.write(json.dumps(results, indent=2))
+utils.print_with_time('Done.')